@@ -51,6 +51,18 @@ STATIC mp_obj_t dht_readinto(mp_obj_t pin_in, mp_obj_t buf_in) {
     // issue start command
     mp_hal_pin_od_high_dht(pin);
     mp_hal_delay_ms(250);
+
+    #ifdef mp_hal_dht_readinto
+    // the port may generate the start pulse and time the response in
+    // hardware, or return -1 to have it bit-banged
+    int ret = mp_hal_dht_readinto(pin, bufinfo.buf);
+    if (ret > 0) {
+        mp_raise_OSError(ret);
+    } else if (ret == 0) {
+        return mp_const_none;
+    }
+    #endif
+
     mp_hal_pin_od_low(pin);
     mp_hal_delay_ms(18);
 
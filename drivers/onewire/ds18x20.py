@@ -2,6 +2,8 @@
 # MIT license; Copyright (c) 2016 Damien P. George
 
 from micropython import const
+import time
+import _onewire as _ow
 
 _CONVERT = const(0x44)
 _RD_SCRATCH = const(0xbe)
@@ -21,19 +23,13 @@ class DS18X20:
         self.ow.writebyte(_CONVERT)
 
     def read_scratch(self, rom):
-        self.ow.reset(True)
-        self.ow.select_rom(rom)
-        self.ow.writebyte(_RD_SCRATCH)
-        self.ow.readinto(self.buf)
+        self.ow.transfer(rom, bytes((_RD_SCRATCH,)), self.buf)
         if self.ow.crc8(self.buf):
             raise Exception('CRC error')
         return self.buf
 
     def write_scratch(self, rom, buf):
-        self.ow.reset(True)
-        self.ow.select_rom(rom)
-        self.ow.writebyte(_WR_SCRATCH)
-        self.ow.write(buf)
+        self.ow.transfer(rom, bytes((_WR_SCRATCH,)) + buf)
 
     def read_temp(self, rom):
         buf = self.read_scratch(rom)
@@ -49,3 +45,32 @@ class DS18X20:
             if t & 0x8000: # sign bit set
                 t = -((t ^ 0xffff) + 1)
             return t / 16
+
+# Conversions on several buses at once.  sensors is a list of (DS18X20, rom)
+# pairs, typically from scan() on each bus.
+
+def _pins(sensors):
+    pins = []
+    for ds, _ in sensors:
+        if ds.ow.pin not in pins:
+            pins.append(ds.ow.pin)
+    return pins
+
+def convert_all(sensors):
+    # start a conversion on every bus, they all run at the same time
+    _ow.broadcast(_pins(sensors), _CONVERT)
+
+def ready(sensors):
+    # True once every conversion has finished; parasite-powered sensors
+    # can't signal this and always look ready
+    return _ow.ready(_pins(sensors))
+
+def read_all(sensors, timeout_ms=750):
+    # convert on all buses, poll until done, then return the temperatures
+    # in the same order as sensors
+    pins = _pins(sensors)
+    _ow.broadcast(pins, _CONVERT)
+    t0 = time.ticks_ms()
+    while not _ow.ready(pins) and time.ticks_diff(time.ticks_ms(), t0) < timeout_ms:
+        time.sleep_ms(10)
+    return [ds.read_temp(rom) for ds, rom in sensors]
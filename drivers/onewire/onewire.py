@@ -29,8 +29,7 @@ class OneWire:
         return _ow.readbyte(self.pin)
 
     def readinto(self, buf):
-        for i in range(len(buf)):
-            buf[i] = _ow.readbyte(self.pin)
+        _ow.readinto(self.pin, buf)
 
     def writebit(self, value):
         return _ow.writebit(self.pin, value)
@@ -39,14 +38,18 @@ class OneWire:
         return _ow.writebyte(self.pin, value)
 
     def write(self, buf):
-        for b in buf:
-            _ow.writebyte(self.pin, b)
+        _ow.write(self.pin, buf)
 
     def select_rom(self, rom):
         self.reset()
         self.writebyte(MATCH_ROM)
         self.write(rom)
 
+    def transfer(self, rom, wbuf, rbuf=None):
+        # reset, select rom (all devices if None), write wbuf then read rbuf
+        if not _ow.transfer(self.pin, rom, wbuf, rbuf):
+            raise OneWireError
+
     def scan(self):
         devices = []
         diff = 65
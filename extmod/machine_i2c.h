@@ -50,6 +50,13 @@ typedef struct _mp_machine_soft_i2c_obj_t {
 extern const mp_obj_type_t machine_i2c_type;
 extern const mp_obj_dict_t mp_machine_soft_i2c_locals_dict;
 
+// methods that only use the readfrom/writeto protocol entries, for reuse
+// by port I2C types
+MP_DECLARE_CONST_FUN_OBJ_1(machine_i2c_scan_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_i2c_readfrom_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_i2c_readfrom_into_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(machine_i2c_writeto_obj);
+
 int mp_machine_soft_i2c_readfrom(mp_obj_base_t *self_in, uint16_t addr, uint8_t *dest, size_t len, bool stop);
 int mp_machine_soft_i2c_writeto(mp_obj_base_t *self_in, uint16_t addr, const uint8_t *src, size_t len, bool stop);
 
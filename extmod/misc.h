@@ -36,10 +36,13 @@ MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_uos_dupterm_obj);
 
 #if MICROPY_PY_OS_DUPTERM
 int mp_uos_dupterm_rx_chr(void);
+int mp_uos_dupterm_rx_strn(byte *buf, size_t len);
 void mp_uos_dupterm_tx_strn(const char *str, size_t len);
+void mp_uos_dupterm_tx_strn_cooked(const char *str, size_t len);
 void mp_uos_deactivate(size_t dupterm_idx, const char *msg, mp_obj_t exc);
 #else
 #define mp_uos_dupterm_tx_strn(s, l)
+#define mp_uos_dupterm_tx_strn_cooked(s, l)
 #endif
 
 #endif // MICROPY_INCLUDED_EXTMOD_MISC_H
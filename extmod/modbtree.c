@@ -118,6 +118,56 @@ STATIC mp_obj_t btree_get(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(btree_get_obj, 2, 3, btree_get);
 
+// Insert (key, value) pairs from an iterable whose keys are strictly
+// ascending.  The library appends such keys to the last leaf without doing a
+// search, and when that leaf fills it starts a new empty one rather than
+// splitting it in half, so the leaves are written out full and in order.
+STATIC mp_obj_t btree_bulk_load(mp_obj_t self_in, mp_obj_t iter_in) {
+    mp_obj_btree_t *self = MP_OBJ_TO_PTR(self_in);
+    BTREE *t = self->db->internal;
+    mp_obj_iter_buf_t iter_buf;
+    mp_obj_t iterable = mp_getiter(iter_in, &iter_buf);
+    mp_obj_t item;
+    mp_obj_t last_key = MP_OBJ_NULL;
+    mp_int_t count = 0;
+    while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+        mp_obj_t *kv;
+        mp_obj_get_array_fixed_n(item, 2, &kv);
+        DBT key, val;
+        key.data = (void*)mp_obj_str_get_data(kv[0], &key.size);
+        val.data = (void*)mp_obj_str_get_data(kv[1], &val.size);
+        if (last_key != MP_OBJ_NULL) {
+            DBT prev_key;
+            prev_key.data = (void*)mp_obj_str_get_data(last_key, &prev_key.size);
+            if (t->bt_cmp(&key, &prev_key) <= 0) {
+                mp_raise_ValueError("keys not sorted");
+            }
+        }
+        int res = __bt_put(self->db, &key, &val, 0);
+        CHECK_ERROR(res);
+        last_key = kv[0];
+        count++;
+    }
+    return MP_OBJ_NEW_SMALL_INT(count);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(btree_bulk_load_obj, btree_bulk_load);
+
+#if MICROPY_PY_BTREE_STATS
+// Page cache counters of the underlying mpool: (hits, misses, reads, writes)
+STATIC mp_obj_t btree_stats(mp_obj_t self_in) {
+    mp_obj_btree_t *self = MP_OBJ_TO_PTR(self_in);
+    MPOOL *mp = ((BTREE*)self->db->internal)->bt_mp;
+    mp_obj_t items[4] = {
+        mp_obj_new_int_from_uint(mp->cachehit),
+        mp_obj_new_int_from_uint(mp->cachemiss),
+        mp_obj_new_int_from_uint(mp->pageread),
+        mp_obj_new_int_from_uint(mp->pagewrite),
+    };
+    return mp_obj_new_tuple(4, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(btree_stats_obj, btree_stats);
+#endif
+
 STATIC mp_obj_t btree_seq(size_t n_args, const mp_obj_t *args) {
     mp_obj_btree_t *self = MP_OBJ_TO_PTR(args[0]);
     int flags = MP_OBJ_SMALL_INT_VALUE(args[1]);
@@ -304,6 +354,10 @@ STATIC const mp_rom_map_elem_t btree_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_keys), MP_ROM_PTR(&btree_keys_obj) },
     { MP_ROM_QSTR(MP_QSTR_values), MP_ROM_PTR(&btree_values_obj) },
     { MP_ROM_QSTR(MP_QSTR_items), MP_ROM_PTR(&btree_items_obj) },
+    { MP_ROM_QSTR(MP_QSTR_bulk_load), MP_ROM_PTR(&btree_bulk_load_obj) },
+    #if MICROPY_PY_BTREE_STATS
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&btree_stats_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(btree_locals_dict, btree_locals_dict_table);
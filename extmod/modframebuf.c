@@ -59,6 +59,30 @@ typedef struct _mp_framebuf_p_t {
 #define FRAMEBUF_GS8      (6)
 #define FRAMEBUF_MHLSB    (3)
 #define FRAMEBUF_MHMSB    (4)
+#define FRAMEBUF_RGB888   (7)
+#define FRAMEBUF_GRB888   (8)
+
+// Bytes per pixel of the formats whose pixels are whole bytes, else 0
+STATIC int format_bytes_per_pixel(int format) {
+    switch (format) {
+        case FRAMEBUF_GS8:
+            return 1;
+        case FRAMEBUF_RGB565:
+            return 2;
+        case FRAMEBUF_RGB888:
+        case FRAMEBUF_GRB888:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+// Fill the rest of a rectangle by copying its first row, which is filled
+STATIC void fill_rect_copy_rows(uint8_t *row, size_t row_len, size_t stride_bytes, int h) {
+    for (uint8_t *b = row + stride_bytes; --h > 0; b += stride_bytes) {
+        memcpy(b, row, row_len);
+    }
+}
 
 // Functions for MHLSB and MHMSB
 
@@ -77,14 +101,25 @@ STATIC uint32_t mono_horiz_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
 STATIC void mono_horiz_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
     int reverse = fb->format == FRAMEBUF_MHMSB;
     int advance = fb->stride >> 3;
-    while (w--) {
-        uint8_t *b = &((uint8_t*)fb->buf)[(x >> 3) + y * advance];
-        int offset = reverse ?  x & 7 : 7 - (x & 7);
-        for (int hh = h; hh; --hh) {
-            *b = (*b & ~(0x01 << offset)) | ((col != 0) << offset);
-            b += advance;
+    uint8_t *row = &((uint8_t*)fb->buf)[(x >> 3) + y * advance];
+    int xlast = x + w - 1;
+    // bits of the first and last bytes of each row that are in the rectangle
+    uint8_t first_mask = reverse ? 0xff << (x & 7) : 0xff >> (x & 7);
+    uint8_t last_mask = reverse ? 0xff >> (7 - (xlast & 7)) : 0xff << (7 - (xlast & 7));
+    int nbytes = (xlast >> 3) - (x >> 3);
+    if (nbytes == 0) {
+        first_mask &= last_mask;
+    }
+    uint8_t fill = col ? 0xff : 0;
+    while (h--) {
+        uint8_t *b = row;
+        *b = (*b & ~first_mask) | (fill & first_mask);
+        if (nbytes != 0) {
+            memset(b + 1, fill, nbytes - 1);
+            b += nbytes;
+            *b = (*b & ~last_mask) | (fill & last_mask);
         }
-        ++x;
+        row += advance;
     }
 }
 
@@ -101,14 +136,18 @@ STATIC uint32_t mvlsb_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
 }
 
 STATIC void mvlsb_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
-    while (h--) {
+    uint8_t fill = col ? 0xff : 0;
+    // each byte holds 8 rows, so do all the rows that fall into a byte in one pass
+    while (h > 0) {
         uint8_t *b = &((uint8_t*)fb->buf)[(y >> 3) * fb->stride + x];
-        uint8_t offset = y & 0x07;
+        int n = MIN(h, 8 - (y & 0x07));
+        uint8_t mask = ((1 << n) - 1) << (y & 0x07);
         for (int ww = w; ww; --ww) {
-            *b = (*b & ~(0x01 << offset)) | ((col != 0) << offset);
+            *b = (*b & ~mask) | (fill & mask);
             ++b;
         }
-        ++y;
+        y += n;
+        h -= n;
     }
 }
 
@@ -124,12 +163,10 @@ STATIC uint32_t rgb565_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
 
 STATIC void rgb565_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
     uint16_t *b = &((uint16_t*)fb->buf)[x + y * fb->stride];
-    while (h--) {
-        for (int ww = w; ww; --ww) {
-            *b++ = col;
-        }
-        b += fb->stride - w;
+    for (int ww = 0; ww < w; ++ww) {
+        b[ww] = col;
     }
+    fill_rect_copy_rows((uint8_t*)b, w * 2, fb->stride * 2, h);
 }
 
 // Functions for GS2_HMSB format
@@ -226,6 +263,31 @@ STATIC void gs8_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int
     }
 }
 
+// Functions for RGB888 and GRB888 formats, with colours given as 0xRRGGBB;
+// GRB888 is the byte order of WS2812 (NeoPixel) LEDs
+
+STATIC void rgb888_setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
+    uint8_t *pixel = &((uint8_t*)fb->buf)[(x + y * fb->stride) * 3];
+    int grb = fb->format == FRAMEBUF_GRB888;
+    pixel[grb] = col >> 16;
+    pixel[!grb] = col >> 8;
+    pixel[2] = col;
+}
+
+STATIC uint32_t rgb888_getpixel(const mp_obj_framebuf_t *fb, int x, int y) {
+    const uint8_t *pixel = &((uint8_t*)fb->buf)[(x + y * fb->stride) * 3];
+    int grb = fb->format == FRAMEBUF_GRB888;
+    return pixel[grb] << 16 | pixel[!grb] << 8 | pixel[2];
+}
+
+STATIC void rgb888_fill_rect(const mp_obj_framebuf_t *fb, int x, int y, int w, int h, uint32_t col) {
+    uint8_t *row = &((uint8_t*)fb->buf)[(x + y * fb->stride) * 3];
+    for (int ww = 0; ww < w; ++ww) {
+        rgb888_setpixel(fb, x + ww, y, col);
+    }
+    fill_rect_copy_rows(row, w * 3, fb->stride * 3, h);
+}
+
 STATIC mp_framebuf_p_t formats[] = {
     [FRAMEBUF_MVLSB] = {mvlsb_setpixel, mvlsb_getpixel, mvlsb_fill_rect},
     [FRAMEBUF_RGB565] = {rgb565_setpixel, rgb565_getpixel, rgb565_fill_rect},
@@ -234,6 +296,8 @@ STATIC mp_framebuf_p_t formats[] = {
     [FRAMEBUF_GS8] = {gs8_setpixel, gs8_getpixel, gs8_fill_rect},
     [FRAMEBUF_MHLSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect},
     [FRAMEBUF_MHMSB] = {mono_horiz_setpixel, mono_horiz_getpixel, mono_horiz_fill_rect},
+    [FRAMEBUF_RGB888] = {rgb888_setpixel, rgb888_getpixel, rgb888_fill_rect},
+    [FRAMEBUF_GRB888] = {rgb888_setpixel, rgb888_getpixel, rgb888_fill_rect},
 };
 
 static inline void setpixel(const mp_obj_framebuf_t *fb, int x, int y, uint32_t col) {
@@ -294,6 +358,8 @@ STATIC mp_obj_t framebuf_make_new(const mp_obj_type_t *type, size_t n_args, size
             o->stride = (o->stride + 1) & ~1;
             break;
         case FRAMEBUF_GS8:
+        case FRAMEBUF_RGB888:
+        case FRAMEBUF_GRB888:
             break;
         default:
             mp_raise_ValueError("invalid format");
@@ -306,7 +372,7 @@ STATIC mp_int_t framebuf_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo,
     (void)flags;
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
     bufinfo->buf = self->buf;
-    bufinfo->len = self->stride * self->height * (self->format == FRAMEBUF_RGB565 ? 2 : 1);
+    bufinfo->len = self->stride * self->height * MAX(1, format_bytes_per_pixel(self->format));
     bufinfo->typecode = 'B'; // view framebuf as bytes
     return 0;
 }
@@ -495,6 +561,17 @@ STATIC mp_obj_t framebuf_blit(size_t n_args, const mp_obj_t *args) {
     int x0end = MIN(self->width, x + source->width);
     int y0end = MIN(self->height, y + source->height);
 
+    int bpp = format_bytes_per_pixel(self->format);
+    if (key == -1 && bpp != 0 && source->format == self->format) {
+        // same whole-byte format and no transparent colour, so copy whole rows
+        size_t row_len = (x0end - x0) * bpp;
+        for (; y0 < y0end; ++y0, ++y1) {
+            memmove((uint8_t*)self->buf + (x0 + y0 * self->stride) * bpp,
+                (uint8_t*)source->buf + (x1 + y1 * source->stride) * bpp, row_len);
+        }
+        return mp_const_none;
+    }
+
     for (; y0 < y0end; ++y0) {
         int cx1 = x1;
         for (int cx0 = x0; cx0 < x0end; ++cx0) {
@@ -514,6 +591,24 @@ STATIC mp_obj_t framebuf_scroll(mp_obj_t self_in, mp_obj_t xstep_in, mp_obj_t ys
     mp_obj_framebuf_t *self = MP_OBJ_TO_PTR(self_in);
     mp_int_t xstep = mp_obj_get_int(xstep_in);
     mp_int_t ystep = mp_obj_get_int(ystep_in);
+    int bpp = format_bytes_per_pixel(self->format);
+    if (bpp != 0) {
+        // whole-byte format, so move the part of each row that stays in view
+        if (xstep <= -self->width || xstep >= self->width || ystep <= -self->height || ystep >= self->height) {
+            return mp_const_none;
+        }
+        size_t row_len = (self->width - (xstep < 0 ? -xstep : xstep)) * bpp;
+        int x0 = MAX(0, xstep);
+        int x1 = MAX(0, -xstep);
+        int y = ystep < 0 ? 0 : self->height - 1;
+        int yend = ystep < 0 ? self->height + ystep : ystep - 1;
+        int dy = ystep < 0 ? 1 : -1;
+        for (; y != yend; y += dy) {
+            memmove((uint8_t*)self->buf + (x0 + y * self->stride) * bpp,
+                (uint8_t*)self->buf + (x1 + (y - ystep) * self->stride) * bpp, row_len);
+        }
+        return mp_const_none;
+    }
     int sx, y, xend, yend, dx, dy;
     if (xstep < 0) {
         sx = 0;
@@ -568,9 +663,13 @@ STATIC mp_obj_t framebuf_text(size_t n_args, const mp_obj_t *args) {
                 uint vline_data = chr_data[j]; // each byte is a column of 8 pixels, LSB at top
                 for (int y = y0; vline_data; vline_data >>= 1, y++) { // scan over vertical column
                     if (vline_data & 1) { // only draw if pixel set
-                        if (0 <= y && y < self->height) { // clip y
-                            setpixel(self, x0, y, col);
+                        // draw the run of set pixels starting here in one go
+                        int run = 1;
+                        for (; vline_data & 2; vline_data >>= 1) {
+                            ++run;
                         }
+                        fill_rect(self, x0, y, 1, run, col); // clips y
+                        y += run - 1;
                     }
                 }
             }
@@ -636,6 +735,8 @@ STATIC const mp_rom_map_elem_t framebuf_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_GS8), MP_ROM_INT(FRAMEBUF_GS8) },
     { MP_ROM_QSTR(MP_QSTR_MONO_HLSB), MP_ROM_INT(FRAMEBUF_MHLSB) },
     { MP_ROM_QSTR(MP_QSTR_MONO_HMSB), MP_ROM_INT(FRAMEBUF_MHMSB) },
+    { MP_ROM_QSTR(MP_QSTR_RGB888), MP_ROM_INT(FRAMEBUF_RGB888) },
+    { MP_ROM_QSTR(MP_QSTR_GRB888), MP_ROM_INT(FRAMEBUF_GRB888) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(framebuf_module_globals, framebuf_module_globals_table);
@@ -43,7 +43,17 @@
 #define TIMING_WRITE2 (50)
 #define TIMING_WRITE3 (10)
 
+#define ONEWIRE_MATCH_ROM (0x55)
+#define ONEWIRE_SKIP_ROM (0xcc)
+
 STATIC int onewire_bus_reset(mp_hal_pin_obj_t pin) {
+    #ifdef mp_hal_onewire_reset
+    // the port may do the reset in hardware, or return -1
+    int hw_status = mp_hal_onewire_reset(pin);
+    if (hw_status >= 0) {
+        return hw_status;
+    }
+    #endif
     mp_hal_pin_write(pin, 0);
     mp_hal_delay_us(TIMING_RESET1);
     uint32_t i = mp_hal_quiet_timing_enter();
@@ -81,6 +91,41 @@ STATIC void onewire_bus_writebit(mp_hal_pin_obj_t pin, int value) {
     mp_hal_quiet_timing_exit(i);
 }
 
+// Whole-byte transfers go through the port's hooks when it has them; a
+// negative return from a hook asks for the bit-banged version
+
+STATIC int onewire_bus_readbyte(mp_hal_pin_obj_t pin) {
+    #ifdef mp_hal_onewire_readbyte
+    int hw_value = mp_hal_onewire_readbyte(pin);
+    if (hw_value >= 0) {
+        return hw_value;
+    }
+    #endif
+    uint8_t value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value |= onewire_bus_readbit(pin) << i;
+    }
+    return value;
+}
+
+STATIC void onewire_bus_writebyte(mp_hal_pin_obj_t pin, int value) {
+    #ifdef mp_hal_onewire_writebyte
+    if (mp_hal_onewire_writebyte(pin, value) == 0) {
+        return;
+    }
+    #endif
+    for (int i = 0; i < 8; ++i) {
+        onewire_bus_writebit(pin, value & 1);
+        value >>= 1;
+    }
+}
+
+STATIC void onewire_bus_write(mp_hal_pin_obj_t pin, const uint8_t *buf, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        onewire_bus_writebyte(pin, buf[i]);
+    }
+}
+
 /******************************************************************************/
 // MicroPython bindings
 
@@ -95,14 +140,20 @@ STATIC mp_obj_t onewire_readbit(mp_obj_t pin_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_readbit_obj, onewire_readbit);
 
 STATIC mp_obj_t onewire_readbyte(mp_obj_t pin_in) {
+    return MP_OBJ_NEW_SMALL_INT(onewire_bus_readbyte(mp_hal_get_pin_obj(pin_in)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_readbyte_obj, onewire_readbyte);
+
+STATIC mp_obj_t onewire_readinto(mp_obj_t pin_in, mp_obj_t buf_in) {
     mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(pin_in);
-    uint8_t value = 0;
-    for (int i = 0; i < 8; ++i) {
-        value |= onewire_bus_readbit(pin) << i;
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    for (size_t i = 0; i < bufinfo.len; ++i) {
+        ((uint8_t*)bufinfo.buf)[i] = onewire_bus_readbyte(pin);
     }
-    return MP_OBJ_NEW_SMALL_INT(value);
+    return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_readbyte_obj, onewire_readbyte);
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_readinto_obj, onewire_readinto);
 
 STATIC mp_obj_t onewire_writebit(mp_obj_t pin_in, mp_obj_t value_in) {
     onewire_bus_writebit(mp_hal_get_pin_obj(pin_in), mp_obj_get_int(value_in));
@@ -111,16 +162,88 @@ STATIC mp_obj_t onewire_writebit(mp_obj_t pin_in, mp_obj_t value_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_writebit_obj, onewire_writebit);
 
 STATIC mp_obj_t onewire_writebyte(mp_obj_t pin_in, mp_obj_t value_in) {
-    mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(pin_in);
-    int value = mp_obj_get_int(value_in);
-    for (int i = 0; i < 8; ++i) {
-        onewire_bus_writebit(pin, value & 1);
-        value >>= 1;
-    }
+    onewire_bus_writebyte(mp_hal_get_pin_obj(pin_in), mp_obj_get_int(value_in));
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_writebyte_obj, onewire_writebyte);
 
+STATIC mp_obj_t onewire_write(mp_obj_t pin_in, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    onewire_bus_write(mp_hal_get_pin_obj(pin_in), bufinfo.buf, bufinfo.len);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_write_obj, onewire_write);
+
+// transfer(pin, rom, wbuf, rbuf)
+// One transaction: reset, address the device with the given rom (or all
+// devices if rom is None), write wbuf and then read into rbuf.  Returns
+// False, without writing, if no device answered the reset.
+STATIC mp_obj_t onewire_transfer(size_t n_args, const mp_obj_t *args) {
+    mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(args[0]);
+    mp_buffer_info_t wbuf;
+    mp_get_buffer_raise(args[2], &wbuf, MP_BUFFER_READ);
+    mp_buffer_info_t rbuf = { .buf = NULL, .len = 0 };
+    if (args[3] != mp_const_none) {
+        mp_get_buffer_raise(args[3], &rbuf, MP_BUFFER_WRITE);
+    }
+    if (!onewire_bus_reset(pin)) {
+        return mp_const_false;
+    }
+    if (args[1] == mp_const_none) {
+        onewire_bus_writebyte(pin, ONEWIRE_SKIP_ROM);
+    } else {
+        mp_buffer_info_t rom;
+        mp_get_buffer_raise(args[1], &rom, MP_BUFFER_READ);
+        onewire_bus_writebyte(pin, ONEWIRE_MATCH_ROM);
+        onewire_bus_write(pin, rom.buf, rom.len);
+    }
+    onewire_bus_write(pin, wbuf.buf, wbuf.len);
+    for (size_t i = 0; i < rbuf.len; ++i) {
+        ((uint8_t*)rbuf.buf)[i] = onewire_bus_readbyte(pin);
+    }
+    return mp_const_true;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(onewire_transfer_obj, 4, 4, onewire_transfer);
+
+// broadcast(pins, cmd)
+// Reset each bus in turn and send cmd to all the devices on it, so that for
+// example a temperature conversion runs on every bus at the same time.
+// Returns the number of buses on which a device answered the reset.
+STATIC mp_obj_t onewire_broadcast(mp_obj_t pins_in, mp_obj_t cmd_in) {
+    size_t n_pins;
+    mp_obj_t *pins;
+    mp_obj_get_array(pins_in, &n_pins, &pins);
+    int cmd = mp_obj_get_int(cmd_in);
+    mp_int_t present = 0;
+    for (size_t i = 0; i < n_pins; ++i) {
+        mp_hal_pin_obj_t pin = mp_hal_get_pin_obj(pins[i]);
+        if (onewire_bus_reset(pin)) {
+            onewire_bus_writebyte(pin, ONEWIRE_SKIP_ROM);
+            onewire_bus_writebyte(pin, cmd);
+            ++present;
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(present);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(onewire_broadcast_obj, onewire_broadcast);
+
+// ready(pins)
+// Issue a read slot on each bus.  Devices busy with a command hold the line
+// low, so this returns True once all of them have finished.
+STATIC mp_obj_t onewire_ready(mp_obj_t pins_in) {
+    size_t n_pins;
+    mp_obj_t *pins;
+    mp_obj_get_array(pins_in, &n_pins, &pins);
+    for (size_t i = 0; i < n_pins; ++i) {
+        if (!onewire_bus_readbit(mp_hal_get_pin_obj(pins[i]))) {
+            return mp_const_false;
+        }
+    }
+    return mp_const_true;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(onewire_ready_obj, onewire_ready);
+
 STATIC mp_obj_t onewire_crc8(mp_obj_t data) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
@@ -149,8 +272,13 @@ STATIC const mp_rom_map_elem_t onewire_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&onewire_reset_obj) },
     { MP_ROM_QSTR(MP_QSTR_readbit), MP_ROM_PTR(&onewire_readbit_obj) },
     { MP_ROM_QSTR(MP_QSTR_readbyte), MP_ROM_PTR(&onewire_readbyte_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&onewire_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_writebit), MP_ROM_PTR(&onewire_writebit_obj) },
     { MP_ROM_QSTR(MP_QSTR_writebyte), MP_ROM_PTR(&onewire_writebyte_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&onewire_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_transfer), MP_ROM_PTR(&onewire_transfer_obj) },
+    { MP_ROM_QSTR(MP_QSTR_broadcast), MP_ROM_PTR(&onewire_broadcast_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ready), MP_ROM_PTR(&onewire_ready_obj) },
     { MP_ROM_QSTR(MP_QSTR_crc8), MP_ROM_PTR(&onewire_crc8_obj) },
 };
 
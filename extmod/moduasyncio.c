@@ -0,0 +1,524 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "py/stream.h"
+#include "py/builtin.h"
+#include "py/smallint.h"
+#include "py/mpstate.h"
+#include "extmod/modutimeq.h"
+
+#if MICROPY_PY_UASYNCIO
+
+// Event loop for generator-based coroutines, with the API of uasyncio from
+// micropython-lib.
+//
+// Runnable coroutines and callbacks are kept in a fixed size ring, those that
+// sleep in a utimeq ordered by the time they wake, and those waiting for a
+// stream are registered with a uselect.poll object.  A coroutine waits by
+// yielding (or awaiting) the result of sleep_ms(), wait_read() and so on, and
+// a bare yield lets the others run.  The loop returns when there is nothing
+// left to run or wait for.
+
+#define TICKS_PERIOD (MICROPY_PY_UTIME_TICKS_PERIOD)
+#define TICKS_MAX (TICKS_PERIOD - 1)
+#define TICKS_HALFPERIOD (TICKS_PERIOD / 2)
+
+#define REQ_SLEEP (0)
+#define REQ_READ (1)
+#define REQ_WRITE (2)
+
+// What a coroutine waits for.  It is filled in by sleep_ms() etc and then
+// yielded to the loop, and as only one coroutine runs at a time the loop
+// needs just one of them.
+typedef struct _uasyncio_req_t {
+    mp_obj_base_t base;
+    bool pending;               // filled in but not yet yielded by "await"
+    uint8_t kind;
+    mp_int_t ms;
+    mp_obj_t stream;
+} uasyncio_req_t;
+
+// A stream that coroutines wait on, with the events it is registered for
+typedef struct _uasyncio_io_t {
+    mp_obj_t stream;
+    mp_obj_t reader;
+    mp_obj_t writer;
+    mp_uint_t events;
+} uasyncio_io_t;
+
+typedef struct _uasyncio_loop_t {
+    mp_obj_base_t base;
+    bool running;
+    bool stopped;
+    uasyncio_req_t *req;
+    // runnable entries, each a coroutine and MP_OBJ_NULL or a callback and its args
+    size_t runq_alloc;
+    size_t runq_head;
+    size_t runq_len;
+    mp_obj_t *runq;
+    mp_obj_t waitq;
+    mp_obj_t poll;              // made when a stream is first waited on
+    size_t io_alloc;
+    size_t io_len;
+    uasyncio_io_t *io;
+    mp_obj_t main;              // the coroutine given to run_until_complete
+    mp_obj_t main_ret;
+} uasyncio_loop_t;
+
+STATIC const mp_obj_type_t uasyncio_req_type;
+STATIC const mp_obj_type_t uasyncio_loop_type;
+
+STATIC mp_uint_t ticks_ms(void) {
+    return mp_hal_ticks_ms() & TICKS_MAX;
+}
+
+STATIC mp_int_t ticks_diff(mp_uint_t end, mp_uint_t start) {
+    return ((end - start + TICKS_HALFPERIOD) & TICKS_MAX) - TICKS_HALFPERIOD;
+}
+
+STATIC mp_int_t get_ms(mp_obj_t secs_in) {
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (!mp_obj_is_int(secs_in)) {
+        return (mp_int_t)(mp_obj_get_float(secs_in) * 1000);
+    }
+    #endif
+    return mp_obj_get_int(secs_in) * 1000;
+}
+
+STATIC uasyncio_loop_t *loop_new(size_t runq_len, size_t waitq_len) {
+    uasyncio_loop_t *self = m_new_obj(uasyncio_loop_t);
+    self->base.type = &uasyncio_loop_type;
+    self->running = false;
+    self->stopped = false;
+    self->req = m_new_obj(uasyncio_req_t);
+    self->req->base.type = &uasyncio_req_type;
+    self->req->pending = false;
+    self->req->stream = MP_OBJ_NULL;
+    self->runq_alloc = runq_len;
+    self->runq_head = 0;
+    self->runq_len = 0;
+    self->runq = m_new0(mp_obj_t, 2 * runq_len);
+    self->waitq = mp_utimeq_new(waitq_len);
+    self->poll = MP_OBJ_NULL;
+    self->io_alloc = 0;
+    self->io_len = 0;
+    self->io = NULL;
+    self->main = MP_OBJ_NULL;
+    self->main_ret = mp_const_none;
+    return self;
+}
+
+STATIC uasyncio_loop_t *get_loop(void) {
+    if (MP_STATE_VM(uasyncio_loop) == MP_OBJ_NULL) {
+        MP_STATE_VM(uasyncio_loop) = MP_OBJ_FROM_PTR(loop_new(16, 16));
+    }
+    return MP_OBJ_TO_PTR(MP_STATE_VM(uasyncio_loop));
+}
+
+STATIC void runq_push(uasyncio_loop_t *self, mp_obj_t callback, mp_obj_t args) {
+    if (self->runq_len == self->runq_alloc) {
+        mp_raise_msg(&mp_type_IndexError, "queue overflow");
+    }
+    size_t i = (self->runq_head + self->runq_len++) % self->runq_alloc;
+    self->runq[2 * i] = callback;
+    self->runq[2 * i + 1] = args;
+}
+
+STATIC void runq_pop(uasyncio_loop_t *self, mp_obj_t *callback, mp_obj_t *args) {
+    size_t i = self->runq_head;
+    *callback = self->runq[2 * i];
+    *args = self->runq[2 * i + 1];
+    self->runq[2 * i] = MP_OBJ_NULL; // so we don't retain a pointer
+    self->runq[2 * i + 1] = MP_OBJ_NULL;
+    self->runq_head = (i + 1) % self->runq_alloc;
+    self->runq_len -= 1;
+}
+
+STATIC uasyncio_io_t *io_find(uasyncio_loop_t *self, mp_obj_t stream) {
+    for (size_t i = 0; i < self->io_len; ++i) {
+        if (self->io[i].stream == stream) {
+            return &self->io[i];
+        }
+    }
+    return NULL;
+}
+
+STATIC void io_wait(uasyncio_loop_t *self, mp_obj_t stream, mp_obj_t coro, bool write) {
+    uasyncio_io_t *io = io_find(self, stream);
+    if (io == NULL) {
+        if (self->io_len == self->io_alloc) {
+            self->io = m_renew(uasyncio_io_t, self->io, self->io_alloc, self->io_alloc + 4);
+            self->io_alloc += 4;
+        }
+        io = &self->io[self->io_len++];
+        io->stream = stream;
+        io->reader = MP_OBJ_NULL;
+        io->writer = MP_OBJ_NULL;
+        io->events = 0;
+    }
+    if (write) {
+        io->writer = coro;
+    } else {
+        io->reader = coro;
+    }
+}
+
+// Bring the registrations of the poll object up to date with the waiting
+// coroutines, dropping streams that nothing waits on any more
+STATIC void io_sync(uasyncio_loop_t *self) {
+    for (size_t i = 0; i < self->io_len;) {
+        uasyncio_io_t *io = &self->io[i];
+        mp_uint_t events = (io->reader != MP_OBJ_NULL ? MP_STREAM_POLL_RD : 0)
+            | (io->writer != MP_OBJ_NULL ? MP_STREAM_POLL_WR : 0);
+        if (events != io->events) {
+            if (self->poll == MP_OBJ_NULL) {
+                self->poll = mp_call_function_0(mp_load_attr(MP_OBJ_FROM_PTR(&mp_module_uselect), MP_QSTR_poll));
+            }
+            mp_obj_t dest[4];
+            if (events == 0) {
+                mp_load_method(self->poll, MP_QSTR_unregister, dest);
+                dest[2] = io->stream;
+                mp_call_method_n_kw(1, 0, dest);
+            } else {
+                mp_load_method(self->poll, MP_QSTR_register, dest);
+                dest[2] = io->stream;
+                dest[3] = MP_OBJ_NEW_SMALL_INT(events);
+                mp_call_method_n_kw(2, 0, dest);
+            }
+            io->events = events;
+        }
+        if (events == 0) {
+            *io = self->io[--self->io_len];
+            self->io[self->io_len].stream = MP_OBJ_NULL;
+        } else {
+            ++i;
+        }
+    }
+}
+
+// Wait up to timeout ms (-1 for no limit) for a stream to be ready, and make
+// the coroutines waiting on the ready streams runnable
+STATIC void io_poll(uasyncio_loop_t *self, mp_int_t timeout) {
+    if (self->io_len == 0) {
+        if (timeout > 0) {
+            mp_hal_delay_ms(timeout);
+        }
+        return;
+    }
+    mp_obj_t dest[3];
+    mp_load_method(self->poll, MP_QSTR_ipoll, dest);
+    dest[2] = MP_OBJ_NEW_SMALL_INT(timeout);
+    mp_obj_t iter = mp_getiter(mp_call_method_n_kw(1, 0, dest), NULL);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_obj_t *ev;
+        mp_obj_get_array_fixed_n(item, 2, &ev);
+        uasyncio_io_t *io = io_find(self, ev[0]);
+        if (io == NULL) {
+            continue;
+        }
+        // errors and hang up wake both the reader and the writer
+        mp_uint_t flags = mp_obj_get_int(ev[1]);
+        if (io->reader != MP_OBJ_NULL && (flags & ~MP_STREAM_POLL_WR)) {
+            runq_push(self, io->reader, MP_OBJ_NULL);
+            io->reader = MP_OBJ_NULL;
+        }
+        if (io->writer != MP_OBJ_NULL && (flags & ~MP_STREAM_POLL_RD)) {
+            runq_push(self, io->writer, MP_OBJ_NULL);
+            io->writer = MP_OBJ_NULL;
+        }
+    }
+}
+
+STATIC void loop_resume(uasyncio_loop_t *self, mp_obj_t coro) {
+    mp_obj_t ret;
+    mp_vm_return_kind_t ret_kind = mp_resume(coro, mp_const_none, MP_OBJ_NULL, &ret);
+    if (ret_kind == MP_VM_RETURN_YIELD) {
+        uasyncio_req_t *req = self->req;
+        if (ret != MP_OBJ_FROM_PTR(req)) {
+            // a bare yield, so run again after the others
+            runq_push(self, coro, MP_OBJ_NULL);
+            return;
+        }
+        // a plain "yield sleep_ms(t)" doesn't go through req_iternext
+        req->pending = false;
+        if (req->kind == REQ_SLEEP) {
+            mp_uint_t wake = (ticks_ms() + req->ms) & TICKS_MAX;
+            mp_utimeq_push(self->waitq, wake, coro, MP_OBJ_NULL);
+        } else {
+            io_wait(self, req->stream, coro, req->kind == REQ_WRITE);
+            req->stream = MP_OBJ_NULL;
+        }
+    } else if (ret_kind == MP_VM_RETURN_NORMAL) {
+        if (coro == self->main) {
+            self->main = MP_OBJ_NULL;
+            self->main_ret = ret == MP_OBJ_STOP_ITERATION ? mp_const_none : ret;
+            self->stopped = true;
+        }
+    } else {
+        nlr_raise(ret);
+    }
+}
+
+STATIC void loop_run(uasyncio_loop_t *self) {
+    self->stopped = false;
+    while (!self->stopped) {
+        // make the coroutines and callbacks that are due runnable
+        mp_uint_t now = ticks_ms();
+        while (mp_utimeq_len(self->waitq) > 0 && ticks_diff(mp_utimeq_peektime(self->waitq), now) <= 0) {
+            mp_obj_t callback, args;
+            mp_utimeq_pop(self->waitq, &callback, &args);
+            runq_push(self, callback, args);
+        }
+
+        // run those entries, leaving any they add for the next pass
+        for (size_t n = self->runq_len; n > 0 && !self->stopped; --n) {
+            mp_obj_t callback, args;
+            runq_pop(self, &callback, &args);
+            if (args == MP_OBJ_NULL) {
+                loop_resume(self, callback);
+            } else {
+                size_t n_args;
+                mp_obj_t *items;
+                mp_obj_tuple_get(args, &n_args, &items);
+                mp_call_function_n_kw(callback, n_args, 0, items);
+            }
+        }
+        if (self->stopped) {
+            break;
+        }
+
+        // wait for the next timer or stream, if there is nothing to run now
+        io_sync(self);
+        mp_int_t timeout;
+        if (self->runq_len > 0) {
+            timeout = 0;
+        } else if (mp_utimeq_len(self->waitq) > 0) {
+            timeout = MAX(0, ticks_diff(mp_utimeq_peektime(self->waitq), ticks_ms()));
+        } else if (self->io_len > 0) {
+            timeout = -1;
+        } else {
+            break;
+        }
+        io_poll(self, timeout);
+    }
+}
+
+STATIC void loop_run_checked(uasyncio_loop_t *self) {
+    if (self->running) {
+        mp_raise_msg(&mp_type_RuntimeError, "loop already running");
+    }
+    self->running = true;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        loop_run(self);
+        nlr_pop();
+        self->running = false;
+    } else {
+        self->running = false;
+        self->main = MP_OBJ_NULL;
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+STATIC mp_obj_t loop_create_task(mp_obj_t self_in, mp_obj_t coro) {
+    uasyncio_loop_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!mp_obj_is_type(coro, &mp_type_gen_instance)) {
+        mp_raise_TypeError("expected a coroutine");
+    }
+    runq_push(self, coro, MP_OBJ_NULL);
+    return coro;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(loop_create_task_obj, loop_create_task);
+
+STATIC mp_obj_t loop_call_soon(size_t n_args, const mp_obj_t *args) {
+    uasyncio_loop_t *self = MP_OBJ_TO_PTR(args[0]);
+    runq_push(self, args[1], mp_obj_new_tuple(n_args - 2, args + 2));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(loop_call_soon_obj, 2, loop_call_soon);
+
+STATIC void loop_call_at_ms(uasyncio_loop_t *self, mp_int_t delay, size_t n_args, const mp_obj_t *args) {
+    mp_uint_t wake = (ticks_ms() + delay) & TICKS_MAX;
+    mp_utimeq_push(self->waitq, wake, args[0], mp_obj_new_tuple(n_args - 1, args + 1));
+}
+
+STATIC mp_obj_t loop_call_later(size_t n_args, const mp_obj_t *args) {
+    loop_call_at_ms(MP_OBJ_TO_PTR(args[0]), get_ms(args[1]), n_args - 2, args + 2);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(loop_call_later_obj, 3, loop_call_later);
+
+STATIC mp_obj_t loop_call_later_ms(size_t n_args, const mp_obj_t *args) {
+    loop_call_at_ms(MP_OBJ_TO_PTR(args[0]), mp_obj_get_int(args[1]), n_args - 2, args + 2);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(loop_call_later_ms_obj, 3, loop_call_later_ms);
+
+STATIC mp_obj_t loop_run_forever(mp_obj_t self_in) {
+    loop_run_checked(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(loop_run_forever_obj, loop_run_forever);
+
+STATIC mp_obj_t loop_run_until_complete(mp_obj_t self_in, mp_obj_t coro) {
+    uasyncio_loop_t *self = MP_OBJ_TO_PTR(self_in);
+    loop_create_task(self_in, coro);
+    self->main = coro;
+    self->main_ret = mp_const_none;
+    loop_run_checked(self);
+    if (self->main != MP_OBJ_NULL) {
+        self->main = MP_OBJ_NULL;
+        mp_raise_msg(&mp_type_RuntimeError, "loop stopped before coroutine finished");
+    }
+    mp_obj_t ret = self->main_ret;
+    self->main_ret = mp_const_none;
+    return ret;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(loop_run_until_complete_obj, loop_run_until_complete);
+
+STATIC mp_obj_t loop_stop(mp_obj_t self_in) {
+    uasyncio_loop_t *self = MP_OBJ_TO_PTR(self_in);
+    self->stopped = true;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(loop_stop_obj, loop_stop);
+
+STATIC const mp_rom_map_elem_t loop_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_create_task), MP_ROM_PTR(&loop_create_task_obj) },
+    { MP_ROM_QSTR(MP_QSTR_call_soon), MP_ROM_PTR(&loop_call_soon_obj) },
+    { MP_ROM_QSTR(MP_QSTR_call_later), MP_ROM_PTR(&loop_call_later_obj) },
+    { MP_ROM_QSTR(MP_QSTR_call_later_ms), MP_ROM_PTR(&loop_call_later_ms_obj) },
+    { MP_ROM_QSTR(MP_QSTR_run_forever), MP_ROM_PTR(&loop_run_forever_obj) },
+    { MP_ROM_QSTR(MP_QSTR_run_until_complete), MP_ROM_PTR(&loop_run_until_complete_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&loop_stop_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(loop_locals_dict, loop_locals_dict_table);
+
+STATIC const mp_obj_type_t uasyncio_loop_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_EventLoop,
+    .locals_dict = (void*)&loop_locals_dict,
+};
+
+// "await req" yields the request to the loop once, and when the coroutine is
+// resumed the await is done
+STATIC mp_obj_t req_iternext(mp_obj_t self_in) {
+    uasyncio_req_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->pending) {
+        self->pending = false;
+        return self_in;
+    }
+    return MP_OBJ_STOP_ITERATION;
+}
+
+STATIC const mp_obj_type_t uasyncio_req_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Request,
+    .getiter = mp_identity_getiter,
+    .iternext = req_iternext,
+};
+
+STATIC mp_obj_t req_fill(uint8_t kind, mp_int_t ms, mp_obj_t stream) {
+    uasyncio_req_t *req = get_loop()->req;
+    req->pending = true;
+    req->kind = kind;
+    req->ms = MAX(0, ms);
+    req->stream = stream;
+    return MP_OBJ_FROM_PTR(req);
+}
+
+STATIC mp_obj_t mod_uasyncio_get_event_loop(size_t n_args, const mp_obj_t *args) {
+    if (MP_STATE_VM(uasyncio_loop) == MP_OBJ_NULL) {
+        size_t runq_len = n_args > 0 ? mp_obj_get_int(args[0]) : 16;
+        size_t waitq_len = n_args > 1 ? mp_obj_get_int(args[1]) : 16;
+        MP_STATE_VM(uasyncio_loop) = MP_OBJ_FROM_PTR(loop_new(runq_len, waitq_len));
+    }
+    return MP_STATE_VM(uasyncio_loop);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uasyncio_get_event_loop_obj, 0, 2, mod_uasyncio_get_event_loop);
+
+STATIC mp_obj_t mod_uasyncio_create_task(mp_obj_t coro) {
+    return loop_create_task(MP_OBJ_FROM_PTR(get_loop()), coro);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uasyncio_create_task_obj, mod_uasyncio_create_task);
+
+STATIC mp_obj_t mod_uasyncio_run(mp_obj_t coro) {
+    return loop_run_until_complete(MP_OBJ_FROM_PTR(get_loop()), coro);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uasyncio_run_obj, mod_uasyncio_run);
+
+STATIC mp_obj_t mod_uasyncio_sleep(mp_obj_t secs_in) {
+    return req_fill(REQ_SLEEP, get_ms(secs_in), MP_OBJ_NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uasyncio_sleep_obj, mod_uasyncio_sleep);
+
+STATIC mp_obj_t mod_uasyncio_sleep_ms(mp_obj_t ms_in) {
+    return req_fill(REQ_SLEEP, mp_obj_get_int(ms_in), MP_OBJ_NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uasyncio_sleep_ms_obj, mod_uasyncio_sleep_ms);
+
+STATIC mp_obj_t uasyncio_wait_io(mp_obj_t stream, uint8_t kind) {
+    uasyncio_io_t *io = io_find(get_loop(), stream);
+    if (io != NULL && (kind == REQ_WRITE ? io->writer : io->reader) != MP_OBJ_NULL) {
+        mp_raise_ValueError("stream already waited on");
+    }
+    return req_fill(kind, 0, stream);
+}
+
+STATIC mp_obj_t mod_uasyncio_wait_read(mp_obj_t stream) {
+    return uasyncio_wait_io(stream, REQ_READ);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uasyncio_wait_read_obj, mod_uasyncio_wait_read);
+
+STATIC mp_obj_t mod_uasyncio_wait_write(mp_obj_t stream) {
+    return uasyncio_wait_io(stream, REQ_WRITE);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uasyncio_wait_write_obj, mod_uasyncio_wait_write);
+
+STATIC const mp_rom_map_elem_t mp_module_uasyncio_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uasyncio) },
+    { MP_ROM_QSTR(MP_QSTR_get_event_loop), MP_ROM_PTR(&mod_uasyncio_get_event_loop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_create_task), MP_ROM_PTR(&mod_uasyncio_create_task_obj) },
+    { MP_ROM_QSTR(MP_QSTR_run), MP_ROM_PTR(&mod_uasyncio_run_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sleep), MP_ROM_PTR(&mod_uasyncio_sleep_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sleep_ms), MP_ROM_PTR(&mod_uasyncio_sleep_ms_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait_read), MP_ROM_PTR(&mod_uasyncio_wait_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait_write), MP_ROM_PTR(&mod_uasyncio_wait_write_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(mp_module_uasyncio_globals, mp_module_uasyncio_globals_table);
+
+const mp_obj_module_t mp_module_uasyncio = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&mp_module_uasyncio_globals,
+};
+
+#endif // MICROPY_PY_UASYNCIO
@@ -30,8 +30,27 @@
 
 #include "py/runtime.h"
 #include "py/binary.h"
+#include "py/mphal.h"
 #include "extmod/modubinascii.h"
 
+STATIC const char binascii_hex_digits[16] = "0123456789abcdef";
+
+// hexlify data into out, with sep between the bytes if it is not NULL;
+// out must have room for binascii_hexlify_size()
+STATIC size_t binascii_hexlify_size(size_t len, const char *sep) {
+    return len == 0 ? 0 : len * 2 + (sep != NULL ? len - 1 : 0);
+}
+
+STATIC void binascii_hexlify_buf(const byte *in, size_t len, const char *sep, byte *out) {
+    for (size_t i = 0; i < len; ++i) {
+        if (sep != NULL && i != 0) {
+            *out++ = *sep;
+        }
+        *out++ = binascii_hex_digits[in[i] >> 4];
+        *out++ = binascii_hex_digits[in[i] & 0xf];
+    }
+}
+
 mp_obj_t mod_binascii_hexlify(size_t n_args, const mp_obj_t *args) {
     // Second argument is for an extension to allow a separator to be used
     // between values.
@@ -39,36 +58,16 @@ mp_obj_t mod_binascii_hexlify(size_t n_args, const mp_obj_t *args) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
 
-    // Code below assumes non-zero buffer length when computing size with
-    // separator, so handle the zero-length case here.
     if (bufinfo.len == 0) {
         return mp_const_empty_bytes;
     }
-
-    vstr_t vstr;
-    size_t out_len = bufinfo.len * 2;
     if (n_args > 1) {
         // 1-char separator between hex numbers
-        out_len += bufinfo.len - 1;
         sep = mp_obj_str_get_str(args[1]);
     }
-    vstr_init_len(&vstr, out_len);
-    byte *in = bufinfo.buf, *out = (byte*)vstr.buf;
-    for (mp_uint_t i = bufinfo.len; i--;) {
-        byte d = (*in >> 4);
-        if (d > 9) {
-            d += 'a' - '9' - 1;
-        }
-        *out++ = d + '0';
-        d = (*in++ & 0xf);
-        if (d > 9) {
-            d += 'a' - '9' - 1;
-        }
-        *out++ = d + '0';
-        if (sep != NULL && i != 0) {
-            *out++ = *sep;
-        }
-    }
+    vstr_t vstr;
+    vstr_init_len(&vstr, binascii_hexlify_size(bufinfo.len, sep));
+    binascii_hexlify_buf(bufinfo.buf, bufinfo.len, sep, (byte*)vstr.buf);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_hexlify_obj, 1, 2, mod_binascii_hexlify);
@@ -102,39 +101,61 @@ mp_obj_t mod_binascii_unhexlify(mp_obj_t data) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_unhexlify_obj, mod_binascii_unhexlify);
 
+STATIC const char binascii_base64_digits[64] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Sextet value of the characters '+' to 'z', or 0xff if not in the alphabet
+#define BINASCII_SEXTET_FIRST ('+')
+STATIC const uint8_t binascii_sextet_table['z' - '+' + 1] = {
+    62, 0xff, 0xff, 0xff, 63,                                   // + , - . /
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61,                     // 0-9
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,                   // : ; < = > ? @
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,                   // A-M
+    13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25,         // N-Z
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff,                         // [ \ ] ^ _ `
+    26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38,         // a-m
+    39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51,         // n-z
+};
+
 // If ch is a character in the base64 alphabet, and is not a pad character, then
 // the corresponding integer between 0 and 63, inclusively, is returned.
 // Otherwise, -1 is returned.
-static int mod_binascii_sextet(byte ch) {
-    if (ch >= 'A' && ch <= 'Z') {
-        return ch - 'A';
-    } else if (ch >= 'a' && ch <= 'z') {
-        return ch - 'a' + 26;
-    } else if (ch >= '0' && ch <= '9') {
-        return ch - '0' + 52;
-    } else if (ch == '+') {
-        return 62;
-    } else if (ch == '/') {
-        return 63;
-    } else {
+static inline int mod_binascii_sextet(byte ch) {
+    if (ch < BINASCII_SEXTET_FIRST || ch > 'z') {
         return -1;
     }
+    uint8_t v = binascii_sextet_table[ch - BINASCII_SEXTET_FIRST];
+    return v == 0xff ? -1 : v;
 }
 
-mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
-    mp_buffer_info_t bufinfo;
-    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
-    byte *in = bufinfo.buf;
-
-    vstr_t vstr;
-    vstr_init(&vstr, (bufinfo.len / 4) * 3 + 1); // Potentially over-allocate
-    byte *out = (byte *)vstr.buf;
-
+// Decode base64 into out, which needs room for (len / 4) * 3 + 2 bytes.
+// Whole groups of four alphabet characters are decoded as one 24-bit word;
+// anything else (line breaks, padding) goes through the bit-at-a-time path.
+STATIC size_t binascii_a2b_base64_buf(const byte *in, size_t len, byte *out) {
+    byte *out_start = out;
     uint shift = 0;
     int nbits = 0; // Number of meaningful bits in shift
     bool hadpad = false; // Had a pad character since last valid character
-    for (size_t i = 0; i < bufinfo.len; i++) {
-        if (in[i] == '=') {
+    size_t i = 0;
+    while (i < len) {
+        if (nbits == 0 && i + 4 <= len) {
+            int a = mod_binascii_sextet(in[i]);
+            int b = mod_binascii_sextet(in[i + 1]);
+            int c = mod_binascii_sextet(in[i + 2]);
+            int d = mod_binascii_sextet(in[i + 3]);
+            if ((a | b | c | d) >= 0) {
+                uint32_t w = a << 18 | b << 12 | c << 6 | d;
+                *out++ = w >> 16;
+                *out++ = w >> 8;
+                *out++ = w;
+                i += 4;
+                hadpad = false;
+                continue;
+            }
+        }
+
+        byte ch = in[i++];
+        if (ch == '=') {
             if ((nbits == 2) || ((nbits == 4) && hadpad)) {
                 nbits = 0;
                 break;
@@ -142,7 +163,7 @@ mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
             hadpad = true;
         }
 
-        int sextet = mod_binascii_sextet(in[i]);
+        int sextet = mod_binascii_sextet(ch);
         if (sextet == -1) {
             continue;
         }
@@ -152,71 +173,106 @@ mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
 
         if (nbits >= 8) {
             nbits -= 8;
-            out[vstr.len++] = (shift >> nbits) & 0xFF;
+            *out++ = (shift >> nbits) & 0xFF;
         }
     }
 
     if (nbits) {
         mp_raise_ValueError("incorrect padding");
     }
-
-    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    return out - out_start;
 }
-MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_a2b_base64_obj, mod_binascii_a2b_base64);
 
-mp_obj_t mod_binascii_b2a_base64(mp_obj_t data) {
+mp_obj_t mod_binascii_a2b_base64(mp_obj_t data) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
 
     vstr_t vstr;
-    vstr_init_len(&vstr, ((bufinfo.len != 0) ? (((bufinfo.len - 1) / 3) + 1) * 4 : 0) + 1);
+    vstr_init(&vstr, (bufinfo.len / 4) * 3 + 2); // Potentially over-allocate
+    vstr.len = binascii_a2b_base64_buf(bufinfo.buf, bufinfo.len, (byte*)vstr.buf);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_a2b_base64_obj, mod_binascii_a2b_base64);
 
-    // First pass, we convert input buffer to numeric base 64 values
-    byte *in = bufinfo.buf, *out = (byte*)vstr.buf;
-    mp_uint_t i;
-    for (i = bufinfo.len; i >= 3; i -= 3) {
-        *out++ = (in[0] & 0xFC) >> 2;
-        *out++ = (in[0] & 0x03) << 4 | (in[1] & 0xF0) >> 4;
-        *out++ = (in[1] & 0x0F) << 2 | (in[2] & 0xC0) >> 6;
-        *out++ = in[2] & 0x3F;
+// Length of the base64 encoding of len bytes, including the newline
+STATIC size_t binascii_b2a_base64_size(size_t len) {
+    return (len + 2) / 3 * 4 + 1;
+}
+
+STATIC void binascii_b2a_base64_buf(const byte *in, size_t len, byte *out) {
+    size_t i;
+    for (i = len; i >= 3; i -= 3) {
+        uint32_t w = in[0] << 16 | in[1] << 8 | in[2];
+        *out++ = binascii_base64_digits[w >> 18];
+        *out++ = binascii_base64_digits[(w >> 12) & 0x3f];
+        *out++ = binascii_base64_digits[(w >> 6) & 0x3f];
+        *out++ = binascii_base64_digits[w & 0x3f];
         in += 3;
     }
     if (i != 0) {
-        *out++ = (in[0] & 0xFC) >> 2;
-        if (i == 2) {
-            *out++ = (in[0] & 0x03) << 4 | (in[1] & 0xF0) >> 4;
-            *out++ = (in[1] & 0x0F) << 2;
-        }
-        else {
-            *out++ = (in[0] & 0x03) << 4;
-            *out++ = 64;
-        }
-        *out = 64;
-    }
-
-    // Second pass, we convert number base 64 values to actual base64 ascii encoding
-    out = (byte*)vstr.buf;
-    for (mp_uint_t j = vstr.len - 1; j--;) {
-        if (*out < 26) {
-            *out += 'A';
-        } else if (*out < 52) {
-            *out += 'a' - 26;
-        } else if (*out < 62) {
-            *out += '0' - 52;
-        } else if (*out == 62) {
-            *out ='+';
-        } else if (*out == 63) {
-            *out = '/';
-        } else {
-            *out = '=';
-        }
-        out++;
+        uint32_t w = in[0] << 16 | (i == 2 ? in[1] << 8 : 0);
+        *out++ = binascii_base64_digits[w >> 18];
+        *out++ = binascii_base64_digits[(w >> 12) & 0x3f];
+        *out++ = i == 2 ? binascii_base64_digits[(w >> 6) & 0x3f] : '=';
+        *out++ = '=';
     }
     *out = '\n';
+}
+
+mp_obj_t mod_binascii_b2a_base64(mp_obj_t data) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+
+    vstr_t vstr;
+    vstr_init_len(&vstr, binascii_b2a_base64_size(bufinfo.len));
+    binascii_b2a_base64_buf(bufinfo.buf, bufinfo.len, (byte*)vstr.buf);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mod_binascii_b2a_base64_obj, mod_binascii_b2a_base64);
 
+#if MICROPY_PY_UBINASCII_INTO
+
+// The *_into(data, buf) variants write the result to the start of buf and
+// return the number of bytes written, so no new bytes object is needed.
+
+STATIC void *binascii_get_out_buf(mp_obj_t buf_in, size_t needed) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < needed) {
+        mp_raise_ValueError("buffer too small");
+    }
+    return bufinfo.buf;
+}
+
+STATIC mp_obj_t mod_binascii_hexlify_into(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    const char *sep = n_args > 2 ? mp_obj_str_get_str(args[2]) : NULL;
+    size_t n = binascii_hexlify_size(bufinfo.len, sep);
+    binascii_hexlify_buf(bufinfo.buf, bufinfo.len, sep, binascii_get_out_buf(args[1], n));
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_hexlify_into_obj, 2, 3, mod_binascii_hexlify_into);
+
+STATIC mp_obj_t mod_binascii_a2b_base64_into(mp_obj_t data, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    byte *out = binascii_get_out_buf(buf_in, (bufinfo.len / 4) * 3 + 2);
+    return MP_OBJ_NEW_SMALL_INT(binascii_a2b_base64_buf(bufinfo.buf, bufinfo.len, out));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_a2b_base64_into_obj, mod_binascii_a2b_base64_into);
+
+STATIC mp_obj_t mod_binascii_b2a_base64_into(mp_obj_t data, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    size_t n = binascii_b2a_base64_size(bufinfo.len);
+    binascii_b2a_base64_buf(bufinfo.buf, bufinfo.len, binascii_get_out_buf(buf_in, n));
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_binascii_b2a_base64_into_obj, mod_binascii_b2a_base64_into);
+
+#endif // MICROPY_PY_UBINASCII_INTO
+
 #if MICROPY_PY_UBINASCII_CRC32
 #include "uzlib/tinf.h"
 
@@ -224,8 +280,13 @@ mp_obj_t mod_binascii_crc32(size_t n_args, const mp_obj_t *args) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
     uint32_t crc = (n_args > 1) ? mp_obj_get_int_truncated(args[1]) : 0;
-    crc = uzlib_crc32(bufinfo.buf, bufinfo.len, crc ^ 0xffffffff);
-    return mp_obj_new_int_from_uint(crc ^ 0xffffffff);
+    #ifdef mp_hal_crc32
+    // the port has a faster implementation, e.g. in ROM
+    crc = mp_hal_crc32(crc, bufinfo.buf, bufinfo.len);
+    #else
+    crc = uzlib_crc32(bufinfo.buf, bufinfo.len, crc ^ 0xffffffff) ^ 0xffffffff;
+    #endif
+    return mp_obj_new_int_from_uint(crc);
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_binascii_crc32_obj, 1, 2, mod_binascii_crc32);
 #endif
@@ -238,6 +299,11 @@ STATIC const mp_rom_map_elem_t mp_module_binascii_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_unhexlify), MP_ROM_PTR(&mod_binascii_unhexlify_obj) },
     { MP_ROM_QSTR(MP_QSTR_a2b_base64), MP_ROM_PTR(&mod_binascii_a2b_base64_obj) },
     { MP_ROM_QSTR(MP_QSTR_b2a_base64), MP_ROM_PTR(&mod_binascii_b2a_base64_obj) },
+    #if MICROPY_PY_UBINASCII_INTO
+    { MP_ROM_QSTR(MP_QSTR_hexlify_into), MP_ROM_PTR(&mod_binascii_hexlify_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_a2b_base64_into), MP_ROM_PTR(&mod_binascii_a2b_base64_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_b2a_base64_into), MP_ROM_PTR(&mod_binascii_b2a_base64_into_obj) },
+    #endif
     #if MICROPY_PY_UBINASCII_CRC32
     { MP_ROM_QSTR(MP_QSTR_crc32), MP_ROM_PTR(&mod_binascii_crc32_obj) },
     #endif
@@ -39,12 +39,12 @@
 // of PEP 272 can be made with a simple wrapper which adds all the
 // needed boilerplate.
 
-// values follow PEP 272
+// values follow PEP 272; it has no GCM so that takes the PyCryptodome value
 enum {
-    UCRYPTOLIB_MODE_MIN = 0,
-    UCRYPTOLIB_MODE_ECB,
-    UCRYPTOLIB_MODE_CBC,
-    UCRYPTOLIB_MODE_MAX,
+    UCRYPTOLIB_MODE_ECB = 1,
+    UCRYPTOLIB_MODE_CBC = 2,
+    UCRYPTOLIB_MODE_CTR = 6,
+    UCRYPTOLIB_MODE_GCM = 11,
 };
 
 #if MICROPY_SSL_AXTLS
@@ -72,6 +72,33 @@ struct mbedtls_aes_ctx_with_key {
 #define AES_CTX_IMPL struct mbedtls_aes_ctx_with_key
 #endif
 
+#if MICROPY_PY_UCRYPTOLIB_CTR || MICROPY_PY_UCRYPTOLIB_GCM
+// keystream state of the counter modes, laid out as mbedtls_aes_crypt_ctr wants
+typedef struct _aes_ctr_t {
+    uint8_t counter[16];
+    // the encrypted counter, of which stream[offset:] is still to be used
+    uint8_t stream[16];
+    size_t offset;
+} aes_ctr_t;
+#endif
+
+#if MICROPY_PY_UCRYPTOLIB_GCM
+typedef struct _aes_gcm_t {
+    aes_ctr_t ctr;
+    // H times each 4-bit value, so GHASH can multiply by H a nibble at a time
+    uint64_t hh[16];
+    uint64_t hl[16];
+    // the encrypted pre-counter block, which masks the tag
+    uint8_t ek_j0[16];
+    // GHASH accumulator, and the number of bytes of its current block taken
+    uint8_t y[16];
+    uint8_t y_len;
+    bool data_started;
+    uint64_t aad_len;
+    uint64_t data_len;
+} aes_gcm_t;
+#endif
+
 typedef struct _mp_obj_aes_t {
     mp_obj_base_t base;
     AES_CTX_IMPL ctx;
@@ -80,6 +107,15 @@ typedef struct _mp_obj_aes_t {
 #define AES_KEYTYPE_ENC  1
 #define AES_KEYTYPE_DEC  2
     uint8_t key_type: 2;
+    #if MICROPY_PY_UCRYPTOLIB_CTR || MICROPY_PY_UCRYPTOLIB_GCM
+    // only allocated for the counter modes
+    union {
+        aes_ctr_t ctr;
+        #if MICROPY_PY_UCRYPTOLIB_GCM
+        aes_gcm_t gcm;
+        #endif
+    } state[];
+    #endif
 } mp_obj_aes_t;
 
 #if MICROPY_SSL_AXTLS
@@ -155,20 +191,187 @@ STATIC void aes_process_ecb_impl(AES_CTX_IMPL *ctx, const uint8_t in[16], uint8_
 STATIC void aes_process_cbc_impl(AES_CTX_IMPL *ctx, const uint8_t *in, uint8_t *out, size_t in_len, bool encrypt) {
     mbedtls_aes_crypt_cbc(&ctx->u.mbedtls_ctx, encrypt ? MBEDTLS_AES_ENCRYPT : MBEDTLS_AES_DECRYPT, in_len, ctx->iv, in, out);
 }
+
+#if MICROPY_PY_UCRYPTOLIB_CTR && defined(MBEDTLS_CIPHER_MODE_CTR)
+// a single call lets hardware AES (eg on esp32) do the whole buffer at once
+#define aes_process_ctr_impl(ctx, ctr, in, out, in_len) \
+    mbedtls_aes_crypt_ctr(&(ctx)->u.mbedtls_ctx, (in_len), &(ctr)->offset, (ctr)->counter, (ctr)->stream, (in), (out))
+#endif
+#endif
+
+#if MICROPY_PY_UCRYPTOLIB_GCM || (MICROPY_PY_UCRYPTOLIB_CTR && !defined(aes_process_ctr_impl))
+// XOR the keystream into in_len bytes, incrementing the last inc_len bytes of
+// the counter as a big-endian number for each block (16 for CTR, 4 for GCM)
+STATIC void aes_process_ctr_generic(AES_CTX_IMPL *ctx, aes_ctr_t *ctr, const uint8_t *in, uint8_t *out, size_t in_len, size_t inc_len) {
+    size_t n = ctr->offset;
+    for (size_t i = 0; i < in_len; i++) {
+        if (n == 0) {
+            aes_process_ecb_impl(ctx, ctr->counter, ctr->stream, true);
+            for (int j = 15; j >= 16 - (int)inc_len; j--) {
+                if (++ctr->counter[j] != 0) {
+                    break;
+                }
+            }
+        }
+        out[i] = in[i] ^ ctr->stream[n];
+        n = (n + 1) & 15;
+    }
+    ctr->offset = n;
+}
+#endif
+
+#if MICROPY_PY_UCRYPTOLIB_CTR && !defined(aes_process_ctr_impl)
+#define aes_process_ctr_impl(ctx, ctr, in, out, in_len) aes_process_ctr_generic((ctx), (ctr), (in), (out), (in_len), 16)
+#endif
+
+#if MICROPY_PY_UCRYPTOLIB_GCM
+STATIC uint64_t aes_gcm_get_be64(const uint8_t *buf) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) {
+        v = v << 8 | buf[i];
+    }
+    return v;
+}
+
+STATIC void aes_gcm_put_be64(uint8_t *buf, uint64_t v) {
+    for (int i = 7; i >= 0; i--) {
+        buf[i] = v;
+        v >>= 8;
+    }
+}
+
+// x = x * H in GF(2^128), using the 4-bit tables (Shoup's method)
+STATIC void aes_gcm_mult(const aes_gcm_t *gcm, uint8_t x[16]) {
+    // reduction of the 4 bits shifted out when multiplying by x^4
+    static const uint16_t last4[16] = {
+        0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+        0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0,
+    };
+    uint64_t zh = 0, zl = 0;
+    // Horner's rule, from the highest degree nibble (low half of the last byte)
+    for (int i = 31; i >= 0; i--) {
+        unsigned int n = (i & 1) ? x[i >> 1] & 0xf : x[i >> 1] >> 4;
+        unsigned int rem = zl & 0xf;
+        zl = zh << 60 | zl >> 4;
+        zh = zh >> 4 ^ (uint64_t)last4[rem] << 48;
+        zh ^= gcm->hh[n];
+        zl ^= gcm->hl[n];
+    }
+    aes_gcm_put_be64(x, zh);
+    aes_gcm_put_be64(x + 8, zl);
+}
+
+// feed bytes to GHASH accumulator y, of which *y_len bytes are taken
+STATIC void aes_gcm_ghash(const aes_gcm_t *gcm, uint8_t y[16], uint8_t *y_len, const uint8_t *buf, size_t len) {
+    uint8_t n = *y_len;
+    for (size_t i = 0; i < len; i++) {
+        y[n++] ^= buf[i];
+        if (n == 16) {
+            aes_gcm_mult(gcm, y);
+            n = 0;
+        }
+    }
+    *y_len = n;
+}
+
+// pad the current GHASH block with zeros, then feed the two 64-bit bit lengths
+STATIC void aes_gcm_ghash_lengths(const aes_gcm_t *gcm, uint8_t y[16], uint8_t y_len, uint64_t len_a, uint64_t len_b) {
+    if (y_len != 0) {
+        aes_gcm_mult(gcm, y);
+    }
+    uint8_t lens[16];
+    aes_gcm_put_be64(lens, len_a * 8);
+    aes_gcm_put_be64(lens + 8, len_b * 8);
+    y_len = 0;
+    aes_gcm_ghash(gcm, y, &y_len, lens, 16);
+}
+
+STATIC void aes_gcm_init(AES_CTX_IMPL *ctx, aes_gcm_t *gcm, const uint8_t *iv, size_t iv_len) {
+    memset(gcm, 0, sizeof(*gcm));
+
+    // hash key H = E(0), and its tables with hh[8], hl[8] = H
+    uint8_t h[16] = {0};
+    aes_process_ecb_impl(ctx, h, h, true);
+    uint64_t vh = aes_gcm_get_be64(h);
+    uint64_t vl = aes_gcm_get_be64(h + 8);
+    gcm->hh[8] = vh;
+    gcm->hl[8] = vl;
+    for (int i = 4; i > 0; i >>= 1) {
+        uint64_t t = (vl & 1) ? 0xe100000000000000ULL : 0;
+        vl = vh << 63 | vl >> 1;
+        vh = vh >> 1 ^ t;
+        gcm->hh[i] = vh;
+        gcm->hl[i] = vl;
+    }
+    for (int i = 2; i <= 8; i <<= 1) {
+        for (int j = 1; j < i; j++) {
+            gcm->hh[i + j] = gcm->hh[i] ^ gcm->hh[j];
+            gcm->hl[i + j] = gcm->hl[i] ^ gcm->hl[j];
+        }
+    }
+
+    // pre-counter block J0 is the IV itself if 96 bits long, otherwise GHASH(IV)
+    uint8_t *j0 = gcm->ctr.counter;
+    if (iv_len == 12) {
+        memcpy(j0, iv, 12);
+        j0[15] = 1;
+    } else {
+        uint8_t j0_len = 0;
+        aes_gcm_ghash(gcm, j0, &j0_len, iv, iv_len);
+        aes_gcm_ghash_lengths(gcm, j0, j0_len, 0, iv_len);
+    }
+    aes_process_ctr_generic(ctx, &gcm->ctr, gcm->ek_j0, gcm->ek_j0, 16, 4);
+}
+
+STATIC void aes_process_gcm(AES_CTX_IMPL *ctx, aes_gcm_t *gcm, const uint8_t *in, uint8_t *out, size_t in_len, bool encrypt) {
+    if (!gcm->data_started) {
+        // the additional data is padded to a whole block
+        if (gcm->y_len != 0) {
+            aes_gcm_mult(gcm, gcm->y);
+            gcm->y_len = 0;
+        }
+        gcm->data_started = true;
+    }
+    // GHASH covers the ciphertext: hash the input before it may be overwritten
+    if (!encrypt) {
+        aes_gcm_ghash(gcm, gcm->y, &gcm->y_len, in, in_len);
+    }
+    aes_process_ctr_generic(ctx, &gcm->ctr, in, out, in_len, 4);
+    if (encrypt) {
+        aes_gcm_ghash(gcm, gcm->y, &gcm->y_len, out, in_len);
+    }
+    gcm->data_len += in_len;
+}
 #endif
 
 STATIC mp_obj_t ucryptolib_aes_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 2, 3, false);
-    mp_obj_aes_t *o = m_new_obj(mp_obj_aes_t);
-    o->base.type = type;
 
-    o->block_mode = mp_obj_get_int(args[1]);
-    o->key_type = AES_KEYTYPE_NONE;
-
-    if (o->block_mode <= UCRYPTOLIB_MODE_MIN || o->block_mode >= UCRYPTOLIB_MODE_MAX) {
-        mp_raise_ValueError("mode");
+    mp_int_t block_mode = mp_obj_get_int(args[1]);
+    size_t state_size = 0;
+    switch (block_mode) {
+        case UCRYPTOLIB_MODE_ECB:
+        case UCRYPTOLIB_MODE_CBC:
+            break;
+        #if MICROPY_PY_UCRYPTOLIB_CTR
+        case UCRYPTOLIB_MODE_CTR:
+            state_size = sizeof(aes_ctr_t);
+            break;
+        #endif
+        #if MICROPY_PY_UCRYPTOLIB_GCM
+        case UCRYPTOLIB_MODE_GCM:
+            state_size = sizeof(aes_gcm_t);
+            break;
+        #endif
+        default:
+            mp_raise_ValueError("mode");
     }
 
+    mp_obj_aes_t *o = m_new_obj_var(mp_obj_aes_t, uint8_t, state_size);
+    o->base.type = type;
+    o->block_mode = block_mode;
+    o->key_type = AES_KEYTYPE_NONE;
+
     mp_buffer_info_t keyinfo;
     mp_get_buffer_raise(args[0], &keyinfo, MP_BUFFER_READ);
     if (32 != keyinfo.len && 16 != keyinfo.len) {
@@ -180,14 +383,34 @@ STATIC mp_obj_t ucryptolib_aes_make_new(const mp_obj_type_t *type, size_t n_args
     if (n_args > 2 && args[2] != mp_const_none) {
         mp_get_buffer_raise(args[2], &ivinfo, MP_BUFFER_READ);
 
-        if (16 != ivinfo.len) {
+        // a GCM nonce can be any length, though 12 bytes is recommended
+        if (block_mode == UCRYPTOLIB_MODE_GCM ? 0 == ivinfo.len : 16 != ivinfo.len) {
             mp_raise_ValueError("IV");
         }
-    } else if (o->block_mode == UCRYPTOLIB_MODE_CBC) {
+    } else if (block_mode != UCRYPTOLIB_MODE_ECB) {
         mp_raise_ValueError("IV");
     }
 
-    aes_initial_set_key_impl(&o->ctx, keyinfo.buf, keyinfo.len, ivinfo.buf);
+    if (state_size == 0) {
+        aes_initial_set_key_impl(&o->ctx, keyinfo.buf, keyinfo.len, ivinfo.buf);
+        return MP_OBJ_FROM_PTR(o);
+    }
+
+    #if MICROPY_PY_UCRYPTOLIB_CTR || MICROPY_PY_UCRYPTOLIB_GCM
+    // the counter modes only ever run the cipher forwards, for both encrypt
+    // and decrypt, so the key schedule can be done now
+    aes_initial_set_key_impl(&o->ctx, keyinfo.buf, keyinfo.len, NULL);
+    aes_final_set_key_impl(&o->ctx, true);
+    o->key_type = AES_KEYTYPE_ENC;
+    #if MICROPY_PY_UCRYPTOLIB_GCM
+    if (block_mode == UCRYPTOLIB_MODE_GCM) {
+        aes_gcm_init(&o->ctx, &o->state->gcm, ivinfo.buf, ivinfo.len);
+        return MP_OBJ_FROM_PTR(o);
+    }
+    #endif
+    memcpy(o->state->ctr.counter, ivinfo.buf, 16);
+    o->state->ctr.offset = 0;
+    #endif
 
     return MP_OBJ_FROM_PTR(o);
 }
@@ -204,7 +427,8 @@ STATIC mp_obj_t aes_process(size_t n_args, const mp_obj_t *args, bool encrypt) {
     mp_buffer_info_t in_bufinfo;
     mp_get_buffer_raise(in_buf, &in_bufinfo, MP_BUFFER_READ);
 
-    if (in_bufinfo.len % 16 != 0) {
+    bool is_block_mode = self->block_mode == UCRYPTOLIB_MODE_ECB || self->block_mode == UCRYPTOLIB_MODE_CBC;
+    if (is_block_mode && in_bufinfo.len % 16 != 0) {
         mp_raise_ValueError("blksize % 16");
     }
 
@@ -226,7 +450,7 @@ STATIC mp_obj_t aes_process(size_t n_args, const mp_obj_t *args, bool encrypt) {
     if (AES_KEYTYPE_NONE == self->key_type) {
         aes_final_set_key_impl(&self->ctx, encrypt);
         self->key_type = encrypt ? AES_KEYTYPE_ENC : AES_KEYTYPE_DEC;
-    } else {
+    } else if (is_block_mode) {
         if ((encrypt && self->key_type == AES_KEYTYPE_DEC) ||
             (!encrypt && self->key_type == AES_KEYTYPE_ENC)) {
 
@@ -234,14 +458,28 @@ STATIC mp_obj_t aes_process(size_t n_args, const mp_obj_t *args, bool encrypt) {
         }
     }
 
-    if (self->block_mode == UCRYPTOLIB_MODE_ECB) {
-        uint8_t *in = in_bufinfo.buf, *out = out_buf_ptr;
-        uint8_t *top = in + in_bufinfo.len;
-        for (; in < top; in += 16, out += 16) {
-            aes_process_ecb_impl(&self->ctx, in, out, encrypt);
+    switch (self->block_mode) {
+        case UCRYPTOLIB_MODE_ECB: {
+            uint8_t *in = in_bufinfo.buf, *out = out_buf_ptr;
+            uint8_t *top = in + in_bufinfo.len;
+            for (; in < top; in += 16, out += 16) {
+                aes_process_ecb_impl(&self->ctx, in, out, encrypt);
+            }
+            break;
         }
-    } else {
-        aes_process_cbc_impl(&self->ctx, in_bufinfo.buf, out_buf_ptr, in_bufinfo.len, encrypt);
+        case UCRYPTOLIB_MODE_CBC:
+            aes_process_cbc_impl(&self->ctx, in_bufinfo.buf, out_buf_ptr, in_bufinfo.len, encrypt);
+            break;
+        #if MICROPY_PY_UCRYPTOLIB_CTR
+        case UCRYPTOLIB_MODE_CTR:
+            aes_process_ctr_impl(&self->ctx, &self->state->ctr, in_bufinfo.buf, out_buf_ptr, in_bufinfo.len);
+            break;
+        #endif
+        #if MICROPY_PY_UCRYPTOLIB_GCM
+        case UCRYPTOLIB_MODE_GCM:
+            aes_process_gcm(&self->ctx, &self->state->gcm, in_bufinfo.buf, out_buf_ptr, in_bufinfo.len, encrypt);
+            break;
+        #endif
     }
 
     if (out_buf != MP_OBJ_NULL) {
@@ -260,9 +498,88 @@ STATIC mp_obj_t ucryptolib_aes_decrypt(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ucryptolib_aes_decrypt_obj, 2, 3, ucryptolib_aes_decrypt);
 
+STATIC mp_obj_t ucryptolib_aes_encrypt_into(mp_obj_t self_in, mp_obj_t in_buf, mp_obj_t out_buf) {
+    mp_obj_t args[3] = {self_in, in_buf, out_buf};
+    aes_process(3, args, true);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(ucryptolib_aes_encrypt_into_obj, ucryptolib_aes_encrypt_into);
+
+STATIC mp_obj_t ucryptolib_aes_decrypt_into(mp_obj_t self_in, mp_obj_t in_buf, mp_obj_t out_buf) {
+    mp_obj_t args[3] = {self_in, in_buf, out_buf};
+    aes_process(3, args, false);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(ucryptolib_aes_decrypt_into_obj, ucryptolib_aes_decrypt_into);
+
+#if MICROPY_PY_UCRYPTOLIB_GCM
+STATIC aes_gcm_t *aes_get_gcm(mp_obj_t self_in) {
+    mp_obj_aes_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->block_mode != UCRYPTOLIB_MODE_GCM) {
+        mp_raise_ValueError("mode");
+    }
+    return &self->state->gcm;
+}
+
+// compute the tag over what has been processed so far, leaving the state as is
+STATIC void aes_gcm_tag(mp_obj_t self_in, uint8_t tag[16]) {
+    aes_gcm_t *gcm = aes_get_gcm(self_in);
+    memcpy(tag, gcm->y, 16);
+    aes_gcm_ghash_lengths(gcm, tag, gcm->y_len, gcm->aad_len, gcm->data_len);
+    for (int i = 0; i < 16; i++) {
+        tag[i] ^= gcm->ek_j0[i];
+    }
+}
+
+STATIC mp_obj_t ucryptolib_aes_update(mp_obj_t self_in, mp_obj_t aad_in) {
+    aes_gcm_t *gcm = aes_get_gcm(self_in);
+    if (gcm->data_started) {
+        mp_raise_ValueError("update after encrypt/decrypt");
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(aad_in, &bufinfo, MP_BUFFER_READ);
+    aes_gcm_ghash(gcm, gcm->y, &gcm->y_len, bufinfo.buf, bufinfo.len);
+    gcm->aad_len += bufinfo.len;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ucryptolib_aes_update_obj, ucryptolib_aes_update);
+
+STATIC mp_obj_t ucryptolib_aes_digest(mp_obj_t self_in) {
+    vstr_t vstr;
+    vstr_init_len(&vstr, 16);
+    aes_gcm_tag(self_in, (uint8_t*)vstr.buf);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ucryptolib_aes_digest_obj, ucryptolib_aes_digest);
+
+STATIC mp_obj_t ucryptolib_aes_verify(mp_obj_t self_in, mp_obj_t tag_in) {
+    uint8_t tag[16];
+    aes_gcm_tag(self_in, tag);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(tag_in, &bufinfo, MP_BUFFER_READ);
+    // compare in constant time, so the tag can't be found a byte at a time
+    uint8_t diff = bufinfo.len != 16;
+    for (size_t i = 0; i < 16 && i < bufinfo.len; i++) {
+        diff |= tag[i] ^ ((uint8_t*)bufinfo.buf)[i];
+    }
+    if (diff) {
+        mp_raise_ValueError("MAC check failed");
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(ucryptolib_aes_verify_obj, ucryptolib_aes_verify);
+#endif
+
 STATIC const mp_rom_map_elem_t ucryptolib_aes_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_encrypt), MP_ROM_PTR(&ucryptolib_aes_encrypt_obj) },
     { MP_ROM_QSTR(MP_QSTR_decrypt), MP_ROM_PTR(&ucryptolib_aes_decrypt_obj) },
+    { MP_ROM_QSTR(MP_QSTR_encrypt_into), MP_ROM_PTR(&ucryptolib_aes_encrypt_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_decrypt_into), MP_ROM_PTR(&ucryptolib_aes_decrypt_into_obj) },
+    #if MICROPY_PY_UCRYPTOLIB_GCM
+    { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&ucryptolib_aes_update_obj) },
+    { MP_ROM_QSTR(MP_QSTR_digest), MP_ROM_PTR(&ucryptolib_aes_digest_obj) },
+    { MP_ROM_QSTR(MP_QSTR_verify), MP_ROM_PTR(&ucryptolib_aes_verify_obj) },
+    #endif
 };
 STATIC MP_DEFINE_CONST_DICT(ucryptolib_aes_locals_dict, ucryptolib_aes_locals_dict_table);
 
@@ -279,6 +596,12 @@ STATIC const mp_rom_map_elem_t mp_module_ucryptolib_globals_table[] = {
 #if MICROPY_PY_UCRYPTOLIB_CONSTS
     { MP_ROM_QSTR(MP_QSTR_MODE_ECB), MP_ROM_INT(UCRYPTOLIB_MODE_ECB) },
     { MP_ROM_QSTR(MP_QSTR_MODE_CBC), MP_ROM_INT(UCRYPTOLIB_MODE_CBC) },
+    #if MICROPY_PY_UCRYPTOLIB_CTR
+    { MP_ROM_QSTR(MP_QSTR_MODE_CTR), MP_ROM_INT(UCRYPTOLIB_MODE_CTR) },
+    #endif
+    #if MICROPY_PY_UCRYPTOLIB_GCM
+    { MP_ROM_QSTR(MP_QSTR_MODE_GCM), MP_ROM_INT(UCRYPTOLIB_MODE_GCM) },
+    #endif
 #endif
 };
 
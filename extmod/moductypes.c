@@ -109,11 +109,31 @@ enum {
 // "struct" in uctypes context means "structural", i.e. aggregate, type.
 STATIC const mp_obj_type_t uctypes_struct_type;
 
+// A dict descriptor compiled into a table of its fields, in the order that
+// iterating the dict gives, with each field's offset and type decoded
+typedef struct _uctypes_field_t {
+    qstr name;
+    bool is_agg;
+    uint8_t val_type;   // for scalars and bitfields
+    uint8_t bit_offset;
+    uint8_t bit_len;
+    mp_uint_t offset;
+    mp_obj_t sub;       // the tuple for aggregates
+} uctypes_field_t;
+
+typedef struct _uctypes_layout_t {
+    mp_obj_t desc;
+    size_t used;        // of the dict when compiled, to notice added fields
+    size_t n_fields;
+    uctypes_field_t fields[];
+} uctypes_layout_t;
+
 typedef struct _mp_obj_uctypes_struct_t {
     mp_obj_base_t base;
     mp_obj_t desc;
     byte *addr;
     uint32_t flags;
+    uctypes_layout_t *layout; // compiled on first field access
 } mp_obj_uctypes_struct_t;
 
 STATIC NORETURN void syntax_error(void) {
@@ -127,6 +147,7 @@ STATIC mp_obj_t uctypes_struct_make_new(const mp_obj_type_t *type, size_t n_args
     o->addr = (void*)(uintptr_t)mp_obj_int_get_truncated(args[0]);
     o->desc = args[1];
     o->flags = LAYOUT_NATIVE;
+    o->layout = NULL;
     if (n_args == 3) {
         o->flags = mp_obj_get_int(args[2]);
     }
@@ -403,26 +424,104 @@ STATIC void set_aligned(uint val_type, void *p, mp_int_t index, mp_obj_t val) {
     }
 }
 
-STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
-    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
+STATIC bool uctypes_desc_is_dict(mp_obj_t desc) {
+    return mp_obj_is_type(desc, &mp_type_dict)
+        #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
+        || mp_obj_is_type(desc, &mp_type_ordereddict)
+        #endif
+        ;
+}
 
-    if (!mp_obj_is_type(self->desc, &mp_type_dict)
-      #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
-        && !mp_obj_is_type(self->desc, &mp_type_ordereddict)
-      #endif
-      ) {
-            mp_raise_TypeError("struct: no fields");
+STATIC uctypes_layout_t *uctypes_layout_compile(mp_obj_t desc) {
+    mp_map_t *map = &((mp_obj_dict_t*)MP_OBJ_TO_PTR(desc))->map;
+    uctypes_layout_t *layout = m_new_obj_var(uctypes_layout_t, uctypes_field_t, map->used);
+    layout->desc = desc;
+    layout->used = map->used;
+    size_t n = 0;
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (!mp_map_slot_is_filled(map, i)) {
+            continue;
+        }
+        uctypes_field_t *field = &layout->fields[n++];
+        field->name = mp_obj_str_get_qstr(map->table[i].key);
+        mp_obj_t v = map->table[i].value;
+        if (mp_obj_is_small_int(v)) {
+            mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(v);
+            field->is_agg = false;
+            field->val_type = GET_TYPE(offset, VAL_TYPE_BITS);
+            offset &= VALUE_MASK(VAL_TYPE_BITS);
+            field->bit_offset = 0;
+            field->bit_len = 0;
+            if (field->val_type >= BFUINT8 && field->val_type <= BFINT32) {
+                field->bit_offset = (offset >> 17) & 31;
+                field->bit_len = (offset >> 22) & 31;
+                offset &= (1 << 17) - 1;
+            }
+            field->offset = offset;
+            field->sub = MP_OBJ_NULL;
+        } else {
+            if (!mp_obj_is_type(v, &mp_type_tuple)) {
+                syntax_error();
+            }
+            mp_obj_tuple_t *sub = MP_OBJ_TO_PTR(v);
+            mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(sub->items[0]);
+            field->is_agg = true;
+            field->val_type = GET_TYPE(offset, AGG_TYPE_BITS);
+            field->offset = offset & VALUE_MASK(AGG_TYPE_BITS);
+            field->sub = v;
+        }
     }
+    layout->n_fields = n;
+    return layout;
+}
 
-    mp_obj_t deref = mp_obj_dict_get(self->desc, MP_OBJ_NEW_QSTR(attr));
-    if (mp_obj_is_small_int(deref)) {
-        mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(deref);
-        mp_uint_t val_type = GET_TYPE(offset, VAL_TYPE_BITS);
-        offset &= VALUE_MASK(VAL_TYPE_BITS);
-//printf("scalar type=%d offset=%x\n", val_type, offset);
+#if MICROPY_PY_UCTYPES_LAYOUT_CACHE
+// Nested structs get a new struct object on every access, so keep the most
+// recently used layouts, most recent first, to reuse for the same descriptor.
+// A layout is recompiled if fields were added to the dict since.
+STATIC uctypes_layout_t *uctypes_layout_get(mp_obj_t desc) {
+    uctypes_layout_t **cache = (uctypes_layout_t**)MP_STATE_VM(uctypes_layout_cache);
+    size_t i = 0;
+    for (; i < MICROPY_PY_UCTYPES_LAYOUT_CACHE && cache[i] != NULL; ++i) {
+        if (cache[i]->desc == desc) {
+            break;
+        }
+    }
+    uctypes_layout_t *layout;
+    if (i < MICROPY_PY_UCTYPES_LAYOUT_CACHE && cache[i] != NULL
+        && cache[i]->used == ((mp_obj_dict_t*)MP_OBJ_TO_PTR(desc))->map.used) {
+        layout = cache[i];
+    } else {
+        // not found, so the least recently used entry is dropped if full
+        layout = uctypes_layout_compile(desc);
+        if (i == MICROPY_PY_UCTYPES_LAYOUT_CACHE) {
+            --i;
+        }
+    }
+    memmove(&cache[1], &cache[0], i * sizeof(uctypes_layout_t*));
+    cache[0] = layout;
+    return layout;
+}
+#else
+#define uctypes_layout_get(desc) uctypes_layout_compile(desc)
+#endif
+
+STATIC uctypes_layout_t *uctypes_struct_get_layout(mp_obj_uctypes_struct_t *self) {
+    if (!uctypes_desc_is_dict(self->desc)) {
+        mp_raise_TypeError("struct: no fields");
+    }
+    if (self->layout == NULL) {
+        self->layout = uctypes_layout_get(self->desc);
+    }
+    return self->layout;
+}
+
+STATIC mp_obj_t uctypes_struct_field_op(mp_obj_uctypes_struct_t *self, const uctypes_field_t *field, mp_obj_t set_val) {
+    if (!field->is_agg) {
+        mp_uint_t val_type = field->val_type;
+        mp_uint_t offset = field->offset;
 
         if (val_type <= INT64 || val_type == FLOAT32 || val_type == FLOAT64) {
-//            printf("size=%d\n", GET_SCALAR_SIZE(val_type));
             if (self->flags == LAYOUT_NATIVE) {
                 if (set_val == MP_OBJ_NULL) {
                     return get_aligned(val_type, self->addr + offset, 0);
@@ -438,10 +537,9 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
                     return set_val; // just !MP_OBJ_NULL
                 }
             }
-        } else if (val_type >= BFUINT8 && val_type <= BFINT32) {
-            uint bit_offset = (offset >> 17) & 31;
-            uint bit_len = (offset >> 22) & 31;
-            offset &= (1 << 17) - 1;
+        } else {
+            uint bit_offset = field->bit_offset;
+            uint bit_len = field->bit_len;
             mp_uint_t val;
             if (self->flags == LAYOUT_NATIVE) {
                 val = get_aligned_basic(val_type & 6, self->addr + offset);
@@ -471,13 +569,6 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
                 return set_val; // just !MP_OBJ_NULL
             }
         }
-
-        assert(0);
-        return MP_OBJ_NULL;
-    }
-
-    if (!mp_obj_is_type(deref, &mp_type_tuple)) {
-        syntax_error();
     }
 
     if (set_val != MP_OBJ_NULL) {
@@ -485,19 +576,17 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
         syntax_error();
     }
 
-    mp_obj_tuple_t *sub = MP_OBJ_TO_PTR(deref);
-    mp_int_t offset = MP_OBJ_SMALL_INT_VALUE(sub->items[0]);
-    mp_uint_t agg_type = GET_TYPE(offset, AGG_TYPE_BITS);
-    offset &= VALUE_MASK(AGG_TYPE_BITS);
-//printf("agg type=%d offset=%x\n", agg_type, offset);
+    mp_obj_tuple_t *sub = MP_OBJ_TO_PTR(field->sub);
+    mp_uint_t offset = field->offset;
 
-    switch (agg_type) {
+    switch (field->val_type) {
         case STRUCT: {
             mp_obj_uctypes_struct_t *o = m_new_obj(mp_obj_uctypes_struct_t);
             o->base.type = &uctypes_struct_type;
             o->desc = sub->items[1];
             o->addr = self->addr + offset;
             o->flags = self->flags;
+            o->layout = NULL;
             return MP_OBJ_FROM_PTR(o);
         }
         case ARRAY: {
@@ -513,7 +602,7 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
             o->desc = MP_OBJ_FROM_PTR(sub);
             o->addr = self->addr + offset;
             o->flags = self->flags;
-//printf("PTR/ARR base addr=%p\n", o->addr);
+            o->layout = NULL;
             return MP_OBJ_FROM_PTR(o);
         }
     }
@@ -522,6 +611,17 @@ STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set
     return MP_OBJ_NULL;
 }
 
+STATIC mp_obj_t uctypes_struct_attr_op(mp_obj_t self_in, qstr attr, mp_obj_t set_val) {
+    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    uctypes_layout_t *layout = uctypes_struct_get_layout(self);
+    for (size_t i = 0; i < layout->n_fields; ++i) {
+        if (layout->fields[i].name == attr) {
+            return uctypes_struct_field_op(self, &layout->fields[i], set_val);
+        }
+    }
+    nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, MP_OBJ_NEW_QSTR(attr)));
+}
+
 STATIC void uctypes_struct_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     if (dest[0] == MP_OBJ_NULL) {
         // load attribute
@@ -587,6 +687,7 @@ STATIC mp_obj_t uctypes_struct_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_ob
                 o->desc = t->items[2];
                 o->addr = self->addr + size * index;
                 o->flags = self->flags;
+                o->layout = NULL;
                 return MP_OBJ_FROM_PTR(o);
             } else {
                 return MP_OBJ_NULL; // op not supported
@@ -605,6 +706,7 @@ STATIC mp_obj_t uctypes_struct_subscr(mp_obj_t self_in, mp_obj_t index_in, mp_ob
                 o->desc = t->items[1];
                 o->addr = p + size * index;
                 o->flags = self->flags;
+                o->layout = NULL;
                 return MP_OBJ_FROM_PTR(o);
             }
         }
@@ -645,6 +747,23 @@ STATIC mp_int_t uctypes_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo,
     return 0;
 }
 
+/// \function unpack_all()
+/// Return the values of all the fields of a structure as a tuple, in the
+/// order that iterating its descriptor gives.
+STATIC mp_obj_t uctypes_struct_unpack_all(mp_obj_t struct_in) {
+    if (!mp_obj_is_type(struct_in, &uctypes_struct_type)) {
+        mp_raise_TypeError(NULL);
+    }
+    mp_obj_uctypes_struct_t *self = MP_OBJ_TO_PTR(struct_in);
+    uctypes_layout_t *layout = uctypes_struct_get_layout(self);
+    mp_obj_tuple_t *res = MP_OBJ_TO_PTR(mp_obj_new_tuple(layout->n_fields, NULL));
+    for (size_t i = 0; i < layout->n_fields; ++i) {
+        res->items[i] = uctypes_struct_field_op(self, &layout->fields[i], MP_OBJ_NULL);
+    }
+    return MP_OBJ_FROM_PTR(res);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(uctypes_struct_unpack_all_obj, uctypes_struct_unpack_all);
+
 /// \function addressof()
 /// Return address of object's data (applies to object providing buffer
 /// interface).
@@ -692,6 +811,7 @@ STATIC const mp_rom_map_elem_t mp_module_uctypes_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_addressof), MP_ROM_PTR(&uctypes_struct_addressof_obj) },
     { MP_ROM_QSTR(MP_QSTR_bytes_at), MP_ROM_PTR(&uctypes_struct_bytes_at_obj) },
     { MP_ROM_QSTR(MP_QSTR_bytearray_at), MP_ROM_PTR(&uctypes_struct_bytearray_at_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_all), MP_ROM_PTR(&uctypes_struct_unpack_all_obj) },
 
     /// \moduleref uctypes
 
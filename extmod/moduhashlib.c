@@ -63,6 +63,15 @@ typedef struct _mp_obj_hash_t {
     char state[0];
 } mp_obj_hash_t;
 
+#if MICROPY_SSL_MBEDTLS && MICROPY_PY_UHASHLIB_FINALISER
+// mbedTLS contexts are freed when the hash object is collected, so that any
+// hardware hash engine one has claimed (eg with the esp32 SHA accelerator) is
+// released even if digest is never called
+#define m_new_hash_obj(ctx_type) m_new_obj_var_with_finaliser(mp_obj_hash_t, char, sizeof(ctx_type))
+#else
+#define m_new_hash_obj(ctx_type) m_new_obj_var(mp_obj_hash_t, char, sizeof(ctx_type))
+#endif
+
 #if MICROPY_PY_UHASHLIB_SHA256
 STATIC mp_obj_t uhashlib_sha256_update(mp_obj_t self_in, mp_obj_t arg);
 
@@ -76,7 +85,7 @@ STATIC mp_obj_t uhashlib_sha256_update(mp_obj_t self_in, mp_obj_t arg);
 
 STATIC mp_obj_t uhashlib_sha256_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 0, 1, false);
-    mp_obj_hash_t *o = m_new_obj_var(mp_obj_hash_t, char, sizeof(mbedtls_sha256_context));
+    mp_obj_hash_t *o = m_new_hash_obj(mbedtls_sha256_context);
     o->base.type = type;
     mbedtls_sha256_init((mbedtls_sha256_context*)&o->state);
     mbedtls_sha256_starts_ret((mbedtls_sha256_context*)&o->state, 0);
@@ -99,9 +108,19 @@ STATIC mp_obj_t uhashlib_sha256_digest(mp_obj_t self_in) {
     vstr_t vstr;
     vstr_init_len(&vstr, 32);
     mbedtls_sha256_finish_ret((mbedtls_sha256_context*)&self->state, (unsigned char *)vstr.buf);
+    mbedtls_sha256_free((mbedtls_sha256_context*)&self->state);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
 
+#if MICROPY_PY_UHASHLIB_FINALISER
+STATIC mp_obj_t uhashlib_sha256_del(mp_obj_t self_in) {
+    mp_obj_hash_t *self = MP_OBJ_TO_PTR(self_in);
+    mbedtls_sha256_free((mbedtls_sha256_context*)&self->state);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uhashlib_sha256_del_obj, uhashlib_sha256_del);
+#endif
+
 #else
 
 #include "crypto-algorithms/sha256.c"
@@ -140,6 +159,9 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(uhashlib_sha256_digest_obj, uhashlib_sha256_dig
 STATIC const mp_rom_map_elem_t uhashlib_sha256_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&uhashlib_sha256_update_obj) },
     { MP_ROM_QSTR(MP_QSTR_digest), MP_ROM_PTR(&uhashlib_sha256_digest_obj) },
+    #if MICROPY_SSL_MBEDTLS && MICROPY_PY_UHASHLIB_FINALISER
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&uhashlib_sha256_del_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(uhashlib_sha256_locals_dict, uhashlib_sha256_locals_dict_table);
@@ -194,7 +216,7 @@ STATIC mp_obj_t uhashlib_sha1_digest(mp_obj_t self_in) {
 
 STATIC mp_obj_t uhashlib_sha1_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 0, 1, false);
-    mp_obj_hash_t *o = m_new_obj_var(mp_obj_hash_t, char, sizeof(mbedtls_sha1_context));
+    mp_obj_hash_t *o = m_new_hash_obj(mbedtls_sha1_context);
     o->base.type = type;
     mbedtls_sha1_init((mbedtls_sha1_context*)o->state);
     mbedtls_sha1_starts_ret((mbedtls_sha1_context*)o->state);
@@ -220,6 +242,15 @@ STATIC mp_obj_t uhashlib_sha1_digest(mp_obj_t self_in) {
     mbedtls_sha1_free((mbedtls_sha1_context*)self->state);
     return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
 }
+
+#if MICROPY_PY_UHASHLIB_FINALISER
+STATIC mp_obj_t uhashlib_sha1_del(mp_obj_t self_in) {
+    mp_obj_hash_t *self = MP_OBJ_TO_PTR(self_in);
+    mbedtls_sha1_free((mbedtls_sha1_context*)self->state);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(uhashlib_sha1_del_obj, uhashlib_sha1_del);
+#endif
 #endif
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(uhashlib_sha1_update_obj, uhashlib_sha1_update);
@@ -228,6 +259,9 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(uhashlib_sha1_digest_obj, uhashlib_sha1_digest)
 STATIC const mp_rom_map_elem_t uhashlib_sha1_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_update), MP_ROM_PTR(&uhashlib_sha1_update_obj) },
     { MP_ROM_QSTR(MP_QSTR_digest), MP_ROM_PTR(&uhashlib_sha1_digest_obj) },
+    #if MICROPY_SSL_MBEDTLS && MICROPY_PY_UHASHLIB_FINALISER
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&uhashlib_sha1_del_obj) },
+    #endif
 };
 STATIC MP_DEFINE_CONST_DICT(uhashlib_sha1_locals_dict, uhashlib_sha1_locals_dict_table);
 
@@ -25,6 +25,7 @@
  */
 
 #include "py/objlist.h"
+#include "py/objtuple.h"
 #include "py/runtime.h"
 
 #if MICROPY_PY_UHEAPQ
@@ -38,12 +39,33 @@ STATIC mp_obj_list_t *get_heap(mp_obj_t heap_in) {
     return MP_OBJ_TO_PTR(heap_in);
 }
 
-STATIC void heap_siftdown(mp_obj_list_t *heap, mp_uint_t start_pos, mp_uint_t pos) {
+// Compare two heap items.  Small ints, and tuples whose first items are
+// distinct small ints (eg (time, callback) entries), are compared directly
+// without going through the generic binary-op dispatch.
+STATIC bool heap_less(mp_obj_t a, mp_obj_t b) {
+    if (mp_obj_is_small_int(a) && mp_obj_is_small_int(b)) {
+        return MP_OBJ_SMALL_INT_VALUE(a) < MP_OBJ_SMALL_INT_VALUE(b);
+    }
+    if (mp_obj_is_type(a, &mp_type_tuple) && mp_obj_is_type(b, &mp_type_tuple)) {
+        mp_obj_tuple_t *ta = MP_OBJ_TO_PTR(a);
+        mp_obj_tuple_t *tb = MP_OBJ_TO_PTR(b);
+        if (ta->len > 0 && tb->len > 0 && ta->items[0] != tb->items[0]
+            && mp_obj_is_small_int(ta->items[0]) && mp_obj_is_small_int(tb->items[0])) {
+            return MP_OBJ_SMALL_INT_VALUE(ta->items[0]) < MP_OBJ_SMALL_INT_VALUE(tb->items[0]);
+        }
+    }
+    return mp_binary_op(MP_BINARY_OP_LESS, a, b) == mp_const_true;
+}
+
+// A max-heap is only used internally, by nsmallest
+#define HEAP_LESS(max, a, b) ((max) ? heap_less((b), (a)) : heap_less((a), (b)))
+
+STATIC void heap_siftdown(mp_obj_list_t *heap, mp_uint_t start_pos, mp_uint_t pos, bool max) {
     mp_obj_t item = heap->items[pos];
     while (pos > start_pos) {
         mp_uint_t parent_pos = (pos - 1) >> 1;
         mp_obj_t parent = heap->items[parent_pos];
-        if (mp_binary_op(MP_BINARY_OP_LESS, item, parent) == mp_const_true) {
+        if (HEAP_LESS(max, item, parent)) {
             heap->items[pos] = parent;
             pos = parent_pos;
         } else {
@@ -53,13 +75,13 @@ STATIC void heap_siftdown(mp_obj_list_t *heap, mp_uint_t start_pos, mp_uint_t po
     heap->items[pos] = item;
 }
 
-STATIC void heap_siftup(mp_obj_list_t *heap, mp_uint_t pos) {
+STATIC void heap_siftup(mp_obj_list_t *heap, mp_uint_t pos, bool max) {
     mp_uint_t start_pos = pos;
     mp_uint_t end_pos = heap->len;
     mp_obj_t item = heap->items[pos];
     for (mp_uint_t child_pos = 2 * pos + 1; child_pos < end_pos; child_pos = 2 * pos + 1) {
         // choose right child if it's <= left child
-        if (child_pos + 1 < end_pos && mp_binary_op(MP_BINARY_OP_LESS, heap->items[child_pos], heap->items[child_pos + 1]) == mp_const_false) {
+        if (child_pos + 1 < end_pos && !HEAP_LESS(max, heap->items[child_pos], heap->items[child_pos + 1])) {
             child_pos += 1;
         }
         // bubble up the smaller child
@@ -67,13 +89,13 @@ STATIC void heap_siftup(mp_obj_list_t *heap, mp_uint_t pos) {
         pos = child_pos;
     }
     heap->items[pos] = item;
-    heap_siftdown(heap, start_pos, pos);
+    heap_siftdown(heap, start_pos, pos, max);
 }
 
 STATIC mp_obj_t mod_uheapq_heappush(mp_obj_t heap_in, mp_obj_t item) {
     mp_obj_list_t *heap = get_heap(heap_in);
     mp_obj_list_append(heap_in, item);
-    heap_siftdown(heap, 0, heap->len - 1);
+    heap_siftdown(heap, 0, heap->len - 1, false);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_uheapq_heappush_obj, mod_uheapq_heappush);
@@ -88,7 +110,7 @@ STATIC mp_obj_t mod_uheapq_heappop(mp_obj_t heap_in) {
     heap->items[0] = heap->items[heap->len];
     heap->items[heap->len] = MP_OBJ_NULL; // so we don't retain a pointer
     if (heap->len) {
-        heap_siftup(heap, 0);
+        heap_siftup(heap, 0, false);
     }
     return item;
 }
@@ -97,17 +119,153 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uheapq_heappop_obj, mod_uheapq_heappop);
 STATIC mp_obj_t mod_uheapq_heapify(mp_obj_t heap_in) {
     mp_obj_list_t *heap = get_heap(heap_in);
     for (mp_uint_t i = heap->len / 2; i > 0;) {
-        heap_siftup(heap, --i);
+        heap_siftup(heap, --i, false);
     }
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_uheapq_heapify_obj, mod_uheapq_heapify);
 
+#if MICROPY_PY_UHEAPQ_BULK
+// Keep the n best items of the iterable in a bounded heap whose root is the
+// worst of them, then heap-sort it in place so the best comes first.
+STATIC mp_obj_t heap_nbest(mp_obj_t n_in, mp_obj_t iterable, bool smallest) {
+    mp_int_t n = mp_obj_get_int(n_in);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    if (n <= 0) {
+        return list;
+    }
+    mp_obj_list_t *heap = MP_OBJ_TO_PTR(list);
+    mp_obj_t iter = mp_getiter(iterable, NULL);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        if (heap->len < (size_t)n) {
+            mp_obj_list_append(list, item);
+            heap_siftdown(heap, 0, heap->len - 1, smallest);
+        } else if (HEAP_LESS(smallest, heap->items[0], item)) {
+            heap->items[0] = item;
+            heap_siftup(heap, 0, smallest);
+        }
+    }
+    size_t len = heap->len;
+    while (heap->len > 1) {
+        heap->len -= 1;
+        mp_obj_t top = heap->items[0];
+        heap->items[0] = heap->items[heap->len];
+        heap->items[heap->len] = top;
+        heap_siftup(heap, 0, smallest);
+    }
+    heap->len = len;
+    return list;
+}
+
+STATIC mp_obj_t mod_uheapq_nsmallest(mp_obj_t n_in, mp_obj_t iterable) {
+    return heap_nbest(n_in, iterable, true);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_uheapq_nsmallest_obj, mod_uheapq_nsmallest);
+
+STATIC mp_obj_t mod_uheapq_nlargest(mp_obj_t n_in, mp_obj_t iterable) {
+    return heap_nbest(n_in, iterable, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_uheapq_nlargest_obj, mod_uheapq_nlargest);
+
+// merge keeps a heap of the next value from each input iterator.  Ties are
+// broken by the position of the input, so the merge is stable.
+typedef struct _merge_entry_t {
+    mp_obj_t value;
+    mp_obj_t iter;
+    size_t order;
+} merge_entry_t;
+
+typedef struct _mp_obj_uheapq_merge_t {
+    mp_obj_base_t base;
+    size_t len;
+    merge_entry_t entries[];
+} mp_obj_uheapq_merge_t;
+
+STATIC bool merge_less(const merge_entry_t *a, const merge_entry_t *b) {
+    if (heap_less(a->value, b->value)) {
+        return true;
+    }
+    return a->order < b->order && !heap_less(b->value, a->value);
+}
+
+STATIC void merge_siftup(mp_obj_uheapq_merge_t *self, size_t pos) {
+    merge_entry_t item = self->entries[pos];
+    for (size_t child_pos = 2 * pos + 1; child_pos < self->len; child_pos = 2 * pos + 1) {
+        if (child_pos + 1 < self->len && merge_less(&self->entries[child_pos + 1], &self->entries[child_pos])) {
+            child_pos += 1;
+        }
+        if (!merge_less(&self->entries[child_pos], &item)) {
+            break;
+        }
+        self->entries[pos] = self->entries[child_pos];
+        pos = child_pos;
+    }
+    self->entries[pos] = item;
+}
+
+STATIC mp_obj_t merge_iternext(mp_obj_t self_in) {
+    mp_obj_uheapq_merge_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->len == 0) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    merge_entry_t *top = &self->entries[0];
+    mp_obj_t ret = top->value;
+    mp_obj_t next = mp_iternext(top->iter);
+    if (next == MP_OBJ_STOP_ITERATION) {
+        self->len -= 1;
+        *top = self->entries[self->len];
+        // so we don't retain a pointer
+        self->entries[self->len].value = MP_OBJ_NULL;
+        self->entries[self->len].iter = MP_OBJ_NULL;
+    } else {
+        top->value = next;
+    }
+    if (self->len > 1) {
+        merge_siftup(self, 0);
+    }
+    return ret;
+}
+
+STATIC const mp_obj_type_t mod_uheapq_merge_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_merge,
+    .getiter = mp_identity_getiter,
+    .iternext = merge_iternext,
+};
+
+STATIC mp_obj_t mod_uheapq_merge(size_t n_args, const mp_obj_t *args) {
+    mp_obj_uheapq_merge_t *o = m_new_obj_var(mp_obj_uheapq_merge_t, merge_entry_t, n_args);
+    o->base.type = &mod_uheapq_merge_type;
+    o->len = 0;
+    for (size_t i = 0; i < n_args; ++i) {
+        mp_obj_t iter = mp_getiter(args[i], NULL);
+        mp_obj_t value = mp_iternext(iter);
+        if (value != MP_OBJ_STOP_ITERATION) {
+            merge_entry_t *e = &o->entries[o->len++];
+            e->value = value;
+            e->iter = iter;
+            e->order = i;
+        }
+    }
+    for (size_t i = o->len / 2; i > 0;) {
+        merge_siftup(o, --i);
+    }
+    return MP_OBJ_FROM_PTR(o);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR(mod_uheapq_merge_obj, 0, mod_uheapq_merge);
+#endif
+
 STATIC const mp_rom_map_elem_t mp_module_uheapq_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uheapq) },
     { MP_ROM_QSTR(MP_QSTR_heappush), MP_ROM_PTR(&mod_uheapq_heappush_obj) },
     { MP_ROM_QSTR(MP_QSTR_heappop), MP_ROM_PTR(&mod_uheapq_heappop_obj) },
     { MP_ROM_QSTR(MP_QSTR_heapify), MP_ROM_PTR(&mod_uheapq_heapify_obj) },
+    #if MICROPY_PY_UHEAPQ_BULK
+    { MP_ROM_QSTR(MP_QSTR_nsmallest), MP_ROM_PTR(&mod_uheapq_nsmallest_obj) },
+    { MP_ROM_QSTR(MP_QSTR_nlargest), MP_ROM_PTR(&mod_uheapq_nlargest_obj) },
+    { MP_ROM_QSTR(MP_QSTR_merge), MP_ROM_PTR(&mod_uheapq_merge_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uheapq_globals, mp_module_uheapq_globals_table);
@@ -0,0 +1,789 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "py/mpstate.h"
+
+#if MICROPY_PY_UHTTPC
+
+// HTTP/1.1 client with the API of urequests.
+//
+// A Session keeps the connections of finished responses open and uses them
+// again for the next request to the same host, and remembers the TLS
+// session of each https host so that a new connection to it can resume the
+// session instead of doing a full handshake.  A Response is a stream of its
+// body, chunked transfer coding removed, which can be read in pieces with
+// readinto() instead of all at once with .content.  When the body has been
+// read to the end the connection goes back to the session's pool.
+
+// the longest status or header line accepted
+#define UHTTPC_LINE_MAX (2048)
+
+// A connection, with the data read ahead of what has been consumed
+typedef struct _uhttpc_conn_t {
+    mp_obj_t sock;
+    mp_obj_t host;
+    uint16_t port;
+    bool ssl;
+    size_t rx_pos;
+    size_t rx_len;
+    size_t buf_size;
+    byte buf[];
+} uhttpc_conn_t;
+
+typedef struct _uhttpc_session_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t connect;           // called to open connections, or None for usocket
+    mp_obj_t tls_sessions;      // dict of (host, port) to a resumable TLS session
+    size_t buf_size;
+    size_t pool_size;
+    uhttpc_conn_t **pool;       // idle keep-alive connections, NULL for a free slot
+} uhttpc_session_obj_t;
+
+typedef struct _uhttpc_response_obj_t {
+    mp_obj_base_t base;
+    uhttpc_session_obj_t *session;
+    uhttpc_conn_t *conn;        // NULL once the body is finished or closed
+    mp_obj_t reason;
+    mp_obj_t headers;
+    mp_obj_t content;           // MP_OBJ_NULL until read
+    size_t remaining;           // bytes left in the body, or in the current chunk
+    uint16_t status;
+    bool chunked;
+    bool in_chunks;             // a chunk has been started
+    bool until_close;           // neither chunked nor with a length
+    bool keep_alive;
+} uhttpc_response_obj_t;
+
+STATIC const mp_obj_type_t uhttpc_session_type;
+STATIC const mp_obj_type_t uhttpc_response_type;
+
+/******************************************************************************/
+// Connections
+
+STATIC bool str_ieq(const char *a, const char *b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (unichar_tolower((unsigned char)a[i]) != (unsigned char)b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+STATIC void conn_close(uhttpc_conn_t *conn) {
+    mp_stream_close(conn->sock);
+    conn->sock = MP_OBJ_NULL;
+}
+
+STATIC mp_obj_t conn_open_socket(uhttpc_session_obj_t *session, mp_obj_t host, mp_int_t port, bool ssl) {
+    if (session->connect != mp_const_none) {
+        mp_obj_t args[3] = { host, MP_OBJ_NEW_SMALL_INT(port), mp_obj_new_bool(ssl) };
+        return mp_call_function_n_kw(session->connect, 3, 0, args);
+    }
+
+    mp_obj_t usocket = mp_import_name(MP_QSTR_usocket, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+    mp_obj_t ai_args[2] = { host, MP_OBJ_NEW_SMALL_INT(port) };
+    mp_obj_t ai = mp_call_function_n_kw(mp_load_attr(usocket, MP_QSTR_getaddrinfo), 2, 0, ai_args);
+    ai = mp_obj_subscr(ai, MP_OBJ_NEW_SMALL_INT(0), MP_OBJ_SENTINEL);
+    mp_obj_t addr = mp_obj_subscr(ai, MP_OBJ_NEW_SMALL_INT(-1), MP_OBJ_SENTINEL);
+    mp_obj_t sock = mp_call_function_0(mp_load_attr(usocket, MP_QSTR_socket));
+    mp_obj_t dest[3];
+    mp_load_method(sock, MP_QSTR_connect, dest);
+    dest[2] = addr;
+    mp_call_method_n_kw(1, 0, dest);
+    if (!ssl) {
+        return sock;
+    }
+
+    // ussl.wrap_socket(sock, server_hostname=host[, session=...]), resuming
+    // the last TLS session with this server if there is one
+    mp_obj_t key_items[2] = { host, MP_OBJ_NEW_SMALL_INT(port) };
+    mp_obj_t key = mp_obj_new_tuple(2, key_items);
+    mp_map_elem_t *elem = mp_map_lookup(mp_obj_dict_get_map(session->tls_sessions), key, MP_MAP_LOOKUP);
+    mp_obj_t ussl = mp_import_name(MP_QSTR_ussl, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+    mp_obj_t wrap_args[5] = {
+        sock,
+        MP_OBJ_NEW_QSTR(MP_QSTR_server_hostname), host,
+        MP_OBJ_NEW_QSTR(MP_QSTR_session), elem != NULL ? elem->value : mp_const_none,
+    };
+    sock = mp_call_function_n_kw(mp_load_attr(ussl, MP_QSTR_wrap_socket), 1, elem != NULL ? 2 : 1, wrap_args);
+    mp_load_method_maybe(sock, MP_QSTR_getsession, dest);
+    if (dest[0] != MP_OBJ_NULL) {
+        mp_obj_dict_store(session->tls_sessions, key, mp_call_method_n_kw(0, 0, dest));
+    }
+    return sock;
+}
+
+STATIC uhttpc_conn_t *conn_open(uhttpc_session_obj_t *session, mp_obj_t host, mp_int_t port, bool ssl) {
+    mp_obj_t sock = conn_open_socket(session, host, port, ssl);
+    mp_get_stream_raise(sock, MP_STREAM_OP_READ | MP_STREAM_OP_WRITE);
+    uhttpc_conn_t *conn = m_new_obj_var(uhttpc_conn_t, byte, session->buf_size);
+    conn->sock = sock;
+    conn->host = host;
+    conn->port = port;
+    conn->ssl = ssl;
+    conn->rx_pos = 0;
+    conn->rx_len = 0;
+    conn->buf_size = session->buf_size;
+    return conn;
+}
+
+STATIC size_t conn_recv(uhttpc_conn_t *conn, void *buf, size_t len) {
+    int errcode;
+    mp_uint_t out_sz = mp_stream_rw(conn->sock, buf, len, &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+    if (out_sz == MP_STREAM_ERROR || errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    return out_sz;
+}
+
+// Read up to len bytes with at most one read from the socket.  Reads at
+// least as big as the buffer go straight to the caller's memory.
+STATIC size_t conn_read(uhttpc_conn_t *conn, byte *buf, size_t len) {
+    if (conn->rx_pos == conn->rx_len) {
+        if (len >= conn->buf_size) {
+            return conn_recv(conn, buf, len);
+        }
+        conn->rx_pos = 0;
+        conn->rx_len = conn_recv(conn, conn->buf, conn->buf_size);
+    }
+    len = MIN(len, conn->rx_len - conn->rx_pos);
+    memcpy(buf, conn->buf + conn->rx_pos, len);
+    conn->rx_pos += len;
+    return len;
+}
+
+// Read a line into vstr, without its CRLF.  Returns false if the connection
+// closed before the end of the line.
+STATIC bool conn_readline(uhttpc_conn_t *conn, vstr_t *vstr) {
+    vstr_reset(vstr);
+    for (;;) {
+        if (conn->rx_pos == conn->rx_len) {
+            conn->rx_pos = 0;
+            conn->rx_len = conn_recv(conn, conn->buf, conn->buf_size);
+            if (conn->rx_len == 0) {
+                return false;
+            }
+        }
+        const byte *start = conn->buf + conn->rx_pos;
+        size_t avail = conn->rx_len - conn->rx_pos;
+        const byte *nl = memchr(start, '\n', avail);
+        size_t n = (nl != NULL) ? (size_t)(nl - start) + 1 : avail;
+        if (vstr->len + n > UHTTPC_LINE_MAX) {
+            mp_raise_OSError(MP_EIO);
+        }
+        vstr_add_strn(vstr, (const char*)start, n);
+        conn->rx_pos += n;
+        if (nl != NULL) {
+            vstr_cut_tail_bytes(vstr, 1);
+            if (vstr->len > 0 && vstr->buf[vstr->len - 1] == '\r') {
+                vstr_cut_tail_bytes(vstr, 1);
+            }
+            return true;
+        }
+    }
+}
+
+STATIC uhttpc_conn_t *pool_take(uhttpc_session_obj_t *session, mp_obj_t host, mp_int_t port, bool ssl) {
+    for (size_t i = 0; i < session->pool_size; i++) {
+        uhttpc_conn_t *conn = session->pool[i];
+        if (conn != NULL && conn->port == port && conn->ssl == ssl && mp_obj_equal(conn->host, host)) {
+            session->pool[i] = NULL;
+            return conn;
+        }
+    }
+    return NULL;
+}
+
+STATIC void pool_release(uhttpc_session_obj_t *session, uhttpc_conn_t *conn, bool keep_alive) {
+    // a connection with unread data after the response can't be used again
+    if (keep_alive && conn->rx_pos == conn->rx_len) {
+        for (size_t i = 0; i < session->pool_size; i++) {
+            if (session->pool[i] == NULL) {
+                session->pool[i] = conn;
+                return;
+            }
+        }
+    }
+    conn_close(conn);
+}
+
+/******************************************************************************/
+// Response
+
+STATIC void response_finish(uhttpc_response_obj_t *self, bool keep_alive) {
+    uhttpc_conn_t *conn = self->conn;
+    if (conn != NULL) {
+        self->conn = NULL;
+        pool_release(self->session, conn, keep_alive);
+    }
+}
+
+// Start the next chunk of a chunked body.  Returns false after the last one.
+STATIC bool response_next_chunk(uhttpc_response_obj_t *self) {
+    vstr_t vstr;
+    vstr_init(&vstr, 16);
+    if (self->in_chunks) {
+        // the CRLF that ends the previous chunk
+        if (!conn_readline(self->conn, &vstr) || vstr.len != 0) {
+            mp_raise_OSError(MP_EIO);
+        }
+    }
+    if (!conn_readline(self->conn, &vstr)) {
+        mp_raise_OSError(MP_EIO);
+    }
+    self->in_chunks = true;
+    size_t size = 0;
+    size_t i = 0;
+    for (; i < vstr.len; i++) {
+        int c = unichar_xdigit_value(vstr.buf[i]);
+        if (!unichar_isxdigit(vstr.buf[i])) {
+            break;
+        }
+        size = size * 16 + c;
+    }
+    if (i == 0) {
+        mp_raise_OSError(MP_EIO);
+    }
+    if (size == 0) {
+        // skip any trailer fields, up to the empty line
+        do {
+            if (!conn_readline(self->conn, &vstr)) {
+                mp_raise_OSError(MP_EIO);
+            }
+        } while (vstr.len != 0);
+        vstr_clear(&vstr);
+        return false;
+    }
+    vstr_clear(&vstr);
+    self->remaining = size;
+    return true;
+}
+
+STATIC mp_uint_t response_stream_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
+    uhttpc_response_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)errcode;
+    if (self->conn == NULL || size == 0) {
+        return 0;
+    }
+    if (self->remaining == 0 && !self->until_close) {
+        if (!self->chunked || !response_next_chunk(self)) {
+            response_finish(self, self->keep_alive);
+            return 0;
+        }
+    }
+    if (!self->until_close) {
+        size = MIN(size, self->remaining);
+    }
+    size_t n = conn_read(self->conn, buf, size);
+    if (n == 0) {
+        if (!self->until_close) {
+            // the server closed the connection in the middle of the body
+            response_finish(self, false);
+            mp_raise_OSError(MP_ECONNRESET);
+        }
+        response_finish(self, false);
+        return 0;
+    }
+    if (!self->until_close) {
+        self->remaining -= n;
+        if (self->remaining == 0 && !self->chunked) {
+            response_finish(self, self->keep_alive);
+        }
+    }
+    return n;
+}
+
+STATIC mp_uint_t response_stream_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    uhttpc_response_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)arg;
+    if (request == MP_STREAM_CLOSE) {
+        // an unfinished body would be left in the way of the next response
+        response_finish(self, false);
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC mp_obj_t response_content(uhttpc_response_obj_t *self) {
+    if (self->content == MP_OBJ_NULL) {
+        vstr_t vstr;
+        vstr_init(&vstr, self->until_close || self->chunked ? self->session->buf_size : self->remaining);
+        while (self->conn != NULL) {
+            if (vstr.len == vstr.alloc) {
+                vstr_hint_size(&vstr, self->session->buf_size);
+            }
+            int errcode;
+            size_t n = response_stream_read(MP_OBJ_FROM_PTR(self), vstr.buf + vstr.len, vstr.alloc - vstr.len, &errcode);
+            vstr.len += n;
+        }
+        self->content = mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    }
+    return self->content;
+}
+
+STATIC mp_obj_t response_json(mp_obj_t self_in) {
+    mp_obj_t ujson = mp_import_name(MP_QSTR_ujson, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+    return mp_call_function_1(mp_load_attr(ujson, MP_QSTR_loads), response_content(MP_OBJ_TO_PTR(self_in)));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(response_json_obj, response_json);
+
+STATIC mp_obj_t response___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return mp_stream_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(response___exit___obj, 4, 4, response___exit__);
+
+STATIC void response_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    uhttpc_response_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "<Response [%u]>", self->status);
+}
+
+STATIC const mp_rom_map_elem_t response_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_json), MP_ROM_PTR(&response_json_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&response___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(response_locals_dict, response_locals_dict_table);
+
+STATIC void response_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    uhttpc_response_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (dest[0] != MP_OBJ_NULL) {
+        // attributes are read-only
+        return;
+    }
+    switch (attr) {
+        case MP_QSTR_status_code:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->status);
+            break;
+        case MP_QSTR_reason:
+            dest[0] = self->reason;
+            break;
+        case MP_QSTR_headers:
+            dest[0] = self->headers;
+            break;
+        case MP_QSTR_content:
+            dest[0] = response_content(self);
+            break;
+        case MP_QSTR_text: {
+            size_t len;
+            const char *content = mp_obj_str_get_data(response_content(self), &len);
+            dest[0] = mp_obj_new_str(content, len);
+            break;
+        }
+        default: {
+            mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&response_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+            if (elem != NULL) {
+                mp_convert_member_lookup(self_in, &uhttpc_response_type, elem->value, dest);
+            }
+            break;
+        }
+    }
+}
+
+STATIC const mp_stream_p_t response_stream_p = {
+    .read = response_stream_read,
+    .ioctl = response_stream_ioctl,
+};
+
+STATIC const mp_obj_type_t uhttpc_response_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Response,
+    .print = response_print,
+    .attr = response_attr,
+    .protocol = &response_stream_p,
+    .locals_dict = (mp_obj_dict_t*)&response_locals_dict,
+};
+
+// Read the status line and the header fields, and work out how the body ends
+STATIC void response_read_head(uhttpc_response_obj_t *self, const char *method, vstr_t *line) {
+    uhttpc_conn_t *conn = self->conn;
+    // the status line is already in line
+    const char *s = line->buf;
+    if (line->len < 12 || strncmp(s, "HTTP/1.", 7) != 0 || s[8] != ' ') {
+        mp_raise_OSError(MP_EIO);
+    }
+    bool http10 = s[7] == '0';
+    self->status = (s[9] - '0') * 100 + (s[10] - '0') * 10 + (s[11] - '0');
+    self->reason = mp_obj_new_str(s + MIN(13, line->len), line->len - MIN(13, line->len));
+
+    self->headers = mp_obj_new_dict(0);
+    bool have_length = false;
+    self->keep_alive = !http10;
+    for (;;) {
+        if (!conn_readline(conn, line)) {
+            mp_raise_OSError(MP_ECONNRESET);
+        }
+        if (line->len == 0) {
+            break;
+        }
+        char *colon = memchr(line->buf, ':', line->len);
+        if (colon == NULL) {
+            continue;
+        }
+        size_t key_len = colon - line->buf;
+        for (size_t i = 0; i < key_len; i++) {
+            line->buf[i] = unichar_tolower(line->buf[i]);
+        }
+        const char *value = colon + 1;
+        const char *end = line->buf + line->len;
+        while (value < end && (*value == ' ' || *value == '\t')) {
+            value++;
+        }
+        size_t value_len = end - value;
+        mp_obj_t key = mp_obj_new_str(line->buf, key_len);
+        mp_obj_dict_store(self->headers, key, mp_obj_new_str(value, value_len));
+
+        if (key_len == 14 && memcmp(line->buf, "content-length", 14) == 0) {
+            self->remaining = 0;
+            for (const char *p = value; p < end && unichar_isdigit(*p); p++) {
+                self->remaining = self->remaining * 10 + (*p - '0');
+            }
+            have_length = true;
+        } else if (key_len == 17 && memcmp(line->buf, "transfer-encoding", 17) == 0) {
+            self->chunked = value_len >= 7 && str_ieq(end - 7, "chunked", 7);
+        } else if (key_len == 10 && memcmp(line->buf, "connection", 10) == 0) {
+            if (value_len == 5 && str_ieq(value, "close", 5)) {
+                self->keep_alive = false;
+            } else if (value_len == 10 && str_ieq(value, "keep-alive", 10)) {
+                self->keep_alive = true;
+            }
+        }
+    }
+
+    if (strcmp(method, "HEAD") == 0 || self->status / 100 == 1 || self->status == 204 || self->status == 304) {
+        self->chunked = false;
+        self->remaining = 0;
+    } else if (self->chunked) {
+        self->remaining = 0;
+    } else if (!have_length) {
+        self->until_close = true;
+        self->keep_alive = false;
+    }
+    if (!self->chunked && !self->until_close && self->remaining == 0) {
+        response_finish(self, self->keep_alive);
+    }
+}
+
+/******************************************************************************/
+// Session
+
+// Send a request and read the status line of the response into line.
+// Returns the exception raised doing so, or MP_OBJ_NULL.
+STATIC mp_obj_t conn_send_request(uhttpc_conn_t *conn, vstr_t *req, mp_buffer_info_t *body, vstr_t *line) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_stream_iovec_t iov[2] = { { req->buf, req->len }, { body->buf, body->len } };
+        int errcode;
+        mp_stream_writev(conn->sock, iov, 2, &errcode);
+        if (errcode != 0) {
+            mp_raise_OSError(errcode);
+        }
+        if (!conn_readline(conn, line)) {
+            mp_raise_OSError(MP_ECONNRESET);
+        }
+        nlr_pop();
+        return MP_OBJ_NULL;
+    } else {
+        return MP_OBJ_FROM_PTR(nlr.ret_val);
+    }
+}
+
+STATIC mp_obj_t session_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_pool_size, ARG_buf_size, ARG_connect };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_pool_size, MP_ARG_INT, {.u_int = 2} },
+        { MP_QSTR_buf_size, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 512} },
+        { MP_QSTR_connect, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    if (args[ARG_pool_size].u_int < 0 || args[ARG_buf_size].u_int < 16) {
+        mp_raise_ValueError(NULL);
+    }
+    uhttpc_session_obj_t *self = m_new_obj(uhttpc_session_obj_t);
+    self->base.type = type;
+    self->connect = args[ARG_connect].u_obj;
+    self->tls_sessions = mp_obj_new_dict(0);
+    self->buf_size = args[ARG_buf_size].u_int;
+    self->pool_size = args[ARG_pool_size].u_int;
+    self->pool = m_new0(uhttpc_conn_t*, self->pool_size);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Split an http or https URL, returning the path
+STATIC const char *parse_url(mp_obj_t url_in, bool *ssl, mp_obj_t *host, mp_int_t *port) {
+    size_t len;
+    const char *url = mp_obj_str_get_data(url_in, &len);
+    const char *end = url + len;
+    const char *p;
+    if (len >= 7 && strncmp(url, "http://", 7) == 0) {
+        *ssl = false;
+        *port = 80;
+        p = url + 7;
+    } else if (len >= 8 && strncmp(url, "https://", 8) == 0) {
+        *ssl = true;
+        *port = 443;
+        p = url + 8;
+    } else {
+        mp_raise_ValueError("unsupported URL");
+    }
+    const char *host_start = p;
+    while (p < end && *p != '/' && *p != ':') {
+        p++;
+    }
+    if (p == host_start) {
+        mp_raise_ValueError("unsupported URL");
+    }
+    *host = mp_obj_new_str(host_start, p - host_start);
+    if (p < end && *p == ':') {
+        mp_int_t n = 0;
+        for (p++; p < end && unichar_isdigit(*p); p++) {
+            n = n * 10 + (*p - '0');
+        }
+        if (n <= 0 || n > 0xffff) {
+            mp_raise_ValueError("unsupported URL");
+        }
+        *port = n;
+    }
+    return p;
+}
+
+STATIC mp_obj_t session_do_request(uhttpc_session_obj_t *self, const char *method, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_url, ARG_data, ARG_json, ARG_headers };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_url, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_data, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_json, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_headers, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    bool ssl;
+    mp_obj_t host;
+    mp_int_t port;
+    const char *path = parse_url(args[ARG_url].u_obj, &ssl, &host, &port);
+    size_t url_len;
+    const char *url = mp_obj_str_get_data(args[ARG_url].u_obj, &url_len);
+    size_t path_len = url + url_len - path;
+
+    mp_obj_t data = args[ARG_data].u_obj;
+    if (args[ARG_json].u_obj != mp_const_none) {
+        mp_obj_t ujson = mp_import_name(MP_QSTR_ujson, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+        data = mp_call_function_1(mp_load_attr(ujson, MP_QSTR_dumps), args[ARG_json].u_obj);
+    }
+    mp_buffer_info_t body = { NULL, 0, 0 };
+    if (data != mp_const_none) {
+        mp_get_buffer_raise(data, &body, MP_BUFFER_READ);
+    }
+
+    // the request head is put together in one string
+    vstr_t req;
+    vstr_init(&req, 128);
+    vstr_printf(&req, "%s %.*s HTTP/1.1\r\nHost: %s", method,
+        path_len != 0 ? (int)path_len : 1, path_len != 0 ? path : "/", mp_obj_str_get_str(host));
+    if (port != (ssl ? 443 : 80)) {
+        vstr_printf(&req, ":%u", (unsigned)port);
+    }
+    vstr_add_str(&req, "\r\n");
+    if (args[ARG_headers].u_obj != mp_const_none) {
+        mp_map_t *map = mp_obj_dict_get_map(args[ARG_headers].u_obj);
+        for (size_t i = 0; i < map->alloc; i++) {
+            if (mp_map_slot_is_filled(map, i)) {
+                vstr_printf(&req, "%s: %s\r\n", mp_obj_str_get_str(map->table[i].key),
+                    mp_obj_str_get_str(map->table[i].value));
+            }
+        }
+    }
+    if (args[ARG_json].u_obj != mp_const_none) {
+        vstr_add_str(&req, "Content-Type: application/json\r\n");
+    }
+    if (data != mp_const_none) {
+        vstr_printf(&req, "Content-Length: %u\r\n", (unsigned)body.len);
+    }
+    vstr_add_str(&req, "\r\n");
+
+    uhttpc_response_obj_t *resp = m_new_obj(uhttpc_response_obj_t);
+    memset(resp, 0, sizeof(*resp));
+    resp->base.type = &uhttpc_response_type;
+    resp->session = self;
+    resp->content = MP_OBJ_NULL;
+
+    vstr_t line;
+    vstr_init(&line, 64);
+    for (;;) {
+        // a pooled connection may have been closed by the server while idle,
+        // in which case the request is sent again on a new one
+        uhttpc_conn_t *conn = pool_take(self, host, port, ssl);
+        bool reused = conn != NULL;
+        if (!reused) {
+            conn = conn_open(self, host, port, ssl);
+        }
+        mp_obj_t exc = conn_send_request(conn, &req, &body, &line);
+        if (exc == MP_OBJ_NULL) {
+            resp->conn = conn;
+            break;
+        }
+        conn_close(conn);
+        if (!reused || !mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(mp_obj_get_type(exc)), MP_OBJ_FROM_PTR(&mp_type_OSError))) {
+            nlr_raise(exc);
+        }
+    }
+    vstr_clear(&req);
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        response_read_head(resp, method, &line);
+        nlr_pop();
+    } else {
+        response_finish(resp, false);
+        nlr_jump(nlr.ret_val);
+    }
+    vstr_clear(&line);
+    return MP_OBJ_FROM_PTR(resp);
+}
+
+STATIC mp_obj_t session_request(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    uhttpc_session_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    return session_do_request(self, mp_obj_str_get_str(pos_args[1]), n_args - 2, pos_args + 2, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(session_request_obj, 3, session_request);
+
+#define SESSION_METHOD(name, method) \
+    STATIC mp_obj_t session_##name(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) { \
+        uhttpc_session_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]); \
+        return session_do_request(self, method, n_args - 1, pos_args + 1, kw_args); \
+    } \
+    STATIC MP_DEFINE_CONST_FUN_OBJ_KW(session_##name##_obj, 2, session_##name);
+
+SESSION_METHOD(get, "GET")
+SESSION_METHOD(head, "HEAD")
+SESSION_METHOD(post, "POST")
+SESSION_METHOD(put, "PUT")
+SESSION_METHOD(patch, "PATCH")
+SESSION_METHOD(delete, "DELETE")
+
+// Close the idle connections; responses still being read are unaffected
+STATIC mp_obj_t session_close(mp_obj_t self_in) {
+    uhttpc_session_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    for (size_t i = 0; i < self->pool_size; i++) {
+        uhttpc_conn_t *conn = self->pool[i];
+        if (conn != NULL) {
+            self->pool[i] = NULL;
+            conn_close(conn);
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(session_close_obj, session_close);
+
+STATIC mp_obj_t session___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return session_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(session___exit___obj, 4, 4, session___exit__);
+
+STATIC const mp_rom_map_elem_t session_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_request), MP_ROM_PTR(&session_request_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&session_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_head), MP_ROM_PTR(&session_head_obj) },
+    { MP_ROM_QSTR(MP_QSTR_post), MP_ROM_PTR(&session_post_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put), MP_ROM_PTR(&session_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_patch), MP_ROM_PTR(&session_patch_obj) },
+    { MP_ROM_QSTR(MP_QSTR_delete), MP_ROM_PTR(&session_delete_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&session_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&session___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(session_locals_dict, session_locals_dict_table);
+
+STATIC const mp_obj_type_t uhttpc_session_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Session,
+    .make_new = session_make_new,
+    .locals_dict = (mp_obj_dict_t*)&session_locals_dict,
+};
+
+/******************************************************************************/
+// Module
+
+// The module-level functions share one session, created on first use
+STATIC uhttpc_session_obj_t *default_session(void) {
+    if (MP_STATE_VM(uhttpc_session) == MP_OBJ_NULL) {
+        MP_STATE_VM(uhttpc_session) = session_make_new(&uhttpc_session_type, 0, 0, NULL);
+    }
+    return MP_OBJ_TO_PTR(MP_STATE_VM(uhttpc_session));
+}
+
+STATIC mp_obj_t mod_uhttpc_request(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    return session_do_request(default_session(), mp_obj_str_get_str(pos_args[0]), n_args - 1, pos_args + 1, kw_args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_uhttpc_request_obj, 2, mod_uhttpc_request);
+
+#define MODULE_METHOD(name, method) \
+    STATIC mp_obj_t mod_uhttpc_##name(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) { \
+        return session_do_request(default_session(), method, n_args, pos_args, kw_args); \
+    } \
+    STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_uhttpc_##name##_obj, 1, mod_uhttpc_##name);
+
+MODULE_METHOD(get, "GET")
+MODULE_METHOD(head, "HEAD")
+MODULE_METHOD(post, "POST")
+MODULE_METHOD(put, "PUT")
+MODULE_METHOD(patch, "PATCH")
+MODULE_METHOD(delete, "DELETE")
+
+STATIC const mp_rom_map_elem_t mp_module_uhttpc_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uhttpc) },
+    { MP_ROM_QSTR(MP_QSTR_Session), MP_ROM_PTR(&uhttpc_session_type) },
+    { MP_ROM_QSTR(MP_QSTR_request), MP_ROM_PTR(&mod_uhttpc_request_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&mod_uhttpc_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_head), MP_ROM_PTR(&mod_uhttpc_head_obj) },
+    { MP_ROM_QSTR(MP_QSTR_post), MP_ROM_PTR(&mod_uhttpc_post_obj) },
+    { MP_ROM_QSTR(MP_QSTR_put), MP_ROM_PTR(&mod_uhttpc_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_patch), MP_ROM_PTR(&mod_uhttpc_patch_obj) },
+    { MP_ROM_QSTR(MP_QSTR_delete), MP_ROM_PTR(&mod_uhttpc_delete_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(mp_module_uhttpc_globals, mp_module_uhttpc_globals_table);
+
+const mp_obj_module_t mp_module_uhttpc = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&mp_module_uhttpc_globals,
+};
+
+#endif // MICROPY_PY_UHTTPC
@@ -25,32 +25,95 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/objlist.h"
-#include "py/objstringio.h"
 #include "py/parsenum.h"
 #include "py/runtime.h"
 #include "py/stream.h"
 
 #if MICROPY_PY_UJSON
 
+// The JSON output is printed into a buffer which, when full, is flushed to the
+// stream or vstr given, so that each small token isn't written separately.  If
+// neither are given the buffer is the caller's and output must fit in it.
+
+typedef struct _ujson_dump_out_t {
+    mp_obj_t stream;
+    vstr_t *vstr;
+    byte *buf;
+    size_t len;
+    size_t alloc;
+} ujson_dump_out_t;
+
+STATIC void ujson_dump_out_flush(ujson_dump_out_t *out, const char *str, size_t len) {
+    if (out->stream != MP_OBJ_NULL) {
+        mp_stream_write(out->stream, str, len, MP_STREAM_RW_WRITE);
+    } else if (out->vstr != NULL) {
+        vstr_add_strn(out->vstr, str, len);
+    } else {
+        mp_raise_ValueError("buffer too small");
+    }
+}
+
+STATIC void ujson_dump_out_strn(void *data, const char *str, size_t len) {
+    ujson_dump_out_t *out = data;
+    if (out->len + len > out->alloc) {
+        ujson_dump_out_flush(out, (const char*)out->buf, out->len);
+        out->len = 0;
+        if (len > out->alloc) {
+            ujson_dump_out_flush(out, str, len);
+            return;
+        }
+    }
+    memcpy(out->buf + out->len, str, len);
+    out->len += len;
+}
+
+STATIC void ujson_dump_helper(ujson_dump_out_t *out, mp_obj_t obj) {
+    mp_print_t print = {out, ujson_dump_out_strn};
+    mp_obj_print_helper(&print, obj, PRINT_JSON);
+}
+
 STATIC mp_obj_t mod_ujson_dump(mp_obj_t obj, mp_obj_t stream) {
     mp_get_stream_raise(stream, MP_STREAM_OP_WRITE);
-    mp_print_t print = {MP_OBJ_TO_PTR(stream), mp_stream_write_adaptor};
-    mp_obj_print_helper(&print, obj, PRINT_JSON);
+    byte buf[MICROPY_PY_UJSON_STREAM_BUF_SIZE];
+    ujson_dump_out_t out = {stream, NULL, buf, 0, sizeof(buf)};
+    ujson_dump_helper(&out, obj);
+    if (out.len != 0) {
+        mp_stream_write(stream, buf, out.len, MP_STREAM_RW_WRITE);
+    }
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ujson_dump_obj, mod_ujson_dump);
 
 STATIC mp_obj_t mod_ujson_dumps(mp_obj_t obj) {
     vstr_t vstr;
-    mp_print_t print;
-    vstr_init_print(&vstr, 8, &print);
-    mp_obj_print_helper(&print, obj, PRINT_JSON);
+    vstr_init(&vstr, 0);
+    byte buf[MICROPY_PY_UJSON_STREAM_BUF_SIZE];
+    ujson_dump_out_t out = {MP_OBJ_NULL, &vstr, buf, 0, sizeof(buf)};
+    ujson_dump_helper(&out, obj);
+    if (vstr.len == 0) {
+        // the output fits in buf, so make the str with a single allocation
+        vstr_clear(&vstr);
+        return mp_obj_new_str((const char*)buf, out.len);
+    }
+    vstr_add_strn(&vstr, (const char*)buf, out.len);
     return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_dumps_obj, mod_ujson_dumps);
 
+// Write the JSON encoding of obj into the writable buffer buf, without any
+// heap allocation, and return the number of bytes written.
+STATIC mp_obj_t mod_ujson_dump_into(mp_obj_t obj, mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    ujson_dump_out_t out = {MP_OBJ_NULL, NULL, bufinfo.buf, 0, bufinfo.len};
+    ujson_dump_helper(&out, obj);
+    return MP_OBJ_NEW_SMALL_INT(out.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ujson_dump_into_obj, mod_ujson_dump_into);
+
 // The function below implements a simple non-recursive JSON parser.
 //
 // The JSON specification is at http://www.ietf.org/rfc/rfc4627.txt
@@ -69,27 +132,144 @@ typedef struct _ujson_stream_t {
     mp_uint_t (*read)(mp_obj_t obj, void *buf, mp_uint_t size, int *errcode);
     int errcode;
     byte cur;
+    // the stream is read in chunks of MICROPY_PY_UJSON_STREAM_BUF_SIZE bytes
+    // into read_buf; if read is NULL then all the input is already in buf
+    const byte *buf;
+    size_t buf_pos;
+    size_t buf_len;
+    byte *read_buf;
 } ujson_stream_t;
 
 #define S_EOF (0) // null is not allowed in json stream so is ok as EOF marker
 #define S_END(s) ((s).cur == S_EOF)
 #define S_CUR(s) ((s).cur)
-#define S_NEXT(s) (ujson_stream_next(&(s)))
+#define S_NEXT(s) ((s).buf_pos < (s).buf_len ? ((s).cur = (s).buf[(s).buf_pos++]) : ujson_stream_next(&(s)))
 
 STATIC byte ujson_stream_next(ujson_stream_t *s) {
-    mp_uint_t ret = s->read(s->stream_obj, &s->cur, 1, &s->errcode);
-    if (s->errcode != 0) {
-        mp_raise_OSError(s->errcode);
+    s->buf_pos = 0;
+    s->buf_len = 0;
+    if (s->read != NULL) {
+        mp_uint_t ret = s->read(s->stream_obj, s->read_buf, MICROPY_PY_UJSON_STREAM_BUF_SIZE, &s->errcode);
+        if (ret == MP_STREAM_ERROR) {
+            mp_raise_OSError(s->errcode);
+        }
+        s->buf = s->read_buf;
+        s->buf_len = ret;
     }
-    if (ret == 0) {
+    if (s->buf_len == 0) {
         s->cur = S_EOF;
+        return S_EOF;
     }
+    s->cur = s->buf[s->buf_pos++];
     return s->cur;
 }
 
-STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
-    const mp_stream_p_t *stream_p = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ);
-    ujson_stream_t s = {stream_obj, stream_p->read, 0, 0};
+STATIC void ujson_stream_init(ujson_stream_t *s, mp_obj_t stream_obj, byte *read_buf) {
+    s->stream_obj = stream_obj;
+    s->errcode = 0;
+    s->cur = 0;
+    s->buf_pos = 0;
+    s->buf_len = 0;
+    s->read_buf = read_buf;
+    if (read_buf == NULL) {
+        // parse directly from the str/bytes object
+        s->read = NULL;
+        s->buf = (const byte*)mp_obj_str_get_data(stream_obj, &s->buf_len);
+    } else {
+        s->read = mp_get_stream_raise(stream_obj, MP_STREAM_OP_READ)->read;
+    }
+}
+
+// Parse the primitive (null, false, true, number or string) that starts with
+// cur, which has already been consumed.  Returns MP_OBJ_NULL if there isn't a
+// valid one.
+STATIC mp_obj_t ujson_parse_primitive(ujson_stream_t *s, vstr_t *vstr, byte cur, bool intern) {
+    switch (cur) {
+        case 'n':
+            if (S_CUR(*s) == 'u' && S_NEXT(*s) == 'l' && S_NEXT(*s) == 'l') {
+                S_NEXT(*s);
+                return mp_const_none;
+            }
+            break;
+        case 'f':
+            if (S_CUR(*s) == 'a' && S_NEXT(*s) == 'l' && S_NEXT(*s) == 's' && S_NEXT(*s) == 'e') {
+                S_NEXT(*s);
+                return mp_const_false;
+            }
+            break;
+        case 't':
+            if (S_CUR(*s) == 'r' && S_NEXT(*s) == 'u' && S_NEXT(*s) == 'e') {
+                S_NEXT(*s);
+                return mp_const_true;
+            }
+            break;
+        case '"':
+            vstr_reset(vstr);
+            for (; !S_END(*s) && S_CUR(*s) != '"';) {
+                byte c = S_CUR(*s);
+                if (c == '\\') {
+                    c = S_NEXT(*s);
+                    switch (c) {
+                        case 'b': c = 0x08; break;
+                        case 'f': c = 0x0c; break;
+                        case 'n': c = 0x0a; break;
+                        case 'r': c = 0x0d; break;
+                        case 't': c = 0x09; break;
+                        case 'u': {
+                            mp_uint_t num = 0;
+                            for (int i = 0; i < 4; i++) {
+                                c = (S_NEXT(*s) | 0x20) - '0';
+                                if (c > 9) {
+                                    c -= ('a' - ('9' + 1));
+                                }
+                                num = (num << 4) | c;
+                            }
+                            vstr_add_char(vstr, num);
+                            goto str_cont;
+                        }
+                    }
+                }
+                vstr_add_byte(vstr, c);
+            str_cont:
+                S_NEXT(*s);
+            }
+            if (S_END(*s)) {
+                break;
+            }
+            S_NEXT(*s);
+            if (intern) {
+                // make it a qstr so that equal strings (eg dict keys) share it
+                return mp_obj_new_str_via_qstr(vstr->buf, vstr->len);
+            }
+            return mp_obj_new_str(vstr->buf, vstr->len);
+        case '-':
+        case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': {
+            bool flt = false;
+            vstr_reset(vstr);
+            for (;;) {
+                vstr_add_byte(vstr, cur);
+                cur = S_CUR(*s);
+                if (cur == '.' || cur == 'E' || cur == 'e') {
+                    flt = true;
+                } else if (cur == '-' || unichar_isdigit(cur)) {
+                    // pass
+                } else {
+                    break;
+                }
+                S_NEXT(*s);
+            }
+            if (flt) {
+                return mp_parse_num_decimal(vstr->buf, vstr->len, false, false, NULL);
+            }
+            return mp_parse_num_integer(vstr->buf, vstr->len, 10, NULL);
+        }
+    }
+    return MP_OBJ_NULL;
+}
+
+STATIC mp_obj_t ujson_load(mp_obj_t stream_obj, bool intern_keys, byte *read_buf) {
+    ujson_stream_t s;
+    ujson_stream_init(&s, stream_obj, read_buf);
     vstr_t vstr;
     vstr_init(&vstr, 8);
     mp_obj_list_t stack; // we use a list as a simple stack for nested JSON
@@ -116,89 +296,6 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
             case '\n':
             case '\r':
                 goto cont;
-            case 'n':
-                if (S_CUR(s) == 'u' && S_NEXT(s) == 'l' && S_NEXT(s) == 'l') {
-                    S_NEXT(s);
-                    next = mp_const_none;
-                } else {
-                    goto fail;
-                }
-                break;
-            case 'f':
-                if (S_CUR(s) == 'a' && S_NEXT(s) == 'l' && S_NEXT(s) == 's' && S_NEXT(s) == 'e') {
-                    S_NEXT(s);
-                    next = mp_const_false;
-                } else {
-                    goto fail;
-                }
-                break;
-            case 't':
-                if (S_CUR(s) == 'r' && S_NEXT(s) == 'u' && S_NEXT(s) == 'e') {
-                    S_NEXT(s);
-                    next = mp_const_true;
-                } else {
-                    goto fail;
-                }
-                break;
-            case '"':
-                vstr_reset(&vstr);
-                for (; !S_END(s) && S_CUR(s) != '"';) {
-                    byte c = S_CUR(s);
-                    if (c == '\\') {
-                        c = S_NEXT(s);
-                        switch (c) {
-                            case 'b': c = 0x08; break;
-                            case 'f': c = 0x0c; break;
-                            case 'n': c = 0x0a; break;
-                            case 'r': c = 0x0d; break;
-                            case 't': c = 0x09; break;
-                            case 'u': {
-                                mp_uint_t num = 0;
-                                for (int i = 0; i < 4; i++) {
-                                    c = (S_NEXT(s) | 0x20) - '0';
-                                    if (c > 9) {
-                                        c -= ('a' - ('9' + 1));
-                                    }
-                                    num = (num << 4) | c;
-                                }
-                                vstr_add_char(&vstr, num);
-                                goto str_cont;
-                            }
-                        }
-                    }
-                    vstr_add_byte(&vstr, c);
-                str_cont:
-                    S_NEXT(s);
-                }
-                if (S_END(s)) {
-                    goto fail;
-                }
-                S_NEXT(s);
-                next = mp_obj_new_str(vstr.buf, vstr.len);
-                break;
-            case '-':
-            case '0': case '1': case '2': case '3': case '4': case '5': case '6': case '7': case '8': case '9': {
-                bool flt = false;
-                vstr_reset(&vstr);
-                for (;;) {
-                    vstr_add_byte(&vstr, cur);
-                    cur = S_CUR(s);
-                    if (cur == '.' || cur == 'E' || cur == 'e') {
-                        flt = true;
-                    } else if (cur == '-' || unichar_isdigit(cur)) {
-                        // pass
-                    } else {
-                        break;
-                    }
-                    S_NEXT(s);
-                }
-                if (flt) {
-                    next = mp_parse_num_decimal(vstr.buf, vstr.len, false, false, NULL);
-                } else {
-                    next = mp_parse_num_integer(vstr.buf, vstr.len, 10, NULL);
-                }
-                break;
-            }
             case '[':
                 next = mp_obj_new_list(0, NULL);
                 enter = true;
@@ -223,7 +320,12 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
                 goto cont;
             }
             default:
-                goto fail;
+                next = ujson_parse_primitive(&s, &vstr, cur,
+                    intern_keys && stack_top_type == &mp_type_dict && stack_key == MP_OBJ_NULL);
+                if (next == MP_OBJ_NULL) {
+                    goto fail;
+                }
+                break;
         }
         if (stack_top == MP_OBJ_NULL) {
             stack_top = next;
@@ -278,23 +380,174 @@ STATIC mp_obj_t mod_ujson_load(mp_obj_t stream_obj) {
     fail:
     mp_raise_ValueError("syntax error in JSON");
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_load_obj, mod_ujson_load);
 
-STATIC mp_obj_t mod_ujson_loads(mp_obj_t obj) {
-    size_t len;
-    const char *buf = mp_obj_str_get_data(obj, &len);
-    vstr_t vstr = {len, len, (char*)buf, true};
-    mp_obj_stringio_t sio = {{&mp_type_stringio}, &vstr, 0, MP_OBJ_NULL};
-    return mod_ujson_load(MP_OBJ_FROM_PTR(&sio));
+STATIC const mp_arg_t ujson_load_allowed_args[] = {
+    { MP_QSTR_intern_keys, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+};
+
+STATIC mp_obj_t mod_ujson_load(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(ujson_load_allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(ujson_load_allowed_args), ujson_load_allowed_args, args);
+    byte read_buf[MICROPY_PY_UJSON_STREAM_BUF_SIZE];
+    return ujson_load(pos_args[0], args[0].u_bool, read_buf);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_ujson_load_obj, 1, mod_ujson_load);
+
+STATIC mp_obj_t mod_ujson_loads(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_arg_val_t args[MP_ARRAY_SIZE(ujson_load_allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(ujson_load_allowed_args), ujson_load_allowed_args, args);
+    return ujson_load(pos_args[0], args[0].u_bool, NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_ujson_loads_obj, 1, mod_ujson_loads);
+
+#if MICROPY_PY_UJSON_ITERLOAD
+// iterload parses the stream incrementally, yielding a (path, value) pair for
+// each primitive value and each empty list or dict, where path is a tuple of
+// the dict keys and list indices that lead to the value.  No list or dict in
+// the document is built, so memory use depends only on the nesting depth.
+
+typedef struct _ujson_iterload_t {
+    mp_obj_base_t base;
+    ujson_stream_t s;
+    vstr_t vstr;
+    // one entry per enclosing list or dict: for a list it is the index of the
+    // current item; for a dict it is the current key, or None if waiting for
+    // a key, or False if waiting for the first key
+    mp_obj_t path;
+    bool done;
+    byte read_buf[MICROPY_PY_UJSON_STREAM_BUF_SIZE];
+} ujson_iterload_t;
+
+STATIC mp_obj_t ujson_iterload_iternext(mp_obj_t self_in) {
+    ujson_iterload_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_list_t *path = MP_OBJ_TO_PTR(self->path);
+    if (self->done) {
+    finished:
+        // eat trailing whitespace
+        while (unichar_isspace(S_CUR(self->s))) {
+            S_NEXT(self->s);
+        }
+        if (!S_END(self->s)) {
+            // unexpected chars
+            goto fail;
+        }
+        return MP_OBJ_STOP_ITERATION;
+    }
+    for (;;) {
+        if (S_END(self->s)) {
+            goto fail;
+        }
+        mp_obj_t top = path->len == 0 ? MP_OBJ_NULL : path->items[path->len - 1];
+        bool want_key = top == mp_const_none || top == mp_const_false;
+        mp_obj_t value;
+        byte cur = S_CUR(self->s);
+        S_NEXT(self->s);
+        switch (cur) {
+            case ',':
+            case ':':
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                continue;
+            case '[':
+            case '{':
+                if (want_key) {
+                    goto fail;
+                }
+                mp_obj_list_append(self->path, cur == '[' ? MP_OBJ_NEW_SMALL_INT(0) : mp_const_false);
+                continue;
+            case ']':
+            case '}':
+                if (top == MP_OBJ_NULL || mp_obj_is_str(top)) {
+                    // not in a list or dict, or a key without a value
+                    goto fail;
+                }
+                path->len -= 1;
+                if (top == MP_OBJ_NEW_SMALL_INT(0)) {
+                    value = mp_obj_new_list(0, NULL);
+                } else if (top == mp_const_false) {
+                    value = mp_obj_new_dict(0);
+                } else {
+                    // a non-empty list or dict, its items have been yielded
+                    value = MP_OBJ_NULL;
+                }
+                break;
+            default:
+                value = ujson_parse_primitive(&self->s, &self->vstr, cur, want_key);
+                if (value == MP_OBJ_NULL) {
+                    goto fail;
+                }
+                if (want_key) {
+                    if (!mp_obj_is_str(value)) {
+                        goto fail;
+                    }
+                    path->items[path->len - 1] = value;
+                    continue;
+                }
+                break;
+        }
+
+        mp_obj_t event = MP_OBJ_NULL;
+        if (value != MP_OBJ_NULL) {
+            mp_obj_t items[2] = {mp_obj_new_tuple(path->len, path->items), value};
+            event = mp_obj_new_tuple(2, items);
+        }
+
+        // move on to the next item of the enclosing list or dict
+        if (path->len == 0) {
+            self->done = true;
+        } else {
+            top = path->items[path->len - 1];
+            if (mp_obj_is_small_int(top)) {
+                path->items[path->len - 1] = MP_OBJ_NEW_SMALL_INT(MP_OBJ_SMALL_INT_VALUE(top) + 1);
+            } else {
+                path->items[path->len - 1] = mp_const_none;
+            }
+        }
+
+        if (event != MP_OBJ_NULL) {
+            return event;
+        }
+        if (self->done) {
+            goto finished;
+        }
+    }
+
+fail:
+    mp_raise_ValueError("syntax error in JSON");
+}
+
+STATIC const mp_obj_type_t ujson_iterload_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity_getiter,
+    .iternext = ujson_iterload_iternext,
+};
+
+STATIC mp_obj_t mod_ujson_iterload(mp_obj_t stream_obj) {
+    ujson_iterload_t *self = m_new_obj(ujson_iterload_t);
+    self->base.type = &ujson_iterload_type;
+    ujson_stream_init(&self->s, stream_obj, self->read_buf);
+    vstr_init(&self->vstr, 8);
+    self->path = mp_obj_new_list(0, NULL);
+    self->done = false;
+    S_NEXT(self->s);
+    return MP_OBJ_FROM_PTR(self);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_loads_obj, mod_ujson_loads);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ujson_iterload_obj, mod_ujson_iterload);
+#endif
 
 STATIC const mp_rom_map_elem_t mp_module_ujson_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ujson) },
     { MP_ROM_QSTR(MP_QSTR_dump), MP_ROM_PTR(&mod_ujson_dump_obj) },
     { MP_ROM_QSTR(MP_QSTR_dumps), MP_ROM_PTR(&mod_ujson_dumps_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dump_into), MP_ROM_PTR(&mod_ujson_dump_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&mod_ujson_load_obj) },
     { MP_ROM_QSTR(MP_QSTR_loads), MP_ROM_PTR(&mod_ujson_loads_obj) },
+    #if MICROPY_PY_UJSON_ITERLOAD
+    { MP_ROM_QSTR(MP_QSTR_iterload), MP_ROM_PTR(&mod_ujson_iterload_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_ujson_globals, mp_module_ujson_globals_table);
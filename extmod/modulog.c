@@ -0,0 +1,533 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/builtin.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+
+#if MICROPY_PY_ULOG
+
+#ifndef mp_hal_crc32
+#include "uzlib/tinf.h"
+#endif
+
+// Binary data logger writing fixed-size records into a ring of blocks in a
+// file (or any seekable stream), see tools/ulog.py for reading it on a host.
+//
+// The file starts with a superblock giving the layout: the block size, the
+// number of blocks in the ring and the ustruct format of the records.  It is
+// followed by the ring, where the block with sequence number seq goes in
+// slot seq % blocks.  Each block has a header with the sequence number, the
+// number of records in it and a CRC32 of the header and those records, so
+// after a power failure the blocks are recovered by their CRC and ordered
+// by their sequence number.
+//
+// Records are packed into RAM staging blocks and the file is only ever
+// written in whole blocks: a block is written once it is full, or, with
+// whatever records it has so far, by flush().  A partial block is written
+// again in the same slot when it has more records.
+
+#define ULOG_VERSION (1)
+#define ULOG_SUPER_HDR_SIZE (20)
+#define ULOG_HDR_SIZE (16)
+
+// the superblock is: "ULOG", version, 0, block size (16 bits), blocks (32),
+// record size (16), format length (16), CRC32 of the others and the format,
+// then the format
+//
+// a block header is: "UL", record size (16 bits), seq (32), count (16), 0
+// (16), CRC32 of the first 12 bytes and the records; all little endian
+
+typedef struct _ulog_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t stream;
+    mp_obj_t rec;           // the ustruct.Struct of a record
+    size_t n_items;         // values in a record
+    uint32_t n_blocks;      // blocks in the ring
+    uint16_t block_size;
+    uint16_t rec_size;
+    uint16_t per_block;     // records that fit in a block
+    uint16_t n_stage;       // staging blocks
+    uint16_t cur;           // staging block being filled
+    uint16_t count;         // records in it
+    uint16_t synced;        // records of staging block 0 already written
+    uint32_t seq;           // sequence number of the first staging block
+    byte *stage;            // n_stage blocks
+} ulog_obj_t;
+
+typedef struct _ulog_iter_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    ulog_obj_t *log;
+    uint32_t seq;           // of the block being read
+    uint16_t idx;           // next record in it
+    uint16_t count;         // records in it, 0 if it has to be loaded
+    const byte *block;
+    byte *buf;              // for blocks read from the stream
+} ulog_iter_t;
+
+STATIC void put_u16(byte *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+STATIC void put_u32(byte *p, uint32_t v) {
+    put_u16(p, v);
+    put_u16(p + 2, v >> 16);
+}
+
+STATIC uint32_t get_u16(const byte *p) {
+    return p[0] | p[1] << 8;
+}
+
+STATIC uint32_t get_u32(const byte *p) {
+    return get_u16(p) | get_u16(p + 2) << 16;
+}
+
+STATIC uint32_t ulog_crc32(uint32_t crc, const byte *buf, size_t len) {
+    #ifdef mp_hal_crc32
+    return mp_hal_crc32(crc, buf, len);
+    #else
+    return uzlib_crc32(buf, len, crc ^ 0xffffffff) ^ 0xffffffff;
+    #endif
+}
+
+/******************************************************************************/
+// stream access
+
+STATIC void ulog_seek(ulog_obj_t *self, uint32_t block) {
+    const mp_stream_p_t *stream_p = mp_get_stream(self->stream);
+    struct mp_stream_seek_t seek_s;
+    seek_s.offset = (mp_off_t)block * self->block_size;
+    seek_s.whence = MP_SEEK_SET;
+    int errcode;
+    if (stream_p->ioctl(self->stream, MP_STREAM_SEEK, (uintptr_t)&seek_s, &errcode) == MP_STREAM_ERROR) {
+        mp_raise_OSError(errcode);
+    }
+}
+
+// Write n whole blocks from buf at block number block of the file
+STATIC void ulog_write(ulog_obj_t *self, uint32_t block, const byte *buf, size_t n) {
+    ulog_seek(self, block);
+    int errcode;
+    size_t len = n * self->block_size;
+    if (mp_stream_rw(self->stream, (void*)buf, len, &errcode, MP_STREAM_RW_WRITE) != len) {
+        mp_raise_OSError(errcode != 0 ? errcode : MP_EIO);
+    }
+}
+
+// Read the block at block number block of the file, returning false if it
+// is past the end
+STATIC bool ulog_read(ulog_obj_t *self, uint32_t block, byte *buf) {
+    ulog_seek(self, block);
+    int errcode;
+    size_t got = mp_stream_rw(self->stream, buf, self->block_size, &errcode, MP_STREAM_RW_READ);
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    return got == self->block_size;
+}
+
+/******************************************************************************/
+// blocks
+
+STATIC byte *ulog_stage(ulog_obj_t *self, size_t i) {
+    return self->stage + i * self->block_size;
+}
+
+// Fill in the header of a block of count records
+STATIC void ulog_seal(ulog_obj_t *self, byte *block, uint32_t seq, size_t count) {
+    block[0] = 'U';
+    block[1] = 'L';
+    put_u16(block + 2, self->rec_size);
+    put_u32(block + 4, seq);
+    put_u16(block + 8, count);
+    put_u16(block + 10, 0);
+    uint32_t crc = ulog_crc32(0, block, 12);
+    crc = ulog_crc32(crc, block + ULOG_HDR_SIZE, count * self->rec_size);
+    put_u32(block + 12, crc);
+}
+
+// The number of records in block if it is a valid block of this log, else -1
+STATIC int ulog_check(ulog_obj_t *self, const byte *block) {
+    if (block[0] != 'U' || block[1] != 'L' || get_u16(block + 2) != self->rec_size) {
+        return -1;
+    }
+    size_t count = get_u16(block + 8);
+    if (count > self->per_block) {
+        return -1;
+    }
+    uint32_t crc = ulog_crc32(0, block, 12);
+    crc = ulog_crc32(crc, block + ULOG_HDR_SIZE, count * self->rec_size);
+    if (crc != get_u32(block + 12)) {
+        return -1;
+    }
+    return count;
+}
+
+// Write staging blocks 0 to n - 1 to their slots in the ring, in at most two
+// writes
+STATIC void ulog_write_stage(ulog_obj_t *self, size_t n) {
+    size_t slot = self->seq % self->n_blocks;
+    size_t n1 = MIN(n, self->n_blocks - slot);
+    ulog_write(self, 1 + slot, self->stage, n1);
+    if (n1 < n) {
+        ulog_write(self, 1, ulog_stage(self, n1), n - n1);
+    }
+}
+
+// Write out the staging blocks, including the current one if it has any
+// records; the current block stays staged to be filled further
+STATIC void ulog_sync(ulog_obj_t *self) {
+    size_t n = self->cur;
+    if (self->count > 0) {
+        ulog_seal(self, ulog_stage(self, n), self->seq + n, self->count);
+        n++;
+    }
+    if (n == 0) {
+        return;
+    }
+    ulog_write_stage(self, n);
+    if (self->cur > 0) {
+        memmove(self->stage, ulog_stage(self, self->cur), self->block_size);
+        self->seq += self->cur;
+        self->cur = 0;
+    }
+    self->synced = self->count;
+}
+
+// Make a new log: the superblock and an empty ring
+STATIC void ulog_format(ulog_obj_t *self, const char *fmt, size_t fmt_len) {
+    byte *buf = self->stage;
+    memset(buf, 0, self->block_size);
+    memcpy(buf, "ULOG", 4);
+    buf[4] = ULOG_VERSION;
+    put_u16(buf + 6, self->block_size);
+    put_u32(buf + 8, self->n_blocks);
+    put_u16(buf + 12, self->rec_size);
+    put_u16(buf + 14, fmt_len);
+    memcpy(buf + ULOG_SUPER_HDR_SIZE, fmt, fmt_len);
+    uint32_t crc = ulog_crc32(0, buf, 16);
+    put_u32(buf + 16, ulog_crc32(crc, buf + ULOG_SUPER_HDR_SIZE, fmt_len));
+    ulog_write(self, 0, buf, 1);
+    memset(buf, 0, self->block_size);
+    for (size_t i = 0; i < self->n_blocks; i++) {
+        ulog_write(self, 1 + i, buf, 1);
+    }
+}
+
+// Check the superblock in buf: returns false if it isn't one, raises if it
+// is for a different layout
+STATIC bool ulog_check_super(ulog_obj_t *self, const byte *buf, const char *fmt, size_t fmt_len) {
+    if (memcmp(buf, "ULOG", 4) != 0 || buf[4] != ULOG_VERSION) {
+        return false;
+    }
+    size_t len = get_u16(buf + 14);
+    if (len > (size_t)self->block_size - ULOG_SUPER_HDR_SIZE) {
+        return false;
+    }
+    uint32_t crc = ulog_crc32(0, buf, 16);
+    if (ulog_crc32(crc, buf + ULOG_SUPER_HDR_SIZE, len) != get_u32(buf + 16)) {
+        return false;
+    }
+    if (get_u16(buf + 6) != self->block_size || get_u32(buf + 8) != self->n_blocks
+        || len != fmt_len || memcmp(buf + ULOG_SUPER_HDR_SIZE, fmt, fmt_len) != 0) {
+        mp_raise_ValueError("log has a different layout");
+    }
+    return true;
+}
+
+// Find the newest valid block and carry on after it, or in it if it has room
+STATIC void ulog_recover(ulog_obj_t *self) {
+    byte *buf = self->stage;
+    bool found = false;
+    uint32_t newest = 0;
+    size_t newest_count = 0;
+    for (size_t slot = 0; slot < self->n_blocks; slot++) {
+        if (!ulog_read(self, 1 + slot, buf)) {
+            break;
+        }
+        int count = ulog_check(self, buf);
+        uint32_t seq = get_u32(buf + 4);
+        if (count >= 0 && seq % self->n_blocks == slot && (!found || seq > newest)) {
+            found = true;
+            newest = seq;
+            newest_count = count;
+        }
+    }
+    self->cur = 0;
+    self->count = 0;
+    self->synced = 0;
+    if (!found) {
+        self->seq = 0;
+    } else if (newest_count < self->per_block) {
+        // append to the partial block
+        ulog_read(self, 1 + newest % self->n_blocks, buf);
+        self->seq = newest;
+        self->count = newest_count;
+        self->synced = newest_count;
+    } else {
+        self->seq = newest + 1;
+    }
+}
+
+/******************************************************************************/
+// Log
+
+// Log(stream, format, blocks, *, block_size=512, buffer=1)
+STATIC mp_obj_t ulog_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_stream, ARG_format, ARG_blocks, ARG_block_size, ARG_buffer };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_stream, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_format, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_blocks, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_block_size, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 512} },
+        { MP_QSTR_buffer, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_get_stream_raise(args[ARG_stream].u_obj, MP_STREAM_OP_READ | MP_STREAM_OP_WRITE | MP_STREAM_OP_IOCTL);
+    mp_obj_t rec = mp_struct_get(args[ARG_format].u_obj);
+    size_t fmt_len;
+    const char *fmt = mp_obj_str_get_data(mp_struct_format(rec), &fmt_len);
+    size_t n_items;
+    size_t rec_size = mp_struct_size(rec, &n_items);
+    mp_int_t block_size = args[ARG_block_size].u_int;
+    if (block_size < 64 || block_size > 0xffff || rec_size == 0
+        || rec_size > (size_t)block_size - ULOG_HDR_SIZE
+        || fmt_len > (size_t)block_size - ULOG_SUPER_HDR_SIZE
+        || args[ARG_blocks].u_int < 2 || args[ARG_buffer].u_int < 1
+        || args[ARG_buffer].u_int >= args[ARG_blocks].u_int) {
+        mp_raise_ValueError(NULL);
+    }
+
+    ulog_obj_t *self = m_new_obj(ulog_obj_t);
+    self->base.type = type;
+    self->stream = args[ARG_stream].u_obj;
+    self->rec = rec;
+    self->n_items = n_items;
+    self->n_blocks = args[ARG_blocks].u_int;
+    self->block_size = block_size;
+    self->rec_size = rec_size;
+    self->per_block = MIN((block_size - ULOG_HDR_SIZE) / rec_size, 0xffff);
+    self->n_stage = args[ARG_buffer].u_int;
+    self->stage = m_new(byte, self->n_stage * block_size);
+
+    bool valid = ulog_read(self, 0, self->stage) && ulog_check_super(self, self->stage, fmt, fmt_len);
+    if (valid) {
+        ulog_recover(self);
+    } else {
+        ulog_format(self, fmt, fmt_len);
+        self->seq = 0;
+        self->cur = 0;
+        self->count = 0;
+        self->synced = 0;
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC ulog_obj_t *ulog_get(mp_obj_t self_in) {
+    ulog_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->stage == NULL) {
+        mp_raise_OSError(MP_EBADF);
+    }
+    return self;
+}
+
+// append(*values): add a record
+STATIC mp_obj_t ulog_append(size_t n_args, const mp_obj_t *args) {
+    ulog_obj_t *self = ulog_get(args[0]);
+    if (n_args - 1 != self->n_items) {
+        mp_raise_TypeError("wrong number of values");
+    }
+    byte *block = ulog_stage(self, self->cur);
+    byte *p = block + ULOG_HDR_SIZE + self->count * self->rec_size;
+    memset(p, 0, self->rec_size);
+    mp_struct_pack_into(self->rec, p, n_args - 1, args + 1);
+    if (++self->count == self->per_block) {
+        // the block is full
+        ulog_seal(self, block, self->seq + self->cur, self->count);
+        self->count = 0;
+        if (++self->cur == self->n_stage) {
+            ulog_write_stage(self, self->n_stage);
+            self->seq += self->n_stage;
+            self->cur = 0;
+            self->synced = 0;
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ulog_append_obj, 1, MP_OBJ_FUN_ARGS_MAX, ulog_append);
+
+// flush(): write out the staged records and flush the stream
+STATIC mp_obj_t ulog_flush(mp_obj_t self_in) {
+    ulog_obj_t *self = ulog_get(self_in);
+    ulog_sync(self);
+    const mp_stream_p_t *stream_p = mp_get_stream(self->stream);
+    int errcode;
+    if (stream_p->ioctl(self->stream, MP_STREAM_FLUSH, 0, &errcode) == MP_STREAM_ERROR) {
+        mp_raise_OSError(errcode);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ulog_flush_obj, ulog_flush);
+
+// close(): flush, then close the stream
+STATIC mp_obj_t ulog_close(mp_obj_t self_in) {
+    ulog_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->stage != NULL) {
+        ulog_flush(self_in);
+        m_del(byte, self->stage, self->n_stage * self->block_size);
+        self->stage = NULL;
+        mp_stream_close(self->stream);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ulog_close_obj, ulog_close);
+
+STATIC mp_obj_t ulog___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return ulog_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(ulog___exit___obj, 4, 4, ulog___exit__);
+
+STATIC mp_obj_t ulog_iternext(mp_obj_t self_in) {
+    ulog_iter_t *it = MP_OBJ_TO_PTR(self_in);
+    ulog_obj_t *self = it->log;
+    if (self->stage == NULL) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    uint32_t last = self->seq + self->cur;
+    while (it->idx >= it->count) {
+        if (it->block != NULL) {
+            // done with this block
+            it->seq++;
+            it->block = NULL;
+        }
+        if (it->seq > last) {
+            return MP_OBJ_STOP_ITERATION;
+        }
+        it->idx = 0;
+        if (it->seq >= self->seq) {
+            // staged, so read from RAM; the current block may be added to
+            // while iterating
+            it->block = ulog_stage(self, it->seq - self->seq);
+            it->count = it->seq == last ? self->count : self->per_block;
+        } else {
+            it->block = it->buf;
+            it->count = 0;
+            if (ulog_read(self, 1 + it->seq % self->n_blocks, it->buf) && get_u32(it->buf + 4) == it->seq) {
+                int count = ulog_check(self, it->buf);
+                if (count > 0) {
+                    it->count = count;
+                }
+            }
+        }
+    }
+    return mp_struct_unpack(self->rec, it->block + ULOG_HDR_SIZE + it->idx++ * self->rec_size);
+}
+
+// records(): iterate over the records, oldest first, as tuples
+STATIC mp_obj_t ulog_records(mp_obj_t self_in) {
+    ulog_obj_t *self = ulog_get(self_in);
+    ulog_iter_t *it = m_new_obj(ulog_iter_t);
+    it->base.type = &mp_type_polymorph_iter;
+    it->iternext = ulog_iternext;
+    it->log = self;
+    uint32_t last = self->seq + self->cur;
+    it->seq = last >= self->n_blocks ? last - self->n_blocks + 1 : 0;
+    it->idx = 0;
+    it->count = 0;
+    it->block = NULL;
+    it->buf = m_new(byte, self->block_size);
+    return MP_OBJ_FROM_PTR(it);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ulog_records_obj, ulog_records);
+
+STATIC void ulog_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest);
+
+STATIC const mp_rom_map_elem_t ulog_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_append), MP_ROM_PTR(&ulog_append_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&ulog_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_records), MP_ROM_PTR(&ulog_records_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&ulog_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&ulog___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(ulog_locals_dict, ulog_locals_dict_table);
+
+STATIC const mp_obj_type_t ulog_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Log,
+    .make_new = ulog_make_new,
+    .attr = ulog_attr,
+    .locals_dict = (mp_obj_dict_t*)&ulog_locals_dict,
+};
+
+// seq is the sequence number of the block being filled, and pending the
+// number of records not yet written to the stream
+STATIC void ulog_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        return;
+    }
+    ulog_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (attr) {
+        case MP_QSTR_seq:
+            dest[0] = mp_obj_new_int_from_uint(self->seq + self->cur);
+            break;
+        case MP_QSTR_pending:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->cur * self->per_block + self->count - self->synced);
+            break;
+        case MP_QSTR_record_size:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->rec_size);
+            break;
+        default: {
+            mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&ulog_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+            if (elem != NULL) {
+                mp_convert_member_lookup(self_in, &ulog_type, elem->value, dest);
+            }
+            break;
+        }
+    }
+}
+
+STATIC const mp_rom_map_elem_t mp_module_ulog_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ulog) },
+    { MP_ROM_QSTR(MP_QSTR_Log), MP_ROM_PTR(&ulog_type) },
+};
+STATIC MP_DEFINE_CONST_DICT(mp_module_ulog_globals, mp_module_ulog_globals_table);
+
+const mp_obj_module_t mp_module_ulog = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&mp_module_ulog_globals,
+};
+
+#endif // MICROPY_PY_ULOG
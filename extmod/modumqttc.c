@@ -0,0 +1,798 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "py/objexcept.h"
+
+#if MICROPY_PY_UMQTTC
+
+// MQTT 3.1.1 client with the API of umqtt.simple, over any stream.
+//
+// Incoming packets are read into a buffer allocated with the client, and a
+// message's payload is passed to the callback as a memoryview of that
+// buffer, so it is only valid until the callback returns.  A QoS 1 publish
+// doesn't wait for its PUBACK: the packet is kept in an in-flight area until
+// the PUBACK comes in through wait_msg()/check_msg(), and is sent again with
+// the DUP flag after connect(clean_session=False).  Only when the in-flight
+// area is full does publish() wait for acknowledgements.
+
+#define MQTT_CONNECT        (0x10)
+#define MQTT_CONNACK        (0x20)
+#define MQTT_PUBLISH        (0x30)
+#define MQTT_PUBACK         (0x40)
+#define MQTT_SUBSCRIBE      (0x82)
+#define MQTT_SUBACK         (0x90)
+#define MQTT_UNSUBSCRIBE    (0xa2)
+#define MQTT_UNSUBACK       (0xb0)
+#define MQTT_PINGREQ        (0xc0)
+#define MQTT_PINGRESP       (0xd0)
+#define MQTT_DISCONNECT     (0xe0)
+
+#define MQTT_PUBLISH_DUP    (0x08)
+
+// Packets up to this size are put together on the stack and sent with one
+// write, so that a stream without gather writes (eg ussl) doesn't send the
+// header as a record or segment of its own
+#define MQTT_STACK_PACKET_MAX (128)
+
+// each in-flight entry is u16 packet id, u16 packet length, then the packet
+#define MQTT_INFLIGHT_HEADER (4)
+
+typedef struct _mp_obj_mqtt_client_t {
+    mp_obj_base_t base;
+    mp_obj_t sock;              // MP_OBJ_NULL while not connected
+    mp_obj_t client_id;
+    mp_obj_t server;
+    mp_obj_t user;
+    mp_obj_t password;
+    mp_obj_t ssl_params;        // None for a plain socket
+    mp_obj_t lw_topic;          // None for no last will
+    mp_obj_t lw_msg;
+    mp_obj_t cb;
+    mp_obj_t subs;              // list of (filter, callback) from subscribe()
+    mp_uint_t last_tx;          // mp_hal_ticks_ms() of the last packet sent
+    mp_uint_t dropped;          // incoming messages too big for buf
+    uint16_t port;
+    uint16_t keepalive;
+    uint16_t pid;
+    uint16_t ack_pid;           // of the last SUBACK or UNSUBACK
+    uint8_t ack_rc;
+    uint8_t lw_qos;
+    bool lw_retain;
+    uint16_t inflight_count;
+    size_t inflight_used;
+    size_t inflight_size;
+    byte *inflight;             // QoS 1 PUBLISH packets awaiting PUBACK
+    size_t buf_size;
+    byte buf[];                 // the packet being received
+} mp_obj_mqtt_client_t;
+
+MP_DEFINE_EXCEPTION(MQTTException, Exception)
+
+STATIC NORETURN void mqtt_raise(mp_int_t code) {
+    nlr_raise(mp_obj_new_exception_arg1(&mp_type_MQTTException, MP_OBJ_NEW_SMALL_INT(code)));
+}
+
+// Whether a topic name matches a subscription filter, following the rules
+// for the '+' and '#' wildcards in section 4.7 of the MQTT spec
+STATIC bool mqtt_topic_matches(const byte *f, size_t flen, const byte *t, size_t tlen) {
+    // wildcards at the first level don't match topics starting with '$'
+    if (tlen > 0 && t[0] == '$' && flen > 0 && (f[0] == '+' || f[0] == '#')) {
+        return false;
+    }
+    size_t i = 0, j = 0;
+    for (;;) {
+        if (i < flen && f[i] == '#') {
+            return true;
+        }
+        if (i < flen && f[i] == '+') {
+            while (j < tlen && t[j] != '/') {
+                j++;
+            }
+            i++;
+        } else {
+            while (i < flen && f[i] != '/') {
+                if (j >= tlen || t[j] != f[i]) {
+                    return false;
+                }
+                i++;
+                j++;
+            }
+            if (j < tlen && t[j] != '/') {
+                return false;
+            }
+        }
+        // both are now at the end of a level
+        if (i == flen) {
+            return j == tlen;
+        }
+        if (j == tlen) {
+            // "a/#" also matches "a"
+            return i + 2 == flen && f[i + 1] == '#';
+        }
+        i++;
+        j++;
+    }
+}
+
+STATIC size_t mqtt_encode_len(byte *p, size_t len) {
+    size_t n = 0;
+    do {
+        byte b = len & 0x7f;
+        len >>= 7;
+        if (len != 0) {
+            b |= 0x80;
+        }
+        p[n++] = b;
+    } while (len != 0);
+    return n;
+}
+
+STATIC byte *mqtt_put_str(byte *p, const void *data, size_t len) {
+    *p++ = len >> 8;
+    *p++ = len;
+    memcpy(p, data, len);
+    return p + len;
+}
+
+STATIC void mqtt_check_connected(mp_obj_mqtt_client_t *self) {
+    if (self->sock == MP_OBJ_NULL) {
+        mp_raise_OSError(MP_ENOTCONN);
+    }
+}
+
+STATIC void mqtt_read(mp_obj_mqtt_client_t *self, byte *buf, size_t len) {
+    int errcode;
+    mp_uint_t out_sz = mp_stream_rw(self->sock, buf, len, &errcode, MP_STREAM_RW_READ);
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    if (out_sz < len) {
+        // the broker closed the connection
+        mp_raise_OSError(MP_ECONNRESET);
+    }
+}
+
+STATIC void mqtt_writev(mp_obj_mqtt_client_t *self, mp_stream_iovec_t *iov, size_t iovcnt) {
+    int errcode;
+    mp_stream_writev(self->sock, iov, iovcnt, &errcode);
+    if (errcode != 0) {
+        mp_raise_OSError(errcode);
+    }
+    self->last_tx = mp_hal_ticks_ms();
+}
+
+STATIC void mqtt_write(mp_obj_mqtt_client_t *self, const void *buf, size_t len) {
+    mp_stream_iovec_t iov = { buf, len };
+    mqtt_writev(self, &iov, 1);
+}
+
+// Send a packet with a 16-bit packet id and a payload of one string, and
+// optionally one more byte (SUBSCRIBE, UNSUBSCRIBE)
+STATIC void mqtt_write_pid_str(mp_obj_mqtt_client_t *self, byte type, uint16_t pid, mp_obj_t str_in, int extra) {
+    size_t len;
+    const char *str = mp_obj_str_get_data(str_in, &len);
+    size_t rem = 2 + 2 + len + (extra >= 0 ? 1 : 0);
+    byte hdr[9];
+    hdr[0] = type;
+    size_t n = 1 + mqtt_encode_len(hdr + 1, rem);
+    hdr[n++] = pid >> 8;
+    hdr[n++] = pid;
+    hdr[n++] = len >> 8;
+    hdr[n++] = len;
+    byte qos = extra;
+    mp_stream_iovec_t iov[3] = { { hdr, n }, { str, len }, { &qos, extra >= 0 ? 1 : 0 } };
+    mqtt_writev(self, iov, 3);
+}
+
+STATIC uint16_t mqtt_next_pid(mp_obj_mqtt_client_t *self) {
+    if (++self->pid == 0) {
+        self->pid = 1;
+    }
+    return self->pid;
+}
+
+STATIC size_t mqtt_read_len(mp_obj_mqtt_client_t *self) {
+    size_t len = 0;
+    for (int shift = 0; shift < 28; shift += 7) {
+        byte b;
+        mqtt_read(self, &b, 1);
+        len |= (size_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return len;
+        }
+    }
+    mp_raise_OSError(MP_EIO);
+}
+
+STATIC void mqtt_inflight_remove(mp_obj_mqtt_client_t *self, uint16_t pid) {
+    byte *p = self->inflight;
+    byte *top = self->inflight + self->inflight_used;
+    while (p < top) {
+        size_t size = MQTT_INFLIGHT_HEADER + ((p[2] << 8) | p[3]);
+        if (((p[0] << 8) | p[1]) == pid) {
+            memmove(p, p + size, top - (p + size));
+            self->inflight_used -= size;
+            self->inflight_count--;
+            return;
+        }
+        p += size;
+    }
+}
+
+STATIC mp_obj_t mqtt_find_callback(mp_obj_mqtt_client_t *self, const byte *topic, size_t len) {
+    mp_obj_list_t *subs = MP_OBJ_TO_PTR(self->subs);
+    for (size_t i = 0; i < subs->len; i++) {
+        mp_obj_t *sub = ((mp_obj_tuple_t*)MP_OBJ_TO_PTR(subs->items[i]))->items;
+        size_t flen;
+        const char *filter = mp_obj_str_get_data(sub[0], &flen);
+        if (mqtt_topic_matches((const byte*)filter, flen, topic, len)) {
+            return sub[1];
+        }
+    }
+    return self->cb;
+}
+
+// Read and handle one packet.  Returns None, or the type byte of a packet
+// the client doesn't handle itself.
+STATIC mp_obj_t mqtt_handle_packet(mp_obj_mqtt_client_t *self) {
+    byte op;
+    mqtt_read(self, &op, 1);
+    size_t len = mqtt_read_len(self);
+    byte *buf = self->buf;
+
+    if ((op & 0xf0) == MQTT_PUBLISH) {
+        int qos = (op >> 1) & 3;
+        size_t first = MIN(len, self->buf_size);
+        mqtt_read(self, buf, first);
+        size_t topic_len = (len >= 2) ? (size_t)((buf[0] << 8) | buf[1]) : len;
+        size_t off = 2 + topic_len + (qos ? 2 : 0);
+        if (off > len) {
+            mp_raise_OSError(MP_EIO);
+        }
+        uint16_t pid = 0;
+        if (qos && off <= first) {
+            pid = (buf[off - 2] << 8) | buf[off - 1];
+        }
+        if (len > self->buf_size) {
+            // too big for the buffer, so it's dropped, after giving the
+            // broker its PUBACK if the packet id was in the first part
+            for (size_t n = len - first; n > 0;) {
+                size_t chunk = MIN(n, self->buf_size);
+                mqtt_read(self, buf, chunk);
+                n -= chunk;
+            }
+            self->dropped++;
+        } else {
+            mp_obj_t cb = mqtt_find_callback(self, buf + 2, topic_len);
+            if (cb != mp_const_none) {
+                mp_obj_t args[2] = {
+                    mp_obj_new_bytes(buf + 2, topic_len),
+                    mp_obj_new_memoryview('B', len - off, buf + off),
+                };
+                mp_call_function_n_kw(cb, 2, 0, args);
+            }
+        }
+        if (qos == 1 && pid != 0) {
+            byte ack[4] = { MQTT_PUBACK, 2, pid >> 8, pid };
+            mqtt_write(self, ack, 4);
+        } else if (qos > 1) {
+            // never subscribed to with QoS 2
+            mp_raise_OSError(MP_EIO);
+        }
+        return mp_const_none;
+    }
+
+    if (len > self->buf_size) {
+        mp_raise_OSError(MP_EIO);
+    }
+    mqtt_read(self, buf, len);
+    switch (op) {
+        case MQTT_PUBACK:
+            if (len >= 2) {
+                mqtt_inflight_remove(self, (buf[0] << 8) | buf[1]);
+            }
+            return mp_const_none;
+        case MQTT_SUBACK:
+        case MQTT_UNSUBACK:
+            if (len >= 2) {
+                self->ack_pid = (buf[0] << 8) | buf[1];
+                self->ack_rc = (len >= 3) ? buf[2] : 0;
+            }
+            return mp_const_none;
+        case MQTT_PINGRESP:
+            return mp_const_none;
+        default:
+            return MP_OBJ_NEW_SMALL_INT(op);
+    }
+}
+
+/******************************************************************************/
+// MQTTClient
+
+STATIC mp_obj_t mqtt_client_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_client_id, ARG_server, ARG_port, ARG_user, ARG_password, ARG_keepalive,
+        ARG_ssl, ARG_ssl_params, ARG_buf_size, ARG_inflight_size };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_client_id, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_server, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_port, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_user, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_password, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_keepalive, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_ssl, MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_ssl_params, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_buf_size, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 512} },
+        { MP_QSTR_inflight_size, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1024} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t buf_size = args[ARG_buf_size].u_int;
+    mp_int_t inflight_size = args[ARG_inflight_size].u_int;
+    if (buf_size < 16 || inflight_size < 0 || args[ARG_keepalive].u_int < 0 || args[ARG_keepalive].u_int > 0xffff) {
+        mp_raise_ValueError(NULL);
+    }
+
+    mp_obj_mqtt_client_t *self = m_new_obj_var(mp_obj_mqtt_client_t, byte, buf_size);
+    memset(self, 0, sizeof(*self));
+    self->base.type = type;
+    self->sock = MP_OBJ_NULL;
+    self->client_id = args[ARG_client_id].u_obj;
+    self->server = args[ARG_server].u_obj;
+    self->user = args[ARG_user].u_obj;
+    self->password = args[ARG_password].u_obj;
+    self->ssl_params = mp_const_none;
+    if (args[ARG_ssl].u_bool) {
+        self->ssl_params = args[ARG_ssl_params].u_obj;
+        if (self->ssl_params == mp_const_none) {
+            self->ssl_params = mp_obj_new_dict(0);
+        }
+    }
+    self->port = args[ARG_port].u_int;
+    if (self->port == 0) {
+        self->port = args[ARG_ssl].u_bool ? 8883 : 1883;
+    }
+    self->keepalive = args[ARG_keepalive].u_int;
+    self->lw_topic = mp_const_none;
+    self->lw_msg = mp_const_none;
+    self->cb = mp_const_none;
+    self->subs = mp_obj_new_list(0, NULL);
+    self->inflight_size = inflight_size;
+    self->inflight = m_new(byte, inflight_size);
+    self->buf_size = buf_size;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t mqtt_client_set_callback(mp_obj_t self_in, mp_obj_t cb) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(self_in);
+    self->cb = cb;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mqtt_client_set_callback_obj, mqtt_client_set_callback);
+
+// set_last_will(topic, msg, retain=False, qos=0)
+STATIC const mp_arg_t mqtt_publish_args[] = {
+    { MP_QSTR_topic, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_msg, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_retain, MP_ARG_BOOL, {.u_bool = false} },
+    { MP_QSTR_qos, MP_ARG_INT, {.u_int = 0} },
+};
+enum { ARG_topic, ARG_msg, ARG_retain, ARG_qos };
+
+STATIC mp_obj_t mqtt_client_set_last_will(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(mqtt_publish_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(mqtt_publish_args), mqtt_publish_args, args);
+    mp_int_t qos = args[ARG_qos].u_int;
+    if (qos < 0 || qos > 2) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_obj_str_get_str(args[ARG_topic].u_obj);
+    self->lw_topic = args[ARG_topic].u_obj;
+    self->lw_msg = args[ARG_msg].u_obj;
+    self->lw_retain = args[ARG_retain].u_bool;
+    self->lw_qos = qos;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mqtt_client_set_last_will_obj, 3, mqtt_client_set_last_will);
+
+STATIC mp_obj_t mqtt_open_socket(mp_obj_mqtt_client_t *self) {
+    mp_obj_t usocket = mp_import_name(MP_QSTR_usocket, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+    mp_obj_t ai_args[2] = { self->server, MP_OBJ_NEW_SMALL_INT(self->port) };
+    mp_obj_t ai = mp_call_function_n_kw(mp_load_attr(usocket, MP_QSTR_getaddrinfo), 2, 0, ai_args);
+    ai = mp_obj_subscr(ai, MP_OBJ_NEW_SMALL_INT(0), MP_OBJ_SENTINEL);
+    mp_obj_t addr = mp_obj_subscr(ai, MP_OBJ_NEW_SMALL_INT(-1), MP_OBJ_SENTINEL);
+    mp_obj_t sock = mp_call_function_0(mp_load_attr(usocket, MP_QSTR_socket));
+    mp_obj_t dest[3];
+    mp_load_method(sock, MP_QSTR_connect, dest);
+    dest[2] = addr;
+    mp_call_method_n_kw(1, 0, dest);
+    if (self->ssl_params != mp_const_none) {
+        // ussl.wrap_socket(sock, **ssl_params)
+        mp_obj_t ussl = mp_import_name(MP_QSTR_ussl, mp_const_none, MP_OBJ_NEW_SMALL_INT(0));
+        mp_map_t *map = mp_obj_dict_get_map(self->ssl_params);
+        mp_obj_t *wrap_args = m_new(mp_obj_t, 1 + 2 * map->used);
+        size_t n_kw = 0;
+        wrap_args[0] = sock;
+        for (size_t i = 0; i < map->alloc; i++) {
+            if (mp_map_slot_is_filled(map, i)) {
+                wrap_args[1 + 2 * n_kw] = map->table[i].key;
+                wrap_args[2 + 2 * n_kw] = map->table[i].value;
+                n_kw++;
+            }
+        }
+        sock = mp_call_function_n_kw(mp_load_attr(ussl, MP_QSTR_wrap_socket), 1, n_kw, wrap_args);
+        m_del(mp_obj_t, wrap_args, 1 + 2 * map->used);
+    }
+    return sock;
+}
+
+// connect(clean_session=True, sock=None) -> session present flag
+STATIC mp_obj_t mqtt_client_connect(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_clean_session, ARG_sock };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_clean_session, MP_ARG_BOOL, {.u_bool = true} },
+        { MP_QSTR_sock, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    bool clean = args[ARG_clean_session].u_bool;
+
+    // the CONNECT packet is put together in buf
+    size_t id_len, topic_len = 0, msg_len = 0, user_len = 0, pswd_len = 0;
+    const char *id = mp_obj_str_get_data(self->client_id, &id_len);
+    const char *topic = NULL, *user = NULL, *pswd = NULL;
+    mp_buffer_info_t msg;
+    size_t rem = 10 + 2 + id_len;
+    byte flags = clean ? 0x02 : 0;
+    if (self->lw_topic != mp_const_none) {
+        topic = mp_obj_str_get_data(self->lw_topic, &topic_len);
+        mp_get_buffer_raise(self->lw_msg, &msg, MP_BUFFER_READ);
+        msg_len = msg.len;
+        rem += 2 + topic_len + 2 + msg_len;
+        flags |= 0x04 | (self->lw_qos << 3) | (self->lw_retain ? 0x20 : 0);
+    }
+    if (self->user != mp_const_none) {
+        user = mp_obj_str_get_data(self->user, &user_len);
+        rem += 2 + user_len;
+        flags |= 0x80;
+        if (self->password != mp_const_none) {
+            pswd = mp_obj_str_get_data(self->password, &pswd_len);
+            rem += 2 + pswd_len;
+            flags |= 0x40;
+        }
+    }
+    byte len_bytes[4];
+    if (1 + mqtt_encode_len(len_bytes, rem) + rem > self->buf_size) {
+        mp_raise_ValueError("buf_size too small");
+    }
+    byte *p = self->buf;
+    *p++ = MQTT_CONNECT;
+    p += mqtt_encode_len(p, rem);
+    p = mqtt_put_str(p, "MQTT", 4);
+    *p++ = 4; // protocol level 3.1.1
+    *p++ = flags;
+    *p++ = self->keepalive >> 8;
+    *p++ = self->keepalive;
+    p = mqtt_put_str(p, id, id_len);
+    if (topic != NULL) {
+        p = mqtt_put_str(p, topic, topic_len);
+        p = mqtt_put_str(p, msg.buf, msg_len);
+    }
+    if (user != NULL) {
+        p = mqtt_put_str(p, user, user_len);
+        if (pswd != NULL) {
+            p = mqtt_put_str(p, pswd, pswd_len);
+        }
+    }
+
+    if (self->sock != MP_OBJ_NULL) {
+        mp_stream_close(self->sock);
+        self->sock = MP_OBJ_NULL;
+    }
+    mp_obj_t sock = args[ARG_sock].u_obj;
+    if (sock == mp_const_none) {
+        sock = mqtt_open_socket(self);
+    }
+    mp_get_stream_raise(sock, MP_STREAM_OP_READ | MP_STREAM_OP_WRITE);
+    self->sock = sock;
+    mqtt_write(self, self->buf, p - self->buf);
+
+    byte ack[4];
+    mqtt_read(self, ack, 4);
+    if (ack[0] != MQTT_CONNACK || ack[1] != 2) {
+        mp_raise_OSError(MP_EIO);
+    }
+    if (ack[3] != 0) {
+        mqtt_raise(ack[3]);
+    }
+
+    if (clean) {
+        // the broker has forgotten the session, along with the messages in flight
+        self->inflight_used = 0;
+        self->inflight_count = 0;
+    } else {
+        for (size_t off = 0; off < self->inflight_used;) {
+            byte *e = self->inflight + off;
+            size_t len = (e[2] << 8) | e[3];
+            e[MQTT_INFLIGHT_HEADER] |= MQTT_PUBLISH_DUP;
+            mqtt_write(self, e + MQTT_INFLIGHT_HEADER, len);
+            off += MQTT_INFLIGHT_HEADER + len;
+        }
+    }
+    return mp_obj_new_bool(ack[2] & 1);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mqtt_client_connect_obj, 1, mqtt_client_connect);
+
+STATIC mp_obj_t mqtt_client_disconnect(mp_obj_t self_in) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(self_in);
+    mqtt_check_connected(self);
+    static const byte pkt[2] = { MQTT_DISCONNECT, 0 };
+    mqtt_write(self, pkt, 2);
+    mp_obj_t sock = self->sock;
+    self->sock = MP_OBJ_NULL;
+    mp_stream_close(sock);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mqtt_client_disconnect_obj, mqtt_client_disconnect);
+
+STATIC mp_obj_t mqtt_client_ping(mp_obj_t self_in) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(self_in);
+    mqtt_check_connected(self);
+    static const byte pkt[2] = { MQTT_PINGREQ, 0 };
+    mqtt_write(self, pkt, 2);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mqtt_client_ping_obj, mqtt_client_ping);
+
+// publish(topic, msg, retain=False, qos=0) -> packet id, or None for QoS 0
+STATIC mp_obj_t mqtt_client_publish(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(mqtt_publish_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(mqtt_publish_args), mqtt_publish_args, args);
+    mqtt_check_connected(self);
+    size_t topic_len;
+    const char *topic = mp_obj_str_get_data(args[ARG_topic].u_obj, &topic_len);
+    mp_buffer_info_t msg;
+    mp_get_buffer_raise(args[ARG_msg].u_obj, &msg, MP_BUFFER_READ);
+    bool retain = args[ARG_retain].u_bool;
+    mp_int_t qos = args[ARG_qos].u_int;
+    if (qos < 0 || qos > 1) {
+        mp_raise_ValueError("QoS 0 or 1 only");
+    }
+
+    size_t rem = 2 + topic_len + (qos ? 2 : 0) + msg.len;
+    byte hdr[7];
+    hdr[0] = MQTT_PUBLISH | (qos << 1) | (retain ? 1 : 0);
+    size_t n = 1 + mqtt_encode_len(hdr + 1, rem);
+    hdr[n++] = topic_len >> 8;
+    hdr[n++] = topic_len;
+    size_t pkt_len = n + topic_len + (qos ? 2 : 0) + msg.len;
+
+    if (qos == 0) {
+        if (pkt_len <= MQTT_STACK_PACKET_MAX) {
+            byte pkt[MQTT_STACK_PACKET_MAX];
+            memcpy(pkt, hdr, n);
+            memcpy(pkt + n, topic, topic_len);
+            memcpy(pkt + n + topic_len, msg.buf, msg.len);
+            mqtt_write(self, pkt, pkt_len);
+        } else {
+            mp_stream_iovec_t iov[3] = { { hdr, n }, { topic, topic_len }, { msg.buf, msg.len } };
+            mqtt_writev(self, iov, 3);
+        }
+        return mp_const_none;
+    }
+
+    // QoS 1: the packet is kept in the in-flight area until its PUBACK
+    size_t size = MQTT_INFLIGHT_HEADER + pkt_len;
+    if (size > self->inflight_size || pkt_len > 0xffff) {
+        mp_raise_ValueError("message too big");
+    }
+    while (self->inflight_used + size > self->inflight_size) {
+        mqtt_handle_packet(self);
+    }
+    uint16_t pid = mqtt_next_pid(self);
+    byte *e = self->inflight + self->inflight_used;
+    e[0] = pid >> 8;
+    e[1] = pid;
+    e[2] = pkt_len >> 8;
+    e[3] = pkt_len;
+    byte *p = e + MQTT_INFLIGHT_HEADER;
+    memcpy(p, hdr, n);
+    p += n;
+    memcpy(p, topic, topic_len);
+    p += topic_len;
+    *p++ = pid >> 8;
+    *p++ = pid;
+    memcpy(p, msg.buf, msg.len);
+    self->inflight_used += size;
+    self->inflight_count++;
+    mqtt_write(self, e + MQTT_INFLIGHT_HEADER, pkt_len);
+    return MP_OBJ_NEW_SMALL_INT(pid);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mqtt_client_publish_obj, 3, mqtt_client_publish);
+
+// subscribe(topic, qos=0, cb=None): messages on topics matching this filter
+// go to cb, if given, instead of the callback from set_callback()
+STATIC mp_obj_t mqtt_client_subscribe(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_sub_topic, ARG_sub_qos, ARG_sub_cb };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_topic, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_qos, MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_cb, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    mqtt_check_connected(self);
+    mp_obj_t topic = args[ARG_sub_topic].u_obj;
+    mp_int_t qos = args[ARG_sub_qos].u_int;
+    if (qos < 0 || qos > 1) {
+        mp_raise_ValueError("QoS 0 or 1 only");
+    }
+    uint16_t pid = mqtt_next_pid(self);
+    mqtt_write_pid_str(self, MQTT_SUBSCRIBE, pid, topic, qos);
+    self->ack_pid = 0;
+    while (self->ack_pid != pid) {
+        mqtt_handle_packet(self);
+    }
+    if (self->ack_rc == 0x80) {
+        mqtt_raise(self->ack_rc);
+    }
+
+    // replace or drop any callback for the same filter
+    mp_obj_list_t *subs = MP_OBJ_TO_PTR(self->subs);
+    for (size_t i = 0; i < subs->len; i++) {
+        mp_obj_tuple_t *sub = MP_OBJ_TO_PTR(subs->items[i]);
+        if (mp_obj_equal(sub->items[0], topic)) {
+            mp_obj_list_remove(self->subs, subs->items[i]);
+            break;
+        }
+    }
+    if (args[ARG_sub_cb].u_obj != mp_const_none) {
+        mp_obj_t sub[2] = { topic, args[ARG_sub_cb].u_obj };
+        mp_obj_list_append(self->subs, mp_obj_new_tuple(2, sub));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mqtt_client_subscribe_obj, 2, mqtt_client_subscribe);
+
+STATIC mp_obj_t mqtt_client_unsubscribe(mp_obj_t self_in, mp_obj_t topic_in) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(self_in);
+    mqtt_check_connected(self);
+    uint16_t pid = mqtt_next_pid(self);
+    mqtt_write_pid_str(self, MQTT_UNSUBSCRIBE, pid, topic_in, -1);
+    self->ack_pid = 0;
+    while (self->ack_pid != pid) {
+        mqtt_handle_packet(self);
+    }
+    mp_obj_list_t *subs = MP_OBJ_TO_PTR(self->subs);
+    for (size_t i = 0; i < subs->len; i++) {
+        mp_obj_tuple_t *sub = MP_OBJ_TO_PTR(subs->items[i]);
+        if (mp_obj_equal(sub->items[0], topic_in)) {
+            mp_obj_list_remove(self->subs, subs->items[i]);
+            break;
+        }
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mqtt_client_unsubscribe_obj, mqtt_client_unsubscribe);
+
+// Block until a packet comes in and handle it
+STATIC mp_obj_t mqtt_client_wait_msg(mp_obj_t self_in) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(self_in);
+    mqtt_check_connected(self);
+    return mqtt_handle_packet(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mqtt_client_wait_msg_obj, mqtt_client_wait_msg);
+
+// Handle a packet if one is waiting, and send a PINGREQ if half of the
+// keepalive time has gone by without anything being sent
+STATIC mp_obj_t mqtt_client_check_msg(mp_obj_t self_in) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(self_in);
+    mqtt_check_connected(self);
+    if (self->keepalive != 0 && mp_hal_ticks_ms() - self->last_tx >= self->keepalive * 500u) {
+        mqtt_client_ping(self_in);
+    }
+    const mp_stream_p_t *stream_p = mp_get_stream_raise(self->sock, MP_STREAM_OP_IOCTL);
+    int errcode;
+    mp_uint_t ret = stream_p->ioctl(self->sock, MP_STREAM_POLL, MP_STREAM_POLL_RD, &errcode);
+    if (ret == MP_STREAM_ERROR) {
+        mp_raise_OSError(errcode);
+    }
+    if (!(ret & (MP_STREAM_POLL_RD | MP_STREAM_POLL_ERR | MP_STREAM_POLL_HUP))) {
+        return mp_const_none;
+    }
+    return mqtt_handle_packet(self);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mqtt_client_check_msg_obj, mqtt_client_check_msg);
+
+// inflight() -> (QoS 1 messages awaiting PUBACK, messages dropped as too big)
+STATIC mp_obj_t mqtt_client_inflight(mp_obj_t self_in) {
+    mp_obj_mqtt_client_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t items[2] = {
+        MP_OBJ_NEW_SMALL_INT(self->inflight_count),
+        mp_obj_new_int_from_uint(self->dropped),
+    };
+    return mp_obj_new_tuple(2, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mqtt_client_inflight_obj, mqtt_client_inflight);
+
+STATIC const mp_rom_map_elem_t mqtt_client_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_set_callback), MP_ROM_PTR(&mqtt_client_set_callback_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_last_will), MP_ROM_PTR(&mqtt_client_set_last_will_obj) },
+    { MP_ROM_QSTR(MP_QSTR_connect), MP_ROM_PTR(&mqtt_client_connect_obj) },
+    { MP_ROM_QSTR(MP_QSTR_disconnect), MP_ROM_PTR(&mqtt_client_disconnect_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ping), MP_ROM_PTR(&mqtt_client_ping_obj) },
+    { MP_ROM_QSTR(MP_QSTR_publish), MP_ROM_PTR(&mqtt_client_publish_obj) },
+    { MP_ROM_QSTR(MP_QSTR_subscribe), MP_ROM_PTR(&mqtt_client_subscribe_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unsubscribe), MP_ROM_PTR(&mqtt_client_unsubscribe_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait_msg), MP_ROM_PTR(&mqtt_client_wait_msg_obj) },
+    { MP_ROM_QSTR(MP_QSTR_check_msg), MP_ROM_PTR(&mqtt_client_check_msg_obj) },
+    { MP_ROM_QSTR(MP_QSTR_inflight), MP_ROM_PTR(&mqtt_client_inflight_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(mqtt_client_locals_dict, mqtt_client_locals_dict_table);
+
+STATIC const mp_obj_type_t mqtt_client_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_MQTTClient,
+    .make_new = mqtt_client_make_new,
+    .locals_dict = (mp_obj_dict_t*)&mqtt_client_locals_dict,
+};
+
+/******************************************************************************/
+// Module
+
+STATIC mp_obj_t mod_umqttc_topic_matches(mp_obj_t filter_in, mp_obj_t topic_in) {
+    size_t flen, tlen;
+    const char *filter = mp_obj_str_get_data(filter_in, &flen);
+    const char *topic = mp_obj_str_get_data(topic_in, &tlen);
+    return mp_obj_new_bool(mqtt_topic_matches((const byte*)filter, flen, (const byte*)topic, tlen));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_umqttc_topic_matches_obj, mod_umqttc_topic_matches);
+
+STATIC const mp_rom_map_elem_t mp_module_umqttc_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_umqttc) },
+    { MP_ROM_QSTR(MP_QSTR_MQTTClient), MP_ROM_PTR(&mqtt_client_type) },
+    { MP_ROM_QSTR(MP_QSTR_MQTTException), MP_ROM_PTR(&mp_type_MQTTException) },
+    { MP_ROM_QSTR(MP_QSTR_topic_matches), MP_ROM_PTR(&mod_umqttc_topic_matches_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(mp_module_umqttc_globals, mp_module_umqttc_globals_table);
+
+const mp_obj_module_t mp_module_umqttc = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&mp_module_umqttc_globals,
+};
+
+#endif // MICROPY_PY_UMQTTC
@@ -52,6 +52,20 @@ STATIC uint32_t yasmarang(void)
 
 // End of Yasmarang
 
+#ifdef MICROPY_PY_URANDOM_HW_FUNC
+// The hardware generator is used until seed() asks for a repeatable sequence
+STATIC bool urandom_seeded = false;
+
+STATIC uint32_t urandom_next(void) {
+    if (urandom_seeded) {
+        return yasmarang();
+    }
+    return MICROPY_PY_URANDOM_HW_FUNC();
+}
+#else
+#define urandom_next() yasmarang()
+#endif
+
 #if MICROPY_PY_URANDOM_EXTRA_FUNCS
 
 // returns an unsigned integer below the given argument
@@ -63,7 +77,7 @@ STATIC uint32_t yasmarang_randbelow(uint32_t n) {
     }
     uint32_t r;
     do {
-        r = yasmarang() & mask;
+        r = urandom_next() & mask;
     } while (r >= n);
     return r;
 }
@@ -78,7 +92,7 @@ STATIC mp_obj_t mod_urandom_getrandbits(mp_obj_t num_in) {
     uint32_t mask = ~0;
     // Beware of C undefined behavior when shifting by >= than bit size
     mask >>= (32 - n);
-    return mp_obj_new_int_from_uint(yasmarang() & mask);
+    return mp_obj_new_int_from_uint(urandom_next() & mask);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_urandom_getrandbits_obj, mod_urandom_getrandbits);
 
@@ -88,10 +102,31 @@ STATIC mp_obj_t mod_urandom_seed(mp_obj_t seed_in) {
     yasmarang_n = 69;
     yasmarang_d = 233;
     yasmarang_dat = 0;
+    #ifdef MICROPY_PY_URANDOM_HW_FUNC
+    urandom_seeded = true;
+    #endif
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_urandom_seed_obj, mod_urandom_seed);
 
+// fill(buf): fill a writable buffer with random bytes, a word at a time
+STATIC mp_obj_t mod_urandom_fill(mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    uint8_t *p = bufinfo.buf;
+    size_t n = bufinfo.len;
+    for (; n >= sizeof(uint32_t); n -= sizeof(uint32_t), p += sizeof(uint32_t)) {
+        uint32_t r = urandom_next();
+        memcpy(p, &r, sizeof(r));
+    }
+    if (n > 0) {
+        uint32_t r = urandom_next();
+        memcpy(p, &r, n);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_urandom_fill_obj, mod_urandom_fill);
+
 #if MICROPY_PY_URANDOM_EXTRA_FUNCS
 
 STATIC mp_obj_t mod_urandom_randrange(size_t n_args, const mp_obj_t *args) {
@@ -177,9 +212,9 @@ STATIC mp_float_t yasmarang_float(void) {
     u.p.sgn = 0;
     u.p.exp = (1 << (MP_FLOAT_EXP_BITS - 1)) - 1;
     if (MP_FLOAT_FRAC_BITS <= 32) {
-        u.p.frc = yasmarang();
+        u.p.frc = urandom_next();
     } else {
-        u.p.frc = ((uint64_t)yasmarang() << 32) | (uint64_t)yasmarang();
+        u.p.frc = ((uint64_t)urandom_next() << 32) | (uint64_t)urandom_next();
     }
     return u.f - 1;
 }
@@ -204,6 +239,7 @@ STATIC const mp_rom_map_elem_t mp_module_urandom_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_urandom) },
     { MP_ROM_QSTR(MP_QSTR_getrandbits), MP_ROM_PTR(&mod_urandom_getrandbits_obj) },
     { MP_ROM_QSTR(MP_QSTR_seed), MP_ROM_PTR(&mod_urandom_seed_obj) },
+    { MP_ROM_QSTR(MP_QSTR_fill), MP_ROM_PTR(&mod_urandom_fill_obj) },
     #if MICROPY_PY_URANDOM_EXTRA_FUNCS
     { MP_ROM_QSTR(MP_QSTR_randrange), MP_ROM_PTR(&mod_urandom_randrange_obj) },
     { MP_ROM_QSTR(MP_QSTR_randint), MP_ROM_PTR(&mod_urandom_randint_obj) },
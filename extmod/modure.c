@@ -43,6 +43,9 @@
 
 typedef struct _mp_obj_re_t {
     mp_obj_base_t base;
+    #if MICROPY_PY_URE_CACHE
+    mp_obj_t pattern;
+    #endif
     ByteProg re;
 } mp_obj_re_t;
 
@@ -53,6 +56,12 @@ typedef struct _mp_obj_match_t {
     const char *caps[0];
 } mp_obj_match_t;
 
+#if MICROPY_PY_URE_PIKEVM
+#define ure_run(prog, subj, caps, caps_num, is_anchored) re1_5_pikevm(prog, subj, caps, caps_num, is_anchored)
+#else
+#define ure_run(prog, subj, caps, caps_num, is_anchored) re1_5_recursiveloopprog(prog, subj, caps, caps_num, is_anchored)
+#endif
+
 
 STATIC void match_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
@@ -182,7 +191,7 @@ STATIC mp_obj_t ure_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     mp_obj_match_t *match = m_new_obj_var(mp_obj_match_t, char*, caps_num);
     // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
     memset((char*)match->caps, 0, caps_num * sizeof(char*));
-    int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, is_anchored);
+    int res = ure_run(&self->re, &subj, match->caps, caps_num, is_anchored);
     if (res == 0) {
         m_del_var(mp_obj_match_t, char*, caps_num, match);
         return mp_const_none;
@@ -223,7 +232,7 @@ STATIC mp_obj_t re_split(size_t n_args, const mp_obj_t *args) {
     while (true) {
         // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
         memset((char**)caps, 0, caps_num * sizeof(char*));
-        int res = re1_5_recursiveloopprog(&self->re, &subj, caps, caps_num, false);
+        int res = ure_run(&self->re, &subj, caps, caps_num, false);
 
         // if we didn't have a match, or had an empty match, it's time to stop
         if (!res || caps[0] == caps[1]) {
@@ -278,7 +287,7 @@ STATIC mp_obj_t re_sub_helper(mp_obj_t self_in, size_t n_args, const mp_obj_t *a
     for (;;) {
         // cast is a workaround for a bug in msvc: it treats const char** as a const pointer instead of a pointer to pointer to const char
         memset((char*)match->caps, 0, caps_num * sizeof(char*));
-        int res = re1_5_recursiveloopprog(&self->re, &subj, match->caps, caps_num, false);
+        int res = ure_run(&self->re, &subj, match->caps, caps_num, false);
 
         // If we didn't have a match, or had an empty match, it's time to stop
         if (!res || match->caps[0] == match->caps[1]) {
@@ -389,6 +398,9 @@ STATIC mp_obj_t mod_re_compile(size_t n_args, const mp_obj_t *args) {
     }
     mp_obj_re_t *o = m_new_obj_var(mp_obj_re_t, char, size);
     o->base.type = &re_type;
+    #if MICROPY_PY_URE_CACHE
+    o->pattern = args[0];
+    #endif
     int flags = 0;
     if (n_args > 1) {
         flags = mp_obj_get_int(args[1]);
@@ -405,9 +417,42 @@ error:
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_compile_obj, 1, 2, mod_re_compile);
 
+#if MICROPY_PY_URE_CACHE
+// The module-level functions compile their pattern on each call, so keep the
+// most recently used compiled patterns, most recent first, to reuse when the
+// same pattern is given again.
+STATIC mp_obj_t mod_re_compile_cached(mp_obj_t pattern) {
+    mp_obj_t *cache = MP_STATE_VM(ure_cache);
+    size_t i = 0;
+    for (; i < MICROPY_PY_URE_CACHE && cache[i] != MP_OBJ_NULL; ++i) {
+        mp_obj_re_t *o = MP_OBJ_TO_PTR(cache[i]);
+        // types are checked first so str and bytes aren't compared
+        if (o->pattern == pattern
+            || (mp_obj_get_type(o->pattern) == mp_obj_get_type(pattern) && mp_obj_equal(o->pattern, pattern))) {
+            break;
+        }
+    }
+    mp_obj_t re;
+    if (i < MICROPY_PY_URE_CACHE && cache[i] != MP_OBJ_NULL) {
+        re = cache[i];
+    } else {
+        // not found, so the least recently used entry is dropped if full
+        re = mod_re_compile(1, &pattern);
+        if (i == MICROPY_PY_URE_CACHE) {
+            --i;
+        }
+    }
+    memmove(&cache[1], &cache[0], i * sizeof(mp_obj_t));
+    cache[0] = re;
+    return re;
+}
+#else
+#define mod_re_compile_cached(pattern) mod_re_compile(1, &(pattern))
+#endif
+
 STATIC mp_obj_t mod_re_exec(bool is_anchored, uint n_args, const mp_obj_t *args) {
     (void)n_args;
-    mp_obj_t self = mod_re_compile(1, args);
+    mp_obj_t self = mod_re_compile_cached(args[0]);
 
     const mp_obj_t args2[] = {self, args[1]};
     mp_obj_t match = ure_exec(is_anchored, 2, args2);
@@ -426,7 +471,7 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_search_obj, 2, 4, mod_re_search);
 
 #if MICROPY_PY_URE_SUB
 STATIC mp_obj_t mod_re_sub(size_t n_args, const mp_obj_t *args) {
-    mp_obj_t self = mod_re_compile(1, args);
+    mp_obj_t self = mod_re_compile_cached(args[0]);
     return re_sub_helper(self, n_args, args);
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_re_sub_obj, 3, 5, mod_re_sub);
@@ -456,7 +501,14 @@ const mp_obj_module_t mp_module_ure = {
 #define re1_5_fatal(x) assert(!x)
 #include "re1.5/compilecode.c"
 #include "re1.5/dumpcode.c"
+#if MICROPY_PY_URE_PIKEVM
+#define re1_5_alloc(n) m_new(char, (n))
+#define re1_5_free(p, n) m_del(char, (p), (n))
+#define re1_5_memfind(s, n, lit, litlen) ((const char*)find_subbytes((const byte*)(s), (n), (const byte*)(lit), (litlen), 1))
+#include "re1.5/pike.c"
+#else
 #include "re1.5/recursiveloop.c"
+#endif
 #include "re1.5/charclass.c"
 
 #endif //MICROPY_PY_URE
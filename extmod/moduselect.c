@@ -44,6 +44,12 @@
 /// This module provides the select function.
 
 typedef struct _poll_obj_t {
+    #if MICROPY_PY_USELECT_NOTIFY
+    // first, so that a stream's pointer to it keeps the whole entry alive
+    mp_stream_poll_notify_t notify;
+    // notify.seq when the object was last polled
+    mp_uint_t seq_polled;
+    #endif
     mp_obj_t obj;
     mp_uint_t (*ioctl)(mp_obj_t obj, mp_uint_t request, uintptr_t arg, int *errcode);
     mp_uint_t flags;
@@ -61,6 +67,10 @@ STATIC void poll_map_add(mp_map_t *poll_map, const mp_obj_t *obj, mp_uint_t obj_
             poll_obj->ioctl = stream_p->ioctl;
             poll_obj->flags = flags;
             poll_obj->flags_ret = 0;
+            #if MICROPY_PY_USELECT_NOTIFY
+            poll_obj->notify.seq = 0;
+            poll_obj->notify.attached = false;
+            #endif
             elem->value = MP_OBJ_FROM_PTR(poll_obj);
         } else {
             // object exists; update its flags
@@ -82,6 +92,15 @@ STATIC mp_uint_t poll_map_poll(mp_map_t *poll_map, size_t *rwx_num) {
         }
 
         poll_obj_t *poll_obj = MP_OBJ_TO_PTR(poll_map->table[i].value);
+        #if MICROPY_PY_USELECT_NOTIFY
+        // read seq before polling, so a change during the ioctl is not missed
+        mp_uint_t seq = poll_obj->notify.seq;
+        if (poll_obj->notify.attached && seq == poll_obj->seq_polled && poll_obj->flags_ret == 0) {
+            // not ready when last polled, and nothing has happened since
+            continue;
+        }
+        poll_obj->seq_polled = seq;
+        #endif
         int errcode;
         mp_int_t ret = poll_obj->ioctl(poll_obj->obj, MP_STREAM_POLL, poll_obj->flags, &errcode);
         poll_obj->flags_ret = ret;
@@ -173,6 +192,7 @@ STATIC mp_obj_t select_select(size_t n_args, const mp_obj_t *args) {
             return mp_obj_new_tuple(3, list_array);
         }
         MICROPY_EVENT_POLL_HOOK
+        MICROPY_PY_USELECT_IDLE_HOOK
     }
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_select_select_obj, 3, 4, select_select);
@@ -189,6 +209,30 @@ typedef struct _mp_obj_poll_t {
     mp_obj_t ret_tuple;
 } mp_obj_poll_t;
 
+#if MICROPY_PY_USELECT_NOTIFY
+// Ask the stream to notify the entry of changes, if it isn't already doing so
+STATIC void poll_obj_attach(poll_obj_t *poll_obj) {
+    if (!poll_obj->notify.attached) {
+        int errcode;
+        poll_obj->ioctl(poll_obj->obj, MP_STREAM_POLL_NOTIFY, (uintptr_t)&poll_obj->notify, &errcode);
+    }
+    // its flags may have changed, so poll it next time regardless
+    poll_obj->seq_polled = poll_obj->notify.seq - 1;
+}
+
+STATIC void poll_obj_detach(poll_obj_t *poll_obj) {
+    if (poll_obj->notify.attached) {
+        int errcode;
+        poll_obj->ioctl(poll_obj->obj, MP_STREAM_POLL_NOTIFY, (uintptr_t)&poll_obj->notify, &errcode);
+    }
+}
+
+STATIC poll_obj_t *poll_map_find(mp_map_t *poll_map, mp_obj_t obj) {
+    mp_map_elem_t *elem = mp_map_lookup(poll_map, mp_obj_id(obj), MP_MAP_LOOKUP);
+    return elem == NULL ? NULL : MP_OBJ_TO_PTR(elem->value);
+}
+#endif
+
 /// \method register(obj[, eventmask])
 STATIC mp_obj_t poll_register(size_t n_args, const mp_obj_t *args) {
     mp_obj_poll_t *self = MP_OBJ_TO_PTR(args[0]);
@@ -199,6 +243,9 @@ STATIC mp_obj_t poll_register(size_t n_args, const mp_obj_t *args) {
         flags = MP_STREAM_POLL_RD | MP_STREAM_POLL_WR;
     }
     poll_map_add(&self->poll_map, &args[1], 1, flags, false);
+    #if MICROPY_PY_USELECT_NOTIFY
+    poll_obj_attach(poll_map_find(&self->poll_map, args[1]));
+    #endif
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_register_obj, 2, 3, poll_register);
@@ -206,6 +253,12 @@ MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(poll_register_obj, 2, 3, poll_register);
 /// \method unregister(obj)
 STATIC mp_obj_t poll_unregister(mp_obj_t self_in, mp_obj_t obj_in) {
     mp_obj_poll_t *self = MP_OBJ_TO_PTR(self_in);
+    #if MICROPY_PY_USELECT_NOTIFY
+    poll_obj_t *poll_obj = poll_map_find(&self->poll_map, obj_in);
+    if (poll_obj != NULL) {
+        poll_obj_detach(poll_obj);
+    }
+    #endif
     mp_map_lookup(&self->poll_map, mp_obj_id(obj_in), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
     // TODO raise KeyError if obj didn't exist in map
     return mp_const_none;
@@ -220,6 +273,9 @@ STATIC mp_obj_t poll_modify(mp_obj_t self_in, mp_obj_t obj_in, mp_obj_t eventmas
         mp_raise_OSError(MP_ENOENT);
     }
     ((poll_obj_t*)MP_OBJ_TO_PTR(elem->value))->flags = mp_obj_get_int(eventmask_in);
+    #if MICROPY_PY_USELECT_NOTIFY
+    poll_obj_attach(MP_OBJ_TO_PTR(elem->value));
+    #endif
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_3(poll_modify_obj, poll_modify);
@@ -253,6 +309,7 @@ STATIC mp_uint_t poll_poll_internal(uint n_args, const mp_obj_t *args) {
             break;
         }
         MICROPY_EVENT_POLL_HOOK
+        MICROPY_PY_USELECT_IDLE_HOOK
     }
 
     return n_ready;
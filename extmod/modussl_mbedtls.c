@@ -55,14 +55,24 @@ typedef struct _mp_obj_ssl_socket_t {
     mbedtls_pk_context pkey;
 } mp_obj_ssl_socket_t;
 
+// A client session from a finished handshake, which can be passed to
+// wrap_socket() to resume it with the same server and skip the key exchange
+typedef struct _mp_obj_ssl_session_t {
+    mp_obj_base_t base;
+    mbedtls_ssl_session session;
+} mp_obj_ssl_session_t;
+
 struct ssl_args {
     mp_arg_val_t key;
     mp_arg_val_t cert;
     mp_arg_val_t server_side;
     mp_arg_val_t server_hostname;
+    mp_arg_val_t session;
+    mp_arg_val_t max_fragment_len;
 };
 
 STATIC const mp_obj_type_t ussl_socket_type;
+STATIC const mp_obj_type_t ussl_session_type;
 
 #ifdef MBEDTLS_DEBUG_C
 STATIC void mbedtls_debug(void *ctx, int level, const char *file, int line, const char *str) {
@@ -107,9 +117,39 @@ STATIC int _mbedtls_ssl_recv(void *ctx, byte *buf, size_t len) {
 }
 
 
+STATIC mp_obj_t mod_ssl_getsession(mp_obj_t o_in);
+
+#if MICROPY_PY_USSL_SESSION_CACHE
+STATIC mp_obj_t *session_cache_lookup(mp_obj_t hostname) {
+    for (size_t i = 0; i < 2 * MICROPY_PY_USSL_SESSION_CACHE; i += 2) {
+        mp_obj_t *entry = &MP_STATE_VM(ussl_session_cache[i]);
+        if (entry[0] != MP_OBJ_NULL && mp_obj_equal(entry[0], hostname)) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Keep the session of a finished client handshake, replacing the one for
+// the same server or else dropping the oldest
+STATIC void session_cache_store(mp_obj_t hostname, mp_obj_t session) {
+    mp_obj_t *entry = session_cache_lookup(hostname);
+    if (entry == NULL) {
+        mp_obj_t *cache = MP_STATE_VM(ussl_session_cache);
+        memmove(cache, cache + 2, (2 * MICROPY_PY_USSL_SESSION_CACHE - 2) * sizeof(mp_obj_t));
+        entry = &cache[2 * MICROPY_PY_USSL_SESSION_CACHE - 2];
+        entry[0] = hostname;
+    }
+    entry[1] = session;
+}
+#endif
+
 STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
     // Verify the socket object has the full stream protocol
     mp_get_stream_raise(sock, MP_STREAM_OP_READ | MP_STREAM_OP_WRITE | MP_STREAM_OP_IOCTL);
+    if (args->session.u_obj != mp_const_none && !MP_OBJ_IS_TYPE(args->session.u_obj, &ussl_session_type)) {
+        mp_raise_TypeError(NULL);
+    }
 
 #if MICROPY_PY_USSL_FINALISER
     mp_obj_ssl_socket_t *o = m_new_obj_with_finaliser(mp_obj_ssl_socket_t);
@@ -152,6 +192,17 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
     mbedtls_ssl_conf_dbg(&o->conf, mbedtls_debug, NULL);
     #endif
 
+    #ifdef MBEDTLS_SSL_MAX_FRAGMENT_LENGTH
+    // Ask the server for smaller records; the codes 1 to 4 are 512 to 4096
+    if (args->max_fragment_len.u_int != 0) {
+        unsigned char mfl = 1;
+        while ((256 << mfl) < args->max_fragment_len.u_int && mfl < MBEDTLS_SSL_MAX_FRAG_LEN_4096) {
+            ++mfl;
+        }
+        mbedtls_ssl_conf_max_frag_len(&o->conf, mfl);
+    }
+    #endif
+
     ret = mbedtls_ssl_setup(&o->ssl, &o->conf);
     if (ret != 0) {
         goto cleanup;
@@ -167,6 +218,23 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
 
     mbedtls_ssl_set_bio(&o->ssl, &o->sock, _mbedtls_ssl_send, _mbedtls_ssl_recv, NULL);
 
+    mp_obj_t session_in = args->session.u_obj;
+    #if MICROPY_PY_USSL_SESSION_CACHE
+    if (session_in == mp_const_none && !args->server_side.u_bool && args->server_hostname.u_obj != mp_const_none) {
+        mp_obj_t *entry = session_cache_lookup(args->server_hostname.u_obj);
+        if (entry != NULL) {
+            session_in = entry[1];
+        }
+    }
+    #endif
+    if (session_in != mp_const_none) {
+        mp_obj_ssl_session_t *session = MP_OBJ_TO_PTR(session_in);
+        ret = mbedtls_ssl_set_session(&o->ssl, &session->session);
+        if (ret != 0) {
+            goto cleanup;
+        }
+    }
+
     if (args->key.u_obj != MP_OBJ_NULL) {
         size_t key_len;
         const byte *key = (const byte*)mp_obj_str_get_data(args->key.u_obj, &key_len);
@@ -191,6 +259,15 @@ STATIC mp_obj_ssl_socket_t *socket_new(mp_obj_t sock, struct ssl_args *args) {
         }
     }
 
+    #if MICROPY_PY_USSL_SESSION_CACHE
+    if (!args->server_side.u_bool && args->server_hostname.u_obj != mp_const_none) {
+        mp_obj_t session = mod_ssl_getsession(MP_OBJ_FROM_PTR(o));
+        if (session != mp_const_none) {
+            session_cache_store(args->server_hostname.u_obj, session);
+        }
+    }
+    #endif
+
     return o;
 
 cleanup:
@@ -219,6 +296,42 @@ STATIC mp_obj_t mod_ssl_getpeercert(mp_obj_t o_in, mp_obj_t binary_form) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_ssl_getpeercert_obj, mod_ssl_getpeercert);
 
+STATIC mp_obj_t mod_ssl_getsession(mp_obj_t o_in) {
+    mp_obj_ssl_socket_t *o = MP_OBJ_TO_PTR(o_in);
+    mp_obj_ssl_session_t *session = m_new_obj_with_finaliser(mp_obj_ssl_session_t);
+    session->base.type = &ussl_session_type;
+    mbedtls_ssl_session_init(&session->session);
+    int ret = mbedtls_ssl_get_session(&o->ssl, &session->session);
+    if (ret != 0) {
+        mbedtls_ssl_session_free(&session->session);
+        if (ret == MBEDTLS_ERR_SSL_ALLOC_FAILED) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+        // a server side socket, or no handshake done
+        return mp_const_none;
+    }
+    return MP_OBJ_FROM_PTR(session);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ssl_getsession_obj, mod_ssl_getsession);
+
+STATIC mp_obj_t ssl_session_del(mp_obj_t self_in) {
+    mp_obj_ssl_session_t *self = MP_OBJ_TO_PTR(self_in);
+    mbedtls_ssl_session_free(&self->session);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(ssl_session_del_obj, ssl_session_del);
+
+STATIC const mp_rom_map_elem_t ussl_session_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&ssl_session_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(ussl_session_locals_dict, ussl_session_locals_dict_table);
+
+STATIC const mp_obj_type_t ussl_session_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Session,
+    .locals_dict = (void*)&ussl_session_locals_dict,
+};
+
 STATIC void socket_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_ssl_socket_t *self = MP_OBJ_TO_PTR(self_in);
@@ -293,6 +406,7 @@ STATIC const mp_rom_map_elem_t ussl_socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&mp_stream_close_obj) },
 #endif
     { MP_ROM_QSTR(MP_QSTR_getpeercert), MP_ROM_PTR(&mod_ssl_getpeercert_obj) },
+    { MP_ROM_QSTR(MP_QSTR_getsession), MP_ROM_PTR(&mod_ssl_getsession_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(ussl_socket_locals_dict, ussl_socket_locals_dict_table);
@@ -321,6 +435,8 @@ STATIC mp_obj_t mod_ssl_wrap_socket(size_t n_args, const mp_obj_t *pos_args, mp_
         { MP_QSTR_cert, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
         { MP_QSTR_server_side, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
         { MP_QSTR_server_hostname, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_session, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_max_fragment_len, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
     };
 
     // TODO: Check that sock implements stream protocol
@@ -30,6 +30,7 @@
 #include "py/objlist.h"
 #include "py/runtime.h"
 #include "py/smallint.h"
+#include "extmod/modutimeq.h"
 
 #if MICROPY_PY_UTIMEQ
 
@@ -74,9 +75,7 @@ STATIC bool time_less_than(struct qentry *item, struct qentry *parent) {
     return res && res < (MODULO / 2);
 }
 
-STATIC mp_obj_t utimeq_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
-    mp_arg_check_num(n_args, n_kw, 1, 1, false);
-    mp_uint_t alloc = mp_obj_get_int(args[0]);
+STATIC mp_obj_t utimeq_new(const mp_obj_type_t *type, mp_uint_t alloc) {
     mp_obj_utimeq_t *o = m_new_obj_var(mp_obj_utimeq_t, struct qentry, alloc);
     o->base.type = type;
     memset(o->items, 0, sizeof(*o->items) * alloc);
@@ -85,6 +84,11 @@ STATIC mp_obj_t utimeq_make_new(const mp_obj_type_t *type, size_t n_args, size_t
     return MP_OBJ_FROM_PTR(o);
 }
 
+STATIC mp_obj_t utimeq_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    return utimeq_new(type, mp_obj_get_int(args[0]));
+}
+
 STATIC void heap_siftdown(mp_obj_utimeq_t *heap, mp_uint_t start_pos, mp_uint_t pos) {
     struct qentry item = heap->items[pos];
     while (pos > start_pos) {
@@ -121,38 +125,37 @@ STATIC void heap_siftup(mp_obj_utimeq_t *heap, mp_uint_t pos) {
     heap_siftdown(heap, start_pos, pos);
 }
 
-STATIC mp_obj_t mod_utimeq_heappush(size_t n_args, const mp_obj_t *args) {
-    (void)n_args;
-    mp_obj_t heap_in = args[0];
+void mp_utimeq_push(mp_obj_t heap_in, mp_uint_t time, mp_obj_t callback, mp_obj_t args) {
     mp_obj_utimeq_t *heap = get_heap(heap_in);
     if (heap->len == heap->alloc) {
         mp_raise_msg(&mp_type_IndexError, "queue overflow");
     }
     mp_uint_t l = heap->len;
-    heap->items[l].time = MP_OBJ_SMALL_INT_VALUE(args[1]);
+    heap->items[l].time = time;
     heap->items[l].id = utimeq_id++;
-    heap->items[l].callback = args[2];
-    heap->items[l].args = args[3];
+    heap->items[l].callback = callback;
+    heap->items[l].args = args;
     heap_siftdown(heap, 0, heap->len);
     heap->len++;
-    return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_utimeq_heappush_obj, 4, 4, mod_utimeq_heappush);
 
-STATIC mp_obj_t mod_utimeq_heappop(mp_obj_t heap_in, mp_obj_t list_ref) {
+mp_uint_t mp_utimeq_peektime(mp_obj_t heap_in) {
     mp_obj_utimeq_t *heap = get_heap(heap_in);
     if (heap->len == 0) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "empty heap"));
     }
-    mp_obj_list_t *ret = MP_OBJ_TO_PTR(list_ref);
-    if (!mp_obj_is_type(list_ref, &mp_type_list) || ret->len < 3) {
-        mp_raise_TypeError(NULL);
-    }
+    return heap->items[0].time;
+}
 
+mp_uint_t mp_utimeq_pop(mp_obj_t heap_in, mp_obj_t *callback, mp_obj_t *args) {
+    mp_obj_utimeq_t *heap = get_heap(heap_in);
+    if (heap->len == 0) {
+        nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "empty heap"));
+    }
     struct qentry *item = &heap->items[0];
-    ret->items[0] = MP_OBJ_NEW_SMALL_INT(item->time);
-    ret->items[1] = item->callback;
-    ret->items[2] = item->args;
+    mp_uint_t time = item->time;
+    *callback = item->callback;
+    *args = item->args;
     heap->len -= 1;
     heap->items[0] = heap->items[heap->len];
     heap->items[heap->len].callback = MP_OBJ_NULL; // so we don't retain a pointer
@@ -160,18 +163,34 @@ STATIC mp_obj_t mod_utimeq_heappop(mp_obj_t heap_in, mp_obj_t list_ref) {
     if (heap->len) {
         heap_siftup(heap, 0);
     }
+    return time;
+}
+
+STATIC mp_obj_t mod_utimeq_heappush(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_utimeq_push(args[0], MP_OBJ_SMALL_INT_VALUE(args[1]), args[2], args[3]);
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_utimeq_heappop_obj, mod_utimeq_heappop);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_utimeq_heappush_obj, 4, 4, mod_utimeq_heappush);
 
-STATIC mp_obj_t mod_utimeq_peektime(mp_obj_t heap_in) {
+STATIC mp_obj_t mod_utimeq_heappop(mp_obj_t heap_in, mp_obj_t list_ref) {
     mp_obj_utimeq_t *heap = get_heap(heap_in);
     if (heap->len == 0) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_IndexError, "empty heap"));
     }
+    mp_obj_list_t *ret = MP_OBJ_TO_PTR(list_ref);
+    if (!mp_obj_is_type(list_ref, &mp_type_list) || ret->len < 3) {
+        mp_raise_TypeError(NULL);
+    }
 
-    struct qentry *item = &heap->items[0];
-    return MP_OBJ_NEW_SMALL_INT(item->time);
+    mp_uint_t time = mp_utimeq_pop(heap_in, &ret->items[1], &ret->items[2]);
+    ret->items[0] = MP_OBJ_NEW_SMALL_INT(time);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mod_utimeq_heappop_obj, mod_utimeq_heappop);
+
+STATIC mp_obj_t mod_utimeq_peektime(mp_obj_t heap_in) {
+    return MP_OBJ_NEW_SMALL_INT(mp_utimeq_peektime(heap_in));
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_utimeq_peektime_obj, mod_utimeq_peektime);
 
@@ -222,6 +241,14 @@ STATIC const mp_rom_map_elem_t mp_module_utimeq_globals_table[] = {
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_utimeq_globals, mp_module_utimeq_globals_table);
 
+mp_obj_t mp_utimeq_new(size_t alloc) {
+    return utimeq_new(&utimeq_type, alloc);
+}
+
+size_t mp_utimeq_len(mp_obj_t heap_in) {
+    return get_heap(heap_in)->len;
+}
+
 const mp_obj_module_t mp_module_utimeq = {
     .base = { &mp_type_module },
     .globals = (mp_obj_dict_t*)&mp_module_utimeq_globals,
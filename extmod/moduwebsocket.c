@@ -38,6 +38,12 @@ enum { FRAME_HEADER, FRAME_OPT, PAYLOAD, CONTROL };
 
 enum { BLOCKING_WRITE = 0x80 };
 
+// Frames up to this size (header included) are sent with a single write to
+// the socket from a stack buffer, larger ones from a temporary heap buffer
+// if one is available.  Sending the header separately would leave it as a
+// small unacknowledged segment, which makes TCP hold back the payload.
+#define WEBSOCKET_STACK_FRAME_MAX (128)
+
 typedef struct _mp_obj_websocket_t {
     mp_obj_base_t base;
     mp_obj_t sock;
@@ -57,6 +63,30 @@ typedef struct _mp_obj_websocket_t {
 
 STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode);
 
+// XOR buf with the mask, starting at mask byte pos, a machine word at a time
+// where buf is aligned
+STATIC void websocket_unmask(byte *buf, size_t sz, const byte *mask, byte pos) {
+    while (sz != 0 && ((uintptr_t)buf & (sizeof(mp_uint_t) - 1)) != 0) {
+        *buf++ ^= mask[pos++ & 3];
+        --sz;
+    }
+    if (sz >= sizeof(mp_uint_t)) {
+        // the mask as it lines up with the aligned words, in memory order
+        byte rot[sizeof(mp_uint_t)];
+        for (size_t i = 0; i < sizeof(rot); ++i) {
+            rot[i] = mask[(pos + i) & 3];
+        }
+        mp_uint_t m;
+        memcpy(&m, rot, sizeof(m));
+        for (; sz >= sizeof(mp_uint_t); sz -= sizeof(mp_uint_t), buf += sizeof(mp_uint_t)) {
+            *(mp_uint_t*)buf ^= m;
+        }
+    }
+    while (sz--) {
+        *buf++ ^= mask[pos++ & 3];
+    }
+}
+
 STATIC mp_obj_t websocket_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 1, 2, false);
     mp_get_stream_raise(args[0], MP_STREAM_OP_READ | MP_STREAM_OP_WRITE | MP_STREAM_OP_IOCTL);
@@ -175,10 +205,8 @@ STATIC mp_uint_t websocket_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
                     return out_sz;
                 }
 
-                sz = out_sz;
-                for (byte *p = buf; sz--; p++) {
-                    *p ^= self->mask[self->mask_pos++ & 3];
-                }
+                websocket_unmask(buf, out_sz, self->mask, self->mask_pos);
+                self->mask_pos += out_sz;
 
                 self->msg_sz -= out_sz;
                 if (self->msg_sz == 0) {
@@ -238,9 +266,28 @@ STATIC mp_uint_t websocket_write(mp_obj_t self_in, const void *buf, mp_uint_t si
         mp_call_method_n_kw(1, 0, dest);
     }
 
-    mp_uint_t out_sz = mp_stream_write_exactly(self->sock, header, hdr_sz, errcode);
-    if (*errcode == 0) {
-        out_sz = mp_stream_write_exactly(self->sock, buf, size, errcode);
+    byte stack_frame[WEBSOCKET_STACK_FRAME_MAX];
+    byte *frame = stack_frame;
+    if (hdr_sz + size > sizeof(stack_frame)) {
+        // may be called with the heap locked (eg dupterm output), so fall
+        // back to two writes instead of raising
+        frame = m_new_maybe(byte, hdr_sz + size);
+    }
+
+    mp_uint_t out_sz;
+    if (frame != NULL) {
+        memcpy(frame, header, hdr_sz);
+        memcpy(frame + hdr_sz, buf, size);
+        out_sz = mp_stream_write_exactly(self->sock, frame, hdr_sz + size, errcode);
+        if (frame != stack_frame) {
+            m_del(byte, frame, hdr_sz + size);
+        }
+        out_sz = out_sz < (mp_uint_t)hdr_sz ? 0 : out_sz - hdr_sz;
+    } else {
+        out_sz = mp_stream_write_exactly(self->sock, header, hdr_sz, errcode);
+        if (*errcode == 0) {
+            out_sz = mp_stream_write_exactly(self->sock, buf, size, errcode);
+        }
     }
 
     if (self->opts & BLOCKING_WRITE) {
@@ -264,6 +311,8 @@ STATIC mp_uint_t websocket_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t
             return 0;
         case MP_STREAM_GET_DATA_OPTS:
             return self->ws_flags & FRAME_OPCODE_MASK;
+        case MP_STREAM_GET_DATA_AVAIL:
+            return self->state == PAYLOAD ? self->msg_sz : 0;
         case MP_STREAM_SET_DATA_OPTS: {
             int cur = self->opts & FRAME_OPCODE_MASK;
             self->opts = (self->opts & ~FRAME_OPCODE_MASK) | (arg & FRAME_OPCODE_MASK);
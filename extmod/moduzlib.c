@@ -30,9 +30,11 @@
 #include "py/runtime.h"
 #include "py/stream.h"
 #include "py/mperrno.h"
+#include "py/binary.h"
 
 #if MICROPY_PY_UZLIB
 
+#define UZLIB_CONF_FAST_BITS MICROPY_PY_UZLIB_FAST_BITS
 #include "uzlib/tinf.h"
 
 #if 0 // print debugging info
@@ -46,6 +48,8 @@ typedef struct _mp_obj_decompio_t {
     mp_obj_t src_stream;
     TINF_DATA decomp;
     bool eof;
+    byte *src_buf;
+    size_t src_buf_size;
 } mp_obj_decompio_t;
 
 STATIC int read_src_stream(TINF_DATA *data) {
@@ -55,19 +59,21 @@ STATIC int read_src_stream(TINF_DATA *data) {
 
     const mp_stream_p_t *stream = mp_get_stream(self->src_stream);
     int err;
-    byte c;
-    mp_uint_t out_sz = stream->read(self->src_stream, &c, 1, &err);
+    mp_uint_t out_sz = stream->read(self->src_stream, self->src_buf, self->src_buf_size, &err);
     if (out_sz == MP_STREAM_ERROR) {
         mp_raise_OSError(err);
     }
     if (out_sz == 0) {
         nlr_raise(mp_obj_new_exception(&mp_type_EOFError));
     }
-    return c;
+    // the rest of what was read is taken from the buffer before calling here again
+    data->source = self->src_buf + 1;
+    data->source_limit = self->src_buf + out_sz;
+    return self->src_buf[0];
 }
 
 STATIC mp_obj_t decompio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
-    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    mp_arg_check_num(n_args, n_kw, 1, 3, false);
     mp_get_stream_raise(args[0], MP_STREAM_OP_READ);
     mp_obj_decompio_t *o = m_new_obj(mp_obj_decompio_t);
     o->base.type = type;
@@ -76,6 +82,19 @@ STATIC mp_obj_t decompio_make_new(const mp_obj_type_t *type, size_t n_args, size
     o->src_stream = args[0];
     o->eof = false;
 
+    // By default the source is read a byte at a time, so that no more of it
+    // is consumed than the compressed data.  A larger bufsize reads it in
+    // chunks, which is faster but may read past the end of the data.
+    mp_int_t bufsize = 1;
+    if (n_args > 2) {
+        bufsize = mp_obj_get_int(args[2]);
+        if (bufsize < 1) {
+            mp_raise_ValueError(NULL);
+        }
+    }
+    o->src_buf = m_new(byte, bufsize);
+    o->src_buf_size = bufsize;
+
     mp_int_t dict_opt = 0;
     int dict_sz;
     if (n_args > 1) {
@@ -94,7 +113,8 @@ STATIC mp_obj_t decompio_make_new(const mp_obj_type_t *type, size_t n_args, size
 header_error:
             mp_raise_ValueError("compression header");
         }
-        dict_sz = 1 << dict_opt;
+        // the header gives the base 2 log of the window size, minus 8
+        dict_sz = 1 << (dict_opt + 8);
     } else {
         dict_sz = 1 << -dict_opt;
     }
@@ -182,11 +202,13 @@ STATIC mp_obj_t mod_uzlib_decompress(size_t n_args, const mp_obj_t *args) {
         if (st == TINF_DONE) {
             break;
         }
+        // grow the buffer in proportion to its size, to limit the copying
         size_t offset = decomp->dest - dest_buf;
-        dest_buf = m_renew(byte, dest_buf, dest_buf_size, dest_buf_size + 256);
-        dest_buf_size += 256;
+        size_t grow = dest_buf_size / 2 < 256 ? 256 : dest_buf_size / 2;
+        dest_buf = m_renew(byte, dest_buf, dest_buf_size, dest_buf_size + grow);
+        dest_buf_size += grow;
         decomp->dest = dest_buf + offset;
-        decomp->dest_limit = decomp->dest + 256;
+        decomp->dest_limit = decomp->dest + grow;
     }
 
     mp_uint_t final_sz = decomp->dest - dest_buf;
@@ -201,10 +223,202 @@ error:
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_decompress_obj, 1, 3, mod_uzlib_decompress);
 
+#if MICROPY_PY_UZLIB_COMPRESS
+
+// The wbits argument of CompressIO and compress selects the format and window
+// size as for decompression: 9 to 15 for zlib, -9 to -15 for raw deflate and
+// 25 to 31 for gzip.  Memory used is about 4 << abs(wbits) bytes.
+#define UZLIB_COMPRESS_WBITS_DEFAULT (10)
+
+typedef struct _mp_obj_compio_t {
+    mp_obj_base_t base;
+    // output goes to this stream, or to vstr if it's MP_OBJ_NULL
+    mp_obj_t dest_stream;
+    vstr_t vstr;
+    struct uzlib_comp comp;
+    char format; // 'z' zlib, 'g' gzip, 'r' raw deflate
+    bool closed;
+    uint32_t checksum;
+    uint32_t in_len;
+    byte outbuf[64];
+} mp_obj_compio_t;
+
+STATIC void compio_write_out(mp_obj_compio_t *self, const byte *buf, size_t len) {
+    if (self->dest_stream == MP_OBJ_NULL) {
+        vstr_add_strn(&self->vstr, (const char*)buf, len);
+    } else {
+        mp_stream_write(self->dest_stream, buf, len, MP_STREAM_RW_WRITE);
+    }
+}
+
+STATIC void compio_flush_cb(struct Outbuf *out) {
+    byte *p = (void*)out;
+    p -= offsetof(mp_obj_compio_t, comp.out);
+    mp_obj_compio_t *self = (mp_obj_compio_t*)p;
+    compio_write_out(self, out->outbuf, out->outlen);
+    out->outlen = 0;
+}
+
+STATIC void compio_init(mp_obj_compio_t *self, mp_int_t wbits) {
+    if (wbits >= 25 && wbits <= 31) {
+        self->format = 'g';
+        wbits -= 16;
+    } else if (wbits >= -15 && wbits <= -9) {
+        self->format = 'r';
+        wbits = -wbits;
+    } else if (wbits >= 9 && wbits <= 15) {
+        self->format = 'z';
+    } else {
+        mp_raise_ValueError(NULL);
+    }
+
+    struct uzlib_comp *c = &self->comp;
+    memset(c, 0, sizeof(*c));
+    c->out.outbuf = self->outbuf;
+    c->out.outsize = sizeof(self->outbuf);
+    c->out.flush_cb = compio_flush_cb;
+    c->wbits = wbits;
+    c->hash_bits = wbits - 1;
+    c->chain_limit = 8;
+    c->window = m_new(uint8_t, 2 << wbits);
+    c->hash_table = m_new(uzlib_hash_entry_t, 1 << c->hash_bits);
+    c->hash_chain = m_new(uzlib_hash_entry_t, 1 << wbits);
+    self->closed = false;
+    self->in_len = 0;
+
+    if (self->format == 'z') {
+        byte header[2] = {((wbits - 8) << 4) | 8, 0};
+        header[1] = 31 - (header[0] << 8) % 31;
+        compio_write_out(self, header, sizeof(header));
+        self->checksum = 1;
+    } else if (self->format == 'g') {
+        static const byte header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 0xff};
+        compio_write_out(self, header, sizeof(header));
+        self->checksum = ~0;
+    }
+    uzlib_compress_init(c);
+}
+
+STATIC void compio_write_data(mp_obj_compio_t *self, const void *buf, size_t len) {
+    if (self->format == 'z') {
+        self->checksum = uzlib_adler32(buf, len, self->checksum);
+    } else if (self->format == 'g') {
+        self->checksum = uzlib_crc32(buf, len, self->checksum);
+    }
+    self->in_len += len;
+    uzlib_compress(&self->comp, buf, len);
+}
+
+STATIC void compio_finish(mp_obj_compio_t *self) {
+    if (self->closed) {
+        return;
+    }
+    self->closed = true;
+    uzlib_compress_finish(&self->comp);
+    compio_flush_cb(&self->comp.out);
+    byte trailer[8];
+    if (self->format == 'z') {
+        mp_binary_set_int(4, true, trailer, self->checksum);
+        compio_write_out(self, trailer, 4);
+    } else if (self->format == 'g') {
+        mp_binary_set_int(4, false, trailer, ~self->checksum);
+        mp_binary_set_int(4, false, trailer + 4, self->in_len);
+        compio_write_out(self, trailer, 8);
+    }
+    struct uzlib_comp *c = &self->comp;
+    m_del(uint8_t, c->window, 2 << c->wbits);
+    m_del(uzlib_hash_entry_t, c->hash_table, 1 << c->hash_bits);
+    m_del(uzlib_hash_entry_t, c->hash_chain, 1 << c->wbits);
+    c->window = NULL;
+    c->hash_table = NULL;
+    c->hash_chain = NULL;
+}
+
+STATIC mp_obj_t compio_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 2, false);
+    mp_get_stream_raise(args[0], MP_STREAM_OP_WRITE);
+    mp_obj_compio_t *o = m_new_obj(mp_obj_compio_t);
+    o->base.type = type;
+    o->dest_stream = args[0];
+    compio_init(o, n_args > 1 ? mp_obj_get_int(args[1]) : UZLIB_COMPRESS_WBITS_DEFAULT);
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC mp_uint_t compio_write(mp_obj_t o_in, const void *buf, mp_uint_t size, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    if (o->closed) {
+        *errcode = MP_EINVAL;
+        return MP_STREAM_ERROR;
+    }
+    compio_write_data(o, buf, size);
+    return size;
+}
+
+STATIC mp_uint_t compio_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    mp_obj_compio_t *o = MP_OBJ_TO_PTR(o_in);
+    (void)arg;
+    if (request == MP_STREAM_CLOSE) {
+        // finish the compressed data; the destination stream is left open
+        compio_finish(o);
+        return 0;
+    }
+    *errcode = MP_EINVAL;
+    return MP_STREAM_ERROR;
+}
+
+STATIC mp_obj_t compio___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return mp_stream_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(compio___exit___obj, 4, 4, compio___exit__);
+
+STATIC const mp_rom_map_elem_t compio_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&compio___exit___obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(compio_locals_dict, compio_locals_dict_table);
+
+STATIC const mp_stream_p_t compio_stream_p = {
+    .write = compio_write,
+    .ioctl = compio_ioctl,
+};
+
+STATIC const mp_obj_type_t compio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_CompressIO,
+    .make_new = compio_make_new,
+    .protocol = &compio_stream_p,
+    .locals_dict = (void*)&compio_locals_dict,
+};
+
+STATIC mp_obj_t mod_uzlib_compress(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+    mp_obj_compio_t *o = m_new_obj(mp_obj_compio_t);
+    o->dest_stream = MP_OBJ_NULL;
+    vstr_init(&o->vstr, bufinfo.len / 2 + 16);
+    compio_init(o, n_args > 1 ? mp_obj_get_int(args[1]) : UZLIB_COMPRESS_WBITS_DEFAULT);
+    compio_write_data(o, bufinfo.buf, bufinfo.len);
+    compio_finish(o);
+    mp_obj_t res = mp_obj_new_str_from_vstr(&mp_type_bytes, &o->vstr);
+    m_del_obj(mp_obj_compio_t, o);
+    return res;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mod_uzlib_compress_obj, 1, 2, mod_uzlib_compress);
+
+#endif // MICROPY_PY_UZLIB_COMPRESS
+
 STATIC const mp_rom_map_elem_t mp_module_uzlib_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_uzlib) },
     { MP_ROM_QSTR(MP_QSTR_decompress), MP_ROM_PTR(&mod_uzlib_decompress_obj) },
     { MP_ROM_QSTR(MP_QSTR_DecompIO), MP_ROM_PTR(&decompio_type) },
+    #if MICROPY_PY_UZLIB_COMPRESS
+    { MP_ROM_QSTR(MP_QSTR_compress), MP_ROM_PTR(&mod_uzlib_compress_obj) },
+    { MP_ROM_QSTR(MP_QSTR_CompressIO), MP_ROM_PTR(&compio_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_uzlib_globals, mp_module_uzlib_globals_table);
@@ -222,5 +436,9 @@ const mp_obj_module_t mp_module_uzlib = {
 #include "uzlib/tinfgzip.c"
 #include "uzlib/adler32.c"
 #include "uzlib/crc32.c"
+#if MICROPY_PY_UZLIB_COMPRESS
+#include "uzlib/defl_static.c"
+#include "uzlib/lz77.c"
+#endif
 
 #endif // MICROPY_PY_UZLIB
@@ -57,6 +57,15 @@ struct webrepl_file {
 enum { PUT_FILE = 1, GET_FILE, GET_VER };
 enum { STATE_PASSWD, STATE_NORMAL };
 
+// File data is moved in chunks of up to this many bytes.  Each GET chunk
+// waits for an acknowledgement from the client, so the chunk size bounds
+// the transfer rate to about one chunk per round trip.
+#define WEBREPL_CHUNK_SIZE (1024)
+
+// Shared by PUT and GET, only one of which can be in progress; a GET chunk
+// is preceded by its 2-byte length
+STATIC byte webrepl_filebuf[2 + WEBREPL_CHUNK_SIZE];
+
 typedef struct _mp_obj_webrepl_t {
     mp_obj_base_t base;
     mp_obj_t sock;
@@ -119,9 +128,9 @@ STATIC void check_file_op_finished(mp_obj_webrepl_t *self) {
 
 STATIC int write_file_chunk(mp_obj_webrepl_t *self) {
     const mp_stream_p_t *file_stream = mp_get_stream(self->cur_file);
-    byte readbuf[2 + 256];
+    byte *readbuf = webrepl_filebuf;
     int err;
-    mp_uint_t out_sz = file_stream->read(self->cur_file, readbuf + 2, sizeof(readbuf) - 2, &err);
+    mp_uint_t out_sz = file_stream->read(self->cur_file, readbuf + 2, WEBREPL_CHUNK_SIZE, &err);
     if (out_sz == MP_STREAM_ERROR) {
         return out_sz;
     }
@@ -186,11 +195,11 @@ STATIC mp_uint_t webrepl_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *
 }
 
 STATIC mp_uint_t _webrepl_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
-    // We know that os.dupterm always calls with size = 1
-    assert(size == 1);
+    // os.dupterm may ask for several bytes, but only REPL text is taken in
+    // bulk; the password and file transfer records are parsed a byte at a time
     mp_obj_webrepl_t *self = self_in;
     const mp_stream_p_t *sock_stream = mp_get_stream(self->sock);
-    mp_uint_t out_sz = sock_stream->read(self->sock, buf, size, errcode);
+    mp_uint_t out_sz = sock_stream->read(self->sock, buf, 1, errcode);
     //DEBUG_printf("webrepl: Read %d initial bytes from websocket\n", out_sz);
     if (out_sz == 0 || out_sz == MP_STREAM_ERROR) {
         return out_sz;
@@ -219,6 +228,15 @@ STATIC mp_uint_t _webrepl_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
     // If last read data belonged to text record (== REPL)
     int err;
     if (sock_stream->ioctl(self->sock, MP_STREAM_GET_DATA_OPTS, 0, &err) == 1) {
+        // Take the rest of the text frame that has already arrived, but
+        // never read past it into what may be a binary frame
+        mp_uint_t avail = sock_stream->ioctl(self->sock, MP_STREAM_GET_DATA_AVAIL, 0, &err);
+        if (size > 1 && avail != 0 && avail != MP_STREAM_ERROR) {
+            mp_uint_t sz = sock_stream->read(self->sock, (byte*)buf + 1, MIN(size - 1, avail), &err);
+            if (sz != 0 && sz != MP_STREAM_ERROR) {
+                out_sz += sz;
+            }
+        }
         return out_sz;
     }
 
@@ -246,14 +264,24 @@ STATIC mp_uint_t _webrepl_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
     }
 
     if (self->data_to_recv != 0) {
-        static byte filebuf[512];
+        byte *filebuf = webrepl_filebuf;
         filebuf[0] = *(byte*)buf;
         mp_uint_t buf_sz = 1;
-        if (--self->data_to_recv != 0) {
-            size_t to_read = MIN(sizeof(filebuf) - 1, self->data_to_recv);
-            mp_uint_t sz = sock_stream->read(self->sock, filebuf + 1, to_read, errcode);
+        --self->data_to_recv;
+        // Take as much of the file data as has already arrived directly into
+        // the buffer, rather than a byte per call from dupterm
+        while (self->data_to_recv != 0 && buf_sz < WEBREPL_CHUNK_SIZE) {
+            size_t to_read = MIN(WEBREPL_CHUNK_SIZE - buf_sz, self->data_to_recv);
+            mp_uint_t sz = sock_stream->read(self->sock, filebuf + buf_sz, to_read, errcode);
             if (sz == MP_STREAM_ERROR) {
-                return sz;
+                if (!mp_is_nonblocking_error(*errcode)) {
+                    return sz;
+                }
+                // write out what has been received so far
+                break;
+            }
+            if (sz == 0) {
+                break;
             }
             self->data_to_recv -= sz;
             buf_sz += sz;
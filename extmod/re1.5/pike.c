@@ -0,0 +1,198 @@
+// Copyright 2007-2009 Russ Cox.  All Rights Reserved.
+// Use of this source code is governed by a BSD-style
+// license that can be found in the LICENSE file.
+
+// Pike VM, as in re1's pike.c, running the re1.5 bytecode.  All threads are
+// advanced in lock step over the subject, so matching takes time linear in
+// the subject length, and threads are kept in priority order so the match
+// found is the same one a backtracking matcher would find.
+
+#include "re1.5.h"
+
+#ifndef re1_5_alloc
+#define re1_5_alloc(n) malloc(n)
+#define re1_5_free(p, n) free(p)
+#endif
+
+#ifndef re1_5_memfind
+static const char *
+re1_5_memfind(const char *s, int n, const char *lit, int litlen)
+{
+	for(; n >= litlen; s++, n--)
+		if(memcmp(s, lit, litlen) == 0)
+			return s;
+	return nil;
+}
+#endif
+
+enum {
+	MAXLIT = 16
+};
+
+typedef struct ThreadList ThreadList;
+typedef struct PikeState PikeState;
+
+struct ThreadList
+{
+	int n;
+	// each thread is a pc followed by nsubp capture pointers
+	const char **t;
+};
+
+struct PikeState
+{
+	Subject *input;
+	char *insts;
+	int nsubp;
+	int gen;
+	// generation in which each instruction was last added to a list
+	int *mark;
+};
+
+static void
+addthread(PikeState *s, ThreadList *l, char *pc, const char *sp, const char **subp)
+{
+	const char *old;
+	const char **t;
+	int off;
+
+	re1_5_stack_chk();
+
+	if(s->mark[pc - s->insts] == s->gen)
+		return;
+	s->mark[pc - s->insts] = s->gen;
+
+	switch(*pc) {
+	case Jmp:
+		off = (signed char)pc[1];
+		addthread(s, l, pc + 2 + off, sp, subp);
+		return;
+	case Split:
+		off = (signed char)pc[1];
+		addthread(s, l, pc + 2, sp, subp);
+		addthread(s, l, pc + 2 + off, sp, subp);
+		return;
+	case RSplit:
+		off = (signed char)pc[1];
+		addthread(s, l, pc + 2 + off, sp, subp);
+		addthread(s, l, pc + 2, sp, subp);
+		return;
+	case Save:
+		off = (unsigned char)pc[1];
+		if(off >= s->nsubp) {
+			addthread(s, l, pc + 2, sp, subp);
+			return;
+		}
+		old = subp[off];
+		subp[off] = sp;
+		addthread(s, l, pc + 2, sp, subp);
+		subp[off] = old;
+		return;
+	case Bol:
+		if(sp == s->input->begin)
+			addthread(s, l, pc + 1, sp, subp);
+		return;
+	case Eol:
+		if(sp == s->input->end)
+			addthread(s, l, pc + 1, sp, subp);
+		return;
+	}
+
+	// a consumer or Match, which waits in the list
+	t = l->t + l->n++ * (1 + s->nsubp);
+	t[0] = pc;
+	memcpy(t + 1, subp, s->nsubp * sizeof(*subp));
+}
+
+int
+re1_5_pikevm(ByteProg *prog, Subject *input, const char **subp, int nsubp, int is_anchored)
+{
+	// unanchored search is done by seeding a new thread at each position,
+	// rather than with the prefix code, so the prefix is always skipped
+	char *start = HANDLE_ANCHORED(prog->insts, 1);
+	char lit[MAXLIT];
+	int litlen = 0;
+	char *pc;
+
+	// find the literal that every match must start with, and whether a
+	// match can only start at the beginning of the subject
+	for(pc = start; *pc == Save; pc += 2)
+		;
+	if(*pc == Bol)
+		is_anchored = 1;
+	for(; *pc == Char && litlen < MAXLIT; pc += 2)
+		lit[litlen++] = pc[1];
+
+	int tsize = 1 + nsubp;
+	size_t size = (2 * prog->len * tsize + nsubp) * sizeof(const char*) + prog->bytelen * sizeof(int);
+	const char **mem = (const char**)re1_5_alloc(size);
+	ThreadList clist = {0, mem};
+	ThreadList nlist = {0, mem + prog->len * tsize};
+	const char **caps = mem + 2 * prog->len * tsize;
+	PikeState s = {input, prog->insts, nsubp, 0, (int*)(caps + nsubp)};
+	memset(caps, 0, nsubp * sizeof(*caps));
+	memset(s.mark, 0xff, prog->bytelen * sizeof(int));
+
+	int matched = 0;
+	const char *sp = input->begin;
+	for(;;) {
+		if(!matched && (!is_anchored || sp == input->begin)) {
+			if(clist.n == 0 && litlen > 0 && !is_anchored) {
+				// nothing in progress, so skip to where a match could start
+				sp = re1_5_memfind(sp, input->end - sp, lit, litlen);
+				if(sp == nil)
+					break;
+				s.gen++;
+			}
+			// a match starting here has lower priority than those in progress
+			addthread(&s, &clist, start, sp, caps);
+		}
+		if(clist.n == 0)
+			break;
+
+		s.gen++;
+		nlist.n = 0;
+		for(int i = 0; i < clist.n; i++) {
+			const char **t = clist.t + i * tsize;
+			pc = (char*)t[0];
+			if(*pc == Match) {
+				// lower priority threads can't give the match, so cut them off
+				memcpy(subp, t + 1, nsubp * sizeof(*subp));
+				matched = 1;
+				break;
+			}
+			if(sp >= input->end)
+				continue;
+			switch(*pc) {
+			case Char:
+				if(*sp == pc[1])
+					addthread(&s, &nlist, pc + 2, sp + 1, t + 1);
+				break;
+			case Any:
+				addthread(&s, &nlist, pc + 1, sp + 1, t + 1);
+				break;
+			case Class:
+			case ClassNot:
+				if(_re1_5_classmatch(pc + 1, sp))
+					addthread(&s, &nlist, pc + 2 + *(unsigned char*)(pc + 1) * 2, sp + 1, t + 1);
+				break;
+			case NamedClass:
+				if(_re1_5_namedclassmatch(pc + 1, sp))
+					addthread(&s, &nlist, pc + 2, sp + 1, t + 1);
+				break;
+			default:
+				re1_5_fatal("pikevm");
+			}
+		}
+		if(sp >= input->end)
+			break;
+
+		ThreadList tmp = clist;
+		clist = nlist;
+		nlist = tmp;
+		sp++;
+	}
+
+	re1_5_free((char*)mem, size);
+	return matched;
+}
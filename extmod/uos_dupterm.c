@@ -36,6 +36,8 @@
 
 #if MICROPY_PY_OS_DUPTERM
 
+#define DUPTERM_TX_COOKED_BUF_SIZE (64)
+
 void mp_uos_deactivate(size_t dupterm_idx, const char *msg, mp_obj_t exc) {
     mp_obj_t term = MP_STATE_VM(dupterm_objs[dupterm_idx]);
     MP_STATE_VM(dupterm_objs[dupterm_idx]) = MP_OBJ_NULL;
@@ -93,6 +95,53 @@ int mp_uos_dupterm_rx_chr(void) {
     return -1;
 }
 
+// Reads as much as the first ready stream gives in one call, up to len bytes.
+// Returns the number of bytes left after taking out interrupt chars (which
+// may be 0), or -1 if no stream had anything.
+int mp_uos_dupterm_rx_strn(byte *buf, size_t len) {
+    for (size_t idx = 0; idx < MICROPY_PY_OS_DUPTERM; ++idx) {
+        if (MP_STATE_VM(dupterm_objs[idx]) == MP_OBJ_NULL) {
+            continue;
+        }
+
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            int errcode;
+            const mp_stream_p_t *stream_p = mp_get_stream(MP_STATE_VM(dupterm_objs[idx]));
+            mp_uint_t out_sz = stream_p->read(MP_STATE_VM(dupterm_objs[idx]), buf, len, &errcode);
+            if (out_sz == 0) {
+                nlr_pop();
+                mp_uos_deactivate(idx, "dupterm: EOF received, deactivating\n", MP_OBJ_NULL);
+            } else if (out_sz == MP_STREAM_ERROR) {
+                // errcode is valid
+                if (mp_is_nonblocking_error(errcode)) {
+                    nlr_pop();
+                } else {
+                    mp_raise_OSError(errcode);
+                }
+            } else {
+                nlr_pop();
+                // Take out any interrupt chars, keeping what was typed around them
+                size_t n = 0;
+                for (size_t i = 0; i < out_sz; ++i) {
+                    if (buf[i] == mp_interrupt_char) {
+                        // Signal keyboard interrupt to be raised as soon as the VM resumes
+                        mp_keyboard_interrupt();
+                    } else {
+                        buf[n++] = buf[i];
+                    }
+                }
+                return n;
+            }
+        } else {
+            mp_uos_deactivate(idx, "dupterm: Exception in read() method, deactivating: ", MP_OBJ_FROM_PTR(nlr.ret_val));
+        }
+    }
+
+    // No chars available
+    return -1;
+}
+
 void mp_uos_dupterm_tx_strn(const char *str, size_t len) {
     for (size_t idx = 0; idx < MICROPY_PY_OS_DUPTERM; ++idx) {
         if (MP_STATE_VM(dupterm_objs[idx]) == MP_OBJ_NULL) {
@@ -108,6 +157,33 @@ void mp_uos_dupterm_tx_strn(const char *str, size_t len) {
     }
 }
 
+// Converts "\n" to "\r\n" through a small buffer, so a stream such as a
+// websocket gets one write per chunk rather than one per line and newline
+void mp_uos_dupterm_tx_strn_cooked(const char *str, size_t len) {
+    size_t idx = 0;
+    while (idx < MICROPY_PY_OS_DUPTERM && MP_STATE_VM(dupterm_objs[idx]) == MP_OBJ_NULL) {
+        ++idx;
+    }
+    if (idx == MICROPY_PY_OS_DUPTERM) {
+        return;
+    }
+    char buf[DUPTERM_TX_COOKED_BUF_SIZE];
+    size_t n = 0;
+    while (len--) {
+        if (n >= sizeof(buf) - 1) {
+            mp_uos_dupterm_tx_strn(buf, n);
+            n = 0;
+        }
+        if (*str == '\n') {
+            buf[n++] = '\r';
+        }
+        buf[n++] = *str++;
+    }
+    if (n != 0) {
+        mp_uos_dupterm_tx_strn(buf, n);
+    }
+}
+
 STATIC mp_obj_t mp_uos_dupterm(size_t n_args, const mp_obj_t *args) {
     mp_int_t idx = 0;
     if (n_args == 2) {
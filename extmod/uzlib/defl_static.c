@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) uzlib authors
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+/*
+ * Deflate encoder using the static Huffman codes of RFC 1951.  Output goes
+ * into out->outbuf; when that is full out->flush_cb is called to make room.
+ */
+
+#include <assert.h>
+#include "uzlib.h"
+
+static void out_byte(struct Outbuf *out, unsigned char c)
+{
+   if (out->outlen == out->outsize) {
+      out->flush_cb(out);
+      assert(out->outlen < out->outsize);
+   }
+   out->outbuf[out->outlen++] = c;
+}
+
+void outbits(struct Outbuf *out, unsigned long bits, int nbits)
+{
+   assert(out->noutbits + nbits <= 32);
+   out->outbits |= bits << out->noutbits;
+   out->noutbits += nbits;
+   while (out->noutbits >= 8) {
+      out_byte(out, out->outbits & 0xff);
+      out->outbits >>= 8;
+      out->noutbits -= 8;
+   }
+}
+
+/* Huffman codes are sent most significant bit first */
+static unsigned int reverse_bits(unsigned int code, int nbits)
+{
+   unsigned int rev = 0;
+   while (nbits--) {
+      rev = (rev << 1) | (code & 1);
+      code >>= 1;
+   }
+   return rev;
+}
+
+static void out_litlen(struct Outbuf *out, unsigned int sym)
+{
+   if (sym < 144) {
+      outbits(out, reverse_bits(0x30 + sym, 8), 8);
+   } else if (sym < 256) {
+      outbits(out, reverse_bits(0x190 + sym - 144, 9), 9);
+   } else if (sym < 280) {
+      outbits(out, reverse_bits(sym - 256, 7), 7);
+   } else {
+      outbits(out, reverse_bits(0xc0 + sym - 280, 8), 8);
+   }
+}
+
+static const unsigned short defl_length_base[29] = {
+   3, 4, 5, 6, 7, 8, 9, 10,
+   11, 13, 15, 17, 19, 23, 27, 31,
+   35, 43, 51, 59, 67, 83, 99, 115,
+   131, 163, 195, 227, 258
+};
+
+static const unsigned short defl_dist_base[30] = {
+   1, 2, 3, 4, 5, 7, 9, 13,
+   17, 25, 33, 49, 65, 97, 129, 193,
+   257, 385, 513, 769, 1025, 1537, 2049, 3073,
+   4097, 6145, 8193, 12289, 16385, 24577
+};
+
+void zlib_start_block(struct Outbuf *out)
+{
+   outbits(out, 1, 1); /* final block */
+   outbits(out, 1, 2); /* static Huffman codes */
+}
+
+void zlib_finish_block(struct Outbuf *out)
+{
+   out_litlen(out, 256); /* end of block */
+   outbits(out, 0, 7); /* pad to a byte boundary */
+   out->outbits = 0;
+   out->noutbits = 0;
+}
+
+void zlib_literal(struct Outbuf *out, unsigned char c)
+{
+   out_litlen(out, c);
+}
+
+void zlib_match(struct Outbuf *out, int distance, int len)
+{
+   int code;
+
+   assert(len >= 3 && len <= 258);
+   assert(distance >= 1 && distance <= 32768);
+
+   if (len == 258) {
+      code = 28;
+   } else {
+      for (code = 27; defl_length_base[code] > len; --code);
+   }
+   out_litlen(out, 257 + code);
+   if (code >= 8 && code < 28) {
+      outbits(out, len - defl_length_base[code], (code - 4) >> 2);
+   }
+
+   for (code = 29; defl_dist_base[code] > distance; --code);
+   outbits(out, reverse_bits(code, 5), 5);
+   if (code >= 4) {
+      outbits(out, distance - defl_dist_base[code], (code - 2) >> 1);
+   }
+}
@@ -36,6 +36,8 @@ struct Outbuf {
     unsigned long outbits;
     int noutbits;
     int comp_disabled;
+    /* called when outbuf is full, to consume outlen bytes from it */
+    void (*flush_cb)(struct Outbuf *out);
 };
 
 void outbits(struct Outbuf *out, unsigned long bits, int nbits);
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) uzlib authors
+ *
+ * This software is provided 'as-is', without any express
+ * or implied warranty.  In no event will the authors be
+ * held liable for any damages arising from the use of
+ * this software.
+ *
+ * Permission is granted to anyone to use this software
+ * for any purpose, including commercial applications,
+ * and to alter it and redistribute it freely, subject to
+ * the following restrictions:
+ *
+ * 1. The origin of this software must not be
+ *    misrepresented; you must not claim that you
+ *    wrote the original software. If you use this
+ *    software in a product, an acknowledgment in
+ *    the product documentation would be appreciated
+ *    but is not required.
+ *
+ * 2. Altered source versions must be plainly marked
+ *    as such, and must not be misrepresented as
+ *    being the original software.
+ *
+ * 3. This notice may not be removed or altered from
+ *    any source distribution.
+ */
+
+/*
+ * Streaming LZ77 match finder with hash chains, producing a single static
+ * Huffman deflate block via defl_static.c.
+ */
+
+#include <string.h>
+#include "uzlib.h"
+
+#define MIN_MATCH 3
+#define MAX_MATCH 258
+
+static unsigned int lz77_hash(struct uzlib_comp *c, const uint8_t *p)
+{
+   uint32_t v = ((uint32_t)p[0] << 16) | (p[1] << 8) | p[2];
+   return (v * 2654435761u) >> (32 - c->hash_bits);
+}
+
+static void lz77_insert(struct uzlib_comp *c, unsigned int pos)
+{
+   unsigned int h = lz77_hash(c, c->window + pos);
+   c->hash_chain[pos & ((1 << c->wbits) - 1)] = c->hash_table[h];
+   c->hash_table[h] = pos;
+}
+
+/* Move the second half of the window down to make room for more input */
+static void lz77_slide(struct uzlib_comp *c)
+{
+   unsigned int wsize = 1 << c->wbits;
+   unsigned int i;
+   memmove(c->window, c->window + wsize, wsize);
+   c->win_len -= wsize;
+   c->pos -= wsize;
+   for (i = 0; i < (1u << c->hash_bits); i++) {
+      c->hash_table[i] = c->hash_table[i] >= wsize ? c->hash_table[i] - wsize : 0;
+   }
+   for (i = 0; i < wsize; i++) {
+      c->hash_chain[i] = c->hash_chain[i] >= wsize ? c->hash_chain[i] - wsize : 0;
+   }
+}
+
+/* Compress input in the window, leaving at least lookahead bytes */
+static void lz77_run(struct uzlib_comp *c, unsigned int lookahead)
+{
+   unsigned int wsize = 1 << c->wbits;
+   const uint8_t *w = c->window;
+
+   while (c->win_len - c->pos > lookahead) {
+      unsigned int pos = c->pos;
+      unsigned int avail = c->win_len - pos;
+      unsigned int best_len = MIN_MATCH - 1;
+      unsigned int best_dist = 0;
+
+      if (avail >= MIN_MATCH) {
+         unsigned int max_len = avail < MAX_MATCH ? avail : MAX_MATCH;
+         unsigned int cand = c->hash_table[lz77_hash(c, w + pos)];
+         unsigned int limit = c->chain_limit;
+         lz77_insert(c, pos);
+         /* candidates are verified by comparing the bytes, so stale hash
+            entries only cost time */
+         while (limit-- && cand < pos && pos - cand < wsize) {
+            if (w[cand + best_len] == w[pos + best_len]) {
+               unsigned int len = 0;
+               while (len < max_len && w[cand + len] == w[pos + len]) {
+                  len++;
+               }
+               if (len > best_len) {
+                  best_len = len;
+                  best_dist = pos - cand;
+                  if (len == max_len) {
+                     break;
+                  }
+               }
+            }
+            unsigned int next = c->hash_chain[cand & (wsize - 1)];
+            if (next >= cand) {
+               break;
+            }
+            cand = next;
+         }
+      }
+
+      if (best_dist != 0) {
+         zlib_match(&c->out, best_dist, best_len);
+         while (--best_len) {
+            if (++pos + MIN_MATCH <= c->win_len) {
+               lz77_insert(c, pos);
+            }
+         }
+         c->pos = pos + 1;
+      } else {
+         zlib_literal(&c->out, w[pos]);
+         c->pos = pos + 1;
+      }
+   }
+}
+
+void uzlib_compress_init(struct uzlib_comp *c)
+{
+   memset(c->hash_table, 0, sizeof(uzlib_hash_entry_t) << c->hash_bits);
+   memset(c->hash_chain, 0, sizeof(uzlib_hash_entry_t) << c->wbits);
+   c->win_len = 0;
+   c->pos = 0;
+   zlib_start_block(&c->out);
+}
+
+void uzlib_compress(struct uzlib_comp *c, const uint8_t *src, unsigned slen)
+{
+   unsigned int wsize = 1 << c->wbits;
+   while (slen > 0) {
+      if (c->win_len == 2 * wsize) {
+         lz77_slide(c);
+      }
+      unsigned int n = 2 * wsize - c->win_len;
+      if (n > slen) {
+         n = slen;
+      }
+      memcpy(c->window + c->win_len, src, n);
+      c->win_len += n;
+      src += n;
+      slen -= n;
+      /* keep enough input back to find the longest match */
+      lz77_run(c, MAX_MATCH);
+   }
+}
+
+void uzlib_compress_finish(struct uzlib_comp *c)
+{
+   lz77_run(c, 0);
+   zlib_finish_block(&c->out);
+}
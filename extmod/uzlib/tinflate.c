@@ -121,6 +121,32 @@ static void tinf_build_bits_base(unsigned char *bits, unsigned short *base, int
 }
 #endif
 
+#if UZLIB_CONF_FAST_BITS
+/* build the lookup table for codes of up to UZLIB_CONF_FAST_BITS bits */
+static void tinf_build_fast(TINF_TREE *t)
+{
+   unsigned int len, i, idx = 0, code = 0;
+
+   for (i = 0; i < (1 << UZLIB_CONF_FAST_BITS); ++i) t->fast[i] = 0;
+
+   for (len = 1; len <= UZLIB_CONF_FAST_BITS; ++len, code <<= 1)
+   {
+      for (i = 0; i < t->table[len]; ++i, ++idx, ++code)
+      {
+         /* codes are sent most significant bit first */
+         unsigned int rev = 0, c = code, n;
+         for (n = 0; n < len; ++n, c >>= 1) rev = (rev << 1) | (c & 1);
+         for (n = rev; n < (1 << UZLIB_CONF_FAST_BITS); n += 1 << len)
+         {
+            t->fast[n] = (t->trans[idx] << 4) | len;
+         }
+      }
+   }
+}
+#else
+#define tinf_build_fast(t)
+#endif
+
 /* build the fixed huffman trees */
 static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
 {
@@ -144,6 +170,9 @@ static void tinf_build_fixed_trees(TINF_TREE *lt, TINF_TREE *dt)
    dt->table[5] = 32;
 
    for (i = 0; i < 32; ++i) dt->trans[i] = i;
+
+   tinf_build_fast(lt);
+   tinf_build_fast(dt);
 }
 
 /* given an array of code lengths, build a tree */
@@ -183,6 +212,8 @@ static void tinf_build_tree(TINF_TREE *t, const unsigned char *lengths, unsigned
    {
       if (lengths[i]) t->trans[offs[lengths[i]]++] = i;
    }
+
+   tinf_build_fast(t);
 }
 
 /* ---------------------- *
@@ -191,6 +222,15 @@ static void tinf_build_tree(TINF_TREE *t, const unsigned char *lengths, unsigned
 
 unsigned char uzlib_get_byte(TINF_DATA *d)
 {
+    /* Whole bytes already taken into the bit buffer come first; this is
+       only called when the bit position is on a byte boundary. */
+    if (d->bitcount >= 8) {
+        unsigned char c = d->tag;
+        d->tag >>= 8;
+        d->bitcount -= 8;
+        return c;
+    }
+
     /* If end of source buffer is not reached, return next byte from source
        buffer. */
     if (d->source < d->source_limit) {
@@ -235,22 +275,41 @@ uint32_t tinf_get_be_uint32(TINF_DATA *d)
     return val;
 }
 
+/* skip to the next byte boundary of the source stream */
+static void tinf_align_byte(TINF_DATA *d)
+{
+   d->tag >>= d->bitcount & 7;
+   d->bitcount &= ~7;
+}
+
+/* top up the bit buffer from bytes already in the source buffer, without
+   calling readSource, so nothing past the end of the stream is requested */
+static void tinf_refill(TINF_DATA *d)
+{
+   while (d->bitcount <= 24 && d->source < d->source_limit)
+   {
+      d->tag |= (uint32_t)*d->source++ << d->bitcount;
+      d->bitcount += 8;
+   }
+}
+
 /* get one bit from source stream */
 static int tinf_getbit(TINF_DATA *d)
 {
    unsigned int bit;
 
    /* check if tag is empty */
-   if (!d->bitcount--)
+   if (d->bitcount == 0)
    {
       /* load next tag */
       d->tag = uzlib_get_byte(d);
-      d->bitcount = 7;
+      d->bitcount = 8;
    }
 
    /* shift bit out of tag */
    bit = d->tag & 0x01;
    d->tag >>= 1;
+   d->bitcount--;
 
    return bit;
 }
@@ -260,8 +319,14 @@ static unsigned int tinf_read_bits(TINF_DATA *d, int num, int base)
 {
    unsigned int val = 0;
 
-   /* read num bits */
-   if (num)
+   tinf_refill(d);
+   if (d->bitcount >= (unsigned int)num)
+   {
+      val = d->tag & ((1 << num) - 1);
+      d->tag >>= num;
+      d->bitcount -= num;
+   }
+   else if (num)
    {
       unsigned int limit = 1 << (num);
       unsigned int mask;
@@ -278,6 +343,20 @@ static int tinf_decode_symbol(TINF_DATA *d, TINF_TREE *t)
 {
    int sum = 0, cur = 0, len = 0;
 
+#if UZLIB_CONF_FAST_BITS
+   tinf_refill(d);
+   if (d->bitcount >= UZLIB_CONF_FAST_BITS)
+   {
+      unsigned int e = t->fast[d->tag & ((1 << UZLIB_CONF_FAST_BITS) - 1)];
+      if (e)
+      {
+         d->tag >>= e & 15;
+         d->bitcount -= e & 15;
+         return e >> 4;
+      }
+   }
+#endif
+
    /* get more bits while code value is above sum */
    do {
 
@@ -471,17 +550,18 @@ static int tinf_inflate_block_data(TINF_DATA *d, TINF_TREE *lt, TINF_TREE *dt)
         }
     }
 
-    /* copy next byte from dict substring */
-    if (d->dict_ring) {
-        TINF_PUT(d, d->dict_ring[d->lzOff]);
-        if ((unsigned)++d->lzOff == d->dict_size) {
-            d->lzOff = 0;
+    /* copy bytes from dict substring, as many as there is room for */
+    do {
+        if (d->dict_ring) {
+            TINF_PUT(d, d->dict_ring[d->lzOff]);
+            if ((unsigned)++d->lzOff == d->dict_size) {
+                d->lzOff = 0;
+            }
+        } else {
+            d->dest[0] = d->dest[d->lzOff];
+            d->dest++;
         }
-    } else {
-        d->dest[0] = d->dest[d->lzOff];
-        d->dest++;
-    }
-    d->curlen--;
+    } while (--d->curlen != 0 && d->dest < d->dest_limit);
     return TINF_OK;
 }
 
@@ -491,6 +571,9 @@ static int tinf_inflate_uncompressed_block(TINF_DATA *d)
     if (d->curlen == 0) {
         unsigned int length, invlength;
 
+        /* the block starts on a byte boundary */
+        tinf_align_byte(d);
+
         /* get length */
         length = uzlib_get_byte(d);
         length += 256 * uzlib_get_byte(d);
@@ -503,9 +586,6 @@ static int tinf_inflate_uncompressed_block(TINF_DATA *d)
         /* increment length to properly return TINF_DONE below, without
            producing data at the same time */
         d->curlen = length + 1;
-
-        /* make sure we start next block on a byte boundary */
-        d->bitcount = 0;
     }
 
     if (--d->curlen == 0) {
@@ -539,6 +619,7 @@ void uzlib_init(void)
 void uzlib_uncompress_init(TINF_DATA *d, void *dict, unsigned int dictLen)
 {
    d->eof = 0;
+   d->tag = 0;
    d->bitcount = 0;
    d->bfinal = 0;
    d->btype = -1;
@@ -635,6 +716,9 @@ int uzlib_uncompress_chksum(TINF_DATA *d)
     if (res == TINF_DONE) {
         unsigned int val;
 
+        /* the trailer starts on a byte boundary */
+        tinf_align_byte(d);
+
         switch (d->checksum_type) {
 
         case TINF_CHKSUM_ADLER:
@@ -80,6 +80,11 @@ extern "C" {
 typedef struct {
    unsigned short table[16];  /* table of code length counts */
    unsigned short trans[288]; /* code -> symbol translation table */
+#if UZLIB_CONF_FAST_BITS
+   /* next UZLIB_CONF_FAST_BITS bits of input -> (symbol << 4) | code length,
+      or 0 if the code is longer */
+   unsigned short fast[1 << UZLIB_CONF_FAST_BITS];
+#endif
 } TINF_TREE;
 
 struct uzlib_uncomp {
@@ -94,7 +99,8 @@ struct uzlib_uncomp {
        source_limit fields, thus allowing for buffered operation. */
     int (*source_read_cb)(struct uzlib_uncomp *uncomp);
 
-    unsigned int tag;
+    /* bits read from source but not yet used, least significant first */
+    uint32_t tag;
     unsigned int bitcount;
 
     /* Destination (output) buffer start */
@@ -143,17 +149,35 @@ int TINFCC uzlib_gzip_parse_header(TINF_DATA *d);
 
 /* Compression API */
 
-typedef const uint8_t *uzlib_hash_entry_t;
+/* Matches are found in a window of the last 1 << wbits bytes, looking up
+   candidates from a hash of their first 3 bytes and following a chain of
+   earlier positions with the same hash.  The caller provides the buffers,
+   which take (4 << wbits) + (2 << hash_bits) bytes, fills in the fields up
+   to chain_limit, and sets up out. */
+
+typedef uint16_t uzlib_hash_entry_t;
 
 struct uzlib_comp {
     struct Outbuf out;
 
+    /* 2 << wbits bytes: the window followed by input not yet compressed */
+    uint8_t *window;
+    /* 1 << hash_bits entries: the latest position with each hash */
     uzlib_hash_entry_t *hash_table;
+    /* 1 << wbits entries: the previous position with the same hash */
+    uzlib_hash_entry_t *hash_chain;
+    unsigned int wbits;
     unsigned int hash_bits;
-    unsigned int dict_size;
+    /* maximum number of candidates to try for each match */
+    unsigned int chain_limit;
+
+    unsigned int win_len;
+    unsigned int pos;
 };
 
+void TINFCC uzlib_compress_init(struct uzlib_comp *c);
 void TINFCC uzlib_compress(struct uzlib_comp *c, const uint8_t *src, unsigned slen);
+void TINFCC uzlib_compress_finish(struct uzlib_comp *c);
 
 /* Checksum API */
 
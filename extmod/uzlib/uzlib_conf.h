@@ -19,4 +19,11 @@
 #define UZLIB_CONF_PARANOID_CHECKS 0
 #endif
 
+#ifndef UZLIB_CONF_FAST_BITS
+/* If non-zero, Huffman codes of up to this many bits are decoded with a
+   single table lookup, using 2 << UZLIB_CONF_FAST_BITS extra bytes for each
+   of the two trees. Longer codes are decoded bit by bit. */
+#define UZLIB_CONF_FAST_BITS 0
+#endif
+
 #endif /* UZLIB_CONF_H_INCLUDED */
@@ -42,9 +42,13 @@
 #include "extmod/vfs_posix.h"
 #endif
 
+#if MICROPY_VFS_LOG
+#include "extmod/vfs_log.h"
+#endif
+
 // For mp_vfs_proxy_call, the maximum number of additional args that can be passed.
 // A fixed maximum size is used to avoid the need for a costly variable array.
-#define PROXY_MAX_ARGS (2)
+#define PROXY_MAX_ARGS (3)
 
 // path is the path to lookup and *path_out holds the path within the VFS
 // object (starts with / if an absolute path).
@@ -178,10 +182,17 @@ mp_obj_t mp_vfs_mount(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args
     if (dest[0] == MP_OBJ_NULL) {
         // Input object has no mount method, assume it's a block device and try to
         // auto-detect the filesystem and create the corresponding VFS entity.
-        // (At the moment we only support FAT filesystems.)
-        #if MICROPY_VFS_FAT
-        vfs_obj = mp_fat_vfs_type.make_new(&mp_fat_vfs_type, 1, 0, &vfs_obj);
+        // (At the moment we support log and FAT filesystems.)
+        #if MICROPY_VFS_LOG
+        if (mp_vfs_log_probe(vfs_obj)) {
+            vfs_obj = mp_type_vfs_log.make_new(&mp_type_vfs_log, 1, 0, &vfs_obj);
+        } else
         #endif
+        {
+            #if MICROPY_VFS_FAT
+            vfs_obj = mp_fat_vfs_type.make_new(&mp_fat_vfs_type, 1, 0, &vfs_obj);
+            #endif
+        }
     }
 
     // create new object
@@ -254,9 +265,10 @@ mp_obj_t mp_vfs_umount(mp_obj_t mnt_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mp_vfs_umount_obj, mp_vfs_umount);
 
-// Note: buffering and encoding args are currently ignored
+// Note: encoding is currently ignored, and buffering is only passed on to the
+// filesystem when a buffer size is given
 mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_file, ARG_mode, ARG_encoding };
+    enum { ARG_file, ARG_mode, ARG_buffering, ARG_encoding };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_file, MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
         { MP_QSTR_mode, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_QSTR(MP_QSTR_r)} },
@@ -276,7 +288,12 @@ mp_obj_t mp_vfs_open(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
     #endif
 
     mp_vfs_mount_t *vfs = lookup_path(args[ARG_file].u_obj, &args[ARG_file].u_obj);
-    return mp_vfs_proxy_call(vfs, MP_QSTR_open, 2, (mp_obj_t*)&args);
+    size_t n_open_args = 2;
+    if (args[ARG_buffering].u_int > 1) {
+        args[ARG_buffering].u_obj = MP_OBJ_NEW_SMALL_INT(args[ARG_buffering].u_int);
+        n_open_args = 3;
+    }
+    return mp_vfs_proxy_call(vfs, MP_QSTR_open, n_open_args, (mp_obj_t*)&args);
 }
 MP_DEFINE_CONST_FUN_OBJ_KW(mp_vfs_open_obj, 0, mp_vfs_open);
 
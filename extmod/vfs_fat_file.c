@@ -28,6 +28,7 @@
 #if MICROPY_VFS && MICROPY_VFS_FAT
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/runtime.h"
 #include "py/stream.h"
@@ -35,6 +36,15 @@
 #include "lib/oofatfs/ff.h"
 #include "extmod/vfs_fat.h"
 
+#if FF_MAX_SS == FF_MIN_SS
+#define SECSIZE(fs) (FF_MIN_SS)
+#else
+#define SECSIZE(fs) ((fs)->ssize)
+#endif
+
+// largest write buffer that open(..., buffering=n) will give a file
+#define FILE_WBUF_MAX (32768)
+
 // this table converts from FRESULT to POSIX errno
 const byte fresult_to_errno_table[20] = {
     [FR_OK] = 0,
@@ -62,6 +72,12 @@ const byte fresult_to_errno_table[20] = {
 typedef struct _pyb_file_obj_t {
     mp_obj_base_t base;
     FIL fp;
+    // Writes are gathered here when the file was opened with a buffer size,
+    // and passed on to f_write in whole sectors.  The buffer is part of the
+    // object so it is still there when the finaliser flushes it.
+    size_t wbuf_size;
+    size_t wbuf_len;
+    byte wbuf[];
 } pyb_file_obj_t;
 
 STATIC void file_obj_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
@@ -69,8 +85,47 @@ STATIC void file_obj_print(const mp_print_t *print, mp_obj_t self_in, mp_print_k
     mp_printf(print, "<io.%s %p>", mp_obj_get_type_str(self_in), MP_OBJ_TO_PTR(self_in));
 }
 
+STATIC int file_obj_write_fp(pyb_file_obj_t *self, const void *buf, mp_uint_t size) {
+    UINT sz_out;
+    FRESULT res = f_write(&self->fp, buf, size, &sz_out);
+    if (res != FR_OK) {
+        return fresult_to_errno_table[res];
+    }
+    if (sz_out != size) {
+        // The FatFS documentation says that this means disk full.
+        return MP_ENOSPC;
+    }
+    return 0;
+}
+
+// Pass buffered writes on to FatFS.  Unless all is set this stops at the
+// last sector boundary, so the rest of the file is written in whole sectors.
+STATIC int file_obj_flush_wbuf(pyb_file_obj_t *self, bool all) {
+    size_t n = self->wbuf_len;
+    if (!all) {
+        n -= (f_tell(&self->fp) + n) % SECSIZE(self->fp.obj.fs);
+    }
+    if (n == 0) {
+        return 0;
+    }
+    int err = file_obj_write_fp(self, self->wbuf, n);
+    if (err != 0) {
+        return err;
+    }
+    self->wbuf_len -= n;
+    memmove(self->wbuf, self->wbuf + n, self->wbuf_len);
+    return 0;
+}
+
 STATIC mp_uint_t file_obj_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
     pyb_file_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->wbuf_len != 0) {
+        *errcode = file_obj_flush_wbuf(self, true);
+        if (*errcode != 0) {
+            return MP_STREAM_ERROR;
+        }
+    }
+    // FatFS moves whole sectors straight into buf, so large reads need no help
     UINT sz_out;
     FRESULT res = f_read(&self->fp, buf, size, &sz_out);
     if (res != FR_OK) {
@@ -82,18 +137,38 @@ STATIC mp_uint_t file_obj_read(mp_obj_t self_in, void *buf, mp_uint_t size, int
 
 STATIC mp_uint_t file_obj_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
     pyb_file_obj_t *self = MP_OBJ_TO_PTR(self_in);
-    UINT sz_out;
-    FRESULT res = f_write(&self->fp, buf, size, &sz_out);
-    if (res != FR_OK) {
-        *errcode = fresult_to_errno_table[res];
-        return MP_STREAM_ERROR;
+    if (self->wbuf_size == 0) {
+        *errcode = file_obj_write_fp(self, buf, size);
+        return *errcode != 0 ? MP_STREAM_ERROR : size;
     }
-    if (sz_out != size) {
-        // The FatFS documentation says that this means disk full.
-        *errcode = MP_ENOSPC;
-        return MP_STREAM_ERROR;
+
+    const byte *src = buf;
+    mp_uint_t remain = size;
+    while (remain > 0) {
+        if (self->wbuf_len == 0 && remain >= self->wbuf_size) {
+            // write as many whole sectors as there are straight from buf
+            mp_uint_t n = remain - (f_tell(&self->fp) + remain) % SECSIZE(self->fp.obj.fs);
+            *errcode = file_obj_write_fp(self, src, n);
+            if (*errcode != 0) {
+                return MP_STREAM_ERROR;
+            }
+            src += n;
+            remain -= n;
+            continue;
+        }
+        mp_uint_t n = MIN(remain, self->wbuf_size - self->wbuf_len);
+        memcpy(self->wbuf + self->wbuf_len, src, n);
+        self->wbuf_len += n;
+        src += n;
+        remain -= n;
+        if (self->wbuf_len == self->wbuf_size) {
+            *errcode = file_obj_flush_wbuf(self, false);
+            if (*errcode != 0) {
+                return MP_STREAM_ERROR;
+            }
+        }
     }
-    return sz_out;
+    return size;
 }
 
 
@@ -106,6 +181,17 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(file_obj___exit___obj, 4, 4, file_obj
 STATIC mp_uint_t file_obj_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
     pyb_file_obj_t *self = MP_OBJ_TO_PTR(o_in);
 
+    // everything but closing an already closed file needs the buffer written out
+    if (self->wbuf_len != 0 && self->fp.obj.fs != NULL) {
+        *errcode = file_obj_flush_wbuf(self, true);
+        if (*errcode != 0) {
+            if (request == MP_STREAM_CLOSE) {
+                f_close(&self->fp);
+            }
+            return MP_STREAM_ERROR;
+        }
+    }
+
     if (request == MP_STREAM_SEEK) {
         struct mp_stream_seek_t *s = (struct mp_stream_seek_t*)(uintptr_t)arg;
 
@@ -156,6 +242,7 @@ STATIC mp_uint_t file_obj_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg,
 STATIC const mp_arg_t file_open_args[] = {
     { MP_QSTR_file, MP_ARG_OBJ | MP_ARG_REQUIRED, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
     { MP_QSTR_mode, MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_QSTR(MP_QSTR_r)} },
+    { MP_QSTR_buffering, MP_ARG_INT, {.u_int = -1} },
     { MP_QSTR_encoding, MP_ARG_OBJ | MP_ARG_KW_ONLY, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
 };
 #define FILE_OPEN_NUM_ARGS MP_ARRAY_SIZE(file_open_args)
@@ -192,14 +279,24 @@ STATIC mp_obj_t file_open(fs_user_mount_t *vfs, const mp_obj_type_t *type, mp_ar
         }
     }
 
-    pyb_file_obj_t *o = m_new_obj_with_finaliser(pyb_file_obj_t);
+    // a buffer size of 0 or 1 means unbuffered, as does the default of -1
+    assert(vfs != NULL);
+    size_t wbuf_size = 0;
+    if (args[2].u_int > 1 && (mode & FA_WRITE)) {
+        size_t ssize = SECSIZE(&vfs->fatfs);
+        wbuf_size = MIN((size_t)args[2].u_int, FILE_WBUF_MAX);
+        wbuf_size = (wbuf_size + ssize - 1) / ssize * ssize;
+    }
+
+    pyb_file_obj_t *o = m_new_obj_var_with_finaliser(pyb_file_obj_t, byte, wbuf_size);
     o->base.type = type;
+    o->wbuf_size = wbuf_size;
+    o->wbuf_len = 0;
 
     const char *fname = mp_obj_str_get_str(args[0].u_obj);
-    assert(vfs != NULL);
     FRESULT res = f_open(&vfs->fatfs, &o->fp, fname, mode);
     if (res != FR_OK) {
-        m_del_obj(pyb_file_obj_t, o);
+        m_del_var(pyb_file_obj_t, byte, wbuf_size, o);
         mp_raise_OSError(fresult_to_errno_table[res]);
     }
 
@@ -223,8 +320,10 @@ STATIC const mp_rom_map_elem_t rawfile_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_readline_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_readlines), MP_ROM_PTR(&mp_stream_unbuffered_readlines_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writevec), MP_ROM_PTR(&mp_stream_writevec_obj) },
     { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
     { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
     { MP_ROM_QSTR(MP_QSTR_seek), MP_ROM_PTR(&mp_stream_seek_obj) },
@@ -241,6 +340,7 @@ STATIC const mp_stream_p_t fileio_stream_p = {
     .read = file_obj_read,
     .write = file_obj_write,
     .ioctl = file_obj_ioctl,
+    .is_seekable = true,
 };
 
 const mp_obj_type_t mp_type_vfs_fat_fileio = {
@@ -259,6 +359,7 @@ STATIC const mp_stream_p_t textio_stream_p = {
     .read = file_obj_read,
     .write = file_obj_write,
     .ioctl = file_obj_ioctl,
+    .is_seekable = true,
     .is_text = true,
 };
 
@@ -274,15 +375,15 @@ const mp_obj_type_t mp_type_vfs_fat_textio = {
 };
 
 // Factory function for I/O stream classes
-STATIC mp_obj_t fatfs_builtin_open_self(mp_obj_t self_in, mp_obj_t path, mp_obj_t mode) {
-    // TODO: analyze buffering args and instantiate appropriate type
-    fs_user_mount_t *self = MP_OBJ_TO_PTR(self_in);
+STATIC mp_obj_t fatfs_builtin_open_self(size_t n_args, const mp_obj_t *args) {
+    fs_user_mount_t *self = MP_OBJ_TO_PTR(args[0]);
     mp_arg_val_t arg_vals[FILE_OPEN_NUM_ARGS];
-    arg_vals[0].u_obj = path;
-    arg_vals[1].u_obj = mode;
-    arg_vals[2].u_obj = mp_const_none;
+    arg_vals[0].u_obj = args[1];
+    arg_vals[1].u_obj = args[2];
+    arg_vals[2].u_int = n_args > 3 ? mp_obj_get_int(args[3]) : -1;
+    arg_vals[3].u_obj = mp_const_none;
     return file_open(self, &mp_type_vfs_fat_textio, arg_vals);
 }
-MP_DEFINE_CONST_FUN_OBJ_3(fat_vfs_open_obj, fatfs_builtin_open_self);
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(fat_vfs_open_obj, 3, 4, fatfs_builtin_open_self);
 
 #endif // MICROPY_VFS && MICROPY_VFS_FAT
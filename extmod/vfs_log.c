@@ -0,0 +1,1239 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/mpconfig.h"
+#if MICROPY_VFS_LOG
+
+#if !MICROPY_VFS
+#error "with MICROPY_VFS_LOG enabled, must also enable MICROPY_VFS"
+#endif
+
+#include <string.h>
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/binary.h"
+#include "py/objarray.h"
+#include "extmod/vfs_log.h"
+
+// A log-structured filesystem for flash block devices.
+//
+// The device is used as a ring of blocks.  Every change is appended as a
+// record to the head block, and once the head is full the next block in
+// the ring becomes the head, so all blocks are written in turn.  Each block
+// starts with a header holding a sequence number one more than the block
+// before it and the sequence number of the oldest block still in the log.
+// At mount the head is the block with the highest sequence number and the
+// log runs back from it to that oldest block.  The records of the log are
+// replayed, oldest first, to rebuild the directory tree and an extent map
+// of where each file's data is.
+//
+// When the free part of the ring runs low the tail block is collected: what
+// it holds that is still live is appended to the head again and the tail
+// drops out of the log, which a TAIL record in the head makes note of.
+//
+// Appending to a block only ever clears bits of erased flash, and a record
+// only counts once its CRC is right, so a block device that skips the erase
+// for such writes (like esp32.FlashBdev) never loses committed data when
+// power fails part way through a write.
+
+#define VFS_LOG_MAGIC       (0x474c504d) // "MPLG"
+#define VFS_LOG_VERSION     (1)
+#define VFS_LOG_HDR_SIZE    (20)
+#define VFS_LOG_REC_HDR     (12)
+#define VFS_LOG_RESERVE     (3)
+#define VFS_LOG_MIN_BLOCKS  (VFS_LOG_RESERVE + 3)
+#define VFS_LOG_GC_CHUNK    (256)
+#define VFS_LOG_ROOT_ID     (1)
+#define VFS_LOG_NAME_MAX    (255)
+#define VFS_LOG_NO_BLOCK    (0xffffffff)
+
+#define REC_INODE           (1) // arg=parent, payload=u32 size, u8 kind, name
+#define REC_DATA            (2) // arg=offset, payload=data
+#define REC_DELETE          (3)
+#define REC_TAIL            (4) // arg=sequence number of the oldest block
+#define REC_FREE            (0xff)
+
+// a record is its header and payload padded to 4 bytes, then a CRC32
+#define REC_SIZE(plen) ((((VFS_LOG_REC_HDR + (plen)) + 3) & ~3) + 4)
+
+#define BP_IOCTL_SYNC       (3)
+#define BP_IOCTL_SEC_COUNT  (4)
+#define BP_IOCTL_SEC_SIZE   (5)
+
+STATIC inline uint32_t get_u32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+STATIC inline uint16_t get_u16(const uint8_t *p) {
+    return p[0] | p[1] << 8;
+}
+
+STATIC inline void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+STATIC inline void put_u16(uint8_t *p, uint16_t v) {
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+STATIC uint32_t vfs_log_crc(const uint8_t *buf, size_t len) {
+    static const uint32_t tab[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+    };
+    uint32_t crc = 0xffffffff;
+    while (len--) {
+        crc ^= *buf++;
+        crc = (crc >> 4) ^ tab[crc & 15];
+        crc = (crc >> 4) ^ tab[crc & 15];
+    }
+    return ~crc;
+}
+
+/******************************************************************************/
+// block device access
+
+STATIC void log_dev_read(mp_obj_vfs_log_t *self, uint32_t block, uint8_t *buf) {
+    mp_obj_array_t ar = {{&mp_type_bytearray}, BYTEARRAY_TYPECODE, 0, self->block_size, buf};
+    self->readblocks[2] = MP_OBJ_NEW_SMALL_INT(block);
+    self->readblocks[3] = MP_OBJ_FROM_PTR(&ar);
+    mp_call_method_n_kw(2, 0, self->readblocks);
+}
+
+STATIC void log_dev_write(mp_obj_vfs_log_t *self, uint32_t block, const uint8_t *buf) {
+    mp_obj_array_t ar = {{&mp_type_bytearray}, BYTEARRAY_TYPECODE, 0, self->block_size, (void*)buf};
+    self->writeblocks[2] = MP_OBJ_NEW_SMALL_INT(block);
+    self->writeblocks[3] = MP_OBJ_FROM_PTR(&ar);
+    mp_call_method_n_kw(2, 0, self->writeblocks);
+}
+
+STATIC mp_obj_t log_dev_ioctl(mp_obj_vfs_log_t *self, mp_int_t op) {
+    self->ioctl[2] = MP_OBJ_NEW_SMALL_INT(op);
+    self->ioctl[3] = MP_OBJ_NEW_SMALL_INT(0);
+    return mp_call_method_n_kw(2, 0, self->ioctl);
+}
+
+// Get the contents of a block in the log, from the head buffer or the device
+STATIC const uint8_t *log_load(mp_obj_vfs_log_t *self, uint32_t block) {
+    if (block == self->head) {
+        return self->head_buf;
+    }
+    if (block != self->tmp_block) {
+        self->tmp_block = VFS_LOG_NO_BLOCK;
+        log_dev_read(self, block, self->tmp_buf);
+        self->tmp_block = block;
+    }
+    return self->tmp_buf;
+}
+
+STATIC uint32_t log_block_end(mp_obj_vfs_log_t *self, uint32_t block) {
+    if (block == self->head && self->head_dirty) {
+        return self->head_used;
+    }
+    return self->block_end[block];
+}
+
+/******************************************************************************/
+// nodes and extents
+
+STATIC vfs_log_node_t *log_find(mp_obj_vfs_log_t *self, uint32_t id) {
+    for (vfs_log_node_t *n = self->nodes; n != NULL; n = n->next) {
+        if (n->id == id) {
+            return n;
+        }
+    }
+    return NULL;
+}
+
+STATIC vfs_log_node_t *log_new_node(mp_obj_vfs_log_t *self, uint32_t id) {
+    vfs_log_node_t *n = m_new0(vfs_log_node_t, 1);
+    n->id = id;
+    n->name = m_new0(char, 1);
+    if (self->nodes == NULL) {
+        self->nodes = n;
+    } else {
+        // keep the root first
+        n->next = self->nodes->next;
+        self->nodes->next = n;
+    }
+    if (id >= self->next_id) {
+        self->next_id = id + 1;
+    }
+    return n;
+}
+
+STATIC void log_unlink(mp_obj_vfs_log_t *self, vfs_log_node_t *node) {
+    for (vfs_log_node_t **n = &self->nodes; *n != NULL; n = &(*n)->next) {
+        if (*n == node) {
+            *n = node->next;
+            break;
+        }
+    }
+    node->next = NULL;
+    node->deleted = true;
+    node->size = 0;
+    node->n_ext = 0;
+    if (self->open_node == node) {
+        self->open_node = NULL;
+    }
+}
+
+STATIC void log_set_name(vfs_log_node_t *node, const char *name, size_t len) {
+    node->name = m_renew(char, node->name, strlen(node->name) + 1, len + 1);
+    memcpy(node->name, name, len);
+    node->name[len] = '\0';
+}
+
+// Index of the first extent that ends after pos
+STATIC size_t ext_search(vfs_log_node_t *node, uint32_t pos) {
+    size_t lo = 0, hi = node->n_ext;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (node->ext[mid].off + node->ext[mid].len > pos) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+STATIC void ext_remove(vfs_log_node_t *node, size_t i) {
+    memmove(&node->ext[i], &node->ext[i + 1], (node->n_ext - i - 1) * sizeof(vfs_log_extent_t));
+    node->n_ext -= 1;
+}
+
+// Record that [off, off + len) of a file now lives in the given block
+STATIC void ext_set(vfs_log_node_t *node, uint32_t off, uint32_t len, uint32_t block) {
+    uint32_t end = off + len;
+    vfs_log_extent_t *last = node->n_ext ? &node->ext[node->n_ext - 1] : NULL;
+    if (last != NULL && last->block == block && last->off + last->len == off) {
+        // the common case of appending to the same block
+        last->len += len;
+        return;
+    }
+
+    size_t i = ext_search(node, off);
+    size_t j = i;
+    while (j < node->n_ext && node->ext[j].off < end) {
+        ++j;
+    }
+
+    // extents i..j-1 overlap the new one, so keep only the parts outside it
+    vfs_log_extent_t left = {0, 0, 0}, right = {0, 0, 0};
+    bool has_left = false, has_right = false;
+    if (i < j) {
+        if (node->ext[i].off < off) {
+            left.off = node->ext[i].off;
+            left.len = off - node->ext[i].off;
+            left.block = node->ext[i].block;
+            has_left = true;
+        }
+        vfs_log_extent_t *e = &node->ext[j - 1];
+        if (e->off + e->len > end) {
+            right.off = end;
+            right.len = e->off + e->len - end;
+            right.block = e->block;
+            has_right = true;
+        }
+    }
+
+    size_t n_new = has_left + 1 + has_right;
+    size_t n_ext = node->n_ext - (j - i) + n_new;
+    if (n_ext > node->alloc_ext) {
+        size_t alloc = node->alloc_ext * 2;
+        if (alloc < n_ext) {
+            alloc = n_ext + 2;
+        }
+        node->ext = m_renew(vfs_log_extent_t, node->ext, node->alloc_ext, alloc);
+        node->alloc_ext = alloc;
+    }
+    memmove(&node->ext[i + n_new], &node->ext[j], (node->n_ext - j) * sizeof(vfs_log_extent_t));
+    node->n_ext = n_ext;
+    if (has_left) {
+        node->ext[i++] = left;
+    }
+    node->ext[i].off = off;
+    node->ext[i].len = len;
+    node->ext[i].block = block;
+    if (has_right) {
+        node->ext[i + 1] = right;
+    }
+
+    // merge with neighbours that are contiguous in the same block
+    if (i + 1 < node->n_ext && node->ext[i + 1].block == block && node->ext[i + 1].off == end) {
+        node->ext[i].len += node->ext[i + 1].len;
+        ext_remove(node, i + 1);
+    }
+    if (i > 0 && node->ext[i - 1].block == block && node->ext[i - 1].off + node->ext[i - 1].len == off) {
+        node->ext[i - 1].len += node->ext[i].len;
+        ext_remove(node, i);
+    }
+}
+
+// Drop the extents at or past size
+STATIC void ext_trim(vfs_log_node_t *node, uint32_t size) {
+    size_t i = ext_search(node, size);
+    if (i < node->n_ext && node->ext[i].off < size) {
+        node->ext[i].len = size - node->ext[i].off;
+        ++i;
+    }
+    node->n_ext = i;
+}
+
+/******************************************************************************/
+// writing the log
+
+// Finish the open DATA record by padding it and writing its CRC
+STATIC void log_seal(mp_obj_vfs_log_t *self) {
+    if (self->rec_open == 0) {
+        return;
+    }
+    uint8_t *r = self->head_buf + self->rec_open;
+    uint32_t plen = get_u16(r + 2);
+    uint32_t crc_off = REC_SIZE(plen) - 4;
+    for (uint32_t i = VFS_LOG_REC_HDR + plen; i < crc_off; ++i) {
+        r[i] = 0;
+    }
+    put_u32(r + crc_off, vfs_log_crc(r, VFS_LOG_REC_HDR + plen));
+    self->rec_open = 0;
+    self->open_node = NULL;
+}
+
+// Write the head block out to the device
+STATIC void log_commit(mp_obj_vfs_log_t *self) {
+    log_seal(self);
+    if (self->head_dirty) {
+        log_dev_write(self, self->head, self->head_buf);
+        self->block_end[self->head] = self->head_used;
+        self->head_dirty = false;
+    }
+}
+
+STATIC void log_dev_sync(mp_obj_vfs_log_t *self) {
+    if (self->ioctl[0] != MP_OBJ_NULL) {
+        log_dev_ioctl(self, BP_IOCTL_SYNC);
+    }
+}
+
+STATIC void log_start_block(mp_obj_vfs_log_t *self, uint32_t block, uint32_t seq) {
+    uint8_t *h = self->head_buf;
+    memset(h, 0xff, self->block_size);
+    put_u32(h, VFS_LOG_MAGIC);
+    put_u32(h + 4, seq);
+    put_u32(h + 8, self->seq - self->log_count + 1);
+    put_u16(h + 12, VFS_LOG_VERSION);
+    put_u16(h + 14, 0);
+    put_u32(h + 16, vfs_log_crc(h, 16));
+    self->head = block;
+    self->seq = seq;
+    self->head_used = VFS_LOG_HDR_SIZE;
+    self->head_dirty = true;
+    self->block_end[block] = VFS_LOG_HDR_SIZE;
+    if (self->tmp_block == block) {
+        self->tmp_block = VFS_LOG_NO_BLOCK;
+    }
+}
+
+STATIC void log_gc(mp_obj_vfs_log_t *self);
+
+// Make sure the head block has room for need more bytes
+STATIC void log_make_room(mp_obj_vfs_log_t *self, uint32_t need) {
+    uint32_t tries = self->log_count;
+    while (self->head_used + need > self->block_size) {
+        log_commit(self);
+        uint32_t free = self->blocks - self->log_count;
+        if (!self->in_gc && free <= VFS_LOG_RESERVE) {
+            // collecting the tail may leave room in a new head, so check again
+            if (free < 2 || self->log_count < 2 || tries-- == 0) {
+                mp_raise_OSError(MP_ENOSPC);
+            }
+            log_gc(self);
+            continue;
+        }
+        if (free == 0) {
+            mp_raise_OSError(MP_ENOSPC);
+        }
+        log_start_block(self, (self->head + 1) % self->blocks, self->seq + 1);
+        self->log_count += 1;
+    }
+}
+
+STATIC void log_put_rec(mp_obj_vfs_log_t *self, uint8_t type, uint32_t id, uint32_t arg, uint32_t plen) {
+    uint8_t *r = self->head_buf + self->head_used;
+    r[0] = type;
+    r[1] = 0;
+    put_u16(r + 2, plen);
+    put_u32(r + 4, id);
+    put_u32(r + 8, arg);
+}
+
+STATIC void log_append_inode(mp_obj_vfs_log_t *self, vfs_log_node_t *node) {
+    size_t name_len = strlen(node->name);
+    uint32_t plen = 5 + name_len;
+    log_make_room(self, REC_SIZE(plen));
+    log_seal(self);
+    log_put_rec(self, REC_INODE, node->id, node->parent, plen);
+    uint8_t *p = self->head_buf + self->head_used + VFS_LOG_REC_HDR;
+    put_u32(p, node->size);
+    p[4] = node->kind;
+    memcpy(p + 5, node->name, name_len);
+    self->rec_open = self->head_used;
+    log_seal(self);
+    self->head_used += REC_SIZE(plen);
+    self->head_dirty = true;
+    node->meta_block = self->head;
+}
+
+STATIC void log_append_empty(mp_obj_vfs_log_t *self, uint8_t type, uint32_t id, uint32_t arg) {
+    log_make_room(self, REC_SIZE(0));
+    log_seal(self);
+    log_put_rec(self, type, id, arg, 0);
+    self->rec_open = self->head_used;
+    log_seal(self);
+    self->head_used += REC_SIZE(0);
+    self->head_dirty = true;
+}
+
+// Largest payload of a record starting at off in a block
+STATIC uint32_t log_max_plen(mp_obj_vfs_log_t *self, uint32_t off) {
+    uint32_t max = ((self->block_size - off - 4) & ~3) - VFS_LOG_REC_HDR;
+    return max > 0xffff ? 0xffff : max;
+}
+
+STATIC void log_append_data(mp_obj_vfs_log_t *self, vfs_log_node_t *node, uint32_t pos, const uint8_t *buf, mp_uint_t len) {
+    while (len > 0) {
+        uint8_t *r = self->head_buf + self->rec_open;
+        uint32_t plen = get_u16(r + 2);
+        uint32_t n = 0;
+        if (self->rec_open != 0 && self->open_node == node && get_u32(r + 8) + plen == pos) {
+            // carry on with the open record if there's room
+            n = log_max_plen(self, self->rec_open) - plen;
+        }
+        if (n == 0) {
+            log_make_room(self, REC_SIZE(len < 32 ? len : 32));
+            log_seal(self);
+            r = self->head_buf + self->head_used;
+            log_put_rec(self, REC_DATA, node->id, pos, 0);
+            self->rec_open = self->head_used;
+            self->open_node = node;
+            plen = 0;
+            n = log_max_plen(self, self->rec_open);
+        }
+        if (n > len) {
+            n = len;
+        }
+        memcpy(r + VFS_LOG_REC_HDR + plen, buf, n);
+        put_u16(r + 2, plen + n);
+        self->head_used = self->rec_open + REC_SIZE(plen + n);
+        self->head_dirty = true;
+        ext_set(node, pos, n, self->head);
+        if (pos + n > node->size) {
+            node->size = pos + n;
+        }
+        pos += n;
+        buf += n;
+        len -= n;
+    }
+}
+
+// Copy the newest data of a file for [pos, pos + len) out of one block
+STATIC void log_scan_data(mp_obj_vfs_log_t *self, uint32_t block, uint32_t id, uint32_t pos, uint8_t *out, uint32_t len) {
+    const uint8_t *buf = log_load(self, block);
+    uint32_t limit = log_block_end(self, block);
+    uint32_t end = pos + len;
+    for (uint32_t off = VFS_LOG_HDR_SIZE; off < limit;) {
+        const uint8_t *r = buf + off;
+        uint32_t plen = get_u16(r + 2);
+        if (r[0] == REC_DATA && get_u32(r + 4) == id) {
+            uint32_t r_pos = get_u32(r + 8);
+            uint32_t a = r_pos > pos ? r_pos : pos;
+            uint32_t b = r_pos + plen < end ? r_pos + plen : end;
+            if (a < b) {
+                memcpy(out + (a - pos), r + VFS_LOG_REC_HDR + (a - r_pos), b - a);
+            }
+        }
+        off += REC_SIZE(plen);
+    }
+}
+
+// Move what is still live in the tail block to the head, then drop the tail
+STATIC void log_gc_copy(mp_obj_vfs_log_t *self, uint32_t tail) {
+    for (vfs_log_node_t *node = self->nodes->next; node != NULL; node = node->next) {
+        for (;;) {
+            size_t i = 0;
+            while (i < node->n_ext && node->ext[i].block != tail) {
+                ++i;
+            }
+            if (i == node->n_ext) {
+                break;
+            }
+            uint32_t pos = node->ext[i].off;
+            uint32_t n = node->ext[i].len;
+            if (n > VFS_LOG_GC_CHUNK) {
+                n = VFS_LOG_GC_CHUNK;
+            }
+            uint8_t chunk[VFS_LOG_GC_CHUNK];
+            log_scan_data(self, tail, node->id, pos, chunk, n);
+            log_append_data(self, node, pos, chunk, n);
+        }
+        if (node->meta_block == tail) {
+            log_append_inode(self, node);
+        }
+    }
+}
+
+STATIC void log_gc(mp_obj_vfs_log_t *self) {
+    uint32_t tail = (self->head + self->blocks - self->log_count + 1) % self->blocks;
+    self->in_gc = true;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        log_gc_copy(self, tail);
+        // the copies must be on the device before the tail can be dropped
+        log_commit(self);
+        log_dev_sync(self);
+        self->log_count -= 1;
+        self->gc_count += 1;
+        log_append_empty(self, REC_TAIL, 0, self->seq - self->log_count + 1);
+        nlr_pop();
+        self->in_gc = false;
+    } else {
+        self->in_gc = false;
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+/******************************************************************************/
+// mounting
+
+STATIC bool log_header_valid(const uint8_t *h, uint32_t *seq) {
+    if (get_u32(h) != VFS_LOG_MAGIC || get_u16(h + 12) != VFS_LOG_VERSION
+        || get_u32(h + 16) != vfs_log_crc(h, 16)) {
+        return false;
+    }
+    *seq = get_u32(h + 4);
+    return true;
+}
+
+// Size of the valid record at off, or 0 at the end of the records
+STATIC uint32_t log_rec_size(mp_obj_vfs_log_t *self, const uint8_t *buf, uint32_t off) {
+    if (off + REC_SIZE(0) > self->block_size || buf[off] == REC_FREE) {
+        return 0;
+    }
+    const uint8_t *r = buf + off;
+    uint32_t plen = get_u16(r + 2);
+    uint32_t size = REC_SIZE(plen);
+    if (off + size > self->block_size
+        || get_u32(r + size - 4) != vfs_log_crc(r, VFS_LOG_REC_HDR + plen)) {
+        // torn write
+        return 0;
+    }
+    return size;
+}
+
+// Sequence number of the oldest block in the log, going by the head
+STATIC uint32_t log_tail_seq(mp_obj_vfs_log_t *self, const uint8_t *buf) {
+    uint32_t tail_seq = get_u32(buf + 8);
+    uint32_t size;
+    for (uint32_t off = VFS_LOG_HDR_SIZE; (size = log_rec_size(self, buf, off)) != 0; off += size) {
+        if (buf[off] == REC_TAIL) {
+            tail_seq = get_u32(buf + off + 8);
+        }
+    }
+    return tail_seq;
+}
+
+// Apply the records of one block to the tree, returning where they end
+STATIC uint32_t log_replay(mp_obj_vfs_log_t *self, uint32_t block, const uint8_t *buf) {
+    uint32_t off = VFS_LOG_HDR_SIZE;
+    uint32_t size;
+    while ((size = log_rec_size(self, buf, off)) != 0) {
+        const uint8_t *r = buf + off;
+        uint32_t plen = get_u16(r + 2);
+        uint32_t id = get_u32(r + 4);
+        uint32_t arg = get_u32(r + 8);
+        const uint8_t *p = r + VFS_LOG_REC_HDR;
+        vfs_log_node_t *node = id == VFS_LOG_ROOT_ID ? NULL : log_find(self, id);
+        if (r[0] == REC_INODE && plen > 5 && id != VFS_LOG_ROOT_ID) {
+            if (node == NULL) {
+                node = log_new_node(self, id);
+            }
+            node->parent = arg;
+            node->size = get_u32(p);
+            node->kind = p[4];
+            node->meta_block = block;
+            log_set_name(node, (const char*)p + 5, plen - 5);
+            ext_trim(node, node->size);
+        } else if (r[0] == REC_DATA && node != NULL && node->kind == VFS_LOG_KIND_FILE && plen > 0) {
+            ext_set(node, arg, plen, block);
+            if (arg + plen > node->size) {
+                node->size = arg + plen;
+            }
+        } else if (r[0] == REC_DELETE && node != NULL) {
+            log_unlink(self, node);
+        }
+        off += size;
+    }
+    return off;
+}
+
+STATIC void log_reset_tree(mp_obj_vfs_log_t *self) {
+    self->nodes = NULL;
+    self->next_id = VFS_LOG_ROOT_ID;
+    vfs_log_node_t *root = log_new_node(self, VFS_LOG_ROOT_ID);
+    root->kind = VFS_LOG_KIND_DIR;
+    root->parent = VFS_LOG_ROOT_ID;
+    self->cwd = VFS_LOG_ROOT_ID;
+    self->rec_open = 0;
+    self->open_node = NULL;
+}
+
+// Find the log on the device and rebuild the tree from it.  This is one
+// pass over the headers and one over the blocks in the log.
+STATIC void log_mount(mp_obj_vfs_log_t *self) {
+    uint32_t *seqs = m_new(uint32_t, self->blocks);
+    uint32_t head = VFS_LOG_NO_BLOCK;
+    self->max_seq = 0;
+    self->tmp_block = VFS_LOG_NO_BLOCK;
+    for (uint32_t b = 0; b < self->blocks; ++b) {
+        log_dev_read(self, b, self->tmp_buf);
+        uint32_t seq;
+        if (!log_header_valid(self->tmp_buf, &seq)) {
+            seqs[b] = 0;
+            self->block_end[b] = 0;
+            continue;
+        }
+        seqs[b] = seq;
+        self->block_end[b] = VFS_LOG_HDR_SIZE;
+        if (head == VFS_LOG_NO_BLOCK || seq > self->max_seq) {
+            head = b;
+            self->max_seq = seq;
+        }
+    }
+
+    log_reset_tree(self);
+    if (head == VFS_LOG_NO_BLOCK) {
+        m_del(uint32_t, seqs, self->blocks);
+        self->formatted = false;
+        return;
+    }
+
+    log_dev_read(self, head, self->head_buf);
+    uint32_t want = self->max_seq - log_tail_seq(self, self->head_buf) + 1;
+    uint32_t tail = head;
+    uint32_t count = 1;
+    while (count < want && count < self->blocks) {
+        uint32_t prev = (tail + self->blocks - 1) % self->blocks;
+        if (self->block_end[prev] == 0 || seqs[prev] != seqs[tail] - 1) {
+            break;
+        }
+        tail = prev;
+        ++count;
+    }
+    m_del(uint32_t, seqs, self->blocks);
+
+    self->head = head;
+    self->seq = self->max_seq;
+    self->log_count = count;
+    self->head_dirty = false;
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t b = (tail + i) % self->blocks;
+        uint8_t *buf = self->head_buf;
+        if (b != head) {
+            buf = self->tmp_buf;
+            log_dev_read(self, b, buf);
+        }
+        self->block_end[b] = log_replay(self, b, buf);
+    }
+    self->tmp_block = VFS_LOG_NO_BLOCK;
+
+    // if anything but erased bytes follows the last record of the head then
+    // a write was torn, so start a new block rather than append after it
+    self->head_used = self->block_end[head];
+    for (uint32_t i = self->head_used; i < self->block_size; ++i) {
+        if (self->head_buf[i] != 0xff) {
+            self->head_used = self->block_size;
+            break;
+        }
+    }
+    self->formatted = true;
+}
+
+STATIC void log_format(mp_obj_vfs_log_t *self) {
+    if (self->writeblocks[0] == MP_OBJ_NULL) {
+        mp_raise_OSError(MP_EROFS);
+    }
+    log_reset_tree(self);
+    // skip a number so the old log can't look like it follows on
+    self->seq = self->max_seq + 2;
+    self->log_count = 1;
+    log_start_block(self, 0, self->seq);
+    self->max_seq = self->seq;
+    log_commit(self);
+    log_dev_sync(self);
+    self->formatted = true;
+}
+
+/******************************************************************************/
+// operations used by the VFS and file objects
+
+void vfs_log_check_writable(mp_obj_vfs_log_t *self) {
+    if (!self->formatted) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+    if (self->readonly || self->writeblocks[0] == MP_OBJ_NULL) {
+        mp_raise_OSError(MP_EROFS);
+    }
+}
+
+vfs_log_node_t *vfs_log_find_child(mp_obj_vfs_log_t *self, vfs_log_node_t *dir, const char *name, size_t len) {
+    if (len == 1 && name[0] == '.') {
+        return dir;
+    }
+    if (len == 2 && name[0] == '.' && name[1] == '.') {
+        return log_find(self, dir->parent);
+    }
+    for (vfs_log_node_t *n = self->nodes->next; n != NULL; n = n->next) {
+        if (n->parent == dir->id && strncmp(n->name, name, len) == 0 && n->name[len] == '\0') {
+            return n;
+        }
+    }
+    return NULL;
+}
+
+// Resolve a path to a node, or NULL if it doesn't exist.  With want_parent
+// the directory that would hold the last component is returned instead and
+// the component is passed back in leaf, without any trailing slash.
+vfs_log_node_t *vfs_log_lookup(mp_obj_vfs_log_t *self, const char *path, bool want_parent, const char **leaf, size_t *leaf_len) {
+    if (!self->formatted) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+    vfs_log_node_t *node = NULL;
+    if (path[0] != '/') {
+        node = log_find(self, self->cwd);
+    }
+    if (node == NULL) {
+        node = self->nodes;
+    }
+    for (;;) {
+        while (*path == '/') {
+            ++path;
+        }
+        const char *end = path;
+        while (*end != '\0' && *end != '/') {
+            ++end;
+        }
+        const char *next = end;
+        while (*next == '/') {
+            ++next;
+        }
+        if (want_parent && *next == '\0') {
+            *leaf = path;
+            *leaf_len = end - path;
+            return node;
+        }
+        if (end == path) {
+            return node;
+        }
+        if (node->kind != VFS_LOG_KIND_DIR) {
+            mp_raise_OSError(MP_ENOTDIR);
+        }
+        node = vfs_log_find_child(self, node, path, end - path);
+        if (node == NULL) {
+            return NULL;
+        }
+        path = end;
+    }
+}
+
+vfs_log_node_t *vfs_log_create(mp_obj_vfs_log_t *self, vfs_log_node_t *parent, const char *name, size_t len, uint8_t kind) {
+    vfs_log_check_writable(self);
+    if (len == 0 || (len == 1 && name[0] == '.') || (len == 2 && name[0] == '.' && name[1] == '.')) {
+        mp_raise_OSError(MP_EINVAL);
+    }
+    if (len > VFS_LOG_NAME_MAX) {
+        mp_raise_OSError(MP_EINVAL);
+    }
+    vfs_log_node_t *node = log_new_node(self, self->next_id);
+    node->parent = parent->id;
+    node->kind = kind;
+    log_set_name(node, name, len);
+    log_append_inode(self, node);
+    return node;
+}
+
+void vfs_log_truncate(mp_obj_vfs_log_t *self, vfs_log_node_t *node) {
+    vfs_log_check_writable(self);
+    if (node->deleted) {
+        return;
+    }
+    node->size = 0;
+    node->n_ext = 0;
+    if (self->open_node == node) {
+        log_seal(self);
+    }
+    log_append_inode(self, node);
+}
+
+mp_uint_t vfs_log_read(mp_obj_vfs_log_t *self, vfs_log_node_t *node, uint32_t pos, uint8_t *buf, mp_uint_t len) {
+    if (pos >= node->size) {
+        return 0;
+    }
+    if (len > node->size - pos) {
+        len = node->size - pos;
+    }
+    mp_uint_t total = len;
+    while (len > 0) {
+        size_t i = ext_search(node, pos);
+        uint32_t n;
+        if (i == node->n_ext || node->ext[i].off > pos) {
+            // a hole, which reads as zeros
+            n = (i == node->n_ext ? node->size : node->ext[i].off) - pos;
+            if (n > len) {
+                n = len;
+            }
+            memset(buf, 0, n);
+        } else {
+            n = node->ext[i].off + node->ext[i].len - pos;
+            if (n > len) {
+                n = len;
+            }
+            log_scan_data(self, node->ext[i].block, node->id, pos, buf, n);
+        }
+        pos += n;
+        buf += n;
+        len -= n;
+    }
+    return total;
+}
+
+void vfs_log_write(mp_obj_vfs_log_t *self, vfs_log_node_t *node, uint32_t pos, const uint8_t *buf, mp_uint_t len) {
+    vfs_log_check_writable(self);
+    if (node->deleted) {
+        // removed while open, so the data has nowhere to go
+        return;
+    }
+    log_append_data(self, node, pos, buf, len);
+}
+
+void vfs_log_sync(mp_obj_vfs_log_t *self) {
+    if (self->formatted && self->head_dirty) {
+        log_commit(self);
+        log_dev_sync(self);
+    }
+}
+
+/******************************************************************************/
+// the VfsLog type
+
+STATIC mp_import_stat_t vfs_log_import_stat(void *vfs_in, const char *path) {
+    mp_obj_vfs_log_t *self = vfs_in;
+    if (!self->formatted) {
+        return MP_IMPORT_STAT_NO_EXIST;
+    }
+    vfs_log_node_t *node = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        node = vfs_log_lookup(self, path, false, NULL, NULL);
+        nlr_pop();
+    }
+    if (node == NULL) {
+        return MP_IMPORT_STAT_NO_EXIST;
+    }
+    return node->kind == VFS_LOG_KIND_DIR ? MP_IMPORT_STAT_DIR : MP_IMPORT_STAT_FILE;
+}
+
+STATIC mp_obj_t vfs_log_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+
+    mp_obj_vfs_log_t *self = m_new0(mp_obj_vfs_log_t, 1);
+    self->base.type = type;
+
+    // load block protocol methods
+    mp_load_method(args[0], MP_QSTR_readblocks, self->readblocks);
+    mp_load_method_maybe(args[0], MP_QSTR_writeblocks, self->writeblocks);
+    mp_load_method(args[0], MP_QSTR_ioctl, self->ioctl);
+
+    self->blocks = mp_obj_get_int(log_dev_ioctl(self, BP_IOCTL_SEC_COUNT));
+    mp_obj_t bs = log_dev_ioctl(self, BP_IOCTL_SEC_SIZE);
+    self->block_size = bs == mp_const_none ? 512 : mp_obj_get_int(bs);
+    if (self->block_size < 256 || self->block_size > 32768 || (self->block_size & 3) != 0
+        || self->blocks < VFS_LOG_MIN_BLOCKS) {
+        mp_raise_ValueError("unsuitable block device");
+    }
+
+    self->head_buf = m_new(uint8_t, self->block_size);
+    self->tmp_buf = m_new(uint8_t, self->block_size);
+    self->block_end = m_new(uint16_t, self->blocks);
+
+    // don't error out if no filesystem, to let mkfs()/mount() create one if wanted
+    log_mount(self);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Check whether a block device holds a VfsLog, by looking at the header of
+// its first block which is written when formatting and never left erased
+bool mp_vfs_log_probe(mp_obj_t bdev) {
+    bool found = false;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_vfs_log_t probe;
+        mp_load_method(bdev, MP_QSTR_readblocks, probe.readblocks);
+        mp_load_method(bdev, MP_QSTR_ioctl, probe.ioctl);
+        mp_obj_t bs = log_dev_ioctl(&probe, BP_IOCTL_SEC_SIZE);
+        probe.block_size = bs == mp_const_none ? 512 : mp_obj_get_int(bs);
+        uint8_t *buf = m_new(uint8_t, probe.block_size);
+        log_dev_read(&probe, 0, buf);
+        uint32_t seq;
+        found = log_header_valid(buf, &seq);
+        m_del(uint8_t, buf, probe.block_size);
+        nlr_pop();
+    }
+    return found;
+}
+
+STATIC mp_obj_t vfs_log_mkfs(mp_obj_t bdev_in) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(vfs_log_make_new(&mp_type_vfs_log, 1, 0, &bdev_in));
+    log_format(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(vfs_log_mkfs_fun_obj, vfs_log_mkfs);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(vfs_log_mkfs_obj, MP_ROM_PTR(&vfs_log_mkfs_fun_obj));
+
+STATIC vfs_log_node_t *vfs_log_get_node(mp_obj_vfs_log_t *self, mp_obj_t path_in) {
+    vfs_log_node_t *node = vfs_log_lookup(self, mp_obj_str_get_str(path_in), false, NULL, NULL);
+    if (node == NULL) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    return node;
+}
+
+STATIC mp_obj_t vfs_log_ilistdir_func(size_t n_args, const mp_obj_t *args) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(args[0]);
+    bool is_str = true;
+    vfs_log_node_t *dir;
+    if (n_args == 2) {
+        if (mp_obj_get_type(args[1]) == &mp_type_bytes) {
+            is_str = false;
+        }
+        dir = vfs_log_get_node(self, args[1]);
+    } else {
+        dir = vfs_log_get_node(self, MP_OBJ_NEW_QSTR(MP_QSTR_));
+    }
+    if (dir->kind != VFS_LOG_KIND_DIR) {
+        mp_raise_OSError(MP_ENOTDIR);
+    }
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (vfs_log_node_t *n = self->nodes->next; n != NULL; n = n->next) {
+        if (n->parent != dir->id) {
+            continue;
+        }
+        mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(4, NULL));
+        if (is_str) {
+            t->items[0] = mp_obj_new_str(n->name, strlen(n->name));
+        } else {
+            t->items[0] = mp_obj_new_bytes((const byte*)n->name, strlen(n->name));
+        }
+        t->items[1] = MP_OBJ_NEW_SMALL_INT(n->kind == VFS_LOG_KIND_DIR ? MP_S_IFDIR : MP_S_IFREG);
+        t->items[2] = MP_OBJ_NEW_SMALL_INT(0); // no inode number
+        t->items[3] = mp_obj_new_int_from_uint(n->size);
+        mp_obj_list_append(list, MP_OBJ_FROM_PTR(t));
+    }
+    return mp_getiter(list, NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(vfs_log_ilistdir_obj, 1, 2, vfs_log_ilistdir_func);
+
+STATIC mp_obj_t vfs_log_mkdir(mp_obj_t vfs_in, mp_obj_t path_in) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(vfs_in);
+    const char *leaf;
+    size_t len;
+    vfs_log_node_t *parent = vfs_log_lookup(self, mp_obj_str_get_str(path_in), true, &leaf, &len);
+    if (parent == NULL) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    if (parent->kind != VFS_LOG_KIND_DIR) {
+        mp_raise_OSError(MP_ENOTDIR);
+    }
+    if (len == 0 || vfs_log_find_child(self, parent, leaf, len) != NULL) {
+        mp_raise_OSError(MP_EEXIST);
+    }
+    vfs_log_create(self, parent, leaf, len, VFS_LOG_KIND_DIR);
+    vfs_log_sync(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(vfs_log_mkdir_obj, vfs_log_mkdir);
+
+STATIC void vfs_log_delete(mp_obj_vfs_log_t *self, vfs_log_node_t *node) {
+    if (self->open_node == node) {
+        log_seal(self);
+    }
+    log_unlink(self, node);
+    log_append_empty(self, REC_DELETE, node->id, 0);
+}
+
+STATIC mp_obj_t vfs_log_remove_kind(mp_obj_t vfs_in, mp_obj_t path_in, uint8_t kind) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(vfs_in);
+    vfs_log_check_writable(self);
+    vfs_log_node_t *node = vfs_log_get_node(self, path_in);
+    if (node == self->nodes) {
+        mp_raise_OSError(MP_EACCES);
+    }
+    if (node->kind != kind) {
+        mp_raise_OSError(kind == VFS_LOG_KIND_DIR ? MP_ENOTDIR : MP_EISDIR);
+    }
+    if (kind == VFS_LOG_KIND_DIR) {
+        for (vfs_log_node_t *n = self->nodes->next; n != NULL; n = n->next) {
+            if (n->parent == node->id) {
+                // not empty
+                mp_raise_OSError(MP_EACCES);
+            }
+        }
+        if (self->cwd == node->id) {
+            self->cwd = VFS_LOG_ROOT_ID;
+        }
+    }
+    vfs_log_delete(self, node);
+    vfs_log_sync(self);
+    return mp_const_none;
+}
+
+STATIC mp_obj_t vfs_log_remove(mp_obj_t vfs_in, mp_obj_t path_in) {
+    return vfs_log_remove_kind(vfs_in, path_in, VFS_LOG_KIND_FILE);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(vfs_log_remove_obj, vfs_log_remove);
+
+STATIC mp_obj_t vfs_log_rmdir(mp_obj_t vfs_in, mp_obj_t path_in) {
+    return vfs_log_remove_kind(vfs_in, path_in, VFS_LOG_KIND_DIR);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(vfs_log_rmdir_obj, vfs_log_rmdir);
+
+STATIC mp_obj_t vfs_log_rename(mp_obj_t vfs_in, mp_obj_t path_in, mp_obj_t path_out) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(vfs_in);
+    vfs_log_check_writable(self);
+    vfs_log_node_t *node = vfs_log_get_node(self, path_in);
+    if (node == self->nodes) {
+        mp_raise_OSError(MP_EACCES);
+    }
+    const char *leaf;
+    size_t len;
+    vfs_log_node_t *parent = vfs_log_lookup(self, mp_obj_str_get_str(path_out), true, &leaf, &len);
+    if (parent == NULL) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    if (parent->kind != VFS_LOG_KIND_DIR) {
+        mp_raise_OSError(MP_ENOTDIR);
+    }
+    // a directory can't be moved inside itself
+    for (vfs_log_node_t *p = parent; p != self->nodes; p = log_find(self, p->parent)) {
+        if (p == node || p == NULL) {
+            mp_raise_OSError(MP_EINVAL);
+        }
+    }
+    vfs_log_node_t *dest = vfs_log_find_child(self, parent, leaf, len);
+    if (dest == node) {
+        return mp_const_none;
+    }
+    if (dest != NULL) {
+        if (dest->kind != VFS_LOG_KIND_FILE || node->kind != VFS_LOG_KIND_FILE) {
+            mp_raise_OSError(MP_EEXIST);
+        }
+        vfs_log_delete(self, dest);
+    }
+    if (len == 0 || (len == 1 && leaf[0] == '.') || (len == 2 && leaf[0] == '.' && leaf[1] == '.')) {
+        mp_raise_OSError(MP_EINVAL);
+    }
+    if (len > VFS_LOG_NAME_MAX) {
+        mp_raise_OSError(MP_EINVAL);
+    }
+    if (self->open_node == node) {
+        log_seal(self);
+    }
+    node->parent = parent->id;
+    log_set_name(node, leaf, len);
+    log_append_inode(self, node);
+    vfs_log_sync(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(vfs_log_rename_obj, vfs_log_rename);
+
+STATIC mp_obj_t vfs_log_chdir(mp_obj_t vfs_in, mp_obj_t path_in) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(vfs_in);
+    vfs_log_node_t *node = vfs_log_get_node(self, path_in);
+    if (node->kind != VFS_LOG_KIND_DIR) {
+        mp_raise_OSError(MP_ENOTDIR);
+    }
+    self->cwd = node->id;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(vfs_log_chdir_obj, vfs_log_chdir);
+
+STATIC mp_obj_t vfs_log_getcwd(mp_obj_t vfs_in) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(vfs_in);
+    char buf[MICROPY_ALLOC_PATH_MAX + 1];
+    size_t pos = sizeof(buf);
+    buf[--pos] = '\0';
+    vfs_log_node_t *node = log_find(self, self->cwd);
+    while (node != NULL && node != self->nodes) {
+        size_t len = strlen(node->name);
+        if (len + 1 > pos) {
+            mp_raise_OSError(MP_EINVAL);
+        }
+        pos -= len;
+        memcpy(buf + pos, node->name, len);
+        buf[--pos] = '/';
+        node = log_find(self, node->parent);
+    }
+    if (buf[pos] == '\0') {
+        buf[--pos] = '/';
+    }
+    return mp_obj_new_str(buf + pos, sizeof(buf) - 1 - pos);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(vfs_log_getcwd_obj, vfs_log_getcwd);
+
+STATIC mp_obj_t vfs_log_stat(mp_obj_t vfs_in, mp_obj_t path_in) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(vfs_in);
+    vfs_log_node_t *node = vfs_log_get_node(self, path_in);
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(10, NULL));
+    t->items[0] = MP_OBJ_NEW_SMALL_INT(node->kind == VFS_LOG_KIND_DIR ? MP_S_IFDIR : MP_S_IFREG); // st_mode
+    t->items[1] = MP_OBJ_NEW_SMALL_INT(0); // st_ino
+    t->items[2] = MP_OBJ_NEW_SMALL_INT(0); // st_dev
+    t->items[3] = MP_OBJ_NEW_SMALL_INT(0); // st_nlink
+    t->items[4] = MP_OBJ_NEW_SMALL_INT(0); // st_uid
+    t->items[5] = MP_OBJ_NEW_SMALL_INT(0); // st_gid
+    t->items[6] = mp_obj_new_int_from_uint(node->size); // st_size
+    t->items[7] = MP_OBJ_NEW_SMALL_INT(0); // st_atime
+    t->items[8] = MP_OBJ_NEW_SMALL_INT(0); // st_mtime
+    t->items[9] = MP_OBJ_NEW_SMALL_INT(0); // st_ctime
+    return MP_OBJ_FROM_PTR(t);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(vfs_log_stat_obj, vfs_log_stat);
+
+// Get the status of a VFS.  The free space is an estimate from the amount of
+// live data, which is what the log shrinks to once collected.
+STATIC mp_obj_t vfs_log_statvfs(mp_obj_t vfs_in, mp_obj_t path_in) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(vfs_in);
+    (void)path_in;
+    if (!self->formatted) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+
+    uint32_t room = self->block_size - VFS_LOG_HDR_SIZE;
+    uint32_t live = 0;
+    for (vfs_log_node_t *n = self->nodes->next; n != NULL; n = n->next) {
+        live += REC_SIZE(5 + strlen(n->name));
+        for (size_t i = 0; i < n->n_ext; ++i) {
+            live += n->ext[i].len;
+        }
+    }
+    uint32_t total = self->blocks - VFS_LOG_RESERVE - 1;
+    uint32_t used = (live + room - 1) / room;
+    uint32_t bfree = used < total ? total - used : 0;
+
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(10, NULL));
+    t->items[0] = MP_OBJ_NEW_SMALL_INT(room); // f_bsize
+    t->items[1] = t->items[0]; // f_frsize
+    t->items[2] = MP_OBJ_NEW_SMALL_INT(total); // f_blocks
+    t->items[3] = MP_OBJ_NEW_SMALL_INT(bfree); // f_bfree
+    t->items[4] = t->items[3]; // f_bavail
+    t->items[5] = MP_OBJ_NEW_SMALL_INT(0); // f_files
+    t->items[6] = MP_OBJ_NEW_SMALL_INT(0); // f_ffree
+    t->items[7] = MP_OBJ_NEW_SMALL_INT(0); // f_favail
+    t->items[8] = MP_OBJ_NEW_SMALL_INT(0); // f_flags
+    t->items[9] = MP_OBJ_NEW_SMALL_INT(VFS_LOG_NAME_MAX); // f_namemax
+    return MP_OBJ_FROM_PTR(t);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(vfs_log_statvfs_obj, vfs_log_statvfs);
+
+STATIC mp_obj_t vfs_log_mount(mp_obj_t self_in, mp_obj_t readonly, mp_obj_t mkfs) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(self_in);
+    if (mp_obj_is_true(readonly)) {
+        self->readonly = true;
+    }
+    if (!self->formatted) {
+        if (!mp_obj_is_true(mkfs)) {
+            mp_raise_OSError(MP_ENODEV);
+        }
+        log_format(self);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(vfs_log_mount_obj, vfs_log_mount);
+
+STATIC mp_obj_t vfs_log_umount(mp_obj_t self_in) {
+    // keep the tree in memory so the VFS methods can still be used
+    vfs_log_sync(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(vfs_log_umount_obj, vfs_log_umount);
+
+// Return (blocks in the log, blocks collected) for checking the wear
+STATIC mp_obj_t vfs_log_info(mp_obj_t self_in) {
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t tuple[2] = {
+        mp_obj_new_int_from_uint(self->log_count),
+        mp_obj_new_int_from_uint(self->gc_count),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(vfs_log_info_obj, vfs_log_info);
+
+STATIC const mp_rom_map_elem_t vfs_log_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_mkfs), MP_ROM_PTR(&vfs_log_mkfs_obj) },
+    { MP_ROM_QSTR(MP_QSTR_open), MP_ROM_PTR(&vfs_log_open_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ilistdir), MP_ROM_PTR(&vfs_log_ilistdir_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mkdir), MP_ROM_PTR(&vfs_log_mkdir_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rmdir), MP_ROM_PTR(&vfs_log_rmdir_obj) },
+    { MP_ROM_QSTR(MP_QSTR_chdir), MP_ROM_PTR(&vfs_log_chdir_obj) },
+    { MP_ROM_QSTR(MP_QSTR_getcwd), MP_ROM_PTR(&vfs_log_getcwd_obj) },
+    { MP_ROM_QSTR(MP_QSTR_remove), MP_ROM_PTR(&vfs_log_remove_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rename), MP_ROM_PTR(&vfs_log_rename_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stat), MP_ROM_PTR(&vfs_log_stat_obj) },
+    { MP_ROM_QSTR(MP_QSTR_statvfs), MP_ROM_PTR(&vfs_log_statvfs_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mount), MP_ROM_PTR(&vfs_log_mount_obj) },
+    { MP_ROM_QSTR(MP_QSTR_umount), MP_ROM_PTR(&vfs_log_umount_obj) },
+    { MP_ROM_QSTR(MP_QSTR_info), MP_ROM_PTR(&vfs_log_info_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(vfs_log_locals_dict, vfs_log_locals_dict_table);
+
+STATIC const mp_vfs_proto_t vfs_log_proto = {
+    .import_stat = vfs_log_import_stat,
+};
+
+const mp_obj_type_t mp_type_vfs_log = {
+    { &mp_type_type },
+    .name = MP_QSTR_VfsLog,
+    .make_new = vfs_log_make_new,
+    .protocol = &vfs_log_proto,
+    .locals_dict = (mp_obj_dict_t*)&vfs_log_locals_dict,
+};
+
+#endif // MICROPY_VFS_LOG
@@ -0,0 +1,105 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef MICROPY_INCLUDED_EXTMOD_VFS_LOG_H
+#define MICROPY_INCLUDED_EXTMOD_VFS_LOG_H
+
+#include "py/obj.h"
+#include "extmod/vfs.h"
+
+#define VFS_LOG_KIND_FILE   (1)
+#define VFS_LOG_KIND_DIR    (2)
+
+// Where a range of a file's data lives: the newest data for file offsets
+// [off, off + len) is in DATA records of that block
+typedef struct _vfs_log_extent_t {
+    uint32_t off;
+    uint32_t len;
+    uint32_t block;
+} vfs_log_extent_t;
+
+// A file or directory, rebuilt from the log at mount
+typedef struct _vfs_log_node_t {
+    struct _vfs_log_node_t *next;
+    uint32_t id;
+    uint32_t parent;
+    uint32_t size;
+    uint32_t meta_block;        // block with the node's latest INODE record
+    uint8_t kind;
+    bool deleted;               // removed while a file object still refers to it
+    size_t n_ext;
+    size_t alloc_ext;
+    vfs_log_extent_t *ext;      // sorted by off and not overlapping
+    char *name;
+} vfs_log_node_t;
+
+typedef struct _mp_obj_vfs_log_t {
+    mp_obj_base_t base;
+    mp_obj_t readblocks[4];
+    mp_obj_t writeblocks[4];
+    mp_obj_t ioctl[4];
+    uint32_t block_size;
+    uint32_t blocks;
+    bool formatted;
+    bool readonly;
+    bool in_gc;
+    bool head_dirty;
+    // the log is the ring of log_count blocks ending at head
+    uint32_t head;
+    uint32_t log_count;
+    uint32_t seq;               // of the head block
+    uint32_t max_seq;           // highest seq seen on the device at mount
+    uint32_t head_used;         // bytes of head_buf in use, including an open record
+    uint32_t rec_open;          // offset of the open (unsealed) DATA record, or 0
+    vfs_log_node_t *open_node;  // and the node it belongs to
+    uint8_t *head_buf;
+    uint8_t *tmp_buf;           // a block read from the device
+    uint32_t tmp_block;
+    uint16_t *block_end;        // bytes of valid records in each block
+    uint32_t next_id;
+    uint32_t cwd;
+    vfs_log_node_t *nodes;      // the root directory is always first
+    uint32_t gc_count;
+} mp_obj_vfs_log_t;
+
+extern const mp_obj_type_t mp_type_vfs_log;
+extern const mp_obj_type_t mp_type_vfs_log_fileio;
+extern const mp_obj_type_t mp_type_vfs_log_textio;
+
+MP_DECLARE_CONST_FUN_OBJ_VAR(vfs_log_open_obj);
+
+bool mp_vfs_log_probe(mp_obj_t bdev);
+
+// Used by the file objects in vfs_log_file.c
+vfs_log_node_t *vfs_log_lookup(mp_obj_vfs_log_t *self, const char *path, bool want_parent, const char **leaf, size_t *leaf_len);
+vfs_log_node_t *vfs_log_find_child(mp_obj_vfs_log_t *self, vfs_log_node_t *dir, const char *name, size_t len);
+vfs_log_node_t *vfs_log_create(mp_obj_vfs_log_t *self, vfs_log_node_t *parent, const char *name, size_t len, uint8_t kind);
+void vfs_log_truncate(mp_obj_vfs_log_t *self, vfs_log_node_t *node);
+mp_uint_t vfs_log_read(mp_obj_vfs_log_t *self, vfs_log_node_t *node, uint32_t pos, uint8_t *buf, mp_uint_t len);
+void vfs_log_write(mp_obj_vfs_log_t *self, vfs_log_node_t *node, uint32_t pos, const uint8_t *buf, mp_uint_t len);
+void vfs_log_sync(mp_obj_vfs_log_t *self);
+void vfs_log_check_writable(mp_obj_vfs_log_t *self);
+
+#endif // MICROPY_INCLUDED_EXTMOD_VFS_LOG_H
@@ -0,0 +1,270 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/mpconfig.h"
+#if MICROPY_VFS && MICROPY_VFS_LOG
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "extmod/vfs_log.h"
+
+#define FILE_READ   (0x01)
+#define FILE_WRITE  (0x02)
+#define FILE_APPEND (0x04)
+
+typedef struct _vfs_log_file_obj_t {
+    mp_obj_base_t base;
+    mp_obj_vfs_log_t *vfs;      // NULL once closed
+    vfs_log_node_t *node;
+    uint32_t pos;
+    uint8_t flags;
+} vfs_log_file_obj_t;
+
+STATIC void file_obj_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_printf(print, "<io.%s %p>", mp_obj_get_type_str(self_in), MP_OBJ_TO_PTR(self_in));
+}
+
+STATIC mp_uint_t file_obj_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
+    vfs_log_file_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->vfs == NULL || !(self->flags & FILE_READ)) {
+        *errcode = MP_EBADF;
+        return MP_STREAM_ERROR;
+    }
+    mp_uint_t n = vfs_log_read(self->vfs, self->node, self->pos, buf, size);
+    self->pos += n;
+    return n;
+}
+
+STATIC mp_uint_t file_obj_write(mp_obj_t self_in, const void *buf, mp_uint_t size, int *errcode) {
+    vfs_log_file_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->vfs == NULL || !(self->flags & FILE_WRITE)) {
+        *errcode = MP_EBADF;
+        return MP_STREAM_ERROR;
+    }
+    if (self->flags & FILE_APPEND) {
+        self->pos = self->node->size;
+    }
+    vfs_log_write(self->vfs, self->node, self->pos, buf, size);
+    self->pos += size;
+    return size;
+}
+
+STATIC mp_obj_t file_obj___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return mp_stream_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(file_obj___exit___obj, 4, 4, file_obj___exit__);
+
+STATIC mp_uint_t file_obj_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    vfs_log_file_obj_t *self = MP_OBJ_TO_PTR(o_in);
+
+    if (request == MP_STREAM_SEEK) {
+        struct mp_stream_seek_t *s = (struct mp_stream_seek_t*)(uintptr_t)arg;
+        mp_off_t pos = s->offset;
+        switch (s->whence) {
+            case 1: // SEEK_CUR
+                pos += self->pos;
+                break;
+
+            case 2: // SEEK_END
+                pos += self->node->size;
+                break;
+        }
+        if (pos < 0) {
+            *errcode = MP_EINVAL;
+            return MP_STREAM_ERROR;
+        }
+        self->pos = pos;
+        s->offset = pos;
+        return 0;
+
+    } else if (request == MP_STREAM_FLUSH) {
+        if (self->vfs != NULL && (self->flags & FILE_WRITE)) {
+            vfs_log_sync(self->vfs);
+        }
+        return 0;
+
+    } else if (request == MP_STREAM_CLOSE) {
+        // if vfs==NULL then the file is closed and in that case this method is a no-op
+        if (self->vfs != NULL) {
+            mp_obj_vfs_log_t *vfs = self->vfs;
+            self->vfs = NULL;
+            if (self->flags & FILE_WRITE) {
+                vfs_log_sync(vfs);
+            }
+        }
+        return 0;
+
+    } else {
+        *errcode = MP_EINVAL;
+        return MP_STREAM_ERROR;
+    }
+}
+
+STATIC mp_obj_t file_open(mp_obj_vfs_log_t *vfs, const mp_obj_type_t *type, mp_obj_t path_in, mp_obj_t mode_in) {
+    uint8_t flags = 0;
+    bool create = false, truncate = false, exclusive = false;
+    const char *mode_s = mp_obj_str_get_str(mode_in);
+    while (*mode_s) {
+        switch (*mode_s++) {
+            case 'r':
+                flags |= FILE_READ;
+                break;
+            case 'w':
+                flags |= FILE_WRITE;
+                create = truncate = true;
+                break;
+            case 'x':
+                flags |= FILE_WRITE;
+                create = exclusive = true;
+                break;
+            case 'a':
+                flags |= FILE_WRITE | FILE_APPEND;
+                create = true;
+                break;
+            case '+':
+                flags |= FILE_READ | FILE_WRITE;
+                break;
+            #if MICROPY_PY_IO_FILEIO
+            case 'b':
+                type = &mp_type_vfs_log_fileio;
+                break;
+            #endif
+            case 't':
+                type = &mp_type_vfs_log_textio;
+                break;
+        }
+    }
+    if (flags & FILE_WRITE) {
+        vfs_log_check_writable(vfs);
+    }
+
+    const char *leaf;
+    size_t len;
+    vfs_log_node_t *parent = vfs_log_lookup(vfs, mp_obj_str_get_str(path_in), true, &leaf, &len);
+    if (parent == NULL) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    if (parent->kind != VFS_LOG_KIND_DIR) {
+        mp_raise_OSError(MP_ENOTDIR);
+    }
+    vfs_log_node_t *node = len == 0 ? parent : vfs_log_find_child(vfs, parent, leaf, len);
+    if (node == NULL) {
+        if (!create) {
+            mp_raise_OSError(MP_ENOENT);
+        }
+        node = vfs_log_create(vfs, parent, leaf, len, VFS_LOG_KIND_FILE);
+    } else if (exclusive) {
+        mp_raise_OSError(MP_EEXIST);
+    } else if (node->kind != VFS_LOG_KIND_FILE) {
+        mp_raise_OSError(MP_EISDIR);
+    } else if (truncate) {
+        vfs_log_truncate(vfs, node);
+    }
+
+    vfs_log_file_obj_t *o = m_new_obj_with_finaliser(vfs_log_file_obj_t);
+    o->base.type = type;
+    o->vfs = vfs;
+    o->node = node;
+    o->pos = 0;
+    o->flags = flags;
+
+    // for 'a' mode, we must begin at the end of the file
+    if (flags & FILE_APPEND) {
+        o->pos = node->size;
+    }
+
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC const mp_rom_map_elem_t rawfile_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_readline_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readlines), MP_ROM_PTR(&mp_stream_unbuffered_readlines_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writevec), MP_ROM_PTR(&mp_stream_writevec_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_seek), MP_ROM_PTR(&mp_stream_seek_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tell), MP_ROM_PTR(&mp_stream_tell_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&file_obj___exit___obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(rawfile_locals_dict, rawfile_locals_dict_table);
+
+#if MICROPY_PY_IO_FILEIO
+STATIC const mp_stream_p_t fileio_stream_p = {
+    .read = file_obj_read,
+    .write = file_obj_write,
+    .ioctl = file_obj_ioctl,
+    .is_seekable = true,
+};
+
+const mp_obj_type_t mp_type_vfs_log_fileio = {
+    { &mp_type_type },
+    .name = MP_QSTR_FileIO,
+    .print = file_obj_print,
+    .getiter = mp_identity_getiter,
+    .iternext = mp_stream_unbuffered_iter,
+    .protocol = &fileio_stream_p,
+    .locals_dict = (mp_obj_dict_t*)&rawfile_locals_dict,
+};
+#endif
+
+STATIC const mp_stream_p_t textio_stream_p = {
+    .read = file_obj_read,
+    .write = file_obj_write,
+    .ioctl = file_obj_ioctl,
+    .is_seekable = true,
+    .is_text = true,
+};
+
+const mp_obj_type_t mp_type_vfs_log_textio = {
+    { &mp_type_type },
+    .name = MP_QSTR_TextIOWrapper,
+    .print = file_obj_print,
+    .getiter = mp_identity_getiter,
+    .iternext = mp_stream_unbuffered_iter,
+    .protocol = &textio_stream_p,
+    .locals_dict = (mp_obj_dict_t*)&rawfile_locals_dict,
+};
+
+// Factory function for I/O stream classes.  Writes are already gathered in
+// the head block, so a buffer size given as a 4th argument is ignored.
+STATIC mp_obj_t vfs_log_open(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_vfs_log_t *self = MP_OBJ_TO_PTR(args[0]);
+    return file_open(self, &mp_type_vfs_log_textio, args[1], args[2]);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(vfs_log_open_obj, 3, 4, vfs_log_open);
+
+#endif // MICROPY_VFS && MICROPY_VFS_LOG
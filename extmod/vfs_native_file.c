@@ -256,6 +256,7 @@ STATIC const mp_rom_map_elem_t rawfile_locals_dict_table[] = {
 	{ MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
 	{ MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
 	{ MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+	{ MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_readline_into_obj) },
 	{ MP_ROM_QSTR(MP_QSTR_readlines), MP_ROM_PTR(&mp_stream_unbuffered_readlines_obj) },
 	{ MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
 	{ MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
@@ -276,6 +277,7 @@ STATIC const mp_stream_p_t fileio_stream_p = {
 	.read = file_obj_read,
 	.write = file_obj_write,
 	.ioctl = file_obj_ioctl,
+	.is_seekable = true,
 };
 
 //====================================
@@ -296,6 +298,7 @@ STATIC const mp_stream_p_t textio_stream_p = {
 	.read = file_obj_read,
 	.write = file_obj_write,
 	.ioctl = file_obj_ioctl,
+	.is_seekable = true,
 	.is_text = true,
 };
 
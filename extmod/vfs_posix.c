@@ -123,8 +123,12 @@ STATIC mp_obj_t vfs_posix_umount(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(vfs_posix_umount_obj, vfs_posix_umount);
 
-STATIC mp_obj_t vfs_posix_open(mp_obj_t self_in, mp_obj_t path_in, mp_obj_t mode_in) {
-    mp_obj_vfs_posix_t *self = MP_OBJ_TO_PTR(self_in);
+// The buffer size that may be given as a 4th argument is ignored
+STATIC mp_obj_t vfs_posix_open(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_vfs_posix_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_obj_t path_in = args[1];
+    mp_obj_t mode_in = args[2];
     const char *mode = mp_obj_str_get_str(mode_in);
     if (self->readonly
         && (strchr(mode, 'w') != NULL || strchr(mode, 'a') != NULL || strchr(mode, '+') != NULL)) {
@@ -135,7 +139,7 @@ STATIC mp_obj_t vfs_posix_open(mp_obj_t self_in, mp_obj_t path_in, mp_obj_t mode
     }
     return mp_vfs_posix_file_open(&mp_type_textio, path_in, mode_in);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_3(vfs_posix_open_obj, vfs_posix_open);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(vfs_posix_open_obj, 3, 4, vfs_posix_open);
 
 STATIC mp_obj_t vfs_posix_chdir(mp_obj_t self_in, mp_obj_t path_in) {
     return vfs_posix_fun1_helper(self_in, path_in, chdir);
@@ -35,20 +35,21 @@
 #if MICROPY_READER_VFS
 
 typedef struct _mp_reader_vfs_t {
-    mp_obj_t file;
-    uint16_t len;
-    uint16_t pos;
-    byte buf[24];
+    mp_obj_t file;              // MP_OBJ_NULL once the whole file is in buf
+    size_t alloc;
+    size_t len;
+    size_t pos;
+    byte buf[];
 } mp_reader_vfs_t;
 
 STATIC mp_uint_t mp_reader_vfs_readbyte(void *data) {
     mp_reader_vfs_t *reader = (mp_reader_vfs_t*)data;
     if (reader->pos >= reader->len) {
-        if (reader->len < sizeof(reader->buf)) {
+        if (reader->file == MP_OBJ_NULL || reader->len < reader->alloc) {
             return MP_READER_EOF;
         } else {
             int errcode;
-            reader->len = mp_stream_rw(reader->file, reader->buf, sizeof(reader->buf),
+            reader->len = mp_stream_rw(reader->file, reader->buf, reader->alloc,
                 &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
             if (errcode != 0) {
                 // TODO handle errors properly
@@ -63,25 +64,53 @@ STATIC mp_uint_t mp_reader_vfs_readbyte(void *data) {
     return reader->buf[reader->pos++];
 }
 
+STATIC mp_uint_t mp_reader_vfs_readbuf(void *data, const byte **buf) {
+    mp_reader_vfs_t *reader = (mp_reader_vfs_t*)data;
+    if (reader->pos >= reader->len) {
+        // readbyte refills the buffer, this takes back the byte it returns
+        if (mp_reader_vfs_readbyte(data) == MP_READER_EOF) {
+            return 0;
+        }
+        reader->pos--;
+    }
+    *buf = reader->buf + reader->pos;
+    mp_uint_t len = reader->len - reader->pos;
+    reader->pos = reader->len;
+    return len;
+}
+
 STATIC void mp_reader_vfs_close(void *data) {
     mp_reader_vfs_t *reader = (mp_reader_vfs_t*)data;
-    mp_stream_close(reader->file);
-    m_del_obj(mp_reader_vfs_t, reader);
+    if (reader->file != MP_OBJ_NULL) {
+        mp_stream_close(reader->file);
+    }
+    m_del_var(mp_reader_vfs_t, byte, reader->alloc, reader);
 }
 
 void mp_reader_new_file(mp_reader_t *reader, const char *filename) {
-    mp_reader_vfs_t *rf = m_new_obj(mp_reader_vfs_t);
     mp_obj_t arg = mp_obj_new_str(filename, strlen(filename));
-    rf->file = mp_vfs_open(1, &arg, (mp_map_t*)&mp_const_empty_map);
+    mp_obj_t file = mp_vfs_open(1, &arg, (mp_map_t*)&mp_const_empty_map);
+    mp_reader_vfs_t *rf = m_new_obj_var(mp_reader_vfs_t, byte, MICROPY_READER_VFS_BUF_SIZE);
+    rf->file = file;
+    rf->alloc = MICROPY_READER_VFS_BUF_SIZE;
+    // fill the whole buffer, so that a file that fits is read in one go
     int errcode;
-    rf->len = mp_stream_rw(rf->file, rf->buf, sizeof(rf->buf), &errcode, MP_STREAM_RW_READ | MP_STREAM_RW_ONCE);
+    rf->len = mp_stream_rw(file, rf->buf, rf->alloc, &errcode, MP_STREAM_RW_READ);
     if (errcode != 0) {
         mp_raise_OSError(errcode);
     }
+    if (rf->len < rf->alloc) {
+        // all of the file is in the buffer: close it now and give back the rest
+        rf->file = MP_OBJ_NULL;
+        mp_stream_close(file);
+        rf = (mp_reader_vfs_t*)m_renew(byte, rf, sizeof(mp_reader_vfs_t) + rf->alloc, sizeof(mp_reader_vfs_t) + rf->len);
+        rf->alloc = rf->len;
+    }
     rf->pos = 0;
     reader->data = rf;
     reader->readbyte = mp_reader_vfs_readbyte;
     reader->close = mp_reader_vfs_close;
+    reader->readbuf = mp_reader_vfs_readbuf;
 }
 
 #endif // MICROPY_READER_VFS
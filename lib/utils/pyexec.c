@@ -53,6 +53,7 @@ STATIC bool repl_display_debugging_info = 0;
 #define EXEC_FLAG_SOURCE_IS_RAW_CODE (8)
 #define EXEC_FLAG_SOURCE_IS_VSTR (16)
 #define EXEC_FLAG_SOURCE_IS_FILENAME (32)
+#define EXEC_FLAG_SOURCE_IS_READER (64)
 
 // parses, compiles and executes the code in the lexer
 // frees the lexer before returning
@@ -83,22 +84,37 @@ STATIC int parse_compile_execute(const void *source, mp_parse_input_kind_t input
                 lex = mp_lexer_new_from_str_len(MP_QSTR__lt_stdin_gt_, vstr->buf, vstr->len, 0);
             } else if (exec_flags & EXEC_FLAG_SOURCE_IS_FILENAME) {
                 lex = mp_lexer_new_from_file(source);
+            } else if (exec_flags & EXEC_FLAG_SOURCE_IS_READER) {
+                lex = mp_lexer_new(MP_QSTR__lt_stdin_gt_, *(const mp_reader_t*)source);
             } else {
                 lex = (mp_lexer_t*)source;
             }
-            // source is a lexer, parse and compile the script
-            qstr source_name = lex->source_name;
-            mp_parse_tree_t parse_tree = mp_parse(lex, input_kind);
-            module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, exec_flags & EXEC_FLAG_IS_REPL);
+            #if MICROPY_COMP_STREAM_FILE_INPUT
+            if (exec_flags & EXEC_FLAG_SOURCE_IS_FILENAME) {
+                // script files are executed statement by statement as they are compiled
+                mp_hal_set_interrupt_char(CHAR_CTRL_C); // allow ctrl-C to interrupt us
+                start = mp_hal_ticks_ms();
+                mp_parse_compile_execute_stream(lex, mp_globals_get(), mp_locals_get());
+                module_fun = MP_OBJ_NULL;
+            } else
+            #endif
+            {
+                // source is a lexer, parse and compile the script
+                qstr source_name = lex->source_name;
+                mp_parse_tree_t parse_tree = mp_parse(lex, input_kind);
+                module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, exec_flags & EXEC_FLAG_IS_REPL);
+            }
             #else
             mp_raise_msg(&mp_type_RuntimeError, "script compilation not supported");
             #endif
         }
 
         // execute code
-        mp_hal_set_interrupt_char(CHAR_CTRL_C); // allow ctrl-C to interrupt us
-        start = mp_hal_ticks_ms();
-        mp_call_function_0(module_fun);
+        if (module_fun != MP_OBJ_NULL) {
+            mp_hal_set_interrupt_char(CHAR_CTRL_C); // allow ctrl-C to interrupt us
+            start = mp_hal_ticks_ms();
+            mp_call_function_0(module_fun);
+        }
         mp_hal_set_interrupt_char(-1); // disable interrupt
         nlr_pop();
         ret = 1;
@@ -109,6 +125,12 @@ STATIC int parse_compile_execute(const void *source, mp_parse_input_kind_t input
         // uncaught exception
         // FIXME it could be that an interrupt happens just before we disable it here
         mp_hal_set_interrupt_char(-1); // disable interrupt
+        if (exec_flags & EXEC_FLAG_SOURCE_IS_READER) {
+            // the parser doesn't free the lexer if it raises, so make sure
+            // the rest of the input is consumed
+            const mp_reader_t *reader = source;
+            reader->close(reader->data);
+        }
         // print EOF after normal output
         if (exec_flags & EXEC_FLAG_PRINT_EOF) {
             mp_hal_stdout_tx_strn("\x04", 1);
@@ -355,6 +377,87 @@ int pyexec_event_repl_process_char(int c) {
 
 #else // MICROPY_REPL_EVENT_DRIVEN
 
+#if MICROPY_REPL_RAW_PASTE
+
+// Raw-paste mode is entered from the raw REPL with "\x05A\x01".  The device
+// replies "R\x01" and a 16-bit little-endian window size, and the host may
+// then send that many bytes plus one more window.  Each "\x01" from the
+// device grants another window.  The host ends the code with "\x04", which
+// the device echoes before running it as in the raw REPL; a "\x04" from the
+// device before that means it stopped reading early and the host should
+// send its "\x04" straight away.
+typedef struct _mp_reader_stdin_t {
+    bool eof;
+    uint16_t window_max;
+    uint16_t window_remain;
+} mp_reader_stdin_t;
+
+STATIC mp_uint_t mp_reader_stdin_readbyte(void *data) {
+    mp_reader_stdin_t *reader = (mp_reader_stdin_t*)data;
+
+    if (reader->eof) {
+        return MP_READER_EOF;
+    }
+
+    int c = mp_hal_stdin_rx_chr();
+
+    if (c == CHAR_CTRL_C || c == CHAR_CTRL_D) {
+        reader->eof = true;
+        mp_hal_stdout_tx_strn("\x04", 1); // indicate end to host
+        if (c == CHAR_CTRL_C) {
+            #if MICROPY_KBD_EXCEPTION
+            MP_STATE_VM(mp_kbd_exception).traceback_data = NULL;
+            nlr_raise(MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_kbd_exception)));
+            #else
+            mp_raise_msg(&mp_type_KeyboardInterrupt, NULL);
+            #endif
+        }
+        return MP_READER_EOF;
+    }
+
+    if (--reader->window_remain == 0) {
+        mp_hal_stdout_tx_strn("\x01", 1); // indicate window available to host
+        reader->window_remain = reader->window_max;
+    }
+
+    return c;
+}
+
+STATIC void mp_reader_stdin_close(void *data) {
+    mp_reader_stdin_t *reader = (mp_reader_stdin_t*)data;
+    if (!reader->eof) {
+        reader->eof = true;
+        mp_hal_stdout_tx_strn("\x04", 1); // indicate end to host
+        for (;;) {
+            int c = mp_hal_stdin_rx_chr();
+            if (c == CHAR_CTRL_C || c == CHAR_CTRL_D) {
+                break;
+            }
+        }
+    }
+}
+
+STATIC int pyexec_raw_paste(int cmd) {
+    if (cmd != 'A') {
+        // unsupported command
+        mp_hal_stdout_tx_strn("R\x00", 2);
+        return 0;
+    }
+
+    // Indicate reception of the command, then the window size: the window is
+    // half the stdin buffer, and sending its size implicitly grants the first
+    // window so the 0x01 grants the second.
+    size_t window = MICROPY_REPL_STDIN_BUFFER_MAX / 2;
+    char reply[5] = { 'R', 0x01, window & 0xff, window >> 8, 0x01 };
+    mp_hal_stdout_tx_strn(reply, sizeof(reply));
+
+    mp_reader_stdin_t reader_stdin = { false, window, window };
+    mp_reader_t reader = { &reader_stdin, mp_reader_stdin_readbyte, mp_reader_stdin_close };
+    return parse_compile_execute(&reader, MP_PARSE_FILE_INPUT, EXEC_FLAG_PRINT_EOF | EXEC_FLAG_SOURCE_IS_READER);
+}
+
+#endif
+
 int pyexec_raw_repl(void) {
     vstr_t line;
     vstr_init(&line, 32);
@@ -368,6 +471,17 @@ raw_repl_reset:
         for (;;) {
             int c = mp_hal_stdin_rx_chr();
             if (c == CHAR_CTRL_A) {
+                #if MICROPY_REPL_RAW_PASTE
+                if (line.len == 2 && line.buf[0] == CHAR_CTRL_E) {
+                    int ret = pyexec_raw_paste(line.buf[1]);
+                    if (ret & PYEXEC_FORCED_EXIT) {
+                        return ret;
+                    }
+                    vstr_reset(&line);
+                    mp_hal_stdout_tx_str(">");
+                    continue;
+                }
+                #endif
                 // reset raw REPL
                 goto raw_repl_reset;
             } else if (c == CHAR_CTRL_B) {
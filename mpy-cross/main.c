@@ -45,6 +45,7 @@ mp_uint_t mp_verbose_flag = 0;
 // Heap size of GC heap (if enabled)
 // Make it larger on a 64 bit machine, because pointers are larger.
 long heap_size = 1024*1024 * (sizeof(mp_uint_t) / 4);
+STATIC char *heap;
 
 STATIC void stderr_print_strn(void *env, const char *str, mp_uint_t len) {
     (void)env;
@@ -54,54 +55,244 @@ STATIC void stderr_print_strn(void *env, const char *str, mp_uint_t len) {
 
 STATIC const mp_print_t mp_stderr_print = {NULL, stderr_print_strn};
 
+// Cache of compiled output (if enabled), as files named after a hash of
+// everything that goes into the output: the compiler itself, the options,
+// the embedded source name and the source
+STATIC const char *cache_dir = NULL;
+STATIC uint64_t cache_compiler_hash;
+
+STATIC uint64_t fnv1a_hash(uint64_t h, const void *data, size_t len) {
+    const byte *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+#define FNV1A_INIT (0xcbf29ce484222325ULL)
+
+STATIC byte *read_file(const char *file, size_t *len) {
+    FILE *f = fopen(file, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    size_t alloc = 4096;
+    byte *buf = malloc(alloc);
+    *len = 0;
+    size_t n;
+    while (buf != NULL && (n = fread(buf + *len, 1, alloc - *len, f)) > 0) {
+        *len += n;
+        if (*len == alloc) {
+            alloc *= 2;
+            byte *new_buf = realloc(buf, alloc);
+            if (new_buf == NULL) {
+                free(buf);
+            }
+            buf = new_buf;
+        }
+    }
+    fclose(f);
+    return buf;
+}
+
+STATIC bool write_file(const char *file, const void *data, size_t len) {
+    FILE *f = fopen(file, "wb");
+    if (f == NULL) {
+        return false;
+    }
+    bool ok = fwrite(data, 1, len, f) == len;
+    ok = (fclose(f) == 0) && ok;
+    return ok;
+}
+
+// Hash the compiler binary, so the cache is invalidated when it's rebuilt;
+// the cache is off if it can't be found
+STATIC void cache_init(const char *argv0) {
+    size_t len;
+    byte *buf = read_file(argv0, &len);
+    if (buf == NULL) {
+        mp_printf(&mp_stderr_print, "can't read %s, not using cache\n", argv0);
+        cache_dir = NULL;
+        return;
+    }
+    cache_compiler_hash = fnv1a_hash(FNV1A_INIT, buf, len);
+    free(buf);
+}
+
+STATIC char *cache_file_name(const char *source_name, const byte *src, size_t src_len) {
+    uint64_t h = cache_compiler_hash;
+    int32_t opts[] = {
+        emit_opt,
+        MP_STATE_VM(mp_optimise_value),
+        mp_dynamic_compiler.small_int_bits,
+        mp_dynamic_compiler.opt_cache_map_lookup_in_bytecode,
+        mp_dynamic_compiler.py_builtins_str_unicode,
+        mp_dynamic_compiler.native_arch,
+    };
+    h = fnv1a_hash(h, opts, sizeof(opts));
+    h = fnv1a_hash(h, source_name, strlen(source_name) + 1);
+    h = fnv1a_hash(h, src, src_len);
+    size_t len = strlen(cache_dir) + 1 + 16 + 4 + 1;
+    char *name = malloc(len);
+    snprintf(name, len, "%s/%08x%08x.mpy", cache_dir, (unsigned)(h >> 32), (unsigned)h);
+    return name;
+}
+
+// Add to the cache by writing a temporary file then renaming it, so that
+// concurrent compilers never see a partial entry
+STATIC void cache_store(const char *cache_file, const byte *data, size_t len) {
+    size_t tmp_len = strlen(cache_file) + 16;
+    char *tmp = malloc(tmp_len);
+    snprintf(tmp, tmp_len, "%s.%d", cache_file, (int)getpid());
+    if (!write_file(tmp, data, len) || rename(tmp, cache_file) != 0) {
+        remove(tmp);
+    }
+    free(tmp);
+}
+
+// Set up the VM, or set it up again for the next input of a batch so that
+// what is compiled doesn't depend on the qstrs interned for the inputs
+// before it (the parser makes a string constant a qstr if it exists)
+STATIC void init_vm(void) {
+    static bool vm_used = false;
+    uint optimise_value = 0;
+    if (vm_used) {
+        optimise_value = MP_STATE_VM(mp_optimise_value);
+        mp_deinit();
+    }
+    gc_init(heap, heap + heap_size);
+    mp_init();
+    mp_obj_list_init(mp_sys_path, 0);
+    mp_obj_list_init(mp_sys_argv, 0);
+    if (vm_used) {
+        MP_STATE_VM(mp_optimise_value) = optimise_value;
+    }
+    vm_used = true;
+}
+
 STATIC int compile_and_save(const char *file, const char *output_file, const char *source_file) {
-    nlr_buf_t nlr;
-    if (nlr_push(&nlr) == 0) {
-        mp_lexer_t *lex = mp_lexer_new_from_file(file);
+    static bool compiled = false;
+    size_t src_len;
+    byte *src = read_file(file, &src_len);
+    if (src == NULL) {
+        mp_printf(&mp_stderr_print, "can't open %s\n", file);
+        return 1;
+    }
+    const char *source_name = source_file == NULL ? file : source_file;
 
-        qstr source_name;
-        if (source_file == NULL) {
-            source_name = lex->source_name;
-        } else {
-            source_name = qstr_from_str(source_file);
+    char *cache_file = NULL;
+    if (cache_dir != NULL) {
+        cache_file = cache_file_name(source_name, src, src_len);
+        size_t len;
+        byte *cached = read_file(cache_file, &len);
+        if (cached != NULL) {
+            bool ok = write_file(output_file, cached, len);
+            free(cached);
+            if (ok) {
+                if (mp_verbose_flag) {
+                    mp_printf(&mp_stderr_print, "%s: cached\n", file);
+                }
+                free(cache_file);
+                free(src);
+                return 0;
+            }
         }
+    }
+
+    if (compiled) {
+        init_vm();
+    }
+    compiled = true;
+
+    int ret;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        qstr source_qstr = qstr_from_str(source_name);
+        mp_lexer_t *lex = mp_lexer_new_from_str_len(qstr_from_str(file), (const char*)src, src_len, 0);
 
         #if MICROPY_PY___FILE__
         if (input_kind == MP_PARSE_FILE_INPUT) {
-            mp_store_global(MP_QSTR___file__, MP_OBJ_NEW_QSTR(source_name));
+            mp_store_global(MP_QSTR___file__, MP_OBJ_NEW_QSTR(source_qstr));
         }
         #endif
 
         mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
-        mp_raw_code_t *rc = mp_compile_to_raw_code(&parse_tree, source_name, emit_opt, false);
+        mp_raw_code_t *rc = mp_compile_to_raw_code(&parse_tree, source_qstr, emit_opt, false);
 
         vstr_t vstr;
-        vstr_init(&vstr, 16);
-        if (output_file == NULL) {
-            vstr_add_str(&vstr, file);
-            vstr_cut_tail_bytes(&vstr, 2);
-            vstr_add_str(&vstr, "mpy");
+        mp_print_t print;
+        vstr_init_print(&vstr, 1024, &print);
+        mp_raw_code_save(rc, &print);
+        if (write_file(output_file, vstr.buf, vstr.len)) {
+            if (cache_file != NULL) {
+                cache_store(cache_file, (const byte*)vstr.buf, vstr.len);
+            }
+            ret = 0;
         } else {
-            vstr_add_str(&vstr, output_file);
+            mp_printf(&mp_stderr_print, "can't write %s\n", output_file);
+            ret = 1;
         }
-        mp_raw_code_save_file(rc, vstr_null_terminated_str(&vstr));
         vstr_clear(&vstr);
 
         nlr_pop();
-        return 0;
     } else {
         // uncaught exception
         mp_obj_print_exception(&mp_stderr_print, (mp_obj_t)nlr.ret_val);
-        return 1;
+        ret = 1;
+    }
+    free(cache_file);
+    free(src);
+    return ret;
+}
+
+// Compile each input in turn in this one process; the names they are
+// compiled under and the outputs are as described under usage()
+STATIC int compile_all(size_t n_inputs, char **inputs, const char *output, const char *source_file, const char *root) {
+    size_t root_len = root == NULL ? 0 : strlen(root);
+    int ret = 0;
+    for (size_t i = 0; i < n_inputs; i++) {
+        const char *file = inputs[i];
+        const char *rel = file;
+        if (root != NULL) {
+            if (strncmp(file, root, root_len) != 0 || file[root_len] != '/') {
+                mp_printf(&mp_stderr_print, "%s is not under %s\n", file, root);
+                ret = 1;
+                continue;
+            }
+            rel = file + root_len + 1;
+        }
+
+        // the name is kept off the GC heap because the VM may be reset
+        size_t len = (output == NULL ? 0 : strlen(output)) + 1 + strlen(file) + sizeof(".mpy");
+        char *output_file = malloc(len);
+        if (output != NULL && root == NULL) {
+            snprintf(output_file, len, "%s", output);
+        } else {
+            const char *name = output == NULL ? file : rel;
+            int name_len = strlen(name);
+            if (name_len >= 3 && strcmp(name + name_len - 3, ".py") == 0) {
+                name_len -= 3;
+            }
+            snprintf(output_file, len, "%s%s%.*s.mpy", output == NULL ? "" : output, output == NULL ? "" : "/", name_len, name);
+        }
+
+        if (compile_and_save(file, output_file, root != NULL ? rel : source_file) != 0) {
+            ret = 1;
+        }
+        free(output_file);
     }
+    return ret;
 }
 
 STATIC int usage(char **argv) {
     printf(
-"usage: %s [<opts>] [-X <implopt>] <input filename>\n"
+"usage: %s [<opts>] [-X <implopt>] <input filename>...\n"
 "Options:\n"
 "-o : output file for compiled bytecode (defaults to input with .mpy extension)\n"
 "-s : source filename to embed in the compiled bytecode (defaults to input file)\n"
+"-r <dir> : inputs are under dir: embed their names relative to it, and write\n"
+"           each one to the same relative path (.mpy) under the -o directory\n"
+"-c <dir> : reuse output cached in dir for unchanged inputs and options\n"
 "-v : verbose (trace various operations); can be multiple\n"
 "-O[N] : apply bytecode optimizations of level N\n"
 "\n"
@@ -180,15 +371,11 @@ MP_NOINLINE int main_(int argc, char **argv) {
 
     pre_process_options(argc, argv);
 
-    char *heap = malloc(heap_size);
-    gc_init(heap, heap + heap_size);
-
-    mp_init();
+    heap = malloc(heap_size);
+    init_vm();
 #ifdef _WIN32
     set_fmode_binary();
 #endif
-    mp_obj_list_init(mp_sys_path, 0);
-    mp_obj_list_init(mp_sys_argv, 0);
 
     // set default compiler configuration
     mp_dynamic_compiler.small_int_bits = 31;
@@ -202,9 +389,11 @@ MP_NOINLINE int main_(int argc, char **argv) {
     mp_dynamic_compiler.native_arch = MP_NATIVE_ARCH_NONE;
     #endif
 
-    const char *input_file = NULL;
+    char **input_files = malloc(argc * sizeof(char*));
+    size_t n_input_files = 0;
     const char *output_file = NULL;
     const char *source_file = NULL;
+    const char *root_dir = NULL;
 
     // parse main options
     for (int a = 1; a < argc; a++) {
@@ -232,6 +421,18 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 }
                 a += 1;
                 source_file = argv[a];
+            } else if (strcmp(argv[a], "-r") == 0) {
+                if (a + 1 >= argc) {
+                    exit(usage(argv));
+                }
+                a += 1;
+                root_dir = argv[a];
+            } else if (strcmp(argv[a], "-c") == 0) {
+                if (a + 1 >= argc) {
+                    exit(usage(argv));
+                }
+                a += 1;
+                cache_dir = argv[a];
             } else if (strncmp(argv[a], "-msmall-int-bits=", sizeof("-msmall-int-bits=") - 1) == 0) {
                 char *end;
                 mp_dynamic_compiler.small_int_bits =
@@ -267,20 +468,24 @@ MP_NOINLINE int main_(int argc, char **argv) {
                 return usage(argv);
             }
         } else {
-            if (input_file != NULL) {
-                mp_printf(&mp_stderr_print, "multiple input files\n");
-                exit(1);
-            }
-            input_file = argv[a];
+            input_files[n_input_files++] = argv[a];
         }
     }
 
-    if (input_file == NULL) {
+    if (n_input_files == 0) {
         mp_printf(&mp_stderr_print, "no input file\n");
         exit(1);
     }
+    if (n_input_files > 1 && root_dir == NULL && (output_file != NULL || source_file != NULL)) {
+        mp_printf(&mp_stderr_print, "multiple input files\n");
+        exit(1);
+    }
+    if (cache_dir != NULL) {
+        cache_init(argv[0]);
+    }
 
-    int ret = compile_and_save(input_file, output_file, source_file);
+    int ret = compile_all(n_input_files, input_files, output_file, source_file, root_dir);
+    free(input_files);
 
     #if MICROPY_PY_MICROPYTHON_MEM_INFO
     if (mp_verbose_flag) {
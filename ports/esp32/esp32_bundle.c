@@ -0,0 +1,572 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+
+#include "py/runtime.h"
+#include "py/stream.h"
+#include "py/mperrno.h"
+#include "py/objlist.h"
+#include "extmod/vfs.h"
+#include "modesp32.h"
+
+// Read-only filesystem over a module bundle in a data partition, so that
+// library updates can be shipped with ota.begin('bundle') instead of a
+// whole firmware image.  The partition is memory mapped and files are read
+// straight out of flash.  The bundle is built by makebundle.py:
+//
+//   header:  "MPYB", u16 version, u16 count, u32 size of the whole bundle
+//   index:   count * (u32 offset, u32 length, u8 name length, name)
+//   data
+//
+// All integers are little endian, offsets are from the start of the bundle
+// and names are paths relative to the mount point, eg "pystubit/dsply.mpy".
+// Directories are implied by the names.
+
+#define BUNDLE_HEADER_SIZE      (12)
+#define BUNDLE_VERSION          (1)
+#define BUNDLE_DEFAULT_LABEL    "bundle"
+
+typedef struct _esp32_bundle_obj_t {
+    mp_obj_base_t base;
+    const esp_partition_t *partition;
+    spi_flash_mmap_handle_t handle;
+    const uint8_t *base_ptr;
+    uint32_t size;
+    uint16_t count;
+    uint16_t gen;               // bumped on unmap so stale files see it
+    bool mapped;
+    bool pinned;                // mmap() handed out a view into the mapping
+} esp32_bundle_obj_t;
+
+typedef struct _esp32_bundle_file_obj_t {
+    mp_obj_base_t base;
+    const uint8_t *data;
+    uint32_t len;
+    uint32_t pos;
+    uint16_t gen;
+    bool open;
+} esp32_bundle_file_obj_t;
+
+typedef struct _esp32_bundle_entry_t {
+    const char *name;
+    size_t name_len;
+    uint32_t offset;
+    uint32_t len;
+} esp32_bundle_entry_t;
+
+const mp_obj_type_t esp32_bundle_type;
+STATIC const mp_obj_type_t esp32_bundle_fileio_type;
+STATIC const mp_obj_type_t esp32_bundle_textio_type;
+
+// there is only one bundle partition, so the object is a singleton that
+// lives outside the heap along with its mapping
+STATIC esp32_bundle_obj_t esp32_bundle_obj = {{&esp32_bundle_type}};
+
+STATIC uint32_t bundle_get_u32(const uint8_t *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Memoryviews from mmap() point straight into the mapping and can outlive a
+// umount, so once pinned the MMU pages are kept until the next soft reset.
+// base_ptr is non-NULL for as long as the pages are mapped.
+STATIC void bundle_unmap(esp32_bundle_obj_t *self) {
+    if (self->mapped) {
+        self->mapped = false;
+        self->gen++;
+    }
+    if (self->base_ptr != NULL && !self->pinned) {
+        spi_flash_munmap(self->handle);
+        self->base_ptr = NULL;
+    }
+}
+
+// Walk the index; returns false at the end.  *pos starts at 0.
+STATIC bool bundle_next_entry(esp32_bundle_obj_t *self, size_t *pos, esp32_bundle_entry_t *e) {
+    if (*pos == 0) {
+        *pos = BUNDLE_HEADER_SIZE;
+    }
+    if (*pos >= self->size) {
+        return false;
+    }
+    const uint8_t *p = self->base_ptr + *pos;
+    e->offset = bundle_get_u32(p);
+    e->len = bundle_get_u32(p + 4);
+    e->name_len = p[8];
+    e->name = (const char *)p + 9;
+    *pos += 9 + e->name_len;
+    return true;
+}
+
+STATIC void bundle_check_mapped(esp32_bundle_obj_t *self) {
+    if (!self->mapped) {
+        mp_raise_OSError(MP_ENODEV);
+    }
+}
+
+STATIC bool bundle_map(esp32_bundle_obj_t *self, const esp_partition_t *part) {
+    if (self->base_ptr == NULL) {
+        const void *ptr;
+        if (esp_partition_mmap(part, 0, part->size, SPI_FLASH_MMAP_DATA, &ptr, &self->handle) != ESP_OK) {
+            return false;
+        }
+        self->partition = part;
+        self->base_ptr = ptr;
+    }
+    self->mapped = true;
+
+    // check the header and that every entry lies inside the bundle
+    const uint8_t *p = self->base_ptr;
+    self->size = bundle_get_u32(p + 8);
+    self->count = p[6] | (p[7] << 8);
+    if ((memcmp(p, "MPYB", 4) != 0) || ((p[4] | (p[5] << 8)) != BUNDLE_VERSION)
+        || (self->size < BUNDLE_HEADER_SIZE) || (self->size > part->size)) {
+        bundle_unmap(self);
+        return false;
+    }
+    size_t pos = BUNDLE_HEADER_SIZE;
+    for (int i = 0; i < self->count; i++) {
+        if ((pos + 9 > self->size) || (pos + 9 + p[pos + 8] > self->size)) {
+            bundle_unmap(self);
+            return false;
+        }
+        uint32_t offset = bundle_get_u32(p + pos);
+        uint32_t len = bundle_get_u32(p + pos + 4);
+        if ((offset > self->size) || (len > self->size - offset)) {
+            bundle_unmap(self);
+            return false;
+        }
+        pos += 9 + p[pos + 8];
+    }
+    return true;
+}
+
+// Strip the leading and trailing slashes that the VFS layer leaves on
+STATIC const char *bundle_path(mp_obj_t path_in, size_t *len) {
+    const char *path = mp_obj_str_get_data(path_in, len);
+    while (*len > 0 && path[0] == '/') {
+        path++;
+        (*len)--;
+    }
+    while (*len > 0 && path[*len - 1] == '/') {
+        (*len)--;
+    }
+    return path;
+}
+
+STATIC bool bundle_find(esp32_bundle_obj_t *self, const char *path, size_t len, esp32_bundle_entry_t *e) {
+    size_t pos = 0;
+    for (int i = 0; i < self->count && bundle_next_entry(self, &pos, e); i++) {
+        if (e->name_len == len && memcmp(e->name, path, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+STATIC bool bundle_is_dir(esp32_bundle_obj_t *self, const char *path, size_t len) {
+    if (len == 0) {
+        return true;
+    }
+    esp32_bundle_entry_t e;
+    size_t pos = 0;
+    for (int i = 0; i < self->count && bundle_next_entry(self, &pos, &e); i++) {
+        if (e.name_len > len && e.name[len] == '/' && memcmp(e.name, path, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool esp32_bundle_is_mapped(const esp_partition_t *partition) {
+    return esp32_bundle_obj.base_ptr != NULL && esp32_bundle_obj.partition == partition;
+}
+
+/******************************************************************************/
+// Files
+
+STATIC mp_uint_t bundle_file_read(mp_obj_t self_in, void *buf, mp_uint_t size, int *errcode) {
+    esp32_bundle_file_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!self->open || self->gen != esp32_bundle_obj.gen) {
+        *errcode = MP_EBADF;
+        return MP_STREAM_ERROR;
+    }
+    if (size > self->len - self->pos) {
+        size = self->len - self->pos;
+    }
+    memcpy(buf, self->data + self->pos, size);
+    self->pos += size;
+    return size;
+}
+
+STATIC mp_uint_t bundle_file_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
+    esp32_bundle_file_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (request == MP_STREAM_SEEK) {
+        struct mp_stream_seek_t *s = (struct mp_stream_seek_t*)(uintptr_t)arg;
+        mp_off_t pos = s->offset;
+        if (s->whence == 1) {
+            pos += self->pos;
+        } else if (s->whence == 2) {
+            pos += self->len;
+        }
+        if (pos < 0) {
+            pos = 0;
+        } else if (pos > self->len) {
+            pos = self->len;
+        }
+        self->pos = pos;
+        s->offset = pos;
+        return 0;
+    } else if (request == MP_STREAM_CLOSE) {
+        self->open = false;
+        return 0;
+    } else {
+        *errcode = MP_EINVAL;
+        return MP_STREAM_ERROR;
+    }
+}
+
+STATIC mp_obj_t bundle_file___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    return mp_stream_close(args[0]);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(bundle_file___exit___obj, 4, 4, bundle_file___exit__);
+
+STATIC const mp_rom_map_elem_t bundle_file_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_readline_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readlines), MP_ROM_PTR(&mp_stream_unbuffered_readlines_obj) },
+    { MP_ROM_QSTR(MP_QSTR_close), MP_ROM_PTR(&mp_stream_close_obj) },
+    { MP_ROM_QSTR(MP_QSTR_seek), MP_ROM_PTR(&mp_stream_seek_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tell), MP_ROM_PTR(&mp_stream_tell_obj) },
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&mp_identity_obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&bundle_file___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(bundle_file_locals_dict, bundle_file_locals_dict_table);
+
+STATIC const mp_stream_p_t bundle_fileio_stream_p = {
+    .read = bundle_file_read,
+    .ioctl = bundle_file_ioctl,
+    .is_seekable = true,
+};
+
+STATIC const mp_obj_type_t esp32_bundle_fileio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_FileIO,
+    .getiter = mp_identity_getiter,
+    .iternext = mp_stream_unbuffered_iter,
+    .protocol = &bundle_fileio_stream_p,
+    .locals_dict = (mp_obj_dict_t*)&bundle_file_locals_dict,
+};
+
+STATIC const mp_stream_p_t bundle_textio_stream_p = {
+    .read = bundle_file_read,
+    .ioctl = bundle_file_ioctl,
+    .is_seekable = true,
+    .is_text = true,
+};
+
+STATIC const mp_obj_type_t esp32_bundle_textio_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_TextIOWrapper,
+    .getiter = mp_identity_getiter,
+    .iternext = mp_stream_unbuffered_iter,
+    .protocol = &bundle_textio_stream_p,
+    .locals_dict = (mp_obj_dict_t*)&bundle_file_locals_dict,
+};
+
+/******************************************************************************/
+// Filesystem
+
+// Bundle(partition='bundle')
+STATIC mp_obj_t esp32_bundle_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 0, 1, false);
+    const char *label = (n_args > 0) ? mp_obj_str_get_str(args[0]) : BUNDLE_DEFAULT_LABEL;
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == NULL) {
+        mp_raise_ValueError("partition not found");
+    }
+    esp32_bundle_obj_t *self = &esp32_bundle_obj;
+    if (self->pinned && self->partition != part) {
+        mp_raise_ValueError("bundle pinned by mmap()");
+    }
+    if (self->mapped && self->partition != part) {
+        // the previous bundle goes away with any files open on it
+        bundle_unmap(self);
+    }
+    if (!self->mapped && !bundle_map(self, part)) {
+        mp_raise_ValueError("no valid bundle");
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t esp32_bundle_mount(mp_obj_t self_in, mp_obj_t readonly, mp_obj_t mkfs) {
+    esp32_bundle_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (mp_obj_is_true(mkfs)) {
+        mp_raise_OSError(MP_EPERM);
+    }
+    if (!self->mapped && !bundle_map(self, self->partition)) {
+        mp_raise_ValueError("no valid bundle");
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_bundle_mount_obj, esp32_bundle_mount);
+
+STATIC mp_obj_t esp32_bundle_umount(mp_obj_t self_in) {
+    bundle_unmap(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_bundle_umount_obj, esp32_bundle_umount);
+
+STATIC mp_obj_t esp32_bundle_open(mp_obj_t self_in, mp_obj_t path_in, mp_obj_t mode_in) {
+    esp32_bundle_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    bundle_check_mapped(self);
+    const char *mode = mp_obj_str_get_str(mode_in);
+    const mp_obj_type_t *type = &esp32_bundle_textio_type;
+    for (; *mode; mode++) {
+        if (*mode == 'w' || *mode == 'a' || *mode == 'x' || *mode == '+') {
+            mp_raise_OSError(MP_EROFS);
+        }
+        if (*mode == 'b') {
+            type = &esp32_bundle_fileio_type;
+        }
+    }
+    size_t len;
+    const char *path = bundle_path(path_in, &len);
+    esp32_bundle_entry_t e;
+    if (!bundle_find(self, path, len, &e)) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    esp32_bundle_file_obj_t *o = m_new_obj(esp32_bundle_file_obj_t);
+    o->base.type = type;
+    o->data = self->base_ptr + e.offset;
+    o->len = e.len;
+    o->pos = 0;
+    o->gen = self->gen;
+    o->open = true;
+    return MP_OBJ_FROM_PTR(o);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_bundle_open_obj, esp32_bundle_open);
+
+STATIC mp_obj_t esp32_bundle_ilistdir(mp_obj_t self_in, mp_obj_t path_in) {
+    esp32_bundle_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    bundle_check_mapped(self);
+    size_t len;
+    const char *path = bundle_path(path_in, &len);
+    if (!bundle_is_dir(self, path, len)) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    size_t prefix = (len > 0) ? len + 1 : 0;
+
+    mp_obj_list_t *list = MP_OBJ_TO_PTR(mp_obj_new_list(0, NULL));
+    esp32_bundle_entry_t e;
+    size_t pos = 0;
+    for (int i = 0; i < self->count && bundle_next_entry(self, &pos, &e); i++) {
+        if (e.name_len <= prefix || (len > 0 && (e.name[len] != '/' || memcmp(e.name, path, len) != 0))) {
+            continue;
+        }
+        // the next path component is either a file or an implied directory
+        const char *name = e.name + prefix;
+        size_t name_len = e.name_len - prefix;
+        const char *slash = memchr(name, '/', name_len);
+        mp_int_t type = MP_S_IFREG;
+        if (slash != NULL) {
+            name_len = slash - name;
+            type = MP_S_IFDIR;
+        }
+        mp_obj_t name_obj = mp_obj_new_str(name, name_len);
+        bool seen = false;
+        for (size_t j = 0; j < list->len; j++) {
+            mp_obj_tuple_t *t = MP_OBJ_TO_PTR(list->items[j]);
+            if (mp_obj_equal(t->items[0], name_obj)) {
+                seen = true;
+                break;
+            }
+        }
+        if (!seen) {
+            mp_obj_t items[3] = { name_obj, MP_OBJ_NEW_SMALL_INT(type), MP_OBJ_NEW_SMALL_INT(0) };
+            mp_obj_list_append(MP_OBJ_FROM_PTR(list), mp_obj_new_tuple(3, items));
+        }
+    }
+    return mp_getiter(MP_OBJ_FROM_PTR(list), NULL);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_bundle_ilistdir_obj, esp32_bundle_ilistdir);
+
+STATIC mp_obj_t esp32_bundle_stat(mp_obj_t self_in, mp_obj_t path_in) {
+    esp32_bundle_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    bundle_check_mapped(self);
+    size_t len;
+    const char *path = bundle_path(path_in, &len);
+    mp_int_t mode;
+    uint32_t size = 0;
+    esp32_bundle_entry_t e;
+    if (bundle_find(self, path, len, &e)) {
+        mode = MP_S_IFREG;
+        size = e.len;
+    } else if (bundle_is_dir(self, path, len)) {
+        mode = MP_S_IFDIR;
+    } else {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(10, NULL));
+    t->items[0] = MP_OBJ_NEW_SMALL_INT(mode);
+    for (int i = 1; i < 10; i++) {
+        t->items[i] = MP_OBJ_NEW_SMALL_INT(0);
+    }
+    t->items[6] = mp_obj_new_int_from_uint(size);
+    return MP_OBJ_FROM_PTR(t);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_bundle_stat_obj, esp32_bundle_stat);
+
+STATIC mp_obj_t esp32_bundle_statvfs(mp_obj_t self_in, mp_obj_t path_in) {
+    esp32_bundle_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    bundle_check_mapped(self);
+    (void)path_in;
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(10, NULL));
+    for (int i = 0; i < 10; i++) {
+        t->items[i] = MP_OBJ_NEW_SMALL_INT(0);
+    }
+    t->items[0] = MP_OBJ_NEW_SMALL_INT(SPI_FLASH_SEC_SIZE);  // f_bsize
+    t->items[1] = t->items[0];                              // f_frsize
+    t->items[2] = MP_OBJ_NEW_SMALL_INT(self->partition->size / SPI_FLASH_SEC_SIZE); // f_blocks
+    t->items[9] = MP_OBJ_NEW_SMALL_INT(255);               // f_namemax
+    return MP_OBJ_FROM_PTR(t);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_bundle_statvfs_obj, esp32_bundle_statvfs);
+
+STATIC mp_obj_t esp32_bundle_readonly(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    (void)args;
+    mp_raise_OSError(MP_EROFS);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_bundle_readonly_obj, 2, 3, esp32_bundle_readonly);
+
+// mmap(path) -> read-only memoryview of a file, read straight from flash
+// through the cache without copying it into the heap
+STATIC mp_obj_t esp32_bundle_mmap(mp_obj_t self_in, mp_obj_t path_in) {
+    esp32_bundle_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    bundle_check_mapped(self);
+    size_t len;
+    const char *path = bundle_path(path_in, &len);
+    esp32_bundle_entry_t e;
+    if (!bundle_find(self, path, len, &e)) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    self->pinned = true;
+    return mp_obj_new_memoryview('B', e.len, (void*)(self->base_ptr + e.offset));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_bundle_mmap_obj, esp32_bundle_mmap);
+
+// info() -> (partition label, number of files, bundle size)
+STATIC mp_obj_t esp32_bundle_info(mp_obj_t self_in) {
+    esp32_bundle_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    bundle_check_mapped(self);
+    mp_obj_t items[3] = {
+        mp_obj_new_str(self->partition->label, strlen(self->partition->label)),
+        MP_OBJ_NEW_SMALL_INT(self->count),
+        mp_obj_new_int_from_uint(self->size),
+    };
+    return mp_obj_new_tuple(3, items);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_bundle_info_obj, esp32_bundle_info);
+
+STATIC mp_import_stat_t esp32_bundle_import_stat(void *self_in, const char *path) {
+    esp32_bundle_obj_t *self = self_in;
+    if (!self->mapped) {
+        return MP_IMPORT_STAT_NO_EXIST;
+    }
+    size_t len = strlen(path);
+    while (len > 0 && path[0] == '/') {
+        path++;
+        len--;
+    }
+    esp32_bundle_entry_t e;
+    if (bundle_find(self, path, len, &e)) {
+        return MP_IMPORT_STAT_FILE;
+    }
+    if (bundle_is_dir(self, path, len)) {
+        return MP_IMPORT_STAT_DIR;
+    }
+    return MP_IMPORT_STAT_NO_EXIST;
+}
+
+STATIC const mp_rom_map_elem_t esp32_bundle_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_mount), MP_ROM_PTR(&esp32_bundle_mount_obj) },
+    { MP_ROM_QSTR(MP_QSTR_umount), MP_ROM_PTR(&esp32_bundle_umount_obj) },
+    { MP_ROM_QSTR(MP_QSTR_open), MP_ROM_PTR(&esp32_bundle_open_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mmap), MP_ROM_PTR(&esp32_bundle_mmap_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ilistdir), MP_ROM_PTR(&esp32_bundle_ilistdir_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stat), MP_ROM_PTR(&esp32_bundle_stat_obj) },
+    { MP_ROM_QSTR(MP_QSTR_statvfs), MP_ROM_PTR(&esp32_bundle_statvfs_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mkdir), MP_ROM_PTR(&esp32_bundle_readonly_obj) },
+    { MP_ROM_QSTR(MP_QSTR_remove), MP_ROM_PTR(&esp32_bundle_readonly_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rename), MP_ROM_PTR(&esp32_bundle_readonly_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rmdir), MP_ROM_PTR(&esp32_bundle_readonly_obj) },
+    { MP_ROM_QSTR(MP_QSTR_info), MP_ROM_PTR(&esp32_bundle_info_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(esp32_bundle_locals_dict, esp32_bundle_locals_dict_table);
+
+STATIC const mp_vfs_proto_t esp32_bundle_proto = {
+    .import_stat = esp32_bundle_import_stat,
+};
+
+const mp_obj_type_t esp32_bundle_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Bundle,
+    .make_new = esp32_bundle_make_new,
+    .protocol = &esp32_bundle_proto,
+    .locals_dict = (mp_obj_dict_t*)&esp32_bundle_locals_dict,
+};
+
+// Mount a valid bundle at /bundle ahead of everything else on sys.path,
+// so it can replace frozen packages.  Called at boot and on each soft reset.
+void esp32_bundle_boot_mount(void) {
+    // any views from mmap() went with the old heap
+    esp32_bundle_obj.pinned = false;
+    bundle_unmap(&esp32_bundle_obj);
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, BUNDLE_DEFAULT_LABEL);
+    if (part == NULL || !bundle_map(&esp32_bundle_obj, part)) {
+        return;
+    }
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t args[2] = { MP_OBJ_FROM_PTR(&esp32_bundle_obj), MP_OBJ_NEW_QSTR(MP_QSTR__slash_bundle) };
+        mp_vfs_mount(2, args, (mp_map_t*)&mp_const_empty_map);
+        mp_obj_t dest[4];
+        mp_load_method(mp_sys_path, MP_QSTR_insert, dest);
+        dest[2] = MP_OBJ_NEW_SMALL_INT(0);
+        dest[3] = MP_OBJ_NEW_QSTR(MP_QSTR__slash_bundle);
+        mp_call_method_n_kw(2, 0, dest);
+        nlr_pop();
+    } else {
+        bundle_unmap(&esp32_bundle_obj);
+    }
+}
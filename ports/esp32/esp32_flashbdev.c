@@ -0,0 +1,355 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "esp_spi_flash.h"
+#include "esp_flash_encrypt.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "extmod/vfs.h"
+#include "modesp32.h"
+
+// Block device over the user area of the SPI flash, for VfsFat.  Blocks are
+// flash sectors, so the layout is the same as the old flashbdev.FlashBdev.
+//
+// Written blocks are kept in a small write-back cache and only go to flash
+// when evicted (least recently used first) or on ioctl(BP_IOCTL_SYNC), which
+// FatFs issues when a file is flushed or closed.  So repeated updates of the
+// FAT and directory sectors while a file is written cost one erase each
+// rather than one per update.  When a block is written back its old
+// contents are compared with the new, and the erase is skipped if nothing
+// changed or if the new data only clears bits.
+
+#define FLASHBDEV_SEC_SIZE          (SPI_FLASH_SEC_SIZE)
+#define FLASHBDEV_DEFAULT_START     (0x601000)
+#define FLASHBDEV_DEFAULT_CACHE     (4)
+#define FLASHBDEV_BOOT_SIZE         (2048 * 1024) // as used by flashbdev.py
+#define FLASHBDEV_CMP_CHUNK         (256)   // flash is compared in chunks this big
+#define FLASHBDEV_NO_BLOCK          (0xffffffff)
+
+typedef struct _esp32_flashbdev_cache_t {
+    uint32_t block;
+    uint32_t used;              // value of the object's clock at last use
+    bool dirty;
+} esp32_flashbdev_cache_t;
+
+typedef struct _esp32_flashbdev_obj_t {
+    mp_obj_base_t base;
+    struct _esp32_flashbdev_obj_t *next;
+    uint32_t start_sector;
+    uint32_t blocks;
+    uint32_t clock;
+    uint32_t hits;
+    uint32_t erases;
+    uint32_t programs;
+    uint8_t *bufs;              // n_cache sectors, one per cache entry
+    size_t n_cache;
+    esp32_flashbdev_cache_t cache[];
+} esp32_flashbdev_obj_t;
+
+STATIC void flashbdev_check(esp_err_t res) {
+    if (res != ESP_OK) {
+        mp_raise_OSError(MP_EIO);
+    }
+}
+
+STATIC uint8_t *flashbdev_buf(esp32_flashbdev_obj_t *self, esp32_flashbdev_cache_t *c) {
+    return self->bufs + (c - self->cache) * FLASHBDEV_SEC_SIZE;
+}
+
+STATIC esp32_flashbdev_cache_t *flashbdev_lookup(esp32_flashbdev_obj_t *self, uint32_t block) {
+    for (size_t i = 0; i < self->n_cache; ++i) {
+        if (self->cache[i].block == block) {
+            return &self->cache[i];
+        }
+    }
+    return NULL;
+}
+
+// Write a dirty cache entry back to flash.  Unlike esp.flash_erase() this
+// keeps the GIL: the FAT filesystem on top isn't reentrant, so another
+// thread must not get into it while a block operation is under way.
+STATIC void flashbdev_write_back(esp32_flashbdev_obj_t *self, esp32_flashbdev_cache_t *c) {
+    if (!c->dirty) {
+        return;
+    }
+    uint32_t addr = (self->start_sector + c->block) * FLASHBDEV_SEC_SIZE;
+    const uint8_t *buf = flashbdev_buf(self, c);
+
+    // Programming can only clear bits, so the sector needs erasing only if
+    // the new data sets a bit which is clear in flash.  With flash
+    // encryption the stored bits don't correspond to the data, so always
+    // erase then.
+    bool same = true;
+    bool need_erase = esp_flash_encryption_enabled();
+    for (uint32_t off = 0; off < FLASHBDEV_SEC_SIZE && !need_erase; off += FLASHBDEV_CMP_CHUNK) {
+        uint32_t old[FLASHBDEV_CMP_CHUNK / 4];
+        flashbdev_check(spi_flash_read(addr + off, old, sizeof(old)));
+        const uint32_t *new = (const uint32_t*)(buf + off);
+        for (size_t i = 0; i < MP_ARRAY_SIZE(old); ++i) {
+            if (new[i] != old[i]) {
+                same = false;
+                if (new[i] & ~old[i]) {
+                    need_erase = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (need_erase) {
+        flashbdev_check(spi_flash_erase_sector(self->start_sector + c->block));
+        ++self->erases;
+    }
+    if (need_erase || !same) {
+        flashbdev_check(spi_flash_write(addr, buf, FLASHBDEV_SEC_SIZE));
+        ++self->programs;
+    }
+    c->dirty = false;
+}
+
+STATIC void flashbdev_sync(esp32_flashbdev_obj_t *self) {
+    for (size_t i = 0; i < self->n_cache; ++i) {
+        flashbdev_write_back(self, &self->cache[i]);
+    }
+}
+
+// Get the cache entry for a block that is about to be written, evicting the
+// least recently used entry if the block isn't cached.  If fill is true the
+// entry gets the block's current contents, for a write of part of it.
+STATIC esp32_flashbdev_cache_t *flashbdev_get(esp32_flashbdev_obj_t *self, uint32_t block, bool fill) {
+    esp32_flashbdev_cache_t *c = flashbdev_lookup(self, block);
+    if (c != NULL) {
+        ++self->hits;
+    } else {
+        c = &self->cache[0];
+        for (size_t i = 1; i < self->n_cache; ++i) {
+            esp32_flashbdev_cache_t *e = &self->cache[i];
+            if (e->block == FLASHBDEV_NO_BLOCK
+                || (c->block != FLASHBDEV_NO_BLOCK && (int32_t)(e->used - c->used) < 0)) {
+                c = e;
+            }
+        }
+        flashbdev_write_back(self, c);
+        c->block = FLASHBDEV_NO_BLOCK;
+        if (fill) {
+            flashbdev_check(spi_flash_read((self->start_sector + block) * FLASHBDEV_SEC_SIZE,
+                flashbdev_buf(self, c), FLASHBDEV_SEC_SIZE));
+        }
+        c->block = block;
+    }
+    c->used = self->clock++;
+    return c;
+}
+
+STATIC void flashbdev_check_range(esp32_flashbdev_obj_t *self, mp_int_t block, size_t len) {
+    if (block < 0 || (uint32_t)block + (len + FLASHBDEV_SEC_SIZE - 1) / FLASHBDEV_SEC_SIZE > self->blocks) {
+        mp_raise_ValueError("block out of range");
+    }
+}
+
+// Write back the caches of all block devices, so nothing is lost on a
+// soft reset or a machine.reset()/deepsleep()
+void esp32_flashbdev_sync_all(void) {
+    for (esp32_flashbdev_obj_t *self = MP_STATE_PORT(esp32_flashbdev_head); self != NULL; self = self->next) {
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            flashbdev_sync(self);
+            nlr_pop();
+        }
+    }
+    MP_STATE_PORT(esp32_flashbdev_head) = NULL;
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC mp_obj_t esp32_flashbdev_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_blocks, ARG_start, ARG_cache };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_blocks, MP_ARG_REQUIRED | MP_ARG_INT },
+        { MP_QSTR_start, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = FLASHBDEV_DEFAULT_START} },
+        { MP_QSTR_cache, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = FLASHBDEV_DEFAULT_CACHE} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t blocks = args[ARG_blocks].u_int;
+    mp_int_t start = args[ARG_start].u_int;
+    mp_int_t n_cache = args[ARG_cache].u_int;
+    if (start < 0 || start % FLASHBDEV_SEC_SIZE != 0 || blocks <= 0
+        || (uint64_t)start + (uint64_t)blocks * FLASHBDEV_SEC_SIZE > spi_flash_get_chip_size()) {
+        mp_raise_ValueError("bad flash range");
+    }
+    if (n_cache < 1) {
+        mp_raise_ValueError("cache must be at least 1");
+    }
+
+    esp32_flashbdev_obj_t *self = m_new_obj_var(esp32_flashbdev_obj_t, esp32_flashbdev_cache_t, n_cache);
+    self->base.type = type;
+    self->start_sector = start / FLASHBDEV_SEC_SIZE;
+    self->blocks = blocks;
+    self->clock = 0;
+    self->hits = 0;
+    self->erases = 0;
+    self->programs = 0;
+    self->bufs = m_new(uint8_t, n_cache * FLASHBDEV_SEC_SIZE);
+    self->n_cache = n_cache;
+    for (size_t i = 0; i < self->n_cache; ++i) {
+        self->cache[i].block = FLASHBDEV_NO_BLOCK;
+        self->cache[i].used = 0;
+        self->cache[i].dirty = false;
+    }
+    self->next = MP_STATE_PORT(esp32_flashbdev_head);
+    MP_STATE_PORT(esp32_flashbdev_head) = self;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// Mount the FAT filesystem at / the way _boot.py does, but without
+// importing anything.  Returns false if the flash is too small or holds no
+// filesystem, in which case _boot.py should run to set one up.
+bool esp32_flashbdev_boot_mount(void) {
+    if (spi_flash_get_chip_size() < FLASHBDEV_DEFAULT_START + FLASHBDEV_BOOT_SIZE) {
+        return false;
+    }
+    esp32_flashbdev_obj_t *head = MP_STATE_PORT(esp32_flashbdev_head);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_obj_t blocks = MP_OBJ_NEW_SMALL_INT(FLASHBDEV_BOOT_SIZE / FLASHBDEV_SEC_SIZE);
+        mp_obj_t args[2] = {
+            esp32_flashbdev_make_new(&esp32_flashbdev_type, 1, 0, &blocks),
+            MP_OBJ_NEW_QSTR(MP_QSTR__slash_),
+        };
+        mp_vfs_mount(2, args, (mp_map_t*)&mp_const_empty_map);
+        nlr_pop();
+        return true;
+    }
+    // drop the device again, so its cache can be freed
+    MP_STATE_PORT(esp32_flashbdev_head) = head;
+    return false;
+}
+
+STATIC mp_obj_t esp32_flashbdev_readblocks(mp_obj_t self_in, mp_obj_t block_in, mp_obj_t buf_in) {
+    esp32_flashbdev_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_int_t block = mp_obj_get_int(block_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    flashbdev_check_range(self, block, bufinfo.len);
+
+    // read runs of uncached blocks straight from flash
+    uint8_t *buf = bufinfo.buf;
+    size_t len = bufinfo.len;
+    while (len != 0) {
+        size_t n = MIN(len, FLASHBDEV_SEC_SIZE);
+        esp32_flashbdev_cache_t *c = flashbdev_lookup(self, block);
+        if (c != NULL) {
+            memcpy(buf, flashbdev_buf(self, c), n);
+            ++self->hits;
+        } else {
+            size_t run = n;
+            while (run < len && flashbdev_lookup(self, block + run / FLASHBDEV_SEC_SIZE) == NULL) {
+                run += MIN(len - run, FLASHBDEV_SEC_SIZE);
+            }
+            n = run;
+            flashbdev_check(spi_flash_read((self->start_sector + block) * FLASHBDEV_SEC_SIZE, buf, n));
+        }
+        buf += n;
+        len -= n;
+        block += (n + FLASHBDEV_SEC_SIZE - 1) / FLASHBDEV_SEC_SIZE;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_flashbdev_readblocks_obj, esp32_flashbdev_readblocks);
+
+STATIC mp_obj_t esp32_flashbdev_writeblocks(mp_obj_t self_in, mp_obj_t block_in, mp_obj_t buf_in) {
+    esp32_flashbdev_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_int_t block = mp_obj_get_int(block_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    flashbdev_check_range(self, block, bufinfo.len);
+
+    const uint8_t *buf = bufinfo.buf;
+    size_t len = bufinfo.len;
+    for (; len != 0; ++block) {
+        size_t n = MIN(len, FLASHBDEV_SEC_SIZE);
+        esp32_flashbdev_cache_t *c = flashbdev_get(self, block, n < FLASHBDEV_SEC_SIZE);
+        memcpy(flashbdev_buf(self, c), buf, n);
+        c->dirty = true;
+        buf += n;
+        len -= n;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_flashbdev_writeblocks_obj, esp32_flashbdev_writeblocks);
+
+STATIC mp_obj_t esp32_flashbdev_ioctl(mp_obj_t self_in, mp_obj_t op_in, mp_obj_t arg_in) {
+    esp32_flashbdev_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (mp_obj_get_int(op_in)) {
+        case BP_IOCTL_INIT:
+            return MP_OBJ_NEW_SMALL_INT(0);
+        case BP_IOCTL_DEINIT:
+        case BP_IOCTL_SYNC:
+            flashbdev_sync(self);
+            return MP_OBJ_NEW_SMALL_INT(0);
+        case BP_IOCTL_SEC_COUNT:
+            return MP_OBJ_NEW_SMALL_INT(self->blocks);
+        case BP_IOCTL_SEC_SIZE:
+            return MP_OBJ_NEW_SMALL_INT(FLASHBDEV_SEC_SIZE);
+        default:
+            return mp_const_none;
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_flashbdev_ioctl_obj, esp32_flashbdev_ioctl);
+
+// stats() -> (cache hits, sector erases, sector programs)
+STATIC mp_obj_t esp32_flashbdev_stats(mp_obj_t self_in) {
+    esp32_flashbdev_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_t tuple[3] = {
+        mp_obj_new_int_from_uint(self->hits),
+        mp_obj_new_int_from_uint(self->erases),
+        mp_obj_new_int_from_uint(self->programs),
+    };
+    return mp_obj_new_tuple(3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_flashbdev_stats_obj, esp32_flashbdev_stats);
+
+STATIC const mp_rom_map_elem_t esp32_flashbdev_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_readblocks), MP_ROM_PTR(&esp32_flashbdev_readblocks_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writeblocks), MP_ROM_PTR(&esp32_flashbdev_writeblocks_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ioctl), MP_ROM_PTR(&esp32_flashbdev_ioctl_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&esp32_flashbdev_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_SEC_SIZE), MP_ROM_INT(FLASHBDEV_SEC_SIZE) },
+};
+STATIC MP_DEFINE_CONST_DICT(esp32_flashbdev_locals_dict, esp32_flashbdev_locals_dict_table);
+
+const mp_obj_type_t esp32_flashbdev_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_FlashBdev,
+    .make_new = esp32_flashbdev_make_new,
+    .locals_dict = (mp_obj_dict_t*)&esp32_flashbdev_locals_dict,
+};
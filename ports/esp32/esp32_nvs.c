@@ -0,0 +1,302 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "nvs.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/objstr.h"
+#include "modesp32.h"
+
+// Typed key/value store in an NVS namespace, for settings and calibration
+// that would otherwise be JSON files on the FAT filesystem.  Each value is
+// kept in a RAM cache once read or set, so repeated reads don't touch the
+// flash.  Writes go to the cache and are held until commit(), which writes
+// each changed key once; setting a key to the value it already has in flash
+// writes nothing.  Values are ints (NVS i32), floats (the bits as an NVS
+// u32) and bytes (NVS blob).
+
+// NVS key and namespace names are at most 15 characters
+#define ESP32_NVS_NAME_MAX  (15)
+
+typedef struct _esp32_nvs_obj_t {
+    mp_obj_base_t base;
+    nvs_handle handle;
+    bool open;
+    mp_obj_dict_t *cache;   // key -> value, as in flash or as last set
+    mp_obj_dict_t *dirty;   // key -> value to write, or None to erase
+} esp32_nvs_obj_t;
+
+STATIC void esp32_nvs_check_err(esp_err_t err) {
+    switch (err) {
+        case ESP_OK:
+            return;
+        case ESP_ERR_NVS_NOT_FOUND:
+        case ESP_ERR_NVS_TYPE_MISMATCH:
+            mp_raise_OSError(MP_ENOENT);
+        case ESP_ERR_NVS_NOT_ENOUGH_SPACE:
+        case ESP_ERR_NVS_PAGE_FULL:
+        case ESP_ERR_NVS_NO_FREE_PAGES:
+            mp_raise_OSError(MP_ENOSPC);
+        case ESP_ERR_NVS_INVALID_NAME:
+        case ESP_ERR_NVS_KEY_TOO_LONG:
+            mp_raise_ValueError("key invalid or too long");
+        default:
+            mp_raise_OSError(err);
+    }
+}
+
+STATIC esp32_nvs_obj_t *esp32_nvs_get_open(mp_obj_t self_in) {
+    esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (!self->open) {
+        mp_raise_OSError(MP_EBADF);
+    }
+    return self;
+}
+
+STATIC const char *esp32_nvs_get_name(mp_obj_t name_in) {
+    size_t len;
+    const char *name = mp_obj_str_get_data(name_in, &len);
+    if (len == 0 || len > ESP32_NVS_NAME_MAX) {
+        mp_raise_ValueError("key invalid or too long");
+    }
+    return name;
+}
+
+STATIC mp_obj_t esp32_nvs_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    const char *namespace = esp32_nvs_get_name(args[0]);
+    esp32_nvs_obj_t *self = m_new_obj_with_finaliser(esp32_nvs_obj_t);
+    self->base.type = type;
+    self->open = false;
+    self->cache = MP_OBJ_TO_PTR(mp_obj_new_dict(0));
+    self->dirty = MP_OBJ_TO_PTR(mp_obj_new_dict(0));
+    esp32_nvs_check_err(nvs_open(namespace, NVS_READWRITE, &self->handle));
+    self->open = true;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+// The value of key in the cache, reading it from flash with load() on a miss.
+// type is that of the value wanted; another type is the same as no key.
+STATIC mp_obj_t esp32_nvs_lookup(esp32_nvs_obj_t *self, mp_obj_t key, const mp_obj_type_t *type,
+    mp_obj_t (*load)(esp32_nvs_obj_t *self, const char *key)) {
+    mp_map_elem_t *elem = mp_map_lookup(&self->cache->map, key, MP_MAP_LOOKUP);
+    mp_obj_t value;
+    if (elem != NULL) {
+        value = elem->value;
+    } else {
+        elem = mp_map_lookup(&self->dirty->map, key, MP_MAP_LOOKUP);
+        if (elem != NULL) {
+            // erased but not yet committed
+            mp_raise_OSError(MP_ENOENT);
+        }
+        value = load(self, esp32_nvs_get_name(key));
+        mp_obj_dict_store(MP_OBJ_FROM_PTR(self->cache), key, value);
+    }
+    if (mp_obj_get_type(value) != type) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    return value;
+}
+
+STATIC void esp32_nvs_set(esp32_nvs_obj_t *self, mp_obj_t key, mp_obj_t value) {
+    esp32_nvs_get_name(key);
+    if (mp_map_lookup(&self->dirty->map, key, MP_MAP_LOOKUP) == NULL) {
+        mp_map_elem_t *elem = mp_map_lookup(&self->cache->map, key, MP_MAP_LOOKUP);
+        if (elem != NULL && mp_obj_get_type(elem->value) == mp_obj_get_type(value)
+            && mp_obj_equal(elem->value, value)) {
+            // already in flash
+            return;
+        }
+    }
+    mp_obj_dict_store(MP_OBJ_FROM_PTR(self->cache), key, value);
+    mp_obj_dict_store(MP_OBJ_FROM_PTR(self->dirty), key, value);
+}
+
+STATIC mp_obj_t esp32_nvs_load_i32(esp32_nvs_obj_t *self, const char *key) {
+    int32_t value;
+    esp32_nvs_check_err(nvs_get_i32(self->handle, key, &value));
+    return mp_obj_new_int(value);
+}
+
+STATIC mp_obj_t esp32_nvs_load_float(esp32_nvs_obj_t *self, const char *key) {
+    union { float f; uint32_t u; } value;
+    esp32_nvs_check_err(nvs_get_u32(self->handle, key, &value.u));
+    return mp_obj_new_float(value.f);
+}
+
+STATIC mp_obj_t esp32_nvs_load_blob(esp32_nvs_obj_t *self, const char *key) {
+    size_t len = 0;
+    esp32_nvs_check_err(nvs_get_blob(self->handle, key, NULL, &len));
+    vstr_t vstr;
+    vstr_init_len(&vstr, len);
+    esp32_nvs_check_err(nvs_get_blob(self->handle, key, vstr.buf, &len));
+    vstr.len = len;
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+
+STATIC mp_obj_t esp32_nvs_set_i32(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t value_in) {
+    esp32_nvs_obj_t *self = esp32_nvs_get_open(self_in);
+    int32_t value = mp_obj_get_int_truncated(value_in);
+    esp32_nvs_set(self, key_in, mp_obj_new_int(value));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_nvs_set_i32_obj, esp32_nvs_set_i32);
+
+STATIC mp_obj_t esp32_nvs_get_i32(mp_obj_t self_in, mp_obj_t key_in) {
+    esp32_nvs_obj_t *self = esp32_nvs_get_open(self_in);
+    return esp32_nvs_lookup(self, key_in, &mp_type_int, esp32_nvs_load_i32);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_get_i32_obj, esp32_nvs_get_i32);
+
+STATIC mp_obj_t esp32_nvs_set_float(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t value_in) {
+    esp32_nvs_obj_t *self = esp32_nvs_get_open(self_in);
+    // rounded to what's stored, so that an unchanged value is seen as such
+    float value = mp_obj_get_float(value_in);
+    esp32_nvs_set(self, key_in, mp_obj_new_float(value));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_nvs_set_float_obj, esp32_nvs_set_float);
+
+STATIC mp_obj_t esp32_nvs_get_float(mp_obj_t self_in, mp_obj_t key_in) {
+    esp32_nvs_obj_t *self = esp32_nvs_get_open(self_in);
+    return esp32_nvs_lookup(self, key_in, &mp_type_float, esp32_nvs_load_float);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_get_float_obj, esp32_nvs_get_float);
+
+STATIC mp_obj_t esp32_nvs_set_blob(mp_obj_t self_in, mp_obj_t key_in, mp_obj_t value_in) {
+    esp32_nvs_obj_t *self = esp32_nvs_get_open(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(value_in, &bufinfo, MP_BUFFER_READ);
+    // copied, so that later changes to the buffer aren't stored
+    esp32_nvs_set(self, key_in, mp_obj_new_bytes(bufinfo.buf, bufinfo.len));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp32_nvs_set_blob_obj, esp32_nvs_set_blob);
+
+// get_blob(key[, buf]): the blob as bytes, or read into buf returning its length
+STATIC mp_obj_t esp32_nvs_get_blob(size_t n_args, const mp_obj_t *args) {
+    esp32_nvs_obj_t *self = esp32_nvs_get_open(args[0]);
+    mp_obj_t value = esp32_nvs_lookup(self, args[1], &mp_type_bytes, esp32_nvs_load_blob);
+    if (n_args == 2) {
+        return value;
+    }
+    size_t len;
+    const char *data = mp_obj_str_get_data(value, &len);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[2], &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < len) {
+        mp_raise_ValueError("buffer too small");
+    }
+    memcpy(bufinfo.buf, data, len);
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_nvs_get_blob_obj, 2, 3, esp32_nvs_get_blob);
+
+STATIC mp_obj_t esp32_nvs_erase_key(mp_obj_t self_in, mp_obj_t key_in) {
+    esp32_nvs_obj_t *self = esp32_nvs_get_open(self_in);
+    esp32_nvs_get_name(key_in);
+    mp_map_lookup(&self->cache->map, key_in, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    mp_obj_dict_store(MP_OBJ_FROM_PTR(self->dirty), key_in, mp_const_none);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_nvs_erase_key_obj, esp32_nvs_erase_key);
+
+STATIC esp_err_t esp32_nvs_write(esp32_nvs_obj_t *self, const char *key, mp_obj_t value) {
+    if (value == mp_const_none) {
+        esp_err_t err = nvs_erase_key(self->handle, key);
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+    } else if (mp_obj_is_float(value)) {
+        union { float f; uint32_t u; } v = { .f = mp_obj_get_float(value) };
+        return nvs_set_u32(self->handle, key, v.u);
+    } else if (mp_obj_is_int(value)) {
+        return nvs_set_i32(self->handle, key, mp_obj_get_int_truncated(value));
+    } else {
+        size_t len;
+        const char *data = mp_obj_str_get_data(value, &len);
+        return nvs_set_blob(self->handle, key, data, len);
+    }
+}
+
+// commit(): write all the changed keys to flash
+STATIC mp_obj_t esp32_nvs_commit(mp_obj_t self_in) {
+    esp32_nvs_obj_t *self = esp32_nvs_get_open(self_in);
+    mp_map_t *map = &self->dirty->map;
+    if (map->used == 0) {
+        return mp_const_none;
+    }
+    for (size_t i = 0; i < map->alloc; ++i) {
+        if (!mp_map_slot_is_filled(map, i)) {
+            continue;
+        }
+        const char *key = mp_obj_str_get_str(map->table[i].key);
+        esp_err_t err = esp32_nvs_write(self, key, map->table[i].value);
+        if (err == ESP_ERR_NVS_TYPE_MISMATCH) {
+            // NVS doesn't change a key's type in place
+            nvs_erase_key(self->handle, key);
+            err = esp32_nvs_write(self, key, map->table[i].value);
+        }
+        // on error all the changes are kept, to be written again next time
+        esp32_nvs_check_err(err);
+    }
+    esp32_nvs_check_err(nvs_commit(self->handle));
+    self->dirty = MP_OBJ_TO_PTR(mp_obj_new_dict(0));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_nvs_commit_obj, esp32_nvs_commit);
+
+// uncommitted changes are dropped, as with NVS itself
+STATIC mp_obj_t esp32_nvs_del(mp_obj_t self_in) {
+    esp32_nvs_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->open) {
+        self->open = false;
+        nvs_close(self->handle);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_nvs_del_obj, esp32_nvs_del);
+
+STATIC const mp_rom_map_elem_t esp32_nvs_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_set_i32), MP_ROM_PTR(&esp32_nvs_set_i32_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_i32), MP_ROM_PTR(&esp32_nvs_get_i32_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_float), MP_ROM_PTR(&esp32_nvs_set_float_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_float), MP_ROM_PTR(&esp32_nvs_get_float_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_blob), MP_ROM_PTR(&esp32_nvs_set_blob_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_blob), MP_ROM_PTR(&esp32_nvs_get_blob_obj) },
+    { MP_ROM_QSTR(MP_QSTR_erase_key), MP_ROM_PTR(&esp32_nvs_erase_key_obj) },
+    { MP_ROM_QSTR(MP_QSTR_commit), MP_ROM_PTR(&esp32_nvs_commit_obj) },
+    { MP_ROM_QSTR(MP_QSTR___del__), MP_ROM_PTR(&esp32_nvs_del_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(esp32_nvs_locals_dict, esp32_nvs_locals_dict_table);
+
+const mp_obj_type_t esp32_nvs_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_NVS,
+    .make_new = esp32_nvs_make_new,
+    .locals_dict = (mp_obj_dict_t*)&esp32_nvs_locals_dict,
+};
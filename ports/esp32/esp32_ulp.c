@@ -24,10 +24,38 @@
  * THE SOFTWARE.
  */
 
+#include <string.h>
+
 #include "py/runtime.h"
 
 #include "esp32/ulp.h"
 #include "esp_err.h"
+#include "driver/adc.h"
+#include "soc/rtc.h"
+#include "soc/rtc_cntl_reg.h"
+
+#include "modmachine.h"
+#include "machine_rtc.h"
+
+// The sampler keeps its state and samples at the start of the reserved RTC
+// slow memory, followed by the generated program.  The ULP stores a 16-bit
+// value per word with its PC in the upper half, so only the low half counts.
+#define SAMPLER_INDEX       (0)     // number of samples stored so far
+#define SAMPLER_EVENT       (1)     // why the ULP woke the CPU, or 0
+#define SAMPLER_DATA        (2)
+#define SAMPLER_MAX_CHANNELS (4)
+#define SAMPLER_MAX_INSNS   (20 + 7 * SAMPLER_MAX_CHANNELS)
+
+#define SAMPLER_EVENT_THRESHOLD (1)
+#define SAMPLER_EVENT_FULL      (2)
+
+enum {
+    LBL_THRESHOLD,
+    LBL_FULL,
+    LBL_WAKE,
+};
+
+STATIC const uint8_t esp32_ulp_adc1_gpios[ADC1_CHANNEL_MAX] = {36, 37, 38, 39, 32, 33, 34, 35};
 
 typedef struct _esp32_ulp_obj_t {
     mp_obj_base_t base;
@@ -81,10 +109,162 @@ STATIC mp_obj_t esp32_ulp_run(mp_obj_t self_in, mp_obj_t entry_point_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp32_ulp_run_obj, esp32_ulp_run);
 
+STATIC void esp32_ulp_stop_timer(void) {
+    CLEAR_PERI_REG_MASK(RTC_CNTL_STATE0_REG, RTC_CNTL_ULP_CP_SLP_TIMER_EN);
+}
+
+// ULP.sample(pins, period_us, *, samples=64, low=None, high=None, atten=ADC.ATTN_11DB)
+// Make the ULP read the ADC1 channels of the given pins every period_us and
+// store the readings in RTC memory while the main cores sleep.  The CPU is
+// only woken, and the ULP stopped, when a reading is below low or at least
+// high, or when samples readings of each pin have been taken.  The Studuino:bit
+// light sensor is on pin 34.
+STATIC mp_obj_t esp32_ulp_sample(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_pins, ARG_period_us, ARG_samples, ARG_low, ARG_high, ARG_atten };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_pins, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_period_us, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_samples, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 64} },
+        { MP_QSTR_low, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_high, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_atten, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = ADC_ATTEN_11db} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    size_t n_pins;
+    mp_obj_t *pins;
+    mp_obj_get_array(args[ARG_pins].u_obj, &n_pins, &pins);
+    if (n_pins == 0 || n_pins > SAMPLER_MAX_CHANNELS) {
+        mp_raise_ValueError("need 1 to 4 pins");
+    }
+    adc1_channel_t chans[SAMPLER_MAX_CHANNELS];
+    for (size_t i = 0; i < n_pins; i++) {
+        int gpio = machine_pin_get_gpio(pins[i]);
+        int ch = 0;
+        while (ch < ADC1_CHANNEL_MAX && esp32_ulp_adc1_gpios[ch] != gpio) {
+            ++ch;
+        }
+        if (ch == ADC1_CHANNEL_MAX) {
+            mp_raise_ValueError("invalid pin for ADC1");
+        }
+        chans[i] = ch;
+    }
+    mp_int_t total = args[ARG_samples].u_int * n_pins;
+    mp_int_t low = args[ARG_low].u_obj == mp_const_none ? -1 : mp_obj_get_int(args[ARG_low].u_obj);
+    mp_int_t high = args[ARG_high].u_obj == mp_const_none ? -1 : mp_obj_get_int(args[ARG_high].u_obj);
+    if (args[ARG_samples].u_int <= 0 || low > 4095 || high > 4095) {
+        mp_raise_ValueError(NULL);
+    }
+
+    // one pass of the program per wakeup period; R2 holds the sample index
+    ulp_insn_t prog[SAMPLER_MAX_INSNS];
+    size_t n = 0;
+    // the branch macros expand to two instructions, so go through an array
+    #define SAMPLER_EMIT(...) do { \
+        const ulp_insn_t insn[] = { __VA_ARGS__ }; \
+        memcpy(&prog[n], insn, sizeof(insn)); \
+        n += MP_ARRAY_SIZE(insn); \
+    } while (0)
+    SAMPLER_EMIT(I_MOVI(R3, 0));
+    SAMPLER_EMIT(I_LD(R2, R3, SAMPLER_INDEX));
+    for (size_t i = 0; i < n_pins; i++) {
+        SAMPLER_EMIT(I_ADC(R0, 0, chans[i]));
+        SAMPLER_EMIT(I_ST(R0, R2, SAMPLER_DATA));
+        SAMPLER_EMIT(I_ADDI(R2, R2, 1));
+        if (low > 0) {
+            SAMPLER_EMIT(M_BL(LBL_THRESHOLD, low));
+        }
+        if (high >= 0) {
+            SAMPLER_EMIT(M_BGE(LBL_THRESHOLD, high));
+        }
+    }
+    SAMPLER_EMIT(I_ST(R2, R3, SAMPLER_INDEX));
+    SAMPLER_EMIT(I_MOVR(R0, R2));
+    SAMPLER_EMIT(M_BGE(LBL_FULL, total));
+    SAMPLER_EMIT(I_HALT());
+    SAMPLER_EMIT(M_LABEL(LBL_THRESHOLD));
+    SAMPLER_EMIT(I_ST(R2, R3, SAMPLER_INDEX));
+    SAMPLER_EMIT(I_MOVI(R0, SAMPLER_EVENT_THRESHOLD));
+    SAMPLER_EMIT(M_BX(LBL_WAKE));
+    SAMPLER_EMIT(M_LABEL(LBL_FULL));
+    SAMPLER_EMIT(I_MOVI(R0, SAMPLER_EVENT_FULL));
+    SAMPLER_EMIT(M_LABEL(LBL_WAKE));
+    SAMPLER_EMIT(I_ST(R0, R3, SAMPLER_EVENT));
+    SAMPLER_EMIT(I_WAKE());
+    SAMPLER_EMIT(I_END());
+    SAMPLER_EMIT(I_HALT());
+    #undef SAMPLER_EMIT
+
+    // the samples go first, so they don't move if the program changes size
+    uint32_t load_addr = SAMPLER_DATA + total;
+    if ((load_addr + n) * sizeof(uint32_t) > CONFIG_ULP_COPROC_RESERVE_MEM) {
+        mp_raise_ValueError("too many samples");
+    }
+
+    esp32_ulp_stop_timer();
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    for (size_t i = 0; i < n_pins; i++) {
+        adc1_config_channel_atten(chans[i], args[ARG_atten].u_int);
+    }
+    adc1_ulp_enable();
+
+    RTC_SLOW_MEM[SAMPLER_INDEX] = 0;
+    RTC_SLOW_MEM[SAMPLER_EVENT] = 0;
+    size_t size = n;
+    esp_err_t err = ulp_process_macros_and_load(load_addr, prog, &size);
+    if (err == ESP_OK) {
+        err = ulp_set_wakeup_period(0, args[ARG_period_us].u_int);
+    }
+    if (err == ESP_OK) {
+        err = ulp_run(load_addr);
+    }
+    if (err != ESP_OK) {
+        mp_raise_OSError(err);
+    }
+    machine_rtc_config.wake_on_ulp = true;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(esp32_ulp_sample_obj, 3, esp32_ulp_sample);
+
+// ULP.samples()
+// Return the readings stored by the sampler, in the order taken and
+// interleaved by pin, and the event that stopped it (0 if still running).
+STATIC mp_obj_t esp32_ulp_samples(mp_obj_t self_in) {
+    size_t n = RTC_SLOW_MEM[SAMPLER_INDEX] & 0xffff;
+    if ((SAMPLER_DATA + n) * sizeof(uint32_t) > CONFIG_ULP_COPROC_RESERVE_MEM) {
+        // not written by the sampler, eg after a cold boot
+        n = 0;
+    }
+    mp_obj_list_t *list = MP_OBJ_TO_PTR(mp_obj_new_list(n, NULL));
+    for (size_t i = 0; i < n; i++) {
+        list->items[i] = MP_OBJ_NEW_SMALL_INT(RTC_SLOW_MEM[SAMPLER_DATA + i] & 0xffff);
+    }
+    mp_obj_t tuple[2] = {
+        MP_OBJ_FROM_PTR(list),
+        MP_OBJ_NEW_SMALL_INT(RTC_SLOW_MEM[SAMPLER_EVENT] & 0xffff),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_ulp_samples_obj, esp32_ulp_samples);
+
+// ULP.stop()
+STATIC mp_obj_t esp32_ulp_stop(mp_obj_t self_in) {
+    esp32_ulp_stop_timer();
+    machine_rtc_config.wake_on_ulp = false;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp32_ulp_stop_obj, esp32_ulp_stop);
+
 STATIC const mp_rom_map_elem_t esp32_ulp_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_set_wakeup_period), MP_ROM_PTR(&esp32_ulp_set_wakeup_period_obj) },
     { MP_ROM_QSTR(MP_QSTR_load_binary), MP_ROM_PTR(&esp32_ulp_load_binary_obj) },
     { MP_ROM_QSTR(MP_QSTR_run), MP_ROM_PTR(&esp32_ulp_run_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sample), MP_ROM_PTR(&esp32_ulp_sample_obj) },
+    { MP_ROM_QSTR(MP_QSTR_samples), MP_ROM_PTR(&esp32_ulp_samples_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&esp32_ulp_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_EVENT_THRESHOLD), MP_ROM_INT(SAMPLER_EVENT_THRESHOLD) },
+    { MP_ROM_QSTR(MP_QSTR_EVENT_FULL), MP_ROM_INT(SAMPLER_EVENT_FULL) },
     { MP_ROM_QSTR(MP_QSTR_RESERVE_MEM), MP_ROM_INT(CONFIG_ULP_COPROC_RESERVE_MEM) },
 };
 STATIC MP_DEFINE_CONST_DICT(esp32_ulp_locals_dict, esp32_ulp_locals_dict_table);
@@ -0,0 +1,243 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_heap_caps.h"
+#include "esp_task.h"
+#include "soc/cpu.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/gc.h"
+#include "py/stackctrl.h"
+#include "py/mphal.h"
+#include "py/mpthread.h"
+#include "lib/utils/pyexec.h"
+#include "modesp32.h"
+
+#if MICROPY_STATE_CTX_PER_TASK
+
+// A second, isolated VM running a frozen module in its own task.  It has its
+// own mp_state_ctx_t, GC heap, pystack and GIL, so it never waits on the main
+// VM's GIL; with the unicore sdkconfig the two tasks still share the one core.
+// The two share no objects:
+// they talk through a pair of _thread.Queue channels that copy each item in
+// and out.  The channels live on the main VM's heap (rooted in
+// MP_STATE_PORT(esp32_vm_channels)) and are only ever pointed to from the
+// second VM, whose GC ignores pointers outside its own heap.
+//
+// Drivers keep their state in C statics and in the main VM's root pointers,
+// so the second VM is meant for pure computation, time and the channels.
+// ISRs reach the VM of the task they preempt, so driver IRQ callbacks must
+// not be enabled while the second VM runs.
+
+#define ESP32_VM_PRIORITY       (ESP_TASK_PRIO_MIN + 1)
+#define ESP32_VM_PYSTACK_SIZE   (4 * 1024)
+#define ESP32_VM_STOP_MS        (1000)
+
+typedef struct _esp32_vm_t {
+    mp_state_ctx_t ctx;
+    TaskHandle_t task;
+    volatile bool done;
+    size_t stack_size;
+    size_t heap_size;
+    byte *heap; // the pystack then the GC heap
+    mp_obj_t chan[2]; // main VM to this VM, and back; see esp32_vm_channels()
+    char module[36];
+} esp32_vm_t;
+
+STATIC esp32_vm_t *esp32_vm = NULL;
+
+STATIC bool esp32_vm_is_self(void) {
+    return esp32_vm != NULL && mp_state_ctx_ptr == &esp32_vm->ctx;
+}
+
+STATIC void esp32_vm_task(void *arg) {
+    esp32_vm_t *vm = arg;
+    volatile uint32_t sp = (uint32_t)get_sp();
+
+    mp_state_ctx_ptr = &vm->ctx;
+    mp_thread_set_state(&vm->ctx.thread);
+    mp_stack_set_top((void *)sp);
+    mp_stack_set_limit(vm->stack_size - 1024);
+    mp_pystack_init(vm->heap, vm->heap + ESP32_VM_PYSTACK_SIZE);
+    gc_init(vm->heap + ESP32_VM_PYSTACK_SIZE, vm->heap + vm->heap_size);
+    mp_init();
+    mp_obj_list_init(mp_sys_path, 0);
+    mp_obj_list_append(mp_sys_path, MP_OBJ_NEW_QSTR(MP_QSTR_));
+    mp_obj_list_init(mp_sys_argv, 0);
+
+    pyexec_frozen_module(vm->module);
+
+    gc_sweep_all();
+    mp_deinit();
+    MP_THREAD_GIL_EXIT();
+    vm->done = true;
+
+    // esp32_vm_stop() deletes the task, so that there's no race between it
+    // and the task deleting itself
+    for (;;) {
+        vTaskSuspend(NULL);
+    }
+}
+
+// Stop the VM, waiting up to ESP32_VM_STOP_MS for it to handle a
+// KeyboardInterrupt before deleting its task, then free its memory.
+STATIC void esp32_vm_stop_internal(void) {
+    esp32_vm_t *vm = esp32_vm;
+    if (vm == NULL) {
+        return;
+    }
+    if (!vm->done) {
+        vm->ctx.vm.mp_pending_exception = MP_OBJ_FROM_PTR(&vm->ctx.vm.mp_kbd_exception);
+        #if MICROPY_ENABLE_SCHEDULER
+        if (vm->ctx.vm.sched_state == MP_SCHED_IDLE) {
+            vm->ctx.vm.sched_state = MP_SCHED_PENDING;
+        }
+        #endif
+        // wake it from mp_hal_wait_event() or a channel get()
+        xTaskNotifyGive(vm->task);
+        for (int ms = 0; ms < ESP32_VM_STOP_MS && !vm->done; ms += 10) {
+            MP_THREAD_GIL_EXIT();
+            vTaskDelay(10 / portTICK_PERIOD_MS);
+            MP_THREAD_GIL_ENTER();
+        }
+    }
+    vTaskDelete(vm->task);
+    esp32_vm = NULL;
+    MP_STATE_PORT(esp32_vm_channels)[0] = MP_OBJ_NULL;
+    MP_STATE_PORT(esp32_vm_channels)[1] = MP_OBJ_NULL;
+    heap_caps_free(vm->heap);
+    heap_caps_free(vm);
+}
+
+void esp32_vm_deinit(void) {
+    esp32_vm_stop_internal();
+}
+
+STATIC void esp32_vm_check_main(void) {
+    if (!MP_STATE_CTX_IS_MAIN()) {
+        mp_raise_msg(&mp_type_RuntimeError, "only the main VM can do this");
+    }
+}
+
+// vm_start(module, *, heap=32768, stack=16384, capacity=8, itemsize=128):
+// run the frozen module.py in a new VM, stopping any previous one
+STATIC mp_obj_t esp32_vm_start(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_module, ARG_heap, ARG_stack, ARG_capacity, ARG_itemsize };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_module, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_heap, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 32 * 1024} },
+        { MP_QSTR_stack, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 16 * 1024} },
+        { MP_QSTR_capacity, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8} },
+        { MP_QSTR_itemsize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 128} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    esp32_vm_check_main();
+    size_t module_len;
+    const char *module = mp_obj_str_get_data(args[ARG_module].u_obj, &module_len);
+    if (module_len + 4 > sizeof(((esp32_vm_t *)0)->module)
+        || args[ARG_heap].u_int < 8 * 1024 || args[ARG_stack].u_int < 4 * 1024
+        || args[ARG_capacity].u_int < 1 || args[ARG_capacity].u_int > 0xffff
+        || args[ARG_itemsize].u_int < 0 || args[ARG_itemsize].u_int > 0xffff) {
+        mp_raise_ValueError(NULL);
+    }
+
+    esp32_vm_stop_internal();
+
+    // the channels are made first as they're on the heap and may raise
+    size_t chan_size = mp_thread_queue_mem_size(args[ARG_capacity].u_int, args[ARG_itemsize].u_int);
+    for (int i = 0; i < 2; ++i) {
+        MP_STATE_PORT(esp32_vm_channels)[i] = mp_thread_queue_init(m_malloc(chan_size),
+            args[ARG_capacity].u_int, args[ARG_itemsize].u_int);
+    }
+
+    esp32_vm_t *vm = heap_caps_calloc(1, sizeof(esp32_vm_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    size_t heap_size = ESP32_VM_PYSTACK_SIZE + args[ARG_heap].u_int;
+    byte *heap = heap_caps_malloc(heap_size, MALLOC_CAP_8BIT);
+    if (vm == NULL || heap == NULL) {
+        MP_STATE_PORT(esp32_vm_channels)[0] = MP_OBJ_NULL;
+        MP_STATE_PORT(esp32_vm_channels)[1] = MP_OBJ_NULL;
+        heap_caps_free(vm);
+        heap_caps_free(heap);
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    vm->stack_size = args[ARG_stack].u_int;
+    vm->heap_size = heap_size;
+    vm->heap = heap;
+    vm->chan[0] = MP_STATE_PORT(esp32_vm_channels)[0];
+    vm->chan[1] = MP_STATE_PORT(esp32_vm_channels)[1];
+    memcpy(vm->module, module, module_len);
+    memcpy(vm->module + module_len, ".py", 4);
+
+    if (xTaskCreate(esp32_vm_task, "mp_vm", vm->stack_size / sizeof(StackType_t), vm,
+        ESP32_VM_PRIORITY, &vm->task) != pdPASS) {
+        MP_STATE_PORT(esp32_vm_channels)[0] = MP_OBJ_NULL;
+        MP_STATE_PORT(esp32_vm_channels)[1] = MP_OBJ_NULL;
+        heap_caps_free(heap);
+        heap_caps_free(vm);
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    esp32_vm = vm;
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_KW(esp32_vm_start_obj, 1, esp32_vm_start);
+
+STATIC mp_obj_t esp32_vm_stop(void) {
+    esp32_vm_check_main();
+    esp32_vm_stop_internal();
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(esp32_vm_stop_obj, esp32_vm_stop);
+
+STATIC mp_obj_t esp32_vm_running(void) {
+    return mp_obj_new_bool(esp32_vm != NULL && !esp32_vm->done);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(esp32_vm_running_obj, esp32_vm_running);
+
+// vm_channels(): the (inbox, outbox) queues of the calling VM
+STATIC mp_obj_t esp32_vm_channels(void) {
+    mp_obj_t items[2];
+    if (esp32_vm_is_self()) {
+        items[0] = esp32_vm->chan[0];
+        items[1] = esp32_vm->chan[1];
+    } else if (MP_STATE_CTX_IS_MAIN() && esp32_vm != NULL) {
+        items[0] = esp32_vm->chan[1];
+        items[1] = esp32_vm->chan[0];
+    } else {
+        mp_raise_msg(&mp_type_RuntimeError, "no VM");
+    }
+    return mp_obj_new_tuple(2, items);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(esp32_vm_channels_obj, esp32_vm_channels);
+
+#endif // MICROPY_STATE_CTX_PER_TASK
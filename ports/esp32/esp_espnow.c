@@ -27,10 +27,14 @@
 
 
 #include <stdio.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 
+#include "freertos/FreeRTOS.h"
+
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_now.h"
 #include "esp_wifi.h"
 #include "esp_wifi_types.h"
@@ -43,6 +47,7 @@
 #include "py/runtime.h"
 #include "py/mphal.h"
 #include "py/mperrno.h"
+#include "py/binary.h"
 
 #include "modnetwork.h"
 
@@ -85,62 +90,340 @@ static inline void _get_bytes(mp_obj_t str, size_t len, uint8_t *dst) {
 static mp_obj_t send_cb_obj = mp_const_none;
 static mp_obj_t recv_cb_obj = mp_const_none;
 
+// Sends are paced against a window of frames that have been handed to
+// ESP-NOW but not yet reported by send_cb, so a burst waits for the driver
+// instead of failing with ESP_ERR_ESPNOW_NO_MEM.  send_cb itself only
+// updates counters and, if an on_send callback is set, records the result
+// in a small ring for a dispatcher that runs in the VM.  Results that do
+// not fit in the ring are still counted but not passed to the callback.
+#define ESPNOW_TX_WINDOW (8)
+#define ESPNOW_SEND_RING_LEN (16)
+#define ESPNOW_SEND_TIMEOUT_MS (1000)
+
+typedef struct _espnow_send_status_t {
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    bool ok;
+} espnow_send_status_t;
+
+typedef struct _espnow_send_state_t {
+    espnow_send_status_t ring[ESPNOW_SEND_RING_LEN];
+    uint32_t head;
+    uint32_t tail;
+    volatile uint32_t in_flight;
+    uint32_t sent;
+    uint32_t delivered;
+    uint32_t failed;
+    volatile bool dispatch_pending;
+} espnow_send_state_t;
+
+STATIC espnow_send_state_t send_state;
+STATIC portMUX_TYPE send_state_mux = portMUX_INITIALIZER_UNLOCKED;
+
+STATIC void espnow_send_state_reset(void) {
+    portENTER_CRITICAL(&send_state_mux);
+    send_state.head = send_state.tail = 0;
+    send_state.in_flight = 0;
+    send_state.sent = send_state.delivered = send_state.failed = 0;
+    send_state.dispatch_pending = false;
+    portEXIT_CRITICAL(&send_state_mux);
+}
+
+// Scheduled from send_cb when a callback is registered; hands every
+// recorded result to it as a (mac, ok) tuple.
+STATIC mp_obj_t espnow_send_dispatch(mp_obj_t arg) {
+    (void)arg;
+    send_state.dispatch_pending = false;
+    while (send_cb_obj != mp_const_none) {
+        espnow_send_status_t st;
+        bool ok = false;
+        portENTER_CRITICAL(&send_state_mux);
+        if (send_state.head != send_state.tail) {
+            st = send_state.ring[send_state.tail++ % ESPNOW_SEND_RING_LEN];
+            ok = true;
+        }
+        portEXIT_CRITICAL(&send_state_mux);
+        if (!ok) {
+            break;
+        }
+        mp_obj_t tuple[2] = {
+            mp_obj_new_bytes(st.mac, ESP_NOW_ETH_ALEN),
+            mp_obj_new_bool(st.ok),
+        };
+        mp_call_function_1(send_cb_obj, mp_obj_new_tuple(2, tuple));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(espnow_send_dispatch_obj, espnow_send_dispatch);
+
 STATIC void IRAM_ATTR send_cb(const uint8_t *macaddr, esp_now_send_status_t status)
 {
-    if (send_cb_obj != mp_const_none) {
-        mp_obj_tuple_t *msg = mp_obj_new_tuple(2, NULL);
-        msg->items[0] = mp_obj_new_bytes(macaddr, ESP_NOW_ETH_ALEN);
-        msg->items[1] = (status == ESP_NOW_SEND_SUCCESS) ? mp_const_true : mp_const_false;
-        mp_sched_schedule(send_cb_obj, msg);
-        //printf("send_cb");
-        //((void (*)(mp_obj_tuple_t*))send_cb_obj)(msg);
+    bool want_cb = send_cb_obj != mp_const_none;
+    portENTER_CRITICAL(&send_state_mux);
+    if (send_state.in_flight > 0) {
+        send_state.in_flight--;
+    }
+    if (status == ESP_NOW_SEND_SUCCESS) {
+        send_state.delivered++;
+    } else {
+        send_state.failed++;
+    }
+    if (want_cb && send_state.head - send_state.tail < ESPNOW_SEND_RING_LEN) {
+        espnow_send_status_t *st = &send_state.ring[send_state.head++ % ESPNOW_SEND_RING_LEN];
+        memcpy(st->mac, macaddr, ESP_NOW_ETH_ALEN);
+        st->ok = (status == ESP_NOW_SEND_SUCCESS);
+    }
+    portEXIT_CRITICAL(&send_state_mux);
+
+    if (want_cb && !send_state.dispatch_pending) {
+        send_state.dispatch_pending = true;
+        if (!mp_sched_schedule(MP_OBJ_FROM_PTR(&espnow_send_dispatch_obj), mp_const_none)) {
+            send_state.dispatch_pending = false;
+        } else {
+            xTaskNotifyGive(mp_main_task_handle);
+        }
     }
 }
 
-#define BUFFERNUM (32)
+// Wait until fewer than limit frames are in flight, false on timeout
+STATIC bool espnow_wait_in_flight(uint32_t limit, mp_uint_t timeout_ms) {
+    mp_uint_t start = mp_hal_ticks_ms();
+    while (send_state.in_flight >= limit) {
+        if (mp_hal_ticks_ms() - start >= timeout_ms) {
+            return false;
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+    return true;
+}
 
-typedef struct _my_obj_tuple_t {
-    mp_obj_base_t base;
-    size_t len;
-    mp_obj_t items[2];
-} my_obj_tuple_t;
+bool espnow_send_frame_nowait(const uint8_t *addr, const uint8_t *buf, size_t len) {
+    bool ok = false;
+    portENTER_CRITICAL(&send_state_mux);
+    if (send_state.in_flight < ESPNOW_TX_WINDOW) {
+        send_state.in_flight++;
+        ok = true;
+    }
+    portEXIT_CRITICAL(&send_state_mux);
+    if (!ok) {
+        return false;
+    }
+    ok = (esp_now_send(addr, buf, len) == ESP_OK);
+    portENTER_CRITICAL(&send_state_mux);
+    if (ok) {
+        send_state.sent++;
+    } else if (send_state.in_flight > 0) {
+        send_state.in_flight--;
+    }
+    portEXIT_CRITICAL(&send_state_mux);
+    return ok;
+}
 
-static my_obj_tuple_t msg[BUFFERNUM];
-static mp_obj_str_t item[BUFFERNUM][2];
-static uint8_t my_g_i = 0;
-byte recv_buffer[2][BUFFERNUM][256];
+// Hand one frame to ESP-NOW, waiting for room in the TX window
+STATIC void espnow_xmit(const uint8_t *addr, const uint8_t *buf, size_t len) {
+    mp_uint_t start = mp_hal_ticks_ms();
+    for (;;) {
+        if (!espnow_wait_in_flight(ESPNOW_TX_WINDOW, ESPNOW_SEND_TIMEOUT_MS)) {
+            mp_raise_OSError(MP_ETIMEDOUT);
+        }
+        // count the frame first, send_cb may run before esp_now_send returns
+        portENTER_CRITICAL(&send_state_mux);
+        send_state.in_flight++;
+        portEXIT_CRITICAL(&send_state_mux);
+        esp_err_t e = esp_now_send(addr, buf, len);
+        portENTER_CRITICAL(&send_state_mux);
+        if (e == ESP_OK) {
+            send_state.sent++;
+        } else if (send_state.in_flight > 0) {
+            send_state.in_flight--;
+        }
+        portEXIT_CRITICAL(&send_state_mux);
+        if (e == ESP_OK) {
+            return;
+        }
+        if (e != ESP_ERR_ESPNOW_NO_MEM) {
+            ESPNOW_EXCEPTIONS(e);
+        }
+        // the driver queue is shorter than our window, give it a moment
+        if (mp_hal_ticks_ms() - start >= ESPNOW_SEND_TIMEOUT_MS) {
+            mp_raise_OSError(MP_ETIMEDOUT);
+        }
+        MICROPY_EVENT_POLL_HOOK
+    }
+}
 
-STATIC void IRAM_ATTR recv_cb(const uint8_t *macaddr, const uint8_t *data, int len) 
-{
-    if (recv_cb_obj != mp_const_none) {
-#if 0
-        mp_obj_tuple_t *msg = mp_obj_new_tuple(2, NULL);
-        msg->items[0] = mp_obj_new_bytes(macaddr, ESP_NOW_ETH_ALEN);
-        msg->items[1] = mp_obj_new_bytes(data, len);
-        mp_sched_schedule(recv_cb_obj, msg);
-#endif
+// Received packets are copied into a fixed ring of slots by the WiFi task
+// and taken out again from the VM, either by the recv functions or by the
+// dispatcher scheduled for an on_recv callback.  The WiFi task only copies
+// bytes under the lock; all objects are created on the VM side.  When the
+// ring is full new packets are dropped and counted rather than overwriting
+// ones that have not been read yet.
+#define ESPNOW_RECV_RING_LEN (32)
+
+typedef struct _espnow_packet_t {
+    uint32_t ticks_us;  // esp_timer time when the WiFi task got it
+    int8_t rssi;        // dBm, or 0 if unknown
+    uint8_t channel;    // or 0 if unknown
+    uint8_t mac[ESP_NOW_ETH_ALEN];
+    uint8_t len;
+    uint8_t data[ESP_NOW_MAX_DATA_LEN];
+} espnow_packet_t;
+
+// An ESP-NOW frame is a vendor specific action frame.  The data passed to
+// recv_cb is its body, still inside the wifi_promiscuous_pkt_t the driver
+// received, so the rx_ctrl with the RSSI and channel sits just before the
+// 802.11 header.  The header is checked before the rx_ctrl is trusted.
+typedef struct __attribute__((packed)) _espnow_frame_t {
+    uint16_t frame_ctrl;
+    uint16_t duration;
+    uint8_t dest[ESP_NOW_ETH_ALEN];
+    uint8_t src[ESP_NOW_ETH_ALEN];
+    uint8_t bssid[ESP_NOW_ETH_ALEN];
+    uint16_t seq_ctrl;
+    uint8_t category;
+    uint8_t oui[3];
+    uint8_t random[4];
+    uint8_t element_id;
+    uint8_t element_len;
+    uint8_t element_oui[3];
+    uint8_t type;
+    uint8_t version;
+    uint8_t body[];
+} espnow_frame_t;
+
+#define ESPNOW_ELEMENT_ID_VENDOR (0xdd)
+
+STATIC const uint8_t espnow_oui[3] = {0x18, 0xfe, 0x34};
+
+STATIC void IRAM_ATTR espnow_rx_info(const uint8_t *mac, const uint8_t *data, espnow_packet_t *slot) {
+    const espnow_frame_t *frame = (const espnow_frame_t *)(data - offsetof(espnow_frame_t, body));
+    const wifi_pkt_rx_ctrl_t *rx_ctrl = (const wifi_pkt_rx_ctrl_t *)((const uint8_t *)frame - sizeof(wifi_pkt_rx_ctrl_t));
+    if (frame->element_id == ESPNOW_ELEMENT_ID_VENDOR
+        && memcmp(frame->element_oui, espnow_oui, sizeof(espnow_oui)) == 0
+        && memcmp(frame->src, mac, ESP_NOW_ETH_ALEN) == 0) {
+        slot->rssi = rx_ctrl->rssi;
+        slot->channel = rx_ctrl->channel;
+    } else {
+        slot->rssi = 0;
+        slot->channel = 0;
+    }
+}
+
+typedef struct _espnow_recv_ring_t {
+    espnow_packet_t slot[ESPNOW_RECV_RING_LEN];
+    uint32_t head;
+    uint32_t tail;
+    uint32_t received;
+    uint32_t dropped;
+    volatile bool dispatch_pending;
+} espnow_recv_ring_t;
+
+STATIC espnow_recv_ring_t recv_ring;
+STATIC portMUX_TYPE recv_ring_mux = portMUX_INITIALIZER_UNLOCKED;
+
+STATIC void espnow_recv_ring_reset(void) {
+    portENTER_CRITICAL(&recv_ring_mux);
+    recv_ring.head = recv_ring.tail = 0;
+    recv_ring.received = recv_ring.dropped = 0;
+    recv_ring.dispatch_pending = false;
+    portEXIT_CRITICAL(&recv_ring_mux);
+}
+
+// Copy the oldest packet out of the ring; returns false if it is empty.
+// If peek is set the packet is left in the ring.
+STATIC bool espnow_recv_ring_get(espnow_packet_t *pkt, bool peek) {
+    bool ok = false;
+    portENTER_CRITICAL(&recv_ring_mux);
+    if (recv_ring.head != recv_ring.tail) {
+        const espnow_packet_t *slot = &recv_ring.slot[recv_ring.tail % ESPNOW_RECV_RING_LEN];
+        pkt->ticks_us = slot->ticks_us;
+        pkt->rssi = slot->rssi;
+        pkt->channel = slot->channel;
+        memcpy(pkt->mac, slot->mac, ESP_NOW_ETH_ALEN);
+        pkt->len = slot->len;
+        memcpy(pkt->data, slot->data, slot->len);
+        if (!peek) {
+            recv_ring.tail++;
+        }
+        ok = true;
+    }
+    portEXIT_CRITICAL(&recv_ring_mux);
+    return ok;
+}
+
+STATIC void espnow_recv_ring_drop(void) {
+    portENTER_CRITICAL(&recv_ring_mux);
+    if (recv_ring.head != recv_ring.tail) {
+        recv_ring.tail++;
+    }
+    portEXIT_CRITICAL(&recv_ring_mux);
+}
+
+STATIC mp_obj_t espnow_packet_tuple(const espnow_packet_t *pkt) {
+    mp_obj_t tuple[2] = {
+        mp_obj_new_bytes(pkt->mac, ESP_NOW_ETH_ALEN),
+        mp_obj_new_bytes(pkt->data, pkt->len),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
 
-        item[my_g_i][0].base.type=&mp_type_bytes;
-        item[my_g_i][0].len = ESP_NOW_ETH_ALEN;
-        item[my_g_i][0].hash = qstr_compute_hash(macaddr, ESP_NOW_ETH_ALEN);
-        memcpy(recv_buffer[0][my_g_i], (byte*)macaddr, ESP_NOW_ETH_ALEN * sizeof(byte));
+// Scheduled from recv_cb when a callback is registered; hands every queued
+// packet to it as a (mac, msg) tuple.
+STATIC mp_obj_t espnow_recv_dispatch(mp_obj_t arg) {
+    (void)arg;
+    // clear the flag first so a packet arriving while we drain schedules
+    // another pass
+    recv_ring.dispatch_pending = false;
+    espnow_packet_t pkt;
+    while (recv_cb_obj != mp_const_none && espnow_recv_ring_get(&pkt, false)) {
+        mp_call_function_1(recv_cb_obj, espnow_packet_tuple(&pkt));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(espnow_recv_dispatch_obj, espnow_recv_dispatch);
 
-        item[my_g_i][1].base.type=&mp_type_bytes;
-        item[my_g_i][1].len = len;
-        item[my_g_i][1].hash = qstr_compute_hash(data, len);
-        memcpy(recv_buffer[1][my_g_i], (byte*)data, len * sizeof(byte));
+STATIC volatile espnow_recv_hook_t recv_hook = NULL;
 
-        msg[my_g_i].base.type = &mp_type_tuple;
-        msg[my_g_i].len=2;
-        msg[my_g_i].items[0] = MP_OBJ_FROM_PTR(&item[my_g_i][0]);
-        msg[my_g_i].items[1] = MP_OBJ_FROM_PTR(&item[my_g_i][1]);
+void espnow_set_recv_hook(espnow_recv_hook_t hook) {
+    recv_hook = hook;
+}
 
-        mp_sched_schedule(recv_cb_obj, MP_OBJ_FROM_PTR(&msg[my_g_i]));
+STATIC void IRAM_ATTR recv_cb(const uint8_t *macaddr, const uint8_t *data, int len)
+{
+    espnow_recv_hook_t hook = recv_hook;
+    if (hook != NULL && hook(macaddr, data, len)) {
+        return;
+    }
 
-        if (++my_g_i > BUFFERNUM-1)
-            my_g_i = 0;
+    // stamped before taking the lock, and long before the VM sees it
+    uint32_t ticks_us = esp_timer_get_time();
+    bool queued = false;
+    portENTER_CRITICAL(&recv_ring_mux);
+    if (len < 0 || len > ESP_NOW_MAX_DATA_LEN
+        || recv_ring.head - recv_ring.tail >= ESPNOW_RECV_RING_LEN) {
+        recv_ring.dropped++;
+    } else {
+        espnow_packet_t *slot = &recv_ring.slot[recv_ring.head % ESPNOW_RECV_RING_LEN];
+        slot->ticks_us = ticks_us;
+        espnow_rx_info(macaddr, data, slot);
+        memcpy(slot->mac, macaddr, ESP_NOW_ETH_ALEN);
+        slot->len = len;
+        memcpy(slot->data, data, len);
+        recv_ring.head++;
+        recv_ring.received++;
+        queued = true;
+    }
+    portEXIT_CRITICAL(&recv_ring_mux);
+
+    if (queued && recv_cb_obj != mp_const_none && !recv_ring.dispatch_pending) {
+        recv_ring.dispatch_pending = true;
+        if (!mp_sched_schedule(MP_OBJ_FROM_PTR(&espnow_recv_dispatch_obj), mp_const_none)) {
+            // scheduler queue is full, try again with the next packet
+            recv_ring.dispatch_pending = false;
+        } else {
+            xTaskNotifyGive(mp_main_task_handle);
+        }
     }
-} 
+}
 
 static int initialized = 0;
 
@@ -149,15 +432,10 @@ STATIC mp_obj_t espnow_init() {
         ESPNOW_EXCEPTIONS(esp_now_init());
         initialized = 1;
 
+        espnow_recv_ring_reset();
+        espnow_send_state_reset();
         ESPNOW_EXCEPTIONS(esp_now_register_recv_cb(recv_cb));
         ESPNOW_EXCEPTIONS(esp_now_register_send_cb(send_cb));
-
-	int i;
-	for (i = 0;i < BUFFERNUM;i++) {
-		item[i][0].data = recv_buffer[0][i];
-		item[i][1].data = recv_buffer[1][i];
-	}
-
     }
     return mp_const_none;
 }
@@ -167,6 +445,8 @@ STATIC mp_obj_t espnow_deinit() {
     if (initialized) {
         ESPNOW_EXCEPTIONS(esp_now_deinit());
         initialized = 0;
+        espnow_recv_ring_reset();
+        espnow_send_state_reset();
     }
     return mp_const_none;
 }
@@ -188,10 +468,114 @@ STATIC mp_obj_t espnow_on_recv(size_t n_args, const mp_obj_t *args) {
     }
 
     recv_cb_obj = args[0];
+    if (recv_cb_obj != mp_const_none && !recv_ring.dispatch_pending
+        && recv_ring.head != recv_ring.tail) {
+        // hand over anything that arrived before the callback was set
+        recv_ring.dispatch_pending = mp_sched_schedule(MP_OBJ_FROM_PTR(&espnow_recv_dispatch_obj), mp_const_none);
+    }
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(espnow_on_recv_obj, 0, 1, espnow_on_recv);
 
+// recv() -> (peer_mac, msg) or None
+STATIC mp_obj_t espnow_recv() {
+    espnow_packet_t pkt;
+    if (!espnow_recv_ring_get(&pkt, false)) {
+        return mp_const_none;
+    }
+    return espnow_packet_tuple(&pkt);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(espnow_recv_obj, espnow_recv);
+
+// recv_into(buf, [mac_buf, [info]]) -> length of msg or None
+//
+// Copies the next message into buf without allocating.  If buf is too
+// small the message is left queued and ValueError is raised.  info is an
+// array of at least 3 ints, set to the RSSI in dBm, the time.ticks_us()
+// when it arrived and the channel; RSSI and channel are 0 if unknown.
+STATIC mp_obj_t espnow_recv_into(size_t n_args, const mp_obj_t *args) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_WRITE);
+    mp_buffer_info_t macinfo = { .buf = NULL };
+    if (n_args > 1 && args[1] != mp_const_none) {
+        mp_get_buffer_raise(args[1], &macinfo, MP_BUFFER_WRITE);
+        if (macinfo.len < ESP_NOW_ETH_ALEN) mp_raise_ValueError("mac buffer too small");
+    }
+    mp_buffer_info_t info = { .buf = NULL };
+    if (n_args > 2 && args[2] != mp_const_none) {
+        mp_get_buffer_raise(args[2], &info, MP_BUFFER_WRITE);
+        if (info.len < 3 * mp_binary_get_size('@', info.typecode, NULL)) mp_raise_ValueError("info array too small");
+    }
+
+    espnow_packet_t pkt;
+    if (!espnow_recv_ring_get(&pkt, true)) {
+        return mp_const_none;
+    }
+    if (pkt.len > bufinfo.len) mp_raise_ValueError("buffer too small");
+    espnow_recv_ring_drop();
+
+    memcpy(bufinfo.buf, pkt.data, pkt.len);
+    if (macinfo.buf != NULL) {
+        memcpy(macinfo.buf, pkt.mac, ESP_NOW_ETH_ALEN);
+    }
+    if (info.buf != NULL) {
+        mp_binary_set_val_array(info.typecode, info.buf, 0, MP_OBJ_NEW_SMALL_INT(pkt.rssi));
+        mp_binary_set_val_array(info.typecode, info.buf, 1,
+            MP_OBJ_NEW_SMALL_INT(pkt.ticks_us & (MICROPY_PY_UTIME_TICKS_PERIOD - 1)));
+        mp_binary_set_val_array(info.typecode, info.buf, 2, MP_OBJ_NEW_SMALL_INT(pkt.channel));
+    }
+    return MP_OBJ_NEW_SMALL_INT(pkt.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(espnow_recv_into_obj, 1, 3, espnow_recv_into);
+
+// any() -> number of messages waiting
+STATIC mp_obj_t espnow_any() {
+    portENTER_CRITICAL(&recv_ring_mux);
+    uint32_t n = recv_ring.head - recv_ring.tail;
+    portEXIT_CRITICAL(&recv_ring_mux);
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(espnow_any_obj, espnow_any);
+
+// stats() -> (received, dropped)
+STATIC mp_obj_t espnow_stats() {
+    portENTER_CRITICAL(&recv_ring_mux);
+    uint32_t received = recv_ring.received;
+    uint32_t dropped = recv_ring.dropped;
+    portEXIT_CRITICAL(&recv_ring_mux);
+
+    mp_obj_t tuple[2];
+    tuple[0] = mp_obj_new_int_from_uint(received);
+    tuple[1] = mp_obj_new_int_from_uint(dropped);
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(espnow_stats_obj, espnow_stats);
+
+// irecv() -> iterator over the queued (peer_mac, msg) tuples, which ends
+// when there is nothing left to read
+STATIC mp_obj_t espnow_irecv_iternext(mp_obj_t self_in) {
+    (void)self_in;
+    espnow_packet_t pkt;
+    if (!espnow_recv_ring_get(&pkt, false)) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    return espnow_packet_tuple(&pkt);
+}
+
+STATIC const mp_obj_type_t espnow_irecv_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_iterator,
+    .getiter = mp_identity_getiter,
+    .iternext = espnow_irecv_iternext,
+};
+
+STATIC const mp_obj_base_t espnow_irecv_iter = { &espnow_irecv_type };
+
+STATIC mp_obj_t espnow_irecv() {
+    return MP_OBJ_FROM_PTR(&espnow_irecv_iter);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(espnow_irecv_obj, espnow_irecv);
+
 // pmk(primary_key)
 STATIC mp_obj_t espnow_pmk(mp_obj_t key) {
     uint8_t buf[ESP_NOW_KEY_LEN];
@@ -264,17 +648,29 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(espnow_del_peer_obj, espnow_del_peer);
     if_id;                                                          \
 })                                                                  \
 
-STATIC mp_obj_t espnow_send(mp_obj_t addr, mp_obj_t msg) {
-    if (!wifi_started) goto espnow_wifi_err;
+NORETURN STATIC void espnow_raise_wifi_err(void) {
+    mp_raise_msg(&mp_type_OSError, "wifi not active");
+}
+
+STATIC void espnow_send_to(wifi_mode_t mode, const uint8_t *addr, const uint8_t *buf, size_t len) {
+    esp_now_peer_info_t peer;
+    ESPNOW_EXCEPTIONS(esp_now_get_peer(addr, &peer));
+    if (!IS_IF_AVAILABLE(mode, peer.ifidx)) {
+        int new_if = AVAILABLE_IF(mode);
+        if (new_if < 0) espnow_raise_wifi_err();
+        peer.ifidx = new_if;
+        ESPNOW_EXCEPTIONS(esp_now_mod_peer(&peer));
+    }
+    espnow_xmit(addr, buf, len);
+}
 
+STATIC void espnow_send_msg(wifi_mode_t mode, mp_obj_t addr, mp_obj_t msg) {
     mp_uint_t addr_len;
     const uint8_t *addr_buf;
-    mp_uint_t msg_len;
-    const uint8_t *msg_buf = (const uint8_t *)mp_obj_str_get_data(msg, &msg_len);
-    if (msg_len > ESP_NOW_MAX_DATA_LEN) mp_raise_ValueError("msg too long");
+    mp_buffer_info_t msginfo;
+    mp_get_buffer_raise(msg, &msginfo, MP_BUFFER_READ);
+    if (msginfo.len > ESP_NOW_MAX_DATA_LEN) mp_raise_ValueError("msg too long");
 
-    wifi_mode_t mode;
-    ESPNOW_EXCEPTIONS(esp_wifi_get_mode(&mode));
     bool first = true;
     int new_if = -1;
     if (addr == mp_const_none) {
@@ -286,40 +682,92 @@ STATIC mp_obj_t espnow_send(mp_obj_t addr, mp_obj_t msg) {
             if (!IS_IF_AVAILABLE(mode, peer.ifidx)) {
                 if (first) {
                     new_if = AVAILABLE_IF(mode);
-                    if (new_if < 0) goto espnow_wifi_err;
+                    if (new_if < 0) espnow_raise_wifi_err();
                     first = false;
                 }
                 peer.ifidx = new_if;
                 ESPNOW_EXCEPTIONS(esp_now_mod_peer(&peer));
             }
             addr_buf = peer.peer_addr;
-            ESPNOW_EXCEPTIONS(esp_now_send(addr_buf, msg_buf, msg_len));
+            espnow_xmit(addr_buf, msginfo.buf, msginfo.len);
             e = esp_now_fetch_peer(false, &peer);
         }
     } else {
         // send to one
         addr_buf = (const uint8_t *)mp_obj_str_get_data(addr, &addr_len);
         if (addr_len != ESP_NOW_ETH_ALEN) mp_raise_ValueError("addr invalid");
-
-        esp_now_peer_info_t peer;
-        ESPNOW_EXCEPTIONS(esp_now_get_peer(addr_buf, &peer));
-        if (!IS_IF_AVAILABLE(mode, peer.ifidx)) {
-            new_if = AVAILABLE_IF(mode);
-            if (new_if < 0) goto espnow_wifi_err;
-            peer.ifidx = new_if;
-            ESPNOW_EXCEPTIONS(esp_now_mod_peer(&peer));
-        }
-        ESPNOW_EXCEPTIONS(esp_now_send(addr_buf, msg_buf, msg_len));
+        espnow_send_to(mode, addr_buf, msginfo.buf, msginfo.len);
     }
+}
 
-    return mp_const_none;
+void espnow_send_frame(const uint8_t *addr, const uint8_t *buf, size_t len) {
+    if (!wifi_started) espnow_raise_wifi_err();
 
-espnow_wifi_err:
-    mp_raise_msg(&mp_type_OSError, "wifi not active");
+    wifi_mode_t mode;
+    ESPNOW_EXCEPTIONS(esp_wifi_get_mode(&mode));
+    espnow_send_to(mode, addr, buf, len);
+}
+
+STATIC mp_obj_t espnow_send(mp_obj_t addr, mp_obj_t msg) {
+    if (!wifi_started) espnow_raise_wifi_err();
+
+    wifi_mode_t mode;
+    ESPNOW_EXCEPTIONS(esp_wifi_get_mode(&mode));
+    espnow_send_msg(mode, addr, msg);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(espnow_send_obj, espnow_send);
 
+// send_many(packets) -> number of frames sent
+//
+// packets is an iterable of (peer_mac, msg) pairs, peer_mac may be None to
+// send to all peers.  Frames are fed to ESP-NOW as fast as the TX window
+// allows; use send_stats() or on_send to see how they were delivered.
+STATIC mp_obj_t espnow_send_many(mp_obj_t packets) {
+    if (!wifi_started) espnow_raise_wifi_err();
+
+    wifi_mode_t mode;
+    ESPNOW_EXCEPTIONS(esp_wifi_get_mode(&mode));
+    uint32_t sent = send_state.sent;
+    mp_obj_iter_buf_t iter_buf;
+    mp_obj_t iterable = mp_getiter(packets, &iter_buf);
+    mp_obj_t item;
+    while ((item = mp_iternext(iterable)) != MP_OBJ_STOP_ITERATION) {
+        mp_obj_t *pkt;
+        mp_obj_get_array_fixed_n(item, 2, &pkt);
+        espnow_send_msg(mode, pkt[0], pkt[1]);
+    }
+    return mp_obj_new_int_from_uint(send_state.sent - sent);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(espnow_send_many_obj, espnow_send_many);
+
+// flush([timeout_ms]) -> True once every frame sent has been reported,
+// False if that took longer than timeout_ms
+STATIC mp_obj_t espnow_flush(size_t n_args, const mp_obj_t *args) {
+    mp_int_t timeout_ms = n_args > 0 ? mp_obj_get_int(args[0]) : ESPNOW_SEND_TIMEOUT_MS;
+    if (timeout_ms < 0) mp_raise_ValueError("timeout must not be negative");
+    return mp_obj_new_bool(espnow_wait_in_flight(1, timeout_ms));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(espnow_flush_obj, 0, 1, espnow_flush);
+
+// send_stats() -> (sent, delivered, failed, in_flight)
+STATIC mp_obj_t espnow_send_stats() {
+    portENTER_CRITICAL(&send_state_mux);
+    uint32_t sent = send_state.sent;
+    uint32_t delivered = send_state.delivered;
+    uint32_t failed = send_state.failed;
+    uint32_t in_flight = send_state.in_flight;
+    portEXIT_CRITICAL(&send_state_mux);
+
+    mp_obj_t tuple[4];
+    tuple[0] = mp_obj_new_int_from_uint(sent);
+    tuple[1] = mp_obj_new_int_from_uint(delivered);
+    tuple[2] = mp_obj_new_int_from_uint(failed);
+    tuple[3] = mp_obj_new_int_from_uint(in_flight);
+    return mp_obj_new_tuple(4, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(espnow_send_stats_obj, espnow_send_stats);
+
 STATIC mp_obj_t espnow_peer_count() {
     esp_now_peer_num_t peer_num = {0};
     ESPNOW_EXCEPTIONS(esp_now_get_peer_num(&peer_num));
@@ -347,8 +795,16 @@ STATIC const mp_rom_map_elem_t espnow_globals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_add_peer), MP_ROM_PTR(&espnow_add_peer_obj) },
     { MP_ROM_QSTR(MP_QSTR_del_peer), MP_ROM_PTR(&espnow_del_peer_obj) },
     { MP_ROM_QSTR(MP_QSTR_send), MP_ROM_PTR(&espnow_send_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_many), MP_ROM_PTR(&espnow_send_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&espnow_flush_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_stats), MP_ROM_PTR(&espnow_send_stats_obj) },
     { MP_ROM_QSTR(MP_QSTR_on_send), MP_ROM_PTR(&espnow_on_send_obj) },
     { MP_ROM_QSTR(MP_QSTR_on_recv), MP_ROM_PTR(&espnow_on_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&espnow_recv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv_into), MP_ROM_PTR(&espnow_recv_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irecv), MP_ROM_PTR(&espnow_irecv_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&espnow_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&espnow_stats_obj) },
     { MP_ROM_QSTR(MP_QSTR_peer_count), MP_ROM_PTR(&espnow_peer_count_obj) },
     { MP_ROM_QSTR(MP_QSTR_version), MP_ROM_PTR(&espnow_version_obj) },
 };
@@ -0,0 +1,215 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// NeoPixel output through the RMT peripheral.  Unlike esp_neopixel_write()
+// this does not disable interrupts: the pixel data is encoded into RMT items
+// and the driver's ISR feeds them to the peripheral while the caller returns.
+//
+// The transmit channels are also handed out to other RMT users such as
+// Pin.pulse_train() through esp_rmt_tx_channel(), so that they don't both
+// configure the same channel.
+
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "driver/rmt.h"
+
+#include "py/mpconfig.h"
+#include "py/mpthread.h"
+#include "modesp.h"
+
+// APB clock is 80MHz, divide by 2 to get a 25ns tick
+#define NEOPIXEL_RMT_CLK_DIV    (2)
+#define NS_TO_TICKS(ns)         ((ns) / 25)
+
+// Low time appended to every frame so the strip latches before the next one
+#define NEOPIXEL_RMT_LATCH_TICKS NS_TO_TICKS(30000)
+
+typedef struct _neopixel_rmt_chan_t {
+    int8_t pin;
+    uint8_t clk_div;
+    bool idle_level;
+    uint32_t items_alloc;
+    rmt_item32_t *items;
+} neopixel_rmt_chan_t;
+
+STATIC neopixel_rmt_chan_t neopixel_rmt_chan[RMT_CHANNEL_MAX];
+STATIC bool neopixel_rmt_inited = false;
+
+STATIC void neopixel_rmt_init_table(void) {
+    if (!neopixel_rmt_inited) {
+        for (int i = 0; i < RMT_CHANNEL_MAX; ++i) {
+            neopixel_rmt_chan[i].pin = -1;
+            neopixel_rmt_chan[i].items_alloc = 0;
+            neopixel_rmt_chan[i].items = NULL;
+        }
+        neopixel_rmt_inited = true;
+    }
+}
+
+STATIC int neopixel_rmt_find(int pin) {
+    // ESP_RMT_RX_CHANNEL is never handed out for transmitting
+    for (int i = 0; i < ESP_RMT_RX_CHANNEL; ++i) {
+        if (neopixel_rmt_chan[i].pin == pin) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Returns the channel driving the given pin, installing the RMT driver on a
+// free channel the first time the pin is used.  The clock divider and the
+// idle level are changed if the last user of the channel set others.
+int esp_rmt_tx_channel(uint8_t pin, uint8_t clk_div, bool idle_level) {
+    neopixel_rmt_init_table();
+    int ch = neopixel_rmt_find(pin);
+    if (ch >= 0) {
+        neopixel_rmt_chan_t *chan = &neopixel_rmt_chan[ch];
+        // the pin may have been given back to the GPIO matrix by Pin.init()
+        if (rmt_set_pin(ch, RMT_MODE_TX, pin) != ESP_OK) {
+            return -1;
+        }
+        if (chan->clk_div != clk_div || chan->idle_level != idle_level) {
+            esp_rmt_tx_wait(ch);
+            if (rmt_set_clk_div(ch, clk_div) != ESP_OK
+                || rmt_set_idle_level(ch, true, idle_level ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW) != ESP_OK) {
+                return -1;
+            }
+            chan->clk_div = clk_div;
+            chan->idle_level = idle_level;
+        }
+        return ch;
+    }
+    ch = neopixel_rmt_find(-1);
+    if (ch < 0) {
+        return -1;
+    }
+
+    rmt_config_t config = {
+        .rmt_mode = RMT_MODE_TX,
+        .channel = ch,
+        .clk_div = clk_div,
+        .gpio_num = pin,
+        .mem_block_num = 1,
+        .tx_config = {
+            .loop_en = false,
+            .carrier_en = false,
+            .idle_output_en = true,
+            .idle_level = idle_level ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW,
+        },
+    };
+    if (rmt_config(&config) != ESP_OK || rmt_driver_install(ch, 0, 0) != ESP_OK) {
+        return -1;
+    }
+    neopixel_rmt_chan[ch].pin = pin;
+    neopixel_rmt_chan[ch].clk_div = clk_div;
+    neopixel_rmt_chan[ch].idle_level = idle_level;
+    return ch;
+}
+
+void esp_rmt_tx_wait(int ch) {
+    MP_THREAD_GIL_EXIT();
+    rmt_wait_tx_done(ch, portMAX_DELAY);
+    MP_THREAD_GIL_ENTER();
+}
+
+// The item buffer of a channel, with room for num_items.  The buffer is read
+// by the RMT ISR, so this waits for the previous transmission to finish.
+rmt_item32_t *esp_rmt_tx_items(int ch, uint32_t num_items) {
+    neopixel_rmt_chan_t *chan = &neopixel_rmt_chan[ch];
+    esp_rmt_tx_wait(ch);
+    if (num_items > chan->items_alloc) {
+        rmt_item32_t *items = realloc(chan->items, num_items * sizeof(rmt_item32_t));
+        if (items == NULL) {
+            return NULL;
+        }
+        chan->items = items;
+        chan->items_alloc = num_items;
+    }
+    return chan->items;
+}
+
+int esp_neopixel_rmt_write(uint8_t pin, const uint8_t *pixels, uint32_t numBytes, uint8_t timing) {
+    int ch = esp_rmt_tx_channel(pin, NEOPIXEL_RMT_CLK_DIV, false);
+    if (ch < 0) {
+        return -1;
+    }
+    uint32_t num_items = numBytes * 8 + 1;
+    rmt_item32_t *items = esp_rmt_tx_items(ch, num_items);
+    if (items == NULL) {
+        return -1;
+    }
+
+    rmt_item32_t bit0, bit1;
+    if (timing == 1) {
+        // 800 KHz
+        bit0 = (rmt_item32_t){{{ NS_TO_TICKS(350), 1, NS_TO_TICKS(900), 0 }}};
+        bit1 = (rmt_item32_t){{{ NS_TO_TICKS(800), 1, NS_TO_TICKS(450), 0 }}};
+    } else {
+        // 400 KHz
+        bit0 = (rmt_item32_t){{{ NS_TO_TICKS(500), 1, NS_TO_TICKS(2000), 0 }}};
+        bit1 = (rmt_item32_t){{{ NS_TO_TICKS(1200), 1, NS_TO_TICKS(1300), 0 }}};
+    }
+
+    rmt_item32_t *item = items;
+    for (const uint8_t *p = pixels, *end = pixels + numBytes; p < end; ++p) {
+        uint8_t pix = *p;
+        for (uint8_t mask = 0x80; mask; mask >>= 1) {
+            *item++ = (pix & mask) ? bit1 : bit0;
+        }
+    }
+    *item = (rmt_item32_t){{{ NEOPIXEL_RMT_LATCH_TICKS, 0, NEOPIXEL_RMT_LATCH_TICKS, 0 }}};
+
+    if (rmt_write_items(ch, items, num_items, false) != ESP_OK) {
+        return -1;
+    }
+    return 0;
+}
+
+void esp_neopixel_rmt_wait(uint8_t pin) {
+    neopixel_rmt_init_table();
+    int ch = neopixel_rmt_find(pin);
+    if (ch >= 0) {
+        esp_rmt_tx_wait(ch);
+    }
+}
+
+void esp_neopixel_rmt_deinit(void) {
+    if (!neopixel_rmt_inited) {
+        return;
+    }
+    for (int i = 0; i < RMT_CHANNEL_MAX; ++i) {
+        neopixel_rmt_chan_t *chan = &neopixel_rmt_chan[i];
+        if (chan->pin != -1) {
+            rmt_wait_tx_done(i, portMAX_DELAY);
+            rmt_driver_uninstall(i);
+            free(chan->items);
+            chan->pin = -1;
+            chan->items_alloc = 0;
+            chan->items = NULL;
+        }
+    }
+}
@@ -0,0 +1,320 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Waveform capture through the RMT peripheral.  The receive channel records
+// the level and length of every pulse on a pin, in 1us ticks, from the first
+// edge until the line has been idle for a given time.  A transaction can
+// also drive the same pin, open-drain, from a transmit channel while it is
+// being recorded, so the start pulse of a DHT sensor or the time slots of a
+// 1-Wire bus are generated and sampled by the hardware.  The caller waits
+// for the ring buffer of the driver with the GIL released, instead of
+// busy-waiting with interrupts disabled.
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/ringbuf.h"
+#include "driver/rmt.h"
+#include "soc/gpio_sig_map.h"
+
+#include "py/mpconfig.h"
+#include "py/misc.h"
+#include "py/mperrno.h"
+#include "py/mpthread.h"
+#include "py/mphal.h"
+#include "modesp.h"
+
+// APB clock is 80MHz, divide by 80 to get a 1us tick
+#define RMT_RX_CLK_DIV          (80)
+// pulses shorter than this many APB cycles are taken as noise
+#define RMT_RX_FILTER_TICKS     (40)
+// the channel has one block of RMT RAM
+#define RMT_RX_MAX_ITEMS        (64)
+#define RMT_RX_RINGBUF_SIZE     (RMT_RX_MAX_ITEMS * sizeof(rmt_item32_t) * 2)
+
+// 1-Wire slots, in microseconds
+#define OW_RESET_LOW            (480)
+#define OW_RESET_IDLE           (250)   // ends the capture after the presence pulse
+#define OW_RESET_RECOVERY       (250)
+#define OW_SLOT                 (70)
+#define OW_WRITE1_LOW           (6)
+#define OW_WRITE0_LOW           (60)
+#define OW_READ_LOW             (3)
+#define OW_READ_SAMPLE          (15)    // a low longer than this reads as 0
+#define OW_IDLE                 (100)
+
+// DHT11/DHT22 frame
+#define DHT_START_LOW           (18000)
+#define DHT_IDLE                (20000) // longer than the start pulse
+#define DHT_TIMEOUT_MS          (50)
+#define DHT_BIT1_HIGH           (48)
+
+STATIC bool rmt_rx_installed = false;
+STATIC RingbufHandle_t rmt_rx_ringbuf;
+
+STATIC int rmt_rx_setup(uint8_t pin, uint16_t idle_us) {
+    if (!rmt_rx_installed) {
+        rmt_config_t config = {
+            .rmt_mode = RMT_MODE_RX,
+            .channel = ESP_RMT_RX_CHANNEL,
+            .clk_div = RMT_RX_CLK_DIV,
+            .gpio_num = pin,
+            .mem_block_num = 1,
+            .rx_config = {
+                .filter_en = true,
+                .filter_ticks_thresh = RMT_RX_FILTER_TICKS,
+                .idle_threshold = idle_us,
+            },
+        };
+        if (rmt_config(&config) != ESP_OK
+            || rmt_driver_install(ESP_RMT_RX_CHANNEL, RMT_RX_RINGBUF_SIZE, 0) != ESP_OK
+            || rmt_get_ringbuf_handle(ESP_RMT_RX_CHANNEL, &rmt_rx_ringbuf) != ESP_OK) {
+            return -1;
+        }
+        rmt_rx_installed = true;
+        return 0;
+    }
+    if (rmt_set_pin(ESP_RMT_RX_CHANNEL, RMT_MODE_RX, pin) != ESP_OK
+        || rmt_set_rx_idle_thresh(ESP_RMT_RX_CHANNEL, idle_us) != ESP_OK) {
+        return -1;
+    }
+    return 0;
+}
+
+// Record the pulses on pin into rx, from the first edge until the line has
+// been idle for idle_us (at most 65535), waiting up to timeout_ms for the
+// frame.  If n_tx > 0 the tx items are sent on the pin first, open-drain and
+// idling high.  Returns the number of items recorded, 0 if there was no
+// frame, or -1 if the peripheral could not be set up.
+int esp_rmt_rx_capture(uint8_t pin, const rmt_item32_t *tx, size_t n_tx,
+    rmt_item32_t *rx, size_t max_rx, uint16_t idle_us, uint32_t timeout_ms) {
+    // the receiver is routed first, as routing a transmitter to the pin
+    // makes it an output
+    if (rmt_rx_setup(pin, idle_us) != 0) {
+        return -1;
+    }
+    int tx_ch = -1;
+    if (n_tx > 0) {
+        tx_ch = esp_rmt_tx_channel(pin, RMT_RX_CLK_DIV, true);
+        if (tx_ch < 0) {
+            return -1;
+        }
+        rmt_item32_t *items = esp_rmt_tx_items(tx_ch, n_tx);
+        if (items == NULL) {
+            return -1;
+        }
+        memcpy(items, tx, n_tx * sizeof(rmt_item32_t));
+        tx = items;
+        gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+        gpio_matrix_in(pin, RMT_SIG_IN0_IDX + ESP_RMT_RX_CHANNEL, false);
+    }
+
+    // drop anything left over from an earlier frame
+    size_t size;
+    void *data;
+    while ((data = xRingbufferReceive(rmt_rx_ringbuf, &size, 0)) != NULL) {
+        vRingbufferReturnItem(rmt_rx_ringbuf, data);
+    }
+
+    rmt_rx_start(ESP_RMT_RX_CHANNEL, true);
+    if (tx_ch >= 0) {
+        rmt_write_items(tx_ch, tx, n_tx, false);
+    }
+    MP_THREAD_GIL_EXIT();
+    data = xRingbufferReceive(rmt_rx_ringbuf, &size, pdMS_TO_TICKS(timeout_ms) + 1);
+    MP_THREAD_GIL_ENTER();
+    rmt_rx_stop(ESP_RMT_RX_CHANNEL);
+
+    size_t n = 0;
+    if (data != NULL) {
+        n = MIN(size / sizeof(rmt_item32_t), max_rx);
+        memcpy(rx, data, n * sizeof(rmt_item32_t));
+        vRingbufferReturnItem(rmt_rx_ringbuf, data);
+    }
+
+    if (tx_ch >= 0) {
+        // give the pin back to the GPIO matrix, as an open-drain output
+        esp_rmt_tx_wait(tx_ch);
+        gpio_matrix_out(pin, SIG_GPIO_OUT_IDX, false, false);
+        gpio_set_level(pin, 1);
+        gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    }
+    return n;
+}
+
+// The level and length of pulse i of a capture, each item holds two.  A
+// zero length marks the end of the frame.
+STATIC uint32_t rmt_rx_pulse(const rmt_item32_t *items, size_t i, int *level) {
+    const rmt_item32_t *it = &items[i / 2];
+    if (i & 1) {
+        *level = it->level1;
+        return it->duration1;
+    }
+    *level = it->level0;
+    return it->duration0;
+}
+
+void esp_rmt_rx_deinit(void) {
+    if (rmt_rx_installed) {
+        rmt_rx_stop(ESP_RMT_RX_CHANNEL);
+        rmt_driver_uninstall(ESP_RMT_RX_CHANNEL);
+        rmt_rx_installed = false;
+    }
+}
+
+/******************************************************************************/
+// 1-Wire and DHT on top of esp_rmt_rx_capture(); these return -1 when the
+// peripheral is not available, so the callers can bit-bang instead
+
+int esp_rmt_onewire_reset(uint8_t pin) {
+    const rmt_item32_t tx[1] = {{{{ OW_RESET_LOW, 0, 0, 1 }}}};
+    rmt_item32_t rx[RMT_RX_MAX_ITEMS];
+    int n = esp_rmt_rx_capture(pin, tx, 1, rx, RMT_RX_MAX_ITEMS, OW_RESET_IDLE, 5);
+    if (n < 0) {
+        return -1;
+    }
+    // the first low pulse is the reset itself, any other is a presence pulse
+    int presence = 0;
+    int lows = 0;
+    for (size_t i = 0; i < 2 * (size_t)n; ++i) {
+        int level;
+        if (rmt_rx_pulse(rx, i, &level) == 0) {
+            break;
+        }
+        if (level == 0 && ++lows > 1) {
+            presence = 1;
+        }
+    }
+    mp_hal_delay_us(OW_RESET_RECOVERY);
+    return presence;
+}
+
+int esp_rmt_onewire_writebyte(uint8_t pin, uint8_t value) {
+    int ch = esp_rmt_tx_channel(pin, RMT_RX_CLK_DIV, true);
+    if (ch < 0) {
+        return -1;
+    }
+    rmt_item32_t *items = esp_rmt_tx_items(ch, 8);
+    if (items == NULL) {
+        return -1;
+    }
+    for (int i = 0; i < 8; ++i, value >>= 1) {
+        uint32_t low = (value & 1) ? OW_WRITE1_LOW : OW_WRITE0_LOW;
+        items[i] = (rmt_item32_t){{{ low, 0, OW_SLOT - low, 1 }}};
+    }
+    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    if (rmt_write_items(ch, items, 8, false) != ESP_OK) {
+        return -1;
+    }
+    esp_rmt_tx_wait(ch);
+    gpio_matrix_out(pin, SIG_GPIO_OUT_IDX, false, false);
+    gpio_set_level(pin, 1);
+    gpio_set_direction(pin, GPIO_MODE_INPUT_OUTPUT_OD);
+    return 0;
+}
+
+// Eight read slots: the master pulls the line low briefly and a device
+// sending a 0 holds it low for longer
+int esp_rmt_onewire_readbyte(uint8_t pin) {
+    rmt_item32_t tx[8];
+    for (int i = 0; i < 8; ++i) {
+        tx[i] = (rmt_item32_t){{{ OW_READ_LOW, 0, OW_SLOT - OW_READ_LOW, 1 }}};
+    }
+    rmt_item32_t rx[RMT_RX_MAX_ITEMS];
+    int n = esp_rmt_rx_capture(pin, tx, 8, rx, RMT_RX_MAX_ITEMS, OW_IDLE, 5);
+    if (n < 0) {
+        return -1;
+    }
+    int value = 0;
+    int bit = 0;
+    for (size_t i = 0; i < 2 * (size_t)n && bit < 8; ++i) {
+        int level;
+        uint32_t us = rmt_rx_pulse(rx, i, &level);
+        if (us == 0) {
+            break;
+        }
+        if (level == 0) {
+            value |= (us <= OW_READ_SAMPLE) << bit++;
+        }
+    }
+    if (bit < 8) {
+        // a slot was lost, the bus is probably held low
+        return -1;
+    }
+    return value;
+}
+
+// Read the 5 bytes of a DHT frame into buf.  Returns 0, MP_ETIMEDOUT or -1.
+int esp_rmt_dht_readinto(uint8_t pin, uint8_t *buf) {
+    const rmt_item32_t tx[1] = {{{{ DHT_START_LOW, 0, 0, 1 }}}};
+    rmt_item32_t rx[RMT_RX_MAX_ITEMS];
+    int n = esp_rmt_rx_capture(pin, tx, 1, rx, RMT_RX_MAX_ITEMS, DHT_IDLE, DHT_TIMEOUT_MS);
+    if (n < 0) {
+        return -1;
+    }
+    // after the start pulse the line is released (high), the sensor answers
+    // with 80us low and 80us high, then each bit is 50us low followed by
+    // a high of 26us for a 0 or 70us for a 1
+    int highs = 0;
+    memset(buf, 0, 5);
+    for (size_t i = 0; i < 2 * (size_t)n; ++i) {
+        int level;
+        uint32_t us = rmt_rx_pulse(rx, i, &level);
+        if (us == 0) {
+            break;
+        }
+        if (level == 1) {
+            int bit = highs++ - 2;
+            if (bit >= 0 && bit < 40) {
+                buf[bit / 8] = (buf[bit / 8] << 1) | (us > DHT_BIT1_HIGH);
+            }
+        }
+    }
+    return highs >= 42 ? 0 : MP_ETIMEDOUT;
+}
+
+// Record up to n pulses at level, returning how many were stored in us_out
+int esp_rmt_time_pulses_us(uint8_t pin, int pulse_level, uint32_t *us_out, size_t n, uint32_t timeout_us) {
+    rmt_item32_t rx[RMT_RX_MAX_ITEMS];
+    uint16_t idle = MIN(timeout_us, 0xffff);
+    gpio_set_direction(pin, GPIO_MODE_INPUT);
+    int items = esp_rmt_rx_capture(pin, NULL, 0, rx, RMT_RX_MAX_ITEMS, idle, timeout_us / 1000 + 2 * RMT_RX_MAX_ITEMS * idle / 1000);
+    if (items < 0) {
+        return -1;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < 2 * (size_t)items && count < n; ++i) {
+        int level;
+        uint32_t us = rmt_rx_pulse(rx, i, &level);
+        if (us == 0) {
+            break;
+        }
+        if (level == pulse_level) {
+            us_out[count++] = us;
+        }
+    }
+    return count;
+}
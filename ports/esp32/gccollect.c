@@ -55,7 +55,9 @@ static void gc_collect_inner(int level) {
 
     // trace root pointers from any threads
     #if MICROPY_PY_THREAD
-    mp_thread_gc_others();
+    if (MP_STATE_CTX_IS_MAIN()) {
+        mp_thread_gc_others();
+    }
     #endif
 }
 
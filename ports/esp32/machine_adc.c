@@ -38,13 +38,16 @@
 #include "esp_adc_cal.h"
 #include "soc/rtc_cntl_reg.h"
 #include "soc/sens_reg.h"
+#include "soc/syscon_struct.h"
 #include "esp_log.h"
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/mperrno.h"
 #include "modmachine.h"
 #include "py/objarray.h"
-//#include "extmod/vfs_native.h"
+#include "py/binary.h"
+#include "extmod/vfs_native.h"
 
 #define ADC1_CHANNEL_HALL	ADC1_CHANNEL_MAX
 #define I2S_RD_BUF_SIZE     (1024*2)
@@ -57,6 +60,7 @@ typedef struct _madc_obj_t {
     adc_atten_t atten;
     adc_bits_width_t width;
     mp_obj_t callback;
+    mp_obj_t data;
     void *buffer;
     FILE *fhndl;
     uint8_t val_shift;
@@ -70,8 +74,6 @@ typedef struct _madc_obj_t {
     uint8_t cal_read;
 } madc_obj_t;
 
-extern int MainTaskCore;
-
 bool adc_timer_active = false;
 bool collect_active = false;
 intr_handle_t adc_timer_handle = NULL;
@@ -86,12 +88,25 @@ static uint32_t last_adc_vref = 0;
 static adc_atten_t last_atten = ADC_ATTEN_MAX;
 static adc_atten_t last_atten2 = ADC_ATTEN_MAX;
 static esp_adc_cal_characteristics_t characteristics;
-static bool task_running = false;
-#if 0
+static volatile bool task_running = false;
 static uint64_t collect_start_time = 0;
 static uint64_t collect_end_time = 0;
-static bool task_stop = false;
-#endif
+static volatile bool task_stop = false;
+static volatile uint32_t collect_dropped = 0;
+
+// Continuous capture into a pair of buffers.  While Python handles one
+// buffer in the callback the task fills the other; samples arriving when
+// neither buffer is free are dropped and counted.
+typedef struct _madc_capture_t {
+    void *buf[2];
+    mp_obj_t buf_obj[2];
+    size_t len;
+    uint32_t count;
+    uint32_t filled;
+    volatile uint8_t busy;
+} madc_capture_t;
+
+static madc_capture_t capture;
 
 static const uint8_t adc1_gpios[ADC1_CHANNEL_MAX] = {36, 37, 38, 39, 32, 33, 34, 35};
 static const uint8_t adc2_gpios[ADC2_CHANNEL_MAX] = {4, 0, 2, 15, 13, 12, 14, 27, 25, 26};
@@ -134,7 +149,22 @@ static int get_adc_channel(adc_unit_t adc_num, int pin)
     }
     return channel;
 }
-#if 0
+
+// i2s cleanup shared by the capture tasks
+//-----------------------------
+static void adc_task_exit(void)
+{
+    i2s_adc_disable(0);
+    i2s_driver_uninstall(0);
+    i2s_driver_installed = false;
+
+    esp_log_level_set("I2S", CONFIG_LOG_DEFAULT_LEVEL);
+    task_stop = false;
+    task_running = false;
+
+    vTaskDelete(NULL);
+}
+
 //======================================
 static void adc_task(void *pvParameters)
 {
@@ -179,7 +209,7 @@ static void adc_task(void *pvParameters)
     collect_end_time = collect_start_time;
 
     // read ADC data
-    while (self->buf_ptr < self->buf_len) {
+    while ((self->buf_ptr < self->buf_len) && !task_stop) {
         // read data from I2S bus, in this case, from ADC.
         i2s_read(0, (void *)i2s_read_buff, I2S_RD_BUF_SIZE, &bytes_read, 1000);
         if (bytes_read != I2S_RD_BUF_SIZE) {
@@ -195,7 +225,7 @@ static void adc_task(void *pvParameters)
                 self->buf_ptr++;
             }
         }
-        if ( (self->fhndl) && ( (arr_idx >= (I2S_RD_BUF_SIZE/2)) || (self->buf_ptr < self->buf_len) ) ) {
+        if ((self->fhndl) && (arr_idx > 0)) {
             // save buffer to file
             int res;
             if (self->val_shift) res = fwrite(buff8, 1, arr_idx, self->fhndl);
@@ -220,22 +250,103 @@ static void adc_task(void *pvParameters)
         if (buff16) free(buff16);
     }
 
-    if (self->callback) mp_sched_schedule(self->callback, self);
+    if (self->callback) {
+        mp_sched_schedule(self->callback, self);
+        xTaskNotifyGive(mp_main_task_handle);
+    }
 
 exit:
-    // i2s cleanup
-    i2s_adc_disable(0);
-    i2s_driver_uninstall(0);
-    i2s_driver_installed = false;
+    self->buffer = NULL;
+    self->data = MP_OBJ_NULL;
+    MP_STATE_PORT(machine_adc_collect) = NULL;
     if (i2s_read_buff) free(i2s_read_buff);
+    adc_task_exit();
+}
 
-    esp_log_level_set("I2S", CONFIG_LOG_DEFAULT_LEVEL);
-    task_stop = false;
-    task_running = false;
+// Runs in the VM for every buffer filled by adc_capture_task: hands the
+// buffer to the callback and then gives it back to the task
+//----------------------------------------------------------------
+STATIC mp_obj_t adc_capture_dispatch(mp_obj_t buf_in)
+{
+    uint8_t bit = (buf_in == capture.buf_obj[0]) ? 1 : 2;
+    madc_obj_t *self = MP_STATE_PORT(machine_adc_collect);
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        if ((self != NULL) && (self->callback != NULL)) {
+            mp_call_function_1(self->callback, buf_in);
+        }
+        nlr_pop();
+        capture.busy &= ~bit;
+    }
+    else {
+        capture.busy &= ~bit;
+        nlr_jump(nlr.ret_val);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(adc_capture_dispatch_obj, adc_capture_dispatch);
 
-    vTaskDelete(NULL);
+//==============================================
+static void adc_capture_task(void *pvParameters)
+{
+    madc_obj_t *self = (madc_obj_t *)pvParameters;
+    size_t bytes_read;
+    uint16_t *i2s_read_buff = malloc(I2S_RD_BUF_SIZE);
+    if (i2s_read_buff == NULL) {
+        ESP_LOGE("ADC", "Error allocating i2s read buffer");
+        adc_task_exit();
+        return;
+    }
+
+    int cur = 0;
+    size_t pos = 0;
+    self->buf_ptr = 0;
+    collect_start_time = esp_timer_get_time();
+    collect_end_time = collect_start_time;
+
+    while (!task_stop && ((capture.count == 0) || (capture.filled < capture.count))) {
+        i2s_read(0, (void *)i2s_read_buff, I2S_RD_BUF_SIZE, &bytes_read, 1000);
+        if (bytes_read != I2S_RD_BUF_SIZE) {
+            ESP_LOGE("ADC", "I2S error reading (%d)", bytes_read);
+            break;
+        }
+        for (int i = 0; i < (I2S_RD_BUF_SIZE/2); i++) {
+            if (capture.busy & (1 << cur)) {
+                // Python has not finished with this buffer yet
+                collect_dropped++;
+                continue;
+            }
+            uint16_t val = i2s_read_buff[i] & 0x0fff;
+            if (self->val_shift) ((uint8_t *)capture.buf[cur])[pos++] = (uint8_t)(val >> self->val_shift);
+            else ((uint16_t *)capture.buf[cur])[pos++] = val;
+            self->buf_ptr++;
+            if (pos == capture.len) {
+                capture.filled++;
+                if (self->callback != NULL) {
+                    capture.busy |= (1 << cur);
+                    if (!mp_sched_schedule(MP_OBJ_FROM_PTR(&adc_capture_dispatch_obj), capture.buf_obj[cur])) {
+                        // scheduler queue full, the buffer is never seen
+                        capture.busy &= ~(1 << cur);
+                        collect_dropped += capture.len;
+                    } else {
+                        xTaskNotifyGive(mp_main_task_handle);
+                    }
+                }
+                cur ^= 1;
+                pos = 0;
+                if ((capture.count != 0) && (capture.filled >= capture.count)) break;
+            }
+        }
+    }
+    collect_end_time = esp_timer_get_time();
+
+    // the root pointer is left set so the dispatcher can still reach the
+    // callback and buffers, it is cleared when the next capture starts
+    free(i2s_read_buff);
+    adc_task_exit();
 }
 
+#if 0
 //======================================
 // ADC Timer interrupt function
 //======================================
@@ -304,7 +415,10 @@ STATIC void adc_timer_isr(void *self_in)
             adc_timer_handle = NULL;
         }
         collect_end_time = esp_timer_get_time(); //mp_hal_ticks_us();
-        if (self->callback) mp_sched_schedule(self->callback, self);
+        if (self->callback) {
+            mp_sched_schedule(self->callback, self);
+            mp_hal_wake_main_task_from_isr();
+        }
         self->buffer = NULL;
         adc_timer_active = false;
         collect_active = false;
@@ -435,6 +549,7 @@ STATIC mp_obj_t madc_make_new(const mp_obj_type_t *type, size_t n_args, size_t n
     self->interval = 0;
     self->cal_read = 0;
     self->callback = NULL;
+    self->data = MP_OBJ_NULL;
 
     self->adc_num = args[ARG_unit].u_int;
     if ((self->adc_num != 0) && (self->adc_num != ADC_UNIT_1) && (self->adc_num != ADC_UNIT_2)) {
@@ -701,9 +816,10 @@ STATIC mp_obj_t madc_vref_togpio(mp_uint_t n_args, const mp_obj_t *pos_args, mp_
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(madc_vref_togpio_obj, 0, madc_vref_togpio);
 
-#if 0
 // ==== Collect and i2s read functions ======================================================
 
+#if 0
+
 //-------------------------------------------------------------------------------------------
 STATIC mp_obj_t madc_collect(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     enum { ARG_freq, ARG_len, ARG_readmv, ARG_data, ARG_callback, ARG_wait };
@@ -798,6 +914,65 @@ STATIC mp_obj_t madc_collect(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(madc_collect_obj, 0, madc_collect);
+#endif
+
+// Set up the I2S ADC mode at freq and start task to read from it
+//---------------------------------------------------------------------------
+STATIC void adc_start_task(madc_obj_t *self, int freq, TaskFunction_t task)
+{
+    // configure i2s
+    i2s_config_t i2s_config = {
+        .mode = I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN, // Only RX, ADC input
+        //.mode = I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN | I2S_MODE_ADC_BUILT_IN,
+        .sample_rate = freq,
+        .bits_per_sample = 16,
+        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+        .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+        .dma_buf_count = 4,
+        .dma_buf_len = 1024,
+        .use_apll = false,
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .fixed_mclk = 0
+    };
+
+    // install and start i2s driver
+    if (i2s_driver_install(0, &i2s_config, 0, NULL) != ESP_OK) {
+        if (self->fhndl) {
+            fclose(self->fhndl);
+            self->fhndl = NULL;
+        }
+        self->buffer = NULL;
+        self->data = MP_OBJ_NULL;
+        mp_raise_ValueError("Error installing i2s driver");
+    }
+    i2s_driver_installed = true;
+    // init ADC pad
+    i2s_set_adc_mode(self->adc_num, self->adc_chan);
+    i2s_adc_enable(0);
+    //i2s_set_sample_rates(0, freq);
+
+    // keep the ADC object, and with it the array, alive while the task
+    // is writing into it
+    MP_STATE_PORT(machine_adc_collect) = self;
+    task_stop = false;
+    task_running = true;
+    esp_log_level_set("I2S", ESP_LOG_ERROR);
+    // above the MicroPython task so the DMA buffers are drained in time
+    if (xTaskCreate(task, "ADC_task", 2048, (void *)self, ESP_TASK_PRIO_MIN + 2, NULL) != pdPASS) {
+        i2s_adc_disable(0);
+        i2s_driver_uninstall(0);
+        i2s_driver_installed = false;
+        if (self->fhndl) {
+            fclose(self->fhndl);
+            self->fhndl = NULL;
+        }
+        self->buffer = NULL;
+        self->data = MP_OBJ_NULL;
+        MP_STATE_PORT(machine_adc_collect) = NULL;
+        task_running = false;
+        mp_raise_ValueError("Error starting ADC task");
+    }
+}
 
 //----------------------------------------------------------------------------------------------
 STATIC mp_obj_t madc_read_timed(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
@@ -818,6 +993,9 @@ STATIC mp_obj_t madc_read_timed(mp_uint_t n_args, const mp_obj_t *pos_args, mp_m
     if (self->gpio_id == GPIO_NUM_MAX) {
         mp_raise_ValueError("timed read for hall sensor not allowed");
     }
+    if (self->adc_num != ADC_UNIT_1) {
+        mp_raise_ValueError("timed read only supported on ADC1");
+    }
     if (i2s_driver_installed) {
         mp_raise_ValueError("Error: i2s used by other module");
     }
@@ -833,6 +1011,8 @@ STATIC mp_obj_t madc_read_timed(mp_uint_t n_args, const mp_obj_t *pos_args, mp_m
     self->buf_len = 0;
     self->interval = 0;
     self->val_shift = 0;
+    collect_dropped = 0;
+    MP_STATE_PORT(machine_adc_collect) = NULL;
 
     int freq = mp_obj_get_int(args[ARG_freq].u_obj);
     if ((freq < 5000) || (freq > 500000)) {
@@ -879,13 +1059,14 @@ STATIC mp_obj_t madc_read_timed(mp_uint_t n_args, const mp_obj_t *pos_args, mp_m
         mp_get_buffer_raise(args[ARG_data].u_obj, &src, MP_BUFFER_WRITE);
 
         mp_obj_array_t * arr = (mp_obj_array_t *)MP_OBJ_TO_PTR(args[ARG_data].u_obj);
-        if ((arr->typecode == 'h') && (arr->typecode != 'H') && (arr->typecode != 'B')) {
+        if ((arr->typecode != 'h') && (arr->typecode != 'H') && (arr->typecode != 'B')) {
             mp_raise_ValueError("array argument of type 'h', 'H' or 'B' expected");
         }
         if (arr->typecode == 'B') {
             self->val_shift = self->width + 1;
         }
         self->buffer = arr->items;
+        self->data = args[ARG_data].u_obj;
 
         if (arr->len < 1) {
             mp_raise_ValueError("array argument length must be >= 1");
@@ -897,48 +1078,390 @@ STATIC mp_obj_t madc_read_timed(mp_uint_t n_args, const mp_obj_t *pos_args, mp_m
         mp_raise_ValueError("array or file name argument expected");
     }
 
-    // configure i2s
+    adc_start_task(self, freq, adc_task);
+
+    if (wait) {
+        mp_hal_delay_ms(3);
+        while (task_running) {
+            mp_hal_delay_ms(3);
+        }
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(madc_read_timed_obj, 0, madc_read_timed);
+
+// capture(buffers, freq, *, callback=None, count=0, wait=False)
+//
+// Sample continuously into a pair of equally sized arrays, alternating
+// between them.  callback(buf) is scheduled with each buffer as it fills
+// and the buffer is not written again until the callback returns.  With
+// count > 0 capturing stops after that many buffers, otherwise it runs
+// until stopcollect().
+//--------------------------------------------------------------------------------------------
+STATIC mp_obj_t madc_capture(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buffers, ARG_freq, ARG_callback, ARG_count, ARG_wait };
+    const mp_arg_t allowed_args[] = {
+            { MP_QSTR_buffers,  MP_ARG_REQUIRED | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+            { MP_QSTR_freq,     MP_ARG_REQUIRED | MP_ARG_INT,  {.u_int = 0} },
+            { MP_QSTR_callback, MP_ARG_KW_ONLY  | MP_ARG_OBJ,  {.u_obj = mp_const_none} },
+            { MP_QSTR_count,    MP_ARG_KW_ONLY  | MP_ARG_INT,  {.u_int = 0} },
+            { MP_QSTR_wait,     MP_ARG_KW_ONLY  | MP_ARG_BOOL, {.u_bool = false}},
+    };
+
+    madc_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+
+    _is_init(self, true, true);
+
+    if (self->gpio_id == GPIO_NUM_MAX) {
+        mp_raise_ValueError("capture for hall sensor not allowed");
+    }
+    if (self->adc_num != ADC_UNIT_1) {
+        mp_raise_ValueError("capture only supported on ADC1");
+    }
+    if (i2s_driver_installed) {
+        mp_raise_ValueError("Error: i2s used by other module");
+    }
+
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args-1, pos_args+1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int freq = args[ARG_freq].u_int;
+    if ((freq < 5000) || (freq > 500000)) {
+        mp_raise_ValueError("frequency out of range (5000 - 500000 Hz)");
+    }
+    if (args[ARG_count].u_int < 0) {
+        mp_raise_ValueError("count must be >= 0");
+    }
+    mp_obj_t callback = args[ARG_callback].u_obj;
+    if ((callback != mp_const_none) && (!mp_obj_is_callable(callback))) {
+        mp_raise_ValueError("callback function expected");
+    }
+
+    mp_obj_t *bufs;
+    mp_obj_get_array_fixed_n(args[ARG_buffers].u_obj, 2, &bufs);
+    mp_obj_array_t *arr[2];
+    for (int i = 0; i < 2; i++) {
+        if (!MP_OBJ_IS_TYPE(bufs[i], &mp_type_array)) {
+            mp_raise_ValueError("array arguments expected");
+        }
+        arr[i] = (mp_obj_array_t *)MP_OBJ_TO_PTR(bufs[i]);
+        if ((arr[i]->typecode != 'h') && (arr[i]->typecode != 'H') && (arr[i]->typecode != 'B')) {
+            mp_raise_ValueError("array argument of type 'h', 'H' or 'B' expected");
+        }
+    }
+    if ((bufs[0] == bufs[1]) || (arr[0]->typecode != arr[1]->typecode) || (arr[0]->len != arr[1]->len)) {
+        mp_raise_ValueError("two distinct arrays of the same type and length expected");
+    }
+    if (arr[0]->len < 1) {
+        mp_raise_ValueError("array argument length must be >= 1");
+    }
+
+    self->callback = (callback == mp_const_none) ? NULL : callback;
+    self->buffer = NULL;
+    self->fhndl = NULL;
+    self->buf_ptr = 0;
+    self->cal_read = false;
+    self->interval = 0;
+    self->val_shift = (arr[0]->typecode == 'B') ? self->width + 1 : 0;
+    // the tuple holds both arrays, keeping them alive with the ADC object
+    self->data = args[ARG_buffers].u_obj;
+    collect_dropped = 0;
+
+    capture.buf[0] = arr[0]->items;
+    capture.buf[1] = arr[1]->items;
+    capture.buf_obj[0] = bufs[0];
+    capture.buf_obj[1] = bufs[1];
+    capture.len = arr[0]->len;
+    capture.count = args[ARG_count].u_int;
+    capture.filled = 0;
+    capture.busy = 0;
+    self->buf_len = capture.count * capture.len;
+
+    adc_start_task(self, freq, adc_capture_task);
+
+    if (args[ARG_wait].u_bool) {
+        while (task_running) {
+            MICROPY_EVENT_POLL_HOOK
+        }
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(madc_capture_obj, 0, madc_capture);
+
+// The ADC1 digital controller converts the entries of its pattern table in
+// turn, one per I2S sample, so a sweep over several channels is a single
+// DMA stream.  Each entry is channel << 4 | width << 2 | atten, four to a
+// register with the first one in the top byte.
+//-------------------------------------------------------------------------------
+STATIC void madc_scan_set_pattern(const uint8_t *chan, size_t n, adc_atten_t atten)
+{
+    uint32_t tab[4] = {0, 0, 0, 0};
+    for (size_t i = 0; i < n; i++) {
+        uint32_t patt = (chan[i] << 4) | (ADC_WIDTH_BIT_12 << 2) | atten;
+        tab[i / 4] |= patt << (24 - 8 * (i % 4));
+    }
+    SYSCON.saradc_ctrl.sar1_patt_len = n - 1;
+    for (int i = 0; i < 4; i++) {
+        SYSCON.saradc_sar1_patt_tab[i] = tab[i];
+    }
+    SYSCON.saradc_ctrl.sar1_patt_p_clear = 1;
+    SYSCON.saradc_ctrl.sar1_patt_p_clear = 0;
+}
+
+// scan(pins, buf, rate, *, atten=ATTN_11DB)
+//
+// Sweep the ADC1 pins rate times a second through the I2S DMA ADC mode,
+// filling buf, an array('H') or 'h', with raw 12-bit samples interleaved
+// in the order of pins: buf[i * len(pins) + k] is sweep i of pins[k].
+// Each sample carries its channel number, which is how the samples are
+// sorted into place whatever order the DMA delivers them in.
+//-------------------------------------------------------------------------------
+STATIC mp_obj_t madc_scan(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_pins, ARG_buf, ARG_rate, ARG_atten };
+    const mp_arg_t allowed_args[] = {
+            { MP_QSTR_pins,  MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+            { MP_QSTR_buf,   MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+            { MP_QSTR_rate,  MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+            { MP_QSTR_atten, MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = ADC_ATTEN_DB_11} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    size_t npins;
+    mp_obj_t *pins;
+    mp_obj_get_array(args[ARG_pins].u_obj, &npins, &pins);
+    if ((npins < 1) || (npins > ADC1_CHANNEL_MAX)) {
+        mp_raise_ValueError("1 to 8 ADC1 pins expected");
+    }
+    adc_atten_t atten = args[ARG_atten].u_int;
+    if ((atten < ADC_ATTEN_DB_0) || (atten > ADC_ATTEN_DB_11)) {
+        mp_raise_ValueError("invalid atten");
+    }
+
+    // slot of each channel in a sweep, or -1
+    int8_t slot[ADC1_CHANNEL_MAX];
+    uint8_t chan[ADC1_CHANNEL_MAX];
+    memset(slot, -1, sizeof(slot));
+    for (size_t i = 0; i < npins; i++) {
+        int channel = get_adc_channel(ADC_UNIT_1, machine_pin_get_gpio(pins[i]));
+        if (channel < 0) {
+            mp_raise_ValueError("invalid ADC1 pin");
+        }
+        if (slot[channel] >= 0) {
+            mp_raise_ValueError("pin given twice");
+        }
+        slot[channel] = i;
+        chan[i] = channel;
+    }
+
+    mp_buffer_info_t dest;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &dest, MP_BUFFER_WRITE);
+    if ((dest.typecode != 'h') && (dest.typecode != 'H')) {
+        mp_raise_ValueError("array argument of type 'h' or 'H' expected");
+    }
+    size_t nsweeps = dest.len / 2 / npins;
+    if (nsweeps < 1) {
+        mp_raise_ValueError("buffer too small");
+    }
+
+    int freq = args[ARG_rate].u_int * npins;
+    if ((freq < 5000) || (freq > 500000)) {
+        mp_raise_ValueError("rate * len(pins) out of range (5000 - 500000 Hz)");
+    }
+    if (i2s_driver_installed) {
+        mp_raise_ValueError("Error: i2s used by other module");
+    }
+
+    for (size_t i = 0; i < npins; i++) {
+        adc1_config_channel_atten(chan[i], atten);
+    }
+    // the next machine.ADC read has to set up the RTC controller again
+    adc_width = -1;
+    last_atten = ADC_ATTEN_MAX;
+
     i2s_config_t i2s_config = {
-        .mode = I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN, // Only RX, ADC input
-        //.mode = I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN | I2S_MODE_ADC_BUILT_IN,
+        .mode = I2S_MODE_MASTER | I2S_MODE_RX | I2S_MODE_ADC_BUILT_IN,
         .sample_rate = freq,
         .bits_per_sample = 16,
         .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
         .communication_format = I2S_COMM_FORMAT_I2S_MSB,
-        .dma_buf_count = 2,
+        .dma_buf_count = 4,
         .dma_buf_len = 1024,
         .use_apll = false,
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
         .fixed_mclk = 0
     };
-
-    // install and start i2s driver
-    i2s_driver_install(0, &i2s_config, 0, NULL);
+    uint16_t *i2s_read_buff = malloc(I2S_RD_BUF_SIZE);
+    if (i2s_read_buff == NULL) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    if (i2s_driver_install(0, &i2s_config, 0, NULL) != ESP_OK) {
+        free(i2s_read_buff);
+        mp_raise_ValueError("Error installing i2s driver");
+    }
     i2s_driver_installed = true;
-    // init ADC pad
-    i2s_set_adc_mode(self->adc_num, self->adc_chan);
+    esp_log_level_set("I2S", ESP_LOG_ERROR);
+    i2s_set_adc_mode(ADC_UNIT_1, chan[0]);
     i2s_adc_enable(0);
-    //i2s_set_sample_rates(0, freq);
+    // i2s_adc_enable() programs a one entry table for chan[0]
+    madc_scan_set_pattern(chan, npins, atten);
+
+    uint16_t *out = dest.buf;
+    uint32_t count[ADC1_CHANNEL_MAX] = {0};
+    size_t filled = 0;
+    size_t total = nsweeps * npins;
+    bool timeout = false;
+    MP_THREAD_GIL_EXIT();
+    while (filled < total) {
+        size_t bytes_read = 0;
+        i2s_read(0, (void *)i2s_read_buff, I2S_RD_BUF_SIZE, &bytes_read, 1000);
+        if (bytes_read == 0) {
+            timeout = true;
+            break;
+        }
+        for (size_t i = 0; i < bytes_read / 2; i++) {
+            uint16_t val = i2s_read_buff[i];
+            unsigned c = val >> 12;
+            if ((c >= ADC1_CHANNEL_MAX) || (slot[c] < 0) || (count[c] >= nsweeps)) {
+                continue;
+            }
+            out[count[c]++ * npins + slot[c]] = val & 0x0fff;
+            filled++;
+        }
+    }
+    MP_THREAD_GIL_ENTER();
 
-    task_stop = false;
-    esp_log_level_set("I2S", ESP_LOG_ERROR);
-    #if CONFIG_MICROPY_USE_BOTH_CORES
-    xTaskCreate(adc_task, "ADC_task", 2048, (void *)self, CONFIG_MICROPY_TASK_PRIORITY, NULL);
-    #else
-    xTaskCreatePinnedToCore(adc_task, "ADC_task", 2048, (void *)self, CONFIG_MICROPY_TASK_PRIORITY, NULL, MainTaskCore);
-    #endif
+    i2s_adc_disable(0);
+    i2s_driver_uninstall(0);
+    i2s_driver_installed = false;
+    esp_log_level_set("I2S", CONFIG_LOG_DEFAULT_LEVEL);
+    free(i2s_read_buff);
 
-    if (wait) {
-        mp_hal_delay_ms(3);
-        while (task_running) {
-            mp_hal_delay_ms(3);
+    if (timeout) {
+        mp_raise_OSError(MP_ETIMEDOUT);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(madc_scan_fun_obj, 3, madc_scan);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(madc_scan_obj, MP_ROM_PTR(&madc_scan_fun_obj));
+
+// One pass statistics over a buffer of samples, see ADC.stats()
+typedef struct _madc_stats_t {
+    int32_t min;
+    int32_t max;
+    int64_t summ;
+    uint64_t rms_summ;
+    uint32_t *hist;     // NULL or nbins counters
+    uint32_t nbins;
+    uint32_t scale;     // bin = (val * scale) >> 16
+} madc_stats_t;
+
+// The loop is unrolled by four so the compiler can keep the accumulators
+// in registers; samples are only ever widened, never divided
+#define MADC_STATS_ACC(v) do { \
+        int32_t _v = (v); \
+        uint32_t _a = (_v < 0) ? -_v : _v; \
+        if (_v < st->min) st->min = _v; \
+        if (_v > st->max) st->max = _v; \
+        summ += _v; \
+        rms_summ += _a * _a; \
+        if (st->hist) { \
+            uint32_t _b = (_v < 0) ? 0 : ((uint32_t)_v * st->scale) >> 16; \
+            st->hist[(_b < st->nbins) ? _b : st->nbins - 1]++; \
+        } \
+    } while (0)
+
+#define MADC_STATS_KERNEL(name, type) \
+STATIC void name(madc_stats_t *st, const type *p, size_t n) { \
+    int64_t summ = 0; \
+    uint64_t rms_summ = 0; \
+    size_t i = 0; \
+    for (; i + 4 <= n; i += 4) { \
+        MADC_STATS_ACC(p[i]); \
+        MADC_STATS_ACC(p[i + 1]); \
+        MADC_STATS_ACC(p[i + 2]); \
+        MADC_STATS_ACC(p[i + 3]); \
+    } \
+    for (; i < n; i++) { \
+        MADC_STATS_ACC(p[i]); \
+    } \
+    st->summ = summ; \
+    st->rms_summ = rms_summ; \
+}
+
+MADC_STATS_KERNEL(madc_stats_u8, uint8_t)
+MADC_STATS_KERNEL(madc_stats_u16, uint16_t)
+MADC_STATS_KERNEL(madc_stats_s16, int16_t)
+
+// stats(buf, hist=None, *, top=<full scale>)
+//
+// Return (min, max, mean, rms) of the samples in an array('H'), 'h' or 'B'.
+// If hist is given it must be an array('I') or 'L'; its length sets the
+// number of bins, evenly spread over 0..top, and the counts are added to it.
+// By default top is 4096 (12 bit) or 256 for 'B' arrays.
+//----------------------------------------------------------------------------------
+STATIC mp_obj_t madc_stats(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_hist, ARG_top };
+    const mp_arg_t allowed_args[] = {
+            { MP_QSTR_buf,  MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+            { MP_QSTR_hist, MP_ARG_OBJ,                   {.u_obj = mp_const_none} },
+            { MP_QSTR_top,  MP_ARG_KW_ONLY  | MP_ARG_INT, {.u_int = 0} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t src;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &src, MP_BUFFER_READ);
+    if ((src.typecode != 'h') && (src.typecode != 'H') && (src.typecode != 'B')) {
+        mp_raise_ValueError("array argument of type 'h', 'H' or 'B' expected");
+    }
+    size_t n = (src.typecode == 'B') ? src.len : src.len / 2;
+    if (n < 1) {
+        mp_raise_ValueError("no data");
+    }
+
+    madc_stats_t st = { .min = INT32_MAX, .max = INT32_MIN };
+    if (args[ARG_hist].u_obj != mp_const_none) {
+        mp_buffer_info_t hist;
+        mp_get_buffer_raise(args[ARG_hist].u_obj, &hist, MP_BUFFER_WRITE);
+        if (((hist.typecode != 'I') && (hist.typecode != 'L')) || (mp_binary_get_size('@', hist.typecode, NULL) != 4)) {
+            mp_raise_ValueError("hist must be array of type 'I' or 'L'");
         }
+        mp_int_t top = args[ARG_top].u_int;
+        if (top == 0) top = (src.typecode == 'B') ? 256 : 4096;
+        if ((top < 1) || (top > 65536)) {
+            mp_raise_ValueError("top out of range (1 - 65536)");
+        }
+        st.nbins = hist.len / 4;
+        if (st.nbins < 1) {
+            mp_raise_ValueError("hist length must be >= 1");
+        }
+        if (st.nbins > top) {
+            mp_raise_ValueError("more bins than top");
+        }
+        st.hist = hist.buf;
+        // values >= top are counted in the last bin
+        st.scale = (uint32_t)((((uint64_t)st.nbins << 16) + top - 1) / top);
     }
 
-    return mp_const_none;
+    if (src.typecode == 'B') madc_stats_u8(&st, src.buf, n);
+    else if (src.typecode == 'H') madc_stats_u16(&st, src.buf, n);
+    else madc_stats_s16(&st, src.buf, n);
+
+    mp_obj_t tuple[4];
+    tuple[0] = mp_obj_new_int(st.min);
+    tuple[1] = mp_obj_new_int(st.max);
+    tuple[2] = mp_obj_new_float((mp_float_t)st.summ / n);
+    tuple[3] = mp_obj_new_float(MICROPY_FLOAT_C_FUN(sqrt)((mp_float_t)st.rms_summ / n));
+
+    return mp_obj_new_tuple(4, tuple);
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_KW(madc_read_timed_obj, 0, madc_read_timed);
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(madc_stats_fun_obj, 1, madc_stats);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(madc_stats_obj, MP_ROM_PTR(&madc_stats_fun_obj));
 
+#if 0
 //----------------------------------------------------
 STATIC mp_obj_t madc_get_collected(mp_obj_t self_in) {
     madc_obj_t *self = self_in;
@@ -962,6 +1485,7 @@ STATIC mp_obj_t madc_get_collected(mp_obj_t self_in) {
     return mp_obj_new_tuple(4, tuple);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(madc_get_collected_obj, madc_get_collected);
+#endif
 
 //-----------------------------------------------
 STATIC mp_obj_t madc_progress(mp_obj_t self_in) {
@@ -969,14 +1493,15 @@ STATIC mp_obj_t madc_progress(mp_obj_t self_in) {
     _is_init(self, true, false);
 
     bool active = collect_active | task_running;
-    mp_obj_t tuple[4];
+    mp_obj_t tuple[5];
     tuple[0] = mp_obj_new_bool(active);
     tuple[1] = mp_obj_new_int(self->buf_ptr);
     tuple[2] = mp_obj_new_int(self->buf_len);
     if (active) tuple[3] = mp_obj_new_int_from_ull(esp_timer_get_time() /*mp_hal_ticks_us()*/ - collect_start_time);
     else tuple[3] = mp_obj_new_int_from_ull(collect_end_time - collect_start_time);
+    tuple[4] = mp_obj_new_int(collect_dropped);
 
-    return mp_obj_new_tuple(4, tuple);
+    return mp_obj_new_tuple(5, tuple);
 }
 MP_DEFINE_CONST_FUN_OBJ_1(madc_progress_obj, madc_progress);
 
@@ -1007,17 +1532,33 @@ STATIC mp_obj_t madc_stop_collect(mp_obj_t self_in) {
     return mp_const_none;
 }
 MP_DEFINE_CONST_FUN_OBJ_1(madc_stop_collect_obj, madc_stop_collect);
-#endif
+
+// Stop a running timed read, called on soft reset before the heap goes
+//-----------------------
+void machine_adc_deinit(void)
+{
+    if (task_running) {
+        task_stop = true;
+        while (task_running) {
+            vTaskDelay(2);
+        }
+    }
+    capture.busy = 0;
+    MP_STATE_PORT(machine_adc_collect) = NULL;
+}
 
 //=========================================================
 STATIC const mp_rom_map_elem_t madc_locals_dict_table[] = {
         { MP_ROM_QSTR(MP_QSTR_read),		MP_ROM_PTR(&madc_read_obj) },
         { MP_ROM_QSTR(MP_QSTR_readraw),		MP_ROM_PTR(&madc_readraw_obj) },
-//        { MP_ROM_QSTR(MP_QSTR_read_timed),  MP_ROM_PTR(&madc_read_timed_obj) },
+        { MP_ROM_QSTR(MP_QSTR_read_timed),  MP_ROM_PTR(&madc_read_timed_obj) },
+        { MP_ROM_QSTR(MP_QSTR_capture),     MP_ROM_PTR(&madc_capture_obj) },
+        { MP_ROM_QSTR(MP_QSTR_scan),        MP_ROM_PTR(&madc_scan_obj) },
 //        { MP_ROM_QSTR(MP_QSTR_collect),		MP_ROM_PTR(&madc_collect_obj) },
 //        { MP_ROM_QSTR(MP_QSTR_collected),	MP_ROM_PTR(&madc_get_collected_obj) },
-//        { MP_ROM_QSTR(MP_QSTR_stopcollect), MP_ROM_PTR(&madc_stop_collect_obj) },
-//        { MP_ROM_QSTR(MP_QSTR_progress),	MP_ROM_PTR(&madc_progress_obj) },
+        { MP_ROM_QSTR(MP_QSTR_stopcollect), MP_ROM_PTR(&madc_stop_collect_obj) },
+        { MP_ROM_QSTR(MP_QSTR_progress),	MP_ROM_PTR(&madc_progress_obj) },
+        { MP_ROM_QSTR(MP_QSTR_stats),		MP_ROM_PTR(&madc_stats_obj) },
         { MP_ROM_QSTR(MP_QSTR_atten),		MP_ROM_PTR(&madc_atten_obj) },
         { MP_ROM_QSTR(MP_QSTR_width),		MP_ROM_PTR(&madc_width_obj) },
         { MP_ROM_QSTR(MP_QSTR_vref),		MP_ROM_PTR(&madc_vref_togpio_obj) },
@@ -26,16 +26,31 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_task.h"
 
 #include "driver/gpio.h"
 #include "driver/dac.h"
+#include "driver/i2s.h"
+#include "soc/rtc.h"
+#include "soc/sens_reg.h"
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/mperrno.h"
 #include "modmachine.h"
 
+// Timed writes go through I2S0 in built-in DAC mode: the 8-bit samples are
+// in the high byte of 16-bit stereo frames, which DMA feeds to the DAC.
+#define MDAC_DMA_BUF_COUNT  (4)
+#define MDAC_DMA_BUF_LEN    (256)   // frames
+#define MDAC_RATE_MIN       (1000)
+#define MDAC_RATE_MAX       (100000)
+
 typedef struct _mdac_obj_t {
     mp_obj_base_t base;
     gpio_num_t gpio_id;
@@ -47,6 +62,70 @@ STATIC const mdac_obj_t mdac_obj[] = {
     {{&machine_dac_type}, GPIO_NUM_26, DAC_CHANNEL_2},
 };
 
+typedef struct _mdac_play_t {
+    uint8_t *data;              // a copy of the samples, in the IDF heap
+    size_t len;
+    uint32_t rate;
+    dac_channel_t dac_id;
+    bool loop;
+    volatile bool stop;
+    volatile bool running;
+} mdac_play_t;
+
+STATIC mdac_play_t mdac_play;
+
+STATIC void mdac_play_task(void *arg) {
+    uint16_t frames[2 * MDAC_DMA_BUF_LEN];
+    do {
+        for (size_t i = 0; i < mdac_play.len && !mdac_play.stop;) {
+            size_t n = MIN(mdac_play.len - i, MDAC_DMA_BUF_LEN);
+            for (size_t k = 0; k < n; k++) {
+                frames[2 * k] = frames[2 * k + 1] = mdac_play.data[i + k] << 8;
+            }
+            size_t written;
+            i2s_write(I2S_NUM_0, frames, n * 2 * sizeof(uint16_t), &written, portMAX_DELAY);
+            i += n;
+        }
+    } while (mdac_play.loop && !mdac_play.stop);
+
+    if (!mdac_play.stop) {
+        // let the DMA buffers already queued play out
+        uint32_t ms = MDAC_DMA_BUF_COUNT * MDAC_DMA_BUF_LEN * 1000 / mdac_play.rate + 1;
+        vTaskDelay(ms / portTICK_PERIOD_MS + 1);
+    }
+    i2s_set_dac_mode(I2S_DAC_CHANNEL_DISABLE);
+    i2s_driver_uninstall(I2S_NUM_0);
+    i2s_driver_installed = false;
+    // give the pad back to write()
+    dac_output_enable(mdac_play.dac_id);
+
+    free(mdac_play.data);
+    mdac_play.data = NULL;
+    mdac_play.running = false;
+    vTaskDelete(NULL);
+}
+
+STATIC void mdac_play_stop(void) {
+    if (mdac_play.running) {
+        mdac_play.stop = true;
+        while (mdac_play.running) {
+            MP_THREAD_GIL_EXIT();
+            vTaskDelay(1);
+            MP_THREAD_GIL_ENTER();
+        }
+    }
+}
+
+void machine_dac_deinit(void) {
+    mdac_play_stop();
+    CLEAR_PERI_REG_MASK(SENS_SAR_DAC_CTRL1_REG, SENS_SW_TONE_EN);
+    CLEAR_PERI_REG_MASK(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_CW_EN1_M | SENS_DAC_CW_EN2_M);
+}
+
+STATIC void mdac_cosine_disable(dac_channel_t dac_id) {
+    CLEAR_PERI_REG_MASK(SENS_SAR_DAC_CTRL2_REG, dac_id == DAC_CHANNEL_1 ? SENS_DAC_CW_EN1_M : SENS_DAC_CW_EN2_M);
+}
+
 STATIC mp_obj_t mdac_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw,
         const mp_obj_t *args) {
 
@@ -76,14 +155,168 @@ STATIC mp_obj_t mdac_write(mp_obj_t self_in, mp_obj_t value_in) {
     int value = mp_obj_get_int(value_in);
     if (value < 0 || value > 255) mp_raise_ValueError("Value out of range");
 
+    if (mdac_play.running && mdac_play.dac_id == self->dac_id) {
+        mdac_play_stop();
+    }
+    mdac_cosine_disable(self->dac_id);
     esp_err_t err = dac_output_voltage(self->dac_id, value);
     if (err == ESP_OK) return mp_const_none;
     mp_raise_ValueError("Parameter Error");
 }
 MP_DEFINE_CONST_FUN_OBJ_2(mdac_write_obj, mdac_write);
 
+// dac.write_timed(buf, rate, *, loop=False)
+// Start playing the 8-bit samples in buf at rate samples per second through
+// DMA and return.  With loop the samples are repeated until stop() or the
+// next write.  Only one DAC can play at a time, and not while the ADC is
+// collecting through I2S.
+STATIC mp_obj_t mdac_write_timed(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_rate, ARG_loop };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_rate, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    const mdac_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_READ);
+    mp_int_t rate = args[ARG_rate].u_int;
+    if (rate < MDAC_RATE_MIN || rate > MDAC_RATE_MAX) {
+        mp_raise_ValueError("rate out of range");
+    }
+    mdac_play_stop();
+    if (bufinfo.len == 0) {
+        return mp_const_none;
+    }
+    if (i2s_driver_installed) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+
+    // the task outlives the Python buffer, so it plays from a copy
+    uint8_t *data = malloc(bufinfo.len);
+    if (data == NULL) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    memcpy(data, bufinfo.buf, bufinfo.len);
+
+    i2s_config_t i2s_config = {
+        .mode = I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_DAC_BUILT_IN,
+        .sample_rate = rate,
+        .bits_per_sample = 16,
+        .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
+        .communication_format = I2S_COMM_FORMAT_I2S_MSB,
+        .dma_buf_count = MDAC_DMA_BUF_COUNT,
+        .dma_buf_len = MDAC_DMA_BUF_LEN,
+        .use_apll = false,
+        .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
+        .fixed_mclk = 0
+    };
+    if (i2s_driver_install(I2S_NUM_0, &i2s_config, 0, NULL) != ESP_OK) {
+        free(data);
+        mp_raise_ValueError("Error installing i2s driver");
+    }
+    i2s_driver_installed = true;
+    mdac_cosine_disable(self->dac_id);
+    // DAC1 (GPIO25) is the right channel
+    i2s_set_dac_mode(self->dac_id == DAC_CHANNEL_1 ? I2S_DAC_CHANNEL_RIGHT_EN : I2S_DAC_CHANNEL_LEFT_EN);
+
+    mdac_play.data = data;
+    mdac_play.len = bufinfo.len;
+    mdac_play.rate = rate;
+    mdac_play.dac_id = self->dac_id;
+    mdac_play.loop = args[ARG_loop].u_bool;
+    mdac_play.stop = false;
+    mdac_play.running = true;
+    // above the MicroPython task so the DMA buffers are refilled in time
+    if (xTaskCreate(mdac_play_task, "DAC_task", 1536 + sizeof(uint16_t) * 2 * MDAC_DMA_BUF_LEN, NULL, ESP_TASK_PRIO_MIN + 2, NULL) != pdPASS) {
+        mdac_play.running = false;
+        mdac_play.data = NULL;
+        free(data);
+        i2s_set_dac_mode(I2S_DAC_CHANNEL_DISABLE);
+        i2s_driver_uninstall(I2S_NUM_0);
+        i2s_driver_installed = false;
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mdac_write_timed_obj, 3, mdac_write_timed);
+
+// dac.playing()
+STATIC mp_obj_t mdac_playing(mp_obj_t self_in) {
+    const mdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool(mdac_play.running && mdac_play.dac_id == self->dac_id);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mdac_playing_obj, mdac_playing);
+
+// dac.stop()
+// Stop a timed write or the cosine generator on this DAC.
+STATIC mp_obj_t mdac_stop(mp_obj_t self_in) {
+    const mdac_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (mdac_play.running && mdac_play.dac_id == self->dac_id) {
+        mdac_play_stop();
+    }
+    mdac_cosine_disable(self->dac_id);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mdac_stop_obj, mdac_stop);
+
+// dac.cosine(freq, *, scale=0, offset=0)
+// Output a cosine wave from the DAC's built-in generator, which needs no CPU
+// or DMA.  The frequency step is shared by both DACs and is 1/65536 of the
+// RTC 8MHz clock, about 130Hz.  The amplitude is full scale shifted right by
+// scale (0-3) and offset (-128 to 127) moves the wave up or down.
+STATIC mp_obj_t mdac_cosine(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_freq, ARG_scale, ARG_offset };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_freq, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_scale, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_offset, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+    };
+    const mdac_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_int_t scale = args[ARG_scale].u_int;
+    mp_int_t offset = args[ARG_offset].u_int;
+    if (scale < 0 || scale > 3 || offset < -128 || offset > 127) {
+        mp_raise_ValueError(NULL);
+    }
+    uint64_t step = ((uint64_t)args[ARG_freq].u_int * 65536 + RTC_FAST_CLK_FREQ_APPROX / 2) / RTC_FAST_CLK_FREQ_APPROX;
+    if (step < 1 || step > SENS_SW_FSTEP_V) {
+        mp_raise_ValueError("freq out of range");
+    }
+    if (mdac_play.running && mdac_play.dac_id == self->dac_id) {
+        mdac_play_stop();
+    }
+
+    SET_PERI_REG_BITS(SENS_SAR_DAC_CTRL1_REG, SENS_SW_FSTEP, step, SENS_SW_FSTEP_S);
+    SET_PERI_REG_MASK(SENS_SAR_DAC_CTRL1_REG, SENS_SW_TONE_EN);
+    if (self->dac_id == DAC_CHANNEL_1) {
+        SET_PERI_REG_BITS(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_SCALE1, scale, SENS_DAC_SCALE1_S);
+        SET_PERI_REG_BITS(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_DC1, offset & 0xff, SENS_DAC_DC1_S);
+        // invert the MSB, so the wave is centred on the middle of the range
+        SET_PERI_REG_BITS(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_INV1, 2, SENS_DAC_INV1_S);
+        SET_PERI_REG_MASK(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_CW_EN1_M);
+    } else {
+        SET_PERI_REG_BITS(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_SCALE2, scale, SENS_DAC_SCALE2_S);
+        SET_PERI_REG_BITS(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_DC2, offset & 0xff, SENS_DAC_DC2_S);
+        SET_PERI_REG_BITS(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_INV2, 2, SENS_DAC_INV2_S);
+        SET_PERI_REG_MASK(SENS_SAR_DAC_CTRL2_REG, SENS_DAC_CW_EN2_M);
+    }
+    dac_output_enable(self->dac_id);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mdac_cosine_obj, 2, mdac_cosine);
+
 STATIC const mp_rom_map_elem_t mdac_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mdac_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_timed), MP_ROM_PTR(&mdac_write_timed_obj) },
+    { MP_ROM_QSTR(MP_QSTR_playing), MP_ROM_PTR(&mdac_playing_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&mdac_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_cosine), MP_ROM_PTR(&mdac_cosine_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mdac_locals_dict, mdac_locals_dict_table);
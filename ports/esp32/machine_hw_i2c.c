@@ -0,0 +1,390 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "py/mperrno.h"
+#include "extmod/machine_i2c.h"
+#include "modmachine.h"
+
+#include "driver/i2c.h"
+
+// Hardware I2C, selected with an id: I2C(0, ...) or I2C(1, ...).  Each
+// transaction, including the register address phase of the *_mem methods,
+// is built as one command list and run by the driver's interrupt handler
+// while the GIL is released.  The controller may also be claimed from C
+// (the IMU sampler shares port 0 with pystubit), so the driver stays
+// installed while either side uses it.
+
+#define I2C_DEFAULT_FREQ        (400000)
+#define I2C_MAX_FREQ            (1000000)
+#define I2C_DEFAULT_SCL         (22)
+#define I2C_DEFAULT_SDA         (21)
+#define I2C_APB_CLK_MHZ         (80)
+#define I2C_MAX_TIMEOUT_US      (0xfffff / I2C_APB_CLK_MHZ) // SCL low limit of the controller
+#define I2C_CMD_TIMEOUT_MS(len) (100 * (1 + (len) / 16))    // guard against a stuck bus
+
+#define I2C_USER_PY             (0x01)  // a machine.I2C object
+#define I2C_USER_C              (0x02)  // machine_hw_i2c_claim()
+
+typedef struct _machine_hw_i2c_obj_t {
+    mp_obj_base_t base;
+    i2c_port_t port;
+    int8_t scl;
+    int8_t sda;
+    uint8_t users;
+    uint32_t freq;
+    uint32_t timeout_us;
+} machine_hw_i2c_obj_t;
+
+STATIC machine_hw_i2c_obj_t machine_hw_i2c_obj[I2C_NUM_MAX];
+
+STATIC esp_err_t machine_hw_i2c_install(machine_hw_i2c_obj_t *self, int scl, int sda, uint32_t freq, uint32_t timeout_us) {
+    if (self->users != 0) {
+        i2c_driver_delete(self->port);
+    }
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = sda,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_io_num = scl,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = freq,
+    };
+    esp_err_t err = i2c_param_config(self->port, &conf);
+    if (err == ESP_OK) {
+        err = i2c_driver_install(self->port, I2C_MODE_MASTER, 0, 0, 0);
+    }
+    if (err == ESP_OK) {
+        // how long a slave may stretch the clock
+        i2c_set_timeout(self->port, timeout_us * I2C_APB_CLK_MHZ);
+    }
+    if (err != ESP_OK) {
+        self->users = 0;
+        return err;
+    }
+    self->scl = scl;
+    self->sda = sda;
+    self->freq = freq;
+    self->timeout_us = timeout_us;
+    return ESP_OK;
+}
+
+STATIC void machine_hw_i2c_release_internal(machine_hw_i2c_obj_t *self, uint8_t user) {
+    if (!(self->users & user)) {
+        return;
+    }
+    self->users &= ~user;
+    if (self->users == 0) {
+        i2c_driver_delete(self->port);
+        // leave the pins idle high, ready for a software I2C
+        mp_hal_pin_open_drain(self->scl);
+        mp_hal_pin_od_high(self->scl);
+        mp_hal_pin_open_drain(self->sda);
+        mp_hal_pin_od_high(self->sda);
+    }
+}
+
+esp_err_t machine_hw_i2c_claim(int port, int scl, int sda, uint32_t freq) {
+    machine_hw_i2c_obj_t *self = &machine_hw_i2c_obj[port];
+    self->port = port;
+    if (self->users == 0) {
+        esp_err_t err = machine_hw_i2c_install(self, scl, sda, freq, I2C_MAX_TIMEOUT_US);
+        if (err != ESP_OK) {
+            return err;
+        }
+    } else if (self->scl != scl || self->sda != sda) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    self->users |= I2C_USER_C;
+    return ESP_OK;
+}
+
+void machine_hw_i2c_release(int port) {
+    machine_hw_i2c_release_internal(&machine_hw_i2c_obj[port], I2C_USER_C);
+}
+
+void machine_hw_i2c_deinit_all(void) {
+    for (int i = 0; i < I2C_NUM_MAX; i++) {
+        machine_hw_i2c_release_internal(&machine_hw_i2c_obj[i], I2C_USER_PY);
+    }
+}
+
+// Run a command list, releasing the GIL while the controller works
+STATIC int machine_hw_i2c_run(machine_hw_i2c_obj_t *self, i2c_cmd_handle_t cmd, size_t len) {
+    esp_err_t err;
+    MP_HAL_BLOCKING_BEGIN(MP_OBJ_NULL);
+    err = i2c_master_cmd_begin(self->port, cmd, I2C_CMD_TIMEOUT_MS(len) / portTICK_PERIOD_MS);
+    MP_HAL_BLOCKING_END();
+    i2c_cmd_link_delete(cmd);
+    if (err == ESP_OK) {
+        return 0;
+    } else if (err == ESP_FAIL) {
+        // no ACK
+        return -MP_ENODEV;
+    } else if (err == ESP_ERR_TIMEOUT) {
+        return -MP_ETIMEDOUT;
+    } else {
+        return -MP_EIO;
+    }
+}
+
+STATIC void machine_hw_i2c_check(machine_hw_i2c_obj_t *self) {
+    if (!(self->users & I2C_USER_PY)) {
+        mp_raise_msg(&mp_type_OSError, "I2C bus not initialised");
+    }
+}
+
+STATIC int machine_hw_i2c_readfrom(mp_obj_base_t *self_in, uint16_t addr, uint8_t *dest, size_t len, bool stop) {
+    machine_hw_i2c_obj_t *self = (machine_hw_i2c_obj_t *)self_in;
+    machine_hw_i2c_check(self);
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr << 1 | I2C_MASTER_READ, true);
+    if (len > 0) {
+        i2c_master_read(cmd, dest, len, I2C_MASTER_LAST_NACK);
+    }
+    if (stop) {
+        i2c_master_stop(cmd);
+    }
+    int ret = machine_hw_i2c_run(self, cmd, len);
+    return ret < 0 ? ret : len;
+}
+
+STATIC int machine_hw_i2c_writeto(mp_obj_base_t *self_in, uint16_t addr, const uint8_t *src, size_t len, bool stop) {
+    machine_hw_i2c_obj_t *self = (machine_hw_i2c_obj_t *)self_in;
+    machine_hw_i2c_check(self);
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr << 1 | I2C_MASTER_WRITE, true);
+    if (len > 0) {
+        i2c_master_write(cmd, (uint8_t *)src, len, true);
+    }
+    if (stop) {
+        i2c_master_stop(cmd);
+    }
+    int ret = machine_hw_i2c_run(self, cmd, len);
+    // every byte was ACKed, or the driver would have failed
+    return ret < 0 ? ret : len;
+}
+
+// Register access as a single transaction: the address phase and the data
+// phase (after a repeated start when reading) share one command list
+STATIC int machine_hw_i2c_mem(machine_hw_i2c_obj_t *self, uint16_t addr, uint32_t memaddr, uint8_t addrsize, uint8_t *buf, size_t len, bool read) {
+    machine_hw_i2c_check(self);
+    if (addrsize == 0 || addrsize > 32 || (addrsize & 7) != 0) {
+        mp_raise_ValueError("invalid addrsize");
+    }
+    uint8_t memaddr_buf[4];
+    size_t memaddr_len = 0;
+    for (int16_t i = addrsize - 8; i >= 0; i -= 8) {
+        memaddr_buf[memaddr_len++] = memaddr >> i;
+    }
+
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr << 1 | I2C_MASTER_WRITE, true);
+    i2c_master_write(cmd, memaddr_buf, memaddr_len, true);
+    if (read) {
+        i2c_master_start(cmd);
+        i2c_master_write_byte(cmd, addr << 1 | I2C_MASTER_READ, true);
+        if (len > 0) {
+            i2c_master_read(cmd, buf, len, I2C_MASTER_LAST_NACK);
+        }
+    } else if (len > 0) {
+        i2c_master_write(cmd, buf, len, true);
+    }
+    i2c_master_stop(cmd);
+    return machine_hw_i2c_run(self, cmd, memaddr_len + len);
+}
+
+/******************************************************************************/
+// MicroPython bindings for hardware I2C
+
+STATIC void machine_hw_i2c_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    machine_hw_i2c_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "I2C(%u, scl=%d, sda=%d, freq=%u, timeout=%u)",
+        self->port, self->scl, self->sda, self->freq, self->timeout_us);
+}
+
+STATIC void machine_hw_i2c_init_helper(machine_hw_i2c_obj_t *self, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_scl, ARG_sda, ARG_freq, ARG_timeout };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_scl, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_sda, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_freq, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = I2C_DEFAULT_FREQ} },
+        { MP_QSTR_timeout, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = I2C_MAX_TIMEOUT_US} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int scl = (args[ARG_scl].u_obj == MP_OBJ_NULL) ? I2C_DEFAULT_SCL : machine_pin_get_gpio(args[ARG_scl].u_obj);
+    int sda = (args[ARG_sda].u_obj == MP_OBJ_NULL) ? I2C_DEFAULT_SDA : machine_pin_get_gpio(args[ARG_sda].u_obj);
+    mp_int_t freq = args[ARG_freq].u_int;
+    mp_int_t timeout_us = args[ARG_timeout].u_int;
+    if (freq <= 0 || freq > I2C_MAX_FREQ) {
+        mp_raise_ValueError("freq must be 1-1000000");
+    }
+    if (timeout_us <= 0 || timeout_us > I2C_MAX_TIMEOUT_US) {
+        mp_raise_ValueError("timeout out of range");
+    }
+
+    if (self->users != 0 && self->scl == scl && self->sda == sda
+        && self->freq == freq && self->timeout_us == timeout_us) {
+        // already set up like this, perhaps by the C side
+        self->users |= I2C_USER_PY;
+        return;
+    }
+    if (self->users & I2C_USER_C) {
+        mp_raise_msg(&mp_type_OSError, "I2C bus in use");
+    }
+    if (machine_hw_i2c_install(self, scl, sda, freq, timeout_us) != ESP_OK) {
+        mp_raise_OSError(MP_EIO);
+    }
+    self->users |= I2C_USER_PY;
+}
+
+mp_obj_t machine_hw_i2c_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, true);
+    mp_int_t port = mp_obj_get_int(all_args[0]);
+    if (port < 0 || port >= I2C_NUM_MAX) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "I2C(%d) does not exist", port));
+    }
+
+    machine_hw_i2c_obj_t *self = &machine_hw_i2c_obj[port];
+    self->base.type = &machine_hw_i2c_type;
+    self->port = port;
+    mp_map_t kw_args;
+    mp_map_init_fixed_table(&kw_args, n_kw, all_args + n_args);
+    machine_hw_i2c_init_helper(self, n_args - 1, all_args + 1, &kw_args);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t machine_hw_i2c_init(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    machine_hw_i2c_init_helper(MP_OBJ_TO_PTR(args[0]), n_args - 1, args + 1, kw_args);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_hw_i2c_init_obj, 1, machine_hw_i2c_init);
+
+STATIC mp_obj_t machine_hw_i2c_deinit(mp_obj_t self_in) {
+    machine_hw_i2c_release_internal(MP_OBJ_TO_PTR(self_in), I2C_USER_PY);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hw_i2c_deinit_obj, machine_hw_i2c_deinit);
+
+STATIC const mp_arg_t machine_hw_i2c_mem_allowed_args[] = {
+    { MP_QSTR_addr,    MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_memaddr, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+    { MP_QSTR_arg,     MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    { MP_QSTR_addrsize, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8} },
+};
+
+// readfrom_mem(addr, memaddr, nbytes, *, addrsize=8)
+STATIC mp_obj_t machine_hw_i2c_readfrom_mem(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_addr, ARG_memaddr, ARG_n, ARG_addrsize };
+    mp_arg_val_t args[MP_ARRAY_SIZE(machine_hw_i2c_mem_allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+        MP_ARRAY_SIZE(machine_hw_i2c_mem_allowed_args), machine_hw_i2c_mem_allowed_args, args);
+
+    vstr_t vstr;
+    vstr_init_len(&vstr, mp_obj_get_int(args[ARG_n].u_obj));
+    int ret = machine_hw_i2c_mem(MP_OBJ_TO_PTR(pos_args[0]), args[ARG_addr].u_int, args[ARG_memaddr].u_int,
+        args[ARG_addrsize].u_int, (uint8_t *)vstr.buf, vstr.len, true);
+    if (ret < 0) {
+        mp_raise_OSError(-ret);
+    }
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_hw_i2c_readfrom_mem_obj, 1, machine_hw_i2c_readfrom_mem);
+
+// readfrom_mem_into(addr, memaddr, buf, *, addrsize=8)
+STATIC mp_obj_t machine_hw_i2c_readfrom_mem_into(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_addr, ARG_memaddr, ARG_buf, ARG_addrsize };
+    mp_arg_val_t args[MP_ARRAY_SIZE(machine_hw_i2c_mem_allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+        MP_ARRAY_SIZE(machine_hw_i2c_mem_allowed_args), machine_hw_i2c_mem_allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_WRITE);
+    int ret = machine_hw_i2c_mem(MP_OBJ_TO_PTR(pos_args[0]), args[ARG_addr].u_int, args[ARG_memaddr].u_int,
+        args[ARG_addrsize].u_int, bufinfo.buf, bufinfo.len, true);
+    if (ret < 0) {
+        mp_raise_OSError(-ret);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_hw_i2c_readfrom_mem_into_obj, 1, machine_hw_i2c_readfrom_mem_into);
+
+// writeto_mem(addr, memaddr, buf, *, addrsize=8)
+STATIC mp_obj_t machine_hw_i2c_writeto_mem(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_addr, ARG_memaddr, ARG_buf, ARG_addrsize };
+    mp_arg_val_t args[MP_ARRAY_SIZE(machine_hw_i2c_mem_allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args,
+        MP_ARRAY_SIZE(machine_hw_i2c_mem_allowed_args), machine_hw_i2c_mem_allowed_args, args);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[ARG_buf].u_obj, &bufinfo, MP_BUFFER_READ);
+    int ret = machine_hw_i2c_mem(MP_OBJ_TO_PTR(pos_args[0]), args[ARG_addr].u_int, args[ARG_memaddr].u_int,
+        args[ARG_addrsize].u_int, bufinfo.buf, bufinfo.len, false);
+    if (ret < 0) {
+        mp_raise_OSError(-ret);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_hw_i2c_writeto_mem_obj, 1, machine_hw_i2c_writeto_mem);
+
+STATIC const mp_rom_map_elem_t machine_hw_i2c_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_hw_i2c_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_hw_i2c_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scan), MP_ROM_PTR(&machine_i2c_scan_obj) },
+
+    // standard bus operations
+    { MP_ROM_QSTR(MP_QSTR_readfrom), MP_ROM_PTR(&machine_i2c_readfrom_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readfrom_into), MP_ROM_PTR(&machine_i2c_readfrom_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writeto), MP_ROM_PTR(&machine_i2c_writeto_obj) },
+
+    // memory operations
+    { MP_ROM_QSTR(MP_QSTR_readfrom_mem), MP_ROM_PTR(&machine_hw_i2c_readfrom_mem_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readfrom_mem_into), MP_ROM_PTR(&machine_hw_i2c_readfrom_mem_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writeto_mem), MP_ROM_PTR(&machine_hw_i2c_writeto_mem_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_hw_i2c_locals_dict, machine_hw_i2c_locals_dict_table);
+
+STATIC const mp_machine_i2c_p_t machine_hw_i2c_p = {
+    .readfrom = machine_hw_i2c_readfrom,
+    .writeto = machine_hw_i2c_writeto,
+};
+
+const mp_obj_type_t machine_hw_i2c_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_I2C,
+    .print = machine_hw_i2c_print,
+    .make_new = machine_hw_i2c_make_new,
+    .protocol = &machine_hw_i2c_p,
+    .locals_dict = (mp_obj_dict_t *)&machine_hw_i2c_locals_dict,
+};
@@ -31,14 +31,26 @@
 #include "py/runtime.h"
 #include "py/stream.h"
 #include "py/mphal.h"
+#include "py/mperrno.h"
 #include "extmod/machine_spi.h"
 #include "modmachine.h"
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_task.h"
+#include "esp_heap_caps.h"
 #include "driver/spi_master.h"
 
 #define MP_HW_SPI_MAX_XFER_BYTES (4092)
 #define MP_HW_SPI_MAX_XFER_BITS (MP_HW_SPI_MAX_XFER_BYTES * 8) // Has to be an even multiple of 8
 
+// Asynchronous writes: jobs queued from Python and the slot that stops the task
+#define MP_HW_SPI_ASYNC_JOBS        (8)
+#define MP_HW_SPI_ASYNC_STOP        (0xff)
+#define MP_HW_SPI_ASYNC_TASK_STACK  (2048)
+#define MP_HW_SPI_ASYNC_TASK_PRIO   (ESP_TASK_PRIO_MIN + 2)
+
 typedef struct _machine_hw_spi_obj_t {
     mp_obj_base_t base;
     spi_host_device_t host;
@@ -56,11 +68,37 @@ typedef struct _machine_hw_spi_obj_t {
         MACHINE_HW_SPI_STATE_INIT,
         MACHINE_HW_SPI_STATE_DEINIT
     } state;
+    bool busy; // a transfer is running with the GIL released
+    struct _machine_hw_spi_async_t *async;
 } machine_hw_spi_obj_t;
 
+// State of write_async()/queue(), allocated on first use and reachable
+// from a root pointer so that the queued buffers stay alive.  The heap may
+// be in SPIRAM, which the SPI DMA cannot read, so a task copies each job
+// through two DMA capable bounce buffers, filling one while the other is
+// on the wire.
+typedef struct _machine_hw_spi_async_t {
+    machine_hw_spi_obj_t *spi;
+    TaskHandle_t task;
+    QueueHandle_t full_q;           // slots of queued jobs, in order
+    QueueHandle_t free_q;           // slots free for new jobs
+    uint8_t *bounce[2];
+    spi_transaction_t trans[2];
+    volatile uint32_t pending;      // jobs queued and not yet on the wire
+    struct {
+        mp_obj_t buf_obj;
+        const uint8_t *buf;
+        size_t len;
+        mp_obj_t callback;
+    } job[MP_HW_SPI_ASYNC_JOBS];
+} machine_hw_spi_async_t;
+
 // Static objects mapping to HSPI and VSPI hardware peripherals
 STATIC machine_hw_spi_obj_t machine_hw_spi_obj[2];
 
+STATIC void machine_hw_spi_async_stop(machine_hw_spi_obj_t *self);
+STATIC void machine_hw_spi_async_wait(machine_hw_spi_obj_t *self);
+
 STATIC void machine_hw_spi_deinit_internal(machine_hw_spi_obj_t *self) {
     switch (spi_bus_remove_device(self->spi)) {
         case ESP_ERR_INVALID_ARG:
@@ -164,6 +202,7 @@ STATIC void machine_hw_spi_init_internal(
 
     if (changed) {
         if (self->state == MACHINE_HW_SPI_STATE_INIT) {
+            machine_hw_spi_async_stop(self);
             self->state = MACHINE_HW_SPI_STATE_DEINIT;
             machine_hw_spi_deinit_internal(&old_self);
         }
@@ -183,7 +222,7 @@ STATIC void machine_hw_spi_init_internal(
         .clock_speed_hz = self->baudrate,
         .mode = self->phase | (self->polarity << 1),
         .spics_io_num = -1, // No CS pin
-        .queue_size = 1,
+        .queue_size = 2,    // both bounce buffers of an async write in flight
         .flags = self->firstbit == MICROPY_PY_MACHINE_SPI_LSB ? SPI_DEVICE_TXBIT_LSBFIRST | SPI_DEVICE_RXBIT_LSBFIRST : 0,
         .pre_cb = NULL
     };
@@ -232,6 +271,7 @@ STATIC void machine_hw_spi_init_internal(
 STATIC void machine_hw_spi_deinit(mp_obj_base_t *self_in) {
     machine_hw_spi_obj_t *self = (machine_hw_spi_obj_t *) self_in;
     if (self->state == MACHINE_HW_SPI_STATE_INIT) {
+        machine_hw_spi_async_stop(self);
         self->state = MACHINE_HW_SPI_STATE_DEINIT;
         machine_hw_spi_deinit_internal(self);
     }
@@ -240,6 +280,9 @@ STATIC void machine_hw_spi_deinit(mp_obj_base_t *self_in) {
 STATIC void machine_hw_spi_transfer(mp_obj_base_t *self_in, size_t len, const uint8_t *src, uint8_t *dest) {
     machine_hw_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
+    // the device queue is shared with the async task
+    machine_hw_spi_async_wait(self);
+
     if (self->state == MACHINE_HW_SPI_STATE_DEINIT) {
         mp_raise_msg(&mp_type_OSError, "transfer on deinitialized SPI");
         return;
@@ -267,6 +310,10 @@ STATIC void machine_hw_spi_transfer(mp_obj_base_t *self_in, size_t len, const ui
         int offset = 0;
         int bits_remaining = bits_to_send;
 
+        // long transfers run with the GIL released, other threads using
+        // this device wait for it in machine_hw_spi_async_wait()
+        self->busy = true;
+        MP_HAL_BLOCKING_BEGIN(MP_OBJ_NULL);
         while (bits_remaining) {
             memset(&transaction, 0, sizeof(transaction));
 
@@ -286,6 +333,178 @@ STATIC void machine_hw_spi_transfer(mp_obj_base_t *self_in, size_t len, const ui
             // doesn't need ceil(); loop ends when bits_remaining is 0
             offset += transaction.length / 8;
         }
+        MP_HAL_BLOCKING_END();
+        self->busy = false;
+    }
+}
+
+/******************************************************************************/
+// Asynchronous writes
+
+STATIC void machine_hw_spi_async_task(void *arg) {
+    machine_hw_spi_async_t *a = arg;
+    machine_hw_spi_obj_t *self = a->spi;
+    uint8_t slot;
+
+    for (;;) {
+        xQueueReceive(a->full_q, &slot, portMAX_DELAY);
+        if (slot == MP_HW_SPI_ASYNC_STOP) {
+            break;
+        }
+
+        const uint8_t *buf = a->job[slot].buf;
+        size_t len = a->job[slot].len;
+        size_t offset = 0;
+        int in_flight = 0;
+        int b = 0;
+        while ((offset < len) || (in_flight > 0)) {
+            if ((offset < len) && (in_flight < 2)) {
+                // fill one bounce buffer while the other one is sent
+                size_t n = MIN(len - offset, MP_HW_SPI_MAX_XFER_BYTES);
+                memcpy(a->bounce[b], buf + offset, n);
+                spi_transaction_t *t = &a->trans[b];
+                memset(t, 0, sizeof(*t));
+                t->length = n * 8 / self->bits * self->bits;
+                t->tx_buffer = a->bounce[b];
+                spi_device_queue_trans(self->spi, t, portMAX_DELAY);
+                offset += n;
+                b ^= 1;
+                in_flight++;
+            } else {
+                spi_transaction_t *t;
+                spi_device_get_trans_result(self->spi, &t, portMAX_DELAY);
+                in_flight--;
+            }
+        }
+
+        mp_obj_t callback = a->job[slot].callback;
+        a->job[slot].buf_obj = MP_OBJ_NULL;
+        a->job[slot].callback = mp_const_none;
+        mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        a->pending--;
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        xQueueSend(a->free_q, &slot, portMAX_DELAY);
+        if (callback != mp_const_none) {
+            mp_sched_schedule(callback, MP_OBJ_FROM_PTR(self));
+        }
+        xTaskNotifyGive(mp_main_task_handle);
+    }
+
+    a->task = NULL;
+    vTaskDelete(NULL);
+}
+
+STATIC machine_hw_spi_async_t *machine_hw_spi_async_get(machine_hw_spi_obj_t *self) {
+    if (self->state != MACHINE_HW_SPI_STATE_INIT) {
+        mp_raise_msg(&mp_type_OSError, "transfer on deinitialized SPI");
+    }
+    if (self->async != NULL) {
+        return self->async;
+    }
+
+    machine_hw_spi_async_t *a = m_new0(machine_hw_spi_async_t, 1);
+    a->spi = self;
+    for (int i = 0; i < MP_HW_SPI_ASYNC_JOBS; i++) {
+        a->job[i].callback = mp_const_none;
+    }
+    a->full_q = xQueueCreate(MP_HW_SPI_ASYNC_JOBS + 1, sizeof(uint8_t));
+    a->free_q = xQueueCreate(MP_HW_SPI_ASYNC_JOBS, sizeof(uint8_t));
+    a->bounce[0] = heap_caps_malloc(MP_HW_SPI_MAX_XFER_BYTES, MALLOC_CAP_DMA);
+    a->bounce[1] = heap_caps_malloc(MP_HW_SPI_MAX_XFER_BYTES, MALLOC_CAP_DMA);
+    if ((a->full_q == NULL) || (a->free_q == NULL) || (a->bounce[0] == NULL) || (a->bounce[1] == NULL)
+        || (xTaskCreate(machine_hw_spi_async_task, "spi_async", MP_HW_SPI_ASYNC_TASK_STACK, a,
+            MP_HW_SPI_ASYNC_TASK_PRIO, &a->task) != pdPASS)) {
+        if (a->full_q != NULL) {
+            vQueueDelete(a->full_q);
+        }
+        if (a->free_q != NULL) {
+            vQueueDelete(a->free_q);
+        }
+        heap_caps_free(a->bounce[0]);
+        heap_caps_free(a->bounce[1]);
+        m_del(machine_hw_spi_async_t, a, 1);
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    for (uint8_t i = 0; i < MP_HW_SPI_ASYNC_JOBS; i++) {
+        xQueueSend(a->free_q, &i, 0);
+    }
+
+    self->async = a;
+    MP_STATE_PORT(machine_hw_spi_async)[self - machine_hw_spi_obj] = a;
+    return a;
+}
+
+// Wait, running the scheduler, until all queued jobs are on the wire
+STATIC void machine_hw_spi_async_wait(machine_hw_spi_obj_t *self) {
+    while (self->busy || ((self->async != NULL) && (self->async->pending > 0))) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+}
+
+// Let the task finish the queued jobs, then free everything
+STATIC void machine_hw_spi_async_stop(machine_hw_spi_obj_t *self) {
+    // and any transfer another thread is running
+    while (self->busy) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    machine_hw_spi_async_t *a = self->async;
+    if (a == NULL) {
+        return;
+    }
+    uint8_t slot = MP_HW_SPI_ASYNC_STOP;
+    xQueueSend(a->full_q, &slot, portMAX_DELAY);
+    while (a->task != NULL) {
+        vTaskDelay(1);
+    }
+    vQueueDelete(a->full_q);
+    vQueueDelete(a->free_q);
+    heap_caps_free(a->bounce[0]);
+    heap_caps_free(a->bounce[1]);
+    self->async = NULL;
+    MP_STATE_PORT(machine_hw_spi_async)[self - machine_hw_spi_obj] = NULL;
+}
+
+// Queue writes of the buffers in bufs, with callback(spi) run once the
+// last one has been sent
+STATIC void machine_hw_spi_async_queue(machine_hw_spi_obj_t *self, size_t n, const mp_obj_t *bufs, mp_obj_t callback) {
+    if ((callback != mp_const_none) && !mp_obj_is_callable(callback)) {
+        mp_raise_ValueError("callback must be None or callable");
+    }
+    // check all the buffers before queueing any of them
+    for (size_t i = 0; i < n; i++) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_READ);
+    }
+    machine_hw_spi_async_t *a = machine_hw_spi_async_get(self);
+    while (self->busy) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len == 0) {
+            continue;
+        }
+        uint8_t slot;
+        while (xQueueReceive(a->free_q, &slot, 0) != pdTRUE) {
+            // all jobs in use, wait for one to finish
+            MICROPY_EVENT_POLL_HOOK
+        }
+        a->job[slot].buf_obj = bufs[i];
+        a->job[slot].buf = bufinfo.buf;
+        a->job[slot].len = bufinfo.len;
+        a->job[slot].callback = (i == n - 1) ? callback : mp_const_none;
+        mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        a->pending++;
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        xQueueSend(a->full_q, &slot, portMAX_DELAY);
+    }
+}
+
+void machine_hw_spi_deinit_all(void) {
+    for (int i = 0; i < MP_ARRAY_SIZE(machine_hw_spi_obj); i++) {
+        machine_hw_spi_async_stop(&machine_hw_spi_obj[i]);
     }
 }
 
@@ -389,6 +608,78 @@ mp_obj_t machine_hw_spi_make_new(const mp_obj_type_t *type, size_t n_args, size_
     return MP_OBJ_FROM_PTR(self);
 }
 
+STATIC mp_obj_t machine_hw_spi_init_method(size_t n_args, const mp_obj_t *args, mp_map_t *kw_args) {
+    machine_hw_spi_init(MP_OBJ_TO_PTR(args[0]), n_args - 1, args + 1, kw_args);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_hw_spi_init_obj, 1, machine_hw_spi_init_method);
+
+STATIC mp_obj_t machine_hw_spi_deinit_method(mp_obj_t self_in) {
+    machine_hw_spi_deinit(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hw_spi_deinit_obj, machine_hw_spi_deinit_method);
+
+// write_async(buf, *, callback=None)
+STATIC mp_obj_t machine_hw_spi_write_async(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_buf, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_buf, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    machine_hw_spi_async_queue(MP_OBJ_TO_PTR(pos_args[0]), 1, &args[ARG_buf].u_obj, args[ARG_callback].u_obj);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_hw_spi_write_async_obj, 1, machine_hw_spi_write_async);
+
+// queue(bufs, *, callback=None)
+STATIC mp_obj_t machine_hw_spi_queue(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_bufs, ARG_callback };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_bufs, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_callback, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    size_t n;
+    mp_obj_t *bufs;
+    mp_obj_get_array(args[ARG_bufs].u_obj, &n, &bufs);
+    machine_hw_spi_async_queue(MP_OBJ_TO_PTR(pos_args[0]), n, bufs, args[ARG_callback].u_obj);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_hw_spi_queue_obj, 1, machine_hw_spi_queue);
+
+STATIC mp_obj_t machine_hw_spi_busy(mp_obj_t self_in) {
+    machine_hw_spi_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return mp_obj_new_bool((self->async != NULL) && (self->async->pending > 0));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hw_spi_busy_obj, machine_hw_spi_busy);
+
+STATIC mp_obj_t machine_hw_spi_wait(mp_obj_t self_in) {
+    machine_hw_spi_async_wait(MP_OBJ_TO_PTR(self_in));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_hw_spi_wait_obj, machine_hw_spi_wait);
+
+STATIC const mp_rom_map_elem_t machine_hw_spi_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_hw_spi_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_deinit), MP_ROM_PTR(&machine_hw_spi_deinit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_machine_spi_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_machine_spi_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_machine_spi_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_readinto), MP_ROM_PTR(&mp_machine_spi_write_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write_async), MP_ROM_PTR(&machine_hw_spi_write_async_obj) },
+    { MP_ROM_QSTR(MP_QSTR_queue), MP_ROM_PTR(&machine_hw_spi_queue_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&machine_hw_spi_busy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&machine_hw_spi_wait_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_MSB), MP_ROM_INT(MICROPY_PY_MACHINE_SPI_MSB) },
+    { MP_ROM_QSTR(MP_QSTR_LSB), MP_ROM_INT(MICROPY_PY_MACHINE_SPI_LSB) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_hw_spi_locals_dict, machine_hw_spi_locals_dict_table);
+
 STATIC const mp_machine_spi_p_t machine_hw_spi_p = {
     .init = machine_hw_spi_init,
     .deinit = machine_hw_spi_deinit,
@@ -401,5 +692,5 @@ const mp_obj_type_t machine_hw_spi_type = {
     .print = machine_hw_spi_print,
     .make_new = machine_hw_spi_make_new,
     .protocol = &machine_hw_spi_p,
-    .locals_dict = (mp_obj_dict_t *) &mp_machine_spi_locals_dict,
+    .locals_dict = (mp_obj_dict_t *) &machine_hw_spi_locals_dict,
 };
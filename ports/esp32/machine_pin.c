@@ -34,15 +34,22 @@
 
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/mperrno.h"
+#include "py/smallint.h"
 #include "mphalport.h"
 #include "modmachine.h"
 #include "extmod/virtpin.h"
 #include "machine_rtc.h"
 #include "modesp32.h"
+#include "modesp.h"
 
 // Used to implement gpio_hold_en() functionality; value should be distinct from all IDF pull modes
 #define GPIO_PULLHOLD (8)
 
+// APB clock is 80MHz, divide by 80 for the 1us ticks of pulse_train()
+#define PULSE_TRAIN_RMT_CLK_DIV (80)
+#define PULSE_TRAIN_MAX_US      (32767)
+
 typedef struct _machine_pin_obj_t {
     mp_obj_base_t base;
     gpio_num_t id;
@@ -53,6 +60,27 @@ typedef struct _machine_pin_irq_obj_t {
     gpio_num_t id;
 } machine_pin_irq_obj_t;
 
+// Edges of pins configured with irq(capture=n) are recorded by the ISR into
+// one ring shared by all such pins, so the order of edges on different pins
+// is kept.  The ISR is the only writer of head and the VM the only writer of
+// tail.
+typedef struct _machine_pin_event_t {
+    uint32_t time;              // mp_hal_ticks_us() when the edge was seen
+    uint8_t pin;
+    uint8_t level;              // after the edge
+} machine_pin_event_t;
+
+typedef struct _machine_pin_capture_t {
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t overflow;
+    uint32_t size;
+    machine_pin_event_t events[];
+} machine_pin_capture_t;
+
+// bit n set if GPIO n records edges into MP_STATE_PORT(machine_pin_capture)
+STATIC volatile uint64_t machine_pin_capture_mask;
+
 STATIC const machine_pin_obj_t machine_pin_obj[] = {
     {{&machine_pin_type}, GPIO_NUM_0},
     {{&machine_pin_type}, GPIO_NUM_1},
@@ -106,6 +134,8 @@ void machine_pins_init(void) {
         did_install = true;
     }
     memset(&MP_STATE_PORT(machine_pin_irq_handler[0]), 0, sizeof(MP_STATE_PORT(machine_pin_irq_handler)));
+    machine_pin_capture_mask = 0;
+    MP_STATE_PORT(machine_pin_capture) = NULL;
 }
 
 void machine_pins_deinit(void) {
@@ -116,10 +146,36 @@ void machine_pins_deinit(void) {
     }
 }
 
+// Returns true if the ring was empty, ie the handler hasn't been told yet.
+STATIC bool machine_pin_capture_push(gpio_num_t id) {
+    uint32_t time = mp_hal_ticks_us() & (MICROPY_PY_UTIME_TICKS_PERIOD - 1);
+    machine_pin_capture_t *cap = MP_STATE_PORT(machine_pin_capture);
+    uint32_t head = cap->head;
+    uint32_t next = (head + 1) % cap->size;
+    uint32_t tail = cap->tail;
+    if (next == tail) {
+        cap->overflow += 1;
+        return false;
+    }
+    cap->events[head].time = time;
+    cap->events[head].pin = id;
+    cap->events[head].level = gpio_get_level(id);
+    __sync_synchronize();
+    cap->head = next;
+    return head == tail;
+}
+
 STATIC void machine_pin_isr_handler(void *arg) {
     machine_pin_obj_t *self = arg;
     mp_obj_t handler = MP_STATE_PORT(machine_pin_irq_handler)[self->id];
-    mp_sched_schedule(handler, MP_OBJ_FROM_PTR(self));
+    if (machine_pin_capture_mask & (1ULL << self->id)) {
+        // only the first of a burst of edges schedules the handler, which
+        // then drains them all with read_events()
+        if (!machine_pin_capture_push(self->id) || handler == MP_OBJ_NULL) {
+            return;
+        }
+    }
+    mp_sched_schedule_prio(handler, MP_OBJ_FROM_PTR(self), MP_SCHED_PRIO_HIGH);
     mp_hal_wake_main_task_from_isr();
 }
 
@@ -271,13 +327,96 @@ STATIC mp_obj_t machine_pin_on(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_pin_on_obj, machine_pin_on);
 
-// pin.irq(handler=None, trigger=IRQ_FALLING|IRQ_RISING)
+// pin.pulse_train(durations, *, level=1, wait=True)
+// Output pulses of the given lengths in microseconds through an RMT channel,
+// starting at level and alternating, then return to the other level.  The
+// timing is kept by the peripheral, so it isn't disturbed by interrupts.
+STATIC mp_obj_t machine_pin_pulse_train(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_durations, ARG_level, ARG_wait };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_durations, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_level, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    machine_pin_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+    if (!GPIO_IS_VALID_OUTPUT_GPIO(self->id)) {
+        mp_raise_ValueError("pin can only be input");
+    }
+    bool level = args[ARG_level].u_bool;
+
+    size_t len = mp_obj_get_int(mp_obj_len(args[ARG_durations].u_obj));
+    if (len == 0) {
+        return mp_const_none;
+    }
+    int ch = esp_rmt_tx_channel(self->id, PULSE_TRAIN_RMT_CLK_DIV, !level);
+    if (ch < 0) {
+        mp_raise_OSError(MP_EIO);
+    }
+    uint32_t num_items = (len + 1) / 2;
+    rmt_item32_t *items = esp_rmt_tx_items(ch, num_items);
+    if (items == NULL) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+
+    // each item holds a pulse and the gap after it; a zero length gap after
+    // an odd final pulse ends the transmission
+    memset(items, 0, num_items * sizeof(rmt_item32_t));
+    mp_obj_t iter = mp_getiter(args[ARG_durations].u_obj, NULL);
+    for (size_t i = 0; i < len; i++) {
+        mp_obj_t item = mp_iternext(iter);
+        mp_int_t us = (item == MP_OBJ_STOP_ITERATION) ? 0 : mp_obj_get_int(item);
+        if (us <= 0 || us > PULSE_TRAIN_MAX_US) {
+            mp_raise_ValueError("duration out of range");
+        }
+        rmt_item32_t *it = &items[i / 2];
+        if (i % 2 == 0) {
+            it->duration0 = us;
+            it->level0 = level;
+            it->level1 = !level;
+        } else {
+            it->duration1 = us;
+        }
+    }
+
+    if (rmt_write_items(ch, items, num_items, false) != ESP_OK) {
+        mp_raise_OSError(MP_EIO);
+    }
+    if (args[ARG_wait].u_bool) {
+        esp_rmt_tx_wait(ch);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_pin_pulse_train_obj, 2, machine_pin_pulse_train);
+
+// Make sure the capture ring holds at least size events.  It can only be
+// replaced while no pin is writing to it.
+STATIC void machine_pin_capture_alloc(gpio_num_t id, mp_int_t size) {
+    machine_pin_capture_t *cap = MP_STATE_PORT(machine_pin_capture);
+    if (cap != NULL && (mp_uint_t)size < cap->size) {
+        return;
+    }
+    if (cap != NULL && (machine_pin_capture_mask & ~(1ULL << id)) != 0) {
+        mp_raise_ValueError("capture buffer in use");
+    }
+    // one slot is kept free to tell a full ring from an empty one
+    cap = m_new_obj_var(machine_pin_capture_t, machine_pin_event_t, size + 1);
+    cap->head = 0;
+    cap->tail = 0;
+    cap->overflow = 0;
+    cap->size = size + 1;
+    MP_STATE_PORT(machine_pin_capture) = cap;
+}
+
+// pin.irq(handler=None, trigger=IRQ_FALLING|IRQ_RISING, wake=None, capture=0)
 STATIC mp_obj_t machine_pin_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_handler, ARG_trigger, ARG_wake };
+    enum { ARG_handler, ARG_trigger, ARG_wake, ARG_capture };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_handler, MP_ARG_OBJ, {.u_obj = mp_const_none} },
         { MP_QSTR_trigger, MP_ARG_INT, {.u_int = GPIO_PIN_INTR_POSEDGE | GPIO_PIN_INTR_NEGEDGE} },
         { MP_QSTR_wake, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_capture, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
     };
     machine_pin_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
@@ -320,11 +459,23 @@ STATIC mp_obj_t machine_pin_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_
                 machine_rtc_config.ext0_pin = -1;
             }
 
+            mp_int_t capture = args[ARG_capture].u_int;
+            if (capture < 0) {
+                mp_raise_ValueError("bad capture size");
+            }
             if (handler == mp_const_none) {
                 handler = MP_OBJ_NULL;
-                trigger = 0;
+                if (capture == 0) {
+                    trigger = 0;
+                }
             }
             gpio_isr_handler_remove(self->id);
+            if (capture > 0) {
+                machine_pin_capture_alloc(self->id, capture);
+                machine_pin_capture_mask |= 1ULL << self->id;
+            } else {
+                machine_pin_capture_mask &= ~(1ULL << self->id);
+            }
             MP_STATE_PORT(machine_pin_irq_handler)[self->id] = handler;
             gpio_set_intr_type(self->id, trigger);
             gpio_isr_handler_add(self->id, machine_pin_isr_handler, (void*)self);
@@ -343,6 +494,7 @@ STATIC const mp_rom_map_elem_t machine_pin_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_off), MP_ROM_PTR(&machine_pin_off_obj) },
     { MP_ROM_QSTR(MP_QSTR_on), MP_ROM_PTR(&machine_pin_on_obj) },
     { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&machine_pin_irq_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pulse_train), MP_ROM_PTR(&machine_pin_pulse_train_obj) },
 
     // class constants
     { MP_ROM_QSTR(MP_QSTR_IN), MP_ROM_INT(GPIO_MODE_INPUT) },
@@ -456,8 +608,70 @@ STATIC mp_obj_t machine_pin_irq_trigger(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_pin_irq_trigger_obj, 1, 2, machine_pin_irq_trigger);
 
+// irq.read_events([buf])
+// Take the captured edges of all capturing pins, oldest first.  Without buf a
+// list of (pin, level, ticks_us) tuples is returned.  Otherwise each event is
+// stored into buf as two 32-bit words, ticks_us and pin << 1 | level, and the
+// number of events stored is returned.
+STATIC mp_obj_t machine_pin_irq_read_events(size_t n_args, const mp_obj_t *args) {
+    machine_pin_capture_t *cap = MP_STATE_PORT(machine_pin_capture);
+    mp_buffer_info_t bufinfo;
+    size_t max = (size_t)-1;
+    mp_obj_t list = MP_OBJ_NULL;
+    if (n_args == 2) {
+        mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+        max = bufinfo.len / (2 * sizeof(uint32_t));
+    } else {
+        list = mp_obj_new_list(0, NULL);
+    }
+    size_t n = 0;
+    if (cap != NULL) {
+        uint32_t tail = cap->tail;
+        uint32_t head = cap->head;
+        __sync_synchronize();
+        for (; tail != head && n < max; tail = (tail + 1) % cap->size, ++n) {
+            const machine_pin_event_t *ev = &cap->events[tail];
+            if (list == MP_OBJ_NULL) {
+                uint32_t *w = (uint32_t*)bufinfo.buf + 2 * n;
+                w[0] = ev->time;
+                w[1] = ev->pin << 1 | ev->level;
+            } else {
+                mp_obj_t t[3] = {
+                    MP_OBJ_FROM_PTR(&machine_pin_obj[ev->pin]),
+                    MP_OBJ_NEW_SMALL_INT(ev->level),
+                    mp_obj_new_int_from_uint(ev->time),
+                };
+                mp_obj_list_append(list, mp_obj_new_tuple(3, t));
+            }
+        }
+        cap->tail = tail;
+    }
+    if (list == MP_OBJ_NULL) {
+        return MP_OBJ_NEW_SMALL_INT(n);
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_pin_irq_read_events_obj, 1, 2, machine_pin_irq_read_events);
+
+// irq.overflow()
+// Return the number of edges dropped because the capture ring was full, and
+// reset it.
+STATIC mp_obj_t machine_pin_irq_overflow(mp_obj_t self_in) {
+    (void)self_in;
+    machine_pin_capture_t *cap = MP_STATE_PORT(machine_pin_capture);
+    if (cap == NULL) {
+        return MP_OBJ_NEW_SMALL_INT(0);
+    }
+    uint32_t n = cap->overflow;
+    cap->overflow -= n;
+    return mp_obj_new_int_from_uint(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_pin_irq_overflow_obj, machine_pin_irq_overflow);
+
 STATIC const mp_rom_map_elem_t machine_pin_irq_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_trigger), MP_ROM_PTR(&machine_pin_irq_trigger_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_events), MP_ROM_PTR(&machine_pin_irq_read_events_obj) },
+    { MP_ROM_QSTR(MP_QSTR_overflow), MP_ROM_PTR(&machine_pin_irq_overflow_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(machine_pin_irq_locals_dict, machine_pin_irq_locals_dict_table);
 
@@ -467,3 +681,153 @@ STATIC const mp_obj_type_t machine_pin_irq_type = {
     .call = machine_pin_irq_call,
     .locals_dict = (mp_obj_dict_t*)&machine_pin_irq_locals_dict,
 };
+
+/******************************************************************************/
+// PinGroup
+
+// A PinGroup reads all its pins with one load of the GPIO input registers and
+// writes them with one store each to the output set and clear registers,
+// instead of a driver call per pin.  Bit i of a value is pins[i].  GPIOs
+// 32-39 are in a second bank of registers, so pins in different banks change
+// a few cycles apart.
+
+typedef struct _machine_pin_group_obj_t {
+    mp_obj_base_t base;
+    uint32_t mask[2];           // of the group's GPIOs in each bank
+    int8_t shift;               // GPIO of pins[0] if the pins are consecutive in bank 0, else -1
+    uint8_t len;
+    uint8_t gpio[];
+} machine_pin_group_obj_t;
+
+STATIC void machine_pin_group_write(machine_pin_group_obj_t *self, uint32_t value) {
+    uint32_t set[2] = { 0, 0 };
+    if (self->shift >= 0) {
+        set[0] = (value << self->shift) & self->mask[0];
+    } else {
+        for (size_t i = 0; i < self->len; i++) {
+            if (value & (1u << i)) {
+                set[self->gpio[i] >> 5] |= 1u << (self->gpio[i] & 31);
+            }
+        }
+    }
+    if (self->mask[0]) {
+        GPIO_REG_WRITE(GPIO_OUT_W1TS_REG, set[0]);
+        GPIO_REG_WRITE(GPIO_OUT_W1TC_REG, self->mask[0] & ~set[0]);
+    }
+    if (self->mask[1]) {
+        GPIO_REG_WRITE(GPIO_OUT1_W1TS_REG, set[1]);
+        GPIO_REG_WRITE(GPIO_OUT1_W1TC_REG, self->mask[1] & ~set[1]);
+    }
+}
+
+STATIC uint32_t machine_pin_group_read(machine_pin_group_obj_t *self) {
+    uint32_t in[2];
+    in[0] = GPIO_REG_READ(GPIO_IN_REG);
+    in[1] = self->mask[1] ? GPIO_REG_READ(GPIO_IN1_REG) : 0;
+    if (self->shift >= 0) {
+        return (in[0] & self->mask[0]) >> self->shift;
+    }
+    uint32_t value = 0;
+    for (size_t i = 0; i < self->len; i++) {
+        value |= ((in[self->gpio[i] >> 5] >> (self->gpio[i] & 31)) & 1) << i;
+    }
+    return value;
+}
+
+// PinGroup(pins, mode=None, pull=None, *, value)
+STATIC mp_obj_t machine_pin_group_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_pins, ARG_mode, ARG_pull, ARG_value };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_pins, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_mode, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_pull, MP_ARG_OBJ, {.u_obj = MP_OBJ_NEW_SMALL_INT(-1)} },
+        { MP_QSTR_value, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(args[ARG_pins].u_obj, &len, &items);
+    if (len == 0 || len > 32) {
+        mp_raise_ValueError("need 1 to 32 pins");
+    }
+    machine_pin_group_obj_t *self = m_new_obj_var(machine_pin_group_obj_t, uint8_t, len);
+    self->base.type = type;
+    self->mask[0] = 0;
+    self->mask[1] = 0;
+    self->len = len;
+    self->shift = -1;
+    for (size_t i = 0; i < len; i++) {
+        int gpio = machine_pin_get_gpio(items[i]);
+        if (gpio < 0 || gpio >= (int)MP_ARRAY_SIZE(machine_pin_obj) || machine_pin_obj[gpio].base.type == NULL) {
+            mp_raise_ValueError("invalid pin");
+        }
+        uint32_t bit = 1u << (gpio & 31);
+        if (self->mask[gpio >> 5] & bit) {
+            mp_raise_ValueError("pin given twice");
+        }
+        self->mask[gpio >> 5] |= bit;
+        self->gpio[i] = gpio;
+    }
+    if (self->gpio[0] + len <= 32) {
+        self->shift = self->gpio[0];
+        for (size_t i = 1; i < len; i++) {
+            if (self->gpio[i] != self->gpio[0] + i) {
+                self->shift = -1;
+                break;
+            }
+        }
+    }
+
+    // the initial value goes out together, before the pins become outputs
+    if (args[ARG_value].u_obj != MP_OBJ_NULL) {
+        machine_pin_group_write(self, mp_obj_get_int_truncated(args[ARG_value].u_obj));
+    }
+    if (args[ARG_mode].u_obj != mp_const_none || args[ARG_pull].u_obj != MP_OBJ_NEW_SMALL_INT(-1)) {
+        mp_obj_t pin_args[2] = { args[ARG_mode].u_obj, args[ARG_pull].u_obj };
+        mp_map_t no_kw;
+        mp_map_init_fixed_table(&no_kw, 0, NULL);
+        for (size_t i = 0; i < len; i++) {
+            const machine_pin_obj_t *pin = &machine_pin_obj[self->gpio[i]];
+            if (rtc_gpio_is_valid_gpio(pin->id)) {
+                rtc_gpio_deinit(pin->id);
+            }
+            machine_pin_obj_init_helper(pin, 2, pin_args, &no_kw);
+        }
+    }
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC void machine_pin_group_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    machine_pin_group_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "PinGroup(pins:");
+    for (size_t i = 0; i < self->len; i++) {
+        mp_printf(print, "%s %u", (i == 0) ? "" : ",", self->gpio[i]);
+    }
+    mp_printf(print, ")");
+}
+
+// group.value([value])
+STATIC mp_obj_t machine_pin_group_value(size_t n_args, const mp_obj_t *args) {
+    machine_pin_group_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 1) {
+        return mp_obj_new_int_from_uint(machine_pin_group_read(self));
+    }
+    machine_pin_group_write(self, mp_obj_get_int_truncated(args[1]));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_pin_group_value_obj, 1, 2, machine_pin_group_value);
+
+STATIC const mp_rom_map_elem_t machine_pin_group_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_value), MP_ROM_PTR(&machine_pin_group_value_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_pin_group_locals_dict, machine_pin_group_locals_dict_table);
+
+const mp_obj_type_t machine_pin_group_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_PinGroup,
+    .print = machine_pin_group_print,
+    .make_new = machine_pin_group_make_new,
+    .locals_dict = (mp_obj_dict_t*)&machine_pin_group_locals_dict,
+};
@@ -26,11 +26,13 @@
  */
 
 #include <stdio.h>
+#include "freertos/FreeRTOS.h"
 #include "driver/ledc.h"
 #include "esp_err.h"
 
 #include "py/nlr.h"
 #include "py/runtime.h"
+#include "py/mphal.h"
 #include "modmachine.h"
 #include "modmachine.h"
 #include "mphalport.h"
@@ -41,18 +43,38 @@
 // Forward dec'l
 extern const mp_obj_type_t machine_pwm_type;
 
+// Frequency of a new PWM without an explicit frequency
+#define PWM_DEFAULT_FREQ (5000)
+
+// Errors from setting the frequency of a channel
+#define PWM_ERR_FREQ     (-1)   // no duty resolution fits the frequency
+#define PWM_ERR_TIMERS   (-2)   // all timers are in use at other frequencies
+
 typedef struct _esp32_pwm_obj_t {
     mp_obj_base_t base;
     gpio_num_t pin;
     uint8_t active;
     uint8_t channel;
     uint8_t timer;
+    uint8_t auto_timer;     // timer taken from the pool rather than given
 } esp32_pwm_obj_t;
 
 STATIC esp32_pwm_obj_t *pwm_channels[LEDC_CHANNEL_MAX];
 STATIC ledc_timer_config_t pwm_timers[LEDC_CHANNEL_MAX/2];
 STATIC uint8_t pwm_is_init = 0;
 
+// ==== LEDC timer pool ====
+// A PWM created without timer=N shares the four LEDC timers with other
+// channels by (frequency, duty resolution): it uses a running timer with the
+// same settings if there is one and configures a free one otherwise, and
+// when its frequency changes it retunes its timer only if it is the sole
+// user, moving to another timer if not.  A timer given with timer=N is
+// kept, and retuning such a channel retunes every channel on its timer.
+// The melody player retunes channels from its own task, so the reference
+// counts are only changed under pwm_timer_mux.
+STATIC uint8_t pwm_timer_refs[LEDC_CHANNEL_MAX/2];
+STATIC portMUX_TYPE pwm_timer_mux = portMUX_INITIALIZER_UNLOCKED;
+
 
 //-----------------------------------------------------
 STATIC float duty2perc(esp32_pwm_obj_t *self, int duty)
@@ -66,17 +88,25 @@ STATIC int perc2duty(esp32_pwm_obj_t *self, float dperc)
 	return ((int)(dperc * 100.0) * (1 << pwm_timers[self->timer].duty_resolution)) / 10000;
 }
 
+// Highest duty resolution usable at freq, or 0 if there is none
+//------------------------------
+STATIC int freq2dres(int freq)
+{
+    int dres = 15;
+    while (freq > (80000000 / (1 << dres))) {
+    	dres--;
+    	if (dres == 0) break;
+    }
+    return dres;
+}
+
 //----------------------------------------------------
 STATIC int set_freq(esp32_pwm_obj_t *self, int newval)
 {
 	if (newval == pwm_timers[self->timer].freq_hz) return 1;
 
     // Adjust duty resolution for new frequency if needed
-    int dres = 15;
-    while (newval > (80000000 / (1 << dres))) {
-    	dres--;
-    	if (dres == 0) break;
-    }
+    int dres = freq2dres(newval);
     if (dres == 0) return 0; // can't set duty resolution for the requested frequency
 
 	int n;
@@ -118,6 +148,113 @@ STATIC int set_freq(esp32_pwm_obj_t *self, int newval)
     return 1;
 }
 
+// Take a reference to a timer running at freq.  A running timer with the
+// same settings is shared; otherwise cur, the caller's current timer (or -1),
+// is retuned if the caller is its only user, else a free timer is set up.
+// Returns the timer or a PWM_ERR_ code.
+//-------------------------------------------
+STATIC int pwm_timer_get(int freq, int cur)
+{
+    int dres = freq2dres(freq);
+    if (dres == 0) {
+        return PWM_ERR_FREQ;
+    }
+
+    int t = -1;
+    bool setup = false;
+    ledc_timer_config_t old_cfg;
+    portENTER_CRITICAL(&pwm_timer_mux);
+    for (int n = 0; n < (LEDC_CHANNEL_MAX/2); n++) {
+        if (pwm_timer_refs[n] && (pwm_timers[n].freq_hz == freq) && (pwm_timers[n].duty_resolution == dres)) {
+            t = n;
+            break;
+        }
+    }
+    if (t < 0) {
+        if ((cur >= 0) && (pwm_timer_refs[cur] == 1)) {
+            t = cur;
+        } else {
+            for (int n = 0; n < (LEDC_CHANNEL_MAX/2); n++) {
+                if (pwm_timer_refs[n] == 0) {
+                    t = n;
+                    break;
+                }
+            }
+        }
+        if (t >= 0) {
+            // claim the settings now so that others share rather than clash
+            old_cfg = pwm_timers[t];
+            pwm_timers[t].freq_hz = freq;
+            pwm_timers[t].duty_resolution = dres;
+            setup = true;
+        }
+    }
+    if ((t >= 0) && (t != cur)) {
+        pwm_timer_refs[t]++;
+    }
+    portEXIT_CRITICAL(&pwm_timer_mux);
+
+    if (t < 0) {
+        return PWM_ERR_TIMERS;
+    }
+    if (setup && (ledc_timer_config(&(pwm_timers[t])) != ESP_OK)) {
+        portENTER_CRITICAL(&pwm_timer_mux);
+        pwm_timers[t] = old_cfg;
+        if (t != cur) {
+            pwm_timer_refs[t]--;
+        }
+        portEXIT_CRITICAL(&pwm_timer_mux);
+        return PWM_ERR_FREQ;
+    }
+    return t;
+}
+
+//-------------------------------
+STATIC void pwm_timer_put(int t)
+{
+    portENTER_CRITICAL(&pwm_timer_mux);
+    if (pwm_timer_refs[t]) {
+        pwm_timer_refs[t]--;
+    }
+    portEXIT_CRITICAL(&pwm_timer_mux);
+}
+
+// Set the frequency of a channel keeping its duty; 0 or a PWM_ERR_ code
+//-------------------------------------------------------------
+STATIC int pwm_set_channel_freq(esp32_pwm_obj_t *self, int freq)
+{
+    if (!self->auto_timer) {
+        return set_freq(self, freq) ? 0 : PWM_ERR_FREQ;
+    }
+    int old = self->timer;
+    if (freq == pwm_timers[old].freq_hz) {
+        return 0;
+    }
+
+    float dperc = duty2perc(self, ledc_get_duty(PWMODE, self->channel));
+    int t = pwm_timer_get(freq, old);
+    if (t < 0) {
+        return t;
+    }
+    if (t != old) {
+        ledc_bind_channel_timer(PWMODE, self->channel, pwm_timers[t].timer_num);
+        self->timer = t;
+        pwm_timer_put(old);
+    }
+    ledc_set_duty(PWMODE, self->channel, perc2duty(self, dperc));
+    ledc_update_duty(PWMODE, self->channel);
+    return 0;
+}
+
+//-----------------------------------------------
+STATIC void pwm_raise_freq(int err, int freq)
+{
+    if (err == PWM_ERR_TIMERS) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "out of PWM timers for frequency %d", freq));
+    }
+    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Bad frequency %d", freq));
+}
+
 //------------------------------------------------
 STATIC void pwm_initChannel(esp32_pwm_obj_t *self)
 {
@@ -151,9 +288,10 @@ STATIC void esp32_pwm_print(const mp_print_t *print, mp_obj_t self_in, mp_print_
     if (self->active) {
         int duty = ledc_get_duty(PWMODE, self->channel);
         float dperc = duty2perc(self, duty);
-        mp_printf(print, ", freq=%u Hz, duty=%.2f%% [%d], duty resolution=%d bits, channel=%d, timer=%d",
+        mp_printf(print, ", freq=%u Hz, duty=%.2f%% [%d], duty resolution=%d bits, channel=%d, timer=%d%s",
         		ledc_get_freq(PWMODE, pwm_timers[self->timer].timer_num), dperc, duty,
-				pwm_timers[self->timer].duty_resolution, self->channel, pwm_timers[self->timer].timer_num);
+				pwm_timers[self->timer].duty_resolution, self->channel, pwm_timers[self->timer].timer_num,
+				self->auto_timer ? " (shared)" : "");
     }
     else mp_printf(print, ", not active");
     mp_printf(print, ")");
@@ -173,13 +311,12 @@ STATIC void esp32_pwm_init_helper(esp32_pwm_obj_t *self, size_t n_args, const mp
 
     int timer = args[ARG_timer].u_int;
 
+    if (timer > 3) {
+		nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "wrong timer requested: %d (0~3 allowed)", timer));
+    }
+
     if (self->channel >= LEDC_CHANNEL_MAX) {
 		// === New PWM assignment
-        if (timer < 0) timer = 0;
-        if (timer > 3) {
-    		nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "wrong timer requested: %d (0~3 allowed)", timer));
-        }
-        self->timer = timer;
         int channel;
         // Find a free PWM channel ===
         for (channel = 0; channel < LEDC_CHANNEL_MAX; ++channel) {
@@ -198,7 +335,33 @@ STATIC void esp32_pwm_init_helper(esp32_pwm_obj_t *self, size_t n_args, const mp
 		}
 		self->channel = channel;
 
-		pwm_initChannel(self);
+		if (timer < 0) {
+			// take a timer from the pool, already at the requested frequency
+			int freq = (args[ARG_freq].u_int != -1) ? args[ARG_freq].u_int : PWM_DEFAULT_FREQ;
+			int t = pwm_timer_get(freq, -1);
+			if (t < 0) {
+				self->channel = LEDC_CHANNEL_MAX;
+				pwm_raise_freq(t, freq);
+			}
+			self->timer = t;
+			self->auto_timer = 1;
+		} else {
+			portENTER_CRITICAL(&pwm_timer_mux);
+			pwm_timer_refs[timer]++;
+			portEXIT_CRITICAL(&pwm_timer_mux);
+			self->timer = timer;
+			self->auto_timer = 0;
+		}
+
+		nlr_buf_t nlr;
+		if (nlr_push(&nlr) == 0) {
+			pwm_initChannel(self);
+			nlr_pop();
+		} else {
+			pwm_timer_put(self->timer);
+			self->channel = LEDC_CHANNEL_MAX;
+			nlr_jump(nlr.ret_val);
+		}
 
 		pwm_channels[channel] = self;
 		self->active = 1;
@@ -207,12 +370,17 @@ STATIC void esp32_pwm_init_helper(esp32_pwm_obj_t *self, size_t n_args, const mp
 
     // Check if pwm timer has to be changed
     if ((timer >= 0) && (timer < 4)) {
+        self->auto_timer = 0;
         if (timer != pwm_timers[self->timer].timer_num) {
             int old_duty = ledc_get_duty(PWMODE, self->channel);
             float old_dperc = duty2perc(self, old_duty);
             int old_freq = pwm_timers[self->timer].freq_hz;
 
             ledc_stop(PWMODE, self->channel, 0);
+            pwm_timer_put(self->timer);
+            portENTER_CRITICAL(&pwm_timer_mux);
+            pwm_timer_refs[timer]++;
+            portEXIT_CRITICAL(&pwm_timer_mux);
             self->timer = timer;
 
     		pwm_initChannel(self);
@@ -234,8 +402,9 @@ STATIC void esp32_pwm_init_helper(esp32_pwm_obj_t *self, size_t n_args, const mp
     int fqval = args[ARG_freq].u_int;
     if (fqval != -1) {
         if (fqval != pwm_timers[self->timer].freq_hz) {
-            if (!set_freq(self, fqval)) {
-                nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Bad frequency %d", fqval));
+            int err = pwm_set_channel_freq(self, fqval);
+            if (err != 0) {
+                pwm_raise_freq(err, fqval);
             }
         }
     }
@@ -264,6 +433,7 @@ STATIC mp_obj_t esp32_pwm_make_new(const mp_obj_type_t *type, size_t n_args, siz
     self->pin = pin_id;
     self->active = 0;
     self->channel = LEDC_CHANNEL_MAX;
+    self->auto_timer = 0;
 
     if (!pwm_is_init) {
     	int n;
@@ -278,6 +448,9 @@ STATIC mp_obj_t esp32_pwm_make_new(const mp_obj_type_t *type, size_t n_args, siz
     	for (n=0; n<(LEDC_CHANNEL_MAX); n++) {
     		pwm_channels[n] = NULL;
     	}
+    	for (n=0; n<(LEDC_CHANNEL_MAX/2); n++) {
+    		pwm_timer_refs[n] = 0;
+    	}
     	pwm_is_init = 1;
     }
     // start the PWM running for this channel
@@ -307,6 +480,7 @@ STATIC mp_obj_t esp32_pwm_deinit(mp_obj_t self_in)
         // Mark it unused, and tell the hardware to stop routing
         pwm_channels[chan] = NULL;
         ledc_stop(PWMODE, chan, 0);
+        pwm_timer_put(self->timer);
         self->active = 0;
         self->channel = -1;
     }
@@ -328,8 +502,9 @@ STATIC mp_obj_t esp32_pwm_freq(size_t n_args, const mp_obj_t *args)
     // set the frequency
     int new_freq = mp_obj_get_int(args[1]);
     if (new_freq != curr_freq) {
-		if (!set_freq(self, new_freq)) {
-			nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Bad frequency %d", new_freq));
+		int err = pwm_set_channel_freq(self, new_freq);
+		if (err != 0) {
+			pwm_raise_freq(err, new_freq);
 		}
     }
     return mp_const_none;
@@ -388,6 +563,14 @@ STATIC mp_obj_t esp32_pwm_list()
 			mp_printf(&mp_plat_print, "\n");
 		}
 	}
+	for (int n=0; n<(LEDC_CHANNEL_MAX/2); n++) {
+		if (pwm_timer_refs[n]) {
+			mp_printf(&mp_plat_print, "Timer %d: freq=%u Hz, duty resolution=%d bits, channels=%d\n",
+					n, pwm_timers[n].freq_hz, pwm_timers[n].duty_resolution, pwm_timer_refs[n]);
+		} else {
+			mp_printf(&mp_plat_print, "Timer %d: free\n", n);
+		}
+	}
 
     return mp_const_none;
 }
@@ -395,6 +578,36 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_0(esp32_pwm_list_obj, esp32_pwm_list);
 
 
 
+// ==== C API for drivers that retune a channel outside the VM ====
+
+//---------------------------------------------
+int machine_pwm_get_channel(mp_obj_t pwm_in)
+{
+    if (!mp_obj_is_type(pwm_in, &machine_pwm_type)) {
+        mp_raise_TypeError("expecting a PWM object");
+    }
+    esp32_pwm_obj_t *self = MP_OBJ_TO_PTR(pwm_in);
+    if (!self->active || self->channel >= LEDC_CHANNEL_MAX) {
+        return -1;
+    }
+    return self->channel;
+}
+
+//-----------------------------------------------------------------
+bool machine_pwm_set_tone(int channel, int freq, float dperc)
+{
+    esp32_pwm_obj_t *self = pwm_channels[channel];
+    if (self == NULL) {
+        return false;
+    }
+    if ((freq > 0) && (pwm_set_channel_freq(self, freq) != 0)) {
+        return false;
+    }
+    ledc_set_duty(PWMODE, channel, (freq > 0) ? perc2duty(self, dperc) : 0);
+    ledc_update_duty(PWMODE, channel);
+    return true;
+}
+
 //==============================================================
 STATIC const mp_rom_map_elem_t esp32_pwm_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&esp32_pwm_init_obj) },
@@ -415,3 +628,216 @@ const mp_obj_type_t machine_pwm_type = {
     .make_new = esp32_pwm_make_new,
     .locals_dict = (mp_obj_dict_t*)&esp32_pwm_locals_dict,
 };
+
+
+// ==== PWMGroup: update the duty of several channels together ====
+//
+// ledc_set_duty() only loads a new duty into the channel registers; it is
+// latched when ledc_update_duty() sets the channel's duty_start bit and the
+// channel's timer next wraps.  A group loads every duty first and then sets
+// all the duty_start bits with interrupts off, so the channels of a group
+// that share a timer switch in the same PWM period.  sync() restarts the
+// group's timers together so that channels on different timers stay in
+// phase as well.
+
+typedef struct _machine_pwm_group_obj_t {
+    mp_obj_base_t base;
+    size_t len;
+    esp32_pwm_obj_t *pwm[];
+} machine_pwm_group_obj_t;
+
+STATIC portMUX_TYPE pwm_group_mux = portMUX_INITIALIZER_UNLOCKED;
+STATIC bool pwm_fade_installed = false;
+
+STATIC void machine_pwm_group_check(machine_pwm_group_obj_t *self);
+
+//-------------------------------------------------------------------------------------------------------------
+STATIC mp_obj_t machine_pwm_group_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args)
+{
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    size_t len;
+    mp_obj_t *items;
+    mp_obj_get_array(args[0], &len, &items);
+    if (len == 0) {
+        mp_raise_ValueError("empty PWM group");
+    }
+
+    // active PWMs have distinct channels, so the group checks below also
+    // keep len within LEDC_CHANNEL_MAX
+    machine_pwm_group_obj_t *self = m_new_obj_var(machine_pwm_group_obj_t, esp32_pwm_obj_t*, len);
+    self->base.type = type;
+    self->len = len;
+    for (size_t i = 0; i < len; i++) {
+        machine_pwm_get_channel(items[i]); // type check
+        self->pwm[i] = MP_OBJ_TO_PTR(items[i]);
+        for (size_t j = 0; j < i; j++) {
+            if (self->pwm[j] == self->pwm[i]) {
+                mp_raise_ValueError("PWM given twice");
+            }
+        }
+    }
+    machine_pwm_group_check(self);
+    return MP_OBJ_FROM_PTR(self);
+}
+
+//----------------------------------------------------------------------------------------------
+STATIC void machine_pwm_group_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind)
+{
+    machine_pwm_group_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "PWMGroup(pins:");
+    for (size_t i = 0; i < self->len; i++) {
+        mp_printf(print, "%s %u", (i == 0) ? "" : ",", self->pwm[i]->pin);
+    }
+    mp_printf(print, ")");
+}
+
+// Every PWM of the group must still be running
+//-------------------------------------------------------------------
+STATIC void machine_pwm_group_check(machine_pwm_group_obj_t *self)
+{
+    for (size_t i = 0; i < self->len; i++) {
+        if (!self->pwm[i]->active || (self->pwm[i]->channel >= LEDC_CHANNEL_MAX)) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "PWM on pin %d is not active", self->pwm[i]->pin));
+        }
+    }
+}
+
+// Convert one duty (0 ~ 100 %) for all channels, or one per channel, to raw duties
+//-------------------------------------------------------------------------------------------------
+STATIC void machine_pwm_group_get_duty(machine_pwm_group_obj_t *self, mp_obj_t duty_in, uint32_t *duty)
+{
+    mp_obj_t *items = NULL;
+    if (!mp_obj_is_int(duty_in) && !mp_obj_is_float(duty_in)) {
+        size_t len;
+        mp_obj_get_array(duty_in, &len, &items);
+        if (len != self->len) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "expecting %d duties", self->len));
+        }
+    }
+    for (size_t i = 0; i < self->len; i++) {
+        float dperc = mp_obj_get_float((items != NULL) ? items[i] : duty_in);
+        if ((dperc < 0) || (dperc > 100.0)) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Bad duty %.2f, use 0 ~ 100 (%%)", dperc));
+        }
+        duty[i] = perc2duty(self->pwm[i], dperc);
+    }
+}
+
+//-----------------------------------------------------------------------
+STATIC mp_obj_t machine_pwm_group_duty(size_t n_args, const mp_obj_t *args)
+{
+    machine_pwm_group_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    machine_pwm_group_check(self);
+
+    if (n_args == 1) {
+        // get and return the duty cycles
+        mp_obj_t tuple[LEDC_CHANNEL_MAX];
+        for (size_t i = 0; i < self->len; i++) {
+            int duty = ledc_get_duty(PWMODE, self->pwm[i]->channel);
+            tuple[i] = mp_obj_new_float(duty2perc(self->pwm[i], duty));
+        }
+        return mp_obj_new_tuple(self->len, tuple);
+    }
+
+    uint32_t duty[LEDC_CHANNEL_MAX];
+    machine_pwm_group_get_duty(self, args[1], duty);
+    for (size_t i = 0; i < self->len; i++) {
+        ledc_set_duty(PWMODE, self->pwm[i]->channel, duty[i]);
+    }
+    portENTER_CRITICAL(&pwm_group_mux);
+    for (size_t i = 0; i < self->len; i++) {
+        ledc_update_duty(PWMODE, self->pwm[i]->channel);
+    }
+    portEXIT_CRITICAL(&pwm_group_mux);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_pwm_group_duty_obj, 1, 2, machine_pwm_group_duty);
+
+// fade(duty, time_ms, *, wait=False)
+// Ramp the channels in hardware to the new duties over time_ms.  The fades are
+// started one after another, which takes a few microseconds per channel, so
+// in practice they all begin in the same PWM period.
+//-------------------------------------------------------------------------------------------
+STATIC mp_obj_t machine_pwm_group_fade(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
+{
+    enum { ARG_duty, ARG_time_ms, ARG_wait };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_duty, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_time_ms, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    machine_pwm_group_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    machine_pwm_group_check(self);
+    int time_ms = args[ARG_time_ms].u_int;
+    if (time_ms <= 0) {
+        mp_raise_ValueError("fade time must be positive");
+    }
+    uint32_t duty[LEDC_CHANNEL_MAX];
+    machine_pwm_group_get_duty(self, args[ARG_duty].u_obj, duty);
+
+    if (!pwm_fade_installed) {
+        esp_err_t err = ledc_fade_func_install(0);
+        if ((err != ESP_OK) && (err != ESP_ERR_INVALID_STATE)) {
+            mp_raise_msg(&mp_type_OSError, "Error installing pwm fade service");
+        }
+        pwm_fade_installed = true;
+    }
+
+    for (size_t i = 0; i < self->len; i++) {
+        if (ledc_set_fade_with_time(PWMODE, self->pwm[i]->channel, duty[i], time_ms) != ESP_OK) {
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError, "Error setting fade for pin %d", self->pwm[i]->pin));
+        }
+    }
+    for (size_t i = 0; i < self->len; i++) {
+        ledc_fade_start(PWMODE, self->pwm[i]->channel, LEDC_FADE_NO_WAIT);
+    }
+
+    if (args[ARG_wait].u_bool) {
+        mp_hal_delay_ms(time_ms);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_pwm_group_fade_obj, 1, machine_pwm_group_fade);
+
+//------------------------------------------------------
+STATIC mp_obj_t machine_pwm_group_sync(mp_obj_t self_in)
+{
+    machine_pwm_group_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    machine_pwm_group_check(self);
+
+    uint8_t timers = 0;
+    for (size_t i = 0; i < self->len; i++) {
+        timers |= 1 << pwm_timers[self->pwm[i]->timer].timer_num;
+    }
+    portENTER_CRITICAL(&pwm_group_mux);
+    for (int n = 0; n < LEDC_TIMER_MAX; n++) {
+        if (timers & (1 << n)) {
+            ledc_timer_rst(PWMODE, n);
+        }
+    }
+    portEXIT_CRITICAL(&pwm_group_mux);
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_pwm_group_sync_obj, machine_pwm_group_sync);
+
+//====================================================================
+STATIC const mp_rom_map_elem_t machine_pwm_group_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_duty), MP_ROM_PTR(&machine_pwm_group_duty_obj) },
+    { MP_ROM_QSTR(MP_QSTR_fade), MP_ROM_PTR(&machine_pwm_group_fade_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sync), MP_ROM_PTR(&machine_pwm_group_sync_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(machine_pwm_group_locals_dict, machine_pwm_group_locals_dict_table);
+
+//============================================
+const mp_obj_type_t machine_pwm_group_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_PWMGroup,
+    .print = machine_pwm_group_print,
+    .make_new = machine_pwm_group_make_new,
+    .locals_dict = (mp_obj_dict_t*)&machine_pwm_group_locals_dict,
+};
@@ -36,6 +36,8 @@
 #include "py/obj.h"
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/binary.h"
+#include "py/objarray.h"
 #include "timeutils.h"
 #include "modmachine.h"
 #include "machine_rtc.h"
@@ -56,6 +58,25 @@ RTC_DATA_ATTR uint32_t rtc_user_mem_magic;
 RTC_DATA_ATTR uint32_t rtc_user_mem_len;
 RTC_DATA_ATTR uint8_t rtc_user_mem_data[MEM_USER_MAXLEN];
 
+// Named buffers for RTC.buffer() are allocated one after the other from their
+// own pool, each a header and then the items rounded up to a word.  They are
+// never freed one by one, only all together by RTC.clear_buffers().
+#define BUF_MAGIC           0x75507922
+#define BUF_POOL_LEN        1024
+#define BUF_NAME_MAXLEN     15
+
+typedef struct _rtc_buf_hdr_t {
+    uint8_t name_len;
+    char name[BUF_NAME_MAXLEN];
+    uint16_t nitems;
+    uint8_t typecode;
+    uint8_t size;               // of the data in words, which fit in 8 bits for this pool
+} rtc_buf_hdr_t;
+
+RTC_DATA_ATTR uint32_t rtc_buf_magic;
+RTC_DATA_ATTR uint32_t rtc_buf_used;
+RTC_DATA_ATTR uint32_t rtc_buf_pool[BUF_POOL_LEN / sizeof(uint32_t)];
+
 // singleton RTC object
 STATIC const machine_rtc_obj_t machine_rtc_obj = {{&machine_rtc_type}};
 
@@ -147,10 +168,104 @@ STATIC mp_obj_t machine_rtc_memory(mp_uint_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_rtc_memory_obj, 1, 2, machine_rtc_memory);
 
+STATIC void machine_rtc_buf_check(void) {
+    if (rtc_buf_magic != BUF_MAGIC || rtc_buf_used > BUF_POOL_LEN) {
+        // cold boot
+        rtc_buf_magic = BUF_MAGIC;
+        rtc_buf_used = 0;
+    }
+}
+
+STATIC mp_obj_t machine_rtc_buf_view(rtc_buf_hdr_t *hdr) {
+    return mp_obj_new_memoryview(hdr->typecode | MP_OBJ_ARRAY_TYPECODE_FLAG_RW, hdr->nitems, hdr + 1);
+}
+
+// rtc.buffer(name, [size, [typecode='B']])
+// Return a writable memoryview of the buffer called name in RTC slow memory,
+// which keeps its contents through deep sleep.  The buffer is created, zeroed,
+// with size items of typecode the first time; later calls, also after waking,
+// give the same memory.
+STATIC mp_obj_t machine_rtc_buffer(size_t n_args, const mp_obj_t *args) {
+    size_t name_len;
+    const char *name = mp_obj_str_get_data(args[1], &name_len);
+    if (name_len == 0 || name_len > BUF_NAME_MAXLEN) {
+        mp_raise_ValueError("bad name");
+    }
+    char typecode = 'B';
+    if (n_args > 3) {
+        const char *tc = mp_obj_str_get_str(args[3]);
+        typecode = tc[0];
+        if (tc[0] == '\0' || tc[1] != '\0' || strchr("bBhHiIlLqQfd", typecode) == NULL) {
+            mp_raise_ValueError("bad typecode");
+        }
+    }
+
+    machine_rtc_buf_check();
+    uint8_t *pool = (uint8_t*)rtc_buf_pool;
+    for (uint32_t off = 0; off < rtc_buf_used;) {
+        rtc_buf_hdr_t *hdr = (rtc_buf_hdr_t*)(pool + off);
+        if (hdr->name_len == name_len && memcmp(hdr->name, name, name_len) == 0) {
+            if (n_args > 2 && (hdr->nitems != mp_obj_get_int(args[2]) || hdr->typecode != typecode)) {
+                mp_raise_ValueError("buffer exists with another size");
+            }
+            return machine_rtc_buf_view(hdr);
+        }
+        off += sizeof(rtc_buf_hdr_t) + hdr->size * sizeof(uint32_t);
+    }
+    if (n_args == 2) {
+        nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, args[1]));
+    }
+
+    mp_int_t nitems = mp_obj_get_int(args[2]);
+    size_t bytes = nitems * mp_binary_get_size('@', typecode, NULL);
+    size_t words = (bytes + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+    if (nitems <= 0 || nitems > 0xffff
+        || rtc_buf_used + sizeof(rtc_buf_hdr_t) + words * sizeof(uint32_t) > BUF_POOL_LEN) {
+        mp_raise_ValueError("buffer too long");
+    }
+    rtc_buf_hdr_t *hdr = (rtc_buf_hdr_t*)(pool + rtc_buf_used);
+    memset(hdr, 0, sizeof(rtc_buf_hdr_t) + words * sizeof(uint32_t));
+    hdr->name_len = name_len;
+    memcpy(hdr->name, name, name_len);
+    hdr->nitems = nitems;
+    hdr->typecode = typecode;
+    hdr->size = words;
+    rtc_buf_used += sizeof(rtc_buf_hdr_t) + words * sizeof(uint32_t);
+    return machine_rtc_buf_view(hdr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_rtc_buffer_obj, 2, 4, machine_rtc_buffer);
+
+// rtc.buffers()
+// Return the names of the buffers in RTC memory.
+STATIC mp_obj_t machine_rtc_buffers(mp_obj_t self_in) {
+    machine_rtc_buf_check();
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    uint8_t *pool = (uint8_t*)rtc_buf_pool;
+    for (uint32_t off = 0; off < rtc_buf_used;) {
+        rtc_buf_hdr_t *hdr = (rtc_buf_hdr_t*)(pool + off);
+        mp_obj_list_append(list, mp_obj_new_str(hdr->name, hdr->name_len));
+        off += sizeof(rtc_buf_hdr_t) + hdr->size * sizeof(uint32_t);
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_rtc_buffers_obj, machine_rtc_buffers);
+
+// rtc.clear_buffers()
+// Free all buffers; memoryviews of them must not be used afterwards.
+STATIC mp_obj_t machine_rtc_clear_buffers(mp_obj_t self_in) {
+    rtc_buf_magic = BUF_MAGIC;
+    rtc_buf_used = 0;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_rtc_clear_buffers_obj, machine_rtc_clear_buffers);
+
 STATIC const mp_rom_map_elem_t machine_rtc_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_rtc_init_obj) },
     { MP_ROM_QSTR(MP_QSTR_datetime), MP_ROM_PTR(&machine_rtc_datetime_obj) },
     { MP_ROM_QSTR(MP_QSTR_memory), MP_ROM_PTR(&machine_rtc_memory_obj) },
+    { MP_ROM_QSTR(MP_QSTR_buffer), MP_ROM_PTR(&machine_rtc_buffer_obj) },
+    { MP_ROM_QSTR(MP_QSTR_buffers), MP_ROM_PTR(&machine_rtc_buffers_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clear_buffers), MP_ROM_PTR(&machine_rtc_clear_buffers_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(machine_rtc_locals_dict, machine_rtc_locals_dict_table);
 
@@ -31,8 +31,11 @@
 #include <stdio.h>
 
 #include "driver/timer.h"
+#include "esp_timer.h"
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/gc.h"
+#include "py/mpthread.h"
 #include "modmachine.h"
 #include "mphalport.h"
 
@@ -44,6 +47,17 @@
 
 #define TIMER_FLAGS    0
 
+// Timer(-1) is backed by an esp_timer rather than a hardware timer
+#define TIMER_ID_ESP_TIMER (-1)
+
+// C stack a hard callback may use; the ISR stack is raised to 4k in the
+// sdkconfig and the esp_timer task has a little more than that
+#define TIMER_HARD_STACK   (2048)
+
+// pystack for a hard callback, which must not touch that of the thread whose
+// state it borrows
+#define TIMER_HARD_PYSTACK (512)
+
 typedef struct _machine_timer_obj_t {
     mp_obj_base_t base;
     mp_uint_t group;
@@ -54,9 +68,14 @@ typedef struct _machine_timer_obj_t {
     uint64_t period;
 
     mp_obj_t callback;
+    bool hard;
 
     intr_handle_t handle;
 
+    // used by Timer(-1) only
+    esp_timer_handle_t esp_timer;
+    int64_t start_us;
+
     struct _machine_timer_obj_t *next;
 } machine_timer_obj_t;
 
@@ -81,6 +100,12 @@ void machine_timer_deinit_all(void) {
 STATIC void machine_timer_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     machine_timer_obj_t *self = self_in;
 
+    if (self->group == TIMER_ID_ESP_TIMER) {
+        mp_printf(print, "Timer(%p; esp_timer, running=%d, period=%u us, periodic=%d, hard=%d)", self,
+            self->esp_timer != NULL, (uint32_t)(self->period / (TIMER_SCALE / 1000000)), self->repeat, self->hard);
+        return;
+    }
+
     timer_config_t config;
     mp_printf(print, "Timer(%p; ", self);
 
@@ -96,14 +121,25 @@ STATIC mp_obj_t machine_timer_make_new(const mp_obj_type_t *type, size_t n_args,
     machine_timer_obj_t *self = m_new_obj(machine_timer_obj_t);
     self->base.type = &machine_timer_type;
 
-    self->group = (mp_obj_get_int(args[0]) >> 1) & 1;
-    self->index = mp_obj_get_int(args[0]) & 1;
+    mp_int_t id = mp_obj_get_int(args[0]);
+    if (id == TIMER_ID_ESP_TIMER) {
+        self->group = TIMER_ID_ESP_TIMER;
+        self->index = 0;
+    } else {
+        self->group = (id >> 1) & 1;
+        self->index = id & 1;
+    }
     self->next = NULL;
 
     return self;
 }
 
 STATIC void machine_timer_disable(machine_timer_obj_t *self) {
+    if (self->esp_timer) {
+        esp_timer_stop(self->esp_timer);
+        esp_timer_delete(self->esp_timer);
+        self->esp_timer = NULL;
+    }
     if (self->handle) {
         timer_pause(self->group, self->index);
         esp_intr_free(self->handle);
@@ -119,6 +155,70 @@ STATIC void machine_timer_disable(machine_timer_obj_t *self) {
     }
 }
 
+STATIC mp_obj_t machine_timer_hard_error(mp_obj_t exc) {
+    mp_printf(&mp_plat_print, "uncaught exception in hard Timer callback\n");
+    mp_obj_print_exception(&mp_plat_print, exc);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_timer_hard_error_obj, machine_timer_hard_error);
+
+// Run a hard callback right here, in the timer ISR or the esp_timer task,
+// the way stm32 runs hard IRQs: the scheduler and the heap are locked, so
+// the callback runs to completion and cannot allocate.  It borrows the VM
+// state of the interrupted MicroPython thread, or a copy of that of the main
+// thread if the interrupted task is not one, with the stack check and the
+// pystack moved to this stack.
+// Nothing here may block or print, so an exception drops the callback and
+// is reported from the scheduler instead.
+STATIC void machine_timer_hard_call(machine_timer_obj_t *self) {
+    mp_state_thread_t *ts = mp_thread_get_state();
+    bool borrowed = (ts == NULL);
+    mp_state_thread_t ts_copy;
+    if (borrowed) {
+        // the main thread may be running on the other core
+        ts_copy = mp_state_ctx.thread;
+        ts = &ts_copy;
+        mp_thread_set_state(ts);
+    }
+    char *stack_top = ts->stack_top;
+    size_t stack_limit = ts->stack_limit;
+    volatile int sp = 0;
+    ts->stack_top = (char*)&sp;
+    ts->stack_limit = TIMER_HARD_STACK;
+    #if MICROPY_ENABLE_PYSTACK
+    uint8_t *pystack_start = ts->pystack_start;
+    uint8_t *pystack_end = ts->pystack_end;
+    uint8_t *pystack_cur = ts->pystack_cur;
+    mp_obj_t pystack[TIMER_HARD_PYSTACK / sizeof(mp_obj_t)];
+    ts->pystack_start = ts->pystack_cur = (uint8_t*)pystack;
+    ts->pystack_end = (uint8_t*)&pystack[MP_ARRAY_SIZE(pystack)];
+    #endif
+
+    mp_sched_lock();
+    gc_lock();
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        mp_call_function_1(self->callback, MP_OBJ_FROM_PTR(self));
+        nlr_pop();
+    } else {
+        self->callback = mp_const_none;
+        mp_sched_schedule(MP_OBJ_FROM_PTR(&machine_timer_hard_error_obj), MP_OBJ_FROM_PTR(nlr.ret_val));
+    }
+    gc_unlock();
+    mp_sched_unlock();
+
+    ts->stack_top = stack_top;
+    ts->stack_limit = stack_limit;
+    #if MICROPY_ENABLE_PYSTACK
+    ts->pystack_start = pystack_start;
+    ts->pystack_end = pystack_end;
+    ts->pystack_cur = pystack_cur;
+    #endif
+    if (borrowed) {
+        mp_thread_set_state(NULL);
+    }
+}
+
 STATIC void machine_timer_isr(void *self_in) {
     machine_timer_obj_t *self = self_in;
     timg_dev_t *device = self->group ? &(TIMERG1) : &(TIMERG0);
@@ -131,11 +231,63 @@ STATIC void machine_timer_isr(void *self_in) {
     }
     device->hw_timer[self->index].config.alarm_en = self->repeat;
 
-    mp_sched_schedule(self->callback, self);
-    mp_hal_wake_main_task_from_isr();
+    if (self->hard) {
+        if (self->callback != mp_const_none) {
+            machine_timer_hard_call(self);
+        }
+    } else {
+        mp_sched_schedule_prio(self->callback, self, MP_SCHED_PRIO_HIGH);
+        mp_hal_wake_main_task_from_isr();
+    }
+}
+
+// Timer(-1): called from the esp_timer task
+STATIC void machine_timer_esp_timer_cb(void *self_in) {
+    machine_timer_obj_t *self = self_in;
+
+    if (self->hard) {
+        if (self->callback != mp_const_none) {
+            machine_timer_hard_call(self);
+        }
+    } else {
+        mp_sched_schedule_prio(self->callback, self, MP_SCHED_PRIO_HIGH);
+        xTaskNotifyGive(mp_main_task_handle);
+    }
+}
+
+STATIC void machine_timer_esp_timer_enable(machine_timer_obj_t *self) {
+    esp_timer_create_args_t args = {
+        .callback = machine_timer_esp_timer_cb,
+        .arg = self,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "machine.Timer",
+    };
+    uint64_t period_us = self->period / (TIMER_SCALE / 1000000);
+    if (self->repeat && (period_us < 50)) {
+        // esp_timer's shortest period
+        mp_raise_ValueError("period too short, 50 us minimum");
+    }
+    check_esp_err(esp_timer_create(&args, &self->esp_timer));
+
+    // Add the timer to the linked-list of active timers first, so that
+    // machine_timer_disable releases the esp_timer if starting fails
+    self->next = MP_STATE_PORT(machine_timer_obj_head);
+    MP_STATE_PORT(machine_timer_obj_head) = self;
+
+    self->start_us = esp_timer_get_time();
+    if (self->repeat) {
+        check_esp_err(esp_timer_start_periodic(self->esp_timer, period_us));
+    } else {
+        check_esp_err(esp_timer_start_once(self->esp_timer, period_us));
+    }
 }
 
 STATIC void machine_timer_enable(machine_timer_obj_t *self) {
+    if (self->group == TIMER_ID_ESP_TIMER) {
+        machine_timer_esp_timer_enable(self);
+        return;
+    }
+
     timer_config_t config;
     config.alarm_en = TIMER_ALARM_EN;
     config.auto_reload = self->repeat;
@@ -163,6 +315,7 @@ STATIC mp_obj_t machine_timer_init_helper(machine_timer_obj_t *self, mp_uint_t n
         ARG_period,
         ARG_tick_hz,
         ARG_freq,
+        ARG_hard,
     };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_mode,         MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
@@ -174,6 +327,7 @@ STATIC mp_obj_t machine_timer_init_helper(machine_timer_obj_t *self, mp_uint_t n
 #else
         { MP_QSTR_freq,         MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0xffffffff} },
 #endif
+        { MP_QSTR_hard,         MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
     };
 
     machine_timer_disable(self);
@@ -196,7 +350,9 @@ STATIC mp_obj_t machine_timer_init_helper(machine_timer_obj_t *self, mp_uint_t n
 
     self->repeat = args[ARG_mode].u_int;
     self->callback = args[ARG_callback].u_obj;
+    self->hard = args[ARG_hard].u_bool;
     self->handle = NULL;
+    self->esp_timer = NULL;
 
     machine_timer_enable(self);
 
@@ -219,6 +375,15 @@ STATIC mp_obj_t machine_timer_value(mp_obj_t self_in) {
     machine_timer_obj_t *self = self_in;
     double result;
 
+    if (self->group == TIMER_ID_ESP_TIMER) {
+        uint64_t elapsed = esp_timer_get_time() - self->start_us;
+        uint64_t period_us = self->period / (TIMER_SCALE / 1000000);
+        if (self->repeat && (period_us > 0)) {
+            elapsed %= period_us;
+        }
+        return MP_OBJ_NEW_SMALL_INT((mp_uint_t)(elapsed / 1000));  // value in ms
+    }
+
     timer_get_counter_time_sec(self->group, self->index, &result);
 
     return MP_OBJ_NEW_SMALL_INT((mp_uint_t)(result * 1000));  // value in ms
@@ -26,6 +26,7 @@
 
 
 #include <stdio.h>
+#include <string.h>
 
 #include "esp_log.h"
 
@@ -36,6 +37,9 @@
 #include "py/mphal.h"
 #include "modmachine.h"
 
+// Period of the IIR filter started by TouchPad.filter(), in ms
+#define MTP_FILTER_PERIOD_DEFAULT (10)
+
 typedef struct _mtp_obj_t {
     mp_obj_base_t base;
     gpio_num_t gpio_id;
@@ -55,6 +59,59 @@ STATIC const mtp_obj_t touchpad_obj[] = {
     {{&machine_touchpad_type}, GPIO_NUM_32, TOUCH_PAD_NUM9},
 };
 
+STATIC uint16_t mtp_configured;             // bit per touchpad_id
+STATIC uint16_t mtp_irq_enabled;
+STATIC volatile uint16_t mtp_irq_pending;   // handler scheduled but not run yet
+STATIC bool mtp_filter_running;
+STATIC bool mtp_isr_installed;
+
+STATIC esp_err_t mtp_read_value(touch_pad_t pad, uint16_t *value) {
+    if (mtp_filter_running) {
+        return touch_pad_read_filtered(pad, value);
+    }
+    return touch_pad_read(pad, value);
+}
+
+// Runs from the scheduler for a pad whose interrupt has fired, so at most one
+// call per pad is queued however often the pad is measured while touched.
+STATIC mp_obj_t mtp_irq_dispatch(mp_obj_t pad_in) {
+    mp_int_t pad = MP_OBJ_SMALL_INT_VALUE(pad_in);
+    mtp_irq_pending &= ~(1 << pad);
+    mp_obj_t handler = MP_STATE_PORT(machine_touchpad_irq_handler)[pad];
+    if (handler != MP_OBJ_NULL) {
+        mp_call_function_1(handler, MP_OBJ_FROM_PTR(&touchpad_obj[pad]));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mtp_irq_dispatch_obj, mtp_irq_dispatch);
+
+STATIC void mtp_isr_handler(void *arg) {
+    uint32_t status = touch_pad_get_status();
+    touch_pad_clear_status();
+    uint16_t fire = status & mtp_irq_enabled & ~mtp_irq_pending;
+    for (int pad = 0; fire != 0; ++pad, fire >>= 1) {
+        if ((fire & 1) && mp_sched_schedule(MP_OBJ_FROM_PTR(&mtp_irq_dispatch_obj), MP_OBJ_NEW_SMALL_INT(pad))) {
+            mtp_irq_pending |= 1 << pad;
+        }
+    }
+    mp_hal_wake_main_task_from_isr();
+}
+
+void machine_touchpad_deinit(void) {
+    if (mtp_isr_installed) {
+        touch_pad_intr_disable();
+        touch_pad_isr_deregister(mtp_isr_handler, NULL);
+        mtp_isr_installed = false;
+    }
+    if (mtp_filter_running) {
+        touch_pad_filter_stop();
+        mtp_filter_running = false;
+    }
+    mtp_irq_enabled = 0;
+    mtp_irq_pending = 0;
+    memset(MP_STATE_PORT(machine_touchpad_irq_handler), 0, sizeof(MP_STATE_PORT(machine_touchpad_irq_handler)));
+}
+
 STATIC mp_obj_t mtp_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw,
         const mp_obj_t *args) {
 
@@ -72,7 +129,10 @@ STATIC mp_obj_t mtp_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_
         initialized = 1;
     }
     esp_err_t err = touch_pad_config(self->touchpad_id, 0);
-    if (err == ESP_OK) return MP_OBJ_FROM_PTR(self);
+    if (err == ESP_OK) {
+        mtp_configured |= 1 << self->touchpad_id;
+        return MP_OBJ_FROM_PTR(self);
+    }
     mp_raise_ValueError("Touch pad error");
 }
 
@@ -88,16 +148,100 @@ MP_DEFINE_CONST_FUN_OBJ_2(mtp_config_obj, mtp_config);
 STATIC mp_obj_t mtp_read(mp_obj_t self_in) {
     mtp_obj_t *self = self_in;
     uint16_t value;
-    esp_err_t err = touch_pad_read(self->touchpad_id, &value);
+    esp_err_t err = mtp_read_value(self->touchpad_id, &value);
     if (err == ESP_OK) return MP_OBJ_NEW_SMALL_INT(value);
     mp_raise_ValueError("Touch pad error");
 }
 MP_DEFINE_CONST_FUN_OBJ_1(mtp_read_obj, mtp_read);
 
+// TouchPad.read_all(buf)
+// Store the reading of every pad that has been constructed into buf, an
+// array of 16-bit values indexed by touch pad number (0-9), and return a
+// bitmask of the pads stored.
+STATIC mp_obj_t mtp_read_all(mp_obj_t buf_in) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    uint16_t *buf = bufinfo.buf;
+    size_t len = bufinfo.len / sizeof(uint16_t);
+    uint16_t done = 0;
+    for (size_t pad = 0; pad < len && pad < TOUCH_PAD_MAX; ++pad) {
+        if ((mtp_configured & (1 << pad)) && mtp_read_value(pad, &buf[pad]) == ESP_OK) {
+            done |= 1 << pad;
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(done);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mtp_read_all_fun_obj, mtp_read_all);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(mtp_read_all_obj, MP_ROM_PTR(&mtp_read_all_fun_obj));
+
+// TouchPad.filter([period_ms])
+// Start the IDF's IIR filter, which measures all pads every period_ms in the
+// background, after which read() and read_all() return filtered values.  A
+// period of 0 stops it again.
+STATIC mp_obj_t mtp_filter(size_t n_args, const mp_obj_t *args) {
+    mp_int_t period = n_args > 0 ? mp_obj_get_int(args[0]) : MTP_FILTER_PERIOD_DEFAULT;
+    if (mtp_filter_running) {
+        touch_pad_filter_stop();
+        mtp_filter_running = false;
+    }
+    if (period > 0) {
+        if (touch_pad_filter_start(period) != ESP_OK) {
+            mp_raise_ValueError("Touch pad error");
+        }
+        mtp_filter_running = true;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mtp_filter_fun_obj, 0, 1, mtp_filter);
+STATIC MP_DEFINE_CONST_STATICMETHOD_OBJ(mtp_filter_obj, MP_ROM_PTR(&mtp_filter_fun_obj));
+
+// touchpad.irq(handler=None, threshold=0)
+// Call handler(touchpad) when a reading drops below threshold.  The pad keeps
+// interrupting while it is touched, but a new call is only queued once the
+// previous one has run.
+STATIC mp_obj_t mtp_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_handler, ARG_threshold };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_handler, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_threshold, MP_ARG_INT, {.u_int = 0} },
+    };
+    const mtp_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    touch_pad_t pad = self->touchpad_id;
+    mp_obj_t handler = args[ARG_handler].u_obj;
+    if (handler == mp_const_none) {
+        mtp_irq_enabled &= ~(1 << pad);
+        MP_STATE_PORT(machine_touchpad_irq_handler)[pad] = MP_OBJ_NULL;
+        return mp_const_none;
+    }
+    if (!mp_obj_is_callable(handler)) {
+        mp_raise_ValueError("handler must be callable");
+    }
+    if (touch_pad_set_thresh(pad, args[ARG_threshold].u_int) != ESP_OK) {
+        mp_raise_ValueError("Touch pad error");
+    }
+    if (!mtp_isr_installed) {
+        if (touch_pad_isr_register(mtp_isr_handler, NULL) != ESP_OK) {
+            mp_raise_ValueError("Touch pad error");
+        }
+        touch_pad_intr_enable();
+        mtp_isr_installed = true;
+    }
+    MP_STATE_PORT(machine_touchpad_irq_handler)[pad] = handler;
+    mtp_irq_enabled |= 1 << pad;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mtp_irq_obj, 1, mtp_irq);
+
 STATIC const mp_rom_map_elem_t mtp_locals_dict_table[] = {
     // instance methods
     { MP_ROM_QSTR(MP_QSTR_config), MP_ROM_PTR(&mtp_config_obj) },
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mtp_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&mtp_irq_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read_all), MP_ROM_PTR(&mtp_read_all_obj) },
+    { MP_ROM_QSTR(MP_QSTR_filter), MP_ROM_PTR(&mtp_filter_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(mtp_locals_dict, mtp_locals_dict_table);
@@ -30,12 +30,27 @@
 
 #include "driver/uart.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_task.h"
 
 #include "py/runtime.h"
 #include "py/stream.h"
 #include "py/mperrno.h"
+#include "py/mphal.h"
 #include "modmachine.h"
 
+// Triggers for UART.irq()
+#define UART_IRQ_RX         (0x01)  // data arrived, reported when the line goes idle or the FIFO fills
+#define UART_IRQ_PATTERN    (0x02)  // the pattern given to irq() was received
+#define UART_IRQ_OVERFLOW   (0x04)  // the FIFO or the RX buffer overflowed, data was lost
+#define UART_IRQ_BREAK      (0x08)  // a break was received
+
+#define UART_EVENT_QUEUE_LEN    (16)
+#define UART_PATTERN_QUEUE_LEN  (16)
+#define UART_EVENT_TASK_STACK   (2048)
+#define UART_EVENT_TASK_PRIO    (ESP_TASK_PRIO_MIN + 2)
+
 typedef struct _machine_uart_obj_t {
     mp_obj_base_t base;
     uart_port_t uart_num;
@@ -46,14 +61,46 @@ typedef struct _machine_uart_obj_t {
     int8_t rx;
     int8_t rts;
     int8_t cts;
-    uint16_t txbuf;
-    uint16_t rxbuf;
+    uint32_t txbuf;
+    uint32_t rxbuf;
     uint16_t timeout;       // timeout waiting for first char (in ms)
     uint16_t timeout_char;  // timeout waiting between chars (in ms)
+
+    // irq(): the driver's events are taken off its queue by event_task,
+    // which collects them in irq_flags and schedules one handler call at
+    // a time
+    QueueHandle_t event_queue;
+    TaskHandle_t event_task;
+    mp_obj_t irq_handler;
+    uint8_t irq_trigger;
+    volatile uint8_t irq_flags;
+    volatile bool irq_scheduled;
+    int16_t pattern;        // pattern character, or -1
+    uint8_t pattern_count;
 } machine_uart_obj_t;
 
 STATIC const char *_parity_name[] = {"None", "1", "0"};
 
+STATIC void machine_uart_irq_stop(machine_uart_obj_t *self);
+STATIC void machine_uart_irq_start(machine_uart_obj_t *self);
+
+// (Re)install the driver; the RX buffer is a ring the ISR fills from the
+// FIFO, so it alone decides how long Python can leave the UART unread
+STATIC void machine_uart_driver_install(machine_uart_obj_t *self) {
+    bool irq = (self->event_task != NULL);
+    if (irq) {
+        machine_uart_irq_stop(self);
+    }
+    uart_driver_delete(self->uart_num);
+    if (uart_driver_install(self->uart_num, self->rxbuf, self->txbuf, UART_EVENT_QUEUE_LEN, &self->event_queue, 0) != ESP_OK) {
+        self->event_queue = NULL;
+        mp_raise_msg(&mp_type_OSError, "failed to install UART driver");
+    }
+    if (irq) {
+        machine_uart_irq_start(self);
+    }
+}
+
 /******************************************************************************/
 // MicroPython bindings for UART
 
@@ -85,6 +132,15 @@ STATIC void machine_uart_init_helper(machine_uart_obj_t *self, size_t n_args, co
     mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
     mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
 
+    // the driver needs an RX buffer bigger than the FIFO, and no TX buffer
+    // or one bigger than the FIFO
+    if ((args[ARG_rxbuf].u_int >= 0) && (args[ARG_rxbuf].u_int <= UART_FIFO_LEN)) {
+        mp_raise_ValueError("rxbuf must be larger than 128");
+    }
+    if ((args[ARG_txbuf].u_int > 0) && (args[ARG_txbuf].u_int <= UART_FIFO_LEN)) {
+        mp_raise_ValueError("txbuf must be 0 or larger than 128");
+    }
+
     // wait for all data to be transmitted before changing settings
     uart_wait_tx_done(self->uart_num, pdMS_TO_TICKS(1000));
 
@@ -106,9 +162,8 @@ STATIC void machine_uart_init_helper(machine_uart_obj_t *self, size_t n_args, co
         uart_get_word_length(self->uart_num, &uartcfg.data_bits);
         uart_get_parity(self->uart_num, &uartcfg.parity);
         uart_get_stop_bits(self->uart_num, &uartcfg.stop_bits);
-        uart_driver_delete(self->uart_num);
         uart_param_config(self->uart_num, &uartcfg);
-        uart_driver_install(self->uart_num, self->rxbuf, self->txbuf, 0, NULL, 0);
+        machine_uart_driver_install(self);
     }
 
     // set baudrate
@@ -245,6 +300,14 @@ STATIC mp_obj_t machine_uart_make_new(const mp_obj_type_t *type, size_t n_args,
     self->rxbuf = 256; // IDF minimum
     self->timeout = 0;
     self->timeout_char = 0;
+    self->event_queue = NULL;
+    self->event_task = NULL;
+    self->irq_handler = mp_const_none;
+    self->irq_trigger = 0;
+    self->irq_flags = 0;
+    self->irq_scheduled = false;
+    self->pattern = -1;
+    self->pattern_count = 1;
 
     switch (uart_num) {
         case UART_NUM_0:
@@ -261,14 +324,20 @@ STATIC mp_obj_t machine_uart_make_new(const mp_obj_type_t *type, size_t n_args,
             break;
     }
 
-    // Remove any existing configuration
+    // Remove any existing configuration, including the irq of another
+    // object for the same UART
+    machine_uart_obj_t *old = MP_STATE_PORT(machine_uart_obj_all)[uart_num];
+    if (old != NULL) {
+        machine_uart_irq_stop(old);
+        MP_STATE_PORT(machine_uart_obj_all)[uart_num] = NULL;
+    }
     uart_driver_delete(self->uart_num);
 
     // init the peripheral
     // Setup
     uart_param_config(self->uart_num, &uartcfg);
 
-    uart_driver_install(uart_num, self->rxbuf, self->txbuf, 0, NULL, 0);
+    machine_uart_driver_install(self);
 
     mp_map_t kw_args;
     mp_map_init_fixed_table(&kw_args, n_kw, args + n_args);
@@ -325,15 +394,180 @@ STATIC mp_obj_t machine_uart_sendbreak(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_uart_sendbreak_obj, machine_uart_sendbreak);
 
+STATIC mp_obj_t machine_uart_irq_dispatch(mp_obj_t self_in) {
+    machine_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    self->irq_scheduled = false;
+    if (self->irq_handler != mp_const_none) {
+        mp_call_function_1(self->irq_handler, self_in);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_uart_irq_dispatch_obj, machine_uart_irq_dispatch);
+
+STATIC void machine_uart_event_task(void *arg) {
+    machine_uart_obj_t *self = arg;
+    uart_event_t event;
+    for (;;) {
+        if (xQueueReceive(self->event_queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        uint8_t flags = 0;
+        switch (event.type) {
+            case UART_DATA:
+                flags = UART_IRQ_RX;
+                break;
+            case UART_PATTERN_DET:
+                // the positions are not used, keep their queue from filling
+                uart_pattern_pop_pos(self->uart_num);
+                flags = UART_IRQ_PATTERN;
+                break;
+            case UART_FIFO_OVF:
+            case UART_BUFFER_FULL:
+                flags = UART_IRQ_OVERFLOW;
+                break;
+            case UART_BREAK:
+                flags = UART_IRQ_BREAK;
+                break;
+            default:
+                break;
+        }
+        if (flags & (UART_IRQ_RX | UART_IRQ_PATTERN)) {
+            // wake up uselect.poll() and other waits on the main task
+            xTaskNotifyGive(mp_main_task_handle);
+        }
+        flags &= self->irq_trigger;
+        if (flags == 0) {
+            continue;
+        }
+        mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        self->irq_flags |= flags;
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        if (!self->irq_scheduled) {
+            self->irq_scheduled = true;
+            if (!mp_sched_schedule(MP_OBJ_FROM_PTR(&machine_uart_irq_dispatch_obj), MP_OBJ_FROM_PTR(self))) {
+                // scheduler queue full, try again on the next event
+                self->irq_scheduled = false;
+            } else {
+                xTaskNotifyGive(mp_main_task_handle);
+            }
+        }
+    }
+}
+
+STATIC void machine_uart_irq_start(machine_uart_obj_t *self) {
+    if (self->pattern >= 0) {
+        uart_pattern_queue_reset(self->uart_num, UART_PATTERN_QUEUE_LEN);
+        uart_enable_pattern_det_intr(self->uart_num, self->pattern, self->pattern_count, 10000, 10, 10);
+    }
+    if (xTaskCreate(machine_uart_event_task, "uart_event", UART_EVENT_TASK_STACK, self,
+        UART_EVENT_TASK_PRIO, &self->event_task) != pdPASS) {
+        self->event_task = NULL;
+        mp_raise_OSError(MP_ENOMEM);
+    }
+}
+
+STATIC void machine_uart_irq_stop(machine_uart_obj_t *self) {
+    if (self->event_task != NULL) {
+        // the task only ever blocks on the queue, so it can go at any time
+        vTaskDelete(self->event_task);
+        self->event_task = NULL;
+    }
+    if (self->pattern >= 0) {
+        uart_disable_pattern_det_intr(self->uart_num);
+    }
+}
+
+// irq(handler=None, trigger=IRQ_RX, *, pattern=None, pattern_count=1)
+STATIC mp_obj_t machine_uart_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_handler, ARG_trigger, ARG_pattern, ARG_pattern_count };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_handler, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_trigger, MP_ARG_INT, {.u_int = UART_IRQ_RX} },
+        { MP_QSTR_pattern, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_pattern_count, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 1} },
+    };
+    machine_uart_obj_t *self = MP_OBJ_TO_PTR(pos_args[0]);
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int pattern = -1;
+    if (args[ARG_pattern].u_obj != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[ARG_pattern].u_obj, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len != 1) {
+            mp_raise_ValueError("pattern must be a single byte");
+        }
+        pattern = ((uint8_t*)bufinfo.buf)[0];
+    }
+    mp_int_t count = args[ARG_pattern_count].u_int;
+    if ((count < 1) || (count > 127)) {
+        mp_raise_ValueError("pattern_count must be 1-127");
+    }
+
+    machine_uart_irq_stop(self);
+    MP_STATE_PORT(machine_uart_obj_all)[self->uart_num] = NULL;
+    self->irq_handler = args[ARG_handler].u_obj;
+    self->irq_trigger = args[ARG_trigger].u_int;
+    self->irq_flags = 0;
+    self->pattern = pattern;
+    self->pattern_count = count;
+    if (pattern >= 0) {
+        self->irq_trigger |= UART_IRQ_PATTERN;
+    }
+
+    if (self->irq_handler != mp_const_none) {
+        if (!mp_obj_is_callable(self->irq_handler)) {
+            self->irq_handler = mp_const_none;
+            mp_raise_ValueError("handler must be None or callable");
+        }
+        // drop stale events
+        xQueueReset(self->event_queue);
+        machine_uart_irq_start(self);
+        MP_STATE_PORT(machine_uart_obj_all)[self->uart_num] = self;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_uart_irq_obj, 1, machine_uart_irq);
+
+// Triggers seen since the last call
+STATIC mp_obj_t machine_uart_irq_flags(mp_obj_t self_in) {
+    machine_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    uint8_t flags = self->irq_flags;
+    self->irq_flags = 0;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    return MP_OBJ_NEW_SMALL_INT(flags);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(machine_uart_irq_flags_obj, machine_uart_irq_flags);
+
+void machine_uart_deinit_all(void) {
+    for (int i = 0; i < UART_NUM_MAX; i++) {
+        machine_uart_obj_t *self = MP_STATE_PORT(machine_uart_obj_all)[i];
+        if (self != NULL) {
+            machine_uart_irq_stop(self);
+            MP_STATE_PORT(machine_uart_obj_all)[i] = NULL;
+        }
+    }
+}
+
 STATIC const mp_rom_map_elem_t machine_uart_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&machine_uart_init_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&machine_uart_any_obj) },
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_readline_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writevec), MP_ROM_PTR(&mp_stream_writevec_obj) },
     { MP_ROM_QSTR(MP_QSTR_sendbreak), MP_ROM_PTR(&machine_uart_sendbreak_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&machine_uart_irq_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irq_flags), MP_ROM_PTR(&machine_uart_irq_flags_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_IRQ_RX), MP_ROM_INT(UART_IRQ_RX) },
+    { MP_ROM_QSTR(MP_QSTR_IRQ_PATTERN), MP_ROM_INT(UART_IRQ_PATTERN) },
+    { MP_ROM_QSTR(MP_QSTR_IRQ_OVERFLOW), MP_ROM_INT(UART_IRQ_OVERFLOW) },
+    { MP_ROM_QSTR(MP_QSTR_IRQ_BREAK), MP_ROM_INT(UART_IRQ_BREAK) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(machine_uart_locals_dict, machine_uart_locals_dict_table);
@@ -346,16 +580,34 @@ STATIC mp_uint_t machine_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t siz
         return 0;
     }
 
-    TickType_t time_to_wait;
-    if (self->timeout == 0) {
-        time_to_wait = 0;
-    } else {
-        time_to_wait = pdMS_TO_TICKS(self->timeout);
+    // Whatever is buffered is copied straight from the driver's ring into
+    // buf_in; only when the ring is empty does this block, with the GIL
+    // released, for up to timeout for the first char and timeout_char
+    // for each one after that.
+    uint8_t *buf = buf_in;
+    mp_uint_t bytes_read = 0;
+    TickType_t time_to_wait = pdMS_TO_TICKS(self->timeout);
+    while (bytes_read < size) {
+        size_t avail;
+        uart_get_buffered_data_len(self->uart_num, &avail);
+        int n;
+        if (avail > 0) {
+            n = uart_read_bytes(self->uart_num, buf + bytes_read, MIN(avail, size - bytes_read), 0);
+        } else if (time_to_wait > 0) {
+            MP_THREAD_GIL_EXIT();
+            n = uart_read_bytes(self->uart_num, buf + bytes_read, 1, time_to_wait);
+            MP_THREAD_GIL_ENTER();
+        } else {
+            break;
+        }
+        if (n <= 0) {
+            break;
+        }
+        bytes_read += n;
+        time_to_wait = pdMS_TO_TICKS(self->timeout_char);
     }
 
-    int bytes_read = uart_read_bytes(self->uart_num, buf_in, size, time_to_wait);
-
-    if (bytes_read <= 0) {
+    if (bytes_read == 0) {
         *errcode = MP_EAGAIN;
         return MP_STREAM_ERROR;
     }
@@ -366,7 +618,10 @@ STATIC mp_uint_t machine_uart_read(mp_obj_t self_in, void *buf_in, mp_uint_t siz
 STATIC mp_uint_t machine_uart_write(mp_obj_t self_in, const void *buf_in, mp_uint_t size, int *errcode) {
     machine_uart_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
+    // blocks while the TX buffer is full
+    MP_THREAD_GIL_EXIT();
     int bytes_written = uart_write_bytes(self->uart_num, buf_in, size);
+    MP_THREAD_GIL_ENTER();
 
     if (bytes_written < 0) {
         *errcode = MP_EAGAIN;
@@ -405,6 +660,14 @@ STATIC const mp_stream_p_t uart_stream_p = {
     .is_text = false,
 };
 
+int machine_uart_get_port(mp_obj_t uart_in) {
+    if (!mp_obj_is_type(uart_in, &machine_uart_type)) {
+        return -1;
+    }
+    machine_uart_obj_t *self = MP_OBJ_TO_PTR(uart_in);
+    return self->uart_num;
+}
+
 const mp_obj_type_t machine_uart_type = {
     { &mp_type_type },
     .name = MP_QSTR_UART,
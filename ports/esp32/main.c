@@ -54,7 +54,10 @@
 #include "lib/utils/pyexec.h"
 #include "uart.h"
 #include "modmachine.h"
+#include "modesp32.h"
 #include "modnetwork.h"
+#include "modesp.h"
+#include "modstuduinobit.h"
 #include "mpthreadport.h"
 
 // MicroPython runs as a task under FreeRTOS
@@ -63,6 +66,12 @@
 #define MP_TASK_PRIORITY        (ESP_TASK_PRIO_MIN + 1)
 #define MP_TASK_STACK_SIZE      (16 * 1024)
 #define MP_TASK_STACK_LEN       (MP_TASK_STACK_SIZE / sizeof(StackType_t))
+#define MP_TASK_HEAP_INTERNAL_SIZE (48 * 1024) // first heap area when the rest is in SPIRAM
+#define MP_TASK_PYSTACK_SIZE    (8 * 1024)
+
+#if MICROPY_ENABLE_PYSTACK
+STATIC mp_obj_t mp_task_pystack[MP_TASK_PYSTACK_SIZE / sizeof(mp_obj_t)];
+#endif
 
 int vprintf_null(const char *format, va_list ap) {
     // do nothing: this is used as a log target during raw repl mode
@@ -71,15 +80,18 @@ int vprintf_null(const char *format, va_list ap) {
 
 void mp_task(void *pvParameter) {
     volatile uint32_t sp = (uint32_t)get_sp();
+    esp32_boot_mark(ESP32_BOOT_IDF);
     #if MICROPY_PY_THREAD
     mp_thread_init(pxTaskGetStackStart(NULL), MP_TASK_STACK_LEN);
     #endif
     uart_init();
+    mp_hal_pm_init();
 
     #if CONFIG_SPIRAM_SUPPORT
     // Try to use the entire external SPIRAM directly for the heap
     size_t mp_task_heap_size;
     void *mp_task_heap = (void*)0x3f800000;
+    void *mp_task_heap_internal = NULL;
     switch (esp_spiram_get_chip_size()) {
         case ESP_SPIRAM_SIZE_16MBITS:
             mp_task_heap_size = 2 * 1024 * 1024;
@@ -94,6 +106,12 @@ void mp_task(void *pvParameter) {
             mp_task_heap = malloc(mp_task_heap_size);
             break;
     }
+    #if MICROPY_GC_SPLIT_HEAP
+    if (mp_task_heap == (void*)0x3f800000) {
+        // keep small objects in internal RAM, the GC puts large ones in SPIRAM
+        mp_task_heap_internal = heap_caps_malloc(MP_TASK_HEAP_INTERNAL_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    #endif
     #else
     // Allocate the uPy heap using malloc and get the largest available region
     size_t mp_task_heap_size = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
@@ -104,7 +122,20 @@ soft_reset:
     // initialise the stack pointer for the main thread
     mp_stack_set_top((void *)sp);
     mp_stack_set_limit(MP_TASK_STACK_SIZE - 1024);
+    #if MICROPY_GC_SPLIT_HEAP
+    if (mp_task_heap_internal != NULL) {
+        gc_init(mp_task_heap_internal, mp_task_heap_internal + MP_TASK_HEAP_INTERNAL_SIZE);
+        gc_add(mp_task_heap, mp_task_heap + mp_task_heap_size);
+    } else {
+        gc_init(mp_task_heap, mp_task_heap + mp_task_heap_size);
+    }
+    #else
     gc_init(mp_task_heap, mp_task_heap + mp_task_heap_size);
+    #endif
+    #if MICROPY_ENABLE_PYSTACK
+    mp_pystack_init(mp_task_pystack, &mp_task_pystack[MP_ARRAY_SIZE(mp_task_pystack)]);
+    #endif
+    esp32_boot_mark(ESP32_BOOT_GC_INIT);
     mp_init();
     mp_obj_list_init(mp_sys_path, 0);
     mp_obj_list_append(mp_sys_path, MP_OBJ_NEW_QSTR(MP_QSTR_));
@@ -115,11 +146,23 @@ soft_reset:
     // initialise peripherals
     machine_pins_init();
 
+    // a module bundle shadows the frozen modules
+    esp32_bundle_boot_mount();
+
     // run boot-up scripts
 #if MICROPY_FATFS == 1
-    pyexec_frozen_module("_boot.py");
+    bool mounted = false;
+    #if MICROPY_ESP32_FAST_BOOT
+    mounted = esp32_flashbdev_boot_mount();
+    #endif
+    if (!mounted) {
+        pyexec_frozen_module("_boot.py");
+        esp32_boot_mark(ESP32_BOOT_BOOT_PY);
+    }
+    esp32_boot_mark(ESP32_BOOT_VFS);
     pyexec_file("boot.py");
     if (pyexec_mode_kind == PYEXEC_MODE_FRIENDLY_REPL) {
+        esp32_boot_mark(ESP32_BOOT_MAIN);
         pyexec_file("main.py");
     }
 #else
@@ -128,8 +171,10 @@ soft_reset:
     int res = mount_vfs(VFS_NATIVE_TYPE_SPIFLASH, VFS_NATIVE_INTERNAL_MP);
 
     if (res == 0) {
+	    esp32_boot_mark(ESP32_BOOT_VFS);
 	    pyexec_file("boot.py");
 	    if (pyexec_mode_kind == PYEXEC_MODE_FRIENDLY_REPL) {
+		esp32_boot_mark(ESP32_BOOT_MAIN);
 		pyexec_file("main.py");
 	    }
     }
@@ -150,19 +195,44 @@ soft_reset:
         }
     }
 
+    #if MICROPY_STATE_CTX_PER_TASK
+    esp32_vm_deinit();
+    #endif
+    esp32_flashbdev_sync_all();
     machine_timer_deinit_all();
+    #if MICROPY_PROF_SAMPLES
+    esp32_prof_deinit();
+    #endif
+    machine_adc_deinit();
+    machine_uart_deinit_all();
+    machine_hw_spi_deinit_all();
+    machine_hw_i2c_deinit_all();
+    machine_touchpad_deinit();
+    machine_dac_deinit();
+    mod_ota_deinit();
+    studuinobit_display_deinit();
+    studuinobit_imu_deinit();
+    studuinobit_button_deinit();
+    studuinobit_melody_deinit();
+    studuinobit_audio_deinit();
+    studuinobit_radio_deinit();
+    studuinobit_sensors_deinit();
 
     #if MICROPY_PY_THREAD
     mp_thread_deinit();
     #endif
 
     gc_sweep_all();
+    esp_native_code_free_all();
 
     mp_hal_stdout_tx_str("MPY: soft reboot\r\n");
 
     // deinitialise peripherals
     machine_pins_deinit();
+    esp_neopixel_rmt_deinit();
+    esp_rmt_rx_deinit();
     usocket_events_deinit();
+    esp_network_deinit();
 
     mp_deinit();
     fflush(stdout);
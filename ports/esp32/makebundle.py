@@ -0,0 +1,90 @@
+"""
+Pack Python modules into a bundle for the esp32.Bundle filesystem.
+
+Usage: makebundle.py [-o bundle.bin] [--mpy-cross PATH] DIR...
+
+Every file below each DIR is stored under its path relative to DIR; .py
+files are compiled with mpy-cross first and stored as .mpy.  The bundle is
+written to the 'bundle' partition with ota.begin('bundle') and mounted at
+/bundle on the next boot, ahead of the frozen modules on sys.path.  As
+with any package on sys.path, a package in the bundle replaces the frozen
+one completely, so bundle whole packages.
+
+The format is described in esp32_bundle.c.
+"""
+
+from __future__ import print_function
+
+import argparse
+import os
+import struct
+import subprocess
+import tempfile
+
+MAGIC = b'MPYB'
+VERSION = 1
+HEADER = struct.Struct('<4sHHI')
+ENTRY = struct.Struct('<IIB')
+
+
+def collect(root, mpy_cross):
+    files = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for fn in sorted(filenames):
+            path = os.path.join(dirpath, fn)
+            name = os.path.relpath(path, root).replace(os.sep, '/')
+            if fn.endswith('.py'):
+                with tempfile.NamedTemporaryFile(suffix='.mpy', delete=False) as f:
+                    out = f.name
+                try:
+                    subprocess.check_call([mpy_cross, '-s', name, '-o', out, path])
+                    with open(out, 'rb') as f:
+                        data = f.read()
+                finally:
+                    os.unlink(out)
+                name = name[:-3] + '.mpy'
+            else:
+                with open(path, 'rb') as f:
+                    data = f.read()
+            files.append((name.encode('utf-8'), data))
+    return files
+
+
+def pack(files):
+    names = set()
+    for name, _ in files:
+        if len(name) > 255:
+            raise ValueError('name too long: %s' % name.decode())
+        if name in names:
+            raise ValueError('duplicate name: %s' % name.decode())
+        names.add(name)
+    index_len = sum(ENTRY.size + len(name) for name, _ in files)
+    offset = HEADER.size + index_len
+    index = b''
+    data = b''
+    for name, content in files:
+        index += ENTRY.pack(offset + len(data), len(content), len(name)) + name
+        data += content
+    size = HEADER.size + len(index) + len(data)
+    return HEADER.pack(MAGIC, VERSION, len(files), size) + index + data
+
+
+def main():
+    cmd = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    cmd.add_argument('-o', '--output', default='bundle.bin')
+    cmd.add_argument('--mpy-cross', default=os.path.join(os.path.dirname(__file__), '../../mpy-cross/mpy-cross'))
+    cmd.add_argument('dirs', nargs='+')
+    args = cmd.parse_args()
+
+    files = []
+    for d in args.dirs:
+        files.extend(collect(d, args.mpy_cross))
+    bundle = pack(files)
+    with open(args.output, 'wb') as f:
+        f.write(bundle)
+    print('%s: %d files, %d bytes' % (args.output, len(files), len(bundle)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,74 @@
+"""
+Generate the ROM tables for the built-in images of studuinobit.Image.
+
+Usage: makeimages.py studuinobit_images.csv > studuinobit_images.h
+
+The output is included by studuinobit_image.c: it defines one read-only
+image object per image, one tuple object per image sequence, and the
+SB_IMAGE_BUILTIN_LOCALS macro listing them all for the type's locals dict.
+"""
+
+from __future__ import print_function
+
+import sys
+
+WIDTH = 5
+HEIGHT = 5
+
+
+def parse_rows(name, rows):
+    rows = rows.split(':')
+    if len(rows) != HEIGHT or any(len(r) != WIDTH for r in rows):
+        raise ValueError('%s: image must be %dx%d' % (name, WIDTH, HEIGHT))
+    pixels = []
+    for r in rows:
+        for c in r:
+            if not c.isdigit():
+                raise ValueError('%s: unexpected character %r' % (name, c))
+            pixels.append(int(c != '0'))
+    return pixels
+
+
+def main(filename):
+    images = []
+    sequences = []
+    with open(filename) as f:
+        for line in f:
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            name, value = line.split(',')
+            if value[0].isdigit():
+                images.append((name, parse_rows(name, value)))
+            else:
+                members = value.split()
+                known = [n for n, _ in images]
+                for m in members:
+                    if m not in known:
+                        raise ValueError('%s: unknown image %s' % (name, m))
+                sequences.append((name, members))
+
+    print('// Generated by makeimages.py from %s, do not edit' % filename)
+    print()
+    for name, pixels in images:
+        print('STATIC const sb_image_rom_obj_t sb_image_%s_obj = SB_IMAGE_ROM(' % name)
+        for y in range(HEIGHT):
+            row = ', '.join(str(p) for p in pixels[y * WIDTH:(y + 1) * WIDTH])
+            print('    %s%s' % (row, ',' if y < HEIGHT - 1 else ');'))
+    print()
+    for name, members in sequences:
+        print('STATIC const mp_rom_obj_tuple_t sb_image_%s_obj = {' % name)
+        print('    {&mp_type_tuple}, %d, {' % len(members))
+        for m in members:
+            print('        MP_ROM_PTR(&sb_image_%s_obj),' % m)
+        print('    }')
+        print('};')
+    print()
+    print('#define SB_IMAGE_BUILTIN_LOCALS \\')
+    for name, _ in images + sequences:
+        print('    { MP_ROM_QSTR(MP_QSTR_%s), MP_ROM_PTR(&sb_image_%s_obj) }, \\' % (name, name))
+    print()
+
+
+if __name__ == '__main__':
+    main(sys.argv[1])
@@ -32,10 +32,12 @@
 #include "rom/gpio.h"
 #include "esp_log.h"
 #include "esp_spi_flash.h"
+#include "esp_heap_caps.h"
 
 #include "py/runtime.h"
 #include "py/mperrno.h"
 #include "py/mphal.h"
+#include "py/persistentcode.h"
 #include "drivers/dht/dht.h"
 #include "modesp.h"
 
@@ -60,7 +62,10 @@ STATIC mp_obj_t esp_flash_read(mp_obj_t offset_in, mp_obj_t buf_in) {
     mp_int_t offset = mp_obj_get_int(offset_in);
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
-    esp_err_t res = spi_flash_read(offset, bufinfo.buf, bufinfo.len);
+    esp_err_t res;
+    MP_HAL_BLOCKING_BEGIN(buf_in);
+    res = spi_flash_read(offset, bufinfo.buf, bufinfo.len);
+    MP_HAL_BLOCKING_END();
     if (res != ESP_OK) {
         mp_raise_OSError(MP_EIO);
     }
@@ -72,7 +77,10 @@ STATIC mp_obj_t esp_flash_write(mp_obj_t offset_in, mp_obj_t buf_in) {
     mp_int_t offset = mp_obj_get_int(offset_in);
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
-    esp_err_t res = spi_flash_write(offset, bufinfo.buf, bufinfo.len);
+    esp_err_t res;
+    MP_HAL_BLOCKING_BEGIN(buf_in);
+    res = spi_flash_write(offset, bufinfo.buf, bufinfo.len);
+    MP_HAL_BLOCKING_END();
     if (res != ESP_OK) {
         mp_raise_OSError(MP_EIO);
     }
@@ -82,7 +90,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(esp_flash_write_obj, esp_flash_write);
 
 STATIC mp_obj_t esp_flash_erase(mp_obj_t sector_in) {
     mp_int_t sector = mp_obj_get_int(sector_in);
-    esp_err_t res = spi_flash_erase_sector(sector);
+    esp_err_t res;
+    MP_HAL_BLOCKING_BEGIN(MP_OBJ_NULL);
+    res = spi_flash_erase_sector(sector);
+    MP_HAL_BLOCKING_END();
     if (res != ESP_OK) {
         mp_raise_OSError(MP_EIO);
     }
@@ -122,8 +133,70 @@ STATIC mp_obj_t esp_neopixel_write_(mp_obj_t pin, mp_obj_t buf, mp_obj_t timing)
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp_neopixel_write_obj, esp_neopixel_write_);
 
+STATIC mp_obj_t esp_neopixel_write_rmt(mp_obj_t pin, mp_obj_t buf, mp_obj_t timing) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf, &bufinfo, MP_BUFFER_READ);
+    if (esp_neopixel_rmt_write(mp_hal_get_pin_obj(pin),
+        (uint8_t*)bufinfo.buf, bufinfo.len, mp_obj_get_int(timing)) != 0) {
+        mp_raise_OSError(MP_EIO);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(esp_neopixel_write_rmt_obj, esp_neopixel_write_rmt);
+
+STATIC mp_obj_t esp_neopixel_wait_rmt(mp_obj_t pin) {
+    esp_neopixel_rmt_wait(mp_hal_get_pin_obj(pin));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp_neopixel_wait_rmt_obj, esp_neopixel_wait_rmt);
+
 extern const mp_obj_module_t mp_module_esp_espnow;
 
+#if MICROPY_PERSISTENT_CODE_LOAD_NATIVE
+
+// Native code loaded from .mpy files is copied into IRAM, which is only
+// accessible with 32-bit loads and stores.  The blocks are chained through
+// their first word and live until soft reset, when the functions that refer
+// to them have all gone.
+STATIC uint32_t *esp_native_code_head;
+
+void *esp_native_code_commit(void *buf, size_t len, void *reloc) {
+    len = (len + 3) & ~3;
+    uint32_t *block = heap_caps_malloc(4 + len, MALLOC_CAP_EXEC | MALLOC_CAP_32BIT);
+    if (block == NULL) {
+        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_MemoryError,
+            "memory allocation failed, allocating %u bytes for native code", (uint)len));
+    }
+    uint32_t *dest = block + 1;
+
+    mp_native_relocate(reloc, buf, (uintptr_t)dest);
+
+    // buf comes from the GC heap so is word aligned and rounded up
+    const uint32_t *src = buf;
+    for (size_t i = 0; i < len / 4; ++i) {
+        dest[i] = src[i];
+    }
+
+    block[0] = (uint32_t)esp_native_code_head;
+    esp_native_code_head = block;
+    return dest;
+}
+
+void esp_native_code_free_all(void) {
+    while (esp_native_code_head != NULL) {
+        uint32_t *block = esp_native_code_head;
+        esp_native_code_head = (uint32_t*)block[0];
+        heap_caps_free(block);
+    }
+}
+
+#else
+
+void esp_native_code_free_all(void) {
+}
+
+#endif
+
 STATIC const mp_rom_map_elem_t esp_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_esp) },
 
@@ -139,6 +212,8 @@ STATIC const mp_rom_map_elem_t esp_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_gpio_matrix_out), MP_ROM_PTR(&esp_gpio_matrix_out_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_neopixel_write), MP_ROM_PTR(&esp_neopixel_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_neopixel_write_rmt), MP_ROM_PTR(&esp_neopixel_write_rmt_obj) },
+    { MP_ROM_QSTR(MP_QSTR_neopixel_wait_rmt), MP_ROM_PTR(&esp_neopixel_wait_rmt_obj) },
     { MP_ROM_QSTR(MP_QSTR_dht_readinto), MP_ROM_PTR(&dht_readinto_obj) },
 
     // Constants for second arg of osdebug()
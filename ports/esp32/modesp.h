@@ -1 +1,24 @@
+#include "driver/rmt.h"
+
 void esp_neopixel_write(uint8_t pin, uint8_t *pixels, uint32_t numBytes, uint8_t timing);
+
+int esp_neopixel_rmt_write(uint8_t pin, const uint8_t *pixels, uint32_t numBytes, uint8_t timing);
+void esp_neopixel_rmt_wait(uint8_t pin);
+void esp_neopixel_rmt_deinit(void);
+
+// The RMT channel used for receiving, see esprmt_rx.c; the transmit
+// channels are allocated from the ones below it
+#define ESP_RMT_RX_CHANNEL (RMT_CHANNEL_7)
+
+// RMT transmit channels, shared by the users of the peripheral
+int esp_rmt_tx_channel(uint8_t pin, uint8_t clk_div, bool idle_level);
+rmt_item32_t *esp_rmt_tx_items(int ch, uint32_t num_items);
+void esp_rmt_tx_wait(int ch);
+
+int esp_rmt_rx_capture(uint8_t pin, const rmt_item32_t *tx, size_t n_tx,
+    rmt_item32_t *rx, size_t max_rx, uint16_t idle_us, uint32_t timeout_ms);
+int esp_rmt_time_pulses_us(uint8_t pin, int pulse_level, uint32_t *us_out, size_t n, uint32_t timeout_us);
+void esp_rmt_rx_deinit(void);
+
+// Executable copies of native code loaded from .mpy files, see modesp.c
+void esp_native_code_free_all(void);
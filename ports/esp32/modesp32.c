@@ -33,15 +33,18 @@
 #include "soc/sens_reg.h"
 #include "driver/gpio.h"
 #include "driver/adc.h"
+#include "esp_timer.h"
 
 #include "py/nlr.h"
 #include "py/obj.h"
 #include "py/runtime.h"
 #include "py/mphal.h"
+#include "py/bc.h"
 #include "timeutils.h"
 #include "modmachine.h"
 #include "machine_rtc.h"
 #include "modesp32.h"
+#include "uart.h"
 
 STATIC mp_obj_t esp32_wake_on_touch(const mp_obj_t wake) {
 
@@ -145,6 +148,109 @@ STATIC mp_obj_t esp32_hall_sensor(void) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(esp32_hall_sensor_obj, esp32_hall_sensor);
 
+// pm_stats(reset=False): (run_us, idle_us, wakeups) of the main task since
+// boot or the last reset, see machine.freq() for the governor
+STATIC mp_obj_t esp32_pm_stats(size_t n_args, const mp_obj_t *args) {
+    uint64_t run_us, idle_us;
+    uint32_t wakeups;
+    mp_hal_pm_stats(n_args > 0 && mp_obj_is_true(args[0]), &run_us, &idle_us, &wakeups);
+    mp_obj_t tuple[3] = {
+        mp_obj_new_int_from_ull(run_us),
+        mp_obj_new_int_from_ull(idle_us),
+        mp_obj_new_int_from_uint(wakeups),
+    };
+    return mp_obj_new_tuple(3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_pm_stats_obj, 0, 1, esp32_pm_stats);
+
+// Time since the chip started, in microseconds, at which each boot phase
+// completed; kept across soft resets so the IDF phase stays meaningful
+STATIC uint64_t esp32_boot_us[ESP32_BOOT_NUM_PHASES];
+
+void esp32_boot_mark(int phase) {
+    if (phase == ESP32_BOOT_GC_INIT) {
+        // a soft reset starts again from here
+        memset(&esp32_boot_us[phase], 0, sizeof(esp32_boot_us) - phase * sizeof(esp32_boot_us[0]));
+    }
+    esp32_boot_us[phase] = esp_timer_get_time();
+}
+
+// boot_times(): dict of the phases reached on the last boot or soft reset
+STATIC mp_obj_t esp32_boot_times(void) {
+    static const qstr names[ESP32_BOOT_NUM_PHASES] = {
+        MP_QSTR_idf, MP_QSTR_gc_init, MP_QSTR__boot, MP_QSTR_vfs, MP_QSTR_main,
+    };
+    mp_obj_t dict = mp_obj_new_dict(ESP32_BOOT_NUM_PHASES);
+    for (int i = 0; i < ESP32_BOOT_NUM_PHASES; ++i) {
+        if (esp32_boot_us[i] != 0) {
+            mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(names[i]), mp_obj_new_int_from_ull(esp32_boot_us[i]));
+        }
+    }
+    return dict;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(esp32_boot_times_obj, esp32_boot_times);
+
+// stdout_nonblocking([value]): get or set whether console output drops the
+// oldest queued bytes, instead of waiting, when the UART buffer is full
+STATIC mp_obj_t esp32_stdout_nonblocking(size_t n_args, const mp_obj_t *args) {
+    if (n_args > 0) {
+        uart_stdout_nonblocking = mp_obj_is_true(args[0]);
+    }
+    return mp_obj_new_bool(uart_stdout_nonblocking);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_stdout_nonblocking_obj, 0, 1, esp32_stdout_nonblocking);
+
+#if MICROPY_PROF_SAMPLES
+// The profiler samples from the esp_timer task, which has a higher priority
+// than the MicroPython task and so runs in between its bytecodes
+STATIC esp_timer_handle_t esp32_prof_timer = NULL;
+
+STATIC void esp32_prof_timer_cb(void *arg) {
+    mp_prof_sample();
+}
+
+void esp32_prof_deinit(void) {
+    if (esp32_prof_timer != NULL) {
+        esp_timer_stop(esp32_prof_timer);
+        esp_timer_delete(esp32_prof_timer);
+        esp32_prof_timer = NULL;
+    }
+}
+
+// prof_start(period_us=1000): clear the samples and take one every period_us,
+// read them with micropython.profile()
+STATIC mp_obj_t esp32_prof_start(size_t n_args, const mp_obj_t *args) {
+    mp_int_t period_us = n_args > 0 ? mp_obj_get_int(args[0]) : 1000;
+    if (period_us < 50) {
+        // esp_timer's shortest period
+        mp_raise_ValueError("period too short, 50 us minimum");
+    }
+    esp32_prof_deinit();
+    mp_prof_clear();
+    esp_timer_create_args_t timer_args = {
+        .callback = esp32_prof_timer_cb,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "esp32.prof",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &esp32_prof_timer);
+    if (err == ESP_OK) {
+        err = esp_timer_start_periodic(esp32_prof_timer, period_us);
+    }
+    if (err != ESP_OK) {
+        esp32_prof_deinit();
+        mp_raise_OSError(err);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp32_prof_start_obj, 0, 1, esp32_prof_start);
+
+STATIC mp_obj_t esp32_prof_stop(void) {
+    esp32_prof_deinit();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(esp32_prof_stop_obj, esp32_prof_stop);
+#endif
+
 STATIC const mp_rom_map_elem_t esp32_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_esp32) },
 
@@ -153,8 +259,24 @@ STATIC const mp_rom_map_elem_t esp32_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_wake_on_ext1), MP_ROM_PTR(&esp32_wake_on_ext1_obj) },
     { MP_ROM_QSTR(MP_QSTR_raw_temperature), MP_ROM_PTR(&esp32_raw_temperature_obj) },
     { MP_ROM_QSTR(MP_QSTR_hall_sensor), MP_ROM_PTR(&esp32_hall_sensor_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pm_stats), MP_ROM_PTR(&esp32_pm_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_boot_times), MP_ROM_PTR(&esp32_boot_times_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stdout_nonblocking), MP_ROM_PTR(&esp32_stdout_nonblocking_obj) },
+    #if MICROPY_PROF_SAMPLES
+    { MP_ROM_QSTR(MP_QSTR_prof_start), MP_ROM_PTR(&esp32_prof_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_prof_stop), MP_ROM_PTR(&esp32_prof_stop_obj) },
+    #endif
+    #if MICROPY_STATE_CTX_PER_TASK
+    { MP_ROM_QSTR(MP_QSTR_vm_start), MP_ROM_PTR(&esp32_vm_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_vm_stop), MP_ROM_PTR(&esp32_vm_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_vm_running), MP_ROM_PTR(&esp32_vm_running_obj) },
+    { MP_ROM_QSTR(MP_QSTR_vm_channels), MP_ROM_PTR(&esp32_vm_channels_obj) },
+    #endif
 
     { MP_ROM_QSTR(MP_QSTR_ULP), MP_ROM_PTR(&esp32_ulp_type) },
+    { MP_ROM_QSTR(MP_QSTR_Bundle), MP_ROM_PTR(&esp32_bundle_type) },
+    { MP_ROM_QSTR(MP_QSTR_FlashBdev), MP_ROM_PTR(&esp32_flashbdev_type) },
+    { MP_ROM_QSTR(MP_QSTR_NVS), MP_ROM_PTR(&esp32_nvs_type) },
 
     { MP_ROM_QSTR(MP_QSTR_WAKEUP_ALL_LOW), MP_ROM_PTR(&mp_const_false_obj) },
     { MP_ROM_QSTR(MP_QSTR_WAKEUP_ANY_HIGH), MP_ROM_PTR(&mp_const_true_obj) },
@@ -1,6 +1,8 @@
 #ifndef MICROPY_INCLUDED_ESP32_MODESP32_H
 #define MICROPY_INCLUDED_ESP32_MODESP32_H
 
+#include "esp_partition.h"
+
 #define RTC_VALID_EXT_PINS \
 ( \
     (1ll << 0)  | \
@@ -28,4 +30,43 @@
 
 extern const mp_obj_type_t esp32_ulp_type;
 
+// Read-only module bundle filesystem, see esp32_bundle.c
+extern const mp_obj_type_t esp32_bundle_type;
+
+bool esp32_bundle_is_mapped(const esp_partition_t *partition);
+void esp32_bundle_boot_mount(void);
+
+// Cached block device over the user flash, see esp32_flashbdev.c
+extern const mp_obj_type_t esp32_flashbdev_type;
+
+void esp32_flashbdev_sync_all(void);
+bool esp32_flashbdev_boot_mount(void);
+
+// Cached key/value store in NVS, see esp32_nvs.c
+extern const mp_obj_type_t esp32_nvs_type;
+
+// Boot phase timestamps, see esp32.boot_times()
+enum {
+    ESP32_BOOT_IDF,         // mp_task started
+    ESP32_BOOT_GC_INIT,     // heap ready
+    ESP32_BOOT_BOOT_PY,     // _boot.py done
+    ESP32_BOOT_VFS,         // root filesystem mounted
+    ESP32_BOOT_MAIN,        // main.py about to run
+    ESP32_BOOT_NUM_PHASES,
+};
+
+void esp32_boot_mark(int phase);
+
+// Sampling profiler timer, see esp32.prof_start()
+void esp32_prof_deinit(void);
+
+// Second VM on the app core, see esp32_vm.c
+#if MICROPY_STATE_CTX_PER_TASK
+MP_DECLARE_CONST_FUN_OBJ_KW(esp32_vm_start_obj);
+MP_DECLARE_CONST_FUN_OBJ_0(esp32_vm_stop_obj);
+MP_DECLARE_CONST_FUN_OBJ_0(esp32_vm_running_obj);
+MP_DECLARE_CONST_FUN_OBJ_0(esp32_vm_channels_obj);
+void esp32_vm_deinit(void);
+#endif
+
 #endif // MICROPY_INCLUDED_ESP32_MODESP32_H
@@ -41,6 +41,8 @@
 
 #include "py/obj.h"
 #include "py/runtime.h"
+#include "py/mphal.h"
+#include "py/mperrno.h"
 #include "extmod/machine_mem.h"
 #include "extmod/machine_signal.h"
 #include "extmod/machine_pulse.h"
@@ -48,6 +50,9 @@
 #include "extmod/machine_spi.h"
 #include "modmachine.h"
 #include "machine_rtc.h"
+#include "modesp32.h"
+#include "modesp.h"
+#include "uart.h"
 
 #if MICROPY_PY_MACHINE
 
@@ -62,31 +67,58 @@ typedef enum {
     MP_SOFT_RESET
 } reset_reason_t;
 
-STATIC mp_obj_t machine_freq(size_t n_args, const mp_obj_t *args) {
-    if (n_args == 0) {
+STATIC mp_int_t machine_freq_mhz(mp_obj_t freq_in) {
+    mp_int_t freq = mp_obj_get_int(freq_in) / 1000000;
+    if (freq != 20 && freq != 40 && freq != 80 && freq != 160 && freq != 240) {
+        mp_raise_ValueError("frequency must be 20MHz, 40MHz, 80Mhz, 160MHz or 240MHz");
+    }
+    return freq;
+}
+
+// freq([max, [min]], *, light_sleep=False): with min below max, or with
+// light_sleep, the CPU runs at max while the VM is busy and drops to min
+// (or light sleeps) while it waits in time.sleep(), uselect or the REPL
+STATIC mp_obj_t machine_freq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_max, ARG_min, ARG_light_sleep };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_max, MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_min, MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_light_sleep, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_max].u_obj == MP_OBJ_NULL) {
         // get
         return mp_obj_new_int(esp_clk_cpu_freq());
-    } else {
-        // set
-        mp_int_t freq = mp_obj_get_int(args[0]) / 1000000;
-        if (freq != 20 && freq != 40 && freq != 80 && freq != 160 && freq != 240) {
-            mp_raise_ValueError("frequency must be 20MHz, 40MHz, 80Mhz, 160MHz or 240MHz");
-        }
-        esp_pm_config_esp32_t pm;
-        pm.max_freq_mhz = freq;
-        pm.min_freq_mhz = freq;
-        pm.light_sleep_enable = false;
-        esp_err_t ret = esp_pm_configure(&pm);
-        if (ret != ESP_OK) {
-            mp_raise_ValueError(NULL);
+    }
+
+    // set
+    mp_int_t max_freq = machine_freq_mhz(args[ARG_max].u_obj);
+    mp_int_t min_freq = max_freq;
+    if (args[ARG_min].u_obj != MP_OBJ_NULL) {
+        min_freq = machine_freq_mhz(args[ARG_min].u_obj);
+        if (min_freq > max_freq) {
+            mp_raise_ValueError("min frequency above max");
         }
-        while (esp_clk_cpu_freq() != freq * 1000000) {
+    }
+    esp_pm_config_esp32_t pm;
+    pm.max_freq_mhz = max_freq;
+    pm.min_freq_mhz = min_freq;
+    pm.light_sleep_enable = args[ARG_light_sleep].u_bool;
+    esp_err_t ret = esp_pm_configure(&pm);
+    if (ret != ESP_OK) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_hal_pm_auto = min_freq != max_freq || pm.light_sleep_enable;
+    if (!mp_hal_pm_auto) {
+        while (esp_clk_cpu_freq() != max_freq * 1000000) {
             vTaskDelay(1);
         }
-        return mp_const_none;
     }
+    return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_freq_obj, 0, 1, machine_freq);
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_freq_obj, 0, machine_freq);
 
 STATIC mp_obj_t machine_sleep_helper(wake_type_t wake_type, size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
 
@@ -121,11 +153,18 @@ STATIC mp_obj_t machine_sleep_helper(wake_type_t wake_type, size_t n_args, const
         }
     }
 
+    if (machine_rtc_config.wake_on_ulp) {
+        esp_sleep_enable_ulp_wakeup();
+    }
+
+    uart_stdout_flush(100);
+
     switch(wake_type) {
         case MACHINE_WAKE_SLEEP:
             esp_light_sleep_start();
             break;
         case MACHINE_WAKE_DEEPSLEEP:
+            esp32_flashbdev_sync_all();
             esp_deep_sleep_start();
             break;
     }
@@ -186,6 +225,8 @@ STATIC mp_obj_t machine_wake_reason(size_t n_args, const mp_obj_t *pos_args, mp_
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(machine_wake_reason_obj, 0,  machine_wake_reason);
 
 STATIC mp_obj_t machine_reset(void) {
+    esp32_flashbdev_sync_all();
+    uart_stdout_flush(100);
     esp_restart();
     return mp_const_none;
 }
@@ -217,6 +258,34 @@ STATIC mp_obj_t machine_enable_irq(mp_obj_t state_in) {
 }
 MP_DEFINE_CONST_FUN_OBJ_1(machine_enable_irq_obj, machine_enable_irq);
 
+// time_pulses_us(pin, pulse_level, n, timeout_us=1000000)
+// Record a burst of pulses with the RMT receiver and return the lengths of
+// up to n of those at pulse_level.  The burst ends when the pin has been
+// idle for timeout_us, which is limited to 65535, or for up to 64 edges.
+STATIC mp_obj_t machine_time_pulses_us(size_t n_args, const mp_obj_t *args) {
+    gpio_num_t pin = machine_pin_get_id(args[0]);
+    int level = mp_obj_is_true(args[1]);
+    mp_int_t n = mp_obj_get_int(args[2]);
+    mp_uint_t timeout_us = 1000000;
+    if (n_args > 3) {
+        timeout_us = mp_obj_get_int(args[3]);
+    }
+    if (n <= 0 || n > 128) {
+        mp_raise_ValueError("n out of range");
+    }
+    uint32_t us[128];
+    int count = esp_rmt_time_pulses_us(pin, level, us, n, timeout_us);
+    if (count < 0) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    mp_obj_t list = mp_obj_new_list(count, NULL);
+    for (int i = 0; i < count; ++i) {
+        mp_obj_list_store(list, MP_OBJ_NEW_SMALL_INT(i), MP_OBJ_NEW_SMALL_INT(us[i]));
+    }
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(machine_time_pulses_us_obj, 3, 4, machine_time_pulses_us);
+
 // ==== NVS Support ===================================================================
 
 static void checkNVS()
@@ -348,6 +417,7 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_enable_irq), MP_ROM_PTR(&machine_enable_irq_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_time_pulse_us), MP_ROM_PTR(&machine_time_pulse_us_obj) },
+    { MP_ROM_QSTR(MP_QSTR_time_pulses_us), MP_ROM_PTR(&machine_time_pulses_us_obj) },
 
     { MP_ROM_QSTR(MP_QSTR_Timer), MP_ROM_PTR(&machine_timer_type) },
     { MP_ROM_QSTR(MP_QSTR_WDT), MP_ROM_PTR(&machine_wdt_type) },
@@ -363,12 +433,14 @@ STATIC const mp_rom_map_elem_t machine_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_SLEEP), MP_ROM_INT(MACHINE_WAKE_SLEEP) },
     { MP_ROM_QSTR(MP_QSTR_DEEPSLEEP), MP_ROM_INT(MACHINE_WAKE_DEEPSLEEP) },
     { MP_ROM_QSTR(MP_QSTR_Pin), MP_ROM_PTR(&machine_pin_type) },
+    { MP_ROM_QSTR(MP_QSTR_PinGroup), MP_ROM_PTR(&machine_pin_group_type) },
     { MP_ROM_QSTR(MP_QSTR_Signal), MP_ROM_PTR(&machine_signal_type) },
     { MP_ROM_QSTR(MP_QSTR_TouchPad), MP_ROM_PTR(&machine_touchpad_type) },
     { MP_ROM_QSTR(MP_QSTR_ADC), MP_ROM_PTR(&machine_adc_type) },
     { MP_ROM_QSTR(MP_QSTR_DAC), MP_ROM_PTR(&machine_dac_type) },
     { MP_ROM_QSTR(MP_QSTR_I2C), MP_ROM_PTR(&machine_i2c_type) },
     { MP_ROM_QSTR(MP_QSTR_PWM), MP_ROM_PTR(&machine_pwm_type) },
+    { MP_ROM_QSTR(MP_QSTR_PWMGroup), MP_ROM_PTR(&machine_pwm_group_type) },
     { MP_ROM_QSTR(MP_QSTR_RTC), MP_ROM_PTR(&machine_rtc_type) },
     { MP_ROM_QSTR(MP_QSTR_SPI), MP_ROM_PTR(&mp_machine_soft_spi_type) },
     { MP_ROM_QSTR(MP_QSTR_UART), MP_ROM_PTR(&machine_uart_type) },
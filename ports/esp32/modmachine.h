@@ -8,6 +8,7 @@
 #define ADC_TIMER_NUM			3	        // Timer used in ADC module
 #define ADC_TIMER_DIVIDER       8           // 0.1 us per tick, 10 MHz
 #define ADC_TIMER_FREQ          10000000.0  //Timer frequency
+#define SB_AUDIO_TIMER_NUM      2           // Timer used by studuinobit.audio
 
 typedef enum {
     //MACHINE_WAKE_IDLE=0x01,
@@ -18,11 +19,14 @@ typedef enum {
 extern const mp_obj_type_t machine_timer_type;
 extern const mp_obj_type_t machine_wdt_type;
 extern const mp_obj_type_t machine_pin_type;
+extern const mp_obj_type_t machine_pin_group_type;
 extern const mp_obj_type_t machine_touchpad_type;
 extern const mp_obj_type_t machine_adc_type;
 extern const mp_obj_type_t machine_dac_type;
 extern const mp_obj_type_t machine_pwm_type;
+extern const mp_obj_type_t machine_pwm_group_type;
 extern const mp_obj_type_t machine_hw_spi_type;
+extern const mp_obj_type_t machine_hw_i2c_type;
 extern const mp_obj_type_t machine_uart_type;
 extern const mp_obj_type_t machine_rtc_type;
 
@@ -32,6 +36,26 @@ extern bool i2s_driver_installed;
 void machine_pins_init(void);
 void machine_pins_deinit(void);
 void machine_timer_deinit_all(void);
+void machine_adc_deinit(void);
+void machine_uart_deinit_all(void);
+void machine_hw_spi_deinit_all(void);
+void machine_hw_i2c_deinit_all(void);
+void machine_touchpad_deinit(void);
+void machine_dac_deinit(void);
+// Stop a streaming OTA update, see modota.c
+void mod_ota_deinit(void);
 int machine_pin_get_gpio(mp_obj_t pin_in);
+// IDF port number of a machine.UART object, or -1 for other objects
+int machine_uart_get_port(mp_obj_t uart_in);
+
+// LEDC channel of an active machine.PWM object, or -1 if it is deinitialised
+int machine_pwm_get_channel(mp_obj_t pwm_in);
+// Set the frequency (0 for silence) and duty (0-100%) of a PWM channel; may
+// be called from another task as long as the VM leaves the channel alone
+bool machine_pwm_set_tone(int channel, int freq, float dperc);
+// Share a hardware I2C controller with machine.I2C(port); the driver is
+// installed on first use and the pins must match any existing user
+esp_err_t machine_hw_i2c_claim(int port, int scl, int sda, uint32_t freq);
+void machine_hw_i2c_release(int port);
 
 #endif // MICROPY_INCLUDED_ESP32_MODMACHINE_H
@@ -0,0 +1,418 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2016 Damien P. George
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// The neopixel module.  Pixels are kept in buf in the byte order of the
+// strip, which is resolved once at construction, so that write() can hand
+// the buffer straight to esp_neopixel_write() or the RMT backend.  Brightness
+// and gamma correction are only applied on the way out, through a lookup
+// table, so reading back a pixel gives the value that was stored.
+
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/mphal.h"
+#include "py/mperrno.h"
+#include "modesp.h"
+
+// Maps linear intensity to the PWM duty that looks linear: round(255 * (i / 255) ** 2.8)
+STATIC const uint8_t neopixel_gamma8[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,   1,   1,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      2,   3,   3,   3,   3,   3,   3,   3,   4,   4,   4,   4,   4,   5,   5,   5,
+      5,   6,   6,   6,   6,   7,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,
+     10,  10,  11,  11,  11,  12,  12,  13,  13,  13,  14,  14,  15,  15,  16,  16,
+     17,  17,  18,  18,  19,  19,  20,  20,  21,  21,  22,  22,  23,  24,  24,  25,
+     25,  26,  27,  27,  28,  29,  29,  30,  31,  32,  32,  33,  34,  35,  35,  36,
+     37,  38,  39,  39,  40,  41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  50,
+     51,  52,  54,  55,  56,  57,  58,  59,  60,  61,  62,  63,  64,  66,  67,  68,
+     69,  70,  72,  73,  74,  75,  77,  78,  79,  81,  82,  83,  85,  86,  87,  89,
+     90,  92,  93,  95,  96,  98,  99, 101, 102, 104, 105, 107, 109, 110, 112, 114,
+    115, 117, 119, 120, 122, 124, 126, 127, 129, 131, 133, 135, 137, 138, 140, 142,
+    144, 146, 148, 150, 152, 154, 156, 158, 160, 162, 164, 167, 169, 171, 173, 175,
+    177, 180, 182, 184, 186, 189, 191, 193, 196, 198, 200, 203, 205, 208, 210, 213,
+    215, 218, 220, 223, 225, 228, 231, 233, 236, 239, 241, 244, 247, 249, 252, 255,
+};
+
+typedef struct _neopixel_obj_t {
+    mp_obj_base_t base;
+    mp_obj_t pin;
+    mp_obj_t buf;           // bytearray referencing data
+    uint8_t *data;          // n * bpp bytes in the byte order of the strip
+    uint8_t *out;           // data passed through lut, or NULL if lut is NULL
+    uint8_t *lut;           // brightness and gamma, or NULL if neither is used
+    size_t n;
+    uint8_t bpp;
+    uint8_t timing;
+    uint8_t brightness;
+    bool gamma;
+    bool rmt;
+    gpio_num_t gpio;
+    uint8_t order[4];       // offset within a pixel of the R, G, B and W bytes
+} neopixel_obj_t;
+
+const mp_obj_type_t neopixel_type;
+
+STATIC void neopixel_set_order(neopixel_obj_t *self, mp_obj_t order_in) {
+    static const char names[] = "RGBW";
+    mp_uint_t seen = 0;
+    if (order_in == mp_const_none) {
+        // GRB(W), as used by WS2812
+        static const uint8_t grb[4] = {1, 0, 2, 3};
+        memcpy(self->order, grb, sizeof(grb));
+    } else if (mp_obj_is_str(order_in)) {
+        size_t len;
+        const char *s = mp_obj_str_get_data(order_in, &len);
+        if (len != self->bpp) {
+            goto invalid;
+        }
+        for (size_t pos = 0; pos < len; ++pos) {
+            const char *c = memchr(names, s[pos], self->bpp);
+            if (c == NULL) {
+                goto invalid;
+            }
+            self->order[c - names] = pos;
+            seen |= 1 << (c - names);
+        }
+    } else {
+        // a tuple like the ORDER attribute of the Python driver, whose extra
+        // entries are ignored when bpp is 3
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(order_in, &len, &items);
+        if (len < self->bpp) {
+            goto invalid;
+        }
+        for (size_t i = 0; i < self->bpp; ++i) {
+            mp_uint_t pos = mp_obj_get_int(items[i]);
+            if (pos >= self->bpp) {
+                goto invalid;
+            }
+            self->order[i] = pos;
+            seen |= 1 << pos;
+        }
+    }
+    if (order_in == mp_const_none || seen == (1u << self->bpp) - 1) {
+        return;
+    }
+invalid:
+    mp_raise_ValueError("invalid order");
+}
+
+STATIC void neopixel_update_lut(neopixel_obj_t *self) {
+    if (self->brightness == 255 && !self->gamma) {
+        self->lut = NULL;
+        self->out = NULL;
+        return;
+    }
+    if (self->lut == NULL) {
+        self->lut = m_new(uint8_t, 256);
+        self->out = m_new(uint8_t, self->n * self->bpp);
+    }
+    uint32_t scale = self->brightness + 1;
+    for (int i = 0; i < 256; ++i) {
+        uint32_t v = self->gamma ? neopixel_gamma8[i] : i;
+        self->lut[i] = v * scale >> 8;
+    }
+}
+
+// Stores the bpp colour components of val, in R, G, B, W order, to a pixel
+STATIC void neopixel_store(neopixel_obj_t *self, uint8_t *pix, mp_obj_t val) {
+    mp_obj_t *items;
+    mp_obj_get_array_fixed_n(val, self->bpp, &items);
+    for (size_t i = 0; i < self->bpp; ++i) {
+        pix[self->order[i]] = mp_obj_get_int(items[i]);
+    }
+}
+
+STATIC void neopixel_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "NeoPixel(%O, %u, bpp=%u, timing=%u, backend='%s', brightness=%u, gamma=%s)",
+        self->pin, (unsigned)self->n, self->bpp, self->timing, self->rmt ? "rmt" : "bitbang",
+        self->brightness, self->gamma ? "True" : "False");
+}
+
+// NeoPixel(pin, n, bpp=3, timing=1, backend='bitbang', order=None, *, brightness=255, gamma=False)
+//
+// order takes a string such as 'GRB' or 'RGBW', or a tuple giving the byte
+// offset of R, G, B and W in a pixel.  It is positional so that a subclass
+// can pass it through super().__init__(), which doesn't forward keywords.
+STATIC mp_obj_t neopixel_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *all_args) {
+    enum { ARG_pin, ARG_n, ARG_bpp, ARG_timing, ARG_backend, ARG_order, ARG_brightness, ARG_gamma };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_pin, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_n, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_bpp, MP_ARG_INT, {.u_int = 3} },
+        { MP_QSTR_timing, MP_ARG_INT, {.u_int = 1} },
+        { MP_QSTR_backend, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_QSTR(MP_QSTR_bitbang)} },
+        { MP_QSTR_order, MP_ARG_OBJ, {.u_rom_obj = MP_ROM_NONE} },
+        { MP_QSTR_brightness, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 255} },
+        { MP_QSTR_gamma, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all_kw_array(n_args, n_kw, all_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    qstr backend = mp_obj_str_get_qstr(args[ARG_backend].u_obj);
+    if (backend != MP_QSTR_bitbang && backend != MP_QSTR_rmt) {
+        mp_raise_ValueError("invalid backend");
+    }
+    if (args[ARG_bpp].u_int != 3 && args[ARG_bpp].u_int != 4) {
+        mp_raise_ValueError("bpp must be 3 or 4");
+    }
+    if (args[ARG_n].u_int < 0) {
+        mp_raise_ValueError(NULL);
+    }
+
+    neopixel_obj_t *self = m_new_obj(neopixel_obj_t);
+    self->base.type = type;
+    self->pin = args[ARG_pin].u_obj;
+    self->gpio = mp_hal_get_pin_obj(self->pin);
+    self->n = args[ARG_n].u_int;
+    self->bpp = args[ARG_bpp].u_int;
+    self->timing = args[ARG_timing].u_int;
+    self->rmt = backend == MP_QSTR_rmt;
+    neopixel_set_order(self, args[ARG_order].u_obj);
+    self->data = m_new0(uint8_t, self->n * self->bpp);
+    self->buf = mp_obj_new_bytearray_by_ref(self->n * self->bpp, self->data);
+    self->lut = NULL;
+    self->out = NULL;
+    self->brightness = MIN(MAX(args[ARG_brightness].u_int, 0), 255);
+    self->gamma = args[ARG_gamma].u_bool;
+    neopixel_update_lut(self);
+
+    mp_hal_pin_output(self->gpio);
+
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t neopixel_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return mp_obj_new_bool(self->n != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->n);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+// Pixels are read and written as tuples of bpp integers in R, G, B(, W)
+// order.  A slice can be assigned from a bytes-like object holding the
+// components of each pixel in the same order, or from a sequence of tuples.
+STATIC mp_obj_t neopixel_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (value == MP_OBJ_NULL) {
+        // delete
+        return MP_OBJ_NULL; // op not supported
+    }
+
+    if (mp_obj_is_type(index, &mp_type_slice)) {
+        mp_bound_slice_t slice;
+        if (!mp_seq_get_fast_slice_indexes(self->n, index, &slice)) {
+            mp_raise_NotImplementedError("only slices with step=1 (aka None) are supported");
+        }
+        size_t npix = slice.stop > slice.start ? slice.stop - slice.start : 0;
+        uint8_t *pix = self->data + slice.start * self->bpp;
+        if (value == MP_OBJ_SENTINEL) {
+            // load, into a bytes object in R, G, B(, W) order
+            vstr_t vstr;
+            vstr_init_len(&vstr, npix * self->bpp);
+            uint8_t *dest = (uint8_t*)vstr.buf;
+            for (size_t i = 0; i < npix; ++i, pix += self->bpp, dest += self->bpp) {
+                for (size_t c = 0; c < self->bpp; ++c) {
+                    dest[c] = pix[self->order[c]];
+                }
+            }
+            return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+        }
+        mp_buffer_info_t bufinfo;
+        if (mp_get_buffer(value, &bufinfo, MP_BUFFER_READ)) {
+            if (bufinfo.len != npix * self->bpp) {
+                mp_raise_ValueError("buffer size must match slice");
+            }
+            const uint8_t *src = bufinfo.buf;
+            uint8_t *tmp = NULL;
+            if (src >= self->data && src < self->data + self->n * self->bpp) {
+                // the source is this strip's own buffer, eg np[1:] = np.buf[:-3]
+                tmp = m_new(uint8_t, bufinfo.len);
+                memcpy(tmp, src, bufinfo.len);
+                src = tmp;
+            }
+            for (size_t i = 0; i < npix; ++i, pix += self->bpp, src += self->bpp) {
+                for (size_t c = 0; c < self->bpp; ++c) {
+                    pix[self->order[c]] = src[c];
+                }
+            }
+            if (tmp != NULL) {
+                m_del(uint8_t, tmp, bufinfo.len);
+            }
+        } else {
+            size_t len;
+            mp_obj_t *items;
+            mp_obj_get_array(value, &len, &items);
+            if (len != npix) {
+                mp_raise_ValueError("sequence size must match slice");
+            }
+            for (size_t i = 0; i < npix; ++i, pix += self->bpp) {
+                neopixel_store(self, pix, items[i]);
+            }
+        }
+        return mp_const_none;
+    }
+
+    size_t i = mp_get_index(self->base.type, self->n, index, false);
+    uint8_t *pix = self->data + i * self->bpp;
+    if (value == MP_OBJ_SENTINEL) {
+        // load
+        mp_obj_t tuple[4];
+        for (size_t c = 0; c < self->bpp; ++c) {
+            tuple[c] = MP_OBJ_NEW_SMALL_INT(pix[self->order[c]]);
+        }
+        return mp_obj_new_tuple(self->bpp, tuple);
+    }
+    neopixel_store(self, pix, value);
+    return mp_const_none;
+}
+
+STATIC mp_int_t neopixel_get_buffer(mp_obj_t self_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    (void)flags;
+    bufinfo->buf = self->data;
+    bufinfo->len = self->n * self->bpp;
+    bufinfo->typecode = 'B';
+    return 0;
+}
+
+// Sets every pixel to color: the first pixel is stored, then the filled part
+// of the buffer is copied onto the rest, doubling it each time.
+STATIC mp_obj_t neopixel_fill(mp_obj_t self_in, mp_obj_t color) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t len = self->n * self->bpp;
+    if (len == 0) {
+        return mp_const_none;
+    }
+    neopixel_store(self, self->data, color);
+    for (size_t done = self->bpp; done < len; done *= 2) {
+        memcpy(self->data + done, self->data, MIN(done, len - done));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(neopixel_fill_obj, neopixel_fill);
+
+// With the RMT backend the frame is encoded up front and sent in the
+// background, so buf may be modified as soon as this returns.
+STATIC mp_obj_t neopixel_write(mp_obj_t self_in) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t len = self->n * self->bpp;
+    uint8_t *pixels = self->data;
+    if (self->lut != NULL) {
+        const uint8_t *lut = self->lut;
+        for (size_t i = 0; i < len; ++i) {
+            self->out[i] = lut[pixels[i]];
+        }
+        pixels = self->out;
+    }
+    if (self->rmt) {
+        if (esp_neopixel_rmt_write(self->gpio, pixels, len, self->timing) != 0) {
+            mp_raise_OSError(MP_EIO);
+        }
+    } else {
+        esp_neopixel_write(self->gpio, pixels, len, self->timing);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(neopixel_write_obj, neopixel_write);
+
+// Blocks until a background RMT transfer has been clocked out.
+STATIC mp_obj_t neopixel_wait(mp_obj_t self_in) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->rmt) {
+        esp_neopixel_rmt_wait(self->gpio);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(neopixel_wait_obj, neopixel_wait);
+
+// brightness([value]): gets or sets the 0-255 scale applied by write()
+STATIC mp_obj_t neopixel_brightness(size_t n_args, const mp_obj_t *args) {
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (n_args == 1) {
+        return MP_OBJ_NEW_SMALL_INT(self->brightness);
+    }
+    self->brightness = MIN(MAX(mp_obj_get_int(args[1]), 0), 255);
+    neopixel_update_lut(self);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(neopixel_brightness_obj, 1, 2, neopixel_brightness);
+
+STATIC void neopixel_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        // store/delete is not supported
+        return;
+    }
+    neopixel_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (attr) {
+        case MP_QSTR_pin: dest[0] = self->pin; break;
+        case MP_QSTR_n: dest[0] = MP_OBJ_NEW_SMALL_INT(self->n); break;
+        case MP_QSTR_bpp: dest[0] = MP_OBJ_NEW_SMALL_INT(self->bpp); break;
+        case MP_QSTR_timing: dest[0] = MP_OBJ_NEW_SMALL_INT(self->timing); break;
+        case MP_QSTR_buf: dest[0] = self->buf; break;
+        default:
+            // continue lookup in locals_dict
+            dest[1] = MP_OBJ_SENTINEL;
+            break;
+    }
+}
+
+STATIC const mp_rom_map_elem_t neopixel_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_fill), MP_ROM_PTR(&neopixel_fill_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&neopixel_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&neopixel_wait_obj) },
+    { MP_ROM_QSTR(MP_QSTR_brightness), MP_ROM_PTR(&neopixel_brightness_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(neopixel_locals_dict, neopixel_locals_dict_table);
+
+const mp_obj_type_t neopixel_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_NeoPixel,
+    .print = neopixel_print,
+    .make_new = neopixel_make_new,
+    .unary_op = neopixel_unary_op,
+    .subscr = neopixel_subscr,
+    .attr = neopixel_attr,
+    .buffer_p = { .get_buffer = neopixel_get_buffer },
+    .locals_dict = (mp_obj_dict_t*)&neopixel_locals_dict,
+};
+
+STATIC const mp_rom_map_elem_t neopixel_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_neopixel) },
+    { MP_ROM_QSTR(MP_QSTR_NeoPixel), MP_ROM_PTR(&neopixel_type) },
+};
+STATIC MP_DEFINE_CONST_DICT(neopixel_module_globals, neopixel_module_globals_table);
+
+const mp_obj_module_t mp_module_neopixel = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&neopixel_module_globals,
+};
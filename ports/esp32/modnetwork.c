@@ -41,6 +41,7 @@
 #include "py/mphal.h"
 #include "py/mperrno.h"
 #include "netutils.h"
+#include "esp_attr.h"
 #include "esp_eth.h"
 #include "esp_wifi.h"
 #include "esp_wifi_types.h"
@@ -124,6 +125,102 @@ static bool wifi_sta_connected = false;
 // Store the current status. 0 means None here, safe to do so as first enum value is WIFI_REASON_UNSPECIFIED=1.
 static uint8_t wifi_sta_disconn_reason = 0;
 
+// What the last successful STA connection used, for connect(fast=True).  It is
+// in RTC memory so that it survives deep sleep, the case it is meant for.
+#define WIFI_FAST_MAGIC (0x57464331)
+typedef struct _wifi_fast_cache_t {
+    uint32_t magic;             // WIFI_FAST_MAGIC if the rest is valid
+    uint8_t ssid[32];
+    uint8_t bssid[6];
+    uint8_t channel;
+    tcpip_adapter_ip_info_t ip_info;
+    ip_addr_t dns;
+} wifi_fast_cache_t;
+static RTC_DATA_ATTR wifi_fast_cache_t wifi_fast_cache;
+
+// Set while a connect(fast=True) hasn't got its IP address yet, and while the
+// STA runs with the cached address instead of DHCP.
+static bool wifi_fast_pending = false;
+static bool wifi_fast_static_ip = false;
+
+// Events for WLAN.irq(); the handler is called as handler(event, data)
+#define WLAN_EVENT_STA_CONNECTED        (0x01)
+#define WLAN_EVENT_STA_DISCONNECTED     (0x02)  // data is the reason
+#define WLAN_EVENT_STA_GOT_IP           (0x04)
+#define WLAN_EVENT_SCAN_DONE            (0x08)  // data is the list of APs found
+#define WLAN_EVENT_AP_STACONNECTED      (0x10)
+#define WLAN_EVENT_AP_STADISCONNECTED   (0x20)
+#define WLAN_EVENT_ALL                  (0x3f)
+
+static uint8_t wlan_irq_events = 0;
+
+STATIC mp_obj_t esp_scan_results(void);
+
+// Runs from the scheduler with the event in the low byte of arg and its
+// data above it.
+STATIC mp_obj_t wlan_irq_dispatch(mp_obj_t arg_in) {
+    mp_int_t arg = MP_OBJ_SMALL_INT_VALUE(arg_in);
+    mp_obj_t handler = MP_STATE_PORT(network_wlan_irq_handler);
+    if (handler == MP_OBJ_NULL) {
+        return mp_const_none;
+    }
+    mp_int_t event = arg & 0xff;
+    mp_obj_t data = mp_const_none;
+    if (event == WLAN_EVENT_STA_DISCONNECTED) {
+        data = MP_OBJ_NEW_SMALL_INT(arg >> 8);
+    } else if (event == WLAN_EVENT_SCAN_DONE) {
+        data = esp_scan_results();
+    }
+    return mp_call_function_2(handler, MP_OBJ_NEW_SMALL_INT(event), data);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(wlan_irq_dispatch_obj, wlan_irq_dispatch);
+
+// Called from the event task, so can't allocate on the heap.
+static void wlan_irq_post(uint8_t event, uint8_t data) {
+    if ((wlan_irq_events & event) && MP_STATE_PORT(network_wlan_irq_handler) != MP_OBJ_NULL) {
+        mp_sched_schedule(MP_OBJ_FROM_PTR(&wlan_irq_dispatch_obj), MP_OBJ_NEW_SMALL_INT(event | data << 8));
+        xTaskNotifyGive(mp_main_task_handle);
+    }
+}
+
+void esp_network_deinit(void) {
+    wlan_irq_events = 0;
+    MP_STATE_PORT(network_wlan_irq_handler) = MP_OBJ_NULL;
+}
+
+// Called from the event task when the STA has an address.
+static void wifi_fast_cache_store(const tcpip_adapter_ip_info_t *ip_info) {
+    wifi_ap_record_t ap;
+    wifi_config_t cfg;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK || esp_wifi_get_config(ESP_IF_WIFI_STA, &cfg) != ESP_OK) {
+        return;
+    }
+    wifi_fast_cache.magic = 0;
+    memcpy(wifi_fast_cache.ssid, cfg.sta.ssid, sizeof(wifi_fast_cache.ssid));
+    memcpy(wifi_fast_cache.bssid, ap.bssid, sizeof(wifi_fast_cache.bssid));
+    wifi_fast_cache.channel = ap.primary;
+    wifi_fast_cache.ip_info = *ip_info;
+    wifi_fast_cache.dns = *dns_getserver(0);
+    wifi_fast_cache.magic = WIFI_FAST_MAGIC;
+}
+
+// Called from the event task when a fast connect failed: forget the cache and
+// let the reconnect go through a scan and DHCP.
+static void wifi_fast_fallback(void) {
+    wifi_fast_cache.magic = 0;
+    wifi_fast_pending = false;
+    wifi_config_t cfg;
+    if (esp_wifi_get_config(ESP_IF_WIFI_STA, &cfg) == ESP_OK) {
+        cfg.sta.bssid_set = 0;
+        cfg.sta.channel = 0;
+        esp_wifi_set_config(ESP_IF_WIFI_STA, &cfg);
+    }
+    if (wifi_fast_static_ip) {
+        wifi_fast_static_ip = false;
+        tcpip_adapter_dhcpc_start(TCPIP_ADAPTER_IF_STA);
+    }
+}
+
 // This function is called by the system-event task and so runs in a different
 // thread to the main MicroPython task.  It must not raise any Python exceptions.
 static esp_err_t event_handler(void *ctx, system_event_t *event) {
@@ -133,11 +230,15 @@ static esp_err_t event_handler(void *ctx, system_event_t *event) {
         break;
     case SYSTEM_EVENT_STA_CONNECTED:
         ESP_LOGI("network", "CONNECTED");
+        wlan_irq_post(WLAN_EVENT_STA_CONNECTED, 0);
         break;
     case SYSTEM_EVENT_STA_GOT_IP:
         ESP_LOGI("network", "GOT_IP");
         wifi_sta_connected = true;
         wifi_sta_disconn_reason = 0; // Success so clear error. (in case of new error will be replaced anyway)
+        wifi_fast_pending = false;
+        wifi_fast_cache_store(&event->event_info.got_ip.ip_info);
+        wlan_irq_post(WLAN_EVENT_STA_GOT_IP, 0);
         break;
     case SYSTEM_EVENT_STA_DISCONNECTED: {
         // This is a workaround as ESP32 WiFi libs don't currently
@@ -164,7 +265,11 @@ static esp_err_t event_handler(void *ctx, system_event_t *event) {
         }
         ESP_LOGI("wifi", "STA_DISCONNECTED, reason:%d%s", disconn->reason, message);
 
+        if (wifi_fast_pending) {
+            wifi_fast_fallback();
+        }
         wifi_sta_connected = false;
+        wlan_irq_post(WLAN_EVENT_STA_DISCONNECTED, disconn->reason);
         if (wifi_sta_connect_requested) {
             wifi_mode_t mode;
             if (esp_wifi_get_mode(&mode) == ESP_OK) {
@@ -179,6 +284,15 @@ static esp_err_t event_handler(void *ctx, system_event_t *event) {
         }
         break;
     }
+    case SYSTEM_EVENT_SCAN_DONE:
+        wlan_irq_post(WLAN_EVENT_SCAN_DONE, 0);
+        break;
+    case SYSTEM_EVENT_AP_STACONNECTED:
+        wlan_irq_post(WLAN_EVENT_AP_STACONNECTED, 0);
+        break;
+    case SYSTEM_EVENT_AP_STADISCONNECTED:
+        wlan_irq_post(WLAN_EVENT_AP_STADISCONNECTED, 0);
+        break;
     case SYSTEM_EVENT_GOT_IP6:
         ESP_LOGI("network", "Got IPv6");
         break;
@@ -292,12 +406,18 @@ STATIC mp_obj_t esp_active(size_t n_args, const mp_obj_t *args) {
 
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp_active_obj, 1, 2, esp_active);
 
+// connect([ssid, [password]], *, bssid=None, fast=False)
+// With fast, and if the last connection before a deep sleep was to the same
+// SSID, its channel and BSSID are used instead of a scan, and its DHCP address
+// instead of asking again.  If that fails the cache is dropped and the
+// reconnect does a full scan and DHCP.
 STATIC mp_obj_t esp_connect(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
-    enum { ARG_ssid, ARG_password, ARG_bssid };
+    enum { ARG_ssid, ARG_password, ARG_bssid, ARG_fast };
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_, MP_ARG_OBJ, {.u_obj = mp_const_none} },
         { MP_QSTR_, MP_ARG_OBJ, {.u_obj = mp_const_none} },
         { MP_QSTR_bssid, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_fast, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
     };
 
     // parse args
@@ -326,8 +446,36 @@ STATIC mp_obj_t esp_connect(size_t n_args, const mp_obj_t *pos_args, mp_map_t *k
             wifi_sta_config.sta.bssid_set = 1;
             memcpy(wifi_sta_config.sta.bssid, p, sizeof(wifi_sta_config.sta.bssid));
         }
+    } else {
+        ESP_EXCEPTIONS( esp_wifi_get_config(ESP_IF_WIFI_STA, &wifi_sta_config) );
+    }
+
+    bool fast = args[ARG_fast].u_bool
+        && wifi_fast_cache.magic == WIFI_FAST_MAGIC
+        && memcmp(wifi_fast_cache.ssid, wifi_sta_config.sta.ssid, sizeof(wifi_fast_cache.ssid)) == 0;
+    if (fast) {
+        if (!wifi_sta_config.sta.bssid_set) {
+            wifi_sta_config.sta.bssid_set = 1;
+            memcpy(wifi_sta_config.sta.bssid, wifi_fast_cache.bssid, sizeof(wifi_sta_config.sta.bssid));
+        }
+        wifi_sta_config.sta.channel = wifi_fast_cache.channel;
+        wifi_sta_config.sta.scan_method = WIFI_FAST_SCAN;
+
+        esp_err_t e = tcpip_adapter_dhcpc_stop(TCPIP_ADAPTER_IF_STA);
+        if (e != ESP_OK && e != ESP_ERR_TCPIP_ADAPTER_DHCP_ALREADY_STOPPED) _esp_exceptions(e);
+        ESP_EXCEPTIONS(tcpip_adapter_set_ip_info(TCPIP_ADAPTER_IF_STA, &wifi_fast_cache.ip_info));
+        tcpip_adapter_dns_info_t dns_info = { .ip = wifi_fast_cache.dns };
+        ESP_EXCEPTIONS(tcpip_adapter_set_dns_info(TCPIP_ADAPTER_IF_STA, TCPIP_ADAPTER_DNS_MAIN, &dns_info));
+        wifi_fast_static_ip = true;
+    } else if (wifi_fast_static_ip) {
+        // the address came from the cache, so go back to DHCP
+        wifi_fast_static_ip = false;
+        ESP_EXCEPTIONS(tcpip_adapter_dhcpc_start(TCPIP_ADAPTER_IF_STA));
+    }
+    if (n_args > 1 || fast) {
         ESP_EXCEPTIONS( esp_wifi_set_config(ESP_IF_WIFI_STA, &wifi_sta_config) );
     }
+    wifi_fast_pending = fast;
 
     // connect to the WiFi AP
     MP_THREAD_GIL_EXIT();
@@ -409,7 +557,42 @@ STATIC mp_obj_t esp_status(size_t n_args, const mp_obj_t *args) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(esp_status_obj, 1, 2, esp_status);
 
-STATIC mp_obj_t esp_scan(mp_obj_t self_in) {
+// Fetch the results of the last scan as a list of tuples.
+STATIC mp_obj_t esp_scan_results(void) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    uint16_t count = 0;
+    ESP_EXCEPTIONS( esp_wifi_scan_get_ap_num(&count) );
+    // on the heap so that it isn't leaked if anything below raises
+    uint16_t alloc = count;
+    wifi_ap_record_t *wifi_ap_records = m_new(wifi_ap_record_t, alloc);
+    ESP_EXCEPTIONS( esp_wifi_scan_get_ap_records(&count, wifi_ap_records) );
+    for (uint16_t i = 0; i < count; i++) {
+        mp_obj_tuple_t *t = mp_obj_new_tuple(6, NULL);
+        uint8_t *x = memchr(wifi_ap_records[i].ssid, 0, sizeof(wifi_ap_records[i].ssid));
+        int ssid_len = x ? x - wifi_ap_records[i].ssid : sizeof(wifi_ap_records[i].ssid);
+        t->items[0] = mp_obj_new_bytes(wifi_ap_records[i].ssid, ssid_len);
+        t->items[1] = mp_obj_new_bytes(wifi_ap_records[i].bssid, sizeof(wifi_ap_records[i].bssid));
+        t->items[2] = MP_OBJ_NEW_SMALL_INT(wifi_ap_records[i].primary);
+        t->items[3] = MP_OBJ_NEW_SMALL_INT(wifi_ap_records[i].rssi);
+        t->items[4] = MP_OBJ_NEW_SMALL_INT(wifi_ap_records[i].authmode);
+        t->items[5] = mp_const_false; // XXX hidden?
+        mp_obj_list_append(list, MP_OBJ_FROM_PTR(t));
+    }
+    m_del(wifi_ap_record_t, wifi_ap_records, alloc);
+    return list;
+}
+
+// scan(*, block=True)
+// Without block the scan runs in the background and the list is passed to
+// the WLAN.irq() handler with EVENT_SCAN_DONE.
+STATIC mp_obj_t esp_scan(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_block };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_block, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
     // check that STA mode is active
     wifi_mode_t mode;
     ESP_EXCEPTIONS(esp_wifi_get_mode(&mode));
@@ -417,35 +600,48 @@ STATIC mp_obj_t esp_scan(mp_obj_t self_in) {
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "STA must be active"));
     }
 
-    mp_obj_t list = mp_obj_new_list(0, NULL);
     wifi_scan_config_t config = { 0 };
     // XXX how do we scan hidden APs (and if we can scan them, are they really hidden?)
+    if (!args[ARG_block].u_bool) {
+        ESP_EXCEPTIONS( esp_wifi_scan_start(&config, 0) );
+        return mp_const_none;
+    }
     MP_THREAD_GIL_EXIT();
     esp_err_t status = esp_wifi_scan_start(&config, 1);
     MP_THREAD_GIL_ENTER();
-    if (status == 0) {
-        uint16_t count = 0;
-        ESP_EXCEPTIONS( esp_wifi_scan_get_ap_num(&count) );
-        wifi_ap_record_t *wifi_ap_records = calloc(count, sizeof(wifi_ap_record_t));
-        ESP_EXCEPTIONS( esp_wifi_scan_get_ap_records(&count, wifi_ap_records) );
-        for (uint16_t i = 0; i < count; i++) {
-            mp_obj_tuple_t *t = mp_obj_new_tuple(6, NULL);
-            uint8_t *x = memchr(wifi_ap_records[i].ssid, 0, sizeof(wifi_ap_records[i].ssid));
-            int ssid_len = x ? x - wifi_ap_records[i].ssid : sizeof(wifi_ap_records[i].ssid);
-            t->items[0] = mp_obj_new_bytes(wifi_ap_records[i].ssid, ssid_len);
-            t->items[1] = mp_obj_new_bytes(wifi_ap_records[i].bssid, sizeof(wifi_ap_records[i].bssid));
-            t->items[2] = MP_OBJ_NEW_SMALL_INT(wifi_ap_records[i].primary);
-            t->items[3] = MP_OBJ_NEW_SMALL_INT(wifi_ap_records[i].rssi);
-            t->items[4] = MP_OBJ_NEW_SMALL_INT(wifi_ap_records[i].authmode);
-            t->items[5] = mp_const_false; // XXX hidden?
-            mp_obj_list_append(list, MP_OBJ_FROM_PTR(t));
-        }
-        free(wifi_ap_records);
+    if (status != 0) {
+        return mp_obj_new_list(0, NULL);
     }
-    return list;
+    return esp_scan_results();
 }
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(esp_scan_obj, 1, esp_scan);
 
-STATIC MP_DEFINE_CONST_FUN_OBJ_1(esp_scan_obj, esp_scan);
+// irq(handler=None, events=EVENT_ALL)
+// Call handler(event, data) from the scheduler for the given events of either
+// interface, so that connections and scans don't have to be polled for.
+STATIC mp_obj_t esp_irq(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_handler, ARG_events };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_handler, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_events, MP_ARG_INT, {.u_int = WLAN_EVENT_ALL} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args - 1, pos_args + 1, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t handler = args[ARG_handler].u_obj;
+    if (handler == mp_const_none) {
+        wlan_irq_events = 0;
+        MP_STATE_PORT(network_wlan_irq_handler) = MP_OBJ_NULL;
+    } else {
+        if (!mp_obj_is_callable(handler)) {
+            mp_raise_ValueError("handler must be callable");
+        }
+        MP_STATE_PORT(network_wlan_irq_handler) = handler;
+        wlan_irq_events = args[ARG_events].u_int & WLAN_EVENT_ALL;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(esp_irq_obj, 1, esp_irq);
 
 STATIC mp_obj_t esp_isconnected(mp_obj_t self_in) {
     wlan_if_obj_t *self = MP_OBJ_TO_PTR(self_in);
@@ -677,6 +873,7 @@ STATIC const mp_rom_map_elem_t wlan_if_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_disconnect), MP_ROM_PTR(&esp_disconnect_obj) },
     { MP_ROM_QSTR(MP_QSTR_status), MP_ROM_PTR(&esp_status_obj) },
     { MP_ROM_QSTR(MP_QSTR_scan), MP_ROM_PTR(&esp_scan_obj) },
+    { MP_ROM_QSTR(MP_QSTR_irq), MP_ROM_PTR(&esp_irq_obj) },
     { MP_ROM_QSTR(MP_QSTR_isconnected), MP_ROM_PTR(&esp_isconnected_obj) },
     { MP_ROM_QSTR(MP_QSTR_config), MP_ROM_PTR(&esp_config_obj) },
     { MP_ROM_QSTR(MP_QSTR_ifconfig), MP_ROM_PTR(&esp_ifconfig_obj) },
@@ -734,6 +931,14 @@ STATIC const mp_rom_map_elem_t mp_module_network_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_STAT_IDLE), MP_ROM_INT(STAT_IDLE)},
     { MP_ROM_QSTR(MP_QSTR_STAT_CONNECTING), MP_ROM_INT(STAT_CONNECTING)},
     { MP_ROM_QSTR(MP_QSTR_STAT_GOT_IP), MP_ROM_INT(STAT_GOT_IP)},
+
+    { MP_ROM_QSTR(MP_QSTR_EVENT_STA_CONNECTED), MP_ROM_INT(WLAN_EVENT_STA_CONNECTED)},
+    { MP_ROM_QSTR(MP_QSTR_EVENT_STA_DISCONNECTED), MP_ROM_INT(WLAN_EVENT_STA_DISCONNECTED)},
+    { MP_ROM_QSTR(MP_QSTR_EVENT_STA_GOT_IP), MP_ROM_INT(WLAN_EVENT_STA_GOT_IP)},
+    { MP_ROM_QSTR(MP_QSTR_EVENT_SCAN_DONE), MP_ROM_INT(WLAN_EVENT_SCAN_DONE)},
+    { MP_ROM_QSTR(MP_QSTR_EVENT_AP_STACONNECTED), MP_ROM_INT(WLAN_EVENT_AP_STACONNECTED)},
+    { MP_ROM_QSTR(MP_QSTR_EVENT_AP_STADISCONNECTED), MP_ROM_INT(WLAN_EVENT_AP_STADISCONNECTED)},
+    { MP_ROM_QSTR(MP_QSTR_EVENT_ALL), MP_ROM_INT(WLAN_EVENT_ALL)},
     // Errors from the ESP-IDF
     { MP_ROM_QSTR(MP_QSTR_STAT_NO_AP_FOUND), MP_ROM_INT(WIFI_REASON_NO_AP_FOUND)},
     { MP_ROM_QSTR(MP_QSTR_STAT_WRONG_PASSWORD), MP_ROM_INT(WIFI_REASON_AUTH_FAIL)},
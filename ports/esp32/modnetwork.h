@@ -29,13 +29,27 @@
 enum { PHY_LAN8720, PHY_TLK110 };
 
 MP_DECLARE_CONST_FUN_OBJ_KW(get_lan_obj);
-MP_DECLARE_CONST_FUN_OBJ_1(ppp_make_new_obj);
+MP_DECLARE_CONST_FUN_OBJ_KW(ppp_make_new_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(esp_ifconfig_obj);
 
 void usocket_events_deinit(void);
+void esp_network_deinit(void);
 
 extern bool wifi_started;
 
+NORETURN void _esp_exceptions(esp_err_t e);
+
+// Hooks for protocols built on ESP-NOW, see esp_espnow.c.  The receive hook
+// is called on the WiFi task for every frame and returns true if it has
+// consumed it.  espnow_send_frame sends to a registered peer, waiting for
+// room in the TX window, and raises on error.  espnow_send_frame_nowait
+// may be called from the receive hook; it returns false instead of waiting
+// when the window is full or the frame could not be queued.
+typedef bool (*espnow_recv_hook_t)(const uint8_t *mac, const uint8_t *data, int len);
+void espnow_set_recv_hook(espnow_recv_hook_t hook);
+void espnow_send_frame(const uint8_t *addr, const uint8_t *buf, size_t len);
+bool espnow_send_frame_nowait(const uint8_t *addr, const uint8_t *buf, size_t len);
+
 typedef struct _wlan_if_obj_t {
     mp_obj_base_t base;
     int if_id;
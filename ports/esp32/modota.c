@@ -35,6 +35,7 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
 #include <sys/socket.h>
 #include <netdb.h>
 
@@ -48,9 +49,15 @@
 //#include "soc/dport_reg.h"
 #include "esp_log.h"
 //#include "esp_http_client.h"
+#include "mbedtls/sha256.h"
 
 #include "py/runtime.h"
+#include "py/mperrno.h"
+#if MICROPY_PY_UZLIB
+#include "extmod/uzlib/tinf.h"
+#endif
 #include "modmachine.h"
+#include "modesp32.h"
 #include "mphalport.h"
 //#include "extmod/vfs_native.h"
 
@@ -590,6 +597,555 @@ STATIC mp_obj_t mod_ota_fromfile(mp_uint_t n_args, const mp_obj_t *pos_args, mp_
 STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_ota_fromfile_obj, 0, mod_ota_fromfile);
 #endif 
 
+// Streaming update writer: Python downloads the image and feeds it to
+// write() while a separate task erases, writes and hashes the previous
+// chunk, so the network is not left idle during flash operations.  Two
+// BUFFSIZE slots circulate between the VM and the writer task through a
+// pair of queues.  The partition is written directly rather than through
+// esp_ota_write() so an interrupted download can be resumed from any
+// sector boundary; esp_ota_set_boot_partition() verifies the image.
+//
+// A gzip or zlib compressed image is inflated by the writer task itself:
+// uzlib pulls its input from the slots through a read callback, so the
+// decompressor blocks in the task rather than in the VM.
+//
+// A data partition such as the module bundle (see esp32_bundle.c) can be
+// written the same way; it is not checked for an app image and does not
+// change the boot partition.
+
+#define OTA_SECTOR_SIZE     (4096)
+#define OTA_ERASE_BLOCK     (65536)
+#define OTA_NUM_SLOTS       (2)
+#define OTA_SLOT_STOP       (0xff)
+
+typedef struct _ota_writer_t {
+    const esp_partition_t *partition;
+    mbedtls_sha256_context sha;
+    uint8_t *slot[OTA_NUM_SLOTS];
+    uint16_t slot_len[OTA_NUM_SLOTS];
+    int cur;                    // slot being filled by write(), or -1
+    QueueHandle_t full_q;       // VM -> task
+    QueueHandle_t free_q;       // task -> VM
+    TaskHandle_t task;
+    uint32_t offset;            // next byte to be queued
+    uint32_t erase_end;
+    volatile uint32_t flashed;  // bytes written to flash
+    uint32_t size;              // expected image size, 0 if unknown
+    uint8_t expect_sha[32];
+    bool check_sha;
+    volatile esp_err_t err;
+    bool active;
+    bool ending;                // end() is waiting with the GIL released
+    bool compressed;
+    bool is_app;
+    #if MICROPY_PY_UZLIB
+    TINF_DATA *inflate;
+    int in_idx;                 // slot uzlib is reading from, or -1
+    #endif
+} ota_writer_t;
+
+static ota_writer_t ota_writer;
+
+//--------------------------------------------------------------------
+static esp_err_t ota_write_chunk(ota_writer_t *w, const uint8_t *buf, size_t len)
+{
+    uint32_t addr = w->flashed;
+    if ((addr + len) > w->partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (w->is_app && (addr == 0) && (len > 0) && (buf[0] != 0xE9)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    while (w->erase_end < (addr + len)) {
+        // large aligned erases are much faster than sector by sector
+        uint32_t n = OTA_SECTOR_SIZE;
+        if (((w->erase_end % OTA_ERASE_BLOCK) == 0) && ((w->erase_end + OTA_ERASE_BLOCK) <= w->partition->size)) {
+            n = OTA_ERASE_BLOCK;
+        }
+        esp_err_t err = esp_partition_erase_range(w->partition, w->erase_end, n);
+        if (err != ESP_OK) return err;
+        w->erase_end += n;
+    }
+    esp_err_t err = esp_partition_write(w->partition, addr, buf, len);
+    if (err != ESP_OK) return err;
+    mbedtls_sha256_update_ret(&w->sha, buf, len);
+    w->flashed = addr + len;
+    return ESP_OK;
+}
+
+#if MICROPY_PY_UZLIB
+// uzlib input callback, hands the used slot back and waits for the next
+//------------------------------------------------
+static int ota_inflate_read(TINF_DATA *d)
+{
+    ota_writer_t *w = &ota_writer;
+    uint8_t idx;
+    if (w->in_idx >= 0) {
+        idx = w->in_idx;
+        w->in_idx = -1;
+        xQueueSend(w->free_q, &idx, portMAX_DELAY);
+    }
+    xQueueReceive(w->full_q, &idx, portMAX_DELAY);
+    if (idx == OTA_SLOT_STOP) {
+        // put it back for the drain loop in ota_writer_task()
+        xQueueSendToFront(w->full_q, &idx, portMAX_DELAY);
+        return -1;
+    }
+    w->in_idx = idx;
+    d->source = w->slot[idx] + 1;
+    d->source_limit = w->slot[idx] + w->slot_len[idx];
+    return w->slot[idx][0];
+}
+
+//-------------------------------------------
+static esp_err_t ota_inflate(ota_writer_t *w)
+{
+    TINF_DATA *d = w->inflate;
+    uint8_t *out = malloc(BUFFSIZE);
+    if (out == NULL) return ESP_ERR_NO_MEM;
+
+    memset(d, 0, sizeof(*d));
+    d->readSource = ota_inflate_read;
+    esp_err_t err = ESP_ERR_INVALID_CRC;
+    int c = ota_inflate_read(d);
+    if (c < 0) goto done;
+    // peek at the first byte to tell gzip (1f 8b) from zlib (78 ..)
+    d->source--;
+    int dict_bits;
+    if (c == 0x1f) {
+        if (uzlib_gzip_parse_header(d) != TINF_OK) goto done;
+        dict_bits = 15;
+    }
+    else {
+        // returns the window size as log2 minus 8
+        dict_bits = uzlib_zlib_parse_header(d);
+        if (dict_bits < 0) goto done;
+        dict_bits += 8;
+    }
+    uint8_t *dict = malloc(1 << dict_bits);
+    if (dict == NULL) {
+        err = ESP_ERR_NO_MEM;
+        goto done;
+    }
+    uzlib_uncompress_init(d, dict, 1 << dict_bits);
+
+    int st;
+    err = ESP_OK;
+    do {
+        d->dest = out;
+        d->dest_limit = out + BUFFSIZE;
+        st = uzlib_uncompress_chksum(d);
+        if (st < 0) break;
+        if (d->dest > out) {
+            err = ota_write_chunk(w, out, d->dest - out);
+            if (err != ESP_OK) break;
+        }
+    } while (st != TINF_DONE);
+    if (st < 0) err = ESP_ERR_INVALID_CRC;
+    free(dict);
+
+done:
+    free(out);
+    if (w->in_idx >= 0) {
+        uint8_t idx = w->in_idx;
+        w->in_idx = -1;
+        xQueueSend(w->free_q, &idx, portMAX_DELAY);
+    }
+    return err;
+}
+#endif
+
+//=========================================
+static void ota_writer_task(void *pvParameters)
+{
+    ota_writer_t *w = (ota_writer_t *)pvParameters;
+    uint8_t idx;
+    #if MICROPY_PY_UZLIB
+    if (w->compressed) {
+        w->err = ota_inflate(w);
+    }
+    #endif
+    // slots arriving after the end of a compressed image or after an
+    // error are just handed back
+    while (xQueueReceive(w->full_q, &idx, portMAX_DELAY) == pdTRUE) {
+        if (idx == OTA_SLOT_STOP) break;
+        if ((w->err == ESP_OK) && !w->compressed) {
+            w->err = ota_write_chunk(w, w->slot[idx], w->slot_len[idx]);
+        }
+        xQueueSend(w->free_q, &idx, portMAX_DELAY);
+    }
+    // tell ota_writer_join() we are gone
+    idx = OTA_SLOT_STOP;
+    xQueueSend(w->free_q, &idx, portMAX_DELAY);
+    vTaskDelete(NULL);
+}
+
+// Wait for a slot to come back from the writer task
+//-------------------------------------------
+static uint8_t ota_writer_take_slot(ota_writer_t *w)
+{
+    uint8_t idx;
+    while (xQueueReceive(w->free_q, &idx, 0) != pdTRUE) {
+        MICROPY_EVENT_POLL_HOOK
+    }
+    return idx;
+}
+
+//-------------------------------------------
+static void ota_writer_queue_slot(ota_writer_t *w)
+{
+    uint8_t idx = w->cur;
+    w->cur = -1;
+    xQueueSend(w->full_q, &idx, portMAX_DELAY);
+}
+
+// Let the task finish everything queued so far and exit
+//-------------------------------------------
+static void ota_writer_join(ota_writer_t *w)
+{
+    if (w->task != NULL) {
+        uint8_t idx = OTA_SLOT_STOP;
+        xQueueSend(w->full_q, &idx, portMAX_DELAY);
+        do {
+            xQueueReceive(w->free_q, &idx, portMAX_DELAY);
+        } while (idx != OTA_SLOT_STOP);
+        w->task = NULL;
+    }
+}
+
+// Stop the task and release everything, leaving the flash as it is
+//-------------------------------------------
+static void ota_writer_stop(ota_writer_t *w)
+{
+    ota_writer_join(w);
+    if (w->full_q != NULL) vQueueDelete(w->full_q);
+    if (w->free_q != NULL) vQueueDelete(w->free_q);
+    w->full_q = NULL;
+    w->free_q = NULL;
+    for (int i = 0; i < OTA_NUM_SLOTS; i++) {
+        free(w->slot[i]);
+        w->slot[i] = NULL;
+    }
+    #if MICROPY_PY_UZLIB
+    free(w->inflate);
+    w->inflate = NULL;
+    #endif
+    if (w->active) mbedtls_sha256_free(&w->sha);
+    w->active = false;
+}
+
+//-------------------------------------------------------
+static void ota_writer_check(ota_writer_t *w)
+{
+    if (w->ending) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    if (!w->active) {
+        mp_raise_msg(&mp_type_OSError, "OTA update not started");
+    }
+    if (w->err != ESP_OK) {
+        esp_err_t err = w->err;
+        ota_writer_stop(w);
+        if (err == ESP_ERR_INVALID_SIZE) {
+            mp_raise_ValueError("image bigger than the partition");
+        }
+        if (err == ESP_ERR_INVALID_ARG) {
+            mp_raise_ValueError("invalid image magic byte");
+        }
+        if (err == ESP_ERR_INVALID_CRC) {
+            mp_raise_ValueError("bad compressed data");
+        }
+        if (err == ESP_ERR_NO_MEM) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+        mp_raise_OSError(MP_EIO);
+    }
+}
+
+// begin(partition=None, *, size=0, sha256=None, offset=0, compressed=False)
+//
+// Start writing an image to the named app or data partition, by default the next
+// OTA partition.  sha256 is the expected digest as 32 bytes or 64 hex
+// digits.  A non-zero offset, which must be a multiple of 4096, resumes an
+// earlier attempt: the bytes already in flash are kept and hashed.
+// With compressed=True the data given to write() is a gzip or zlib stream;
+// size and sha256 then refer to the uncompressed image and offset must be 0.
+//------------------------------------------------------------------------------------------
+STATIC mp_obj_t mod_ota_begin(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
+{
+    enum { ARG_partition, ARG_size, ARG_sha256, ARG_offset, ARG_compressed };
+    const mp_arg_t allowed_args[] = {
+            { MP_QSTR_partition, MP_ARG_OBJ,                   {.u_obj = mp_const_none} },
+            { MP_QSTR_size,      MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+            { MP_QSTR_sha256,    MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+            { MP_QSTR_offset,    MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 0} },
+            { MP_QSTR_compressed, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    ota_writer_t *w = &ota_writer;
+    if (w->ending) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    ota_writer_stop(w);
+
+    const esp_partition_t *part;
+    if (args[ARG_partition].u_obj == mp_const_none) {
+        part = esp_ota_get_next_update_partition(NULL);
+    }
+    else {
+        const char *label = mp_obj_str_get_str(args[ARG_partition].u_obj);
+        part = esp_partition_find_first(ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_ANY, label);
+        if (part == NULL) {
+            part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+        }
+    }
+    if (part == NULL) {
+        mp_raise_ValueError("partition not found");
+    }
+    if (part == esp_ota_get_running_partition()) {
+        mp_raise_ValueError("cannot update the running partition");
+    }
+    if (esp32_bundle_is_mapped(part)) {
+        mp_raise_ValueError("partition in use, umount it first");
+    }
+
+    mp_int_t size = args[ARG_size].u_int;
+    mp_int_t offset = args[ARG_offset].u_int;
+    if ((size < 0) || (size > (mp_int_t)part->size)) {
+        mp_raise_ValueError("image bigger than the partition");
+    }
+    if ((offset < 0) || ((offset % OTA_SECTOR_SIZE) != 0) || (offset > (mp_int_t)part->size) || ((size > 0) && (offset > size))) {
+        mp_raise_ValueError("bad offset");
+    }
+    bool compressed = args[ARG_compressed].u_bool;
+    #if MICROPY_PY_UZLIB
+    if (compressed && (offset != 0)) {
+        mp_raise_ValueError("compressed image cannot be resumed");
+    }
+    #else
+    if (compressed) {
+        mp_raise_ValueError("compressed images not supported");
+    }
+    #endif
+
+    w->check_sha = false;
+    if (args[ARG_sha256].u_obj != mp_const_none) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[ARG_sha256].u_obj, &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len == 32) {
+            memcpy(w->expect_sha, bufinfo.buf, 32);
+        }
+        else if (bufinfo.len == 64) {
+            const char *hex = bufinfo.buf;
+            for (int i = 0; i < 64; i++) {
+                char c = hex[i];
+                if (!unichar_isxdigit(c)) {
+                    mp_raise_ValueError("bad sha256");
+                }
+                uint8_t v = unichar_xdigit_value(c);
+                if (i & 1) w->expect_sha[i >> 1] |= v;
+                else w->expect_sha[i >> 1] = v << 4;
+            }
+        }
+        else {
+            mp_raise_ValueError("bad sha256");
+        }
+        w->check_sha = true;
+    }
+
+    w->partition = part;
+    w->size = size;
+    w->offset = offset;
+    w->flashed = offset;
+    w->erase_end = offset;
+    w->err = ESP_OK;
+    w->cur = -1;
+    w->compressed = compressed;
+    w->is_app = (part->type == ESP_PARTITION_TYPE_APP);
+    mbedtls_sha256_init(&w->sha);
+    mbedtls_sha256_starts_ret(&w->sha, 0);
+    w->active = true;
+
+    for (int i = 0; i < OTA_NUM_SLOTS; i++) {
+        w->slot[i] = malloc(BUFFSIZE);
+        if (w->slot[i] == NULL) {
+            ota_writer_stop(w);
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+    #if MICROPY_PY_UZLIB
+    w->in_idx = -1;
+    if (compressed) {
+        w->inflate = malloc(sizeof(TINF_DATA));
+        if (w->inflate == NULL) {
+            ota_writer_stop(w);
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+    #endif
+
+    // hash what an earlier attempt already wrote, reusing a slot
+    for (uint32_t pos = 0; pos < offset; pos += BUFFSIZE) {
+        uint32_t n = ((offset - pos) < BUFFSIZE) ? (offset - pos) : BUFFSIZE;
+        if (esp_partition_read(part, pos, w->slot[0], n) != ESP_OK) {
+            ota_writer_stop(w);
+            mp_raise_OSError(MP_EIO);
+        }
+        mbedtls_sha256_update_ret(&w->sha, w->slot[0], n);
+        MICROPY_EVENT_POLL_HOOK
+    }
+
+    w->full_q = xQueueCreate(OTA_NUM_SLOTS + 1, sizeof(uint8_t));
+    w->free_q = xQueueCreate(OTA_NUM_SLOTS + 1, sizeof(uint8_t));
+    if ((w->full_q == NULL) || (w->free_q == NULL)) {
+        ota_writer_stop(w);
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    for (uint8_t i = 0; i < OTA_NUM_SLOTS; i++) {
+        xQueueSend(w->free_q, &i, 0);
+    }
+    if (xTaskCreate(ota_writer_task, "ota_writer", 3072, w, ESP_TASK_PRIO_MIN + 1, &w->task) != pdPASS) {
+        w->task = NULL;
+        ota_writer_stop(w);
+        mp_raise_OSError(MP_ENOMEM);
+    }
+
+    ESP_LOGI(TAG, "Writing to '%s' partition from offset %d", part->label, offset);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(mod_ota_begin_obj, 0, mod_ota_begin);
+
+// write(buf): queue the next part of the image, only blocks while both
+// slots are still being written to flash
+//---------------------------------------------------
+STATIC mp_obj_t mod_ota_write(mp_obj_t buf_in)
+{
+    ota_writer_t *w = &ota_writer;
+    ota_writer_check(w);
+
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_READ);
+    const uint8_t *src = bufinfo.buf;
+    size_t len = bufinfo.len;
+
+    if (!w->compressed) {
+        // catch these before anything is queued, the task checks the
+        // output of the decompressor
+        if (w->is_app && (w->offset == 0) && (len > 0) && (src[0] != 0xE9)) {
+            mp_raise_ValueError("invalid image magic byte");
+        }
+        if ((w->offset + len) > ((w->size > 0) ? w->size : w->partition->size)) {
+            mp_raise_ValueError("more data than expected");
+        }
+    }
+
+    while (len > 0) {
+        if (w->cur < 0) {
+            w->cur = ota_writer_take_slot(w);
+            w->slot_len[w->cur] = 0;
+        }
+        size_t n = BUFFSIZE - w->slot_len[w->cur];
+        if (n > len) n = len;
+        memcpy(w->slot[w->cur] + w->slot_len[w->cur], src, n);
+        w->slot_len[w->cur] += n;
+        w->offset += n;
+        src += n;
+        len -= n;
+        if (w->slot_len[w->cur] == BUFFSIZE) {
+            ota_writer_queue_slot(w);
+        }
+    }
+    return mp_obj_new_int(bufinfo.len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mod_ota_write_obj, mod_ota_write);
+
+// end(): flush, check size and digest, and make an app partition bootable
+//---------------------------------
+STATIC mp_obj_t mod_ota_end(void)
+{
+    ota_writer_t *w = &ota_writer;
+    ota_writer_check(w);
+
+    if (w->cur >= 0) {
+        ota_writer_queue_slot(w);
+    }
+    // the task exits once everything queued is in flash; for a compressed
+    // image the end of the input also ends the stream.  Other threads run
+    // meanwhile but can't use the writer until it is done.
+    w->ending = true;
+    MP_HAL_BLOCKING_BEGIN(MP_OBJ_NULL);
+    ota_writer_join(w);
+    MP_HAL_BLOCKING_END();
+    w->ending = false;
+    ota_writer_check(w);
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish_ret(&w->sha, digest);
+    const esp_partition_t *part = w->partition;
+    bool is_app = w->is_app;
+    uint32_t flashed = w->flashed;
+    bool size_ok = (w->size == 0) || (flashed == w->size);
+    bool sha_ok = !w->check_sha || (memcmp(digest, w->expect_sha, 32) == 0);
+    ota_writer_stop(w);
+
+    if (!size_ok) {
+        mp_raise_ValueError("image incomplete");
+    }
+    if (!sha_ok) {
+        mp_raise_ValueError("sha256 mismatch");
+    }
+    if (!is_app) {
+        return mp_obj_new_bytes(digest, 32);
+    }
+    // this reads back and verifies the whole image
+    esp_err_t err;
+    MP_HAL_BLOCKING_BEGIN(MP_OBJ_NULL);
+    err = esp_ota_set_boot_partition(part);
+    MP_HAL_BLOCKING_END();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "OTA set_boot_partition failed! err=0x%x", err);
+        mp_raise_ValueError("invalid image");
+    }
+    ESP_LOGW(TAG, "On next reboot the system will be started from '%s' partition", part->label);
+    return mp_obj_new_bytes(digest, 32);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_ota_end_obj, mod_ota_end);
+
+// abort(): stop writing, what is already in flash can be resumed later
+// unless the image was compressed
+//-----------------------------------
+STATIC mp_obj_t mod_ota_abort(void)
+{
+    if (ota_writer.ending) {
+        mp_raise_OSError(MP_EBUSY);
+    }
+    ota_writer_stop(&ota_writer);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_ota_abort_obj, mod_ota_abort);
+
+// progress() -> (flashed, queued, size)
+//--------------------------------------
+STATIC mp_obj_t mod_ota_progress(void)
+{
+    ota_writer_t *w = &ota_writer;
+    mp_obj_t tuple[3];
+    tuple[0] = mp_obj_new_int_from_uint(w->flashed);
+    tuple[1] = mp_obj_new_int_from_uint(w->offset);
+    tuple[2] = mp_obj_new_int_from_uint(w->size);
+    return mp_obj_new_tuple(3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_ota_progress_obj, mod_ota_progress);
+
+// Called on soft reset while an update may still be in progress
+//-----------------------
+void mod_ota_deinit(void)
+{
+    ota_writer_stop(&ota_writer);
+}
+
 //---------------------------------------------------------------------------------------------
 STATIC mp_obj_t mod_ota_set_boot(mp_uint_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args)
 {
@@ -647,6 +1203,11 @@ STATIC const mp_rom_map_elem_t ota_module_globals_table[] = {
 //    { MP_ROM_QSTR(MP_QSTR_start),			MP_ROM_PTR(&mod_ota_start_obj) },
 //    { MP_ROM_QSTR(MP_QSTR_fromfile),		MP_ROM_PTR(&mod_ota_fromfile_obj) },
     { MP_ROM_QSTR(MP_QSTR_set_bootpart),	MP_ROM_PTR(&mod_ota_set_boot_obj) },
+    { MP_ROM_QSTR(MP_QSTR_begin),			MP_ROM_PTR(&mod_ota_begin_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write),			MP_ROM_PTR(&mod_ota_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_end),				MP_ROM_PTR(&mod_ota_end_obj) },
+    { MP_ROM_QSTR(MP_QSTR_abort),			MP_ROM_PTR(&mod_ota_abort_obj) },
+    { MP_ROM_QSTR(MP_QSTR_progress),		MP_ROM_PTR(&mod_ota_progress_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(ota_module_globals, ota_module_globals_table);
 
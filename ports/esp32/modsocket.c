@@ -38,6 +38,7 @@
 
 #include "py/runtime0.h"
 #include "py/nlr.h"
+#include "py/binary.h"
 #include "py/objlist.h"
 #include "py/objstr.h"
 #include "py/runtime.h"
@@ -54,6 +55,10 @@
 #include "lwip/ip4.h"
 #include "lwip/igmp.h"
 #include "esp_log.h"
+#include "esp_task.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #define SOCKET_POLL_US (100000)
 
@@ -67,77 +72,310 @@ typedef struct _socket_obj_t {
     unsigned int retries;
     #if MICROPY_PY_USOCKET_EVENTS
     mp_obj_t events_callback;
-    struct _socket_obj_t *events_next;
     #endif
 } socket_obj_t;
 
 void _socket_settimeout(socket_obj_t *sock, uint64_t timeout_ms);
+NORETURN static void exception_from_errno(int _errno);
 
-#if MICROPY_PY_USOCKET_EVENTS
+// The watcher task below serves both socket event callbacks and poll objects
+#define USOCKET_WATCHER (MICROPY_PY_USOCKET_EVENTS || MICROPY_PY_USELECT_NOTIFY)
+
+#if USOCKET_WATCHER
 // Support for callbacks on asynchronous socket events (when socket becomes readable)
+//
+// A watcher task blocks in select() on every armed socket.  When one becomes
+// readable it is disarmed and its index pushed onto a single-producer,
+// single-consumer ring, and the MicroPython task is woken.  The event poll
+// hook then only has to drain the ring, so its cost does not depend on how
+// many sockets are registered.  A socket is armed again once its callback
+// returns, which makes the callbacks edge-triggered: a socket that stays
+// readable while its callback runs is reported once.  Re-arming wakes the
+// watcher through a UDP socket it listens on over the loopback interface.
+//
+// A socket registered with a uselect.poll object has a poll notifier.  When
+// polling finds some of the requested events not ready, the watcher watches
+// for those and bumps the notifier once any of them occurs, so poll only has
+// to ask the sockets that have changed.
+
+#define USOCKET_EVENTS_MAX          (MEMP_NUM_NETCONN)
+#define USOCKET_EVENTS_TASK_PRIO    (ESP_TASK_PRIO_MIN + 2)
+#define USOCKET_EVENTS_TASK_STACK   (2048)
+#define USOCKET_EVENTS_TIMEOUT_S    (1)  // rebuild the select set at least this often
+
+#if USOCKET_EVENTS_MAX > MICROPY_PY_USOCKET_EVENTS_MAX
+#error "MICROPY_PY_USOCKET_EVENTS_MAX is smaller than the number of lwIP sockets"
+#endif
+
+STATIC struct {
+    TaskHandle_t task;
+    SemaphoreHandle_t mutex;        // guards armed[], watch[] and the notifiers
+    int wake_fd;
+    struct sockaddr_in wake_addr;
+    bool in_handler;
+    bool armed[USOCKET_EVENTS_MAX];
+    #if MICROPY_PY_USELECT_NOTIFY
+    // MP_STREAM_POLL_* events to watch for on behalf of the poll notifier,
+    // which is in MP_STATE_PORT(usocket_poll_notify)
+    uint8_t watch[USOCKET_EVENTS_MAX];
+    #endif
+    // ring of socket indices, each present at most once as it is disarmed
+    // when pushed; head is written by the watcher, tail by MicroPython
+    uint32_t head;
+    uint32_t tail;
+    uint8_t ring[USOCKET_EVENTS_MAX];
+} usocket_events;
+
+STATIC void usocket_events_wake(void) {
+    uint8_t b = 0;
+    lwip_sendto_r(usocket_events.wake_fd, &b, 1, MSG_DONTWAIT,
+        (struct sockaddr *)&usocket_events.wake_addr, sizeof(usocket_events.wake_addr));
+}
 
-// This divisor is used to reduce the load on the system, so it doesn't poll sockets too often
-#define USOCKET_EVENTS_DIVISOR (8)
+STATIC void usocket_events_task(void *arg) {
+    for (;;) {
+        fd_set rfds, wfds, efds;
+        FD_ZERO(&rfds);
+        FD_ZERO(&wfds);
+        FD_ZERO(&efds);
+        FD_SET(usocket_events.wake_fd, &rfds);
+        int max_fd = usocket_events.wake_fd;
+        xSemaphoreTake(usocket_events.mutex, portMAX_DELAY);
+        for (int i = 0; i < USOCKET_EVENTS_MAX; ++i) {
+            int fd = LWIP_SOCKET_OFFSET + i;
+            uint8_t watch = usocket_events.armed[i] ? MP_STREAM_POLL_RD : 0;
+            #if MICROPY_PY_USELECT_NOTIFY
+            watch |= usocket_events.watch[i];
+            #endif
+            if (watch & MP_STREAM_POLL_RD) {
+                FD_SET(fd, &rfds);
+            }
+            if (watch & MP_STREAM_POLL_WR) {
+                FD_SET(fd, &wfds);
+            }
+            if (watch & MP_STREAM_POLL_HUP) {
+                FD_SET(fd, &efds);
+            }
+            if (watch) {
+                max_fd = MAX(max_fd, fd);
+            }
+        }
+        xSemaphoreGive(usocket_events.mutex);
 
-STATIC uint8_t usocket_events_divisor;
-STATIC socket_obj_t *usocket_events_head;
+        struct timeval timeout = { .tv_sec = USOCKET_EVENTS_TIMEOUT_S, .tv_usec = 0 };
+        int r = select(max_fd + 1, &rfds, &wfds, &efds, &timeout);
+        if (r <= 0) {
+            // timed out, or a socket was closed under us
+            continue;
+        }
+        if (FD_ISSET(usocket_events.wake_fd, &rfds)) {
+            uint8_t buf[8];
+            while (lwip_recvfrom_r(usocket_events.wake_fd, buf, sizeof(buf), MSG_DONTWAIT, NULL, NULL) > 0) {
+            }
+        }
 
-void usocket_events_deinit(void) {
-    usocket_events_head = NULL;
+        bool notify = false;
+        uint32_t head = usocket_events.head;
+        xSemaphoreTake(usocket_events.mutex, portMAX_DELAY);
+        for (int i = 0; i < USOCKET_EVENTS_MAX; ++i) {
+            int fd = LWIP_SOCKET_OFFSET + i;
+            if (usocket_events.armed[i] && FD_ISSET(fd, &rfds)) {
+                usocket_events.armed[i] = false;
+                usocket_events.ring[head++ % USOCKET_EVENTS_MAX] = i;
+                notify = true;
+            }
+            #if MICROPY_PY_USELECT_NOTIFY
+            uint8_t watch = usocket_events.watch[i];
+            if ((watch & MP_STREAM_POLL_RD && FD_ISSET(fd, &rfds))
+                || (watch & MP_STREAM_POLL_WR && FD_ISSET(fd, &wfds))
+                || (watch & MP_STREAM_POLL_HUP && FD_ISSET(fd, &efds))) {
+                // watched again when poll next finds the socket not ready
+                usocket_events.watch[i] = 0;
+                mp_stream_poll_notify(MP_STATE_PORT(usocket_poll_notify)[i]);
+                notify = true;
+            }
+            #endif
+        }
+        xSemaphoreGive(usocket_events.mutex);
+        if (notify) {
+            __atomic_store_n(&usocket_events.head, head, __ATOMIC_RELEASE);
+            xTaskNotifyGive(mp_main_task_handle);
+        }
+    }
 }
 
-// Assumes the socket is not already in the linked list, and adds it
-STATIC void usocket_events_add(socket_obj_t *sock) {
-    sock->events_next = usocket_events_head;
-    usocket_events_head = sock;
+#if MICROPY_PY_USOCKET_EVENTS
+STATIC void usocket_events_set_armed(int i, bool armed) {
+    xSemaphoreTake(usocket_events.mutex, portMAX_DELAY);
+    usocket_events.armed[i] = armed;
+    xSemaphoreGive(usocket_events.mutex);
+    usocket_events_wake();
 }
+#endif
 
-// Assumes the socket is already in the linked list, and removes it
-STATIC void usocket_events_remove(socket_obj_t *sock) {
-    for (socket_obj_t **s = &usocket_events_head;; s = &(*s)->events_next) {
-        if (*s == sock) {
-            *s = (*s)->events_next;
-            return;
+// Start the watcher on first use; it is kept across soft resets
+STATIC void usocket_events_init(void) {
+    if (usocket_events.task != NULL) {
+        return;
+    }
+    int fd = lwip_socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        exception_from_errno(errno);
+    }
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = lwip_htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addr_len = sizeof(addr);
+    if (lwip_bind_r(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+        || lwip_getsockname_r(fd, (struct sockaddr *)&addr, &addr_len) != 0) {
+        int err = errno;
+        lwip_close_r(fd);
+        exception_from_errno(err);
+    }
+    usocket_events.wake_fd = fd;
+    usocket_events.wake_addr = addr;
+    usocket_events.mutex = xSemaphoreCreateMutex();
+    if (usocket_events.mutex == NULL || xTaskCreate(usocket_events_task, "usock_ev",
+        USOCKET_EVENTS_TASK_STACK, NULL, USOCKET_EVENTS_TASK_PRIO, &usocket_events.task) != pdPASS) {
+        if (usocket_events.mutex != NULL) {
+            vSemaphoreDelete(usocket_events.mutex);
+            usocket_events.mutex = NULL;
         }
+        lwip_close_r(fd);
+        mp_raise_OSError(MP_ENOMEM);
     }
 }
 
-// Polls all registered sockets for readability and calls their callback if they are readable
-void usocket_events_handler(void) {
-    if (usocket_events_head == NULL) {
+void usocket_events_deinit(void) {
+    if (usocket_events.task == NULL) {
         return;
     }
-    if (--usocket_events_divisor) {
-        return;
+    xSemaphoreTake(usocket_events.mutex, portMAX_DELAY);
+    for (int i = 0; i < USOCKET_EVENTS_MAX; ++i) {
+        usocket_events.armed[i] = false;
+        MP_STATE_PORT(usocket_events_sock)[i] = NULL;
+        #if MICROPY_PY_USELECT_NOTIFY
+        usocket_events.watch[i] = 0;
+        MP_STATE_PORT(usocket_poll_notify)[i] = NULL;
+        #endif
     }
-    usocket_events_divisor = USOCKET_EVENTS_DIVISOR;
+    xSemaphoreGive(usocket_events.mutex);
+    usocket_events.tail = __atomic_load_n(&usocket_events.head, __ATOMIC_ACQUIRE);
+    usocket_events.in_handler = false;
+    usocket_events_wake();
+}
 
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    int max_fd = 0;
+#if MICROPY_PY_USELECT_NOTIFY
+// Handle MP_STREAM_POLL_NOTIFY: attach the notifier, or detach it if it is
+// already attached, as described in py/stream.h
+STATIC void usocket_poll_notify_attach(socket_obj_t *sock, mp_stream_poll_notify_t *notify) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        usocket_events_init();
+        nlr_pop();
+    } else {
+        // without the watcher the socket is simply polled every time
+        return;
+    }
+    int i = sock->fd - LWIP_SOCKET_OFFSET;
+    xSemaphoreTake(usocket_events.mutex, portMAX_DELAY);
+    mp_stream_poll_notify_t *old = MP_STATE_PORT(usocket_poll_notify)[i];
+    if (notify->attached) {
+        if (old == notify) {
+            MP_STATE_PORT(usocket_poll_notify)[i] = NULL;
+            usocket_events.watch[i] = 0;
+        }
+        notify->attached = false;
+    } else {
+        if (old != NULL) {
+            old->attached = false;
+        }
+        MP_STATE_PORT(usocket_poll_notify)[i] = notify;
+        usocket_events.watch[i] = 0;
+        notify->attached = true;
+    }
+    xSemaphoreGive(usocket_events.mutex);
+}
 
-    for (socket_obj_t *s = usocket_events_head; s != NULL; s = s->events_next) {
-        FD_SET(s->fd, &rfds);
-        max_fd = MAX(max_fd, s->fd);
+// Called when the socket is closed; its poller goes back to polling it
+STATIC void usocket_poll_notify_close(socket_obj_t *sock) {
+    if (usocket_events.task == NULL) {
+        return;
+    }
+    int i = sock->fd - LWIP_SOCKET_OFFSET;
+    xSemaphoreTake(usocket_events.mutex, portMAX_DELAY);
+    mp_stream_poll_notify_t *notify = MP_STATE_PORT(usocket_poll_notify)[i];
+    if (notify != NULL) {
+        notify->attached = false;
+        MP_STATE_PORT(usocket_poll_notify)[i] = NULL;
+        usocket_events.watch[i] = 0;
     }
+    xSemaphoreGive(usocket_events.mutex);
+}
 
-    // Poll the sockets
-    struct timeval timeout = { .tv_sec = 0, .tv_usec = 0 };
-    int r = select(max_fd + 1, &rfds, NULL, NULL, &timeout);
-    if (r <= 0) {
+// After a poll, have the watcher look for the requested events that were
+// not ready; only wakes it if that changes what it is watching
+STATIC void usocket_poll_notify_watch(socket_obj_t *sock, uint8_t events) {
+    if (usocket_events.task == NULL) {
         return;
     }
+    int i = sock->fd - LWIP_SOCKET_OFFSET;
+    bool changed = false;
+    xSemaphoreTake(usocket_events.mutex, portMAX_DELAY);
+    if (MP_STATE_PORT(usocket_poll_notify)[i] != NULL && usocket_events.watch[i] != events) {
+        usocket_events.watch[i] = events;
+        changed = true;
+    }
+    xSemaphoreGive(usocket_events.mutex);
+    if (changed) {
+        usocket_events_wake();
+    }
+}
+#endif
+
+#if MICROPY_PY_USOCKET_EVENTS
+// Assumes the socket is not already registered, and adds it
+STATIC void usocket_events_add(socket_obj_t *sock) {
+    usocket_events_init();
+    int i = sock->fd - LWIP_SOCKET_OFFSET;
+    MP_STATE_PORT(usocket_events_sock)[i] = sock;
+    usocket_events_set_armed(i, true);
+}
+
+// Assumes the socket is registered, and removes it; an entry for it that
+// is still in the ring is skipped by the handler
+STATIC void usocket_events_remove(socket_obj_t *sock) {
+    int i = sock->fd - LWIP_SOCKET_OFFSET;
+    MP_STATE_PORT(usocket_events_sock)[i] = NULL;
+    usocket_events_set_armed(i, false);
+}
 
-    // Call the callbacks
-    for (socket_obj_t *s = usocket_events_head; s != NULL; s = s->events_next) {
-        if (FD_ISSET(s->fd, &rfds)) {
+// Calls the callbacks of the sockets the watcher found readable
+void usocket_events_handler(void) {
+    uint32_t head = __atomic_load_n(&usocket_events.head, __ATOMIC_ACQUIRE);
+    if (head == usocket_events.tail || usocket_events.in_handler || !MP_STATE_CTX_IS_MAIN()) {
+        return;
+    }
+    usocket_events.in_handler = true;
+    while (usocket_events.tail != head) {
+        int i = usocket_events.ring[usocket_events.tail % USOCKET_EVENTS_MAX];
+        __atomic_store_n(&usocket_events.tail, usocket_events.tail + 1, __ATOMIC_RELEASE);
+        socket_obj_t *s = MP_STATE_PORT(usocket_events_sock)[i];
+        if (s != NULL) {
             mp_call_function_1_protected(s->events_callback, s);
+            // the callback may have closed or unregistered the socket
+            if (MP_STATE_PORT(usocket_events_sock)[i] == s) {
+                usocket_events_set_armed(i, true);
+            }
         }
     }
+    usocket_events.in_handler = false;
 }
-
 #endif // MICROPY_PY_USOCKET_EVENTS
 
+#endif // USOCKET_WATCHER
+
 NORETURN static void exception_from_errno(int _errno) {
     // Here we need to convert from lwip errno values to MicroPython's standard ones
     if (_errno == EINPROGRESS) {
@@ -425,7 +663,8 @@ STATIC mp_uint_t _socket_read_data(mp_obj_t self_in, void *buf, size_t size,
         if (release_gil) {
             MP_THREAD_GIL_ENTER();
         }
-        if (r == 0) {
+        if (r == 0 && sock->type == SOCK_STREAM) {
+            // a datagram socket can receive empty packets and stays open
             sock->peer_closed = true;
         }
         if (r >= 0) {
@@ -478,6 +717,108 @@ STATIC mp_obj_t socket_recvfrom(mp_obj_t self_in, mp_obj_t len_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_recvfrom_obj, socket_recvfrom);
 
+// Receive straight into a caller's writable buffer, so a loop taking in
+// datagrams at a high rate does not allocate a bytes object per packet
+STATIC mp_uint_t _socket_recv_into(size_t n_args, const mp_obj_t *args,
+        struct sockaddr *from, socklen_t *from_len) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    size_t len = bufinfo.len;
+    if (n_args > 2) {
+        mp_int_t nbytes = mp_obj_get_int(args[2]);
+        if (nbytes < 0) {
+            mp_raise_ValueError("negative buffersize");
+        }
+        if (nbytes != 0 && (size_t)nbytes < len) {
+            len = nbytes;
+        }
+    }
+
+    int errcode;
+    mp_uint_t ret = _socket_read_data(args[0], bufinfo.buf, len, from, from_len, &errcode);
+    if (ret == MP_STREAM_ERROR) {
+        exception_from_errno(errcode);
+    }
+    return ret;
+}
+
+STATIC mp_obj_t socket_recv_into(size_t n_args, const mp_obj_t *args) {
+    return mp_obj_new_int_from_uint(_socket_recv_into(n_args, args, NULL, NULL));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recv_into_obj, 2, 3, socket_recv_into);
+
+STATIC mp_obj_t socket_recvfrom_into(size_t n_args, const mp_obj_t *args) {
+    struct sockaddr from;
+    socklen_t fromlen = sizeof(from);
+
+    mp_obj_t tuple[2];
+    tuple[0] = mp_obj_new_int_from_uint(_socket_recv_into(n_args, args, &from, &fromlen));
+
+    uint8_t *ip = (uint8_t*)&((struct sockaddr_in*)&from)->sin_addr;
+    mp_uint_t port = lwip_ntohs(((struct sockaddr_in*)&from)->sin_port);
+    tuple[1] = netutils_format_inet_addr(ip, port, NETUTILS_BIG);
+
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recvfrom_into_obj, 2, 3, socket_recvfrom_into);
+
+// Fill bufs with datagrams: wait for the first as recv does, then take
+// whatever else has already arrived.  The length of each goes in the
+// sizes array and, if addrs is a list, the sender in addrs.  Returns the
+// number of datagrams received.
+STATIC mp_obj_t socket_recv_many(size_t n_args, const mp_obj_t *args) {
+    socket_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    size_t n_bufs;
+    mp_obj_t *bufs;
+    mp_obj_get_array(args[1], &n_bufs, &bufs);
+    mp_buffer_info_t sizes;
+    mp_get_buffer_raise(args[2], &sizes, MP_BUFFER_WRITE);
+    mp_obj_t *addrs = NULL;
+    if (n_args > 3 && args[3] != mp_const_none) {
+        if (!mp_obj_is_type(args[3], &mp_type_list)) {
+            mp_raise_TypeError("addrs must be a list");
+        }
+        size_t n_addrs;
+        mp_obj_list_get(args[3], &n_addrs, &addrs);
+        if (n_addrs < n_bufs) {
+            mp_raise_ValueError("addrs too short");
+        }
+    }
+    if (sizes.len / mp_binary_get_size('@', sizes.typecode, NULL) < n_bufs) {
+        mp_raise_ValueError("sizes too short");
+    }
+
+    size_t n = 0;
+    for (; n < n_bufs; ++n) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(bufs[n], &bufinfo, MP_BUFFER_WRITE);
+        struct sockaddr from;
+        socklen_t fromlen = sizeof(from);
+        int r;
+        if (n == 0) {
+            int errcode;
+            r = _socket_read_data(args[0], bufinfo.buf, bufinfo.len, &from, &fromlen, &errcode);
+            if (r == MP_STREAM_ERROR) {
+                exception_from_errno(errcode);
+            }
+        } else {
+            // an error here is left for the next call to report
+            r = lwip_recvfrom_r(self->fd, bufinfo.buf, bufinfo.len, MSG_DONTWAIT, &from, &fromlen);
+            if (r < 0) {
+                break;
+            }
+        }
+        mp_binary_set_val_array_from_int(sizes.typecode, sizes.buf, n, r);
+        if (addrs != NULL) {
+            uint8_t *ip = (uint8_t*)&((struct sockaddr_in*)&from)->sin_addr;
+            mp_uint_t port = lwip_ntohs(((struct sockaddr_in*)&from)->sin_port);
+            addrs[n] = netutils_format_inet_addr(ip, port, NETUTILS_BIG);
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(socket_recv_many_obj, 3, 4, socket_recv_many);
+
 int _socket_send(socket_obj_t *sock, const char *data, size_t datalen) {
     int sentlen = 0;
     for (int i=0; i<=sock->retries && sentlen < datalen; i++) {
@@ -513,6 +854,28 @@ STATIC mp_obj_t socket_sendall(const mp_obj_t arg0, const mp_obj_t arg1) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_sendall_obj, socket_sendall);
 
+STATIC void _socket_parse_addr(mp_obj_t addr_in, struct sockaddr_in *to) {
+    to->sin_len = sizeof(*to);
+    to->sin_family = AF_INET;
+    to->sin_port = lwip_htons(netutils_parse_inet_addr(addr_in, (uint8_t*)&to->sin_addr, NETUTILS_BIG));
+}
+
+// Send one datagram, to the connected peer if to is NULL.  Returns the
+// number of bytes sent, or -1 if the socket stayed busy for the timeout.
+STATIC int _socket_sendto(socket_obj_t *self, const void *buf, size_t len, const struct sockaddr_in *to) {
+    for (int i=0; i<=self->retries; i++) {
+        MP_THREAD_GIL_EXIT();
+        int ret = lwip_sendto_r(self->fd, buf, len, 0, (struct sockaddr*)to, to == NULL ? 0 : sizeof(*to));
+        MP_THREAD_GIL_ENTER();
+        if (ret >= 0) return ret;
+        if (errno != EWOULDBLOCK) {
+            exception_from_errno(errno);
+        }
+        check_for_exceptions();
+    }
+    return -1;
+}
+
 STATIC mp_obj_t socket_sendto(mp_obj_t self_in, mp_obj_t data_in, mp_obj_t addr_in) {
     socket_obj_t *self = MP_OBJ_TO_PTR(self_in);
 
@@ -522,25 +885,51 @@ STATIC mp_obj_t socket_sendto(mp_obj_t self_in, mp_obj_t data_in, mp_obj_t addr_
 
     // create the destination address
     struct sockaddr_in to;
-    to.sin_len = sizeof(to);
-    to.sin_family = AF_INET;
-    to.sin_port = lwip_htons(netutils_parse_inet_addr(addr_in, (uint8_t*)&to.sin_addr, NETUTILS_BIG));
+    _socket_parse_addr(addr_in, &to);
 
     // send the data
-    for (int i=0; i<=self->retries; i++) {
-        MP_THREAD_GIL_EXIT();
-        int ret = lwip_sendto_r(self->fd, bufinfo.buf, bufinfo.len, 0, (struct sockaddr*)&to, sizeof(to));
-        MP_THREAD_GIL_ENTER();
-        if (ret > 0) return mp_obj_new_int_from_uint(ret);
-        if (ret == -1 && errno != EWOULDBLOCK) {
-            exception_from_errno(errno);
-        }
-        check_for_exceptions();
+    int ret = _socket_sendto(self, bufinfo.buf, bufinfo.len, &to);
+    if (ret < 0) {
+        mp_raise_OSError(MP_ETIMEDOUT);
     }
-    mp_raise_OSError(MP_ETIMEDOUT); 
+    return mp_obj_new_int_from_uint(ret);
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_3(socket_sendto_obj, socket_sendto);
 
+// Send a sequence of (buf, addr) pairs in one call, addr being None for a
+// connected socket.  Stops early if the socket stays busy and returns the
+// number of datagrams sent.
+STATIC mp_obj_t socket_send_many(mp_obj_t self_in, mp_obj_t items_in) {
+    socket_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t n_items;
+    mp_obj_t *items;
+    mp_obj_get_array(items_in, &n_items, &items);
+
+    // consecutive datagrams usually go to the same place, so only parse
+    // the address again when it is a different object
+    mp_obj_t last_addr = MP_OBJ_NULL;
+    struct sockaddr_in to;
+    size_t n = 0;
+    for (; n < n_items; ++n) {
+        mp_obj_t *item;
+        mp_obj_get_array_fixed_n(items[n], 2, &item);
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(item[0], &bufinfo, MP_BUFFER_READ);
+        if (item[1] != last_addr && item[1] != mp_const_none) {
+            _socket_parse_addr(item[1], &to);
+        }
+        last_addr = item[1];
+        if (_socket_sendto(self, bufinfo.buf, bufinfo.len, last_addr == mp_const_none ? NULL : &to) < 0) {
+            if (n == 0) {
+                mp_raise_OSError(self->retries == 0 ? MP_EWOULDBLOCK : MP_ETIMEDOUT);
+            }
+            break;
+        }
+    }
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(socket_send_many_obj, socket_send_many);
+
 STATIC mp_obj_t socket_fileno(const mp_obj_t arg0) {
     socket_obj_t *self = MP_OBJ_TO_PTR(arg0);
     return mp_obj_new_int(self->fd);
@@ -571,6 +960,27 @@ STATIC mp_uint_t socket_stream_write(mp_obj_t self_in, const void *buf, mp_uint_
     return MP_STREAM_ERROR;
 }
 
+// Gather write for MP_STREAM_WRITEV, so a header and body go out in one
+// lwIP call without being joined first
+STATIC mp_uint_t socket_stream_writev(socket_obj_t *sock, const mp_stream_writev_t *wv, int *errcode) {
+    struct iovec iov[8];
+    int cnt = MIN(wv->iovcnt, MP_ARRAY_SIZE(iov));
+    for (int i = 0; i < cnt; i++) {
+        iov[i].iov_base = (void*)wv->iov[i].base;
+        iov[i].iov_len = wv->iov[i].len;
+    }
+    for (int i=0; i<=sock->retries; i++) {
+        MP_THREAD_GIL_EXIT();
+        int r = lwip_writev_r(sock->fd, iov, cnt);
+        MP_THREAD_GIL_ENTER();
+        if (r > 0) return r;
+        if (r < 0 && errno != EWOULDBLOCK) { *errcode = errno; return MP_STREAM_ERROR; }
+        check_for_exceptions();
+    }
+    *errcode = sock->retries == 0 ? MP_EWOULDBLOCK : MP_ETIMEDOUT;
+    return MP_STREAM_ERROR;
+}
+
 STATIC mp_uint_t socket_stream_ioctl(mp_obj_t self_in, mp_uint_t request, uintptr_t arg, int *errcode) {
     socket_obj_t * socket = self_in;
     if (request == MP_STREAM_POLL) {
@@ -593,9 +1003,22 @@ STATIC mp_uint_t socket_stream_ioctl(mp_obj_t self_in, mp_uint_t request, uintpt
         if (FD_ISSET(socket->fd, &rfds)) ret |= MP_STREAM_POLL_RD;
         if (FD_ISSET(socket->fd, &wfds)) ret |= MP_STREAM_POLL_WR;
         if (FD_ISSET(socket->fd, &efds)) ret |= MP_STREAM_POLL_HUP;
+        #if MICROPY_PY_USELECT_NOTIFY
+        usocket_poll_notify_watch(socket, arg & (MP_STREAM_POLL_RD | MP_STREAM_POLL_WR | MP_STREAM_POLL_HUP) & ~ret);
+        #endif
         return ret;
+    #if MICROPY_PY_USELECT_NOTIFY
+    } else if (request == MP_STREAM_POLL_NOTIFY) {
+        usocket_poll_notify_attach(socket, (mp_stream_poll_notify_t*)arg);
+        return 0;
+    #endif
+    } else if (request == MP_STREAM_WRITEV) {
+        return socket_stream_writev(socket, (const mp_stream_writev_t*)arg, errcode);
     } else if (request == MP_STREAM_CLOSE) {
         if (socket->fd >= 0) {
+            #if MICROPY_PY_USELECT_NOTIFY
+            usocket_poll_notify_close(socket);
+            #endif
             #if MICROPY_PY_USOCKET_EVENTS
             if (socket->events_callback != MP_OBJ_NULL) {
                 usocket_events_remove(socket);
@@ -628,6 +1051,10 @@ STATIC const mp_rom_map_elem_t socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_sendto), MP_ROM_PTR(&socket_sendto_obj) },
     { MP_ROM_QSTR(MP_QSTR_recv), MP_ROM_PTR(&socket_recv_obj) },
     { MP_ROM_QSTR(MP_QSTR_recvfrom), MP_ROM_PTR(&socket_recvfrom_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv_into), MP_ROM_PTR(&socket_recv_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recvfrom_into), MP_ROM_PTR(&socket_recvfrom_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_recv_many), MP_ROM_PTR(&socket_recv_many_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_many), MP_ROM_PTR(&socket_send_many_obj) },
     { MP_ROM_QSTR(MP_QSTR_setsockopt), MP_ROM_PTR(&socket_setsockopt_obj) },
     { MP_ROM_QSTR(MP_QSTR_settimeout), MP_ROM_PTR(&socket_settimeout_obj) },
     { MP_ROM_QSTR(MP_QSTR_setblocking), MP_ROM_PTR(&socket_setblocking_obj) },
@@ -637,7 +1064,9 @@ STATIC const mp_rom_map_elem_t socket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_readline_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writevec), MP_ROM_PTR(&mp_stream_writevec_obj) },
 };
 STATIC MP_DEFINE_CONST_DICT(socket_locals_dict, socket_locals_dict_table);
 
@@ -0,0 +1,52 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "py/runtime.h"
+#include "modstuduinobit.h"
+
+// Native drivers for the Studuino:bit board.  The frozen pystubit package
+// builds its user-facing classes on top of these submodules.
+
+STATIC const mp_rom_map_elem_t studuinobit_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_studuinobit) },
+
+    { MP_ROM_QSTR(MP_QSTR_display), MP_ROM_PTR(&studuinobit_display_module) },
+    { MP_ROM_QSTR(MP_QSTR_Image), MP_ROM_PTR(&studuinobit_image_type) },
+    { MP_ROM_QSTR(MP_QSTR_imu), MP_ROM_PTR(&studuinobit_imu_module) },
+    { MP_ROM_QSTR(MP_QSTR_button), MP_ROM_PTR(&studuinobit_button_module) },
+    { MP_ROM_QSTR(MP_QSTR_melody), MP_ROM_PTR(&studuinobit_melody_module) },
+    { MP_ROM_QSTR(MP_QSTR_audio), MP_ROM_PTR(&studuinobit_audio_module) },
+    { MP_ROM_QSTR(MP_QSTR_magcal), MP_ROM_PTR(&studuinobit_magcal_module) },
+    { MP_ROM_QSTR(MP_QSTR_radio), MP_ROM_PTR(&studuinobit_radio_module) },
+    { MP_ROM_QSTR(MP_QSTR_sensors), MP_ROM_PTR(&studuinobit_sensors_module) },
+};
+STATIC MP_DEFINE_CONST_DICT(studuinobit_module_globals, studuinobit_module_globals_table);
+
+const mp_obj_module_t mp_module_studuinobit = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&studuinobit_module_globals,
+};
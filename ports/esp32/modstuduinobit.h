@@ -0,0 +1,96 @@
+#ifndef MICROPY_INCLUDED_ESP32_MODSTUDUINOBIT_H
+#define MICROPY_INCLUDED_ESP32_MODSTUDUINOBIT_H
+
+#include "py/obj.h"
+
+// 5x5 LED matrix
+#define SB_DISPLAY_WIDTH        (5)
+#define SB_DISPLAY_HEIGHT       (5)
+#define SB_DISPLAY_NUM_PIXELS   (SB_DISPLAY_WIDTH * SB_DISPLAY_HEIGHT)
+#define SB_DISPLAY_POWER_PIN    (2)
+#define SB_DISPLAY_DATA_PIN     (4)
+
+// Number of animations that can be queued on the display
+#define SB_DISPLAY_ANIM_QUEUE_LEN (4)
+
+// Largest value accepted for a single colour component
+#define SB_COLOR_FACTOR_MAX     (0xff)
+
+extern const mp_obj_module_t studuinobit_display_module;
+
+void studuinobit_display_deinit(void);
+
+// Built-in 5x5 font covering printable ASCII, see studuinobit_font.c
+#define SB_FONT_WIDTH           (5)
+#define SB_FONT_FIRST           (' ')
+#define SB_FONT_NUM_GLYPHS      (95)
+
+extern const uint8_t studuinobit_font[SB_FONT_NUM_GLYPHS][SB_FONT_WIDTH];
+
+// Glyph index for c, falling back to '?' for characters not in the font
+static inline uint8_t studuinobit_font_index(unichar c) {
+    if (c < SB_FONT_FIRST || c >= SB_FONT_FIRST + SB_FONT_NUM_GLYPHS) {
+        c = '?';
+    }
+    return c - SB_FONT_FIRST;
+}
+
+// Sensor bus shared by the ICM20948 and the AK09916 behind it
+#define SB_IMU_SDA_PIN          (21)
+#define SB_IMU_SCL_PIN          (22)
+
+extern const mp_obj_module_t studuinobit_imu_module;
+
+void studuinobit_imu_deinit(void);
+
+// Gesture recogniser run by the IMU sampler, see studuinobit_gesture.c;
+// accel_fs is the ACCEL_FS_SEL field of the ICM20948 (0=2g .. 3=16g)
+void studuinobit_gesture_reset(uint8_t accel_fs);
+void studuinobit_gesture_update(const int16_t accel[3], uint32_t time_us);
+
+MP_DECLARE_CONST_FUN_OBJ_0(studuinobit_gesture_current_obj);
+MP_DECLARE_CONST_FUN_OBJ_1(studuinobit_gesture_is_obj);
+MP_DECLARE_CONST_FUN_OBJ_1(studuinobit_gesture_was_obj);
+MP_DECLARE_CONST_FUN_OBJ_0(studuinobit_gesture_get_all_obj);
+
+// Buttons A and B with debouncing and event queues, see studuinobit_button.c
+extern const mp_obj_type_t studuinobit_button_type;
+extern const mp_obj_module_t studuinobit_button_module;
+
+void studuinobit_button_deinit(void);
+
+// Melody playback on a machine.PWM channel, see studuinobit_melody.c
+extern const mp_obj_module_t studuinobit_melody_module;
+
+void studuinobit_melody_deinit(void);
+
+// Sample playback through the sigma-delta modulator, see studuinobit_audio.c
+extern const mp_obj_module_t studuinobit_audio_module;
+
+void studuinobit_audio_deinit(void);
+
+// micro:bit style radio framing over ESP-NOW, see studuinobit_radio.c
+extern const mp_obj_module_t studuinobit_radio_module;
+
+void studuinobit_radio_deinit(void);
+
+// Light sensor and thermistor readings, see studuinobit_sensors.c
+extern const mp_obj_module_t studuinobit_sensors_module;
+
+void studuinobit_sensors_deinit(void);
+
+// Magnetometer calibration engine, see studuinobit_magcal.c
+extern const mp_obj_module_t studuinobit_magcal_module;
+
+extern const mp_obj_type_t studuinobit_image_type;
+
+// Render the top-left 5x5 pixels of an Image (or an instance of a subclass)
+// into rgb as row-major RGB triples.  Returns false if image_in is not an
+// Image.
+bool studuinobit_image_get_rgb(mp_obj_t image_in, uint8_t *rgb);
+
+// Parse a colour given as (R,G,B), [R,G,B] or a 24-bit int into rgb[3],
+// raising the same exceptions as the pystubit Python layer.
+void studuinobit_get_color(mp_obj_t color_in, uint8_t rgb[3]);
+
+#endif // MICROPY_INCLUDED_ESP32_MODSTUDUINOBIT_H
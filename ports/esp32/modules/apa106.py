@@ -5,4 +5,6 @@ from neopixel import NeoPixel
 
 
 class APA106(NeoPixel):
-    ORDER = (0, 1, 2, 3)
+    # APA106 takes RGB rather than the GRB of WS2812
+    def __init__(self, pin, n, bpp=3, timing=1, backend='bitbang'):
+        super().__init__(pin, n, bpp, timing, backend, 'RGBW'[:bpp])
@@ -0,0 +1,132 @@
+# Download a firmware image over HTTP(S) straight into the next OTA
+# partition.  The image is fed to ota.write() while the previous chunk is
+# being flashed by the writer task; a dropped connection is resumed with
+# an HTTP Range request from the last complete flash sector.  A gzip or
+# zlib compressed image is inflated on the board as it is written; it
+# cannot be resumed, so a dropped connection starts it again.
+import usocket
+import ota
+
+CHUNK = 4096
+SECTOR = 4096
+TIMEOUT = 10 # sec
+
+
+def _open(url, offset):
+    proto, _, host, path = url.split('/', 3)
+    if proto == 'http:':
+        port = 80
+    elif proto == 'https:':
+        port = 443
+    else:
+        raise ValueError('unsupported protocol: ' + proto)
+    if ':' in host:
+        host, port = host.split(':', 1)
+        port = int(port)
+    addr = usocket.getaddrinfo(host, port)[0][-1]
+    s = usocket.socket()
+    s.settimeout(TIMEOUT)
+    try:
+        s.connect(addr)
+        if proto == 'https:':
+            import ussl
+            s = ussl.wrap_socket(s, server_hostname=host)
+        s.write('GET /%s HTTP/1.0\r\nHost: %s\r\n' % (path, host))
+        if offset:
+            s.write('Range: bytes=%d-\r\n' % offset)
+        s.write('\r\n')
+        status = int(s.readline().split(None, 2)[1])
+        length = -1
+        while True:
+            l = s.readline()
+            if not l or l == b'\r\n':
+                break
+            if l[:15].lower() == b'content-length:':
+                length = int(l[15:])
+        if status == 200:
+            # no range support, start again from the beginning
+            offset = 0
+        elif status != 206:
+            raise OSError('HTTP status %d' % status)
+    except:
+        s.close()
+        raise
+    return s, offset, length
+
+
+def update(url, sha256=None, *, compressed=None, callback=None, retries=5, partition=None, restart=False):
+    """Write the image at url to the next OTA partition.
+
+    sha256 is the expected digest of the whole (uncompressed) image.
+    compressed defaults to True for urls ending in '.gz' or '.z'.
+    callback(done, total) is called after each chunk with the bytes
+    downloaded so far; total is 0 if the server does not say.
+    Returns the digest of the image written.
+    """
+    if compressed is None:
+        compressed = url.endswith('.gz') or url.endswith('.z')
+    buf = bytearray(CHUNK)
+    mv = memoryview(buf)
+    offset = 0
+    size = 0
+    while True:
+        s = None
+        try:
+            s, offset, length = _open(url, offset)
+            if length >= 0:
+                size = offset + length
+            if compressed:
+                ota.begin(partition, sha256=sha256, compressed=True)
+            else:
+                ota.begin(partition, size=size, sha256=sha256, offset=offset)
+            done = offset
+            while True:
+                n = s.readinto(buf)
+                if not n:
+                    break
+                ota.write(mv[:n])
+                done += n
+                if callback:
+                    callback(done, size)
+            break
+        except OSError:
+            retries -= 1
+            if retries < 0:
+                ota.abort()
+                raise
+            # resume from the last sector that is fully in flash
+            ota.abort()
+            if not compressed:
+                offset = ota.progress()[0] & ~(SECTOR - 1)
+        finally:
+            if s:
+                s.close()
+    digest = ota.end()
+    if restart:
+        import machine
+        machine.reset()
+    return digest
+
+
+def update_bundle(url, sha256=None, *, callback=None, retries=5):
+    """Write the module bundle at url (see makebundle.py) to the 'bundle'
+    partition and mount it again at /bundle.
+
+    Modules already imported from the old bundle stay loaded until the
+    next soft reset.
+    """
+    import uos
+    import esp32
+    try:
+        uos.umount('/bundle')
+    except OSError:
+        pass
+    try:
+        digest = update(url, sha256, compressed=False, callback=callback,
+            retries=retries, partition='bundle')
+    finally:
+        try:
+            uos.mount(esp32.Bundle(), '/bundle')
+        except OSError:
+            pass
+    return digest
@@ -28,6 +28,7 @@ https://github.com/loboris/MicroPython_ESP32_psRAM_LoBo/blob/master/MicroPython_
 import utime
 from machine import I2C, Pin
 from micropython import const
+from studuinobit import magcal as _magcal
 from .icm_register_rw import ICMRegisterRW
 
 __version__ = "0.2.0"
@@ -104,6 +105,14 @@ class AK09916(ICMRegisterRW):
         xyz = [x, y, z]
 
         self.register_char(_ST2)    # Enable updating readings again
+        return self.magnetic_from_raw(xyz)
+
+    def magnetic_from_raw(self, raw):
+        """
+        X, Y, Z axis micro-Tesla (uT) as floats from raw readings, such as
+        the ones taken by the studuinobit.imu sampler.
+        """
+        xyz = [raw[0], raw[1], raw[2]]
 
         # Apply factory axial sensitivy adjustements
         # xyz[0] *= self._adjustement[0]
@@ -131,6 +140,20 @@ class AK09916(ICMRegisterRW):
 
         return tuple(xyz)
 
+    def magnetic_raw_into(self, out):
+        """Raw X, Y, Z readings into out[0:3], see magnetic_so."""
+        self.register_three_shorts_into(_HXL, out, endian='l')
+        self.register_char(_ST2)    # Enable updating readings again
+
+    @property
+    def magnetic_so(self):
+        """micro-Tesla per digit of the raw readings."""
+        return self._so
+
+    def measure_mode(self, mode):
+        """Set the measurement mode, eg MODE_CONTINOUS_MEASURE_2."""
+        self.register_char(_CNTL2, mode)
+
     # @property
     # def adjustement(self):
     #     return self._adjustement
@@ -141,45 +164,20 @@ class AK09916(ICMRegisterRW):
         return self.register_char(_WIA)
 
     def calibrate(self, count=256, delay=200):
-        self._offset = (0, 0, 0)
-        self._scale = (1, 1, 1)
-
-        reading = self.magnetic
-        minx = maxx = reading[0]
-        miny = maxy = reading[1]
-        minz = maxz = reading[2]
+        # Hard and soft iron correction are fitted by studuinobit.magcal as
+        # the raw readings come in, so no samples are kept here
+        raw = [0, 0, 0]
+        _magcal.reset()
+        self.magnetic_raw_into(raw)
+        _magcal.add(raw)
 
         while count:
             utime.sleep_ms(delay)
-            reading = self.magnetic
-            minx = min(minx, reading[0])
-            maxx = max(maxx, reading[0])
-            miny = min(miny, reading[1])
-            maxy = max(maxy, reading[1])
-            minz = min(minz, reading[2])
-            maxz = max(maxz, reading[2])
+            self.magnetic_raw_into(raw)
+            _magcal.add(raw)
             count -= 1
 
-        # Hard iron correction
-        offset_x = (maxx + minx) / 2
-        offset_y = (maxy + miny) / 2
-        offset_z = (maxz + minz) / 2
-
-        self._offset = (offset_x, offset_y, offset_z)
-
-        # Soft iron correction
-        avg_delta_x = (maxx - minx) / 2
-        avg_delta_y = (maxy - miny) / 2
-        avg_delta_z = (maxz - minz) / 2
-
-        avg_delta = (avg_delta_x + avg_delta_y + avg_delta_z) / 3
-
-        scale_x = avg_delta / avg_delta_x
-        scale_y = avg_delta / avg_delta_y
-        scale_z = avg_delta / avg_delta_z
-
-        self._scale = (scale_x, scale_y, scale_z)
-
+        self._offset, self._scale = _magcal.fit(self._so)
         return self._offset, self._scale
 
     def __enter__(self):
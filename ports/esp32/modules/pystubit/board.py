@@ -1,15 +1,9 @@
-from .inst import button_a, button_b, \
-                  Image, \
-                  display, \
-                  p0, p1, p2, p3, p4, p5, p6, p7, p8, p9, \
-                  p10, p11, p12, p13, p14, p15, p16, p19, p20, \
-                  pin0, pin1, pin2, pin3, \
-                  i2c, \
-                  lightsensor, \
-                  temperature, \
-                  accelerometer, \
-                  gyro, \
-                  compass, \
-                  uart, \
-                  buzzer, \
-                  CreateWLAN
+from . import inst as _inst
+from .inst import __all__
+
+
+# Re-export the instances in inst without creating them until they are used.
+def __getattr__(name):
+    value = getattr(_inst, name)
+    globals()[name] = value
+    return value
@@ -34,7 +34,8 @@ __i2c = None
 def get_i2c_object():
     global __i2c
     if __i2c is None:
-        __i2c = I2C(scl=Pin(22), sda=Pin(21))
+        # hardware controller 0, shared with the studuinobit.imu sampler
+        __i2c = I2C(0, scl=Pin(22), sda=Pin(21), freq=400000)
     return __i2c
 
 """ ---------------------------------------------------------------------- """
@@ -54,11 +55,10 @@ class StuduinoBitI2C:
         return self._i2c.scan()
 
     def read(self, addr, n, repeat=False):
-        return self._i2c.readfrom(addr, n)
+        return self._i2c.readfrom(addr, n, not repeat)
 
     def write(self, addr, buf, repeat=False):
-        """Not implemented """
-        pass
+        self._i2c.writeto(addr, buf, not repeat)
 
 """ ---------------------------------------------------------------------- """
 """ SPI bus -------------------------------------------------------------- """
@@ -24,8 +24,7 @@ We used the script below as reference
 https://github.com/casnortheast/microbit_stub/
 ------------------------------------------------------------------------------
 """
-from machine import Pin
-import utime
+from studuinobit import button as _button
 
 # for singleton pattern
 # Implement used global value,
@@ -73,6 +72,17 @@ class StuduinoBitButton:
         """
         return self.__button.get_presses()
 
+    def get_event(self):
+        """Returns the oldest of the queued 'down', 'up', 'click',
+        'double_click' and 'long_press' events, or None.
+        """
+        return self.__button.get_event()
+
+    def get_events(self):
+        """Returns a tuple of all the queued events, oldest first.
+        """
+        return self.__button.get_events()
+
 
 """ ---------------------------------------------------------------------- """
 """ Buttons -------------------------------------------------------------- """
@@ -88,55 +98,36 @@ class __SBButton:
     """
 
     def __init__(self, ab):
-        self._count = 0
-        self._was_pressed = False
+        # Debouncing, press counting and the event queue are done by the
+        # native driver, so presses are not lost while Python is busy
         if ab == 'A':
-            pin = 15
+            self._button = _button.button_a
         elif ab == 'B':
-            pin = 27
+            self._button = _button.button_b
         else:
             raise ValueError("ab must be 'A' or 'B'")
 
-        self._button = Pin(pin, Pin.IN)
-        self._button.irq(handler=self.__button_pushed,
-                         trigger=Pin.IRQ_FALLING)
-
-        self.prev_time = utime.ticks_ms()
-
     def get_value(self):
         return self._button.value()
 
     def is_pressed(self):
         """If the button is pressed down, is_pressed() is True, else False.
         """
-        if self._button.value() == 1:
-            flag = False
-        else:
-            flag = True
-        return flag
+        return self._button.is_pressed()
 
     def was_pressed(self):
         """True if the button was pressed since the last time was_pressed()
         was called, else False.
         """
-        flag = self._was_pressed
-        self._was_pressed = False
-        return flag
+        return self._button.was_pressed()
 
     def get_presses(self):
         """Returns the running total of button presses.
         """
-        count = self._count
-        self._count = 0
-        return count
-
-    def __button_pushed(self, p):
-        cur_time = utime.ticks_ms()
-        if cur_time < self.prev_time + 150:
-            return
+        return self._button.get_presses()
 
-        self.prev_time = cur_time
+    def get_event(self):
+        return self._button.get_event()
 
-        self._was_pressed = True
-        self._count += 1
-        return
+    def get_events(self):
+        return self._button.get_events()
@@ -23,6 +23,9 @@ Kenji Kawase, Artec Co., Ltd.
 ------------------------------------------------------------------------------
 """
 from machine import Pin, PWM
+from array import array
+from studuinobit import melody as _melody
+from studuinobit import audio as _audio
 from .terminal import StuduinoBitTerminal
 import time
 
@@ -52,6 +55,15 @@ class StuduinoBitBuzzer():
     def off(self):
         self.__buzzer.off()
 
+    def play(self, notes, *, wait=True, loop=False):
+        self.__buzzer.play(notes, wait=wait, loop=loop)
+
+    def is_playing(self):
+        return self.__buzzer.is_playing()
+
+    def play_sample(self, source, *, rate=8000, adpcm=False, wait=True, loop=False):
+        self.__buzzer.play_sample(source, rate=rate, adpcm=adpcm, wait=wait, loop=loop)
+
     def release(self):
         self.__buzzer.release()
 
@@ -59,9 +71,8 @@ class StuduinoBitBuzzer():
 class __SBBuzzer():
     def __init__(self):
         self._buzzer = StuduinoBitTerminal('P4')
-        self.tid = self._buzzer.get_pwm_timer()
 
-    def on(self, sound, *, duration=None):
+    def _hz(self, sound):
         if type(sound) is str:
             if sound.isdigit():
                 # MIDI noto number
@@ -74,16 +85,21 @@ class __SBBuzzer():
                 tone = sound
 
             try:
-                self._buzzer.set_analog_hz(__SBBuzzer.TONE_MAP[tone], self.tid)
+                return __SBBuzzer.TONE_MAP[tone]
             except KeyError as e:
                 raise ValueError("Note must be 'C3'-'G9'")
         elif type(sound) is int:
             if sound < 0:
                 raise ValueError("Frequency must be more than 0")
-            self._buzzer.set_analog_hz(sound, self.tid)
+            return sound
         else:
             raise TypeError("sound type must be string or integer")
 
+    def on(self, sound, *, duration=None):
+        _melody.stop()
+        _audio.stop()
+        self._buzzer.set_analog_hz(self._hz(sound))
+
         self._buzzer.write_analog(10)
 
         if duration != None:
@@ -94,11 +110,63 @@ class __SBBuzzer():
             self.off()
 
     def off(self):
+        _melody.stop()
+        _audio.stop()
+        self._buzzer.write_analog(0)
+
+    def play(self, notes, *, wait=True, loop=False):
+        """
+        Play notes, a sequence of (sound, duration) pairs where sound is
+        anything on() accepts, or 0 for a rest, and duration is in
+        milliseconds.  The notes are played by studuinobit.melody from a
+        timer, so with wait=False this returns at once.
+        """
+        seq = array('H', bytes(4 * len(notes)))
+        for i, (sound, duration) in enumerate(notes):
+            hz = 0 if sound == 0 else self._hz(sound)
+            if hz > 0xffff:
+                raise ValueError("Frequency must be less than 65536")
+            if not 0 <= duration <= 0xffff:
+                raise ValueError("duration must be 0-65535 ms.")
+            seq[2 * i] = hz
+            seq[2 * i + 1] = duration
+
+        # the melody retunes the PWM of the pin, so make sure it has one
+        _melody.stop()
+        _audio.stop()
         self._buzzer.write_analog(0)
+        self._buzzer.set_analog_hz(seq[0] if len(seq) and seq[0] else 440)
+        _melody.play(self._buzzer.pwm, seq, duty=10, loop=loop)
+        if wait and not loop:
+            while _melody.playing():
+                time.sleep_ms(10)
+
+    def play_sample(self, source, *, rate=8000, adpcm=False, wait=True, loop=False):
+        """
+        Play recorded sound: source is a bytes-like object or a file opened
+        with 'rb', holding unsigned 8-bit samples or, with adpcm=True,
+        headerless 4-bit IMA ADPCM.  The samples are streamed to the pin by
+        studuinobit.audio from a timer interrupt, so with wait=False this
+        returns at once and a file is read in blocks as it plays.
+        """
+        _melody.stop()
+        _audio.stop()
+        # the samples go out through the sigma-delta modulator, not LEDC
+        self._buzzer.release_pwm()
+        _audio.play(self._buzzer.pin, source, rate=rate,
+                    format=_audio.ADPCM if adpcm else _audio.PCM8, loop=loop)
+        if wait and not loop:
+            while _audio.playing():
+                time.sleep_ms(10)
+            _audio.stop()
+
+    def is_playing(self):
+        return _melody.playing() or _audio.playing()
 
     def release(self):
+        _melody.stop()
+        _audio.stop()
         self._buzzer.write_analog(0)
-        self._buzzer.rel_pwm_timer(self.tid)
         self._buzzer.release_pwm()
 
 
@@ -24,29 +24,77 @@ Kenji Kawase, Artec Co., Ltd.
 """
 
 
+from machine import UART
+
+# UART0 carries the REPL, so the board-level UART is the second controller
+_UART_ID = 2
+
+
+def _gpio(pin):
+    # accepts a terminal such as p0, a machine.Pin or a GPIO number
+    if pin is None or isinstance(pin, int):
+        return pin
+    return getattr(pin, 'pin', pin)
+
+
 class StuduinoBitUART:
+    """Board-level UART on top of machine.UART.
+
+    After init() the stream methods of the machine.UART object are bound
+    to the instance, so read(), readinto() and readline() copy straight
+    from the driver's ring buffer without going through a Python frame.
+    """
     def __init__(self):
-        """Not implemented """
-        pass
+        self._uart = None
 
     def init(self, baudrate=9600, bits=8, parity=None, stop=1, *,
-             tx=None, rx=None):
-        raise NotImplementedError
+             tx=None, rx=None, rxbuf=1024, timeout=0, timeout_char=0):
+        kw = {}
+        if tx is not None:
+            kw['tx'] = _gpio(tx)
+        if rx is not None:
+            kw['rx'] = _gpio(rx)
+        if self._uart is None:
+            self._uart = UART(_UART_ID)
+        # the RX ring is what lets a slow reader keep up at high baud rates
+        self._uart.init(baudrate=baudrate, bits=bits, parity=parity,
+                        stop=stop, rxbuf=rxbuf, timeout=timeout,
+                        timeout_char=timeout_char, **kw)
+        u = self._uart
+        self.any = u.any
+        self.read = u.read
+        self.readline = u.readline
+        self.readinto = u.readinto
+        self.write = u.write
+
+    def _default(self):
+        if self._uart is None:
+            self.init()
 
+    # These are only reached before init(), which shadows them with the
+    # bound methods of the machine.UART object.
     def any(self):
-        raise NotImplementedError
+        self._default()
+        return self.any()
 
-    def read(self, n):
-        raise NotImplementedError
+    def read(self, n=-1):
+        self._default()
+        return self.read(n)
 
     def readall(self):
-        raise NotImplementedError
+        self._default()
+        return self._uart.read()
 
     def readline(self):
-        raise NotImplementedError
+        self._default()
+        return self.readline()
 
-    def readinto(self, buffer):
-        raise NotImplementedError
+    def readinto(self, buffer, nbytes=None):
+        self._default()
+        if nbytes is None:
+            return self.readinto(buffer)
+        return self.readinto(buffer, nbytes)
 
     def write(self, buffer):
-        raise NotImplementedError
+        self._default()
+        return self.write(buffer)
@@ -25,12 +25,9 @@ https://github.com/casnortheast/microbit_stub/
 ------------------------------------------------------------------------------
 """
 from .image import StuduinoBitImage as Image
-from machine import Pin
-from neopixel import NeoPixel
-import time
-import _thread
+from studuinobit import Image as _Image
+from studuinobit import display as _display
 from .const import *
-from .common import _rgb_24bit, _24bit_rgb
 
 
 # for singleton pattern
@@ -92,140 +89,48 @@ class __SBDisplay(BuiltinColor):
     """Display class represents the 5x5 LED display.
 
     There is a single display object that has an image.
+    The framebuffer, colour scaling and LED output live in the native
+    studuinobit.display module; this class only converts images.
     """
-    __PIX_MAXCOLOR_FACTOR = 0xff
 
     def __init__(self):
         """Initialise the display.
         """
         self.__last_image = Image(5, 5)
 
-        self.__powerPin = Pin(2, Pin.OUT)
-        self.__controlPin = Pin(4, Pin.OUT)
-        self.__np = NeoPixel(self.__controlPin, 25)
-        self.__np.fill((0, 0, 0))
-        self.__powerPin.value(True)
-        self.__on = True
-
-        self.__bgthid = -1
-
-        self.a = 0
-        self.b = 31
+        _display.init()
+        _display.clear()
 
     # 明るさの上限を決めるための社内用API
     def set_rgb_max_factor(self, max_factor):
-	if (max_factor > __SBDisplay.__PIX_MAXCOLOR_FACTOR):
-            raise ValueError('color out of bounds')
-        max_factor = max_factor if max_factor > 31 else 31
-
-        self.a = (max_factor - 31) / ( 255 - 31)
-        self.b = 31 - self.a * 31
-
-    def __board_factor(self, uf):
-        return int(uf if uf < 32 else self.a * uf + self.b)
-
-    def __user_factor(self, bf):
-        if (self.a == 0):
-            return bf
-
-        return int(bf if bf < 32 else (bf - self.b) / self.a)
-
-    def __print(self, image, color):
-        """Output to the display.
-        """
-        for x in range(image.width()):
-            for y in range(image.height()):
-                val = image.get_pixel_color(x, y)
-                val = tuple(map(self.__board_factor, val))
-                if (val != (0, 0, 0)) and (color is not None):
-                    val = list(map(self.__board_factor, color))
-                pos = abs(x-4) * 5 + y
-                self.__np[pos] = val
-        self.__np.write()
+        _display.set_rgb_max_factor(max_factor)
 
     def get_pixel(self, x, y):
-        """Gets the brightness of LED pixel (x,y).
-
-        Brightness can be from 0 (LED is off) to 9 (maximum LED brightness).
+        """Gets the colour of LED pixel (x,y) as an (R,G,B) tuple.
         """
-        if y < 0 or x < 0 or y > 4 or x > 4:
-            raise ValueError('index out of bounds')
-
-        pos = abs(x-4) * 5 + y
-        val = self.__np[pos]
-        val = list(map(self.__user_factor, val))
-        return val
+        return _display.get_pixel(x, y)
 
     def set_pixel(self, x, y, color):
         # Set the dsplay at LED pixel (x,y) to color.
-        # Check argument (Type check).
-        if (type(color) is tuple) or (type(color) is list):
-            rgb = color
-        elif (type(color) is int):
-            rgb = _24bit_rgb(color)
-        else:
-            raise TypeError('color takes a (R,G,B) or [R,G,B] or #RGB')
-
-        # Check argument (X-Y range check).
-        if y < 0 or x < 0 or y > 4 or x > 4:
-            raise ValueError('index out of bounds')
-
-        # Check argument (Color min max check).
-        if ((type(color) is int) and (color > 0xffffff)):
-            raise ValueError('color factor must be 0-0xffffff')
-        
-        if (rgb[0] < 0 or rgb[0] > __SBDisplay.__PIX_MAXCOLOR_FACTOR or
-            rgb[1] < 0 or rgb[1] > __SBDisplay.__PIX_MAXCOLOR_FACTOR or
-            rgb[2] < 0 or rgb[2] > __SBDisplay.__PIX_MAXCOLOR_FACTOR):
-            raise ValueError('color factor must be 0-{0}'.
-                             format(__SBDisplay.__PIX_MAXCOLOR_FACTOR))
-
-        # ceiling process
-        rgb = list(map(self.__board_factor, rgb))
-
-        pos = abs(x-4) * 5 + y
-        self.__np[pos] = rgb
-        self.__np.write()
-        time.sleep_ms(1)
+        _display.set_pixel(x, y, color)
 
     def clear(self):
-        """Clear the display.
+        """Clear the display, cancelling any animation in progress.
         """
-        if self.__bgthid != -1:
-            self.__bgthid = -1
-
+        _display.stop()
         self.__last_image = Image(5, 5)
-        self.__np.fill((0, 0, 0))
-        self.__np.write()
+        _display.clear()
 
     def show(self, iterable, delay=400, *,
              wait=True, loop=False, clear=False, color=None):
-        if wait:
-            if loop:
-                self.__show_loop(iterable, delay=delay,
-                                 clear=clear, color=color)
-            else:
-                self.__one_show(iterable, delay=delay,
-                                clear=clear, color=color)
-        else:
-            if loop:
-                _thread.start_new_thread(self.__show_loop, (iterable, delay),
-                                         {'clear': clear, 'color': color})
-            else:
-                _thread.start_new_thread(self.__one_show, (iterable, delay),
-                                         {'clear': clear, 'color': color})
-
-    def __show_loop(self, iterable, delay, *, clear=False, color=None):
-        while True:
-            self.__one_show(iterable, delay=delay, clear=clear, color=color)
-
-    def __one_show(self, iterable, delay, *, clear=False, color=None):
         """Show images or a string on the display.
 
         Shows the images an image at a time or a string a character at a time,
         with delay milliseconds between image/character.
-        If loop is True, loop forever.
+        If loop is True, loop until another show() or scroll() is queued.
         If clear is True, clear the screen after showing.
+        If wait is False the animation is queued on the display and this
+        returns immediately.
         Usage:
         shows an image:
         display.show(image, delay=0, wait=True, loop=False, clear=False)
@@ -238,107 +143,38 @@ class __SBDisplay(BuiltinColor):
         if not iterable:
             return
 
-        val = color
-        if (type(color) is tuple) or (type(color) is list):
-            val = color
-        elif (type(color) is int):
-            val = _24bit_rgb(color)
-        elif color is not None:
-            raise TypeError('color takes a (R,G,B) or [R,G,B] or #RGB')
-
         if isinstance(iterable, str):
             iterable = [Image(Image.CHARACTER_MAP.
                         get(c, Image.CHARACTER_MAP.get('?')))
                         for c in iterable]
-
-        if isinstance(iterable, Image):
+        elif isinstance(iterable, _Image):
             iterable = [iterable]
+        elif not isinstance(iterable, (list, tuple)):
+            iterable = list(iterable)
 
-        for img in iterable:
-            # if img != self.__last_image:
-            self.__print(img, val)
-            self.__last_image = img
-            time.sleep_ms(delay)
+        self.__last_image = iterable[-1]
 
-        if clear:
-            self.clear()
+        _display.animate(iterable, delay, loop=loop, clear=clear,
+                         color=color, wait=wait)
 
     def scroll(self, string, delay=150, *,
                wait=True, loop=False, monospace=False, color=None):
-        if wait:
-            if loop:
-                self.__scroll_loop(string, delay=delay,
-                                   monospace=monospace, color=color)
-            else:
-                self.__one_scroll(string, delay=delay,
-                                  monospace=monospace, color=color)
-        else:
-            if loop:
-                _thread.start_new_thread(self.__scroll_loop, (string, delay),
-                                         {'monospace': monospace,
-                                         'color': color})
-            else:
-                _thread.start_new_thread(self.__one_scroll, (string, delay),
-                                         {'monospace': monospace,
-                                         'color': color})
-
-    def __scroll_loop(self, string, delay, *, monospace, color):
-        while True:
-            self.__one_scroll(string, delay=delay,
-                              monospace=monospace, color=color)
-
-    def __one_scroll(self, string, delay, *, monospace, color):
         """Scroll the string across the display with given delay.
 
-        In this emulation this is the same as showing the string and clearing
-        the screen.
+        The text is scrolled a column at a time from the built-in font and
+        the display is cleared afterwards.
         """
-        # _thread.allowsuspend(True)
-
         if not isinstance(string, str):
             raise TypeError('can\'t convert ', type(string),
                             'to str implicitly')
 
-        val = color
-        if (type(color) is tuple) or (type(color) is list):
-            val = color
-        elif (type(color) is int):
-            val = _24bit_rgb(color)
-        elif color is not None:
-            raise TypeError('color takes a (R,G,B) or [R,G,B] or #RGB')
-
-        disp_string = ' ' + string + ' '
-        for i in range(len(disp_string)-1):
-            curr = Image(Image.CHARACTER_MAP.get(disp_string[i],
-                         Image(Image.CHARACTER_MAP.get('?'))))
-            next = Image(Image.CHARACTER_MAP.get(disp_string[i+1],
-                         Image(Image.CHARACTER_MAP.get('?'))))
-            for i in range(5):
-                time.sleep_ms(delay)
-                bc = curr.__get_base_color()
-                img = curr.shift_left(i) + next.shift_right(5-i)
-                img.set_base_color(bc)
-
-                self.__print(img, val)
-                time.sleep_ms(delay)
-
-        self.clear()
+        _display.scroll(string, delay, color, loop=loop, wait=wait)
 
     def on(self):
-        if self.__on:
-            return
-        self.__on = True
-        self.__powerPin.value(self.__on)
-        self.show(self.__last_image)
+        _display.on()
 
     def off(self):
-        for x in range(5):
-            for y in range(5):
-                val = self.get_pixel(x, y)
-                self.__last_image.set_pixel_color(x, y, val)
-
-        self.__on = False
-        self.__powerPin.value(self.__on)
+        _display.off()
 
     def is_on(self):
-        return self.__on
+        return _display.is_on()
@@ -26,7 +26,10 @@ https://github.com/loboris/MicroPython_ESP32_psRAM_LoBo/blob/master/MicroPython_
 ------------------------------------------------------------------------------
 """
 from micropython import const
+from array import array
+from studuinobit import imu as _imu
 from .ak09916 import AK09916
+from .ak09916 import MODE_CONTINOUS_MEASURE_1, MODE_CONTINOUS_MEASURE_2
 from .icm_register_rw import ICMRegisterRW
 
 __version__ = "0.2.0"
@@ -48,6 +51,24 @@ _GYRO_YOUT_H = const(0x35)
 _GYRO_YOUT_L = const(0x36)
 _GYRO_ZOUT_H = const(0x37)
 _GYRO_ZOUT_L = const(0x38)
+_USER_CTRL = const(0x03)
+_FIFO_EN_2 = const(0x67)
+_FIFO_RST = const(0x68)
+_FIFO_MODE = const(0x69)
+_FIFO_COUNTH = const(0x70)
+_FIFO_R_W = const(0x72)
+
+# bank 2
+_GYRO_SMPLRT_DIV = const(0x00)
+_ACCEL_SMPLRT_DIV_1 = const(0x10)
+_ACCEL_SMPLRT_DIV_2 = const(0x11)
+
+_USER_CTRL_FIFO_EN = const(0b01000000)
+_FIFO_EN_ACCEL = const(0b00010000)
+_FIFO_EN_GYRO = const(0b00001110)
+_FIFO_MODE_SNAPSHOT = const(0b00000001)
+_ACCEL_FCHOICE = const(0b00000001)
+_FIFO_SIZE = const(512)
 
 # _ACCEL_FS_MASK = const(0b00011000)
 ACCEL_FS_SEL_2G = const(0b00000000)
@@ -104,11 +125,21 @@ class ICM20948(ICMRegisterRW):
 
         self._ak09916 = AK09916(i2c)
 
+        # FIFO state, _fifo_frame is 0 while the FIFO is disabled
+        self._fifo_frame = 0
+        self._fifo_buf = bytearray(2)
+        self.fifo_overflows = 0
+
+        # Background sampler state, see start_sampler()
+        self._sampler_period = 0
+        self._latest = array('h', bytes(18))
+
         self._accel_so = self._accel_fs(ACCEL_FS_SEL_2G)
         self._gyro_so = self._gyro_fs(GYRO_FS_SEL_250DPS)
         self._accel_sf = SF_M_S2
         self._gyro_sf = SF_DEG_S
 
+
         # Enable I2C bypass to access for ICM20948 magnetometer access.
         char = self.register_char(_INT_PIN_CFG)
         char &= ~_I2C_BYPASS_MASK   # clear I2C bits
@@ -157,7 +188,7 @@ class ICM20948(ICMRegisterRW):
             raise ValueError("must be 'dps'/'rps'")
 
     def _gyro_dlpf(self, dlpfcfg=-1):
-
+        period = self._pause_sampler()
         self.register_char(0x7f, 0x20)
         # get ICM20948 gyro configuration.
         char = self.register_char(_GYRO_CONFIG)
@@ -187,6 +218,7 @@ class ICM20948(ICMRegisterRW):
 
         self.register_char(_GYRO_CONFIG, char)
         self.register_char(0x7f, 0x00)
+        self._resume_sampler(period)
 
     @property
     def acceleration(self):
@@ -197,7 +229,10 @@ class ICM20948(ICMRegisterRW):
         so = self._accel_so
         sf = self._accel_sf
 
-        xyz = self.register_three_shorts(_ACCEL_XOUT_H)
+        if _imu.running():
+            xyz = self._sampler_latest()[0:3]
+        else:
+            xyz = self.register_three_shorts(_ACCEL_XOUT_H)
         return tuple([value / so * sf for value in xyz])
 
     @property
@@ -208,25 +243,192 @@ class ICM20948(ICMRegisterRW):
         so = self._gyro_so
         sf = self._gyro_sf
 
-        xyz = self.register_three_shorts(_GYRO_XOUT_H)
+        if _imu.running():
+            xyz = self._sampler_latest()[3:6]
+        else:
+            xyz = self.register_three_shorts(_GYRO_XOUT_H)
         return tuple([value / so * sf for value in xyz])
 
+    def acceleration_raw_into(self, out):
+        """Raw X, Y, Z accelerometer readings into out[0:3]."""
+        if _imu.running():
+            self._sampler_into(out, 0)
+        else:
+            self.register_three_shorts_into(_ACCEL_XOUT_H, out)
+
+    def gyro_raw_into(self, out):
+        """Raw X, Y, Z gyro readings into out[0:3]."""
+        if _imu.running():
+            self._sampler_into(out, 3)
+        else:
+            self.register_three_shorts_into(_GYRO_XOUT_H, out)
+
     @property
     def magnetic(self):
         """
         X, Y, Z axis micro-Tesla (uT) as floats.
         """
+        if _imu.running():
+            return self._ak09916.magnetic_from_raw(self._sampler_latest()[6:9])
         return self._ak09916.magnetic
 
+    def magnetic_raw_into(self, out):
+        """Raw X, Y, Z magnetometer readings into out[0:3]."""
+        if _imu.running():
+            self._sampler_into(out, 6)
+        else:
+            self._ak09916.magnetic_raw_into(out)
+
+    @property
+    def magnetic_so(self):
+        """micro-Tesla per digit of the raw magnetometer readings."""
+        return self._ak09916.magnetic_so
+
+    def magnetic_fast(self, fast):
+        """Run the magnetometer at 100Hz rather than the default 10Hz."""
+        period = self._pause_sampler()
+        self._ak09916.measure_mode(MODE_CONTINOUS_MEASURE_2 if fast else
+                                   MODE_CONTINOUS_MEASURE_1)
+        self._resume_sampler(period)
+
+    def fifo_enable(self, rate_div=0, accel=True, gyro=True):
+        """
+        Start sampling into the hardware FIFO at 1125 / (1 + rate_div) Hz.
+        Each frame holds the raw X, Y, Z accelerometer values followed by
+        the raw X, Y, Z gyro values, for whichever of the two are enabled.
+        Use fifo_read() to drain it.
+        """
+        if not accel and not gyro:
+            raise ValueError("accel or gyro must be enabled")
+        if _imu.running():
+            raise RuntimeError("sensor bus in use by the sampler")
+        if not 0 <= rate_div <= 255:
+            raise ValueError("rate_div must be 0-255")
+        self.fifo_disable()
+
+        # Both sensors run through their low pass filter so they sample at
+        # the same rate and frames stay aligned in the FIFO.
+        self._fifo_frame = 6 * (bool(accel) + bool(gyro))
+        self._accel_fs(self._accel_fs_sel)
+        self.register_char(0x7f, 0x20)
+        self.register_char(_GYRO_SMPLRT_DIV, rate_div)
+        self.register_char(_ACCEL_SMPLRT_DIV_1, 0)
+        self.register_char(_ACCEL_SMPLRT_DIV_2, rate_div)
+        self.register_char(0x7f, 0x00)
+
+        self.register_char(_FIFO_MODE, _FIFO_MODE_SNAPSHOT)
+        self._fifo_reset()
+        self.register_char(_FIFO_EN_2, (_FIFO_EN_ACCEL if accel else 0) |
+                           (_FIFO_EN_GYRO if gyro else 0))
+        char = self.register_char(_USER_CTRL)
+        self.register_char(_USER_CTRL, char | _USER_CTRL_FIFO_EN)
+
+    def fifo_disable(self):
+        """Stop sampling into the FIFO and discard its contents."""
+        self.register_char(_FIFO_EN_2, 0)
+        char = self.register_char(_USER_CTRL)
+        self.register_char(_USER_CTRL, char & ~_USER_CTRL_FIFO_EN)
+        self._fifo_reset()
+        if self._fifo_frame:
+            self._fifo_frame = 0
+            self._accel_fs(self._accel_fs_sel)
+
+    def _fifo_reset(self):
+        self.register_char(_FIFO_RST, 0x1f)
+        self.register_char(_FIFO_RST, 0x00)
+
+    def fifo_count(self):
+        """Number of complete frames waiting in the FIFO."""
+        if not self._fifo_frame:
+            return 0
+        buf = self._fifo_buf
+        self._i2c.readfrom_mem_into(self._address, _FIFO_COUNTH, buf)
+        return ((buf[0] & 0x1f) << 8 | buf[1]) // self._fifo_frame
+
+    def fifo_read(self, buf):
+        """
+        Move as many frames as fit from the FIFO into buf, an array('h'),
+        in a single I2C burst and return the number of frames read.
+        Nothing is allocated when buf is exactly filled.
+
+        If the FIFO filled up since the last call, sampling stopped on a
+        partial frame: the frames read are returned, the rest of the FIFO
+        is discarded and fifo_overflows is incremented.
+        """
+        frame = self._fifo_frame
+        if not frame:
+            raise RuntimeError("FIFO is not enabled")
+        buf_count = self._fifo_buf
+        self._i2c.readfrom_mem_into(self._address, _FIFO_COUNTH, buf_count)
+        nbytes = (buf_count[0] & 0x1f) << 8 | buf_count[1]
+        n = min(nbytes // frame, len(buf) * 2 // frame)
+        nvalues = n * frame // 2
+        if n:
+            if nvalues == len(buf):
+                self._i2c.readfrom_mem_into(self._address, _FIFO_R_W, buf)
+            else:
+                self._i2c.readfrom_mem_into(self._address, _FIFO_R_W,
+                                            memoryview(buf)[:nvalues])
+            # the sensor is big endian
+            for i in range(nvalues):
+                v = buf[i]
+                buf[i] = (v & 0xff) << 8 | (v >> 8) & 0xff
+        if nbytes >= _FIFO_SIZE:
+            self._fifo_reset()
+            self.fifo_overflows += 1
+        return n
+
+    def start_sampler(self, period_us=20000):
+        """
+        Run the studuinobit.imu background sampler, which also drives the
+        gesture recogniser.  While it runs it owns the sensor bus: readings
+        come from its latest frame and configuration changes stop it for
+        the duration of the register writes.
+        """
+        if self._fifo_frame:
+            raise RuntimeError("sensor bus in use by the FIFO")
+        _imu.start(period_us, 1)
+        self._sampler_period = period_us
+
+    def stop_sampler(self):
+        self._sampler_period = 0
+        _imu.stop()
+
+    def _pause_sampler(self):
+        if not _imu.running():
+            return 0
+        _imu.stop()
+        return self._sampler_period or 20000
+
+    def _resume_sampler(self, period):
+        if period:
+            self.start_sampler(period)
+
+    def _sampler_latest(self):
+        latest = self._latest
+        _imu.latest_into(latest)
+        return latest
+
+    def _sampler_into(self, out, first):
+        latest = self._sampler_latest()
+        for i in range(3):
+            out[i] = latest[first + i]
+
     @property
     def whoami(self):
         """ Value of the whoami register. """
         return self.register_char(_WHO_AM_I)
 
     def _accel_fs(self, value):
+        self._accel_fs_sel = value
+        period = self._pause_sampler()
         self.register_char(0x7f, 0x20)
-        self.register_char(_ACCEL_CONFIG, value)
+        if self._fifo_frame:
+            self.register_char(_ACCEL_CONFIG, value | _ACCEL_FCHOICE)
+        else:
+            self.register_char(_ACCEL_CONFIG, value)
         self.register_char(0x7f, 0x00)
+        self._resume_sampler(period)
 
         # Return the sensitivity divider
         if ACCEL_FS_SEL_2G == value:
@@ -239,10 +441,11 @@ class ICM20948(ICMRegisterRW):
             return _ACCEL_SO_16G
 
     def _gyro_fs(self, value):
-
+        period = self._pause_sampler()
         self.register_char(0x7f, 0x20)
         self.register_char(_GYRO_CONFIG, value)
         self.register_char(0x7f, 0x00)
+        self._resume_sampler(period)
 
         # Return the sensitivity divider
         if GYRO_FS_SEL_250DPS == value:
@@ -54,6 +54,17 @@ class ICMRegisterRW:
         self._i2c.readfrom_mem_into(self._address, register, buf)
         return ustruct.unpack(fmt, buf)
 
+    def register_three_shorts_into(self, register, out, buf=bytearray(6),
+                                   endian='b'):
+        """Read three shorts into out[0:3] without allocating."""
+        self._i2c.readfrom_mem_into(self._address, register, buf)
+        hi = 0 if endian is 'b' else 1
+        for i in range(3):
+            v = buf[2 * i + hi] << 8 | buf[2 * i + 1 - hi]
+            if v & 0x8000:
+                v -= 0x10000
+            out[i] = v
+
     def register_char(self, register, value=None, buf=bytearray(1)):
         if value is None:
             self._i2c.readfrom_mem_into(self._address, register, buf)
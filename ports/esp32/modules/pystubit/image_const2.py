@@ -1,96 +0,0 @@
-"""
-------------------------------------------------------------------------------
-The MIT License (MIT)
-Copyright (c) 2016 Newcastle University
-Permission is hereby granted, free of charge, to any person obtaining a copy
-of this software and associated documentation files (the "Software"), to deal
-in the Software without restriction, including without limitation the rights
-to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
-copies of the Software, and to permit persons to whom the Software is
-furnished to do so, subject to the following conditions:
-The above copyright notice and this permission notice shall be included in all
-copies or substantial portions of the Software.
-THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
-IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
-FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
-AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
-LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
-OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
-SOFTWARE.import time
-------------------------------------------------------------------------------
-Author
-Kenji Kawase, Artec Co., Ltd.
-We used the script below as reference
-https://github.com/casnortheast/microbit_stub/
-------------------------------------------------------------------------------
-"""
-from .image import StuduinoBitImage
-from .image_const1 import *
-
-StuduinoBitImage.ANGRY = ANGRY
-StuduinoBitImage.BUTTERFLY = BUTTERFLY
-StuduinoBitImage.CHESSBOARD = CHESSBOARD
-StuduinoBitImage.CONFUSED = CONFUSED
-StuduinoBitImage.COW = COW
-StuduinoBitImage.DIAMOND = DIAMOND
-StuduinoBitImage.DIAMOND_SMALL = DIAMOND_SMALL
-StuduinoBitImage.DUCK = DUCK
-StuduinoBitImage.FABULOUS = FABULOUS
-StuduinoBitImage.GHOST = GHOST
-StuduinoBitImage.GIRAFFE = GIRAFFE
-StuduinoBitImage.HAPPY = HAPPY
-StuduinoBitImage.HEART = HEART
-StuduinoBitImage.HEART_SMALL = HEART_SMALL
-StuduinoBitImage.HOUSE = HOUSE
-StuduinoBitImage.MEH = MEH
-StuduinoBitImage.MUSIC_CROTCHET = MUSIC_CROTCHET
-StuduinoBitImage.MUSIC_QUAVER = MUSIC_QUAVER
-StuduinoBitImage.MUSIC_QUAVERS = MUSIC_QUAVERS
-StuduinoBitImage.NO = NO
-StuduinoBitImage.PACMAN = PACMAN
-StuduinoBitImage.PITCHFORK = PITCHFORK
-StuduinoBitImage.RABBIT = RABBIT
-StuduinoBitImage.ROLLERSKATE = ROLLERSKATE
-StuduinoBitImage.SAD = SAD
-StuduinoBitImage.SILLY = SILLY
-StuduinoBitImage.SKULL = SKULL
-StuduinoBitImage.SMILE = SMILE
-StuduinoBitImage.SNAKE = SNAKE
-StuduinoBitImage.SQUARE = SQUARE
-StuduinoBitImage.SQUARE_SMALL = SQUARE_SMALL
-StuduinoBitImage.STICKFIGURE = STICKFIGURE
-StuduinoBitImage.SURPRISED = SURPRISED
-StuduinoBitImage.SWORD = SWORD
-StuduinoBitImage.TARGET = TARGET
-StuduinoBitImage.TORTOISE = TORTOISE
-StuduinoBitImage.TRIANGLE = TRIANGLE
-StuduinoBitImage.TRIANGLE_LEFT = TRIANGLE_LEFT
-StuduinoBitImage.TSHIRT = TSHIRT
-StuduinoBitImage.UMBRELLA = UMBRELLA
-StuduinoBitImage.XMAS = XMAS
-StuduinoBitImage.YES = YES
-
-StuduinoBitImage.ARROW_N = ARROW_N
-StuduinoBitImage.ARROW_NE = ARROW_NE
-StuduinoBitImage.ARROW_E = ARROW_E
-StuduinoBitImage.ARROW_SE = ARROW_SE
-StuduinoBitImage.ARROW_S = ARROW_S
-StuduinoBitImage.ARROW_SW = ARROW_SW
-StuduinoBitImage.ARROW_W = ARROW_W
-StuduinoBitImage.ARROW_NW = ARROW_NW
-
-StuduinoBitImage.CLOCK12 = CLOCK12
-StuduinoBitImage.CLOCK1 = CLOCK1
-StuduinoBitImage.CLOCK2 = CLOCK2
-StuduinoBitImage.CLOCK3 = CLOCK3
-StuduinoBitImage.CLOCK4 = CLOCK4
-StuduinoBitImage.CLOCK5 = CLOCK5
-StuduinoBitImage.CLOCK6 = CLOCK6
-StuduinoBitImage.CLOCK7 = CLOCK7
-StuduinoBitImage.CLOCK8 = CLOCK8
-StuduinoBitImage.CLOCK9 = CLOCK9
-StuduinoBitImage.CLOCK10 = CLOCK10
-StuduinoBitImage.CLOCK11 = CLOCK11
-
-StuduinoBitImage.ALL_ARROWS = ALL_ARROWS
-StuduinoBitImage.ALL_CLOCKS = ALL_CLOCKS
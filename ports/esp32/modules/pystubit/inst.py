@@ -1,89 +1,112 @@
 """
-Button
-"""
-from .button import StuduinoBitButton
-button_a = StuduinoBitButton('A')
-button_b = StuduinoBitButton('B')
+Board instances
 
+Creating an instance can touch the hardware (eg the ICM20948 and AK09916
+are initialised over I2C), so each one is only made, along with the module
+defining its class, the first time it is accessed.  See __getattr__ below.
 """
-Image
-"""
-from .image import StuduinoBitImage as Image
 
-"""
-Display
-"""
-from .dsply import StuduinoBitDisplay
-display = StuduinoBitDisplay()
 
-"""
-Terminal
-"""
-from .terminal import StuduinoBitTerminal, StuduinoBitTerminalForMB
-p0 = StuduinoBitTerminal('P0')
-p1 = StuduinoBitTerminal('P1')
-p2 = StuduinoBitTerminal('P2')
-p3 = StuduinoBitTerminal('P3')
-p4 = StuduinoBitTerminal('P4')
-p5 = StuduinoBitTerminal('P5')
-p6 = StuduinoBitTerminal('P6')
-p7 = StuduinoBitTerminal('P7')
-p8 = StuduinoBitTerminal('P8')
-p9 = StuduinoBitTerminal('P9')
-p10 = StuduinoBitTerminal('P10')
-p11 = StuduinoBitTerminal('P11')
-p12 = StuduinoBitTerminal('P12')
-p13 = StuduinoBitTerminal('P13')
-p14 = StuduinoBitTerminal('P14')
-p15 = StuduinoBitTerminal('P15')
-p16 = StuduinoBitTerminal('P16')
-p19 = StuduinoBitTerminal('P19')
-p20 = StuduinoBitTerminal('P20')
-
-pin0 = StuduinoBitTerminalForMB('P0')
-pin1 = StuduinoBitTerminalForMB('P1')
-pin2 = StuduinoBitTerminalForMB('P2')
-pin3 = StuduinoBitTerminalForMB('P3')
+def _button(name):
+    from .button import StuduinoBitButton
+    return StuduinoBitButton(name)
 
-"""
-Bus
-"""
-from .bus import StuduinoBitI2C, StuduinoBitSPI
-i2c = StuduinoBitI2C()
-spi = StuduinoBitSPI()
 
+def _image(_):
+    from .image import StuduinoBitImage
+    return StuduinoBitImage
 
-"""
-Sensor
-"""
-from .sensor import StuduinoBitLightSensor, \
-                    StuduinoBitTemperature, \
-                    StuduinoBitAccelerometer, \
-                    StuduinoBitGyro, \
-                    StuduinoBitCompass
-
-lightsensor = StuduinoBitLightSensor()
-temperature = StuduinoBitTemperature()
-accelerometer = StuduinoBitAccelerometer()
-gyro = StuduinoBitGyro()
-compass = StuduinoBitCompass()
 
-"""
-Circuit
-"""
-from .circuit import StuduinoBitUART
-uart = StuduinoBitUART()
+def _display(_):
+    from .dsply import StuduinoBitDisplay
+    return StuduinoBitDisplay()
 
-"""
-Buzzer
-"""
-from .bzr import StuduinoBitBuzzer
-buzzer = StuduinoBitBuzzer()
 
-"""
-Network
-"""
-from .nw import CreateWLAN
+def _terminal(name):
+    from .terminal import StuduinoBitTerminal
+    return StuduinoBitTerminal(name)
+
+
+def _terminal_mb(name):
+    from .terminal import StuduinoBitTerminalForMB
+    return StuduinoBitTerminalForMB(name)
+
+
+def _bus(name):
+    from . import bus
+    return getattr(bus, name)()
+
+
+def _sensor(name):
+    from . import sensor
+    return getattr(sensor, name)()
+
+
+def _uart(_):
+    from .circuit import StuduinoBitUART
+    return StuduinoBitUART()
+
+
+def _buzzer(_):
+    from .bzr import StuduinoBitBuzzer
+    return StuduinoBitBuzzer()
+
+
+def _wlan(_):
+    from .nw import CreateWLAN
+    return CreateWLAN
+
+
+# name: (factory, argument)
+_INSTANCES = {
+    'button_a': (_button, 'A'),
+    'button_b': (_button, 'B'),
+    'Image': (_image, None),
+    'display': (_display, None),
+    'p0': (_terminal, 'P0'),
+    'p1': (_terminal, 'P1'),
+    'p2': (_terminal, 'P2'),
+    'p3': (_terminal, 'P3'),
+    'p4': (_terminal, 'P4'),
+    'p5': (_terminal, 'P5'),
+    'p6': (_terminal, 'P6'),
+    'p7': (_terminal, 'P7'),
+    'p8': (_terminal, 'P8'),
+    'p9': (_terminal, 'P9'),
+    'p10': (_terminal, 'P10'),
+    'p11': (_terminal, 'P11'),
+    'p12': (_terminal, 'P12'),
+    'p13': (_terminal, 'P13'),
+    'p14': (_terminal, 'P14'),
+    'p15': (_terminal, 'P15'),
+    'p16': (_terminal, 'P16'),
+    'p19': (_terminal, 'P19'),
+    'p20': (_terminal, 'P20'),
+    'pin0': (_terminal_mb, 'P0'),
+    'pin1': (_terminal_mb, 'P1'),
+    'pin2': (_terminal_mb, 'P2'),
+    'pin3': (_terminal_mb, 'P3'),
+    'i2c': (_bus, 'StuduinoBitI2C'),
+    'spi': (_bus, 'StuduinoBitSPI'),
+    'lightsensor': (_sensor, 'StuduinoBitLightSensor'),
+    'temperature': (_sensor, 'StuduinoBitTemperature'),
+    'accelerometer': (_sensor, 'StuduinoBitAccelerometer'),
+    'gyro': (_sensor, 'StuduinoBitGyro'),
+    'compass': (_sensor, 'StuduinoBitCompass'),
+    'uart': (_uart, None),
+    'buzzer': (_buzzer, None),
+    'CreateWLAN': (_wlan, None),
+}
 
+__all__ = tuple(_INSTANCES)
 
 
+def __getattr__(name):
+    try:
+        factory, arg = _INSTANCES[name]
+    except KeyError:
+        raise AttributeError(name)
+    value = factory(arg)
+    # later accesses find the instance directly, without calling this again
+    globals()[name] = value
+    return value
@@ -25,6 +25,7 @@ Kenji Kawase, Artec Co., Ltd.
 import machine
 import network
 from esp import espnow
+from studuinobit import radio as _radio
 import io
 import json
 import time
@@ -46,23 +47,12 @@ class StuduinoBitRadio:
     def __nwled_off(self):
         self.nwpin.value(0)
 
-    def __recv_cb(self, dobj):
-        # Group ID do not set yet.
-        if self.__group == -1:
-            return
-        if dobj:
-            data = dobj[1]
-            if data[1] == self.__group:
-                self.queue.append(data)
-
     def __init__(self):
         # Network LED OFF
         self.nwpin = machine.Pin(12, machine.Pin.OUT)
         self.nwpin.value(0)
 
         # Initialize StuduinoBitRadio information
-        self.__group = -1
-        self.queue = []
         self.is_on = False
 
     def on(self):
@@ -82,6 +72,7 @@ class StuduinoBitRadio:
 
     def off(self):
         # Wifi OFF
+        _radio.off()
         self.w.active(False)
 
         start = time.ticks_ms()
@@ -98,99 +89,49 @@ class StuduinoBitRadio:
             raise RuntimeError('Start Wifi before this method')
 
         try:
-            # Intialize ESP-NOW and resiger coallback function.
+            # Intialize ESP-NOW and add the broadcast peer.
             espnow.init()
             espnow.add_peer(StuduinoBitRadio.BROADCAST_MAC_ADDRESS)
-            espnow.on_recv(self.__recv_cb)
         except OSError as e:
             print(e)
 
-        self.__group = group
+        self.group(group)
+        _radio.on()
 
-    def config(self, length=None, queue=None, channel=None, group=None):
-        raise NotImplementedError
+    def config(self, length=None, queue=None, channel=None, group=None,
+               relay=None, ttl=None):
+        _radio.config(length=length, queue=queue, channel=channel, group=group,
+                      relay=relay, ttl=ttl)
 
     def group(self, group=-1):
         if group < 0:
             raise ValueError("group must be 0 - 255")
-        self.__group = group
-        self.queue.clear()
-
-    def __make_dal_header(self):
-        dal_header = [1, self.__group, 1]
-        return bytes(dal_header)
-
-    def __make_pxt_header(self, type):
-        pxt_header = [type, 0, 0, 0, 0]
-        return bytes(pxt_header)
+        _radio.config(group=group)
 
     def send_number(self, n):
         if not self.is_on:
             raise RuntimeError('Start Wifi before this method')
-
-        hdal = self.__make_dal_header()
-        hpxt = self.__make_pxt_header(0)
-        dpxt_n = n.to_bytes(4, 'big')
-        msg = hdal + hpxt + dpxt_n
-        espnow.send(StuduinoBitRadio.BROADCAST_MAC_ADDRESS, msg)
+        _radio.send_number(n)
 
     def send_value(self, s, n):
         if not self.is_on:
             raise RuntimeError('Start Wifi before this method')
-
-        hdal = self.__make_dal_header()
-        hpxt = self.__make_pxt_header(1)
-        dpxt_n = n.to_bytes(4, 'big')
-        dpxt_s = s.encode()
-        msg = hdal + hpxt + dpxt_n + dpxt_s
-        espnow.send(StuduinoBitRadio.BROADCAST_MAC_ADDRESS, msg)
+        _radio.send_value(s, n)
 
     def send_string(self, s):
         if not self.is_on:
             raise RuntimeError('Start Wifi before this method')
-
-        hdal = self.__make_dal_header()
-        hpxt = self.__make_pxt_header(2)
-        dpxt_s = s.encode()
-        msg = hdal + hpxt + dpxt_s
-        espnow.send(StuduinoBitRadio.BROADCAST_MAC_ADDRESS, msg)
+        _radio.send_string(s)
 
     def send_buffer(self, buf):
         if not self.is_on:
             raise RuntimeError('Start Wifi before this method')
-
-        hdal = self.__make_dal_header()
-        hpxt = self.__make_pxt_header(3)
-        dpxt_b = buf
-        msg = hdal + hpxt + dpxt_b
-        espnow.send(StuduinoBitRadio.BROADCAST_MAC_ADDRESS, msg)
+        _radio.send_bytes(buf)
 
     def recv(self):
         if not self.is_on:
             raise RuntimeError('Start Wifi before this method')
-
-        try:
-            data = self.queue.pop(0)
-        except IndexError as e:
-            return None
-
-        if (data[3] == 0x00):   # Number
-            num = data[8:12]
-            num = int.from_bytes(num, 'big')
-            return 0, num
-        if (data[3] == 0x01):   # Value
-            num = data[8:12]
-            name = data[12:32]
-            num = int.from_bytes(num, 'big')
-            name = name.decode()
-            return 1, (name, num)
-        if (data[3] == 0x02):   # String
-            name = data[8:32]
-            name = name.decode()
-            return 2, name
-        if (data[3] == 0x03):   # Buffer
-            buff = data[8:32]
-            return 3, buff
+        return _radio.receive()
 
 
 class StuduinoBitBLE:
@@ -25,11 +25,13 @@ We used the script below as reference
 """
 from micropython import const
 from time import sleep_ms
-from math import atan, sin, cos, pi, log
+from math import tilt_heading
 import io
 import json
+from studuinobit import imu as _imu
+from studuinobit import magcal as _magcal
+from studuinobit import sensors as _sensors
 from .const import *
-from .terminal import StuduinoBitAnalogPin
 
 
 MAGNETIC_OFFSET = 'magnetic_offset'
@@ -52,6 +54,28 @@ def get_icm20948_object():
     return __icm20948
 
 
+# Scale applied by get_values_into(): value = raw * factor - offset
+def _raw_scale(factor, offset=0):
+    k = factor * 1000
+    shift = 0
+    # largest k that keeps raw * k a small int for any 16-bit reading
+    while k and abs(k) * 2 < 32768 and shift < 24:
+        k *= 2
+        shift += 1
+    return (factor, offset, int(k), shift, round(offset * 1000))
+
+
+def _scale_into(buf, raw, scale, fixed):
+    if fixed:
+        for i in range(3):
+            s = scale[i]
+            buf[i] = (raw[i] * s[2] >> s[3]) - s[4]
+    else:
+        for i in range(3):
+            s = scale[i]
+            buf[i] = raw[i] * s[0] - s[1]
+
+
 class StuduinoBitAccelerometer:
     def __init__(self, fs='2g', sf='ms2'):
         # from .icm20948 import ICM20948
@@ -59,6 +83,8 @@ class StuduinoBitAccelerometer:
         self._icm20948.accel_fs(fs)
         self._icm20948.accel_sf(sf)
         self._axis_correct = (1, 1, 1)
+        self._raw = [0, 0, 0]
+        self._values_scale_key = None
 
     def get_x(self, ndigits=2):
         return round(self._icm20948.acceleration[0] *
@@ -80,17 +106,49 @@ class StuduinoBitAccelerometer:
         z = round(value[2] * self._axis_correct[2], ndigits)
         return (x, y, z)
 
+    def get_values_into(self, buf, fixed=False):
+        """
+        Write the X, Y, Z values into buf[0:3], eg an array('f'), without
+        building a tuple.  With fixed=True the values are ints in
+        thousandths of the unit set by set_sf(), computed without floats,
+        so nothing is allocated when buf is an integer array such as
+        array('i').
+        """
+        icm = self._icm20948
+        icm.acceleration_raw_into(self._raw)
+        key = self._values_scale_key
+        if (key is None or key[0] != icm._accel_so or
+                key[1] != icm._accel_sf or key[2] is not self._axis_correct):
+            self._update_values_scale(icm._accel_so, icm._accel_sf)
+        _scale_into(buf, self._raw, self._values_scale, fixed)
+
+    def _update_values_scale(self, so, sf):
+        # kept out of get_values_into() so that the comprehension does not
+        # turn its locals into heap allocated cells
+        axis = self._axis_correct
+        self._values_scale = [_raw_scale(sf / so * a) for a in axis]
+        self._values_scale_key = (so, sf, axis)
+
+    # Gestures are recognised in C by the studuinobit.imu sampler, which is
+    # started the first time one of these is called.  The names and their
+    # axes follow the micro:bit: 'up', 'down', 'left', 'right', 'face up',
+    # 'face down', 'freefall', '3g', '6g', '8g' and 'shake'.
+    def _gestures(self):
+        if not _imu.running():
+            self._icm20948.start_sampler()
+        return _imu
+
     def current_gesture(self):
-        raise NotImplementedError
+        return self._gestures().current_gesture()
 
     def is_gesture(self, name):
-        raise NotImplementedError
+        return self._gestures().is_gesture(name)
 
     def was_gesture(self, name):
-        raise NotImplementedError
+        return self._gestures().was_gesture(name)
 
     def get_gestures(self):
-        raise NotImplementedError
+        return self._gestures().get_gestures()
 
     def set_fs(self, value):
         self._icm20948.accel_fs(value)
@@ -117,6 +175,8 @@ class StuduinoBitGyro:
         self._icm20948.gyro_fs(fs)
         self._icm20948.gyro_sf(sf)
         self._axis_correct = (1, 1, 1)
+        self._raw = [0, 0, 0]
+        self._values_scale_key = None
 
     def get_x(self, ndigits=2):
         return round(self._icm20948.gyro[0] *
@@ -137,6 +197,27 @@ class StuduinoBitGyro:
         z = round(value[2] * self._axis_correct[2], ndigits)
         return (x, y, z)
 
+    def get_values_into(self, buf, fixed=False):
+        """
+        Write the X, Y, Z values into buf[0:3], eg an array('f'), without
+        building a tuple.  With fixed=True the values are ints in
+        thousandths of the unit set by set_sf(), computed without floats,
+        so nothing is allocated when buf is an integer array such as
+        array('i').
+        """
+        icm = self._icm20948
+        icm.gyro_raw_into(self._raw)
+        key = self._values_scale_key
+        if (key is None or key[0] != icm._gyro_so or
+                key[1] != icm._gyro_sf or key[2] is not self._axis_correct):
+            self._update_values_scale(icm._gyro_so, icm._gyro_sf)
+        _scale_into(buf, self._raw, self._values_scale, fixed)
+
+    def _update_values_scale(self, so, sf):
+        axis = self._axis_correct
+        self._values_scale = [_raw_scale(sf / so * a) for a in axis]
+        self._values_scale_key = (so, sf, axis)
+
     def set_fs(self, value):
         self._icm20948.gyro_fs(value)
 
@@ -158,14 +239,16 @@ but {} found".format(type(mode)))
 class StuduinoBitCompass:
     def __init__(self):
         self._icm20948 = get_icm20948_object()
-        self._offset = self._get_configureValue(MAGNETIC_OFFSET)
-        self._scale = self._get_configureValue(MAGNETIC_SCALE)
-        self._calibrated = True
-        if self._offset is None or self._scale is None:
-            self._calibrated = False
+        cal = self._load_calibration()
+        self._calibrated = cal is not None
+        if cal is None:
             self._offset = (0, 0, 0)
             self._scale = (1, 1, 1)
+        else:
+            self._offset, self._scale = cal
         self._axis_correct = (1, 1, 1)
+        self._raw = [0, 0, 0]
+        self._values_scale_key = None
 
     def get_x(self):
         return self.get_values()[0]
@@ -193,6 +276,28 @@ class StuduinoBitCompass:
                 res[i] = (val - self._offset[i]) * self._scale[i]
             return tuple(res)
 
+    def get_values_into(self, buf, fixed=False):
+        """
+        Write the X, Y, Z values into buf[0:3], eg an array('f'), without
+        building a tuple.  With fixed=True the values are ints in
+        thousandths of a micro-Tesla, computed without floats, so nothing
+        is allocated when buf is an integer array such as array('i').
+        """
+        icm = self._icm20948
+        icm.magnetic_raw_into(self._raw)
+        key = self._values_scale_key
+        if (key is None or key[0] is not self._offset or
+                key[1] is not self._scale or key[2] is not self._axis_correct):
+            self._update_values_scale(icm.magnetic_so)
+        _scale_into(buf, self._raw, self._values_scale, fixed)
+
+    def _update_values_scale(self, so):
+        offset, scale, axis = self._offset, self._scale, self._axis_correct
+        self._values_scale = [
+            _raw_scale(so * scale[i] * axis[i], offset[i] * scale[i] * axis[i])
+            for i in range(3)]
+        self._values_scale_key = (offset, scale, axis)
+
     def set_axis(self, mode):
         if type(mode) != str:
             raise TypeError("set_axis() expected 'sbmp'/'sbs'/'mb', \
@@ -209,77 +314,50 @@ but {} found".format(type(mode)))
     def calibrate(self):
         # Reference:
         # https://www.aichi-mi.com/home/%E9%9B%BB%E5%AD%90%E3%82%B3%E3%83%B3%E3%83%91%E3%82%B9/%E3%82%B3%E3%83%B3%E3%83%91%E3%82%B9%E3%81%AE%E8%BC%83%E6%AD%A3%E3%82%BD%E3%83%95%E3%83%88%E3%81%AE%E5%8E%9F%E7%90%86/
-        global CONFIG_FILE, MAGNETIC_OFFSET, MAGNETIC_OFFSET
-
+        # Every reading is fed to the studuinobit.magcal fitting engine, so
+        # calibration ends as soon as the board has been turned far enough
+        # rather than after a fixed number of samples.
         from .dsply import StuduinoBitDisplay
         display = StuduinoBitDisplay()
 
-        self._offset = (0, 0, 0)
-        self._scale = (1, 1, 1)
-
-        reading = self.get_pure_values()
-        minx = maxx = reading[0]
-        miny = maxy = reading[1]
-        minz = maxz = reading[2]
-
-        # display.scroll('Fill Dispry with Blue')
-
-        display.clear()
-        count = 0
-        x = 0
-        y = 0
-        while True:
-            if (display.get_pixel(x, y) == (0, 0, 10)):
-                display.set_pixel(x, y, 0)
-            ax, ay, az = self._icm20948.acceleration
-            x = (ax + 8) / 4 + 0.5
-            y = (ay + 8) / 4 + 0.5
-            x = int(min(max(x, 0), 4))
-            y = int(min(max(y, 0), 4))
-
-            if x == 0 or x == 4 or y == 0 or y == 4:
-                if display.get_pixel(x, y) == (0, 0, 0):
-                    display.set_pixel(x, y, 0x0a000a)
-                    reading = self.get_pure_values()
-                    minx = min(minx, reading[0])
-                    maxx = max(maxx, reading[0])
-                    miny = min(miny, reading[1])
-                    maxy = max(maxy, reading[1])
-                    minz = min(minz, reading[2])
-                    maxz = max(maxz, reading[2])
-                    display.set_pixel(x, y, 0x0a0000)
-                    count += 1
-            else:
-                display.set_pixel(x, y, 0x00000a)
-
-            if (count == 16):
-                break
-
-            sleep_ms(100)
-
-        # Hard iron correction
-        offset_x = (maxx + minx) / 2
-        offset_y = (maxy + miny) / 2
-        offset_z = (maxz + minz) / 2
-
-        self._offset = (offset_x, offset_y, offset_z)
-
-        # Soft iron correction
-        avg_delta_x = (maxx - minx) / 2
-        avg_delta_y = (maxy - miny) / 2
-        avg_delta_z = (maxz - minz) / 2
-
-        avg_delta = (avg_delta_x + avg_delta_y + avg_delta_z) / 3
-
-        scale_x = avg_delta / avg_delta_x
-        scale_y = avg_delta / avg_delta_y
-        scale_z = avg_delta / avg_delta_z
-
-        self._scale = (scale_x, scale_y, scale_z)
-
-        # Output config.json file
-        self._set_configureValue(MAGNETIC_OFFSET, self._offset)
-        self._set_configureValue(MAGNETIC_SCALE, self._scale)
+        icm = self._icm20948
+        raw = self._raw
+        _magcal.reset()
+        icm.magnetic_fast(True)
+        try:
+            # display.scroll('Fill Dispry with Blue')
+
+            display.clear()
+            count = 0
+            x = 0
+            y = 0
+            while True:
+                if (display.get_pixel(x, y) == (0, 0, 10)):
+                    display.set_pixel(x, y, 0)
+                icm.magnetic_raw_into(raw)
+                _magcal.add(raw)
+                ax, ay, az = icm.acceleration
+                x = (ax + 8) / 4 + 0.5
+                y = (ay + 8) / 4 + 0.5
+                x = int(min(max(x, 0), 4))
+                y = int(min(max(y, 0), 4))
+
+                if x == 0 or x == 4 or y == 0 or y == 4:
+                    if display.get_pixel(x, y) == (0, 0, 0):
+                        display.set_pixel(x, y, 0x0a0000)
+                        count += 1
+                else:
+                    display.set_pixel(x, y, 0x00000a)
+
+                if count == 16 or _magcal.ready():
+                    break
+
+                sleep_ms(20)
+        finally:
+            icm.magnetic_fast(False)
+
+        self._offset, self._scale = _magcal.fit(icm.magnetic_so)
+        _magcal.save(self._offset, self._scale)
 
         self._calibrated = True
 
@@ -293,8 +371,8 @@ but {} found".format(type(mode)))
     def clear_calibration(self):
         self._offset = (0, 0, 0)
         self._scale = (1, 1, 1)
-        self._set_configureValue(MAGNETIC_OFFSET, None)
-        self._set_configureValue(MAGNETIC_SCALE, None)
+        _magcal.erase()
+        self._drop_configureValues(MAGNETIC_OFFSET, MAGNETIC_SCALE)
         self._calibrated = False
 
     def heading(self):
@@ -304,75 +382,55 @@ but {} found".format(type(mode)))
         if not self._calibrated:
             self.calibrate()
 
-        ax, ay, az = self._icm20948.acceleration
         mx, my, mz = self.get_pure_values()
 
-        mx = mx
-        my = -my
-        mz = -mz
-
-        phi = atan(ay/az)
-        psi = atan(-1*ax/(ay*sin(phi)+az*cos(phi)))
-        theta = atan((mz*sin(phi)-my*cos(phi)) /
-                     (mx*cos(psi)+my*sin(psi)*sin(phi)+mz*sin(psi)*cos(phi)))
-        deg = theta * 180 / pi
-        if mx < 0:
-            offset = -90
-        else:
-            offset = +90
-        head = 1 * ((deg+offset) % 360)
-
-        return head
+        return tilt_heading(self._icm20948.acceleration, (mx, -my, -mz))
 
     def get_field_strength(self):
         raise NotImplementedError
 
-    def _get_configureValue(self, key):
-        global CONFIG_FILE
+    def _load_calibration(self):
+        # A calibration saved in CONFIG_FILE by older firmware is moved to
+        # NVS the first time it is found
+        cal = _magcal.load()
+        if cal is None:
+            offset = self._get_configureValue(MAGNETIC_OFFSET)
+            scale = self._get_configureValue(MAGNETIC_SCALE)
+            if offset is None or scale is None:
+                return None
+            cal = (tuple(offset), tuple(scale))
+            _magcal.save(*cal)
+        return cal
+
+    def _read_configureFile(self):
+        # the file is only left by older firmware, so a missing one isn't
+        # created and settings are stored in NVS instead
         try:
-            f = io.open(CONFIG_FILE, mode='r')
-            s = f.read()
-            f.close()
-        except OSError as e:
-            # create new file
-            f = io.open(CONFIG_FILE, mode='w')
-            f.close()
-            f = io.open(CONFIG_FILE, mode='r')
-            s = f.read()
-            f.close()
+            with io.open(CONFIG_FILE, mode='r') as f:
+                j = json.loads(f.read())
+        except (OSError, ValueError):
+            return {}
+        return j if isinstance(j, dict) else {}
 
-        try:
-            j = json.loads(s)
-            return j[key]
-        except OSError as e:
-            pass
-        except ValueError as e:
-            pass
-        except KeyError as e:
-            pass
-
-        return None
-
-    def _set_configureValue(self, key, value):
-        global CONFIG_FILE
-        f = io.open(CONFIG_FILE, mode='r')
-        s = f.read()
-        f.close()
+    def _get_configureValue(self, key):
+        return self._read_configureFile().get(key)
 
-        try:
-            j = json.loads(s)
-        except ValueError as e:
-            j = {}
+    def _drop_configureValues(self, *keys):
+        # rewrite the file only if it has any of the keys
+        j = self._read_configureFile()
+        if not any(key in j for key in keys):
+            return
+        for key in keys:
+            j.pop(key, None)
+        with io.open(CONFIG_FILE, mode='w') as f:
+            f.write(json.dumps(j))
 
-        try:
-            j[key] = value
-        except TypeError as e:
-            j.update({key, value})
-        s = json.dumps(j)
+def _start_sensors():
+    # the light sensor and the thermistor are oversampled in the background
+    # and read from the cache, see studuinobit_sensors.c
+    if not _sensors.running():
+        _sensors.start(100)
 
-        f = io.open(CONFIG_FILE, mode='w')
-        f.write(s)
-        f.close()
 
 __lightsensor = None
 
@@ -388,26 +446,14 @@ def get_lightsensor_object():
 class StuduinoBitLightSensor:
     def __init__(self):
         self.__lightsensor = get_lightsensor_object()
-
-    def get_value(self):
-        return int(self.__lightsensor.get_value())
+        # the native reader, already an int
+        self.get_value = self.__lightsensor.get_value
 
 
 class __SBLightSensor:
     def __init__(self):
-        self._pin = StuduinoBitAnalogPin(34)
-
-    def get_value(self):
-        return self._pin.read_analog()
-
-# resistance at 25 degrees C
-__THERMISTORNOMINAL__ = const(10000)
-# temp. for nominal resistance (almost always 25 C)
-__TEMPERATURENOMINAL__ = const(25)
-# The beta coefficient of the thermistor (usually 3000-4000)
-__BCOEFFICIENT__ = const(3950)
-# the value of the 'other' resistor
-__SERIESRESISTOR__ = const(10000)
+        _start_sensors()
+        self.get_value = _sensors.light
 
 
 __temperature = None
@@ -424,9 +470,7 @@ def get_temperature_object():
 class StuduinoBitTemperature:
     def __init__(self):
         self.__temerature = get_temperature_object()
-
-    def get_value(self):
-        return self.__temerature.get_value()
+        self.get_value = self.__temerature.get_value
 
     def get_celsius(self):
         return self.__temerature.get_celsius()
@@ -434,30 +478,14 @@ class StuduinoBitTemperature:
 
 class __SBTemperature:
     """
-    https://learn.adafruit.com/thermistor/using-a-thermistor
+    The beta equation of https://learn.adafruit.com/thermistor/using-a-thermistor
+    is evaluated in C by studuinobit.sensors.
     """
 
     def __init__(self):
-        self._pin = StuduinoBitAnalogPin(35)
-
-    def get_value(self):
-        return int(self._pin.read_analog())
+        _start_sensors()
+        self.get_value = _sensors.temperature
 
     def get_celsius(self, ndigits=2):
-        val = self._pin.read_analog(mv=False)
-        # convert the value to resistance
-        val = 4095 / val - 1
-        val = __SERIESRESISTOR__ * val
-        # print("Thermistor resistance {0}".format(average))
-
-        steinhart = val / __THERMISTORNOMINAL__                 # (R/Ro)
-        steinhart = log(steinhart)                              # ln(R/Ro)
-        steinhart /= __BCOEFFICIENT__                           # 1/B*ln(R/Ro)
-        steinhart += 1.0 / (__TEMPERATURENOMINAL__ + 273.15)    # + (1/To)
-        steinhart = 1.0 / steinhart                             # Invert
-        steinhart -= 273.15                               # convert to C
-        # print("Temperature {0} *C".format(steinhart))
-        # steinhart = int(steinhart * pow(10, ndigits)) / pow(10, ndigits)
-        steinhart = round(steinhart, ndigits)
-        return steinhart
+        return round(_sensors.celsius(), ndigits)
 
@@ -23,31 +23,16 @@ Kenji Kawase, Artec Co., Ltd.
 ------------------------------------------------------------------------------
 """
 import machine
-
-
-class PWMTimerManager():
-    TIMERPOOL = [True, True, True, True]    # True:Enable, False:Disable
-
-    def __init__(self):
-        pass
-
-    def get_pwm_timer(self):
-        for i, f in enumerate(PWMTimerManager.TIMERPOOL):
-            if f:
-                # print('Use Timer ID:{0}'.format(i))
-                PWMTimerManager.TIMERPOOL[i] = False
-                return i
-        raise MemoryError('PWM Timer has depleted.')
-
-    def rel_pwm_timer(self, i):
-        PWMTimerManager.TIMERPOOL[i] = True
+import time
 
 
 """ ---------------------------------------------------------------------- """
 """ Pins ----------------------------------------------------------------- """
 
 
-class StuduinoBitDigitalPinMixin(PWMTimerManager):
+# machine.PWM shares the LEDC timers between pins by frequency, so a pin
+# only passes timer= to pin it to a particular timer.
+class StuduinoBitDigitalPinMixin():
     def release_pwm(self):
         if self.pwm is not None:
             self.pwm.deinit()                       # stop pwm output.
@@ -113,14 +98,19 @@ class StuduinoBitDigitalPinMixin(PWMTimerManager):
 
 
 class StuduinoBitAnalogPinMixin():
-    """Returns the pin's value, which will be between 0 and 1023
-    """
-    def read_analog(self, mv=False):
+    # Lowest rate sampled with the I2S DMA ADC mode
+    TIMED_READ_MIN_HZ = 5000
+
+    def _adc(self):
         if self.adc is None:
             self.adc = machine.ADC(self.pin)
             self.adc.atten(self.adc.ATTN_11DB)
+        return self.adc
 
-        val = self.adc.readraw()
+    """Returns the pin's value, which will be between 0 and 1023
+    """
+    def read_analog(self, mv=False):
+        val = self._adc().readraw()
         if (val == 0) or (val == 4095):
             if mv:
                 val = val / 4095 * 3300
@@ -133,6 +123,26 @@ class StuduinoBitAnalogPinMixin():
 
         return val
 
+    """Fills buf, eg an array('H'), with raw 12-bit readings taken rate_hz
+    times a second.  From 5000 Hz up to 500 kHz the samples are taken by the
+    I2S DMA ADC mode; lower rates are paced here.
+    """
+    def read_analog_into(self, buf, rate_hz):
+        if rate_hz <= 0:
+            raise ValueError('rate_hz must be positive')
+        adc = self._adc()
+        if rate_hz >= self.TIMED_READ_MIN_HZ:
+            adc.read_timed(buf, rate_hz, wait=True)
+            return
+        period = 1000000 // rate_hz
+        t = time.ticks_us()
+        for i in range(len(buf)):
+            buf[i] = adc.readraw()
+            t = time.ticks_add(t, period)
+            wait = time.ticks_diff(t, time.ticks_us())
+            if wait > 0:
+                time.sleep_us(wait)
+
 
 class StuduinoBitDigitalPin(StuduinoBitDigitalPinMixin):
     def __init__(self, pin):
@@ -190,6 +200,24 @@ class StuduinoBitAnalogDigialPin(StuduinoBitDigitalPinMixin,
         else:
             return int(super().read_analog(mv))
 
+    def read_analog_into(self, buf, rate_hz):
+        if self.pwm is not None:
+            self.pwm.deinit()
+            self.pwm = None
+        super().read_analog_into(buf, rate_hz)
+
+
+"""Fills buf, eg an array('H'), with raw 12-bit readings of the analog
+terminals, eg (p0, p1, p2, p3), interleaved in that order: every one of
+them is sampled rate_hz times a second by a single DMA driven sweep.
+"""
+def read_analog_scan(terminals, buf, rate_hz):
+    for t in terminals:
+        if getattr(t, 'pwm', None) is not None:
+            t.pwm.deinit()
+            t.pwm = None
+    machine.ADC.scan([t.pin for t in terminals], buf, rate_hz)
+
 
 # for singleton pattern
 # Implement used global value,
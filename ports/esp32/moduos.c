@@ -38,6 +38,7 @@
 #include "extmod/misc.h"
 #include "extmod/vfs.h"
 #include "extmod/vfs_fat.h"
+#include "extmod/vfs_log.h"
 #include "genhdr/mpversion.h"
 
 extern const mp_obj_type_t mp_fat_vfs_type;
@@ -84,15 +85,35 @@ STATIC mp_obj_t os_urandom(mp_obj_t num) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(os_urandom_obj, os_urandom);
 
+#if MICROPY_VFS
+// mmap(path) -> read-only memoryview of a file, for filesystems that keep
+// their files memory mapped (esp32.Bundle)
+STATIC mp_obj_t os_mmap(mp_obj_t path_in) {
+    const char *path_out;
+    mp_vfs_mount_t *vfs = mp_vfs_lookup_path(mp_obj_str_get_str(path_in), &path_out);
+    if (vfs == MP_VFS_NONE || vfs == MP_VFS_ROOT) {
+        mp_raise_OSError(MP_ENOENT);
+    }
+    mp_obj_t dest[3];
+    mp_load_method_maybe(vfs->obj, MP_QSTR_mmap, dest);
+    if (dest[0] == MP_OBJ_NULL) {
+        mp_raise_OSError(MP_EOPNOTSUPP);
+    }
+    dest[2] = mp_obj_new_str(path_out, strlen(path_out));
+    return mp_call_method_n_kw(1, 0, dest);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(os_mmap_obj, os_mmap);
+#endif
+
 #if MICROPY_PY_OS_DUPTERM
 STATIC mp_obj_t os_dupterm_notify(mp_obj_t obj_in) {
     (void)obj_in;
-    for (;;) {
-        int c = mp_uos_dupterm_rx_chr();
-        if (c < 0) {
-            break;
+    byte buf[32];
+    int n;
+    while ((n = mp_uos_dupterm_rx_strn(buf, sizeof(buf))) >= 0) {
+        for (int i = 0; i < n; ++i) {
+            ringbuf_put(&stdin_ringbuf, buf[i]);
         }
-        ringbuf_put(&stdin_ringbuf, c);
     }
     return mp_const_none;
 }
@@ -120,9 +141,13 @@ STATIC const mp_rom_map_elem_t os_module_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_statvfs), MP_ROM_PTR(&mp_vfs_statvfs_obj) },
     { MP_ROM_QSTR(MP_QSTR_mount), MP_ROM_PTR(&mp_vfs_mount_obj) },
     { MP_ROM_QSTR(MP_QSTR_umount), MP_ROM_PTR(&mp_vfs_umount_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mmap), MP_ROM_PTR(&os_mmap_obj) },
     #if MICROPY_VFS_FAT
     { MP_ROM_QSTR(MP_QSTR_VfsFat), MP_ROM_PTR(&mp_fat_vfs_type) },
     #endif
+    #if MICROPY_VFS_LOG
+    { MP_ROM_QSTR(MP_QSTR_VfsLog), MP_ROM_PTR(&mp_type_vfs_log) },
+    #endif
     #endif
 };
 
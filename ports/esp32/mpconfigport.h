@@ -5,56 +5,114 @@
 #include <alloca.h>
 #include "rom/ets_sys.h"
 
-// object representation and NLR handling
+// object representation
+#ifndef MICROPY_OBJ_REPR
 #define MICROPY_OBJ_REPR                    (MICROPY_OBJ_REPR_A)
-#define MICROPY_NLR_SETJMP                  (1)
+#endif
 
 // memory allocation policies
 #define MICROPY_ALLOC_PATH_MAX              (128)
 
 // emitters
 #define MICROPY_PERSISTENT_CODE_LOAD        (1)
+#define MICROPY_PERSISTENT_CODE_SAVE        (1)
+#define MICROPY_PERSISTENT_CODE_LOAD_NATIVE (1)
+#define MICROPY_NATIVE_ARCH                 (MP_NATIVE_ARCH_XTENSAWIN)
 
 // compiler configuration
 #define MICROPY_COMP_MODULE_CONST           (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN    (1)
+#define MICROPY_COMP_CONST_FOLDING_EXTENDED (1)
+#define MICROPY_COMP_CONST_TUPLE            (1)
 
 // optimisations
 #define MICROPY_OPT_COMPUTED_GOTO           (1)
 #define MICROPY_OPT_MPZ_BITWISE             (1)
+#define MICROPY_OPT_MPZ_KARATSUBA           (48)
+#define MICROPY_OPT_MPZ_MONTGOMERY          (1)
+#define MICROPY_OPT_CACHE_CLASS_LOOKUP      (64)
+#define MICROPY_OPT_SMALL_INT_BINARY_OP     (1)
+#define MICROPY_OPT_SUPERINSTRUCTIONS       (1)
+#define MICROPY_OPT_FAST_CALL               (1)
+#define MICROPY_OPT_ARG_PARSE_FAST          (1)
+#define MICROPY_OPT_GEN_FRAME_REUSE         (1)
+#define MICROPY_MAP_COMPACT                 (1)
+#define MICROPY_OPT_MAP_INT_KEYS            (1)
+#define MICROPY_OPT_STR_CONCAT_INPLACE      (32)
+#define MICROPY_OPT_STR_INDEX_CACHE         (4)
+#define MICROPY_OPT_STR_LAZY_HASH           (32)
+#define MICROPY_OPT_STR_SLICE_VIEW          (64)
+#define MICROPY_OPT_STR_FIND_FAST           (1)
+#define MICROPY_OPT_STR_CACHE               (32)
+#define MICROPY_OPT_STR_FORMAT_CACHE        (8)
+#define MICROPY_QSTR_HASH_INDEX             (1)
 
 // Python internal features
 #define MICROPY_READER_VFS                  (1)
+#define MICROPY_READER_VFS_BUF_SIZE         (2048)
 #define MICROPY_ENABLE_GC                   (1)
+// with SPIRAM, small objects go in an internal RAM area and large ones in SPIRAM
+#define MICROPY_GC_SPLIT_HEAP               (CONFIG_SPIRAM_SUPPORT)
+#define MICROPY_GC_SPLIT_HEAP_LARGE         (256)
+#define MICROPY_GC_INCREMENTAL_SWEEP        (1)
+#define MICROPY_GC_HEAP_STACK               (1)
+#define MICROPY_GC_RUN_HINTS                (7)
+#define MICROPY_GC_MEM_PEAK                 (1)
+#define MICROPY_GC_FREE_LISTS               (16)
+#define MICROPY_GC_FINALISER_LIST           (32)
+#define MICROPY_GC_ARENA                    (8)
+#define MICROPY_PY_MICROPYTHON_STATS        (1)
 #define MICROPY_ENABLE_FINALISER            (1)
 #define MICROPY_STACK_CHECK                 (1)
+#define MICROPY_ENABLE_PYSTACK              (1)
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF (1)
+#define MICROPY_PREALLOC_EXCEPTIONS         (1)
 #define MICROPY_KBD_EXCEPTION               (1)
 #define MICROPY_HELPER_REPL                 (1)
 #define MICROPY_REPL_EMACS_KEYS             (1)
 #define MICROPY_REPL_AUTO_INDENT            (1)
+#define MICROPY_REPL_RAW_PASTE              (1)
+#define MICROPY_REPL_STDIN_BUFFER_MAX       (1024)
 #define MICROPY_LONGINT_IMPL                (MICROPY_LONGINT_IMPL_MPZ)
 #define MICROPY_ENABLE_SOURCE_LINE          (1)
+#define MICROPY_PROF_SAMPLES                (256)
 #define MICROPY_ERROR_REPORTING             (MICROPY_ERROR_REPORTING_NORMAL)
 #define MICROPY_WARNINGS                    (1)
 #define MICROPY_FLOAT_IMPL                  (MICROPY_FLOAT_IMPL_FLOAT)
+#define MICROPY_FLOAT_FORMAT_SHORTEST       (1)
 #define MICROPY_CPYTHON_COMPAT              (1)
 #define MICROPY_STREAMS_NON_BLOCK           (1)
 #define MICROPY_STREAMS_POSIX_API           (1)
 #define MICROPY_MODULE_BUILTIN_INIT         (1)
 #define MICROPY_MODULE_WEAK_LINKS           (1)
+#define MICROPY_MODULE_GETATTR              (1)
 #define MICROPY_MODULE_FROZEN_STR           (0)
 #define MICROPY_MODULE_FROZEN_MPY           (1)
+#define MICROPY_MODULE_FROZEN_MPY_COMPRESSED (16)
+#define MICROPY_MODULE_MPY_CACHE            (1)
 #define MICROPY_QSTR_EXTRA_POOL             mp_qstr_frozen_const_pool
 #define MICROPY_CAN_OVERRIDE_BUILTINS       (1)
 #define MICROPY_USE_INTERNAL_ERRNO          (1)
 #define MICROPY_USE_INTERNAL_PRINTF         (0) // ESP32 SDK requires its own printf
 #define MICROPY_ENABLE_SCHEDULER            (1)
-#define MICROPY_SCHEDULER_DEPTH             (8)
+#define MICROPY_SCHEDULER_DEPTH             (32)
+#define MICROPY_SCHED_HOOK_SCHEDULED \
+    do { \
+        extern void mp_hal_wake_main_task(void); \
+        mp_hal_wake_main_task(); \
+    } while (0)
+#define MICROPY_SCHEDULER_HIGH_DEPTH        (8)
+#define MICROPY_SCHEDULER_STATS             (8)
 #define MICROPY_VFS                         (1)
+#define MICROPY_VFS_LOG                     (1)
 
 #if MICROPY_FATFS == 1
 #define MICROPY_VFS_FAT                     (1)
+// mount the filesystem from C at boot and only run _boot.py if that fails;
+// flashbdev.bdev is then not the mounted device
+#ifndef MICROPY_ESP32_FAST_BOOT
+#define MICROPY_ESP32_FAST_BOOT             (0)
+#endif
 #else
 #define MICROPY_VFS_FAT                     (0)
 #define MICROPY_SDMMC_SHOW_INFO             (1) // show sdcard info after initialization
@@ -67,6 +125,7 @@
 // control over Python builtins
 #define MICROPY_PY_FUNCTION_ATTRS           (1)
 #define MICROPY_PY_DESCRIPTORS              (1)
+#define MICROPY_PY_CLASS_SLOTS              (1)
 #define MICROPY_PY_STR_BYTES_CMP_WARN       (1)
 #define MICROPY_PY_BUILTINS_STR_UNICODE     (1)
 #define MICROPY_PY_BUILTINS_STR_CENTER      (1)
@@ -99,12 +158,17 @@
 #define MICROPY_PY_MICROPYTHON_MEM_INFO     (1)
 #define MICROPY_PY_ARRAY                    (1)
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN       (1)
+#define MICROPY_PY_ARRAY_OPS                (1)
 #define MICROPY_PY_ATTRTUPLE                (1)
 #define MICROPY_PY_COLLECTIONS              (1)
 #define MICROPY_PY_COLLECTIONS_DEQUE        (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_ITER   (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE (1)
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT  (1)
 #define MICROPY_PY_MATH                     (1)
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS   (1)
+#define MICROPY_PY_MATH_ARRAY               (1)
 #define MICROPY_PY_CMATH                    (1)
 #define MICROPY_PY_GC                       (1)
 #define MICROPY_PY_IO                       (1)
@@ -113,6 +177,7 @@
 #define MICROPY_PY_IO_BYTESIO               (1)
 #define MICROPY_PY_IO_BUFFEREDWRITER        (1)
 #define MICROPY_PY_STRUCT                   (1)
+#define MICROPY_PY_STRUCT_STRUCT            (1)
 #define MICROPY_PY_SYS                      (1)
 #define MICROPY_PY_SYS_MAXSIZE              (1)
 #define MICROPY_PY_SYS_MODULES              (1)
@@ -121,45 +186,68 @@
 #define MICROPY_PY_SYS_STDIO_BUFFER         (1)
 #define MICROPY_PY_UERRNO                   (1)
 #define MICROPY_PY_USELECT                  (1)
+#define MICROPY_PY_USELECT_NOTIFY           (1)
 #define MICROPY_PY_UTIME_MP_HAL             (1)
 #define MICROPY_PY_THREAD                   (1)
 #define MICROPY_PY_THREAD_GIL               (1)
 #define MICROPY_PY_THREAD_GIL_VM_DIVISOR    (32)
+#define MICROPY_PY_THREAD_STATS             (1)
+#define MICROPY_PY_THREAD_QUEUE             (1)
 
 // extended modules
 #define MICROPY_PY_UCTYPES                  (1)
 #define MICROPY_PY_UZLIB                    (1)
+#define MICROPY_PY_UZLIB_COMPRESS           (1)
+#define MICROPY_PY_UZLIB_FAST_BITS          (9)
 #define MICROPY_PY_UJSON                    (1)
+#define MICROPY_PY_UJSON_ITERLOAD           (1)
 #define MICROPY_PY_URE                      (1)
 #define MICROPY_PY_URE_SUB                  (1)
+#define MICROPY_PY_URE_PIKEVM               (1)
+#define MICROPY_PY_URE_CACHE                (8)
+#define MICROPY_PY_UCTYPES_LAYOUT_CACHE     (8)
 #define MICROPY_PY_UHEAPQ                   (1)
+#define MICROPY_PY_UHEAPQ_BULK              (1)
 #define MICROPY_PY_UTIMEQ                   (1)
 #define MICROPY_PY_UHASHLIB                 (1)
 #define MICROPY_PY_UHASHLIB_SHA1            (1)
 #define MICROPY_PY_UHASHLIB_SHA256          (1)
+#define MICROPY_PY_UHASHLIB_FINALISER       (1)
 #define MICROPY_PY_UCRYPTOLIB               (1)
+#define MICROPY_PY_UCRYPTOLIB_CTR           (1)
+#define MICROPY_PY_UCRYPTOLIB_GCM           (1)
 #define MICROPY_PY_UBINASCII                (1)
 #define MICROPY_PY_UBINASCII_CRC32          (1)
+#define MICROPY_PY_UBINASCII_INTO           (1)
 #define MICROPY_PY_URANDOM                  (1)
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS      (1)
+#define MICROPY_PY_URANDOM_HW_FUNC()        esp_random()
 #define MICROPY_PY_OS_DUPTERM               (1)
 #define MICROPY_PY_MACHINE                  (1)
 #define MICROPY_PY_MACHINE_PIN_MAKE_NEW     mp_pin_make_new
 #define MICROPY_PY_MACHINE_PULSE            (1)
 #define MICROPY_PY_MACHINE_I2C              (1)
+#define MICROPY_PY_MACHINE_I2C_MAKE_NEW     machine_hw_i2c_make_new
 #define MICROPY_PY_MACHINE_SPI              (1)
 #define MICROPY_PY_MACHINE_SPI_MSB          (0)
 #define MICROPY_PY_MACHINE_SPI_LSB          (1)
 #define MICROPY_PY_MACHINE_SPI_MAKE_NEW     machine_hw_spi_make_new
 #define MICROPY_HW_SOFTSPI_MIN_DELAY        (0)
 #define MICROPY_HW_SOFTSPI_MAX_BAUDRATE     (ets_get_cpu_frequency() * 1000000 / 200) // roughly
+#define MICROPY_HW_STDOUT_TXBUF_SIZE        (1024) // console output queued for the UART
 #define MICROPY_PY_USSL                     (1)
 #define MICROPY_SSL_MBEDTLS                 (1)
 #define MICROPY_PY_USSL_FINALISER           (1)
+#define MICROPY_PY_USSL_SESSION_CACHE       (4)
 #define MICROPY_PY_UWEBSOCKET               (1)
+#define MICROPY_PY_UMQTTC                   (1)
+#define MICROPY_PY_UHTTPC                   (1)
+#define MICROPY_PY_ULOG                     (1)
+#define MICROPY_PY_UASYNCIO                 (1)
 #define MICROPY_PY_WEBREPL                  (1)
 #define MICROPY_PY_FRAMEBUF                 (1)
 #define MICROPY_PY_USOCKET_EVENTS           (MICROPY_PY_WEBREPL)
+#define MICROPY_PY_USOCKET_EVENTS_MAX       (16) // most lwIP sockets IDF allows
 
 // fatfs configuration
 #define MICROPY_FATFS_ENABLE_LFN            (1)
@@ -194,7 +282,9 @@ extern const struct _mp_obj_module_t mp_module_usocket;
 extern const struct _mp_obj_module_t mp_module_machine;
 extern const struct _mp_obj_module_t mp_module_network;
 extern const struct _mp_obj_module_t mp_module_onewire;
+extern const struct _mp_obj_module_t mp_module_neopixel;
 extern const struct _mp_obj_module_t mp_module_ota;
+extern const struct _mp_obj_module_t mp_module_studuinobit;
 
 #define MICROPY_PORT_BUILTIN_MODULES \
     { MP_OBJ_NEW_QSTR(MP_QSTR_esp), (mp_obj_t)&esp_module }, \
@@ -205,8 +295,10 @@ extern const struct _mp_obj_module_t mp_module_ota;
     { MP_OBJ_NEW_QSTR(MP_QSTR_machine), (mp_obj_t)&mp_module_machine }, \
     { MP_OBJ_NEW_QSTR(MP_QSTR_network), (mp_obj_t)&mp_module_network }, \
     { MP_OBJ_NEW_QSTR(MP_QSTR__onewire), (mp_obj_t)&mp_module_onewire }, \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_neopixel), (mp_obj_t)&mp_module_neopixel }, \
     { MP_OBJ_NEW_QSTR(MP_QSTR_uhashlib), (mp_obj_t)&mp_module_uhashlib }, \
     { MP_OBJ_NEW_QSTR(MP_QSTR_ota), (mp_obj_t)&mp_module_ota }, \
+    { MP_OBJ_NEW_QSTR(MP_QSTR_studuinobit), (mp_obj_t)&mp_module_studuinobit }, \
 
 
 #define MICROPY_PORT_BUILTIN_MODULE_WEAK_LINKS \
@@ -230,17 +322,33 @@ extern const struct _mp_obj_module_t mp_module_ota;
 #define MP_STATE_PORT MP_STATE_VM
 
 struct _machine_timer_obj_t;
+struct _esp32_flashbdev_obj_t;
 
 #define MICROPY_PORT_ROOT_POINTERS \
     const char *readline_hist[8]; \
     mp_obj_t machine_pin_irq_handler[40]; \
+    void *machine_pin_capture; \
+    mp_obj_t machine_touchpad_irq_handler[10]; \
+    mp_obj_t network_wlan_irq_handler; \
     struct _machine_timer_obj_t *machine_timer_obj_head; \
+    struct _esp32_flashbdev_obj_t *esp32_flashbdev_head; \
+    mp_obj_t studuinobit_display_anim[4]; \
+    mp_obj_t studuinobit_audio_src; \
+    void *studuinobit_imu_out; \
+    void *machine_adc_collect; \
+    struct _machine_uart_obj_t *machine_uart_obj_all[3]; \
+    struct _machine_hw_spi_async_t *machine_hw_spi_async[2]; \
+    struct _socket_obj_t *usocket_events_sock[MICROPY_PY_USOCKET_EVENTS_MAX]; \
+    struct _mp_stream_poll_notify_t *usocket_poll_notify[MICROPY_PY_USOCKET_EVENTS_MAX]; \
+    mp_obj_t esp32_vm_channels[2]; \
 
 // type definitions for the specific machine
 
 #define BYTES_PER_WORD (4)
 #define MICROPY_MAKE_POINTER_CALLABLE(p) ((void*)((mp_uint_t)(p)))
 #define MP_PLAT_PRINT_STRN(str, len) mp_hal_stdout_tx_strn_cooked(str, len)
+void *esp_native_code_commit(void*, size_t, void*);
+#define MP_PLAT_COMMIT_EXEC(buf, len, reloc) esp_native_code_commit(buf, len, reloc)
 #define MP_SSIZE_MAX (0x7fffffff)
 
 // Note: these "critical nested" macros do not ensure cross-CPU exclusion,
@@ -256,6 +364,9 @@ struct _machine_timer_obj_t;
 #define MICROPY_PY_USOCKET_EVENTS_HANDLER
 #endif
 
+// with the power management governor on, uselect waits a tick between polls
+#define MICROPY_PY_USELECT_IDLE_HOOK extern void mp_hal_pm_idle(void); mp_hal_pm_idle();
+
 #if MICROPY_PY_THREAD
 #define MICROPY_EVENT_POLL_HOOK \
     do { \
@@ -275,6 +386,9 @@ struct _machine_timer_obj_t;
     } while (0);
 #endif
 
+// the hardware RNG, from esp_system.h
+uint32_t esp_random(void);
+
 #define UINT_FMT "%u"
 #define INT_FMT "%d"
 
@@ -31,7 +31,8 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "rom/uart.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
 
 #include "py/obj.h"
 #include "py/mpstate.h"
@@ -39,10 +40,21 @@
 #include "extmod/misc.h"
 #include "lib/utils/pyexec.h"
 #include "mphalport.h"
+#include "uart.h"
 
 TaskHandle_t mp_main_task_handle;
 
-STATIC uint8_t stdin_ringbuf_array[256];
+// The main task holds a CPU_FREQ_MAX lock while it runs and drops it while
+// blocked in mp_hal_wait_event(), so that with machine.freq(max, min) the
+// CPU runs at min, or light sleeps, whenever the VM is idle.
+bool mp_hal_pm_auto = false;
+STATIC esp_pm_lock_handle_t mp_hal_pm_lock = NULL;
+STATIC uint64_t mp_hal_pm_t0;
+STATIC uint64_t mp_hal_pm_idle_us;
+STATIC uint32_t mp_hal_pm_wakeups;
+
+// a ringbuf holds one byte less than its size
+STATIC uint8_t stdin_ringbuf_array[MICROPY_REPL_STDIN_BUFFER_MAX + 1];
 ringbuf_t stdin_ringbuf = {stdin_ringbuf_array, sizeof(stdin_ringbuf_array)};
 
 int mp_hal_stdin_rx_chr(void) {
@@ -52,47 +64,73 @@ int mp_hal_stdin_rx_chr(void) {
             return c;
         }
         MICROPY_EVENT_POLL_HOOK
-        ulTaskNotifyTake(pdFALSE, 1);
+        // the UART interrupt, dupterm and scheduled callbacks all notify
+        // the task, so there is no need to wake up in between
+        mp_hal_wait_event(portMAX_DELAY);
     }
 }
 
-void mp_hal_stdout_tx_str(const char *str) {
-    mp_hal_stdout_tx_strn(str, strlen(str));
+void mp_hal_pm_init(void) {
+    if (mp_hal_pm_lock == NULL) {
+        esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "mp_task", &mp_hal_pm_lock);
+        esp_pm_lock_acquire(mp_hal_pm_lock);
+    }
+    mp_hal_pm_stats(true, NULL, NULL, NULL);
 }
 
-void mp_hal_stdout_tx_strn(const char *str, uint32_t len) {
-    // Only release the GIL if many characters are being sent
-    bool release_gil = len > 20;
-    if (release_gil) {
-        MP_THREAD_GIL_EXIT();
+void mp_hal_pm_stats(bool reset, uint64_t *run_us, uint64_t *idle_us, uint32_t *wakeups) {
+    uint64_t now = esp_timer_get_time();
+    if (run_us != NULL) {
+        *run_us = now - mp_hal_pm_t0 - mp_hal_pm_idle_us;
+        *idle_us = mp_hal_pm_idle_us;
+        *wakeups = mp_hal_pm_wakeups;
     }
-    for (uint32_t i = 0; i < len; ++i) {
-        uart_tx_one_char(str[i]);
+    if (reset) {
+        mp_hal_pm_t0 = now;
+        mp_hal_pm_idle_us = 0;
+        mp_hal_pm_wakeups = 0;
     }
-    if (release_gil) {
-        MP_THREAD_GIL_ENTER();
+}
+
+// Block until the main task is notified or the ticks have passed.  The GIL
+// and the power management lock are released for the duration.
+void mp_hal_wait_event(TickType_t ticks) {
+    uint64_t t0 = esp_timer_get_time();
+    MP_THREAD_GIL_EXIT();
+    if (mp_hal_pm_lock != NULL) {
+        esp_pm_lock_release(mp_hal_pm_lock);
     }
+    ulTaskNotifyTake(pdFALSE, ticks);
+    if (mp_hal_pm_lock != NULL) {
+        esp_pm_lock_acquire(mp_hal_pm_lock);
+    }
+    MP_THREAD_GIL_ENTER();
+    mp_hal_pm_idle_us += esp_timer_get_time() - t0;
+    ++mp_hal_pm_wakeups;
+}
+
+// Used by uselect between polls: with the governor on, give the CPU a tick
+// to slow down instead of spinning
+void mp_hal_pm_idle(void) {
+    if (mp_hal_pm_auto) {
+        mp_hal_wait_event(1);
+    }
+}
+
+void mp_hal_stdout_tx_str(const char *str) {
+    mp_hal_stdout_tx_strn(str, strlen(str));
+}
+
+void mp_hal_stdout_tx_strn(const char *str, uint32_t len) {
+    uart_stdout_tx_strn(str, len, false);
     mp_uos_dupterm_tx_strn(str, len);
 }
 
-// Efficiently convert "\n" to "\r\n"
+// The UART gets "\n" converted to "\r\n" as the bytes are queued, and
+// dupterm does its own conversion in buffered chunks
 void mp_hal_stdout_tx_strn_cooked(const char *str, size_t len) {
-    const char *last = str;
-    while (len--) {
-        if (*str == '\n') {
-            if (str > last) {
-                mp_hal_stdout_tx_strn(last, str - last);
-            }
-            mp_hal_stdout_tx_strn("\r\n", 2);
-            ++str;
-            last = str;
-        } else {
-            ++str;
-        }
-    }
-    if (str > last) {
-        mp_hal_stdout_tx_strn(last, str - last);
-    }
+    uart_stdout_tx_strn(str, len, true);
+    mp_uos_dupterm_tx_strn_cooked(str, len);
 }
 
 uint32_t mp_hal_ticks_ms(void) {
@@ -115,7 +153,13 @@ void mp_hal_delay_ms(uint32_t ms) {
             break;
         }
         MICROPY_EVENT_POLL_HOOK
-        ulTaskNotifyTake(pdFALSE, 1);
+        // sleep until just before the deadline, an event wakes the task
+        // early; the long wait lets the CPU enter light sleep
+        TickType_t ticks = (us - dt) / (portTICK_PERIOD_MS * 1000) - 1;
+        if (ticks == 0) {
+            ticks = 1;
+        }
+        mp_hal_wait_event(ticks);
     }
     if (dt < us) {
         // do the remaining delay accurately
@@ -155,6 +199,15 @@ int *__errno() {
 }
 */
 
+// Wake up the main task if it is sleeping, from task or interrupt context
+void mp_hal_wake_main_task(void) {
+    if (xPortInIsrContext()) {
+        mp_hal_wake_main_task_from_isr();
+    } else {
+        xTaskNotifyGive(mp_main_task_handle);
+    }
+}
+
 // Wake up the main task if it is sleeping
 void mp_hal_wake_main_task_from_isr(void) {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
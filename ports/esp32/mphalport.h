@@ -55,8 +55,30 @@ uint32_t mp_hal_get_cpu_freq(void);
 #define mp_hal_quiet_timing_exit(irq_state) MICROPY_END_ATOMIC_SECTION(irq_state)
 
 // Wake up the main task if it is sleeping
+void mp_hal_wake_main_task(void);
 void mp_hal_wake_main_task_from_isr(void);
 
+// Power management governor, see machine.freq()
+extern bool mp_hal_pm_auto;
+void mp_hal_pm_init(void);
+void mp_hal_pm_stats(bool reset, uint64_t *run_us, uint64_t *idle_us, uint32_t *wakeups);
+void mp_hal_wait_event(TickType_t ticks);
+void mp_hal_pm_idle(void);
+
+// Bracket a long-running driver call with these so that other threads run
+// meanwhile; the call must not touch Python objects or raise.  owner is the
+// object holding the buffer the call uses, or MP_OBJ_NULL.  It is kept in a
+// volatile slot on this thread's stack, which the GC scans, so the buffer
+// can't be reclaimed even if only a pointer into its middle is otherwise
+// live.  Code that shares state on the object must guard it itself.
+#define MP_HAL_BLOCKING_BEGIN(owner) do { \
+        volatile mp_obj_t mp_hal_blocking_owner = (owner); \
+        MP_THREAD_GIL_EXIT();
+#define MP_HAL_BLOCKING_END() \
+        MP_THREAD_GIL_ENTER(); \
+        (void)mp_hal_blocking_owner; \
+    } while (0)
+
 // C-level pin HAL
 #include "py/obj.h"
 #include "driver/gpio.h"
@@ -91,4 +113,19 @@ static inline void mp_hal_pin_write(mp_hal_pin_obj_t pin, int v) {
     gpio_set_level(pin, v);
 }
 
+// zlib-compatible CRC-32 from ROM, for ubinascii.crc32()
+#include "rom/crc.h"
+#define mp_hal_crc32(crc, buf, len) crc32_le((crc), (const uint8_t*)(buf), (len))
+
+// 1-Wire and DHT transfers done by the RMT peripheral, see esprmt_rx.c.  They
+// return -1 when no channel is available and the caller should bit-bang.
+int esp_rmt_onewire_reset(uint8_t pin);
+int esp_rmt_onewire_readbyte(uint8_t pin);
+int esp_rmt_onewire_writebyte(uint8_t pin, uint8_t value);
+int esp_rmt_dht_readinto(uint8_t pin, uint8_t *buf);
+#define mp_hal_onewire_reset(pin) esp_rmt_onewire_reset(pin)
+#define mp_hal_onewire_readbyte(pin) esp_rmt_onewire_readbyte(pin)
+#define mp_hal_onewire_writebyte(pin, value) esp_rmt_onewire_writebyte((pin), (value))
+#define mp_hal_dht_readinto(pin, buf) esp_rmt_dht_readinto((pin), (buf))
+
 #endif // INCLUDED_MPHALPORT_H
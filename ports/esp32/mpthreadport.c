@@ -26,14 +26,17 @@
  */
 
 #include "stdio.h"
+#include <string.h>
 
 #include "py/mpconfig.h"
 #include "py/mpstate.h"
 #include "py/gc.h"
 #include "py/mpthread.h"
+#include "py/runtime.h"
 #include "mpthreadport.h"
 
 #include "esp_task.h"
+#include "esp_timer.h"
 
 #if MICROPY_PY_THREAD
 
@@ -48,6 +51,9 @@ typedef struct _thread_t {
     void *arg;              // thread Python args, a GC root pointer
     void *stack;            // pointer to the stack
     size_t stack_len;       // number of words in the stack
+    #if MICROPY_PY_THREAD_STATS
+    size_t stack_size;      // bytes allocated for the stack
+    #endif
     struct _thread_t *next;
 } thread_t;
 
@@ -65,6 +71,9 @@ void mp_thread_init(void *stack, uint32_t stack_len) {
     thread->arg = NULL;
     thread->stack = stack;
     thread->stack_len = stack_len;
+    #if MICROPY_PY_THREAD_STATS
+    thread->stack_size = stack_len * sizeof(StackType_t);
+    #endif
     thread->next = NULL;
     mp_thread_mutex_init(&thread_mutex);
 }
@@ -81,6 +90,12 @@ void mp_thread_gc_others(void) {
             continue;
         }
         gc_collect_root(th->stack, th->stack_len); // probably not needed
+        #if MICROPY_ENABLE_PYSTACK
+        mp_state_thread_t *ts = pvTaskGetThreadLocalStoragePointer(th->id, 1);
+        if (ts != NULL) {
+            gc_collect_root((void**)(void*)ts->pystack_start, (ts->pystack_cur - ts->pystack_start) / sizeof(void*));
+        }
+        #endif
     }
     mp_thread_mutex_unlock(&thread_mutex);
 }
@@ -136,6 +151,10 @@ void mp_thread_create_ex(void *(*entry)(void*), void *arg, size_t *stack_size, i
         nlr_raise(mp_obj_new_exception_msg(&mp_type_OSError, "can't create thread"));
     }
 
+    #if MICROPY_PY_THREAD_STATS
+    th->stack_size = *stack_size;
+    #endif
+
     // adjust the stack_size to provide room to recover from hitting the limit
     *stack_size -= 1024;
 
@@ -197,6 +216,98 @@ void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex) {
     xSemaphoreGive(mutex->handle);
 }
 
+portMUX_TYPE mp_thread_queue_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void mp_thread_queue_wait(uint32_t ms) {
+    MP_THREAD_GIL_EXIT();
+    ulTaskNotifyTake(pdTRUE, ms / portTICK_PERIOD_MS + 1);
+    MP_THREAD_GIL_ENTER();
+}
+
+#if MICROPY_PY_THREAD_STATS
+void mp_thread_gil_enter(void) {
+    if (mp_thread_mutex_lock(&MP_STATE_VM(gil_mutex), 0)) {
+        return;
+    }
+    int64_t t0 = esp_timer_get_time();
+    mp_thread_mutex_lock(&MP_STATE_VM(gil_mutex), 1);
+    mp_state_thread_t *ts = mp_thread_get_state();
+    if (ts != NULL) {
+        ts->gil_wait_us += esp_timer_get_time() - t0;
+    }
+}
+
+// Return (total_us, [(ident, name, run_us, stack_size, stack_free,
+// gil_wait_us, core), ...]) for the threads known to MicroPython.  run_us is
+// the time the task has been running, from the FreeRTOS run-time counters,
+// so its share of the CPU is run_us / total_us between two calls.  core is
+// None if the task is not pinned.  The idents match _thread.get_ident().
+mp_obj_t mp_thread_stats(void) {
+    typedef struct _thread_stats_t {
+        uintptr_t ident;
+        char name[configMAX_TASK_NAME_LEN];
+        uint32_t run;
+        size_t stack_size;
+        size_t stack_free;
+        uint64_t gil_wait_us;
+        BaseType_t core;
+    } thread_stats_t;
+
+    // nothing may allocate while thread_mutex is held, because a collection
+    // would take it again in mp_thread_gc_others, so allocate up front
+    UBaseType_t n_alloc = uxTaskGetNumberOfTasks() + 2;
+    TaskStatus_t *status = m_new(TaskStatus_t, n_alloc);
+    thread_stats_t *stats = m_new(thread_stats_t, n_alloc);
+    uint32_t total = 0;
+    UBaseType_t n_tasks = uxTaskGetSystemState(status, n_alloc, &total);
+
+    size_t n = 0;
+    mp_thread_mutex_lock(&thread_mutex, 1);
+    for (thread_t *th = thread; th != NULL && n < n_alloc; th = th->next) {
+        if (!th->ready) {
+            continue;
+        }
+        thread_stats_t *st = &stats[n++];
+        st->run = 0;
+        for (UBaseType_t i = 0; i < n_tasks; ++i) {
+            if (status[i].xHandle == th->id) {
+                st->run = status[i].ulRunTimeCounter;
+                break;
+            }
+        }
+        mp_state_thread_t *ts = pvTaskGetThreadLocalStoragePointer(th->id, 1);
+        st->ident = (uintptr_t)ts;
+        strncpy(st->name, pcTaskGetTaskName(th->id), sizeof(st->name));
+        st->name[sizeof(st->name) - 1] = '\0';
+        st->stack_size = th->stack_size;
+        st->stack_free = uxTaskGetStackHighWaterMark(th->id) * sizeof(StackType_t);
+        st->gil_wait_us = ts != NULL ? ts->gil_wait_us : 0;
+        st->core = xTaskGetAffinity(th->id);
+    }
+    mp_thread_mutex_unlock(&thread_mutex);
+    m_del(TaskStatus_t, status, n_alloc);
+
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < n; ++i) {
+        thread_stats_t *st = &stats[i];
+        mp_obj_t tuple[7] = {
+            mp_obj_new_int_from_uint(st->ident),
+            mp_obj_new_str(st->name, strlen(st->name)),
+            mp_obj_new_int_from_uint(st->run),
+            mp_obj_new_int_from_uint(st->stack_size),
+            mp_obj_new_int_from_uint(st->stack_free),
+            mp_obj_new_int_from_ull(st->gil_wait_us),
+            st->core == tskNO_AFFINITY ? mp_const_none : MP_OBJ_NEW_SMALL_INT(st->core),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(7, tuple));
+    }
+    m_del(thread_stats_t, stats, n_alloc);
+
+    mp_obj_t tuple[2] = {mp_obj_new_int_from_uint(total), list};
+    return mp_obj_new_tuple(2, tuple);
+}
+#endif
+
 void mp_thread_deinit(void) {
     for (;;) {
         // Find a task to delete
@@ -42,4 +42,14 @@ void mp_thread_init(void *stack, uint32_t stack_len);
 void mp_thread_gc_others(void);
 void mp_thread_deinit(void);
 
+// _thread.Queue hooks.  The spinlock also keeps out ISRs and WiFi callbacks
+// on the other core, and a consumer sleeps on its task notification.
+extern portMUX_TYPE mp_thread_queue_mux;
+void mp_thread_queue_wait(uint32_t ms);
+#define MP_THREAD_QUEUE_ENTER() (portENTER_CRITICAL(&mp_thread_queue_mux), 0)
+#define MP_THREAD_QUEUE_EXIT(state) ((void)(state), portEXIT_CRITICAL(&mp_thread_queue_mux))
+#define MP_THREAD_QUEUE_WAITER() ((void*)xTaskGetCurrentTaskHandle())
+#define MP_THREAD_QUEUE_WAIT(ms) mp_thread_queue_wait(ms)
+#define MP_THREAD_QUEUE_NOTIFY(waiter) vTaskNotifyGiveFromISR((TaskHandle_t)(waiter), NULL)
+
 #endif // MICROPY_INCLUDED_ESP32_MPTHREADPORT_H
@@ -30,9 +30,12 @@
 #include "py/mphal.h"
 #include "py/objtype.h"
 #include "py/stream.h"
+#include "py/mperrno.h"
 #include "netutils.h"
 #include "modmachine.h"
 
+#include "driver/uart.h"
+
 #include "netif/ppp/ppp.h"
 #include "netif/ppp/pppos.h"
 #include "lwip/err.h"
@@ -42,12 +45,18 @@
 #include "lwip/dns.h"
 #include "netif/ppp/pppapi.h"
 
+#define PPP_RXBUF_DEFAULT   (512)
+#define PPP_RXBUF_MIN       (64)
+
 typedef struct _ppp_if_obj_t {
     mp_obj_base_t base;
     bool active;
     bool connected;
     ppp_pcb *pcb;
     mp_obj_t stream;
+    int uart_num;               // if stream is a machine.UART, else -1
+    uint16_t rxbuf_len;
+    uint8_t *rxbuf;             // in the IDF heap, used by the client task
     SemaphoreHandle_t inactiveWaitSem;
     TaskHandle_t client_task_handle;
     struct netif pppif;
@@ -74,13 +83,33 @@ static void ppp_status_cb(ppp_pcb *pcb, int err_code, void *ctx) {
     }
 }
 
-STATIC mp_obj_t ppp_make_new(mp_obj_t stream) {
+// PPP(stream, *, rxbuf=512)
+// rxbuf is the most bytes handed to lwIP at a time.  A machine.UART stream is
+// read and written through the UART driver directly, which lets the client
+// task block on the driver's buffer instead of polling the stream.
+STATIC mp_obj_t ppp_make_new(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_stream, ARG_rxbuf };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_stream, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_rxbuf, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = PPP_RXBUF_DEFAULT} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t stream = args[ARG_stream].u_obj;
     mp_get_stream_raise(stream, MP_STREAM_OP_READ | MP_STREAM_OP_WRITE);
+    mp_int_t rxbuf_len = args[ARG_rxbuf].u_int;
+    if (rxbuf_len < PPP_RXBUF_MIN || rxbuf_len > 0xffff) {
+        mp_raise_ValueError("bad rxbuf");
+    }
 
     ppp_if_obj_t *self = m_new_obj_with_finaliser(ppp_if_obj_t);
 
     self->base.type = &ppp_if_type;
     self->stream = stream;
+    self->uart_num = machine_uart_get_port(stream);
+    self->rxbuf_len = rxbuf_len;
+    self->rxbuf = NULL;
     self->active = false;
     self->connected = false;
     self->inactiveWaitSem = xSemaphoreCreateBinary();
@@ -89,21 +118,31 @@ STATIC mp_obj_t ppp_make_new(mp_obj_t stream) {
     assert(self->inactiveWaitSem != NULL);
     return MP_OBJ_FROM_PTR(self);
 }
-MP_DEFINE_CONST_FUN_OBJ_1(ppp_make_new_obj, ppp_make_new);
+MP_DEFINE_CONST_FUN_OBJ_KW(ppp_make_new_obj, 1, ppp_make_new);
 
 static u32_t ppp_output_callback(ppp_pcb *pcb, u8_t *data, u32_t len, void *ctx) {
     ppp_if_obj_t *self = ctx;
+    if (self->uart_num >= 0) {
+        int n = uart_write_bytes(self->uart_num, (const char*)data, len);
+        return n < 0 ? 0 : n;
+    }
     int err;
     return mp_stream_rw(self->stream, data, len, &err, MP_STREAM_RW_WRITE);
 }
 
 static void pppos_client_task(void *self_in) {
     ppp_if_obj_t *self = (ppp_if_obj_t*)self_in;
-    uint8_t buf[256];
+    uint8_t *buf = self->rxbuf;
 
     while (ulTaskNotifyTake(pdTRUE, 0) == 0) {
-        int err;
-        int len = mp_stream_rw(self->stream, buf, sizeof(buf), &err, 0);
+        int len;
+        if (self->uart_num >= 0) {
+            // returns as soon as the buffer is full, else after a tick
+            len = uart_read_bytes(self->uart_num, buf, self->rxbuf_len, 1);
+        } else {
+            int err;
+            len = mp_stream_rw(self->stream, buf, self->rxbuf_len, &err, MP_STREAM_RW_ONCE);
+        }
         if (len > 0) {
             pppos_input_tcpip(self->pcb, (u8_t*)buf, len);
         }
@@ -120,9 +159,15 @@ STATIC mp_obj_t ppp_active(size_t n_args, const mp_obj_t *args) {
                 return mp_const_true;
             }
 
+            self->rxbuf = malloc(self->rxbuf_len);
+            if (self->rxbuf == NULL) {
+                mp_raise_OSError(MP_ENOMEM);
+            }
             self->pcb = pppapi_pppos_create(&self->pppif, ppp_output_callback, ppp_status_cb, self);
 
             if (self->pcb == NULL) {
+                free(self->rxbuf);
+                self->rxbuf = NULL;
                 mp_raise_msg(&mp_type_RuntimeError, "init failed");
             }
             pppapi_set_default(self->pcb);
@@ -149,6 +194,8 @@ STATIC mp_obj_t ppp_active(size_t n_args, const mp_obj_t *args) {
             // Release PPP
             pppapi_free(self->pcb);
             self->pcb = NULL;
+            free(self->rxbuf);
+            self->rxbuf = NULL;
             self->active = false;
             self->connected = false;
         }
@@ -0,0 +1,479 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/gpio.h"
+#include "driver/sigmadelta.h"
+#include "driver/timer.h"
+#include "esp_intr_alloc.h"
+#include "rom/gpio.h"
+#include "soc/gpio_sd_struct.h"
+#include "soc/gpio_sig_map.h"
+#include "soc/timer_group_struct.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/stream.h"
+#include "py/mphal.h"
+#include "modmachine.h"
+#include "modstuduinobit.h"
+
+// Sample playback on a pin through the sigma-delta modulator.  The samples
+// are kept in two halves of a small buffer: a hardware timer interrupt
+// writes one sample per tick into the modulator's duty register and, when
+// it moves on from a half, schedules a refill of that half.  The refill
+// runs in the VM between bytecodes, reading the next block from the source
+// buffer or stream and decoding it, so Python never touches single samples
+// and the ISR does nothing more than a load and a store.
+//
+// The sigma-delta peripheral is used rather than LEDC so the timers that
+// machine.PWM and studuinobit.melody share are left alone.  If a refill is
+// late the ISR holds the last level and counts an underrun.
+
+#define SB_AUDIO_HALF_LEN       (512)
+#define SB_AUDIO_NO_END         (0xffffffff)
+#define SB_AUDIO_SD_CHANNEL     (SIGMADELTA_CHANNEL_7)
+// 80MHz / (prescale + 1): slow enough for the buzzer's driver transistor,
+// far above anything audible
+#define SB_AUDIO_SD_PRESCALE    (31)
+#define SB_AUDIO_TIMER_GROUP    ((SB_AUDIO_TIMER_NUM >> 1) & 1)
+#define SB_AUDIO_TIMER_INDEX    (SB_AUDIO_TIMER_NUM & 1)
+#define SB_AUDIO_TIMER_DIVIDER  (2)
+#define SB_AUDIO_MIN_RATE       (1000)
+#define SB_AUDIO_MAX_RATE       (32000)
+
+enum {
+    SB_AUDIO_PCM8,
+    SB_AUDIO_ADPCM,
+};
+
+typedef struct _sb_audio_t {
+    intr_handle_t handle;
+    int gpio;
+    uint8_t format;
+    bool loop;
+    bool eof;
+    // position of the source, and where a loop goes back to
+    size_t src_pos;
+    size_t src_start;
+    // IMA ADPCM decoder state
+    int32_t predictor;
+    int8_t index;
+    // read by the ISR, which owns pos
+    volatile uint32_t pos;
+    volatile uint32_t end;
+    volatile bool ready[2];
+    volatile bool refill_pending;
+    volatile bool playing;
+    volatile uint32_t underruns;
+    uint8_t buf[2][SB_AUDIO_HALF_LEN];
+    uint8_t raw[SB_AUDIO_HALF_LEN / 2];
+} sb_audio_t;
+
+STATIC sb_audio_t sb_audio = { .gpio = -1 };
+
+STATIC const int8_t sb_audio_ima_index[8] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+STATIC const uint16_t sb_audio_ima_step[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+    45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190,
+    209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724,
+    796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272,
+    2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132,
+    7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500,
+    20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+MP_DECLARE_CONST_FUN_OBJ_1(sb_audio_refill_obj);
+
+STATIC void sb_audio_timer_stop_from_isr(timg_dev_t *device) {
+    device->hw_timer[SB_AUDIO_TIMER_INDEX].config.enable = 0;
+    sb_audio.playing = false;
+}
+
+STATIC void sb_audio_request_refill_from_isr(void) {
+    if (!sb_audio.refill_pending) {
+        sb_audio.refill_pending = true;
+        if (mp_sched_schedule_prio(MP_OBJ_FROM_PTR(&sb_audio_refill_obj), mp_const_none, MP_SCHED_PRIO_HIGH)) {
+            mp_hal_wake_main_task_from_isr();
+        } else {
+            // scheduler queue is full, try again on the next tick
+            sb_audio.refill_pending = false;
+        }
+    }
+}
+
+STATIC void sb_audio_isr(void *arg) {
+    (void)arg;
+    sb_audio_t *a = &sb_audio;
+    timg_dev_t *device = SB_AUDIO_TIMER_GROUP ? &(TIMERG1) : &(TIMERG0);
+
+    if (SB_AUDIO_TIMER_INDEX) {
+        device->int_clr_timers.t1 = 1;
+    } else {
+        device->int_clr_timers.t0 = 1;
+    }
+    device->hw_timer[SB_AUDIO_TIMER_INDEX].config.alarm_en = 1;
+
+    uint32_t pos = a->pos;
+    if (pos == a->end) {
+        SIGMADELTA.channel[SB_AUDIO_SD_CHANNEL].duty = -128;
+        sb_audio_timer_stop_from_isr(device);
+        return;
+    }
+    uint32_t half = pos / SB_AUDIO_HALF_LEN;
+    if (!a->ready[half]) {
+        a->underruns++;
+        sb_audio_request_refill_from_isr();
+        return;
+    }
+    SIGMADELTA.channel[SB_AUDIO_SD_CHANNEL].duty = (int8_t)(a->buf[half][pos % SB_AUDIO_HALF_LEN] - 128);
+    if (++pos % SB_AUDIO_HALF_LEN == 0) {
+        // this half is played out, have the VM fill it again
+        a->ready[half] = false;
+        if (pos == 2 * SB_AUDIO_HALF_LEN) {
+            pos = 0;
+        }
+        sb_audio_request_refill_from_isr();
+    }
+    a->pos = pos;
+}
+
+STATIC void sb_audio_seek(size_t offset) {
+    mp_obj_t stream = MP_STATE_PORT(studuinobit_audio_src);
+    const mp_stream_p_t *proto = mp_get_stream_raise(stream, MP_STREAM_OP_IOCTL);
+    struct mp_stream_seek_t seek_s = { .offset = offset, .whence = MP_SEEK_SET };
+    int errcode;
+    if (proto->ioctl(stream, MP_STREAM_SEEK, (uintptr_t)&seek_s, &errcode) == MP_STREAM_ERROR) {
+        mp_raise_OSError(errcode);
+    }
+}
+
+// Read up to len bytes of the source into dest, going back to the start for
+// a loop.  Returns less than len only at the end of the source.
+STATIC size_t sb_audio_read(uint8_t *dest, size_t len) {
+    sb_audio_t *a = &sb_audio;
+    mp_obj_t src = MP_STATE_PORT(studuinobit_audio_src);
+    size_t got = 0;
+    bool rewound = false;
+    while (got < len && !a->eof) {
+        size_t n;
+        mp_buffer_info_t bufinfo;
+        if (mp_get_buffer(src, &bufinfo, MP_BUFFER_READ)) {
+            // fetched each time as a bytearray may have moved
+            n = a->src_pos < bufinfo.len ? MIN(len - got, bufinfo.len - a->src_pos) : 0;
+            memcpy(dest + got, (const uint8_t *)bufinfo.buf + a->src_pos, n);
+        } else {
+            int errcode;
+            n = mp_stream_rw(src, dest + got, len - got, &errcode, MP_STREAM_RW_READ);
+            if (errcode != 0) {
+                mp_raise_OSError(errcode);
+            }
+        }
+        a->src_pos += n;
+        got += n;
+        if (got < len) {
+            if (!a->loop || (rewound && n == 0)) {
+                // a source that's empty from the start can't loop
+                a->eof = true;
+            } else {
+                if (!mp_get_buffer(src, &bufinfo, MP_BUFFER_READ)) {
+                    sb_audio_seek(a->src_start);
+                }
+                a->src_pos = a->src_start;
+                a->predictor = 0;
+                a->index = 0;
+                rewound = true;
+            }
+        }
+    }
+    return got;
+}
+
+STATIC uint8_t sb_audio_adpcm_decode(uint8_t nibble) {
+    sb_audio_t *a = &sb_audio;
+    int32_t step = sb_audio_ima_step[a->index];
+    int32_t diff = step >> 3;
+    if (nibble & 4) {
+        diff += step;
+    }
+    if (nibble & 2) {
+        diff += step >> 1;
+    }
+    if (nibble & 1) {
+        diff += step >> 2;
+    }
+    a->predictor += (nibble & 8) ? -diff : diff;
+    if (a->predictor > 32767) {
+        a->predictor = 32767;
+    } else if (a->predictor < -32768) {
+        a->predictor = -32768;
+    }
+    a->index += sb_audio_ima_index[nibble & 7];
+    if (a->index < 0) {
+        a->index = 0;
+    } else if (a->index > 88) {
+        a->index = 88;
+    }
+    return (a->predictor >> 8) + 128;
+}
+
+// Decode the next block of the source into half h and hand it to the ISR
+STATIC void sb_audio_fill(uint32_t h) {
+    sb_audio_t *a = &sb_audio;
+    uint8_t *dest = a->buf[h];
+    size_t n;
+    if (a->format == SB_AUDIO_PCM8) {
+        n = sb_audio_read(dest, SB_AUDIO_HALF_LEN);
+    } else {
+        // two samples per byte, low nibble first
+        size_t raw_len = sb_audio_read(a->raw, sizeof(a->raw));
+        for (size_t i = 0; i < raw_len; ++i) {
+            dest[2 * i] = sb_audio_adpcm_decode(a->raw[i] & 0x0f);
+            dest[2 * i + 1] = sb_audio_adpcm_decode(a->raw[i] >> 4);
+        }
+        n = 2 * raw_len;
+    }
+    if (n < SB_AUDIO_HALF_LEN) {
+        a->end = (h * SB_AUDIO_HALF_LEN + n) % (2 * SB_AUDIO_HALF_LEN);
+    }
+    a->ready[h] = true;
+}
+
+STATIC void sb_audio_fill_pending(void) {
+    sb_audio_t *a = &sb_audio;
+    // the half being played first, in case the ISR is waiting on it
+    uint32_t cur = a->pos / SB_AUDIO_HALF_LEN;
+    for (uint32_t i = 0; i < 2; ++i) {
+        uint32_t h = (cur + i) & 1;
+        if (a->ready[h]) {
+            continue;
+        }
+        if (!a->eof) {
+            sb_audio_fill(h);
+        } else if (a->end == SB_AUDIO_NO_END) {
+            // the source gave out on a half boundary
+            a->end = h * SB_AUDIO_HALF_LEN;
+        }
+    }
+}
+
+// Called by the scheduler after the ISR has played out a half
+STATIC mp_obj_t sb_audio_refill(mp_obj_t arg) {
+    (void)arg;
+    sb_audio.refill_pending = false;
+    if (!sb_audio.playing) {
+        return mp_const_none;
+    }
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        sb_audio_fill_pending();
+        nlr_pop();
+    } else {
+        // a failed read ends the sample where the buffered part runs out
+        sb_audio.eof = true;
+        sb_audio_fill_pending();
+        mp_obj_print_exception(&mp_plat_print, MP_OBJ_FROM_PTR(nlr.ret_val));
+    }
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_1(sb_audio_refill_obj, sb_audio_refill);
+
+STATIC void sb_audio_stop_internal(void) {
+    sb_audio_t *a = &sb_audio;
+    if (a->handle != NULL) {
+        timer_pause(SB_AUDIO_TIMER_GROUP, SB_AUDIO_TIMER_INDEX);
+        timer_disable_intr(SB_AUDIO_TIMER_GROUP, SB_AUDIO_TIMER_INDEX);
+        esp_intr_free(a->handle);
+        a->handle = NULL;
+    }
+    a->playing = false;
+    if (a->gpio >= 0) {
+        // leave the pin a plain output, driven low
+        gpio_matrix_out(a->gpio, SIG_GPIO_OUT_IDX, false, false);
+        gpio_set_direction(a->gpio, GPIO_MODE_OUTPUT);
+        gpio_set_level(a->gpio, 0);
+        a->gpio = -1;
+    }
+    MP_STATE_PORT(studuinobit_audio_src) = MP_OBJ_NULL;
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+// play(pin, source, *, rate=8000, format=PCM8, loop=False)
+//
+// source is a bytes-like object or a stream opened in binary mode, holding
+// unsigned 8-bit samples (PCM8) or headerless IMA ADPCM (ADPCM).  A stream
+// is read from its current position, which is also where a loop restarts.
+STATIC mp_obj_t sb_audio_play(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_pin, ARG_source, ARG_rate, ARG_format, ARG_loop };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_pin, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_source, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_rate, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 8000} },
+        { MP_QSTR_format, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = SB_AUDIO_PCM8} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int gpio = machine_pin_get_gpio(args[ARG_pin].u_obj);
+    if (!GPIO_IS_VALID_OUTPUT_GPIO(gpio)) {
+        mp_raise_ValueError("pin can't output");
+    }
+    mp_int_t rate = args[ARG_rate].u_int;
+    if (rate < SB_AUDIO_MIN_RATE || rate > SB_AUDIO_MAX_RATE) {
+        mp_raise_ValueError("rate must be 1000-32000");
+    }
+    mp_int_t format = args[ARG_format].u_int;
+    if (format != SB_AUDIO_PCM8 && format != SB_AUDIO_ADPCM) {
+        mp_raise_ValueError("bad format");
+    }
+    mp_obj_t source = args[ARG_source].u_obj;
+    mp_buffer_info_t bufinfo;
+    if (!mp_get_buffer(source, &bufinfo, MP_BUFFER_READ)) {
+        mp_get_stream_raise(source, MP_STREAM_OP_READ);
+    }
+
+    sb_audio_t *a = &sb_audio;
+    sb_audio_stop_internal();
+    MP_STATE_PORT(studuinobit_audio_src) = source;
+    a->format = format;
+    a->loop = args[ARG_loop].u_bool;
+    a->eof = false;
+    a->src_pos = 0;
+    a->src_start = 0;
+    a->predictor = 0;
+    a->index = 0;
+    a->pos = 0;
+    a->end = SB_AUDIO_NO_END;
+    a->ready[0] = false;
+    a->ready[1] = false;
+    a->refill_pending = false;
+    a->underruns = 0;
+
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        if (a->loop && !mp_get_buffer(source, &bufinfo, MP_BUFFER_READ)) {
+            // remember where to loop back to, which also checks it can seek
+            const mp_stream_p_t *proto = mp_get_stream_raise(source, MP_STREAM_OP_IOCTL);
+            struct mp_stream_seek_t seek_s = { .offset = 0, .whence = MP_SEEK_CUR };
+            int errcode;
+            if (proto->ioctl(source, MP_STREAM_SEEK, (uintptr_t)&seek_s, &errcode) == MP_STREAM_ERROR) {
+                mp_raise_OSError(errcode);
+            }
+            a->src_start = seek_s.offset;
+            a->src_pos = seek_s.offset;
+        }
+        // both halves are filled before the timer starts
+        sb_audio_fill_pending();
+        nlr_pop();
+    } else {
+        MP_STATE_PORT(studuinobit_audio_src) = MP_OBJ_NULL;
+        nlr_jump(nlr.ret_val);
+    }
+    if (a->end == 0) {
+        // nothing to play
+        MP_STATE_PORT(studuinobit_audio_src) = MP_OBJ_NULL;
+        return mp_const_none;
+    }
+
+    sigmadelta_config_t sd_config = {
+        .channel = SB_AUDIO_SD_CHANNEL,
+        .sigmadelta_duty = 0,
+        .sigmadelta_prescale = SB_AUDIO_SD_PRESCALE,
+        .sigmadelta_gpio = gpio,
+    };
+    if (sigmadelta_config(&sd_config) != ESP_OK) {
+        MP_STATE_PORT(studuinobit_audio_src) = MP_OBJ_NULL;
+        mp_raise_OSError(MP_EIO);
+    }
+    a->gpio = gpio;
+
+    timer_config_t config;
+    config.alarm_en = TIMER_ALARM_EN;
+    config.auto_reload = TIMER_AUTORELOAD_EN;
+    config.counter_dir = TIMER_COUNT_UP;
+    config.divider = SB_AUDIO_TIMER_DIVIDER;
+    config.intr_type = TIMER_INTR_LEVEL;
+    config.counter_en = TIMER_PAUSE;
+    a->playing = true;
+    if (timer_init(SB_AUDIO_TIMER_GROUP, SB_AUDIO_TIMER_INDEX, &config) != ESP_OK
+        || timer_set_counter_value(SB_AUDIO_TIMER_GROUP, SB_AUDIO_TIMER_INDEX, 0) != ESP_OK
+        || timer_set_alarm_value(SB_AUDIO_TIMER_GROUP, SB_AUDIO_TIMER_INDEX,
+            TIMER_BASE_CLK / SB_AUDIO_TIMER_DIVIDER / rate) != ESP_OK
+        || timer_enable_intr(SB_AUDIO_TIMER_GROUP, SB_AUDIO_TIMER_INDEX) != ESP_OK
+        || timer_isr_register(SB_AUDIO_TIMER_GROUP, SB_AUDIO_TIMER_INDEX, sb_audio_isr, NULL,
+            ESP_INTR_FLAG_LEVEL1, &a->handle) != ESP_OK) {
+        sb_audio_stop_internal();
+        mp_raise_OSError(MP_EBUSY);
+    }
+    timer_start(SB_AUDIO_TIMER_GROUP, SB_AUDIO_TIMER_INDEX);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sb_audio_play_obj, 2, sb_audio_play);
+
+STATIC mp_obj_t sb_audio_stop(void) {
+    sb_audio_stop_internal();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_audio_stop_obj, sb_audio_stop);
+
+STATIC mp_obj_t sb_audio_playing(void) {
+    return mp_obj_new_bool(sb_audio.playing);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_audio_playing_obj, sb_audio_playing);
+
+// underruns(): how many samples were held because a refill was late
+STATIC mp_obj_t sb_audio_underruns(void) {
+    return mp_obj_new_int_from_uint(sb_audio.underruns);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_audio_underruns_obj, sb_audio_underruns);
+
+void studuinobit_audio_deinit(void) {
+    sb_audio_stop_internal();
+}
+
+STATIC const mp_rom_map_elem_t sb_audio_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_audio) },
+    { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&sb_audio_play_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&sb_audio_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_playing), MP_ROM_PTR(&sb_audio_playing_obj) },
+    { MP_ROM_QSTR(MP_QSTR_underruns), MP_ROM_PTR(&sb_audio_underruns_obj) },
+    { MP_ROM_QSTR(MP_QSTR_PCM8), MP_ROM_INT(SB_AUDIO_PCM8) },
+    { MP_ROM_QSTR(MP_QSTR_ADPCM), MP_ROM_INT(SB_AUDIO_ADPCM) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_audio_module_globals, sb_audio_module_globals_table);
+
+const mp_obj_module_t studuinobit_audio_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&sb_audio_module_globals,
+};
@@ -0,0 +1,297 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "driver/gpio.h"
+#include "esp_timer.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "modstuduinobit.h"
+
+// Buttons A and B, handled without the MicroPython scheduler so presses
+// are never lost while Python is busy.  An edge interrupt masks the pin and
+// arms a one-shot esp_timer; when it fires the settled level is read and
+// the pin unmasked again, so contact bounce costs a single interrupt.  A
+// second timer reports long presses while the button is still held.  The
+// esp_timer task is the only writer of the state below; Python reads it
+// with atomic operations and drains a per-button event ring.
+
+#define SB_BUTTON_DEBOUNCE_US       (20000)
+#define SB_BUTTON_LONG_PRESS_US     (1000000)
+#define SB_BUTTON_DOUBLE_CLICK_US   (400000)
+#define SB_BUTTON_EVENT_RING_LEN    (16)
+
+typedef enum {
+    SB_BUTTON_EVENT_DOWN,
+    SB_BUTTON_EVENT_UP,
+    SB_BUTTON_EVENT_CLICK,
+    SB_BUTTON_EVENT_DOUBLE_CLICK,
+    SB_BUTTON_EVENT_LONG_PRESS,
+    SB_BUTTON_EVENT_NUM,
+} sb_button_event_t;
+
+STATIC const qstr sb_button_event_name[SB_BUTTON_EVENT_NUM] = {
+    [SB_BUTTON_EVENT_DOWN] = MP_QSTR_down,
+    [SB_BUTTON_EVENT_UP] = MP_QSTR_up,
+    [SB_BUTTON_EVENT_CLICK] = MP_QSTR_click,
+    [SB_BUTTON_EVENT_DOUBLE_CLICK] = MP_QSTR_double_click,
+    [SB_BUTTON_EVENT_LONG_PRESS] = MP_QSTR_long_press,
+};
+
+typedef struct _sb_button_state_t {
+    esp_timer_handle_t debounce_timer;
+    esp_timer_handle_t long_timer;
+    bool pressed;
+    bool long_pressed;
+    uint32_t press_us;
+    uint32_t last_click_us;
+    bool clicked;
+    volatile uint32_t presses;
+    volatile bool was_pressed;
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    uint8_t events[SB_BUTTON_EVENT_RING_LEN];
+} sb_button_state_t;
+
+typedef struct _sb_button_obj_t {
+    mp_obj_base_t base;
+    char name;
+    gpio_num_t pin;
+    sb_button_state_t *state;
+} sb_button_obj_t;
+
+STATIC sb_button_state_t sb_button_state[2];
+STATIC bool sb_button_initialised;
+
+STATIC const sb_button_obj_t sb_button_obj[2] = {
+    {{&studuinobit_button_type}, 'A', GPIO_NUM_15, &sb_button_state[0]},
+    {{&studuinobit_button_type}, 'B', GPIO_NUM_27, &sb_button_state[1]},
+};
+
+STATIC void sb_button_push(sb_button_state_t *s, sb_button_event_t ev) {
+    uint32_t head = s->head;
+    if (head - s->tail < SB_BUTTON_EVENT_RING_LEN) {
+        s->events[head % SB_BUTTON_EVENT_RING_LEN] = ev;
+        __atomic_store_n(&s->head, head + 1, __ATOMIC_RELEASE);
+    }
+}
+
+STATIC void sb_button_isr(void *arg) {
+    const sb_button_obj_t *self = arg;
+    gpio_intr_disable(self->pin);
+    esp_timer_start_once(self->state->debounce_timer, SB_BUTTON_DEBOUNCE_US);
+}
+
+// Runs in the esp_timer task once the level has had time to settle
+STATIC void sb_button_debounce_cb(void *arg) {
+    const sb_button_obj_t *self = arg;
+    sb_button_state_t *s = self->state;
+    bool pressed = gpio_get_level(self->pin) == 0;
+    gpio_intr_enable(self->pin);
+    if (pressed == s->pressed) {
+        return;
+    }
+    s->pressed = pressed;
+    uint32_t now = esp_timer_get_time();
+    if (pressed) {
+        s->press_us = now;
+        s->long_pressed = false;
+        __atomic_add_fetch(&s->presses, 1, __ATOMIC_RELAXED);
+        s->was_pressed = true;
+        sb_button_push(s, SB_BUTTON_EVENT_DOWN);
+        esp_timer_start_once(s->long_timer, SB_BUTTON_LONG_PRESS_US);
+    } else {
+        esp_timer_stop(s->long_timer);
+        sb_button_push(s, SB_BUTTON_EVENT_UP);
+        if (!s->long_pressed) {
+            if (s->clicked && now - s->last_click_us < SB_BUTTON_DOUBLE_CLICK_US) {
+                s->clicked = false;
+                sb_button_push(s, SB_BUTTON_EVENT_DOUBLE_CLICK);
+            } else {
+                s->clicked = true;
+                s->last_click_us = now;
+                sb_button_push(s, SB_BUTTON_EVENT_CLICK);
+            }
+        }
+    }
+}
+
+STATIC void sb_button_long_cb(void *arg) {
+    const sb_button_obj_t *self = arg;
+    sb_button_state_t *s = self->state;
+    if (s->pressed) {
+        s->long_pressed = true;
+        s->clicked = false;
+        sb_button_push(s, SB_BUTTON_EVENT_LONG_PRESS);
+    }
+}
+
+STATIC void sb_button_init(void) {
+    if (sb_button_initialised) {
+        return;
+    }
+    for (int i = 0; i < MP_ARRAY_SIZE(sb_button_obj); ++i) {
+        const sb_button_obj_t *self = &sb_button_obj[i];
+        sb_button_state_t *s = self->state;
+        if (s->debounce_timer == NULL) {
+            esp_timer_create_args_t args = {
+                .callback = sb_button_debounce_cb,
+                .arg = (void*)self,
+                .dispatch_method = ESP_TIMER_TASK,
+                .name = "sb_button",
+            };
+            if (esp_timer_create(&args, &s->debounce_timer) != ESP_OK) {
+                mp_raise_OSError(MP_ENOMEM);
+            }
+            args.callback = sb_button_long_cb;
+            if (esp_timer_create(&args, &s->long_timer) != ESP_OK) {
+                mp_raise_OSError(MP_ENOMEM);
+            }
+        }
+        s->pressed = false;
+        s->clicked = false;
+        s->presses = 0;
+        s->was_pressed = false;
+        s->head = s->tail = 0;
+        gpio_pad_select_gpio(self->pin);
+        gpio_set_direction(self->pin, GPIO_MODE_INPUT);
+        gpio_set_intr_type(self->pin, GPIO_INTR_ANYEDGE);
+        gpio_isr_handler_add(self->pin, sb_button_isr, (void*)self);
+        gpio_intr_enable(self->pin);
+        // pick up a button that is already held down
+        esp_timer_start_once(s->debounce_timer, SB_BUTTON_DEBOUNCE_US);
+    }
+    sb_button_initialised = true;
+}
+
+void studuinobit_button_deinit(void) {
+    if (!sb_button_initialised) {
+        return;
+    }
+    for (int i = 0; i < MP_ARRAY_SIZE(sb_button_obj); ++i) {
+        const sb_button_obj_t *self = &sb_button_obj[i];
+        gpio_intr_disable(self->pin);
+        gpio_isr_handler_remove(self->pin);
+        esp_timer_stop(self->state->debounce_timer);
+        esp_timer_stop(self->state->long_timer);
+    }
+    sb_button_initialised = false;
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC const sb_button_obj_t *sb_button_get(mp_obj_t self_in) {
+    sb_button_init();
+    return MP_OBJ_TO_PTR(self_in);
+}
+
+STATIC void sb_button_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    const sb_button_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "Button('%c')", self->name);
+}
+
+// value(): the debounced level, 0 while pressed as for the raw pin
+STATIC mp_obj_t sb_button_value(mp_obj_t self_in) {
+    const sb_button_obj_t *self = sb_button_get(self_in);
+    return MP_OBJ_NEW_SMALL_INT(!self->state->pressed);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_button_value_obj, sb_button_value);
+
+STATIC mp_obj_t sb_button_is_pressed(mp_obj_t self_in) {
+    const sb_button_obj_t *self = sb_button_get(self_in);
+    return mp_obj_new_bool(self->state->pressed);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_button_is_pressed_obj, sb_button_is_pressed);
+
+STATIC mp_obj_t sb_button_was_pressed(mp_obj_t self_in) {
+    const sb_button_obj_t *self = sb_button_get(self_in);
+    return mp_obj_new_bool(__atomic_exchange_n(&self->state->was_pressed, false, __ATOMIC_RELAXED));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_button_was_pressed_obj, sb_button_was_pressed);
+
+// get_presses(): presses since the last call
+STATIC mp_obj_t sb_button_get_presses(mp_obj_t self_in) {
+    const sb_button_obj_t *self = sb_button_get(self_in);
+    return mp_obj_new_int_from_uint(__atomic_exchange_n(&self->state->presses, 0, __ATOMIC_RELAXED));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_button_get_presses_obj, sb_button_get_presses);
+
+// get_event(): the oldest queued event name, or None
+STATIC mp_obj_t sb_button_get_event(mp_obj_t self_in) {
+    sb_button_state_t *s = sb_button_get(self_in)->state;
+    uint32_t tail = s->tail;
+    if (__atomic_load_n(&s->head, __ATOMIC_ACQUIRE) == tail) {
+        return mp_const_none;
+    }
+    qstr name = sb_button_event_name[s->events[tail % SB_BUTTON_EVENT_RING_LEN]];
+    __atomic_store_n(&s->tail, tail + 1, __ATOMIC_RELEASE);
+    return MP_OBJ_NEW_QSTR(name);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_button_get_event_obj, sb_button_get_event);
+
+// get_events(): tuple of all queued event names, oldest first
+STATIC mp_obj_t sb_button_get_events(mp_obj_t self_in) {
+    sb_button_state_t *s = sb_button_get(self_in)->state;
+    uint32_t tail = s->tail;
+    uint32_t n = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE) - tail;
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(n, NULL));
+    for (uint32_t i = 0; i < n; ++i) {
+        t->items[i] = MP_OBJ_NEW_QSTR(sb_button_event_name[s->events[(tail + i) % SB_BUTTON_EVENT_RING_LEN]]);
+    }
+    __atomic_store_n(&s->tail, tail + n, __ATOMIC_RELEASE);
+    return MP_OBJ_FROM_PTR(t);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_button_get_events_obj, sb_button_get_events);
+
+STATIC const mp_rom_map_elem_t sb_button_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_value), MP_ROM_PTR(&sb_button_value_obj) },
+    { MP_ROM_QSTR(MP_QSTR_is_pressed), MP_ROM_PTR(&sb_button_is_pressed_obj) },
+    { MP_ROM_QSTR(MP_QSTR_was_pressed), MP_ROM_PTR(&sb_button_was_pressed_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_presses), MP_ROM_PTR(&sb_button_get_presses_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_event), MP_ROM_PTR(&sb_button_get_event_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_events), MP_ROM_PTR(&sb_button_get_events_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_button_locals_dict, sb_button_locals_dict_table);
+
+const mp_obj_type_t studuinobit_button_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Button,
+    .print = sb_button_print,
+    .locals_dict = (mp_obj_dict_t*)&sb_button_locals_dict,
+};
+
+STATIC const mp_rom_map_elem_t sb_button_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_button) },
+    { MP_ROM_QSTR(MP_QSTR_button_a), MP_ROM_PTR(&sb_button_obj[0]) },
+    { MP_ROM_QSTR(MP_QSTR_button_b), MP_ROM_PTR(&sb_button_obj[1]) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_button_module_globals, sb_button_module_globals_table);
+
+const mp_obj_module_t studuinobit_button_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&sb_button_module_globals,
+};
@@ -0,0 +1,639 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "py/unicode.h"
+#include "modesp.h"
+#include "modstuduinobit.h"
+
+// The 5x5 matrix is a chain of 25 WS2812 LEDs.  The framebuffer is kept in
+// wire order (GRB) with board-scaled values so a frame can be pushed to the
+// LEDs without any further processing.
+
+// WS2812 needs the data line low for >50us before a new frame is latched
+#define SB_DISPLAY_RESET_US     (60)
+
+// Default colour of scrolled text, the same as an Image's base colour
+#define SB_DISPLAY_TEXT_COLOR   (0x1f0000)
+
+// Colour components below this value are sent to the LEDs unchanged
+#define SB_DISPLAY_FACTOR_KNEE  (31)
+
+typedef struct _sb_display_t {
+    bool initialised;
+    bool on;
+    bool dirty;
+    uint32_t last_write_us;
+    // linear map of user factors above the knee: board = a * user + b
+    float a;
+    float b;
+    uint8_t lut[256];
+    uint8_t grb[SB_DISPLAY_NUM_PIXELS * 3];
+} sb_display_t;
+
+STATIC sb_display_t sb_display;
+
+STATIC void sb_display_set_max_factor(mp_int_t max_factor) {
+    if (max_factor < SB_DISPLAY_FACTOR_KNEE) {
+        max_factor = SB_DISPLAY_FACTOR_KNEE;
+    }
+    sb_display.a = (float)(max_factor - SB_DISPLAY_FACTOR_KNEE) / (255 - SB_DISPLAY_FACTOR_KNEE);
+    sb_display.b = SB_DISPLAY_FACTOR_KNEE - sb_display.a * SB_DISPLAY_FACTOR_KNEE;
+    for (int i = 0; i < 256; ++i) {
+        sb_display.lut[i] = i <= SB_DISPLAY_FACTOR_KNEE ? i : (uint8_t)(sb_display.a * i + sb_display.b);
+    }
+}
+
+STATIC uint8_t sb_display_user_factor(uint8_t bf) {
+    if (sb_display.a == 0 || bf <= SB_DISPLAY_FACTOR_KNEE) {
+        return bf;
+    }
+    return (uint8_t)((bf - sb_display.b) / sb_display.a);
+}
+
+// Position of pixel (x, y) in the LED chain
+static inline size_t sb_display_index(int x, int y) {
+    return ((SB_DISPLAY_WIDTH - 1 - x) * SB_DISPLAY_HEIGHT + y) * 3;
+}
+
+static inline void sb_display_put(size_t idx, const uint8_t rgb[3]) {
+    uint8_t *p = &sb_display.grb[idx];
+    uint8_t g = sb_display.lut[rgb[1]];
+    uint8_t r = sb_display.lut[rgb[0]];
+    uint8_t b = sb_display.lut[rgb[2]];
+    if (p[0] != g || p[1] != r || p[2] != b) {
+        p[0] = g;
+        p[1] = r;
+        p[2] = b;
+        sb_display.dirty = true;
+    }
+}
+
+STATIC void sb_display_flush(bool force) {
+    if (!sb_display.on || !(sb_display.dirty || force)) {
+        return;
+    }
+    // honour the latch time if the previous frame was sent very recently
+    uint32_t elapsed = mp_hal_ticks_us() - sb_display.last_write_us;
+    if (elapsed < SB_DISPLAY_RESET_US) {
+        mp_hal_delay_us_fast(SB_DISPLAY_RESET_US - elapsed);
+    }
+    esp_neopixel_write(SB_DISPLAY_DATA_PIN, sb_display.grb, sizeof(sb_display.grb), 1);
+    sb_display.last_write_us = mp_hal_ticks_us();
+    sb_display.dirty = false;
+}
+
+STATIC void sb_display_init_internal(void) {
+    if (sb_display.initialised) {
+        return;
+    }
+    mp_hal_pin_output(SB_DISPLAY_POWER_PIN);
+    mp_hal_pin_output(SB_DISPLAY_DATA_PIN);
+    mp_hal_pin_write(SB_DISPLAY_DATA_PIN, 0);
+    sb_display_set_max_factor(0);
+    memset(sb_display.grb, 0, sizeof(sb_display.grb));
+    sb_display.last_write_us = mp_hal_ticks_us();
+    sb_display.on = true;
+    sb_display.initialised = true;
+    mp_hal_pin_write(SB_DISPLAY_POWER_PIN, 1);
+    sb_display_flush(true);
+}
+
+// Copy a row-major RGB frame into the framebuffer.  If color is not NULL it
+// replaces the colour of every pixel that is lit.
+STATIC void sb_display_render_rgb(const uint8_t *src, const uint8_t *color) {
+    for (int y = 0; y < SB_DISPLAY_HEIGHT; ++y) {
+        for (int x = 0; x < SB_DISPLAY_WIDTH; ++x, src += 3) {
+            if (color != NULL && (src[0] | src[1] | src[2])) {
+                sb_display_put(sb_display_index(x, y), color);
+            } else {
+                sb_display_put(sb_display_index(x, y), src);
+            }
+        }
+    }
+}
+
+// Draw the WIDTH font columns starting at column col of a line of text,
+// given as glyph indices into studuinobit_font
+STATIC void sb_display_render_text(const uint8_t *glyphs, size_t col, const uint8_t *color) {
+    static const uint8_t black[3] = {0, 0, 0};
+    for (int x = 0; x < SB_DISPLAY_WIDTH; ++x, ++col) {
+        uint8_t bits = studuinobit_font[glyphs[col / SB_FONT_WIDTH]][col % SB_FONT_WIDTH];
+        for (int y = 0; y < SB_DISPLAY_HEIGHT; ++y) {
+            sb_display_put(sb_display_index(x, y), (bits >> y) & 1 ? color : black);
+        }
+    }
+}
+
+STATIC void sb_display_check_xy(mp_obj_t x_in, mp_obj_t y_in, int *x, int *y) {
+    *x = mp_obj_get_int(x_in);
+    *y = mp_obj_get_int(y_in);
+    if (*x < 0 || *y < 0 || *x >= SB_DISPLAY_WIDTH || *y >= SB_DISPLAY_HEIGHT) {
+        mp_raise_ValueError("index out of bounds");
+    }
+}
+
+void studuinobit_get_color(mp_obj_t color_in, uint8_t rgb[3]) {
+    if (MP_OBJ_IS_TYPE(color_in, &mp_type_tuple) || MP_OBJ_IS_TYPE(color_in, &mp_type_list)) {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(color_in, 3, &items);
+        for (int i = 0; i < 3; ++i) {
+            mp_int_t c = mp_obj_get_int(items[i]);
+            if (c < 0 || c > SB_COLOR_FACTOR_MAX) {
+                mp_raise_ValueError("color factor must be 0-255");
+            }
+            rgb[i] = c;
+        }
+    } else if (MP_OBJ_IS_INT(color_in)) {
+        mp_int_t c = mp_obj_get_int(color_in);
+        if (c < 0 || c > 0xffffff) {
+            mp_raise_ValueError("color factor must be 0-0xffffff");
+        }
+        rgb[0] = c >> 16;
+        rgb[1] = c >> 8;
+        rgb[2] = c;
+    } else {
+        mp_raise_TypeError("color takes a (R,G,B) or [R,G,B] or #RGB");
+    }
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC mp_obj_t sb_display_init(void) {
+    sb_display_init_internal();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_display_init_obj, sb_display_init);
+
+STATIC mp_obj_t sb_display_set_pixel(mp_obj_t x_in, mp_obj_t y_in, mp_obj_t color_in) {
+    int x, y;
+    uint8_t rgb[3];
+    sb_display_init_internal();
+    sb_display_check_xy(x_in, y_in, &x, &y);
+    studuinobit_get_color(color_in, rgb);
+    sb_display_put(sb_display_index(x, y), rgb);
+    sb_display_flush(false);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(sb_display_set_pixel_obj, sb_display_set_pixel);
+
+STATIC mp_obj_t sb_display_get_pixel(mp_obj_t x_in, mp_obj_t y_in) {
+    int x, y;
+    sb_display_init_internal();
+    sb_display_check_xy(x_in, y_in, &x, &y);
+    const uint8_t *p = &sb_display.grb[sb_display_index(x, y)];
+    mp_obj_t tuple[3] = {
+        MP_OBJ_NEW_SMALL_INT(sb_display_user_factor(p[1])),
+        MP_OBJ_NEW_SMALL_INT(sb_display_user_factor(p[0])),
+        MP_OBJ_NEW_SMALL_INT(sb_display_user_factor(p[2])),
+    };
+    return mp_obj_new_tuple(3, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(sb_display_get_pixel_obj, sb_display_get_pixel);
+
+// show(image[, color]): image is an Image, or a buffer holding width*height
+// RGB triples in row-major order.  If color is given it replaces the colour
+// of every pixel that is lit.
+STATIC mp_obj_t sb_display_show(size_t n_args, const mp_obj_t *args) {
+    uint8_t frame[SB_DISPLAY_NUM_PIXELS * 3];
+    const uint8_t *src = frame;
+    if (!studuinobit_image_get_rgb(args[0], frame)) {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(args[0], &bufinfo, MP_BUFFER_READ);
+        if (bufinfo.len != sizeof(frame)) {
+            mp_raise_ValueError("image data is incorrect size");
+        }
+        src = bufinfo.buf;
+    }
+    bool override = n_args > 1 && args[1] != mp_const_none;
+    uint8_t color[3];
+    if (override) {
+        studuinobit_get_color(args[1], color);
+    }
+    sb_display_init_internal();
+    sb_display_render_rgb(src, override ? color : NULL);
+    sb_display_flush(false);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sb_display_show_obj, 1, 2, sb_display_show);
+
+STATIC mp_obj_t sb_display_fill(mp_obj_t color_in) {
+    uint8_t rgb[3];
+    studuinobit_get_color(color_in, rgb);
+    sb_display_init_internal();
+    for (int i = 0; i < SB_DISPLAY_NUM_PIXELS; ++i) {
+        sb_display_put(i * 3, rgb);
+    }
+    sb_display_flush(false);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_display_fill_obj, sb_display_fill);
+
+STATIC mp_obj_t sb_display_clear(void) {
+    return sb_display_fill(MP_OBJ_NEW_SMALL_INT(0));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_display_clear_obj, sb_display_clear);
+
+// write([force]): push the framebuffer to the LEDs if it has changed
+STATIC mp_obj_t sb_display_write(size_t n_args, const mp_obj_t *args) {
+    sb_display_init_internal();
+    sb_display_flush(n_args > 0 && mp_obj_is_true(args[0]));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sb_display_write_obj, 0, 1, sb_display_write);
+
+STATIC mp_obj_t sb_display_on(void) {
+    sb_display_init_internal();
+    if (!sb_display.on) {
+        sb_display.on = true;
+        mp_hal_pin_write(SB_DISPLAY_POWER_PIN, 1);
+        sb_display_flush(true);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_display_on_obj, sb_display_on);
+
+STATIC mp_obj_t sb_display_off(void) {
+    sb_display_init_internal();
+    // the framebuffer is retained so on() restores the last frame
+    sb_display.on = false;
+    mp_hal_pin_write(SB_DISPLAY_POWER_PIN, 0);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_display_off_obj, sb_display_off);
+
+STATIC mp_obj_t sb_display_is_on(void) {
+    return mp_obj_new_bool(sb_display.initialised && sb_display.on);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_display_is_on_obj, sb_display_is_on);
+
+STATIC mp_obj_t sb_display_set_rgb_max_factor(mp_obj_t max_factor_in) {
+    mp_int_t max_factor = mp_obj_get_int(max_factor_in);
+    if (max_factor > SB_COLOR_FACTOR_MAX) {
+        mp_raise_ValueError("color out of bounds");
+    }
+    sb_display_init_internal();
+    sb_display_set_max_factor(max_factor);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_display_set_rgb_max_factor_obj, sb_display_set_rgb_max_factor);
+
+/******************************************************************************/
+// Animation compositor
+//
+// Animations are queued and stepped by a single esp_timer.  The timer callback
+// only schedules sb_anim_tick() on the MicroPython task, so the framebuffer is
+// never touched concurrently and no thread is needed per animation.  Frame
+// deadlines advance by the frame delay rather than from when a frame was
+// drawn, so the timing does not drift with the time taken to render.
+
+typedef enum {
+    SB_ANIM_FRAMES, // data is num_frames row-major RGB frames
+    SB_ANIM_SCROLL, // data is a line of glyph indices, scrolled a column per frame
+} sb_anim_kind_t;
+
+typedef struct _sb_anim_t {
+    uint8_t kind;
+    bool loop;
+    bool clear;
+    bool override;
+    uint8_t color[3];
+    uint16_t pos;
+    uint16_t num_frames;
+    uint32_t delay_ms;
+    const uint8_t *data;
+} sb_anim_t;
+
+typedef struct _sb_anim_queue_t {
+    esp_timer_handle_t timer;
+    // bumped whenever the queue is flushed so stale ticks can be ignored
+    volatile uint16_t gen;
+    int64_t deadline;
+    uint8_t head;
+    uint8_t len;
+    sb_anim_t entry[SB_DISPLAY_ANIM_QUEUE_LEN];
+} sb_anim_queue_t;
+
+STATIC sb_anim_queue_t sb_anim;
+
+STATIC mp_obj_t sb_anim_tick(mp_obj_t gen_in);
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_anim_tick_obj, sb_anim_tick);
+
+STATIC void sb_anim_timer_cb(void *arg) {
+    (void)arg;
+    if (mp_sched_schedule(MP_OBJ_FROM_PTR(&sb_anim_tick_obj), MP_OBJ_NEW_SMALL_INT(sb_anim.gen))) {
+        xTaskNotifyGive(mp_main_task_handle);
+    } else {
+        // scheduler queue is full, try again shortly
+        esp_timer_start_once(sb_anim.timer, 1000);
+    }
+}
+
+STATIC void sb_anim_arm(uint32_t delay_ms) {
+    int64_t now = esp_timer_get_time();
+    sb_anim.deadline += (int64_t)delay_ms * 1000;
+    if (sb_anim.deadline < now) {
+        // fell behind; drop the lost time rather than rushing frames
+        sb_anim.deadline = now;
+    }
+    esp_timer_start_once(sb_anim.timer, sb_anim.deadline - now);
+}
+
+STATIC void sb_anim_release(uint8_t idx) {
+    MP_STATE_PORT(studuinobit_display_anim)[idx] = MP_OBJ_NULL;
+}
+
+// Draw the next frame of the animation at the head of the queue, moving on to
+// the next animation when it is finished.  Returns false once the queue drains.
+STATIC bool sb_anim_step(void) {
+    while (sb_anim.len > 0) {
+        sb_anim_t *a = &sb_anim.entry[sb_anim.head];
+        if (a->pos < a->num_frames) {
+            const uint8_t *color = a->override ? a->color : NULL;
+            if (a->kind == SB_ANIM_FRAMES) {
+                sb_display_render_rgb(a->data + a->pos * SB_DISPLAY_NUM_PIXELS * 3, color);
+            } else {
+                sb_display_render_text(a->data, a->pos, color);
+            }
+            ++a->pos;
+            sb_display_flush(false);
+            sb_anim_arm(a->delay_ms);
+            return true;
+        }
+        // a looping animation repeats until something else is queued
+        if (a->loop && sb_anim.len == 1) {
+            a->pos = 0;
+            continue;
+        }
+        if (a->clear) {
+            memset(sb_display.grb, 0, sizeof(sb_display.grb));
+            sb_display.dirty = true;
+            sb_display_flush(false);
+        }
+        sb_anim_release(sb_anim.head);
+        sb_anim.head = (sb_anim.head + 1) % SB_DISPLAY_ANIM_QUEUE_LEN;
+        --sb_anim.len;
+    }
+    return false;
+}
+
+STATIC mp_obj_t sb_anim_tick(mp_obj_t gen_in) {
+    if (MP_OBJ_SMALL_INT_VALUE(gen_in) == sb_anim.gen) {
+        sb_anim_step();
+    }
+    return mp_const_none;
+}
+
+STATIC void sb_anim_stop_internal(void) {
+    if (sb_anim.timer != NULL) {
+        esp_timer_stop(sb_anim.timer);
+    }
+    ++sb_anim.gen;
+    for (int i = 0; i < SB_DISPLAY_ANIM_QUEUE_LEN; ++i) {
+        sb_anim_release(i);
+    }
+    sb_anim.head = 0;
+    sb_anim.len = 0;
+}
+
+STATIC void sb_anim_wait_internal(void) {
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        while (sb_anim.len > 0) {
+            mp_hal_delay_ms(1);
+        }
+        nlr_pop();
+    } else {
+        // interrupted (eg Ctrl-C), so don't leave the animation running
+        sb_anim_stop_internal();
+        nlr_jump(nlr.ret_val);
+    }
+}
+
+STATIC void sb_anim_enqueue(const sb_anim_t *anim, mp_obj_t data, bool wait) {
+    sb_display_init_internal();
+    if (sb_anim.timer == NULL) {
+        esp_timer_create_args_t args = {
+            .callback = sb_anim_timer_cb,
+            .arg = NULL,
+            .name = "sb_display",
+        };
+        if (esp_timer_create(&args, &sb_anim.timer) != ESP_OK) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+    // a full queue drains by itself unless it ends in a looping animation,
+    // which yields as soon as anything else is queued behind it
+    while (sb_anim.len == SB_DISPLAY_ANIM_QUEUE_LEN) {
+        mp_hal_delay_ms(1);
+    }
+    MP_STATIC_ASSERT(MP_ARRAY_SIZE(MP_STATE_PORT(studuinobit_display_anim)) == SB_DISPLAY_ANIM_QUEUE_LEN);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    uint8_t idx = (sb_anim.head + sb_anim.len) % SB_DISPLAY_ANIM_QUEUE_LEN;
+    sb_anim.entry[idx] = *anim;
+    sb_anim.entry[idx].data = bufinfo.buf;
+    MP_STATE_PORT(studuinobit_display_anim)[idx] = data;
+    if (sb_anim.len++ == 0) {
+        sb_anim.deadline = esp_timer_get_time();
+        sb_anim_step();
+    }
+    if (wait) {
+        sb_anim_wait_internal();
+    }
+}
+
+// animate(frames, delay, *, loop=False, clear=False, color=None, wait=True):
+// frames is a list or tuple of Images, or a buffer holding one or more
+// row-major RGB frames back to back.
+STATIC mp_obj_t sb_display_animate(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_frames, ARG_delay, ARG_loop, ARG_clear, ARG_color, ARG_wait };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_frames, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_delay, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_clear, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_color, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    mp_obj_t frames = args[ARG_frames].u_obj;
+    mp_obj_t data;
+    if (MP_OBJ_IS_TYPE(frames, &mp_type_list) || MP_OBJ_IS_TYPE(frames, &mp_type_tuple)) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(frames, &len, &items);
+        vstr_t vstr;
+        vstr_init_len(&vstr, len * SB_DISPLAY_NUM_PIXELS * 3);
+        for (size_t i = 0; i < len; ++i) {
+            if (!studuinobit_image_get_rgb(items[i], (uint8_t*)vstr.buf + i * SB_DISPLAY_NUM_PIXELS * 3)) {
+                mp_raise_TypeError("expecting an Image");
+            }
+        }
+        data = mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+    } else {
+        // take a copy so the caller is free to reuse its buffer
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(frames, &bufinfo, MP_BUFFER_READ);
+        data = mp_obj_new_bytes(bufinfo.buf, bufinfo.len);
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(data, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len == 0 || bufinfo.len % (SB_DISPLAY_NUM_PIXELS * 3) != 0) {
+        mp_raise_ValueError("image data is incorrect size");
+    }
+    sb_anim_t anim = {
+        .kind = SB_ANIM_FRAMES,
+        .loop = args[ARG_loop].u_bool,
+        .clear = args[ARG_clear].u_bool,
+        .override = args[ARG_color].u_obj != mp_const_none,
+        .num_frames = bufinfo.len / (SB_DISPLAY_NUM_PIXELS * 3),
+        .delay_ms = MAX(args[ARG_delay].u_int, 0),
+    };
+    if (anim.override) {
+        studuinobit_get_color(args[ARG_color].u_obj, anim.color);
+    }
+    sb_anim_enqueue(&anim, data, args[ARG_wait].u_bool);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sb_display_animate_obj, 2, sb_display_animate);
+
+// scroll(text, delay, color=None, *, loop=False, wait=True): scroll text
+// right to left a column per frame using the built-in font, then clear.
+// Characters outside the font are drawn as '?'.
+STATIC mp_obj_t sb_display_scroll(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_text, ARG_delay, ARG_color, ARG_loop, ARG_wait };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_text, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_delay, MP_ARG_REQUIRED | MP_ARG_INT, {.u_int = 0} },
+        { MP_QSTR_color, MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_wait, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (!MP_OBJ_IS_STR(args[ARG_text].u_obj)) {
+        mp_raise_TypeError("can't convert to str implicitly");
+    }
+    size_t len;
+    const byte *s = (const byte*)mp_obj_str_get_data(args[ARG_text].u_obj, &len);
+    const byte *end = s + len;
+
+    // the text is padded with a blank glyph either side so it scrolls in
+    // from, and out to, an empty display
+    vstr_t vstr;
+    vstr_init(&vstr, len + 2);
+    vstr_add_byte(&vstr, studuinobit_font_index(' '));
+    for (; s < end; s = utf8_next_char(s)) {
+        vstr_add_byte(&vstr, studuinobit_font_index(utf8_get_char(s)));
+    }
+    vstr_add_byte(&vstr, studuinobit_font_index(' '));
+    size_t num_frames = vstr.len * SB_FONT_WIDTH - SB_DISPLAY_WIDTH + 1;
+    if (num_frames > 0xffff) {
+        mp_raise_ValueError("text too long");
+    }
+
+    sb_anim_t anim = {
+        .kind = SB_ANIM_SCROLL,
+        .loop = args[ARG_loop].u_bool,
+        .clear = true,
+        .override = true,
+        .num_frames = num_frames,
+        .delay_ms = MAX(args[ARG_delay].u_int, 0),
+        .color = {SB_DISPLAY_TEXT_COLOR >> 16, (SB_DISPLAY_TEXT_COLOR >> 8) & 0xff, SB_DISPLAY_TEXT_COLOR & 0xff},
+    };
+    if (args[ARG_color].u_obj != mp_const_none) {
+        studuinobit_get_color(args[ARG_color].u_obj, anim.color);
+    }
+    sb_anim_enqueue(&anim, mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr), args[ARG_wait].u_bool);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sb_display_scroll_obj, 2, sb_display_scroll);
+
+// stop(): cancel the running animation and everything queued behind it
+STATIC mp_obj_t sb_display_stop(void) {
+    sb_anim_stop_internal();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_display_stop_obj, sb_display_stop);
+
+STATIC mp_obj_t sb_display_busy(void) {
+    return mp_obj_new_bool(sb_anim.len > 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_display_busy_obj, sb_display_busy);
+
+// wait(): block until the animation queue is empty
+STATIC mp_obj_t sb_display_wait(void) {
+    sb_anim_wait_internal();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_display_wait_obj, sb_display_wait);
+
+void studuinobit_display_deinit(void) {
+    sb_anim_stop_internal();
+}
+
+STATIC const mp_rom_map_elem_t sb_display_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_display) },
+    { MP_ROM_QSTR(MP_QSTR_init), MP_ROM_PTR(&sb_display_init_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_pixel), MP_ROM_PTR(&sb_display_set_pixel_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_pixel), MP_ROM_PTR(&sb_display_get_pixel_obj) },
+    { MP_ROM_QSTR(MP_QSTR_show), MP_ROM_PTR(&sb_display_show_obj) },
+    { MP_ROM_QSTR(MP_QSTR_fill), MP_ROM_PTR(&sb_display_fill_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clear), MP_ROM_PTR(&sb_display_clear_obj) },
+    { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&sb_display_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_on), MP_ROM_PTR(&sb_display_on_obj) },
+    { MP_ROM_QSTR(MP_QSTR_off), MP_ROM_PTR(&sb_display_off_obj) },
+    { MP_ROM_QSTR(MP_QSTR_is_on), MP_ROM_PTR(&sb_display_is_on_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_rgb_max_factor), MP_ROM_PTR(&sb_display_set_rgb_max_factor_obj) },
+    { MP_ROM_QSTR(MP_QSTR_animate), MP_ROM_PTR(&sb_display_animate_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scroll), MP_ROM_PTR(&sb_display_scroll_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&sb_display_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_busy), MP_ROM_PTR(&sb_display_busy_obj) },
+    { MP_ROM_QSTR(MP_QSTR_wait), MP_ROM_PTR(&sb_display_wait_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_WIDTH), MP_ROM_INT(SB_DISPLAY_WIDTH) },
+    { MP_ROM_QSTR(MP_QSTR_HEIGHT), MP_ROM_INT(SB_DISPLAY_HEIGHT) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_display_module_globals, sb_display_module_globals_table);
+
+const mp_obj_module_t studuinobit_display_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&sb_display_module_globals,
+};
@@ -0,0 +1,296 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/runtime.h"
+#include "modstuduinobit.h"
+
+// Gesture recogniser fed by the IMU sampler task, following the micro:bit
+// DAL: impulses (3g/6g/8g) are checked on every frame so short knocks are
+// not missed, while posture and shake are evaluated at the DAL's 50Hz and
+// debounced the same way.  The sampler task is the only writer; Python
+// reads the current gesture, the per-gesture "seen" flags and a short
+// history without taking a lock.
+
+#define SB_GESTURE_UPDATE_US        (20000)
+#define SB_GESTURE_TILT_TOLERANCE   (200)
+#define SB_GESTURE_FREEFALL_TOLERANCE (400)
+#define SB_GESTURE_SHAKE_TOLERANCE  (400)
+#define SB_GESTURE_SHAKE_COUNT      (4)
+#define SB_GESTURE_DAMPING          (5)
+#define SB_GESTURE_SHAKE_DAMPING    (10)
+#define SB_GESTURE_SHAKE_RTX        (30)
+#define SB_GESTURE_HISTORY_LEN      (8)
+
+typedef enum {
+    SB_GESTURE_NONE,
+    SB_GESTURE_UP,
+    SB_GESTURE_DOWN,
+    SB_GESTURE_LEFT,
+    SB_GESTURE_RIGHT,
+    SB_GESTURE_FACE_UP,
+    SB_GESTURE_FACE_DOWN,
+    SB_GESTURE_FREEFALL,
+    SB_GESTURE_3G,
+    SB_GESTURE_6G,
+    SB_GESTURE_8G,
+    SB_GESTURE_SHAKE,
+    SB_GESTURE_NUM,
+} sb_gesture_t;
+
+STATIC const qstr sb_gesture_name[SB_GESTURE_NUM] = {
+    [SB_GESTURE_NONE] = MP_QSTR_,
+    [SB_GESTURE_UP] = MP_QSTR_up,
+    [SB_GESTURE_DOWN] = MP_QSTR_down,
+    [SB_GESTURE_LEFT] = MP_QSTR_left,
+    [SB_GESTURE_RIGHT] = MP_QSTR_right,
+    [SB_GESTURE_FACE_UP] = MP_QSTR_face_space_up,
+    [SB_GESTURE_FACE_DOWN] = MP_QSTR_face_space_down,
+    [SB_GESTURE_FREEFALL] = MP_QSTR_freefall,
+    [SB_GESTURE_3G] = MP_QSTR_3g,
+    [SB_GESTURE_6G] = MP_QSTR_6g,
+    [SB_GESTURE_8G] = MP_QSTR_8g,
+    [SB_GESTURE_SHAKE] = MP_QSTR_shake,
+};
+
+typedef struct _sb_gesture_state_t {
+    // accelerometer milli-g per digit is (2000 << fs) / 32768
+    uint8_t accel_fs;
+    uint32_t last_update_us;
+    // posture debouncing
+    uint8_t candidate;
+    uint8_t sigma;
+    volatile uint8_t current;
+    // shake detection
+    bool shake_x, shake_y, shake_z;
+    bool shaken;
+    uint8_t shake_count;
+    uint8_t shake_timer;
+    // impulse detection
+    uint8_t impulse;
+    uint8_t impulse_sigma;
+    // events seen since the matching was_gesture() call
+    volatile uint32_t seen;
+    // history of events, written by the sampler and drained by Python
+    volatile uint32_t hist_head;
+    volatile uint32_t hist_tail;
+    uint8_t history[SB_GESTURE_HISTORY_LEN];
+} sb_gesture_state_t;
+
+STATIC sb_gesture_state_t sb_gesture;
+
+STATIC void sb_gesture_event(sb_gesture_t g) {
+    __atomic_fetch_or(&sb_gesture.seen, 1 << g, __ATOMIC_RELAXED);
+    uint32_t head = sb_gesture.hist_head;
+    if (head - sb_gesture.hist_tail < SB_GESTURE_HISTORY_LEN) {
+        sb_gesture.history[head % SB_GESTURE_HISTORY_LEN] = g;
+        __atomic_store_n(&sb_gesture.hist_head, head + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static inline int32_t sb_gesture_mg(int16_t raw) {
+    return ((int32_t)raw * 1000 << (sb_gesture.accel_fs + 1)) >> 15;
+}
+
+STATIC sb_gesture_t sb_gesture_posture(const int32_t mg[3], uint32_t force) {
+    // shake takes priority over posture while it is in progress
+    bool shake = false;
+    if ((mg[0] < -SB_GESTURE_SHAKE_TOLERANCE && sb_gesture.shake_x)
+        || (mg[0] > SB_GESTURE_SHAKE_TOLERANCE && !sb_gesture.shake_x)) {
+        shake = true;
+        sb_gesture.shake_x = !sb_gesture.shake_x;
+    }
+    if ((mg[1] < -SB_GESTURE_SHAKE_TOLERANCE && sb_gesture.shake_y)
+        || (mg[1] > SB_GESTURE_SHAKE_TOLERANCE && !sb_gesture.shake_y)) {
+        shake = true;
+        sb_gesture.shake_y = !sb_gesture.shake_y;
+    }
+    if ((mg[2] < -SB_GESTURE_SHAKE_TOLERANCE && sb_gesture.shake_z)
+        || (mg[2] > SB_GESTURE_SHAKE_TOLERANCE && !sb_gesture.shake_z)) {
+        shake = true;
+        sb_gesture.shake_z = !sb_gesture.shake_z;
+    }
+    if (shake && sb_gesture.shake_count < SB_GESTURE_SHAKE_COUNT) {
+        if (++sb_gesture.shake_count == 1) {
+            sb_gesture.shake_timer = 0;
+        }
+        if (sb_gesture.shake_count == SB_GESTURE_SHAKE_COUNT) {
+            sb_gesture.shaken = true;
+            sb_gesture.shake_timer = 0;
+            return SB_GESTURE_SHAKE;
+        }
+    }
+    if (sb_gesture.shake_count > 0) {
+        ++sb_gesture.shake_timer;
+        if (sb_gesture.shaken && sb_gesture.shake_timer >= SB_GESTURE_SHAKE_DAMPING) {
+            sb_gesture.shaken = false;
+            sb_gesture.shake_timer = 0;
+            sb_gesture.shake_count = 0;
+        } else if (!sb_gesture.shaken && sb_gesture.shake_timer >= SB_GESTURE_SHAKE_RTX) {
+            sb_gesture.shake_timer = 0;
+            --sb_gesture.shake_count;
+        }
+    }
+    if (sb_gesture.shaken) {
+        return SB_GESTURE_SHAKE;
+    }
+
+    if (force < SB_GESTURE_FREEFALL_TOLERANCE * SB_GESTURE_FREEFALL_TOLERANCE) {
+        return SB_GESTURE_FREEFALL;
+    }
+    if (mg[0] < -1000 + SB_GESTURE_TILT_TOLERANCE) {
+        return SB_GESTURE_LEFT;
+    }
+    if (mg[0] > 1000 - SB_GESTURE_TILT_TOLERANCE) {
+        return SB_GESTURE_RIGHT;
+    }
+    if (mg[1] < -1000 + SB_GESTURE_TILT_TOLERANCE) {
+        return SB_GESTURE_DOWN;
+    }
+    if (mg[1] > 1000 - SB_GESTURE_TILT_TOLERANCE) {
+        return SB_GESTURE_UP;
+    }
+    if (mg[2] < -1000 + SB_GESTURE_TILT_TOLERANCE) {
+        return SB_GESTURE_FACE_UP;
+    }
+    if (mg[2] > 1000 - SB_GESTURE_TILT_TOLERANCE) {
+        return SB_GESTURE_FACE_DOWN;
+    }
+    return SB_GESTURE_NONE;
+}
+
+void studuinobit_gesture_reset(uint8_t accel_fs) {
+    sb_gesture.accel_fs = accel_fs;
+    sb_gesture.last_update_us = 0;
+    sb_gesture.candidate = SB_GESTURE_NONE;
+    sb_gesture.sigma = 0;
+    sb_gesture.current = SB_GESTURE_NONE;
+    sb_gesture.shake_x = sb_gesture.shake_y = sb_gesture.shake_z = false;
+    sb_gesture.shaken = false;
+    sb_gesture.shake_count = 0;
+    sb_gesture.shake_timer = 0;
+    sb_gesture.impulse = 0;
+    sb_gesture.impulse_sigma = 0;
+}
+
+void studuinobit_gesture_update(const int16_t accel[3], uint32_t time_us) {
+    int32_t mg[3];
+    for (int i = 0; i < 3; ++i) {
+        mg[i] = sb_gesture_mg(accel[i]);
+    }
+    uint32_t force = mg[0] * mg[0] + mg[1] * mg[1] + mg[2] * mg[2];
+
+    // impulses are reported once each until things have been quiet for a
+    // while, however short they are
+    static const uint32_t threshold[3] = { 3072 * 3072, 6144 * 6144, 8192 * 8192 };
+    for (int i = 0; i < 3; ++i) {
+        if (force > threshold[i]) {
+            sb_gesture.impulse_sigma = 0;
+            if (!(sb_gesture.impulse & (1 << i))) {
+                sb_gesture.impulse |= 1 << i;
+                sb_gesture_event(SB_GESTURE_3G + i);
+            }
+        }
+    }
+
+    if (time_us - sb_gesture.last_update_us < SB_GESTURE_UPDATE_US) {
+        return;
+    }
+    sb_gesture.last_update_us = time_us;
+
+    if (sb_gesture.impulse_sigma < SB_GESTURE_DAMPING) {
+        ++sb_gesture.impulse_sigma;
+    } else {
+        sb_gesture.impulse = 0;
+    }
+
+    sb_gesture_t g = sb_gesture_posture(mg, force);
+    if (g == SB_GESTURE_SHAKE) {
+        if (sb_gesture.current != SB_GESTURE_SHAKE) {
+            sb_gesture.current = SB_GESTURE_SHAKE;
+            sb_gesture_event(SB_GESTURE_SHAKE);
+        }
+        sb_gesture.candidate = SB_GESTURE_SHAKE;
+        sb_gesture.sigma = SB_GESTURE_DAMPING;
+        return;
+    }
+    if (g == sb_gesture.candidate) {
+        if (sb_gesture.sigma < SB_GESTURE_DAMPING) {
+            ++sb_gesture.sigma;
+        }
+    } else {
+        sb_gesture.candidate = g;
+        sb_gesture.sigma = 0;
+    }
+    if (sb_gesture.candidate != sb_gesture.current && sb_gesture.sigma >= SB_GESTURE_DAMPING) {
+        sb_gesture.current = sb_gesture.candidate;
+        if (g != SB_GESTURE_NONE) {
+            sb_gesture_event(g);
+        }
+    }
+}
+
+/******************************************************************************/
+// MicroPython bindings, part of studuinobit.imu
+
+STATIC sb_gesture_t sb_gesture_from_name(mp_obj_t name_in) {
+    qstr name = mp_obj_str_get_qstr(name_in);
+    for (int g = SB_GESTURE_UP; g < SB_GESTURE_NUM; ++g) {
+        if (sb_gesture_name[g] == name) {
+            return g;
+        }
+    }
+    mp_raise_ValueError("invalid gesture");
+}
+
+STATIC mp_obj_t sb_gesture_current(void) {
+    return MP_OBJ_NEW_QSTR(sb_gesture_name[sb_gesture.current]);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(studuinobit_gesture_current_obj, sb_gesture_current);
+
+STATIC mp_obj_t sb_gesture_is(mp_obj_t name_in) {
+    return mp_obj_new_bool(sb_gesture.current == sb_gesture_from_name(name_in));
+}
+MP_DEFINE_CONST_FUN_OBJ_1(studuinobit_gesture_is_obj, sb_gesture_is);
+
+// True if the gesture happened since the last was_gesture() for it
+STATIC mp_obj_t sb_gesture_was(mp_obj_t name_in) {
+    uint32_t mask = 1 << sb_gesture_from_name(name_in);
+    return mp_obj_new_bool(__atomic_fetch_and(&sb_gesture.seen, ~mask, __ATOMIC_RELAXED) & mask);
+}
+MP_DEFINE_CONST_FUN_OBJ_1(studuinobit_gesture_was_obj, sb_gesture_was);
+
+// Tuple of the gestures recorded since the last call, oldest first
+STATIC mp_obj_t sb_gesture_get_all(void) {
+    uint32_t tail = sb_gesture.hist_tail;
+    uint32_t n = __atomic_load_n(&sb_gesture.hist_head, __ATOMIC_ACQUIRE) - tail;
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(n, NULL));
+    for (uint32_t i = 0; i < n; ++i) {
+        t->items[i] = MP_OBJ_NEW_QSTR(sb_gesture_name[sb_gesture.history[(tail + i) % SB_GESTURE_HISTORY_LEN]]);
+    }
+    __atomic_store_n(&sb_gesture.hist_tail, tail + n, __ATOMIC_RELEASE);
+    return MP_OBJ_FROM_PTR(t);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(studuinobit_gesture_get_all_obj, sb_gesture_get_all);
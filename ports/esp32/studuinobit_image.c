@@ -0,0 +1,677 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "py/binary.h"
+#include "modstuduinobit.h"
+
+// An image is a single heap block holding one byte per pixel.  The low nibble
+// is the pixel value (0-9) and the high nibble says where its colour comes
+// from: 0 is the image's base colour, otherwise it selects an entry of a small
+// per-image palette.  Once an image uses more distinct colours than the
+// palette can hold it switches to direct mode, with a separate RGB plane of
+// 3 bytes per pixel; the high nibble is then just an "own colour" flag.
+//
+// The built-in images (HEART, ARROW_N, ...) are read-only objects in ROM,
+// generated from studuinobit_images.csv by makeimages.py.
+
+#define SB_IMAGE_VALUE_MASK     (0x0f)
+#define SB_IMAGE_SLOT_SHIFT     (4)
+#define SB_IMAGE_PALETTE_MAX    (15)
+#define SB_IMAGE_OWN_COLOR      (0xf0)
+#define SB_IMAGE_PIX_MAX        (9)
+#define SB_IMAGE_DEFAULT_COLOR  (0x1f0000)
+#define SB_IMAGE_SIZE_MAX       (0xffff)
+
+typedef struct _sb_image_obj_t {
+    mp_obj_base_t base;
+    uint16_t width;
+    uint16_t height;
+    uint8_t base_color[3];
+    uint8_t palette_len : 4;
+    uint8_t readonly : 1;
+    uint8_t *palette;   // palette_len RGB triples, or NULL
+    uint8_t *rgb;       // per-pixel RGB in direct mode, otherwise NULL
+    uint8_t pixel[];
+} sb_image_obj_t;
+
+// Same layout as sb_image_obj_t with room for a 5x5 image, so that built-in
+// images can be statically initialised
+typedef struct _sb_image_rom_obj_t {
+    mp_obj_base_t base;
+    uint16_t width;
+    uint16_t height;
+    uint8_t base_color[3];
+    uint8_t palette_len : 4;
+    uint8_t readonly : 1;
+    const uint8_t *palette;
+    const uint8_t *rgb;
+    uint8_t pixel[SB_DISPLAY_NUM_PIXELS];
+} sb_image_rom_obj_t;
+
+#define SB_IMAGE_ROM(...) { \
+    .base = { &studuinobit_image_type }, \
+    .width = SB_DISPLAY_WIDTH, \
+    .height = SB_DISPLAY_HEIGHT, \
+    .base_color = { \
+        SB_IMAGE_DEFAULT_COLOR >> 16, \
+        (SB_IMAGE_DEFAULT_COLOR >> 8) & 0xff, \
+        SB_IMAGE_DEFAULT_COLOR & 0xff, \
+    }, \
+    .readonly = 1, \
+    .pixel = { __VA_ARGS__ }, \
+}
+
+#include "genhdr/studuinobit_images.h"
+
+STATIC const uint8_t sb_image_black[3] = {0, 0, 0};
+
+STATIC sb_image_obj_t *sb_image_new(mp_int_t width, mp_int_t height) {
+    if (width < 0 || height < 0 || width > SB_IMAGE_SIZE_MAX || height > SB_IMAGE_SIZE_MAX) {
+        mp_raise_ValueError("image is incorrect size");
+    }
+    MP_STATIC_ASSERT(offsetof(sb_image_rom_obj_t, pixel) == offsetof(sb_image_obj_t, pixel));
+    size_t n = width * height;
+    sb_image_obj_t *img = m_new_obj_var(sb_image_obj_t, uint8_t, n);
+    img->base.type = &studuinobit_image_type;
+    img->width = width;
+    img->height = height;
+    img->base_color[0] = SB_IMAGE_DEFAULT_COLOR >> 16;
+    img->base_color[1] = (SB_IMAGE_DEFAULT_COLOR >> 8) & 0xff;
+    img->base_color[2] = SB_IMAGE_DEFAULT_COLOR & 0xff;
+    img->palette_len = 0;
+    img->readonly = 0;
+    img->palette = NULL;
+    img->rgb = NULL;
+    memset(img->pixel, 0, n);
+    return img;
+}
+
+// New blank image with the same size, base colour and colour tables as src,
+// so pixel bytes (and RGB triples) can be copied over from src verbatim.
+STATIC sb_image_obj_t *sb_image_new_like(const sb_image_obj_t *src) {
+    sb_image_obj_t *img = sb_image_new(src->width, src->height);
+    memcpy(img->base_color, src->base_color, 3);
+    if (src->palette_len > 0) {
+        img->palette = m_new(uint8_t, src->palette_len * 3);
+        memcpy(img->palette, src->palette, src->palette_len * 3);
+        img->palette_len = src->palette_len;
+    }
+    if (src->rgb != NULL) {
+        size_t n = img->width * img->height * 3;
+        img->rgb = m_new(uint8_t, n);
+        memset(img->rgb, 0, n);
+    }
+    return img;
+}
+
+STATIC sb_image_obj_t *sb_image_native(mp_obj_t obj) {
+    if (MP_OBJ_IS_TYPE(obj, &studuinobit_image_type)) {
+        return MP_OBJ_TO_PTR(obj);
+    }
+    // instance of a Python subclass, eg pystubit's StuduinoBitImage
+    mp_obj_t native = mp_instance_cast_to_native_base(obj, MP_OBJ_FROM_PTR(&studuinobit_image_type));
+    if (native == MP_OBJ_NULL) {
+        return NULL;
+    }
+    return MP_OBJ_TO_PTR(native);
+}
+
+STATIC void sb_image_check_writable(const sb_image_obj_t *self) {
+    if (self->readonly) {
+        mp_raise_TypeError("This image cannot be modified. Try copying it first.");
+    }
+}
+
+STATIC size_t sb_image_index(const sb_image_obj_t *self, mp_obj_t x_in, mp_obj_t y_in) {
+    mp_int_t x = mp_obj_get_int(x_in);
+    mp_int_t y = mp_obj_get_int(y_in);
+    if (x < 0 || y < 0 || x >= self->width || y >= self->height) {
+        mp_raise_ValueError("index out of bounds");
+    }
+    return y * self->width + x;
+}
+
+// Colours given to images are clamped rather than rejected, matching the
+// original pure-Python Image class.
+STATIC void sb_image_parse_color(mp_obj_t color_in, uint8_t rgb[3]) {
+    if (MP_OBJ_IS_TYPE(color_in, &mp_type_tuple) || MP_OBJ_IS_TYPE(color_in, &mp_type_list)) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_get_array(color_in, &len, &items);
+        if (len != 3) {
+            mp_raise_ValueError("color takes a (R,G,B) or [R,G,B]");
+        }
+        for (int i = 0; i < 3; ++i) {
+            mp_int_t c = mp_obj_get_int(items[i]);
+            rgb[i] = c < 0 ? 0 : c > SB_COLOR_FACTOR_MAX ? SB_COLOR_FACTOR_MAX : c;
+        }
+    } else if (MP_OBJ_IS_INT(color_in)) {
+        mp_int_t c = mp_obj_get_int(color_in);
+        rgb[0] = c >> 16;
+        rgb[1] = c >> 8;
+        rgb[2] = c;
+    } else {
+        mp_raise_TypeError("color takes a (R,G,B) or [R,G,B] or #RGB");
+    }
+}
+
+STATIC mp_obj_t sb_image_color_obj(const uint8_t rgb[3], bool hex) {
+    if (hex) {
+        return MP_OBJ_NEW_SMALL_INT(rgb[0] << 16 | rgb[1] << 8 | rgb[2]);
+    }
+    mp_obj_t tuple[3] = {
+        MP_OBJ_NEW_SMALL_INT(rgb[0]),
+        MP_OBJ_NEW_SMALL_INT(rgb[1]),
+        MP_OBJ_NEW_SMALL_INT(rgb[2]),
+    };
+    return mp_obj_new_tuple(3, tuple);
+}
+
+// Colour a pixel is drawn with: black if it is off
+STATIC const uint8_t *sb_image_pixel_color(const sb_image_obj_t *self, size_t idx) {
+    uint8_t p = self->pixel[idx];
+    if ((p & SB_IMAGE_VALUE_MASK) == 0) {
+        return sb_image_black;
+    }
+    uint8_t slot = p >> SB_IMAGE_SLOT_SHIFT;
+    if (slot == 0) {
+        return self->base_color;
+    }
+    if (self->rgb != NULL) {
+        return &self->rgb[idx * 3];
+    }
+    return &self->palette[(slot - 1) * 3];
+}
+
+// Drop palette entries no pixel refers to any more
+STATIC void sb_image_palette_compact(sb_image_obj_t *self) {
+    size_t n = self->width * self->height;
+    bool used[SB_IMAGE_PALETTE_MAX + 1] = {false};
+    for (size_t i = 0; i < n; ++i) {
+        used[self->pixel[i] >> SB_IMAGE_SLOT_SHIFT] = true;
+    }
+    uint8_t remap[SB_IMAGE_PALETTE_MAX + 1] = {0};
+    uint8_t len = 0;
+    for (int slot = 1; slot <= self->palette_len; ++slot) {
+        if (used[slot]) {
+            remap[slot] = ++len;
+            memmove(&self->palette[(len - 1) * 3], &self->palette[(slot - 1) * 3], 3);
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t p = self->pixel[i];
+        self->pixel[i] = (p & SB_IMAGE_VALUE_MASK) | remap[p >> SB_IMAGE_SLOT_SHIFT] << SB_IMAGE_SLOT_SHIFT;
+    }
+    self->palette_len = len;
+}
+
+// Palette slot holding rgb, adding it if needed; 0 if the palette is full
+STATIC uint8_t sb_image_palette_slot(sb_image_obj_t *self, const uint8_t rgb[3]) {
+    for (int i = 0; i < self->palette_len; ++i) {
+        if (memcmp(&self->palette[i * 3], rgb, 3) == 0) {
+            return i + 1;
+        }
+    }
+    if (self->palette_len == SB_IMAGE_PALETTE_MAX) {
+        sb_image_palette_compact(self);
+        if (self->palette_len == SB_IMAGE_PALETTE_MAX) {
+            return 0;
+        }
+    }
+    self->palette = m_renew(uint8_t, self->palette, self->palette_len * 3, (self->palette_len + 1) * 3);
+    memcpy(&self->palette[self->palette_len * 3], rgb, 3);
+    return ++self->palette_len;
+}
+
+STATIC void sb_image_to_direct(sb_image_obj_t *self) {
+    size_t n = self->width * self->height;
+    uint8_t *rgb = m_new(uint8_t, n * 3);
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t p = self->pixel[i];
+        uint8_t slot = p >> SB_IMAGE_SLOT_SHIFT;
+        if (slot == 0) {
+            memset(&rgb[i * 3], 0, 3);
+        } else {
+            memcpy(&rgb[i * 3], &self->palette[(slot - 1) * 3], 3);
+            self->pixel[i] = (p & SB_IMAGE_VALUE_MASK) | SB_IMAGE_OWN_COLOR;
+        }
+    }
+    m_del(uint8_t, self->palette, self->palette_len * 3);
+    self->palette = NULL;
+    self->palette_len = 0;
+    self->rgb = rgb;
+}
+
+STATIC void sb_image_set_own_color(sb_image_obj_t *self, size_t idx, const uint8_t rgb[3]) {
+    uint8_t value = self->pixel[idx] & SB_IMAGE_VALUE_MASK;
+    if (self->rgb == NULL) {
+        uint8_t slot = sb_image_palette_slot(self, rgb);
+        if (slot != 0) {
+            self->pixel[idx] = value | slot << SB_IMAGE_SLOT_SHIFT;
+            return;
+        }
+        sb_image_to_direct(self);
+    }
+    memcpy(&self->rgb[idx * 3], rgb, 3);
+    self->pixel[idx] = value | SB_IMAGE_OWN_COLOR;
+}
+
+bool studuinobit_image_get_rgb(mp_obj_t image_in, uint8_t *rgb) {
+    const sb_image_obj_t *self = sb_image_native(image_in);
+    if (self == NULL) {
+        return false;
+    }
+    for (int y = 0; y < SB_DISPLAY_HEIGHT; ++y) {
+        for (int x = 0; x < SB_DISPLAY_WIDTH; ++x, rgb += 3) {
+            if (x < self->width && y < self->height) {
+                memcpy(rgb, sb_image_pixel_color(self, y * self->width + x), 3);
+            } else {
+                memset(rgb, 0, 3);
+            }
+        }
+    }
+    return true;
+}
+
+/******************************************************************************/
+// Construction
+
+// Parse '09090:99999:...' style strings: rows are separated by ':' (a
+// trailing one is optional) and short rows are padded with 0.
+STATIC sb_image_obj_t *sb_image_from_string(mp_obj_t str_in) {
+    if (!MP_OBJ_IS_STR(str_in)) {
+        mp_raise_TypeError("Image(s) takes a string");
+    }
+    size_t len;
+    const char *s = mp_obj_str_get_data(str_in, &len);
+    if (len == 0) {
+        return sb_image_new(0, 0);
+    }
+
+    // one pass checks the characters and measures the image; ':' after the
+    // last digit don't start a new row
+    mp_int_t width = 0, height = 0, rows = 1, row = 0;
+    size_t end = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (s[i] == ':') {
+            ++rows;
+            row = 0;
+        } else if (s[i] >= '0' && s[i] <= '9') {
+            if (++row > width) {
+                width = row;
+            }
+            height = rows;
+            end = i + 1;
+        } else {
+            mp_raise_ValueError("Unexpected character in Image definition");
+        }
+    }
+    if (end == 0) {
+        return sb_image_new(SB_DISPLAY_WIDTH, SB_DISPLAY_HEIGHT);
+    }
+    len = end;
+
+    sb_image_obj_t *img = sb_image_new(width, height);
+    row = 0;
+    mp_int_t col = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (s[i] == ':') {
+            ++row;
+            col = 0;
+        } else {
+            img->pixel[row * width + col++] = s[i] != '0';
+        }
+    }
+    return img;
+}
+
+STATIC sb_image_obj_t *sb_image_from_buffer(mp_obj_t w_in, mp_obj_t h_in, mp_obj_t buf_in) {
+    mp_int_t width = mp_obj_get_int(w_in);
+    mp_int_t height = mp_obj_get_int(h_in);
+    mp_buffer_info_t bufinfo;
+    if (!mp_get_buffer(buf_in, &bufinfo, MP_BUFFER_READ)) {
+        mp_raise_TypeError("(array) object with buffer protocol required");
+    }
+    size_t n = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL);
+    if (width < 0 || height < 0 || n != (size_t)(width * height)) {
+        mp_raise_ValueError("image data is incorrect size");
+    }
+    sb_image_obj_t *img = sb_image_new(width, height);
+    for (size_t i = 0; i < n; ++i) {
+        mp_int_t v = mp_obj_get_int(mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, i));
+        img->pixel[i] = v < 0 ? 0 : v > SB_IMAGE_PIX_MAX ? SB_IMAGE_PIX_MAX : v;
+    }
+    return img;
+}
+
+// Image(), Image(s), Image(width, height) or Image(width, height, buffer),
+// each optionally with color=base_color
+STATIC mp_obj_t sb_image_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    (void)type;
+    sb_image_obj_t *img;
+    switch (n_args) {
+        case 0:
+            img = sb_image_new(SB_DISPLAY_WIDTH, SB_DISPLAY_HEIGHT);
+            break;
+        case 1:
+            img = sb_image_from_string(args[0]);
+            break;
+        case 2:
+            img = sb_image_new(mp_obj_get_int(args[0]), mp_obj_get_int(args[1]));
+            break;
+        case 3:
+            img = sb_image_from_buffer(args[0], args[1], args[2]);
+            break;
+        default:
+            nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError,
+                "function expected at most 3 arguments, got %d", n_args));
+    }
+    for (size_t i = 0; i < n_kw; ++i) {
+        if (args[n_args + 2 * i] != MP_OBJ_NEW_QSTR(MP_QSTR_color)) {
+            mp_raise_TypeError("Unexpected **kwargs");
+        }
+        sb_image_parse_color(args[n_args + 2 * i + 1], img->base_color);
+    }
+    return MP_OBJ_FROM_PTR(img);
+}
+
+/******************************************************************************/
+// Printing
+
+// Write the digits of n pixels of row y, starting at column x, to buf
+STATIC size_t sb_image_format_row(const sb_image_obj_t *self, int x, int y, int n, char *buf) {
+    const uint8_t *p = &self->pixel[y * self->width + x];
+    for (int i = 0; i < n; ++i) {
+        buf[i] = '0' + (p[i] & SB_IMAGE_VALUE_MASK);
+    }
+    return n;
+}
+
+STATIC void sb_image_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    if (kind == PRINT_STR) {
+        // bordered view of the part that fits on the display
+        char line[SB_DISPLAY_WIDTH + 3];
+        mp_print_str(print, "-------\n");
+        for (int y = 0; y < SB_DISPLAY_HEIGHT; ++y) {
+            size_t n = 1;
+            line[0] = '|';
+            if (y < self->height) {
+                n += sb_image_format_row(self, 0, y, MIN(self->width, SB_DISPLAY_WIDTH), line + 1);
+            } else {
+                memset(line + 1, ' ', SB_DISPLAY_WIDTH);
+                n += SB_DISPLAY_WIDTH;
+            }
+            line[n++] = '|';
+            line[n++] = '\n';
+            mp_print_strn(print, line, n, 0, 0, 0);
+        }
+        mp_print_str(print, "-------");
+        return;
+    }
+    // rows are formatted in chunks so wide images need no heap
+    char buf[32];
+    mp_print_str(print, "Image('");
+    for (int y = 0; y < self->height; ++y) {
+        for (int x = 0; x < self->width; x += sizeof(buf)) {
+            size_t n = sb_image_format_row(self, x, y, MIN(self->width - x, (int)sizeof(buf)), buf);
+            mp_print_strn(print, buf, n, 0, 0, 0);
+        }
+        mp_print_str(print, ":");
+    }
+    mp_print_str(print, "')");
+}
+
+/******************************************************************************/
+// Operators
+
+// Superimpose two images: a pixel is lit if it is lit in either, and its
+// colour is the saturating sum of the colours it has in each of them.
+STATIC mp_obj_t sb_image_add(sb_image_obj_t *lhs, sb_image_obj_t *rhs) {
+    if (lhs->width != rhs->width || lhs->height != rhs->height) {
+        mp_raise_ValueError("Images must be the same size.");
+    }
+    sb_image_obj_t *img = sb_image_new(lhs->width, lhs->height);
+    size_t n = img->width * img->height;
+    for (size_t i = 0; i < n; ++i) {
+        const uint8_t *c1 = sb_image_pixel_color(lhs, i);
+        const uint8_t *c2 = sb_image_pixel_color(rhs, i);
+        img->pixel[i] = ((lhs->pixel[i] | rhs->pixel[i]) & SB_IMAGE_VALUE_MASK) != 0;
+        if ((c1[0] | c1[1] | c1[2] | c2[0] | c2[1] | c2[2]) != 0) {
+            uint8_t rgb[3];
+            for (int j = 0; j < 3; ++j) {
+                rgb[j] = MIN(c1[j] + c2[j], SB_COLOR_FACTOR_MAX);
+            }
+            sb_image_set_own_color(img, i, rgb);
+        }
+    }
+    for (int j = 0; j < 3; ++j) {
+        img->base_color[j] = MIN(lhs->base_color[j] + rhs->base_color[j], SB_COLOR_FACTOR_MAX);
+    }
+    return MP_OBJ_FROM_PTR(img);
+}
+
+STATIC void sb_image_scale_color(uint8_t *rgb, mp_float_t f) {
+    for (int j = 0; j < 3; ++j) {
+        mp_float_t v = rgb[j] * f;
+        rgb[j] = v > SB_COLOR_FACTOR_MAX ? SB_COLOR_FACTOR_MAX : (uint8_t)v;
+    }
+}
+
+// Multiply the brightness of every colour in the image
+STATIC mp_obj_t sb_image_mul(sb_image_obj_t *self, mp_obj_t factor_in) {
+    mp_float_t f = mp_obj_get_float(factor_in);
+    if (f < 0) {
+        mp_raise_ValueError("Brightness multiplier must not be negative");
+    }
+    sb_image_obj_t *img = sb_image_new_like(self);
+    size_t n = img->width * img->height;
+    memcpy(img->pixel, self->pixel, n);
+    sb_image_scale_color(img->base_color, f);
+    for (int i = 0; i < img->palette_len; ++i) {
+        sb_image_scale_color(&img->palette[i * 3], f);
+    }
+    if (img->rgb != NULL) {
+        memcpy(img->rgb, self->rgb, n * 3);
+        for (size_t i = 0; i < n; ++i) {
+            sb_image_scale_color(&img->rgb[i * 3], f);
+        }
+    }
+    return MP_OBJ_FROM_PTR(img);
+}
+
+STATIC mp_obj_t sb_image_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_in) {
+    sb_image_obj_t *lhs = MP_OBJ_TO_PTR(lhs_in);
+    switch (op) {
+        case MP_BINARY_OP_ADD: {
+            sb_image_obj_t *rhs = sb_image_native(rhs_in);
+            if (rhs == NULL) {
+                return MP_OBJ_NULL; // op not supported
+            }
+            return sb_image_add(lhs, rhs);
+        }
+        case MP_BINARY_OP_MULTIPLY:
+            if (!MP_OBJ_IS_INT(rhs_in) && !mp_obj_is_float(rhs_in)) {
+                return MP_OBJ_NULL; // op not supported
+            }
+            return sb_image_mul(lhs, rhs_in);
+        default:
+            return MP_OBJ_NULL; // op not supported
+    }
+}
+
+/******************************************************************************/
+// Methods
+
+STATIC mp_obj_t sb_image_width(mp_obj_t self_in) {
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return MP_OBJ_NEW_SMALL_INT(self->height == 0 ? 0 : self->width);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_image_width_obj, sb_image_width);
+
+STATIC mp_obj_t sb_image_height(mp_obj_t self_in) {
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return MP_OBJ_NEW_SMALL_INT(self->height);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_image_height_obj, sb_image_height);
+
+// set_pixel(x, y, value): any non-zero value lights the pixel
+STATIC mp_obj_t sb_image_set_pixel(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    sb_image_check_writable(self);
+    size_t idx = sb_image_index(self, args[1], args[2]);
+    mp_int_t value = mp_obj_get_int(args[3]);
+    if (value < 0 || value > SB_IMAGE_PIX_MAX) {
+        mp_raise_ValueError("value out of bounds");
+    }
+    self->pixel[idx] = (self->pixel[idx] & ~SB_IMAGE_VALUE_MASK) | (value != 0);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sb_image_set_pixel_obj, 4, 4, sb_image_set_pixel);
+
+STATIC mp_obj_t sb_image_get_pixel(mp_obj_t self_in, mp_obj_t x_in, mp_obj_t y_in) {
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    size_t idx = sb_image_index(self, x_in, y_in);
+    return MP_OBJ_NEW_SMALL_INT(self->pixel[idx] & SB_IMAGE_VALUE_MASK);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(sb_image_get_pixel_obj, sb_image_get_pixel);
+
+// set_pixel_color(x, y, color): light the pixel with its own colour
+STATIC mp_obj_t sb_image_set_pixel_color(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    sb_image_check_writable(self);
+    uint8_t rgb[3];
+    sb_image_parse_color(args[3], rgb);
+    size_t idx = sb_image_index(self, args[1], args[2]);
+    sb_image_set_own_color(self, idx, rgb);
+    self->pixel[idx] = (self->pixel[idx] & ~SB_IMAGE_VALUE_MASK) | 1;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sb_image_set_pixel_color_obj, 4, 4, sb_image_set_pixel_color);
+
+// get_pixel_color(x, y, hex=False): (R,G,B), or a 24-bit int if hex is true
+STATIC mp_obj_t sb_image_get_pixel_color(size_t n_args, const mp_obj_t *args) {
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(args[0]);
+    size_t idx = sb_image_index(self, args[1], args[2]);
+    bool hex = n_args > 3 && mp_obj_is_true(args[3]);
+    return sb_image_color_obj(sb_image_pixel_color(self, idx), hex);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sb_image_get_pixel_color_obj, 3, 4, sb_image_get_pixel_color);
+
+STATIC mp_obj_t sb_image_set_base_color(mp_obj_t self_in, mp_obj_t color_in) {
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    sb_image_check_writable(self);
+    sb_image_parse_color(color_in, self->base_color);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(sb_image_set_base_color_obj, sb_image_set_base_color);
+
+STATIC mp_obj_t sb_image_get_base_color(mp_obj_t self_in) {
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    return sb_image_color_obj(self->base_color, false);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_image_get_base_color_obj, sb_image_get_base_color);
+
+// New image with the contents moved by (dx, dy); vacated pixels are off
+STATIC mp_obj_t sb_image_shift(mp_obj_t self_in, mp_int_t dx, mp_int_t dy) {
+    sb_image_obj_t *self = MP_OBJ_TO_PTR(self_in);
+    sb_image_obj_t *img = sb_image_new_like(self);
+    mp_int_t w = self->width;
+    mp_int_t h = self->height;
+    for (mp_int_t y = MAX(dy, 0); y < MIN(h, h + dy); ++y) {
+        mp_int_t x0 = MAX(dx, 0);
+        mp_int_t x1 = MIN(w, w + dx);
+        if (x0 >= x1) {
+            break;
+        }
+        size_t dst = y * w + x0;
+        size_t src = (y - dy) * w + x0 - dx;
+        memcpy(&img->pixel[dst], &self->pixel[src], x1 - x0);
+        if (img->rgb != NULL) {
+            memcpy(&img->rgb[dst * 3], &self->rgb[src * 3], (x1 - x0) * 3);
+        }
+    }
+    return MP_OBJ_FROM_PTR(img);
+}
+
+STATIC mp_obj_t sb_image_shift_left(mp_obj_t self_in, mp_obj_t n_in) {
+    return sb_image_shift(self_in, -mp_obj_get_int(n_in), 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(sb_image_shift_left_obj, sb_image_shift_left);
+
+STATIC mp_obj_t sb_image_shift_right(mp_obj_t self_in, mp_obj_t n_in) {
+    return sb_image_shift(self_in, mp_obj_get_int(n_in), 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(sb_image_shift_right_obj, sb_image_shift_right);
+
+STATIC mp_obj_t sb_image_shift_up(mp_obj_t self_in, mp_obj_t n_in) {
+    return sb_image_shift(self_in, 0, -mp_obj_get_int(n_in));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(sb_image_shift_up_obj, sb_image_shift_up);
+
+STATIC mp_obj_t sb_image_shift_down(mp_obj_t self_in, mp_obj_t n_in) {
+    return sb_image_shift(self_in, 0, mp_obj_get_int(n_in));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(sb_image_shift_down_obj, sb_image_shift_down);
+
+STATIC mp_obj_t sb_image_copy(mp_obj_t self_in) {
+    return sb_image_shift(self_in, 0, 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_image_copy_obj, sb_image_copy);
+
+STATIC const mp_rom_map_elem_t sb_image_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_width), MP_ROM_PTR(&sb_image_width_obj) },
+    { MP_ROM_QSTR(MP_QSTR_height), MP_ROM_PTR(&sb_image_height_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_pixel), MP_ROM_PTR(&sb_image_set_pixel_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_pixel), MP_ROM_PTR(&sb_image_get_pixel_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_pixel_color), MP_ROM_PTR(&sb_image_set_pixel_color_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_pixel_color), MP_ROM_PTR(&sb_image_get_pixel_color_obj) },
+    { MP_ROM_QSTR(MP_QSTR_set_base_color), MP_ROM_PTR(&sb_image_set_base_color_obj) },
+    { MP_ROM_QSTR(MP_QSTR___get_base_color), MP_ROM_PTR(&sb_image_get_base_color_obj) },
+    { MP_ROM_QSTR(MP_QSTR_shift_left), MP_ROM_PTR(&sb_image_shift_left_obj) },
+    { MP_ROM_QSTR(MP_QSTR_shift_right), MP_ROM_PTR(&sb_image_shift_right_obj) },
+    { MP_ROM_QSTR(MP_QSTR_shift_up), MP_ROM_PTR(&sb_image_shift_up_obj) },
+    { MP_ROM_QSTR(MP_QSTR_shift_down), MP_ROM_PTR(&sb_image_shift_down_obj) },
+    { MP_ROM_QSTR(MP_QSTR_copy), MP_ROM_PTR(&sb_image_copy_obj) },
+
+    SB_IMAGE_BUILTIN_LOCALS
+};
+STATIC MP_DEFINE_CONST_DICT(sb_image_locals_dict, sb_image_locals_dict_table);
+
+const mp_obj_type_t studuinobit_image_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Image,
+    .print = sb_image_print,
+    .make_new = sb_image_make_new,
+    .binary_op = sb_image_binary_op,
+    .locals_dict = (mp_obj_dict_t*)&sb_image_locals_dict,
+};
@@ -0,0 +1,467 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_task.h"
+#include "esp_timer.h"
+#include "driver/i2c.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/mphal.h"
+#include "modmachine.h"
+#include "modstuduinobit.h"
+
+// Background sampling of the ICM20948 (and the AK09916 behind its I2C
+// bypass).  An esp_timer wakes a FreeRTOS task that runs above the
+// MicroPython task, reads one frame over the hardware I2C controller and
+// appends it to a single-producer/single-consumer ring buffer, so frames
+// are taken on time whatever the Python code is doing.  While sampling the
+// task shares the hardware I2C controller with pystubit's machine.I2C(0);
+// the driver serialises their transactions.  Every frame also feeds the gesture
+// recogniser and is kept as the latest reading, even when the ring is full.
+
+#define SB_IMU_I2C_PORT         (I2C_NUM_0)
+#define SB_IMU_I2C_FREQ         (400000)
+#define SB_IMU_I2C_TIMEOUT_MS   (10)
+#define SB_IMU_TASK_PRIORITY    (ESP_TASK_PRIO_MIN + 2)
+#define SB_IMU_TASK_STACK_SIZE  (2048)
+
+#define SB_IMU_ICM20948_ADDR    (0x69)
+#define SB_IMU_ACCEL_XOUT_H     (0x2d)
+#define SB_IMU_REG_BANK_SEL     (0x7f)
+#define SB_IMU_ACCEL_CONFIG     (0x14)  // in bank 2
+#define SB_IMU_AK09916_ADDR     (0x0c)
+#define SB_IMU_AK09916_ST1      (0x10)
+
+// The magnetometer runs at most at 100Hz, read it no more often than this
+#define SB_IMU_MAG_PERIOD_US    (10000)
+
+#define SB_IMU_PERIOD_MIN_US    (500)
+
+// Frame flag: mag holds a new magnetometer reading rather than a repeat
+#define SB_IMU_FLAG_MAG         (0x0001)
+
+// A frame as seen from Python is ustruct format '<I9hH': the esp_timer
+// time in microseconds (wrapping), raw accelerometer, gyro and
+// magnetometer X, Y, Z readings, then the flags.
+typedef struct _sb_imu_frame_t {
+    uint32_t time_us;
+    int16_t accel[3];
+    int16_t gyro[3];
+    int16_t mag[3];
+    uint16_t flags;
+} sb_imu_frame_t;
+
+typedef struct _sb_imu_t {
+    TaskHandle_t task;
+    esp_timer_handle_t timer;
+    volatile bool running;
+    bool mag;
+    bool i2c_installed;
+    uint32_t last_mag_us;
+    int16_t last_mag[3];
+    uint32_t capacity;
+    sb_imu_frame_t *ring;
+    // most recent frame, odd seq while the task is writing it
+    volatile uint32_t latest_seq;
+    sb_imu_frame_t latest;
+    // free-running frame counters, head is only written by the task and
+    // tail only by the MicroPython side
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t overruns;
+    volatile uint32_t errors;
+} sb_imu_t;
+
+STATIC sb_imu_t sb_imu;
+
+STATIC esp_err_t sb_imu_read_reg(uint8_t addr, uint8_t reg, uint8_t *buf, size_t len) {
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr << 1 | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, reg, true);
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr << 1 | I2C_MASTER_READ, true);
+    i2c_master_read(cmd, buf, len, I2C_MASTER_LAST_NACK);
+    i2c_master_stop(cmd);
+    esp_err_t err = i2c_master_cmd_begin(SB_IMU_I2C_PORT, cmd, SB_IMU_I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    return err;
+}
+
+STATIC esp_err_t sb_imu_write_reg(uint8_t addr, uint8_t reg, uint8_t value) {
+    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    i2c_master_start(cmd);
+    i2c_master_write_byte(cmd, addr << 1 | I2C_MASTER_WRITE, true);
+    i2c_master_write_byte(cmd, reg, true);
+    i2c_master_write_byte(cmd, value, true);
+    i2c_master_stop(cmd);
+    esp_err_t err = i2c_master_cmd_begin(SB_IMU_I2C_PORT, cmd, SB_IMU_I2C_TIMEOUT_MS / portTICK_PERIOD_MS);
+    i2c_cmd_link_delete(cmd);
+    return err;
+}
+
+// ACCEL_FS_SEL as configured by pystubit, for the gesture thresholds
+STATIC esp_err_t sb_imu_read_accel_fs(uint8_t *fs) {
+    esp_err_t err = sb_imu_write_reg(SB_IMU_ICM20948_ADDR, SB_IMU_REG_BANK_SEL, 0x20);
+    if (err == ESP_OK) {
+        err = sb_imu_read_reg(SB_IMU_ICM20948_ADDR, SB_IMU_ACCEL_CONFIG, fs, 1);
+        *fs = (*fs >> 1) & 3;
+    }
+    if (sb_imu_write_reg(SB_IMU_ICM20948_ADDR, SB_IMU_REG_BANK_SEL, 0x00) != ESP_OK) {
+        err = ESP_FAIL;
+    }
+    return err;
+}
+
+STATIC bool sb_imu_sample(sb_imu_frame_t *frame) {
+    uint8_t buf[12];
+    frame->time_us = esp_timer_get_time();
+    frame->flags = 0;
+
+    // ACCEL_XOUT_H to GYRO_ZOUT_L, big endian
+    if (sb_imu_read_reg(SB_IMU_ICM20948_ADDR, SB_IMU_ACCEL_XOUT_H, buf, 12) != ESP_OK) {
+        return false;
+    }
+    for (int i = 0; i < 3; ++i) {
+        frame->accel[i] = buf[2 * i] << 8 | buf[2 * i + 1];
+        frame->gyro[i] = buf[6 + 2 * i] << 8 | buf[6 + 2 * i + 1];
+    }
+
+    // ST1, HXL to HZH, TMPS and ST2, little endian; reading ST2 releases
+    // the data registers for the next measurement
+    if (sb_imu.mag && frame->time_us - sb_imu.last_mag_us >= SB_IMU_MAG_PERIOD_US) {
+        if (sb_imu_read_reg(SB_IMU_AK09916_ADDR, SB_IMU_AK09916_ST1, buf, 9) != ESP_OK) {
+            return false;
+        }
+        if (buf[0] & 1) {
+            for (int i = 0; i < 3; ++i) {
+                sb_imu.last_mag[i] = buf[2 + 2 * i] << 8 | buf[1 + 2 * i];
+            }
+            frame->flags = SB_IMU_FLAG_MAG;
+        }
+        sb_imu.last_mag_us = frame->time_us;
+    }
+    memcpy(frame->mag, sb_imu.last_mag, sizeof(frame->mag));
+    return true;
+}
+
+STATIC void sb_imu_set_latest(const sb_imu_frame_t *frame) {
+    uint32_t seq = sb_imu.latest_seq;
+    __atomic_store_n(&sb_imu.latest_seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    sb_imu.latest = *frame;
+    __atomic_store_n(&sb_imu.latest_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+STATIC void sb_imu_get_latest(sb_imu_frame_t *frame) {
+    uint32_t seq;
+    do {
+        seq = __atomic_load_n(&sb_imu.latest_seq, __ATOMIC_ACQUIRE);
+        *frame = sb_imu.latest;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((seq & 1) || seq != sb_imu.latest_seq);
+}
+
+STATIC void sb_imu_task(void *arg) {
+    (void)arg;
+    sb_imu_frame_t frame;
+    while (sb_imu.running) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!sb_imu.running) {
+            break;
+        }
+        if (!sb_imu_sample(&frame)) {
+            ++sb_imu.errors;
+            continue;
+        }
+        sb_imu_set_latest(&frame);
+        studuinobit_gesture_update(frame.accel, frame.time_us);
+        uint32_t head = sb_imu.head;
+        if (head - sb_imu.tail >= sb_imu.capacity) {
+            // the reader has fallen behind, drop this frame
+            ++sb_imu.overruns;
+            continue;
+        }
+        sb_imu.ring[head % sb_imu.capacity] = frame;
+        // make the frame visible before publishing it
+        __atomic_store_n(&sb_imu.head, head + 1, __ATOMIC_RELEASE);
+    }
+    sb_imu.task = NULL;
+    vTaskDelete(NULL);
+}
+
+STATIC void sb_imu_timer_cb(void *arg) {
+    (void)arg;
+    TaskHandle_t task = sb_imu.task;
+    if (task != NULL) {
+        xTaskNotifyGive(task);
+    }
+}
+
+STATIC void sb_imu_stop_internal(void) {
+    if (sb_imu.timer != NULL) {
+        esp_timer_stop(sb_imu.timer);
+    }
+    if (sb_imu.task != NULL) {
+        sb_imu.running = false;
+        xTaskNotifyGive(sb_imu.task);
+        while (sb_imu.task != NULL) {
+            vTaskDelay(1);
+        }
+    }
+    if (sb_imu.i2c_installed) {
+        machine_hw_i2c_release(SB_IMU_I2C_PORT);
+        sb_imu.i2c_installed = false;
+    }
+    free(sb_imu.ring);
+    sb_imu.ring = NULL;
+    sb_imu.capacity = 0;
+}
+
+STATIC uint32_t sb_imu_available(void) {
+    return __atomic_load_n(&sb_imu.head, __ATOMIC_ACQUIRE) - sb_imu.tail;
+}
+
+// Copy up to n frames out of the ring and release their slots
+STATIC uint32_t sb_imu_pop(uint8_t *dest, uint32_t n) {
+    uint32_t avail = sb_imu_available();
+    if (n > avail) {
+        n = avail;
+    }
+    uint32_t tail = sb_imu.tail;
+    for (uint32_t i = 0; i < n; ++i) {
+        memcpy(dest, &sb_imu.ring[(tail + i) % sb_imu.capacity], sizeof(sb_imu_frame_t));
+        dest += sizeof(sb_imu_frame_t);
+    }
+    __atomic_store_n(&sb_imu.tail, tail + n, __ATOMIC_RELEASE);
+    return n;
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+// start(period_us=1000, frames=256, mag=True)
+STATIC mp_obj_t sb_imu_start(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_period_us, ARG_frames, ARG_mag };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_period_us, MP_ARG_INT, {.u_int = 1000} },
+        { MP_QSTR_frames, MP_ARG_INT, {.u_int = 256} },
+        { MP_QSTR_mag, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = true} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_period_us].u_int < SB_IMU_PERIOD_MIN_US) {
+        mp_raise_ValueError("period too short");
+    }
+    if (args[ARG_frames].u_int <= 0) {
+        mp_raise_ValueError("frames must be positive");
+    }
+
+    sb_imu_stop_internal();
+
+    // staging buffer for read(), on the GC heap so returned memoryviews
+    // keep it alive
+    uint32_t capacity = args[ARG_frames].u_int;
+    MP_STATE_PORT(studuinobit_imu_out) = m_new(uint8_t, capacity * sizeof(sb_imu_frame_t));
+    sb_imu.ring = malloc(capacity * sizeof(sb_imu_frame_t));
+    if (sb_imu.ring == NULL) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    sb_imu.capacity = capacity;
+    sb_imu.head = 0;
+    sb_imu.tail = 0;
+    sb_imu.overruns = 0;
+    sb_imu.errors = 0;
+    sb_imu.mag = args[ARG_mag].u_bool;
+    sb_imu.last_mag_us = esp_timer_get_time() - SB_IMU_MAG_PERIOD_US;
+    memset(sb_imu.last_mag, 0, sizeof(sb_imu.last_mag));
+
+    // shared with machine.I2C(0), which pystubit uses for the same bus
+    if (machine_hw_i2c_claim(SB_IMU_I2C_PORT, SB_IMU_SCL_PIN, SB_IMU_SDA_PIN, SB_IMU_I2C_FREQ) != ESP_OK) {
+        sb_imu_stop_internal();
+        mp_raise_OSError(MP_EIO);
+    }
+    sb_imu.i2c_installed = true;
+
+    // take the first frame now so that latest_into() is valid straight away
+    uint8_t accel_fs;
+    sb_imu_frame_t frame;
+    if (sb_imu_read_accel_fs(&accel_fs) != ESP_OK || !sb_imu_sample(&frame)) {
+        sb_imu_stop_internal();
+        mp_raise_OSError(MP_EIO);
+    }
+    sb_imu_set_latest(&frame);
+    studuinobit_gesture_reset(accel_fs);
+
+    if (sb_imu.timer == NULL) {
+        esp_timer_create_args_t timer_args = {
+            .callback = sb_imu_timer_cb,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "sb_imu",
+        };
+        if (esp_timer_create(&timer_args, &sb_imu.timer) != ESP_OK) {
+            sb_imu_stop_internal();
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+
+    sb_imu.running = true;
+    if (xTaskCreate(sb_imu_task, "sb_imu", SB_IMU_TASK_STACK_SIZE / sizeof(StackType_t),
+            NULL, SB_IMU_TASK_PRIORITY, &sb_imu.task) != pdPASS) {
+        sb_imu.running = false;
+        sb_imu.task = NULL;
+        sb_imu_stop_internal();
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    esp_timer_start_periodic(sb_imu.timer, args[ARG_period_us].u_int);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sb_imu_start_obj, 0, sb_imu_start);
+
+STATIC mp_obj_t sb_imu_stop(void) {
+    sb_imu_stop_internal();
+    MP_STATE_PORT(studuinobit_imu_out) = NULL;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_imu_stop_obj, sb_imu_stop);
+
+STATIC mp_obj_t sb_imu_running(void) {
+    return mp_obj_new_bool(sb_imu.running);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_imu_running_obj, sb_imu_running);
+
+STATIC mp_obj_t sb_imu_any(void) {
+    return mp_obj_new_int_from_uint(sb_imu.capacity == 0 ? 0 : sb_imu_available());
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_imu_any_obj, sb_imu_any);
+
+// read([n]): memoryview of up to n frames (all buffered frames by default),
+// valid until the next call to read() or start()
+STATIC mp_obj_t sb_imu_read(size_t n_args, const mp_obj_t *args) {
+    uint8_t *out = MP_STATE_PORT(studuinobit_imu_out);
+    if (out == NULL) {
+        mp_raise_msg(&mp_type_RuntimeError, "IMU sampling not started");
+    }
+    mp_int_t n = n_args > 0 ? mp_obj_get_int(args[0]) : -1;
+    if (n < 0 || (mp_uint_t)n > sb_imu.capacity) {
+        n = sb_imu.capacity;
+    }
+    n = sb_imu_pop(out, n);
+    return mp_obj_new_memoryview('B', n * sizeof(sb_imu_frame_t), out);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sb_imu_read_obj, 0, 1, sb_imu_read);
+
+// readinto(buf): copy as many whole frames as fit, return how many
+STATIC mp_obj_t sb_imu_readinto(mp_obj_t buf_in) {
+    if (sb_imu.capacity == 0) {
+        mp_raise_msg(&mp_type_RuntimeError, "IMU sampling not started");
+    }
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+    uint32_t n = sb_imu_pop(bufinfo.buf, bufinfo.len / sizeof(sb_imu_frame_t));
+    return MP_OBJ_NEW_SMALL_INT(n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_imu_readinto_obj, sb_imu_readinto);
+
+// latest_into(buf): copy the raw accel, gyro and mag readings of the most
+// recent frame into buf[0:9], an array('h') or a list
+STATIC mp_obj_t sb_imu_latest_into(mp_obj_t buf_in) {
+    if (!sb_imu.running) {
+        mp_raise_msg(&mp_type_RuntimeError, "IMU sampling not started");
+    }
+    sb_imu_frame_t frame;
+    sb_imu_get_latest(&frame);
+    const int16_t *raw = frame.accel;
+    if (mp_obj_is_type(buf_in, &mp_type_list)) {
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_list_get(buf_in, &len, &items);
+        if (len < 9) {
+            mp_raise_ValueError("buffer too small");
+        }
+        for (int i = 0; i < 9; ++i) {
+            items[i] = MP_OBJ_NEW_SMALL_INT(raw[i]);
+        }
+    } else {
+        mp_buffer_info_t bufinfo;
+        mp_get_buffer_raise(buf_in, &bufinfo, MP_BUFFER_WRITE);
+        if (bufinfo.typecode != 'h' || bufinfo.len < 9 * sizeof(int16_t)) {
+            mp_raise_ValueError("buffer must be array('h') of at least 9");
+        }
+        memcpy(bufinfo.buf, raw, 9 * sizeof(int16_t));
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_imu_latest_into_obj, sb_imu_latest_into);
+
+// stats(): (frames dropped because the ring was full, failed I2C reads)
+STATIC mp_obj_t sb_imu_stats(void) {
+    mp_obj_t tuple[2] = {
+        mp_obj_new_int_from_uint(sb_imu.overruns),
+        mp_obj_new_int_from_uint(sb_imu.errors),
+    };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_imu_stats_obj, sb_imu_stats);
+
+void studuinobit_imu_deinit(void) {
+    sb_imu_stop_internal();
+    MP_STATE_PORT(studuinobit_imu_out) = NULL;
+}
+
+STATIC const mp_rom_map_elem_t sb_imu_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_imu) },
+    { MP_ROM_QSTR(MP_QSTR_start), MP_ROM_PTR(&sb_imu_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&sb_imu_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_running), MP_ROM_PTR(&sb_imu_running_obj) },
+    { MP_ROM_QSTR(MP_QSTR_any), MP_ROM_PTR(&sb_imu_any_obj) },
+    { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&sb_imu_read_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&sb_imu_readinto_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&sb_imu_stats_obj) },
+    { MP_ROM_QSTR(MP_QSTR_latest_into), MP_ROM_PTR(&sb_imu_latest_into_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_current_gesture), MP_ROM_PTR(&studuinobit_gesture_current_obj) },
+    { MP_ROM_QSTR(MP_QSTR_is_gesture), MP_ROM_PTR(&studuinobit_gesture_is_obj) },
+    { MP_ROM_QSTR(MP_QSTR_was_gesture), MP_ROM_PTR(&studuinobit_gesture_was_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_gestures), MP_ROM_PTR(&studuinobit_gesture_get_all_obj) },
+
+    { MP_ROM_QSTR(MP_QSTR_FRAME_SIZE), MP_ROM_INT(sizeof(sb_imu_frame_t)) },
+    { MP_ROM_QSTR(MP_QSTR_FLAG_MAG), MP_ROM_INT(SB_IMU_FLAG_MAG) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_imu_module_globals, sb_imu_module_globals_table);
+
+const mp_obj_module_t studuinobit_imu_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&sb_imu_module_globals,
+};
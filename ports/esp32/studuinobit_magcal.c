@@ -0,0 +1,329 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "py/runtime.h"
+#include "modmachine.h"
+#include "modstuduinobit.h"
+
+// Incremental hard and soft iron calibration of the magnetometer.  Each raw
+// sample updates the per-axis min/max and the normal equations of a least
+// squares fit of the axis aligned ellipsoid
+//     A x^2 + B y^2 + C z^2 + D x + E y + F z = 1
+// so no samples are kept.  The fit gives the centre (hard iron offset) and
+// the radii (soft iron scale); min/max is the fallback when the samples are
+// too poorly spread for the fit to be trusted.  Results are stored in NVS
+// as a fixed size blob.
+
+#define SB_MAGCAL_NUM_PARAMS    (6)
+
+// Samples and spread needed before ready() reports the calibration as
+// usable: every axis must span at least SB_MAGCAL_READY_COVERAGE percent of
+// the widest one, which in turn must be at least SB_MAGCAL_MIN_SPAN raw
+// digits (30uT, well under the diameter of the earth's field).
+#define SB_MAGCAL_MIN_SAMPLES   (64)
+#define SB_MAGCAL_READY_COVERAGE (75)
+#define SB_MAGCAL_MIN_SPAN      (200)
+
+// The fitted radii may differ from each other by at most this factor
+#define SB_MAGCAL_MAX_RADIUS_RATIO (2.0)
+
+#define SB_MAGCAL_NVS_KEY       "sb_magcal"
+#define SB_MAGCAL_NVS_VERSION   (1)
+
+typedef struct _sb_magcal_blob_t {
+    uint32_t version;
+    float offset[3];
+    float scale[3];
+} sb_magcal_blob_t;
+
+typedef struct _sb_magcal_t {
+    uint32_t n;
+    int16_t min[3];
+    int16_t max[3];
+    // upper triangle of sum(r r^T) and sum(r), r = (x^2, y^2, z^2, x, y, z)
+    double ata[SB_MAGCAL_NUM_PARAMS][SB_MAGCAL_NUM_PARAMS];
+    double atb[SB_MAGCAL_NUM_PARAMS];
+} sb_magcal_t;
+
+STATIC sb_magcal_t sb_magcal;
+
+STATIC void sb_magcal_add(const int16_t raw[3]) {
+    if (sb_magcal.n == 0) {
+        memcpy(sb_magcal.min, raw, sizeof(sb_magcal.min));
+        memcpy(sb_magcal.max, raw, sizeof(sb_magcal.max));
+    }
+    for (int i = 0; i < 3; ++i) {
+        if (raw[i] < sb_magcal.min[i]) {
+            sb_magcal.min[i] = raw[i];
+        }
+        if (raw[i] > sb_magcal.max[i]) {
+            sb_magcal.max[i] = raw[i];
+        }
+    }
+    double r[SB_MAGCAL_NUM_PARAMS];
+    for (int i = 0; i < 3; ++i) {
+        r[i] = (double)raw[i] * raw[i];
+        r[3 + i] = raw[i];
+    }
+    for (int i = 0; i < SB_MAGCAL_NUM_PARAMS; ++i) {
+        for (int j = i; j < SB_MAGCAL_NUM_PARAMS; ++j) {
+            sb_magcal.ata[i][j] += r[i] * r[j];
+        }
+        sb_magcal.atb[i] += r[i];
+    }
+    ++sb_magcal.n;
+}
+
+// Percentage of the widest axis span covered by the narrowest one
+STATIC int sb_magcal_spread(int *widest) {
+    int lo = INT32_MAX, hi = 0;
+    for (int i = 0; i < 3; ++i) {
+        int span = sb_magcal.max[i] - sb_magcal.min[i];
+        lo = MIN(lo, span);
+        hi = MAX(hi, span);
+    }
+    *widest = hi;
+    return hi == 0 ? 0 : lo * 100 / hi;
+}
+
+// Solve the normal equations by Gaussian elimination with partial pivoting
+STATIC bool sb_magcal_solve(double p[SB_MAGCAL_NUM_PARAMS]) {
+    double m[SB_MAGCAL_NUM_PARAMS][SB_MAGCAL_NUM_PARAMS + 1];
+    for (int i = 0; i < SB_MAGCAL_NUM_PARAMS; ++i) {
+        for (int j = 0; j < SB_MAGCAL_NUM_PARAMS; ++j) {
+            m[i][j] = i <= j ? sb_magcal.ata[i][j] : sb_magcal.ata[j][i];
+        }
+        m[i][SB_MAGCAL_NUM_PARAMS] = sb_magcal.atb[i];
+    }
+    for (int c = 0; c < SB_MAGCAL_NUM_PARAMS; ++c) {
+        int pivot = c;
+        for (int i = c + 1; i < SB_MAGCAL_NUM_PARAMS; ++i) {
+            if (fabs(m[i][c]) > fabs(m[pivot][c])) {
+                pivot = i;
+            }
+        }
+        if (m[pivot][c] == 0.0) {
+            return false;
+        }
+        if (pivot != c) {
+            for (int j = c; j <= SB_MAGCAL_NUM_PARAMS; ++j) {
+                double t = m[c][j];
+                m[c][j] = m[pivot][j];
+                m[pivot][j] = t;
+            }
+        }
+        for (int i = c + 1; i < SB_MAGCAL_NUM_PARAMS; ++i) {
+            double f = m[i][c] / m[c][c];
+            for (int j = c; j <= SB_MAGCAL_NUM_PARAMS; ++j) {
+                m[i][j] -= f * m[c][j];
+            }
+        }
+    }
+    for (int i = SB_MAGCAL_NUM_PARAMS - 1; i >= 0; --i) {
+        double s = m[i][SB_MAGCAL_NUM_PARAMS];
+        for (int j = i + 1; j < SB_MAGCAL_NUM_PARAMS; ++j) {
+            s -= m[i][j] * p[j];
+        }
+        p[i] = s / m[i][i];
+    }
+    return true;
+}
+
+// Centre and radii of the best fitting ellipsoid, false if there is none
+// or it does not look like a distorted sphere
+STATIC bool sb_magcal_fit_ellipsoid(float offset[3], float radius[3]) {
+    double p[SB_MAGCAL_NUM_PARAMS];
+    if (!sb_magcal_solve(p)) {
+        return false;
+    }
+    double g = 1.0;
+    for (int i = 0; i < 3; ++i) {
+        if (!(p[i] > 0.0)) {
+            return false;
+        }
+        offset[i] = -p[3 + i] / (2.0 * p[i]);
+        g += p[3 + i] * p[3 + i] / (4.0 * p[i]);
+    }
+    for (int i = 0; i < 3; ++i) {
+        radius[i] = sqrt(g / p[i]);
+        // the centre must lie within the samples seen
+        if (!(offset[i] > sb_magcal.min[i] && offset[i] < sb_magcal.max[i])) {
+            return false;
+        }
+    }
+    float lo = MIN(radius[0], MIN(radius[1], radius[2]));
+    float hi = MAX(radius[0], MAX(radius[1], radius[2]));
+    return hi <= lo * SB_MAGCAL_MAX_RADIUS_RATIO;
+}
+
+STATIC void sb_magcal_check_nvs(void) {
+    if (mpy_nvs_handle == 0) {
+        mp_raise_msg(&mp_type_OSError, "NVS not available!");
+    }
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+// reset(): forget all samples and start a new calibration
+STATIC mp_obj_t sb_magcal_reset(void) {
+    memset(&sb_magcal, 0, sizeof(sb_magcal));
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_magcal_reset_obj, sb_magcal_reset);
+
+// add(raw): feed one raw X, Y, Z magnetometer reading, eg the list filled
+// by AK09916.magnetic_raw_into()
+STATIC mp_obj_t sb_magcal_add_sample(mp_obj_t raw_in) {
+    int16_t raw[3];
+    for (int i = 0; i < 3; ++i) {
+        raw[i] = mp_obj_get_int(mp_obj_subscr(raw_in, MP_OBJ_NEW_SMALL_INT(i), MP_OBJ_SENTINEL));
+    }
+    sb_magcal_add(raw);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_magcal_add_obj, sb_magcal_add_sample);
+
+STATIC mp_obj_t sb_magcal_count(void) {
+    return mp_obj_new_int_from_uint(sb_magcal.n);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_magcal_count_obj, sb_magcal_count);
+
+STATIC mp_obj_t sb_magcal_coverage(void) {
+    int widest;
+    return MP_OBJ_NEW_SMALL_INT(sb_magcal_spread(&widest));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_magcal_coverage_obj, sb_magcal_coverage);
+
+// ready(): True once the samples are spread widely enough for fit()
+STATIC mp_obj_t sb_magcal_ready(void) {
+    int widest;
+    int coverage = sb_magcal_spread(&widest);
+    return mp_obj_new_bool(sb_magcal.n >= SB_MAGCAL_MIN_SAMPLES
+        && widest >= SB_MAGCAL_MIN_SPAN && coverage >= SB_MAGCAL_READY_COVERAGE);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_magcal_ready_obj, sb_magcal_ready);
+
+// fit(so=1.0): ((offset X, Y, Z), (scale X, Y, Z)) such that
+// (raw * so - offset) * scale is the corrected reading
+STATIC mp_obj_t sb_magcal_fit(size_t n_args, const mp_obj_t *args) {
+    mp_float_t so = n_args > 0 ? mp_obj_get_float(args[0]) : 1.0;
+    if (sb_magcal.n < SB_MAGCAL_NUM_PARAMS) {
+        mp_raise_ValueError("not enough samples");
+    }
+    float offset[3], radius[3];
+    if (!sb_magcal_fit_ellipsoid(offset, radius)) {
+        for (int i = 0; i < 3; ++i) {
+            offset[i] = (sb_magcal.max[i] + sb_magcal.min[i]) / 2.0f;
+            radius[i] = (sb_magcal.max[i] - sb_magcal.min[i]) / 2.0f;
+            if (radius[i] <= 0.0f) {
+                mp_raise_ValueError("not enough samples");
+            }
+        }
+    }
+    float avg = (radius[0] + radius[1] + radius[2]) / 3.0f;
+    mp_obj_t off[3], scale[3];
+    for (int i = 0; i < 3; ++i) {
+        off[i] = mp_obj_new_float(offset[i] * so);
+        scale[i] = mp_obj_new_float(avg / radius[i]);
+    }
+    mp_obj_t tuple[2] = { mp_obj_new_tuple(3, off), mp_obj_new_tuple(3, scale) };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sb_magcal_fit_obj, 0, 1, sb_magcal_fit);
+
+// save(offset, scale): store a calibration in NVS
+STATIC mp_obj_t sb_magcal_save(mp_obj_t offset_in, mp_obj_t scale_in) {
+    sb_magcal_check_nvs();
+    sb_magcal_blob_t blob = { .version = SB_MAGCAL_NVS_VERSION };
+    mp_obj_t *offset, *scale;
+    mp_obj_get_array_fixed_n(offset_in, 3, &offset);
+    mp_obj_get_array_fixed_n(scale_in, 3, &scale);
+    for (int i = 0; i < 3; ++i) {
+        blob.offset[i] = mp_obj_get_float(offset[i]);
+        blob.scale[i] = mp_obj_get_float(scale[i]);
+    }
+    esp_err_t esp_err = nvs_set_blob(mpy_nvs_handle, SB_MAGCAL_NVS_KEY, &blob, sizeof(blob));
+    if (esp_err == ESP_OK) {
+        esp_err = nvs_commit(mpy_nvs_handle);
+    }
+    if (esp_err != ESP_OK) {
+        mp_raise_msg(&mp_type_OSError, "Operation failed.");
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(sb_magcal_save_obj, sb_magcal_save);
+
+// load(): the calibration stored in NVS as (offset, scale), or None
+STATIC mp_obj_t sb_magcal_load(void) {
+    sb_magcal_check_nvs();
+    sb_magcal_blob_t blob;
+    size_t len = sizeof(blob);
+    if (nvs_get_blob(mpy_nvs_handle, SB_MAGCAL_NVS_KEY, &blob, &len) != ESP_OK
+        || len != sizeof(blob) || blob.version != SB_MAGCAL_NVS_VERSION) {
+        return mp_const_none;
+    }
+    mp_obj_t offset[3], scale[3];
+    for (int i = 0; i < 3; ++i) {
+        offset[i] = mp_obj_new_float(blob.offset[i]);
+        scale[i] = mp_obj_new_float(blob.scale[i]);
+    }
+    mp_obj_t tuple[2] = { mp_obj_new_tuple(3, offset), mp_obj_new_tuple(3, scale) };
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_magcal_load_obj, sb_magcal_load);
+
+// erase(): remove the stored calibration, if any
+STATIC mp_obj_t sb_magcal_erase(void) {
+    sb_magcal_check_nvs();
+    if (nvs_erase_key(mpy_nvs_handle, SB_MAGCAL_NVS_KEY) == ESP_OK) {
+        nvs_commit(mpy_nvs_handle);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_magcal_erase_obj, sb_magcal_erase);
+
+STATIC const mp_rom_map_elem_t sb_magcal_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_magcal) },
+    { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&sb_magcal_reset_obj) },
+    { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&sb_magcal_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_count), MP_ROM_PTR(&sb_magcal_count_obj) },
+    { MP_ROM_QSTR(MP_QSTR_coverage), MP_ROM_PTR(&sb_magcal_coverage_obj) },
+    { MP_ROM_QSTR(MP_QSTR_ready), MP_ROM_PTR(&sb_magcal_ready_obj) },
+    { MP_ROM_QSTR(MP_QSTR_fit), MP_ROM_PTR(&sb_magcal_fit_obj) },
+    { MP_ROM_QSTR(MP_QSTR_save), MP_ROM_PTR(&sb_magcal_save_obj) },
+    { MP_ROM_QSTR(MP_QSTR_load), MP_ROM_PTR(&sb_magcal_load_obj) },
+    { MP_ROM_QSTR(MP_QSTR_erase), MP_ROM_PTR(&sb_magcal_erase_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_magcal_module_globals, sb_magcal_module_globals_table);
+
+const mp_obj_module_t studuinobit_magcal_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&sb_magcal_module_globals,
+};
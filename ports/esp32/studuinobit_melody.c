@@ -0,0 +1,269 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+
+#include "py/runtime.h"
+#include "py/binary.h"
+#include "py/mperrno.h"
+#include "modmachine.h"
+#include "modstuduinobit.h"
+
+// Melody playback on a machine.PWM channel without holding up Python.  The
+// notes are copied out of the GC heap and a one-shot esp_timer walks
+// through them, retuning the LEDC channel at each note boundary.  Each note
+// is scheduled from the absolute end time of the previous one so timing
+// errors do not accumulate.  The end of every note is silenced for a
+// moment so that repeated notes stay distinct.
+//
+// The timer callback runs in the esp_timer task, which has a higher
+// priority than the MicroPython task, so on this single core build the VM
+// never sees it half way through a note change.
+
+// Timer delays shorter than this are not worth arming a timer for
+#define SB_MELODY_MIN_DELAY_US  (50)
+
+typedef struct _sb_melody_note_t {
+    uint16_t freq;
+    uint16_t ms;
+} sb_melody_note_t;
+
+typedef struct _sb_melody_t {
+    esp_timer_handle_t timer;
+    sb_melody_note_t *notes;
+    uint32_t len;
+    uint32_t pos;
+    int channel;
+    float duty;
+    uint32_t gap_us;
+    bool loop;
+    bool gap_pending;
+    uint64_t note_end;
+    volatile bool playing;
+} sb_melody_t;
+
+STATIC sb_melody_t sb_melody;
+
+STATIC void sb_melody_schedule(uint64_t at) {
+    int64_t delay = at - esp_timer_get_time();
+    esp_timer_start_once(sb_melody.timer, delay > SB_MELODY_MIN_DELAY_US ? delay : SB_MELODY_MIN_DELAY_US);
+}
+
+STATIC void sb_melody_finish(void) {
+    sb_melody.playing = false;
+    machine_pwm_set_tone(sb_melody.channel, 0, 0);
+}
+
+STATIC void sb_melody_step(void *arg) {
+    (void)arg;
+    sb_melody_t *m = &sb_melody;
+    if (!m->playing) {
+        return;
+    }
+    if (m->gap_pending) {
+        // silence the tail of the current note
+        m->gap_pending = false;
+        machine_pwm_set_tone(m->channel, 0, 0);
+        sb_melody_schedule(m->note_end);
+        return;
+    }
+    if (m->pos == m->len) {
+        if (!m->loop) {
+            sb_melody_finish();
+            return;
+        }
+        m->pos = 0;
+    }
+    const sb_melody_note_t *note = &m->notes[m->pos++];
+    if (!machine_pwm_set_tone(m->channel, note->freq, m->duty)) {
+        // the PWM channel has gone away
+        sb_melody_finish();
+        return;
+    }
+    uint32_t note_us = note->ms * 1000;
+    m->note_end += note_us;
+    if (note->freq > 0 && note_us > 2 * m->gap_us) {
+        m->gap_pending = true;
+        sb_melody_schedule(m->note_end - m->gap_us);
+    } else {
+        sb_melody_schedule(m->note_end);
+    }
+}
+
+STATIC void sb_melody_stop_internal(void) {
+    if (sb_melody.timer != NULL) {
+        esp_timer_stop(sb_melody.timer);
+    }
+    if (sb_melody.playing) {
+        sb_melody_finish();
+    }
+    free(sb_melody.notes);
+    sb_melody.notes = NULL;
+    sb_melody.len = 0;
+}
+
+STATIC void sb_melody_note_check(mp_int_t freq, mp_int_t ms) {
+    if (freq < 0 || freq > 0xffff) {
+        mp_raise_ValueError("bad frequency");
+    }
+    if (ms < 0 || ms > 0xffff) {
+        mp_raise_ValueError("bad duration");
+    }
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+// play(pwm, notes, *, duty=10, loop=False, gap_ms=10)
+//
+// notes is either a sequence of (frequency, milliseconds) pairs or an
+// integer array of alternating frequencies and durations, eg array('H').
+// A frequency of 0 is a rest.
+STATIC mp_obj_t sb_melody_play(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_pwm, ARG_notes, ARG_duty, ARG_loop, ARG_gap_ms };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_pwm, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_notes, MP_ARG_REQUIRED | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_duty, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = MP_OBJ_NULL} },
+        { MP_QSTR_loop, MP_ARG_KW_ONLY | MP_ARG_BOOL, {.u_bool = false} },
+        { MP_QSTR_gap_ms, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = 10} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    int channel = machine_pwm_get_channel(args[ARG_pwm].u_obj);
+    if (channel < 0) {
+        mp_raise_ValueError("PWM not active");
+    }
+    float duty = args[ARG_duty].u_obj == MP_OBJ_NULL ? 10.0f : mp_obj_get_float(args[ARG_duty].u_obj);
+    if (duty < 0.0f || duty > 100.0f) {
+        mp_raise_ValueError("duty must be 0-100");
+    }
+    if (args[ARG_gap_ms].u_int < 0) {
+        mp_raise_ValueError("gap_ms must not be negative");
+    }
+
+    // parse into a temporary buffer so a bad note leaves any current
+    // melody playing
+    mp_obj_t notes_in = args[ARG_notes].u_obj;
+    mp_buffer_info_t bufinfo;
+    size_t len;
+    sb_melody_note_t *notes;
+    if (mp_get_buffer(notes_in, &bufinfo, MP_BUFFER_READ)) {
+        len = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL) / 2;
+        notes = m_new(sb_melody_note_t, len);
+        for (size_t i = 0; i < len; ++i) {
+            mp_int_t freq = mp_obj_get_int(mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, 2 * i));
+            mp_int_t ms = mp_obj_get_int(mp_binary_get_val_array(bufinfo.typecode, bufinfo.buf, 2 * i + 1));
+            sb_melody_note_check(freq, ms);
+            notes[i].freq = freq;
+            notes[i].ms = ms;
+        }
+    } else {
+        mp_obj_t *items;
+        mp_obj_get_array(notes_in, &len, &items);
+        notes = m_new(sb_melody_note_t, len);
+        for (size_t i = 0; i < len; ++i) {
+            mp_obj_t *note;
+            mp_obj_get_array_fixed_n(items[i], 2, &note);
+            mp_int_t freq = mp_obj_get_int(note[0]);
+            mp_int_t ms = mp_obj_get_int(note[1]);
+            sb_melody_note_check(freq, ms);
+            notes[i].freq = freq;
+            notes[i].ms = ms;
+        }
+    }
+
+    sb_melody_stop_internal();
+    if (len == 0) {
+        m_del(sb_melody_note_t, notes, len);
+        return mp_const_none;
+    }
+    if (sb_melody.timer == NULL) {
+        esp_timer_create_args_t timer_args = {
+            .callback = sb_melody_step,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "sb_melody",
+        };
+        if (esp_timer_create(&timer_args, &sb_melody.timer) != ESP_OK) {
+            m_del(sb_melody_note_t, notes, len);
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+    sb_melody.notes = malloc(len * sizeof(sb_melody_note_t));
+    if (sb_melody.notes == NULL) {
+        m_del(sb_melody_note_t, notes, len);
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    memcpy(sb_melody.notes, notes, len * sizeof(sb_melody_note_t));
+    m_del(sb_melody_note_t, notes, len);
+
+    sb_melody.len = len;
+    sb_melody.pos = 0;
+    sb_melody.channel = channel;
+    sb_melody.duty = duty;
+    sb_melody.gap_us = args[ARG_gap_ms].u_int * 1000;
+    sb_melody.loop = args[ARG_loop].u_bool;
+    sb_melody.gap_pending = false;
+    sb_melody.note_end = esp_timer_get_time();
+    sb_melody.playing = true;
+    // the first note starts straight away
+    sb_melody_step(NULL);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sb_melody_play_obj, 2, sb_melody_play);
+
+STATIC mp_obj_t sb_melody_stop(void) {
+    sb_melody_stop_internal();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_melody_stop_obj, sb_melody_stop);
+
+STATIC mp_obj_t sb_melody_playing(void) {
+    return mp_obj_new_bool(sb_melody.playing);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_melody_playing_obj, sb_melody_playing);
+
+void studuinobit_melody_deinit(void) {
+    sb_melody_stop_internal();
+}
+
+STATIC const mp_rom_map_elem_t sb_melody_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_melody) },
+    { MP_ROM_QSTR(MP_QSTR_play), MP_ROM_PTR(&sb_melody_play_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&sb_melody_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_playing), MP_ROM_PTR(&sb_melody_playing_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_melody_module_globals, sb_melody_module_globals_table);
+
+const mp_obj_module_t studuinobit_melody_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&sb_melody_module_globals,
+};
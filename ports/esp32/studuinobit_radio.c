@@ -0,0 +1,577 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_now.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "py/unicode.h"
+#include "modnetwork.h"
+#include "modstuduinobit.h"
+
+// micro:bit style radio over ESP-NOW broadcasts.  Every frame starts with
+// the DAL header (version, group, protocol) followed by the PXT packet
+// header (type and four reserved bytes) and the payload:
+//
+//   number  int32, big endian
+//   value   int32, big endian, then the name as UTF-8
+//   string  UTF-8
+//   bytes   raw bytes
+//
+// Frames are picked up by a hook on the ESP-NOW receive path, filtered by
+// group on the WiFi task and copied into a bounded queue of `queue` slots
+// of `length` bytes each.  Frames that are not radio frames carry on to the
+// espnow module.  When the queue is full new frames are dropped.
+//
+// The reserved PXT bytes carry a hop count and a 24-bit message id (the
+// last byte of the sender's MAC and a sequence number) for relaying.
+// Boards in relay mode rebroadcast frames of their group straight from the
+// WiFi task with the hop count decremented, so messages reach boards out
+// of range of the sender.  Every board remembers recently seen messages in
+// a small hash table and drops the copies, which also keeps a message from
+// being delivered more than once.  Frames from older firmware have these
+// bytes zeroed and are neither relayed nor checked for duplicates.
+
+#define SB_RADIO_DAL_VERSION    (1)
+#define SB_RADIO_DAL_PROTOCOL   (1)
+#define SB_RADIO_HEADER_LEN     (3 + 5)
+#define SB_RADIO_NUMBER_LEN     (4)
+
+#define SB_RADIO_TYPE_NUMBER    (0)
+#define SB_RADIO_TYPE_VALUE     (1)
+#define SB_RADIO_TYPE_STRING    (2)
+#define SB_RADIO_TYPE_BYTES     (3)
+
+#define SB_RADIO_DEFAULT_LENGTH (32)
+#define SB_RADIO_DEFAULT_QUEUE  (3)
+#define SB_RADIO_MAX_QUEUE      (64)
+#define SB_RADIO_MAX_CHANNEL    (13)
+
+// Offsets of the relay fields in the PXT header
+#define SB_RADIO_TTL_OFFSET     (4)
+#define SB_RADIO_ID_OFFSET      (5)
+#define SB_RADIO_DEFAULT_TTL    (3)
+#define SB_RADIO_MAX_TTL        (15)
+
+// Duplicate cache, SB_RADIO_SEEN_BUCKETS buckets of SB_RADIO_SEEN_WAYS
+#define SB_RADIO_SEEN_BUCKETS   (16)
+#define SB_RADIO_SEEN_WAYS      (4)
+
+typedef struct _sb_radio_t {
+    // queue_len slots, each a length byte followed by up to length bytes
+    uint8_t *slots;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t received;
+    uint32_t dropped;
+    uint16_t length;
+    uint8_t queue_len;
+    uint8_t channel;
+    int16_t group;
+    bool on;
+    bool relay;
+    uint8_t ttl;
+    uint8_t mac_id;
+    uint16_t seq;
+    uint32_t relayed;
+    uint32_t duplicates;
+    uint32_t seen[SB_RADIO_SEEN_BUCKETS][SB_RADIO_SEEN_WAYS];
+    uint8_t seen_next[SB_RADIO_SEEN_BUCKETS];
+} sb_radio_t;
+
+STATIC sb_radio_t sb_radio = {
+    .length = SB_RADIO_DEFAULT_LENGTH,
+    .queue_len = SB_RADIO_DEFAULT_QUEUE,
+    .group = -1,
+    .ttl = SB_RADIO_DEFAULT_TTL,
+};
+STATIC portMUX_TYPE sb_radio_mux = portMUX_INITIALIZER_UNLOCKED;
+
+STATIC const uint8_t sb_radio_broadcast_mac[ESP_NOW_ETH_ALEN] = {
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+static inline uint8_t *sb_radio_slot(uint32_t i) {
+    return sb_radio.slots + (i % sb_radio.queue_len) * (1 + sb_radio.length);
+}
+
+// Key identifying a message in the duplicate cache, FNV-1a over the frame
+// without the hop count.  Returns 0 for frames without a message id.
+STATIC uint32_t sb_radio_key(const uint8_t *data, size_t len) {
+    if (len < SB_RADIO_HEADER_LEN
+        || (data[SB_RADIO_ID_OFFSET] | data[SB_RADIO_ID_OFFSET + 1] | data[SB_RADIO_ID_OFFSET + 2]) == 0) {
+        return 0;
+    }
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        if (i != SB_RADIO_TTL_OFFSET) {
+            hash = (hash ^ data[i]) * 16777619u;
+        }
+    }
+    return hash != 0 ? hash : 1;
+}
+
+// Record key as seen, returns true if it already was.  Call with the lock
+// held.
+STATIC bool sb_radio_seen(uint32_t key) {
+    uint32_t *bucket = sb_radio.seen[key % SB_RADIO_SEEN_BUCKETS];
+    for (size_t i = 0; i < SB_RADIO_SEEN_WAYS; ++i) {
+        if (bucket[i] == key) {
+            return true;
+        }
+    }
+    uint8_t *next = &sb_radio.seen_next[key % SB_RADIO_SEEN_BUCKETS];
+    bucket[*next] = key;
+    *next = (*next + 1) % SB_RADIO_SEEN_WAYS;
+    return false;
+}
+
+// Runs on the WiFi task
+STATIC bool sb_radio_recv_hook(const uint8_t *mac, const uint8_t *data, int len) {
+    (void)mac;
+    if (len < 3 || data[0] != SB_RADIO_DAL_VERSION || data[2] != SB_RADIO_DAL_PROTOCOL) {
+        return false;
+    }
+    uint32_t key = sb_radio_key(data, len);
+    bool relay = false;
+    portENTER_CRITICAL(&sb_radio_mux);
+    if (sb_radio.slots != NULL && data[1] == sb_radio.group) {
+        if (key != 0 && sb_radio_seen(key)) {
+            sb_radio.duplicates++;
+            portEXIT_CRITICAL(&sb_radio_mux);
+            return true;
+        }
+        relay = sb_radio.relay && key != 0 && data[SB_RADIO_TTL_OFFSET] > 0;
+        if (sb_radio.head - sb_radio.tail >= sb_radio.queue_len) {
+            sb_radio.dropped++;
+        } else {
+            uint8_t *slot = sb_radio_slot(sb_radio.head++);
+            slot[0] = len > sb_radio.length ? sb_radio.length : len;
+            memcpy(slot + 1, data, slot[0]);
+            sb_radio.received++;
+        }
+    }
+    portEXIT_CRITICAL(&sb_radio_mux);
+
+    if (relay) {
+        uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+        memcpy(frame, data, len);
+        frame[SB_RADIO_TTL_OFFSET]--;
+        if (espnow_send_frame_nowait(sb_radio_broadcast_mac, frame, len)) {
+            portENTER_CRITICAL(&sb_radio_mux);
+            sb_radio.relayed++;
+            portEXIT_CRITICAL(&sb_radio_mux);
+        }
+    }
+    return true;
+}
+
+STATIC void sb_radio_flush(void) {
+    portENTER_CRITICAL(&sb_radio_mux);
+    sb_radio.tail = sb_radio.head;
+    portEXIT_CRITICAL(&sb_radio_mux);
+}
+
+STATIC void sb_radio_free(void) {
+    espnow_set_recv_hook(NULL);
+    portENTER_CRITICAL(&sb_radio_mux);
+    uint8_t *slots = sb_radio.slots;
+    sb_radio.slots = NULL;
+    sb_radio.head = sb_radio.tail = 0;
+    portEXIT_CRITICAL(&sb_radio_mux);
+    free(slots);
+}
+
+STATIC void sb_radio_alloc(void) {
+    uint8_t *slots = malloc(sb_radio.queue_len * (1 + sb_radio.length));
+    if (slots == NULL) {
+        mp_raise_OSError(MP_ENOMEM);
+    }
+    portENTER_CRITICAL(&sb_radio_mux);
+    sb_radio.slots = slots;
+    sb_radio.head = sb_radio.tail = 0;
+    portEXIT_CRITICAL(&sb_radio_mux);
+    espnow_set_recv_hook(sb_radio_recv_hook);
+}
+
+STATIC void sb_radio_apply_channel(void) {
+    if (sb_radio.channel != 0 && wifi_started) {
+        esp_err_t e = esp_wifi_set_channel(sb_radio.channel, WIFI_SECOND_CHAN_NONE);
+        if (e != ESP_OK) {
+            _esp_exceptions(e);
+        }
+    }
+}
+
+// Length of the longest prefix of str that does not end part way through
+// a UTF-8 sequence, for strings cut short by the frame length
+STATIC size_t sb_radio_utf8_trim(const uint8_t *str, size_t len) {
+    size_t i = len;
+    while (i > 0 && (str[i - 1] & 0xc0) == 0x80) {
+        --i;
+    }
+    if (i == 0) {
+        return len;
+    }
+    uint8_t lead = str[i - 1];
+    size_t need = lead < 0x80 ? 1 : lead < 0xe0 ? 2 : lead < 0xf0 ? 3 : 4;
+    return len - (i - 1) >= need ? len : i - 1;
+}
+
+STATIC mp_obj_t sb_radio_new_str(const uint8_t *str, size_t len) {
+    len = sb_radio_utf8_trim(str, len);
+    if (!utf8_check(str, len)) {
+        return MP_OBJ_NULL;
+    }
+    return mp_obj_new_str((const char*)str, len);
+}
+
+STATIC mp_int_t sb_radio_get_number(const uint8_t *p) {
+    return (int32_t)((uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3]);
+}
+
+STATIC void sb_radio_put_number(uint8_t *p, mp_obj_t n_in) {
+    uint32_t n = mp_obj_get_int_truncated(n_in);
+    p[0] = n >> 24;
+    p[1] = n >> 16;
+    p[2] = n >> 8;
+    p[3] = n;
+}
+
+// Parse a received frame into (type, payload), or MP_OBJ_NULL if it is
+// not a frame we understand
+STATIC mp_obj_t sb_radio_parse(const uint8_t *frame, size_t len) {
+    if (len < SB_RADIO_HEADER_LEN) {
+        return MP_OBJ_NULL;
+    }
+    uint8_t type = frame[3];
+    const uint8_t *payload = frame + SB_RADIO_HEADER_LEN;
+    size_t payload_len = len - SB_RADIO_HEADER_LEN;
+    mp_obj_t value;
+    switch (type) {
+        case SB_RADIO_TYPE_NUMBER:
+            if (payload_len < SB_RADIO_NUMBER_LEN) {
+                return MP_OBJ_NULL;
+            }
+            value = mp_obj_new_int(sb_radio_get_number(payload));
+            break;
+        case SB_RADIO_TYPE_VALUE: {
+            if (payload_len < SB_RADIO_NUMBER_LEN) {
+                return MP_OBJ_NULL;
+            }
+            mp_obj_t name = sb_radio_new_str(payload + SB_RADIO_NUMBER_LEN, payload_len - SB_RADIO_NUMBER_LEN);
+            if (name == MP_OBJ_NULL) {
+                return MP_OBJ_NULL;
+            }
+            mp_obj_t items[2] = { name, mp_obj_new_int(sb_radio_get_number(payload)) };
+            value = mp_obj_new_tuple(2, items);
+            break;
+        }
+        case SB_RADIO_TYPE_STRING:
+            value = sb_radio_new_str(payload, payload_len);
+            if (value == MP_OBJ_NULL) {
+                return MP_OBJ_NULL;
+            }
+            break;
+        case SB_RADIO_TYPE_BYTES:
+            value = mp_obj_new_bytes(payload, payload_len);
+            break;
+        default:
+            return MP_OBJ_NULL;
+    }
+    mp_obj_t items[2] = { MP_OBJ_NEW_SMALL_INT(type), value };
+    return mp_obj_new_tuple(2, items);
+}
+
+STATIC void sb_radio_send(uint8_t type, mp_obj_t number, const void *data, size_t len) {
+    if (!sb_radio.on) {
+        mp_raise_msg(&mp_type_RuntimeError, "radio is not on");
+    }
+    if (sb_radio.group < 0) {
+        mp_raise_ValueError("group not set");
+    }
+    // like the receiving side, anything past the configured length is cut
+    size_t frame_len = SB_RADIO_HEADER_LEN + (number != MP_OBJ_NULL ? SB_RADIO_NUMBER_LEN : 0) + len;
+    if (frame_len > sb_radio.length) {
+        len -= frame_len - sb_radio.length;
+        frame_len = sb_radio.length;
+    }
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    uint8_t *p = frame;
+    *p++ = SB_RADIO_DAL_VERSION;
+    *p++ = sb_radio.group;
+    *p++ = SB_RADIO_DAL_PROTOCOL;
+    *p++ = type;
+    if (++sb_radio.seq == 0) {
+        sb_radio.seq = 1;
+    }
+    *p++ = sb_radio.ttl;
+    *p++ = sb_radio.mac_id;
+    *p++ = sb_radio.seq >> 8;
+    *p++ = sb_radio.seq;
+    if (number != MP_OBJ_NULL) {
+        sb_radio_put_number(p, number);
+        p += SB_RADIO_NUMBER_LEN;
+    }
+    memcpy(p, data, len);
+    // remember our own message so relayed copies are not delivered back
+    uint32_t key = sb_radio_key(frame, frame_len);
+    portENTER_CRITICAL(&sb_radio_mux);
+    sb_radio_seen(key);
+    portEXIT_CRITICAL(&sb_radio_mux);
+    espnow_send_frame(sb_radio_broadcast_mac, frame, frame_len);
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+STATIC mp_obj_t sb_radio_on(void) {
+    if (!sb_radio.on) {
+        uint8_t mac[6];
+        esp_efuse_mac_get_default(mac);
+        sb_radio.mac_id = mac[5];
+        sb_radio_apply_channel();
+        sb_radio_alloc();
+        sb_radio.on = true;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_radio_on_obj, sb_radio_on);
+
+STATIC mp_obj_t sb_radio_off(void) {
+    if (sb_radio.on) {
+        sb_radio_free();
+        sb_radio.on = false;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_radio_off_obj, sb_radio_off);
+
+// config(*, length, queue, channel, group, relay, ttl)
+//
+// Changing length or queue discards any queued messages, as does changing
+// the group.  relay turns on forwarding of other boards' messages; ttl is
+// the number of hops our own messages may be relayed.
+STATIC mp_obj_t sb_radio_config(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_length, ARG_queue, ARG_channel, ARG_group, ARG_relay, ARG_ttl };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_length, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_queue, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_channel, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_group, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_relay, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+        { MP_QSTR_ttl, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_obj = mp_const_none} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    // check everything before changing anything
+    mp_int_t length = sb_radio.length;
+    if (args[ARG_length].u_obj != mp_const_none) {
+        length = mp_obj_get_int(args[ARG_length].u_obj);
+        if (length < SB_RADIO_HEADER_LEN || length > ESP_NOW_MAX_DATA_LEN) {
+            mp_raise_ValueError("length must be 8 - 250");
+        }
+    }
+    mp_int_t queue = sb_radio.queue_len;
+    if (args[ARG_queue].u_obj != mp_const_none) {
+        queue = mp_obj_get_int(args[ARG_queue].u_obj);
+        if (queue < 1 || queue > SB_RADIO_MAX_QUEUE) {
+            mp_raise_ValueError("queue must be 1 - 64");
+        }
+    }
+    mp_int_t channel = sb_radio.channel;
+    if (args[ARG_channel].u_obj != mp_const_none) {
+        channel = mp_obj_get_int(args[ARG_channel].u_obj);
+        if (channel < 1 || channel > SB_RADIO_MAX_CHANNEL) {
+            mp_raise_ValueError("channel must be 1 - 13");
+        }
+    }
+    mp_int_t group = sb_radio.group;
+    if (args[ARG_group].u_obj != mp_const_none) {
+        group = mp_obj_get_int(args[ARG_group].u_obj);
+        if (group < 0 || group > 255) {
+            mp_raise_ValueError("group must be 0 - 255");
+        }
+    }
+    mp_int_t ttl = sb_radio.ttl;
+    if (args[ARG_ttl].u_obj != mp_const_none) {
+        ttl = mp_obj_get_int(args[ARG_ttl].u_obj);
+        if (ttl < 0 || ttl > SB_RADIO_MAX_TTL) {
+            mp_raise_ValueError("ttl must be 0 - 15");
+        }
+    }
+    sb_radio.ttl = ttl;
+    if (args[ARG_relay].u_obj != mp_const_none) {
+        sb_radio.relay = mp_obj_is_true(args[ARG_relay].u_obj);
+    }
+
+    if (length != sb_radio.length || queue != sb_radio.queue_len) {
+        if (sb_radio.on) {
+            sb_radio_free();
+        }
+        sb_radio.length = length;
+        sb_radio.queue_len = queue;
+        if (sb_radio.on) {
+            sb_radio_alloc();
+        }
+    }
+    if (channel != sb_radio.channel) {
+        sb_radio.channel = channel;
+        if (sb_radio.on) {
+            sb_radio_apply_channel();
+        }
+    }
+    if (group != sb_radio.group) {
+        portENTER_CRITICAL(&sb_radio_mux);
+        sb_radio.group = group;
+        sb_radio.tail = sb_radio.head;
+        portEXIT_CRITICAL(&sb_radio_mux);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sb_radio_config_obj, 0, sb_radio_config);
+
+STATIC mp_obj_t sb_radio_send_number(mp_obj_t n) {
+    sb_radio_send(SB_RADIO_TYPE_NUMBER, n, NULL, 0);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_radio_send_number_obj, sb_radio_send_number);
+
+STATIC mp_obj_t sb_radio_send_value(mp_obj_t name, mp_obj_t n) {
+    size_t len;
+    const char *str = mp_obj_str_get_data(name, &len);
+    sb_radio_send(SB_RADIO_TYPE_VALUE, n, str, len);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(sb_radio_send_value_obj, sb_radio_send_value);
+
+STATIC mp_obj_t sb_radio_send_string(mp_obj_t s) {
+    size_t len;
+    const char *str = mp_obj_str_get_data(s, &len);
+    sb_radio_send(SB_RADIO_TYPE_STRING, MP_OBJ_NULL, str, len);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_radio_send_string_obj, sb_radio_send_string);
+
+STATIC mp_obj_t sb_radio_send_bytes(mp_obj_t buf) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf, &bufinfo, MP_BUFFER_READ);
+    sb_radio_send(SB_RADIO_TYPE_BYTES, MP_OBJ_NULL, bufinfo.buf, bufinfo.len);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(sb_radio_send_bytes_obj, sb_radio_send_bytes);
+
+// receive() -> (type, payload) or None
+//
+// type is 0 for a number, 1 for a (name, number) value, 2 for a string and
+// 3 for bytes.  Frames that cannot be parsed are skipped.
+STATIC mp_obj_t sb_radio_receive(void) {
+    uint8_t frame[ESP_NOW_MAX_DATA_LEN];
+    for (;;) {
+        size_t len = 0;
+        portENTER_CRITICAL(&sb_radio_mux);
+        if (sb_radio.slots != NULL && sb_radio.head != sb_radio.tail) {
+            const uint8_t *slot = sb_radio_slot(sb_radio.tail++);
+            len = slot[0];
+            memcpy(frame, slot + 1, len);
+        }
+        portEXIT_CRITICAL(&sb_radio_mux);
+        if (len == 0) {
+            return mp_const_none;
+        }
+        mp_obj_t msg = sb_radio_parse(frame, len);
+        if (msg != MP_OBJ_NULL) {
+            return msg;
+        }
+    }
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_radio_receive_obj, sb_radio_receive);
+
+STATIC mp_obj_t sb_radio_reset(void) {
+    sb_radio_flush();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_radio_reset_obj, sb_radio_reset);
+
+// stats() -> (received, dropped, relayed, duplicates)
+STATIC mp_obj_t sb_radio_stats(void) {
+    portENTER_CRITICAL(&sb_radio_mux);
+    uint32_t received = sb_radio.received;
+    uint32_t dropped = sb_radio.dropped;
+    uint32_t relayed = sb_radio.relayed;
+    uint32_t duplicates = sb_radio.duplicates;
+    portEXIT_CRITICAL(&sb_radio_mux);
+
+    mp_obj_t tuple[4] = {
+        mp_obj_new_int_from_uint(received),
+        mp_obj_new_int_from_uint(dropped),
+        mp_obj_new_int_from_uint(relayed),
+        mp_obj_new_int_from_uint(duplicates),
+    };
+    return mp_obj_new_tuple(4, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_radio_stats_obj, sb_radio_stats);
+
+void studuinobit_radio_deinit(void) {
+    sb_radio_off();
+    sb_radio.length = SB_RADIO_DEFAULT_LENGTH;
+    sb_radio.queue_len = SB_RADIO_DEFAULT_QUEUE;
+    sb_radio.channel = 0;
+    sb_radio.group = -1;
+    sb_radio.relay = false;
+    sb_radio.ttl = SB_RADIO_DEFAULT_TTL;
+    sb_radio.received = sb_radio.dropped = 0;
+    sb_radio.relayed = sb_radio.duplicates = 0;
+    memset(sb_radio.seen, 0, sizeof(sb_radio.seen));
+}
+
+STATIC const mp_rom_map_elem_t sb_radio_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_radio) },
+    { MP_ROM_QSTR(MP_QSTR_on), MP_ROM_PTR(&sb_radio_on_obj) },
+    { MP_ROM_QSTR(MP_QSTR_off), MP_ROM_PTR(&sb_radio_off_obj) },
+    { MP_ROM_QSTR(MP_QSTR_config), MP_ROM_PTR(&sb_radio_config_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset), MP_ROM_PTR(&sb_radio_reset_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_number), MP_ROM_PTR(&sb_radio_send_number_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_value), MP_ROM_PTR(&sb_radio_send_value_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_string), MP_ROM_PTR(&sb_radio_send_string_obj) },
+    { MP_ROM_QSTR(MP_QSTR_send_bytes), MP_ROM_PTR(&sb_radio_send_bytes_obj) },
+    { MP_ROM_QSTR(MP_QSTR_receive), MP_ROM_PTR(&sb_radio_receive_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&sb_radio_stats_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_radio_module_globals, sb_radio_module_globals_table);
+
+const mp_obj_module_t studuinobit_radio_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&sb_radio_module_globals,
+};
@@ -0,0 +1,270 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <math.h>
+
+#include "freertos/FreeRTOS.h"
+#include "esp_timer.h"
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+
+#include "py/runtime.h"
+#include "py/mperrno.h"
+#include "modstuduinobit.h"
+
+// The light sensor and the thermistor of the board, as one ADC1 scan
+// group.  Each scan oversamples every channel and keeps the averages with
+// the time they were taken.  Scans are run by an esp_timer in the
+// background once start() is called, and on the caller's side whenever a
+// reading is older than the max age, so reads are normally just a copy of
+// the cached value.
+//
+// Values are on the 0-4095 scale of pystubit's read_analog(): the
+// calibrated voltage scaled to 3300mV, except at the rails where the raw
+// reading is kept.  The ADC is used at 12 bits and 11dB, as pystubit
+// configures machine.ADC.
+
+#define SB_SENSORS_LIGHT        (0)
+#define SB_SENSORS_TEMPERATURE  (1)
+#define SB_SENSORS_NUM          (2)
+
+#define SB_SENSORS_OVERSAMPLE_MAX   (256)
+
+// Thermistor in a divider with SB_SENSORS_SERIES_R to 3.3V
+#define SB_SENSORS_SERIES_R     (10000.0f)
+#define SB_SENSORS_NOMINAL_R    (10000.0f)  // resistance at NOMINAL_T
+#define SB_SENSORS_NOMINAL_T    (25.0f)
+#define SB_SENSORS_BETA         (3950.0f)
+
+STATIC const adc1_channel_t sb_sensors_channel[SB_SENSORS_NUM] = {
+    ADC1_CHANNEL_6,     // GPIO34, light sensor
+    ADC1_CHANNEL_7,     // GPIO35, thermistor
+};
+
+typedef struct _sb_sensors_t {
+    esp_timer_handle_t timer;
+    bool running;
+    bool configured;
+    uint16_t oversample;
+    uint32_t max_age_us;
+    esp_adc_cal_characteristics_t characteristics;
+    // written by a scan on either side, under mux
+    portMUX_TYPE mux;
+    int64_t time_us;        // when value was taken, 0 if never
+    uint16_t value[SB_SENSORS_NUM];
+} sb_sensors_t;
+
+STATIC sb_sensors_t sb_sensors = {
+    .oversample = 8,
+    .max_age_us = 200000,
+    .mux = portMUX_INITIALIZER_UNLOCKED,
+};
+
+STATIC void sb_sensors_configure(void) {
+    if (sb_sensors.configured) {
+        return;
+    }
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    for (int i = 0; i < SB_SENSORS_NUM; ++i) {
+        adc1_config_channel_atten(sb_sensors_channel[i], ADC_ATTEN_DB_11);
+    }
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &sb_sensors.characteristics);
+    sb_sensors.configured = true;
+}
+
+// Returns the new value of channel ret_ch
+STATIC uint16_t sb_sensors_scan(int ret_ch) {
+    uint16_t value[SB_SENSORS_NUM];
+    uint32_t n = sb_sensors.oversample;
+    for (int i = 0; i < SB_SENSORS_NUM; ++i) {
+        uint32_t sum = 0;
+        for (uint32_t j = 0; j < n; ++j) {
+            sum += adc1_get_raw(sb_sensors_channel[i]);
+        }
+        uint32_t raw = (sum + n / 2) / n;
+        if (raw == 0 || raw == 4095) {
+            value[i] = raw;
+        } else {
+            uint32_t mv = esp_adc_cal_raw_to_voltage(raw, &sb_sensors.characteristics);
+            value[i] = (mv * 4095 + 1650) / 3300;
+        }
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&sb_sensors.mux);
+    for (int i = 0; i < SB_SENSORS_NUM; ++i) {
+        sb_sensors.value[i] = value[i];
+    }
+    sb_sensors.time_us = now;
+    portEXIT_CRITICAL(&sb_sensors.mux);
+    return value[ret_ch];
+}
+
+STATIC void sb_sensors_timer_cb(void *arg) {
+    (void)arg;
+    sb_sensors_scan(0);
+}
+
+// The cached value of a channel, scanning first if it has got too old
+STATIC uint16_t sb_sensors_get(int ch) {
+    sb_sensors_configure();
+    portENTER_CRITICAL(&sb_sensors.mux);
+    int64_t time_us = sb_sensors.time_us;
+    uint16_t value = sb_sensors.value[ch];
+    portEXIT_CRITICAL(&sb_sensors.mux);
+    if (time_us == 0 || esp_timer_get_time() - time_us > sb_sensors.max_age_us) {
+        value = sb_sensors_scan(ch);
+    }
+    return value;
+}
+
+STATIC void sb_sensors_stop_internal(void) {
+    if (sb_sensors.timer != NULL) {
+        esp_timer_stop(sb_sensors.timer);
+    }
+    sb_sensors.running = false;
+}
+
+/******************************************************************************/
+// MicroPython bindings
+
+// config(*, oversample, max_age_ms): samples averaged per channel and scan,
+// and how old a cached reading may be before a read scans again
+STATIC mp_obj_t sb_sensors_config(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
+    enum { ARG_oversample, ARG_max_age_ms };
+    static const mp_arg_t allowed_args[] = {
+        { MP_QSTR_oversample, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+        { MP_QSTR_max_age_ms, MP_ARG_KW_ONLY | MP_ARG_INT, {.u_int = -1} },
+    };
+    mp_arg_val_t args[MP_ARRAY_SIZE(allowed_args)];
+    mp_arg_parse_all(n_args, pos_args, kw_args, MP_ARRAY_SIZE(allowed_args), allowed_args, args);
+
+    if (args[ARG_oversample].u_int != -1) {
+        if (args[ARG_oversample].u_int < 1 || args[ARG_oversample].u_int > SB_SENSORS_OVERSAMPLE_MAX) {
+            mp_raise_ValueError("oversample must be 1-256");
+        }
+        sb_sensors.oversample = args[ARG_oversample].u_int;
+    }
+    if (args[ARG_max_age_ms].u_int != -1) {
+        if (args[ARG_max_age_ms].u_int < 0) {
+            mp_raise_ValueError(NULL);
+        }
+        sb_sensors.max_age_us = args[ARG_max_age_ms].u_int * 1000;
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_KW(sb_sensors_config_obj, 0, sb_sensors_config);
+
+// start(period_ms=100): scan in the background every period_ms
+STATIC mp_obj_t sb_sensors_start(size_t n_args, const mp_obj_t *args) {
+    mp_int_t period_ms = n_args > 0 ? mp_obj_get_int(args[0]) : 100;
+    if (period_ms <= 0) {
+        mp_raise_ValueError("period must be positive");
+    }
+    sb_sensors_stop_internal();
+    sb_sensors_configure();
+    if (sb_sensors.timer == NULL) {
+        esp_timer_create_args_t timer_args = {
+            .callback = sb_sensors_timer_cb,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "sb_sensors",
+        };
+        if (esp_timer_create(&timer_args, &sb_sensors.timer) != ESP_OK) {
+            mp_raise_OSError(MP_ENOMEM);
+        }
+    }
+    // take the first scan now so that reads don't have to
+    sb_sensors_scan(0);
+    esp_timer_start_periodic(sb_sensors.timer, period_ms * 1000);
+    sb_sensors.running = true;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(sb_sensors_start_obj, 0, 1, sb_sensors_start);
+
+STATIC mp_obj_t sb_sensors_stop(void) {
+    sb_sensors_stop_internal();
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_sensors_stop_obj, sb_sensors_stop);
+
+STATIC mp_obj_t sb_sensors_running(void) {
+    return mp_obj_new_bool(sb_sensors.running);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_sensors_running_obj, sb_sensors_running);
+
+STATIC mp_obj_t sb_sensors_light(void) {
+    return MP_OBJ_NEW_SMALL_INT(sb_sensors_get(SB_SENSORS_LIGHT));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_sensors_light_obj, sb_sensors_light);
+
+STATIC mp_obj_t sb_sensors_temperature(void) {
+    return MP_OBJ_NEW_SMALL_INT(sb_sensors_get(SB_SENSORS_TEMPERATURE));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_sensors_temperature_obj, sb_sensors_temperature);
+
+// celsius(): the thermistor temperature from the beta equation,
+// 1/T = 1/T0 + ln(R/R0)/B
+// https://learn.adafruit.com/thermistor/using-a-thermistor
+STATIC mp_obj_t sb_sensors_celsius(void) {
+    uint16_t value = sb_sensors_get(SB_SENSORS_TEMPERATURE);
+    // the same errors as the float arithmetic this replaces in pystubit
+    if (value == 0) {
+        mp_raise_msg(&mp_type_ZeroDivisionError, "divide by zero");
+    }
+    if (value >= 4095) {
+        mp_raise_ValueError("math domain error");
+    }
+    float r = SB_SENSORS_SERIES_R * (4095.0f / value - 1.0f);
+    float t = logf(r / SB_SENSORS_NOMINAL_R) / SB_SENSORS_BETA + 1.0f / (SB_SENSORS_NOMINAL_T + 273.15f);
+    return mp_obj_new_float(1.0f / t - 273.15f);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(sb_sensors_celsius_obj, sb_sensors_celsius);
+
+void studuinobit_sensors_deinit(void) {
+    sb_sensors_stop_internal();
+    sb_sensors.time_us = 0;
+    sb_sensors.oversample = 8;
+    sb_sensors.max_age_us = 200000;
+    // machine.ADC may have reconfigured ADC1 since
+    sb_sensors.configured = false;
+}
+
+STATIC const mp_rom_map_elem_t sb_sensors_module_globals_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_sensors) },
+    { MP_ROM_QSTR(MP_QSTR_config), MP_ROM_PTR(&sb_sensors_config_obj) },
+    { MP_ROM_QSTR(MP_QSTR_start), MP_ROM_PTR(&sb_sensors_start_obj) },
+    { MP_ROM_QSTR(MP_QSTR_stop), MP_ROM_PTR(&sb_sensors_stop_obj) },
+    { MP_ROM_QSTR(MP_QSTR_running), MP_ROM_PTR(&sb_sensors_running_obj) },
+    { MP_ROM_QSTR(MP_QSTR_light), MP_ROM_PTR(&sb_sensors_light_obj) },
+    { MP_ROM_QSTR(MP_QSTR_temperature), MP_ROM_PTR(&sb_sensors_temperature_obj) },
+    { MP_ROM_QSTR(MP_QSTR_celsius), MP_ROM_PTR(&sb_sensors_celsius_obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(sb_sensors_module_globals, sb_sensors_module_globals_table);
+
+const mp_obj_module_t studuinobit_sensors_module = {
+    .base = { &mp_type_module },
+    .globals = (mp_obj_dict_t*)&sb_sensors_module_globals,
+};
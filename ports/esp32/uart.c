@@ -28,10 +28,28 @@
 
 #include <stdio.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "driver/uart.h"
+#include "soc/uart_reg.h"
+#include "rom/uart.h"
 
 #include "py/mpstate.h"
 #include "py/mphal.h"
+#include "uart.h"
+
+// stdout is queued in this ring buffer and drained into the UART FIFO by the
+// TX-FIFO-empty interrupt, so the VM doesn't wait on the baud rate unless the
+// buffer is full.  i_get is advanced by the ISR, i_put by writers, and both
+// are only changed with the spinlock held.
+#define STDOUT_FIFO_THRESH (16)
+
+STATIC uint8_t stdout_buf[MICROPY_HW_STDOUT_TXBUF_SIZE];
+STATIC volatile size_t stdout_i_get;
+STATIC volatile size_t stdout_i_put;
+STATIC portMUX_TYPE stdout_mux = portMUX_INITIALIZER_UNLOCKED;
+STATIC bool stdout_ready = false;
+bool uart_stdout_nonblocking = false;
 
 STATIC void uart_irq_handler(void *arg);
 
@@ -39,14 +57,126 @@ void uart_init(void) {
     uart_isr_handle_t handle;
     uart_isr_register(UART_NUM_0, uart_irq_handler, NULL, ESP_INTR_FLAG_LOWMED | ESP_INTR_FLAG_IRAM, &handle);
     uart_enable_rx_intr(UART_NUM_0);
+    UART0.conf1.txfifo_empty_thrhd = STDOUT_FIFO_THRESH;
+    stdout_ready = true;
+}
+
+// Must be called with stdout_mux held
+STATIC inline size_t IRAM_ATTR stdout_used(void) {
+    size_t i_put = stdout_i_put;
+    size_t i_get = stdout_i_get;
+    return i_put >= i_get ? i_put - i_get : i_put + sizeof(stdout_buf) - i_get;
+}
+
+// Must be called with stdout_mux held
+STATIC void IRAM_ATTR stdout_drain(volatile uart_dev_t *uart) {
+    size_t i_get = stdout_i_get;
+    while (i_get != stdout_i_put && uart->status.txfifo_cnt < UART_FIFO_LEN) {
+        WRITE_PERI_REG(UART_FIFO_AHB_REG(0), stdout_buf[i_get]);
+        if (++i_get == sizeof(stdout_buf)) {
+            i_get = 0;
+        }
+    }
+    stdout_i_get = i_get;
+    if (i_get == stdout_i_put) {
+        uart->int_ena.txfifo_empty = 0;
+    }
+    uart->int_clr.txfifo_empty = 1;
+}
+
+// Queue len bytes for output, converting "\n" to "\r\n" if cooked is set.
+// When the buffer is full this waits, with the GIL released, for it to drain;
+// or, in non-blocking mode and in an ISR, drops the oldest queued bytes.
+void uart_stdout_tx_strn(const char *str, size_t len, bool cooked) {
+    if (!stdout_ready) {
+        // Before the interrupt is installed write straight to the FIFO
+        while (len--) {
+            if (cooked && *str == '\n') {
+                uart_tx_one_char('\r');
+            }
+            uart_tx_one_char(*str++);
+        }
+        return;
+    }
+
+    bool drop = uart_stdout_nonblocking || xPortInIsrContext();
+    bool released_gil = false;
+    while (len > 0) {
+        portENTER_CRITICAL(&stdout_mux);
+        size_t i_put = stdout_i_put;
+        while (len > 0) {
+            size_t need = (cooked && *str == '\n') ? 2 : 1;
+            size_t used = stdout_used();
+            if (used + need >= sizeof(stdout_buf)) {
+                if (!drop) {
+                    break;
+                }
+                size_t i_get = stdout_i_get + need;
+                if (i_get >= sizeof(stdout_buf)) {
+                    i_get -= sizeof(stdout_buf);
+                }
+                stdout_i_get = i_get;
+            }
+            if (need == 2) {
+                stdout_buf[i_put] = '\r';
+                if (++i_put == sizeof(stdout_buf)) {
+                    i_put = 0;
+                }
+            }
+            stdout_buf[i_put] = *str++;
+            if (++i_put == sizeof(stdout_buf)) {
+                i_put = 0;
+            }
+            stdout_i_put = i_put;
+            --len;
+        }
+        UART0.int_ena.txfifo_empty = 1;
+        portEXIT_CRITICAL(&stdout_mux);
+
+        if (len > 0) {
+            // Full: wait for the interrupt to drain some of it.  A tick is
+            // about 110 characters at 115200 baud.
+            if (!released_gil) {
+                MP_THREAD_GIL_EXIT();
+                released_gil = true;
+            }
+            vTaskDelay(1);
+        }
+    }
+    if (released_gil) {
+        MP_THREAD_GIL_ENTER();
+    }
+}
+
+// Wait, for at most timeout_ms, until everything queued has been sent
+void uart_stdout_flush(uint32_t timeout_ms) {
+    if (!stdout_ready || xPortInIsrContext()) {
+        return;
+    }
+    uint32_t t0 = mp_hal_ticks_ms();
+    for (;;) {
+        portENTER_CRITICAL(&stdout_mux);
+        bool empty = stdout_i_get == stdout_i_put && UART0.status.txfifo_cnt == 0;
+        portEXIT_CRITICAL(&stdout_mux);
+        if (empty || mp_hal_ticks_ms() - t0 >= timeout_ms) {
+            break;
+        }
+        vTaskDelay(1);
+    }
 }
 
 // all code executed in ISR must be in IRAM, and any const data must be in DRAM
 STATIC void IRAM_ATTR uart_irq_handler(void *arg) {
     volatile uart_dev_t *uart = &UART0;
+    if (uart->int_st.txfifo_empty) {
+        portENTER_CRITICAL_ISR(&stdout_mux);
+        stdout_drain(uart);
+        portEXIT_CRITICAL_ISR(&stdout_mux);
+    }
     uart->int_clr.rxfifo_full = 1;
     uart->int_clr.frm_err = 1;
     uart->int_clr.rxfifo_tout = 1;
+    bool received = uart->status.rxfifo_cnt != 0;
     while (uart->status.rxfifo_cnt) {
         uint8_t c = uart->fifo.rw_byte;
         if (c == mp_interrupt_char) {
@@ -62,4 +192,13 @@ STATIC void IRAM_ATTR uart_irq_handler(void *arg) {
             ringbuf_put(&stdin_ringbuf, c);
         }
     }
+    if (received) {
+        // the main task blocks on a notification while it waits for input,
+        // FreeRTOS keeps the ISR variant in IRAM
+        BaseType_t woken = pdFALSE;
+        vTaskNotifyGiveFromISR(mp_main_task_handle, &woken);
+        if (woken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    }
 }
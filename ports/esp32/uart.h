@@ -28,6 +28,14 @@
 #ifndef MICROPY_INCLUDED_ESP32_UART_H
 #define MICROPY_INCLUDED_ESP32_UART_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+extern bool uart_stdout_nonblocking;
+
 void uart_init(void);
+void uart_stdout_tx_strn(const char *str, size_t len, bool cooked);
+void uart_stdout_flush(uint32_t timeout_ms);
 
 #endif // MICROPY_INCLUDED_ESP32_UART_H
@@ -167,7 +167,7 @@ void gc_collect(void) {
     #if MICROPY_PY_THREAD
     mp_thread_gc_others();
     #endif
-    #if MICROPY_EMIT_NATIVE
+    #if MICROPY_EMIT_MACHINE_CODE
     mp_unix_mark_exec();
     #endif
     gc_collect_end();
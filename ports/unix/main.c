@@ -439,7 +439,13 @@ MP_NOINLINE int main_(int argc, char **argv) {
 
 #if MICROPY_ENABLE_GC
     char *heap = malloc(heap_size);
+    #if MICROPY_GC_SPLIT_HEAP
+    // exercise the split heap: the second half becomes its own area
+    gc_init(heap, heap + heap_size / 2);
+    gc_add(heap + heap_size / 2, heap + heap_size);
+    #else
     gc_init(heap, heap + heap_size);
+    #endif
 #endif
 
     #if MICROPY_ENABLE_PYSTACK
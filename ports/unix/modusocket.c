@@ -33,6 +33,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <netdb.h>
@@ -143,6 +144,27 @@ STATIC mp_uint_t socket_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg, i
         case MP_STREAM_GET_FILENO:
             return self->fd;
 
+        case MP_STREAM_WRITEV: {
+            const mp_stream_writev_t *wv = (const mp_stream_writev_t*)arg;
+            struct iovec iov[8];
+            int cnt = MIN(wv->iovcnt, MP_ARRAY_SIZE(iov));
+            for (int i = 0; i < cnt; i++) {
+                iov[i].iov_base = (void*)wv->iov[i].base;
+                iov[i].iov_len = wv->iov[i].len;
+            }
+            mp_int_t r = writev(self->fd, iov, cnt);
+            if (r == -1) {
+                int err = errno;
+                // as for socket_write
+                if (err == EAGAIN && self->blocking) {
+                    err = MP_ETIMEDOUT;
+                }
+                *errcode = err;
+                return MP_STREAM_ERROR;
+            }
+            return r;
+        }
+
         default:
             *errcode = MP_EINVAL;
             return MP_STREAM_ERROR;
@@ -414,7 +436,9 @@ STATIC const mp_rom_map_elem_t usocket_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_readline_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
+    { MP_ROM_QSTR(MP_QSTR_writevec), MP_ROM_PTR(&mp_stream_writevec_obj) },
     { MP_ROM_QSTR(MP_QSTR_connect), MP_ROM_PTR(&socket_connect_obj) },
     { MP_ROM_QSTR(MP_QSTR_bind), MP_ROM_PTR(&socket_bind_obj) },
     { MP_ROM_QSTR(MP_QSTR_listen), MP_ROM_PTR(&socket_listen_obj) },
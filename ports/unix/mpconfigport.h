@@ -44,10 +44,18 @@
     #define MICROPY_EMIT_ARM        (1)
 #endif
 #define MICROPY_COMP_MODULE_CONST   (1)
+#define MICROPY_COMP_CONST_FOLDING_EXTENDED (1)
 #define MICROPY_COMP_TRIPLE_TUPLE_ASSIGN (1)
 #define MICROPY_COMP_RETURN_IF_EXPR (1)
+#define MICROPY_COMP_CONST_TUPLE    (1)
 #define MICROPY_ENABLE_GC           (1)
 #define MICROPY_ENABLE_FINALISER    (1)
+#define MICROPY_GC_MEM_PEAK         (1)
+#define MICROPY_GC_FREE_LISTS       (16)
+#define MICROPY_GC_FINALISER_LIST   (64)
+#define MICROPY_GC_ARENA            (8)
+#define MICROPY_PY_MICROPYTHON_STATS (1)
+#define MICROPY_VM_COUNT_OPCODES    (1)
 #define MICROPY_STACK_CHECK         (1)
 #define MICROPY_MALLOC_USES_ALLOCATED_SIZE (1)
 #define MICROPY_MEM_STATS           (1)
@@ -70,9 +78,72 @@
 #ifndef MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (1)
 #endif
+#ifndef MICROPY_OPT_CACHE_CLASS_LOOKUP
+#define MICROPY_OPT_CACHE_CLASS_LOOKUP (64)
+#endif
+#ifndef MICROPY_OPT_SMALL_INT_BINARY_OP
+#define MICROPY_OPT_SMALL_INT_BINARY_OP (1)
+#endif
+#ifndef MICROPY_MAP_COMPACT
+#define MICROPY_MAP_COMPACT (1)
+#endif
+#ifndef MICROPY_OPT_MAP_INT_KEYS
+#define MICROPY_OPT_MAP_INT_KEYS (1)
+#endif
+#ifndef MICROPY_OPT_STR_CONCAT_INPLACE
+#define MICROPY_OPT_STR_CONCAT_INPLACE (32)
+#endif
+#ifndef MICROPY_OPT_STR_SLICE_VIEW
+#define MICROPY_OPT_STR_SLICE_VIEW (64)
+#endif
+#ifndef MICROPY_OPT_STR_LAZY_HASH
+#define MICROPY_OPT_STR_LAZY_HASH (32)
+#endif
+#ifndef MICROPY_OPT_STR_INDEX_CACHE
+#define MICROPY_OPT_STR_INDEX_CACHE (4)
+#endif
+#ifndef MICROPY_QSTR_HASH_INDEX
+#define MICROPY_QSTR_HASH_INDEX (1)
+#endif
+#ifndef MICROPY_OPT_STR_CACHE
+#define MICROPY_OPT_STR_CACHE (64)
+#endif
+#ifndef MICROPY_OPT_STR_FIND_FAST
+#define MICROPY_OPT_STR_FIND_FAST (1)
+#endif
+#ifndef MICROPY_OPT_STR_FORMAT_CACHE
+#define MICROPY_OPT_STR_FORMAT_CACHE (8)
+#endif
+#ifndef MICROPY_OPT_MPZ_KARATSUBA
+#define MICROPY_OPT_MPZ_KARATSUBA (32)
+#endif
+#ifndef MICROPY_OPT_MPZ_MONTGOMERY
+#define MICROPY_OPT_MPZ_MONTGOMERY (1)
+#endif
+#ifndef MICROPY_OPT_NATIVE_LOCAL_REGS
+#define MICROPY_OPT_NATIVE_LOCAL_REGS (1)
+#endif
+#ifndef MICROPY_OPT_SUPERINSTRUCTIONS
+#define MICROPY_OPT_SUPERINSTRUCTIONS (1)
+#endif
+#ifndef MICROPY_OPT_FAST_CALL
+#define MICROPY_OPT_FAST_CALL (1)
+#endif
+#ifndef MICROPY_OPT_ARG_PARSE_FAST
+#define MICROPY_OPT_ARG_PARSE_FAST (1)
+#endif
+#ifndef MICROPY_OPT_GEN_FRAME_REUSE
+#define MICROPY_OPT_GEN_FRAME_REUSE (1)
+#endif
+#if !defined(MICROPY_OPT_TIERED_NATIVE) && MICROPY_EMIT_X64
+#define MICROPY_OPT_TIERED_NATIVE (1)
+#endif
 #define MICROPY_CAN_OVERRIDE_BUILTINS (1)
 #define MICROPY_PY_FUNCTION_ATTRS   (1)
 #define MICROPY_PY_DESCRIPTORS      (1)
+#ifndef MICROPY_PY_CLASS_SLOTS
+#define MICROPY_PY_CLASS_SLOTS      (1)
+#endif
 #define MICROPY_PY_BUILTINS_STR_UNICODE (1)
 #define MICROPY_PY_BUILTINS_STR_CENTER (1)
 #define MICROPY_PY_BUILTINS_STR_PARTITION (1)
@@ -88,6 +159,8 @@
 #define MICROPY_PY_ALL_SPECIAL_METHODS (1)
 #define MICROPY_PY_REVERSE_SPECIAL_METHODS (1)
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN (1)
+#define MICROPY_PY_ARRAY_OPS        (1)
+#define MICROPY_PY_STRUCT_STRUCT    (1)
 #define MICROPY_PY_BUILTINS_SLICE_ATTRS (1)
 #define MICROPY_PY_SYS_EXIT         (1)
 #if defined(__APPLE__) && defined(__MACH__)
@@ -99,15 +172,20 @@
 #define MICROPY_PY_SYS_STDFILES     (1)
 #define MICROPY_PY_SYS_EXC_INFO     (1)
 #define MICROPY_PY_COLLECTIONS_DEQUE (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_ITER (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR (1)
+#define MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE (1)
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (1)
 #ifndef MICROPY_PY_MATH_SPECIAL_FUNCTIONS
 #define MICROPY_PY_MATH_SPECIAL_FUNCTIONS (1)
 #endif
+#define MICROPY_PY_MATH_ARRAY       (1)
 #define MICROPY_PY_CMATH            (1)
 #define MICROPY_PY_IO_IOBASE        (1)
 #define MICROPY_PY_IO_FILEIO        (1)
 #define MICROPY_PY_GC_COLLECT_RETVAL (1)
 #define MICROPY_MODULE_FROZEN_STR   (1)
+#define MICROPY_MODULE_FROZEN_MPY_COMPRESSED (8)
 
 #ifndef MICROPY_STACKLESS
 #define MICROPY_STACKLESS           (0)
@@ -115,28 +193,43 @@
 #endif
 
 #define MICROPY_PY_OS_STATVFS       (1)
+#define MICROPY_PY_THREAD_QUEUE     (1)
 #define MICROPY_PY_UTIME            (1)
 #define MICROPY_PY_UTIME_MP_HAL     (1)
 #define MICROPY_PY_UERRNO           (1)
 #define MICROPY_PY_UCTYPES          (1)
 #define MICROPY_PY_UZLIB            (1)
+#define MICROPY_PY_UZLIB_COMPRESS   (1)
+#define MICROPY_PY_UZLIB_FAST_BITS  (9)
 #define MICROPY_PY_UJSON            (1)
+#define MICROPY_PY_UJSON_ITERLOAD   (1)
 #define MICROPY_PY_URE              (1)
+#define MICROPY_PY_URE_PIKEVM       (1)
+#define MICROPY_PY_URE_CACHE        (4)
+#define MICROPY_PY_UCTYPES_LAYOUT_CACHE (4)
 #define MICROPY_PY_UHEAPQ           (1)
+#define MICROPY_PY_UHEAPQ_BULK      (1)
 #define MICROPY_PY_UTIMEQ           (1)
 #define MICROPY_PY_UHASHLIB         (1)
 #if MICROPY_PY_USSL
 #define MICROPY_PY_UHASHLIB_MD5     (1)
 #define MICROPY_PY_UHASHLIB_SHA1    (1)
 #define MICROPY_PY_UCRYPTOLIB       (1)
+#define MICROPY_PY_UCRYPTOLIB_CTR   (1)
+#define MICROPY_PY_UCRYPTOLIB_GCM   (1)
 #endif
 #define MICROPY_PY_UBINASCII        (1)
 #define MICROPY_PY_UBINASCII_CRC32  (1)
+#define MICROPY_PY_UBINASCII_INTO   (1)
 #define MICROPY_PY_URANDOM          (1)
 #ifndef MICROPY_PY_USELECT_POSIX
 #define MICROPY_PY_USELECT_POSIX    (1)
 #endif
 #define MICROPY_PY_UWEBSOCKET       (1)
+#define MICROPY_PY_UMQTTC           (1)
+#define MICROPY_PY_UHTTPC           (1)
+#define MICROPY_PY_ULOG             (1)
+#define MICROPY_PY_UASYNCIO         (1)
 #define MICROPY_PY_MACHINE          (1)
 #define MICROPY_PY_MACHINE_PULSE    (1)
 #define MICROPY_MACHINE_MEM_GET_READ_ADDR   mod_machine_mem_get_addr
@@ -169,6 +262,7 @@ extern const struct _mp_print_t mp_stderr_print;
 
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF   (1)
 #define MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE  (256)
+#define MICROPY_PREALLOC_EXCEPTIONS (1)
 #define MICROPY_KBD_EXCEPTION       (1)
 #define MICROPY_ASYNC_KBD_INTR      (1)
 
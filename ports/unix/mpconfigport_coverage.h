@@ -35,7 +35,10 @@
 #define MICROPY_OPT_MATH_FACTORIAL     (1)
 #define MICROPY_FLOAT_HIGH_QUALITY_HASH (1)
 #define MICROPY_ENABLE_SCHEDULER       (1)
+#define MICROPY_SCHEDULER_HIGH_DEPTH   (4)
+#define MICROPY_SCHEDULER_STATS        (4)
 #define MICROPY_READER_VFS             (1)
+#define MICROPY_READER_VFS_BUF_SIZE    (256)
 #define MICROPY_WARNINGS_CATEGORY      (1)
 #define MICROPY_MODULE_GETATTR         (1)
 #define MICROPY_PY_DELATTR_SETATTR     (1)
@@ -55,9 +58,14 @@
 #define MICROPY_VFS_POSIX              (1)
 #undef MICROPY_VFS_FAT
 #define MICROPY_VFS_FAT                (1)
+#define MICROPY_VFS_LOG                (1)
 #define MICROPY_PY_FRAMEBUF            (1)
 #define MICROPY_PY_COLLECTIONS_NAMEDTUPLE__ASDICT (1)
 #define MICROPY_PY_UCRYPTOLIB          (1)
+#define MICROPY_GC_INCREMENTAL_SWEEP   (1)
+#define MICROPY_GC_HEAP_STACK          (1)
+#define MICROPY_GC_RUN_HINTS           (7)
+#define MICROPY_GC_PROFILE             (1)
 
 // TODO these should be generic, not bound to fatfs
 #define mp_type_fileio mp_type_vfs_posix_fileio
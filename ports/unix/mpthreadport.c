@@ -252,4 +252,6 @@ void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex) {
     // TODO check return value
 }
 
+pthread_mutex_t mp_thread_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 #endif // MICROPY_PY_THREAD
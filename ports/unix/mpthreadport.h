@@ -31,3 +31,8 @@ typedef pthread_mutex_t mp_thread_mutex_t;
 void mp_thread_init(void);
 void mp_thread_deinit(void);
 void mp_thread_gc_others(void);
+
+// Critical section for _thread.Queue, the threads don't share a GIL
+extern pthread_mutex_t mp_thread_queue_mutex;
+#define MP_THREAD_QUEUE_ENTER() (pthread_mutex_lock(&mp_thread_queue_mutex), 0)
+#define MP_THREAD_QUEUE_EXIT(state) ((void)(state), pthread_mutex_unlock(&mp_thread_queue_mutex))
@@ -76,7 +76,83 @@ void mp_arg_check_num_sig(size_t n_args, size_t n_kw, uint32_t sig) {
     }
 }
 
+#if MICROPY_OPT_ARG_PARSE_FAST
+STATIC void arg_parse_store(const mp_arg_t *allowed, mp_obj_t given_arg, mp_arg_val_t *out_val) {
+    if ((allowed->flags & MP_ARG_KIND_MASK) == MP_ARG_BOOL) {
+        out_val->u_bool = mp_obj_is_true(given_arg);
+    } else if ((allowed->flags & MP_ARG_KIND_MASK) == MP_ARG_INT) {
+        out_val->u_int = mp_obj_get_int(given_arg);
+    } else {
+        assert((allowed->flags & MP_ARG_KIND_MASK) == MP_ARG_OBJ);
+        out_val->u_obj = given_arg;
+    }
+}
+
+// Parse the args when the keywords are in an array with qstr keys, which is
+// how they come from a call.  Each keyword is matched by comparing the key
+// directly against the qstrs of the allowed args, so there are no map lookups,
+// and with only positional args there is no searching at all.  The args are
+// checked before any are converted, and if they are not valid this returns
+// false, without side effects, so the general code can raise the error.
+STATIC bool arg_parse_fast(size_t n_pos, const mp_obj_t *pos, size_t n_kw, const mp_map_elem_t *kw, size_t n_allowed, const mp_arg_t *allowed, mp_arg_val_t *out_vals) {
+    if (n_pos > n_allowed) {
+        return false;
+    }
+    for (size_t j = 0; j < n_kw; j++) {
+        if (!mp_obj_is_qstr(kw[j].key)) {
+            return false;
+        }
+    }
+
+    // First pass: find the keyword, if any, for each arg not given by position
+    size_t kws_found = 0;
+    for (size_t i = 0; i < n_allowed; i++) {
+        if (i < n_pos) {
+            if (allowed[i].flags & MP_ARG_KW_ONLY) {
+                return false;
+            }
+            continue;
+        }
+        mp_obj_t key = MP_OBJ_NEW_QSTR(allowed[i].qst);
+        size_t j = 0;
+        while (j < n_kw && kw[j].key != key) {
+            j++;
+        }
+        if (j == n_kw) {
+            if (allowed[i].flags & MP_ARG_REQUIRED) {
+                return false;
+            }
+        } else {
+            kws_found++;
+        }
+        out_vals[i].u_int = j;
+    }
+    if (kws_found < n_kw) {
+        return false;
+    }
+
+    // Second pass: convert the given args and fill in the defaults
+    for (size_t i = 0; i < n_allowed; i++) {
+        if (i < n_pos) {
+            arg_parse_store(&allowed[i], pos[i], &out_vals[i]);
+        } else if ((size_t)out_vals[i].u_int < n_kw) {
+            arg_parse_store(&allowed[i], kw[out_vals[i].u_int].value, &out_vals[i]);
+        } else {
+            out_vals[i] = allowed[i].defval;
+        }
+    }
+    return true;
+}
+#endif
+
 void mp_arg_parse_all(size_t n_pos, const mp_obj_t *pos, mp_map_t *kws, size_t n_allowed, const mp_arg_t *allowed, mp_arg_val_t *out_vals) {
+    #if MICROPY_OPT_ARG_PARSE_FAST
+    // Keyword args from a call are always in a fixed, ordered table
+    if (kws->is_ordered && arg_parse_fast(n_pos, pos, kws->used, kws->table, n_allowed, allowed, out_vals)) {
+        return;
+    }
+    #endif
+
     size_t pos_found = 0, kws_found = 0;
     for (size_t i = 0; i < n_allowed; i++) {
         mp_obj_t given_arg;
@@ -70,6 +70,89 @@ const byte *mp_decode_uint_skip(const byte *ptr) {
     return ptr;
 }
 
+// Return the source line of the instruction at ip (as stored in code_state->ip)
+// in the given bytecode, and the function and file names it belongs to.
+size_t mp_bytecode_get_source_line(const byte *bytecode, const byte *ip_in, qstr *block_name, qstr *source_file) {
+    const byte *ip = bytecode;
+    ip = mp_decode_uint_skip(ip); // skip n_state
+    ip = mp_decode_uint_skip(ip); // skip n_exc_stack
+    ip++; // skip scope_params
+    ip++; // skip n_pos_args
+    ip++; // skip n_kwonly_args
+    ip++; // skip n_def_pos_args
+    size_t bc = ip_in - ip;
+    size_t code_info_size = mp_decode_uint_value(ip);
+    ip = mp_decode_uint_skip(ip); // skip code_info_size
+    bc -= code_info_size;
+    #if MICROPY_PERSISTENT_CODE
+    *block_name = ip[0] | (ip[1] << 8);
+    *source_file = ip[2] | (ip[3] << 8);
+    ip += 4;
+    #else
+    *block_name = mp_decode_uint_value(ip);
+    ip = mp_decode_uint_skip(ip);
+    *source_file = mp_decode_uint_value(ip);
+    ip = mp_decode_uint_skip(ip);
+    #endif
+    size_t source_line = 1;
+    size_t c;
+    while ((c = *ip)) {
+        size_t b, l;
+        if ((c & 0x80) == 0) {
+            // 0b0LLBBBBB encoding
+            b = c & 0x1f;
+            l = c >> 5;
+            ip += 1;
+        } else {
+            // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
+            b = c & 0xf;
+            l = ((c << 4) & 0x700) | ip[1];
+            ip += 2;
+        }
+        if (bc >= b) {
+            bc -= b;
+            source_line += l;
+        } else {
+            // found source line corresponding to bytecode offset
+            break;
+        }
+    }
+    return source_line;
+}
+
+#if MICROPY_PROF_SAMPLES
+// Record where the main thread is in its bytecode.  This is meant to be
+// called from a timer interrupt (or a task which preempts the main thread)
+// and doesn't allocate; the oldest sample is overwritten once the ring is full.
+void mp_prof_sample(void) {
+    // always the main VM, whichever task the interrupt preempted
+    const mp_code_state_t *code_state = mp_state_ctx.thread.code_state;
+    mp_state_vm_t *vm = &mp_state_ctx.vm;
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    mp_prof_sample_t *sample = &vm->prof_samples[vm->prof_sample_idx];
+    if (code_state == NULL) {
+        sample->bytecode = NULL;
+        sample->ip = NULL;
+    } else {
+        sample->bytecode = code_state->fun_bc->bytecode;
+        sample->ip = code_state->ip;
+    }
+    vm->prof_sample_idx = (vm->prof_sample_idx + 1) % MICROPY_PROF_SAMPLES;
+    if (vm->prof_sample_len < MICROPY_PROF_SAMPLES) {
+        vm->prof_sample_len += 1;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+
+void mp_prof_clear(void) {
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    memset(MP_STATE_VM(prof_samples), 0, sizeof(MP_STATE_VM(prof_samples)));
+    MP_STATE_VM(prof_sample_idx) = 0;
+    MP_STATE_VM(prof_sample_len) = 0;
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+}
+#endif
+
 STATIC NORETURN void fun_pos_args_mismatch(mp_obj_fun_bc_t *f, size_t expected, size_t given) {
 #if MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE
     // generic message, used also for other argument issues
@@ -287,10 +370,12 @@ continue2:;
 #if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
 
 // The following table encodes the number of bytes that a specific opcode
-// takes up.  There are 3 special opcodes that always have an extra byte:
+// takes up.  There are 5 special opcodes that always have an extra byte:
 //     MP_BC_MAKE_CLOSURE
 //     MP_BC_MAKE_CLOSURE_DEFARGS
 //     MP_BC_RAISE_VARARGS
+//     MP_BC_COMPARE_POP_JUMP_IF_TRUE
+//     MP_BC_COMPARE_POP_JUMP_IF_FALSE
 // There are 4 special opcodes that have an extra byte only when
 // MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE is enabled (and they take a qstr):
 //     MP_BC_LOAD_NAME
@@ -318,7 +403,7 @@ STATIC const byte opcode_format_table[64] = {
     OC4(U, U, U, U), // 0x2c-0x2f
     OC4(B, B, B, B), // 0x30-0x33
     OC4(B, O, O, O), // 0x34-0x37
-    OC4(O, O, U, U), // 0x38-0x3b
+    OC4(O, O, O, O), // 0x38-0x3b
     OC4(U, O, B, O), // 0x3c-0x3f
     OC4(O, B, B, O), // 0x40-0x43
     OC4(O, U, O, B), // 0x44-0x47
@@ -400,6 +485,8 @@ uint mp_opcode_format(const byte *ip, size_t *opcode_size, bool count_var_uint)
             *ip == MP_BC_RAISE_VARARGS
             || *ip == MP_BC_MAKE_CLOSURE
             || *ip == MP_BC_MAKE_CLOSURE_DEFARGS
+            || *ip == MP_BC_COMPARE_POP_JUMP_IF_TRUE
+            || *ip == MP_BC_COMPARE_POP_JUMP_IF_FALSE
         );
         ip += 1;
         if (f == MP_OPCODE_VAR_UINT) {
@@ -50,6 +50,9 @@
 //  255             : byte     |    end of list sentinel
 //  <bytecode>                 |
 //
+// Frozen bytecode may instead start with MP_BC_PRELUDE_COMPRESSED, which is
+// never the first byte of an encoded n_state, see py/frozenmod.c.
+//
 //
 // constant table layout:
 //
@@ -59,6 +62,8 @@
 //  const0          : obj
 //  constN          : obj
 
+#define MP_BC_PRELUDE_COMPRESSED (0x80)
+
 // Exception stack entry
 typedef struct _mp_exc_stack_t {
     const byte *handler;
@@ -96,6 +101,11 @@ const byte *mp_decode_uint_skip(const byte *ptr);
 mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp_obj_t inject_exc);
 mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t func, size_t n_args, size_t n_kw, const mp_obj_t *args);
 void mp_setup_code_state(mp_code_state_t *code_state, size_t n_args, size_t n_kw, const mp_obj_t *args);
+size_t mp_bytecode_get_source_line(const byte *bytecode, const byte *ip, qstr *block_name, qstr *source_file);
+#if MICROPY_PROF_SAMPLES
+void mp_prof_sample(void);
+void mp_prof_clear(void);
+#endif
 void mp_bytecode_print(const void *descr, const byte *code, mp_uint_t len, const mp_uint_t *const_table);
 void mp_bytecode_print2(const byte *code, size_t len, const mp_uint_t *const_table);
 const byte *mp_bytecode_print_str(const byte *ip);
@@ -109,6 +109,14 @@
 #define MP_BC_IMPORT_FROM        (0x69) // qstr
 #define MP_BC_IMPORT_STAR        (0x6a)
 
+// Superinstructions, emitted by the compiler in place of common sequences of
+// the opcodes above when MICROPY_OPT_SUPERINSTRUCTIONS is enabled.  They are
+// never saved to .mpy files.
+#define MP_BC_LOAD_FAST_ATTR             (0x2c) // byte local, then as LOAD_ATTR
+#define MP_BC_LOAD_FAST_CONST_BINARY_OP  (0x2d) // uint: local | (small_int + 16) << 4 | op << 10
+#define MP_BC_COMPARE_POP_JUMP_IF_TRUE   (0x3a) // byte op; rel byte code offset, 16-bit signed, in excess
+#define MP_BC_COMPARE_POP_JUMP_IF_FALSE  (0x3b) // byte op; rel byte code offset, 16-bit signed, in excess
+
 #define MP_BC_LOAD_CONST_SMALL_INT_MULTI (0x70) // + N(64)
 #define MP_BC_LOAD_FAST_MULTI            (0xb0) // + N(16)
 #define MP_BC_STORE_FAST_MULTI           (0xc0) // + N(16)
@@ -119,10 +119,23 @@ extern const mp_obj_module_t mp_module_utimeq;
 extern const mp_obj_module_t mp_module_machine;
 extern const mp_obj_module_t mp_module_lwip;
 extern const mp_obj_module_t mp_module_uwebsocket;
+extern const mp_obj_module_t mp_module_umqttc;
+extern const mp_obj_module_t mp_module_uhttpc;
+extern const mp_obj_module_t mp_module_ulog;
+extern const mp_obj_module_t mp_module_uasyncio;
 extern const mp_obj_module_t mp_module_webrepl;
 extern const mp_obj_module_t mp_module_framebuf;
 extern const mp_obj_module_t mp_module_btree;
 
+#if MICROPY_PY_STRUCT_STRUCT
+// ustruct.Struct layouts for records kept by other modules, see modstruct.c
+mp_obj_t mp_struct_get(mp_obj_t fmt);
+size_t mp_struct_size(mp_obj_t st, size_t *n_items);
+mp_obj_t mp_struct_format(mp_obj_t st);
+void mp_struct_pack_into(mp_obj_t st, byte *p, size_t n_args, const mp_obj_t *args);
+mp_obj_t mp_struct_unpack(mp_obj_t st, const byte *p);
+#endif
+
 extern const char MICROPY_PY_BUILTINS_HELP_TEXT[];
 
 #endif // MICROPY_INCLUDED_PY_BUILTIN_H
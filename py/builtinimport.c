@@ -140,7 +140,11 @@ STATIC void do_load_from_lexer(mp_obj_t module_obj, mp_lexer_t *lex) {
 
     // parse, compile and execute the module in its context
     mp_obj_dict_t *mod_globals = mp_obj_module_get_globals(module_obj);
+    #if MICROPY_COMP_STREAM_FILE_INPUT
+    mp_parse_compile_execute_stream(lex, mod_globals, mod_globals);
+    #else
     mp_parse_compile_execute(lex, MP_PARSE_FILE_INPUT, mod_globals, mod_globals);
+    #endif
 }
 #endif
 
@@ -181,6 +185,98 @@ STATIC void do_execute_raw_code(mp_obj_t module_obj, mp_raw_code_t *raw_code) {
 }
 #endif
 
+#if MICROPY_MODULE_MPY_CACHE
+
+#if !MICROPY_PERSISTENT_CODE_LOAD || !MICROPY_PERSISTENT_CODE_SAVE
+#error MICROPY_MODULE_MPY_CACHE requires MICROPY_PERSISTENT_CODE_LOAD and MICROPY_PERSISTENT_CODE_SAVE
+#endif
+
+#define MPY_CACHE_KEY_SIZE (8)
+
+// The key of a source file is its length and a hash of its contents
+STATIC void mpy_cache_source_key(const char *file_str, byte *key) {
+    mp_reader_t reader;
+    mp_reader_new_file(&reader, file_str);
+    uint32_t len = 0;
+    uint32_t hash = 5381;
+    for (mp_uint_t c; (c = reader.readbyte(reader.data)) != MP_READER_EOF;) {
+        hash = (hash * 33) ^ c;
+        ++len;
+    }
+    reader.close(reader.data);
+    for (int i = 0; i < 4; ++i) {
+        key[i] = len >> (8 * i);
+        key[4 + i] = hash >> (8 * i);
+    }
+}
+
+STATIC void mpy_cache_reader_keep_open(void *data) {
+    (void)data;
+}
+
+// Load the cached code, or return NULL if it's missing, stale or unloadable
+STATIC mp_raw_code_t *mpy_cache_load(const char *cache_str, const byte *key) {
+    if (mp_import_stat(cache_str) != MP_IMPORT_STAT_FILE) {
+        return NULL;
+    }
+    mp_reader_t reader;
+    mp_reader_new_file(&reader, cache_str);
+    void (*close)(void *data) = reader.close;
+    mp_raw_code_t *rc = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        // the key follows the code, so keep the file open for reading it
+        reader.close = mpy_cache_reader_keep_open;
+        rc = mp_raw_code_load(&reader);
+        for (int i = 0; i < MPY_CACHE_KEY_SIZE; ++i) {
+            if (reader.readbyte(reader.data) != key[i]) {
+                rc = NULL;
+                break;
+            }
+        }
+        nlr_pop();
+    } else {
+        rc = NULL;
+    }
+    close(reader.data);
+    return rc;
+}
+
+STATIC mp_raw_code_t *mpy_cache_compile(const char *file_str, const char *cache_str, const byte *key) {
+    mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
+    qstr source_name = lex->source_name;
+    mp_raw_code_t *rc;
+
+    // compile without superinstructions, so the code can be saved
+    nlr_buf_t nlr;
+    MP_STATE_VM(mpy_cache_compiling) = true;
+    if (nlr_push(&nlr) == 0) {
+        mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+        rc = mp_compile_to_raw_code(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+        nlr_pop();
+        MP_STATE_VM(mpy_cache_compiling) = false;
+    } else {
+        MP_STATE_VM(mpy_cache_compiling) = false;
+        #if MICROPY_COMP_STREAM_FILE_INPUT
+        // too big to compile as a whole; the caller streams it uncached
+        if (mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(((mp_obj_base_t*)nlr.ret_val)->type), MP_OBJ_FROM_PTR(&mp_type_MemoryError))) {
+            return NULL;
+        }
+        #endif
+        nlr_jump(nlr.ret_val);
+    }
+
+    // failing to save (eg on a read-only filesystem) still imports the module
+    if (nlr_push(&nlr) == 0) {
+        mp_raw_code_save_file_extra(rc, cache_str, key, MPY_CACHE_KEY_SIZE);
+        nlr_pop();
+    }
+
+    return rc;
+}
+
+#endif
+
 STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     #if MICROPY_MODULE_FROZEN || MICROPY_ENABLE_COMPILER || (MICROPY_PERSISTENT_CODE_LOAD && MICROPY_HAS_FILE_READER)
     char *file_str = vstr_null_terminated_str(file);
@@ -224,6 +320,29 @@ STATIC void do_load(mp_obj_t module_obj, vstr_t *file) {
     // If we can compile scripts then load the file and compile and execute it.
     #if MICROPY_ENABLE_COMPILER
     {
+        #if MICROPY_MODULE_MPY_CACHE
+        {
+            byte key[MPY_CACHE_KEY_SIZE];
+            mpy_cache_source_key(file_str, key);
+            vstr_t cache;
+            vstr_init(&cache, file->len + 2);
+            vstr_add_strn(&cache, file_str, file->len);
+            vstr_ins_byte(&cache, cache.len - 2, 'm');
+            const char *cache_str = vstr_null_terminated_str(&cache);
+            mp_raw_code_t *raw_code = mpy_cache_load(cache_str, key);
+            if (raw_code == NULL) {
+                raw_code = mpy_cache_compile(file_str, cache_str, key);
+            }
+            vstr_clear(&cache);
+            if (raw_code != NULL) {
+                #if MICROPY_PY___FILE__
+                mp_store_attr(module_obj, MP_QSTR___file__, MP_OBJ_NEW_QSTR(qstr_from_str(file_str)));
+                #endif
+                do_execute_raw_code(module_obj, raw_code);
+                return;
+            }
+        }
+        #endif
         mp_lexer_t *lex = mp_lexer_new_from_file(file_str);
         do_load_from_lexer(module_obj, lex);
         return;
@@ -34,6 +34,7 @@
 #include "py/emit.h"
 #include "py/compile.h"
 #include "py/runtime.h"
+#include "py/objtuple.h"
 #include "py/asmbase.h"
 #include "py/persistentcode.h"
 
@@ -313,7 +314,71 @@ STATIC void compile_delete_id(compiler_t *comp, qstr qst) {
     }
 }
 
+#if MICROPY_COMP_CONST_TUPLE
+STATIC mp_obj_t get_const_object(mp_parse_node_struct_t *pns);
+
+// Whether a node is a literal that can go in a constant tuple
+STATIC bool c_is_const_value(mp_parse_node_t pn) {
+    return MP_PARSE_NODE_IS_SMALL_INT(pn)
+        || (MP_PARSE_NODE_IS_LEAF(pn) && (MP_PARSE_NODE_LEAF_KIND(pn) == MP_PARSE_NODE_STRING
+            || MP_PARSE_NODE_LEAF_KIND(pn) == MP_PARSE_NODE_BYTES))
+        || MP_PARSE_NODE_IS_STRUCT_KIND(pn, PN_const_object);
+}
+
+STATIC mp_obj_t c_const_value(mp_parse_node_t pn) {
+    if (MP_PARSE_NODE_IS_SMALL_INT(pn)) {
+        return MP_OBJ_NEW_SMALL_INT(MP_PARSE_NODE_LEAF_SMALL_INT(pn));
+    } else if (MP_PARSE_NODE_IS_LEAF(pn)) {
+        qstr qst = MP_PARSE_NODE_LEAF_ARG(pn);
+        if (MP_PARSE_NODE_LEAF_KIND(pn) == MP_PARSE_NODE_STRING) {
+            return MP_OBJ_NEW_QSTR(qst);
+        } else {
+            size_t len;
+            const byte *data = qstr_data(qst, &len);
+            return mp_obj_new_bytes(data, len);
+        }
+    } else {
+        return get_const_object((mp_parse_node_struct_t*)pn);
+    }
+}
+
+// Builds the tuple if all its items are literals, else returns MP_OBJ_NULL
+STATIC mp_obj_t c_tuple_const(mp_parse_node_t pn, mp_parse_node_struct_t *pns_list) {
+    size_t n = pns_list == NULL ? 0 : MP_PARSE_NODE_STRUCT_NUM_NODES(pns_list);
+    size_t first = 0;
+    if (!MP_PARSE_NODE_IS_NULL(pn)) {
+        if (!c_is_const_value(pn)) {
+            return MP_OBJ_NULL;
+        }
+        first = 1;
+    } else if (n == 0) {
+        // the empty tuple is already a constant at runtime
+        return MP_OBJ_NULL;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!c_is_const_value(pns_list->nodes[i])) {
+            return MP_OBJ_NULL;
+        }
+    }
+    mp_obj_tuple_t *tuple = MP_OBJ_TO_PTR(mp_obj_new_tuple(first + n, NULL));
+    if (first) {
+        tuple->items[0] = c_const_value(pn);
+    }
+    for (size_t i = 0; i < n; i++) {
+        tuple->items[first + i] = c_const_value(pns_list->nodes[i]);
+    }
+    return MP_OBJ_FROM_PTR(tuple);
+}
+#endif
+
 STATIC void c_tuple(compiler_t *comp, mp_parse_node_t pn, mp_parse_node_struct_t *pns_list) {
+    #if MICROPY_COMP_CONST_TUPLE
+    mp_obj_t tuple = c_tuple_const(pn, pns_list);
+    if (tuple != MP_OBJ_NULL) {
+        EMIT_ARG(load_const_obj, tuple);
+        return;
+    }
+    #endif
     int total = 0;
     if (!MP_PARSE_NODE_IS_NULL(pn)) {
         compile_node(comp, pn);
@@ -3329,6 +3394,11 @@ STATIC void compile_scope_inline_asm(compiler_t *comp, scope_t *scope, pass_kind
                 0, 0, 0, 0, NULL,
                 #endif
                 comp->scope_cur->num_pos_args, 0, type_sig);
+
+            #if MICROPY_PERF_MAP
+            mp_emit_glue_perf_map(f, mp_asm_base_get_code_size((mp_asm_base_t*)comp->emit_inline_asm),
+                comp->scope_cur->simple_name);
+            #endif
         }
     }
 
@@ -3431,10 +3501,18 @@ STATIC void scope_compute_things(scope_t *scope) {
     }
 }
 
-#if !MICROPY_PERSISTENT_CODE_SAVE
-STATIC
-#endif
-mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl) {
+// With native_scope nonzero, the scope in that position is compiled with the
+// native emitter and its raw code returned, or NULL if it isn't native_name
+STATIC mp_raw_code_t *compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl,
+    size_t native_scope, qstr native_name) {
+    #if MICROPY_OPT_TIERED_NATIVE
+    size_t scope_index = 0;
+    mp_raw_code_t *native_raw_code = NULL;
+    #else
+    (void)native_scope;
+    (void)native_name;
+    #endif
+
     // put compiler state on the stack, it's relatively small
     compiler_t comp_state = {0};
     compiler_t *comp = &comp_state;
@@ -3457,6 +3535,16 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
     #endif
     uint max_num_labels = 0;
     for (scope_t *s = comp->scope_head; s != NULL && comp->compile_error == MP_OBJ_NULL; s = s->next) {
+        #if MICROPY_OPT_TIERED_NATIVE
+        // scopes are found in the same order each time the file is compiled
+        s->raw_code->scope_index = ++scope_index;
+        s->raw_code->src_hash = parse_tree->src_hash;
+        if (scope_index == native_scope && s->simple_name == native_name
+            && s->emit_options == MP_EMIT_OPT_NONE) {
+            s->emit_options = MP_EMIT_OPT_NATIVE_PYTHON;
+            native_raw_code = s->raw_code;
+        }
+        #endif
         if (false) {
         #if MICROPY_EMIT_INLINE_ASM
         } else if (s->emit_options == MP_EMIT_OPT_ASM) {
@@ -3597,9 +3685,20 @@ mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_f
 
     if (comp->compile_error != MP_OBJ_NULL) {
         nlr_raise(comp->compile_error);
-    } else {
-        return outer_raw_code;
     }
+    #if MICROPY_OPT_TIERED_NATIVE
+    if (native_scope != 0) {
+        return native_raw_code;
+    }
+    #endif
+    return outer_raw_code;
+}
+
+#if !MICROPY_PERSISTENT_CODE_SAVE
+STATIC
+#endif
+mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl) {
+    return compile_to_raw_code(parse_tree, source_file, emit_opt, is_repl, 0, MP_QSTR_NULL);
 }
 
 mp_obj_t mp_compile(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl) {
@@ -3608,4 +3707,17 @@ mp_obj_t mp_compile(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt
     return mp_make_function_from_raw_code(rc, MP_OBJ_NULL, MP_OBJ_NULL);
 }
 
+#if MICROPY_OPT_TIERED_NATIVE
+mp_raw_code_t *mp_compile_native_scope(qstr source_file, uint32_t src_hash, size_t scope_index, qstr name) {
+    mp_lexer_t *lex = mp_lexer_new_from_file(qstr_str(source_file));
+    mp_parse_tree_t parse_tree = mp_parse(lex, MP_PARSE_FILE_INPUT);
+    if (parse_tree.src_hash != src_hash) {
+        // the file was changed since the function was compiled from it
+        mp_parse_tree_clear(&parse_tree);
+        return NULL;
+    }
+    return compile_to_raw_code(&parse_tree, source_file, MP_EMIT_OPT_NONE, false, scope_index, name);
+}
+#endif
+
 #endif // MICROPY_ENABLE_COMPILER
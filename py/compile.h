@@ -39,7 +39,16 @@ mp_obj_t mp_compile(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt
 mp_raw_code_t *mp_compile_to_raw_code(mp_parse_tree_t *parse_tree, qstr source_file, uint emit_opt, bool is_repl);
 #endif
 
+#if MICROPY_OPT_TIERED_NATIVE
+// Compile source_file again with its scope_index'th scope as native code and
+// return the raw code of that scope, or NULL if that scope is no longer name
+mp_raw_code_t *mp_compile_native_scope(qstr source_file, uint32_t src_hash, size_t scope_index, qstr name);
+#endif
+
 // this is implemented in runtime.c
 mp_obj_t mp_parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t parse_input_kind, mp_obj_dict_t *globals, mp_obj_dict_t *locals);
+#if MICROPY_COMP_STREAM_FILE_INPUT
+void mp_parse_compile_execute_stream(mp_lexer_t *lex, mp_obj_dict_t *globals, mp_obj_dict_t *locals);
+#endif
 
 #endif // MICROPY_INCLUDED_PY_COMPILE_H
@@ -39,6 +39,26 @@
 #define BYTES_FOR_INT ((BYTES_PER_WORD * 8 + 6) / 7)
 #define DUMMY_DATA_SIZE (BYTES_FOR_INT)
 
+// Superinstructions can't go in .mpy files because they must load on any VM,
+// so with the .mpy import cache they are only left out of code being cached
+#if MICROPY_MODULE_MPY_CACHE
+#define EMIT_FUSE (MICROPY_OPT_SUPERINSTRUCTIONS)
+#define EMIT_FUSE_ALLOWED() (!MP_STATE_VM(mpy_cache_compiling))
+#else
+#define EMIT_FUSE (MICROPY_OPT_SUPERINSTRUCTIONS && !MICROPY_PERSISTENT_CODE_SAVE)
+#define EMIT_FUSE_ALLOWED() (true)
+#endif
+
+#if EMIT_FUSE
+// What the opcodes emitted last, starting at fuse_offset, can be fused with
+enum {
+    FUSE_NONE,
+    FUSE_LOCAL, // LOAD_FAST_MULTI
+    FUSE_LOCAL_CONST, // LOAD_FAST_MULTI, LOAD_CONST_SMALL_INT_MULTI
+    FUSE_COMPARE, // BINARY_OP_MULTI with a relational operator
+};
+#endif
+
 struct _emit_t {
     // Accessed as mp_obj_t, so must be aligned as such, and we rely on the
     // memory allocator returning a suitably aligned pointer.
@@ -70,6 +90,12 @@ struct _emit_t {
     uint16_t ct_cur_raw_code;
     #endif
     mp_uint_t *const_table;
+
+    #if EMIT_FUSE
+    byte fuse_kind;
+    byte fuse_arg[2];
+    size_t fuse_offset;
+    #endif
 };
 
 emit_t *emit_bc_new(void) {
@@ -306,6 +332,34 @@ STATIC void emit_write_bytecode_byte_signed_label(emit_t *emit, byte b1, mp_uint
     c[2] = bytecode_offset >> 8;
 }
 
+#if EMIT_FUSE
+
+// Note that the given opcodes were just emitted at the given offset.
+STATIC void emit_fuse_set(emit_t *emit, int kind, size_t offset, byte arg0, byte arg1) {
+    if (!EMIT_FUSE_ALLOWED()) {
+        return;
+    }
+    emit->fuse_kind = kind;
+    emit->fuse_offset = offset;
+    emit->fuse_arg[0] = arg0;
+    emit->fuse_arg[1] = arg1;
+}
+
+// Check if the opcodes of the given kind are the last ones emitted, taking up
+// the given number of bytes, and if so go back to overwrite them.  The checks
+// on offsets make sure nothing else was emitted in between, and that no label
+// or line number boundary falls inside the sequence.
+STATIC bool emit_fuse_rewind(emit_t *emit, int kind, size_t len) {
+    if (emit->fuse_kind != kind || emit->bytecode_offset != emit->fuse_offset + len) {
+        return false;
+    }
+    emit->fuse_kind = FUSE_NONE;
+    emit->bytecode_offset = emit->fuse_offset;
+    return true;
+}
+
+#endif
+
 void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     emit->pass = pass;
     emit->stack_size = 0;
@@ -321,6 +375,9 @@ void mp_emit_bc_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     #endif
     emit->bytecode_offset = 0;
     emit->code_info_offset = 0;
+    #if EMIT_FUSE
+    emit->fuse_kind = FUSE_NONE;
+    #endif
 
     // Write local state size and exception stack size.
     {
@@ -485,6 +542,9 @@ void mp_emit_bc_set_source_line(emit_t *emit, mp_uint_t source_line) {
         emit_write_code_info_bytes_lines(emit, bytes_to_skip, lines_to_skip);
         emit->last_source_line_offset = emit->bytecode_offset;
         emit->last_source_line = source_line;
+        #if EMIT_FUSE
+        emit->fuse_kind = FUSE_NONE;
+        #endif
     }
 #else
     (void)emit;
@@ -498,6 +558,9 @@ void mp_emit_bc_label_assign(emit_t *emit, mp_uint_t l) {
         return;
     }
     assert(l < emit->max_num_labels);
+    #if EMIT_FUSE
+    emit->fuse_kind = FUSE_NONE;
+    #endif
     if (emit->pass < MP_PASS_EMIT) {
         // assign label offset
         assert(emit->label_offsets[l] == (mp_uint_t)-1);
@@ -539,6 +602,11 @@ void mp_emit_bc_load_const_tok(emit_t *emit, mp_token_kind_t tok) {
 void mp_emit_bc_load_const_small_int(emit_t *emit, mp_int_t arg) {
     emit_bc_pre(emit, 1);
     if (-16 <= arg && arg <= 47) {
+        #if EMIT_FUSE
+        if (emit->fuse_kind == FUSE_LOCAL && emit->bytecode_offset == emit->fuse_offset + 1) {
+            emit_fuse_set(emit, FUSE_LOCAL_CONST, emit->fuse_offset, emit->fuse_arg[0], 16 + arg);
+        }
+        #endif
         emit_write_bytecode_byte(emit, MP_BC_LOAD_CONST_SMALL_INT_MULTI + 16 + arg);
     } else {
         emit_write_bytecode_byte_int(emit, MP_BC_LOAD_CONST_SMALL_INT, arg);
@@ -566,6 +634,9 @@ void mp_emit_bc_load_local(emit_t *emit, qstr qst, mp_uint_t local_num, int kind
     (void)qst;
     emit_bc_pre(emit, 1);
     if (kind == MP_EMIT_IDOP_LOCAL_FAST && local_num <= 15) {
+        #if EMIT_FUSE
+        emit_fuse_set(emit, FUSE_LOCAL, emit->bytecode_offset, local_num, 0);
+        #endif
         emit_write_bytecode_byte(emit, MP_BC_LOAD_FAST_MULTI + local_num);
     } else {
         emit_write_bytecode_byte_uint(emit, MP_BC_LOAD_FAST_N + kind, local_num);
@@ -610,7 +681,15 @@ void mp_emit_bc_subscr(emit_t *emit, int kind) {
 void mp_emit_bc_attr(emit_t *emit, qstr qst, int kind) {
     if (kind == MP_EMIT_ATTR_LOAD) {
         emit_bc_pre(emit, 0);
-        emit_write_bytecode_byte_qstr(emit, MP_BC_LOAD_ATTR, qst);
+        #if EMIT_FUSE
+        if (emit_fuse_rewind(emit, FUSE_LOCAL, 1)) {
+            emit_write_bytecode_byte(emit, MP_BC_LOAD_FAST_ATTR);
+            emit_write_bytecode_byte_qstr(emit, emit->fuse_arg[0], qst);
+        } else
+        #endif
+        {
+            emit_write_bytecode_byte_qstr(emit, MP_BC_LOAD_ATTR, qst);
+        }
     } else {
         if (kind == MP_EMIT_ATTR_DELETE) {
             mp_emit_bc_load_null(emit);
@@ -689,6 +768,13 @@ void mp_emit_bc_jump(emit_t *emit, mp_uint_t label) {
 
 void mp_emit_bc_pop_jump_if(emit_t *emit, bool cond, mp_uint_t label) {
     emit_bc_pre(emit, -1);
+    #if EMIT_FUSE
+    if (emit_fuse_rewind(emit, FUSE_COMPARE, 1)) {
+        emit_write_bytecode_byte(emit, cond ? MP_BC_COMPARE_POP_JUMP_IF_TRUE : MP_BC_COMPARE_POP_JUMP_IF_FALSE);
+        emit_write_bytecode_byte_signed_label(emit, emit->fuse_arg[0], label);
+        return;
+    }
+    #endif
     if (cond) {
         emit_write_bytecode_byte_signed_label(emit, MP_BC_POP_JUMP_IF_TRUE, label);
     } else {
@@ -785,6 +871,16 @@ void mp_emit_bc_binary_op(emit_t *emit, mp_binary_op_t op) {
         op = MP_BINARY_OP_IS;
     }
     emit_bc_pre(emit, -1);
+    #if EMIT_FUSE
+    if (!invert && emit_fuse_rewind(emit, FUSE_LOCAL_CONST, 2)) {
+        emit_write_bytecode_byte_uint(emit, MP_BC_LOAD_FAST_CONST_BINARY_OP,
+            emit->fuse_arg[0] | emit->fuse_arg[1] << 4 | op << 10);
+        return;
+    }
+    if (!invert && op <= MP_BINARY_OP_IS) {
+        emit_fuse_set(emit, FUSE_COMPARE, emit->bytecode_offset, op, 0);
+    }
+    #endif
     emit_write_bytecode_byte(emit, MP_BC_BINARY_OP_MULTI + op);
     if (invert) {
         emit_bc_pre(emit, 0);
@@ -35,6 +35,10 @@
 #include "py/runtime0.h"
 #include "py/bc.h"
 
+#if MICROPY_PERF_MAP
+#include <unistd.h>
+#endif
+
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
 #define WRITE_CODE (1)
@@ -88,7 +92,7 @@ void mp_emit_glue_assign_bytecode(mp_raw_code_t *rc, const byte *code,
 #endif
 }
 
-#if MICROPY_EMIT_NATIVE || MICROPY_EMIT_INLINE_ASM
+#if MICROPY_EMIT_MACHINE_CODE || MICROPY_EMIT_INLINE_ASM
 void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void *fun_data, mp_uint_t fun_len, const mp_uint_t *const_table,
     #if MICROPY_PERSISTENT_CODE_SAVE
     uint16_t prelude_offset,
@@ -106,8 +110,10 @@ void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void
     rc->const_table = const_table;
     rc->type_sig = type_sig;
 
-    #if MICROPY_PERSISTENT_CODE_SAVE
+    #if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_OPT_TIERED_NATIVE
     rc->fun_data_len = fun_len;
+    #endif
+    #if MICROPY_PERSISTENT_CODE_SAVE
     rc->prelude_offset = prelude_offset;
     rc->n_obj = n_obj;
     rc->n_raw_code = n_raw_code;
@@ -136,6 +142,25 @@ void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void
 }
 #endif
 
+#if MICROPY_PERF_MAP
+// Append a line for the given native code to /tmp/perf-<pid>.map, the file
+// perf reads to symbolise samples in code that was generated at run time
+void mp_emit_glue_perf_map(const void *fun_data, mp_uint_t fun_len, qstr name) {
+    static FILE *perf_map = NULL;
+    if (perf_map == NULL) {
+        char path[32];
+        snprintf(path, sizeof(path), "/tmp/perf-%d.map", (int)getpid());
+        perf_map = fopen(path, "a");
+        if (perf_map == NULL) {
+            return;
+        }
+    }
+    fprintf(perf_map, "%lx %lx native:%s\n", (unsigned long)(uintptr_t)fun_data,
+        (unsigned long)fun_len, qstr_str(name));
+    fflush(perf_map);
+}
+#endif
+
 mp_obj_t mp_make_function_from_raw_code(const mp_raw_code_t *rc, mp_obj_t def_args, mp_obj_t def_kw_args) {
     DEBUG_OP_printf("make_function_from_raw_code %p\n", rc);
     assert(rc != NULL);
@@ -149,7 +174,7 @@ mp_obj_t mp_make_function_from_raw_code(const mp_raw_code_t *rc, mp_obj_t def_ar
     // make the function, depending on the raw code kind
     mp_obj_t fun;
     switch (rc->kind) {
-        #if MICROPY_EMIT_NATIVE
+        #if MICROPY_EMIT_MACHINE_CODE
         case MP_CODE_NATIVE_PY:
         case MP_CODE_NATIVE_VIPER:
             fun = mp_obj_new_fun_native(def_args, def_kw_args, rc->fun_data, rc->const_table);
@@ -168,6 +193,10 @@ mp_obj_t mp_make_function_from_raw_code(const mp_raw_code_t *rc, mp_obj_t def_ar
             // rc->kind should always be set and BYTECODE is the only remaining case
             assert(rc->kind == MP_CODE_BYTECODE);
             fun = mp_obj_new_fun_bc(def_args, def_kw_args, rc->fun_data, rc->const_table);
+            #if MICROPY_OPT_TIERED_NATIVE
+            ((mp_obj_fun_bc_t*)MP_OBJ_TO_PTR(fun))->tier_scope = rc->scope_index;
+            ((mp_obj_fun_bc_t*)MP_OBJ_TO_PTR(fun))->tier_hash = rc->src_hash;
+            #endif
             // check for generator functions and if so change the type of the object
             if ((rc->scope_flags & MP_SCOPE_FLAG_GENERATOR) != 0) {
                 ((mp_obj_base_t*)MP_OBJ_TO_PTR(fun))->type = &mp_type_gen_wrap;
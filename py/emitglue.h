@@ -59,17 +59,23 @@ typedef struct _mp_raw_code_t {
     mp_uint_t n_pos_args : 11;
     const void *fun_data;
     const mp_uint_t *const_table;
-    #if MICROPY_PERSISTENT_CODE_SAVE
+    #if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_OPT_TIERED_NATIVE
     size_t fun_data_len;
+    #endif
+    #if MICROPY_OPT_TIERED_NATIVE
+    uint16_t scope_index; // position of the scope in its module, from 1; 0 if unknown
+    uint32_t src_hash; // of the module's source
+    #endif
+    #if MICROPY_PERSISTENT_CODE_SAVE
     uint16_t n_obj;
     uint16_t n_raw_code;
-    #if MICROPY_EMIT_NATIVE || MICROPY_EMIT_INLINE_ASM
+    #if MICROPY_EMIT_MACHINE_CODE || MICROPY_EMIT_INLINE_ASM
     uint16_t prelude_offset;
     uint16_t n_qstr;
     mp_qstr_link_entry_t *qstr_link;
     #endif
     #endif
-    #if MICROPY_EMIT_NATIVE || MICROPY_EMIT_INLINE_ASM
+    #if MICROPY_EMIT_MACHINE_CODE || MICROPY_EMIT_INLINE_ASM
     mp_uint_t type_sig; // for viper, compressed as 2-bit types; ret is MSB, then arg0, arg1, etc
     #endif
 } mp_raw_code_t;
@@ -95,6 +101,10 @@ void mp_emit_glue_assign_native(mp_raw_code_t *rc, mp_raw_code_kind_t kind, void
     #endif
     mp_uint_t n_pos_args, mp_uint_t scope_flags, mp_uint_t type_sig);
 
+#if MICROPY_PERF_MAP
+void mp_emit_glue_perf_map(const void *fun_data, mp_uint_t fun_len, qstr name);
+#endif
+
 mp_obj_t mp_make_function_from_raw_code(const mp_raw_code_t *rc, mp_obj_t def_args, mp_obj_t def_kw_args);
 mp_obj_t mp_make_closure_from_raw_code(const mp_raw_code_t *rc, mp_uint_t n_closed_over, const mp_obj_t *args);
 
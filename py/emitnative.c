@@ -78,7 +78,7 @@
 //  emit->code_state_start:     fun_obj, old_globals [optional]
 //  emit->stack_start:          Python object stack             | emit->n_state
 //                              locals (reversed, L0 at end)    |
-//                              (L0-L2 may be in regs instead)
+//                              (some locals may be in regs instead)
 
 // Word index of nlr_buf_t.ret_val
 #define NLR_BUF_IDX_RET_VAL (1)
@@ -129,6 +129,7 @@ typedef enum {
     VTYPE_PTR8 = 0x00 | MP_NATIVE_TYPE_PTR8,
     VTYPE_PTR16 = 0x00 | MP_NATIVE_TYPE_PTR16,
     VTYPE_PTR32 = 0x00 | MP_NATIVE_TYPE_PTR32,
+    VTYPE_PTRF32 = 0x00 | MP_NATIVE_TYPE_PTRF32,
 
     VTYPE_PTR_NONE = 0x50 | MP_NATIVE_TYPE_PTR,
 
@@ -146,6 +147,9 @@ STATIC qstr vtype_to_qstr(vtype_kind_t vtype) {
         case VTYPE_PTR8: return MP_QSTR_ptr8;
         case VTYPE_PTR16: return MP_QSTR_ptr16;
         case VTYPE_PTR32: return MP_QSTR_ptr32;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case VTYPE_PTRF32: return MP_QSTR_ptrf32;
+        #endif
         case VTYPE_PTR_NONE: default: return MP_QSTR_None;
     }
 }
@@ -207,6 +211,22 @@ struct _emit_t {
 
     bool last_emit_was_return_value;
 
+    // local held in each of the REG_LOCAL_NUM registers, or -1
+    int16_t reg_local_num[REG_LOCAL_NUM];
+
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    // uses of locals and backward jumps, recorded in MP_PASS_STACK_SIZE
+    uint16_t op_pos;
+    uint16_t max_num_labels;
+    uint16_t *label_pos;
+    size_t local_use_alloc;
+    size_t local_use_len;
+    uint16_t *local_use; // pairs of (local_num, op_pos)
+    size_t loop_alloc;
+    size_t loop_len;
+    uint16_t *loop; // pairs of (start op_pos, end op_pos)
+    #endif
+
     scope_t *scope;
 
     ASM_T *as;
@@ -228,6 +248,10 @@ emit_t *EXPORT_FUN(new)(mp_obj_t *error_slot, uint *label_slot, mp_uint_t max_nu
     emit->exc_stack = m_new(exc_stack_entry_t, emit->exc_stack_alloc);
     emit->as = m_new0(ASM_T, 1);
     mp_asm_base_init(&emit->as->base, max_num_labels);
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    emit->max_num_labels = max_num_labels;
+    emit->label_pos = m_new(uint16_t, max_num_labels);
+    #endif
     return emit;
 }
 
@@ -237,6 +261,11 @@ void EXPORT_FUN(free)(emit_t *emit) {
     m_del(exc_stack_entry_t, emit->exc_stack, emit->exc_stack_alloc);
     m_del(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc);
     m_del(stack_info_t, emit->stack_info, emit->stack_info_alloc);
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    m_del(uint16_t, emit->label_pos, emit->max_num_labels);
+    m_del(uint16_t, emit->local_use, emit->local_use_alloc);
+    m_del(uint16_t, emit->loop, emit->loop_alloc);
+    #endif
     m_del_obj(emit_t, emit);
 }
 
@@ -303,6 +332,104 @@ STATIC void emit_native_mov_reg_qstr_obj(emit_t *emit, int reg_dest, qstr qst) {
         emit_native_mov_state_reg((emit), (local_num), (reg_temp)); \
     } while (false)
 
+// Returns the register holding the given local, or -1 if it lives on the stack
+STATIC int emit_native_local_reg(emit_t *emit, mp_uint_t local_num) {
+    if (CAN_USE_REGS_FOR_LOCALS(emit)) {
+        for (int i = 0; i < REG_LOCAL_NUM; ++i) {
+            if (emit->reg_local_num[i] == (int)local_num) {
+                return reg_local_table[i];
+            }
+        }
+    }
+    return -1;
+}
+
+#if MICROPY_OPT_NATIVE_LOCAL_REGS
+
+// Whether uses of locals are worth recording to choose which go in registers
+#define NEED_LOCAL_USES(emit) ((emit)->pass == MP_PASS_STACK_SIZE && (emit)->op_pos < 0xffff \
+    && CAN_USE_REGS_FOR_LOCALS(emit) && (emit)->scope->num_locals > REG_LOCAL_NUM)
+
+STATIC uint16_t *emit_native_grow_pairs(uint16_t *pairs, size_t *alloc, size_t len) {
+    if (len + 2 > *alloc) {
+        pairs = m_renew(uint16_t, pairs, *alloc, *alloc + 32);
+        *alloc += 32;
+    }
+    return pairs;
+}
+
+STATIC void emit_native_note_local_use(emit_t *emit, mp_uint_t local_num) {
+    if (NEED_LOCAL_USES(emit)) {
+        emit->local_use = emit_native_grow_pairs(emit->local_use, &emit->local_use_alloc, emit->local_use_len);
+        emit->local_use[emit->local_use_len++] = local_num;
+        emit->local_use[emit->local_use_len++] = emit->op_pos++;
+    }
+}
+
+STATIC void emit_native_note_label(emit_t *emit, mp_uint_t label) {
+    if (NEED_LOCAL_USES(emit) && label < emit->max_num_labels) {
+        emit->label_pos[label] = emit->op_pos++;
+    }
+}
+
+STATIC void emit_native_note_jump(emit_t *emit, mp_uint_t label) {
+    if (NEED_LOCAL_USES(emit) && label < emit->max_num_labels && emit->label_pos[label] != 0xffff) {
+        // a jump back to a label assigned earlier closes a loop
+        emit->loop = emit_native_grow_pairs(emit->loop, &emit->loop_alloc, emit->loop_len);
+        emit->loop[emit->loop_len++] = emit->label_pos[label];
+        emit->loop[emit->loop_len++] = emit->op_pos++;
+    }
+}
+
+// Choose the locals to keep in registers: those with the most uses, where a
+// use inside n nested loops counts as 4^n uses.  Registers are given to the
+// chosen locals in increasing order of local number.
+STATIC void emit_native_choose_local_regs(emit_t *emit) {
+    mp_uint_t num_locals = emit->scope->num_locals;
+    uint32_t *weight = m_new0(uint32_t, num_locals);
+    for (size_t i = 0; i < emit->local_use_len; i += 2) {
+        uint16_t pos = emit->local_use[i + 1];
+        unsigned int depth = 0;
+        for (size_t j = 0; j < emit->loop_len; j += 2) {
+            if (emit->loop[j] <= pos && pos <= emit->loop[j + 1]) {
+                ++depth;
+            }
+        }
+        weight[emit->local_use[i]] += 1 << (2 * MIN(depth, 6));
+    }
+    mp_uint_t best[REG_LOCAL_NUM];
+    int n = 0;
+    for (; n < REG_LOCAL_NUM; ++n) {
+        // pick the heaviest local not yet chosen, the lowest numbered on a tie
+        mp_uint_t b = 0;
+        for (mp_uint_t l = 1; l < num_locals; ++l) {
+            if (weight[l] > weight[b]) {
+                b = l;
+            }
+        }
+        if (weight[b] == 0) {
+            break;
+        }
+        best[n] = b;
+        weight[b] = 0;
+    }
+    m_del(uint32_t, weight, num_locals);
+
+    // sort the chosen locals
+    for (int i = 1; i < n; ++i) {
+        for (int j = i; j > 0 && best[j - 1] > best[j]; --j) {
+            mp_uint_t t = best[j];
+            best[j] = best[j - 1];
+            best[j - 1] = t;
+        }
+    }
+    for (int i = 0; i < REG_LOCAL_NUM; ++i) {
+        emit->reg_local_num[i] = i < n ? (int16_t)best[i] : -1;
+    }
+}
+
+#endif
+
 STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scope) {
     DEBUG_printf("start_pass(pass=%u, scope=%p)\n", pass, scope);
 
@@ -317,6 +444,26 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
     emit->last_emit_was_return_value = false;
     emit->scope = scope;
 
+    // choose which locals are held in registers, by default L0..L2
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    if (pass == MP_PASS_CODE_SIZE && emit->local_use_len > 0) {
+        emit_native_choose_local_regs(emit);
+    } else if (pass != MP_PASS_EMIT)
+    #endif
+    {
+        for (int i = 0; i < REG_LOCAL_NUM; ++i) {
+            emit->reg_local_num[i] = i < scope->num_locals ? i : -1;
+        }
+    }
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    if (pass == MP_PASS_STACK_SIZE) {
+        emit->op_pos = 0;
+        emit->local_use_len = 0;
+        emit->loop_len = 0;
+        memset(emit->label_pos, 0xff, emit->max_num_labels * sizeof(uint16_t));
+    }
+    #endif
+
     // allocate memory for keeping track of the types of locals
     if (emit->local_vtype_alloc < scope->num_locals) {
         emit->local_vtype = m_renew(vtype_kind_t, emit->local_vtype, emit->local_vtype_alloc, scope->num_locals);
@@ -371,15 +518,16 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
         // Work out size of state (locals plus stack)
         // n_state counts all stack and locals, even those in registers
         emit->n_state = scope->num_locals + scope->stack_size;
+        // Locals L0.. that are in registers don't need a spot on the C stack
         int num_locals_in_regs = 0;
         if (CAN_USE_REGS_FOR_LOCALS(emit)) {
-            num_locals_in_regs = scope->num_locals;
-            if (num_locals_in_regs > REG_LOCAL_NUM) {
-                num_locals_in_regs = REG_LOCAL_NUM;
+            while (num_locals_in_regs < REG_LOCAL_NUM
+                && emit->reg_local_num[num_locals_in_regs] == num_locals_in_regs) {
+                ++num_locals_in_regs;
             }
-            // Need a spot for REG_LOCAL_3 if 4 or more args (see below)
-            if (scope->num_pos_args >= 4) {
-                --num_locals_in_regs;
+            // Need a spot for REG_LOCAL_3 if it holds an arg that is not the last (see below)
+            if (num_locals_in_regs > 2 && scope->num_pos_args >= 4) {
+                num_locals_in_regs = 2;
             }
         }
 
@@ -439,15 +587,17 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
                 r = REG_RET;
             }
             // REG_LOCAL_3 points to the args array so be sure not to overwrite it if it's still needed
-            if (i < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit) && (i != 2 || emit->scope->num_pos_args == 3)) {
-                ASM_MOV_REG_REG(emit->as, reg_local_table[i], r);
+            int reg_local = emit_native_local_reg(emit, i);
+            if (reg_local != -1 && (reg_local != REG_LOCAL_3 || i == emit->scope->num_pos_args - 1)) {
+                ASM_MOV_REG_REG(emit->as, reg_local, r);
             } else {
                 emit_native_mov_state_reg(emit, LOCAL_IDX_LOCAL_VAR(emit, i), r);
             }
         }
-        // Get 3rd local from the stack back into REG_LOCAL_3 if this reg couldn't be written to above
-        if (emit->scope->num_pos_args >= 4 && CAN_USE_REGS_FOR_LOCALS(emit)) {
-            ASM_MOV_REG_LOCAL(emit->as, REG_LOCAL_3, LOCAL_IDX_LOCAL_VAR(emit, 2));
+        // Get local from the stack back into REG_LOCAL_3 if this reg couldn't be written to above
+        if (CAN_USE_REGS_FOR_LOCALS(emit) && emit->reg_local_num[2] != -1
+            && emit->reg_local_num[2] < emit->scope->num_pos_args - 1) {
+            ASM_MOV_REG_LOCAL(emit->as, REG_LOCAL_3, LOCAL_IDX_LOCAL_VAR(emit, emit->reg_local_num[2]));
         }
 
         emit_native_global_exc_entry(emit);
@@ -524,8 +674,10 @@ STATIC void emit_native_start_pass(emit_t *emit, pass_kind_t pass, scope_t *scop
 
         // cache some locals in registers, but only if no exception handlers
         if (CAN_USE_REGS_FOR_LOCALS(emit)) {
-            for (int i = 0; i < REG_LOCAL_NUM && i < scope->num_locals; ++i) {
-                ASM_MOV_REG_LOCAL(emit->as, reg_local_table[i], LOCAL_IDX_LOCAL_VAR(emit, i));
+            for (int i = 0; i < REG_LOCAL_NUM; ++i) {
+                if (emit->reg_local_num[i] != -1) {
+                    ASM_MOV_REG_LOCAL(emit->as, reg_local_table[i], LOCAL_IDX_LOCAL_VAR(emit, emit->reg_local_num[i]));
+                }
             }
         }
 
@@ -633,6 +785,10 @@ STATIC void emit_native_end_pass(emit_t *emit) {
             emit->qstr_link_cur, emit->qstr_link,
             #endif
             emit->scope->num_pos_args, emit->scope->scope_flags, 0);
+
+        #if MICROPY_PERF_MAP
+        mp_emit_glue_perf_map(f, f_len, emit->scope->simple_name);
+        #endif
     }
 }
 
@@ -1070,6 +1226,9 @@ STATIC void emit_native_label_assign(emit_t *emit, mp_uint_t l) {
     need_stack_settled(emit);
     mp_asm_base_label_assign(&emit->as->base, l);
     emit_post(emit);
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    emit_native_note_label(emit, l);
+    #endif
 
     if (is_finally) {
         // Label is at start of finally handler: pop exception stack
@@ -1316,8 +1475,12 @@ STATIC void emit_native_load_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
         EMIT_NATIVE_VIPER_TYPE_ERROR(emit, "local '%q' used before type known", qst);
     }
     emit_native_pre(emit);
-    if (local_num < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit)) {
-        emit_post_push_reg(emit, vtype, reg_local_table[local_num]);
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    emit_native_note_local_use(emit, local_num);
+    #endif
+    int reg_local = emit_native_local_reg(emit, local_num);
+    if (reg_local != -1) {
+        emit_post_push_reg(emit, vtype, reg_local);
     } else {
         need_reg_single(emit, REG_TEMP0, 0);
         emit_native_mov_reg_state(emit, REG_TEMP0, LOCAL_IDX_LOCAL_VAR(emit, local_num));
@@ -1425,6 +1588,13 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
         // TODO The different machine architectures have very different
         // capabilities and requirements for loads, so probably best to
         // write a completely separate load-optimiser for each one.
+        #if MICROPY_PY_BUILTINS_FLOAT
+        // a ptrf32 load is a ptr32 load of the bits, which are then boxed
+        bool is_float = vtype_base == VTYPE_PTRF32;
+        if (is_float) {
+            peek_stack(emit, 1)->vtype = VTYPE_PTR32;
+        }
+        #endif
         stack_info_t *top = peek_stack(emit, 0);
         if (top->vtype == VTYPE_INT && top->kind == STACK_IMM) {
             // index is an immediate
@@ -1433,6 +1603,8 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
             int reg_base = REG_ARG_1;
             int reg_index = REG_ARG_2;
             emit_pre_pop_reg_flexible(emit, &vtype_base, &reg_base, reg_index, reg_index);
+            // the result is loaded into REG_RET so it can't hold a stack entry
+            need_reg_single(emit, REG_RET, 0);
             switch (vtype_base) {
                 case VTYPE_PTR8: {
                     // pointer to 8-bit memory
@@ -1496,6 +1668,7 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
             int reg_index = REG_ARG_2;
             emit_pre_pop_reg_flexible(emit, &vtype_index, &reg_index, REG_ARG_1, REG_ARG_1);
             emit_pre_pop_reg(emit, &vtype_base, REG_ARG_1);
+            need_reg_single(emit, REG_RET, 0);
             if (vtype_index != VTYPE_INT && vtype_index != VTYPE_UINT) {
                 EMIT_NATIVE_VIPER_TYPE_ERROR(emit,
                     "can't load with '%q' index", vtype_to_qstr(vtype_index));
@@ -1529,14 +1702,26 @@ STATIC void emit_native_load_subscr(emit_t *emit) {
                         "can't load from '%q'", vtype_to_qstr(vtype_base));
             }
         }
+        #if MICROPY_PY_BUILTINS_FLOAT
+        if (is_float) {
+            ASM_MOV_REG_REG(emit->as, REG_ARG_1, REG_RET);
+            emit_call_with_imm_arg(emit, MP_F_CONVERT_NATIVE_TO_OBJ, MP_NATIVE_TYPE_FLOAT32, REG_ARG_2);
+            emit_post_push_reg(emit, VTYPE_PYOBJ, REG_RET);
+            return;
+        }
+        #endif
         emit_post_push_reg(emit, VTYPE_INT, REG_RET);
     }
 }
 
 STATIC void emit_native_store_fast(emit_t *emit, qstr qst, mp_uint_t local_num) {
     vtype_kind_t vtype;
-    if (local_num < REG_LOCAL_NUM && CAN_USE_REGS_FOR_LOCALS(emit)) {
-        emit_pre_pop_reg(emit, &vtype, reg_local_table[local_num]);
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    emit_native_note_local_use(emit, local_num);
+    #endif
+    int reg_local = emit_native_local_reg(emit, local_num);
+    if (reg_local != -1) {
+        emit_pre_pop_reg(emit, &vtype, reg_local);
     } else {
         emit_pre_pop_reg(emit, &vtype, REG_TEMP0);
         emit_native_mov_state_reg(emit, LOCAL_IDX_LOCAL_VAR(emit, local_num), REG_TEMP0);
@@ -1633,6 +1818,23 @@ STATIC void emit_native_store_subscr(emit_t *emit) {
         // TODO The different machine architectures have very different
         // capabilities and requirements for stores, so probably best to
         // write a completely separate store-optimiser for each one.
+        #if MICROPY_PY_BUILTINS_FLOAT
+        if (vtype_base == VTYPE_PTRF32) {
+            // convert the value to single-precision bits and store those as for ptr32
+            vtype_kind_t vtype_value;
+            emit_access_stack(emit, 3, &vtype_value, REG_ARG_1);
+            if (vtype_value != VTYPE_PYOBJ) {
+                emit_call_with_imm_arg(emit, MP_F_CONVERT_NATIVE_TO_OBJ, vtype_value, REG_ARG_2);
+                ASM_MOV_REG_REG(emit->as, REG_ARG_1, REG_RET);
+            }
+            emit_call_with_imm_arg(emit, MP_F_CONVERT_OBJ_TO_NATIVE, MP_NATIVE_TYPE_FLOAT32, REG_ARG_2);
+            stack_info_t *si = peek_stack(emit, 2);
+            si->kind = STACK_VALUE;
+            si->vtype = VTYPE_UINT;
+            emit_native_mov_state_reg(emit, emit->stack_start + emit->stack_size - 3, REG_RET);
+            peek_stack(emit, 1)->vtype = VTYPE_PTR32;
+        }
+        #endif
         stack_info_t *top = peek_stack(emit, 0);
         if (top->vtype == VTYPE_INT && top->kind == STACK_IMM) {
             // index is an immediate
@@ -1883,6 +2085,9 @@ STATIC void emit_native_jump(emit_t *emit, mp_uint_t label) {
     need_stack_settled(emit);
     ASM_JUMP(emit->as, label);
     emit_post(emit);
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    emit_native_note_jump(emit, label);
+    #endif
 }
 
 STATIC void emit_native_jump_helper(emit_t *emit, bool cond, mp_uint_t label, bool pop) {
@@ -1916,6 +2121,9 @@ STATIC void emit_native_jump_helper(emit_t *emit, bool cond, mp_uint_t label, bo
     } else {
         ASM_JUMP_IF_REG_ZERO(emit->as, REG_RET, label, vtype == VTYPE_PYOBJ);
     }
+    #if MICROPY_OPT_NATIVE_LOCAL_REGS
+    emit_native_note_jump(emit, label);
+    #endif
     if (!pop) {
         adjust_stack(emit, -1);
     }
@@ -2529,6 +2737,7 @@ STATIC void emit_native_call_function(emit_t *emit, mp_uint_t n_positional, mp_u
             case VTYPE_PTR8:
             case VTYPE_PTR16:
             case VTYPE_PTR32:
+            case VTYPE_PTRF32:
             case VTYPE_PTR_NONE:
                 emit_fold_stack_top(emit, REG_ARG_1);
                 emit_post_top_set_vtype(emit, vtype_cast);
@@ -29,7 +29,9 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 #include "py/formatfloat.h"
 
@@ -426,4 +428,295 @@ int mp_format_float(FPTYPE f, char *buf, size_t buf_size, char fmt, int prec, ch
     return s - buf;
 }
 
+#if MICROPY_FLOAT_FORMAT_SHORTEST && MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+
+/***********************************************************************
+
+  Shortest round-trip formatting of single precision floats.
+
+  This is the Ryu algorithm by Ulf Adams (PLDI 2018, reference code at
+  https://github.com/ulfjack/ryu, Apache 2.0 / Boost licensed).  It finds
+  the shortest decimal that parses back to exactly the same float using
+  only integer arithmetic, instead of the repeated float multiplies and
+  divides of mp_format_float which can both round and lose the last digit.
+
+***********************************************************************/
+
+#define RYU_POW5_INV_BITCOUNT (59)
+#define RYU_POW5_BITCOUNT (61)
+
+// floor(2^(pow5bits(i) - 1 + RYU_POW5_INV_BITCOUNT) / 5^i) + 1
+static const uint64_t ryu_pow5_inv_split[31] = {
+    576460752303423489ULL, 461168601842738791ULL, 368934881474191033ULL,
+    295147905179352826ULL, 472236648286964522ULL, 377789318629571618ULL,
+    302231454903657294ULL, 483570327845851670ULL, 386856262276681336ULL,
+    309485009821345069ULL, 495176015714152110ULL, 396140812571321688ULL,
+    316912650057057351ULL, 507060240091291761ULL, 405648192073033409ULL,
+    324518553658426727ULL, 519229685853482763ULL, 415383748682786211ULL,
+    332306998946228969ULL, 531691198313966350ULL, 425352958651173080ULL,
+    340282366920938464ULL, 544451787073501542ULL, 435561429658801234ULL,
+    348449143727040987ULL, 557518629963265579ULL, 446014903970612463ULL,
+    356811923176489971ULL, 570899077082383953ULL, 456719261665907162ULL,
+    365375409332725730ULL,
+};
+
+// 5^i normalised to RYU_POW5_BITCOUNT bits
+static const uint64_t ryu_pow5_split[48] = {
+    1152921504606846976ULL, 1441151880758558720ULL, 1801439850948198400ULL,
+    2251799813685248000ULL, 1407374883553280000ULL, 1759218604441600000ULL,
+    2199023255552000000ULL, 1374389534720000000ULL, 1717986918400000000ULL,
+    2147483648000000000ULL, 1342177280000000000ULL, 1677721600000000000ULL,
+    2097152000000000000ULL, 1310720000000000000ULL, 1638400000000000000ULL,
+    2048000000000000000ULL, 1280000000000000000ULL, 1600000000000000000ULL,
+    2000000000000000000ULL, 1250000000000000000ULL, 1562500000000000000ULL,
+    1953125000000000000ULL, 1220703125000000000ULL, 1525878906250000000ULL,
+    1907348632812500000ULL, 1192092895507812500ULL, 1490116119384765625ULL,
+    1862645149230957031ULL, 1164153218269348144ULL, 1455191522836685180ULL,
+    1818989403545856475ULL, 2273736754432320594ULL, 1421085471520200371ULL,
+    1776356839400250464ULL, 2220446049250313080ULL, 1387778780781445675ULL,
+    1734723475976807094ULL, 2168404344971008868ULL, 1355252715606880542ULL,
+    1694065894508600678ULL, 2117582368135750847ULL, 1323488980084844279ULL,
+    1654361225106055349ULL, 2067951531382569187ULL, 1292469707114105741ULL,
+    1615587133892632177ULL, 2019483917365790221ULL, 1262177448353618888ULL,
+};
+
+// ceil(log2(5^e)) for e > 0, and 1 for e == 0
+static inline int32_t ryu_pow5bits(int32_t e) {
+    return (int32_t)(((uint32_t)e * 1217359) >> 19) + 1;
+}
+
+// floor(log10(2^e)) and floor(log10(5^e)), both valid for 0 <= e <= 1650
+static inline uint32_t ryu_log10_pow2(int32_t e) {
+    return ((uint32_t)e * 78913) >> 18;
+}
+
+static inline uint32_t ryu_log10_pow5(int32_t e) {
+    return ((uint32_t)e * 732923) >> 20;
+}
+
+static bool ryu_multiple_of_pow5(uint32_t value, uint32_t p) {
+    uint32_t count = 0;
+    while (value % 5 == 0) {
+        value /= 5;
+        ++count;
+    }
+    return count >= p;
+}
+
+static inline bool ryu_multiple_of_pow2(uint32_t value, uint32_t p) {
+    return (value & ((1u << p) - 1)) == 0;
+}
+
+// (m * factor) >> shift, for shift > 32, with only 32x32->64 multiplies
+static inline uint32_t ryu_mul_shift(uint32_t m, uint64_t factor, int32_t shift) {
+    uint64_t bits0 = (uint64_t)m * (uint32_t)factor;
+    uint64_t bits1 = (uint64_t)m * (uint32_t)(factor >> 32);
+    uint64_t sum = (bits0 >> 32) + bits1;
+    return (uint32_t)(sum >> (shift - 32));
+}
+
+// Compute the shortest decimal digits and exponent of a finite, non-zero float,
+// returning the digits as an integer and storing the power of 10 in *exp10
+static uint32_t ryu_f2d(uint32_t ieee_mantissa, uint32_t ieee_exponent, int32_t *exp10) {
+    int32_t e2;
+    uint32_t m2;
+    if (ieee_exponent == 0) {
+        e2 = 1 - 127 - 23 - 2;
+        m2 = ieee_mantissa;
+    } else {
+        e2 = (int32_t)ieee_exponent - 127 - 23 - 2;
+        m2 = (1u << 23) | ieee_mantissa;
+    }
+    const bool accept_bounds = (m2 & 1) == 0;
+
+    // the value and the two halfway points to its neighbours, scaled by 4
+    const uint32_t mv = 4 * m2;
+    const uint32_t mp = 4 * m2 + 2;
+    const uint32_t mm_shift = ieee_mantissa != 0 || ieee_exponent <= 1;
+    const uint32_t mm = 4 * m2 - 1 - mm_shift;
+
+    // convert the interval to base 10
+    uint32_t vr, vp, vm;
+    int32_t e10;
+    bool vm_trailing_zeros = false;
+    bool vr_trailing_zeros = false;
+    uint8_t last_removed_digit = 0;
+    if (e2 >= 0) {
+        const uint32_t q = ryu_log10_pow2(e2);
+        e10 = q;
+        const int32_t k = RYU_POW5_INV_BITCOUNT + ryu_pow5bits(q) - 1;
+        const int32_t i = -e2 + (int32_t)q + k;
+        vr = ryu_mul_shift(mv, ryu_pow5_inv_split[q], i);
+        vp = ryu_mul_shift(mp, ryu_pow5_inv_split[q], i);
+        vm = ryu_mul_shift(mm, ryu_pow5_inv_split[q], i);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            // the loop below removes at most one digit, so we need the one before it
+            const int32_t l = RYU_POW5_INV_BITCOUNT + ryu_pow5bits(q - 1) - 1;
+            last_removed_digit = ryu_mul_shift(mv, ryu_pow5_inv_split[q - 1], -e2 + (int32_t)q - 1 + l) % 10;
+        }
+        if (q <= 9) {
+            // only one of mp, mv and mm can be a multiple of 5, if any
+            if (mv % 5 == 0) {
+                vr_trailing_zeros = ryu_multiple_of_pow5(mv, q);
+            } else if (accept_bounds) {
+                vm_trailing_zeros = ryu_multiple_of_pow5(mm, q);
+            } else {
+                vp -= ryu_multiple_of_pow5(mp, q);
+            }
+        }
+    } else {
+        const uint32_t q = ryu_log10_pow5(-e2);
+        e10 = (int32_t)q + e2;
+        const int32_t i = -e2 - (int32_t)q;
+        const int32_t k = ryu_pow5bits(i) - RYU_POW5_BITCOUNT;
+        int32_t j = (int32_t)q - k;
+        vr = ryu_mul_shift(mv, ryu_pow5_split[i], j);
+        vp = ryu_mul_shift(mp, ryu_pow5_split[i], j);
+        vm = ryu_mul_shift(mm, ryu_pow5_split[i], j);
+        if (q != 0 && (vp - 1) / 10 <= vm / 10) {
+            j = (int32_t)q - 1 - (ryu_pow5bits(i + 1) - RYU_POW5_BITCOUNT);
+            last_removed_digit = ryu_mul_shift(mv, ryu_pow5_split[i + 1], j) % 10;
+        }
+        if (q <= 1) {
+            // mv = 4 * m2 always has at least two trailing 0 bits
+            vr_trailing_zeros = true;
+            if (accept_bounds) {
+                vm_trailing_zeros = mm_shift == 1;
+            } else {
+                --vp;
+            }
+        } else if (q < 31) {
+            vr_trailing_zeros = ryu_multiple_of_pow2(mv, q - 1);
+        }
+    }
+
+    // remove digits while the interval still distinguishes the value
+    int32_t removed = 0;
+    uint32_t output;
+    if (vm_trailing_zeros || vr_trailing_zeros) {
+        // the rare case where the bounds or the value are exact
+        while (vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed_digit == 0;
+            last_removed_digit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        if (vm_trailing_zeros) {
+            while (vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed_digit == 0;
+                last_removed_digit = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                ++removed;
+            }
+        }
+        if (vr_trailing_zeros && last_removed_digit == 5 && vr % 2 == 0) {
+            // exactly halfway, round to even
+            last_removed_digit = 4;
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed_digit >= 5);
+    } else {
+        while (vp / 10 > vm / 10) {
+            last_removed_digit = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            ++removed;
+        }
+        output = vr + (vr == vm || last_removed_digit >= 5);
+    }
+
+    *exp10 = e10 + removed;
+    return output;
+}
+
+int mp_format_float_shortest(float f, char *buf, size_t buf_size) {
+    char *s = buf;
+    union floatbits fb = {f};
+    uint32_t ieee_mantissa = fb.u & FLT_MAN_MASK;
+    uint32_t ieee_exponent = (fb.u & FLT_EXP_MASK) >> 23;
+
+    assert(buf_size >= MP_FORMAT_FLOAT_SHORTEST_BUF_SIZE);
+    (void)buf_size;
+
+    if (ieee_exponent == 0xff && ieee_mantissa != 0) {
+        memcpy(s, "nan", 4);
+        return 3;
+    }
+    if (fb.u & FLT_SIGN_MASK) {
+        *s++ = '-';
+    }
+    if (ieee_exponent == 0xff) {
+        memcpy(s, "inf", 4);
+        return s + 3 - buf;
+    }
+    if (ieee_exponent == 0 && ieee_mantissa == 0) {
+        *s++ = '0';
+        *s = '\0';
+        return s - buf;
+    }
+
+    int32_t exp10;
+    uint32_t output = ryu_f2d(ieee_mantissa, ieee_exponent, &exp10);
+
+    // write the digits out backwards into a scratch area, at most 9 of them
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + output % 10;
+        output /= 10;
+    } while (output != 0);
+
+    // exponent of the leading digit, then lay out like Python's repr
+    int e = exp10 + n - 1;
+    if (e < -4 || e >= 16) {
+        *s++ = digits[--n];
+        if (n > 0) {
+            *s++ = '.';
+            while (n > 0) {
+                *s++ = digits[--n];
+            }
+        }
+        *s++ = 'e';
+        if (e < 0) {
+            *s++ = '-';
+            e = -e;
+        } else {
+            *s++ = '+';
+        }
+        *s++ = '0' + e / 10;
+        *s++ = '0' + e % 10;
+    } else if (e < 0) {
+        *s++ = '0';
+        *s++ = '.';
+        for (int i = -1; i > e; --i) {
+            *s++ = '0';
+        }
+        while (n > 0) {
+            *s++ = digits[--n];
+        }
+    } else {
+        for (int i = 0; i <= e; ++i) {
+            *s++ = n > 0 ? digits[--n] : '0';
+        }
+        if (n > 0) {
+            *s++ = '.';
+            while (n > 0) {
+                *s++ = digits[--n];
+            }
+        }
+    }
+    *s = '\0';
+
+    assert((size_t)(s + 1 - buf) <= buf_size);
+
+    return s - buf;
+}
+
+#endif // MICROPY_FLOAT_FORMAT_SHORTEST && MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+
 #endif // MICROPY_FLOAT_IMPL != MICROPY_FLOAT_IMPL_NONE
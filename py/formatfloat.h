@@ -32,4 +32,10 @@
 int mp_format_float(mp_float_t f, char *buf, size_t bufSize, char fmt, int prec, char sign);
 #endif
 
+#if MICROPY_FLOAT_FORMAT_SHORTEST && MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+// Big enough for "-0.000123456789" and "-1234567890000000"
+#define MP_FORMAT_FLOAT_SHORTEST_BUF_SIZE (20)
+int mp_format_float_shortest(float f, char *buf, size_t buf_size);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_FORMATFLOAT_H
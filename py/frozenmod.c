@@ -96,6 +96,95 @@ STATIC const mp_raw_code_t *mp_find_frozen_mpy(const char *str, size_t len) {
 
 #endif
 
+#if MICROPY_MODULE_FROZEN_MPY_COMPRESSED
+
+#if !MICROPY_PY_UZLIB
+#error MICROPY_MODULE_FROZEN_MPY_COMPRESSED requires MICROPY_PY_UZLIB
+#endif
+
+#include "py/runtime.h"
+#include "py/bc.h"
+
+#define UZLIB_CONF_FAST_BITS MICROPY_PY_UZLIB_FAST_BITS
+#include "extmod/uzlib/tinf.h"
+
+// Compressed bytecode, as written by mpy-tool.py -mcompress-bytecode, is:
+//
+//  MP_BC_PRELUDE_COMPRESSED : byte
+//  code_len        : var uint      size of the expanded bytecode
+//  deflate_len     : var uint      size of the raw deflate stream
+//  n_qstr          : var uint
+//  qstr0_offset    : var uint  |   offset from the end of the previous qstr
+//  qstr0           : 2 bytes   |   little endian qstr to write at that offset
+//  ...                         |   N = n_qstr
+//  <deflate stream>
+//
+// The qstrs are kept out of the stream because their values are only known
+// when the port is built.
+STATIC const byte *frozen_mpy_inflate(const byte *code) {
+    const byte *ip = code + 1;
+    size_t code_len = mp_decode_uint(&ip);
+    size_t deflate_len = mp_decode_uint(&ip);
+    size_t n_qstr = mp_decode_uint(&ip);
+    const byte *qstrs = ip;
+    for (size_t i = 0; i < n_qstr; ++i) {
+        ip = mp_decode_uint_skip(ip) + 2;
+    }
+
+    byte *buf = m_new(byte, code_len);
+    TINF_DATA *decomp = m_new_obj(TINF_DATA);
+    memset(decomp, 0, sizeof(*decomp));
+    uzlib_uncompress_init(decomp, NULL, 0);
+    decomp->source = ip;
+    decomp->source_limit = ip + deflate_len;
+    decomp->dest_start = decomp->dest = buf;
+    decomp->dest_limit = buf + code_len;
+    int st;
+    do {
+        st = uzlib_uncompress(decomp);
+    } while (st == TINF_OK && decomp->dest < decomp->dest_limit);
+    bool ok = st >= 0 && decomp->dest == decomp->dest_limit;
+    m_del_obj(TINF_DATA, decomp);
+    if (!ok) {
+        m_del(byte, buf, code_len);
+        mp_raise_msg(&mp_type_RuntimeError, "corrupt frozen bytecode");
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < n_qstr; ++i) {
+        offset += mp_decode_uint(&qstrs);
+        buf[offset++] = *qstrs++;
+        buf[offset++] = *qstrs++;
+    }
+    return buf;
+}
+
+// Return the expanded copy of compressed bytecode, reusing a recent one if
+// there is one.  Entries that drop off the end of the cache stay alive for
+// as long as the functions using them.
+const byte *mp_frozen_mpy_decompress(const byte *code) {
+    const byte **cache = MP_STATE_VM(frozen_mpy_code_cache);
+    size_t i = 0;
+    const byte *bc = NULL;
+    for (; i < MICROPY_MODULE_FROZEN_MPY_COMPRESSED - 1; ++i) {
+        if (cache[2 * i] == code || cache[2 * i] == NULL) {
+            break;
+        }
+    }
+    if (cache[2 * i] == code) {
+        bc = cache[2 * i + 1];
+    } else {
+        bc = frozen_mpy_inflate(code);
+    }
+    // move the entry to the front, dropping the last one if it was not found
+    memmove(&cache[2], &cache[0], 2 * i * sizeof(*cache));
+    cache[0] = code;
+    cache[1] = bc;
+    return bc;
+}
+
+#endif
+
 #if MICROPY_MODULE_FROZEN
 
 STATIC mp_import_stat_t mp_frozen_stat_helper(const char *name, const char *str) {
@@ -38,4 +38,8 @@ int mp_find_frozen_module(const char *str, size_t len, void **data);
 const char *mp_find_frozen_str(const char *str, size_t *len);
 mp_import_stat_t mp_frozen_stat(const char *str);
 
+#if MICROPY_MODULE_FROZEN_MPY_COMPRESSED
+const byte *mp_frozen_mpy_decompress(const byte *code);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_FROZENMOD_H
@@ -30,6 +30,8 @@
 
 #include "py/gc.h"
 #include "py/runtime.h"
+#include "py/bc.h"
+#include "py/mphal.h"
 
 #if MICROPY_ENABLE_GC
 
@@ -74,26 +76,32 @@
 #define ATB_3_IS_FREE(a) (((a) & ATB_MASK_3) == 0)
 
 #define BLOCK_SHIFT(block) (2 * ((block) & (BLOCKS_PER_ATB - 1)))
-#define ATB_GET_KIND(block) ((MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
-#define ATB_ANY_TO_FREE(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
-#define ATB_FREE_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
-#define ATB_FREE_TO_TAIL(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
-#define ATB_HEAD_TO_MARK(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
-#define ATB_MARK_TO_HEAD(block) do { MP_STATE_MEM(gc_alloc_table_start)[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
-
-#define BLOCK_FROM_PTR(ptr) (((byte*)(ptr) - MP_STATE_MEM(gc_pool_start)) / BYTES_PER_BLOCK)
-#define PTR_FROM_BLOCK(block) (((block) * BYTES_PER_BLOCK + (uintptr_t)MP_STATE_MEM(gc_pool_start)))
+#define ATB_GET_KIND(area, block) (((area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] >> BLOCK_SHIFT(block)) & 3)
+#define ATB_ANY_TO_FREE(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_MARK << BLOCK_SHIFT(block))); } while (0)
+#define ATB_FREE_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_HEAD << BLOCK_SHIFT(block)); } while (0)
+#define ATB_FREE_TO_TAIL(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_TAIL << BLOCK_SHIFT(block)); } while (0)
+#define ATB_HEAD_TO_MARK(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] |= (AT_MARK << BLOCK_SHIFT(block)); } while (0)
+#define ATB_MARK_TO_HEAD(area, block) do { (area)->gc_alloc_table_start[(block) / BLOCKS_PER_ATB] &= (~(AT_TAIL << BLOCK_SHIFT(block))); } while (0)
+
+#define BLOCK_FROM_PTR(area, ptr) (((byte*)(ptr) - (area)->gc_pool_start) / BYTES_PER_BLOCK)
+#define PTR_FROM_BLOCK(area, block) (((block) * BYTES_PER_BLOCK + (uintptr_t)(area)->gc_pool_start))
 #define ATB_FROM_BLOCK(bl) ((bl) / BLOCKS_PER_ATB)
 
+#if MICROPY_GC_SPLIT_HEAP
+#define NEXT_AREA(area) ((area)->next)
+#else
+#define NEXT_AREA(area) (NULL)
+#endif
+
 #if MICROPY_ENABLE_FINALISER
 // FTB = finaliser table byte
 // if set, then the corresponding block may have a finaliser
 
 #define BLOCKS_PER_FTB (8)
 
-#define FTB_GET(block) ((MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
-#define FTB_SET(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
-#define FTB_CLEAR(block) do { MP_STATE_MEM(gc_finaliser_table_start)[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
+#define FTB_GET(area, block) (((area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] >> ((block) & 7)) & 1)
+#define FTB_SET(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] |= (1 << ((block) & 7)); } while (0)
+#define FTB_CLEAR(area, block) do { (area)->gc_finaliser_table_start[(block) / BLOCKS_PER_FTB] &= (~(1 << ((block) & 7))); } while (0)
 #endif
 
 #if MICROPY_PY_THREAD && !MICROPY_PY_THREAD_GIL
@@ -104,8 +112,18 @@
 #define GC_EXIT()
 #endif
 
+#if MICROPY_GC_FREE_LISTS
+// Empty the free lists; their chains are unmarked heads, so the next sweep
+// frees them (or keeps them again if fill is set)
+STATIC void gc_free_lists_drain(bool fill) {
+    MP_STATE_MEM(gc_free_list_len)[0] = 0;
+    MP_STATE_MEM(gc_free_list_len)[1] = 0;
+    MP_STATE_MEM(gc_free_list_fill) = fill;
+}
+#endif
+
 // TODO waste less memory; currently requires that all entries in alloc_table have a corresponding block in pool
-void gc_init(void *start, void *end) {
+STATIC void gc_setup_area(mp_state_mem_area_t *area, void *start, void *end) {
     // align end pointer on block boundary
     end = (void*)((uintptr_t)end & (~(BYTES_PER_BLOCK - 1)));
     DEBUG_printf("Initializing GC heap: %p..%p = " UINT_FMT " bytes\n", start, end, (byte*)end - (byte*)start);
@@ -117,36 +135,54 @@ void gc_init(void *start, void *end) {
     // => T = A * (1 + BLOCKS_PER_ATB / BLOCKS_PER_FTB + BLOCKS_PER_ATB * BYTES_PER_BLOCK)
     size_t total_byte_len = (byte*)end - (byte*)start;
 #if MICROPY_ENABLE_FINALISER
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
+    area->gc_alloc_table_byte_len = total_byte_len * BITS_PER_BYTE / (BITS_PER_BYTE + BITS_PER_BYTE * BLOCKS_PER_ATB / BLOCKS_PER_FTB + BITS_PER_BYTE * BLOCKS_PER_ATB * BYTES_PER_BLOCK);
 #else
-    MP_STATE_MEM(gc_alloc_table_byte_len) = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
+    area->gc_alloc_table_byte_len = total_byte_len / (1 + BITS_PER_BYTE / 2 * BYTES_PER_BLOCK);
 #endif
 
-    MP_STATE_MEM(gc_alloc_table_start) = (byte*)start;
+    area->gc_alloc_table_start = (byte*)start;
 
 #if MICROPY_ENABLE_FINALISER
-    size_t gc_finaliser_table_byte_len = (MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
-    MP_STATE_MEM(gc_finaliser_table_start) = MP_STATE_MEM(gc_alloc_table_start) + MP_STATE_MEM(gc_alloc_table_byte_len);
+    size_t gc_finaliser_table_byte_len = (area->gc_alloc_table_byte_len * BLOCKS_PER_ATB + BLOCKS_PER_FTB - 1) / BLOCKS_PER_FTB;
+    area->gc_finaliser_table_start = area->gc_alloc_table_start + area->gc_alloc_table_byte_len;
 #endif
 
-    size_t gc_pool_block_len = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
-    MP_STATE_MEM(gc_pool_start) = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
-    MP_STATE_MEM(gc_pool_end) = end;
+    size_t gc_pool_block_len = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    area->gc_pool_start = (byte*)end - gc_pool_block_len * BYTES_PER_BLOCK;
+    area->gc_pool_end = end;
 
 #if MICROPY_ENABLE_FINALISER
-    assert(MP_STATE_MEM(gc_pool_start) >= MP_STATE_MEM(gc_finaliser_table_start) + gc_finaliser_table_byte_len);
+    assert(area->gc_pool_start >= area->gc_finaliser_table_start + gc_finaliser_table_byte_len);
 #endif
 
     // clear ATBs
-    memset(MP_STATE_MEM(gc_alloc_table_start), 0, MP_STATE_MEM(gc_alloc_table_byte_len));
+    memset(area->gc_alloc_table_start, 0, area->gc_alloc_table_byte_len);
 
 #if MICROPY_ENABLE_FINALISER
     // clear FTBs
-    memset(MP_STATE_MEM(gc_finaliser_table_start), 0, gc_finaliser_table_byte_len);
+    memset(area->gc_finaliser_table_start, 0, gc_finaliser_table_byte_len);
 #endif
 
     // set last free ATB index to start of heap
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    area->gc_last_free_atb_index = 0;
+    #if MICROPY_GC_RUN_HINTS
+    memset(area->gc_last_run_atb_index, 0, sizeof(area->gc_last_run_atb_index));
+    #endif
+
+    #if MICROPY_GC_SPLIT_HEAP
+    area->next = NULL;
+    #endif
+
+    DEBUG_printf("GC layout:\n");
+    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_alloc_table_start, area->gc_alloc_table_byte_len, area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+#if MICROPY_ENABLE_FINALISER
+    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_finaliser_table_start, gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+#endif
+    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", area->gc_pool_start, gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+}
+
+void gc_init(void *start, void *end) {
+    gc_setup_area(&MP_STATE_MEM(area), start, end);
 
     // unlock the GC
     MP_STATE_MEM(gc_lock_depth) = 0;
@@ -154,24 +190,79 @@ void gc_init(void *start, void *end) {
     // allow auto collection
     MP_STATE_MEM(gc_auto_collect_enabled) = 1;
 
+    #if MICROPY_GC_MEM_PEAK
+    MP_STATE_MEM(gc_used_blocks) = 0;
+    MP_STATE_MEM(gc_peak_blocks) = 0;
+    MP_STATE_MEM(gc_total_blocks) = 0;
+    #endif
+
     #if MICROPY_GC_ALLOC_THRESHOLD
     // by default, maxuint for gc threshold, effectively turning gc-by-threshold off
     MP_STATE_MEM(gc_alloc_threshold) = (size_t)-1;
     MP_STATE_MEM(gc_alloc_amount) = 0;
     #endif
 
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    MP_STATE_MEM(gc_sweep_area) = NULL;
+    MP_STATE_MEM(gc_sweep_defer) = 0;
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+    gc_free_lists_drain(false);
+    #endif
+
+    #if MICROPY_GC_FINALISER_LIST
+    MP_STATE_MEM(gc_finaliser_list_len) = 0;
+    MP_STATE_MEM(gc_finaliser_ftb_used) = 0;
+    #endif
+
+    #if MICROPY_GC_ARENA
+    memset(MP_STATE_MEM(gc_arena), 0, sizeof(MP_STATE_MEM(gc_arena)));
+    MP_STATE_MEM(gc_arena_count) = 0;
+    MP_STATE_THREAD(gc_arena) = NULL;
+    #endif
+
     #if MICROPY_PY_THREAD
     mp_thread_mutex_init(&MP_STATE_MEM(gc_mutex));
     #endif
+}
 
-    DEBUG_printf("GC layout:\n");
-    DEBUG_printf("  alloc table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_alloc_table_start), MP_STATE_MEM(gc_alloc_table_byte_len), MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-#if MICROPY_ENABLE_FINALISER
-    DEBUG_printf("  finaliser table at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_finaliser_table_start), gc_finaliser_table_byte_len, gc_finaliser_table_byte_len * BLOCKS_PER_FTB);
+#if MICROPY_GC_SPLIT_HEAP
+void gc_add(void *start, void *end) {
+    // the area's state lives at the start of the new region
+    mp_state_mem_area_t *area = (mp_state_mem_area_t*)start;
+    start = (void*)(((uintptr_t)(area + 1) + sizeof(void*) - 1) & ~(sizeof(void*) - 1));
+    gc_setup_area(area, start, end);
+
+    // append it after the last area
+    GC_ENTER();
+    mp_state_mem_area_t *prev = &MP_STATE_MEM(area);
+    while (prev->next != NULL) {
+        prev = prev->next;
+    }
+    prev->next = area;
+    GC_EXIT();
+}
 #endif
-    DEBUG_printf("  pool at %p, length " UINT_FMT " bytes, " UINT_FMT " blocks\n", MP_STATE_MEM(gc_pool_start), gc_pool_block_len * BYTES_PER_BLOCK, gc_pool_block_len);
+
+#if MICROPY_GC_MEM_PEAK
+// Account for n blocks that became used
+STATIC inline void gc_peak_add(size_t n) {
+    MP_STATE_MEM(gc_used_blocks) += n;
+    MP_STATE_MEM(gc_total_blocks) += n;
+    if (MP_STATE_MEM(gc_used_blocks) > MP_STATE_MEM(gc_peak_blocks)) {
+        MP_STATE_MEM(gc_peak_blocks) = MP_STATE_MEM(gc_used_blocks);
+    }
 }
 
+void gc_reset_peak(void) {
+    GC_ENTER();
+    MP_STATE_MEM(gc_peak_blocks) = MP_STATE_MEM(gc_used_blocks);
+    MP_STATE_MEM(gc_total_blocks) = 0;
+    GC_EXIT();
+}
+#endif
+
 void gc_lock(void) {
     GC_ENTER();
     MP_STATE_MEM(gc_lock_depth)++;
@@ -188,13 +279,169 @@ bool gc_is_locked(void) {
     return MP_STATE_MEM(gc_lock_depth) != 0;
 }
 
+#if MICROPY_GC_RUN_HINTS
+// Move the run hints back to cover the blocks freed at block; the run they
+// make may begin up to MICROPY_GC_RUN_HINTS blocks earlier.
+STATIC void gc_run_hints_lower(mp_state_mem_area_t *area, size_t block) {
+    size_t atb = (block - MIN(block, MICROPY_GC_RUN_HINTS)) / BLOCKS_PER_ATB;
+    for (size_t i = 0; i < MICROPY_GC_RUN_HINTS; i++) {
+        if (atb < area->gc_last_run_atb_index[i]) {
+            area->gc_last_run_atb_index[i] = atb;
+        }
+    }
+}
+#endif
+
 // ptr should be of type void*
-#define VERIFY_PTR(ptr) ( \
+#define VERIFY_PTR(area, ptr) ( \
         ((uintptr_t)(ptr) & (BYTES_PER_BLOCK - 1)) == 0      /* must be aligned on a block */ \
-        && ptr >= (void*)MP_STATE_MEM(gc_pool_start)     /* must be above start of pool */ \
-        && ptr < (void*)MP_STATE_MEM(gc_pool_end)        /* must be below end of pool */ \
+        && ptr >= (void*)(area)->gc_pool_start           /* must be above start of pool */ \
+        && ptr < (void*)(area)->gc_pool_end              /* must be below end of pool */ \
     )
 
+// Return the heap area that ptr points into, or NULL if it is not a heap pointer
+STATIC inline mp_state_mem_area_t *gc_get_ptr_area(const void *ptr) {
+    #if MICROPY_GC_SPLIT_HEAP
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = area->next) {
+        if (VERIFY_PTR(area, ptr)) {
+            return area;
+        }
+    }
+    return NULL;
+    #else
+    return VERIFY_PTR(&MP_STATE_MEM(area), ptr) ? &MP_STATE_MEM(area) : NULL;
+    #endif
+}
+
+#if MICROPY_GC_ARENA
+// Return the arena that ptr points into, or NULL
+STATIC mp_gc_arena_t *gc_arena_find(const void *ptr) {
+    for (size_t i = 0; i < MICROPY_GC_ARENA; i++) {
+        mp_gc_arena_t *arena = &MP_STATE_MEM(gc_arena)[i];
+        if (arena->map != NULL && (const byte*)ptr >= arena->start && (const byte*)ptr < arena->end) {
+            return arena;
+        }
+    }
+    return NULL;
+}
+
+// A pointer to a tail block inside an arena refers to the arena's head, so
+// that anything allocated in it keeps the whole arena alive
+STATIC inline size_t gc_arena_head(mp_state_mem_area_t *area, const void *ptr, size_t block) {
+    if (MP_STATE_MEM(gc_arena_count) > 0 && ATB_GET_KIND(area, block) == AT_TAIL) {
+        mp_gc_arena_t *arena = gc_arena_find(ptr);
+        if (arena != NULL) {
+            return BLOCK_FROM_PTR(area, arena->map);
+        }
+    }
+    return block;
+}
+
+// Number of bytes in the arena allocation starting at ptr
+STATIC size_t gc_arena_nbytes(mp_gc_arena_t *arena, const byte *ptr) {
+    size_t b = (ptr - arena->start) / BYTES_PER_BLOCK;
+    size_t n = (arena->cur - arena->start) / BYTES_PER_BLOCK;
+    size_t n_blocks = 1;
+    while (b + n_blocks < n && !(arena->map[(b + n_blocks) / 8] & (1 << ((b + n_blocks) & 7)))) {
+        n_blocks += 1;
+    }
+    return n_blocks * BYTES_PER_BLOCK;
+}
+
+void *gc_arena_new(size_t n_bytes) {
+    size_t n_blocks = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
+    size_t n_map = (n_blocks + 8 * BYTES_PER_BLOCK - 1) / (8 * BYTES_PER_BLOCK);
+    if (n_blocks == 0) {
+        return NULL;
+    }
+    if (MP_STATE_MEM(gc_arena_count) == MICROPY_GC_ARENA) {
+        // a collection gives back the slots of the closed arenas
+        gc_collect();
+    }
+
+    // an arena created inside another one comes from the heap
+    mp_gc_arena_t *active = MP_STATE_THREAD(gc_arena);
+    MP_STATE_THREAD(gc_arena) = NULL;
+    byte *map = gc_alloc((n_map + n_blocks) * BYTES_PER_BLOCK, 0);
+    MP_STATE_THREAD(gc_arena) = active;
+    if (map == NULL) {
+        return NULL;
+    }
+    // the bump allocator hands out this memory without clearing it again
+    memset(map, 0, (n_map + n_blocks) * BYTES_PER_BLOCK);
+
+    GC_ENTER();
+    for (size_t i = 0; i < MICROPY_GC_ARENA; i++) {
+        mp_gc_arena_t *arena = &MP_STATE_MEM(gc_arena)[i];
+        if (arena->map == NULL) {
+            arena->map = map;
+            arena->start = map + n_map * BYTES_PER_BLOCK;
+            arena->cur = arena->start;
+            arena->end = arena->start + n_blocks * BYTES_PER_BLOCK;
+            arena->open = true;
+            MP_STATE_MEM(gc_arena_count)++;
+            GC_EXIT();
+            return map;
+        }
+    }
+    GC_EXIT();
+    gc_free(map);
+    return NULL;
+}
+
+STATIC mp_gc_arena_t *gc_arena_lookup(void *map) {
+    for (size_t i = 0; i < MICROPY_GC_ARENA; i++) {
+        if (MP_STATE_MEM(gc_arena)[i].map == map) {
+            return &MP_STATE_MEM(gc_arena)[i];
+        }
+    }
+    return NULL;
+}
+
+void *gc_arena_activate(void *map) {
+    mp_gc_arena_t *prev = MP_STATE_THREAD(gc_arena);
+    mp_gc_arena_t *arena = NULL;
+    if (map != NULL) {
+        GC_ENTER();
+        arena = gc_arena_lookup(map);
+        GC_EXIT();
+        assert(arena != NULL && arena->open);
+    }
+    MP_STATE_THREAD(gc_arena) = arena;
+    return prev == NULL ? NULL : prev->map;
+}
+
+void gc_arena_close(void *map) {
+    GC_ENTER();
+    mp_gc_arena_t *arena = gc_arena_lookup(map);
+    if (arena != NULL) {
+        arena->open = false;
+    }
+    GC_EXIT();
+}
+
+// Make each allocation of a closed arena that is still pointed into its own
+// marked chain. The bitmap and the unused end become unmarked chains that
+// the sweep frees.
+STATIC void gc_arena_promote(mp_gc_arena_t *arena) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(arena->map);
+    ATB_MARK_TO_HEAD(area, BLOCK_FROM_PTR(area, arena->map));
+    size_t start = BLOCK_FROM_PTR(area, arena->start);
+    size_t cur = BLOCK_FROM_PTR(area, arena->cur);
+    for (size_t b = start; b < cur; b++) {
+        if (arena->map[(b - start) / 8] & (1 << ((b - start) & 7))) {
+            ATB_ANY_TO_FREE(area, b);
+            ATB_FREE_TO_HEAD(area, b);
+            ATB_HEAD_TO_MARK(area, b);
+        }
+    }
+    if (arena->cur < arena->end) {
+        ATB_ANY_TO_FREE(area, cur);
+        ATB_FREE_TO_HEAD(area, cur);
+    }
+}
+#endif
+
 #ifndef TRACE_MARK
 #if DEBUG_PRINT
 #define TRACE_MARK(block, ptr) DEBUG_printf("gc_mark(%p)\n", ptr)
@@ -203,33 +450,86 @@ bool gc_is_locked(void) {
 #endif
 #endif
 
+#if MICROPY_GC_HEAP_STACK
+#define GC_STACK (MP_STATE_MEM(gc_stack_start))
+#define GC_AREA_STACK (MP_STATE_MEM(gc_area_stack_start))
+#define GC_STACK_LEN (MP_STATE_MEM(gc_stack_len))
+
+// Choose the stack for this collection: the longest run of free blocks at
+// the end of an area if it holds more entries than the static gc_stack.
+// Nothing is allocated while marking, so those blocks stay free throughout.
+STATIC void gc_setup_stack(void) {
+    MP_STATE_MEM(gc_stack_start) = MP_STATE_MEM(gc_stack);
+    #if MICROPY_GC_SPLIT_HEAP
+    MP_STATE_MEM(gc_area_stack_start) = MP_STATE_MEM(gc_area_stack);
+    const size_t entry_size = sizeof(MICROPY_GC_STACK_ENTRY_TYPE) + sizeof(mp_state_mem_area_t*);
+    #else
+    const size_t entry_size = sizeof(MICROPY_GC_STACK_ENTRY_TYPE);
+    #endif
+    MP_STATE_MEM(gc_stack_len) = MICROPY_ALLOC_GC_STACK_SIZE;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        size_t i = area->gc_alloc_table_byte_len;
+        while (i > 0 && area->gc_alloc_table_start[i - 1] == 0) {
+            i--;
+        }
+        size_t len = (area->gc_alloc_table_byte_len - i) * BLOCKS_PER_ATB * BYTES_PER_BLOCK / entry_size;
+        if (len > MP_STATE_MEM(gc_stack_len)) {
+            // the area pointers go first, they have the stricter alignment
+            byte *start = (byte*)PTR_FROM_BLOCK(area, i * BLOCKS_PER_ATB);
+            #if MICROPY_GC_SPLIT_HEAP
+            MP_STATE_MEM(gc_area_stack_start) = (mp_state_mem_area_t**)start;
+            start += len * sizeof(mp_state_mem_area_t*);
+            #endif
+            MP_STATE_MEM(gc_stack_start) = (MICROPY_GC_STACK_ENTRY_TYPE*)start;
+            MP_STATE_MEM(gc_stack_len) = len;
+        }
+    }
+}
+#else
+#define GC_STACK (MP_STATE_MEM(gc_stack))
+#define GC_AREA_STACK (MP_STATE_MEM(gc_area_stack))
+#define GC_STACK_LEN (MICROPY_ALLOC_GC_STACK_SIZE)
+#endif
+
 // Take the given block as the topmost block on the stack. Check all it's
 // children: mark the unmarked child blocks and put those newly marked
 // blocks on the stack. When all children have been checked, pop off the
 // topmost block on the stack and repeat with that one.
-STATIC void gc_mark_subtree(size_t block) {
+STATIC void gc_mark_subtree(mp_state_mem_area_t *area, size_t block) {
     // Start with the block passed in the argument.
     size_t sp = 0;
+    MICROPY_GC_STACK_ENTRY_TYPE *stack = GC_STACK;
+    #if MICROPY_GC_SPLIT_HEAP
+    mp_state_mem_area_t **area_stack = GC_AREA_STACK;
+    #endif
+    size_t stack_len = GC_STACK_LEN;
     for (;;) {
         // work out number of consecutive blocks in the chain starting with this one
         size_t n_blocks = 0;
         do {
             n_blocks += 1;
-        } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+        } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
 
         // check this block's children
-        void **ptrs = (void**)PTR_FROM_BLOCK(block);
+        void **ptrs = (void**)PTR_FROM_BLOCK(area, block);
         for (size_t i = n_blocks * BYTES_PER_BLOCK / sizeof(void*); i > 0; i--, ptrs++) {
             void *ptr = *ptrs;
-            if (VERIFY_PTR(ptr)) {
+            mp_state_mem_area_t *ptr_area = gc_get_ptr_area(ptr);
+            if (ptr_area != NULL) {
                 // Mark and push this pointer
-                size_t childblock = BLOCK_FROM_PTR(ptr);
-                if (ATB_GET_KIND(childblock) == AT_HEAD) {
+                size_t childblock = BLOCK_FROM_PTR(ptr_area, ptr);
+                #if MICROPY_GC_ARENA
+                childblock = gc_arena_head(ptr_area, ptr, childblock);
+                #endif
+                if (ATB_GET_KIND(ptr_area, childblock) == AT_HEAD) {
                     // an unmarked head, mark it, and push it on gc stack
                     TRACE_MARK(childblock, ptr);
-                    ATB_HEAD_TO_MARK(childblock);
-                    if (sp < MICROPY_ALLOC_GC_STACK_SIZE) {
-                        MP_STATE_MEM(gc_stack)[sp++] = childblock;
+                    ATB_HEAD_TO_MARK(ptr_area, childblock);
+                    if (sp < stack_len) {
+                        #if MICROPY_GC_SPLIT_HEAP
+                        area_stack[sp] = ptr_area;
+                        #endif
+                        stack[sp++] = childblock;
                     } else {
                         MP_STATE_MEM(gc_stack_overflow) = 1;
                     }
@@ -243,95 +543,337 @@ STATIC void gc_mark_subtree(size_t block) {
         }
 
         // pop the next block off the stack
-        block = MP_STATE_MEM(gc_stack)[--sp];
+        block = stack[--sp];
+        #if MICROPY_GC_SPLIT_HEAP
+        area = area_stack[sp];
+        #endif
     }
 }
 
+// Return the number of ATB bytes from index i on that have all their blocks
+// free, comparing a word at a time where the table is word aligned
+STATIC size_t gc_free_atb_run(mp_state_mem_area_t *area, size_t i) {
+    const byte *atb = area->gc_alloc_table_start;
+    size_t len = area->gc_alloc_table_byte_len;
+    size_t j = i;
+    while (j < len && ((uintptr_t)&atb[j] & (sizeof(uintptr_t) - 1)) != 0) {
+        if (atb[j] != 0) {
+            return j - i;
+        }
+        j++;
+    }
+    while (j + sizeof(uintptr_t) <= len && *(const uintptr_t*)&atb[j] == 0) {
+        j += sizeof(uintptr_t);
+    }
+    while (j < len && atb[j] == 0) {
+        j++;
+    }
+    return j - i;
+}
+
 STATIC void gc_deal_with_stack_overflow(void) {
     while (MP_STATE_MEM(gc_stack_overflow)) {
         MP_STATE_MEM(gc_stack_overflow) = 0;
 
         // scan entire memory looking for blocks which have been marked but not their children
-        for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-            // trace (again) if mark bit set
-            if (ATB_GET_KIND(block) == AT_MARK) {
-                gc_mark_subtree(block);
+        for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+            for (size_t block = 0; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+                if (block % BLOCKS_PER_ATB == 0) {
+                    block += gc_free_atb_run(area, block / BLOCKS_PER_ATB) * BLOCKS_PER_ATB;
+                    if (block >= area->gc_alloc_table_byte_len * BLOCKS_PER_ATB) {
+                        break;
+                    }
+                }
+                // trace (again) if mark bit set
+                if (ATB_GET_KIND(area, block) == AT_MARK) {
+                    gc_mark_subtree(area, block);
+                }
             }
         }
     }
 }
 
-STATIC void gc_sweep(void) {
-    #if MICROPY_PY_GC_COLLECT_RETVAL
-    MP_STATE_MEM(gc_collected) = 0;
+#if MICROPY_GC_INCREMENTAL_SWEEP
+// Whether the pending sweep has still to reach the given block
+STATIC bool gc_sweep_ahead(mp_state_mem_area_t *area, size_t block) {
+    mp_state_mem_area_t *sweep_area = MP_STATE_MEM(gc_sweep_area);
+    if (sweep_area == NULL) {
+        return false;
+    }
+    if (area == sweep_area) {
+        return block >= MP_STATE_MEM(gc_sweep_block);
+    }
+    for (sweep_area = NEXT_AREA(sweep_area); sweep_area != NULL; sweep_area = NEXT_AREA(sweep_area)) {
+        if (area == sweep_area) {
+            return true;
+        }
+    }
+    return false;
+}
+#endif
+
+#if MICROPY_GC_FREE_LISTS
+// Keep the unmarked chain starting at block on the free list for its size,
+// if it is 1 or 2 blocks long and the list has room
+STATIC bool gc_free_list_keep(mp_state_mem_area_t *area, size_t block) {
+    size_t end = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+    size_t n = 1;
+    if (block + 1 < end && ATB_GET_KIND(area, block + 1) == AT_TAIL) {
+        if (block + 2 < end && ATB_GET_KIND(area, block + 2) == AT_TAIL) {
+            return false;
+        }
+        n = 2;
+    }
+    uint8_t *len = &MP_STATE_MEM(gc_free_list_len)[n - 1];
+    if (*len >= MICROPY_GC_FREE_LISTS) {
+        return false;
+    }
+    MP_STATE_MEM(gc_free_list)[n - 1][(*len)++] = (void*)PTR_FROM_BLOCK(area, block);
+    return true;
+}
+
+// Really free the chains on the free lists, for when an allocation can't be
+// met; returns whether there were any
+STATIC bool gc_free_lists_release(void) {
+    bool released = false;
+    for (size_t n = 1; n <= 2; n++) {
+        uint8_t *len = &MP_STATE_MEM(gc_free_list_len)[n - 1];
+        while (*len > 0) {
+            void *ptr = MP_STATE_MEM(gc_free_list)[n - 1][--*len];
+            mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+            size_t block = BLOCK_FROM_PTR(area, ptr);
+            if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+                area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
+            }
+            #if MICROPY_GC_RUN_HINTS
+            gc_run_hints_lower(area, block);
+            #endif
+            for (size_t i = 0; i < n; i++) {
+                ATB_ANY_TO_FREE(area, block + i);
+            }
+            #if MICROPY_GC_MEM_PEAK
+            MP_STATE_MEM(gc_used_blocks) -= n;
+            #endif
+            released = true;
+        }
+    }
+    return released;
+}
+#endif
+
+#if MICROPY_ENABLE_FINALISER
+// Run the __del__ method loaded into dest, if there is one, in a protected
+// environment
+STATIC void gc_call_finaliser(mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        #if MICROPY_ENABLE_SCHEDULER
+        mp_sched_lock();
+        #endif
+        mp_call_function_1_protected(dest[0], dest[1]);
+        #if MICROPY_ENABLE_SCHEDULER
+        mp_sched_unlock();
+        #endif
+    }
+}
+#endif
+
+#if MICROPY_GC_FINALISER_LIST
+// Take ptr off the finaliser list; returns whether it was there
+STATIC bool gc_finaliser_list_remove(void *ptr) {
+    void **list = MP_STATE_MEM(gc_finaliser_list);
+    size_t len = MP_STATE_MEM(gc_finaliser_list_len);
+    for (size_t i = 0; i < len; i++) {
+        if (list[i] == ptr) {
+            list[i] = list[len - 1];
+            MP_STATE_MEM(gc_finaliser_list_len) = len - 1;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Finalise the objects on the list that marking didn't reach, and drop them
+// from it; the sweep frees them afterwards.  Objects of a native type with
+// no attr handler all find the same __del__, so it is looked up once for a
+// run of them rather than once per object.
+STATIC void gc_finalise_list(void) {
+    void **list = MP_STATE_MEM(gc_finaliser_list);
+    const mp_obj_type_t *last_type = NULL;
+    mp_obj_t last_del = MP_OBJ_NULL;
+    for (size_t i = 0; i < MP_STATE_MEM(gc_finaliser_list_len);) {
+        mp_obj_base_t *obj = list[i];
+        mp_state_mem_area_t *area = gc_get_ptr_area(obj);
+        if (ATB_GET_KIND(area, BLOCK_FROM_PTR(area, obj)) == AT_MARK) {
+            i++;
+            continue;
+        }
+        list[i] = list[--MP_STATE_MEM(gc_finaliser_list_len)];
+        if (obj->type == NULL) {
+            continue;
+        }
+        mp_obj_t dest[2];
+        if (obj->type == last_type) {
+            dest[0] = last_del;
+            dest[1] = MP_OBJ_FROM_PTR(obj);
+        } else {
+            mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
+            if (obj->type->attr == NULL && (dest[0] == MP_OBJ_NULL || dest[1] == MP_OBJ_FROM_PTR(obj))) {
+                last_type = obj->type;
+                last_del = dest[0];
+            } else {
+                last_type = NULL;
+            }
+        }
+        gc_call_finaliser(dest);
+    }
+}
+#endif
+
+// Free unmarked heads and their tails.  With MICROPY_GC_INCREMENTAL_SWEEP the
+// sweep carries on from where the last call stopped and returns false when it
+// stops after about n_blocks blocks.  It only stops at the start of a chain, so
+// a tail found when resuming belongs to a chain allocated and kept since.
+STATIC bool gc_sweep(size_t n_blocks) {
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    mp_state_mem_area_t *area = MP_STATE_MEM(gc_sweep_area);
+    size_t block = MP_STATE_MEM(gc_sweep_block);
+    #else
+    mp_state_mem_area_t *area = &MP_STATE_MEM(area);
+    size_t block = 0;
+    (void)n_blocks;
     #endif
-    // free unmarked heads and their tails
     int free_tail = 0;
-    for (size_t block = 0; block < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; block++) {
-        switch (ATB_GET_KIND(block)) {
-            case AT_HEAD:
+    for (; area != NULL; area = NEXT_AREA(area), block = 0) {
+        for (; block < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; block++) {
+            if (block % BLOCKS_PER_ATB == 0) {
+                // free blocks need no work, pass over them in bulk
+                size_t skip = gc_free_atb_run(area, block / BLOCKS_PER_ATB) * BLOCKS_PER_ATB;
+                if (skip > 0) {
+                    #if MICROPY_GC_INCREMENTAL_SWEEP
+                    n_blocks -= MIN(n_blocks, skip);
+                    #endif
+                    block += skip;
+                    if (block >= area->gc_alloc_table_byte_len * BLOCKS_PER_ATB) {
+                        break;
+                    }
+                }
+            }
+            size_t kind = ATB_GET_KIND(area, block);
+            #if MICROPY_GC_INCREMENTAL_SWEEP
+            if (n_blocks > 0) {
+                n_blocks--;
+            } else if (kind != AT_TAIL) {
+                MP_STATE_MEM(gc_sweep_area) = area;
+                MP_STATE_MEM(gc_sweep_block) = block;
+                return false;
+            }
+            #endif
+            switch (kind) {
+                case AT_HEAD:
 #if MICROPY_ENABLE_FINALISER
-                if (FTB_GET(block)) {
-                    mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(block);
-                    if (obj->type != NULL) {
-                        // if the object has a type then see if it has a __del__ method
-                        mp_obj_t dest[2];
-                        mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
-                        if (dest[0] != MP_OBJ_NULL) {
-                            // load_method returned a method, execute it in a protected environment
-                            #if MICROPY_ENABLE_SCHEDULER
-                            mp_sched_lock();
-                            #endif
-                            mp_call_function_1_protected(dest[0], dest[1]);
-                            #if MICROPY_ENABLE_SCHEDULER
-                            mp_sched_unlock();
-                            #endif
+                    #if MICROPY_GC_FINALISER_LIST
+                    if (MP_STATE_MEM(gc_finaliser_ftb_used) && FTB_GET(area, block)) {
+                    #else
+                    if (FTB_GET(area, block)) {
+                    #endif
+                        mp_obj_base_t *obj = (mp_obj_base_t*)PTR_FROM_BLOCK(area, block);
+                        if (obj->type != NULL) {
+                            // if the object has a type then see if it has a __del__ method
+                            mp_obj_t dest[2];
+                            mp_load_method_maybe(MP_OBJ_FROM_PTR(obj), MP_QSTR___del__, dest);
+                            gc_call_finaliser(dest);
                         }
+                        // clear finaliser flag
+                        FTB_CLEAR(area, block);
                     }
-                    // clear finaliser flag
-                    FTB_CLEAR(block);
-                }
 #endif
-                free_tail = 1;
-                DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(block));
-                #if MICROPY_PY_GC_COLLECT_RETVAL
-                MP_STATE_MEM(gc_collected)++;
-                #endif
-                // fall through to free the head
-
-            case AT_TAIL:
-                if (free_tail) {
-                    ATB_ANY_TO_FREE(block);
-                    #if CLEAR_ON_SWEEP
-                    memset((void*)PTR_FROM_BLOCK(block), 0, BYTES_PER_BLOCK);
+                    free_tail = 1;
+                    #if MICROPY_GC_INCREMENTAL_SWEEP
+                    // allocations may have moved on past this block since the sweep started
+                    if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+                        area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
+                    }
+                    #if MICROPY_GC_RUN_HINTS
+                    gc_run_hints_lower(area, block);
                     #endif
-                }
-                break;
+                    #endif
+                    DEBUG_printf("gc_sweep(%p)\n", PTR_FROM_BLOCK(area, block));
+                    #if MICROPY_PY_GC_COLLECT_RETVAL
+                    MP_STATE_MEM(gc_collected)++;
+                    #endif
+                    #if MICROPY_GC_FREE_LISTS
+                    if (MP_STATE_MEM(gc_free_list_fill) && gc_free_list_keep(area, block)) {
+                        // left allocated, for gc_alloc to reuse
+                        free_tail = 0;
+                        break;
+                    }
+                    #endif
+                    // fall through to free the head
+
+                case AT_TAIL:
+                    if (free_tail) {
+                        ATB_ANY_TO_FREE(area, block);
+                        #if MICROPY_GC_MEM_PEAK
+                        MP_STATE_MEM(gc_used_blocks)--;
+                        #endif
+                        #if CLEAR_ON_SWEEP
+                        memset((void*)PTR_FROM_BLOCK(area, block), 0, BYTES_PER_BLOCK);
+                        #endif
+                    }
+                    break;
 
-            case AT_MARK:
-                ATB_MARK_TO_HEAD(block);
-                free_tail = 0;
-                break;
+                case AT_MARK:
+                    ATB_MARK_TO_HEAD(area, block);
+                    free_tail = 0;
+                    break;
+            }
         }
     }
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    MP_STATE_MEM(gc_sweep_area) = NULL;
+    #endif
+    return true;
 }
 
 void gc_collect_start(void) {
     GC_ENTER();
     MP_STATE_MEM(gc_lock_depth)++;
+    #if MICROPY_PY_MICROPYTHON_STATS
+    ++MP_STATE_MEM(gc_collections);
+    MP_STATE_MEM(gc_pause_start) = mp_hal_ticks_us();
+    #endif
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // marking needs the previous sweep to be complete
+    gc_sweep(SIZE_MAX);
+    #endif
+    #if MICROPY_GC_FREE_LISTS
+    gc_free_lists_drain(true);
+    #endif
     #if MICROPY_GC_ALLOC_THRESHOLD
     MP_STATE_MEM(gc_alloc_amount) = 0;
     #endif
     MP_STATE_MEM(gc_stack_overflow) = 0;
+    #if MICROPY_GC_HEAP_STACK
+    gc_setup_stack();
+    #endif
 
     // Trace root pointers.  This relies on the root pointers being organised
     // correctly in the mp_state_ctx structure.  We scan nlr_top, dict_locals,
     // dict_globals, then the root pointer section of mp_state_vm.
-    void **ptrs = (void**)(void*)&mp_state_ctx;
+    void **ptrs = (void**)(void*)&MP_STATE_CTX;
     size_t root_start = offsetof(mp_state_ctx_t, thread.dict_locals);
     size_t root_end = offsetof(mp_state_ctx_t, vm.qstr_last_chunk);
     gc_collect_root(ptrs + root_start / sizeof(void*), (root_end - root_start) / sizeof(void*));
 
+    #if MICROPY_GC_ARENA
+    // an open arena is kept even if the object that opened it is lost
+    for (size_t i = 0; i < MICROPY_GC_ARENA; i++) {
+        if (MP_STATE_MEM(gc_arena)[i].open) {
+            gc_collect_root((void**)&MP_STATE_MEM(gc_arena)[i].map, 1);
+        }
+    }
+    #endif
+
     #if MICROPY_ENABLE_PYSTACK
     // Trace root pointers from the Python stack.
     ptrs = (void**)(void*)MP_STATE_THREAD(pystack_start);
@@ -342,13 +884,17 @@ void gc_collect_start(void) {
 void gc_collect_root(void **ptrs, size_t len) {
     for (size_t i = 0; i < len; i++) {
         void *ptr = ptrs[i];
-        if (VERIFY_PTR(ptr)) {
-            size_t block = BLOCK_FROM_PTR(ptr);
-            if (ATB_GET_KIND(block) == AT_HEAD) {
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        if (area != NULL) {
+            size_t block = BLOCK_FROM_PTR(area, ptr);
+            #if MICROPY_GC_ARENA
+            block = gc_arena_head(area, ptr, block);
+            #endif
+            if (ATB_GET_KIND(area, block) == AT_HEAD) {
                 // An unmarked head: mark it, and mark all its children
                 TRACE_MARK(block, ptr);
-                ATB_HEAD_TO_MARK(block);
-                gc_mark_subtree(block);
+                ATB_HEAD_TO_MARK(area, block);
+                gc_mark_subtree(area, block);
             }
         }
     }
@@ -356,8 +902,75 @@ void gc_collect_root(void **ptrs, size_t len) {
 
 void gc_collect_end(void) {
     gc_deal_with_stack_overflow();
-    gc_sweep();
-    MP_STATE_MEM(gc_last_free_atb_index) = 0;
+    #if MICROPY_GC_FINALISER_LIST
+    // finalisers run now even if the sweep is deferred
+    gc_finalise_list();
+    #endif
+    #if MICROPY_OPT_STR_CONCAT_INPLACE
+    // forget the concatenation buffers that are about to be freed
+    for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_VM(str_concat_bufs)); i++) {
+        void *ptr = MP_STATE_VM(str_concat_bufs)[i].data;
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        if (area != NULL && ATB_GET_KIND(area, BLOCK_FROM_PTR(area, ptr)) != AT_MARK) {
+            MP_STATE_VM(str_concat_bufs)[i].data = NULL;
+        }
+    }
+    #endif
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    // likewise the indexed strings, also dropping slices that point into the
+    // middle of a block since their block can't be checked
+    for (size_t i = 0; i < MICROPY_OPT_STR_INDEX_CACHE; i++) {
+        const void *ptr = MP_STATE_VM(str_index)[i].data;
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        if (area != NULL && ATB_GET_KIND(area, BLOCK_FROM_PTR(area, ptr)) != AT_MARK) {
+            MP_STATE_VM(str_index)[i].data = NULL;
+            MP_STATE_VM(str_index_offsets)[i] = NULL;
+        }
+    }
+    #endif
+    #if MICROPY_GC_ARENA
+    // forget the closed arenas: the sweep frees those that nothing points
+    // into, and what is left of the others turns into ordinary chains
+    for (size_t i = 0; i < MICROPY_GC_ARENA; i++) {
+        mp_gc_arena_t *arena = &MP_STATE_MEM(gc_arena)[i];
+        if (arena->map != NULL && !arena->open) {
+            mp_state_mem_area_t *area = gc_get_ptr_area(arena->map);
+            if (ATB_GET_KIND(area, BLOCK_FROM_PTR(area, arena->map)) == AT_MARK) {
+                gc_arena_promote(arena);
+            }
+            arena->map = NULL;
+            MP_STATE_MEM(gc_arena_count)--;
+        }
+    }
+    #endif
+    #if MICROPY_PY_GC_COLLECT_RETVAL
+    MP_STATE_MEM(gc_collected) = 0;
+    #endif
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        area->gc_last_free_atb_index = 0;
+        #if MICROPY_GC_RUN_HINTS
+        memset(area->gc_last_run_atb_index, 0, sizeof(area->gc_last_run_atb_index));
+        #endif
+    }
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    MP_STATE_MEM(gc_sweep_area) = &MP_STATE_MEM(area);
+    MP_STATE_MEM(gc_sweep_block) = 0;
+    if (MP_STATE_MEM(gc_sweep_defer)) {
+        MP_STATE_MEM(gc_sweep_defer) = 0;
+    } else {
+        gc_sweep(SIZE_MAX);
+    }
+    #else
+    gc_sweep(SIZE_MAX);
+    #endif
+    #if MICROPY_PY_MICROPYTHON_STATS
+    // with a deferred sweep this is the mark phase only
+    uint32_t dt = (uint32_t)mp_hal_ticks_us() - MP_STATE_MEM(gc_pause_start);
+    MP_STATE_MEM(gc_pause_us) += dt;
+    if (dt > MP_STATE_MEM(gc_pause_max_us)) {
+        MP_STATE_MEM(gc_pause_max_us) = dt;
+    }
+    #endif
     MP_STATE_MEM(gc_lock_depth)--;
     GC_EXIT();
 }
@@ -365,73 +978,141 @@ void gc_collect_end(void) {
 void gc_sweep_all(void) {
     GC_ENTER();
     MP_STATE_MEM(gc_lock_depth)++;
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // finish any pending sweep so that no marked heads are left
+    gc_sweep(SIZE_MAX);
+    MP_STATE_MEM(gc_sweep_defer) = 0;
+    #endif
+    #if MICROPY_GC_FREE_LISTS
+    // everything is to be freed
+    gc_free_lists_drain(false);
+    #endif
     MP_STATE_MEM(gc_stack_overflow) = 0;
+    #if MICROPY_PY_MICROPYTHON_STATS
+    MP_STATE_MEM(gc_pause_start) = mp_hal_ticks_us();
+    #endif
     gc_collect_end();
 }
 
+#if MICROPY_GC_INCREMENTAL_SWEEP
+void gc_sweep_defer(void) {
+    GC_ENTER();
+    MP_STATE_MEM(gc_sweep_defer) = 1;
+    GC_EXIT();
+}
+
+bool gc_sweep_step(size_t n_blocks) {
+    GC_ENTER();
+    if (MP_STATE_MEM(gc_lock_depth) > 0) {
+        // can't run finalisers now
+        GC_EXIT();
+        return MP_STATE_MEM(gc_sweep_area) == NULL;
+    }
+    MP_STATE_MEM(gc_lock_depth)++;
+    bool done = gc_sweep(n_blocks);
+    MP_STATE_MEM(gc_lock_depth)--;
+    GC_EXIT();
+    return done;
+}
+#endif
+
 void gc_info(gc_info_t *info) {
     GC_ENTER();
-    info->total = MP_STATE_MEM(gc_pool_end) - MP_STATE_MEM(gc_pool_start);
+    info->total = 0;
     info->used = 0;
     info->free = 0;
     info->max_free = 0;
     info->num_1block = 0;
     info->num_2block = 0;
     info->max_block = 0;
-    bool finish = false;
-    for (size_t block = 0, len = 0, len_free = 0; !finish;) {
-        size_t kind = ATB_GET_KIND(block);
-        switch (kind) {
-            case AT_FREE:
-                info->free += 1;
-                len_free += 1;
-                len = 0;
-                break;
-
-            case AT_HEAD:
-                info->used += 1;
-                len = 1;
-                break;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        info->total += area->gc_pool_end - area->gc_pool_start;
+        bool finish = false;
+        for (size_t block = 0, len = 0, len_free = 0; !finish;) {
+            size_t kind = ATB_GET_KIND(area, block);
+            switch (kind) {
+                case AT_FREE:
+                    info->free += 1;
+                    len_free += 1;
+                    len = 0;
+                    break;
+
+                case AT_HEAD:
+                case AT_MARK: // while a sweep is pending
+                    info->used += 1;
+                    len = 1;
+                    break;
+
+                case AT_TAIL:
+                    info->used += 1;
+                    len += 1;
+                    break;
+            }
 
-            case AT_TAIL:
-                info->used += 1;
-                len += 1;
-                break;
+            block++;
+            finish = (block == area->gc_alloc_table_byte_len * BLOCKS_PER_ATB);
+            // Get next block type if possible
+            if (!finish) {
+                kind = ATB_GET_KIND(area, block);
+            }
 
-            case AT_MARK:
-                // shouldn't happen
-                break;
+            if (finish || kind != AT_TAIL) {
+                if (len == 1) {
+                    info->num_1block += 1;
+                } else if (len == 2) {
+                    info->num_2block += 1;
+                }
+                if (len > info->max_block) {
+                    info->max_block = len;
+                }
+                if (finish || kind != AT_FREE) {
+                    if (len_free > info->max_free) {
+                        info->max_free = len_free;
+                    }
+                    len_free = 0;
+                }
+            }
         }
+    }
 
-        block++;
-        finish = (block == MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB);
-        // Get next block type if possible
-        if (!finish) {
-            kind = ATB_GET_KIND(block);
-        }
+    info->used *= BYTES_PER_BLOCK;
+    info->free *= BYTES_PER_BLOCK;
+    GC_EXIT();
+}
 
-        if (finish || kind == AT_FREE || kind == AT_HEAD) {
-            if (len == 1) {
-                info->num_1block += 1;
-            } else if (len == 2) {
-                info->num_2block += 1;
+#if MICROPY_GC_PROFILE
+// Count an allocation against the bytecode location running now
+STATIC void gc_profile_record(size_t n_bytes) {
+    const mp_code_state_t *code_state = MP_STATE_THREAD(code_state);
+    if (code_state != NULL) {
+        const byte *ip = code_state->ip;
+        size_t h = (uintptr_t)ip % MICROPY_GC_PROFILE_SITES;
+        for (size_t n = MICROPY_GC_PROFILE_SITES; n > 0; n--) {
+            mp_gc_profile_site_t *site = &MP_STATE_VM(gc_profile_sites)[h];
+            if (site->bytecode == NULL) {
+                site->bytecode = code_state->fun_bc->bytecode;
+                site->ip = ip;
             }
-            if (len > info->max_block) {
-                info->max_block = len;
-            }
-            if (finish || kind == AT_HEAD) {
-                if (len_free > info->max_free) {
-                    info->max_free = len_free;
-                }
-                len_free = 0;
+            if (site->ip == ip) {
+                site->count += 1;
+                site->bytes += n_bytes;
+                return;
             }
+            h = (h + 1) % MICROPY_GC_PROFILE_SITES;
         }
     }
+    MP_STATE_MEM(gc_profile_other_count) += 1;
+    MP_STATE_MEM(gc_profile_other_bytes) += n_bytes;
+}
 
-    info->used *= BYTES_PER_BLOCK;
-    info->free *= BYTES_PER_BLOCK;
+void gc_profile_clear(void) {
+    GC_ENTER();
+    memset(MP_STATE_VM(gc_profile_sites), 0, sizeof(MP_STATE_VM(gc_profile_sites)));
+    MP_STATE_MEM(gc_profile_other_count) = 0;
+    MP_STATE_MEM(gc_profile_other_bytes) = 0;
     GC_EXIT();
 }
+#endif
 
 void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
     bool has_finaliser = alloc_flags & GC_ALLOC_FLAG_HAS_FINALISER;
@@ -451,14 +1132,50 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
         return NULL;
     }
 
+    #if MICROPY_GC_ARENA
+    mp_gc_arena_t *arena = MP_STATE_THREAD(gc_arena);
+    if (arena != NULL && !has_finaliser && n_blocks <= (size_t)(arena->end - arena->cur) / BYTES_PER_BLOCK) {
+        // bump allocate from the active arena, its memory is already zero
+        byte *p = arena->cur;
+        size_t b = (p - arena->start) / BYTES_PER_BLOCK;
+        arena->map[b / 8] |= 1 << (b & 7);
+        arena->cur = p + n_blocks * BYTES_PER_BLOCK;
+        GC_EXIT();
+        return p;
+    }
+    #endif
+
     size_t i;
     size_t end_block;
     size_t start_block;
     size_t n_free;
+    void *ret_ptr;
     int collected = !MP_STATE_MEM(gc_auto_collect_enabled);
+    mp_state_mem_area_t *area = NULL; // placate gcc, always set by the search
+
+    #if MICROPY_GC_SPLIT_HEAP
+    // large allocations look in the added areas first
+    mp_state_mem_area_t *first_area = &MP_STATE_MEM(area);
+    if (MICROPY_GC_SPLIT_HEAP_LARGE && n_bytes >= MICROPY_GC_SPLIT_HEAP_LARGE && first_area->next != NULL) {
+        first_area = first_area->next;
+    }
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    if (MP_STATE_MEM(gc_sweep_area) != NULL) {
+        // each allocation takes a share of a pending sweep
+        MP_STATE_MEM(gc_lock_depth)++;
+        gc_sweep(MICROPY_GC_SWEEP_STEP);
+        MP_STATE_MEM(gc_lock_depth)--;
+    }
+    #endif
 
     #if MICROPY_GC_ALLOC_THRESHOLD
     if (!collected && MP_STATE_MEM(gc_alloc_amount) >= MP_STATE_MEM(gc_alloc_threshold)) {
+        #if MICROPY_GC_INCREMENTAL_SWEEP
+        // only mark now, the allocations that follow do the sweep
+        MP_STATE_MEM(gc_sweep_defer) = 1;
+        #endif
         GC_EXIT();
         gc_collect();
         collected = 1;
@@ -466,17 +1183,61 @@ void *gc_alloc(size_t n_bytes, unsigned int alloc_flags) {
     }
     #endif
 
+    #if MICROPY_GC_FREE_LISTS
+    if (n_blocks <= 2 && !has_finaliser && MP_STATE_MEM(gc_free_list_len)[n_blocks - 1] > 0) {
+        // a chain of this size kept by the sweep, already marked as in use
+        ret_ptr = MP_STATE_MEM(gc_free_list)[n_blocks - 1][--MP_STATE_MEM(gc_free_list_len)[n_blocks - 1]];
+        start_block = 0;
+        end_block = n_blocks - 1;
+        goto recycled;
+    }
+    #endif
+
     for (;;) {
 
-        // look for a run of n_blocks available blocks
-        n_free = 0;
-        for (i = MP_STATE_MEM(gc_last_free_atb_index); i < MP_STATE_MEM(gc_alloc_table_byte_len); i++) {
-            byte a = MP_STATE_MEM(gc_alloc_table_start)[i];
-            if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
-            if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
-            if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
-            if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+        #if MICROPY_GC_SPLIT_HEAP
+        // visit every area once, starting at first_area and wrapping round
+        area = first_area;
+        do {
+        #else
+        area = &MP_STATE_MEM(area);
+        #endif
+            // look for a run of n_blocks available blocks
+            n_free = 0;
+            i = area->gc_last_free_atb_index;
+            #if MICROPY_GC_RUN_HINTS
+            if (n_blocks >= 2 && n_blocks - 2 < MICROPY_GC_RUN_HINTS && area->gc_last_run_atb_index[n_blocks - 2] > i) {
+                i = area->gc_last_run_atb_index[n_blocks - 2];
+            }
+            #endif
+            for (; i < area->gc_alloc_table_byte_len; i++) {
+                byte a = area->gc_alloc_table_start[i];
+                if (ATB_0_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 0; goto found; } } else { n_free = 0; }
+                if (ATB_1_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 1; goto found; } } else { n_free = 0; }
+                if (ATB_2_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 2; goto found; } } else { n_free = 0; }
+                if (ATB_3_IS_FREE(a)) { if (++n_free >= n_blocks) { i = i * BLOCKS_PER_ATB + 3; goto found; } } else { n_free = 0; }
+            }
+        #if MICROPY_GC_SPLIT_HEAP
+            area = (area->next != NULL) ? area->next : &MP_STATE_MEM(area);
+        } while (area != first_area);
+        #endif
+
+        #if MICROPY_GC_INCREMENTAL_SWEEP
+        if (MP_STATE_MEM(gc_sweep_area) != NULL) {
+            // finish the pending sweep and look again
+            MP_STATE_MEM(gc_lock_depth)++;
+            gc_sweep(SIZE_MAX);
+            MP_STATE_MEM(gc_lock_depth)--;
+            continue;
         }
+        #endif
+
+        #if MICROPY_GC_FREE_LISTS
+        if (gc_free_lists_release()) {
+            // the kept chains may be what is in the way
+            continue;
+        }
+        #endif
 
         GC_EXIT();
         // nothing found!
@@ -501,27 +1262,60 @@ found:
     // before this one.  Also, whenever we free or shink a block we must check
     // if this index needs adjusting (see gc_realloc and gc_free).
     if (n_free == 1) {
-        MP_STATE_MEM(gc_last_free_atb_index) = (i + 1) / BLOCKS_PER_ATB;
+        area->gc_last_free_atb_index = (i + 1) / BLOCKS_PER_ATB;
     }
 
+    #if MICROPY_GC_RUN_HINTS
+    // The search found no run of n_blocks free blocks before this one, so
+    // none of n_blocks or more either.
+    for (size_t n = n_blocks; n >= 2 && n - 2 < MICROPY_GC_RUN_HINTS; n++) {
+        if (area->gc_last_run_atb_index[n - 2] < start_block / BLOCKS_PER_ATB) {
+            area->gc_last_run_atb_index[n - 2] = start_block / BLOCKS_PER_ATB;
+        }
+    }
+    #endif
+
     // mark first block as used head
-    ATB_FREE_TO_HEAD(start_block);
+    ATB_FREE_TO_HEAD(area, start_block);
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    if (gc_sweep_ahead(area, start_block)) {
+        // the pending sweep must see this one as live
+        ATB_HEAD_TO_MARK(area, start_block);
+    }
+    #endif
 
     // mark rest of blocks as used tail
     // TODO for a run of many blocks can make this more efficient
     for (size_t bl = start_block + 1; bl <= end_block; bl++) {
-        ATB_FREE_TO_TAIL(bl);
+        ATB_FREE_TO_TAIL(area, bl);
     }
 
     // get pointer to first block
     // we must create this pointer before unlocking the GC so a collection can find it
-    void *ret_ptr = (void*)(MP_STATE_MEM(gc_pool_start) + start_block * BYTES_PER_BLOCK);
+    ret_ptr = (void*)(area->gc_pool_start + start_block * BYTES_PER_BLOCK);
     DEBUG_printf("gc_alloc(%p)\n", ret_ptr);
 
+    #if MICROPY_GC_MEM_PEAK
+    gc_peak_add(n_blocks);
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+recycled:
+    #endif
+
     #if MICROPY_GC_ALLOC_THRESHOLD
     MP_STATE_MEM(gc_alloc_amount) += n_blocks;
     #endif
 
+    #if MICROPY_PY_MICROPYTHON_STATS
+    ++MP_STATE_MEM(gc_alloc_count);
+    MP_STATE_MEM(gc_alloc_bytes) += n_bytes;
+    #endif
+
+    #if MICROPY_GC_PROFILE
+    gc_profile_record(n_bytes);
+    #endif
+
     GC_EXIT();
 
     #if MICROPY_GC_CONSERVATIVE_CLEAR
@@ -542,7 +1336,16 @@ found:
         ((mp_obj_base_t*)ret_ptr)->type = NULL;
         // set mp_obj flag only if it has a finaliser
         GC_ENTER();
-        FTB_SET(start_block);
+        #if MICROPY_GC_FINALISER_LIST
+        if (MP_STATE_MEM(gc_finaliser_list_len) < MICROPY_GC_FINALISER_LIST) {
+            MP_STATE_MEM(gc_finaliser_list)[MP_STATE_MEM(gc_finaliser_list_len)++] = ret_ptr;
+        } else {
+            MP_STATE_MEM(gc_finaliser_ftb_used) = 1;
+            FTB_SET(area, start_block);
+        }
+        #else
+        FTB_SET(area, start_block);
+        #endif
         GC_EXIT();
     }
     #else
@@ -582,24 +1385,51 @@ void gc_free(void *ptr) {
         GC_EXIT();
     } else {
         // get the GC block number corresponding to this pointer
-        assert(VERIFY_PTR(ptr));
-        size_t block = BLOCK_FROM_PTR(ptr);
-        assert(ATB_GET_KIND(block) == AT_HEAD);
+        mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+        assert(area != NULL);
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+
+        #if MICROPY_GC_ARENA
+        mp_gc_arena_t *arena;
+        if (ATB_GET_KIND(area, block) == AT_TAIL && (arena = gc_arena_find(ptr)) != NULL) {
+            // arena memory goes back in bulk, except the latest allocation
+            size_t n_bytes = gc_arena_nbytes(arena, ptr);
+            if ((byte*)ptr + n_bytes == arena->cur) {
+                size_t b = ((byte*)ptr - arena->start) / BYTES_PER_BLOCK;
+                arena->map[b / 8] &= ~(1 << (b & 7));
+                arena->cur = ptr;
+                memset(ptr, 0, n_bytes);
+            }
+            GC_EXIT();
+            return;
+        }
+        #endif
+
+        assert(ATB_GET_KIND(area, block) == AT_HEAD || ATB_GET_KIND(area, block) == AT_MARK);
 
         #if MICROPY_ENABLE_FINALISER
-        FTB_CLEAR(block);
+        FTB_CLEAR(area, block);
+        #endif
+        #if MICROPY_GC_FINALISER_LIST
+        gc_finaliser_list_remove(ptr);
         #endif
 
         // set the last_free pointer to this block if it's earlier in the heap
-        if (block / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = block / BLOCKS_PER_ATB;
+        if (block / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = block / BLOCKS_PER_ATB;
         }
+        #if MICROPY_GC_RUN_HINTS
+        gc_run_hints_lower(area, block);
+        #endif
 
         // free head and all of its tail blocks
         do {
-            ATB_ANY_TO_FREE(block);
+            ATB_ANY_TO_FREE(area, block);
             block += 1;
-        } while (ATB_GET_KIND(block) == AT_TAIL);
+            #if MICROPY_GC_MEM_PEAK
+            MP_STATE_MEM(gc_used_blocks)--;
+            #endif
+        } while (ATB_GET_KIND(area, block) == AT_TAIL);
 
         GC_EXIT();
 
@@ -611,17 +1441,27 @@ void gc_free(void *ptr) {
 
 size_t gc_nbytes(const void *ptr) {
     GC_ENTER();
-    if (VERIFY_PTR(ptr)) {
-        size_t block = BLOCK_FROM_PTR(ptr);
-        if (ATB_GET_KIND(block) == AT_HEAD) {
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        size_t block = BLOCK_FROM_PTR(area, ptr);
+        size_t kind = ATB_GET_KIND(area, block);
+        if (kind == AT_HEAD || kind == AT_MARK) {
             // work out number of consecutive blocks in the chain starting with this on
             size_t n_blocks = 0;
             do {
                 n_blocks += 1;
-            } while (ATB_GET_KIND(block + n_blocks) == AT_TAIL);
+            } while (ATB_GET_KIND(area, block + n_blocks) == AT_TAIL);
             GC_EXIT();
             return n_blocks * BYTES_PER_BLOCK;
         }
+        #if MICROPY_GC_ARENA
+        mp_gc_arena_t *arena;
+        if (kind == AT_TAIL && (arena = gc_arena_find(ptr)) != NULL && (const byte*)ptr < arena->cur) {
+            size_t n_bytes = gc_arena_nbytes(arena, ptr);
+            GC_EXIT();
+            return n_bytes;
+        }
+        #endif
     }
 
     // invalid pointer
@@ -680,13 +1520,44 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     }
 
     // get the GC block number corresponding to this pointer
-    assert(VERIFY_PTR(ptr));
-    size_t block = BLOCK_FROM_PTR(ptr);
-    assert(ATB_GET_KIND(block) == AT_HEAD);
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    assert(area != NULL);
+    size_t block = BLOCK_FROM_PTR(area, ptr);
 
     // compute number of new blocks that are requested
     size_t new_blocks = (n_bytes + BYTES_PER_BLOCK - 1) / BYTES_PER_BLOCK;
 
+    #if MICROPY_GC_ARENA
+    mp_gc_arena_t *arena;
+    if (ATB_GET_KIND(area, block) == AT_TAIL && (arena = gc_arena_find(ptr)) != NULL) {
+        size_t n_existing = gc_arena_nbytes(arena, ptr);
+        if ((byte*)ptr + n_existing == arena->cur
+            && new_blocks * BYTES_PER_BLOCK <= (size_t)(arena->end - (byte*)ptr)) {
+            // the latest allocation grows or shrinks in place
+            if (new_blocks * BYTES_PER_BLOCK < n_existing) {
+                memset((byte*)ptr + new_blocks * BYTES_PER_BLOCK, 0, n_existing - new_blocks * BYTES_PER_BLOCK);
+            }
+            arena->cur = (byte*)ptr + new_blocks * BYTES_PER_BLOCK;
+            GC_EXIT();
+            return ptr_in;
+        }
+        GC_EXIT();
+        if (new_blocks * BYTES_PER_BLOCK <= n_existing) {
+            return ptr_in;
+        }
+        if (!allow_move) {
+            return NULL;
+        }
+        void *ptr_out = gc_alloc(n_bytes, 0);
+        if (ptr_out != NULL) {
+            memcpy(ptr_out, ptr_in, n_existing);
+        }
+        return ptr_out;
+    }
+    #endif
+
+    assert(ATB_GET_KIND(area, block) == AT_HEAD || ATB_GET_KIND(area, block) == AT_MARK);
+
     // Get the total number of consecutive blocks that are already allocated to
     // this chunk of memory, and then count the number of free blocks following
     // it.  Stop if we reach the end of the heap, or if we find enough extra
@@ -695,9 +1566,9 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     // efficiently shrink it (see below for shrinking code).
     size_t n_free   = 0;
     size_t n_blocks = 1; // counting HEAD block
-    size_t max_block = MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB;
+    size_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
     for (size_t bl = block + n_blocks; bl < max_block; bl++) {
-        byte block_type = ATB_GET_KIND(bl);
+        byte block_type = ATB_GET_KIND(area, bl);
         if (block_type == AT_TAIL) {
             n_blocks++;
             continue;
@@ -723,13 +1594,19 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks < n_blocks) {
         // free unneeded tail blocks
         for (size_t bl = block + new_blocks, count = n_blocks - new_blocks; count > 0; bl++, count--) {
-            ATB_ANY_TO_FREE(bl);
+            ATB_ANY_TO_FREE(area, bl);
         }
+        #if MICROPY_GC_MEM_PEAK
+        MP_STATE_MEM(gc_used_blocks) -= n_blocks - new_blocks;
+        #endif
 
         // set the last_free pointer to end of this block if it's earlier in the heap
-        if ((block + new_blocks) / BLOCKS_PER_ATB < MP_STATE_MEM(gc_last_free_atb_index)) {
-            MP_STATE_MEM(gc_last_free_atb_index) = (block + new_blocks) / BLOCKS_PER_ATB;
+        if ((block + new_blocks) / BLOCKS_PER_ATB < area->gc_last_free_atb_index) {
+            area->gc_last_free_atb_index = (block + new_blocks) / BLOCKS_PER_ATB;
         }
+        #if MICROPY_GC_RUN_HINTS
+        gc_run_hints_lower(area, block + new_blocks);
+        #endif
 
         GC_EXIT();
 
@@ -744,9 +1621,12 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
     if (new_blocks <= n_blocks + n_free) {
         // mark few more blocks as used tail
         for (size_t bl = block + n_blocks; bl < block + new_blocks; bl++) {
-            assert(ATB_GET_KIND(bl) == AT_FREE);
-            ATB_FREE_TO_TAIL(bl);
+            assert(ATB_GET_KIND(area, bl) == AT_FREE);
+            ATB_FREE_TO_TAIL(area, bl);
         }
+        #if MICROPY_GC_MEM_PEAK
+        gc_peak_add(new_blocks - n_blocks);
+        #endif
 
         GC_EXIT();
 
@@ -765,8 +1645,13 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
         return ptr_in;
     }
 
-    #if MICROPY_ENABLE_FINALISER
-    bool ftb_state = FTB_GET(block);
+    #if MICROPY_GC_FINALISER_LIST
+    bool ftb_state = FTB_GET(area, block);
+    for (size_t i = 0; !ftb_state && i < MP_STATE_MEM(gc_finaliser_list_len); i++) {
+        ftb_state = MP_STATE_MEM(gc_finaliser_list)[i] == ptr_in;
+    }
+    #elif MICROPY_ENABLE_FINALISER
+    bool ftb_state = FTB_GET(area, block);
     #else
     bool ftb_state = false;
     #endif
@@ -793,6 +1678,162 @@ void *gc_realloc(void *ptr_in, size_t n_bytes, bool allow_move) {
 }
 #endif // Alternative gc_realloc impl
 
+#if MICROPY_GC_PROFILE
+// Heap snapshot format, all integers little endian:
+//  header:  "MPHS" | version (1) | 0 | bytes per block (u16) | n_types (u8)
+//  types:   n_types times: name length (u8) | name
+//  chunks:  until the end: type (u8) | length in blocks (unsigned LEB128)
+// A chunk's type is 0 if it doesn't start with a recognised type pointer,
+// 1 to n_types for the types above, and 255 for any further types.
+
+#define GC_SNAPSHOT_MAX_TYPES (64)
+
+typedef struct _gc_snapshot_out_t {
+    byte *buf;
+    size_t len;
+    size_t pos;
+} gc_snapshot_out_t;
+
+STATIC void gc_snapshot_put(gc_snapshot_out_t *out, const void *data, size_t len) {
+    if (out->pos + len <= out->len) {
+        memcpy(out->buf + out->pos, data, len);
+    }
+    out->pos += len;
+}
+
+STATIC void gc_snapshot_put_byte(gc_snapshot_out_t *out, byte b) {
+    gc_snapshot_put(out, &b, 1);
+}
+
+// Whether the first word of a chunk is the type of the object in it.  Only
+// pointers that are safe to read through are checked: heap chunks (classes)
+// and addresses within the static types of py/, where the linker normally
+// puts the rest of the const types as well.
+STATIC bool gc_snapshot_is_type(const void *ptr) {
+    static const mp_obj_type_t *const core_types[] = {
+        &mp_type_type, &mp_type_object, &mp_type_NoneType, &mp_type_bool,
+        &mp_type_int, &mp_type_str, &mp_type_bytes, &mp_type_bytearray,
+        &mp_type_list, &mp_type_tuple, &mp_type_dict, &mp_type_fun_bc,
+        &mp_type_gen_instance, &mp_type_module, &mp_type_BaseException,
+        #if MICROPY_PY_BUILTINS_FLOAT
+        &mp_type_float,
+        #endif
+    };
+    if (((uintptr_t)ptr & (sizeof(void*) - 1)) != 0) {
+        return false;
+    }
+    mp_state_mem_area_t *area = gc_get_ptr_area(ptr);
+    if (area != NULL) {
+        size_t kind = ATB_GET_KIND(area, BLOCK_FROM_PTR(area, ptr));
+        if (kind != AT_HEAD && kind != AT_MARK) {
+            return false;
+        }
+    } else {
+        const void *lo = core_types[0];
+        const void *hi = core_types[0];
+        for (size_t i = 1; i < MP_ARRAY_SIZE(core_types); i++) {
+            lo = MIN(lo, (const void*)core_types[i]);
+            hi = MAX(hi, (const void*)core_types[i]);
+        }
+        if (ptr < lo || ptr > hi) {
+            return false;
+        }
+    }
+    return ((const mp_obj_base_t*)ptr)->type == &mp_type_type;
+}
+
+// Call fun for each allocated chunk, with its first word and its length
+STATIC void gc_snapshot_walk(void (*fun)(void *arg, const void *type, size_t n_blocks), void *arg) {
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        size_t max_block = area->gc_alloc_table_byte_len * BLOCKS_PER_ATB;
+        for (size_t block = 0; block < max_block; block++) {
+            if (block % BLOCKS_PER_ATB == 0) {
+                block += gc_free_atb_run(area, block / BLOCKS_PER_ATB) * BLOCKS_PER_ATB;
+                if (block >= max_block) {
+                    break;
+                }
+            }
+            size_t kind = ATB_GET_KIND(area, block);
+            if (kind == AT_HEAD || kind == AT_MARK) {
+                size_t n_blocks = 1;
+                while (block + n_blocks < max_block && ATB_GET_KIND(area, block + n_blocks) == AT_TAIL) {
+                    n_blocks++;
+                }
+                const void *type = *(void**)PTR_FROM_BLOCK(area, block);
+                fun(arg, gc_snapshot_is_type(type) ? type : NULL, n_blocks);
+                block += n_blocks - 1;
+            }
+        }
+    }
+}
+
+typedef struct _gc_snapshot_types_t {
+    const mp_obj_type_t *type[GC_SNAPSHOT_MAX_TYPES];
+    size_t n;
+    gc_snapshot_out_t *out;
+} gc_snapshot_types_t;
+
+STATIC size_t gc_snapshot_type_index(gc_snapshot_types_t *types, const void *type) {
+    if (type == NULL) {
+        return 0;
+    }
+    for (size_t i = 0; i < types->n; i++) {
+        if (types->type[i] == type) {
+            return i + 1;
+        }
+    }
+    return 255;
+}
+
+STATIC void gc_snapshot_add_type(void *arg, const void *type, size_t n_blocks) {
+    gc_snapshot_types_t *types = arg;
+    (void)n_blocks;
+    if (type != NULL && gc_snapshot_type_index(types, type) == 255 && types->n < GC_SNAPSHOT_MAX_TYPES) {
+        types->type[types->n++] = type;
+    }
+}
+
+STATIC void gc_snapshot_add_chunk(void *arg, const void *type, size_t n_blocks) {
+    gc_snapshot_types_t *types = arg;
+    gc_snapshot_put_byte(types->out, gc_snapshot_type_index(types, type));
+    do {
+        byte b = n_blocks & 0x7f;
+        n_blocks >>= 7;
+        gc_snapshot_put_byte(types->out, b | (n_blocks != 0 ? 0x80 : 0));
+    } while (n_blocks != 0);
+}
+
+size_t gc_snapshot(byte *buf, size_t len) {
+    gc_snapshot_out_t out = {buf, len, 0};
+    gc_snapshot_types_t types;
+    types.n = 0;
+    types.out = &out;
+
+    GC_ENTER();
+    gc_snapshot_walk(gc_snapshot_add_type, &types);
+
+    static const byte magic[4] = {'M', 'P', 'H', 'S'};
+    gc_snapshot_put(&out, magic, sizeof(magic));
+    gc_snapshot_put_byte(&out, 1);
+    gc_snapshot_put_byte(&out, 0);
+    gc_snapshot_put_byte(&out, BYTES_PER_BLOCK & 0xff);
+    gc_snapshot_put_byte(&out, BYTES_PER_BLOCK >> 8);
+    gc_snapshot_put_byte(&out, types.n);
+    for (size_t i = 0; i < types.n; i++) {
+        size_t name_len;
+        const byte *name = qstr_data(types.type[i]->name, &name_len);
+        name_len = MIN(name_len, 255);
+        gc_snapshot_put_byte(&out, name_len);
+        gc_snapshot_put(&out, name, name_len);
+    }
+
+    gc_snapshot_walk(gc_snapshot_add_chunk, &types);
+    GC_EXIT();
+
+    return out.pos;
+}
+#endif
+
 void gc_dump_info(void) {
     gc_info_t info;
     gc_info(&info);
@@ -805,110 +1846,112 @@ void gc_dump_info(void) {
 void gc_dump_alloc_table(void) {
     GC_ENTER();
     static const size_t DUMP_BYTES_PER_LINE = 64;
-    #if !EXTENSIVE_HEAP_PROFILING
-    // When comparing heap output we don't want to print the starting
-    // pointer of the heap because it changes from run to run.
-    mp_printf(&mp_plat_print, "GC memory layout; from %p:", MP_STATE_MEM(gc_pool_start));
-    #endif
-    for (size_t bl = 0; bl < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB; bl++) {
-        if (bl % DUMP_BYTES_PER_LINE == 0) {
-            // a new line of blocks
-            {
-                // check if this line contains only free blocks
-                size_t bl2 = bl;
-                while (bl2 < MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB && ATB_GET_KIND(bl2) == AT_FREE) {
-                    bl2++;
-                }
-                if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
-                    // there are at least 2 lines containing only free blocks, so abbreviate their printing
-                    mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
-                    bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
-                    if (bl >= MP_STATE_MEM(gc_alloc_table_byte_len) * BLOCKS_PER_ATB) {
-                        // got to end of heap
-                        break;
-                    }
-                }
-            }
-            // print header for new line of blocks
-            // (the cast to uint32_t is for 16-bit ports)
-            //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
-            mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
-        }
-        int c = ' ';
-        switch (ATB_GET_KIND(bl)) {
-            case AT_FREE: c = '.'; break;
-            /* this prints out if the object is reachable from BSS or STACK (for unix only)
-            case AT_HEAD: {
-                c = 'h';
-                void **ptrs = (void**)(void*)&mp_state_ctx;
-                mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
-                for (mp_uint_t i = 0; i < len; i++) {
-                    mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                    if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                        c = 'B';
-                        break;
+    for (mp_state_mem_area_t *area = &MP_STATE_MEM(area); area != NULL; area = NEXT_AREA(area)) {
+        #if !EXTENSIVE_HEAP_PROFILING
+        // When comparing heap output we don't want to print the starting
+        // pointer of the heap because it changes from run to run.
+        mp_printf(&mp_plat_print, "GC memory layout; from %p:", area->gc_pool_start);
+        #endif
+        for (size_t bl = 0; bl < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB; bl++) {
+            if (bl % DUMP_BYTES_PER_LINE == 0) {
+                // a new line of blocks
+                {
+                    // check if this line contains only free blocks
+                    size_t bl2 = bl;
+                    while (bl2 < area->gc_alloc_table_byte_len * BLOCKS_PER_ATB && ATB_GET_KIND(area, bl2) == AT_FREE) {
+                        bl2++;
                     }
-                }
-                if (c == 'h') {
-                    ptrs = (void**)&c;
-                    len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
-                    for (mp_uint_t i = 0; i < len; i++) {
-                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
-                        if (VERIFY_PTR(ptr) && BLOCK_FROM_PTR(ptr) == bl) {
-                            c = 'S';
+                    if (bl2 - bl >= 2 * DUMP_BYTES_PER_LINE) {
+                        // there are at least 2 lines containing only free blocks, so abbreviate their printing
+                        mp_printf(&mp_plat_print, "\n       (%u lines all free)", (uint)(bl2 - bl) / DUMP_BYTES_PER_LINE);
+                        bl = bl2 & (~(DUMP_BYTES_PER_LINE - 1));
+                        if (bl >= area->gc_alloc_table_byte_len * BLOCKS_PER_ATB) {
+                            // got to end of heap
                             break;
                         }
                     }
                 }
-                break;
+                // print header for new line of blocks
+                // (the cast to uint32_t is for 16-bit ports)
+                //mp_printf(&mp_plat_print, "\n%05x: ", (uint)(PTR_FROM_BLOCK(bl) & (uint32_t)0xfffff));
+                mp_printf(&mp_plat_print, "\n%05x: ", (uint)((bl * BYTES_PER_BLOCK) & (uint32_t)0xfffff));
             }
-            */
-            /* this prints the uPy object type of the head block */
-            case AT_HEAD: {
-                void **ptr = (void**)(MP_STATE_MEM(gc_pool_start) + bl * BYTES_PER_BLOCK);
-                if (*ptr == &mp_type_tuple) { c = 'T'; }
-                else if (*ptr == &mp_type_list) { c = 'L'; }
-                else if (*ptr == &mp_type_dict) { c = 'D'; }
-                else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
-                #if MICROPY_PY_BUILTINS_BYTEARRAY
-                else if (*ptr == &mp_type_bytearray) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_ARRAY
-                else if (*ptr == &mp_type_array) { c = 'A'; }
-                #endif
-                #if MICROPY_PY_BUILTINS_FLOAT
-                else if (*ptr == &mp_type_float) { c = 'F'; }
-                #endif
-                else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
-                else if (*ptr == &mp_type_module) { c = 'M'; }
-                else {
+            int c = ' ';
+            switch (ATB_GET_KIND(area, bl)) {
+                case AT_FREE: c = '.'; break;
+                /* this prints out if the object is reachable from BSS or STACK (for unix only)
+                case AT_HEAD: {
                     c = 'h';
-                    #if 0
-                    // This code prints "Q" for qstr-pool data, and "q" for qstr-str
-                    // data.  It can be useful to see how qstrs are being allocated,
-                    // but is disabled by default because it is very slow.
-                    for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
-                        if ((qstr_pool_t*)ptr == pool) {
-                            c = 'Q';
+                    void **ptrs = (void**)(void*)&MP_STATE_CTX;
+                    mp_uint_t len = offsetof(mp_state_ctx_t, vm.stack_top) / sizeof(mp_uint_t);
+                    for (mp_uint_t i = 0; i < len; i++) {
+                        mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                        if (VERIFY_PTR(area, ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                            c = 'B';
                             break;
                         }
-                        for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
-                            if ((const byte*)ptr == *q) {
-                                c = 'q';
+                    }
+                    if (c == 'h') {
+                        ptrs = (void**)&c;
+                        len = ((mp_uint_t)MP_STATE_THREAD(stack_top) - (mp_uint_t)&c) / sizeof(mp_uint_t);
+                        for (mp_uint_t i = 0; i < len; i++) {
+                            mp_uint_t ptr = (mp_uint_t)ptrs[i];
+                            if (VERIFY_PTR(area, ptr) && BLOCK_FROM_PTR(area, ptr) == bl) {
+                                c = 'S';
                                 break;
                             }
                         }
                     }
+                    break;
+                }
+                */
+                /* this prints the uPy object type of the head block */
+                case AT_HEAD: {
+                    void **ptr = (void**)(area->gc_pool_start + bl * BYTES_PER_BLOCK);
+                    if (*ptr == &mp_type_tuple) { c = 'T'; }
+                    else if (*ptr == &mp_type_list) { c = 'L'; }
+                    else if (*ptr == &mp_type_dict) { c = 'D'; }
+                    else if (*ptr == &mp_type_str || *ptr == &mp_type_bytes) { c = 'S'; }
+                    #if MICROPY_PY_BUILTINS_BYTEARRAY
+                    else if (*ptr == &mp_type_bytearray) { c = 'A'; }
+                    #endif
+                    #if MICROPY_PY_ARRAY
+                    else if (*ptr == &mp_type_array) { c = 'A'; }
+                    #endif
+                    #if MICROPY_PY_BUILTINS_FLOAT
+                    else if (*ptr == &mp_type_float) { c = 'F'; }
                     #endif
+                    else if (*ptr == &mp_type_fun_bc) { c = 'B'; }
+                    else if (*ptr == &mp_type_module) { c = 'M'; }
+                    else {
+                        c = 'h';
+                        #if 0
+                        // This code prints "Q" for qstr-pool data, and "q" for qstr-str
+                        // data.  It can be useful to see how qstrs are being allocated,
+                        // but is disabled by default because it is very slow.
+                        for (qstr_pool_t *pool = MP_STATE_VM(last_pool); c == 'h' && pool != NULL; pool = pool->prev) {
+                            if ((qstr_pool_t*)ptr == pool) {
+                                c = 'Q';
+                                break;
+                            }
+                            for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
+                                if ((const byte*)ptr == *q) {
+                                    c = 'q';
+                                    break;
+                                }
+                            }
+                        }
+                        #endif
+                    }
+                    break;
                 }
-                break;
+                case AT_TAIL: c = '='; break;
+                case AT_MARK: c = 'm'; break;
             }
-            case AT_TAIL: c = '='; break;
-            case AT_MARK: c = 'm'; break;
+            mp_printf(&mp_plat_print, "%c", c);
         }
-        mp_printf(&mp_plat_print, "%c", c);
+        mp_print_str(&mp_plat_print, "\n");
     }
-    mp_print_str(&mp_plat_print, "\n");
     GC_EXIT();
 }
 
@@ -33,6 +33,12 @@
 
 void gc_init(void *start, void *end);
 
+#if MICROPY_GC_SPLIT_HEAP
+// Add another memory region to the heap; the region's own bookkeeping is
+// placed at its start
+void gc_add(void *start, void *end);
+#endif
+
 // These lock/unlock functions can be nested.
 // They can be used to prevent the GC from allocating/freeing.
 void gc_lock(void);
@@ -48,6 +54,14 @@ void gc_collect_end(void);
 // Use this function to sweep the whole heap and run all finalisers
 void gc_sweep_all(void);
 
+#if MICROPY_GC_INCREMENTAL_SWEEP
+// Make the next collection only mark, leaving the sweep to gc_sweep_step
+// and to the allocations that follow
+void gc_sweep_defer(void);
+// Sweep about n_blocks more blocks; returns true once no sweep is pending
+bool gc_sweep_step(size_t n_blocks);
+#endif
+
 enum {
     GC_ALLOC_FLAG_HAS_FINALISER = 1,
 };
@@ -57,6 +71,18 @@ void gc_free(void *ptr); // does not call finaliser
 size_t gc_nbytes(const void *ptr);
 void *gc_realloc(void *ptr, size_t n_bytes, bool allow_move);
 
+#if MICROPY_GC_ARENA
+// Allocate an arena with room for n_bytes; returns NULL if there is no memory
+// or no free arena slot
+void *gc_arena_new(size_t n_bytes);
+// Make the given arena (or NULL for the heap) the one this thread allocates
+// from, returning the previous one
+void *gc_arena_activate(void *arena);
+// Let the next collection take the arena back; whatever is still reachable
+// in it then becomes ordinary heap memory
+void gc_arena_close(void *arena);
+#endif
+
 typedef struct _gc_info_t {
     size_t total;
     size_t used;
@@ -68,6 +94,20 @@ typedef struct _gc_info_t {
 } gc_info_t;
 
 void gc_info(gc_info_t *info);
+
+#if MICROPY_GC_MEM_PEAK
+// Start a new measurement: the peak becomes the current use and the total
+// allocated is cleared
+void gc_reset_peak(void);
+#endif
+
+#if MICROPY_GC_PROFILE
+// Clear the per-location allocation counts
+void gc_profile_clear(void);
+// Write a snapshot of the heap layout to buf (see gc.c for the format) and
+// return its full length, which is more than len if it didn't fit
+size_t gc_snapshot(byte *buf, size_t len);
+#endif
 void gc_dump_info(void);
 void gc_dump_alloc_table(void);
 
@@ -119,6 +119,37 @@ STATIC bool is_tail_of_identifier(mp_lexer_t *lex) {
     return is_head_of_identifier(lex) || is_digit(lex);
 }
 
+// Get the next byte of the source, a block at a time if the reader can
+STATIC unichar read_source_byte(mp_lexer_t *lex) {
+    if (lex->buf_cur < lex->buf_top) {
+        return *lex->buf_cur++;
+    }
+    if (lex->reader.readbuf == NULL) {
+        return lex->reader.readbyte(lex->reader.data);
+    }
+    mp_uint_t len = lex->reader.readbuf(lex->reader.data, &lex->buf_cur);
+    if (len == 0) {
+        lex->buf_cur = lex->buf_top = NULL;
+        return MP_LEXER_EOF;
+    }
+    lex->buf_top = lex->buf_cur + len;
+    return *lex->buf_cur++;
+}
+
+#if MICROPY_OPT_TIERED_NATIVE
+// hash the source as it's read, so functions compiled again from the file
+// later can check that it's still the same
+STATIC unichar read_byte(mp_lexer_t *lex) {
+    unichar c = read_source_byte(lex);
+    if (c != MP_LEXER_EOF) {
+        lex->src_hash = (lex->src_hash * 33) ^ c;
+    }
+    return c;
+}
+#else
+#define read_byte read_source_byte
+#endif
+
 STATIC void next_char(mp_lexer_t *lex) {
     if (lex->chr0 == '\n') {
         // a new line
@@ -134,14 +165,14 @@ STATIC void next_char(mp_lexer_t *lex) {
 
     lex->chr0 = lex->chr1;
     lex->chr1 = lex->chr2;
-    lex->chr2 = lex->reader.readbyte(lex->reader.data);
+    lex->chr2 = read_byte(lex);
 
     if (lex->chr1 == '\r') {
         // CR is a new line, converted to LF
         lex->chr1 = '\n';
         if (lex->chr2 == '\n') {
             // CR LF is a single new line, throw out the extra LF
-            lex->chr2 = lex->reader.readbyte(lex->reader.data);
+            lex->chr2 = read_byte(lex);
         }
     }
 
@@ -209,7 +240,6 @@ STATIC const uint8_t tok_enc_kind[] = {
 };
 
 // must have the same order as enum in lexer.h
-// must be sorted according to strcmp
 STATIC const char *const tok_kw[] = {
     "False",
     "None",
@@ -251,6 +281,53 @@ STATIC const char *const tok_kw[] = {
     "yield",
 };
 
+// Keywords by the top 7 bits of (hash * 65) & 0xffff, where hash is the low
+// 16 bits of the qstr hash of the keyword.  That gives each keyword a slot of
+// its own, so a name is looked up with one compare.
+#define TOK_KW_HASH_SLOT(hash) ((((hash) * 65) & 0xffff) >> 9)
+STATIC const uint8_t tok_kw_hash[128] = {
+    #if MICROPY_PY_ASYNC_AWAIT
+    [9] = MP_TOKEN_KW_ASYNC,
+    #endif
+    [13] = MP_TOKEN_KW___DEBUG__,
+    [19] = MP_TOKEN_KW_FOR,
+    [20] = MP_TOKEN_KW_FROM,
+    [22] = MP_TOKEN_KW_NONE,
+    [27] = MP_TOKEN_KW_IN,
+    [28] = MP_TOKEN_KW_IF,
+    [30] = MP_TOKEN_KW_FALSE,
+    [31] = MP_TOKEN_KW_IS,
+    [33] = MP_TOKEN_KW_NOT,
+    [35] = MP_TOKEN_KW_TRY,
+    [38] = MP_TOKEN_KW_OR,
+    [44] = MP_TOKEN_KW_BREAK,
+    [46] = MP_TOKEN_KW_WHILE,
+    [47] = MP_TOKEN_KW_ASSERT,
+    [50] = MP_TOKEN_KW_ELSE,
+    [54] = MP_TOKEN_KW_ELIF,
+    [67] = MP_TOKEN_KW_CONTINUE,
+    [72] = MP_TOKEN_KW_IMPORT,
+    [74] = MP_TOKEN_KW_FINALLY,
+    [75] = MP_TOKEN_KW_YIELD,
+    [83] = MP_TOKEN_KW_LAMBDA,
+    [84] = MP_TOKEN_KW_NONLOCAL,
+    [91] = MP_TOKEN_KW_DEF,
+    [92] = MP_TOKEN_KW_DEL,
+    [93] = MP_TOKEN_KW_CLASS,
+    [94] = MP_TOKEN_KW_PASS,
+    [103] = MP_TOKEN_KW_GLOBAL,
+    [105] = MP_TOKEN_KW_RAISE,
+    [109] = MP_TOKEN_KW_TRUE,
+    [119] = MP_TOKEN_KW_WITH,
+    [120] = MP_TOKEN_KW_EXCEPT,
+    #if MICROPY_PY_ASYNC_AWAIT
+    [121] = MP_TOKEN_KW_AWAIT,
+    #endif
+    [123] = MP_TOKEN_KW_AND,
+    [125] = MP_TOKEN_KW_AS,
+    [127] = MP_TOKEN_KW_RETURN,
+};
+
 // This is called with CUR_CHAR() before first hex digit, and should return with
 // it pointing to last hex digit
 // num_digits must be greater than zero
@@ -530,32 +607,32 @@ void mp_lexer_to_next(mp_lexer_t *lex) {
     } else if (is_head_of_identifier(lex)) {
         lex->tok_kind = MP_TOKEN_NAME;
 
-        // get first char (add as byte to remain 8-bit clean and support utf-8)
+        // get first char (add as byte to remain 8-bit clean and support utf-8),
+        // hashing the name as it goes so that interning it needn't
+        mp_uint_t hash = qstr_hash_update(QSTR_HASH_INIT, CUR_CHAR(lex));
         vstr_add_byte(&lex->vstr, CUR_CHAR(lex));
         next_char(lex);
 
         // get tail chars
         while (!is_end(lex) && is_tail_of_identifier(lex)) {
+            hash = qstr_hash_update(hash, CUR_CHAR(lex));
             vstr_add_byte(&lex->vstr, CUR_CHAR(lex));
             next_char(lex);
         }
+        lex->tok_hash = qstr_hash_final(hash);
 
         // Check if the name is a keyword.
         // We also check for __debug__ here and convert it to its value.  This is
         // so the parser gives a syntax error on, eg, x.__debug__.  Otherwise, we
         // need to check for this special token in many places in the compiler.
-        const char *s = vstr_null_terminated_str(&lex->vstr);
-        for (size_t i = 0; i < MP_ARRAY_SIZE(tok_kw); i++) {
-            int cmp = strcmp(s, tok_kw[i]);
-            if (cmp == 0) {
-                lex->tok_kind = MP_TOKEN_KW_FALSE + i;
+        mp_token_kind_t kw = tok_kw_hash[TOK_KW_HASH_SLOT(hash)];
+        if (kw != 0) {
+            const char *s = tok_kw[kw - MP_TOKEN_KW_FALSE];
+            if (strlen(s) == lex->vstr.len && memcmp(s, lex->vstr.buf, lex->vstr.len) == 0) {
+                lex->tok_kind = kw;
                 if (lex->tok_kind == MP_TOKEN_KW___DEBUG__) {
                     lex->tok_kind = (MP_STATE_VM(mp_optimise_value) == 0 ? MP_TOKEN_KW_TRUE : MP_TOKEN_KW_FALSE);
                 }
-                break;
-            } else if (cmp < 0) {
-                // Table is sorted and comparison was less-than, so stop searching
-                break;
             }
         }
 
@@ -672,6 +749,8 @@ mp_lexer_t *mp_lexer_new(qstr src_name, mp_reader_t reader) {
 
     lex->source_name = src_name;
     lex->reader = reader;
+    lex->buf_cur = NULL;
+    lex->buf_top = NULL;
     lex->line = 1;
     lex->column = (size_t)-2; // account for 3 dummy bytes
     lex->emit_dent = 0;
@@ -684,6 +763,10 @@ mp_lexer_t *mp_lexer_new(qstr src_name, mp_reader_t reader) {
     // store sentinel for first indentation level
     lex->indent_level[0] = 0;
 
+    #if MICROPY_OPT_TIERED_NATIVE
+    lex->src_hash = 5381;
+    #endif
+
     // load lexer with start of file, advancing lex->column to 1
     // start with dummy bytes and use next_char() for proper EOL/EOF handling
     lex->chr0 = lex->chr1 = lex->chr2 = 0;
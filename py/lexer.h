@@ -144,12 +144,17 @@ typedef enum _mp_token_kind_t {
 } mp_token_kind_t;
 
 // this data structure is exposed for efficiency
-// public members are: source_name, tok_line, tok_column, tok_kind, vstr
+// public members are: source_name, tok_line, tok_column, tok_kind, tok_hash, vstr
 typedef struct _mp_lexer_t {
     qstr source_name;           // name of source
     mp_reader_t reader;         // stream source
 
     unichar chr0, chr1, chr2;   // current cached characters from source
+    const byte *buf_cur;        // rest of the last block from reader.readbuf
+    const byte *buf_top;
+    #if MICROPY_OPT_TIERED_NATIVE
+    uint32_t src_hash;          // of the source read so far
+    #endif
 
     size_t line;                // current source line
     size_t column;              // current source column
@@ -164,6 +169,7 @@ typedef struct _mp_lexer_t {
     size_t tok_line;            // token source line
     size_t tok_column;          // token source column
     mp_token_kind_t tok_kind;   // token kind
+    mp_uint_t tok_hash;         // qstr hash of the token data, for MP_TOKEN_NAME only
     vstr_t vstr;                // token data
 } mp_lexer_t;
 
@@ -327,6 +327,25 @@ def make_bytes(cfg_bytes_len, cfg_bytes_hash, qstr):
     qhash_str = ('\\x%02x' * cfg_bytes_hash) % tuple(((qhash >> (8 * i)) & 0xff) for i in range(cfg_bytes_hash))
     return '(const byte*)"%s%s" "%s"' % (qhash_str, qlen_str, qdata)
 
+def make_hash_index(hashes):
+    # Make an open-addressing table that maps a qstr hash to 1 + the qstr's
+    # position in its pool, or 0 for an empty slot.  A hash is looked up
+    # starting at (hash & (size - 1)) and probing linearly, the same as
+    # qstr_find_strn does.  Entries of None in hashes are left out.
+    size = 8
+    while size < len(hashes) + len(hashes) // 2:
+        size *= 2
+    assert len(hashes) < 0xffff
+    table = [0] * size
+    for i, h in enumerate(hashes):
+        if h is None:
+            continue
+        j = h & (size - 1)
+        while table[j]:
+            j = (j + 1) & (size - 1)
+        table[j] = i + 1
+    return table
+
 def print_qstr_data(qcfgs, qstrs):
     # get config variables
     cfg_bytes_len = int(qcfgs['BYTES_IN_LEN'])
@@ -344,6 +363,15 @@ def print_qstr_data(qcfgs, qstrs):
         qbytes = make_bytes(cfg_bytes_len, cfg_bytes_hash, qstr)
         print('QDEF(MP_QSTR_%s, %s)' % (ident, qbytes))
 
+    # print the hash index of the pool, leaving out MP_QSTR_NULL
+    hashes = [None] + [compute_hash(bytes_cons(qstr, 'utf8'), cfg_bytes_hash)
+        for order, ident, qstr in sorted(qstrs.values(), key=lambda x: x[0])]
+    print('')
+    print('#ifdef QINDEX')
+    for n in make_hash_index(hashes):
+        print('QINDEX(%d)' % n)
+    print('#endif')
+
 def do_work(infiles):
     qcfgs, qstrs = parse_input_headers(infiles)
     print_qstr_data(qcfgs, qstrs)
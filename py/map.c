@@ -76,16 +76,123 @@ STATIC size_t get_hash_alloc_greater_or_equal_to(size_t x) {
 /******************************************************************************/
 /* map                                                                        */
 
+#if MICROPY_MAP_COMPACT
+// A hash table keeps its entries in the order they were added.  Tables of up
+// to MAP_LINEAR_MAX entries have no holes and are searched like ordered maps.
+// Larger ones leave deleted entries behind with an MP_OBJ_SENTINEL key, so
+// the entries in use are followed only by empty ones, and the entries are
+// followed in the same allocation by an index: a hash table of entry numbers
+// plus one (0 is an empty slot), 1, 2 or 4 bytes each, that is probed
+// linearly and at most 3/4 full.
+#define MAP_LINEAR_MAX (8)
+
+STATIC size_t map_index_len(size_t alloc) {
+    size_t len = 16;
+    while (len < alloc + alloc / 3) {
+        len <<= 1;
+    }
+    return len;
+}
+
+STATIC size_t map_index_width(size_t alloc) {
+    return alloc < 0xff ? 1 : alloc < 0xffff ? 2 : 4;
+}
+
+STATIC size_t map_table_size(size_t alloc) {
+    size_t size = alloc * sizeof(mp_map_elem_t);
+    if (alloc > MAP_LINEAR_MAX) {
+        size += map_index_len(alloc) * map_index_width(alloc);
+    }
+    return size;
+}
+
+static inline byte *map_index(const mp_map_t *map) {
+    return (byte*)&map->table[map->alloc];
+}
+
+// Return the number of entries in use, including deleted ones
+STATIC size_t map_filled(const mp_map_t *map) {
+    size_t lo = map->used;
+    size_t hi = map->alloc;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (map->table[mid].key == MP_OBJ_NULL) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+STATIC size_t map_index_get(const byte *index, size_t width, size_t pos) {
+    if (width == 1) {
+        return index[pos];
+    } else if (width == 2) {
+        return ((const uint16_t*)index)[pos];
+    } else {
+        return ((const uint32_t*)index)[pos];
+    }
+}
+
+STATIC void map_index_set(byte *index, size_t width, size_t pos, size_t n) {
+    if (width == 1) {
+        index[pos] = n;
+    } else if (width == 2) {
+        ((uint16_t*)index)[pos] = n;
+    } else {
+        ((uint32_t*)index)[pos] = n;
+    }
+}
+#else
+#define map_table_size(alloc) ((alloc) * sizeof(mp_map_elem_t))
+#endif
+
+#define MAP_LINEAR_REMOVE (MICROPY_PY_COLLECTIONS_ORDEREDDICT || MICROPY_MAP_COMPACT)
+
+STATIC mp_uint_t map_hash(mp_obj_t index) {
+    // fast path for common case of qstr
+    if (mp_obj_is_qstr(index)) {
+        return qstr_hash(MP_OBJ_QSTR_VALUE(index));
+    #if MICROPY_OPT_MAP_INT_KEYS
+    } else if (mp_obj_is_small_int(index)) {
+        // a small int is its own hash
+        return MP_OBJ_SMALL_INT_VALUE(index);
+    #endif
+    } else {
+        return MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    }
+}
+
+// Clear the flags saying all keys are of one kind that index doesn't fit
+static inline void map_key_added(mp_map_t *map, mp_obj_t index) {
+    if (!mp_obj_is_qstr(index)) {
+        map->all_keys_are_qstrs = 0;
+    }
+    #if MICROPY_OPT_MAP_INT_KEYS
+    if (!mp_obj_is_small_int(index)) {
+        map->all_keys_are_small_ints = 0;
+    }
+    #endif
+}
+
+static inline void map_keys_reset(mp_map_t *map) {
+    map->all_keys_are_qstrs = 1;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    map->all_keys_are_small_ints = 1;
+    #endif
+}
+
 void mp_map_init(mp_map_t *map, size_t n) {
     if (n == 0) {
         map->alloc = 0;
         map->table = NULL;
     } else {
         map->alloc = n;
-        map->table = m_new0(mp_map_elem_t, map->alloc);
+        map->table = (mp_map_elem_t*)m_new0(byte, map_table_size(n));
     }
     map->used = 0;
-    map->all_keys_are_qstrs = 1;
+    map_keys_reset(map);
     map->is_fixed = 0;
     map->is_ordered = 0;
 }
@@ -94,30 +201,104 @@ void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table) {
     map->alloc = n;
     map->used = n;
     map->all_keys_are_qstrs = 1;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    map->all_keys_are_small_ints = 0;
+    #endif
     map->is_fixed = 1;
     map->is_ordered = 1;
     map->table = (mp_map_elem_t*)table;
 }
 
+void mp_map_init_copy(mp_map_t *map, const mp_map_t *src) {
+    mp_map_init(map, src->alloc);
+    map->used = src->used;
+    map->all_keys_are_qstrs = src->all_keys_are_qstrs;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    map->all_keys_are_small_ints = src->all_keys_are_small_ints;
+    #endif
+    map->is_ordered = src->is_ordered;
+    size_t size = map_table_size(src->alloc);
+    #if MICROPY_MAP_COMPACT
+    if (src->is_ordered) {
+        // an ordered map has no index
+        size = src->alloc * sizeof(mp_map_elem_t);
+    }
+    #endif
+    memcpy(map->table, src->table, size);
+}
+
 // Differentiate from mp_map_clear() - semantics is different
 void mp_map_deinit(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(byte, map->table, map_table_size(map->alloc));
     }
     map->used = map->alloc = 0;
 }
 
 void mp_map_clear(mp_map_t *map) {
     if (!map->is_fixed) {
-        m_del(mp_map_elem_t, map->table, map->alloc);
+        m_del(byte, map->table, map_table_size(map->alloc));
     }
     map->alloc = 0;
     map->used = 0;
-    map->all_keys_are_qstrs = 1;
+    map_keys_reset(map);
     map->is_fixed = 0;
     map->table = NULL;
 }
 
+#if MICROPY_MAP_COMPACT
+// Squeeze out the deleted entries, resize the entry array (in place when the
+// heap allows) and build a new index.
+STATIC void mp_map_rehash(mp_map_t *map) {
+    size_t old_alloc = map->alloc;
+    size_t n_filled = old_alloc > MAP_LINEAR_MAX ? map_filled(map) : map->used;
+    size_t new_alloc;
+    if (n_filled == map->used) {
+        new_alloc = get_hash_alloc_greater_or_equal_to(old_alloc + 1);
+    } else {
+        // leave room for a quarter as many entries again, so that adding
+        // after deleting doesn't rehash every time
+        new_alloc = get_hash_alloc_greater_or_equal_to(map->used + map->used / 4 + 1);
+    }
+    DEBUG_printf("mp_map_rehash(%p): " UINT_FMT " -> " UINT_FMT "\n", map, old_alloc, new_alloc);
+    mp_map_elem_t *table = map->table;
+    size_t n = 0;
+    map_keys_reset(map);
+    for (size_t i = 0; i < n_filled; i++) {
+        if (table[i].key != MP_OBJ_SENTINEL) {
+            map_key_added(map, table[i].key);
+            table[n++] = table[i];
+        }
+    }
+    size_t new_size = map_table_size(new_alloc);
+    table = (mp_map_elem_t*)m_renew_maybe(byte, map->table, map_table_size(old_alloc), new_size, true);
+    bool failed = table == NULL;
+    if (failed) {
+        // still rebuild the index, as the entries have moved
+        table = map->table;
+        new_alloc = old_alloc;
+    }
+    map->table = table;
+    map->alloc = new_alloc;
+    map->used = n;
+    memset(&table[n], 0, map_table_size(new_alloc) - n * sizeof(mp_map_elem_t));
+    if (new_alloc > MAP_LINEAR_MAX) {
+        size_t width = map_index_width(new_alloc);
+        size_t mask = map_index_len(new_alloc) - 1;
+        byte *index = map_index(map);
+        for (size_t i = 0; i < n; i++) {
+            size_t pos = map_hash(table[i].key) & mask;
+            while (map_index_get(index, width, pos) != 0) {
+                pos = (pos + 1) & mask;
+            }
+            map_index_set(index, width, pos, i + 1);
+        }
+    }
+    if (failed) {
+        m_malloc_fail(new_size);
+    }
+}
+#else
 STATIC void mp_map_rehash(mp_map_t *map) {
     size_t old_alloc = map->alloc;
     size_t new_alloc = get_hash_alloc_greater_or_equal_to(map->alloc + 1);
@@ -127,7 +308,7 @@ STATIC void mp_map_rehash(mp_map_t *map) {
     // If we reach this point, table resizing succeeded, now we can edit the old map.
     map->alloc = new_alloc;
     map->used = 0;
-    map->all_keys_are_qstrs = 1;
+    map_keys_reset(map);
     map->table = new_table;
     for (size_t i = 0; i < old_alloc; i++) {
         if (old_table[i].key != MP_OBJ_NULL && old_table[i].key != MP_OBJ_SENTINEL) {
@@ -136,6 +317,40 @@ STATIC void mp_map_rehash(mp_map_t *map) {
     }
     m_del(mp_map_elem_t, old_table, old_alloc);
 }
+#endif
+
+// Search the entries of an ordered array (or a small hash table) in turn.  A
+// removed element is taken out by moving the rest of the array down, and is
+// returned just after the end so the caller can access it if needed.
+STATIC mp_map_elem_t *map_lookup_linear(mp_map_t *map, mp_obj_t index, bool compare_only_ptrs, mp_map_lookup_kind_t lookup_kind) {
+    for (mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->used]; elem < top; elem++) {
+        if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
+            #if MAP_LINEAR_REMOVE
+            if (MP_UNLIKELY(lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND)) {
+                mp_obj_t value = elem->value;
+                --map->used;
+                memmove(elem, elem + 1, (top - elem - 1) * sizeof(*elem));
+                elem = &map->table[map->used];
+                elem->key = MP_OBJ_NULL;
+                elem->value = value;
+            }
+            #endif
+            return elem;
+        }
+    }
+    return NULL;
+}
+
+#if MICROPY_PY_COLLECTIONS_ORDEREDDICT || MICROPY_MAP_COMPACT
+// Add index at the end of the entries, which must have room for it
+STATIC mp_map_elem_t *map_append(mp_map_t *map, size_t pos, mp_obj_t index) {
+    mp_map_elem_t *elem = &map->table[pos];
+    elem->key = index;
+    elem->value = MP_OBJ_NULL;
+    map_key_added(map, index);
+    return elem;
+}
+#endif
 
 // MP_MAP_LOOKUP behaviour:
 //  - returns NULL if not found, else the slot it was found in with key,value non-null
@@ -165,29 +380,19 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             return NULL;
         }
     }
+    #if MICROPY_OPT_MAP_INT_KEYS
+    if (map->all_keys_are_small_ints && mp_obj_is_small_int(index)) {
+        // Index and keys are small ints, which are equal only if identical.
+        compare_only_ptrs = true;
+    }
+    #endif
 
     // if the map is an ordered array then we must do a brute force linear search
     if (map->is_ordered) {
-        for (mp_map_elem_t *elem = &map->table[0], *top = &map->table[map->used]; elem < top; elem++) {
-            if (elem->key == index || (!compare_only_ptrs && mp_obj_equal(elem->key, index))) {
-                #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
-                if (MP_UNLIKELY(lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND)) {
-                    // remove the found element by moving the rest of the array down
-                    mp_obj_t value = elem->value;
-                    --map->used;
-                    memmove(elem, elem + 1, (top - elem - 1) * sizeof(*elem));
-                    // put the found element after the end so the caller can access it if needed
-                    elem = &map->table[map->used];
-                    elem->key = MP_OBJ_NULL;
-                    elem->value = value;
-                }
-                #endif
-                return elem;
-            }
-        }
+        mp_map_elem_t *elem = map_lookup_linear(map, index, compare_only_ptrs, lookup_kind);
         #if MICROPY_PY_COLLECTIONS_ORDEREDDICT
-        if (MP_LIKELY(lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)) {
-            return NULL;
+        if (elem != NULL || MP_LIKELY(lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND)) {
+            return elem;
         }
         if (map->used == map->alloc) {
             // TODO: Alloc policy
@@ -195,19 +400,77 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             map->table = m_renew(mp_map_elem_t, map->table, map->used, map->alloc);
             mp_seq_clear(map->table, map->used, map->alloc, sizeof(*map->table));
         }
-        mp_map_elem_t *elem = map->table + map->used++;
-        elem->key = index;
-        if (!mp_obj_is_qstr(index)) {
-            map->all_keys_are_qstrs = 0;
-        }
-        return elem;
+        return map_append(map, map->used++, index);
         #else
-        return NULL;
+        return elem;
         #endif
     }
 
     // map is a hash table (not an ordered array), so do a hash lookup
 
+    #if MICROPY_MAP_COMPACT
+
+    if (map->alloc <= MAP_LINEAR_MAX) {
+        if (!mp_obj_is_qstr(index)) {
+            // not needed for the search, but raises TypeError if unhashable
+            map_hash(index);
+        }
+        mp_map_elem_t *elem = map_lookup_linear(map, index, compare_only_ptrs, lookup_kind);
+        if (elem != NULL || lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+            return elem;
+        }
+        if (map->used == map->alloc) {
+            mp_map_rehash(map);
+            if (map->alloc > MAP_LINEAR_MAX) {
+                // the table has an index now
+                return mp_map_lookup(map, index, lookup_kind);
+            }
+        }
+        return map_append(map, map->used++, index);
+    }
+
+    size_t width = map_index_width(map->alloc);
+    size_t mask = map_index_len(map->alloc) - 1;
+    byte *idx = map_index(map);
+    for (size_t pos = map_hash(index) & mask;; pos = (pos + 1) & mask) {
+        size_t n = map_index_get(idx, width, pos);
+        if (n == 0) {
+            // found empty slot, so index is not in table
+            if (lookup_kind != MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
+                return NULL;
+            }
+            size_t filled = map_filled(map);
+            if (filled == map->alloc) {
+                // no entries left at the end, rehash and start again
+                mp_map_rehash(map);
+                return mp_map_lookup(map, index, lookup_kind);
+            }
+            map_index_set(idx, width, pos, filled + 1);
+            map->used += 1;
+            return map_append(map, filled, index);
+        }
+        mp_map_elem_t *elem = &map->table[n - 1];
+        if (elem->key == index || (!compare_only_ptrs && elem->key != MP_OBJ_SENTINEL && mp_obj_equal(elem->key, index))) {
+            // found index
+            // Note: CPython does not replace the index; try x={True:'true'};x[1]='one';x
+            if (lookup_kind == MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
+                map->used--;
+                if ((n == map->alloc || map->table[n].key == MP_OBJ_NULL)
+                    && map_index_get(idx, width, (pos + 1) & mask) == 0) {
+                    // optimisation if this is the last entry and next slot is empty
+                    map_index_set(idx, width, pos, 0);
+                    elem->key = MP_OBJ_NULL;
+                } else {
+                    elem->key = MP_OBJ_SENTINEL;
+                }
+                // keep elem->value so that caller can access it if needed
+            }
+            return elem;
+        }
+    }
+
+    #else
+
     if (map->alloc == 0) {
         if (lookup_kind == MP_MAP_LOOKUP_ADD_IF_NOT_FOUND) {
             mp_map_rehash(map);
@@ -216,14 +479,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
         }
     }
 
-    // get hash of index, with fast path for common case of qstr
-    mp_uint_t hash;
-    if (mp_obj_is_qstr(index)) {
-        hash = qstr_hash(MP_OBJ_QSTR_VALUE(index));
-    } else {
-        hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
-    }
-
+    mp_uint_t hash = map_hash(index);
     size_t pos = hash % map->alloc;
     size_t start_pos = pos;
     mp_map_elem_t *avail_slot = NULL;
@@ -238,9 +494,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                 }
                 avail_slot->key = index;
                 avail_slot->value = MP_OBJ_NULL;
-                if (!mp_obj_is_qstr(index)) {
-                    map->all_keys_are_qstrs = 0;
-                }
+                map_key_added(map, index);
                 return avail_slot;
             } else {
                 return NULL;
@@ -278,9 +532,7 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
                     map->used++;
                     avail_slot->key = index;
                     avail_slot->value = MP_OBJ_NULL;
-                    if (!mp_obj_is_qstr(index)) {
-                        map->all_keys_are_qstrs = 0;
-                    }
+                    map_key_added(map, index);
                     return avail_slot;
                 } else {
                     // not enough room in table, rehash it
@@ -293,6 +545,8 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
             }
         }
     }
+
+    #endif
 }
 
 /******************************************************************************/
@@ -303,6 +557,9 @@ mp_map_elem_t *mp_map_lookup(mp_map_t *map, mp_obj_t index, mp_map_lookup_kind_t
 void mp_set_init(mp_set_t *set, size_t n) {
     set->alloc = n;
     set->used = 0;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    set->all_keys_are_small_ints = 1;
+    #endif
     set->table = m_new0(mp_obj_t, set->alloc);
 }
 
@@ -311,6 +568,9 @@ STATIC void mp_set_rehash(mp_set_t *set) {
     mp_obj_t *old_table = set->table;
     set->alloc = get_hash_alloc_greater_or_equal_to(set->alloc + 1);
     set->used = 0;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    set->all_keys_are_small_ints = 1;
+    #endif
     set->table = m_new0(mp_obj_t, set->alloc);
     for (size_t i = 0; i < old_alloc; i++) {
         if (old_table[i] != MP_OBJ_NULL && old_table[i] != MP_OBJ_SENTINEL) {
@@ -320,6 +580,16 @@ STATIC void mp_set_rehash(mp_set_t *set) {
     m_del(mp_obj_t, old_table, old_alloc);
 }
 
+#if MICROPY_OPT_MAP_INT_KEYS
+static inline void set_key_added(mp_set_t *set, mp_obj_t index) {
+    if (!mp_obj_is_small_int(index)) {
+        set->all_keys_are_small_ints = 0;
+    }
+}
+#else
+#define set_key_added(set, index) (void)0
+#endif
+
 mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t lookup_kind) {
     // Note: lookup_kind can be MP_MAP_LOOKUP_ADD_IF_NOT_FOUND_OR_REMOVE_IF_FOUND which
     // is handled by using bitwise operations.
@@ -331,7 +601,19 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
             return MP_OBJ_NULL;
         }
     }
-    mp_uint_t hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    bool compare_only_ptrs = false;
+    mp_uint_t hash;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    if (mp_obj_is_small_int(index)) {
+        // a small int is its own hash, and if all the keys are small ints
+        // then only an identical one can be equal to it
+        hash = MP_OBJ_SMALL_INT_VALUE(index);
+        compare_only_ptrs = set->all_keys_are_small_ints;
+    } else
+    #endif
+    {
+        hash = MP_OBJ_SMALL_INT_VALUE(mp_unary_op(MP_UNARY_OP_HASH, index));
+    }
     size_t pos = hash % set->alloc;
     size_t start_pos = pos;
     mp_obj_t *avail_slot = NULL;
@@ -345,6 +627,7 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
                 }
                 set->used++;
                 *avail_slot = index;
+                set_key_added(set, index);
                 return index;
             } else {
                 return MP_OBJ_NULL;
@@ -354,7 +637,7 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
             if (avail_slot == NULL) {
                 avail_slot = &set->table[pos];
             }
-        } else if (mp_obj_equal(elem, index)) {
+        } else if (compare_only_ptrs ? elem == index : mp_obj_equal(elem, index)) {
             // found index
             if (lookup_kind & MP_MAP_LOOKUP_REMOVE_IF_FOUND) {
                 // delete element
@@ -379,6 +662,7 @@ mp_obj_t mp_set_lookup(mp_set_t *set, mp_obj_t index, mp_map_lookup_kind_t looku
                     // there was an available slot, so use that
                     set->used++;
                     *avail_slot = index;
+                    set_key_added(set, index);
                     return index;
                 } else {
                     // not enough room in table, rehash it
@@ -415,6 +699,9 @@ void mp_set_clear(mp_set_t *set) {
     m_del(mp_obj_t, set->table, set->alloc);
     set->alloc = 0;
     set->used = 0;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    set->all_keys_are_small_ints = 1;
+    #endif
     set->table = NULL;
 }
 
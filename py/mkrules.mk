@@ -111,16 +111,44 @@ $(TOP)/mpy-cross/mpy-cross: $(TOP)/py/*.[ch] $(TOP)/mpy-cross/*.[ch] $(TOP)/port
 FROZEN_MPY_PY_FILES := $(shell find -L $(FROZEN_MPY_DIR) -type f -name '*.py' | $(SED) -e 's=^$(FROZEN_MPY_DIR)/==')
 FROZEN_MPY_MPY_FILES := $(addprefix $(BUILD)/frozen_mpy/,$(FROZEN_MPY_PY_FILES:.py=.mpy))
 
-# to build .mpy files from .py files
-$(BUILD)/frozen_mpy/%.mpy: $(FROZEN_MPY_DIR)/%.py $(TOP)/mpy-cross/mpy-cross
-	@$(ECHO) "MPY $<"
-	$(Q)$(MKDIR) -p $(dir $@)
-	$(Q)$(MPY_CROSS) -o $@ -s $(<:$(FROZEN_MPY_DIR)/%=%) $(MPY_CROSS_FLAGS) $<
+# to build .mpy files from .py files: they are split into FROZEN_MPY_JOBS
+# batches, each compiled by one run of mpy-cross and run in parallel by make
+# -j; when a batch is out of date only its changed files are recompiled,
+# and output for sources and options seen before comes from MPY_CROSS_CACHE
+# (set it empty to not cache)
+FROZEN_MPY_JOBS ?= 4
+MPY_CROSS_CACHE ?= $(TOP)/mpy-cross/build/cache
+FROZEN_MPY_BATCH_SIZE := $(shell expr \( $(words $(FROZEN_MPY_PY_FILES)) + $(FROZEN_MPY_JOBS) - 1 \) / $(FROZEN_MPY_JOBS))
+FROZEN_MPY_BATCH_NEXT := $(shell expr $(FROZEN_MPY_BATCH_SIZE) + 1)
+
+# the files of a batch to compile: the changed ones, or all if mpy-cross
+# changed or an output is missing
+FROZEN_MPY_BATCH_INPUTS = $(filter %.py,$(if $(filter %/mpy-cross FORCE,$?),$^,$?))
+
+# $(call FROZEN_MPY_BATCH,n,files)
+define FROZEN_MPY_BATCH
+$(BUILD)/frozen_mpy/.batch$(1): $(addprefix $(FROZEN_MPY_DIR)/,$(2)) $(TOP)/mpy-cross/mpy-cross
+	@$(ECHO) "MPY $$(FROZEN_MPY_BATCH_INPUTS:$(FROZEN_MPY_DIR)/%=%)"
+	$(Q)$(MKDIR) -p $(sort $(dir $(addprefix $(BUILD)/frozen_mpy/,$(2)))) $(MPY_CROSS_CACHE)
+	$(Q)$(MPY_CROSS) -r $(FROZEN_MPY_DIR) -o $(BUILD)/frozen_mpy $(if $(MPY_CROSS_CACHE),-c $(MPY_CROSS_CACHE)) $(MPY_CROSS_FLAGS) $$(FROZEN_MPY_BATCH_INPUTS)
+	$(Q)touch $$@
+
+ifneq ($(filter-out $(wildcard $(addprefix $(BUILD)/frozen_mpy/,$(2:.py=.mpy))),$(addprefix $(BUILD)/frozen_mpy/,$(2:.py=.mpy))),)
+$(BUILD)/frozen_mpy/.batch$(1): FORCE
+endif
+
+$(addprefix $(BUILD)/frozen_mpy/,$(2:.py=.mpy)): $(BUILD)/frozen_mpy/.batch$(1) ;
+endef
+
+# define a batch for the first FROZEN_MPY_BATCH_SIZE files, then the rest
+# (the words of $(1) count the batches)
+frozen_mpy_batches = $(if $(2),$(eval $(call FROZEN_MPY_BATCH,$(words $(1)),$(wordlist 1,$(FROZEN_MPY_BATCH_SIZE),$(2))))$(call frozen_mpy_batches,$(1) x,$(wordlist $(FROZEN_MPY_BATCH_NEXT),$(words $(2)),$(2))))
+$(call frozen_mpy_batches,x,$(FROZEN_MPY_PY_FILES))
 
 # to build frozen_mpy.c from all .mpy files
 $(BUILD)/frozen_mpy.c: $(FROZEN_MPY_MPY_FILES) $(BUILD)/genhdr/qstrdefs.generated.h
 	@$(ECHO) "GEN $@"
-	$(Q)$(MPY_TOOL) -f -q $(BUILD)/genhdr/qstrdefs.preprocessed.h $(FROZEN_MPY_MPY_FILES) > $@
+	$(Q)$(MPY_TOOL) -f -q $(BUILD)/genhdr/qstrdefs.preprocessed.h $(MPY_TOOL_FLAGS) $(FROZEN_MPY_MPY_FILES) > $@
 endif
 
 ifneq ($(PROG),)
@@ -28,9 +28,433 @@
 
 #if MICROPY_PY_ARRAY
 
+#if MICROPY_PY_ARRAY_OPS
+
+#include "py/binary.h"
+#include "py/objarray.h"
+#include "py/runtime.h"
+
+// The functions below work on anything with the buffer protocol and a numeric
+// typecode.  Elements are loaded a chunk at a time from their typecode into a
+// buffer of array_int_t or mp_float_t, worked on there, and stored to the
+// destination typecode.  So there is one tight loop per typecode for each
+// load and store, rather than a switch per element or a loop per pair of
+// typecodes.  Arithmetic is done in floating point if any operand is.
+
+#define ARRAY_OPS_CHUNK (16)
+#define ARRAY_OPS_MAX_ARGS (3)
+
+typedef long long array_int_t;
+
+#if MICROPY_LONGINT_IMPL != MICROPY_LONGINT_IMPL_NONE
+#define ARRAY_OPS_LONGLONG_CASES(X) X('q', long long) X('Q', unsigned long long)
+#else
+#define ARRAY_OPS_LONGLONG_CASES(X)
+#endif
+
+#define ARRAY_OPS_INT_CASES(X) \
+    X('b', int8_t) X(BYTEARRAY_TYPECODE, uint8_t) X('B', uint8_t) \
+    X('h', int16_t) X('H', uint16_t) X('i', int) X('I', unsigned int) \
+    X('l', long) X('L', unsigned long) ARRAY_OPS_LONGLONG_CASES(X)
+
+#if MICROPY_PY_BUILTINS_FLOAT
+#define ARRAY_OPS_FLOAT_CASES(X) X('f', float) X('d', double)
+#else
+#define ARRAY_OPS_FLOAT_CASES(X)
+#endif
+
+enum {
+    ARRAY_OP_COPY,
+    ARRAY_OP_ADD,
+    ARRAY_OP_SUB,
+    ARRAY_OP_MUL,
+    ARRAY_OP_SCALE,
+    ARRAY_OP_CLIP,
+};
+
+// An array, or a scalar that is broadcast to every element
+typedef struct _array_operand_t {
+    char typecode; // 0 for a scalar
+    bool is_float;
+    void *buf;
+    size_t len;
+    array_int_t ival;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    mp_float_t fval;
+    #endif
+} array_operand_t;
+
+typedef union _array_chunk_t {
+    array_int_t i[ARRAY_OPS_CHUNK];
+    #if MICROPY_PY_BUILTINS_FLOAT
+    mp_float_t f[ARRAY_OPS_CHUNK];
+    #endif
+} array_chunk_t;
+
+STATIC bool array_ops_typecode_is_float(char typecode) {
+    return typecode == 'f' || typecode == 'd';
+}
+
+STATIC void array_ops_check_typecode(char typecode) {
+    switch (typecode) {
+        #define X(tc, T) case tc:
+        ARRAY_OPS_INT_CASES(X)
+        ARRAY_OPS_FLOAT_CASES(X)
+        #undef X
+            return;
+    }
+    mp_raise_ValueError("unsupported typecode");
+}
+
+STATIC void array_ops_get_operand(mp_obj_t obj, array_operand_t *op, bool allow_scalar, mp_uint_t flags) {
+    mp_buffer_info_t bufinfo;
+    if (mp_get_buffer(obj, &bufinfo, flags)) {
+        array_ops_check_typecode(bufinfo.typecode);
+        op->typecode = bufinfo.typecode;
+        op->is_float = array_ops_typecode_is_float(bufinfo.typecode);
+        op->buf = bufinfo.buf;
+        op->len = bufinfo.len / mp_binary_get_size('@', bufinfo.typecode, NULL);
+        return;
+    }
+    if (!allow_scalar) {
+        mp_raise_TypeError("expecting an array");
+    }
+    op->typecode = 0;
+    op->len = 0;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (mp_obj_is_float(obj)) {
+        op->is_float = true;
+        op->fval = mp_obj_get_float(obj);
+        return;
+    }
+    #endif
+    op->is_float = false;
+    op->ival = mp_obj_get_int(obj);
+    #if MICROPY_PY_BUILTINS_FLOAT
+    op->fval = op->ival;
+    #endif
+}
+
+STATIC void array_ops_load_int(const array_operand_t *op, size_t i, size_t n, array_int_t *dst) {
+    switch (op->typecode) {
+        #define X(tc, T) case tc: { \
+            const T *src = (const T*)op->buf + i; \
+            for (size_t k = 0; k < n; ++k) { \
+                dst[k] = src[k]; \
+            } \
+            break; \
+        }
+        ARRAY_OPS_INT_CASES(X)
+        ARRAY_OPS_FLOAT_CASES(X)
+        #undef X
+    }
+}
+
+STATIC void array_ops_store_int(const array_operand_t *op, size_t i, size_t n, const array_int_t *src) {
+    switch (op->typecode) {
+        #define X(tc, T) case tc: { \
+            T *dst = (T*)op->buf + i; \
+            for (size_t k = 0; k < n; ++k) { \
+                dst[k] = src[k]; \
+            } \
+            break; \
+        }
+        ARRAY_OPS_INT_CASES(X)
+        ARRAY_OPS_FLOAT_CASES(X)
+        #undef X
+    }
+}
+
+#if MICROPY_PY_BUILTINS_FLOAT
+STATIC void array_ops_load_float(const array_operand_t *op, size_t i, size_t n, mp_float_t *dst) {
+    switch (op->typecode) {
+        #define X(tc, T) case tc: { \
+            const T *src = (const T*)op->buf + i; \
+            for (size_t k = 0; k < n; ++k) { \
+                dst[k] = src[k]; \
+            } \
+            break; \
+        }
+        ARRAY_OPS_INT_CASES(X)
+        ARRAY_OPS_FLOAT_CASES(X)
+        #undef X
+    }
+}
+
+STATIC void array_ops_store_float(const array_operand_t *op, size_t i, size_t n, const mp_float_t *src) {
+    switch (op->typecode) {
+        #define X(tc, T) case tc: { \
+            T *dst = (T*)op->buf + i; \
+            for (size_t k = 0; k < n; ++k) { \
+                dst[k] = src[k]; \
+            } \
+            break; \
+        }
+        ARRAY_OPS_INT_CASES(X)
+        ARRAY_OPS_FLOAT_CASES(X)
+        #undef X
+    }
+}
+#endif
+
+// The loops of an elementwise operation, on one chunk in either domain
+#define ARRAY_OPS_APPLY(op, t, n, c) do { \
+    switch (op) { \
+        case ARRAY_OP_ADD: \
+            for (size_t k = 0; k < n; ++k) { t[0].c[k] += t[1].c[k]; } \
+            break; \
+        case ARRAY_OP_SUB: \
+            for (size_t k = 0; k < n; ++k) { t[0].c[k] -= t[1].c[k]; } \
+            break; \
+        case ARRAY_OP_MUL: \
+            for (size_t k = 0; k < n; ++k) { t[0].c[k] *= t[1].c[k]; } \
+            break; \
+        case ARRAY_OP_SCALE: \
+            for (size_t k = 0; k < n; ++k) { t[0].c[k] = t[0].c[k] * t[1].c[k] + t[2].c[k]; } \
+            break; \
+        case ARRAY_OP_CLIP: \
+            for (size_t k = 0; k < n; ++k) { \
+                if (t[0].c[k] < t[1].c[k]) { \
+                    t[0].c[k] = t[1].c[k]; \
+                } else if (t[0].c[k] > t[2].c[k]) { \
+                    t[0].c[k] = t[2].c[k]; \
+                } \
+            } \
+            break; \
+    } \
+} while (0)
+
+// Apply op to the n_args arguments elementwise, into out_in if it is not
+// None, or else into a new array of the given typecode (0 for the first
+// argument's)
+STATIC mp_obj_t array_ops_elementwise(int op, size_t n_args, const mp_obj_t *args, mp_obj_t out_in, char typecode) {
+    array_operand_t ops[ARRAY_OPS_MAX_ARGS];
+    array_ops_get_operand(args[0], &ops[0], false, MP_BUFFER_READ);
+    size_t len = ops[0].len;
+    bool is_float = ops[0].is_float;
+    for (size_t j = 1; j < n_args; ++j) {
+        array_ops_get_operand(args[j], &ops[j], true, MP_BUFFER_READ);
+        if (ops[j].typecode != 0 && ops[j].len != len) {
+            mp_raise_ValueError("array lengths differ");
+        }
+        is_float |= ops[j].is_float;
+    }
+
+    if (out_in == mp_const_none) {
+        if (typecode == 0) {
+            typecode = ops[0].typecode;
+        }
+        array_ops_check_typecode(typecode);
+        out_in = mp_obj_new_array(typecode, len);
+    }
+    array_operand_t out;
+    array_ops_get_operand(out_in, &out, false, MP_BUFFER_WRITE);
+    if (out.len != len) {
+        mp_raise_ValueError("array lengths differ");
+    }
+    is_float |= out.is_float;
+
+    // scalars are the same in every chunk, so fill them in once
+    array_chunk_t t[ARRAY_OPS_MAX_ARGS];
+    for (size_t j = 1; j < n_args; ++j) {
+        if (ops[j].typecode == 0) {
+            for (size_t k = 0; k < ARRAY_OPS_CHUNK; ++k) {
+                #if MICROPY_PY_BUILTINS_FLOAT
+                if (is_float) {
+                    t[j].f[k] = ops[j].fval;
+                    continue;
+                }
+                #endif
+                t[j].i[k] = ops[j].ival;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < len; i += ARRAY_OPS_CHUNK) {
+        size_t n = MIN(ARRAY_OPS_CHUNK, len - i);
+        #if MICROPY_PY_BUILTINS_FLOAT
+        if (is_float) {
+            for (size_t j = 0; j < n_args; ++j) {
+                if (ops[j].typecode != 0) {
+                    array_ops_load_float(&ops[j], i, n, t[j].f);
+                }
+            }
+            ARRAY_OPS_APPLY(op, t, n, f);
+            array_ops_store_float(&out, i, n, t[0].f);
+            continue;
+        }
+        #endif
+        for (size_t j = 0; j < n_args; ++j) {
+            if (ops[j].typecode != 0) {
+                array_ops_load_int(&ops[j], i, n, t[j].i);
+            }
+        }
+        ARRAY_OPS_APPLY(op, t, n, i);
+        array_ops_store_int(&out, i, n, t[0].i);
+    }
+    return out_in;
+}
+
+// add(a, b[, out]): a + b elementwise, where b is an array or a number
+STATIC mp_obj_t array_ops_add(size_t n_args, const mp_obj_t *args) {
+    return array_ops_elementwise(ARRAY_OP_ADD, 2, args, n_args > 2 ? args[2] : mp_const_none, 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_ops_add_obj, 2, 3, array_ops_add);
+
+// sub(a, b[, out]): a - b elementwise
+STATIC mp_obj_t array_ops_sub(size_t n_args, const mp_obj_t *args) {
+    return array_ops_elementwise(ARRAY_OP_SUB, 2, args, n_args > 2 ? args[2] : mp_const_none, 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_ops_sub_obj, 2, 3, array_ops_sub);
+
+// mul(a, b[, out]): a * b elementwise
+STATIC mp_obj_t array_ops_mul(size_t n_args, const mp_obj_t *args) {
+    return array_ops_elementwise(ARRAY_OP_MUL, 2, args, n_args > 2 ? args[2] : mp_const_none, 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_ops_mul_obj, 2, 3, array_ops_mul);
+
+// scale(a, k[, offset[, out]]): a * k + offset elementwise
+STATIC mp_obj_t array_ops_scale(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t op_args[3] = {args[0], args[1], n_args > 2 ? args[2] : MP_OBJ_NEW_SMALL_INT(0)};
+    return array_ops_elementwise(ARRAY_OP_SCALE, 3, op_args, n_args > 3 ? args[3] : mp_const_none, 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_ops_scale_obj, 2, 4, array_ops_scale);
+
+// clip(a, lo, hi[, out]): a limited to [lo, hi] elementwise
+STATIC mp_obj_t array_ops_clip(size_t n_args, const mp_obj_t *args) {
+    return array_ops_elementwise(ARRAY_OP_CLIP, 3, args, n_args > 3 ? args[3] : mp_const_none, 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(array_ops_clip_obj, 3, 4, array_ops_clip);
+
+// convert(a, typecode or out): a converted to a new array of the given
+// typecode, or into the given array
+STATIC mp_obj_t array_ops_convert(mp_obj_t a_in, mp_obj_t dest_in) {
+    if (mp_obj_is_str(dest_in)) {
+        size_t len;
+        const char *typecode = mp_obj_str_get_data(dest_in, &len);
+        if (len != 1) {
+            mp_raise_ValueError("unsupported typecode");
+        }
+        return array_ops_elementwise(ARRAY_OP_COPY, 1, &a_in, mp_const_none, typecode[0]);
+    }
+    return array_ops_elementwise(ARRAY_OP_COPY, 1, &a_in, dest_in, 0);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_ops_convert_obj, array_ops_convert);
+
+enum {
+    ARRAY_REDUCE_SUM,
+    ARRAY_REDUCE_MIN,
+    ARRAY_REDUCE_MAX,
+    ARRAY_REDUCE_DOT,
+};
+
+#define ARRAY_OPS_REDUCE(op, t, n, c, acc, first) do { \
+    switch (op) { \
+        case ARRAY_REDUCE_SUM: \
+            for (size_t k = 0; k < n; ++k) { acc += t[0].c[k]; } \
+            break; \
+        case ARRAY_REDUCE_MIN: \
+            if (first) { acc = t[0].c[0]; } \
+            for (size_t k = 0; k < n; ++k) { if (t[0].c[k] < acc) { acc = t[0].c[k]; } } \
+            break; \
+        case ARRAY_REDUCE_MAX: \
+            if (first) { acc = t[0].c[0]; } \
+            for (size_t k = 0; k < n; ++k) { if (t[0].c[k] > acc) { acc = t[0].c[k]; } } \
+            break; \
+        case ARRAY_REDUCE_DOT: \
+            for (size_t k = 0; k < n; ++k) { acc += t[0].c[k] * t[1].c[k]; } \
+            break; \
+    } \
+} while (0)
+
+STATIC mp_obj_t array_ops_reduce(int op, size_t n_args, const mp_obj_t *args) {
+    array_operand_t ops[2];
+    array_ops_get_operand(args[0], &ops[0], false, MP_BUFFER_READ);
+    size_t len = ops[0].len;
+    bool is_float = ops[0].is_float;
+    if (n_args > 1) {
+        array_ops_get_operand(args[1], &ops[1], false, MP_BUFFER_READ);
+        if (ops[1].len != len) {
+            mp_raise_ValueError("array lengths differ");
+        }
+        is_float |= ops[1].is_float;
+    }
+    if (len == 0 && (op == ARRAY_REDUCE_MIN || op == ARRAY_REDUCE_MAX)) {
+        mp_raise_ValueError("empty array");
+    }
+
+    array_chunk_t t[2];
+    array_int_t iacc = 0;
+    #if MICROPY_PY_BUILTINS_FLOAT
+    mp_float_t facc = 0;
+    #endif
+    for (size_t i = 0; i < len; i += ARRAY_OPS_CHUNK) {
+        size_t n = MIN(ARRAY_OPS_CHUNK, len - i);
+        #if MICROPY_PY_BUILTINS_FLOAT
+        if (is_float) {
+            for (size_t j = 0; j < n_args; ++j) {
+                array_ops_load_float(&ops[j], i, n, t[j].f);
+            }
+            ARRAY_OPS_REDUCE(op, t, n, f, facc, i == 0);
+            continue;
+        }
+        #endif
+        for (size_t j = 0; j < n_args; ++j) {
+            array_ops_load_int(&ops[j], i, n, t[j].i);
+        }
+        ARRAY_OPS_REDUCE(op, t, n, i, iacc, i == 0);
+    }
+
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (is_float) {
+        return mp_obj_new_float(facc);
+    }
+    #endif
+    return mp_obj_new_int_from_ll(iacc);
+}
+
+// sum(a): the sum of the elements
+STATIC mp_obj_t array_ops_sum(mp_obj_t a_in) {
+    return array_ops_reduce(ARRAY_REDUCE_SUM, 1, &a_in);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_ops_sum_obj, array_ops_sum);
+
+// min(a): the smallest element
+STATIC mp_obj_t array_ops_min(mp_obj_t a_in) {
+    return array_ops_reduce(ARRAY_REDUCE_MIN, 1, &a_in);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_ops_min_obj, array_ops_min);
+
+// max(a): the largest element
+STATIC mp_obj_t array_ops_max(mp_obj_t a_in) {
+    return array_ops_reduce(ARRAY_REDUCE_MAX, 1, &a_in);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(array_ops_max_obj, array_ops_max);
+
+// dot(a, b): the sum of the products of the elements
+STATIC mp_obj_t array_ops_dot(mp_obj_t a_in, mp_obj_t b_in) {
+    mp_obj_t args[2] = {a_in, b_in};
+    return array_ops_reduce(ARRAY_REDUCE_DOT, 2, args);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(array_ops_dot_obj, array_ops_dot);
+
+#endif // MICROPY_PY_ARRAY_OPS
+
 STATIC const mp_rom_map_elem_t mp_module_array_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_array) },
     { MP_ROM_QSTR(MP_QSTR_array), MP_ROM_PTR(&mp_type_array) },
+    #if MICROPY_PY_ARRAY_OPS
+    { MP_ROM_QSTR(MP_QSTR_add), MP_ROM_PTR(&array_ops_add_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sub), MP_ROM_PTR(&array_ops_sub_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mul), MP_ROM_PTR(&array_ops_mul_obj) },
+    { MP_ROM_QSTR(MP_QSTR_scale), MP_ROM_PTR(&array_ops_scale_obj) },
+    { MP_ROM_QSTR(MP_QSTR_clip), MP_ROM_PTR(&array_ops_clip_obj) },
+    { MP_ROM_QSTR(MP_QSTR_convert), MP_ROM_PTR(&array_ops_convert_obj) },
+    { MP_ROM_QSTR(MP_QSTR_sum), MP_ROM_PTR(&array_ops_sum_obj) },
+    { MP_ROM_QSTR(MP_QSTR_min), MP_ROM_PTR(&array_ops_min_obj) },
+    { MP_ROM_QSTR(MP_QSTR_max), MP_ROM_PTR(&array_ops_max_obj) },
+    { MP_ROM_QSTR(MP_QSTR_dot), MP_ROM_PTR(&array_ops_dot_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_array_globals, mp_module_array_globals_table);
@@ -27,9 +27,38 @@
 #include "py/mpstate.h"
 #include "py/obj.h"
 #include "py/gc.h"
+#include "py/mphal.h"
+#include "py/bc.h"
 
 #if MICROPY_PY_GC && MICROPY_ENABLE_GC
 
+#if MICROPY_GC_INCREMENTAL_SWEEP
+// collect([budget_us]): run a garbage collection; with a budget, start a
+// collection that only marks if none is being swept and then sweep for at
+// most about budget_us, returning True once the sweep is complete
+STATIC mp_obj_t py_gc_collect(size_t n_args, const mp_obj_t *args) {
+    if (n_args > 0) {
+        mp_uint_t budget = mp_obj_get_int(args[0]);
+        mp_uint_t start = mp_hal_ticks_us();
+        if (gc_sweep_step(0)) {
+            gc_sweep_defer();
+            gc_collect();
+        }
+        bool done;
+        while (!(done = gc_sweep_step(MICROPY_GC_SWEEP_STEP))
+            && mp_hal_ticks_us() - start < budget) {
+        }
+        return mp_obj_new_bool(done);
+    }
+    gc_collect();
+#if MICROPY_PY_GC_COLLECT_RETVAL
+    return MP_OBJ_NEW_SMALL_INT(MP_STATE_MEM(gc_collected));
+#else
+    return mp_const_none;
+#endif
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_collect_obj, 0, 1, py_gc_collect);
+#else
 // collect(): run a garbage collection
 STATIC mp_obj_t py_gc_collect(void) {
     gc_collect();
@@ -40,6 +69,7 @@ STATIC mp_obj_t py_gc_collect(void) {
 #endif
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_collect_obj, py_gc_collect);
+#endif
 
 // disable(): disable the garbage collector
 STATIC mp_obj_t gc_disable(void) {
@@ -76,6 +106,29 @@ STATIC mp_obj_t gc_mem_alloc(void) {
 }
 MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_alloc_obj, gc_mem_alloc);
 
+#if MICROPY_GC_MEM_PEAK
+// mem_peak(): return the most bytes of heap RAM allocated at once since
+// start up or reset_peak()
+STATIC mp_obj_t gc_mem_peak(void) {
+    return mp_obj_new_int_from_uint(MP_STATE_MEM(gc_peak_blocks) * MICROPY_BYTES_PER_GC_BLOCK);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_peak_obj, gc_mem_peak);
+
+// mem_total(): return the number of bytes allocated since start up or
+// reset_peak(), including memory since freed
+STATIC mp_obj_t gc_mem_total(void) {
+    return mp_obj_new_int_from_uint(MP_STATE_MEM(gc_total_blocks) * MICROPY_BYTES_PER_GC_BLOCK);
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_mem_total_obj, gc_mem_total);
+
+// reset_peak(): restart mem_peak() from the current use and mem_total() from 0
+STATIC mp_obj_t gc_reset_peak_(void) {
+    gc_reset_peak();
+    return mp_const_none;
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_reset_peak_obj, gc_reset_peak_);
+#endif
+
 #if MICROPY_GC_ALLOC_THRESHOLD
 STATIC mp_obj_t gc_threshold(size_t n_args, const mp_obj_t *args) {
     if (n_args == 0) {
@@ -95,6 +148,63 @@ STATIC mp_obj_t gc_threshold(size_t n_args, const mp_obj_t *args) {
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_threshold_obj, 0, 1, gc_threshold);
 #endif
 
+#if MICROPY_GC_PROFILE
+// profile([clear]): return a list of (file, line, function, count, bytes)
+// for the allocations made at each bytecode location, with the ones made
+// elsewhere under (None, 0, None, ...); optionally clear the counts after
+STATIC mp_obj_t gc_profile(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < MICROPY_GC_PROFILE_SITES; i++) {
+        const mp_gc_profile_site_t *site = &MP_STATE_VM(gc_profile_sites)[i];
+        if (site->bytecode == NULL) {
+            continue;
+        }
+        qstr block_name, source_file;
+        size_t line = mp_bytecode_get_source_line(site->bytecode, site->ip, &block_name, &source_file);
+        mp_obj_t t[5] = {
+            MP_OBJ_NEW_QSTR(source_file),
+            MP_OBJ_NEW_SMALL_INT(line),
+            MP_OBJ_NEW_QSTR(block_name),
+            mp_obj_new_int_from_uint(site->count),
+            mp_obj_new_int_from_uint(site->bytes),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(5, t));
+    }
+    mp_obj_t t[5] = {
+        mp_const_none,
+        MP_OBJ_NEW_SMALL_INT(0),
+        mp_const_none,
+        mp_obj_new_int_from_uint(MP_STATE_MEM(gc_profile_other_count)),
+        mp_obj_new_int_from_uint(MP_STATE_MEM(gc_profile_other_bytes)),
+    };
+    mp_obj_list_append(list, mp_obj_new_tuple(5, t));
+    if (n_args > 0 && mp_obj_is_true(args[0])) {
+        gc_profile_clear();
+    }
+    return list;
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(gc_profile_obj, 0, 1, gc_profile);
+
+// snapshot(): return the layout of the heap as bytes, for tools/gcsnapshot.py
+STATIC mp_obj_t gc_snapshot_(void) {
+    size_t len = gc_snapshot(NULL, 0);
+    for (;;) {
+        // leave room for the buffer itself and anything allocated meanwhile
+        len += len / 8 + 16;
+        vstr_t vstr;
+        vstr_init_len(&vstr, len);
+        size_t n = gc_snapshot((byte*)vstr.buf, len);
+        if (n <= len) {
+            vstr.len = n;
+            return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+        }
+        vstr_clear(&vstr);
+        len = n;
+    }
+}
+MP_DEFINE_CONST_FUN_OBJ_0(gc_snapshot_obj, gc_snapshot_);
+#endif
+
 STATIC const mp_rom_map_elem_t mp_module_gc_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_gc) },
     { MP_ROM_QSTR(MP_QSTR_collect), MP_ROM_PTR(&gc_collect_obj) },
@@ -103,9 +213,18 @@ STATIC const mp_rom_map_elem_t mp_module_gc_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_isenabled), MP_ROM_PTR(&gc_isenabled_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem_free), MP_ROM_PTR(&gc_mem_free_obj) },
     { MP_ROM_QSTR(MP_QSTR_mem_alloc), MP_ROM_PTR(&gc_mem_alloc_obj) },
+    #if MICROPY_GC_MEM_PEAK
+    { MP_ROM_QSTR(MP_QSTR_mem_peak), MP_ROM_PTR(&gc_mem_peak_obj) },
+    { MP_ROM_QSTR(MP_QSTR_mem_total), MP_ROM_PTR(&gc_mem_total_obj) },
+    { MP_ROM_QSTR(MP_QSTR_reset_peak), MP_ROM_PTR(&gc_reset_peak_obj) },
+    #endif
     #if MICROPY_GC_ALLOC_THRESHOLD
     { MP_ROM_QSTR(MP_QSTR_threshold), MP_ROM_PTR(&gc_threshold_obj) },
     #endif
+    #if MICROPY_GC_PROFILE
+    { MP_ROM_QSTR(MP_QSTR_profile), MP_ROM_PTR(&gc_profile_obj) },
+    { MP_ROM_QSTR(MP_QSTR_snapshot), MP_ROM_PTR(&gc_snapshot_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_gc_globals, mp_module_gc_globals_table);
@@ -296,6 +296,142 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_math_factorial_obj, mp_math_factorial);
 
 #endif
 
+#if MICROPY_PY_MATH_ARRAY
+
+// Batched variants operating elementwise on arrays of typecode 'f' or 'd',
+// storing into a writable array of the same length.  Samples are never
+// boxed, and out-of-domain inputs give nan rather than raising.
+
+STATIC size_t math_get_array(mp_obj_t o, mp_buffer_info_t *bufinfo, mp_uint_t flags, size_t n) {
+    mp_get_buffer_raise(o, bufinfo, flags);
+    size_t sz;
+    if (bufinfo->typecode == 'f') {
+        sz = sizeof(float);
+    } else if (bufinfo->typecode == 'd') {
+        sz = sizeof(double);
+    } else {
+        mp_raise_TypeError("array must be 'f' or 'd'");
+    }
+    size_t len = bufinfo->len / sz;
+    if (n != (size_t)-1 && len != n) {
+        mp_raise_ValueError("arrays must have the same length");
+    }
+    return len;
+}
+
+STATIC inline mp_float_t math_array_get(const mp_buffer_info_t *bufinfo, size_t i) {
+    if (bufinfo->typecode == 'f') {
+        return ((float*)bufinfo->buf)[i];
+    } else {
+        return ((double*)bufinfo->buf)[i];
+    }
+}
+
+STATIC inline void math_array_set(const mp_buffer_info_t *bufinfo, size_t i, mp_float_t val) {
+    if (bufinfo->typecode == 'f') {
+        ((float*)bufinfo->buf)[i] = val;
+    } else {
+        ((double*)bufinfo->buf)[i] = val;
+    }
+}
+
+STATIC mp_obj_t math_array_1(mp_obj_t x_obj, mp_obj_t out_obj, mp_float_t (*f)(mp_float_t)) {
+    mp_buffer_info_t out, x;
+    size_t n = math_get_array(out_obj, &out, MP_BUFFER_WRITE, -1);
+    math_get_array(x_obj, &x, MP_BUFFER_READ, n);
+    for (size_t i = 0; i < n; ++i) {
+        math_array_set(&out, i, f(math_array_get(&x, i)));
+    }
+    return out_obj;
+}
+
+STATIC mp_obj_t math_array_2(mp_obj_t x_obj, mp_obj_t y_obj, mp_obj_t out_obj, mp_float_t (*f)(mp_float_t, mp_float_t)) {
+    mp_buffer_info_t out, x, y;
+    size_t n = math_get_array(out_obj, &out, MP_BUFFER_WRITE, -1);
+    math_get_array(x_obj, &x, MP_BUFFER_READ, n);
+    math_get_array(y_obj, &y, MP_BUFFER_READ, n);
+    for (size_t i = 0; i < n; ++i) {
+        math_array_set(&out, i, f(math_array_get(&x, i), math_array_get(&y, i)));
+    }
+    return out_obj;
+}
+
+// Not all libm's provide hypot, and sensor values don't need its care
+// over intermediate overflow
+STATIC mp_float_t math_hypot(mp_float_t x, mp_float_t y) {
+    return MICROPY_FLOAT_C_FUN(sqrt)(x * x + y * y);
+}
+
+// sqrt_array(x, out)
+STATIC mp_obj_t mp_math_sqrt_array(mp_obj_t x_obj, mp_obj_t out_obj) {
+    return math_array_1(x_obj, out_obj, MICROPY_FLOAT_C_FUN(sqrt));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mp_math_sqrt_array_obj, mp_math_sqrt_array);
+
+// atan2_array(y, x, out)
+STATIC mp_obj_t mp_math_atan2_array(mp_obj_t y_obj, mp_obj_t x_obj, mp_obj_t out_obj) {
+    return math_array_2(y_obj, x_obj, out_obj, MICROPY_FLOAT_C_FUN(atan2));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mp_math_atan2_array_obj, mp_math_atan2_array);
+
+// hypot_array(x, y, out)
+STATIC mp_obj_t mp_math_hypot_array(mp_obj_t x_obj, mp_obj_t y_obj, mp_obj_t out_obj) {
+    return math_array_2(x_obj, y_obj, out_obj, math_hypot);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_3(mp_math_hypot_array_obj, mp_math_hypot_array);
+
+// A 3-vector is a tuple or list, or any other sequence such as an array
+STATIC void math_get_vector3(mp_obj_t v_obj, mp_float_t *v) {
+    if (mp_obj_is_type(v_obj, &mp_type_tuple) || mp_obj_is_type(v_obj, &mp_type_list)) {
+        mp_obj_t *items;
+        mp_obj_get_array_fixed_n(v_obj, 3, &items);
+        for (size_t i = 0; i < 3; ++i) {
+            v[i] = mp_obj_get_float(items[i]);
+        }
+    } else {
+        if (mp_obj_get_int(mp_obj_len(v_obj)) != 3) {
+            mp_raise_ValueError("expected a 3-vector");
+        }
+        for (size_t i = 0; i < 3; ++i) {
+            v[i] = mp_obj_get_float(mp_obj_subscr(v_obj, MP_OBJ_NEW_SMALL_INT(i), MP_OBJ_SENTINEL));
+        }
+    }
+}
+
+// norm3(v): the length of the 3-vector v
+STATIC mp_obj_t mp_math_norm3(mp_obj_t v_obj) {
+    mp_float_t v[3];
+    math_get_vector3(v_obj, v);
+    return mp_obj_new_float(MICROPY_FLOAT_C_FUN(sqrt)(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_math_norm3_obj, mp_math_norm3);
+
+// tilt_heading(accel, mag): compass heading in degrees [0, 360) from a
+// magnetometer reading, compensated for the tilt given by the accelerometer
+STATIC mp_obj_t mp_math_tilt_heading(mp_obj_t accel_obj, mp_obj_t mag_obj) {
+    mp_float_t a[3], m[3];
+    math_get_vector3(accel_obj, a);
+    math_get_vector3(mag_obj, m);
+    mp_float_t phi = MICROPY_FLOAT_C_FUN(atan)(a[1] / a[2]);
+    mp_float_t sin_phi = MICROPY_FLOAT_C_FUN(sin)(phi);
+    mp_float_t cos_phi = MICROPY_FLOAT_C_FUN(cos)(phi);
+    mp_float_t psi = MICROPY_FLOAT_C_FUN(atan)(-a[0] / (a[1] * sin_phi + a[2] * cos_phi));
+    mp_float_t sin_psi = MICROPY_FLOAT_C_FUN(sin)(psi);
+    mp_float_t cos_psi = MICROPY_FLOAT_C_FUN(cos)(psi);
+    mp_float_t theta = MICROPY_FLOAT_C_FUN(atan)((m[2] * sin_phi - m[1] * cos_phi)
+        / (m[0] * cos_psi + m[1] * sin_psi * sin_phi + m[2] * sin_psi * cos_phi));
+    mp_float_t head = theta * (MICROPY_FLOAT_CONST(180.0) / MP_PI);
+    head += m[0] < 0 ? MICROPY_FLOAT_CONST(-90.0) : MICROPY_FLOAT_CONST(90.0);
+    head = MICROPY_FLOAT_C_FUN(fmod)(head, MICROPY_FLOAT_CONST(360.0));
+    if (head < 0) {
+        head += MICROPY_FLOAT_CONST(360.0);
+    }
+    return mp_obj_new_float(head);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(mp_math_tilt_heading_obj, mp_math_tilt_heading);
+
+#endif
+
 STATIC const mp_rom_map_elem_t mp_module_math_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_math) },
     { MP_ROM_QSTR(MP_QSTR_e), mp_const_float_e },
@@ -347,6 +483,13 @@ STATIC const mp_rom_map_elem_t mp_module_math_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_gamma), MP_ROM_PTR(&mp_math_gamma_obj) },
     { MP_ROM_QSTR(MP_QSTR_lgamma), MP_ROM_PTR(&mp_math_lgamma_obj) },
     #endif
+    #if MICROPY_PY_MATH_ARRAY
+    { MP_ROM_QSTR(MP_QSTR_sqrt_array), MP_ROM_PTR(&mp_math_sqrt_array_obj) },
+    { MP_ROM_QSTR(MP_QSTR_atan2_array), MP_ROM_PTR(&mp_math_atan2_array_obj) },
+    { MP_ROM_QSTR(MP_QSTR_hypot_array), MP_ROM_PTR(&mp_math_hypot_array_obj) },
+    { MP_ROM_QSTR(MP_QSTR_norm3), MP_ROM_PTR(&mp_math_norm3_obj) },
+    { MP_ROM_QSTR(MP_QSTR_tilt_heading), MP_ROM_PTR(&mp_math_tilt_heading_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_math_globals, mp_module_math_globals_table);
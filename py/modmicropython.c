@@ -25,12 +25,14 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 
 #include "py/builtin.h"
 #include "py/stackctrl.h"
 #include "py/runtime.h"
 #include "py/gc.h"
 #include "py/mphal.h"
+#include "py/bc.h"
 
 // Various builtins specific to MicroPython runtime,
 // living in micropython module
@@ -47,6 +49,29 @@ STATIC mp_obj_t mp_micropython_opt_level(size_t n_args, const mp_obj_t *args) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_opt_level_obj, 0, 1, mp_micropython_opt_level);
 #endif
 
+#if MICROPY_OPT_TIERED_NATIVE
+// tier_native([calls[, budget]]): make functions native after this many calls
+// (0 to stop), generating at most budget bytes of native code from now on;
+// with no args return the current (calls, budget)
+STATIC mp_obj_t mp_micropython_tier_native(size_t n_args, const mp_obj_t *args) {
+    if (n_args == 0) {
+        mp_obj_t t[2] = {
+            MP_OBJ_NEW_SMALL_INT(MP_STATE_VM(tier_native_calls)),
+            mp_obj_new_int_from_uint(MP_STATE_VM(tier_native_budget)),
+        };
+        return mp_obj_new_tuple(2, t);
+    }
+    mp_int_t calls = mp_obj_get_int(args[0]);
+    if (calls < 0 || calls > 0xffff) {
+        mp_raise_ValueError(NULL);
+    }
+    MP_STATE_VM(tier_native_calls) = calls;
+    MP_STATE_VM(tier_native_budget) = n_args > 1 ? (size_t)mp_obj_get_int(args[1]) : 16384;
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_tier_native_obj, 0, 2, mp_micropython_tier_native);
+#endif
+
 #if MICROPY_PY_MICROPYTHON_MEM_INFO
 
 #if MICROPY_MEM_STATS
@@ -148,13 +173,223 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(mp_micropython_kbd_intr_obj, mp_micropython_kbd
 #endif
 
 #if MICROPY_ENABLE_SCHEDULER
-STATIC mp_obj_t mp_micropython_schedule(mp_obj_t function, mp_obj_t arg) {
-    if (!mp_sched_schedule(function, arg)) {
-        mp_raise_msg(&mp_type_RuntimeError, "schedule stack full");
+STATIC mp_obj_t mp_micropython_schedule(size_t n_args, const mp_obj_t *args) {
+    int prio = MP_SCHED_PRIO_NORMAL;
+    if (n_args > 2 && mp_obj_is_true(args[2])) {
+        prio = MP_SCHED_PRIO_HIGH;
+    }
+    if (!mp_sched_schedule_prio(args[0], args[1], prio)) {
+        mp_raise_msg(&mp_type_RuntimeError, "schedule queue full");
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_schedule_obj, 2, 3, mp_micropython_schedule);
+
+#if MICROPY_SCHEDULER_STATS
+// Return (max_pending, [(func, scheduled, dropped), ...]) and optionally
+// clear the counts; func is None for the entry that counts all the others
+STATIC mp_obj_t mp_micropython_sched_stats(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    mp_sched_stats_t stats[MICROPY_SCHEDULER_STATS];
+    memcpy(stats, MP_STATE_VM(sched_stats), sizeof(stats));
+    mp_obj_t max_len = MP_OBJ_NEW_SMALL_INT(MP_STATE_VM(sched_max_len));
+    if (n_args > 0 && mp_obj_is_true(args[0])) {
+        memset(MP_STATE_VM(sched_stats), 0, sizeof(stats));
+        MP_STATE_VM(sched_max_len) = 0;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    for (size_t i = 0; i < MICROPY_SCHEDULER_STATS; ++i) {
+        if (stats[i].scheduled == 0) {
+            continue;
+        }
+        mp_obj_t tuple[3] = {
+            stats[i].func == MP_OBJ_NULL ? mp_const_none : stats[i].func,
+            mp_obj_new_int_from_uint(stats[i].scheduled),
+            mp_obj_new_int_from_uint(stats[i].dropped),
+        };
+        mp_obj_list_append(list, mp_obj_new_tuple(3, tuple));
+    }
+    mp_obj_t tuple[2] = {max_len, list};
+    return mp_obj_new_tuple(2, tuple);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_sched_stats_obj, 0, 1, mp_micropython_sched_stats);
+#endif
+#endif
+
+#if MICROPY_PY_MICROPYTHON_STATS
+STATIC void mp_micropython_stats_store(mp_obj_t dict, qstr key, mp_obj_t value) {
+    mp_obj_dict_store(dict, MP_OBJ_NEW_QSTR(key), value);
+}
+
+// stats([reset]): return a dict of the runtime counters, and optionally
+// reset them after
+STATIC mp_obj_t mp_micropython_stats(size_t n_args, const mp_obj_t *args) {
+    bool reset = n_args > 0 && mp_obj_is_true(args[0]);
+    mp_obj_t dict = mp_obj_new_dict(0);
+    #if MICROPY_VM_COUNT_OPCODES
+    mp_micropython_stats_store(dict, MP_QSTR_bytecodes, mp_obj_new_int_from_ull(MP_STATE_VM(vm_opcode_count)));
+    #endif
+    mp_micropython_stats_store(dict, MP_QSTR_gc_collections, mp_obj_new_int_from_uint(MP_STATE_MEM(gc_collections)));
+    mp_micropython_stats_store(dict, MP_QSTR_gc_pause_us, mp_obj_new_int_from_ull(MP_STATE_MEM(gc_pause_us)));
+    mp_micropython_stats_store(dict, MP_QSTR_gc_pause_max_us, mp_obj_new_int_from_uint(MP_STATE_MEM(gc_pause_max_us)));
+    mp_micropython_stats_store(dict, MP_QSTR_alloc_count, mp_obj_new_int_from_uint(MP_STATE_MEM(gc_alloc_count)));
+    mp_micropython_stats_store(dict, MP_QSTR_alloc_bytes, mp_obj_new_int_from_ull(MP_STATE_MEM(gc_alloc_bytes)));
+    #if MICROPY_ENABLE_SCHEDULER
+    mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    mp_uint_t sched_max_len = MP_STATE_VM(sched_max_len);
+    mp_uint_t sched_dropped = MP_STATE_VM(sched_dropped);
+    mp_uint_t sched_latency = MP_STATE_VM(sched_latency_max_us);
+    if (reset) {
+        MP_STATE_VM(sched_max_len) = 0;
+        MP_STATE_VM(sched_dropped) = 0;
+        MP_STATE_VM(sched_latency_max_us) = 0;
+    }
+    MICROPY_END_ATOMIC_SECTION(atomic_state);
+    mp_micropython_stats_store(dict, MP_QSTR_sched_max_depth, MP_OBJ_NEW_SMALL_INT(sched_max_len));
+    mp_micropython_stats_store(dict, MP_QSTR_sched_dropped, mp_obj_new_int_from_uint(sched_dropped));
+    mp_micropython_stats_store(dict, MP_QSTR_sched_latency_max_us, mp_obj_new_int_from_uint(sched_latency));
+    #endif
+    if (reset) {
+        #if MICROPY_VM_COUNT_OPCODES
+        MP_STATE_VM(vm_opcode_count) = 0;
+        #endif
+        MP_STATE_MEM(gc_collections) = 0;
+        MP_STATE_MEM(gc_pause_us) = 0;
+        MP_STATE_MEM(gc_pause_max_us) = 0;
+        MP_STATE_MEM(gc_alloc_count) = 0;
+        MP_STATE_MEM(gc_alloc_bytes) = 0;
+    }
+    return dict;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_stats_obj, 0, 1, mp_micropython_stats);
+#endif
+
+#if MICROPY_PROF_SAMPLES
+// profile([clear]): return a list of (file, line, function, count) for the
+// profiler samples taken at each line, with the ones taken outside bytecode
+// under (None, 0, None, count); optionally clear the samples after
+STATIC mp_obj_t mp_micropython_profile(size_t n_args, const mp_obj_t *args) {
+    mp_obj_t counts = mp_obj_new_dict(0);
+    mp_uint_t other = 0;
+    for (size_t i = 0; i < MP_STATE_VM(prof_sample_len); i++) {
+        // take a copy, as the profiler may overwrite the entry meanwhile
+        mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+        mp_prof_sample_t sample = MP_STATE_VM(prof_samples)[i];
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        if (sample.bytecode == NULL) {
+            other += 1;
+            continue;
+        }
+        qstr block_name, source_file;
+        size_t line = mp_bytecode_get_source_line(sample.bytecode, sample.ip, &block_name, &source_file);
+        mp_obj_t t[3] = {
+            MP_OBJ_NEW_QSTR(source_file),
+            MP_OBJ_NEW_SMALL_INT(line),
+            MP_OBJ_NEW_QSTR(block_name),
+        };
+        mp_map_elem_t *elem = mp_map_lookup(mp_obj_dict_get_map(counts),
+            mp_obj_new_tuple(3, t), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+        if (elem->value == MP_OBJ_NULL) {
+            elem->value = MP_OBJ_NEW_SMALL_INT(1);
+        } else {
+            elem->value = MP_OBJ_NEW_SMALL_INT(MP_OBJ_SMALL_INT_VALUE(elem->value) + 1);
+        }
+    }
+    if (n_args > 0 && mp_obj_is_true(args[0])) {
+        mp_prof_clear();
+    }
+
+    mp_map_t *map = mp_obj_dict_get_map(counts);
+    mp_obj_t list = mp_obj_new_list(0, NULL);
+    for (size_t i = 0; i < map->alloc; i++) {
+        if (MP_MAP_SLOT_IS_FILLED(map, i)) {
+            size_t len;
+            mp_obj_t *key;
+            mp_obj_tuple_get(map->table[i].key, &len, &key);
+            mp_obj_t t[4] = { key[0], key[1], key[2], map->table[i].value };
+            mp_obj_list_append(list, mp_obj_new_tuple(4, t));
+        }
+    }
+    mp_obj_t t[4] = {
+        mp_const_none,
+        MP_OBJ_NEW_SMALL_INT(0),
+        mp_const_none,
+        mp_obj_new_int_from_uint(other),
+    };
+    mp_obj_list_append(list, mp_obj_new_tuple(4, t));
+    return list;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_micropython_profile_obj, 0, 1, mp_micropython_profile);
+#endif
+
+#if MICROPY_GC_ARENA
+// arena(size): a context manager that makes the allocations of this thread
+// bump through a region of size bytes while it is active. Nothing in the
+// region is freed on its own; the region goes back to the heap as a whole
+// at the first collection after the block exits. Objects from it that are
+// still referenced then become ordinary heap objects.
+typedef struct _mp_obj_arena_t {
+    mp_obj_base_t base;
+    size_t n_bytes;
+    void *map;
+    void *prev;
+} mp_obj_arena_t;
+
+STATIC mp_obj_t arena_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    mp_int_t n_bytes = mp_obj_get_int(args[0]);
+    if (n_bytes <= 0) {
+        mp_raise_ValueError(NULL);
+    }
+    mp_obj_arena_t *self = m_new_obj(mp_obj_arena_t);
+    self->base.type = type;
+    self->n_bytes = n_bytes;
+    self->map = NULL;
+    self->prev = NULL;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_obj_t arena___enter__(mp_obj_t self_in) {
+    mp_obj_arena_t *self = MP_OBJ_TO_PTR(self_in);
+    if (self->map != NULL) {
+        mp_raise_ValueError("arena in use");
+    }
+
+    // without room for the arena the block just allocates from the heap
+    self->map = gc_arena_new(self->n_bytes);
+    if (self->map != NULL) {
+        self->prev = gc_arena_activate(self->map);
+    }
+    return self_in;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(arena___enter___obj, arena___enter__);
+
+STATIC mp_obj_t arena___exit__(size_t n_args, const mp_obj_t *args) {
+    (void)n_args;
+    mp_obj_arena_t *self = MP_OBJ_TO_PTR(args[0]);
+    if (self->map != NULL) {
+        gc_arena_activate(self->prev);
+        gc_arena_close(self->map);
+        self->map = NULL;
+        self->prev = NULL;
     }
     return mp_const_none;
 }
-STATIC MP_DEFINE_CONST_FUN_OBJ_2(mp_micropython_schedule_obj, mp_micropython_schedule);
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(arena___exit___obj, 4, 4, arena___exit__);
+
+STATIC const mp_rom_map_elem_t arena_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR___enter__), MP_ROM_PTR(&arena___enter___obj) },
+    { MP_ROM_QSTR(MP_QSTR___exit__), MP_ROM_PTR(&arena___exit___obj) },
+};
+STATIC MP_DEFINE_CONST_DICT(arena_locals_dict, arena_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_arena = {
+    { &mp_type_type },
+    .name = MP_QSTR_arena,
+    .make_new = arena_make_new,
+    .locals_dict = (mp_obj_dict_t*)&arena_locals_dict,
+};
 #endif
 
 STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
@@ -163,6 +398,9 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     #if MICROPY_ENABLE_COMPILER
     { MP_ROM_QSTR(MP_QSTR_opt_level), MP_ROM_PTR(&mp_micropython_opt_level_obj) },
     #endif
+    #if MICROPY_OPT_TIERED_NATIVE
+    { MP_ROM_QSTR(MP_QSTR_tier_native), MP_ROM_PTR(&mp_micropython_tier_native_obj) },
+    #endif
 #if MICROPY_PY_MICROPYTHON_MEM_INFO
 #if MICROPY_MEM_STATS
     { MP_ROM_QSTR(MP_QSTR_mem_total), MP_ROM_PTR(&mp_micropython_mem_total_obj) },
@@ -190,6 +428,18 @@ STATIC const mp_rom_map_elem_t mp_module_micropython_globals_table[] = {
     #endif
     #if MICROPY_ENABLE_SCHEDULER
     { MP_ROM_QSTR(MP_QSTR_schedule), MP_ROM_PTR(&mp_micropython_schedule_obj) },
+    #if MICROPY_SCHEDULER_STATS
+    { MP_ROM_QSTR(MP_QSTR_sched_stats), MP_ROM_PTR(&mp_micropython_sched_stats_obj) },
+    #endif
+    #endif
+    #if MICROPY_PROF_SAMPLES
+    { MP_ROM_QSTR(MP_QSTR_profile), MP_ROM_PTR(&mp_micropython_profile_obj) },
+    #endif
+    #if MICROPY_PY_MICROPYTHON_STATS
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&mp_micropython_stats_obj) },
+    #endif
+    #if MICROPY_GC_ARENA
+    { MP_ROM_QSTR(MP_QSTR_arena), MP_ROM_PTR(&mp_type_arena) },
     #endif
 };
 
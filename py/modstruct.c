@@ -31,6 +31,7 @@
 #include "py/runtime.h"
 #include "py/builtin.h"
 #include "py/objtuple.h"
+#include "py/objlist.h"
 #include "py/binary.h"
 #include "py/parsenum.h"
 
@@ -248,6 +249,229 @@ STATIC mp_obj_t struct_pack_into(size_t n_args, const mp_obj_t *args) {
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_pack_into);
 
+#if MICROPY_PY_STRUCT_STRUCT
+
+// A Struct holds its format parsed into a table of fields, so that packing
+// and unpacking do not parse the format string or calculate its size again
+
+typedef struct _struct_field_t {
+    char type;
+    size_t cnt; // repeat count, or the length for 's'
+} struct_field_t;
+
+typedef struct _mp_obj_struct_t {
+    mp_obj_base_t base;
+    mp_obj_t format;
+    char fmt_type;
+    size_t size;
+    size_t n_items;
+    size_t n_fields;
+    struct_field_t fields[];
+} mp_obj_struct_t;
+
+STATIC mp_obj_t struct_obj_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    mp_arg_check_num(n_args, n_kw, 1, 1, false);
+    const char *fmt = mp_obj_str_get_str(args[0]);
+    size_t size;
+    size_t n_items = calc_size_items(fmt, &size);
+
+    const char *f = fmt;
+    char fmt_type = get_fmt_type(&f);
+    size_t n_fields = 0;
+    for (; *f; f++) {
+        if (unichar_isdigit(*f)) {
+            get_fmt_num(&f);
+        }
+        n_fields++;
+    }
+
+    mp_obj_struct_t *o = m_new_obj_var(mp_obj_struct_t, struct_field_t, n_fields);
+    o->base.type = type;
+    o->format = args[0];
+    o->fmt_type = fmt_type;
+    o->size = size;
+    o->n_items = n_items;
+    o->n_fields = n_fields;
+    f = fmt;
+    get_fmt_type(&f);
+    for (size_t i = 0; *f; f++, i++) {
+        mp_uint_t cnt = 1;
+        if (unichar_isdigit(*f)) {
+            cnt = get_fmt_num(&f);
+        }
+        o->fields[i].type = *f;
+        o->fields[i].cnt = cnt;
+    }
+    return MP_OBJ_FROM_PTR(o);
+}
+
+STATIC byte *struct_obj_get_buf(mp_obj_t buf_in, mp_int_t offset, size_t size, mp_uint_t flags) {
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(buf_in, &bufinfo, flags);
+    if (offset < 0) {
+        // negative offsets are relative to the end of the buffer
+        offset = (mp_int_t)bufinfo.len + offset;
+        if (offset < 0) {
+            mp_raise_ValueError("buffer too small");
+        }
+    }
+    if ((size_t)offset + size > bufinfo.len) {
+        mp_raise_ValueError("buffer too small");
+    }
+    return (byte*)bufinfo.buf + offset;
+}
+
+STATIC void struct_obj_unpack_items(mp_obj_struct_t *self, byte *p, mp_obj_t *items) {
+    char fmt_type = self->fmt_type;
+    for (size_t i = 0, f = 0; f < self->n_fields; f++) {
+        const struct_field_t *field = &self->fields[f];
+        if (field->type == 's') {
+            items[i++] = mp_obj_new_bytes(p, field->cnt);
+            p += field->cnt;
+        } else {
+            for (size_t cnt = field->cnt; cnt--;) {
+                items[i++] = mp_binary_get_val(fmt_type, field->type, &p);
+            }
+        }
+    }
+}
+
+// unpack_from(buffer[, offset[, out]]): unpack into a new tuple, or into the
+// given list of the right length, which allocates nothing for values that
+// fit in a small int
+STATIC mp_obj_t struct_obj_unpack_from(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    byte *p = struct_obj_get_buf(args[1], n_args > 2 ? mp_obj_get_int(args[2]) : 0, self->size, MP_BUFFER_READ);
+    mp_obj_t res;
+    mp_obj_t *items;
+    if (n_args > 3) {
+        res = args[3];
+        if (!mp_obj_is_type(res, &mp_type_list) || ((mp_obj_list_t*)MP_OBJ_TO_PTR(res))->len != self->n_items) {
+            mp_raise_ValueError("bad output list");
+        }
+        items = ((mp_obj_list_t*)MP_OBJ_TO_PTR(res))->items;
+    } else {
+        res = mp_obj_new_tuple(self->n_items, NULL);
+        items = ((mp_obj_tuple_t*)MP_OBJ_TO_PTR(res))->items;
+    }
+
+    struct_obj_unpack_items(self, p, items);
+    return res;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_unpack_from_obj, 2, 4, struct_obj_unpack_from);
+
+// This function assumes there is enough room in p to store all the values
+STATIC void struct_obj_pack_into_internal(mp_obj_struct_t *self, byte *p, size_t n_args, const mp_obj_t *args) {
+    char fmt_type = self->fmt_type;
+    for (size_t i = 0, f = 0; i < n_args && f < self->n_fields; f++) {
+        const struct_field_t *field = &self->fields[f];
+        if (field->type == 's') {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(args[i++], &bufinfo, MP_BUFFER_READ);
+            size_t to_copy = MIN(bufinfo.len, field->cnt);
+            memcpy(p, bufinfo.buf, to_copy);
+            memset(p + to_copy, 0, field->cnt - to_copy);
+            p += field->cnt;
+        } else {
+            for (size_t cnt = field->cnt; cnt-- && i < n_args;) {
+                mp_binary_set_val(fmt_type, field->type, args[i++], &p);
+            }
+        }
+    }
+}
+
+STATIC mp_obj_t struct_obj_pack(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    vstr_t vstr;
+    vstr_init_len(&vstr, self->size);
+    memset(vstr.buf, 0, self->size);
+    struct_obj_pack_into_internal(self, (byte*)vstr.buf, n_args - 1, &args[1]);
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_obj, 1, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack);
+
+STATIC mp_obj_t struct_obj_pack_into(size_t n_args, const mp_obj_t *args) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(args[0]);
+    byte *p = struct_obj_get_buf(args[1], mp_obj_get_int(args[2]), self->size, MP_BUFFER_WRITE);
+    struct_obj_pack_into_internal(self, p, n_args - 3, &args[3]);
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(struct_obj_pack_into_obj, 3, MP_OBJ_FUN_ARGS_MAX, struct_obj_pack_into);
+
+STATIC const mp_rom_map_elem_t struct_obj_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_pack), MP_ROM_PTR(&struct_obj_pack_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_obj_pack_into_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_obj_unpack_from_obj) },
+    { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_obj_unpack_from_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(struct_obj_locals_dict, struct_obj_locals_dict_table);
+
+STATIC const mp_obj_type_t struct_obj_type;
+
+STATIC void struct_obj_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    if (dest[0] != MP_OBJ_NULL) {
+        return;
+    }
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (attr) {
+        case MP_QSTR_format:
+            dest[0] = self->format;
+            break;
+        case MP_QSTR_size:
+            dest[0] = MP_OBJ_NEW_SMALL_INT(self->size);
+            break;
+        default: {
+            mp_map_elem_t *elem = mp_map_lookup((mp_map_t*)&struct_obj_locals_dict.map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+            if (elem != NULL) {
+                mp_convert_member_lookup(self_in, &struct_obj_type, elem->value, dest);
+            }
+            break;
+        }
+    }
+}
+
+STATIC const mp_obj_type_t struct_obj_type = {
+    { &mp_type_type },
+    .name = MP_QSTR_Struct,
+    .make_new = struct_obj_make_new,
+    .attr = struct_obj_attr,
+    .locals_dict = (mp_obj_dict_t*)&struct_obj_locals_dict,
+};
+
+// For modules that keep records in the layout of a Struct: fmt may be a
+// Struct, or a format string to make one from
+mp_obj_t mp_struct_get(mp_obj_t fmt) {
+    if (mp_obj_is_type(fmt, &struct_obj_type)) {
+        return fmt;
+    }
+    return struct_obj_make_new(&struct_obj_type, 1, 0, &fmt);
+}
+
+size_t mp_struct_size(mp_obj_t st, size_t *n_items) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(st);
+    *n_items = self->n_items;
+    return self->size;
+}
+
+mp_obj_t mp_struct_format(mp_obj_t st) {
+    return ((mp_obj_struct_t*)MP_OBJ_TO_PTR(st))->format;
+}
+
+// p must have room for the Struct's size, and n_args be its number of items
+void mp_struct_pack_into(mp_obj_t st, byte *p, size_t n_args, const mp_obj_t *args) {
+    struct_obj_pack_into_internal(MP_OBJ_TO_PTR(st), p, n_args, args);
+}
+
+mp_obj_t mp_struct_unpack(mp_obj_t st, const byte *p) {
+    mp_obj_struct_t *self = MP_OBJ_TO_PTR(st);
+    mp_obj_tuple_t *t = MP_OBJ_TO_PTR(mp_obj_new_tuple(self->n_items, NULL));
+    struct_obj_unpack_items(self, (byte*)p, t->items);
+    return MP_OBJ_FROM_PTR(t);
+}
+
+#endif // MICROPY_PY_STRUCT_STRUCT
+
 STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR___name__), MP_ROM_QSTR(MP_QSTR_ustruct) },
     { MP_ROM_QSTR(MP_QSTR_calcsize), MP_ROM_PTR(&struct_calcsize_obj) },
@@ -255,6 +479,9 @@ STATIC const mp_rom_map_elem_t mp_module_struct_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_pack_into), MP_ROM_PTR(&struct_pack_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack), MP_ROM_PTR(&struct_unpack_from_obj) },
     { MP_ROM_QSTR(MP_QSTR_unpack_from), MP_ROM_PTR(&struct_unpack_from_obj) },
+    #if MICROPY_PY_STRUCT_STRUCT
+    { MP_ROM_QSTR(MP_QSTR_Struct), MP_ROM_PTR(&struct_obj_type) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_struct_globals, mp_module_struct_globals_table);
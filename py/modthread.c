@@ -29,6 +29,7 @@
 
 #include "py/runtime.h"
 #include "py/stackctrl.h"
+#include "py/mphal.h"
 
 #if MICROPY_PY_THREAD
 
@@ -123,6 +124,206 @@ STATIC const mp_obj_type_t mp_type_thread_lock = {
     .locals_dict = (mp_obj_dict_t*)&thread_lock_locals_dict,
 };
 
+/****************************************************************/
+// Queue object
+
+#if MICROPY_PY_THREAD_QUEUE
+
+// A ring of capacity slots, each a 16-bit length then itemsize bytes.
+// Items are copied straight into and out of the slots inside the port's
+// short critical section, so put() never allocates or blocks and can be
+// used by ISRs, C callbacks and threads alike.
+typedef struct _mp_obj_thread_queue_t {
+    mp_obj_base_t base;
+    uint16_t capacity;
+    uint16_t itemsize;
+    volatile uint16_t head;
+    volatile uint16_t tail;
+    volatile uint16_t count;
+    void *volatile waiter; // consumer blocked in get(), or NULL
+    byte ring[];
+} mp_obj_thread_queue_t;
+
+STATIC const mp_obj_type_t mp_type_thread_queue;
+
+STATIC byte *thread_queue_slot(mp_obj_thread_queue_t *self, size_t i) {
+    return self->ring + i * (2 + self->itemsize);
+}
+
+bool mp_thread_queue_put(mp_obj_t queue, const void *data, size_t len) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(queue);
+    if (len > self->itemsize) {
+        return false;
+    }
+    bool ok = false;
+    mp_uint_t state = MP_THREAD_QUEUE_ENTER();
+    if (self->count < self->capacity) {
+        byte *slot = thread_queue_slot(self, self->head);
+        slot[0] = len;
+        slot[1] = len >> 8;
+        memcpy(slot + 2, data, len);
+        self->head = self->head + 1 == self->capacity ? 0 : self->head + 1;
+        ++self->count;
+        ok = true;
+        if (self->waiter != NULL) {
+            // inside the critical section so the waiter can't go away
+            MP_THREAD_QUEUE_NOTIFY(self->waiter);
+        }
+    }
+    MP_THREAD_QUEUE_EXIT(state);
+    return ok;
+}
+
+// Take the oldest item into buf, which has room for itemsize bytes, and
+// return its length or -1 if the queue is empty.  waiter is stored in the
+// queue when it's empty, so that the next put() notifies it.
+STATIC mp_int_t thread_queue_take(mp_obj_thread_queue_t *self, byte *buf, void *waiter) {
+    mp_int_t len = -1;
+    mp_uint_t state = MP_THREAD_QUEUE_ENTER();
+    if (self->count > 0) {
+        const byte *slot = thread_queue_slot(self, self->tail);
+        len = slot[0] | slot[1] << 8;
+        memcpy(buf, slot + 2, len);
+        self->tail = self->tail + 1 == self->capacity ? 0 : self->tail + 1;
+        --self->count;
+        waiter = NULL;
+    }
+    self->waiter = waiter;
+    MP_THREAD_QUEUE_EXIT(state);
+    return len;
+}
+
+// As thread_queue_take() but wait up to timeout_ms, or for ever if it's
+// negative.  Another consumer may replace this one as the waiter, so the
+// waits are bounded and the queue checked again after each.
+STATIC mp_int_t thread_queue_get_wait(mp_obj_thread_queue_t *self, byte *buf, mp_int_t timeout_ms) {
+    mp_uint_t start = mp_hal_ticks_ms();
+    for (;;) {
+        mp_int_t len = thread_queue_take(self, buf, timeout_ms == 0 ? NULL : MP_THREAD_QUEUE_WAITER());
+        if (len >= 0) {
+            return len;
+        }
+        mp_uint_t elapsed = mp_hal_ticks_ms() - start;
+        mp_uint_t ms = 100;
+        if (timeout_ms >= 0) {
+            if (elapsed >= (mp_uint_t)timeout_ms) {
+                // an item may have come as we stop being the waiter
+                return thread_queue_take(self, buf, NULL);
+            }
+            ms = MIN(ms, timeout_ms - elapsed);
+        }
+        MP_THREAD_QUEUE_WAIT(ms);
+        // stop being the waiter before anything that may raise
+        mp_uint_t state = MP_THREAD_QUEUE_ENTER();
+        self->waiter = NULL;
+        MP_THREAD_QUEUE_EXIT(state);
+        mp_handle_pending();
+    }
+}
+
+size_t mp_thread_queue_mem_size(size_t capacity, size_t itemsize) {
+    return sizeof(mp_obj_thread_queue_t) + capacity * (2 + itemsize);
+}
+
+mp_obj_t mp_thread_queue_init(void *mem, size_t capacity, size_t itemsize) {
+    mp_obj_thread_queue_t *self = mem;
+    self->base.type = &mp_type_thread_queue;
+    self->capacity = capacity;
+    self->itemsize = itemsize;
+    self->head = 0;
+    self->tail = 0;
+    self->count = 0;
+    self->waiter = NULL;
+    return MP_OBJ_FROM_PTR(self);
+}
+
+STATIC mp_int_t thread_queue_get_timeout(size_t n_args, const mp_obj_t *args, size_t i) {
+    if (n_args <= i || args[i] == mp_const_none) {
+        return -1;
+    }
+    mp_int_t timeout_ms = mp_obj_get_int(args[i]);
+    return timeout_ms < 0 ? 0 : timeout_ms;
+}
+
+STATIC mp_obj_t thread_queue_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    (void)type;
+    mp_arg_check_num(n_args, n_kw, 2, 2, false);
+    mp_int_t capacity = mp_obj_get_int(args[0]);
+    mp_int_t itemsize = mp_obj_get_int(args[1]);
+    if (capacity < 1 || capacity > 0xffff || itemsize < 0 || itemsize > 0xffff) {
+        mp_raise_ValueError(NULL);
+    }
+    void *mem = m_malloc(mp_thread_queue_mem_size(capacity, itemsize));
+    return mp_thread_queue_init(mem, capacity, itemsize);
+}
+
+STATIC mp_obj_t thread_queue_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(self_in);
+    switch (op) {
+        case MP_UNARY_OP_BOOL: return mp_obj_new_bool(self->count != 0);
+        case MP_UNARY_OP_LEN: return MP_OBJ_NEW_SMALL_INT(self->count);
+        default: return MP_OBJ_NULL; // op not supported
+    }
+}
+
+STATIC mp_obj_t thread_queue_put(mp_obj_t self_in, mp_obj_t item_in) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(item_in, &bufinfo, MP_BUFFER_READ);
+    if (bufinfo.len > self->itemsize) {
+        mp_raise_ValueError("item too big");
+    }
+    return mp_obj_new_bool(mp_thread_queue_put(self_in, bufinfo.buf, bufinfo.len));
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(thread_queue_put_obj, thread_queue_put);
+
+STATIC mp_obj_t thread_queue_get(size_t n_args, const mp_obj_t *args) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(args[0]);
+    vstr_t vstr;
+    vstr_init_len(&vstr, self->itemsize);
+    mp_int_t len = thread_queue_get_wait(self, (byte*)vstr.buf, thread_queue_get_timeout(n_args, args, 1));
+    if (len < 0) {
+        vstr_clear(&vstr);
+        return mp_const_none;
+    }
+    vstr.len = len;
+    return mp_obj_new_str_from_vstr(&mp_type_bytes, &vstr);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(thread_queue_get_obj, 1, 2, thread_queue_get);
+
+STATIC mp_obj_t thread_queue_get_into(size_t n_args, const mp_obj_t *args) {
+    mp_obj_thread_queue_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    if (bufinfo.len < self->itemsize) {
+        mp_raise_ValueError("buffer too small");
+    }
+    mp_int_t len = thread_queue_get_wait(self, bufinfo.buf, thread_queue_get_timeout(n_args, args, 2));
+    if (len < 0) {
+        return mp_const_none;
+    }
+    return MP_OBJ_NEW_SMALL_INT(len);
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(thread_queue_get_into_obj, 2, 3, thread_queue_get_into);
+
+STATIC const mp_rom_map_elem_t thread_queue_locals_dict_table[] = {
+    { MP_ROM_QSTR(MP_QSTR_put), MP_ROM_PTR(&thread_queue_put_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get), MP_ROM_PTR(&thread_queue_get_obj) },
+    { MP_ROM_QSTR(MP_QSTR_get_into), MP_ROM_PTR(&thread_queue_get_into_obj) },
+};
+
+STATIC MP_DEFINE_CONST_DICT(thread_queue_locals_dict, thread_queue_locals_dict_table);
+
+STATIC const mp_obj_type_t mp_type_thread_queue = {
+    { &mp_type_type },
+    .name = MP_QSTR_Queue,
+    .make_new = thread_queue_make_new,
+    .unary_op = thread_queue_unary_op,
+    .locals_dict = (mp_obj_dict_t*)&thread_queue_locals_dict,
+};
+
+#endif // MICROPY_PY_THREAD_QUEUE
+
 /****************************************************************/
 // _thread module
 
@@ -148,6 +349,10 @@ typedef struct _thread_entry_args_t {
     mp_obj_dict_t *dict_locals;
     mp_obj_dict_t *dict_globals;
     size_t stack_size;
+    #if MICROPY_ENABLE_PYSTACK
+    size_t pystack_size;
+    void *pystack;
+    #endif
     mp_obj_t fun;
     size_t n_args;
     size_t n_kw;
@@ -161,14 +366,22 @@ STATIC void *thread_entry(void *args_in) {
 
     mp_state_thread_t ts;
     mp_thread_set_state(&ts);
+    #if MICROPY_TRACK_CODE_STATE
+    ts.code_state = NULL;
+    #endif
+    #if MICROPY_PY_THREAD_STATS
+    ts.gil_wait_us = 0;
+    #endif
+    #if MICROPY_GC_ARENA
+    ts.gc_arena = NULL;
+    #endif
 
     mp_stack_set_top(&ts + 1); // need to include ts in root-pointer scan
     mp_stack_set_limit(args->stack_size);
 
     #if MICROPY_ENABLE_PYSTACK
-    // TODO threading and pystack is not fully supported, for now just make a small stack
-    mp_obj_t mini_pystack[128];
-    mp_pystack_init(mini_pystack, &mini_pystack[128]);
+    // the pystack is on the heap, kept alive by args which is a root pointer
+    mp_pystack_init(args->pystack, (byte*)args->pystack + args->pystack_size);
     #endif
 
     // set locals and globals from the calling context
@@ -222,6 +435,11 @@ STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args)
     // disappear from our address space before the thread is created.
     thread_entry_args_t *th_args;
 
+    // the port's thread list, and so gc_collect, only covers the main VM
+    if (!MP_STATE_CTX_IS_MAIN()) {
+        mp_raise_msg(&mp_type_RuntimeError, "threads need the main VM");
+    }
+
     // get positional arguments
     size_t pos_args_len;
     mp_obj_t *pos_args_items;
@@ -260,6 +478,12 @@ STATIC mp_obj_t mod_thread_start_new_thread(size_t n_args, const mp_obj_t *args)
     // set the stack size to use
     th_args->stack_size = thread_stack_size;
 
+    #if MICROPY_ENABLE_PYSTACK
+    // give the thread its own pystack, so its calls don't allocate code states
+    th_args->pystack_size = MICROPY_PYSTACK_THREAD_SIZE(thread_stack_size);
+    th_args->pystack = m_new(byte, th_args->pystack_size);
+    #endif
+
     // set the function for thread entry
     th_args->fun = args[0];
 
@@ -275,6 +499,13 @@ STATIC mp_obj_t mod_thread_exit(void) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_thread_exit_obj, mod_thread_exit);
 
+#if MICROPY_PY_THREAD_STATS
+STATIC mp_obj_t mod_thread_stats(void) {
+    return mp_thread_stats();
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_0(mod_thread_stats_obj, mod_thread_stats);
+#endif
+
 STATIC mp_obj_t mod_thread_allocate_lock(void) {
     return MP_OBJ_FROM_PTR(mp_obj_new_thread_lock());
 }
@@ -288,6 +519,12 @@ STATIC const mp_rom_map_elem_t mp_module_thread_globals_table[] = {
     { MP_ROM_QSTR(MP_QSTR_start_new_thread), MP_ROM_PTR(&mod_thread_start_new_thread_obj) },
     { MP_ROM_QSTR(MP_QSTR_exit), MP_ROM_PTR(&mod_thread_exit_obj) },
     { MP_ROM_QSTR(MP_QSTR_allocate_lock), MP_ROM_PTR(&mod_thread_allocate_lock_obj) },
+    #if MICROPY_PY_THREAD_QUEUE
+    { MP_ROM_QSTR(MP_QSTR_Queue), MP_ROM_PTR(&mp_type_thread_queue) },
+    #endif
+    #if MICROPY_PY_THREAD_STATS
+    { MP_ROM_QSTR(MP_QSTR_stats), MP_ROM_PTR(&mod_thread_stats_obj) },
+    #endif
 };
 
 STATIC MP_DEFINE_CONST_DICT(mp_module_thread_globals, mp_module_thread_globals_table);
@@ -72,6 +72,9 @@ STATIC const mp_obj_dict_t errorcode_dict = {
     .base = {&mp_type_dict},
     .map = {
         .all_keys_are_qstrs = 0, // keys are integers
+        #if MICROPY_OPT_MAP_INT_KEYS
+        .all_keys_are_small_ints = 1,
+        #endif
         .is_fixed = 1,
         .is_ordered = 1,
         .used = MP_ARRAY_SIZE(errorcode_table),
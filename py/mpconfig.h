@@ -132,6 +132,13 @@
 #define MICROPY_GC_STACK_ENTRY_TYPE size_t
 #endif
 
+// Use the free blocks at the end of the heap as the GC stack during a
+// collection, when they hold more entries than the BSS one.  A deep object
+// graph then rarely overflows the stack, which costs a rescan of the heap.
+#ifndef MICROPY_GC_HEAP_STACK
+#define MICROPY_GC_HEAP_STACK (0)
+#endif
+
 // Be conservative and always clear to zero newly (re)allocated memory in the GC.
 // This helps eliminate stray pointers that hold on to memory that's no longer
 // used.  It decreases performance due to unnecessary memory clearing.
@@ -148,6 +155,92 @@
 #define MICROPY_GC_ALLOC_THRESHOLD (1)
 #endif
 
+// Support a heap made of several separate memory regions, added after
+// gc_init with gc_add
+#ifndef MICROPY_GC_SPLIT_HEAP
+#define MICROPY_GC_SPLIT_HEAP (0)
+#endif
+
+// With a split heap, allocations of at least this many bytes are placed in
+// the regions added with gc_add before the first region, which keeps the
+// first region for small objects (0 to always try the first region first)
+#ifndef MICROPY_GC_SPLIT_HEAP_LARGE
+#define MICROPY_GC_SPLIT_HEAP_LARGE (0)
+#endif
+
+// Number of allocation sizes, from 2 blocks up, that remember where their
+// search for free blocks can start.  Without it every allocation of more
+// than one block scans the fragmented part of the heap from the first free
+// block, which makes allocation O(heap) as the heap fills.
+#ifndef MICROPY_GC_RUN_HINTS
+#define MICROPY_GC_RUN_HINTS (0)
+#endif
+
+// Number of freed 1-block and 2-block chains the sweep keeps, per size,
+// for gc_alloc to hand out again without scanning the allocation table.
+// Short-lived floats, small tuples and bound methods are the usual users.
+// The kept chains stay allocated until the next collection drops them.
+#ifndef MICROPY_GC_FREE_LISTS
+#define MICROPY_GC_FREE_LISTS (0)
+#endif
+
+// Number of objects with a finaliser the heap keeps on a list, which the
+// collector walks once after marking instead of the sweep testing each freed
+// chain for a finaliser.  Objects allocated while the list is full fall back
+// to the finaliser table.  Needs MICROPY_ENABLE_FINALISER.
+#ifndef MICROPY_GC_FINALISER_LIST
+#define MICROPY_GC_FINALISER_LIST (0)
+#endif
+
+// Number of arenas that can exist at once for micropython.arena(). While an
+// arena is active gc_alloc bump-allocates from it, and the whole arena goes
+// back to the heap at the first collection after nothing points into it.
+#ifndef MICROPY_GC_ARENA
+#define MICROPY_GC_ARENA (0)
+#endif
+
+// Count allocations by the bytecode location that made them, for
+// gc.profile(), and support exporting the heap layout with gc.snapshot()
+#ifndef MICROPY_GC_PROFILE
+#define MICROPY_GC_PROFILE (0)
+#endif
+
+// Keep a count of the heap blocks in use and its high-water mark, for
+// gc.mem_peak(), gc.mem_total() and gc.reset_peak()
+#ifndef MICROPY_GC_MEM_PEAK
+#define MICROPY_GC_MEM_PEAK (0)
+#endif
+
+// Number of bytecode locations the allocation profiler keeps apart; further
+// locations are counted together
+#ifndef MICROPY_GC_PROFILE_SITES
+#define MICROPY_GC_PROFILE_SITES (64)
+#endif
+
+// Number of samples the sampling profiler keeps, 0 to disable it.  The port
+// calls mp_prof_sample() from a timer to record where the main thread is in
+// its bytecode, and micropython.profile() returns the counts per line
+#ifndef MICROPY_PROF_SAMPLES
+#define MICROPY_PROF_SAMPLES (0)
+#endif
+
+// Whether each thread records the bytecode function it is running, for the
+// profilers above
+#define MICROPY_TRACK_CODE_STATE (MICROPY_GC_PROFILE || MICROPY_PROF_SAMPLES)
+
+// Support sweeping the heap in steps after a collection.  A collection
+// triggered by the allocation threshold then only marks; each following
+// allocation sweeps MICROPY_GC_SWEEP_STEP more blocks, and gc.collect()
+// accepts a time budget in microseconds (needs mp_hal_ticks_us)
+#ifndef MICROPY_GC_INCREMENTAL_SWEEP
+#define MICROPY_GC_INCREMENTAL_SWEEP (0)
+#endif
+
+// Number of blocks swept by each allocation while a sweep is in progress
+#ifndef MICROPY_GC_SWEEP_STEP
+#define MICROPY_GC_SWEEP_STEP (256)
+#endif
+
 // Number of bytes to allocate initially when creating new chunks to store
 // interned string data.  Smaller numbers lead to more chunks being needed
 // and more wastage at the end of the chunk.  Larger numbers lead to wasted
@@ -236,6 +329,14 @@
 #define MICROPY_QSTR_BYTES_IN_HASH (2)
 #endif
 
+// Whether qstr pools have a hash index so that looking up a string (when
+// interning, importing, compiling, getattr with a str) doesn't scan every
+// qstr.  The index of ROM pools is generated at build time, and RAM pools
+// use 2 bytes per entry (at most 3/4 full) in addition to their table.
+#ifndef MICROPY_QSTR_HASH_INDEX
+#define MICROPY_QSTR_HASH_INDEX (0)
+#endif
+
 // Avoid using C stack when making Python function calls. C stack still
 // may be used if there's no free heap.
 #ifndef MICROPY_STACKLESS
@@ -326,6 +427,16 @@
 // Convenience definition for whether any native emitter is enabled
 #define MICROPY_EMIT_NATIVE (MICROPY_EMIT_X64 || MICROPY_EMIT_X86 || MICROPY_EMIT_THUMB || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA)
 
+// Whether native code in .mpy files can be loaded without a native emitter,
+// for machine code produced by other tools such as a C compiler.  The port
+// must set MICROPY_NATIVE_ARCH to the MP_NATIVE_ARCH_xxx value it runs.
+#ifndef MICROPY_PERSISTENT_CODE_LOAD_NATIVE
+#define MICROPY_PERSISTENT_CODE_LOAD_NATIVE (0)
+#endif
+
+// Convenience definition for whether native code can be run at all
+#define MICROPY_EMIT_MACHINE_CODE (MICROPY_EMIT_NATIVE || MICROPY_PERSISTENT_CODE_LOAD_NATIVE)
+
 // Convenience definition for whether any inline assembler emitter is enabled
 #define MICROPY_EMIT_INLINE_ASM (MICROPY_EMIT_INLINE_THUMB || MICROPY_EMIT_INLINE_XTENSA)
 
@@ -356,11 +467,23 @@
 #define MICROPY_COMP_CONST_FOLDING (1)
 #endif
 
+// Whether constant folding also covers float arithmetic, str/bytes
+// concatenation and small int powers; eg -1.5, 2 * 0.5, "a" + "b", 2 ** 8
+#ifndef MICROPY_COMP_CONST_FOLDING_EXTENDED
+#define MICROPY_COMP_CONST_FOLDING_EXTENDED (0)
+#endif
+
 // Whether to enable optimisations for constant literals, eg OrderedDict
 #ifndef MICROPY_COMP_CONST_LITERAL
 #define MICROPY_COMP_CONST_LITERAL (1)
 #endif
 
+// Whether to build tuples of constants, eg (1, 'a', 2.5), once at compile
+// time instead of on each evaluation, which lets mpy-tool put them in ROM
+#ifndef MICROPY_COMP_CONST_TUPLE
+#define MICROPY_COMP_CONST_TUPLE (0)
+#endif
+
 // Whether to enable lookup of constants in modules; eg module.CONST
 #ifndef MICROPY_COMP_MODULE_CONST
 #define MICROPY_COMP_MODULE_CONST (0)
@@ -389,6 +512,15 @@
 #define MICROPY_COMP_RETURN_IF_EXPR (0)
 #endif
 
+// Whether imported modules and script files are parsed, compiled and executed
+// one top-level statement at a time, so that peak compile memory is that of
+// the largest statement rather than the whole file.  A syntax error is then
+// only raised once the statements before it have been executed, which changes
+// import semantics, so no port enables this by default.
+#ifndef MICROPY_COMP_STREAM_FILE_INPUT
+#define MICROPY_COMP_STREAM_FILE_INPUT (0)
+#endif
+
 /*****************************************************************************/
 /* Internal debugging stuff                                                  */
 
@@ -442,12 +574,175 @@
 #define MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE (0)
 #endif
 
+// Whether the VM does the common binary operations on two small ints (compare,
+// add, subtract, multiply and the bitwise and/or/xor) inline, instead of going
+// through mp_binary_op.  Costs a few hundred bytes of code in the VM.
+#ifndef MICROPY_OPT_SMALL_INT_BINARY_OP
+#define MICROPY_OPT_SMALL_INT_BINARY_OP (0)
+#endif
+
+// Whether the compiler fuses common sequences of opcodes into single
+// superinstructions: LOAD_FAST+LOAD_ATTR, LOAD_FAST+LOAD_CONST_SMALL_INT+
+// BINARY_OP and a comparison followed by POP_JUMP_IF.  This saves VM dispatch
+// and stack traffic for a little more code in the VM.  It has no effect on
+// code that is saved to .mpy files, which must run on any VM.
+#ifndef MICROPY_OPT_SUPERINSTRUCTIONS
+#define MICROPY_OPT_SUPERINSTRUCTIONS (0)
+#endif
+
+// Whether bytecode functions that take only positional args, with no *args,
+// **kwargs, keyword-only args or closed-over variables, are marked when they
+// are created so that a call passing exactly their positional args skips the
+// general argument processing of mp_setup_code_state.  Uses 1 word of RAM per
+// function object.
+#ifndef MICROPY_OPT_FAST_CALL
+#define MICROPY_OPT_FAST_CALL (0)
+#endif
+
+// Whether bytecode functions compiled from a source file count their calls
+// and, once micropython.tier_native() sets a threshold, are compiled again
+// from that file with the native emitter when they reach it.  Uses 2 words of
+// RAM per function object and needs a native emitter and a file reader.
+// A function is left as bytecode if its file has changed since it was
+// imported, which is checked with a hash of the source taken by the lexer.
+#ifndef MICROPY_OPT_TIERED_NATIVE
+#define MICROPY_OPT_TIERED_NATIVE (0)
+#endif
+
+// The scopes of a file are found in a different order when it's compiled a
+// statement at a time, so tiering can't find a function's scope again
+#if MICROPY_OPT_TIERED_NATIVE && MICROPY_COMP_STREAM_FILE_INPUT
+#error MICROPY_OPT_TIERED_NATIVE is not compatible with MICROPY_COMP_STREAM_FILE_INPUT
+#endif
+
+// Whether mp_arg_parse_all matches the keyword args of a call directly against
+// the qstrs of the allowed args, in one pass that checks the args and another
+// that converts them, instead of a map lookup for each allowed arg.  Calls
+// with only positional args then do no searching.
+#ifndef MICROPY_OPT_ARG_PARSE_FAST
+#define MICROPY_OPT_ARG_PARSE_FAST (0)
+#endif
+
+// Whether a generator keeps its frame (code state with local and exception
+// stacks) in a separate allocation that is given back to the generating
+// function when the generator finishes, and reused by the next generator made
+// by that function.  Loops that create and exhaust generators then allocate
+// only the small generator object.  Uses 1 word of RAM per function object.
+#ifndef MICROPY_OPT_GEN_FRAME_REUSE
+#define MICROPY_OPT_GEN_FRAME_REUSE (0)
+#endif
+
+// Number of entries in a cache of attribute lookups in user classes, keyed on
+// the class and attribute name, that lets LOAD_ATTR and LOAD_METHOD on an
+// instance skip the search through the class and its bases.  Must be a power
+// of 2, or 0 to disable.  The cache is cleared when any class attribute is
+// stored or deleted.  Uses 3 words of RAM per entry.
+#ifndef MICROPY_OPT_CACHE_CLASS_LOOKUP
+#define MICROPY_OPT_CACHE_CLASS_LOOKUP (0)
+#endif
+
+// Minimum length of a str/bytes slice that refers to the data of the sliced
+// object instead of copying it.  Slices shorter than a quarter of the object
+// are always copied so that they don't keep much larger data alive.  0 to
+// disable.
+#ifndef MICROPY_OPT_STR_SLICE_VIEW
+#define MICROPY_OPT_STR_SLICE_VIEW (0)
+#endif
+
+// Number of entries in a cache of short str objects, of up to 16 bytes, made
+// at runtime by mp_obj_new_str (eg by ujson.loads and bytes.decode).  A new
+// str equal to a cached one returns the cached object, so repeated strings
+// share storage and are hashed once.  Must be a power of 2, or 0 to disable.
+#ifndef MICROPY_OPT_STR_CACHE
+#define MICROPY_OPT_STR_CACHE (0)
+#endif
+
+// Minimum length of str/bytes data copied at runtime (eg by mp_obj_new_bytes
+// and mp_obj_new_str_from_vstr) whose hash is computed when it is first
+// needed rather than when the object is made, so large payloads that are
+// never hashed don't take an extra pass over the data.  0 to disable.
+#ifndef MICROPY_OPT_STR_LAZY_HASH
+#define MICROPY_OPT_STR_LAZY_HASH (0)
+#endif
+
+// Number of unicode str objects, of 32 bytes or more, for which the byte
+// offset of every 32nd character is kept, so that indexing and slicing them
+// doesn't walk the UTF-8 data from the start and len() is O(1).  Filled on the
+// first indexed access; all-ASCII strings are then indexed by byte without
+// the offsets.  Uses 4 words of RAM per entry plus 1 word per 32 characters.
+// 0 to disable.
+#ifndef MICROPY_OPT_STR_INDEX_CACHE
+#define MICROPY_OPT_STR_INDEX_CACHE (0)
+#endif
+
+// Number of format strings compiled for str.format and % formatting, most
+// recently used first.  Only interned strings, such as literals in code, are
+// compiled; repeated formatting with one then skips parsing the format and
+// its field specs.  Uses 1 word of RAM per entry plus about 8 words per field
+// of each cached format.  0 to disable.
+#ifndef MICROPY_OPT_STR_FORMAT_CACHE
+#define MICROPY_OPT_STR_FORMAT_CACHE (0)
+#endif
+
+// Whether str/bytes/bytearray searching (find, index, count, split, replace,
+// partition and "in") uses memchr to find candidate matches, and a Horspool
+// search with a 256 byte skip table for needles of 4 or more bytes
+#ifndef MICROPY_OPT_STR_FIND_FAST
+#define MICROPY_OPT_STR_FIND_FAST (0)
+#endif
+
+// Minimum length of the result of str/bytes concatenation that is given spare
+// capacity, so that a following "s += x" on the result appends in place and
+// string-building loops run in linear time.  The hash of such a string is
+// computed when needed rather than up front.  0 to disable.
+#ifndef MICROPY_OPT_STR_CONCAT_INPLACE
+#define MICROPY_OPT_STR_CONCAT_INPLACE (0)
+#endif
+
 // Whether to use fast versions of bitwise operations (and, or, xor) when the
 // arguments are both positive.  Increases Thumb2 code size by about 250 bytes.
 #ifndef MICROPY_OPT_MPZ_BITWISE
 #define MICROPY_OPT_MPZ_BITWISE (0)
 #endif
 
+// Minimum number of digits of both operands for mpz multiplication to use
+// Karatsuba's method instead of the O(n^2) schoolbook method (0 to disable).
+// Must be at least 4 when enabled; the best value depends on MPZ_DIG_SIZE
+// and the cost of a hardware multiply.
+#ifndef MICROPY_OPT_MPZ_KARATSUBA
+#define MICROPY_OPT_MPZ_KARATSUBA (0)
+#endif
+
+// Whether pow(a, b, m) uses Montgomery multiplication when m is odd and
+// positive, which avoids a long division each step of the exponentiation.
+#ifndef MICROPY_OPT_MPZ_MONTGOMERY
+#define MICROPY_OPT_MPZ_MONTGOMERY (0)
+#endif
+
+// Whether the native emitters keep the most used locals of a function in
+// registers, counting uses within loops as more frequent, rather than always
+// the first few locals (ie the leading arguments).
+#ifndef MICROPY_OPT_NATIVE_LOCAL_REGS
+#define MICROPY_OPT_NATIVE_LOCAL_REGS (0)
+#endif
+
+// Whether dicts keep their entries densely in insertion order, with a
+// separate index of 1, 2 or 4 byte entry numbers for tables of more than 8
+// entries (see map.c).  Iteration follows insertion order like CPython 3.6+,
+// lookups of missing keys stay short, and growing a table reallocates it in
+// place when possible instead of building a second one.
+#ifndef MICROPY_MAP_COMPACT
+#define MICROPY_MAP_COMPACT (0)
+#endif
+
+// Whether dicts and sets remember that all their keys are small ints, like
+// they do for qstrs, so that a small int is looked up by its value as the
+// hash and pointer comparison.  Set operations between two sets also walk
+// the other set's table directly rather than through an iterator.
+#ifndef MICROPY_OPT_MAP_INT_KEYS
+#define MICROPY_OPT_MAP_INT_KEYS (0)
+#endif
+
 
 // Whether math.factorial is large, fast and recursive (1) or small and slow (0).
 #ifndef MICROPY_OPT_MATH_FACTORIAL
@@ -474,6 +769,12 @@
 #define MICROPY_READER_VFS (0)
 #endif
 
+// Size of the readahead buffer used by the VFS reader; a file that fits
+// is read whole and closed before it is compiled
+#ifndef MICROPY_READER_VFS_BUF_SIZE
+#define MICROPY_READER_VFS_BUF_SIZE (24)
+#endif
+
 // Whether any readers have been defined
 #ifndef MICROPY_HAS_FILE_READER
 #define MICROPY_HAS_FILE_READER (MICROPY_READER_POSIX || MICROPY_READER_VFS)
@@ -511,17 +812,40 @@
 #define MICROPY_ENABLE_PYSTACK (0)
 #endif
 
+// Whether each task can have its own mp_state_ctx_t, so that a port can run
+// more than one isolated VM (each with its own heap and GIL).  All state is
+// then reached through the thread-local mp_state_ctx_ptr, which points to
+// mp_state_ctx unless the task changes it.
+#ifndef MICROPY_STATE_CTX_PER_TASK
+#define MICROPY_STATE_CTX_PER_TASK (0)
+#endif
+
 // Number of bytes that memory returned by mp_pystack_alloc will be aligned by.
 #ifndef MICROPY_PYSTACK_ALIGN
 #define MICROPY_PYSTACK_ALIGN (8)
 #endif
 
+// Number of bytes of pystack, allocated on the heap, for a thread started by
+// _thread.start_new_thread, given the C stack size set by _thread.stack_size
+// (0 if it hasn't been set).  The default gives the thread half as many bytes
+// of pystack as of C stack.
+#ifndef MICROPY_PYSTACK_THREAD_SIZE
+#define MICROPY_PYSTACK_THREAD_SIZE(stack_size) ((stack_size) == 0 ? 2048 : (stack_size) / 2)
+#endif
+
 // Whether to check C stack usage. C stack used for calling Python functions,
 // etc. Not checking means segfault on overflow.
 #ifndef MICROPY_STACK_CHECK
 #define MICROPY_STACK_CHECK (0)
 #endif
 
+// Whether StopIteration and OSError with a common errno (EAGAIN, ETIMEDOUT,
+// EINPROGRESS) raised from C use read-only preallocated instances, which
+// don't allocate from the heap and don't record a traceback
+#ifndef MICROPY_PREALLOC_EXCEPTIONS
+#define MICROPY_PREALLOC_EXCEPTIONS (0)
+#endif
+
 // Whether to have an emergency exception buffer
 #ifndef MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF
 #define MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF (0)
@@ -563,6 +887,19 @@
 #define MICROPY_REPL_EVENT_DRIVEN (0)
 #endif
 
+// Whether the raw REPL supports raw-paste mode, where a host tool streams
+// code in windows acknowledged by the device and it is compiled as it
+// arrives, see pyexec_raw_repl()
+#ifndef MICROPY_REPL_RAW_PASTE
+#define MICROPY_REPL_RAW_PASTE (0)
+#endif
+
+// Number of bytes the port's stdin buffer can hold; raw-paste mode allows
+// the host this many bytes in flight
+#ifndef MICROPY_REPL_STDIN_BUFFER_MAX
+#define MICROPY_REPL_STDIN_BUFFER_MAX (256)
+#endif
+
 // Whether to include lexer helper function for unix
 #ifndef MICROPY_HELPER_LEXER_UNIX
 #define MICROPY_HELPER_LEXER_UNIX (0)
@@ -651,6 +988,12 @@ typedef double mp_float_t;
 #define MICROPY_FLOAT_HIGH_QUALITY_HASH (0)
 #endif
 
+// Whether repr/str of a single precision float prints the shortest digits
+// that read back as the same float (Ryu), instead of a fixed 7 digits.
+#ifndef MICROPY_FLOAT_FORMAT_SHORTEST
+#define MICROPY_FLOAT_FORMAT_SHORTEST (0)
+#endif
+
 // Enable features which improve CPython compatibility
 // but may lead to more code size/memory usage.
 // TODO: Originally intended as generic category to not
@@ -704,11 +1047,27 @@ typedef double mp_float_t;
 #define MICROPY_MODULE_FROZEN_MPY (0)
 #endif
 
+// Whether frozen .mpy bytecode may be stored deflate-compressed (mpy-tool.py
+// -mcompress-bytecode), and if so the number of recently expanded functions
+// kept in RAM so they don't need decompressing again; needs MICROPY_PY_UZLIB
+#ifndef MICROPY_MODULE_FROZEN_MPY_COMPRESSED
+#define MICROPY_MODULE_FROZEN_MPY_COMPRESSED (0)
+#endif
+
 // Convenience macro for whether frozen modules are supported
 #ifndef MICROPY_MODULE_FROZEN
 #define MICROPY_MODULE_FROZEN (MICROPY_MODULE_FROZEN_STR || MICROPY_MODULE_FROZEN_MPY)
 #endif
 
+// Whether importing a .py file saves the compiled code as a .mpy file next to
+// it, which later imports of the same source load instead of compiling it
+// again.  The .mpy ends with the length and a hash of the source it came
+// from; a .mpy next to a .py is owned by the cache and rewritten when they
+// don't match.  Requires MICROPY_PERSISTENT_CODE_LOAD and _SAVE.
+#ifndef MICROPY_MODULE_MPY_CACHE
+#define MICROPY_MODULE_MPY_CACHE (0)
+#endif
+
 // Whether you can override builtins in the builtins module
 #ifndef MICROPY_CAN_OVERRIDE_BUILTINS
 #define MICROPY_CAN_OVERRIDE_BUILTINS (0)
@@ -743,6 +1102,25 @@ typedef double mp_float_t;
 #define MICROPY_SCHEDULER_DEPTH (4)
 #endif
 
+// Maximum number of entries in the scheduler's high priority queue, which is
+// run ahead of the normal one (0 to have only one queue)
+#ifndef MICROPY_SCHEDULER_HIGH_DEPTH
+#define MICROPY_SCHEDULER_HIGH_DEPTH (0)
+#endif
+
+// Number of callbacks that the scheduler counts scheduled and dropped calls
+// for separately, for micropython.sched_stats(); the last entry counts all
+// other callbacks (0 to disable the counts)
+#ifndef MICROPY_SCHEDULER_STATS
+#define MICROPY_SCHEDULER_STATS (0)
+#endif
+
+// Hook run by mp_sched_schedule once a callback is queued, so that a port
+// which blocks while idle can wake the VM to run it
+#ifndef MICROPY_SCHED_HOOK_SCHEDULED
+#define MICROPY_SCHED_HOOK_SCHEDULED
+#endif
+
 // Support for generic VFS sub-system
 #ifndef MICROPY_VFS
 #define MICROPY_VFS (0)
@@ -758,6 +1136,12 @@ typedef double mp_float_t;
 #define MICROPY_VFS_FAT (0)
 #endif
 
+// Support for VFS log component, a wear-levelled log-structured filesystem
+// for flash block devices
+#ifndef MICROPY_VFS_LOG
+#define MICROPY_VFS_LOG (0)
+#endif
+
 /*****************************************************************************/
 /* Fine control over Python builtins, classes, modules, etc                  */
 
@@ -787,6 +1171,13 @@ typedef double mp_float_t;
 #define MICROPY_PY_DELATTR_SETATTR (0)
 #endif
 
+// Whether to support __slots__ in classes, keeping the values of the named
+// attributes in an array after the instance instead of in its members map;
+// without "__dict__" in __slots__ instances can't have other attributes
+#ifndef MICROPY_PY_CLASS_SLOTS
+#define MICROPY_PY_CLASS_SLOTS (0)
+#endif
+
 // Support for async/await/async for/async with
 #ifndef MICROPY_PY_ASYNC_AWAIT
 #define MICROPY_PY_ASYNC_AWAIT (1)
@@ -1016,6 +1407,25 @@ typedef double mp_float_t;
 #define MICROPY_PY_MICROPYTHON_STACK_USE (MICROPY_PY_MICROPYTHON_MEM_INFO)
 #endif
 
+// Whether native code records its address and name in /tmp/perf-<pid>.map
+// as it is emitted, so that the Linux perf tool can name it; unix only
+#ifndef MICROPY_PERF_MAP
+#define MICROPY_PERF_MAP (0)
+#endif
+
+// Whether to provide "micropython.stats", which returns the runtime counters:
+// GC collections and pause time, allocations, and scheduler depth, drops and
+// latency.  Needs mp_hal_ticks_us
+#ifndef MICROPY_PY_MICROPYTHON_STATS
+#define MICROPY_PY_MICROPYTHON_STATS (0)
+#endif
+
+// Whether the VM counts the bytecodes it executes, for micropython.stats();
+// this costs an increment per opcode
+#ifndef MICROPY_VM_COUNT_OPCODES
+#define MICROPY_VM_COUNT_OPCODES (0)
+#endif
+
 // Whether to provide "array" module. Note that large chunk of the
 // underlying code is shared with "bytearray" builtin type, so to
 // get real savings, it should be disabled too.
@@ -1029,6 +1439,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_ARRAY_SLICE_ASSIGN (0)
 #endif
 
+// Whether to provide elementwise and reduction functions over numeric arrays
+// in the array module: add, sub, mul, scale, clip, convert, sum, min, max, dot
+#ifndef MICROPY_PY_ARRAY_OPS
+#define MICROPY_PY_ARRAY_OPS (0)
+#endif
+
 // Whether to support attrtuple type (MicroPython extension)
 // It provides space-efficient tuples with attribute access
 #ifndef MICROPY_PY_ATTRTUPLE
@@ -1045,6 +1461,22 @@ typedef double mp_float_t;
 #define MICROPY_PY_COLLECTIONS_DEQUE (0)
 #endif
 
+// Whether "ucollections.deque" supports iteration
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE_ITER
+#define MICROPY_PY_COLLECTIONS_DEQUE_ITER (0)
+#endif
+
+// Whether "ucollections.deque" supports indexing with d[i] (in O(1))
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR
+#define MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR (0)
+#endif
+
+// Whether "ucollections.deque" accepts an array typecode, eg deque('f', 64),
+// storing its items unboxed and exposing them with the buffer protocol
+#ifndef MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+#define MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE (0)
+#endif
+
 // Whether to provide "collections.OrderedDict" type
 #ifndef MICROPY_PY_COLLECTIONS_ORDEREDDICT
 #define MICROPY_PY_COLLECTIONS_ORDEREDDICT (0)
@@ -1070,6 +1502,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_MATH_FACTORIAL (0)
 #endif
 
+// Whether to provide math functions batched over float arrays, and the
+// math.norm3 and math.tilt_heading helpers for 3-axis sensor readings
+#ifndef MICROPY_PY_MATH_ARRAY
+#define MICROPY_PY_MATH_ARRAY (0)
+#endif
+
 // Whether to provide "cmath" module
 #ifndef MICROPY_PY_CMATH
 #define MICROPY_PY_CMATH (0)
@@ -1126,6 +1564,11 @@ typedef double mp_float_t;
 #define MICROPY_PY_STRUCT (1)
 #endif
 
+// Whether to provide "ustruct.Struct", which parses its format once
+#ifndef MICROPY_PY_STRUCT_STRUCT
+#define MICROPY_PY_STRUCT_STRUCT (0)
+#endif
+
 // Whether to provide "sys" module
 #ifndef MICROPY_PY_SYS
 #define MICROPY_PY_SYS (1)
@@ -1183,6 +1626,18 @@ typedef double mp_float_t;
 #define MICROPY_PY_USELECT (0)
 #endif
 
+// Whether uselect.poll objects ask streams to notify them of changes (see
+// MP_STREAM_POLL_NOTIFY), and skip polling streams that have not changed
+#ifndef MICROPY_PY_USELECT_NOTIFY
+#define MICROPY_PY_USELECT_NOTIFY (0)
+#endif
+
+// Hook for uselect while it waits for streams, run after MICROPY_EVENT_POLL_HOOK
+// between polls; a port can block briefly here to let the CPU idle
+#ifndef MICROPY_PY_USELECT_IDLE_HOOK
+#define MICROPY_PY_USELECT_IDLE_HOOK
+#endif
+
 // Whether to provide "utime" module functions implementation
 // in terms of mp_hal_* functions.
 #ifndef MICROPY_PY_UTIME_MP_HAL
@@ -1210,6 +1665,20 @@ typedef double mp_float_t;
 #define MICROPY_PY_THREAD_GIL (MICROPY_PY_THREAD)
 #endif
 
+// Whether to provide "_thread.stats".  The port implements it as
+// mp_thread_stats(), and provides mp_thread_gil_enter() to count the time
+// each thread waits for the GIL
+#ifndef MICROPY_PY_THREAD_STATS
+#define MICROPY_PY_THREAD_STATS (0)
+#endif
+
+// Whether to provide "_thread.Queue", a fixed size queue of byte strings
+// that ISRs and C callbacks can put to without allocating.  The port can
+// provide a critical section and wait/notify hooks for it, see mpthread.h
+#ifndef MICROPY_PY_THREAD_QUEUE
+#define MICROPY_PY_THREAD_QUEUE (0)
+#endif
+
 // Number of VM jump-loops to do before releasing the GIL.
 // Set this to 0 to disable the divisor.
 #ifndef MICROPY_PY_THREAD_GIL_VM_DIVISOR
@@ -1228,14 +1697,42 @@ typedef double mp_float_t;
 #define MICROPY_PY_UCTYPES_NATIVE_C_TYPES (1)
 #endif
 
+// Number of compiled struct layouts that uctypes keeps for reuse by new
+// struct objects with the same descriptor; 0 disables the cache
+#ifndef MICROPY_PY_UCTYPES_LAYOUT_CACHE
+#define MICROPY_PY_UCTYPES_LAYOUT_CACHE (0)
+#endif
+
 #ifndef MICROPY_PY_UZLIB
 #define MICROPY_PY_UZLIB (0)
 #endif
 
+// If non-zero, inflate decodes Huffman codes of up to this many bits with one
+// table lookup, at a cost of 4 << MICROPY_PY_UZLIB_FAST_BITS bytes of RAM
+#ifndef MICROPY_PY_UZLIB_FAST_BITS
+#define MICROPY_PY_UZLIB_FAST_BITS (0)
+#endif
+
+// Whether to provide uzlib.compress and uzlib.CompressIO
+#ifndef MICROPY_PY_UZLIB_COMPRESS
+#define MICROPY_PY_UZLIB_COMPRESS (0)
+#endif
+
 #ifndef MICROPY_PY_UJSON
 #define MICROPY_PY_UJSON (0)
 #endif
 
+// Size of the buffer ujson uses to read from and write to streams, which is on
+// the C stack during ujson.load, dump and dumps
+#ifndef MICROPY_PY_UJSON_STREAM_BUF_SIZE
+#define MICROPY_PY_UJSON_STREAM_BUF_SIZE (256)
+#endif
+
+// Whether to provide ujson.iterload, to parse a stream incrementally
+#ifndef MICROPY_PY_UJSON_ITERLOAD
+#define MICROPY_PY_UJSON_ITERLOAD (0)
+#endif
+
 #ifndef MICROPY_PY_URE
 #define MICROPY_PY_URE (0)
 #endif
@@ -1252,10 +1749,27 @@ typedef double mp_float_t;
 #define MICROPY_PY_URE_SUB (0)
 #endif
 
+// Whether ure matches with a Pike VM, which runs in time linear in the subject
+// length and uses no recursion on the subject, rather than by backtracking
+#ifndef MICROPY_PY_URE_PIKEVM
+#define MICROPY_PY_URE_PIKEVM (0)
+#endif
+
+// Number of compiled patterns that the ure module-level functions (match,
+// search, sub) keep for reuse; 0 disables the cache
+#ifndef MICROPY_PY_URE_CACHE
+#define MICROPY_PY_URE_CACHE (0)
+#endif
+
 #ifndef MICROPY_PY_UHEAPQ
 #define MICROPY_PY_UHEAPQ (0)
 #endif
 
+// Whether to provide uheapq.nsmallest, nlargest and merge
+#ifndef MICROPY_PY_UHEAPQ_BULK
+#define MICROPY_PY_UHEAPQ_BULK (0)
+#endif
+
 // Optimized heap queue for relative timestamps
 #ifndef MICROPY_PY_UTIMEQ
 #define MICROPY_PY_UTIMEQ (0)
@@ -1277,6 +1791,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_UHASHLIB_SHA256 (1)
 #endif
 
+// Whether mbedTLS hash objects free their context when collected, releasing
+// any hardware hash engine held by an object whose digest was never taken
+#ifndef MICROPY_PY_UHASHLIB_FINALISER
+#define MICROPY_PY_UHASHLIB_FINALISER (0)
+#endif
+
 #ifndef MICROPY_PY_UCRYPTOLIB
 #define MICROPY_PY_UCRYPTOLIB (0)
 #endif
@@ -1285,10 +1805,26 @@ typedef double mp_float_t;
 #define MICROPY_PY_UCRYPTOLIB_CONSTS (0)
 #endif
 
+// Whether to provide the AES-CTR mode in ucryptolib
+#ifndef MICROPY_PY_UCRYPTOLIB_CTR
+#define MICROPY_PY_UCRYPTOLIB_CTR (0)
+#endif
+
+// Whether to provide the AES-GCM authenticated mode in ucryptolib
+#ifndef MICROPY_PY_UCRYPTOLIB_GCM
+#define MICROPY_PY_UCRYPTOLIB_GCM (0)
+#endif
+
 #ifndef MICROPY_PY_UBINASCII
 #define MICROPY_PY_UBINASCII (0)
 #endif
 
+// Whether to provide hexlify_into, a2b_base64_into and b2a_base64_into,
+// which write their result into an existing buffer
+#ifndef MICROPY_PY_UBINASCII_INTO
+#define MICROPY_PY_UBINASCII_INTO (0)
+#endif
+
 // Depends on MICROPY_PY_UZLIB
 #ifndef MICROPY_PY_UBINASCII_CRC32
 #define MICROPY_PY_UBINASCII_CRC32 (0)
@@ -1298,6 +1834,10 @@ typedef double mp_float_t;
 #define MICROPY_PY_URANDOM (0)
 #endif
 
+// Function returning a 32-bit hardware random word, used by urandom until
+// seed() is called (after which the sequence is repeatable)
+// #define MICROPY_PY_URANDOM_HW_FUNC() esp_random()
+
 // Whether to include: randrange, randint, choice, random, uniform
 #ifndef MICROPY_PY_URANDOM_EXTRA_FUNCS
 #define MICROPY_PY_URANDOM_EXTRA_FUNCS (0)
@@ -1326,10 +1866,41 @@ typedef double mp_float_t;
 #define MICROPY_PY_USSL_FINALISER (0)
 #endif
 
+// Number of client sessions ussl keeps by server_hostname, so that the next
+// connection to the same server resumes one without a full handshake (0 to
+// disable; mbedTLS only)
+#ifndef MICROPY_PY_USSL_SESSION_CACHE
+#define MICROPY_PY_USSL_SESSION_CACHE (0)
+#endif
+
 #ifndef MICROPY_PY_UWEBSOCKET
 #define MICROPY_PY_UWEBSOCKET (0)
 #endif
 
+// Whether to provide the "umqttc" module, a native MQTT client
+#ifndef MICROPY_PY_UMQTTC
+#define MICROPY_PY_UMQTTC (0)
+#endif
+
+// Whether to provide the "uhttpc" module, a native HTTP/1.1 client
+#ifndef MICROPY_PY_UHTTPC
+#define MICROPY_PY_UHTTPC (0)
+#endif
+
+// Whether to provide the "ulog" module, a binary data logger writing
+// CRC-checked blocks of records into a ring file.
+// Requires MICROPY_PY_STRUCT_STRUCT, and MICROPY_PY_UZLIB unless the port
+// provides mp_hal_crc32.
+#ifndef MICROPY_PY_ULOG
+#define MICROPY_PY_ULOG (0)
+#endif
+
+// Whether to provide the "uasyncio" module, an event loop for coroutines.
+// Requires MICROPY_PY_UTIMEQ and a uselect module with poll().
+#ifndef MICROPY_PY_UASYNCIO
+#define MICROPY_PY_UASYNCIO (0)
+#endif
+
 #ifndef MICROPY_PY_FRAMEBUF
 #define MICROPY_PY_FRAMEBUF (0)
 #endif
@@ -1338,6 +1909,12 @@ typedef double mp_float_t;
 #define MICROPY_PY_BTREE (0)
 #endif
 
+// Whether btree objects have a stats() method giving page cache counters
+// (set by the MICROPY_PY_BTREE_STATS make variable, which builds mpool with them)
+#ifndef MICROPY_PY_BTREE_STATS
+#define MICROPY_PY_BTREE_STATS (0)
+#endif
+
 /*****************************************************************************/
 /* Hooks for a port to add builtins                                          */
 
@@ -31,3 +31,7 @@ mp_dynamic_compiler_t mp_dynamic_compiler = {0};
 #endif
 
 mp_state_ctx_t mp_state_ctx;
+
+#if MICROPY_STATE_CTX_PER_TASK
+__thread mp_state_ctx_t *mp_state_ctx_ptr = &mp_state_ctx;
+#endif
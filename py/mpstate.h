@@ -59,14 +59,65 @@ extern mp_dynamic_compiler_t mp_dynamic_compiler;
 typedef struct _mp_sched_item_t {
     mp_obj_t func;
     mp_obj_t arg;
+    #if MICROPY_PY_MICROPYTHON_STATS
+    uint32_t ticks_us; // when it was scheduled, for the latency
+    #endif
 } mp_sched_item_t;
 
-// This structure hold information about the memory allocation system.
-typedef struct _mp_state_mem_t {
-    #if MICROPY_MEM_STATS
-    size_t total_bytes_allocated;
-    size_t current_bytes_allocated;
-    size_t peak_bytes_allocated;
+#if MICROPY_OPT_CACHE_CLASS_LOOKUP
+typedef struct _mp_class_cache_entry_t {
+    const mp_obj_type_t *type;
+    qstr attr;
+    mp_obj_t member;
+} mp_class_cache_entry_t;
+#endif
+
+#if MICROPY_OPT_STR_CONCAT_INPLACE
+// A str/bytes data buffer with spare room that may be appended to in place
+typedef struct _mp_str_concat_buf_t {
+    byte *data;
+    size_t used;
+    size_t alloc;
+} mp_str_concat_buf_t;
+#endif
+
+#if MICROPY_OPT_STR_INDEX_CACHE
+// The character length of a unicode str, keyed on its data and byte length
+typedef struct _mp_str_index_t {
+    const byte *data;
+    size_t len;
+    size_t charlen;
+} mp_str_index_t;
+#endif
+
+// Scheduler priorities
+#define MP_SCHED_PRIO_NORMAL (0)
+#define MP_SCHED_PRIO_HIGH (1)
+
+#if MICROPY_SCHEDULER_STATS
+typedef struct _mp_sched_stats_t {
+    mp_obj_t func; // MP_OBJ_NULL for the last entry, which counts the rest
+    uint32_t scheduled;
+    uint32_t dropped;
+} mp_sched_stats_t;
+#endif
+
+#if MICROPY_GC_ARENA
+// An arena is one heap chain: a bitmap of where each allocation starts,
+// followed by the blocks handed out by gc_alloc from start up to cur.
+typedef struct _mp_gc_arena_t {
+    byte *map; // the chain, NULL if this slot is unused
+    byte *start;
+    byte *cur;
+    byte *end;
+    bool open; // cleared when its block exits
+} mp_gc_arena_t;
+#endif
+
+// This structure holds the state of one contiguous region of the GC heap.
+typedef struct _mp_state_mem_area_t {
+    #if MICROPY_GC_SPLIT_HEAP
+    struct _mp_state_mem_area_t *next;
     #endif
 
     byte *gc_alloc_table_start;
@@ -77,8 +128,38 @@ typedef struct _mp_state_mem_t {
     byte *gc_pool_start;
     byte *gc_pool_end;
 
+    size_t gc_last_free_atb_index;
+    #if MICROPY_GC_RUN_HINTS
+    // no run of n free blocks starts below gc_last_run_atb_index[n - 2]
+    size_t gc_last_run_atb_index[MICROPY_GC_RUN_HINTS];
+    #endif
+} mp_state_mem_area_t;
+
+// This structure hold information about the memory allocation system.
+typedef struct _mp_state_mem_t {
+    #if MICROPY_MEM_STATS
+    size_t total_bytes_allocated;
+    size_t current_bytes_allocated;
+    size_t peak_bytes_allocated;
+    #endif
+
+    // the first region of the heap, from gc_init
+    mp_state_mem_area_t area;
+
     int gc_stack_overflow;
     MICROPY_GC_STACK_ENTRY_TYPE gc_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #if MICROPY_GC_SPLIT_HEAP
+    // the region each gc_stack entry belongs to
+    mp_state_mem_area_t *gc_area_stack[MICROPY_ALLOC_GC_STACK_SIZE];
+    #endif
+    #if MICROPY_GC_HEAP_STACK
+    // the stack used by the current collection, gc_stack or free heap blocks
+    MICROPY_GC_STACK_ENTRY_TYPE *gc_stack_start;
+    #if MICROPY_GC_SPLIT_HEAP
+    mp_state_mem_area_t **gc_area_stack_start;
+    #endif
+    size_t gc_stack_len;
+    #endif
     uint16_t gc_lock_depth;
 
     // This variable controls auto garbage collection.  If set to 0 then the
@@ -91,18 +172,91 @@ typedef struct _mp_state_mem_t {
     size_t gc_alloc_threshold;
     #endif
 
-    size_t gc_last_free_atb_index;
-
     #if MICROPY_PY_GC_COLLECT_RETVAL
     size_t gc_collected;
     #endif
 
+    #if MICROPY_PY_MICROPYTHON_STATS
+    size_t gc_collections;
+    uint64_t gc_pause_us;
+    uint32_t gc_pause_max_us;
+    uint32_t gc_pause_start;
+    size_t gc_alloc_count;
+    uint64_t gc_alloc_bytes;
+    #endif
+
+    #if MICROPY_GC_MEM_PEAK
+    // blocks in use now, the most in use since gc_reset_peak, and the blocks
+    // allocated since then
+    size_t gc_used_blocks;
+    size_t gc_peak_blocks;
+    size_t gc_total_blocks;
+    #endif
+
+    #if MICROPY_GC_PROFILE
+    // allocations made outside bytecode, or once gc_profile_sites is full
+    size_t gc_profile_other_count;
+    size_t gc_profile_other_bytes;
+    #endif
+
+    #if MICROPY_GC_FREE_LISTS
+    // unmarked chains of 1 and 2 blocks kept by the sweep for reuse; these
+    // are not roots, so a collection frees whatever is left on them
+    void *gc_free_list[2][MICROPY_GC_FREE_LISTS];
+    uint8_t gc_free_list_len[2];
+    // set while the sweep may add to the lists
+    uint8_t gc_free_list_fill;
+    #endif
+
+    #if MICROPY_GC_FINALISER_LIST
+    // the chains allocated with a finaliser that aren't flagged in the FTB;
+    // these are not roots, an unmarked one is finalised and dropped
+    void *gc_finaliser_list[MICROPY_GC_FINALISER_LIST];
+    size_t gc_finaliser_list_len;
+    // set once a finaliser went to the FTB because the list was full
+    uint8_t gc_finaliser_ftb_used;
+    #endif
+
+    #if MICROPY_GC_ARENA
+    // arenas that are open or were closed since the last collection; a
+    // closed arena is freed by the next collection, or split into ordinary
+    // chains if anything points into it
+    mp_gc_arena_t gc_arena[MICROPY_GC_ARENA];
+    uint8_t gc_arena_count;
+    #endif
+
+    #if MICROPY_GC_INCREMENTAL_SWEEP
+    // where an unfinished sweep continues from; the area is NULL if none
+    mp_state_mem_area_t *gc_sweep_area;
+    size_t gc_sweep_block;
+    // set to leave the sweep of the next collection to gc_sweep_step
+    uint8_t gc_sweep_defer;
+    #endif
+
     #if MICROPY_PY_THREAD
     // This is a global mutex used to make the GC thread-safe.
     mp_thread_mutex_t gc_mutex;
     #endif
 } mp_state_mem_t;
 
+#if MICROPY_GC_PROFILE
+// Allocations made at one bytecode location, see gc.profile()
+typedef struct _mp_gc_profile_site_t {
+    const byte *bytecode; // NULL if the entry is unused
+    const byte *ip;
+    size_t count;
+    size_t bytes;
+} mp_gc_profile_site_t;
+#endif
+
+#if MICROPY_PROF_SAMPLES
+// Where the main thread was when the profiler sampled it, see mp_prof_sample()
+typedef struct _mp_prof_sample_t {
+    const byte *bytecode; // NULL if it was not running bytecode
+    const byte *ip;
+} mp_prof_sample_t;
+#endif
+
 // This structure hold runtime and VM information.  It includes a section
 // which contains root pointers that must be scanned by the GC.
 typedef struct _mp_state_vm_t {
@@ -141,7 +295,22 @@ typedef struct _mp_state_vm_t {
     volatile mp_obj_t mp_pending_exception;
 
     #if MICROPY_ENABLE_SCHEDULER
-    mp_sched_item_t sched_stack[MICROPY_SCHEDULER_DEPTH];
+    mp_sched_item_t sched_queue[MICROPY_SCHEDULER_DEPTH];
+    #if MICROPY_SCHEDULER_HIGH_DEPTH
+    mp_sched_item_t sched_queue_high[MICROPY_SCHEDULER_HIGH_DEPTH];
+    #endif
+    #if MICROPY_SCHEDULER_STATS
+    mp_sched_stats_t sched_stats[MICROPY_SCHEDULER_STATS];
+    #endif
+    #endif
+
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    mp_class_cache_entry_t class_cache[MICROPY_OPT_CACHE_CLASS_LOOKUP];
+    #endif
+
+    #if MICROPY_OPT_STR_CACHE
+    // recently made short str objects, shared by mp_obj_new_str
+    mp_obj_t str_cache[MICROPY_OPT_STR_CACHE];
     #endif
 
     // current exception being handled, for sys.exc_info()
@@ -161,6 +330,32 @@ typedef struct _mp_state_vm_t {
     mp_obj_dict_t *mp_module_builtins_override_dict;
     #endif
 
+    #if MICROPY_GC_PROFILE
+    // per-location allocation counts, which also keep the bytecode alive
+    mp_gc_profile_site_t gc_profile_sites[MICROPY_GC_PROFILE_SITES];
+    #endif
+
+    #if MICROPY_PROF_SAMPLES
+    // ring of profiler samples, which also keep the bytecode alive
+    mp_prof_sample_t prof_samples[MICROPY_PROF_SAMPLES];
+    #endif
+
+    #if MICROPY_MODULE_FROZEN_MPY_COMPRESSED
+    // pairs of compressed frozen bytecode and its expanded copy, most recent first
+    const byte *frozen_mpy_code_cache[2 * MICROPY_MODULE_FROZEN_MPY_COMPRESSED];
+    #endif
+
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    // byte offsets of every 32nd character for the str_index entries, or NULL
+    // if the str is all ASCII
+    uint32_t *str_index_offsets[MICROPY_OPT_STR_INDEX_CACHE];
+    #endif
+
+    #if MICROPY_OPT_STR_FORMAT_CACHE
+    // compiled format strings, most recently used first, see objstr.c
+    void *str_format_cache[MICROPY_OPT_STR_FORMAT_CACHE];
+    #endif
+
     // include any root pointers defined by a port
     MICROPY_PORT_ROOT_POINTERS
 
@@ -174,10 +369,31 @@ typedef struct _mp_state_vm_t {
     mp_obj_t dupterm_objs[MICROPY_PY_OS_DUPTERM];
     #endif
 
+    #if MICROPY_PY_URE && MICROPY_PY_URE_CACHE
+    mp_obj_t ure_cache[MICROPY_PY_URE_CACHE];
+    #endif
+
+    #if MICROPY_PY_USSL && MICROPY_PY_USSL_SESSION_CACHE
+    // pairs of server_hostname and ussl session
+    mp_obj_t ussl_session_cache[2 * MICROPY_PY_USSL_SESSION_CACHE];
+    #endif
+
+    #if MICROPY_PY_UCTYPES && MICROPY_PY_UCTYPES_LAYOUT_CACHE
+    void *uctypes_layout_cache[MICROPY_PY_UCTYPES_LAYOUT_CACHE];
+    #endif
+
     #if MICROPY_PY_LWIP_SLIP
     mp_obj_t lwip_slip_stream;
     #endif
 
+    #if MICROPY_PY_UHTTPC
+    mp_obj_t uhttpc_session;
+    #endif
+
+    #if MICROPY_PY_UASYNCIO
+    mp_obj_t uasyncio_loop;
+    #endif
+
     #if MICROPY_VFS
     struct _mp_vfs_mount_t *vfs_cur;
     struct _mp_vfs_mount_t *vfs_mount_table;
@@ -202,6 +418,18 @@ typedef struct _mp_state_vm_t {
     mp_uint_t mp_optimise_value;
     #endif
 
+    #if MICROPY_OPT_TIERED_NATIVE
+    // calls after which a function is made native, 0 to never do so, and
+    // the bytes of native code that may still be generated for this
+    uint16_t tier_native_calls;
+    size_t tier_native_budget;
+    #endif
+
+    #if MICROPY_MODULE_MPY_CACHE
+    // set while compiling code that will be saved to the .mpy cache
+    bool mpy_cache_compiling;
+    #endif
+
     // size of the emergency exception buf, if it's dynamically allocated
     #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF && MICROPY_EMERGENCY_EXCEPTION_BUF_SIZE == 0
     mp_int_t mp_emergency_exception_buf_size;
@@ -209,7 +437,43 @@ typedef struct _mp_state_vm_t {
 
     #if MICROPY_ENABLE_SCHEDULER
     volatile int16_t sched_state;
-    uint16_t sched_sp;
+    uint16_t sched_len;
+    uint16_t sched_idx;
+    #if MICROPY_SCHEDULER_HIGH_DEPTH
+    uint16_t sched_len_high;
+    uint16_t sched_idx_high;
+    #endif
+    #if MICROPY_SCHEDULER_STATS || MICROPY_PY_MICROPYTHON_STATS
+    uint16_t sched_max_len;
+    #endif
+    #if MICROPY_PY_MICROPYTHON_STATS
+    uint32_t sched_dropped;
+    uint32_t sched_latency_max_us;
+    #endif
+    #endif
+
+    #if MICROPY_VM_COUNT_OPCODES
+    uint64_t vm_opcode_count;
+    #endif
+
+    #if MICROPY_OPT_STR_CONCAT_INPLACE
+    // str/bytes buffers that may be appended to in place; not root pointers
+    // because gc_collect_end forgets those that weren't marked
+    mp_str_concat_buf_t str_concat_bufs[4];
+    size_t str_concat_buf_idx;
+    #endif
+
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    // indexed unicode strings; not root pointers because gc_collect_end
+    // forgets those that weren't marked
+    mp_str_index_t str_index[MICROPY_OPT_STR_INDEX_CACHE];
+    size_t str_index_idx;
+    #endif
+
+    #if MICROPY_PROF_SAMPLES
+    // next entry of prof_samples to write, and how many are valid
+    size_t prof_sample_idx;
+    size_t prof_sample_len;
     #endif
 
     #if MICROPY_PY_THREAD_GIL
@@ -234,6 +498,21 @@ typedef struct _mp_state_thread_t {
     uint8_t *pystack_cur;
     #endif
 
+    #if MICROPY_TRACK_CODE_STATE
+    // the bytecode function this thread is running, NULL outside bytecode
+    struct _mp_code_state_t *code_state;
+    #endif
+
+    #if MICROPY_PY_THREAD_STATS
+    // total time spent waiting for the GIL
+    uint64_t gil_wait_us;
+    #endif
+
+    #if MICROPY_GC_ARENA
+    // the arena gc_alloc takes memory from, NULL to use the heap
+    struct _mp_gc_arena_t *gc_arena;
+    #endif
+
     ////////////////////////////////////////////////////////////
     // START ROOT POINTER SECTION
     // Everything that needs GC scanning must start here, and
@@ -256,14 +535,24 @@ typedef struct _mp_state_ctx_t {
 
 extern mp_state_ctx_t mp_state_ctx;
 
-#define MP_STATE_VM(x) (mp_state_ctx.vm.x)
-#define MP_STATE_MEM(x) (mp_state_ctx.mem.x)
+#if MICROPY_STATE_CTX_PER_TASK
+// Each task can run its own VM; tasks that never set this use mp_state_ctx
+extern __thread mp_state_ctx_t *mp_state_ctx_ptr;
+#define MP_STATE_CTX (*mp_state_ctx_ptr)
+#define MP_STATE_CTX_IS_MAIN() (mp_state_ctx_ptr == &mp_state_ctx)
+#else
+#define MP_STATE_CTX (mp_state_ctx)
+#define MP_STATE_CTX_IS_MAIN() (1)
+#endif
+
+#define MP_STATE_VM(x) (MP_STATE_CTX.vm.x)
+#define MP_STATE_MEM(x) (MP_STATE_CTX.mem.x)
 
 #if MICROPY_PY_THREAD
 extern mp_state_thread_t *mp_thread_get_state(void);
 #define MP_STATE_THREAD(x) (mp_thread_get_state()->x)
 #else
-#define MP_STATE_THREAD(x) (mp_state_ctx.thread.x)
+#define MP_STATE_THREAD(x) (MP_STATE_CTX.thread.x)
 #endif
 
 #endif // MICROPY_INCLUDED_PY_MPSTATE_H
@@ -47,11 +47,48 @@ void mp_thread_mutex_init(mp_thread_mutex_t *mutex);
 int mp_thread_mutex_lock(mp_thread_mutex_t *mutex, int wait);
 void mp_thread_mutex_unlock(mp_thread_mutex_t *mutex);
 
+#if MICROPY_PY_THREAD_STATS
+#include "py/obj.h"
+mp_obj_t mp_thread_stats(void);
+#endif
+
+#if MICROPY_PY_THREAD_QUEUE
+#include "py/obj.h"
+// Copy len bytes onto a _thread.Queue without allocating.  This can be
+// called from ISRs and from tasks not holding the GIL.  Returns false if
+// the queue is full or len is more than its itemsize.
+bool mp_thread_queue_put(mp_obj_t queue, const void *data, size_t len);
+
+// Make a _thread.Queue in mp_thread_queue_mem_size() bytes of memory at mem,
+// which need not be on the GC heap.  capacity is 1..65535, itemsize 0..65535.
+size_t mp_thread_queue_mem_size(size_t capacity, size_t itemsize);
+mp_obj_t mp_thread_queue_init(void *mem, size_t capacity, size_t itemsize);
+
+// Port hooks for _thread.Queue.  ENTER/EXIT is a short critical section
+// that must also exclude ISRs and other cores.  WAIT(ms) blocks with the
+// GIL released until a NOTIFY of the thread's WAITER() handle, or up to ms.
+// NOTIFY is run inside the critical section.
+#ifndef MP_THREAD_QUEUE_ENTER
+#define MP_THREAD_QUEUE_ENTER() MICROPY_BEGIN_ATOMIC_SECTION()
+#define MP_THREAD_QUEUE_EXIT(state) MICROPY_END_ATOMIC_SECTION(state)
+#endif
+#ifndef MP_THREAD_QUEUE_WAIT
+#define MP_THREAD_QUEUE_WAITER() (NULL)
+#define MP_THREAD_QUEUE_WAIT(ms) do { MP_THREAD_GIL_EXIT(); mp_hal_delay_ms(1); MP_THREAD_GIL_ENTER(); } while (0)
+#define MP_THREAD_QUEUE_NOTIFY(waiter) (void)(waiter)
+#endif
+#endif
+
 #endif // MICROPY_PY_THREAD
 
 #if MICROPY_PY_THREAD && MICROPY_PY_THREAD_GIL
 #include "py/mpstate.h"
+#if MICROPY_PY_THREAD_STATS
+void mp_thread_gil_enter(void);
+#define MP_THREAD_GIL_ENTER() mp_thread_gil_enter()
+#else
 #define MP_THREAD_GIL_ENTER() mp_thread_mutex_lock(&MP_STATE_VM(gil_mutex), 1)
+#endif
 #define MP_THREAD_GIL_EXIT() mp_thread_mutex_unlock(&MP_STATE_VM(gil_mutex))
 #else
 #define MP_THREAD_GIL_ENTER()
@@ -449,6 +449,167 @@ STATIC size_t mpn_mul(mpz_dig_t *idig, mpz_dig_t *jdig, size_t jlen, mpz_dig_t *
     return ilen;
 }
 
+#if MICROPY_OPT_MPZ_KARATSUBA || MICROPY_OPT_MPZ_MONTGOMERY
+
+/* The functions below work on fixed-length digit arrays: leading zero digits
+   are allowed in the inputs and kept in the outputs.
+*/
+
+/* computes i += j, where i has ilen digits and j has jlen <= ilen digits
+   returns the carry out of the most significant digit of i
+*/
+STATIC mpz_dig_t mpn_add_into(mpz_dig_t *idig, size_t ilen, const mpz_dig_t *jdig, size_t jlen) {
+    mpz_dbl_dig_t carry = 0;
+    size_t i = 0;
+    for (; i < jlen; ++i) {
+        carry += (mpz_dbl_dig_t)idig[i] + (mpz_dbl_dig_t)jdig[i];
+        idig[i] = carry & DIG_MASK;
+        carry >>= DIG_SIZE;
+    }
+    for (; carry != 0 && i < ilen; ++i) {
+        carry += idig[i];
+        idig[i] = carry & DIG_MASK;
+        carry >>= DIG_SIZE;
+    }
+    return carry;
+}
+
+/* computes i -= j, where i has ilen digits and j has jlen <= ilen digits
+   returns the borrow out of the most significant digit of i
+*/
+STATIC mpz_dig_t mpn_sub_from(mpz_dig_t *idig, size_t ilen, const mpz_dig_t *jdig, size_t jlen) {
+    mpz_dbl_dig_signed_t borrow = 0;
+    size_t i = 0;
+    for (; i < jlen; ++i) {
+        borrow += (mpz_dbl_dig_signed_t)idig[i] - (mpz_dbl_dig_signed_t)jdig[i];
+        idig[i] = borrow & DIG_MASK;
+        borrow = borrow < 0 ? -1 : 0;
+    }
+    for (; borrow != 0 && i < ilen; ++i) {
+        borrow += idig[i];
+        idig[i] = borrow & DIG_MASK;
+        borrow = borrow < 0 ? -1 : 0;
+    }
+    return -borrow;
+}
+
+/* computes i = j * k, where i has exactly jlen + klen digits
+   i must not overlap j or k
+*/
+STATIC void mpn_mul_basecase(mpz_dig_t *idig, const mpz_dig_t *jdig, size_t jlen, const mpz_dig_t *kdig, size_t klen) {
+    memset(idig, 0, (jlen + klen) * sizeof(mpz_dig_t));
+    for (size_t k = 0; k < klen; ++k) {
+        mpz_dbl_dig_t carry = 0;
+        for (size_t j = 0; j < jlen; ++j) {
+            carry += (mpz_dbl_dig_t)idig[j + k] + (mpz_dbl_dig_t)jdig[j] * (mpz_dbl_dig_t)kdig[k]; // will never overflow so long as DIG_SIZE <= 8*sizeof(mpz_dbl_dig_t)/2
+            idig[j + k] = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+        idig[jlen + k] = carry;
+    }
+}
+
+#endif
+
+#if MICROPY_OPT_MPZ_KARATSUBA
+
+/* returns the number of scratch digits mpn_mul_karatsuba needs for n digits
+*/
+STATIC size_t mpn_karatsuba_tmp_len(size_t n) {
+    size_t tmp_len = 0;
+    while (n >= MICROPY_OPT_MPZ_KARATSUBA) {
+        size_t hi = n - n / 2;
+        tmp_len += 4 * hi + 4;
+        n = hi + 1;
+    }
+    return tmp_len;
+}
+
+/* computes i = j * k, where j and k have n digits and i has 2n digits
+   i must not overlap j, k or tmp, which has mpn_karatsuba_tmp_len(n) digits
+   can have j, k point to same memory
+*/
+STATIC void mpn_mul_karatsuba(mpz_dig_t *idig, const mpz_dig_t *jdig, const mpz_dig_t *kdig, size_t n, mpz_dig_t *tmp) {
+    if (n < MICROPY_OPT_MPZ_KARATSUBA) {
+        mpn_mul_basecase(idig, jdig, n, kdig, n);
+        return;
+    }
+
+    // split j = j1 * B^lo + j0, and likewise k, with j0 having lo digits
+    size_t lo = n / 2;
+    size_t hi = n - lo;
+
+    // i = j1 * k1 * B^2lo + j0 * k0
+    mpn_mul_karatsuba(idig, jdig, kdig, lo, tmp);
+    mpn_mul_karatsuba(idig + 2 * lo, jdig + lo, kdig + lo, hi, tmp);
+
+    // mid = (j0 + j1) * (k0 + k1) - j0 * k0 - j1 * k1 = j0 * k1 + j1 * k0
+    mpz_dig_t *jsum = tmp;
+    mpz_dig_t *ksum = tmp + hi + 1;
+    mpz_dig_t *mid = tmp + 2 * hi + 2;
+    memcpy(jsum, jdig + lo, hi * sizeof(mpz_dig_t));
+    jsum[hi] = 0;
+    mpn_add_into(jsum, hi + 1, jdig, lo);
+    memcpy(ksum, kdig + lo, hi * sizeof(mpz_dig_t));
+    ksum[hi] = 0;
+    mpn_add_into(ksum, hi + 1, kdig, lo);
+    mpn_mul_karatsuba(mid, jsum, ksum, hi + 1, tmp + 4 * hi + 4);
+    mpn_sub_from(mid, 2 * hi + 2, idig, 2 * lo);
+    mpn_sub_from(mid, 2 * hi + 2, idig + 2 * lo, 2 * hi);
+
+    // i += mid * B^lo; the top digits of mid beyond i are zero
+    mpn_add_into(idig + lo, 2 * n - lo, mid, MIN(2 * hi + 2, 2 * n - lo));
+}
+
+/* computes i = j * k
+   returns number of digits in i
+   assumes i is zeroed and has jlen + klen digits; assumes normalised j, k
+   each having at least MICROPY_OPT_MPZ_KARATSUBA digits
+   can have j, k point to same memory
+*/
+STATIC size_t mpn_mul_big(mpz_dig_t *idig, const mpz_dig_t *jdig, size_t jlen, const mpz_dig_t *kdig, size_t klen) {
+    if (jlen < klen) {
+        const mpz_dig_t *t = jdig; jdig = kdig; kdig = t;
+        size_t tl = jlen; jlen = klen; klen = tl;
+    }
+
+    // multiply k by each klen-digit chunk of j
+    size_t tmp_len = 2 * klen + mpn_karatsuba_tmp_len(klen);
+    mpz_dig_t *prod = m_new(mpz_dig_t, tmp_len);
+    size_t off = 0;
+    for (; off + klen <= jlen; off += klen) {
+        mpn_mul_karatsuba(prod, jdig + off, kdig, klen, prod + 2 * klen);
+        mpn_add_into(idig + off, jlen + klen - off, prod, 2 * klen);
+    }
+    if (off < jlen) {
+        mpn_mul_basecase(prod, jdig + off, jlen - off, kdig, klen);
+        mpn_add_into(idig + off, jlen + klen - off, prod, jlen - off + klen);
+    }
+    m_del(mpz_dig_t, prod, tmp_len);
+
+    size_t ilen = jlen + klen;
+    while (ilen > 0 && idig[ilen - 1] == 0) {
+        --ilen;
+    }
+    return ilen;
+}
+
+#endif
+
+/* returns the largest power of base that fits in a digit, and the exponent
+   in *chunk_len, so that conversions to and from strings can handle that
+   many characters with each pass over the digits
+*/
+STATIC mpz_dig_t mpn_chunk_base(unsigned int base, unsigned int *chunk_len) {
+    mpz_dig_t chunk_base = base;
+    *chunk_len = 1;
+    while ((mpz_dbl_dig_t)chunk_base * base <= DIG_MASK) {
+        chunk_base *= base;
+        ++*chunk_len;
+    }
+    return chunk_base;
+}
+
 /* natural_div - quo * den + new_num = old_num (ie num is replaced with rem)
    assumes den != 0
    assumes num_dig has enough memory to be extended by 1 digit
@@ -855,6 +1016,14 @@ size_t mpz_set_from_str(mpz_t *z, const char *str, size_t len, bool neg, unsigne
         z->neg = 0;
     }
 
+    // accumulate up to chunk_len characters at a time in acc, then do
+    // z = z * base ** n + acc
+    unsigned int chunk_len;
+    mpn_chunk_base(base, &chunk_len);
+    mpz_dig_t acc = 0;
+    mpz_dig_t acc_mul = 1;
+    unsigned int acc_len = 0;
+
     z->len = 0;
     for (; cur < top; ++cur) { // XXX UTF8 next char
         //mp_uint_t v = char_to_numeric(cur#); // XXX UTF8 get char
@@ -871,7 +1040,17 @@ size_t mpz_set_from_str(mpz_t *z, const char *str, size_t len, bool neg, unsigne
         if (v >= base) {
             break;
         }
-        z->len = mpn_mul_dig_add_dig(z->dig, z->len, base, v);
+        acc = acc * base + v;
+        acc_mul *= base;
+        if (++acc_len == chunk_len) {
+            z->len = mpn_mul_dig_add_dig(z->dig, z->len, acc_mul, acc);
+            acc = 0;
+            acc_mul = 1;
+            acc_len = 0;
+        }
+    }
+    if (acc_len != 0) {
+        z->len = mpn_mul_dig_add_dig(z->dig, z->len, acc_mul, acc);
     }
 
     return cur - str;
@@ -1314,7 +1493,14 @@ void mpz_mul_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs) {
 
     mpz_need_dig(dest, lhs->len + rhs->len); // min mem l+r-1, max mem l+r
     memset(dest->dig, 0, dest->alloc * sizeof(mpz_dig_t));
-    dest->len = mpn_mul(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    #if MICROPY_OPT_MPZ_KARATSUBA
+    if (lhs->len >= MICROPY_OPT_MPZ_KARATSUBA && rhs->len >= MICROPY_OPT_MPZ_KARATSUBA) {
+        dest->len = mpn_mul_big(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    } else
+    #endif
+    {
+        dest->len = mpn_mul(dest->dig, lhs->dig, lhs->len, rhs->dig, rhs->len);
+    }
 
     if (lhs->neg == rhs->neg) {
         dest->neg = 0;
@@ -1359,6 +1545,120 @@ void mpz_pow_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs) {
     mpz_free(n);
 }
 
+#if MICROPY_OPT_MPZ_MONTGOMERY
+
+/* computes i = j * k * B^-n mod m, where j, k < m and all have n digits
+   (B is the digit base); minv is -1/m mod B and m must be odd
+   tmp must have 2n + 1 digits, plus mpn_karatsuba_tmp_len(n) if enabled
+   can have i, j, k point to same memory
+*/
+STATIC void mpn_mont_mul(mpz_dig_t *idig, const mpz_dig_t *jdig, const mpz_dig_t *kdig,
+    const mpz_dig_t *mdig, size_t n, mpz_dig_t minv, mpz_dig_t *tmp) {
+    #if MICROPY_OPT_MPZ_KARATSUBA
+    if (n >= MICROPY_OPT_MPZ_KARATSUBA) {
+        mpn_mul_karatsuba(tmp, jdig, kdig, n, tmp + 2 * n + 1);
+    } else
+    #endif
+    {
+        mpn_mul_basecase(tmp, jdig, n, kdig, n);
+    }
+    tmp[2 * n] = 0;
+
+    // add multiples of m to clear the low n digits, then divide by B^n
+    for (size_t i = 0; i < n; ++i) {
+        mpz_dig_t u = ((mpz_dbl_dig_t)tmp[i] * minv) & DIG_MASK;
+        mpz_dbl_dig_t carry = 0;
+        for (size_t j = 0; j < n; ++j) {
+            carry += (mpz_dbl_dig_t)tmp[i + j] + (mpz_dbl_dig_t)u * (mpz_dbl_dig_t)mdig[j];
+            tmp[i + j] = carry & DIG_MASK;
+            carry >>= DIG_SIZE;
+        }
+        mpz_dig_t top = carry;
+        mpn_add_into(tmp + i + n, n + 1 - i, &top, 1);
+    }
+
+    // the result is less than 2m so at most one subtraction is needed
+    mpz_dig_t *r = tmp + n;
+    if (r[n] == 0) {
+        size_t j = n;
+        while (j > 0 && r[j - 1] == mdig[j - 1]) {
+            --j;
+        }
+        if (j > 0 && r[j - 1] < mdig[j - 1]) {
+            memcpy(idig, r, n * sizeof(mpz_dig_t));
+            return;
+        }
+    }
+    mpn_sub_from(r, n + 1, mdig, n);
+    memcpy(idig, r, n * sizeof(mpz_dig_t));
+}
+
+/* computes dest = (lhs ** rhs) % mod for odd, positive mod, with rhs > 0
+   can have dest, lhs, rhs the same; mod can't be the same as dest
+*/
+STATIC void mpz_pow3_mont(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t *mod) {
+    size_t n = mod->len;
+    const mpz_dig_t *mdig = mod->dig;
+
+    // -1/m mod B by Newton's iteration, each step doubling the correct bits
+    mpz_dbl_dig_t inv = mdig[0]; // correct to 3 bits as m is odd
+    for (int i = 0; i < 5; ++i) {
+        inv = (inv * (2 - mdig[0] * inv)) & DIG_MASK;
+    }
+    mpz_dig_t minv = (0 - inv) & DIG_MASK;
+
+    // x = lhs * B^n mod m and r = B^n mod m are lhs and 1 in Montgomery form
+    size_t tmp_len = 2 * n + 1;
+    #if MICROPY_OPT_MPZ_KARATSUBA
+    tmp_len += mpn_karatsuba_tmp_len(n);
+    #endif
+    size_t buf_len = 3 * n + tmp_len;
+    mpz_dig_t *x = m_new0(mpz_dig_t, buf_len);
+    mpz_dig_t *r = x + n;
+    mpz_dig_t *one = r + n;
+    mpz_dig_t *tmp = one + n;
+    {
+        mpz_t quo; mpz_init_zero(&quo);
+        mpz_t rem; mpz_init_zero(&rem);
+        mpz_divmod_inpl(&quo, &rem, lhs, mod);
+        mpz_shl_inpl(&rem, &rem, n * DIG_SIZE);
+        mpz_divmod_inpl(&quo, &rem, &rem, mod);
+        memcpy(x, rem.dig, rem.len * sizeof(mpz_dig_t));
+        mpz_set_from_int(&rem, 1);
+        mpz_shl_inpl(&rem, &rem, n * DIG_SIZE);
+        mpz_divmod_inpl(&quo, &rem, &rem, mod);
+        memcpy(r, rem.dig, rem.len * sizeof(mpz_dig_t));
+        mpz_deinit(&quo);
+        mpz_deinit(&rem);
+    }
+
+    // left-to-right binary exponentiation over the bits of rhs
+    for (size_t i = rhs->len; i-- > 0;) {
+        mpz_dig_t d = rhs->dig[i];
+        for (mpz_dig_t bit = DIG_MSB; bit != 0; bit >>= 1) {
+            mpn_mont_mul(r, r, r, mdig, n, minv, tmp);
+            if (d & bit) {
+                mpn_mont_mul(r, r, x, mdig, n, minv, tmp);
+            }
+        }
+    }
+
+    // convert back from Montgomery form
+    one[0] = 1;
+    mpn_mont_mul(r, r, one, mdig, n, minv, tmp);
+
+    mpz_need_dig(dest, n);
+    memcpy(dest->dig, r, n * sizeof(mpz_dig_t));
+    dest->len = n;
+    while (dest->len > 0 && dest->dig[dest->len - 1] == 0) {
+        --dest->len;
+    }
+    dest->neg = 0;
+    m_del(mpz_dig_t, x, buf_len);
+}
+
+#endif
+
 /* computes dest = (lhs ** rhs) % mod
    can have dest, lhs, rhs the same; mod can't be the same as dest
 */
@@ -1368,6 +1668,13 @@ void mpz_pow3_inpl(mpz_t *dest, const mpz_t *lhs, const mpz_t *rhs, const mpz_t
         return;
     }
 
+    #if MICROPY_OPT_MPZ_MONTGOMERY
+    if (rhs->len != 0 && mod->len >= 2 && mod->neg == 0 && (mod->dig[0] & 1) != 0) {
+        mpz_pow3_mont(dest, lhs, rhs, mod);
+        return;
+    }
+    #endif
+
     mpz_set_from_int(dest, 1);
 
     if (rhs->len == 0) {
@@ -1668,9 +1975,14 @@ size_t mpz_as_str_inpl(const mpz_t *i, unsigned int base, const char *prefix, ch
     }
 
     // make a copy of mpz digits, so we can do the div/mod calculation
-    mpz_dig_t *dig = m_new(mpz_dig_t, ilen);
+    size_t dig_alloc = ilen;
+    mpz_dig_t *dig = m_new(mpz_dig_t, dig_alloc);
     memcpy(dig, i->dig, ilen * sizeof(mpz_dig_t));
 
+    // divide by a power of base each pass, giving chunk_len characters
+    unsigned int chunk_len;
+    mpz_dig_t chunk_base = mpn_chunk_base(base, &chunk_len);
+
     // convert
     char *last_comma = str;
     bool done;
@@ -1681,34 +1993,36 @@ size_t mpz_as_str_inpl(const mpz_t *i, unsigned int base, const char *prefix, ch
         // compute next remainder
         while (--d >= dig) {
             a = (a << DIG_SIZE) | *d;
-            *d = a / base;
-            a %= base;
+            *d = a / chunk_base;
+            a %= chunk_base;
         }
 
-        // convert to character
-        a += '0';
-        if (a > '9') {
-            a += base_char - '9' - 1;
+        // drop leading zero digits, and check if number is zero
+        while (ilen > 0 && dig[ilen - 1] == 0) {
+            --ilen;
         }
-        *s++ = a;
-
-        // check if number is zero
-        done = true;
-        for (d = dig; d < dig + ilen; ++d) {
-            if (*d != 0) {
-                done = false;
-                break;
+        done = ilen == 0;
+
+        // convert to characters, without leading zeros for the last chunk
+        for (unsigned int n = 0; n < chunk_len && !(done && a == 0); ++n) {
+            mpz_dig_t c = a % base + '0';
+            a /= base;
+            if (c > '9') {
+                c += base_char - '9' - 1;
+            }
+            *s++ = c;
+
+            // no comma before the most significant character
+            if (comma && (s - last_comma) == 3 && !(done && a == 0)) {
+                *s++ = comma;
+                last_comma = s;
             }
-        }
-        if (comma && (s - last_comma) == 3) {
-            *s++ = comma;
-            last_comma = s;
         }
     }
     while (!done);
 
     // free the copy of the digits array
-    m_del(mpz_dig_t, dig, ilen);
+    m_del(mpz_dig_t, dig, dig_alloc);
 
     if (prefix) {
         const char *p = &prefix[strlen(prefix)];
@@ -39,7 +39,7 @@
 #define DEBUG_printf(...) (void)0
 #endif
 
-#if MICROPY_EMIT_NATIVE
+#if MICROPY_EMIT_MACHINE_CODE
 
 int mp_native_type_from_qstr(qstr qst) {
     switch (qst) {
@@ -51,6 +51,9 @@ int mp_native_type_from_qstr(qstr qst) {
         case MP_QSTR_ptr8: return MP_NATIVE_TYPE_PTR8;
         case MP_QSTR_ptr16: return MP_NATIVE_TYPE_PTR16;
         case MP_QSTR_ptr32: return MP_NATIVE_TYPE_PTR32;
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case MP_QSTR_ptrf32: return MP_NATIVE_TYPE_PTRF32;
+        #endif
         default: return -1;
     }
 }
@@ -63,6 +66,12 @@ mp_uint_t mp_native_from_obj(mp_obj_t obj, mp_uint_t type) {
         case MP_NATIVE_TYPE_BOOL:
         case MP_NATIVE_TYPE_INT:
         case MP_NATIVE_TYPE_UINT: return mp_obj_get_int_truncated(obj);
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case MP_NATIVE_TYPE_FLOAT32: {
+            union { float f; uint32_t u; } val = {mp_obj_get_float(obj)};
+            return val.u;
+        }
+        #endif
         default: { // cast obj to a pointer
             mp_buffer_info_t bufinfo;
             if (mp_get_buffer(obj, &bufinfo, MP_BUFFER_RW)) {
@@ -77,7 +86,7 @@ mp_uint_t mp_native_from_obj(mp_obj_t obj, mp_uint_t type) {
 
 #endif
 
-#if MICROPY_EMIT_NATIVE || MICROPY_EMIT_INLINE_ASM
+#if MICROPY_EMIT_MACHINE_CODE || MICROPY_EMIT_INLINE_ASM
 
 // convert a native value to a MicroPython object based on type
 mp_obj_t mp_native_to_obj(mp_uint_t val, mp_uint_t type) {
@@ -87,6 +96,12 @@ mp_obj_t mp_native_to_obj(mp_uint_t val, mp_uint_t type) {
         case MP_NATIVE_TYPE_BOOL: return mp_obj_new_bool(val);
         case MP_NATIVE_TYPE_INT: return mp_obj_new_int(val);
         case MP_NATIVE_TYPE_UINT: return mp_obj_new_int_from_uint(val);
+        #if MICROPY_PY_BUILTINS_FLOAT
+        case MP_NATIVE_TYPE_FLOAT32: {
+            union { uint32_t u; float f; } f = {val};
+            return mp_obj_new_float(f.f);
+        }
+        #endif
         default: // a pointer
             // we return just the value of the pointer as an integer
             return mp_obj_new_int_from_uint(val);
@@ -95,7 +110,7 @@ mp_obj_t mp_native_to_obj(mp_uint_t val, mp_uint_t type) {
 
 #endif
 
-#if MICROPY_EMIT_NATIVE
+#if MICROPY_EMIT_MACHINE_CODE
 
 mp_obj_dict_t *mp_native_swap_globals(mp_obj_dict_t *new_globals) {
     if (new_globals == NULL) {
@@ -251,4 +266,4 @@ void mp_f_vector(mp_fun_kind_t fun_kind) {
 }
 */
 
-#endif // MICROPY_EMIT_NATIVE
+#endif // MICROPY_EMIT_MACHINE_CODE
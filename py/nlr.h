@@ -55,6 +55,9 @@
 #elif defined(__thumb2__) || defined(__thumb__) || defined(__arm__)
     #define MICROPY_NLR_THUMB (1)
     #define MICROPY_NLR_NUM_REGS (10)
+#elif defined(__xtensa__) && defined(__XTENSA_WINDOWED_ABI__)
+    #define MICROPY_NLR_XTENSAWIN (1)
+    #define MICROPY_NLR_NUM_REGS (9)
 #elif defined(__xtensa__)
     #define MICROPY_NLR_XTENSA (1)
     #define MICROPY_NLR_NUM_REGS (10)
@@ -0,0 +1,115 @@
+/*
+ * This file is part of the MicroPython project, http://micropython.org/
+ *
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2019 Artec Co., Ltd.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "py/mpstate.h"
+
+#if MICROPY_NLR_XTENSAWIN
+
+#include <xtensa/hal.h>
+
+#undef nlr_push
+
+// Xtensa windowed-ABI calling conventions, as seen by a function called with
+// call8 that does not execute an entry instruction (so it still runs in its
+// caller's register window):
+//  a0-a7 = the caller's registers, preserved across the call
+//  a8 = return address, with the window increment in the top 2 bits
+//  a10 = first arg, and return value
+//  a9, a11-a15 = free to use
+//
+// nlr_push saves the caller's a0-a7 and the return address without touching
+// the stack or spilling any register windows, which is what makes it cheaper
+// than setjmp.  The cost is moved to nlr_jump, which spills all windows to
+// the stack and then returns into the nlr_push caller through a window
+// underflow that reloads the saved registers.
+//
+// The function that calls nlr_push must not change its stack pointer with
+// alloca after the call, because nlr_jump uses the stack pointer saved by
+// nlr_push to find the caller's register save areas.
+
+__asm (
+    "    .text                      \n"
+    "    .literal_position          \n"
+    "    .align  4                  \n"
+    "    .global nlr_push           \n"
+    "    .type   nlr_push, @function\n"
+    "nlr_push:                      \n"
+    "    s32i.n  a0, a10, 8         \n" // save caller's regs...
+    "    s32i.n  a1, a10, 12        \n"
+    "    s32i.n  a2, a10, 16        \n"
+    "    s32i.n  a3, a10, 20        \n"
+    "    s32i.n  a4, a10, 24        \n"
+    "    s32i.n  a5, a10, 28        \n"
+    "    s32i.n  a6, a10, 32        \n"
+    "    s32i.n  a7, a10, 36        \n"
+    "    s32i.n  a8, a10, 40        \n" // ...and the return address
+    "    movi    a9, nlr_push_tail  \n" // do the rest in C, as though the
+    "    jx      a9                 \n" // caller had called it directly
+    "    .size   nlr_push, .-nlr_push\n"
+);
+
+NORETURN void nlr_jump(void *val) {
+    MP_NLR_JUMP_HEAD(val, top)
+
+    // Move the register windows of all callers to their save areas on the
+    // stack, so the frames above the nlr_push caller can be reloaded later
+    xthal_window_spill();
+
+    __asm volatile (
+    "mov.n   a3, %0             \n" // a3 points to nlr_buf
+    "l32i.n  a4, a3, 12         \n" // a4 = sp of nlr_push caller
+    "addi    a4, a4, -16        \n"
+    "l32i.n  a5, a4, 4          \n" // a5 = sp of its caller
+    "addi    a5, a5, -32        \n" // restore its a4-a7 to the extra save area
+    "l32i.n  a6, a3, 24         \n" // in its frame, for the underflow handler
+    "s32i.n  a6, a5, 0          \n"
+    "l32i.n  a6, a3, 28         \n"
+    "s32i.n  a6, a5, 4          \n"
+    "l32i.n  a6, a3, 32         \n"
+    "s32i.n  a6, a5, 8          \n"
+    "l32i.n  a6, a3, 36         \n"
+    "s32i.n  a6, a5, 12         \n"
+    "addi    a4, a1, -16        \n" // restore its a0-a3 to the base save area
+    "l32i.n  a6, a3, 8          \n" // below our sp, as though it called us
+    "s32i.n  a6, a4, 0          \n"
+    "l32i.n  a6, a3, 12         \n"
+    "s32i.n  a6, a4, 4          \n"
+    "l32i.n  a6, a3, 16         \n"
+    "s32i.n  a6, a4, 8          \n"
+    "l32i.n  a6, a3, 20         \n"
+    "s32i.n  a6, a4, 12         \n"
+    "l32i.n  a0, a3, 40         \n" // return address into nlr_push caller
+    "movi.n  a2, 1              \n" // return 1, non-local return
+    "retw.n                     \n" // return, reloading its window
+    :                               // output operands
+    : "r"(top)                      // input operands
+    : "memory"                      // clobbered registers
+    );
+
+    for (;;); // needed to silence compiler warning
+}
+
+#endif // MICROPY_NLR_XTENSAWIN
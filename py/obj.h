@@ -354,7 +354,12 @@ typedef struct _mp_map_t {
     size_t all_keys_are_qstrs : 1;
     size_t is_fixed : 1;    // a fixed array that can't be modified; must also be ordered
     size_t is_ordered : 1;  // an ordered array
+    #if MICROPY_OPT_MAP_INT_KEYS
+    size_t all_keys_are_small_ints : 1;
+    size_t used : (8 * sizeof(size_t) - 4);
+    #else
     size_t used : (8 * sizeof(size_t) - 3);
+    #endif
     size_t alloc;
     mp_map_elem_t *table;
 } mp_map_t;
@@ -373,6 +378,7 @@ static inline bool mp_map_slot_is_filled(const mp_map_t *map, size_t pos) { retu
 
 void mp_map_init(mp_map_t *map, size_t n);
 void mp_map_init_fixed_table(mp_map_t *map, size_t n, const mp_obj_t *table);
+void mp_map_init_copy(mp_map_t *map, const mp_map_t *src);
 mp_map_t *mp_map_new(size_t n);
 void mp_map_deinit(mp_map_t *map);
 void mp_map_free(mp_map_t *map);
@@ -384,7 +390,12 @@ void mp_map_dump(mp_map_t *map);
 
 typedef struct _mp_set_t {
     size_t alloc;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    size_t all_keys_are_small_ints : 1;
+    size_t used : (8 * sizeof(size_t) - 1);
+    #else
     size_t used;
+    #endif
     mp_obj_t *table;
 } mp_set_t;
 
@@ -654,6 +665,9 @@ mp_obj_t mp_obj_new_exception_arg1(const mp_obj_type_t *exc_type, mp_obj_t arg);
 mp_obj_t mp_obj_new_exception_args(const mp_obj_type_t *exc_type, size_t n_args, const mp_obj_t *args);
 mp_obj_t mp_obj_new_exception_msg(const mp_obj_type_t *exc_type, const char *msg);
 mp_obj_t mp_obj_new_exception_msg_varg(const mp_obj_type_t *exc_type, const char *fmt, ...); // counts args by number of % symbols in fmt, excluding %%; can only handle void* sizes (ie no float/double!)
+#if MICROPY_PREALLOC_EXCEPTIONS
+mp_obj_t mp_obj_new_exception_oserror_prealloc(int errno_); // returns MP_OBJ_NULL if errno_ has no preallocated instance
+#endif
 mp_obj_t mp_obj_new_fun_bc(mp_obj_t def_args, mp_obj_t def_kw_args, const byte *code, const mp_uint_t *const_table);
 mp_obj_t mp_obj_new_fun_native(mp_obj_t def_args_in, mp_obj_t def_kw_args, const void *fun_data, const mp_uint_t *const_table);
 mp_obj_t mp_obj_new_fun_asm(size_t n_args, const void *fun_data, mp_uint_t type_sig);
@@ -109,6 +109,10 @@ STATIC mp_obj_array_t *array_new(char typecode, size_t n) {
     o->items = m_new(byte, typecode_size * o->len);
     return o;
 }
+
+mp_obj_t mp_obj_new_array(char typecode, size_t n) {
+    return MP_OBJ_FROM_PTR(array_new(typecode, n));
+}
 #endif
 
 #if MICROPY_PY_BUILTINS_BYTEARRAY || MICROPY_PY_ARRAY
@@ -49,4 +49,8 @@ typedef struct _mp_obj_array_t {
     void *items;
 } mp_obj_array_t;
 
+// Create a new array.array (or a bytearray, for BYTEARRAY_TYPECODE) of n
+// elements, which are not initialised
+mp_obj_t mp_obj_new_array(char typecode, size_t n);
+
 #endif // MICROPY_INCLUDED_PY_OBJARRAY_H
@@ -31,20 +31,49 @@
 #if MICROPY_PY_COLLECTIONS_DEQUE
 
 #include "py/runtime.h"
+#include "py/binary.h"
 
 typedef struct _mp_obj_deque_t {
     mp_obj_base_t base;
     size_t alloc;
     size_t i_get;
     size_t i_put;
-    mp_obj_t *items;
+    void *items;
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+    uint16_t itemsz;
+    char typecode; // 0 for a deque of objects
+    #endif
     uint32_t flags;
     #define FLAG_CHECK_OVERFLOW 1
 } mp_obj_deque_t;
 
+#if MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+#define DEQUE_ITEMSZ(self) ((self)->itemsz)
+#else
+#define DEQUE_ITEMSZ(self) (sizeof(mp_obj_t))
+#endif
+
 STATIC mp_obj_t deque_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     mp_arg_check_num(n_args, n_kw, 2, 3, false);
 
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+    char typecode = 0;
+    size_t itemsz = sizeof(mp_obj_t);
+    if (mp_obj_is_str(args[0])) {
+        // A typecode as used by array, eg deque('f', 64), in which case the
+        // items are stored unboxed
+        size_t l;
+        const char *s = mp_obj_str_get_data(args[0], &l);
+        itemsz = 0;
+        if (l == 1 && s[0] != 'O') {
+            itemsz = mp_binary_get_size('@', s[0], NULL);
+        }
+        if (itemsz == 0) {
+            mp_raise_ValueError("bad typecode");
+        }
+        typecode = s[0];
+    } else
+    #endif
     /* Initialization from existing sequence is not supported, so an empty
        tuple must be passed as such. */
     if (args[0] != mp_const_empty_tuple) {
@@ -61,7 +90,12 @@ STATIC mp_obj_t deque_make_new(const mp_obj_type_t *type, size_t n_args, size_t
     o->base.type = type;
     o->alloc = maxlen + 1;
     o->i_get = o->i_put = 0;
-    o->items = m_new0(mp_obj_t, o->alloc);
+    o->flags = 0;
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+    o->typecode = typecode;
+    o->itemsz = itemsz;
+    #endif
+    o->items = m_new0(byte, o->alloc * DEQUE_ITEMSZ(o));
 
     if (n_args > 2) {
         o->flags = mp_obj_get_int(args[2]);
@@ -70,21 +104,46 @@ STATIC mp_obj_t deque_make_new(const mp_obj_type_t *type, size_t n_args, size_t
     return MP_OBJ_FROM_PTR(o);
 }
 
+STATIC inline mp_obj_t deque_get_item(mp_obj_deque_t *self, size_t i) {
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+    if (self->typecode != 0) {
+        return mp_binary_get_val_array(self->typecode, self->items, i);
+    }
+    #endif
+    return ((mp_obj_t*)self->items)[i];
+}
+
+// Storing MP_OBJ_NULL clears a slot so the GC doesn't retain a removed object
+STATIC inline void deque_set_item(mp_obj_deque_t *self, size_t i, mp_obj_t value) {
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+    if (self->typecode != 0) {
+        if (value != MP_OBJ_NULL) {
+            mp_binary_set_val_array(self->typecode, self->items, i, value);
+        }
+        return;
+    }
+    #endif
+    ((mp_obj_t*)self->items)[i] = value;
+}
+
+STATIC size_t deque_len(mp_obj_deque_t *self) {
+    ssize_t len = self->i_put - self->i_get;
+    if (len < 0) {
+        len += self->alloc;
+    }
+    return len;
+}
+
 STATIC mp_obj_t deque_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
     switch (op) {
         case MP_UNARY_OP_BOOL:
             return mp_obj_new_bool(self->i_get != self->i_put);
-        case MP_UNARY_OP_LEN: {
-            ssize_t len = self->i_put - self->i_get;
-            if (len < 0) {
-                len += self->alloc;
-            }
-            return MP_OBJ_NEW_SMALL_INT(len);
-        }
+        case MP_UNARY_OP_LEN:
+            return MP_OBJ_NEW_SMALL_INT(deque_len(self));
         #if MICROPY_PY_SYS_GETSIZEOF
         case MP_UNARY_OP_SIZEOF: {
-            size_t sz = sizeof(*self) + sizeof(mp_obj_t) * self->alloc;
+            size_t sz = sizeof(*self) + DEQUE_ITEMSZ(self) * self->alloc;
             return MP_OBJ_NEW_SMALL_INT(sz);
         }
         #endif
@@ -105,7 +164,7 @@ STATIC mp_obj_t mp_obj_deque_append(mp_obj_t self_in, mp_obj_t arg) {
         mp_raise_msg(&mp_type_IndexError, "full");
     }
 
-    self->items[self->i_put] = arg;
+    deque_set_item(self, self->i_put, arg);
     self->i_put = new_i_put;
 
     if (self->i_get == new_i_put) {
@@ -118,6 +177,48 @@ STATIC mp_obj_t mp_obj_deque_append(mp_obj_t self_in, mp_obj_t arg) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_append_obj, mp_obj_deque_append);
 
+STATIC mp_obj_t deque_appendleft(mp_obj_t self_in, mp_obj_t arg) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+
+    size_t new_i_get = self->i_get;
+    if (new_i_get == 0) {
+        new_i_get = self->alloc;
+    }
+    new_i_get -= 1;
+
+    bool full = new_i_get == self->i_put;
+    if (full && self->flags & FLAG_CHECK_OVERFLOW) {
+        mp_raise_msg(&mp_type_IndexError, "full");
+    }
+
+    // the slot at i_put is always free, so the item can be stored (and
+    // converted, which may raise) before anything is dropped
+    deque_set_item(self, new_i_get, arg);
+    self->i_get = new_i_get;
+
+    if (full) {
+        // drop the item at the right end, as CPython does
+        if (self->i_put == 0) {
+            self->i_put = self->alloc;
+        }
+        self->i_put -= 1;
+        deque_set_item(self, self->i_put, MP_OBJ_NULL);
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_appendleft_obj, deque_appendleft);
+
+STATIC mp_obj_t deque_extend(mp_obj_t self_in, mp_obj_t arg_in) {
+    mp_obj_t iter = mp_getiter(arg_in, NULL);
+    mp_obj_t item;
+    while ((item = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_obj_deque_append(self_in, item);
+    }
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_2(deque_extend_obj, deque_extend);
+
 STATIC mp_obj_t deque_popleft(mp_obj_t self_in) {
     mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
 
@@ -125,8 +226,8 @@ STATIC mp_obj_t deque_popleft(mp_obj_t self_in) {
         mp_raise_msg(&mp_type_IndexError, "empty");
     }
 
-    mp_obj_t ret = self->items[self->i_get];
-    self->items[self->i_get] = MP_OBJ_NULL;
+    mp_obj_t ret = deque_get_item(self, self->i_get);
+    deque_set_item(self, self->i_get, MP_OBJ_NULL);
 
     if (++self->i_get == self->alloc) {
         self->i_get = 0;
@@ -136,22 +237,177 @@ STATIC mp_obj_t deque_popleft(mp_obj_t self_in) {
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_popleft_obj, deque_popleft);
 
-#if 0
+STATIC mp_obj_t deque_pop(mp_obj_t self_in) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+
+    if (self->i_get == self->i_put) {
+        mp_raise_msg(&mp_type_IndexError, "empty");
+    }
+
+    if (self->i_put == 0) {
+        self->i_put = self->alloc;
+    }
+    self->i_put -= 1;
+    mp_obj_t ret = deque_get_item(self, self->i_put);
+    deque_set_item(self, self->i_put, MP_OBJ_NULL);
+
+    return ret;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_pop_obj, deque_pop);
+
 STATIC mp_obj_t deque_clear(mp_obj_t self_in) {
     mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
     self->i_get = self->i_put = 0;
-    mp_seq_clear(self->items, 0, self->alloc, sizeof(*self->items));
+    memset(self->items, 0, self->alloc * DEQUE_ITEMSZ(self));
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(deque_clear_obj, deque_clear);
+
+// Rotate n steps to the right (to the left if n is negative).  Items are
+// moved between the two ends one slot at a time, taking the shorter way
+// round, so this is O(min(n, len - n)) with no allocation.
+STATIC mp_obj_t deque_rotate(size_t n_args, const mp_obj_t *args) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(args[0]);
+    mp_int_t n = 1;
+    if (n_args > 1) {
+        n = mp_obj_get_int(args[1]);
+    }
+    mp_int_t len = deque_len(self);
+    if (len <= 1) {
+        return mp_const_none;
+    }
+    n %= len;
+    if (n < 0) {
+        n += len;
+    }
+
+    size_t sz = DEQUE_ITEMSZ(self);
+    byte *items = self->items;
+    if (n <= len / 2) {
+        // move n items from the right end round to the left end
+        while (n-- > 0) {
+            self->i_put = (self->i_put == 0 ? self->alloc : self->i_put) - 1;
+            self->i_get = (self->i_get == 0 ? self->alloc : self->i_get) - 1;
+            memcpy(items + self->i_get * sz, items + self->i_put * sz, sz);
+            memset(items + self->i_put * sz, 0, sz);
+        }
+    } else {
+        // move len - n items from the left end round to the right end
+        for (n = len - n; n > 0; --n) {
+            memcpy(items + self->i_put * sz, items + self->i_get * sz, sz);
+            memset(items + self->i_get * sz, 0, sz);
+            if (++self->i_put == self->alloc) {
+                self->i_put = 0;
+            }
+            if (++self->i_get == self->alloc) {
+                self->i_get = 0;
+            }
+        }
+    }
+
+    return mp_const_none;
+}
+STATIC MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(deque_rotate_obj, 1, 2, deque_rotate);
+
+#if MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR
+STATIC mp_obj_t deque_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(self_in);
+    if (value == MP_OBJ_NULL) {
+        // delete not supported
+        return MP_OBJ_NULL;
+    }
+    size_t i = mp_get_index(self->base.type, deque_len(self), index, false) + self->i_get;
+    if (i >= self->alloc) {
+        i -= self->alloc;
+    }
+    if (value == MP_OBJ_SENTINEL) {
+        // load
+        return deque_get_item(self, i);
+    } else {
+        // store
+        deque_set_item(self, i, value);
+        return mp_const_none;
+    }
+}
+#endif
+
+#if MICROPY_PY_COLLECTIONS_DEQUE_ITER
+typedef struct _mp_obj_deque_it_t {
+    mp_obj_base_t base;
+    mp_fun_1_t iternext;
+    mp_obj_t deque;
+    size_t cur;
+} mp_obj_deque_it_t;
+
+STATIC mp_obj_t deque_it_iternext(mp_obj_t self_in) {
+    mp_obj_deque_it_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_deque_t *deque = MP_OBJ_TO_PTR(self->deque);
+    if (self->cur == deque->i_put) {
+        return MP_OBJ_STOP_ITERATION;
+    }
+    mp_obj_t o_out = deque_get_item(deque, self->cur);
+    if (++self->cur == deque->alloc) {
+        self->cur = 0;
+    }
+    return o_out;
+}
+
+STATIC mp_obj_t deque_getiter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
+    assert(sizeof(mp_obj_deque_it_t) <= sizeof(mp_obj_iter_buf_t));
+    mp_obj_deque_t *deque = MP_OBJ_TO_PTR(o_in);
+    mp_obj_deque_it_t *o = (mp_obj_deque_it_t*)iter_buf;
+    o->base.type = &mp_type_polymorph_iter;
+    o->iternext = deque_it_iternext;
+    o->deque = o_in;
+    o->cur = deque->i_get;
+    return MP_OBJ_FROM_PTR(o);
+}
+#endif
+
+#if MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+STATIC void deque_reverse_bytes(byte *a, byte *b) {
+    while (a < --b) {
+        byte t = *a;
+        *a++ = *b;
+        *b = t;
+    }
+}
+
+// A typed deque exposes its items through the buffer protocol, oldest first.
+// The ring is rotated in place first so that the items are contiguous and
+// start at the beginning of the storage.
+STATIC mp_int_t deque_get_buffer(mp_obj_t o_in, mp_buffer_info_t *bufinfo, mp_uint_t flags) {
+    (void)flags;
+    mp_obj_deque_t *self = MP_OBJ_TO_PTR(o_in);
+    if (self->typecode == 0) {
+        return 1;
+    }
+    size_t len = deque_len(self);
+    if (self->i_get != 0) {
+        byte *items = self->items;
+        byte *mid = items + self->i_get * self->itemsz;
+        byte *end = items + self->alloc * self->itemsz;
+        deque_reverse_bytes(items, mid);
+        deque_reverse_bytes(mid, end);
+        deque_reverse_bytes(items, end);
+        self->i_get = 0;
+        self->i_put = len;
+    }
+    bufinfo->buf = self->items;
+    bufinfo->len = len * self->itemsz;
+    bufinfo->typecode = self->typecode;
+    return 0;
+}
 #endif
 
 STATIC const mp_rom_map_elem_t deque_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_append), MP_ROM_PTR(&deque_append_obj) },
-    #if 0
+    { MP_ROM_QSTR(MP_QSTR_appendleft), MP_ROM_PTR(&deque_appendleft_obj) },
     { MP_ROM_QSTR(MP_QSTR_clear), MP_ROM_PTR(&deque_clear_obj) },
-    #endif
+    { MP_ROM_QSTR(MP_QSTR_extend), MP_ROM_PTR(&deque_extend_obj) },
+    { MP_ROM_QSTR(MP_QSTR_pop), MP_ROM_PTR(&deque_pop_obj) },
     { MP_ROM_QSTR(MP_QSTR_popleft), MP_ROM_PTR(&deque_popleft_obj) },
+    { MP_ROM_QSTR(MP_QSTR_rotate), MP_ROM_PTR(&deque_rotate_obj) },
 };
 
 STATIC MP_DEFINE_CONST_DICT(deque_locals_dict, deque_locals_dict_table);
@@ -161,6 +417,15 @@ const mp_obj_type_t mp_type_deque = {
     .name = MP_QSTR_deque,
     .make_new = deque_make_new,
     .unary_op = deque_unary_op,
+    #if MICROPY_PY_COLLECTIONS_DEQUE_SUBSCR
+    .subscr = deque_subscr,
+    #endif
+    #if MICROPY_PY_COLLECTIONS_DEQUE_ITER
+    .getiter = deque_getiter,
+    #endif
+    #if MICROPY_PY_COLLECTIONS_DEQUE_TYPECODE
+    .buffer_p = { .get_buffer = deque_get_buffer },
+    #endif
     .locals_dict = (mp_obj_dict_t*)&deque_locals_dict,
 };
 
@@ -215,14 +215,10 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_clear_obj, dict_clear);
 STATIC mp_obj_t dict_copy(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_dict_type(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_obj_t other_out = mp_obj_new_dict(self->map.alloc);
+    mp_obj_t other_out = mp_obj_new_dict(0);
     mp_obj_dict_t *other = MP_OBJ_TO_PTR(other_out);
     other->base.type = self->base.type;
-    other->map.used = self->map.used;
-    other->map.all_keys_are_qstrs = self->map.all_keys_are_qstrs;
-    other->map.is_fixed = 0;
-    other->map.is_ordered = self->map.is_ordered;
-    memcpy(other->map.table, self->map.table, self->map.alloc * sizeof(mp_map_elem_t));
+    mp_map_init_copy(&other->map, &self->map);
     return other_out;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(dict_copy_obj, dict_copy);
@@ -308,6 +304,19 @@ STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     mp_check_self(mp_obj_is_dict_type(self_in));
     mp_obj_dict_t *self = MP_OBJ_TO_PTR(self_in);
     mp_ensure_not_fixed(self);
+    #if MICROPY_MAP_COMPACT
+    // entries are in insertion order, so pop the last one like CPython
+    mp_map_t *map = &self->map;
+    size_t i = map->alloc;
+    while (i > 0 && !mp_map_slot_is_filled(map, i - 1)) {
+        i -= 1;
+    }
+    if (i == 0) {
+        mp_raise_msg(&mp_type_KeyError, "popitem(): dictionary is empty");
+    }
+    mp_obj_t items[] = {map->table[i - 1].key, map->table[i - 1].value};
+    mp_map_lookup(map, items[0], MP_MAP_LOOKUP_REMOVE_IF_FOUND);
+    #else
     size_t cur = 0;
     mp_map_elem_t *next = dict_iter_next(self, &cur);
     if (next == NULL) {
@@ -317,6 +326,7 @@ STATIC mp_obj_t dict_popitem(mp_obj_t self_in) {
     mp_obj_t items[] = {next->key, next->value};
     next->key = MP_OBJ_SENTINEL; // must mark key as sentinel to indicate that it was deleted
     next->value = MP_OBJ_NULL;
+    #endif
     mp_obj_t tuple = mp_obj_new_tuple(2, items);
 
     return tuple;
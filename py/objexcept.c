@@ -104,6 +104,40 @@ mp_obj_t mp_alloc_emergency_exception_buf(mp_obj_t size_in) {
 // definition module-private so far, have it here.
 const mp_obj_exception_t mp_const_GeneratorExit_obj = {{&mp_type_GeneratorExit}, 0, 0, NULL, (mp_obj_tuple_t*)&mp_const_empty_tuple_obj};
 
+#if MICROPY_PREALLOC_EXCEPTIONS
+// Instances of exceptions raised over and over by polling loops (iterator
+// exhaustion, non-blocking and timed-out I/O).  They live in ROM, so they are
+// shared by every raise and never get a traceback.
+STATIC const mp_rom_obj_tuple_t prealloc_eagain_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_EAGAIN)}};
+STATIC const mp_rom_obj_tuple_t prealloc_etimedout_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_ETIMEDOUT)}};
+STATIC const mp_rom_obj_tuple_t prealloc_einprogress_args = {{&mp_type_tuple}, 1, {MP_ROM_INT(MP_EINPROGRESS)}};
+
+STATIC const mp_obj_exception_t prealloc_exc[] = {
+    {{&mp_type_StopIteration}, 0, 0, NULL, (mp_obj_tuple_t*)&mp_const_empty_tuple_obj},
+    {{&mp_type_OSError}, 0, 0, NULL, (mp_obj_tuple_t*)&prealloc_eagain_args},
+    {{&mp_type_OSError}, 0, 0, NULL, (mp_obj_tuple_t*)&prealloc_etimedout_args},
+    {{&mp_type_OSError}, 0, 0, NULL, (mp_obj_tuple_t*)&prealloc_einprogress_args},
+};
+
+#define PREALLOC_STOP_ITERATION (0)
+#define PREALLOC_OSERROR_FIRST (1)
+
+static inline bool exception_is_prealloc(const mp_obj_exception_t *self) {
+    return self >= &prealloc_exc[0] && self < &prealloc_exc[MP_ARRAY_SIZE(prealloc_exc)];
+}
+
+mp_obj_t mp_obj_new_exception_oserror_prealloc(int errno_) {
+    for (size_t i = PREALLOC_OSERROR_FIRST; i < MP_ARRAY_SIZE(prealloc_exc); ++i) {
+        if (prealloc_exc[i].args->items[0] == MP_OBJ_NEW_SMALL_INT(errno_)) {
+            return MP_OBJ_FROM_PTR(&prealloc_exc[i]);
+        }
+    }
+    return MP_OBJ_NULL;
+}
+#else
+#define exception_is_prealloc(self) (false)
+#endif
+
 void mp_obj_exception_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind) {
     mp_obj_exception_t *o = MP_OBJ_TO_PTR(o_in);
     mp_print_kind_t k = kind & ~PRINT_EXC_SUBCLASS;
@@ -208,7 +242,9 @@ void mp_obj_exception_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
             // However, uPy will keep adding traceback entries to such
             // exception instance, so before throwing it, traceback should
             // be cleared like above.
-            self->traceback_len = 0;
+            if (!exception_is_prealloc(self)) {
+                self->traceback_len = 0;
+            }
             dest[0] = MP_OBJ_NULL; // indicate success
         }
         return;
@@ -287,7 +323,7 @@ MP_DEFINE_EXCEPTION(Exception, BaseException)
       */
   //MP_DEFINE_EXCEPTION(SystemError, Exception)
   MP_DEFINE_EXCEPTION(TypeError, Exception)
-#if MICROPY_EMIT_NATIVE
+#if MICROPY_EMIT_MACHINE_CODE
     MP_DEFINE_EXCEPTION(ViperTypeError, TypeError)
 #endif
   MP_DEFINE_EXCEPTION(ValueError, Exception)
@@ -310,6 +346,11 @@ MP_DEFINE_EXCEPTION(Exception, BaseException)
     */
 
 mp_obj_t mp_obj_new_exception(const mp_obj_type_t *exc_type) {
+    #if MICROPY_PREALLOC_EXCEPTIONS
+    if (exc_type == &mp_type_StopIteration) {
+        return MP_OBJ_FROM_PTR(&prealloc_exc[PREALLOC_STOP_ITERATION]);
+    }
+    #endif
     return mp_obj_new_exception_args(exc_type, 0, NULL);
 }
 
@@ -489,7 +530,9 @@ void mp_obj_exception_clear_traceback(mp_obj_t self_in) {
     GET_NATIVE_EXCEPTION(self, self_in);
     // just set the traceback to the null object
     // we don't want to call any memory management functions here
-    self->traceback_data = NULL;
+    if (!exception_is_prealloc(self)) {
+        self->traceback_data = NULL;
+    }
 }
 
 void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qstr block) {
@@ -498,6 +541,11 @@ void mp_obj_exception_add_traceback(mp_obj_t self_in, qstr file, size_t line, qs
     // append this traceback info to traceback data
     // if memory allocation fails (eg because gc is locked), just return
 
+    if (exception_is_prealloc(self)) {
+        // shared, read-only instance
+        return;
+    }
+
     if (self->traceback_data == NULL) {
         self->traceback_data = m_new_maybe(size_t, TRACEBACK_ENTRY_LEN);
         if (self->traceback_data == NULL) {
@@ -109,6 +109,10 @@ typedef uint32_t mp_float_uint_t;
 STATIC void float_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind) {
     (void)kind;
     mp_float_t o_val = mp_obj_float_get(o_in);
+#if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT && MICROPY_FLOAT_FORMAT_SHORTEST
+    char buf[MP_FORMAT_FLOAT_SHORTEST_BUF_SIZE];
+    mp_format_float_shortest(o_val, buf, sizeof(buf));
+#else
 #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
     char buf[16];
     #if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C
@@ -121,6 +125,7 @@ STATIC void float_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t
     const int precision = 16;
 #endif
     mp_format_float(o_val, buf, sizeof(buf), 'g', precision, '\0');
+#endif
     mp_print_str(print, buf);
     if (strchr(buf, '.') == NULL && strchr(buf, 'e') == NULL && strchr(buf, 'n') == NULL) {
         // Python floats always have decimal point (unless inf or nan)
@@ -33,6 +33,8 @@
 #include "py/runtime.h"
 #include "py/bc.h"
 #include "py/stackctrl.h"
+#include "py/frozenmod.h"
+#include "py/compile.h"
 
 #if MICROPY_DEBUG_VERBOSE // print debugging info
 #define DEBUG_PRINT (1)
@@ -147,19 +149,20 @@ qstr mp_obj_code_get_name(const byte *code_info) {
     #endif
 }
 
-#if MICROPY_EMIT_NATIVE
+#if MICROPY_EMIT_MACHINE_CODE
 STATIC const mp_obj_type_t mp_type_fun_native;
 #endif
 
 qstr mp_obj_fun_get_name(mp_const_obj_t fun_in) {
     const mp_obj_fun_bc_t *fun = MP_OBJ_TO_PTR(fun_in);
-    #if MICROPY_EMIT_NATIVE
+    #if MICROPY_EMIT_MACHINE_CODE
     if (fun->base.type == &mp_type_fun_native || fun->base.type == &mp_type_native_gen_wrap) {
         // TODO native functions don't have name stored
         return MP_QSTR_;
     }
     #endif
 
+    MP_OBJ_FUN_BC_LOAD((mp_obj_fun_bc_t*)fun);
     const byte *bc = fun->bytecode;
     bc = mp_decode_uint_skip(bc); // skip n_state
     bc = mp_decode_uint_skip(bc); // skip n_exc_stack
@@ -206,16 +209,52 @@ STATIC void dump_args(const mp_obj_t *a, size_t sz) {
                            + n_exc_stack * sizeof(mp_exc_stack_t);                \
     }
 
-#define INIT_CODESTATE(code_state, _fun_bc, n_args, n_kw, args) \
+#if MICROPY_OPT_FAST_CALL
+
+// Set up the code state for a call that passes exactly the positional args of
+// a function with fast_ip set: there is nothing to check, so just clear the
+// locals, copy in the args and start at the first opcode
+STATIC void fun_bc_setup_code_state_fast(mp_code_state_t *code_state, size_t n_state, size_t n_args, const mp_obj_t *args) {
+    code_state->ip = code_state->fun_bc->fast_ip;
+    #if MICROPY_STACKLESS
+    code_state->prev = NULL;
+    #endif
+    code_state->sp = &code_state->state[0] - 1;
+    code_state->exc_sp = (mp_exc_stack_t*)(code_state->state + n_state) - 1;
+    memset(code_state->state, 0, (n_state - n_args) * sizeof(*code_state->state));
+    mp_obj_t *arg = &code_state->state[n_state - 1];
+    for (size_t i = 0; i < n_args; i++) {
+        *arg-- = args[i];
+    }
+}
+
+// fast_ip is only set on functions whose prelude starts with 1-byte n_state
+// and n_exc_stack, so n_pos_args is always the 4th byte
+#define INIT_CODESTATE(code_state, _fun_bc, n_state, n_args, n_kw, args) \
+    code_state->fun_bc = _fun_bc; \
+    if (_fun_bc->fast_ip != NULL && n_kw == 0 && n_args == _fun_bc->bytecode[3]) { \
+        fun_bc_setup_code_state_fast(code_state, n_state, n_args, args); \
+    } else { \
+        code_state->ip = 0; \
+        mp_setup_code_state(code_state, n_args, n_kw, args); \
+    } \
+    code_state->old_globals = mp_globals_get();
+
+#else
+
+#define INIT_CODESTATE(code_state, _fun_bc, n_state, n_args, n_kw, args) \
     code_state->fun_bc = _fun_bc; \
     code_state->ip = 0; \
     mp_setup_code_state(code_state, n_args, n_kw, args); \
     code_state->old_globals = mp_globals_get();
 
+#endif
+
 #if MICROPY_STACKLESS
 mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     MP_STACK_CHECK();
     mp_obj_fun_bc_t *self = MP_OBJ_TO_PTR(self_in);
+    MP_OBJ_FUN_BC_LOAD(self);
 
     size_t n_state, state_size;
     DECODE_CODESTATE_SIZE(self->bytecode, n_state, state_size);
@@ -235,7 +274,7 @@ mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t self_in, size_t n_args
     }
     #endif
 
-    INIT_CODESTATE(code_state, self, n_args, n_kw, args);
+    INIT_CODESTATE(code_state, self, n_state, n_args, n_kw, args);
 
     // execute the byte code with the correct globals context
     mp_globals_set(self->globals);
@@ -244,6 +283,39 @@ mp_code_state_t *mp_obj_fun_bc_prepare_codestate(mp_obj_t self_in, size_t n_args
 }
 #endif
 
+#if MICROPY_OPT_TIERED_NATIVE
+// Compile the function again from its source file as native code and turn
+// this object into a native function.  Returns false if that's not possible,
+// in which case it stays bytecode for good.
+STATIC bool fun_bc_tier_native(mp_obj_fun_bc_t *self) {
+    size_t scope_index = self->tier_scope;
+    self->tier_scope = 0;
+    qstr name, source_file;
+    mp_bytecode_get_source_line(self->bytecode, self->bytecode, &name, &source_file);
+    if (qstr_str(source_file)[0] == '<' || MP_STATE_VM(tier_native_budget) == 0) {
+        // code from the REPL or a string has no file to compile again
+        return false;
+    }
+    mp_raw_code_t *rc = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        rc = mp_compile_native_scope(source_file, self->tier_hash, scope_index, name);
+        nlr_pop();
+    }
+    if (rc == NULL || rc->kind != MP_CODE_NATIVE_PY || rc->fun_data_len > MP_STATE_VM(tier_native_budget)) {
+        return false;
+    }
+    MP_STATE_VM(tier_native_budget) -= rc->fun_data_len;
+    self->base.type = &mp_type_fun_native;
+    self->bytecode = rc->fun_data;
+    self->const_table = rc->const_table;
+    #if MICROPY_OPT_FAST_CALL
+    self->fast_ip = NULL;
+    #endif
+    return true;
+}
+#endif
+
 STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     MP_STACK_CHECK();
 
@@ -254,6 +326,14 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
     dump_args(args + n_args, n_kw * 2);
 
     mp_obj_fun_bc_t *self = MP_OBJ_TO_PTR(self_in);
+    MP_OBJ_FUN_BC_LOAD(self);
+
+    #if MICROPY_OPT_TIERED_NATIVE
+    if (self->tier_scope != 0 && MP_STATE_VM(tier_native_calls) != 0
+        && ++self->tier_calls >= MP_STATE_VM(tier_native_calls) && fun_bc_tier_native(self)) {
+        return mp_call_function_n_kw(self_in, n_args, n_kw, args);
+    }
+    #endif
 
     size_t n_state, state_size;
     DECODE_CODESTATE_SIZE(self->bytecode, n_state, state_size);
@@ -280,11 +360,17 @@ STATIC mp_obj_t fun_bc_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const
     }
     #endif
 
-    INIT_CODESTATE(code_state, self, n_args, n_kw, args);
+    INIT_CODESTATE(code_state, self, n_state, n_args, n_kw, args);
 
     // execute the byte code with the correct globals context
     mp_globals_set(self->globals);
+    #if MICROPY_TRACK_CODE_STATE
+    mp_code_state_t *outer_code_state = MP_STATE_THREAD(code_state);
+    #endif
     mp_vm_return_kind_t vm_return_kind = mp_execute_bytecode(code_state, MP_OBJ_NULL);
+    #if MICROPY_TRACK_CODE_STATE
+    MP_STATE_THREAD(code_state) = outer_code_state;
+    #endif
     mp_globals_set(code_state->old_globals);
 
     #if MICROPY_DEBUG_VM_STACK_OVERFLOW
@@ -368,7 +454,32 @@ const mp_obj_type_t mp_type_fun_bc = {
 #endif
 };
 
-mp_obj_t mp_obj_new_fun_bc(mp_obj_t def_args_in, mp_obj_t def_kw_args, const byte *code, const mp_uint_t *const_table) {
+#if MICROPY_OPT_FAST_CALL
+// Return the first opcode of a function that takes only positional args and
+// has no closed-over variables, or NULL if it needs mp_setup_code_state
+STATIC const byte *fun_bc_get_fast_ip(const byte *ip) {
+    if ((ip[0] | ip[1]) & 0x80) {
+        // n_state or n_exc_stack take more than 1 byte
+        return NULL;
+    }
+    size_t scope_flags = ip[2];
+    size_t n_kwonly_args = ip[4];
+    if ((scope_flags & (MP_SCOPE_FLAG_VARARGS | MP_SCOPE_FLAG_VARKEYWORDS | MP_SCOPE_FLAG_DEFKWARGS)) != 0
+        || n_kwonly_args != 0) {
+        return NULL;
+    }
+    // skip the rest of the prelude and the code info
+    ip += 6;
+    ip += mp_decode_uint_value(ip);
+    if (*ip != 255) {
+        // there are closed-over variables to put in cells
+        return NULL;
+    }
+    return ip + 1;
+}
+#endif
+
+STATIC mp_obj_fun_bc_t *fun_bc_new(mp_obj_t def_args_in, mp_obj_t def_kw_args, const byte *code, const mp_uint_t *const_table) {
     size_t n_def_args = 0;
     size_t n_extra_args = 0;
     mp_obj_tuple_t *def_args = MP_OBJ_TO_PTR(def_args_in);
@@ -391,13 +502,41 @@ mp_obj_t mp_obj_new_fun_bc(mp_obj_t def_args_in, mp_obj_t def_kw_args, const byt
     if (def_kw_args != MP_OBJ_NULL) {
         o->extra_args[n_def_args] = def_kw_args;
     }
+    #if MICROPY_OPT_FAST_CALL
+    o->fast_ip = NULL;
+    #endif
+    #if MICROPY_OPT_GEN_FRAME_REUSE
+    o->gen_frame = NULL;
+    #endif
+    #if MICROPY_OPT_TIERED_NATIVE
+    o->tier_scope = 0;
+    o->tier_calls = 0;
+    o->tier_hash = 0;
+    #endif
+    return o;
+}
+
+mp_obj_t mp_obj_new_fun_bc(mp_obj_t def_args_in, mp_obj_t def_kw_args, const byte *code, const mp_uint_t *const_table) {
+    mp_obj_fun_bc_t *o = fun_bc_new(def_args_in, def_kw_args, code, const_table);
+    #if MICROPY_OPT_FAST_CALL
+    o->fast_ip = fun_bc_get_fast_ip(code);
+    #endif
     return MP_OBJ_FROM_PTR(o);
 }
 
+#if MICROPY_MODULE_FROZEN_MPY_COMPRESSED
+void mp_obj_fun_bc_decompress(mp_obj_fun_bc_t *self) {
+    self->bytecode = mp_frozen_mpy_decompress(self->bytecode);
+    #if MICROPY_OPT_FAST_CALL
+    self->fast_ip = fun_bc_get_fast_ip(self->bytecode);
+    #endif
+}
+#endif
+
 /******************************************************************************/
 /* native functions                                                           */
 
-#if MICROPY_EMIT_NATIVE
+#if MICROPY_EMIT_MACHINE_CODE
 
 STATIC mp_obj_t fun_native_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     MP_STACK_CHECK();
@@ -414,12 +553,12 @@ STATIC const mp_obj_type_t mp_type_fun_native = {
 };
 
 mp_obj_t mp_obj_new_fun_native(mp_obj_t def_args_in, mp_obj_t def_kw_args, const void *fun_data, const mp_uint_t *const_table) {
-    mp_obj_fun_bc_t *o = mp_obj_new_fun_bc(def_args_in, def_kw_args, (const byte*)fun_data, const_table);
+    mp_obj_fun_bc_t *o = fun_bc_new(def_args_in, def_kw_args, (const byte*)fun_data, const_table);
     o->base.type = &mp_type_fun_native;
     return o;
 }
 
-#endif // MICROPY_EMIT_NATIVE
+#endif // MICROPY_EMIT_MACHINE_CODE
 
 /******************************************************************************/
 /* inline assembler functions                                                 */
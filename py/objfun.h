@@ -33,6 +33,17 @@ typedef struct _mp_obj_fun_bc_t {
     mp_obj_dict_t *globals;         // the context within which this function was defined
     const byte *bytecode;           // bytecode for the function
     const mp_uint_t *const_table;   // constant table
+    #if MICROPY_OPT_FAST_CALL
+    const byte *fast_ip;            // first opcode if eligible for the fast call path, else NULL
+    #endif
+    #if MICROPY_OPT_GEN_FRAME_REUSE
+    struct _mp_code_state_t *gen_frame; // frame of a finished generator, for the next one
+    #endif
+    #if MICROPY_OPT_TIERED_NATIVE
+    uint16_t tier_scope; // scope_index of the raw code, 0 if it can't be made native
+    uint16_t tier_calls;
+    uint32_t tier_hash; // of the source the function was compiled from
+    #endif
     // the following extra_args array is allocated space to take (in order):
     //  - values of positional default args (if any)
     //  - a single slot for default kw args dict (if it has them)
@@ -43,4 +54,17 @@ typedef struct _mp_obj_fun_bc_t {
 
 void mp_obj_fun_bc_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest);
 
+#if MICROPY_MODULE_FROZEN_MPY_COMPRESSED
+// Compressed frozen bytecode is expanded the first time the function is used
+void mp_obj_fun_bc_decompress(mp_obj_fun_bc_t *self);
+#define MP_OBJ_FUN_BC_LOAD(self) \
+    do { \
+        if ((self)->bytecode[0] == MP_BC_PRELUDE_COMPRESSED) { \
+            mp_obj_fun_bc_decompress(self); \
+        } \
+    } while (0)
+#else
+#define MP_OBJ_FUN_BC_LOAD(self) (void)0
+#endif
+
 #endif // MICROPY_INCLUDED_PY_OBJFUN_H
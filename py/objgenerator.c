@@ -26,6 +26,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "py/runtime.h"
@@ -37,29 +38,95 @@
 /******************************************************************************/
 /* generator wrapper                                                          */
 
+#if MICROPY_OPT_GEN_FRAME_REUSE
+
+// The frame of a generator is allocated separately from the generator object.
+// Once the generator finishes nothing else refers to the frame, so it is kept
+// by the function for the next generator it creates, which then only needs to
+// allocate the small generator object.
+typedef struct _mp_obj_gen_instance_t {
+    mp_obj_base_t base;
+    mp_obj_dict_t *globals;
+    mp_obj_fun_bc_t *fun_bc;
+    mp_code_state_t *code_state;    // NULL once the generator has finished
+} mp_obj_gen_instance_t;
+
+#define GEN_CODE_STATE(self) ((self)->code_state)
+#define GEN_FUN_BC(self) ((self)->fun_bc)
+#define GEN_STOPPED(self) ((self)->code_state == NULL)
+
+#else
+
 typedef struct _mp_obj_gen_instance_t {
     mp_obj_base_t base;
     mp_obj_dict_t *globals;
     mp_code_state_t code_state;
 } mp_obj_gen_instance_t;
 
-STATIC mp_obj_t gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
-    // A generating function is just a bytecode function with type mp_type_gen_wrap
-    mp_obj_fun_bc_t *self_fun = MP_OBJ_TO_PTR(self_in);
+#define GEN_CODE_STATE(self) (&(self)->code_state)
+#define GEN_FUN_BC(self) ((self)->code_state.fun_bc)
+#define GEN_STOPPED(self) ((self)->code_state.ip == 0)
 
-    // bytecode prelude: get state size and exception stack size
-    size_t n_state = mp_decode_uint_value(self_fun->bytecode);
-    size_t n_exc_stack = mp_decode_uint_value(mp_decode_uint_skip(self_fun->bytecode));
+#endif
 
-    // allocate the generator object, with room for local stack and exception stack
-    mp_obj_gen_instance_t *o = m_new_obj_var(mp_obj_gen_instance_t, byte,
-        n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t));
+// Bytes needed after the code state for the local and exception stacks
+STATIC size_t gen_state_size(mp_obj_fun_bc_t *fun) {
+    const byte *prelude = fun->bytecode;
+    size_t n_exc_stack = 0;
+    #if MICROPY_EMIT_MACHINE_CODE
+    if (fun->base.type == &mp_type_native_gen_wrap) {
+        // Determine start of prelude; native code doesn't use an exception stack
+        prelude += ((uintptr_t*)fun->bytecode)[0];
+    } else
+    #endif
+    {
+        n_exc_stack = mp_decode_uint_value(mp_decode_uint_skip(prelude));
+    }
+    return mp_decode_uint_value(prelude) * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t);
+}
+
+// Allocate the generator object, with room for local stack and exception stack
+STATIC mp_obj_gen_instance_t *gen_instance_new(mp_obj_fun_bc_t *fun) {
+    #if MICROPY_OPT_GEN_FRAME_REUSE
+    mp_obj_gen_instance_t *o = m_new_obj(mp_obj_gen_instance_t);
+    o->fun_bc = fun;
+    mp_code_state_t *code_state = fun->gen_frame;
+    if (code_state != NULL) {
+        fun->gen_frame = NULL;
+    } else {
+        code_state = m_new_obj_var(mp_code_state_t, byte, gen_state_size(fun));
+    }
+    o->code_state = code_state;
+    #else
+    mp_obj_gen_instance_t *o = m_new_obj_var(mp_obj_gen_instance_t, byte, gen_state_size(fun));
+    #endif
     o->base.type = &mp_type_gen_instance;
+    o->globals = fun->globals;
+    GEN_CODE_STATE(o)->fun_bc = fun;
+    return o;
+}
+
+#if MICROPY_OPT_GEN_FRAME_REUSE
+// Give the frame of a finished generator back to its function
+STATIC void gen_instance_release_frame(mp_obj_gen_instance_t *self) {
+    mp_code_state_t *code_state = self->code_state;
+    self->code_state = NULL;
+    if (self->fun_bc->gen_frame == NULL) {
+        // Clear the stacks so the spare frame doesn't keep objects alive
+        memset(code_state->state, 0, gen_state_size(self->fun_bc));
+        self->fun_bc->gen_frame = code_state;
+    }
+}
+#endif
 
-    o->globals = self_fun->globals;
-    o->code_state.fun_bc = self_fun;
-    o->code_state.ip = 0;
-    mp_setup_code_state(&o->code_state, n_args, n_kw, args);
+STATIC mp_obj_t gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
+    // A generating function is just a bytecode function with type mp_type_gen_wrap
+    mp_obj_fun_bc_t *self_fun = MP_OBJ_TO_PTR(self_in);
+    MP_OBJ_FUN_BC_LOAD(self_fun);
+
+    mp_obj_gen_instance_t *o = gen_instance_new(self_fun);
+    GEN_CODE_STATE(o)->ip = 0;
+    mp_setup_code_state(GEN_CODE_STATE(o), n_args, n_kw, args);
     return MP_OBJ_FROM_PTR(o);
 }
 
@@ -76,34 +143,25 @@ const mp_obj_type_t mp_type_gen_wrap = {
 /******************************************************************************/
 // native generator wrapper
 
-#if MICROPY_EMIT_NATIVE
+#if MICROPY_EMIT_MACHINE_CODE
 
 STATIC mp_obj_t native_gen_wrap_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args) {
     // The state for a native generating function is held in the same struct as a bytecode function
     mp_obj_fun_bc_t *self_fun = MP_OBJ_TO_PTR(self_in);
-
-    // Determine start of prelude, and extract n_state from it
-    uintptr_t prelude_offset = ((uintptr_t*)self_fun->bytecode)[0];
-    size_t n_state = mp_decode_uint_value(self_fun->bytecode + prelude_offset);
-    size_t n_exc_stack = 0;
-
-    // Allocate the generator object, with room for local stack and exception stack
-    mp_obj_gen_instance_t *o = m_new_obj_var(mp_obj_gen_instance_t, byte,
-        n_state * sizeof(mp_obj_t) + n_exc_stack * sizeof(mp_exc_stack_t));
-    o->base.type = &mp_type_gen_instance;
+    mp_obj_gen_instance_t *o = gen_instance_new(self_fun);
+    mp_code_state_t *code_state = GEN_CODE_STATE(o);
 
     // Parse the input arguments and set up the code state
-    o->globals = self_fun->globals;
-    o->code_state.fun_bc = self_fun;
-    o->code_state.ip = (const byte*)prelude_offset;
-    mp_setup_code_state(&o->code_state, n_args, n_kw, args);
+    uintptr_t prelude_offset = ((uintptr_t*)self_fun->bytecode)[0];
+    code_state->ip = (const byte*)prelude_offset;
+    mp_setup_code_state(code_state, n_args, n_kw, args);
 
     // Indicate we are a native function, which doesn't use this variable
-    o->code_state.exc_sp = NULL;
+    code_state->exc_sp = NULL;
 
     // Prepare the generator instance for execution
     uintptr_t start_offset = ((uintptr_t*)self_fun->bytecode)[1];
-    o->code_state.ip = MICROPY_MAKE_POINTER_CALLABLE((void*)(self_fun->bytecode + start_offset));
+    code_state->ip = MICROPY_MAKE_POINTER_CALLABLE((void*)(self_fun->bytecode + start_offset));
 
     return MP_OBJ_FROM_PTR(o);
 }
@@ -118,7 +176,7 @@ const mp_obj_type_t mp_type_native_gen_wrap = {
     #endif
 };
 
-#endif // MICROPY_EMIT_NATIVE
+#endif // MICROPY_EMIT_MACHINE_CODE
 
 /******************************************************************************/
 /* generator instance                                                         */
@@ -126,32 +184,33 @@ const mp_obj_type_t mp_type_native_gen_wrap = {
 STATIC void gen_instance_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     (void)kind;
     mp_obj_gen_instance_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_printf(print, "<generator object '%q' at %p>", mp_obj_fun_get_name(MP_OBJ_FROM_PTR(self->code_state.fun_bc)), self);
+    mp_printf(print, "<generator object '%q' at %p>", mp_obj_fun_get_name(MP_OBJ_FROM_PTR(GEN_FUN_BC(self))), self);
 }
 
 mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_obj_t throw_value, mp_obj_t *ret_val) {
     MP_STACK_CHECK();
     mp_check_self(mp_obj_is_type(self_in, &mp_type_gen_instance));
     mp_obj_gen_instance_t *self = MP_OBJ_TO_PTR(self_in);
-    if (self->code_state.ip == 0) {
+    if (GEN_STOPPED(self)) {
         // Trying to resume already stopped generator
         *ret_val = MP_OBJ_STOP_ITERATION;
         return MP_VM_RETURN_NORMAL;
     }
-    if (self->code_state.sp == self->code_state.state - 1) {
+    mp_code_state_t *code_state = GEN_CODE_STATE(self);
+    if (code_state->sp == code_state->state - 1) {
         if (send_value != mp_const_none) {
             mp_raise_TypeError("can't send non-None value to a just-started generator");
         }
     } else {
         #if MICROPY_PY_GENERATOR_PEND_THROW
         // If exception is pending (set using .pend_throw()), process it now.
-        if (*self->code_state.sp != mp_const_none) {
-            throw_value = *self->code_state.sp;
-            *self->code_state.sp = MP_OBJ_NULL;
+        if (*code_state->sp != mp_const_none) {
+            throw_value = *code_state->sp;
+            *code_state->sp = MP_OBJ_NULL;
         } else
         #endif
         {
-            *self->code_state.sp = send_value;
+            *code_state->sp = send_value;
         }
     }
 
@@ -162,27 +221,33 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
     }
 
     // Set up the correct globals context for the generator and execute it
-    self->code_state.old_globals = mp_globals_get();
+    code_state->old_globals = mp_globals_get();
     mp_globals_set(self->globals);
     self->globals = NULL;
 
     mp_vm_return_kind_t ret_kind;
 
-    #if MICROPY_EMIT_NATIVE
-    if (self->code_state.exc_sp == NULL) {
+    #if MICROPY_EMIT_MACHINE_CODE
+    if (code_state->exc_sp == NULL) {
         // A native generator, with entry point 2 words into the "bytecode" pointer
         typedef uintptr_t (*mp_fun_native_gen_t)(void*, mp_obj_t);
-        mp_fun_native_gen_t fun = MICROPY_MAKE_POINTER_CALLABLE((const void*)(self->code_state.fun_bc->bytecode + 2 * sizeof(uintptr_t)));
-        ret_kind = fun((void*)&self->code_state, throw_value);
+        mp_fun_native_gen_t fun = MICROPY_MAKE_POINTER_CALLABLE((const void*)(code_state->fun_bc->bytecode + 2 * sizeof(uintptr_t)));
+        ret_kind = fun((void*)code_state, throw_value);
     } else
     #endif
     {
         // A bytecode generator
-        ret_kind = mp_execute_bytecode(&self->code_state, throw_value);
+        #if MICROPY_TRACK_CODE_STATE
+        mp_code_state_t *outer_code_state = MP_STATE_THREAD(code_state);
+        #endif
+        ret_kind = mp_execute_bytecode(code_state, throw_value);
+        #if MICROPY_TRACK_CODE_STATE
+        MP_STATE_THREAD(code_state) = outer_code_state;
+        #endif
     }
 
     self->globals = mp_globals_get();
-    mp_globals_set(self->code_state.old_globals);
+    mp_globals_set(code_state->old_globals);
 
     switch (ret_kind) {
         case MP_VM_RETURN_NORMAL:
@@ -190,20 +255,20 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
             // Explicitly mark generator as completed. If we don't do this,
             // subsequent next() may re-execute statements after last yield
             // again and again, leading to side effects.
-            self->code_state.ip = 0;
-            *ret_val = *self->code_state.sp;
+            code_state->ip = 0;
+            *ret_val = *code_state->sp;
             break;
 
         case MP_VM_RETURN_YIELD:
-            *ret_val = *self->code_state.sp;
+            *ret_val = *code_state->sp;
             #if MICROPY_PY_GENERATOR_PEND_THROW
-            *self->code_state.sp = mp_const_none;
+            *code_state->sp = mp_const_none;
             #endif
             break;
 
         case MP_VM_RETURN_EXCEPTION: {
-            self->code_state.ip = 0;
-            *ret_val = self->code_state.state[0];
+            code_state->ip = 0;
+            *ret_val = code_state->state[0];
             // PEP479: if StopIteration is raised inside a generator it is replaced with RuntimeError
             if (mp_obj_is_subclass_fast(MP_OBJ_FROM_PTR(mp_obj_get_type(*ret_val)), MP_OBJ_FROM_PTR(&mp_type_StopIteration))) {
                 *ret_val = mp_obj_new_exception_msg(&mp_type_RuntimeError, "generator raised StopIteration");
@@ -212,6 +277,12 @@ mp_vm_return_kind_t mp_obj_gen_resume(mp_obj_t self_in, mp_obj_t send_value, mp_
         }
     }
 
+    #if MICROPY_OPT_GEN_FRAME_REUSE
+    if (code_state->ip == 0) {
+        gen_instance_release_frame(self);
+    }
+    #endif
+
     return ret_kind;
 }
 
@@ -288,11 +359,18 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_1(gen_instance_close_obj, gen_instance_close);
 
 STATIC mp_obj_t gen_instance_pend_throw(mp_obj_t self_in, mp_obj_t exc_in) {
     mp_obj_gen_instance_t *self = MP_OBJ_TO_PTR(self_in);
-    if (self->code_state.sp == self->code_state.state - 1) {
+    #if MICROPY_OPT_GEN_FRAME_REUSE
+    if (self->code_state == NULL) {
+        // A finished generator will never raise the exception
+        return mp_const_none;
+    }
+    #endif
+    mp_code_state_t *code_state = GEN_CODE_STATE(self);
+    if (code_state->sp == code_state->state - 1) {
         mp_raise_TypeError("can't pend throw to just-started generator");
     }
-    mp_obj_t prev = *self->code_state.sp;
-    *self->code_state.sp = exc_in;
+    mp_obj_t prev = *code_state->sp;
+    *code_state->sp = exc_in;
     return prev;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(gen_instance_pend_throw_obj, gen_instance_pend_throw);
@@ -29,7 +29,6 @@
 
 #include "py/objlist.h"
 #include "py/runtime.h"
-#include "py/stackctrl.h"
 
 STATIC mp_obj_t mp_obj_new_list_iterator(mp_obj_t list, size_t cur, mp_obj_iter_buf_t *iter_buf);
 STATIC mp_obj_list_t *list_new(size_t n);
@@ -42,6 +41,21 @@ STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args);
 /******************************************************************************/
 /* list                                                                       */
 
+// Make room for at least n items, growing geometrically so that a sequence
+// of appends, extends, inserts or slice assignments copies each item O(1)
+// times on average.  New slots are cleared for the GC.
+STATIC void list_ensure_alloc(mp_obj_list_t *self, size_t n) {
+    if (n > self->alloc) {
+        size_t new_alloc = self->alloc * 2;
+        if (new_alloc < n) {
+            new_alloc = n;
+        }
+        self->items = m_renew(mp_obj_t, self->items, self->alloc, new_alloc);
+        mp_seq_clear(self->items, self->alloc, new_alloc, sizeof(*self->items));
+        self->alloc = new_alloc;
+    }
+}
+
 STATIC void list_print(const mp_print_t *print, mp_obj_t o_in, mp_print_kind_t kind) {
     mp_obj_list_t *o = MP_OBJ_TO_PTR(o_in);
     if (!(MICROPY_PY_UJSON && kind == PRINT_JSON)) {
@@ -203,12 +217,7 @@ STATIC mp_obj_t list_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
             mp_int_t len_adj = value_len - (slice_out.stop - slice_out.start);
             //printf("Len adj: %d\n", len_adj);
             if (len_adj > 0) {
-                if (self->len + len_adj > self->alloc) {
-                    // TODO: Might optimize memory copies here by checking if block can
-                    // be grown inplace or not
-                    self->items = m_renew(mp_obj_t, self->items, self->alloc, self->len + len_adj);
-                    self->alloc = self->len + len_adj;
-                }
+                list_ensure_alloc(self, self->len + len_adj);
                 mp_seq_replace_slice_grow_inplace(self->items, self->len,
                     slice_out.start, slice_out.stop, value_items, value_len, len_adj, sizeof(*self->items));
             } else {
@@ -234,11 +243,7 @@ STATIC mp_obj_t list_getiter(mp_obj_t o_in, mp_obj_iter_buf_t *iter_buf) {
 mp_obj_t mp_obj_list_append(mp_obj_t self_in, mp_obj_t arg) {
     mp_check_self(mp_obj_is_type(self_in, &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
-    if (self->len >= self->alloc) {
-        self->items = m_renew(mp_obj_t, self->items, self->alloc, self->alloc * 2);
-        self->alloc *= 2;
-        mp_seq_clear(self->items, self->len + 1, self->alloc, sizeof(*self->items));
-    }
+    list_ensure_alloc(self, self->len + 1);
     self->items[self->len++] = arg;
     return mp_const_none; // return None, as per CPython
 }
@@ -249,13 +254,7 @@ STATIC mp_obj_t list_extend(mp_obj_t self_in, mp_obj_t arg_in) {
         mp_obj_list_t *self = MP_OBJ_TO_PTR(self_in);
         mp_obj_list_t *arg = MP_OBJ_TO_PTR(arg_in);
 
-        if (self->len + arg->len > self->alloc) {
-            // TODO: use alloc policy for "4"
-            self->items = m_renew(mp_obj_t, self->items, self->alloc, self->len + arg->len + 4);
-            self->alloc = self->len + arg->len + 4;
-            mp_seq_clear(self->items, self->len + arg->len, self->alloc, sizeof(*self->items));
-        }
-
+        list_ensure_alloc(self, self->len + arg->len);
         memcpy(self->items + self->len, arg->items, sizeof(mp_obj_t) * arg->len);
         self->len += arg->len;
     } else {
@@ -276,42 +275,125 @@ STATIC mp_obj_t list_pop(size_t n_args, const mp_obj_t *args) {
     memmove(self->items + index, self->items + index + 1, (self->len - index) * sizeof(mp_obj_t));
     // Clear stale pointer from slot which just got freed to prevent GC issues
     self->items[self->len] = MP_OBJ_NULL;
-    if (self->alloc > LIST_MIN_ALLOC && self->alloc > 2 * self->len) {
+    // Only shrink once the list is a quarter full so that alternating
+    // appends and pops around a power of 2 don't reallocate every time
+    if (self->alloc > LIST_MIN_ALLOC && self->alloc > 4 * self->len) {
         self->items = m_renew(mp_obj_t, self->items, self->alloc, self->alloc/2);
         self->alloc /= 2;
     }
     return ret;
 }
 
-STATIC void mp_quicksort(mp_obj_t *head, mp_obj_t *tail, mp_obj_t key_fn, mp_obj_t binop_less_result) {
-    MP_STACK_CHECK();
-    while (head < tail) {
-        mp_obj_t *h = head - 1;
-        mp_obj_t *t = tail;
-        mp_obj_t v = key_fn == MP_OBJ_NULL ? tail[0] : mp_call_function_1(key_fn, tail[0]); // get pivot using key_fn
-        for (;;) {
-            do ++h; while (h < t && mp_binary_op(MP_BINARY_OP_LESS, key_fn == MP_OBJ_NULL ? h[0] : mp_call_function_1(key_fn, h[0]), v) == binop_less_result);
-            do --t; while (h < t && mp_binary_op(MP_BINARY_OP_LESS, v, key_fn == MP_OBJ_NULL ? t[0] : mp_call_function_1(key_fn, t[0])) == binop_less_result);
-            if (h >= t) break;
-            mp_obj_t x = h[0];
-            h[0] = t[0];
-            t[0] = x;
+// list.sort is a stable, non-recursive merge sort.  Short runs are put in
+// order with an insertion sort and then merged pairwise into longer runs.
+// The shorter run of each pair is moved out to a buffer of at most half the
+// list, and put back if a comparison raises, so the list keeps all its items.
+// With a key function each key is computed once, up front.
+
+#define LIST_SORT_MIN_RUN (8)
+
+typedef struct _list_sort_t {
+    mp_obj_t *keys; // what is compared, the same array as items if there is no key function
+    mp_obj_t *items;
+    mp_obj_t *tmp_keys; // the run moved out for the merge in progress
+    mp_obj_t *tmp_items;
+    size_t tmp_pos; // tmp entries from tmp_pos to tmp_end are not merged yet
+    size_t tmp_end;
+    size_t gap; // and they go back in the list starting here
+    bool reverse;
+} list_sort_t;
+
+// Whether key a must go before key b
+STATIC bool list_sort_before(const list_sort_t *s, mp_obj_t a, mp_obj_t b) {
+    if (s->reverse) {
+        mp_obj_t t = a;
+        a = b;
+        b = t;
+    }
+    if (mp_obj_is_small_int(a) && mp_obj_is_small_int(b)) {
+        return MP_OBJ_SMALL_INT_VALUE(a) < MP_OBJ_SMALL_INT_VALUE(b);
+    }
+    #if MICROPY_PY_BUILTINS_FLOAT
+    if (mp_obj_is_float(a) && mp_obj_is_float(b)) {
+        return mp_obj_float_get(a) < mp_obj_float_get(b);
+    }
+    #endif
+    return mp_obj_is_true(mp_binary_op(MP_BINARY_OP_LESS, a, b));
+}
+
+STATIC void list_sort_move(list_sort_t *s, size_t dest, const mp_obj_t *keys, const mp_obj_t *items, size_t src) {
+    s->keys[dest] = keys[src];
+    s->items[dest] = items[src];
+}
+
+// Put the unmerged part of the run that was moved out back in the list
+STATIC void list_sort_restore(list_sort_t *s) {
+    size_t n = s->tmp_end - s->tmp_pos;
+    memcpy(&s->keys[s->gap], &s->tmp_keys[s->tmp_pos], n * sizeof(mp_obj_t));
+    memcpy(&s->items[s->gap], &s->tmp_items[s->tmp_pos], n * sizeof(mp_obj_t));
+    s->tmp_pos = s->tmp_end;
+}
+
+// Insertion sort of entries lo to hi-1, swapping so no item is ever held outside the list
+STATIC void list_sort_insertion(list_sort_t *s, size_t lo, size_t hi) {
+    for (size_t i = lo + 1; i < hi; ++i) {
+        for (size_t j = i; j > lo && list_sort_before(s, s->keys[j], s->keys[j - 1]); --j) {
+            mp_obj_t t = s->keys[j];
+            s->keys[j] = s->keys[j - 1];
+            s->keys[j - 1] = t;
+            if (s->items != s->keys) {
+                t = s->items[j];
+                s->items[j] = s->items[j - 1];
+                s->items[j - 1] = t;
+            }
         }
-        mp_obj_t x = h[0];
-        h[0] = tail[0];
-        tail[0] = x;
-        // do the smaller recursive call first, to keep stack within O(log(N))
-        if (t - head < tail - h - 1) {
-            mp_quicksort(head, t, key_fn, binop_less_result);
-            head = h + 1;
-        } else {
-            mp_quicksort(h + 1, tail, key_fn, binop_less_result);
-            tail = t;
+    }
+}
+
+// Merge the sorted runs lo to mid-1 and mid to hi-1
+STATIC void list_sort_merge(list_sort_t *s, size_t lo, size_t mid, size_t hi) {
+    mp_obj_t *keys = s->keys;
+    if (!list_sort_before(s, keys[mid], keys[mid - 1])) {
+        // already in order, so sorted input takes O(n) comparisons
+        return;
+    }
+    if (mid - lo <= hi - mid) {
+        // move out the left run and merge upwards from lo
+        memcpy(s->tmp_keys, &keys[lo], (mid - lo) * sizeof(mp_obj_t));
+        memcpy(s->tmp_items, &s->items[lo], (mid - lo) * sizeof(mp_obj_t));
+        s->tmp_pos = 0;
+        s->tmp_end = mid - lo;
+        s->gap = lo;
+        size_t j = mid;
+        while (s->tmp_pos < s->tmp_end && j < hi) {
+            if (list_sort_before(s, keys[j], s->tmp_keys[s->tmp_pos])) {
+                list_sort_move(s, s->gap++, keys, s->items, j++);
+            } else {
+                list_sort_move(s, s->gap++, s->tmp_keys, s->tmp_items, s->tmp_pos++);
+            }
+        }
+    } else {
+        // move out the right run and merge downwards from hi; the unmerged
+        // part of the left run ends at gap and the free space follows it
+        memcpy(s->tmp_keys, &keys[mid], (hi - mid) * sizeof(mp_obj_t));
+        memcpy(s->tmp_items, &s->items[mid], (hi - mid) * sizeof(mp_obj_t));
+        s->tmp_pos = 0;
+        s->tmp_end = hi - mid;
+        s->gap = mid;
+        size_t dest = hi;
+        while (s->tmp_end > 0 && s->gap > lo) {
+            if (list_sort_before(s, s->tmp_keys[s->tmp_end - 1], keys[s->gap - 1])) {
+                --s->gap;
+                list_sort_move(s, --dest, keys, s->items, s->gap);
+            } else {
+                --s->tmp_end;
+                list_sort_move(s, --dest, s->tmp_keys, s->tmp_items, s->tmp_end);
+            }
         }
     }
+    list_sort_restore(s);
 }
 
-// TODO Python defines sort to be stable but ours is not
 mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_args) {
     static const mp_arg_t allowed_args[] = {
         { MP_QSTR_key, MP_ARG_KW_ONLY | MP_ARG_OBJ, {.u_rom_obj = MP_ROM_PTR(&mp_const_none_obj)} },
@@ -328,10 +410,47 @@ mp_obj_t mp_obj_list_sort(size_t n_args, const mp_obj_t *pos_args, mp_map_t *kw_
     mp_check_self(mp_obj_is_type(pos_args[0], &mp_type_list));
     mp_obj_list_t *self = MP_OBJ_TO_PTR(pos_args[0]);
 
-    if (self->len > 1) {
-        mp_quicksort(self->items, self->items + self->len - 1,
-                     args.key.u_obj == mp_const_none ? MP_OBJ_NULL : args.key.u_obj,
-                     args.reverse.u_bool ? mp_const_false : mp_const_true);
+    size_t n = self->len;
+    if (n > 1) {
+        list_sort_t s;
+        s.items = self->items;
+        s.tmp_pos = s.tmp_end = 0;
+        s.reverse = args.reverse.u_bool;
+        size_t n_tmp = n / 2;
+        size_t n_buf = n_tmp;
+        mp_obj_t *buf;
+        if (args.key.u_obj == mp_const_none) {
+            buf = m_new(mp_obj_t, n_buf);
+            s.keys = s.items;
+            s.tmp_keys = s.tmp_items = buf;
+        } else {
+            n_buf = n + 2 * n_tmp;
+            buf = m_new(mp_obj_t, n_buf);
+            s.keys = buf;
+            s.tmp_keys = buf + n;
+            s.tmp_items = buf + n + n_tmp;
+            for (size_t i = 0; i < n; ++i) {
+                s.keys[i] = mp_call_function_1(args.key.u_obj, s.items[i]);
+            }
+        }
+
+        nlr_buf_t nlr;
+        if (nlr_push(&nlr) == 0) {
+            for (size_t lo = 0; lo < n; lo += LIST_SORT_MIN_RUN) {
+                list_sort_insertion(&s, lo, MIN(lo + LIST_SORT_MIN_RUN, n));
+            }
+            for (size_t width = LIST_SORT_MIN_RUN; width < n; width *= 2) {
+                for (size_t lo = 0; lo + width < n; lo += 2 * width) {
+                    list_sort_merge(&s, lo, lo + width, MIN(lo + 2 * width, n));
+                }
+            }
+            nlr_pop();
+        } else {
+            list_sort_restore(&s);
+            m_del(mp_obj_t, buf, n_buf);
+            nlr_jump(nlr.ret_val);
+        }
+        m_del(mp_obj_t, buf, n_buf);
     }
 
     return mp_const_none;
@@ -380,12 +499,10 @@ STATIC mp_obj_t list_insert(mp_obj_t self_in, mp_obj_t idx, mp_obj_t obj) {
          index = self->len;
     }
 
-    mp_obj_list_append(self_in, mp_const_none);
-
-    for (mp_int_t i = self->len-1; i > index; i--) {
-         self->items[i] = self->items[i-1];
-    }
+    list_ensure_alloc(self, self->len + 1);
+    memmove(self->items + index + 1, self->items + index, (self->len - index) * sizeof(mp_obj_t));
     self->items[index] = obj;
+    self->len++;
 
     return mp_const_none;
 }
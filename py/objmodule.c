@@ -56,16 +56,51 @@ STATIC void module_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kin
     mp_printf(print, "<module '%s'>", module_name);
 }
 
+#if MICROPY_STATE_CTX_PER_TASK
+// With a VM per task, the parts of built-in modules that live in the VM
+// state can't be referred to statically and are found here instead.
+STATIC mp_obj_dict_t *module_globals(mp_obj_module_t *self) {
+    if (self == &mp_module___main__) {
+        return &MP_STATE_VM(dict_main);
+    }
+    return self->globals;
+}
+
+STATIC mp_obj_t module_state_attr(mp_obj_module_t *self, qstr attr) {
+    #if MICROPY_PY_SYS
+    if (self == &mp_module_sys) {
+        switch (attr) {
+            case MP_QSTR_path:
+                return MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_sys_path_obj));
+            case MP_QSTR_argv:
+                return MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_sys_argv_obj));
+            #if MICROPY_PY_SYS_MODULES
+            case MP_QSTR_modules:
+                return MP_OBJ_FROM_PTR(&MP_STATE_VM(mp_loaded_modules_dict));
+            #endif
+        }
+    }
+    #endif
+    return MP_OBJ_NULL;
+}
+#else
+#define module_globals(self) ((self)->globals)
+#define module_state_attr(self, attr) (MP_OBJ_NULL)
+#endif
+
 STATIC void module_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     mp_obj_module_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_obj_dict_t *globals = module_globals(self);
     if (dest[0] == MP_OBJ_NULL) {
         // load attribute
-        mp_map_elem_t *elem = mp_map_lookup(&self->globals->map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
+        mp_map_elem_t *elem = mp_map_lookup(&globals->map, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP);
         if (elem != NULL) {
             dest[0] = elem->value;
+        } else if ((dest[0] = module_state_attr(self, attr)) != MP_OBJ_NULL) {
+            // in the running VM's state
         #if MICROPY_MODULE_GETATTR
         } else if (attr != MP_QSTR___getattr__) {
-            elem = mp_map_lookup(&self->globals->map, MP_OBJ_NEW_QSTR(MP_QSTR___getattr__), MP_MAP_LOOKUP);
+            elem = mp_map_lookup(&globals->map, MP_OBJ_NEW_QSTR(MP_QSTR___getattr__), MP_MAP_LOOKUP);
             if (elem != NULL) {
                 dest[0] = mp_call_function_1(elem->value, MP_OBJ_NEW_QSTR(attr));
             }
@@ -73,7 +108,7 @@ STATIC void module_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
         }
     } else {
         // delete/store attribute
-        mp_obj_dict_t *dict = self->globals;
+        mp_obj_dict_t *dict = globals;
         if (dict->map.is_fixed) {
             #if MICROPY_CAN_OVERRIDE_BUILTINS
             if (dict == &mp_module_builtins_globals) {
@@ -213,6 +248,18 @@ STATIC const mp_rom_map_elem_t mp_builtin_module_table[] = {
 #if MICROPY_PY_UWEBSOCKET
     { MP_ROM_QSTR(MP_QSTR_uwebsocket), MP_ROM_PTR(&mp_module_uwebsocket) },
 #endif
+#if MICROPY_PY_UMQTTC
+    { MP_ROM_QSTR(MP_QSTR_umqttc), MP_ROM_PTR(&mp_module_umqttc) },
+#endif
+#if MICROPY_PY_UHTTPC
+    { MP_ROM_QSTR(MP_QSTR_uhttpc), MP_ROM_PTR(&mp_module_uhttpc) },
+#endif
+#if MICROPY_PY_ULOG
+    { MP_ROM_QSTR(MP_QSTR_ulog), MP_ROM_PTR(&mp_module_ulog) },
+#endif
+#if MICROPY_PY_UASYNCIO
+    { MP_ROM_QSTR(MP_QSTR_uasyncio), MP_ROM_PTR(&mp_module_uasyncio) },
+#endif
 #if MICROPY_PY_WEBREPL
     { MP_ROM_QSTR(MP_QSTR__webrepl), MP_ROM_PTR(&mp_module_webrepl) },
 #endif
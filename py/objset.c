@@ -55,6 +55,37 @@ STATIC bool is_set_or_frozenset(mp_obj_t o) {
     ;
 }
 
+#if MICROPY_OPT_MAP_INT_KEYS
+// The table behind o if it is a set or frozenset, so that bulk operations
+// can walk it directly; otherwise NULL and o is iterated
+STATIC mp_set_t *set_get_table(mp_obj_t o) {
+    if (is_set_or_frozenset(o)) {
+        return &((mp_obj_set_t*)MP_OBJ_TO_PTR(o))->set;
+    }
+    return NULL;
+}
+#else
+#define set_get_table(o) ((mp_set_t*)NULL)
+#endif
+
+// Apply mp_set_lookup with the given kind to dest for each item of other
+STATIC void set_lookup_each(mp_set_t *dest, mp_obj_t other, mp_map_lookup_kind_t lookup_kind) {
+    mp_set_t *other_set = set_get_table(other);
+    if (other_set != NULL) {
+        for (size_t pos = 0; pos < other_set->alloc; pos++) {
+            if (mp_set_slot_is_filled(other_set, pos)) {
+                mp_set_lookup(dest, other_set->table[pos], lookup_kind);
+            }
+        }
+        return;
+    }
+    mp_obj_t iter = mp_getiter(other, NULL);
+    mp_obj_t next;
+    while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+        mp_set_lookup(dest, next, lookup_kind);
+    }
+}
+
 // This macro is shorthand for mp_check_self to verify the argument is a set.
 #define check_set(o) mp_check_self(mp_obj_is_type(o, &mp_type_set))
 
@@ -183,6 +214,9 @@ STATIC mp_obj_t set_copy(mp_obj_t self_in) {
     other->base.type = self->base.type;
     mp_set_init(&other->set, self->set.alloc);
     other->set.used = self->set.used;
+    #if MICROPY_OPT_MAP_INT_KEYS
+    other->set.all_keys_are_small_ints = self->set.all_keys_are_small_ints;
+    #endif
     memcpy(other->set.table, self->set.table, self->set.alloc * sizeof(mp_obj_t));
     return MP_OBJ_FROM_PTR(other);
 }
@@ -211,11 +245,7 @@ STATIC mp_obj_t set_diff_int(size_t n_args, const mp_obj_t *args, bool update) {
             set_clear(self);
         } else {
             mp_set_t *self_set = &((mp_obj_set_t*)MP_OBJ_TO_PTR(self))->set;
-            mp_obj_t iter = mp_getiter(other, NULL);
-            mp_obj_t next;
-            while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
-                mp_set_lookup(self_set, next, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
-            }
+            set_lookup_each(self_set, other, MP_MAP_LOOKUP_REMOVE_IF_FOUND);
         }
     }
 
@@ -247,11 +277,27 @@ STATIC mp_obj_t set_intersect_int(mp_obj_t self_in, mp_obj_t other, bool update)
     mp_obj_set_t *self = MP_OBJ_TO_PTR(self_in);
     mp_obj_set_t *out = MP_OBJ_TO_PTR(mp_obj_new_set(0, NULL));
 
-    mp_obj_t iter = mp_getiter(other, NULL);
-    mp_obj_t next;
-    while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
-        if (mp_set_lookup(&self->set, next, MP_MAP_LOOKUP)) {
-            set_add(MP_OBJ_FROM_PTR(out), next);
+    mp_set_t *other_set = set_get_table(other);
+    if (other_set != NULL) {
+        // walk the smaller table and look its items up in the larger one
+        mp_set_t *small = other_set;
+        mp_set_t *large = &self->set;
+        if (small->used > large->used) {
+            small = &self->set;
+            large = other_set;
+        }
+        for (size_t pos = 0; pos < small->alloc; pos++) {
+            if (mp_set_slot_is_filled(small, pos) && mp_set_lookup(large, small->table[pos], MP_MAP_LOOKUP)) {
+                mp_set_lookup(&out->set, small->table[pos], MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+            }
+        }
+    } else {
+        mp_obj_t iter = mp_getiter(other, NULL);
+        mp_obj_t next;
+        while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+            if (mp_set_lookup(&self->set, next, MP_MAP_LOOKUP)) {
+                set_add(MP_OBJ_FROM_PTR(out), next);
+            }
         }
     }
 
@@ -259,6 +305,9 @@ STATIC mp_obj_t set_intersect_int(mp_obj_t self_in, mp_obj_t other, bool update)
         m_del(mp_obj_t, self->set.table, self->set.alloc);
         self->set.alloc = out->set.alloc;
         self->set.used = out->set.used;
+        #if MICROPY_OPT_MAP_INT_KEYS
+        self->set.all_keys_are_small_ints = out->set.all_keys_are_small_ints;
+        #endif
         self->set.table = out->set.table;
     }
 
@@ -279,6 +328,22 @@ STATIC mp_obj_t set_isdisjoint(mp_obj_t self_in, mp_obj_t other) {
     check_set_or_frozenset(self_in);
     mp_obj_set_t *self = MP_OBJ_TO_PTR(self_in);
 
+    mp_set_t *other_set = set_get_table(other);
+    if (other_set != NULL) {
+        mp_set_t *small = other_set;
+        mp_set_t *large = &self->set;
+        if (small->used > large->used) {
+            small = &self->set;
+            large = other_set;
+        }
+        for (size_t pos = 0; pos < small->alloc; pos++) {
+            if (mp_set_slot_is_filled(small, pos) && mp_set_lookup(large, small->table[pos], MP_MAP_LOOKUP)) {
+                return mp_const_false;
+            }
+        }
+        return mp_const_true;
+    }
+
     mp_obj_iter_buf_t iter_buf;
     mp_obj_t iter = mp_getiter(other, &iter_buf);
     mp_obj_t next;
@@ -385,11 +450,7 @@ STATIC MP_DEFINE_CONST_FUN_OBJ_2(set_remove_obj, set_remove);
 STATIC mp_obj_t set_symmetric_difference_update(mp_obj_t self_in, mp_obj_t other_in) {
     check_set_or_frozenset(self_in); // can be frozenset due to call from set_symmetric_difference
     mp_obj_set_t *self = MP_OBJ_TO_PTR(self_in);
-    mp_obj_t iter = mp_getiter(other_in, NULL);
-    mp_obj_t next;
-    while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
-        mp_set_lookup(&self->set, next, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND_OR_REMOVE_IF_FOUND);
-    }
+    set_lookup_each(&self->set, other_in, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND_OR_REMOVE_IF_FOUND);
     return mp_const_none;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(set_symmetric_difference_update_obj, set_symmetric_difference_update);
@@ -402,11 +463,7 @@ STATIC mp_obj_t set_symmetric_difference(mp_obj_t self_in, mp_obj_t other_in) {
 STATIC MP_DEFINE_CONST_FUN_OBJ_2(set_symmetric_difference_obj, set_symmetric_difference);
 
 STATIC void set_update_int(mp_obj_set_t *self, mp_obj_t other_in) {
-    mp_obj_t iter = mp_getiter(other_in, NULL);
-    mp_obj_t next;
-    while ((next = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
-        mp_set_lookup(&self->set, next, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
-    }
+    set_lookup_each(&self->set, other_in, MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
 }
 
 STATIC mp_obj_t set_update(size_t n_args, const mp_obj_t *args) {
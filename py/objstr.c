@@ -25,6 +25,7 @@
  * THE SOFTWARE.
  */
 
+#include <stddef.h>
 #include <string.h>
 #include <assert.h>
 
@@ -158,9 +159,6 @@ mp_obj_t mp_obj_str_make_new(const mp_obj_type_t *type, size_t n_args, size_t n_
             if (mp_obj_is_type(args[0], &mp_type_bytes)) {
                 GET_STR_DATA_LEN(args[0], str_data, str_len);
                 GET_STR_HASH(args[0], str_hash);
-                if (str_hash == 0) {
-                    str_hash = qstr_compute_hash(str_data, str_len);
-                }
                 #if MICROPY_PY_BUILTINS_STR_UNICODE_CHECK
                 if (!utf8_check(str_data, str_len)) {
                     mp_raise_msg(&mp_type_UnicodeError, NULL);
@@ -211,9 +209,6 @@ STATIC mp_obj_t bytes_make_new(const mp_obj_type_t *type_in, size_t n_args, size
         }
         GET_STR_DATA_LEN(args[0], str_data, str_len);
         GET_STR_HASH(args[0], str_hash);
-        if (str_hash == 0) {
-            str_hash = qstr_compute_hash(str_data, str_len);
-        }
         mp_obj_str_t *o = MP_OBJ_TO_PTR(mp_obj_new_str_copy(&mp_type_bytes, NULL, str_len));
         o->data = str_data;
         o->hash = str_hash;
@@ -272,7 +267,61 @@ wrong_args:
 
 // like strstr but with specified length and allows \0 bytes
 // TODO replace with something more efficient/standard
+#if MICROPY_OPT_STR_FIND_FAST
+// Horspool search, used for longer needles and haystacks where the cost of
+// building the skip table is paid back by skipping up to nlen bytes at a time
+STATIC const byte *find_subbytes_horspool(const byte *haystack, size_t hlen, const byte *needle, size_t nlen) {
+    uint8_t skip[256];
+    size_t max_skip = MIN(nlen, 255);
+    memset(skip, max_skip, sizeof(skip));
+    for (size_t i = nlen - max_skip; i < nlen - 1; i++) {
+        skip[needle[i]] = nlen - 1 - i;
+    }
+    byte last = needle[nlen - 1];
+    const byte *p = haystack;
+    const byte *top = haystack + hlen - nlen;
+    while (p <= top) {
+        byte c = p[nlen - 1];
+        if (c == last && memcmp(p, needle, nlen - 1) == 0) {
+            return p;
+        }
+        p += skip[c];
+    }
+    return NULL;
+}
+#endif
+
 const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle, size_t nlen, int direction) {
+    #if MICROPY_OPT_STR_FIND_FAST
+    if (hlen < nlen) {
+        return NULL;
+    }
+    if (nlen == 0) {
+        return direction > 0 ? haystack : haystack + hlen;
+    }
+    if (direction > 0) {
+        if (nlen >= 4 && hlen >= 64) {
+            return find_subbytes_horspool(haystack, hlen, needle, nlen);
+        }
+        // let memchr, which normally scans a word or more at a time, find
+        // candidates for the first byte
+        const byte *p = haystack;
+        const byte *top = haystack + hlen - nlen;
+        while (p <= top && (p = memchr(p, needle[0], top - p + 1)) != NULL) {
+            if (memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+                return p;
+            }
+            p++;
+        }
+    } else {
+        for (const byte *p = haystack + hlen - nlen; p >= haystack; p--) {
+            if (*p == needle[0] && memcmp(p + 1, needle + 1, nlen - 1) == 0) {
+                return p;
+            }
+        }
+    }
+    return NULL;
+    #else
     if (hlen >= nlen) {
         size_t str_index, str_index_end;
         if (direction > 0) {
@@ -295,8 +344,65 @@ const byte *find_subbytes(const byte *haystack, size_t hlen, const byte *needle,
         }
     }
     return NULL;
+    #endif
 }
 
+#if MICROPY_OPT_STR_CONCAT_INPLACE
+// The data of a str/bytes made by concatenation is given spare room at the
+// end, and the buffer is remembered in MP_STATE_VM(str_concat_bufs) until it
+// is overwritten by a newer one or freed by a collection.  All str/bytes
+// objects using the buffer start at its first byte, and the one of length
+// "used" may be extended in place: the bytes after it aren't part of any
+// other object.
+STATIC mp_obj_t str_concat_inplace(const mp_obj_type_t *type, mp_obj_t lhs_in, const byte *lhs_data, size_t lhs_len, const byte *rhs_data, size_t rhs_len) {
+    size_t len = lhs_len + rhs_len;
+    mp_str_concat_buf_t *buf = NULL;
+    if (!mp_obj_is_qstr(lhs_in)) {
+        for (size_t i = 0; i < MP_ARRAY_SIZE(MP_STATE_VM(str_concat_bufs)); i++) {
+            mp_str_concat_buf_t *b = &MP_STATE_VM(str_concat_bufs)[i];
+            if (b->data == lhs_data && b->used == lhs_len) {
+                buf = b;
+                break;
+            }
+        }
+        if (buf != NULL && len > buf->alloc) {
+            // try to grow the buffer without moving it because other objects
+            // point into it
+            size_t alloc = len + len / 2;
+            if (m_renew_maybe(byte, buf->data, buf->alloc + 1, alloc + 1, false) != NULL) {
+                buf->alloc = alloc;
+            } else {
+                buf = NULL;
+            }
+        }
+    }
+    byte *data;
+    if (buf != NULL) {
+        data = buf->data;
+    } else {
+        size_t alloc = len + len / 2;
+        data = m_new(byte, alloc + 1);
+        memcpy(data, lhs_data, lhs_len);
+        // the allocations below may collect, which can clear an entry
+        buf = &MP_STATE_VM(str_concat_bufs)[MP_STATE_VM(str_concat_buf_idx)];
+        MP_STATE_VM(str_concat_buf_idx) = (MP_STATE_VM(str_concat_buf_idx) + 1) % MP_ARRAY_SIZE(MP_STATE_VM(str_concat_bufs));
+        buf->data = NULL;
+        buf->alloc = alloc;
+    }
+    memcpy(data + lhs_len, rhs_data, rhs_len);
+    data[len] = '\0';
+
+    mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
+    o->base.type = type;
+    o->hash = 0;
+    o->len = len;
+    o->data = data;
+    buf->data = data;
+    buf->used = len;
+    return MP_OBJ_FROM_PTR(o);
+}
+#endif
+
 // Note: this function is used to check if an object is a str or bytes, which
 // works because both those types use it as their binary_op method.  Revisit
 // mp_obj_is_str_or_bytes if this fact changes.
@@ -386,6 +492,12 @@ mp_obj_t mp_obj_str_binary_op(mp_binary_op_t op, mp_obj_t lhs_in, mp_obj_t rhs_i
                 return lhs_in;
             }
 
+            #if MICROPY_OPT_STR_CONCAT_INPLACE
+            if (lhs_len + rhs_len >= MICROPY_OPT_STR_CONCAT_INPLACE) {
+                return str_concat_inplace(lhs_type, lhs_in, lhs_data, lhs_len, rhs_data, rhs_len);
+            }
+            #endif
+
             vstr_t vstr;
             vstr_init_len(&vstr, lhs_len + rhs_len);
             memcpy(vstr.buf, lhs_data, lhs_len);
@@ -430,7 +542,7 @@ STATIC mp_obj_t bytes_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
             if (!mp_seq_get_fast_slice_indexes(self_len, index, &slice)) {
                 mp_raise_NotImplementedError("only slices with step=1 (aka None) are supported");
             }
-            return mp_obj_new_str_of_type(type, self_data + slice.start, slice.stop - slice.start);
+            return mp_obj_str_new_slice(type, self_in, self_len, self_data + slice.start, slice.stop - slice.start);
         }
 #endif
         size_t index_val = mp_get_index(type, self_len, index, false);
@@ -548,6 +660,11 @@ mp_obj_t mp_obj_str_split(size_t n_args, const mp_obj_t *args) {
 
         for (;;) {
             const byte *start = s;
+            #if MICROPY_OPT_STR_FIND_FAST
+            if (splits == 0 || (s = find_subbytes(s, top - s, (const byte*)sep_str, sep_len, 1)) == NULL) {
+                s = top;
+            }
+            #else
             for (;;) {
                 if (splits == 0 || s + sep_len > top) {
                     s = top;
@@ -557,6 +674,7 @@ mp_obj_t mp_obj_str_split(size_t n_args, const mp_obj_t *args) {
                 }
                 s++;
             }
+            #endif
             mp_obj_list_append(res, mp_obj_new_str_of_type(self_type, start, s - start));
             if (s >= top) {
                 break;
@@ -941,6 +1059,309 @@ STATIC NORETURN void terse_str_format_value_error(void) {
 #define terse_str_format_value_error()
 #endif
 
+// A parsed replacement field of str.format, or conversion of % formatting
+typedef struct _str_format_spec_t {
+    char conversion; // 'r', 's' or 0 for str.format
+    char fill;
+    char align;
+    char type;
+    bool alt; // the '#' of % formatting, kept apart as 'd' ignores it
+    int flags;
+    int width;
+    int precision;
+} str_format_spec_t;
+
+STATIC void str_format_spec_init(str_format_spec_t *spec, char conversion, bool has_format_spec) {
+    if (!has_format_spec && !conversion) {
+        conversion = 's';
+    }
+    spec->conversion = conversion;
+    spec->fill = '\0';
+    spec->align = '\0';
+    spec->type = '\0';
+    spec->alt = false;
+    spec->flags = 0;
+    spec->width = -1;
+    spec->precision = -1;
+}
+
+// Parse a format specifier that has had any nested fields substituted.
+// Returns false if it isn't valid.
+STATIC bool str_format_parse_spec(const char *s, const char *top, str_format_spec_t *spec) {
+    // The format specifier (from http://docs.python.org/2/library/string.html#formatspec)
+    //
+    // [[fill]align][sign][#][0][width][,][.precision][type]
+    // fill        ::=  <any character>
+    // align       ::=  "<" | ">" | "=" | "^"
+    // sign        ::=  "+" | "-" | " "
+    // width       ::=  integer
+    // precision   ::=  integer
+    // type        ::=  "b" | "c" | "d" | "e" | "E" | "f" | "F" | "g" | "G" | "n" | "o" | "s" | "x" | "X" | "%"
+    #define PEEK(i) (s + (i) < top ? s[i] : '\0')
+    if (isalignment(PEEK(0))) {
+        spec->align = *s++;
+    } else if (PEEK(0) && isalignment(PEEK(1))) {
+        spec->fill = *s++;
+        spec->align = *s++;
+    }
+    if (PEEK(0) == '+' || PEEK(0) == '-' || PEEK(0) == ' ') {
+        if (*s == '+') {
+            spec->flags |= PF_FLAG_SHOW_SIGN;
+        } else if (*s == ' ') {
+            spec->flags |= PF_FLAG_SPACE_SIGN;
+        }
+        s++;
+    }
+    if (PEEK(0) == '#') {
+        spec->flags |= PF_FLAG_SHOW_PREFIX;
+        s++;
+    }
+    if (PEEK(0) == '0') {
+        if (!spec->align) {
+            spec->align = '=';
+        }
+        if (!spec->fill) {
+            spec->fill = '0';
+        }
+    }
+    s = str_to_int(s, top, &spec->width);
+    if (PEEK(0) == ',') {
+        spec->flags |= PF_FLAG_SHOW_COMMA;
+        s++;
+    }
+    if (PEEK(0) == '.') {
+        s++;
+        s = str_to_int(s, top, &spec->precision);
+    }
+    if (istype(PEEK(0))) {
+        spec->type = *s++;
+    }
+    return PEEK(0) == '\0';
+    #undef PEEK
+}
+
+// Print arg for one replacement field of str.format
+STATIC void str_format_field(const mp_print_t *print, mp_obj_t arg, const str_format_spec_t *spec) {
+    if (spec->conversion) {
+        mp_print_kind_t print_kind;
+        if (spec->conversion == 's') {
+            print_kind = PRINT_STR;
+        } else {
+            assert(spec->conversion == 'r');
+            print_kind = PRINT_REPR;
+        }
+        vstr_t arg_vstr;
+        mp_print_t arg_print;
+        vstr_init_print(&arg_vstr, 16, &arg_print);
+        mp_obj_print_helper(&arg_print, arg, print_kind);
+        arg = mp_obj_new_str_from_vstr(&mp_type_str, &arg_vstr);
+    }
+
+    char fill = spec->fill;
+    char align = spec->align;
+    int width = spec->width;
+    int precision = spec->precision;
+    char type = spec->type;
+    int flags = spec->flags;
+
+    if (!align) {
+        if (arg_looks_numeric(arg)) {
+            align = '>';
+        } else {
+            align = '<';
+        }
+    }
+    if (!fill) {
+        fill = ' ';
+    }
+
+    if (flags & (PF_FLAG_SHOW_SIGN | PF_FLAG_SPACE_SIGN)) {
+        if (type == 's') {
+            if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                terse_str_format_value_error();
+            } else {
+                mp_raise_ValueError("sign not allowed in string format specifier");
+            }
+        }
+        if (type == 'c') {
+            if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                terse_str_format_value_error();
+            } else {
+                mp_raise_ValueError(
+                    "sign not allowed with integer format specifier 'c'");
+            }
+        }
+    }
+
+    switch (align) {
+        case '<': flags |= PF_FLAG_LEFT_ADJUST;     break;
+        case '=': flags |= PF_FLAG_PAD_AFTER_SIGN;  break;
+        case '^': flags |= PF_FLAG_CENTER_ADJUST;   break;
+    }
+
+    if (arg_looks_integer(arg)) {
+        switch (type) {
+            case 'b':
+                mp_print_mp_int(print, arg, 2, 'a', flags, fill, width, 0);
+                return;
+
+            case 'c':
+            {
+                char ch = mp_obj_get_int(arg);
+                mp_print_strn(print, &ch, 1, flags, fill, width);
+                return;
+            }
+
+            case '\0':  // No explicit format type implies 'd'
+            case 'n':   // I don't think we support locales in uPy so use 'd'
+            case 'd':
+                mp_print_mp_int(print, arg, 10, 'a', flags, fill, width, 0);
+                return;
+
+            case 'o':
+                if (flags & PF_FLAG_SHOW_PREFIX) {
+                    flags |= PF_FLAG_SHOW_OCTAL_LETTER;
+                }
+
+                mp_print_mp_int(print, arg, 8, 'a', flags, fill, width, 0);
+                return;
+
+            case 'X':
+            case 'x':
+                mp_print_mp_int(print, arg, 16, type - ('X' - 'A'), flags, fill, width, 0);
+                return;
+
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case '%':
+                // The floating point formatters all work with anything that
+                // looks like an integer
+                break;
+
+            default:
+                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                    terse_str_format_value_error();
+                } else {
+                    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                        "unknown format code '%c' for object of type '%s'",
+                        type, mp_obj_get_type_str(arg)));
+                }
+        }
+    }
+
+    // NOTE: no else here. We need the e, f, g etc formats for integer
+    //       arguments (from above if) to take this if.
+    if (arg_looks_numeric(arg)) {
+        if (!type) {
+
+            // Even though the docs say that an unspecified type is the same
+            // as 'g', there is one subtle difference, when the exponent
+            // is one less than the precision.
+            //
+            // '{:10.1}'.format(0.0) ==> '0e+00'
+            // '{:10.1g}'.format(0.0) ==> '0'
+            //
+            // TODO: Figure out how to deal with this.
+            //
+            // A proper solution would involve adding a special flag
+            // or something to format_float, and create a format_double
+            // to deal with doubles. In order to fix this when using
+            // sprintf, we'd need to use the e format and tweak the
+            // returned result to strip trailing zeros like the g format
+            // does.
+            //
+            // {:10.3} and {:10.2e} with 1.23e2 both produce 1.23e+02
+            // but with 1.e2 you get 1e+02 and 1.00e+02
+            //
+            // Stripping the trailing 0's (like g) does would make the
+            // e format give us the right format.
+            //
+            // CPython sources say:
+            //   Omitted type specifier.  Behaves in the same way as repr(x)
+            //   and str(x) if no precision is given, else like 'g', but with
+            //   at least one digit after the decimal point. */
+
+            type = 'g';
+        }
+        if (type == 'n') {
+            type = 'g';
+        }
+
+        switch (type) {
+#if MICROPY_PY_BUILTINS_FLOAT
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+                mp_print_float(print, mp_obj_get_float(arg), type, flags, fill, width, precision);
+                break;
+
+            case '%':
+                flags |= PF_FLAG_ADD_PERCENT;
+                #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
+                #define F100 100.0F
+                #else
+                #define F100 100.0
+                #endif
+                mp_print_float(print, mp_obj_get_float(arg) * F100, 'f', flags, fill, width, precision);
+                #undef F100
+                break;
+#endif
+
+            default:
+                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                    terse_str_format_value_error();
+                } else {
+                    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                        "unknown format code '%c' for object of type '%s'",
+                        type, mp_obj_get_type_str(arg)));
+                }
+        }
+    } else {
+        // arg doesn't look like a number
+
+        if (align == '=') {
+            if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                terse_str_format_value_error();
+            } else {
+                mp_raise_ValueError(
+                    "'=' alignment not allowed in string format specifier");
+            }
+        }
+
+        switch (type) {
+            case '\0': // no explicit format type implies 's'
+            case 's': {
+                size_t slen;
+                const char *s = mp_obj_str_get_data(arg, &slen);
+                if (precision < 0) {
+                    precision = slen;
+                }
+                if (slen > (size_t)precision) {
+                    slen = precision;
+                }
+                mp_print_strn(print, s, slen, flags, fill, width);
+                break;
+            }
+
+            default:
+                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                    terse_str_format_value_error();
+                } else {
+                    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                        "unknown format code '%c' for object of type '%s'",
+                        type, mp_obj_get_type_str(arg)));
+                }
+        }
+    }
+}
+
 STATIC vstr_t mp_obj_str_format_helper(const char *str, const char *top, int *arg_i, size_t n_args, const mp_obj_t *args, mp_map_t *kwargs) {
     vstr_t vstr;
     mp_print_t print;
@@ -1092,86 +1513,14 @@ STATIC vstr_t mp_obj_str_format_helper(const char *str, const char *top, int *ar
             arg = args[(*arg_i) + 1];
             (*arg_i)++;
         }
-        if (!format_spec && !conversion) {
-            conversion = 's';
-        }
-        if (conversion) {
-            mp_print_kind_t print_kind;
-            if (conversion == 's') {
-                print_kind = PRINT_STR;
-            } else {
-                assert(conversion == 'r');
-                print_kind = PRINT_REPR;
-            }
-            vstr_t arg_vstr;
-            mp_print_t arg_print;
-            vstr_init_print(&arg_vstr, 16, &arg_print);
-            mp_obj_print_helper(&arg_print, arg, print_kind);
-            arg = mp_obj_new_str_from_vstr(&mp_type_str, &arg_vstr);
-        }
-
-        char fill = '\0';
-        char align = '\0';
-        int width = -1;
-        int precision = -1;
-        char type = '\0';
-        int flags = 0;
 
+        str_format_spec_t spec;
+        str_format_spec_init(&spec, conversion, format_spec != NULL);
         if (format_spec) {
-            // The format specifier (from http://docs.python.org/2/library/string.html#formatspec)
-            //
-            // [[fill]align][sign][#][0][width][,][.precision][type]
-            // fill        ::=  <any character>
-            // align       ::=  "<" | ">" | "=" | "^"
-            // sign        ::=  "+" | "-" | " "
-            // width       ::=  integer
-            // precision   ::=  integer
-            // type        ::=  "b" | "c" | "d" | "e" | "E" | "f" | "F" | "g" | "G" | "n" | "o" | "s" | "x" | "X" | "%"
-
             // recursively call the formatter to format any nested specifiers
             MP_STACK_CHECK();
             vstr_t format_spec_vstr = mp_obj_str_format_helper(format_spec, str, arg_i, n_args, args, kwargs);
-            const char *s = vstr_null_terminated_str(&format_spec_vstr);
-            const char *stop = s + format_spec_vstr.len;
-            if (isalignment(*s)) {
-                align = *s++;
-            } else if (*s && isalignment(s[1])) {
-                fill = *s++;
-                align = *s++;
-            }
-            if (*s == '+' || *s == '-' || *s == ' ') {
-                if (*s == '+') {
-                    flags |= PF_FLAG_SHOW_SIGN;
-                } else if (*s == ' ') {
-                    flags |= PF_FLAG_SPACE_SIGN;
-                }
-                s++;
-            }
-            if (*s == '#') {
-                flags |= PF_FLAG_SHOW_PREFIX;
-                s++;
-            }
-            if (*s == '0') {
-                if (!align) {
-                    align = '=';
-                }
-                if (!fill) {
-                    fill = '0';
-                }
-            }
-            s = str_to_int(s, stop, &width);
-            if (*s == ',') {
-                flags |= PF_FLAG_SHOW_COMMA;
-                s++;
-            }
-            if (*s == '.') {
-                s++;
-                s = str_to_int(s, stop, &precision);
-            }
-            if (istype(*s)) {
-                type = *s++;
-            }
-            if (*s) {
+            if (!str_format_parse_spec(format_spec_vstr.buf, format_spec_vstr.buf + format_spec_vstr.len, &spec)) {
                 if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
                     terse_str_format_value_error();
                 } else {
@@ -1180,210 +1529,339 @@ STATIC vstr_t mp_obj_str_format_helper(const char *str, const char *top, int *ar
             }
             vstr_clear(&format_spec_vstr);
         }
-        if (!align) {
-            if (arg_looks_numeric(arg)) {
-                align = '>';
-            } else {
-                align = '<';
+        str_format_field(&print, arg, &spec);
+    }
+
+    return vstr;
+}
+
+#if MICROPY_OPT_STR_FORMAT_CACHE
+
+// A format string that is an interned literal can be compiled once into a
+// list of items, each some literal text of the format string followed by
+// the argument and parsed spec of a field.  Formatting with it then copies
+// the text and prints the fields without looking at the format string
+// again.  Anything the compiler doesn't handle, like nested fields or an
+// invalid format, isn't cached and goes the slow way, which also raises
+// the right error at the right point.
+
+#define STR_FORMAT_MAX_ITEMS (16)
+#define STR_FORMAT_ARG_NONE (-1) // only literal text
+#define STR_FORMAT_ARG_KEY (-2) // a keyword argument or % dict key
+#define STR_FORMAT_NOT_COMPILED (0xffff) // n_items of a format left to the slow way
+
+enum {
+    STR_FORMAT_KIND_BRACES,
+    STR_FORMAT_KIND_MODULO,
+};
+
+typedef struct _str_format_item_t {
+    uint16_t lit_off;
+    uint16_t lit_len;
+    int16_t arg;
+    qstr key;
+    str_format_spec_t spec;
+} str_format_item_t;
+
+typedef struct _str_format_prog_t {
+    qstr fmt;
+    uint16_t kind;
+    uint16_t n_items;
+    size_t lit_len;
+    str_format_item_t items[];
+} str_format_prog_t;
+
+typedef struct _str_format_compiler_t {
+    const char *start;
+    const char *lit;
+    size_t n_items;
+    str_format_item_t items[STR_FORMAT_MAX_ITEMS];
+} str_format_compiler_t;
+
+// Add an item for the literal text up to top.  Returns NULL if full.
+STATIC str_format_item_t *str_format_add_item(str_format_compiler_t *c, const char *top, int arg) {
+    if (c->n_items == STR_FORMAT_MAX_ITEMS) {
+        return NULL;
+    }
+    str_format_item_t *item = &c->items[c->n_items++];
+    item->lit_off = c->lit - c->start;
+    item->lit_len = top - c->lit;
+    item->arg = arg;
+    item->key = MP_QSTR_NULL;
+    return item;
+}
+
+STATIC bool str_format_compile_braces(str_format_compiler_t *c, const char *str, const char *top) {
+    int arg_i = 0;
+    for (; str < top; str++) {
+        if (*str != '{' && *str != '}') {
+            continue;
+        }
+        if (str + 1 < top && str[1] == *str) {
+            // an escaped brace, keep the first as literal text
+            if (!str_format_add_item(c, str + 1, STR_FORMAT_ARG_NONE)) {
+                return false;
             }
+            str++;
+            c->lit = str + 1;
+            continue;
         }
-        if (!fill) {
-            fill = ' ';
+        if (*str == '}') {
+            return false;
         }
+        const char *lit_top = str++;
 
-        if (flags & (PF_FLAG_SHOW_SIGN | PF_FLAG_SPACE_SIGN)) {
-            if (type == 's') {
-                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                    terse_str_format_value_error();
-                } else {
-                    mp_raise_ValueError("sign not allowed in string format specifier");
-                }
+        const char *field_name = str;
+        while (str < top && *str != '}' && *str != '!' && *str != ':') {
+            ++str;
+        }
+        const char *field_name_top = str;
+        char conversion = '\0';
+        if (str < top && *str == '!') {
+            if (++str == top || (*str != 'r' && *str != 's')) {
+                return false;
             }
-            if (type == 'c') {
-                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                    terse_str_format_value_error();
-                } else {
-                    mp_raise_ValueError(
-                        "sign not allowed with integer format specifier 'c'");
+            conversion = *str++;
+        }
+        const char *format_spec = NULL;
+        if (str < top && *str == ':' && ++str < top && *str != '}') {
+            format_spec = str;
+            while (str < top && *str != '}') {
+                if (*str++ == '{') {
+                    // nested fields are substituted at format time
+                    return false;
                 }
             }
         }
-
-        switch (align) {
-            case '<': flags |= PF_FLAG_LEFT_ADJUST;     break;
-            case '=': flags |= PF_FLAG_PAD_AFTER_SIGN;  break;
-            case '^': flags |= PF_FLAG_CENTER_ADJUST;   break;
+        if (str == top || *str != '}') {
+            return false;
         }
 
-        if (arg_looks_integer(arg)) {
-            switch (type) {
-                case 'b':
-                    mp_print_mp_int(&print, arg, 2, 'a', flags, fill, width, 0);
-                    continue;
-
-                case 'c':
-                {
-                    char ch = mp_obj_get_int(arg);
-                    mp_print_strn(&print, &ch, 1, flags, fill, width);
-                    continue;
+        int index;
+        qstr key = MP_QSTR_NULL;
+        if (field_name == field_name_top) {
+            if (arg_i < 0) {
+                return false;
+            }
+            index = arg_i++;
+        } else if (unichar_isdigit(*field_name)) {
+            if (arg_i > 0) {
+                return false;
+            }
+            index = 0;
+            if (str_to_int(field_name, field_name_top, &index) != field_name_top || index > 0x7fff) {
+                return false;
+            }
+            arg_i = -1;
+        } else {
+            for (const char *s = field_name; s < field_name_top; ++s) {
+                if (*s == '.' || *s == '[') {
+                    return false;
                 }
+            }
+            index = STR_FORMAT_ARG_KEY;
+            key = qstr_from_strn(field_name, field_name_top - field_name);
+        }
 
-                case '\0':  // No explicit format type implies 'd'
-                case 'n':   // I don't think we support locales in uPy so use 'd'
-                case 'd':
-                    mp_print_mp_int(&print, arg, 10, 'a', flags, fill, width, 0);
-                    continue;
-
-                case 'o':
-                    if (flags & PF_FLAG_SHOW_PREFIX) {
-                        flags |= PF_FLAG_SHOW_OCTAL_LETTER;
-                    }
+        str_format_item_t *item = str_format_add_item(c, lit_top, index);
+        if (item == NULL) {
+            return false;
+        }
+        item->key = key;
+        str_format_spec_init(&item->spec, conversion, format_spec != NULL);
+        if (format_spec && !str_format_parse_spec(format_spec, str, &item->spec)) {
+            return false;
+        }
+        c->lit = str + 1;
+    }
+    return true;
+}
 
-                    mp_print_mp_int(&print, arg, 8, 'a', flags, fill, width, 0);
-                    continue;
-
-                case 'X':
-                case 'x':
-                    mp_print_mp_int(&print, arg, 16, type - ('X' - 'A'), flags, fill, width, 0);
-                    continue;
-
-                case 'e':
-                case 'E':
-                case 'f':
-                case 'F':
-                case 'g':
-                case 'G':
-                case '%':
-                    // The floating point formatters all work with anything that
-                    // looks like an integer
-                    break;
+#if MICROPY_PY_BUILTINS_STR_OP_MODULO
+STATIC bool str_format_compile_modulo(str_format_compiler_t *c, const char *str, const char *top) {
+    for (; str < top; str++) {
+        if (*str != '%') {
+            continue;
+        }
+        if (str + 1 < top && str[1] == '%') {
+            if (!str_format_add_item(c, str + 1, STR_FORMAT_ARG_NONE)) {
+                return false;
+            }
+            str++;
+            c->lit = str + 1;
+            continue;
+        }
+        const char *lit_top = str++;
 
-                default:
-                    if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                        terse_str_format_value_error();
-                    } else {
-                        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
-                            "unknown format code '%c' for object of type '%s'",
-                            type, mp_obj_get_type_str(arg)));
-                    }
+        qstr key = MP_QSTR_NULL;
+        if (str < top && *str == '(') {
+            const char *k = ++str;
+            while (str < top && *str != ')') {
+                ++str;
             }
+            if (str == top) {
+                return false;
+            }
+            key = qstr_from_strn(k, str - k);
+            str++;
         }
 
-        // NOTE: no else here. We need the e, f, g etc formats for integer
-        //       arguments (from above if) to take this if.
-        if (arg_looks_numeric(arg)) {
-            if (!type) {
-
-                // Even though the docs say that an unspecified type is the same
-                // as 'g', there is one subtle difference, when the exponent
-                // is one less than the precision.
-                //
-                // '{:10.1}'.format(0.0) ==> '0e+00'
-                // '{:10.1g}'.format(0.0) ==> '0'
-                //
-                // TODO: Figure out how to deal with this.
-                //
-                // A proper solution would involve adding a special flag
-                // or something to format_float, and create a format_double
-                // to deal with doubles. In order to fix this when using
-                // sprintf, we'd need to use the e format and tweak the
-                // returned result to strip trailing zeros like the g format
-                // does.
-                //
-                // {:10.3} and {:10.2e} with 1.23e2 both produce 1.23e+02
-                // but with 1.e2 you get 1e+02 and 1.00e+02
-                //
-                // Stripping the trailing 0's (like g) does would make the
-                // e format give us the right format.
-                //
-                // CPython sources say:
-                //   Omitted type specifier.  Behaves in the same way as repr(x)
-                //   and str(x) if no precision is given, else like 'g', but with
-                //   at least one digit after the decimal point. */
-
-                type = 'g';
-            }
-            if (type == 'n') {
-                type = 'g';
-            }
-
-            switch (type) {
-#if MICROPY_PY_BUILTINS_FLOAT
-                case 'e':
-                case 'E':
-                case 'f':
-                case 'F':
-                case 'g':
-                case 'G':
-                    mp_print_float(&print, mp_obj_get_float(arg), type, flags, fill, width, precision);
-                    break;
+        str_format_spec_t spec;
+        str_format_spec_init(&spec, '\0', true);
+        spec.fill = ' ';
+        for (; str < top; str++) {
+            if (*str == '-')      spec.flags |= PF_FLAG_LEFT_ADJUST;
+            else if (*str == '+') spec.flags |= PF_FLAG_SHOW_SIGN;
+            else if (*str == ' ') spec.flags |= PF_FLAG_SPACE_SIGN;
+            else if (*str == '#') spec.alt = true;
+            else if (*str == '0') {
+                spec.flags |= PF_FLAG_PAD_AFTER_SIGN;
+                spec.fill = '0';
+            } else break;
+        }
+        // a '*' width or precision takes an argument, leave it to the slow way
+        spec.width = 0;
+        str = str_to_int(str, top, &spec.width);
+        if (str < top && *str == '.') {
+            if (++str < top) {
+                spec.precision = 0;
+                str = str_to_int(str, top, &spec.precision);
+            }
+        }
+        if (str == top || *str == '\0' || strchr("cdiueEfFgGorsxX", *str) == NULL) {
+            return false;
+        }
+        #if !MICROPY_PY_BUILTINS_FLOAT
+        if (strchr("eEfFgG", *str) != NULL) {
+            return false;
+        }
+        #endif
+        spec.type = *str;
 
-                case '%':
-                    flags |= PF_FLAG_ADD_PERCENT;
-                    #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
-                    #define F100 100.0F
-                    #else
-                    #define F100 100.0
-                    #endif
-                    mp_print_float(&print, mp_obj_get_float(arg) * F100, 'f', flags, fill, width, precision);
-                    #undef F100
-                    break;
+        str_format_item_t *item = str_format_add_item(c, lit_top, key == MP_QSTR_NULL ? 0 : STR_FORMAT_ARG_KEY);
+        if (item == NULL) {
+            return false;
+        }
+        item->key = key;
+        item->spec = spec;
+        c->lit = str + 1;
+    }
+    return true;
+}
 #endif
 
-                default:
-                    if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                        terse_str_format_value_error();
-                    } else {
-                        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
-                            "unknown format code '%c' for object of type '%s'",
-                            type, mp_obj_get_type_str(arg)));
-                    }
-            }
-        } else {
-            // arg doesn't look like a number
+// Find the compiled form of the interned format string fmt, compiling it if
+// need be.  Returns NULL if it can't be compiled.
+STATIC const str_format_prog_t *str_format_get_prog(mp_obj_t fmt, uint16_t kind) {
+    qstr q = MP_OBJ_QSTR_VALUE(fmt);
+    str_format_prog_t **cache = (str_format_prog_t **)MP_STATE_VM(str_format_cache);
+    size_t i;
+    for (i = 0; i < MICROPY_OPT_STR_FORMAT_CACHE && cache[i] != NULL; ++i) {
+        if (cache[i]->fmt == q && cache[i]->kind == kind) {
+            // move to the front so the least recently used is last
+            str_format_prog_t *prog = cache[i];
+            memmove(&cache[1], &cache[0], i * sizeof(*cache));
+            cache[0] = prog;
+            return prog->n_items == STR_FORMAT_NOT_COMPILED ? NULL : prog;
+        }
+    }
 
-            if (align == '=') {
-                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                    terse_str_format_value_error();
-                } else {
-                    mp_raise_ValueError(
-                        "'=' alignment not allowed in string format specifier");
-                }
-            }
+    size_t len;
+    const char *str = (const char *)qstr_data(q, &len);
+    if (len > 0xffff) {
+        return NULL;
+    }
+    str_format_compiler_t c;
+    c.start = str;
+    c.lit = str;
+    c.n_items = 0;
+    bool ok;
+    #if MICROPY_PY_BUILTINS_STR_OP_MODULO
+    if (kind == STR_FORMAT_KIND_MODULO) {
+        ok = str_format_compile_modulo(&c, str, str + len);
+    } else
+    #endif
+    {
+        ok = str_format_compile_braces(&c, str, str + len);
+    }
+    if (ok && c.lit < str + len) {
+        ok = str_format_add_item(&c, str + len, STR_FORMAT_ARG_NONE) != NULL;
+    }
+    if (!ok) {
+        // remember not to try again
+        c.n_items = 0;
+    }
 
-            switch (type) {
-                case '\0': // no explicit format type implies 's'
-                case 's': {
-                    size_t slen;
-                    const char *s = mp_obj_str_get_data(arg, &slen);
-                    if (precision < 0) {
-                        precision = slen;
-                    }
-                    if (slen > (size_t)precision) {
-                        slen = precision;
-                    }
-                    mp_print_strn(&print, s, slen, flags, fill, width);
-                    break;
-                }
+    str_format_prog_t *prog = m_malloc_maybe(sizeof(str_format_prog_t) + c.n_items * sizeof(str_format_item_t));
+    if (prog == NULL) {
+        return NULL;
+    }
+    prog->fmt = q;
+    prog->kind = kind;
+    prog->n_items = ok ? c.n_items : STR_FORMAT_NOT_COMPILED;
+    prog->lit_len = 0;
+    for (size_t j = 0; j < c.n_items; ++j) {
+        prog->lit_len += c.items[j].lit_len;
+    }
+    memcpy(prog->items, c.items, c.n_items * sizeof(str_format_item_t));
 
-                default:
-                    if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                        terse_str_format_value_error();
-                    } else {
-                        nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
-                            "unknown format code '%c' for object of type '%s'",
-                            type, mp_obj_get_type_str(arg)));
-                    }
+    // an evicted program may still be running in a __str__ further up the
+    // stack so is left for the GC
+    if (i == MICROPY_OPT_STR_FORMAT_CACHE) {
+        --i;
+    }
+    memmove(&cache[1], &cache[0], i * sizeof(*cache));
+    cache[0] = prog;
+    return ok ? prog : NULL;
+}
+
+STATIC void str_format_prog_init_vstr(const str_format_prog_t *prog, vstr_t *vstr, mp_print_t *print) {
+    vstr_init_print(vstr, prog->lit_len + 8 * prog->n_items + 1, print);
+}
+
+STATIC vstr_t str_format_run_braces(const str_format_prog_t *prog, size_t n_args, const mp_obj_t *args, mp_map_t *kwargs) {
+    const char *fmt = qstr_str(prog->fmt);
+    vstr_t vstr;
+    mp_print_t print;
+    str_format_prog_init_vstr(prog, &vstr, &print);
+    for (size_t i = 0; i < prog->n_items; ++i) {
+        const str_format_item_t *item = &prog->items[i];
+        vstr_add_strn(&vstr, fmt + item->lit_off, item->lit_len);
+        mp_obj_t arg;
+        if (item->arg == STR_FORMAT_ARG_NONE) {
+            continue;
+        } else if (item->arg == STR_FORMAT_ARG_KEY) {
+            mp_map_elem_t *key_elem = mp_map_lookup(kwargs, MP_OBJ_NEW_QSTR(item->key), MP_MAP_LOOKUP);
+            if (key_elem == NULL) {
+                nlr_raise(mp_obj_new_exception_arg1(&mp_type_KeyError, MP_OBJ_NEW_QSTR(item->key)));
+            }
+            arg = key_elem->value;
+        } else {
+            if ((uint)item->arg >= n_args - 1) {
+                mp_raise_msg(&mp_type_IndexError, "tuple index out of range");
             }
+            arg = args[item->arg + 1];
         }
+        str_format_field(&print, arg, &item->spec);
     }
-
     return vstr;
 }
 
+#endif // MICROPY_OPT_STR_FORMAT_CACHE
+
 mp_obj_t mp_obj_str_format(size_t n_args, const mp_obj_t *args, mp_map_t *kwargs) {
     mp_check_self(mp_obj_is_str_or_bytes(args[0]));
 
+    #if MICROPY_OPT_STR_FORMAT_CACHE
+    if (mp_obj_is_qstr(args[0])) {
+        const str_format_prog_t *prog = str_format_get_prog(args[0], STR_FORMAT_KIND_BRACES);
+        if (prog != NULL) {
+            vstr_t vstr = str_format_run_braces(prog, n_args, args, kwargs);
+            return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
+        }
+    }
+    #endif
+
     GET_STR_DATA_LEN(args[0], str, len);
     int arg_i = 0;
     vstr_t vstr = mp_obj_str_format_helper((const char*)str, (const char*)str + len, &arg_i, n_args, args, kwargs);
@@ -1392,9 +1870,138 @@ mp_obj_t mp_obj_str_format(size_t n_args, const mp_obj_t *args, mp_map_t *kwargs
 MP_DEFINE_CONST_FUN_OBJ_KW(str_format_obj, 1, mp_obj_str_format);
 
 #if MICROPY_PY_BUILTINS_STR_OP_MODULO
+// Print arg for one conversion of % formatting
+STATIC void str_modulo_field(const mp_print_t *print, mp_obj_t arg, const str_format_spec_t *spec, bool is_bytes) {
+    int flags = spec->flags;
+    char fill = spec->fill;
+    int alt = spec->alt ? PF_FLAG_SHOW_PREFIX : 0;
+    int width = spec->width;
+    int prec = spec->precision;
+    switch (spec->type) {
+        case 'c':
+            if (mp_obj_is_str(arg)) {
+                size_t slen;
+                const char *s = mp_obj_str_get_data(arg, &slen);
+                if (slen != 1) {
+                    mp_raise_TypeError("%%c needs int or char");
+                }
+                mp_print_strn(print, s, 1, flags, ' ', width);
+            } else if (arg_looks_integer(arg)) {
+                char ch = mp_obj_get_int(arg);
+                mp_print_strn(print, &ch, 1, flags, ' ', width);
+            } else {
+                mp_raise_TypeError("integer needed");
+            }
+            break;
+
+        case 'd':
+        case 'i':
+        case 'u':
+            mp_print_mp_int(print, arg_as_int(arg), 10, 'a', flags, fill, width, prec);
+            break;
+
+#if MICROPY_PY_BUILTINS_FLOAT
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+            mp_print_float(print, mp_obj_get_float(arg), spec->type, flags, fill, width, prec);
+            break;
+#endif
+
+        case 'o':
+            if (alt) {
+                flags |= (PF_FLAG_SHOW_PREFIX | PF_FLAG_SHOW_OCTAL_LETTER);
+            }
+            mp_print_mp_int(print, arg, 8, 'a', flags, fill, width, prec);
+            break;
+
+        case 'r':
+        case 's':
+        {
+            vstr_t arg_vstr;
+            mp_print_t arg_print;
+            vstr_init_print(&arg_vstr, 16, &arg_print);
+            mp_print_kind_t print_kind = (spec->type == 'r' ? PRINT_REPR : PRINT_STR);
+            if (print_kind == PRINT_STR && is_bytes && mp_obj_is_type(arg, &mp_type_bytes)) {
+                // If we have something like b"%s" % b"1", bytes arg should be
+                // printed undecorated.
+                print_kind = PRINT_RAW;
+            }
+            mp_obj_print_helper(&arg_print, arg, print_kind);
+            uint vlen = arg_vstr.len;
+            if (prec < 0) {
+                prec = vlen;
+            }
+            if (vlen > (uint)prec) {
+                vlen = prec;
+            }
+            mp_print_strn(print, arg_vstr.buf, vlen, flags, ' ', width);
+            vstr_clear(&arg_vstr);
+            break;
+        }
+
+        case 'X':
+        case 'x':
+            mp_print_mp_int(print, arg, 16, spec->type - ('X' - 'A'), flags | alt, fill, width, prec);
+            break;
+
+        default:
+            // the caller has checked the conversion type
+            assert(0);
+    }
+}
+
+#if MICROPY_OPT_STR_FORMAT_CACHE
+STATIC mp_obj_t str_modulo_run(const str_format_prog_t *prog, size_t n_args, const mp_obj_t *args, mp_obj_t dict) {
+    const char *fmt = qstr_str(prog->fmt);
+    size_t arg_i = 0;
+    vstr_t vstr;
+    mp_print_t print;
+    str_format_prog_init_vstr(prog, &vstr, &print);
+    for (size_t i = 0; i < prog->n_items; ++i) {
+        const str_format_item_t *item = &prog->items[i];
+        vstr_add_strn(&vstr, fmt + item->lit_off, item->lit_len);
+        mp_obj_t arg;
+        if (item->arg == STR_FORMAT_ARG_NONE) {
+            continue;
+        } else if (item->arg == STR_FORMAT_ARG_KEY) {
+            if (dict == MP_OBJ_NULL) {
+                mp_raise_TypeError("format needs a dict");
+            }
+            arg_i = 1; // we used up the single dict argument
+            arg = mp_obj_dict_get(dict, MP_OBJ_NEW_QSTR(item->key));
+        } else {
+            if (arg_i >= n_args) {
+                mp_raise_TypeError("format string needs more arguments");
+            }
+            arg = args[arg_i++];
+        }
+        str_modulo_field(&print, arg, &item->spec, false);
+    }
+
+    if (arg_i != n_args) {
+        mp_raise_TypeError("format string didn't convert all arguments");
+    }
+
+    return mp_obj_new_str_from_vstr(&mp_type_str, &vstr);
+}
+#endif
+
 STATIC mp_obj_t str_modulo_format(mp_obj_t pattern, size_t n_args, const mp_obj_t *args, mp_obj_t dict) {
     mp_check_self(mp_obj_is_str_or_bytes(pattern));
 
+    #if MICROPY_OPT_STR_FORMAT_CACHE
+    if (mp_obj_is_qstr(pattern)) {
+        const str_format_prog_t *prog = str_format_get_prog(pattern, STR_FORMAT_KIND_MODULO);
+        if (prog != NULL) {
+            return str_modulo_run(prog, n_args, args, dict);
+        }
+    }
+    #endif
+
     GET_STR_DATA_LEN(pattern, str, len);
     const byte *start_str = str;
     bool is_bytes = mp_obj_is_type(pattern, &mp_type_bytes);
@@ -1439,45 +2046,44 @@ STATIC mp_obj_t str_modulo_format(mp_obj_t pattern, size_t n_args, const mp_obj_
             str++;
         }
 
-        int flags = 0;
-        char fill = ' ';
-        int alt = 0;
+        str_format_spec_t spec;
+        str_format_spec_init(&spec, '\0', true);
+        spec.fill = ' ';
         while (str < top) {
-            if (*str == '-')      flags |= PF_FLAG_LEFT_ADJUST;
-            else if (*str == '+') flags |= PF_FLAG_SHOW_SIGN;
-            else if (*str == ' ') flags |= PF_FLAG_SPACE_SIGN;
-            else if (*str == '#') alt = PF_FLAG_SHOW_PREFIX;
+            if (*str == '-')      spec.flags |= PF_FLAG_LEFT_ADJUST;
+            else if (*str == '+') spec.flags |= PF_FLAG_SHOW_SIGN;
+            else if (*str == ' ') spec.flags |= PF_FLAG_SPACE_SIGN;
+            else if (*str == '#') spec.alt = true;
             else if (*str == '0') {
-                flags |= PF_FLAG_PAD_AFTER_SIGN;
-                fill = '0';
+                spec.flags |= PF_FLAG_PAD_AFTER_SIGN;
+                spec.fill = '0';
             } else break;
             str++;
         }
         // parse width, if it exists
-        int width = 0;
+        spec.width = 0;
         if (str < top) {
             if (*str == '*') {
                 if (arg_i >= n_args) {
                     goto not_enough_args;
                 }
-                width = mp_obj_get_int(args[arg_i++]);
+                spec.width = mp_obj_get_int(args[arg_i++]);
                 str++;
             } else {
-                str = (const byte*)str_to_int((const char*)str, (const char*)top, &width);
+                str = (const byte*)str_to_int((const char*)str, (const char*)top, &spec.width);
             }
         }
-        int prec = -1;
         if (str < top && *str == '.') {
             if (++str < top) {
                 if (*str == '*') {
                     if (arg_i >= n_args) {
                         goto not_enough_args;
                     }
-                    prec = mp_obj_get_int(args[arg_i++]);
+                    spec.precision = mp_obj_get_int(args[arg_i++]);
                     str++;
                 } else {
-                    prec = 0;
-                    str = (const byte*)str_to_int((const char*)str, (const char*)top, &prec);
+                    spec.precision = 0;
+                    str = (const byte*)str_to_int((const char*)str, (const char*)top, &spec.precision);
                 }
             }
         }
@@ -1499,86 +2105,21 @@ not_enough_args:
             }
             arg = args[arg_i++];
         }
-        switch (*str) {
-            case 'c':
-                if (mp_obj_is_str(arg)) {
-                    size_t slen;
-                    const char *s = mp_obj_str_get_data(arg, &slen);
-                    if (slen != 1) {
-                        mp_raise_TypeError("%%c needs int or char");
-                    }
-                    mp_print_strn(&print, s, 1, flags, ' ', width);
-                } else if (arg_looks_integer(arg)) {
-                    char ch = mp_obj_get_int(arg);
-                    mp_print_strn(&print, &ch, 1, flags, ' ', width);
-                } else {
-                    mp_raise_TypeError("integer needed");
-                }
-                break;
-
-            case 'd':
-            case 'i':
-            case 'u':
-                mp_print_mp_int(&print, arg_as_int(arg), 10, 'a', flags, fill, width, prec);
-                break;
-
-#if MICROPY_PY_BUILTINS_FLOAT
-            case 'e':
-            case 'E':
-            case 'f':
-            case 'F':
-            case 'g':
-            case 'G':
-                mp_print_float(&print, mp_obj_get_float(arg), *str, flags, fill, width, prec);
-                break;
-#endif
-
-            case 'o':
-                if (alt) {
-                    flags |= (PF_FLAG_SHOW_PREFIX | PF_FLAG_SHOW_OCTAL_LETTER);
-                }
-                mp_print_mp_int(&print, arg, 8, 'a', flags, fill, width, prec);
-                break;
-
-            case 'r':
-            case 's':
-            {
-                vstr_t arg_vstr;
-                mp_print_t arg_print;
-                vstr_init_print(&arg_vstr, 16, &arg_print);
-                mp_print_kind_t print_kind = (*str == 'r' ? PRINT_REPR : PRINT_STR);
-                if (print_kind == PRINT_STR && is_bytes && mp_obj_is_type(arg, &mp_type_bytes)) {
-                    // If we have something like b"%s" % b"1", bytes arg should be
-                    // printed undecorated.
-                    print_kind = PRINT_RAW;
-                }
-                mp_obj_print_helper(&arg_print, arg, print_kind);
-                uint vlen = arg_vstr.len;
-                if (prec < 0) {
-                    prec = vlen;
-                }
-                if (vlen > (uint)prec) {
-                    vlen = prec;
-                }
-                mp_print_strn(&print, arg_vstr.buf, vlen, flags, ' ', width);
-                vstr_clear(&arg_vstr);
-                break;
+        if (*str == '\0' || strchr("cdiu"
+            #if MICROPY_PY_BUILTINS_FLOAT
+            "eEfFgG"
+            #endif
+            "orsxX", *str) == NULL) {
+            if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                terse_str_format_value_error();
+            } else {
+                nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                    "unsupported format character '%c' (0x%x) at index %d",
+                    *str, *str, str - start_str));
             }
-
-            case 'X':
-            case 'x':
-                mp_print_mp_int(&print, arg, 16, *str - ('X' - 'A'), flags | alt, fill, width, prec);
-                break;
-
-            default:
-                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
-                    terse_str_format_value_error();
-                } else {
-                    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
-                        "unsupported format character '%c' (0x%x) at index %d",
-                        *str, *str, str - start_str));
-                }
         }
+        spec.type = *str;
+        str_modulo_field(&print, arg, &spec, is_bytes);
     }
 
     if (arg_i != n_args) {
@@ -1726,6 +2267,15 @@ STATIC mp_obj_t str_count(size_t n_args, const mp_obj_t *args) {
 
     // count the occurrences
     mp_int_t num_occurrences = 0;
+    #if MICROPY_OPT_STR_FIND_FAST
+    // a match can't start in the middle of a utf-8 char so every byte can be
+    // tried, which find_subbytes does quickly
+    for (const byte *haystack_ptr = start;
+        (haystack_ptr = find_subbytes(haystack_ptr, end - haystack_ptr, needle, needle_len, 1)) != NULL;
+        haystack_ptr += needle_len) {
+        num_occurrences++;
+    }
+    #else
     for (const byte *haystack_ptr = start; haystack_ptr + needle_len <= end;) {
         if (memcmp(haystack_ptr, needle, needle_len) == 0) {
             num_occurrences++;
@@ -1734,6 +2284,7 @@ STATIC mp_obj_t str_count(size_t n_args, const mp_obj_t *args) {
             haystack_ptr = utf8_next_char(haystack_ptr);
         }
     }
+    #endif
 
     return MP_OBJ_NEW_SMALL_INT(num_occurrences);
 }
@@ -2002,6 +2553,17 @@ const mp_obj_type_t mp_type_bytes = {
 // The zero-length bytes object, with data that includes a null-terminating byte
 const mp_obj_str_t mp_const_empty_bytes_obj = {{&mp_type_bytes}, 0, 0, (const byte*)""};
 
+// The hash to give a new str/bytes object; 0, meaning not computed, for long
+// data that may never be hashed
+STATIC mp_uint_t str_new_hash(const byte *data, size_t len) {
+    #if MICROPY_OPT_STR_LAZY_HASH
+    if (len >= MICROPY_OPT_STR_LAZY_HASH) {
+        return 0;
+    }
+    #endif
+    return qstr_compute_hash(data, len);
+}
+
 // Create a str/bytes object using the given data.  New memory is allocated and
 // the data is copied across.  This function should only be used if the type is bytes,
 // or if the type is str and the string data is known to be not interned.
@@ -2010,7 +2572,7 @@ mp_obj_t mp_obj_new_str_copy(const mp_obj_type_t *type, const byte* data, size_t
     o->base.type = type;
     o->len = len;
     if (data) {
-        o->hash = qstr_compute_hash(data, len);
+        o->hash = str_new_hash(data, len);
         byte *p = m_new(byte, len + 1);
         o->data = p;
         memcpy(p, data, len * sizeof(byte));
@@ -2019,6 +2581,37 @@ mp_obj_t mp_obj_new_str_copy(const mp_obj_type_t *type, const byte* data, size_t
     return MP_OBJ_FROM_PTR(o);
 }
 
+#if MICROPY_OPT_STR_SLICE_VIEW
+// A str/bytes whose data is inside the data of another str/bytes object.
+// The GC only follows pointers to the start of a heap block, so that object
+// is referenced here to keep the data alive.
+typedef struct _mp_obj_str_view_t {
+    mp_obj_str_t str;
+    mp_obj_t parent;
+} mp_obj_str_view_t;
+#endif
+
+// Create a str/bytes object for the slice data[0:len] of self_in, which has
+// length self_len.  Large slices refer to the data of self_in rather than
+// copying it, unless that would keep a much larger object alive.
+mp_obj_t mp_obj_str_new_slice(const mp_obj_type_t *type, mp_obj_t self_in, size_t self_len, const byte *data, size_t len) {
+    #if MICROPY_OPT_STR_SLICE_VIEW
+    if (len >= MICROPY_OPT_STR_SLICE_VIEW && len >= self_len / 4) {
+        mp_obj_str_view_t *o = m_new_obj(mp_obj_str_view_t);
+        o->str.base.type = type;
+        o->str.hash = 0;
+        o->str.len = len;
+        o->str.data = data;
+        o->parent = self_in;
+        return MP_OBJ_FROM_PTR(o);
+    }
+    #else
+    (void)self_in;
+    (void)self_len;
+    #endif
+    return mp_obj_new_str_of_type(type, data, len);
+}
+
 // Create a str/bytes object using the given data.  If the type is str and the string
 // data is already interned, then a qstr object is returned.  Otherwise new memory is
 // allocated for the object and the data is copied across.
@@ -2053,7 +2646,7 @@ mp_obj_t mp_obj_new_str_from_vstr(const mp_obj_type_t *type, vstr_t *vstr) {
     mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
     o->base.type = type;
     o->len = vstr->len;
-    o->hash = qstr_compute_hash((byte*)vstr->buf, vstr->len);
+    o->hash = str_new_hash((byte*)vstr->buf, vstr->len);
     if (vstr->len + 1 == vstr->alloc) {
         o->data = (byte*)vstr->buf;
     } else {
@@ -2070,10 +2663,32 @@ mp_obj_t mp_obj_new_str(const char* data, size_t len) {
     if (q != MP_QSTR_NULL) {
         // qstr with this data already exists
         return MP_OBJ_NEW_QSTR(q);
-    } else {
-        // no existing qstr, don't make one
-        return mp_obj_new_str_copy(&mp_type_str, (const byte*)data, len);
     }
+    #if MICROPY_OPT_STR_CACHE
+    if (len <= 16) {
+        // share an equal str made recently, else make one and remember it
+        mp_uint_t hash = qstr_compute_hash((const byte*)data, len);
+        mp_obj_t *entry = &MP_STATE_VM(str_cache)[hash & (MICROPY_OPT_STR_CACHE - 1)];
+        if (*entry != MP_OBJ_NULL) {
+            const mp_obj_str_t *o = MP_OBJ_TO_PTR(*entry);
+            if (o->hash == hash && o->len == len && memcmp(o->data, data, len) == 0) {
+                return *entry;
+            }
+        }
+        mp_obj_str_t *o = m_new_obj(mp_obj_str_t);
+        o->base.type = &mp_type_str;
+        o->hash = hash;
+        o->len = len;
+        byte *p = m_new(byte, len + 1);
+        memcpy(p, data, len);
+        p[len] = '\0';
+        o->data = p;
+        *entry = MP_OBJ_FROM_PTR(o);
+        return *entry;
+    }
+    #endif
+    // no existing qstr, don't make one
+    return mp_obj_new_str_copy(&mp_type_str, (const byte*)data, len);
 }
 
 mp_obj_t mp_obj_str_intern(mp_obj_t str) {
@@ -2139,7 +2754,18 @@ qstr mp_obj_str_get_qstr(mp_obj_t self_in) {
 const char *mp_obj_str_get_str(mp_obj_t self_in) {
     if (mp_obj_is_str_or_bytes(self_in)) {
         GET_STR_DATA_LEN(self_in, s, l);
+        #if MICROPY_OPT_STR_CONCAT_INPLACE || MICROPY_OPT_STR_SLICE_VIEW
+        if (s[l] != '\0') {
+            // the data is a slice view or was appended to in place, so make a
+            // null-terminated copy
+            char *p = m_new(char, l + 1);
+            memcpy(p, s, l);
+            p[l] = '\0';
+            return p;
+        }
+        #else
         (void)l; // len unused
+        #endif
         return (const char*)s;
     } else {
         bad_implicit_conversion(self_in);
@@ -144,6 +144,7 @@ STATIC mp_uint_t stringio_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg,
         case MP_STREAM_FLUSH:
             return 0;
         case MP_STREAM_CLOSE:
+            o->ref_obj = MP_OBJ_NULL;
             #if MICROPY_CPYTHON_COMPAT
             vstr_free(o->vstr);
             o->vstr = NULL;
@@ -165,8 +166,23 @@ STATIC mp_uint_t stringio_ioctl(mp_obj_t o_in, mp_uint_t request, uintptr_t arg,
 STATIC mp_obj_t stringio_getvalue(mp_obj_t self_in) {
     mp_obj_stringio_t *self = MP_OBJ_TO_PTR(self_in);
     check_stringio_is_open(self);
-    // TODO: Try to avoid copying string
-    return mp_obj_new_str_of_type(STREAM_TO_CONTENT_TYPE(self), (byte*)self->vstr->buf, self->vstr->len);
+    const mp_obj_type_t *type = STREAM_TO_CONTENT_TYPE(self);
+    if (self->ref_obj != MP_OBJ_NULL && mp_obj_get_type(self->ref_obj) == type) {
+        // nothing written since the object was made from, or last returned, ref_obj
+        return self->ref_obj;
+    }
+    if (self->vstr->fixed_buf) {
+        return mp_obj_new_str_of_type(type, (byte*)self->vstr->buf, self->vstr->len);
+    }
+    // Hand the buffer over to the new object without copying it, and read
+    // from that object until the next write copies it back.
+    mp_obj_t value = mp_obj_new_str_from_vstr(type, self->vstr);
+    size_t len;
+    const char *data = mp_obj_str_get_data(value, &len);
+    vstr_init_fixed_buf(self->vstr, len, (char*)data);
+    self->vstr->len = len;
+    self->ref_obj = value;
+    return value;
 }
 STATIC MP_DEFINE_CONST_FUN_OBJ_1(stringio_getvalue_obj, stringio_getvalue);
 
@@ -226,6 +242,7 @@ STATIC const mp_rom_map_elem_t stringio_locals_dict_table[] = {
     { MP_ROM_QSTR(MP_QSTR_read), MP_ROM_PTR(&mp_stream_read_obj) },
     { MP_ROM_QSTR(MP_QSTR_readinto), MP_ROM_PTR(&mp_stream_readinto_obj) },
     { MP_ROM_QSTR(MP_QSTR_readline), MP_ROM_PTR(&mp_stream_unbuffered_readline_obj) },
+    { MP_ROM_QSTR(MP_QSTR_readline_into), MP_ROM_PTR(&mp_stream_readline_into_obj) },
     { MP_ROM_QSTR(MP_QSTR_write), MP_ROM_PTR(&mp_stream_write_obj) },
     { MP_ROM_QSTR(MP_QSTR_seek), MP_ROM_PTR(&mp_stream_seek_obj) },
     { MP_ROM_QSTR(MP_QSTR_flush), MP_ROM_PTR(&mp_stream_flush_obj) },
@@ -241,6 +258,7 @@ STATIC const mp_stream_p_t stringio_stream_p = {
     .read = stringio_read,
     .write = stringio_write,
     .ioctl = stringio_ioctl,
+    .is_seekable = true,
     .is_text = true,
 };
 
@@ -248,6 +266,7 @@ STATIC const mp_stream_p_t bytesio_stream_p = {
     .read = stringio_read,
     .write = stringio_write,
     .ioctl = stringio_ioctl,
+    .is_seekable = true,
 };
 
 const mp_obj_type_t mp_type_stringio = {
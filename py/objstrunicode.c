@@ -98,12 +98,76 @@ STATIC void uni_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t
     }
 }
 
+#if MICROPY_OPT_STR_INDEX_CACHE
+
+#define STR_INDEX_STEP (32)
+
+STATIC mp_str_index_t *str_index_lookup(const byte *data, size_t len) {
+    for (size_t i = 0; i < MICROPY_OPT_STR_INDEX_CACHE; ++i) {
+        mp_str_index_t *entry = &MP_STATE_VM(str_index)[i];
+        if (entry->data == data && entry->len == len) {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Find or make the index entry of a str of at least STR_INDEX_STEP bytes,
+// returning NULL if there is no memory for the offsets
+STATIC mp_str_index_t *str_index_get(const byte *data, size_t len, const uint32_t **offsets) {
+    mp_str_index_t *entry = str_index_lookup(data, len);
+    if (entry != NULL) {
+        *offsets = MP_STATE_VM(str_index_offsets)[entry - MP_STATE_VM(str_index)];
+        return entry;
+    }
+
+    size_t charlen = utf8_charlen(data, len);
+    uint32_t *offs = NULL;
+    if (charlen != len) {
+        offs = m_new_maybe(uint32_t, (charlen + STR_INDEX_STEP - 1) / STR_INDEX_STEP);
+        if (offs == NULL) {
+            return NULL;
+        }
+        const byte *s = data;
+        for (size_t i = 0; i < charlen; ++i) {
+            if (i % STR_INDEX_STEP == 0) {
+                offs[i / STR_INDEX_STEP] = s - data;
+            }
+            ++s;
+            while (UTF8_IS_CONT(*s)) {
+                ++s;
+            }
+        }
+    }
+
+    // claim the slot after allocating, because a collection can clear entries
+    size_t idx = MP_STATE_VM(str_index_idx);
+    MP_STATE_VM(str_index_idx) = (idx + 1) % MICROPY_OPT_STR_INDEX_CACHE;
+    entry = &MP_STATE_VM(str_index)[idx];
+    entry->data = data;
+    entry->len = len;
+    entry->charlen = charlen;
+    MP_STATE_VM(str_index_offsets)[idx] = offs;
+    *offsets = offs;
+    return entry;
+}
+
+#endif
+
 STATIC mp_obj_t uni_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
     GET_STR_DATA_LEN(self_in, str_data, str_len);
     switch (op) {
         case MP_UNARY_OP_BOOL:
             return mp_obj_new_bool(str_len != 0);
         case MP_UNARY_OP_LEN:
+            #if MICROPY_OPT_STR_INDEX_CACHE
+            if (str_len >= STR_INDEX_STEP) {
+                mp_str_index_t *entry = str_index_lookup(str_data, str_len);
+                if (entry != NULL) {
+                    return MP_OBJ_NEW_SMALL_INT(entry->charlen);
+                }
+            }
+            #endif
             return MP_OBJ_NEW_SMALL_INT(utf8_charlen(str_data, str_len));
         default:
             return MP_OBJ_NULL; // op not supported
@@ -132,6 +196,38 @@ const byte *str_index_to_ptr(const mp_obj_type_t *type, const byte *self_data, s
         nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_TypeError, "string indices must be integers, not %s", mp_obj_get_type_str(index)));
     }
     const byte *s, *top = self_data + self_len;
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    const uint32_t *offsets;
+    mp_str_index_t *entry;
+    if (self_len >= STR_INDEX_STEP && (entry = str_index_get(self_data, self_len, &offsets)) != NULL) {
+        if (i < 0) {
+            i += entry->charlen;
+            if (i < 0) {
+                if (is_slice) {
+                    return self_data;
+                }
+                mp_raise_msg(&mp_type_IndexError, "string index out of range");
+            }
+        } else if ((size_t)i >= entry->charlen) {
+            if (is_slice) {
+                return top;
+            }
+            mp_raise_msg(&mp_type_IndexError, "string index out of range");
+        }
+        if (offsets == NULL) {
+            // all ASCII
+            return self_data + i;
+        }
+        s = self_data + offsets[i / STR_INDEX_STEP];
+        for (i %= STR_INDEX_STEP; i > 0; --i) {
+            ++s;
+            while (UTF8_IS_CONT(*s)) {
+                ++s;
+            }
+        }
+        return s;
+    }
+    #endif
     if (i < 0)
     {
         // Negative indexing is performed by counting from the end of the string.
@@ -205,7 +301,7 @@ STATIC mp_obj_t str_subscr(mp_obj_t self_in, mp_obj_t index, mp_obj_t value) {
             if (pstop < pstart) {
                 return MP_OBJ_NEW_QSTR(MP_QSTR_);
             }
-            return mp_obj_new_str_of_type(type, (const byte *)pstart, pstop - pstart);
+            return mp_obj_str_new_slice(type, self_in, self_len, (const byte *)pstart, pstop - pstart);
         }
 #endif
         const byte *s = str_index_to_ptr(type, self_data, self_len, index, false);
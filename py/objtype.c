@@ -46,6 +46,8 @@
 
 #define TYPE_FLAG_IS_SUBCLASSED (0x0001)
 #define TYPE_FLAG_HAS_SPECIAL_ACCESSORS (0x0002)
+#define TYPE_FLAG_HAS_SLOTS (0x0004) // instances have __slots__ values in subobj
+#define TYPE_FLAG_NO_DICT (0x0008) // instances can only have __slots__ attributes
 
 STATIC mp_obj_t static_class_method_make_new(const mp_obj_type_t *self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
 
@@ -102,7 +104,12 @@ STATIC
 mp_obj_instance_t *mp_obj_new_instance(const mp_obj_type_t *class, const mp_obj_type_t **native_base) {
     size_t num_native_bases = instance_count_native_bases(class, native_base);
     assert(num_native_bases < 2);
-    mp_obj_instance_t *o = m_new_obj_var(mp_obj_instance_t, mp_obj_t, num_native_bases);
+    #if MICROPY_PY_CLASS_SLOTS
+    size_t n_subobj = ((const mp_obj_class_t*)class)->n_subobj;
+    #else
+    size_t n_subobj = num_native_bases;
+    #endif
+    mp_obj_instance_t *o = m_new_obj_var(mp_obj_instance_t, mp_obj_t, n_subobj);
     o->base.type = class;
     mp_map_init(&o->members, 0);
     // Initialise the native base-class slot (should be 1 at most) with a valid
@@ -111,6 +118,12 @@ mp_obj_instance_t *mp_obj_new_instance(const mp_obj_type_t *class, const mp_obj_
     if (num_native_bases != 0) {
         o->subobj[0] = MP_OBJ_FROM_PTR(&native_base_init_wrapper_obj);
     }
+    #if MICROPY_PY_CLASS_SLOTS
+    // __slots__ values start out unset
+    for (size_t i = num_native_bases; i < n_subobj; i++) {
+        o->subobj[i] = MP_OBJ_NULL;
+    }
+    #endif
     return o;
 }
 
@@ -134,8 +147,87 @@ struct class_lookup_data {
     size_t meth_offset;
     mp_obj_t *dest;
     bool is_type;
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    // set to the unconverted member if it was found in a user class (or object)
+    mp_obj_t member;
+    #endif
+};
+
+#if MICROPY_PY_CLASS_SLOTS
+// A __slots__ name is stored in the class as one of these, which gives the
+// index of its value in the subobj array of an instance
+typedef struct _mp_obj_member_t {
+    mp_obj_base_t base;
+    qstr name;
+    uint16_t index;
+} mp_obj_member_t;
+
+STATIC void member_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
+    (void)kind;
+    mp_obj_member_t *self = MP_OBJ_TO_PTR(self_in);
+    mp_printf(print, "<member '%q'>", self->name);
+}
+
+STATIC const mp_obj_type_t mp_type_member = {
+    { &mp_type_type },
+    .name = MP_QSTR_member_descriptor,
+    .print = member_print,
 };
 
+// If the attribute found in the class (dest[0], not a method) is a __slots__
+// name then load its value instead; returns false if the value is unset
+STATIC bool instance_load_slot(mp_obj_instance_t *self, mp_obj_t *dest) {
+    if (dest[1] == MP_OBJ_NULL && mp_obj_is_type(dest[0], &mp_type_member)) {
+        const mp_obj_member_t *member = MP_OBJ_TO_PTR(dest[0]);
+        dest[0] = self->subobj[member->index];
+        return dest[0] != MP_OBJ_NULL;
+    }
+    return true;
+}
+#endif
+
+#if MICROPY_OPT_CACHE_CLASS_LOOKUP
+
+STATIC mp_class_cache_entry_t *mp_obj_class_cache_entry(const mp_obj_type_t *type, qstr attr) {
+    size_t i = (((uintptr_t)type >> 4) ^ attr) & (MICROPY_OPT_CACHE_CLASS_LOOKUP - 1);
+    return &MP_STATE_VM(class_cache)[i];
+}
+
+void mp_obj_class_cache_clear(void) {
+    memset(MP_STATE_VM(class_cache), 0, sizeof(MP_STATE_VM(class_cache)));
+}
+
+// Any attribute found in an instance's members takes precedence over the class,
+// so this is only a fast path for the class lookup done after a members miss.
+// Attributes of classes with special accessors are never cached because they
+// may need converting (properties, descriptors).
+bool mp_obj_instance_load_method_cached(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
+    const mp_obj_type_t *type = mp_obj_get_type(self_in);
+    if (!mp_obj_is_instance_type(type)) {
+        return false;
+    }
+    mp_class_cache_entry_t *entry = mp_obj_class_cache_entry(type, attr);
+    if (entry->type != type || entry->attr != attr) {
+        return false;
+    }
+    mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
+    if (mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP) != NULL) {
+        return false;
+    }
+    dest[0] = MP_OBJ_NULL;
+    dest[1] = MP_OBJ_NULL;
+    mp_convert_member_lookup(self_in, type, entry->member, dest);
+    #if MICROPY_PY_CLASS_SLOTS
+    if ((type->flags & TYPE_FLAG_HAS_SLOTS) && !instance_load_slot(self, dest)) {
+        // let the full lookup raise the AttributeError
+        return false;
+    }
+    #endif
+    return true;
+}
+
+#endif
+
 STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_type_t *type) {
     assert(lookup->dest[0] == MP_OBJ_NULL);
     assert(lookup->dest[1] == MP_OBJ_NULL);
@@ -173,6 +265,9 @@ STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_
                         obj_obj = obj->subobj[0];
                     } else {
                         obj_obj = MP_OBJ_FROM_PTR(obj);
+                        #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+                        lookup->member = elem->value;
+                        #endif
                     }
                     mp_convert_member_lookup(obj_obj, type, elem->value, lookup->dest);
                 }
@@ -236,6 +331,36 @@ STATIC void mp_obj_class_lookup(struct class_lookup_data  *lookup, const mp_obj_
     }
 }
 
+#if MICROPY_PY_CLASS_SLOTS
+// Return the __slots__ entry for attr of an instance, or NULL if it has none
+STATIC mp_obj_t *instance_lookup_slot(mp_obj_instance_t *self, qstr attr) {
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    if (!(self->base.type->flags & TYPE_FLAG_HAS_SPECIAL_ACCESSORS)) {
+        mp_class_cache_entry_t *entry = mp_obj_class_cache_entry(self->base.type, attr);
+        if (entry->type == self->base.type && entry->attr == attr) {
+            if (mp_obj_is_type(entry->member, &mp_type_member)) {
+                return &self->subobj[((mp_obj_member_t*)MP_OBJ_TO_PTR(entry->member))->index];
+            }
+            return NULL;
+        }
+    }
+    #endif
+    mp_obj_t member[2] = {MP_OBJ_NULL, MP_OBJ_NULL};
+    struct class_lookup_data lookup = {
+        .obj = self,
+        .attr = attr,
+        .meth_offset = 0,
+        .dest = member,
+        .is_type = false,
+    };
+    mp_obj_class_lookup(&lookup, self->base.type);
+    if (member[1] == MP_OBJ_NULL && member[0] != MP_OBJ_NULL && mp_obj_is_type(member[0], &mp_type_member)) {
+        return &self->subobj[((mp_obj_member_t*)MP_OBJ_TO_PTR(member[0]))->index];
+    }
+    return NULL;
+}
+#endif
+
 STATIC void instance_print(const mp_print_t *print, mp_obj_t self_in, mp_print_kind_t kind) {
     mp_obj_instance_t *self = MP_OBJ_TO_PTR(self_in);
     qstr meth = (kind == PRINT_STR) ? MP_QSTR___str__ : MP_QSTR___repr__;
@@ -397,6 +522,9 @@ STATIC mp_obj_t instance_unary_op(mp_unary_op_t op, mp_obj_t self_in) {
         const mp_obj_type_t *native_base;
         size_t num_native_bases = instance_count_native_bases(mp_obj_get_type(self_in), &native_base);
 
+        #if MICROPY_PY_CLASS_SLOTS
+        num_native_bases = ((const mp_obj_class_t*)self->base.type)->n_subobj;
+        #endif
         size_t sz = sizeof(*self) + sizeof(*self->subobj) * num_native_bases
             + sizeof(*self->members.table) * self->members.alloc;
         return MP_OBJ_NEW_SMALL_INT(sz);
@@ -587,7 +715,11 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
         return;
     }
 #if MICROPY_CPYTHON_COMPAT
+    #if MICROPY_PY_CLASS_SLOTS
+    if (attr == MP_QSTR___dict__ && !(self->base.type->flags & TYPE_FLAG_NO_DICT)) {
+    #else
     if (attr == MP_QSTR___dict__) {
+    #endif
         // Create a new dict with a copy of the instance's map items.
         // This creates, unlike CPython, a 'read-only' __dict__: modifying
         // it will not result in modifications to the actual instance members.
@@ -609,9 +741,46 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
         .dest = dest,
         .is_type = false,
     };
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    bool cacheable = !(self->base.type->flags & TYPE_FLAG_HAS_SPECIAL_ACCESSORS)
+        && attr != MP_QSTR___next__
+        #if MICROPY_CPYTHON_COMPAT
+        && attr != MP_QSTR___class__
+        #endif
+        ;
+    mp_class_cache_entry_t *entry = NULL;
+    if (cacheable) {
+        entry = mp_obj_class_cache_entry(self->base.type, attr);
+        if (entry->type == self->base.type && entry->attr == attr) {
+            mp_convert_member_lookup(self_in, self->base.type, entry->member, dest);
+            #if MICROPY_PY_CLASS_SLOTS
+            if ((self->base.type->flags & TYPE_FLAG_HAS_SLOTS) && !instance_load_slot(self, dest)) {
+                goto try_getattr;
+            }
+            #endif
+            return;
+        }
+    }
+    #endif
     mp_obj_class_lookup(&lookup, self->base.type);
     mp_obj_t member = dest[0];
     if (member != MP_OBJ_NULL) {
+        #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+        if (entry != NULL && lookup.member != MP_OBJ_NULL) {
+            entry->type = self->base.type;
+            entry->attr = attr;
+            entry->member = lookup.member;
+        }
+        #endif
+        #if MICROPY_PY_CLASS_SLOTS
+        if ((self->base.type->flags & TYPE_FLAG_HAS_SLOTS) && mp_obj_is_type(member, &mp_type_member)) {
+            if (!instance_load_slot(self, dest)) {
+                // unset __slots__ value, fall through to __getattr__
+                goto try_getattr;
+            }
+            return;
+        }
+        #endif
         if (!(self->base.type->flags & TYPE_FLAG_HAS_SPECIAL_ACCESSORS)) {
             // Class doesn't have any special accessors to check so return straightaway
             return;
@@ -652,6 +821,9 @@ STATIC void mp_obj_instance_load_attr(mp_obj_t self_in, qstr attr, mp_obj_t *des
         return;
     }
 
+    #if MICROPY_PY_CLASS_SLOTS
+try_getattr:
+    #endif
     // try __getattr__
     if (attr != MP_QSTR___getattr__) {
         #if MICROPY_PY_DELATTR_SETATTR
@@ -786,6 +958,23 @@ STATIC bool mp_obj_instance_store_attr(mp_obj_t self_in, qstr attr, mp_obj_t val
 
 skip_special_accessors:
 
+    #if MICROPY_PY_CLASS_SLOTS
+    if (self->base.type->flags & TYPE_FLAG_HAS_SLOTS) {
+        mp_obj_t *slot = instance_lookup_slot(self, attr);
+        if (slot != NULL) {
+            if (value == MP_OBJ_NULL && *slot == MP_OBJ_NULL) {
+                // deleting an unset value
+                return false;
+            }
+            *slot = value;
+            return true;
+        }
+        if (self->base.type->flags & TYPE_FLAG_NO_DICT) {
+            return false;
+        }
+    }
+    #endif
+
     if (value == MP_OBJ_NULL) {
         // delete attribute
         mp_map_elem_t *elem = mp_map_lookup(&self->members, MP_OBJ_NEW_QSTR(attr), MP_MAP_LOOKUP_REMOVE_IF_FOUND);
@@ -1023,6 +1212,11 @@ STATIC void type_attr(mp_obj_t self_in, qstr attr, mp_obj_t *dest) {
     } else {
         // delete/store attribute
 
+        #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+        // this class, or any class derived from it, may now give a different result
+        mp_obj_class_cache_clear();
+        #endif
+
         if (self->locals_dict != NULL) {
             assert(self->locals_dict->base.type == &mp_type_dict); // MicroPython restriction, for now
             mp_map_t *locals_map = &self->locals_dict->map;
@@ -1107,7 +1301,12 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
         #endif
     }
 
+    #if MICROPY_PY_CLASS_SLOTS
+    mp_obj_class_t *cls = m_new0(mp_obj_class_t, 1);
+    mp_obj_type_t *o = &cls->type;
+    #else
     mp_obj_type_t *o = m_new0(mp_obj_type_t, 1);
+    #endif
     o->base.type = &mp_type_type;
     o->flags = base_flags;
     o->name = name;
@@ -1164,6 +1363,71 @@ mp_obj_t mp_obj_new_type(qstr name, mp_obj_t bases_tuple, mp_obj_t locals_dict)
     }
 
     mp_map_t *locals_map = &o->locals_dict->map;
+
+    #if MICROPY_PY_CLASS_SLOTS
+    // Values of __slots__ names are stored in the subobj array of an instance,
+    // after the native base (if any) and the slots inherited from a base
+    size_t n_subobj = num_native_bases;
+    bool bases_have_dict = false;
+    for (size_t i = 0; i < bases_len; i++) {
+        const mp_obj_type_t *t = MP_OBJ_TO_PTR(bases_items[i]);
+        if (!mp_obj_is_instance_type(t)) {
+            bases_have_dict |= t != &mp_type_object;
+            continue;
+        }
+        bases_have_dict |= !(t->flags & TYPE_FLAG_NO_DICT);
+        if (t->flags & TYPE_FLAG_HAS_SLOTS) {
+            const mp_obj_type_t *t_native_base;
+            if (n_subobj != num_native_bases
+                || (size_t)instance_count_native_bases(t, &t_native_base) != num_native_bases) {
+                mp_raise_TypeError("multiple bases have instance lay-out conflict");
+            }
+            n_subobj = ((const mp_obj_class_t*)t)->n_subobj;
+        }
+    }
+    bool has_dict = true;
+    mp_map_elem_t *slots_elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(MP_QSTR___slots__), MP_MAP_LOOKUP);
+    if (slots_elem != NULL) {
+        has_dict = false;
+        mp_obj_t slots_iter = slots_elem->value;
+        if (mp_obj_is_str(slots_iter)) {
+            slots_iter = mp_obj_new_tuple(1, &slots_iter);
+        }
+        slots_iter = mp_getiter(slots_iter, NULL);
+        mp_obj_t slot_name;
+        while ((slot_name = mp_iternext(slots_iter)) != MP_OBJ_STOP_ITERATION) {
+            qstr slot_qst = mp_obj_str_get_qstr(slot_name);
+            if (slot_qst == MP_QSTR___dict__) {
+                has_dict = true;
+                continue;
+            }
+            mp_map_elem_t *slot_elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(slot_qst), MP_MAP_LOOKUP_ADD_IF_NOT_FOUND);
+            if (slot_elem->value != MP_OBJ_NULL) {
+                if (MICROPY_ERROR_REPORTING == MICROPY_ERROR_REPORTING_TERSE) {
+                    mp_raise_ValueError("__slots__ conflicts with class variable");
+                } else {
+                    nlr_raise(mp_obj_new_exception_msg_varg(&mp_type_ValueError,
+                        "'%q' in __slots__ conflicts with class variable", slot_qst));
+                }
+            }
+            if (n_subobj >= 0xffff) {
+                mp_raise_msg(&mp_type_OverflowError, "too many __slots__");
+            }
+            mp_obj_member_t *member = m_new_obj(mp_obj_member_t);
+            member->base.type = &mp_type_member;
+            member->name = slot_qst;
+            member->index = n_subobj++;
+            slot_elem->value = MP_OBJ_FROM_PTR(member);
+        }
+    }
+    cls->n_subobj = n_subobj;
+    if (n_subobj > num_native_bases) {
+        o->flags |= TYPE_FLAG_HAS_SLOTS;
+    }
+    if (!has_dict && !bases_have_dict) {
+        o->flags |= TYPE_FLAG_NO_DICT;
+    }
+    #endif
     mp_map_elem_t *elem = mp_map_lookup(locals_map, MP_OBJ_NEW_QSTR(MP_QSTR___new__), MP_MAP_LOOKUP);
     if (elem != NULL) {
         // __new__ slot exists; check if it is a function
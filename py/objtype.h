@@ -37,11 +37,27 @@ typedef struct _mp_obj_instance_t {
     // TODO maybe cache __getattr__ and __setattr__ for efficient lookup of them
 } mp_obj_instance_t;
 
+#if MICROPY_PY_CLASS_SLOTS
+// a class defined in Python; instances of it have n_subobj entries in subobj:
+// the native base (if any) followed by the values of all __slots__
+typedef struct _mp_obj_class_t {
+    mp_obj_type_t type;
+    uint16_t n_subobj;
+} mp_obj_class_t;
+#endif
+
 #if MICROPY_CPYTHON_COMPAT
 // this is needed for object.__new__
 mp_obj_instance_t *mp_obj_new_instance(const mp_obj_type_t *cls, const mp_obj_type_t **native_base);
 #endif
 
+#if MICROPY_OPT_CACHE_CLASS_LOOKUP
+// lookup of a method or attribute of an instance through the class lookup cache;
+// returns false if the cache can't answer it (dest is then left untouched)
+bool mp_obj_instance_load_method_cached(mp_obj_t self_in, qstr attr, mp_obj_t *dest);
+void mp_obj_class_cache_clear(void);
+#endif
+
 // these need to be exposed so mp_obj_is_callable can work correctly
 bool mp_obj_instance_is_callable(mp_obj_t self_in);
 mp_obj_t mp_obj_instance_call(mp_obj_t self_in, size_t n_args, size_t n_kw, const mp_obj_t *args);
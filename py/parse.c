@@ -467,11 +467,32 @@ STATIC mp_parse_node_t mp_parse_node_new_small_int_checked(parser_t *parser, mp_
     return mp_parse_node_new_small_int(val);
 }
 
+STATIC mp_parse_node_t make_node_str_bytes(parser_t *parser, size_t src_line, bool is_bytes, const char *str, size_t len) {
+    // Don't automatically intern all strings/bytes.  doc strings (which are usually large)
+    // will be discarded by the compiler, and so we shouldn't intern them.
+    qstr qst = MP_QSTR_NULL;
+    if (len <= MICROPY_ALLOC_PARSE_INTERN_STRING_LEN) {
+        // intern short strings
+        qst = qstr_from_strn(str, len);
+    } else {
+        // check if this string is already interned
+        qst = qstr_find_strn(str, len);
+    }
+    if (qst != MP_QSTR_NULL) {
+        // qstr exists, make a leaf node
+        return mp_parse_node_new_leaf(is_bytes ? MP_PARSE_NODE_BYTES : MP_PARSE_NODE_STRING, qst);
+    } else {
+        // not interned, make a node holding a pointer to the string/bytes object
+        mp_obj_t o = mp_obj_new_str_copy(is_bytes ? &mp_type_bytes : &mp_type_str, (const byte*)str, len);
+        return make_node_const_object(parser, src_line, o);
+    }
+}
+
 STATIC void push_result_token(parser_t *parser, uint8_t rule_id) {
     mp_parse_node_t pn;
     mp_lexer_t *lex = parser->lexer;
     if (lex->tok_kind == MP_TOKEN_NAME) {
-        qstr id = qstr_from_strn(lex->vstr.buf, lex->vstr.len);
+        qstr id = qstr_from_strn_hash(lex->vstr.buf, lex->vstr.len, lex->tok_hash);
         #if MICROPY_COMP_CONST
         // if name is a standalone identifier, look it up in the table of dynamic constants
         mp_map_elem_t *elem;
@@ -500,26 +521,8 @@ STATIC void push_result_token(parser_t *parser, uint8_t rule_id) {
         mp_obj_t o = mp_parse_num_decimal(lex->vstr.buf, lex->vstr.len, true, false, lex);
         pn = make_node_const_object(parser, lex->tok_line, o);
     } else if (lex->tok_kind == MP_TOKEN_STRING || lex->tok_kind == MP_TOKEN_BYTES) {
-        // Don't automatically intern all strings/bytes.  doc strings (which are usually large)
-        // will be discarded by the compiler, and so we shouldn't intern them.
-        qstr qst = MP_QSTR_NULL;
-        if (lex->vstr.len <= MICROPY_ALLOC_PARSE_INTERN_STRING_LEN) {
-            // intern short strings
-            qst = qstr_from_strn(lex->vstr.buf, lex->vstr.len);
-        } else {
-            // check if this string is already interned
-            qst = qstr_find_strn(lex->vstr.buf, lex->vstr.len);
-        }
-        if (qst != MP_QSTR_NULL) {
-            // qstr exists, make a leaf node
-            pn = mp_parse_node_new_leaf(lex->tok_kind == MP_TOKEN_STRING ? MP_PARSE_NODE_STRING : MP_PARSE_NODE_BYTES, qst);
-        } else {
-            // not interned, make a node holding a pointer to the string/bytes object
-            mp_obj_t o = mp_obj_new_str_copy(
-                lex->tok_kind == MP_TOKEN_STRING ? &mp_type_str : &mp_type_bytes,
-                (const byte*)lex->vstr.buf, lex->vstr.len);
-            pn = make_node_const_object(parser, lex->tok_line, o);
-        }
+        pn = make_node_str_bytes(parser, lex->tok_line, lex->tok_kind == MP_TOKEN_BYTES,
+            lex->vstr.buf, lex->vstr.len);
     } else {
         pn = mp_parse_node_new_leaf(MP_PARSE_NODE_TOKEN, lex->tok_kind);
     }
@@ -600,8 +603,71 @@ STATIC bool fold_logical_constants(parser_t *parser, uint8_t rule_id, size_t *nu
     return false;
 }
 
+#if MICROPY_COMP_CONST_FOLDING_EXTENDED
+
+// Floats are not folded when cross compiling because the target may use a
+// different float precision to the compiler, and folding must not change results.
+#define FOLD_FLOAT (MICROPY_PY_BUILTINS_FLOAT && !MICROPY_DYNAMIC_COMPILER)
+
+// gets a constant operand that may be folded: an int, a float, or a str/bytes
+STATIC bool fold_get_const_maybe(mp_parse_node_t pn, mp_obj_t *o) {
+    if (MP_PARSE_NODE_IS_SMALL_INT(pn)) {
+        *o = MP_OBJ_NEW_SMALL_INT(MP_PARSE_NODE_LEAF_SMALL_INT(pn));
+        return true;
+    } else if (MP_PARSE_NODE_IS_LEAF(pn) && MP_PARSE_NODE_LEAF_KIND(pn) == MP_PARSE_NODE_STRING) {
+        *o = MP_OBJ_NEW_QSTR(MP_PARSE_NODE_LEAF_ARG(pn));
+        return true;
+    } else if (MP_PARSE_NODE_IS_LEAF(pn) && MP_PARSE_NODE_LEAF_KIND(pn) == MP_PARSE_NODE_BYTES) {
+        size_t len;
+        const byte *data = qstr_data(MP_PARSE_NODE_LEAF_ARG(pn), &len);
+        *o = mp_obj_new_bytes(data, len);
+        return true;
+    } else if (MP_PARSE_NODE_IS_STRUCT_KIND(pn, RULE_const_object)) {
+        mp_parse_node_struct_t *pns = (mp_parse_node_struct_t*)pn;
+        #if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D
+        // nodes are 32-bit pointers, but need to extract 64-bit object
+        *o = (uint64_t)pns->nodes[0] | ((uint64_t)pns->nodes[1] << 32);
+        #else
+        *o = (mp_obj_t)pns->nodes[0];
+        #endif
+        return mp_obj_is_int(*o)
+            #if FOLD_FLOAT
+            || mp_obj_is_float(*o)
+            #endif
+            || mp_obj_is_str(*o) || mp_obj_is_type(*o, &mp_type_bytes);
+    } else {
+        return false;
+    }
+}
+
+// checks that a binary op with a non-int operand can be folded without raising
+STATIC bool fold_binary_op_ok(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
+    #if FOLD_FLOAT
+    if ((mp_obj_is_int(lhs) || mp_obj_is_float(lhs))
+        && (mp_obj_is_int(rhs) || mp_obj_is_float(rhs))) {
+        // float arithmetic; / // and % can't have zero rhs
+        if (op <= MP_BINARY_OP_RSHIFT) {
+            return false;
+        }
+        return op < MP_BINARY_OP_FLOOR_DIVIDE || mp_obj_get_float(rhs) != 0;
+    }
+    #endif
+    // concatenation of str+str and bytes+bytes
+    return op == MP_BINARY_OP_ADD && mp_obj_get_type(lhs) == mp_obj_get_type(rhs)
+        && (mp_obj_is_str(lhs) || mp_obj_is_type(lhs, &mp_type_bytes));
+}
+
+#define fold_get_operand_maybe fold_get_const_maybe
+
+#else
+
+#define fold_get_operand_maybe mp_parse_node_get_int_maybe
+
+#endif
+
 STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
     // this code does folding of arbitrary integer expressions, eg 1 + 2 * 3 + 4
+    // and, if enabled, of float arithmetic and str/bytes concatenation
     // it does not do partial folding, eg 1 + 2 + x -> 3 + x
 
     mp_obj_t arg0;
@@ -634,13 +700,13 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
         || rule_id == RULE_term) {
         // folding for binary ops: << >> + - * / % //
         mp_parse_node_t pn = peek_result(parser, num_args - 1);
-        if (!mp_parse_node_get_int_maybe(pn, &arg0)) {
+        if (!fold_get_operand_maybe(pn, &arg0)) {
             return false;
         }
         for (ssize_t i = num_args - 2; i >= 1; i -= 2) {
             pn = peek_result(parser, i - 1);
             mp_obj_t arg1;
-            if (!mp_parse_node_get_int_maybe(pn, &arg1)) {
+            if (!fold_get_operand_maybe(pn, &arg1)) {
                 return false;
             }
             mp_token_kind_t tok = MP_PARSE_NODE_LEAF_ARG(peek_result(parser, i));
@@ -649,7 +715,11 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
                 MP_BINARY_OP_SUBTRACT,
                 MP_BINARY_OP_MULTIPLY,
                 255,//MP_BINARY_OP_POWER,
+                #if MICROPY_COMP_CONST_FOLDING_EXTENDED && FOLD_FLOAT
+                MP_BINARY_OP_TRUE_DIVIDE,
+                #else
                 255,//MP_BINARY_OP_TRUE_DIVIDE,
+                #endif
                 MP_BINARY_OP_FLOOR_DIVIDE,
                 MP_BINARY_OP_MODULO,
                 255,//MP_BINARY_OP_LESS
@@ -661,6 +731,15 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
             if (op == (mp_binary_op_t)255) {
                 return false;
             }
+            #if MICROPY_COMP_CONST_FOLDING_EXTENDED
+            if (!mp_obj_is_int(arg0) || !mp_obj_is_int(arg1)) {
+                if (!fold_binary_op_ok(op, arg0, arg1)) {
+                    return false;
+                }
+                arg0 = mp_binary_op(op, arg0, arg1);
+                continue;
+            }
+            #endif
             int rhs_sign = mp_obj_int_sign(arg1);
             if (op <= MP_BINARY_OP_RSHIFT) {
                 // << and >> can't have negative rhs
@@ -678,7 +757,7 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
     } else if (rule_id == RULE_factor_2) {
         // folding for unary ops: + - ~
         mp_parse_node_t pn = peek_result(parser, 0);
-        if (!mp_parse_node_get_int_maybe(pn, &arg0)) {
+        if (!fold_get_operand_maybe(pn, &arg0)) {
             return false;
         }
         mp_token_kind_t tok = MP_PARSE_NODE_LEAF_ARG(peek_result(parser, 1));
@@ -691,8 +770,33 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
             assert(tok == MP_TOKEN_OP_TILDE); // should be
             op = MP_UNARY_OP_INVERT;
         }
+        #if MICROPY_COMP_CONST_FOLDING_EXTENDED
+        if (!mp_obj_is_int(arg0)) {
+            // only + and - of a float can be folded
+            #if FOLD_FLOAT
+            if (!mp_obj_is_float(arg0) || op == MP_UNARY_OP_INVERT)
+            #endif
+            {
+                return false;
+            }
+        }
+        #endif
         arg0 = mp_unary_op(op, arg0);
 
+    #if MICROPY_COMP_CONST_FOLDING_EXTENDED
+    } else if (rule_id == RULE_power) {
+        // folding for binary op: ** with small int operands
+        // the exponent is limited so the result stays a reasonable size
+        mp_obj_t arg1;
+        if (!mp_parse_node_get_int_maybe(peek_result(parser, 1), &arg0)
+            || !mp_parse_node_get_int_maybe(peek_result(parser, 0), &arg1)
+            || !mp_obj_is_small_int(arg0) || !mp_obj_is_small_int(arg1)
+            || MP_OBJ_SMALL_INT_VALUE(arg1) < 0 || MP_OBJ_SMALL_INT_VALUE(arg1) > 32) {
+            return false;
+        }
+        arg0 = mp_binary_op(MP_BINARY_OP_POWER, arg0, arg1);
+    #endif
+
     #if MICROPY_COMP_CONST
     } else if (rule_id == RULE_expr_stmt) {
         mp_parse_node_t pn1 = peek_result(parser, 0);
@@ -785,6 +889,12 @@ STATIC bool fold_constants(parser_t *parser, uint8_t rule_id, size_t num_args) {
     }
     if (mp_obj_is_small_int(arg0)) {
         push_result_node(parser, mp_parse_node_new_small_int_checked(parser, arg0));
+    #if MICROPY_COMP_CONST_FOLDING_EXTENDED
+    } else if (mp_obj_is_str(arg0) || mp_obj_is_type(arg0, &mp_type_bytes)) {
+        size_t len;
+        const char *str = mp_obj_str_get_data(arg0, &len);
+        push_result_node(parser, make_node_str_bytes(parser, 0, !mp_obj_is_str(arg0), str, len));
+    #endif
     } else {
         // TODO reuse memory for parse node struct?
         push_result_node(parser, make_node_const_object(parser, 0, arg0));
@@ -829,37 +939,46 @@ STATIC void push_result_rule(parser_t *parser, size_t src_line, uint8_t rule_id,
     push_result_node(parser, (mp_parse_node_t)pn);
 }
 
-mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
-
-    // initialise parser and allocate memory for its stacks
+STATIC void parser_init(parser_t *parser, mp_lexer_t *lex) {
+    // allocate memory for the parser stacks
 
-    parser_t parser;
-
-    parser.rule_stack_alloc = MICROPY_ALLOC_PARSE_RULE_INIT;
-    parser.rule_stack_top = 0;
-    parser.rule_stack = m_new(rule_stack_t, parser.rule_stack_alloc);
+    parser->rule_stack_alloc = MICROPY_ALLOC_PARSE_RULE_INIT;
+    parser->rule_stack_top = 0;
+    parser->rule_stack = m_new(rule_stack_t, parser->rule_stack_alloc);
 
-    parser.result_stack_alloc = MICROPY_ALLOC_PARSE_RESULT_INIT;
-    parser.result_stack_top = 0;
-    parser.result_stack = m_new(mp_parse_node_t, parser.result_stack_alloc);
+    parser->result_stack_alloc = MICROPY_ALLOC_PARSE_RESULT_INIT;
+    parser->result_stack_top = 0;
+    parser->result_stack = m_new(mp_parse_node_t, parser->result_stack_alloc);
 
-    parser.lexer = lex;
+    parser->lexer = lex;
 
-    parser.tree.chunk = NULL;
-    parser.cur_chunk = NULL;
+    #if MICROPY_COMP_CONST
+    mp_map_init(&parser->consts, 0);
+    #endif
+}
 
+STATIC void parser_deinit(parser_t *parser) {
     #if MICROPY_COMP_CONST
-    mp_map_init(&parser.consts, 0);
+    mp_map_deinit(&parser->consts);
     #endif
 
-    // work out the top-level rule to use, and push it on the stack
-    size_t top_level_rule;
-    switch (input_kind) {
-        case MP_PARSE_SINGLE_INPUT: top_level_rule = RULE_single_input; break;
-        case MP_PARSE_EVAL_INPUT: top_level_rule = RULE_eval_input; break;
-        default: top_level_rule = RULE_file_input;
-    }
-    push_rule(&parser, lex->tok_line, top_level_rule, 0);
+    // free the memory that we don't need anymore
+    m_del(rule_stack_t, parser->rule_stack, parser->rule_stack_alloc);
+    m_del(mp_parse_node_t, parser->result_stack, parser->result_stack_alloc);
+
+    // we also free the lexer on behalf of the caller
+    mp_lexer_free(parser->lexer);
+}
+
+// parses input matching top_level_rule into parser->tree
+// if need_end is true then the rule must consume all remaining input
+STATIC void parser_parse(parser_t *parser, size_t top_level_rule, mp_parse_input_kind_t input_kind, bool need_end) {
+    mp_lexer_t *lex = parser->lexer;
+
+    parser->tree.chunk = NULL;
+    parser->cur_chunk = NULL;
+
+    push_rule(parser, lex->tok_line, top_level_rule, 0);
 
     // parse!
 
@@ -867,22 +986,22 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
 
     for (;;) {
         next_rule:
-        if (parser.rule_stack_top == 0) {
+        if (parser->rule_stack_top == 0) {
             break;
         }
 
         // Pop the next rule to process it
         size_t i; // state for the current rule
         size_t rule_src_line; // source line for the first token matched by the current rule
-        uint8_t rule_id = pop_rule(&parser, &i, &rule_src_line);
+        uint8_t rule_id = pop_rule(parser, &i, &rule_src_line);
         uint8_t rule_act = rule_act_table[rule_id];
         const uint16_t *rule_arg = get_rule_arg(rule_id);
         size_t n = rule_act & RULE_ACT_ARG_MASK;
 
         #if 0
         // debugging
-        printf("depth=" UINT_FMT " ", parser.rule_stack_top);
-        for (int j = 0; j < parser.rule_stack_top; ++j) {
+        printf("depth=" UINT_FMT " ", parser->rule_stack_top);
+        for (int j = 0; j < parser->rule_stack_top; ++j) {
             printf(" ");
         }
         printf("%s n=" UINT_FMT " i=" UINT_FMT " bt=%d\n", rule_name_table[rule_id], n, i, backtrack);
@@ -899,16 +1018,16 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                     uint16_t kind = rule_arg[i] & RULE_ARG_KIND_MASK;
                     if (kind == RULE_ARG_TOK) {
                         if (lex->tok_kind == (rule_arg[i] & RULE_ARG_ARG_MASK)) {
-                            push_result_token(&parser, rule_id);
+                            push_result_token(parser, rule_id);
                             mp_lexer_to_next(lex);
                             goto next_rule;
                         }
                     } else {
                         assert(kind == RULE_ARG_RULE);
                         if (i + 1 < n) {
-                            push_rule(&parser, rule_src_line, rule_id, i + 1); // save this or-rule
+                            push_rule(parser, rule_src_line, rule_id, i + 1); // save this or-rule
                         }
-                        push_rule_from_arg(&parser, rule_arg[i]); // push child of or-rule
+                        push_rule_from_arg(parser, rule_arg[i]); // push child of or-rule
                         goto next_rule;
                     }
                 }
@@ -922,7 +1041,7 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                     assert(i > 0);
                     if ((rule_arg[i - 1] & RULE_ARG_KIND_MASK) == RULE_ARG_OPT_RULE) {
                         // an optional rule that failed, so continue with next arg
-                        push_result_node(&parser, MP_PARSE_NODE_NULL);
+                        push_result_node(parser, MP_PARSE_NODE_NULL);
                         backtrack = false;
                     } else {
                         // a mandatory rule that failed, so propagate backtrack
@@ -943,7 +1062,7 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                         if (lex->tok_kind == tok_kind) {
                             // matched token
                             if (tok_kind == MP_TOKEN_NAME) {
-                                push_result_token(&parser, rule_id);
+                                push_result_token(parser, rule_id);
                             }
                             mp_lexer_to_next(lex);
                         } else {
@@ -958,8 +1077,8 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                             }
                         }
                     } else {
-                        push_rule(&parser, rule_src_line, rule_id, i + 1); // save this and-rule
-                        push_rule_from_arg(&parser, rule_arg[i]); // push child of and-rule
+                        push_rule(parser, rule_src_line, rule_id, i + 1); // save this and-rule
+                        push_rule_from_arg(parser, rule_arg[i]); // push child of and-rule
                         goto next_rule;
                     }
                 }
@@ -970,16 +1089,16 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
 
                 #if !MICROPY_ENABLE_DOC_STRING
                 // this code discards lonely statements, such as doc strings
-                if (input_kind != MP_PARSE_SINGLE_INPUT && rule_id == RULE_expr_stmt && peek_result(&parser, 0) == MP_PARSE_NODE_NULL) {
-                    mp_parse_node_t p = peek_result(&parser, 1);
+                if (input_kind != MP_PARSE_SINGLE_INPUT && rule_id == RULE_expr_stmt && peek_result(parser, 0) == MP_PARSE_NODE_NULL) {
+                    mp_parse_node_t p = peek_result(parser, 1);
                     if ((MP_PARSE_NODE_IS_LEAF(p) && !MP_PARSE_NODE_IS_ID(p))
                         || MP_PARSE_NODE_IS_STRUCT_KIND(p, RULE_const_object)) {
-                        pop_result(&parser); // MP_PARSE_NODE_NULL
-                        pop_result(&parser); // const expression (leaf or RULE_const_object)
+                        pop_result(parser); // MP_PARSE_NODE_NULL
+                        pop_result(parser); // const expression (leaf or RULE_const_object)
                         // Pushing the "pass" rule here will overwrite any RULE_const_object
                         // entry that was on the result stack, allowing the GC to reclaim
                         // the memory from the const object when needed.
-                        push_result_rule(&parser, rule_src_line, RULE_pass_stmt, 0);
+                        push_result_rule(parser, rule_src_line, RULE_pass_stmt, 0);
                         break;
                     }
                 }
@@ -999,7 +1118,7 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                         }
                     } else {
                         // rules are always pushed
-                        if (peek_result(&parser, i) != MP_PARSE_NODE_NULL) {
+                        if (peek_result(parser, i) != MP_PARSE_NODE_NULL) {
                             num_not_nil += 1;
                         }
                         i += 1;
@@ -1010,22 +1129,22 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                     // this rule has only 1 argument and should not be emitted
                     mp_parse_node_t pn = MP_PARSE_NODE_NULL;
                     for (size_t x = 0; x < i; ++x) {
-                        mp_parse_node_t pn2 = pop_result(&parser);
+                        mp_parse_node_t pn2 = pop_result(parser);
                         if (pn2 != MP_PARSE_NODE_NULL) {
                             pn = pn2;
                         }
                     }
-                    push_result_node(&parser, pn);
+                    push_result_node(parser, pn);
                 } else {
                     // this rule must be emitted
 
                     if (rule_act & RULE_ACT_ADD_BLANK) {
                         // and add an extra blank node at the end (used by the compiler to store data)
-                        push_result_node(&parser, MP_PARSE_NODE_NULL);
+                        push_result_node(parser, MP_PARSE_NODE_NULL);
                         i += 1;
                     }
 
-                    push_result_rule(&parser, rule_src_line, rule_id, i);
+                    push_result_rule(parser, rule_src_line, rule_id, i);
                 }
                 break;
             }
@@ -1075,7 +1194,7 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                                 if (i & 1 & n) {
                                     // separators which are tokens are not pushed to result stack
                                 } else {
-                                    push_result_token(&parser, rule_id);
+                                    push_result_token(parser, rule_id);
                                 }
                                 mp_lexer_to_next(lex);
                                 // got element of list, so continue parsing list
@@ -1088,8 +1207,8 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                             }
                         } else {
                             assert((arg & RULE_ARG_KIND_MASK) == RULE_ARG_RULE);
-                            push_rule(&parser, rule_src_line, rule_id, i + 1); // save this list-rule
-                            push_rule_from_arg(&parser, arg); // push child of list-rule
+                            push_rule(parser, rule_src_line, rule_id, i + 1); // save this list-rule
+                            push_rule_from_arg(parser, arg); // push child of list-rule
                             goto next_rule;
                         }
                     }
@@ -1107,36 +1226,32 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
                     // list matched single item
                     if (had_trailing_sep) {
                         // if there was a trailing separator, make a list of a single item
-                        push_result_rule(&parser, rule_src_line, rule_id, i);
+                        push_result_rule(parser, rule_src_line, rule_id, i);
                     } else {
                         // just leave single item on stack (ie don't wrap in a list)
                     }
                 } else {
-                    push_result_rule(&parser, rule_src_line, rule_id, i);
+                    push_result_rule(parser, rule_src_line, rule_id, i);
                 }
                 break;
             }
         }
     }
 
-    #if MICROPY_COMP_CONST
-    mp_map_deinit(&parser.consts);
-    #endif
-
     // truncate final chunk and link into chain of chunks
-    if (parser.cur_chunk != NULL) {
-        (void)m_renew_maybe(byte, parser.cur_chunk,
-            sizeof(mp_parse_chunk_t) + parser.cur_chunk->alloc,
-            sizeof(mp_parse_chunk_t) + parser.cur_chunk->union_.used,
+    if (parser->cur_chunk != NULL) {
+        (void)m_renew_maybe(byte, parser->cur_chunk,
+            sizeof(mp_parse_chunk_t) + parser->cur_chunk->alloc,
+            sizeof(mp_parse_chunk_t) + parser->cur_chunk->union_.used,
             false);
-        parser.cur_chunk->alloc = parser.cur_chunk->union_.used;
-        parser.cur_chunk->union_.next = parser.tree.chunk;
-        parser.tree.chunk = parser.cur_chunk;
+        parser->cur_chunk->alloc = parser->cur_chunk->union_.used;
+        parser->cur_chunk->union_.next = parser->tree.chunk;
+        parser->tree.chunk = parser->cur_chunk;
     }
 
     if (
-        lex->tok_kind != MP_TOKEN_END // check we are at the end of the token stream
-        || parser.result_stack_top == 0 // check that we got a node (can fail on empty input)
+        (need_end && lex->tok_kind != MP_TOKEN_END) // check we are at the end of the token stream
+        || parser->result_stack_top == 0 // check that we got a node (can fail on empty input)
         ) {
     syntax_error:;
         mp_obj_t exc;
@@ -1157,19 +1272,63 @@ mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
     }
 
     // get the root parse node that we created
-    assert(parser.result_stack_top == 1);
-    parser.tree.root = parser.result_stack[0];
+    assert(parser->result_stack_top == 1);
+    parser->tree.root = parser->result_stack[0];
+    parser->result_stack_top = 0;
+}
 
-    // free the memory that we don't need anymore
-    m_del(rule_stack_t, parser.rule_stack, parser.rule_stack_alloc);
-    m_del(mp_parse_node_t, parser.result_stack, parser.result_stack_alloc);
+mp_parse_tree_t mp_parse(mp_lexer_t *lex, mp_parse_input_kind_t input_kind) {
+    parser_t parser;
+    parser_init(&parser, lex);
 
-    // we also free the lexer on behalf of the caller
-    mp_lexer_free(lex);
+    // work out the top-level rule to use
+    size_t top_level_rule;
+    switch (input_kind) {
+        case MP_PARSE_SINGLE_INPUT: top_level_rule = RULE_single_input; break;
+        case MP_PARSE_EVAL_INPUT: top_level_rule = RULE_eval_input; break;
+        default: top_level_rule = RULE_file_input;
+    }
+
+    parser_parse(&parser, top_level_rule, input_kind, true);
+    #if MICROPY_OPT_TIERED_NATIVE
+    parser.tree.src_hash = lex->src_hash;
+    #endif
+    parser_deinit(&parser);
 
     return parser.tree;
 }
 
+#if MICROPY_COMP_STREAM_FILE_INPUT
+
+mp_parse_stream_t *mp_parse_stream_new(mp_lexer_t *lex) {
+    mp_parse_stream_t *ps = m_new_obj(mp_parse_stream_t);
+    parser_init(ps, lex);
+    return ps;
+}
+
+bool mp_parse_stream_next(mp_parse_stream_t *ps, mp_parse_tree_t *tree) {
+    // skip blank lines between statements, as file_input_3 does
+    mp_lexer_t *lex = ps->lexer;
+    while (lex->tok_kind == MP_TOKEN_NEWLINE) {
+        mp_lexer_to_next(lex);
+    }
+    if (lex->tok_kind == MP_TOKEN_END) {
+        return false;
+    }
+
+    // parse a single statement; the consts map is kept for later statements
+    parser_parse(ps, RULE_stmt, MP_PARSE_FILE_INPUT, false);
+    *tree = ps->tree;
+    return true;
+}
+
+void mp_parse_stream_free(mp_parse_stream_t *ps) {
+    parser_deinit(ps);
+    m_del_obj(mp_parse_stream_t, ps);
+}
+
+#endif
+
 void mp_parse_tree_clear(mp_parse_tree_t *tree) {
     mp_parse_chunk_t *chunk = tree->chunk;
     while (chunk != NULL) {
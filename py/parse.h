@@ -97,6 +97,9 @@ typedef enum {
 typedef struct _mp_parse_t {
     mp_parse_node_t root;
     struct _mp_parse_chunk_t *chunk;
+    #if MICROPY_OPT_TIERED_NATIVE
+    uint32_t src_hash; // of the whole source, from the lexer
+    #endif
 } mp_parse_tree_t;
 
 // the parser will raise an exception if an error occurred
@@ -104,4 +107,14 @@ typedef struct _mp_parse_t {
 mp_parse_tree_t mp_parse(struct _mp_lexer_t *lex, mp_parse_input_kind_t input_kind);
 void mp_parse_tree_clear(mp_parse_tree_t *tree);
 
+#if MICROPY_COMP_STREAM_FILE_INPUT
+// incremental parsing of file input, one top-level statement per tree
+// mp_parse_stream_next returns false at the end of the input
+// mp_parse_stream_free also frees the lexer
+typedef struct _parser_t mp_parse_stream_t;
+mp_parse_stream_t *mp_parse_stream_new(struct _mp_lexer_t *lex);
+bool mp_parse_stream_next(mp_parse_stream_t *ps, mp_parse_tree_t *tree);
+void mp_parse_stream_free(mp_parse_stream_t *ps);
+#endif
+
 #endif // MICROPY_INCLUDED_PY_PARSE_H
@@ -173,24 +173,34 @@ typedef enum {
 mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool force_complex, mp_lexer_t *lex) {
 #if MICROPY_PY_BUILTINS_FLOAT
 
-// DEC_VAL_MAX only needs to be rough and is used to retain precision while not overflowing
 // SMALL_NORMAL_VAL is the smallest power of 10 that is still a normal float
 // EXACT_POWER_OF_10 is the largest value of x so that 10^x can be stored exactly in a float
 //   Note: EXACT_POWER_OF_10 is at least floor(log_5(2^mantissa_length)). Indeed, 10^n = 2^n * 5^n
 //   so we only have to store the 5^n part in the mantissa (the 2^n part will go into the float's
 //   exponent).
+// EXACT_MANTISSA_MAX is the largest integer such that it and all smaller integers are exact floats
 #if MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_FLOAT
-#define DEC_VAL_MAX 1e20F
 #define SMALL_NORMAL_VAL (1e-37F)
 #define SMALL_NORMAL_EXP (-37)
 #define EXACT_POWER_OF_10 (9)
+#define EXACT_MANTISSA_MAX (1ULL << 24)
 #elif MICROPY_FLOAT_IMPL == MICROPY_FLOAT_IMPL_DOUBLE
-#define DEC_VAL_MAX 1e200
 #define SMALL_NORMAL_VAL (1e-307)
 #define SMALL_NORMAL_EXP (-307)
 #define EXACT_POWER_OF_10 (22)
+#define EXACT_MANTISSA_MAX (1ULL << 53)
 #endif
 
+    static const mp_float_t exact_pow_10[EXACT_POWER_OF_10 + 1] = {
+        MICROPY_FLOAT_CONST(1e0), MICROPY_FLOAT_CONST(1e1), MICROPY_FLOAT_CONST(1e2),
+        MICROPY_FLOAT_CONST(1e3), MICROPY_FLOAT_CONST(1e4), MICROPY_FLOAT_CONST(1e5),
+        MICROPY_FLOAT_CONST(1e6), MICROPY_FLOAT_CONST(1e7), MICROPY_FLOAT_CONST(1e8),
+        MICROPY_FLOAT_CONST(1e9),
+        #if EXACT_POWER_OF_10 > 9
+        1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+        #endif
+    };
+
     const char *top = str + len;
     mp_float_t dec_val = 0;
     bool dec_neg = false;
@@ -237,6 +247,8 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
         bool exp_neg = false;
         int exp_val = 0;
         int exp_extra = 0;
+        uint64_t mant = 0;
+        bool mant_inexact = false;
         while (str < top) {
             unsigned int dig = *str++;
             if ('0' <= dig && dig <= '9') {
@@ -249,15 +261,16 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
                         exp_val = 10 * exp_val + dig;
                     }
                 } else {
-                    if (dec_val < DEC_VAL_MAX) {
-                        // dec_val won't overflow so keep accumulating
-                        dec_val = 10 * dec_val + dig;
+                    if (mant <= (UINT64_MAX - 9) / 10) {
+                        // mant won't overflow so keep accumulating
+                        mant = 10 * mant + dig;
                         if (in == PARSE_DEC_IN_FRAC) {
                             --exp_extra;
                         }
                     } else {
-                        // dec_val might overflow and we anyway can't represent more digits
+                        // mant might overflow and we anyway can't represent more digits
                         // of precision, so ignore the digit and just adjust the exponent
+                        mant_inexact |= dig != 0;
                         if (in == PARSE_DEC_IN_INTG) {
                             ++exp_extra;
                         }
@@ -295,8 +308,32 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
             exp_val = -exp_val;
         }
 
-        // apply the exponent, making sure it's not a subnormal value
         exp_val += exp_extra;
+
+        // If the mantissa and the power of 10 are both exact floats then a single
+        // multiply or divide gives the correctly rounded result, so try to get there
+        // first, moving excess positive exponent into the mantissa while it stays exact
+        if (!mant_inexact) {
+            while (exp_val > EXACT_POWER_OF_10 && mant != 0 && mant <= EXACT_MANTISSA_MAX / 10) {
+                mant *= 10;
+                --exp_val;
+            }
+        }
+        dec_val = (mp_float_t)mant;
+        if (mant == 0) {
+            goto dec_done;
+        }
+        if (!mant_inexact && mant <= EXACT_MANTISSA_MAX
+            && exp_val >= -EXACT_POWER_OF_10 && exp_val <= EXACT_POWER_OF_10) {
+            if (exp_val < 0) {
+                dec_val /= exact_pow_10[-exp_val];
+            } else {
+                dec_val *= exact_pow_10[exp_val];
+            }
+            goto dec_done;
+        }
+
+        // apply the exponent, making sure it's not a subnormal value
         if (exp_val < SMALL_NORMAL_EXP) {
             exp_val -= SMALL_NORMAL_EXP;
             dec_val *= SMALL_NORMAL_VAL;
@@ -312,6 +349,7 @@ mp_obj_t mp_parse_num_decimal(const char *str, size_t len, bool allow_imag, bool
         } else {
             dec_val *= MICROPY_FLOAT_C_FUN(pow)(10, exp_val);
         }
+    dec_done:;
     }
 
     // negate value if needed
@@ -37,6 +37,7 @@
 #if MICROPY_PERSISTENT_CODE_LOAD || MICROPY_PERSISTENT_CODE_SAVE
 
 #include "py/smallint.h"
+#include "py/objtuple.h"
 
 #define QSTR_LAST_STATIC MP_QSTR_zip
 
@@ -74,6 +75,8 @@
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_ARMV6)
 #elif MICROPY_EMIT_XTENSA
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_XTENSA)
+#elif MICROPY_PERSISTENT_CODE_LOAD_NATIVE
+#define MPY_FEATURE_ARCH (MICROPY_NATIVE_ARCH)
 #else
 #define MPY_FEATURE_ARCH (MP_NATIVE_ARCH_NONE)
 #endif
@@ -160,7 +163,7 @@ typedef struct _bytecode_prelude_t {
     uint code_info_size;
 } bytecode_prelude_t;
 
-#if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_EMIT_NATIVE
+#if MICROPY_PERSISTENT_CODE_SAVE || MICROPY_EMIT_MACHINE_CODE
 
 // ip will point to start of opcodes
 // ip2 will point to simple_name, source_file qstrs
@@ -186,7 +189,7 @@ STATIC void extract_prelude(const byte **ip, const byte **ip2, bytecode_prelude_
 
 #include "py/parsenum.h"
 
-#if MICROPY_EMIT_NATIVE
+#if MICROPY_EMIT_MACHINE_CODE
 
 #if MICROPY_EMIT_THUMB
 STATIC void asm_thumb_rewrite_mov(uint8_t *pc, uint16_t val) {
@@ -203,12 +206,7 @@ STATIC void arch_link_qstr(uint8_t *pc, bool is_obj, qstr qst) {
     if (is_obj) {
         val = (mp_uint_t)MP_OBJ_NEW_QSTR(qst);
     }
-    #if MICROPY_EMIT_X86 || MICROPY_EMIT_X64 || MICROPY_EMIT_ARM || MICROPY_EMIT_XTENSA
-    pc[0] = val & 0xff;
-    pc[1] = (val >> 8) & 0xff;
-    pc[2] = (val >> 16) & 0xff;
-    pc[3] = (val >> 24) & 0xff;
-    #elif MICROPY_EMIT_THUMB
+    #if MICROPY_EMIT_THUMB
     if (is_obj) {
         // qstr object, movw and movt
         asm_thumb_rewrite_mov(pc, val); // movw
@@ -217,9 +215,27 @@ STATIC void arch_link_qstr(uint8_t *pc, bool is_obj, qstr qst) {
         // qstr number, movw instruction
         asm_thumb_rewrite_mov(pc, val); // movw
     }
+    #else
+    pc[0] = val & 0xff;
+    pc[1] = (val >> 8) & 0xff;
+    pc[2] = (val >> 16) & 0xff;
+    pc[3] = (val >> 24) & 0xff;
     #endif
 }
 
+void mp_native_relocate(const mp_native_reloc_t *reloc, uint8_t *text, uintptr_t dest) {
+    if (reloc == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < reloc->n; ++i) {
+        // The word may be unaligned within the code so access it bytewise
+        uintptr_t val;
+        memcpy(&val, text + reloc->off[i], sizeof(val));
+        val += dest;
+        memcpy(text + reloc->off[i], &val, sizeof(val));
+    }
+}
+
 #endif
 
 STATIC int read_byte(mp_reader_t *reader) {
@@ -271,6 +287,13 @@ STATIC mp_obj_t load_obj(mp_reader_t *reader) {
     byte obj_type = read_byte(reader);
     if (obj_type == 'e') {
         return MP_OBJ_FROM_PTR(&mp_const_ellipsis_obj);
+    } else if (obj_type == 't') {
+        size_t len = read_uint(reader, NULL);
+        mp_obj_tuple_t *tuple = MP_OBJ_TO_PTR(mp_obj_new_tuple(len, NULL));
+        for (size_t i = 0; i < len; ++i) {
+            tuple->items[i] = load_obj(reader);
+        }
+        return MP_OBJ_FROM_PTR(tuple);
     } else {
         size_t len = read_uint(reader, NULL);
         vstr_t vstr;
@@ -330,7 +353,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     int kind = (kind_len & 3) + MP_CODE_BYTECODE;
     size_t fun_data_len = kind_len >> 2;
 
-    #if !MICROPY_EMIT_NATIVE
+    #if !MICROPY_EMIT_MACHINE_CODE
     if (kind != MP_CODE_BYTECODE) {
         mp_raise_ValueError("incompatible .mpy file");
     }
@@ -339,10 +362,11 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     uint8_t *fun_data = NULL;
     byte *ip2;
     bytecode_prelude_t prelude = {0};
-    #if MICROPY_EMIT_NATIVE
-    size_t prelude_offset;
+    #if MICROPY_EMIT_MACHINE_CODE
+    size_t prelude_offset = 0;
     mp_uint_t type_sig = 0;
     size_t n_qstr_link = 0;
+    mp_native_reloc_t reloc = {0, NULL};
     #endif
 
     if (kind == MP_CODE_BYTECODE) {
@@ -356,7 +380,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
         // Load bytecode
         load_bytecode(reader, qw, ip, fun_data + fun_data_len);
 
-    #if MICROPY_EMIT_NATIVE
+    #if MICROPY_EMIT_MACHINE_CODE
     } else {
         // Allocate memory for native data and load it
         size_t fun_alloc;
@@ -368,6 +392,15 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
             n_qstr_link = read_uint(reader, NULL);
             for (size_t i = 0; i < n_qstr_link; ++i) {
                 size_t off = read_uint(reader, NULL);
+                if ((off & 3) == 3) {
+                    // Word to relocate once the code is at its final address,
+                    // there is no qstr for this entry
+                    if (reloc.off == NULL) {
+                        reloc.off = m_new(size_t, n_qstr_link);
+                    }
+                    reloc.off[reloc.n++] = off >> 2;
+                    continue;
+                }
                 qstr qst = load_qstr(reader, qw);
                 uint8_t *dest = fun_data + (off >> 2);
                 if ((off & 3) == 0) {
@@ -408,12 +441,14 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
     }
 
     mp_uint_t *const_table = NULL;
+    size_t n_obj = 0;
+    size_t n_raw_code = 0;
     if (kind != MP_CODE_NATIVE_ASM) {
         // Load constant table for bytecode, native and viper
 
         // Number of entries in constant table
-        size_t n_obj = read_uint(reader, NULL);
-        size_t n_raw_code = read_uint(reader, NULL);
+        n_obj = read_uint(reader, NULL);
+        n_raw_code = read_uint(reader, NULL);
 
         // Allocate constant table
         size_t n_alloc = prelude.n_pos_args + prelude.n_kwonly_args + n_obj + n_raw_code;
@@ -429,7 +464,7 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
             *ct++ = (mp_uint_t)MP_OBJ_NEW_QSTR(load_qstr(reader, qw));
         }
 
-        #if MICROPY_EMIT_NATIVE
+        #if MICROPY_EMIT_MACHINE_CODE
         if (kind != MP_CODE_BYTECODE) {
             // Populate mp_fun_table entry
             *ct++ = (mp_uint_t)(uintptr_t)mp_fun_table;
@@ -458,11 +493,16 @@ STATIC mp_raw_code_t *load_raw_code(mp_reader_t *reader, qstr_window_t *qw) {
             #endif
             prelude.scope_flags);
 
-    #if MICROPY_EMIT_NATIVE
+    #if MICROPY_EMIT_MACHINE_CODE
     } else {
         #if defined(MP_PLAT_COMMIT_EXEC)
-        fun_data = MP_PLAT_COMMIT_EXEC(fun_data, fun_data_len);
+        fun_data = MP_PLAT_COMMIT_EXEC(fun_data, fun_data_len, reloc.n ? &reloc : NULL);
+        #else
+        mp_native_relocate(&reloc, fun_data, (uintptr_t)fun_data);
         #endif
+        if (reloc.off != NULL) {
+            m_del(size_t, reloc.off, n_qstr_link);
+        }
 
         mp_emit_glue_assign_native(rc, kind,
             fun_data, fun_data_len, const_table,
@@ -563,7 +603,7 @@ STATIC void save_obj(mp_print_t *print, mp_obj_t o) {
         } else {
             obj_type = 'b';
         }
-        mp_uint_t len;
+        size_t len;
         const char *str = mp_obj_str_get_data(o, &len);
         mp_print_bytes(print, &obj_type, 1);
         mp_print_uint(print, len);
@@ -571,11 +611,23 @@ STATIC void save_obj(mp_print_t *print, mp_obj_t o) {
     } else if (MP_OBJ_TO_PTR(o) == &mp_const_ellipsis_obj) {
         byte obj_type = 'e';
         mp_print_bytes(print, &obj_type, 1);
+    } else if (mp_obj_is_type(o, &mp_type_tuple)) {
+        // a constant tuple from the compiler, saved item by item
+        size_t len;
+        mp_obj_t *items;
+        mp_obj_tuple_get(o, &len, &items);
+        byte obj_type = 't';
+        mp_print_bytes(print, &obj_type, 1);
+        mp_print_uint(print, len);
+        for (size_t i = 0; i < len; ++i) {
+            save_obj(print, items[i]);
+        }
     } else {
         // we save numbers using a simplistic text representation
         // TODO could be improved
         byte obj_type;
-        if (mp_obj_is_type(o, &mp_type_int)) {
+        if (mp_obj_is_int(o)) {
+            // a small int only occurs as an item of a tuple
             obj_type = 'i';
         #if MICROPY_PY_BUILTINS_COMPLEX
         } else if (mp_obj_is_type(o, &mp_type_complex)) {
@@ -629,6 +681,7 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
 
         // Save bytecode
         save_bytecode(print, qstr_window, ip, ip_top);
+    #if MICROPY_EMIT_MACHINE_CODE || MICROPY_EMIT_INLINE_ASM
     } else {
         // Save native code
         mp_print_bytes(print, rc->fun_data, rc->fun_data_len);
@@ -657,6 +710,7 @@ STATIC void save_raw_code(mp_print_t *print, mp_raw_code_t *rc, qstr_window_t *q
                 mp_print_uint(print, rc->type_sig);
             }
         }
+    #endif
     }
 
     if (rc->kind == MP_CODE_BYTECODE || rc->kind == MP_CODE_NATIVE_PY) {
@@ -763,15 +817,39 @@ STATIC void fd_print_strn(void *env, const char *str, size_t len) {
     (void)ret;
 }
 
-void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
+void mp_raw_code_save_file_extra(mp_raw_code_t *rc, const char *filename, const byte *extra, size_t extra_len) {
     int fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
     mp_print_t fd_print = {(void*)(intptr_t)fd, fd_print_strn};
     mp_raw_code_save(rc, &fd_print);
+    mp_print_bytes(&fd_print, extra, extra_len);
     close(fd);
 }
 
+#elif MICROPY_VFS
+
+#include "py/stream.h"
+#include "extmod/vfs.h"
+
+STATIC void vfs_print_strn(void *env, const char *str, size_t len) {
+    int errcode;
+    mp_stream_write_exactly(MP_OBJ_FROM_PTR(env), str, len, &errcode);
+}
+
+void mp_raw_code_save_file_extra(mp_raw_code_t *rc, const char *filename, const byte *extra, size_t extra_len) {
+    mp_obj_t args[2] = {mp_obj_new_str(filename, strlen(filename)), MP_OBJ_NEW_QSTR(MP_QSTR_wb)};
+    mp_obj_t file = mp_vfs_open(MP_ARRAY_SIZE(args), args, (mp_map_t*)&mp_const_empty_map);
+    mp_print_t vfs_print = {MP_OBJ_TO_PTR(file), vfs_print_strn};
+    mp_raw_code_save(rc, &vfs_print);
+    mp_print_bytes(&vfs_print, extra, extra_len);
+    mp_stream_close(file);
+}
+
 #else
 #error mp_raw_code_save_file not implemented for this platform
 #endif
 
+void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename) {
+    mp_raw_code_save_file_extra(rc, filename, NULL, 0);
+}
+
 #endif // MICROPY_PERSISTENT_CODE_SAVE
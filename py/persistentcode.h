@@ -41,13 +41,25 @@ enum {
     MP_NATIVE_ARCH_ARMV7EMSP,
     MP_NATIVE_ARCH_ARMV7EMDP,
     MP_NATIVE_ARCH_XTENSA,
+    MP_NATIVE_ARCH_XTENSAWIN,
 };
 
+// Words of native code that hold an offset from the start of the code and
+// must have its final address added once that is known
+typedef struct _mp_native_reloc_t {
+    size_t n;
+    size_t *off;
+} mp_native_reloc_t;
+
+void mp_native_relocate(const mp_native_reloc_t *reloc, uint8_t *text, uintptr_t dest);
+
 mp_raw_code_t *mp_raw_code_load(mp_reader_t *reader);
 mp_raw_code_t *mp_raw_code_load_mem(const byte *buf, size_t len);
 mp_raw_code_t *mp_raw_code_load_file(const char *filename);
 
 void mp_raw_code_save(mp_raw_code_t *rc, mp_print_t *print);
 void mp_raw_code_save_file(mp_raw_code_t *rc, const char *filename);
+// As mp_raw_code_save_file, then append extra bytes that the loader ignores
+void mp_raw_code_save_file_extra(mp_raw_code_t *rc, const char *filename, const byte *extra, size_t extra_len);
 
 #endif // MICROPY_INCLUDED_PY_PERSISTENTCODE_H
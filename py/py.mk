@@ -104,6 +104,11 @@ endif
 ifeq ($(MICROPY_PY_BTREE),1)
 BTREE_DIR = lib/berkeley-db-1.xx
 BTREE_DEFS = -D__DBINTERFACE_PRIVATE=1 -Dmpool_error=printf -Dabort=abort_ "-Dvirt_fd_t=void*" $(BTREE_DEFS_EXTRA)
+ifeq ($(MICROPY_PY_BTREE_STATS),1)
+# have mpool count page cache hits and misses, for btree's stats() method
+BTREE_DEFS += -DSTATISTICS
+CFLAGS_MOD += -DMICROPY_PY_BTREE_STATS=1
+endif
 INC += -I$(TOP)/$(BTREE_DIR)/PORT/include
 SRC_MOD += extmod/modbtree.c
 SRC_MOD += $(addprefix $(BTREE_DIR)/,\
@@ -155,6 +160,7 @@ PY_CORE_O_BASENAME = $(addprefix py/,\
 	nlrx64.o \
 	nlrthumb.o \
 	nlrxtensa.o \
+	nlrxtensawin.o \
 	nlrsetjmp.o \
 	malloc.o \
 	gc.o \
@@ -285,6 +291,10 @@ PY_EXTMOD_O_BASENAME = \
 	extmod/modurandom.o \
 	extmod/moduselect.o \
 	extmod/moduwebsocket.o \
+	extmod/modumqttc.o \
+	extmod/moduhttpc.o \
+	extmod/modulog.o \
+	extmod/moduasyncio.o \
 	extmod/modwebrepl.o \
 	extmod/modframebuf.o \
 	extmod/vfs.o \
@@ -309,6 +319,10 @@ PY_EXTMOD_O_BASENAME += \
 	extmod/vfs_native_misc.o
 endif
 
+PY_EXTMOD_O_BASENAME += \
+	extmod/vfs_log.o \
+	extmod/vfs_log_file.o
+
 
 # prepend the build destination prefix to the py object files
 PY_CORE_O = $(addprefix $(BUILD)/, $(PY_CORE_O_BASENAME))
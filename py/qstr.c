@@ -84,13 +84,7 @@
 // allocated pool is twice this size.  The value here must be <= MP_QSTRnumber_of.
 #define MICROPY_ALLOC_QSTR_ENTRIES_INIT (10)
 
-// this must match the equivalent function in makeqstrdata.py
-mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
-    // djb2 algorithm; see http://www.cse.yorku.ca/~oz/hash.html
-    mp_uint_t hash = 5381;
-    for (const byte *top = data + len; data < top; data++) {
-        hash = ((hash << 5) + hash) ^ (*data); // hash * 33 ^ data
-    }
+mp_uint_t qstr_hash_final(mp_uint_t hash) {
     hash &= Q_HASH_MASK;
     // Make sure that valid hash is never zero, zero means "hash not computed"
     if (hash == 0) {
@@ -99,11 +93,37 @@ mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
     return hash;
 }
 
+// this must match the equivalent function in makeqstrdata.py
+mp_uint_t qstr_compute_hash(const byte *data, size_t len) {
+    // djb2 algorithm; see http://www.cse.yorku.ca/~oz/hash.html
+    mp_uint_t hash = QSTR_HASH_INIT;
+    for (const byte *top = data + len; data < top; data++) {
+        hash = qstr_hash_update(hash, *data);
+    }
+    return qstr_hash_final(hash);
+}
+
+#if MICROPY_QSTR_HASH_INDEX
+STATIC const uint16_t mp_qstr_const_index[] = {
+#ifndef NO_QSTR
+#define QDEF(id, str)
+#define QINDEX(n) n,
+#include "genhdr/qstrdefs.generated.h"
+#undef QINDEX
+#undef QDEF
+#endif
+};
+#endif
+
 const qstr_pool_t mp_qstr_const_pool = {
     NULL,               // no previous pool
     0,                  // no previous pool
     MICROPY_ALLOC_QSTR_ENTRIES_INIT,
     MP_QSTRnumber_of,   // corresponds to number of strings in array just below
+    #if MICROPY_QSTR_HASH_INDEX
+    mp_qstr_const_index,
+    MP_ARRAY_SIZE(mp_qstr_const_index) - 1,
+    #endif
     {
 #ifndef NO_QSTR
 #define QDEF(id, str) str,
@@ -150,7 +170,18 @@ STATIC qstr qstr_add(const byte *q_ptr) {
         // Put a lower bound on the allocation size in case the extra qstr pool has few entries
         new_alloc = MAX(MICROPY_ALLOC_QSTR_ENTRIES_INIT, new_alloc);
         #endif
+        #if MICROPY_QSTR_HASH_INDEX
+        // the index follows the qstrs in the same allocation
+        new_alloc = MIN(new_alloc, 0xfffe);
+        size_t index_len = 8;
+        while (index_len < new_alloc + new_alloc / 3) {
+            index_len *= 2;
+        }
+        size_t pool_size = sizeof(qstr_pool_t) + sizeof(const char*) * new_alloc;
+        qstr_pool_t *pool = m_malloc_maybe(pool_size + sizeof(uint16_t) * index_len);
+        #else
         qstr_pool_t *pool = m_new_obj_var_maybe(qstr_pool_t, const char*, new_alloc);
+        #endif
         if (pool == NULL) {
             QSTR_EXIT();
             m_malloc_fail(new_alloc);
@@ -159,23 +190,48 @@ STATIC qstr qstr_add(const byte *q_ptr) {
         pool->total_prev_len = MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len;
         pool->alloc = new_alloc;
         pool->len = 0;
+        #if MICROPY_QSTR_HASH_INDEX
+        pool->index = (uint16_t*)((byte*)pool + pool_size);
+        pool->index_mask = index_len - 1;
+        memset((uint16_t*)pool->index, 0, sizeof(uint16_t) * index_len);
+        #endif
         MP_STATE_VM(last_pool) = pool;
         DEBUG_printf("QSTR: allocate new pool of size %d\n", MP_STATE_VM(last_pool)->alloc);
     }
 
     // add the new qstr
-    MP_STATE_VM(last_pool)->qstrs[MP_STATE_VM(last_pool)->len++] = q_ptr;
+    qstr_pool_t *pool = MP_STATE_VM(last_pool);
+    #if MICROPY_QSTR_HASH_INDEX
+    size_t i = Q_GET_HASH(q_ptr) & pool->index_mask;
+    while (pool->index[i] != 0) {
+        i = (i + 1) & pool->index_mask;
+    }
+    ((uint16_t*)pool->index)[i] = pool->len + 1;
+    #endif
+    pool->qstrs[pool->len++] = q_ptr;
 
     // return id for the newly-added qstr
     return MP_STATE_VM(last_pool)->total_prev_len + MP_STATE_VM(last_pool)->len - 1;
 }
 
 qstr qstr_find_strn(const char *str, size_t str_len) {
-    // work out hash of str
-    mp_uint_t str_hash = qstr_compute_hash((const byte*)str, str_len);
+    return qstr_find_strn_hash(str, str_len, qstr_compute_hash((const byte*)str, str_len));
+}
 
+qstr qstr_find_strn_hash(const char *str, size_t str_len, mp_uint_t str_hash) {
     // search pools for the data
     for (qstr_pool_t *pool = MP_STATE_VM(last_pool); pool != NULL; pool = pool->prev) {
+        #if MICROPY_QSTR_HASH_INDEX
+        if (pool->index != NULL) {
+            for (size_t i = str_hash & pool->index_mask; pool->index[i] != 0; i = (i + 1) & pool->index_mask) {
+                const byte *q = pool->qstrs[pool->index[i] - 1];
+                if (Q_GET_HASH(q) == str_hash && Q_GET_LENGTH(q) == str_len && memcmp(Q_GET_DATA(q), str, str_len) == 0) {
+                    return pool->total_prev_len + pool->index[i] - 1;
+                }
+            }
+            continue;
+        }
+        #endif
         for (const byte **q = pool->qstrs, **q_top = pool->qstrs + pool->len; q < q_top; q++) {
             if (Q_GET_HASH(*q) == str_hash && Q_GET_LENGTH(*q) == str_len && memcmp(Q_GET_DATA(*q), str, str_len) == 0) {
                 return pool->total_prev_len + (q - pool->qstrs);
@@ -192,9 +248,14 @@ qstr qstr_from_str(const char *str) {
 }
 
 qstr qstr_from_strn(const char *str, size_t len) {
+    return qstr_from_strn_hash(str, len, qstr_compute_hash((const byte*)str, len));
+}
+
+qstr qstr_from_strn_hash(const char *str, size_t len, mp_uint_t hash) {
     assert(len < (1 << (8 * MICROPY_QSTR_BYTES_IN_LEN)));
+    assert(hash == qstr_compute_hash((const byte*)str, len));
     QSTR_ENTER();
-    qstr q = qstr_find_strn(str, len);
+    qstr q = qstr_find_strn_hash(str, len, hash);
     if (q == 0) {
         // qstr does not exist in interned pool so need to add it
 
@@ -239,7 +300,6 @@ qstr qstr_from_strn(const char *str, size_t len) {
         MP_STATE_VM(qstr_last_used) += n_bytes;
 
         // store the interned strings' data
-        mp_uint_t hash = qstr_compute_hash((const byte*)str, len);
         Q_SET_HASH(q_ptr, hash);
         Q_SET_LENGTH(q_ptr, len);
         memcpy(q_ptr + MICROPY_QSTR_BYTES_IN_HASH + MICROPY_QSTR_BYTES_IN_LEN, str, len);
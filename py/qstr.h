@@ -52,6 +52,12 @@ typedef struct _qstr_pool_t {
     size_t total_prev_len;
     size_t alloc;
     size_t len;
+    #if MICROPY_QSTR_HASH_INDEX
+    // open-addressing table of 1 + position in qstrs (0 if empty) probed
+    // linearly from the qstr hash & index_mask; NULL to search qstrs instead
+    const uint16_t *index;
+    size_t index_mask;
+    #endif
     const byte *qstrs[];
 } qstr_pool_t;
 
@@ -60,11 +66,21 @@ typedef struct _qstr_pool_t {
 
 void qstr_init(void);
 
+// qstr_compute_hash can also be worked out a byte at a time, starting with
+// QSTR_HASH_INIT and passing the result of qstr_hash_update to qstr_hash_final
+#define QSTR_HASH_INIT (5381)
+static inline mp_uint_t qstr_hash_update(mp_uint_t hash, byte b) {
+    return ((hash << 5) + hash) ^ b; // hash * 33 ^ b
+}
+mp_uint_t qstr_hash_final(mp_uint_t hash);
+
 mp_uint_t qstr_compute_hash(const byte *data, size_t len);
 qstr qstr_find_strn(const char *str, size_t str_len); // returns MP_QSTR_NULL if not found
+qstr qstr_find_strn_hash(const char *str, size_t str_len, mp_uint_t str_hash);
 
 qstr qstr_from_str(const char *str);
 qstr qstr_from_strn(const char *str, size_t len);
+qstr qstr_from_strn_hash(const char *str, size_t len, mp_uint_t hash); // hash as from qstr_compute_hash
 
 mp_uint_t qstr_hash(qstr q);
 const char *qstr_str(qstr q);
@@ -47,6 +47,14 @@ STATIC mp_uint_t mp_reader_mem_readbyte(void *data) {
     }
 }
 
+STATIC mp_uint_t mp_reader_mem_readbuf(void *data, const byte **buf) {
+    mp_reader_mem_t *reader = (mp_reader_mem_t*)data;
+    mp_uint_t len = reader->end - reader->cur;
+    *buf = reader->cur;
+    reader->cur = reader->end;
+    return len;
+}
+
 STATIC void mp_reader_mem_close(void *data) {
     mp_reader_mem_t *reader = (mp_reader_mem_t*)data;
     if (reader->free_len > 0) {
@@ -64,6 +72,7 @@ void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t
     reader->data = rm;
     reader->readbyte = mp_reader_mem_readbyte;
     reader->close = mp_reader_mem_close;
+    reader->readbuf = mp_reader_mem_readbuf;
 }
 
 #if MICROPY_READER_POSIX
@@ -98,6 +107,26 @@ STATIC mp_uint_t mp_reader_posix_readbyte(void *data) {
     return reader->buf[reader->pos++];
 }
 
+STATIC mp_uint_t mp_reader_posix_readbuf(void *data, const byte **buf) {
+    mp_reader_posix_t *reader = (mp_reader_posix_t*)data;
+    if (reader->pos >= reader->len) {
+        if (reader->len == 0) {
+            return 0;
+        }
+        int n = read(reader->fd, reader->buf, sizeof(reader->buf));
+        if (n <= 0) {
+            reader->len = 0;
+            return 0;
+        }
+        reader->len = n;
+        reader->pos = 0;
+    }
+    *buf = reader->buf + reader->pos;
+    mp_uint_t len = reader->len - reader->pos;
+    reader->pos = reader->len;
+    return len;
+}
+
 STATIC void mp_reader_posix_close(void *data) {
     mp_reader_posix_t *reader = (mp_reader_posix_t*)data;
     if (reader->close_fd) {
@@ -122,6 +151,7 @@ void mp_reader_new_file_from_fd(mp_reader_t *reader, int fd, bool close_fd) {
     reader->data = rp;
     reader->readbyte = mp_reader_posix_readbyte;
     reader->close = mp_reader_posix_close;
+    reader->readbuf = mp_reader_posix_readbuf;
 }
 
 #if !MICROPY_VFS_POSIX
@@ -33,10 +33,14 @@
 // it can be called again after returning MP_READER_EOF, and in that case must return MP_READER_EOF
 #define MP_READER_EOF ((mp_uint_t)(-1))
 
+// the optional readbuf function gives the next block of the input stream by
+// setting *buf and returning its length, and returns 0 at the end of stream;
+// the block is consumed and must stay valid until the next call or close
 typedef struct _mp_reader_t {
     void *data;
     mp_uint_t (*readbyte)(void *data);
     void (*close)(void *data);
+    mp_uint_t (*readbuf)(void *data, const byte **buf);
 } mp_reader_t;
 
 void mp_reader_new_mem(mp_reader_t *reader, const byte *buf, size_t len, size_t free_len);
@@ -36,6 +36,8 @@
 #include "py/objlist.h"
 #include "py/objmodule.h"
 #include "py/objgenerator.h"
+#include "py/objtype.h"
+#include "py/bc.h"
 #include "py/smallint.h"
 #include "py/runtime.h"
 #include "py/builtin.h"
@@ -53,7 +55,12 @@
 
 const mp_obj_module_t mp_module___main__ = {
     .base = { &mp_type_module },
+    #if MICROPY_STATE_CTX_PER_TASK
+    // the main VM's, module_attr() finds the running VM's
+    .globals = (mp_obj_dict_t*)&mp_state_ctx.vm.dict_main,
+    #else
     .globals = (mp_obj_dict_t*)&MP_STATE_VM(dict_main),
+    #endif
 };
 
 void mp_init(void) {
@@ -61,9 +68,42 @@ void mp_init(void) {
 
     // no pending exceptions to start with
     MP_STATE_VM(mp_pending_exception) = MP_OBJ_NULL;
+    #if MICROPY_OPT_TIERED_NATIVE
+    MP_STATE_VM(tier_native_calls) = 0;
+    MP_STATE_VM(tier_native_budget) = 0;
+    #endif
     #if MICROPY_ENABLE_SCHEDULER
     MP_STATE_VM(sched_state) = MP_SCHED_IDLE;
-    MP_STATE_VM(sched_sp) = 0;
+    MP_STATE_VM(sched_len) = 0;
+    MP_STATE_VM(sched_idx) = 0;
+    #if MICROPY_SCHEDULER_HIGH_DEPTH
+    MP_STATE_VM(sched_len_high) = 0;
+    MP_STATE_VM(sched_idx_high) = 0;
+    #endif
+    #if MICROPY_SCHEDULER_STATS
+    MP_STATE_VM(sched_max_len) = 0;
+    memset(MP_STATE_VM(sched_stats), 0, sizeof(MP_STATE_VM(sched_stats)));
+    #endif
+    #endif
+
+    #if MICROPY_TRACK_CODE_STATE
+    MP_STATE_THREAD(code_state) = NULL;
+    #endif
+    #if MICROPY_PROF_SAMPLES
+    mp_prof_clear();
+    #endif
+
+    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+    // classes from a previous session may have left entries behind
+    mp_obj_class_cache_clear();
+    #endif
+
+    #if MICROPY_OPT_STR_CACHE
+    memset(MP_STATE_VM(str_cache), 0, sizeof(MP_STATE_VM(str_cache)));
+    #endif
+
+    #if MICROPY_OPT_STR_CONCAT_INPLACE
+    memset(MP_STATE_VM(str_concat_bufs), 0, sizeof(MP_STATE_VM(str_concat_bufs)));
     #endif
 
 #if MICROPY_ENABLE_EMERGENCY_EXCEPTION_BUF
@@ -89,6 +129,24 @@ void mp_init(void) {
     MP_STATE_VM(mp_optimise_value) = 0;
     #endif
 
+    #if MICROPY_MODULE_MPY_CACHE
+    MP_STATE_VM(mpy_cache_compiling) = false;
+    #endif
+
+    #if MICROPY_MODULE_FROZEN_MPY_COMPRESSED
+    memset(MP_STATE_VM(frozen_mpy_code_cache), 0, sizeof(MP_STATE_VM(frozen_mpy_code_cache)));
+    #endif
+
+    #if MICROPY_OPT_STR_INDEX_CACHE
+    memset(MP_STATE_VM(str_index), 0, sizeof(MP_STATE_VM(str_index)));
+    memset(MP_STATE_VM(str_index_offsets), 0, sizeof(MP_STATE_VM(str_index_offsets)));
+    MP_STATE_VM(str_index_idx) = 0;
+    #endif
+
+    #if MICROPY_OPT_STR_FORMAT_CACHE
+    memset(MP_STATE_VM(str_format_cache), 0, sizeof(MP_STATE_VM(str_format_cache)));
+    #endif
+
     // init global module dict
     mp_obj_dict_init(&MP_STATE_VM(mp_loaded_modules_dict), 3);
 
@@ -111,6 +169,32 @@ void mp_init(void) {
     }
     #endif
 
+    #if MICROPY_PY_URE && MICROPY_PY_URE_CACHE
+    for (size_t i = 0; i < MICROPY_PY_URE_CACHE; ++i) {
+        MP_STATE_VM(ure_cache[i]) = MP_OBJ_NULL;
+    }
+    #endif
+
+    #if MICROPY_PY_USSL && MICROPY_PY_USSL_SESSION_CACHE
+    for (size_t i = 0; i < 2 * MICROPY_PY_USSL_SESSION_CACHE; ++i) {
+        MP_STATE_VM(ussl_session_cache[i]) = MP_OBJ_NULL;
+    }
+    #endif
+
+    #if MICROPY_PY_UCTYPES && MICROPY_PY_UCTYPES_LAYOUT_CACHE
+    for (size_t i = 0; i < MICROPY_PY_UCTYPES_LAYOUT_CACHE; ++i) {
+        MP_STATE_VM(uctypes_layout_cache[i]) = NULL;
+    }
+    #endif
+
+    #if MICROPY_PY_UHTTPC
+    MP_STATE_VM(uhttpc_session) = MP_OBJ_NULL;
+    #endif
+
+    #if MICROPY_PY_UASYNCIO
+    MP_STATE_VM(uasyncio_loop) = MP_OBJ_NULL;
+    #endif
+
     #if MICROPY_FSUSERMOUNT
     // zero out the pointers to the user-mounted devices
     memset(MP_STATE_VM(fs_user_mount), 0, sizeof(MP_STATE_VM(fs_user_mount)));
@@ -259,6 +343,13 @@ mp_obj_t mp_unary_op(mp_unary_op_t op, mp_obj_t arg) {
         if (h == 0) {
             GET_STR_DATA_LEN(arg, data, len);
             h = qstr_compute_hash(data, len);
+            #if MICROPY_OPT_STR_LAZY_HASH && MICROPY_ENABLE_GC
+            // keep it in the object, unless the object is not on the heap and
+            // may be in ROM
+            if (gc_nbytes(MP_OBJ_TO_PTR(arg)) != 0) {
+                ((mp_obj_str_t*)MP_OBJ_TO_PTR(arg))->hash = h;
+            }
+            #endif
         }
         return MP_OBJ_NEW_SMALL_INT(h);
     } else {
@@ -1390,8 +1481,24 @@ import_error:
 void mp_import_all(mp_obj_t module) {
     DEBUG_printf("import all %p\n", module);
 
-    // TODO: Support __all__
     mp_map_t *map = &mp_obj_module_get_globals(module)->map;
+
+    #if MICROPY_CPYTHON_COMPAT
+    // if the module defines __all__ then import exactly the names listed,
+    // loading each as an attribute so that names provided by a module-level
+    // __getattr__ are included
+    mp_map_elem_t *all = mp_map_lookup(map, MP_OBJ_NEW_QSTR(MP_QSTR___all__), MP_MAP_LOOKUP);
+    if (all != NULL) {
+        mp_obj_t iter = mp_getiter(all->value, NULL);
+        mp_obj_t name;
+        while ((name = mp_iternext(iter)) != MP_OBJ_STOP_ITERATION) {
+            qstr qname = mp_obj_str_get_qstr(name);
+            mp_store_name(qname, mp_load_attr(module, qname));
+        }
+        return;
+    }
+    #endif
+
     for (size_t i = 0; i < map->alloc; i++) {
         if (mp_map_slot_is_filled(map, i)) {
             // Entry in module global scope may be generated programmatically
@@ -1446,6 +1553,46 @@ mp_obj_t mp_parse_compile_execute(mp_lexer_t *lex, mp_parse_input_kind_t parse_i
     }
 }
 
+#if MICROPY_COMP_STREAM_FILE_INPUT
+// as mp_parse_compile_execute with MP_PARSE_FILE_INPUT, but each top-level
+// statement is executed as soon as it is compiled, so the parse tree and
+// module-level bytecode of earlier statements can be reclaimed
+void mp_parse_compile_execute_stream(mp_lexer_t *lex, mp_obj_dict_t *globals, mp_obj_dict_t *locals) {
+    // save context
+    mp_obj_dict_t *volatile old_globals = mp_globals_get();
+    mp_obj_dict_t *volatile old_locals = mp_locals_get();
+
+    // set new context
+    mp_globals_set(globals);
+    mp_locals_set(locals);
+
+    mp_parse_stream_t *volatile ps = NULL;
+    nlr_buf_t nlr;
+    if (nlr_push(&nlr) == 0) {
+        qstr source_name = lex->source_name;
+        ps = mp_parse_stream_new(lex);
+        mp_parse_tree_t parse_tree;
+        while (mp_parse_stream_next(ps, &parse_tree)) {
+            mp_obj_t module_fun = mp_compile(&parse_tree, source_name, MP_EMIT_OPT_NONE, false);
+            mp_call_function_0(module_fun);
+        }
+        nlr_pop();
+        mp_parse_stream_free(ps);
+        mp_globals_set(old_globals);
+        mp_locals_set(old_locals);
+    } else {
+        // exception; restore context, free the parser (and so close the
+        // lexer's input) and re-raise same exception
+        mp_globals_set(old_globals);
+        mp_locals_set(old_locals);
+        if (ps != NULL) {
+            mp_parse_stream_free(ps);
+        }
+        nlr_jump(nlr.ret_val);
+    }
+}
+#endif
+
 #endif // MICROPY_ENABLE_COMPILER
 
 NORETURN void m_malloc_fail(size_t num_bytes) {
@@ -1476,6 +1623,12 @@ NORETURN void mp_raise_TypeError(const char *msg) {
 }
 
 NORETURN void mp_raise_OSError(int errno_) {
+    #if MICROPY_PREALLOC_EXCEPTIONS
+    mp_obj_t exc = mp_obj_new_exception_oserror_prealloc(errno_);
+    if (exc != MP_OBJ_NULL) {
+        nlr_raise(exc);
+    }
+    #endif
     nlr_raise(mp_obj_new_exception_arg1(&mp_type_OSError, MP_OBJ_NEW_SMALL_INT(errno_)));
 }
 
@@ -70,8 +70,13 @@ void mp_handle_pending_tail(mp_uint_t atomic_state);
 #if MICROPY_ENABLE_SCHEDULER
 void mp_sched_lock(void);
 void mp_sched_unlock(void);
-static inline unsigned int mp_sched_num_pending(void) { return MP_STATE_VM(sched_sp); }
+#if MICROPY_SCHEDULER_HIGH_DEPTH
+static inline unsigned int mp_sched_num_pending(void) { return MP_STATE_VM(sched_len) + MP_STATE_VM(sched_len_high); }
+#else
+static inline unsigned int mp_sched_num_pending(void) { return MP_STATE_VM(sched_len); }
+#endif
 bool mp_sched_schedule(mp_obj_t function, mp_obj_t arg);
+bool mp_sched_schedule_prio(mp_obj_t function, mp_obj_t arg, int prio);
 #endif
 
 // extra printing method specifically for mp_obj_t's which are integral type
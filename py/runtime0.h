@@ -45,6 +45,9 @@
 #define MP_NATIVE_TYPE_PTR8 (0x05)
 #define MP_NATIVE_TYPE_PTR16 (0x06)
 #define MP_NATIVE_TYPE_PTR32 (0x07)
+#define MP_NATIVE_TYPE_PTRF32 (0x08)
+// single-precision float bits, only used to convert values for ptrf32
+#define MP_NATIVE_TYPE_FLOAT32 (0x09)
 
 typedef enum {
     // These ops may appear in the bytecode. Changing this group
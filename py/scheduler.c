@@ -27,9 +27,23 @@
 #include <stdio.h>
 
 #include "py/runtime.h"
+#include "py/mphal.h"
 
 #if MICROPY_ENABLE_SCHEDULER
 
+#if MICROPY_PY_MICROPYTHON_STATS
+// Record how long the item waited in the queue; called just before it runs
+STATIC void mp_sched_latency(const mp_sched_item_t *item) {
+    uint32_t dt = (uint32_t)mp_hal_ticks_us() - item->ticks_us;
+    if (dt > MP_STATE_VM(sched_latency_max_us)) {
+        MP_STATE_VM(sched_latency_max_us) = dt;
+    }
+}
+#define SCHED_LATENCY(item) mp_sched_latency(item)
+#else
+#define SCHED_LATENCY(item)
+#endif
+
 // A variant of this is inlined in the VM at the pending exception check
 void mp_handle_pending(void) {
     if (MP_STATE_VM(sched_state) == MP_SCHED_PENDING) {
@@ -51,9 +65,23 @@ void mp_handle_pending(void) {
 // or by the VM's inlined version of that function.
 void mp_handle_pending_tail(mp_uint_t atomic_state) {
     MP_STATE_VM(sched_state) = MP_SCHED_LOCKED;
-    if (MP_STATE_VM(sched_sp) > 0) {
-        mp_sched_item_t item = MP_STATE_VM(sched_stack)[--MP_STATE_VM(sched_sp)];
+    mp_sched_item_t item;
+    #if MICROPY_SCHEDULER_HIGH_DEPTH
+    if (MP_STATE_VM(sched_len_high) > 0) {
+        item = MP_STATE_VM(sched_queue_high)[MP_STATE_VM(sched_idx_high)];
+        MP_STATE_VM(sched_idx_high) = (MP_STATE_VM(sched_idx_high) + 1) % MICROPY_SCHEDULER_HIGH_DEPTH;
+        --MP_STATE_VM(sched_len_high);
+        MICROPY_END_ATOMIC_SECTION(atomic_state);
+        SCHED_LATENCY(&item);
+        mp_call_function_1_protected(item.func, item.arg);
+    } else
+    #endif
+    if (MP_STATE_VM(sched_len) > 0) {
+        item = MP_STATE_VM(sched_queue)[MP_STATE_VM(sched_idx)];
+        MP_STATE_VM(sched_idx) = (MP_STATE_VM(sched_idx) + 1) % MICROPY_SCHEDULER_DEPTH;
+        --MP_STATE_VM(sched_len);
         MICROPY_END_ATOMIC_SECTION(atomic_state);
+        SCHED_LATENCY(&item);
         mp_call_function_1_protected(item.func, item.arg);
     } else {
         MICROPY_END_ATOMIC_SECTION(atomic_state);
@@ -84,25 +112,88 @@ void mp_sched_unlock(void) {
     MICROPY_END_ATOMIC_SECTION(atomic_state);
 }
 
-bool mp_sched_schedule(mp_obj_t function, mp_obj_t arg) {
+#if MICROPY_SCHEDULER_STATS
+// Count a call to mp_sched_schedule for the given function; must be called
+// within the atomic section
+STATIC void mp_sched_count(mp_obj_t function, bool dropped) {
+    mp_sched_stats_t *stats = MP_STATE_VM(sched_stats);
+    size_t i = 0;
+    while (i < MICROPY_SCHEDULER_STATS - 1 && stats[i].func != function && stats[i].func != MP_OBJ_NULL) {
+        ++i;
+    }
+    if (i < MICROPY_SCHEDULER_STATS - 1) {
+        stats[i].func = function;
+    }
+    ++stats[i].scheduled;
+    if (dropped) {
+        ++stats[i].dropped;
+    }
+    if (mp_sched_num_pending() > MP_STATE_VM(sched_max_len)) {
+        MP_STATE_VM(sched_max_len) = mp_sched_num_pending();
+    }
+}
+#endif
+
+// Queue a call to function(arg), to be run by the VM as soon as it can.  This
+// may be called from interrupts and other tasks; the queues are only changed
+// within the atomic section, which on most ports just masks interrupts for a
+// few instructions.  Returns false if the queue was full.
+bool mp_sched_schedule_prio(mp_obj_t function, mp_obj_t arg, int prio) {
     mp_uint_t atomic_state = MICROPY_BEGIN_ATOMIC_SECTION();
+    mp_sched_item_t *queue = MP_STATE_VM(sched_queue);
+    uint16_t *len = &MP_STATE_VM(sched_len);
+    size_t idx = MP_STATE_VM(sched_idx);
+    size_t depth = MICROPY_SCHEDULER_DEPTH;
+    #if MICROPY_SCHEDULER_HIGH_DEPTH
+    if (prio == MP_SCHED_PRIO_HIGH) {
+        queue = MP_STATE_VM(sched_queue_high);
+        len = &MP_STATE_VM(sched_len_high);
+        idx = MP_STATE_VM(sched_idx_high);
+        depth = MICROPY_SCHEDULER_HIGH_DEPTH;
+    }
+    #else
+    (void)prio;
+    #endif
     bool ret;
-    if (MP_STATE_VM(sched_sp) < MICROPY_SCHEDULER_DEPTH) {
+    if (*len < depth) {
         if (MP_STATE_VM(sched_state) == MP_SCHED_IDLE) {
             MP_STATE_VM(sched_state) = MP_SCHED_PENDING;
         }
-        MP_STATE_VM(sched_stack)[MP_STATE_VM(sched_sp)].func = function;
-        MP_STATE_VM(sched_stack)[MP_STATE_VM(sched_sp)].arg = arg;
-        ++MP_STATE_VM(sched_sp);
+        size_t i = (idx + *len) % depth;
+        queue[i].func = function;
+        queue[i].arg = arg;
+        #if MICROPY_PY_MICROPYTHON_STATS
+        queue[i].ticks_us = mp_hal_ticks_us();
+        #endif
+        ++*len;
         ret = true;
     } else {
-        // schedule stack is full
+        // schedule queue is full
         ret = false;
     }
+    #if MICROPY_SCHEDULER_STATS
+    mp_sched_count(function, !ret);
+    #elif MICROPY_PY_MICROPYTHON_STATS
+    if (mp_sched_num_pending() > MP_STATE_VM(sched_max_len)) {
+        MP_STATE_VM(sched_max_len) = mp_sched_num_pending();
+    }
+    #endif
+    #if MICROPY_PY_MICROPYTHON_STATS
+    if (!ret) {
+        ++MP_STATE_VM(sched_dropped);
+    }
+    #endif
     MICROPY_END_ATOMIC_SECTION(atomic_state);
+    if (ret) {
+        MICROPY_SCHED_HOOK_SCHEDULED;
+    }
     return ret;
 }
 
+bool mp_sched_schedule(mp_obj_t function, mp_obj_t arg) {
+    return mp_sched_schedule_prio(function, arg, MP_SCHED_PRIO_NORMAL);
+}
+
 #else // MICROPY_ENABLE_SCHEDULER
 
 // A variant of this is inlined in the VM at the pending exception check
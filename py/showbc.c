@@ -527,6 +527,33 @@ const byte *mp_bytecode_print_str(const byte *ip) {
             printf("IMPORT_STAR");
             break;
 
+        #if MICROPY_OPT_SUPERINSTRUCTIONS
+        case MP_BC_LOAD_FAST_ATTR:
+            unum = *ip++;
+            DECODE_QSTR;
+            printf("LOAD_FAST_ATTR " UINT_FMT " %s", unum, qstr_str(qst));
+            if (MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE) {
+                printf(" (cache=%u)", *ip++);
+            }
+            break;
+
+        case MP_BC_LOAD_FAST_CONST_BINARY_OP:
+            DECODE_UINT;
+            printf("LOAD_FAST_CONST_BINARY_OP " UINT_FMT " " INT_FMT " %s",
+                unum & 0xf, (mp_int_t)((unum >> 4) & 0x3f) - 16, qstr_str(mp_binary_op_method_name[unum >> 10]));
+            break;
+
+        case MP_BC_COMPARE_POP_JUMP_IF_TRUE:
+        case MP_BC_COMPARE_POP_JUMP_IF_FALSE: {
+            byte op = *ip++;
+            DECODE_SLABEL;
+            printf("COMPARE_POP_JUMP_IF_%s %s " UINT_FMT,
+                ip[-4] == MP_BC_COMPARE_POP_JUMP_IF_TRUE ? "TRUE" : "FALSE",
+                qstr_str(mp_binary_op_method_name[op]), (mp_uint_t)(ip + unum - mp_showbc_code_start));
+            break;
+        }
+        #endif
+
         default:
             if (ip[-1] < MP_BC_LOAD_CONST_SMALL_INT_MULTI + 64) {
                 printf("LOAD_CONST_SMALL_INT " INT_FMT, (mp_int_t)ip[-1] - MP_BC_LOAD_CONST_SMALL_INT_MULTI - 16);
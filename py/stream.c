@@ -84,6 +84,54 @@ mp_uint_t mp_stream_rw(mp_obj_t stream, void *buf_, mp_uint_t size, int *errcode
     return done;
 }
 
+mp_uint_t mp_stream_writev(mp_obj_t stream, mp_stream_iovec_t *iov, size_t iovcnt, int *errcode) {
+    const mp_stream_p_t *stream_p = mp_get_stream(stream);
+    bool gather = stream_p->ioctl != NULL;
+    *errcode = 0;
+    mp_uint_t done = 0;
+    while (iovcnt > 0) {
+        if (iov->len == 0) {
+            iov++;
+            iovcnt--;
+            continue;
+        }
+        mp_uint_t out_sz = MP_STREAM_ERROR;
+        if (gather) {
+            mp_stream_writev_t wv = { iov, iovcnt };
+            out_sz = stream_p->ioctl(stream, MP_STREAM_WRITEV, (uintptr_t)&wv, errcode);
+            if (out_sz == MP_STREAM_ERROR && *errcode == MP_EINVAL) {
+                // no gather support, so fall back to a write per buffer
+                *errcode = 0;
+                gather = false;
+            }
+        }
+        if (!gather) {
+            out_sz = stream_p->write(stream, iov->base, iov->len, errcode);
+        }
+        if (out_sz == 0) {
+            return done;
+        }
+        if (out_sz == MP_STREAM_ERROR) {
+            // If we wrote something before getting EAGAIN, report that instead
+            if (mp_is_nonblocking_error(*errcode) && done != 0) {
+                *errcode = 0;
+            }
+            return done;
+        }
+        done += out_sz;
+        while (out_sz >= iov->len && iovcnt > 0) {
+            out_sz -= iov->len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->base = (const byte*)iov->base + out_sz;
+            iov->len -= out_sz;
+        }
+    }
+    return done;
+}
+
 const mp_stream_p_t *mp_get_stream_raise(mp_obj_t self_in, int flags) {
     mp_obj_type_t *type = mp_obj_get_type(self_in);
     const mp_stream_p_t *stream_p = type->protocol;
@@ -272,6 +320,45 @@ STATIC mp_obj_t stream_write1_method(mp_obj_t self_in, mp_obj_t arg) {
 }
 MP_DEFINE_CONST_FUN_OBJ_2(mp_stream_write1_obj, stream_write1_method);
 
+// writevec(bufs): write a sequence of buffers without joining them first
+STATIC mp_obj_t stream_writevec_method(mp_obj_t self_in, mp_obj_t bufs_in) {
+    mp_get_stream_raise(self_in, MP_STREAM_OP_WRITE);
+    size_t n;
+    mp_obj_t *bufs;
+    mp_obj_get_array(bufs_in, &n, &bufs);
+    // the buffers go out in batches so that the iovecs can live on the stack
+    mp_stream_iovec_t iov[8];
+    mp_uint_t total = 0;
+    for (size_t i = 0; i < n;) {
+        size_t cnt = 0;
+        mp_uint_t want = 0;
+        for (; i < n && cnt < MP_ARRAY_SIZE(iov); i++, cnt++) {
+            mp_buffer_info_t bufinfo;
+            mp_get_buffer_raise(bufs[i], &bufinfo, MP_BUFFER_READ);
+            iov[cnt].base = bufinfo.buf;
+            iov[cnt].len = bufinfo.len;
+            want += bufinfo.len;
+        }
+        int error;
+        mp_uint_t out_sz = mp_stream_writev(self_in, iov, cnt, &error);
+        total += out_sz;
+        if (error != 0) {
+            if (!mp_is_nonblocking_error(error)) {
+                mp_raise_OSError(error);
+            }
+            if (total == 0) {
+                return mp_const_none;
+            }
+            break;
+        }
+        if (out_sz < want) {
+            break;
+        }
+    }
+    return mp_obj_new_int_from_uint(total);
+}
+MP_DEFINE_CONST_FUN_OBJ_2(mp_stream_writevec_obj, stream_writevec_method);
+
 STATIC mp_obj_t stream_readinto(size_t n_args, const mp_obj_t *args) {
     mp_buffer_info_t bufinfo;
     mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
@@ -340,7 +427,56 @@ STATIC mp_obj_t stream_readall(mp_obj_t self_in) {
     return mp_obj_new_str_from_vstr(STREAM_CONTENT_TYPE(stream_p), &vstr);
 }
 
-// Unbuffered, inefficient implementation of readline() for raw I/O files.
+// Read up to size bytes of a line into buf, stopping after a newline.
+// Seekable streams are read a chunk at a time and whatever was read past
+// the newline is given back with a seek; others have to be read a byte at
+// a time.  Returns the number of bytes read, with errcode as for mp_stream_rw.
+STATIC mp_uint_t stream_readline_chunk(mp_obj_t stream, const mp_stream_p_t *stream_p, byte *buf, mp_uint_t size, int *errcode) {
+    *errcode = 0;
+    if (stream_p->is_seekable) {
+        struct mp_stream_seek_t seek_s;
+        seek_s.offset = 0;
+        seek_s.whence = MP_SEEK_CUR;
+        // a stream can still refuse to seek, eg a pipe opened as a file
+        if (stream_p->ioctl(stream, MP_STREAM_SEEK, (uintptr_t)&seek_s, errcode) != MP_STREAM_ERROR) {
+            mp_uint_t out_sz = stream_p->read(stream, buf, size, errcode);
+            if (out_sz == MP_STREAM_ERROR) {
+                return 0;
+            }
+            const byte *nl = memchr(buf, '\n', out_sz);
+            if (nl != NULL && (mp_uint_t)(nl + 1 - buf) < out_sz) {
+                out_sz = nl + 1 - buf;
+                seek_s.offset += out_sz;
+                seek_s.whence = MP_SEEK_SET;
+                if (stream_p->ioctl(stream, MP_STREAM_SEEK, (uintptr_t)&seek_s, errcode) == MP_STREAM_ERROR) {
+                    return 0;
+                }
+            }
+            return out_sz;
+        }
+        *errcode = 0;
+    }
+    mp_uint_t done = 0;
+    while (done < size) {
+        mp_uint_t out_sz = stream_p->read(stream, buf + done, 1, errcode);
+        if (out_sz == MP_STREAM_ERROR) {
+            // If we read something before getting EAGAIN, don't leak it
+            if (mp_is_nonblocking_error(*errcode) && done != 0) {
+                *errcode = 0;
+            }
+            break;
+        }
+        if (out_sz == 0) {
+            break;
+        }
+        if (buf[done++] == '\n') {
+            break;
+        }
+    }
+    return done;
+}
+
+// Implementation of readline() for raw I/O files, without a buffer of its own.
 STATIC mp_obj_t stream_unbuffered_readline(size_t n_args, const mp_obj_t *args) {
     const mp_stream_p_t *stream_p = mp_get_stream(args[0]);
 
@@ -356,36 +492,37 @@ STATIC mp_obj_t stream_unbuffered_readline(size_t n_args, const mp_obj_t *args)
         vstr_init(&vstr, 16);
     }
 
-    while (max_size == -1 || max_size-- != 0) {
-        char *p = vstr_add_len(&vstr, 1);
+    for (;;) {
+        mp_uint_t chunk = 64;
+        if (max_size != -1 && (mp_uint_t)max_size - vstr.len < chunk) {
+            chunk = max_size - vstr.len;
+        }
+        // Allocate first and then read, so that an OutOfMemory doesn't lose
+        // data already taken from the stream.
+        byte *p = (byte*)vstr_add_len(&vstr, chunk);
         int error;
-        mp_uint_t out_sz = stream_p->read(args[0], p, 1, &error);
-        if (out_sz == MP_STREAM_ERROR) {
+        mp_uint_t out_sz = stream_readline_chunk(args[0], stream_p, p, chunk, &error);
+        vstr_cut_tail_bytes(&vstr, chunk - out_sz);
+        if (error != 0) {
             if (mp_is_nonblocking_error(error)) {
-                if (vstr.len == 1) {
-                    // We just incremented it, but otherwise we read nothing
-                    // and immediately got EAGAIN. This case is not well
-                    // specified in
+                if (vstr.len == 0) {
+                    // We read nothing and immediately got EAGAIN. This case
+                    // is not well specified in
                     // https://docs.python.org/3/library/io.html#io.IOBase.readline
                     // unlike similar case for read(). But we follow the latter's
                     // behavior - return None.
                     vstr_clear(&vstr);
                     return mp_const_none;
-                } else {
-                    goto done;
                 }
+                break;
             }
             mp_raise_OSError(error);
         }
-        if (out_sz == 0) {
-done:
-            // Back out previously added byte
-            // Consider, what's better - read a char and get OutOfMemory (so read
-            // char is lost), or allocate first as we do.
-            vstr_cut_tail_bytes(&vstr, 1);
+        if (out_sz < chunk || (out_sz > 0 && p[out_sz - 1] == '\n')) {
+            // EOF, a newline, or for a byte at a time stream no more data
             break;
         }
-        if (*p == '\n') {
+        if (max_size != -1 && vstr.len >= (size_t)max_size) {
             break;
         }
     }
@@ -394,6 +531,30 @@ done:
 }
 MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_unbuffered_readline_obj, 1, 2, stream_unbuffered_readline);
 
+// readline_into(buf[, maxlen]) -> number of bytes read, without allocating
+STATIC mp_obj_t stream_readline_into(size_t n_args, const mp_obj_t *args) {
+    const mp_stream_p_t *stream_p = mp_get_stream_raise(args[0], MP_STREAM_OP_READ);
+    mp_buffer_info_t bufinfo;
+    mp_get_buffer_raise(args[1], &bufinfo, MP_BUFFER_WRITE);
+    mp_uint_t len = bufinfo.len;
+    if (n_args > 2) {
+        len = mp_obj_get_int(args[2]);
+        if (len > bufinfo.len) {
+            len = bufinfo.len;
+        }
+    }
+    int error;
+    mp_uint_t out_sz = stream_readline_chunk(args[0], stream_p, bufinfo.buf, len, &error);
+    if (error != 0) {
+        if (mp_is_nonblocking_error(error)) {
+            return mp_const_none;
+        }
+        mp_raise_OSError(error);
+    }
+    return MP_OBJ_NEW_SMALL_INT(out_sz);
+}
+MP_DEFINE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_readline_into_obj, 2, 3, stream_readline_into);
+
 // TODO take an optional extra argument (what does it do exactly?)
 STATIC mp_obj_t stream_unbuffered_readlines(mp_obj_t self) {
     mp_obj_t lines = mp_obj_new_list(0, NULL);
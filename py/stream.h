@@ -42,6 +42,9 @@
 #define MP_STREAM_GET_DATA_OPTS (8)  // Get data/message options
 #define MP_STREAM_SET_DATA_OPTS (9)  // Set data/message options
 #define MP_STREAM_GET_FILENO    (10) // Get fileno of underlying file
+#define MP_STREAM_POLL_NOTIFY   (11) // Attach/detach a poll notifier
+#define MP_STREAM_WRITEV        (12) // Gather write of several buffers
+#define MP_STREAM_GET_DATA_AVAIL (13) // Get bytes left in current data/message
 
 // These poll ioctl values are compatible with Linux
 #define MP_STREAM_POLL_RD  (0x0001)
@@ -58,6 +61,38 @@ struct mp_stream_seek_t {
     int whence;
 };
 
+// Argument structure for MP_STREAM_POLL_NOTIFY.  A stream that accepts it
+// keeps the pointer, sets attached, and from then on calls
+// mp_stream_poll_notify() (from any task) whenever its poll state may have
+// changed, so a poller only has to poll it again once seq has moved on.  A
+// second request with the same notifier detaches it and clears attached.
+// A stream has at most one notifier: attaching another clears attached on
+// the previous one, whose poller then goes back to polling it every time.
+// Streams that don't support notification leave attached false.
+typedef struct _mp_stream_poll_notify_t {
+    volatile mp_uint_t seq;
+    bool attached;
+} mp_stream_poll_notify_t;
+
+static inline void mp_stream_poll_notify(mp_stream_poll_notify_t *notify) {
+    notify->seq++;
+}
+
+// One buffer of a gather write
+typedef struct _mp_stream_iovec_t {
+    const void *base;
+    size_t len;
+} mp_stream_iovec_t;
+
+// Argument structure for MP_STREAM_WRITEV.  The stream writes from the
+// buffers in order, as a single write call would, and returns the number
+// of bytes written.  Streams without gather support return MP_EINVAL and
+// get one write call per buffer instead.
+typedef struct _mp_stream_writev_t {
+    const mp_stream_iovec_t *iov;
+    size_t iovcnt;
+} mp_stream_writev_t;
+
 // seek ioctl "whence" values
 #define MP_SEEK_SET (0)
 #define MP_SEEK_CUR (1)
@@ -71,15 +106,18 @@ typedef struct _mp_stream_p_t {
     mp_uint_t (*write)(mp_obj_t obj, const void *buf, mp_uint_t size, int *errcode);
     mp_uint_t (*ioctl)(mp_obj_t obj, mp_uint_t request, uintptr_t arg, int *errcode);
     mp_uint_t is_text : 1; // default is bytes, set this for text stream
+    mp_uint_t is_seekable : 1; // set if MP_STREAM_SEEK can give back data read ahead
 } mp_stream_p_t;
 
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_read_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_read1_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_readinto_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_unbuffered_readline_obj);
+MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_readline_into_obj);
 MP_DECLARE_CONST_FUN_OBJ_1(mp_stream_unbuffered_readlines_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_write_obj);
 MP_DECLARE_CONST_FUN_OBJ_2(mp_stream_write1_obj);
+MP_DECLARE_CONST_FUN_OBJ_2(mp_stream_writevec_obj);
 MP_DECLARE_CONST_FUN_OBJ_1(mp_stream_close_obj);
 MP_DECLARE_CONST_FUN_OBJ_VAR_BETWEEN(mp_stream_seek_obj);
 MP_DECLARE_CONST_FUN_OBJ_1(mp_stream_tell_obj);
@@ -110,6 +148,9 @@ mp_obj_t mp_stream_write(mp_obj_t self_in, const void *buf, size_t len, byte fla
 #define MP_STREAM_RW_ONCE  1
 mp_uint_t mp_stream_rw(mp_obj_t stream, void *buf, mp_uint_t size, int *errcode, byte flags);
 #define mp_stream_write_exactly(stream, buf, size, err) mp_stream_rw(stream, (byte*)buf, size, err, MP_STREAM_RW_WRITE)
+// Write all of iovcnt buffers, using MP_STREAM_WRITEV where the stream has it;
+// the iov entries are updated as data goes out
+mp_uint_t mp_stream_writev(mp_obj_t stream, mp_stream_iovec_t *iov, size_t iovcnt, int *errcode);
 #define mp_stream_read_exactly(stream, buf, size, err) mp_stream_rw(stream, buf, size, err, MP_STREAM_RW_READ)
 
 void mp_stream_write_adaptor(void *self, const char *buf, size_t len);
@@ -32,11 +32,14 @@
 #include "py/emitglue.h"
 #include "py/objtype.h"
 #include "py/runtime.h"
+#include "py/smallint.h"
 #include "py/bc0.h"
 #include "py/bc.h"
 
 #if 0
 #define TRACE(ip) printf("sp=%d ", (int)(sp - &code_state->state[0] + 1)); mp_bytecode_print2(ip, 1, code_state->fun_bc->const_table);
+#elif MICROPY_VM_COUNT_OPCODES
+#define TRACE(ip) (++MP_STATE_VM(vm_opcode_count))
 #else
 #define TRACE(ip)
 #endif
@@ -108,6 +111,60 @@
     exc_sp--; /* pop back to previous exception handler */ \
     CLEAR_SYS_EXC_INFO() /* just clear sys.exc_info(), not compliant, but it shouldn't be used in 1st place */
 
+#if MICROPY_OPT_SMALL_INT_BINARY_OP
+// Binary op on two objects, with a fast path for the operations on small ints
+// that loops are made of; anything else goes to mp_binary_op.
+static inline mp_obj_t vm_binary_op(mp_binary_op_t op, mp_obj_t lhs, mp_obj_t rhs) {
+    if (mp_obj_is_small_int(lhs) && mp_obj_is_small_int(rhs)) {
+        mp_int_t lhs_val = MP_OBJ_SMALL_INT_VALUE(lhs);
+        mp_int_t rhs_val = MP_OBJ_SMALL_INT_VALUE(rhs);
+        mp_int_t res;
+        switch (op) {
+            case MP_BINARY_OP_LESS: return mp_obj_new_bool(lhs_val < rhs_val);
+            case MP_BINARY_OP_MORE: return mp_obj_new_bool(lhs_val > rhs_val);
+            case MP_BINARY_OP_EQUAL: return mp_obj_new_bool(lhs_val == rhs_val);
+            case MP_BINARY_OP_LESS_EQUAL: return mp_obj_new_bool(lhs_val <= rhs_val);
+            case MP_BINARY_OP_MORE_EQUAL: return mp_obj_new_bool(lhs_val >= rhs_val);
+            case MP_BINARY_OP_NOT_EQUAL: return mp_obj_new_bool(lhs_val != rhs_val);
+            case MP_BINARY_OP_ADD:
+            case MP_BINARY_OP_INPLACE_ADD:
+                res = lhs_val + rhs_val;
+                goto check_fits;
+            case MP_BINARY_OP_SUBTRACT:
+            case MP_BINARY_OP_INPLACE_SUBTRACT:
+                res = lhs_val - rhs_val;
+            check_fits:
+                // the sum of two small ints can't overflow mp_int_t
+                if (MP_SMALL_INT_FITS(res)) {
+                    return MP_OBJ_NEW_SMALL_INT(res);
+                }
+                break;
+            case MP_BINARY_OP_MULTIPLY:
+            case MP_BINARY_OP_INPLACE_MULTIPLY:
+                if (!mp_small_int_mul_overflow(lhs_val, rhs_val)) {
+                    return MP_OBJ_NEW_SMALL_INT(lhs_val * rhs_val);
+                }
+                break;
+            // the bitwise ops on small ints always give a small int
+            case MP_BINARY_OP_AND:
+            case MP_BINARY_OP_INPLACE_AND:
+                return MP_OBJ_NEW_SMALL_INT(lhs_val & rhs_val);
+            case MP_BINARY_OP_OR:
+            case MP_BINARY_OP_INPLACE_OR:
+                return MP_OBJ_NEW_SMALL_INT(lhs_val | rhs_val);
+            case MP_BINARY_OP_XOR:
+            case MP_BINARY_OP_INPLACE_XOR:
+                return MP_OBJ_NEW_SMALL_INT(lhs_val ^ rhs_val);
+            default:
+                break;
+        }
+    }
+    return mp_binary_op(op, lhs, rhs);
+}
+#else
+#define vm_binary_op mp_binary_op
+#endif
+
 // fastn has items in reverse order (fastn[0] is local[0], fastn[-1] is local[1], etc)
 // sp points to bottom of stack which grows up
 // returns:
@@ -149,6 +206,11 @@ mp_vm_return_kind_t mp_execute_bytecode(mp_code_state_t *code_state, volatile mp
 #if MICROPY_STACKLESS
 run_code_state: ;
 #endif
+    #if MICROPY_TRACK_CODE_STATE
+    // allocations and profiler samples from now on go to this function
+    MP_STATE_THREAD(code_state) = code_state;
+    #endif
+
     // Pointers which are constant for particular invocation of mp_execute_bytecode()
     mp_obj_t * /*const*/ fastn;
     mp_exc_stack_t * /*const*/ exc_stack;
@@ -321,8 +383,22 @@ dispatch_loop:
                 }
                 #endif
 
+                #if MICROPY_OPT_SUPERINSTRUCTIONS
+                ENTRY(MP_BC_LOAD_FAST_ATTR):
+                    // the rest of the opcode is laid out like LOAD_ATTR
+                    obj_shared = fastn[-(mp_int_t)*ip++];
+                    if (obj_shared == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    PUSH(obj_shared);
+                    goto load_attr;
+                #endif
+
                 #if !MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE
                 ENTRY(MP_BC_LOAD_ATTR): {
+                    #if MICROPY_OPT_SUPERINSTRUCTIONS
+                    load_attr:
+                    #endif
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
                     SET_TOP(mp_load_attr(TOP(), qst));
@@ -330,6 +406,9 @@ dispatch_loop:
                 }
                 #else
                 ENTRY(MP_BC_LOAD_ATTR): {
+                    #if MICROPY_OPT_SUPERINSTRUCTIONS
+                    load_attr:
+                    #endif
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
                     mp_obj_t top = TOP();
@@ -362,7 +441,12 @@ dispatch_loop:
                 ENTRY(MP_BC_LOAD_METHOD): {
                     MARK_EXC_IP_SELECTIVE();
                     DECODE_QSTR;
-                    mp_load_method(*sp, qst, sp);
+                    #if MICROPY_OPT_CACHE_CLASS_LOOKUP
+                    if (!mp_obj_instance_load_method_cached(*sp, qst, sp))
+                    #endif
+                    {
+                        mp_load_method(*sp, qst, sp);
+                    }
                     sp += 1;
                     DISPATCH();
                 }
@@ -552,6 +636,46 @@ dispatch_loop:
                     DISPATCH_WITH_PEND_EXC_CHECK();
                 }
 
+                #if MICROPY_OPT_SUPERINSTRUCTIONS
+                ENTRY(MP_BC_COMPARE_POP_JUMP_IF_TRUE): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_binary_op_t op = *ip++;
+                    DECODE_SLABEL;
+                    mp_obj_t rhs = POP();
+                    mp_obj_t lhs = POP();
+                    mp_obj_t res = vm_binary_op(op, lhs, rhs);
+                    if (res == mp_const_true || (res != mp_const_false && mp_obj_is_true(res))) {
+                        ip += slab;
+                    }
+                    DISPATCH_WITH_PEND_EXC_CHECK();
+                }
+
+                ENTRY(MP_BC_COMPARE_POP_JUMP_IF_FALSE): {
+                    MARK_EXC_IP_SELECTIVE();
+                    mp_binary_op_t op = *ip++;
+                    DECODE_SLABEL;
+                    mp_obj_t rhs = POP();
+                    mp_obj_t lhs = POP();
+                    mp_obj_t res = vm_binary_op(op, lhs, rhs);
+                    if (res == mp_const_false || (res != mp_const_true && !mp_obj_is_true(res))) {
+                        ip += slab;
+                    }
+                    DISPATCH_WITH_PEND_EXC_CHECK();
+                }
+
+                ENTRY(MP_BC_LOAD_FAST_CONST_BINARY_OP): {
+                    MARK_EXC_IP_SELECTIVE();
+                    DECODE_UINT;
+                    mp_obj_t lhs = fastn[-(mp_int_t)(unum & 0xf)];
+                    if (lhs == MP_OBJ_NULL) {
+                        goto local_name_error;
+                    }
+                    mp_obj_t rhs = MP_OBJ_NEW_SMALL_INT((mp_int_t)((unum >> 4) & 0x3f) - 16);
+                    PUSH(vm_binary_op(unum >> 10, lhs, rhs));
+                    DISPATCH();
+                }
+                #endif
+
                 ENTRY(MP_BC_JUMP_IF_TRUE_OR_POP): {
                     DECODE_SLABEL;
                     if (mp_obj_is_true(TOP())) {
@@ -1236,7 +1360,7 @@ yield:
                     MARK_EXC_IP_SELECTIVE();
                     mp_obj_t rhs = POP();
                     mp_obj_t lhs = TOP();
-                    SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
+                    SET_TOP(vm_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
                     DISPATCH();
                 }
 
@@ -1259,7 +1383,7 @@ yield:
                     } else if (ip[-1] < MP_BC_BINARY_OP_MULTI + MP_BINARY_OP_NUM_BYTECODE) {
                         mp_obj_t rhs = POP();
                         mp_obj_t lhs = TOP();
-                        SET_TOP(mp_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
+                        SET_TOP(vm_binary_op(ip[-1] - MP_BC_BINARY_OP_MULTI, lhs, rhs));
                         DISPATCH();
                     } else
 #endif
@@ -1364,50 +1488,8 @@ unwind_loop:
             // TODO: don't set traceback for exceptions re-raised by END_FINALLY.
             // But consider how to handle nested exceptions.
             if (nlr.ret_val != &mp_const_GeneratorExit_obj) {
-                const byte *ip = code_state->fun_bc->bytecode;
-                ip = mp_decode_uint_skip(ip); // skip n_state
-                ip = mp_decode_uint_skip(ip); // skip n_exc_stack
-                ip++; // skip scope_params
-                ip++; // skip n_pos_args
-                ip++; // skip n_kwonly_args
-                ip++; // skip n_def_pos_args
-                size_t bc = code_state->ip - ip;
-                size_t code_info_size = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip); // skip code_info_size
-                bc -= code_info_size;
-                #if MICROPY_PERSISTENT_CODE
-                qstr block_name = ip[0] | (ip[1] << 8);
-                qstr source_file = ip[2] | (ip[3] << 8);
-                ip += 4;
-                #else
-                qstr block_name = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                qstr source_file = mp_decode_uint_value(ip);
-                ip = mp_decode_uint_skip(ip);
-                #endif
-                size_t source_line = 1;
-                size_t c;
-                while ((c = *ip)) {
-                    size_t b, l;
-                    if ((c & 0x80) == 0) {
-                        // 0b0LLBBBBB encoding
-                        b = c & 0x1f;
-                        l = c >> 5;
-                        ip += 1;
-                    } else {
-                        // 0b1LLLBBBB 0bLLLLLLLL encoding (l's LSB in second byte)
-                        b = c & 0xf;
-                        l = ((c << 4) & 0x700) | ip[1];
-                        ip += 2;
-                    }
-                    if (bc >= b) {
-                        bc -= b;
-                        source_line += l;
-                    } else {
-                        // found source line corresponding to bytecode offset
-                        break;
-                    }
-                }
+                qstr block_name, source_file;
+                size_t source_line = mp_bytecode_get_source_line(code_state->fun_bc->bytecode, code_state->ip, &block_name, &source_file);
                 mp_obj_exception_add_traceback(MP_OBJ_FROM_PTR(nlr.ret_val), source_file, source_line, block_name);
             }
 
@@ -42,6 +42,9 @@ static const void *const entry_table[256] = {
     [MP_BC_LOAD_DEREF] = &&entry_MP_BC_LOAD_DEREF,
     [MP_BC_LOAD_NAME] = &&entry_MP_BC_LOAD_NAME,
     [MP_BC_LOAD_GLOBAL] = &&entry_MP_BC_LOAD_GLOBAL,
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    [MP_BC_LOAD_FAST_ATTR] = &&entry_MP_BC_LOAD_FAST_ATTR,
+    #endif
     [MP_BC_LOAD_ATTR] = &&entry_MP_BC_LOAD_ATTR,
     [MP_BC_LOAD_METHOD] = &&entry_MP_BC_LOAD_METHOD,
     [MP_BC_LOAD_SUPER_METHOD] = &&entry_MP_BC_LOAD_SUPER_METHOD,
@@ -65,6 +68,11 @@ static const void *const entry_table[256] = {
     [MP_BC_JUMP] = &&entry_MP_BC_JUMP,
     [MP_BC_POP_JUMP_IF_TRUE] = &&entry_MP_BC_POP_JUMP_IF_TRUE,
     [MP_BC_POP_JUMP_IF_FALSE] = &&entry_MP_BC_POP_JUMP_IF_FALSE,
+    #if MICROPY_OPT_SUPERINSTRUCTIONS
+    [MP_BC_COMPARE_POP_JUMP_IF_TRUE] = &&entry_MP_BC_COMPARE_POP_JUMP_IF_TRUE,
+    [MP_BC_COMPARE_POP_JUMP_IF_FALSE] = &&entry_MP_BC_COMPARE_POP_JUMP_IF_FALSE,
+    [MP_BC_LOAD_FAST_CONST_BINARY_OP] = &&entry_MP_BC_LOAD_FAST_CONST_BINARY_OP,
+    #endif
     [MP_BC_JUMP_IF_TRUE_OR_POP] = &&entry_MP_BC_JUMP_IF_TRUE_OR_POP,
     [MP_BC_JUMP_IF_FALSE_OR_POP] = &&entry_MP_BC_JUMP_IF_FALSE_OR_POP,
     [MP_BC_SETUP_WITH] = &&entry_MP_BC_SETUP_WITH,
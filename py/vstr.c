@@ -110,7 +110,13 @@ STATIC void vstr_ensure_extra(vstr_t *vstr, size_t size) {
             // be there, so the only safe option is to raise an exception.
             mp_raise_msg(&mp_type_RuntimeError, NULL);
         }
-        size_t new_alloc = ROUND_ALLOC((vstr->len + size) + 16);
+        // grow by at least half again, so that building a long string a
+        // piece at a time costs linear rather than quadratic time
+        size_t new_alloc = (vstr->len + size) + 16;
+        if (new_alloc < vstr->alloc + vstr->alloc / 2) {
+            new_alloc = vstr->alloc + vstr->alloc / 2;
+        }
+        new_alloc = ROUND_ALLOC(new_alloc);
         char *new_buf = m_renew(char, vstr->buf, vstr->alloc, new_alloc);
         vstr->alloc = new_alloc;
         vstr->buf = new_buf;
@@ -0,0 +1,43 @@
+# test the elementwise and reduction functions of the array module
+
+try:
+    import uarray as array
+except ImportError:
+    import array
+try:
+    array.add
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+a = array.array('h', [1, -2, 3, 400])
+b = array.array('h', [10, 20, 30, 40])
+
+# elementwise
+print(array.add(a, b), array.sub(a, 1), array.mul(a, b))
+print(array.scale(a, 0.5), array.scale(a, 2, 1), array.scale(a, 0.5, 0.25, array.array('f', [0] * 4)))
+print(array.clip(a, 0, 100))
+print(array.convert(a, 'f'), array.convert(a, 'B'), array.convert(array.array('f', [1.5, -2.5]), 'i'))
+
+# reductions
+print(array.sum(a), array.min(a), array.max(a), array.dot(a, b), array.sum(array.array('d', [0.5, 0.25])))
+
+# other buffers, an explicit output, and larger arrays
+print(array.add(bytearray(b'\x01\x02'), 255))
+o = array.array('i', [0] * 4)
+print(array.add(a, b, o) is o, o)
+l = array.array('I', range(100))
+print(array.sum(l), array.dot(l, l), array.max(l))
+
+# errors
+for f in (
+    lambda: array.add(a, array.array('h', [1])),
+    lambda: array.add(a, b, array.array('h', [0] * 2)),
+    lambda: array.min(array.array('b')),
+    lambda: array.convert(a, 'O'),
+    lambda: array.sum(1),
+):
+    try:
+        f()
+    except (TypeError, ValueError) as er:
+        print(type(er).__name__)
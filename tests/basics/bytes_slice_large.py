@@ -0,0 +1,29 @@
+# test large slices of str and bytes, which may share the data of the original
+
+import gc
+
+b = bytes(range(256)) * 4
+s = ''.join(chr(65 + i % 26) for i in range(600)) + 'é' * 100
+
+bs = b[100:900]
+ss = s[50:650]
+print(len(bs), bs[:4], bs[-4:], len(ss), ss[:5], ss[-5:])
+
+# the slices stay valid after the original is gone
+del b, s
+gc.collect()
+x = [bytes(1000) for i in range(10)]
+print(bs[10:14], ss[100:105], bs == bytes(range(100, 256)) + bytes(range(256)) * 2 + bytes(range(132)))
+
+# slices of slices, hashing, comparison and dict keys
+bss = bs[200:700]
+sss = ss[400:]
+print(len(bss), bss[:3], sss[-10:], hash(sss) == hash(ss[400:]), sss == ss[400:])
+d = {sss: 1}
+print(d[ss[-200:]])
+
+# concatenation and conversion
+t = ss[:100] + ss[:100]
+print(len(t), t[95:105])
+print(int(('1' * 300)[:100]) == int('1' * 100), float(('2' * 200)[:80]) == float('2' * 80))
+print(sss.encode()[-6:], bytes(bss[:3]))
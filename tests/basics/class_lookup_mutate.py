@@ -0,0 +1,43 @@
+# test that method and attribute lookups see changes made to classes
+
+class A:
+    x = 1
+    def f(self):
+        return 'A.f'
+
+class B(A):
+    pass
+
+b = B()
+for i in range(2):
+    print(b.f(), b.x)
+
+# change the method in the base class
+A.f = lambda self: 'new A.f'
+print(b.f())
+
+# override it in the derived class
+B.f = lambda self: 'B.f'
+print(b.f())
+
+# remove the override again
+del B.f
+print(b.f())
+
+# an instance member shadows the class
+b.f = lambda: 'b.f'
+print(b.f())
+del b.f
+print(b.f())
+
+# class attributes
+A.x = 2
+print(b.x)
+setattr(B, 'x', 3)
+print(b.x, A().x)
+
+# a new class with the same attribute names
+class C:
+    def f(self):
+        return 'C.f'
+print(C().f(), b.f())
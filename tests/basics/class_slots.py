@@ -0,0 +1,83 @@
+# test __slots__ on user classes
+
+class A:
+    __slots__ = ('x', 'y')
+    def __init__(self):
+        self.x = 1
+
+a = A()
+try:
+    a.z = 3
+    print('SKIP')
+    raise SystemExit
+except AttributeError:
+    pass
+
+print(a.x)
+try:
+    a.y
+except AttributeError:
+    print('AttributeError')
+a.y = 2
+print(a.x, a.y)
+del a.y
+try:
+    del a.y
+except AttributeError:
+    print('AttributeError')
+try:
+    a.__dict__
+except AttributeError:
+    print('AttributeError')
+
+# a single string names one slot
+class B:
+    __slots__ = 'v'
+b = B()
+b.v = 'v'
+print(b.v)
+
+# slots are inherited, and a subclass without __slots__ has a dict
+class C(A):
+    __slots__ = ('w',)
+c = C()
+c.w = 4
+print(c.x, c.w)
+class D(A):
+    pass
+d = D()
+d.z = 5
+print(d.x, d.z)
+
+# __dict__ in __slots__ allows other attributes
+class E:
+    __slots__ = ('x', '__dict__')
+e = E()
+e.x = 1
+e.z = 2
+print(e.x, e.z)
+
+# slots with methods and class attributes
+class F:
+    __slots__ = ('val',)
+    scale = 10
+    def get(self):
+        return self.val * self.scale
+f = F()
+f.val = 3
+print(f.get())
+
+# __getattr__ is called for an unset slot
+class G:
+    __slots__ = ('x',)
+    def __getattr__(self, attr):
+        return 'getattr ' + attr
+print(G().x)
+
+# a slot can't shadow a class variable
+try:
+    class H:
+        __slots__ = ('x',)
+        x = 1
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,54 @@
+# deque methods beyond append/popleft, indexing and iteration
+try:
+    try:
+        from ucollections import deque
+    except ImportError:
+        from collections import deque
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+d = deque((), 3)
+try:
+    d.pop()
+except IndexError:
+    print("IndexError")
+
+d.extend([1, 2])
+d.appendleft(0)
+print(len(d), d.popleft(), d.pop(), len(d))
+
+# full deques drop from the opposite end
+d = deque((), 3)
+d.extend(range(5))
+d.appendleft(10)
+print(len(d), d.pop(), d.popleft(), d.popleft())
+
+# wrap around the end of the buffer
+d = deque((), 4)
+for i in range(10):
+    d.append(i)
+    if i % 3 == 0:
+        d.popleft()
+try:
+    print(list(d), [x * 2 for x in d])
+except TypeError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    print(d[0], d[-1], d[len(d) - 1])
+    d[1] = 'x'
+    print(d[1], d.pop(), d.pop(), d.pop())
+except TypeError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    d[len(d)]
+except IndexError:
+    print("IndexError")
+
+d.extend((1, 2))
+d.clear()
+print(len(d), bool(d), list(d))
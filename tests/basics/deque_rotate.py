@@ -0,0 +1,39 @@
+# deque.rotate, including across the wrap-around point of the buffer
+try:
+    try:
+        from ucollections import deque
+    except ImportError:
+        from collections import deque
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    deque((), 1).rotate
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+d = deque((), 5)
+d.rotate()
+d.append(1)
+d.rotate(3)
+print(list(d))
+
+d.extend(range(2, 6))
+for n in (1, -1, 2, -2, 3, -3, 4, 5, 7, -12, 0):
+    d.rotate(n)
+    print(n, list(d), d[0], d[-1])
+
+# partially filled and wrapped
+d = deque((), 6)
+d.extend(range(5))
+for i in range(4):
+    d.popleft()
+    d.append(10 + i)
+for n in (1, 2, -4, 3):
+    d.rotate(n)
+    print(list(d))
+d.append(20)
+d.appendleft(21)
+print(list(d))
@@ -0,0 +1,46 @@
+# deque storing unboxed numbers, given an array typecode
+try:
+    from ucollections import deque
+    from array import array
+    deque('f', 1)
+except (ImportError, TypeError, ValueError):
+    print("SKIP")
+    raise SystemExit
+
+d = deque('h', 3)
+d.extend((1, -2, 3, 4))
+print(len(d), list(d), d[0], d[-1])
+d[1] = 100
+print(d.popleft(), d.pop(), list(d))
+d.appendleft(7)
+d.appendleft(8)
+print(list(d))
+d.rotate()
+print(list(d))
+
+# moving average over a window
+w = deque('f', 4)
+for x in (1.0, 2.0, 3.0, 4.0, 5.0, 6.0):
+    w.append(x)
+    print(sum(w) / len(w))
+
+# buffer protocol gives the items oldest first
+print(list(array('f', w)), bytes(deque('B', 2)))
+d = deque('B', 4)
+for i in range(7):
+    d.append(i)
+d.popleft()
+print(bytes(d), list(d))
+d.append(9)
+print(bytes(d))
+
+for tc in ('O', 'x', 'ff', ''):
+    try:
+        deque(tc, 2)
+    except ValueError:
+        print('ValueError')
+try:
+    d.append('a')
+except TypeError:
+    print('TypeError')
+print(list(d))
@@ -0,0 +1,44 @@
+# dicts with many deletions and additions, of various sizes
+
+for n in (3, 8, 9, 20, 300):
+    d = {}
+    for i in range(n):
+        d[i] = i
+    for i in range(0, n, 2):
+        del d[i]
+    for i in range(n, 2 * n):
+        d[str(i)] = i
+    for i in range(1, n, 4):
+        d.pop(i)
+    for i in range(0, n, 2):
+        d[i] = -i
+    print(n, len(d), sorted(d.values())[:8], sum(d.values()))
+    print(all(d[k] == (k if isinstance(k, int) and k % 2 else -k if isinstance(k, int) else int(k)) for k in d))
+    print(1 in d, 2 in d, str(n) in d, 'x' in d)
+
+    # empty it with popitem, then fill it again
+    m = len(d)
+    while d:
+        d.popitem()
+    print(m, len(d))
+    for i in range(n):
+        d[i] = i
+    print(len(d), sum(d.values()))
+
+# copy of a large dict stays independent
+d = {i: i for i in range(50)}
+c = d.copy()
+del c[10]
+c[100] = 100
+print(len(d), len(c), 10 in d, 10 in c, 100 in d)
+
+# unhashable keys raise for small and large dicts
+for d in ({1: 1}, {i: i for i in range(20)}):
+    try:
+        d[[]] = 1
+    except TypeError:
+        print('TypeError')
+    try:
+        [] in d
+    except TypeError:
+        print('TypeError')
@@ -0,0 +1,48 @@
+# dicts and sets whose keys are all small ints, and what happens when
+# keys of other types equal to them are used
+
+d = {}
+for i in range(-5, 20):
+    d[i] = i * i
+print(d[0], d[-5], d[19], 20 in d, -6 in d)
+print(d.get(True), d.get(False), d.get(3.0), d.get(2 ** 100))
+d[True] = "t"
+print(d[1], len(d))
+d[2.0] = "f"
+print(d[2], len(d))
+d["x"] = 1
+print(d[3], d["x"], 3 in d)
+del d[4]
+print(4 in d, len(d))
+
+s = set(range(10))
+print(1.0 in s, True in s, 10 in s, -1 in s)
+s.add(True)
+print(len(s))
+s.add(1.5)
+print(1.5 in s, 5 in s, len(s))
+s.discard(5.0)
+print(5 in s, len(s))
+
+# bulk operations with sets, frozensets and other iterables
+a = set(range(0, 20, 2))
+b = set(range(0, 20, 3))
+print(sorted(a & b), sorted(a | b), sorted(a - b), sorted(a ^ b))
+print(sorted(a.intersection(range(0, 20, 3))), sorted(a.difference([0, 2, 4.0])))
+print(a.isdisjoint(b), a.isdisjoint({1, 3}), a.isdisjoint([1, 2]))
+print(sorted(frozenset(b) & a), sorted(a.intersection({2.0, True})))
+c = set(a)
+c.update(b, [100])
+print(sorted(c))
+c.difference_update({100.0}, range(10))
+print(sorted(c))
+c.intersection_update(frozenset(range(12, 100)))
+print(sorted(c))
+c.symmetric_difference_update(c)
+print(c)
+c = set(a)
+c.update(c)
+c.intersection_update(c)
+print(sorted(c))
+c -= c
+print(c)
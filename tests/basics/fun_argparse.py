@@ -0,0 +1,23 @@
+# test argument parsing of builtins that take keyword args
+
+# positional and keyword args, in any order
+print(list(enumerate([1, 2], 5)))
+print(list(enumerate([1, 2], start=5)))
+print(list(enumerate(start=5, iterable=[1, 2])))
+l = [3, 1, 2]
+l.sort(reverse=True, key=lambda x: -x)
+print(l)
+
+# invalid combinations of args
+for f in (
+    lambda: enumerate(),
+    lambda: enumerate([1], foo=1),
+    lambda: enumerate([1], 2, 3),
+    lambda: enumerate([1], 2, start=3),
+    lambda: [].sort(1),
+    lambda: enumerate(iterable=[1], start="x"),
+):
+    try:
+        f()
+    except TypeError:
+        print("TypeError")
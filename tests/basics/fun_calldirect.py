@@ -0,0 +1,59 @@
+# test calls to functions that take only positional args, which may take a
+# fast path, next to forms that need the general argument handling
+
+def f0():
+    return 0
+
+def f3(a, b, c):
+    return a, b, c
+
+def fdef(a, b=2, c=3):
+    return a, b, c
+
+def fcell(a, b):
+    def g():
+        return a + b
+    return g()
+
+print(f0())
+print(f3(1, 2, 3))
+print(f3(1, *(2, 3)))
+print(f3(1, c=3, b=2))
+print(fdef(1, 5, 6))
+print(fdef(1, 5))
+print(fdef(1))
+print(fdef(1, c=7))
+print(fcell(4, 5))
+
+# locals other than the args must start unbound
+def flocal(a):
+    if a:
+        x = 1
+    return x
+
+print(flocal(1))
+try:
+    flocal(0)
+except NameError:
+    print('NameError')
+
+# wrong number of args still raises
+for args in ((), (1, 2), (1, 2, 3, 4)):
+    try:
+        f3(*args)
+    except TypeError:
+        print('TypeError', len(args))
+
+# methods, where self is one of the positional args
+class A:
+    def m(self, x):
+        return x + 1
+
+print(A().m(1))
+print(list(map(f3, (1, 2), (3, 4), (5, 6))))
+
+# a deep chain of calls
+def chain(n):
+    return n if n == 0 else chain(n - 1) + 1
+
+print(chain(50))
@@ -0,0 +1,61 @@
+# test generators made one after another by the same function, which may
+# reuse the frame of a finished one
+
+def gen(n):
+    x = [n]
+    for i in range(n):
+        yield x[0] + i
+
+# a finished generator stays finished while others run
+g1 = gen(2)
+print(list(g1))
+g2 = gen(3)
+print(next(g2))
+try:
+    next(g1)
+except StopIteration:
+    print('StopIteration')
+print(list(g2), list(g1))
+
+# several generators of one function alive together
+gs = [gen(i) for i in range(4)]
+print([list(g) for g in gs])
+print([list(g) for g in gs])
+
+# generators stopped by an exception, return or close
+def gen_exc(x):
+    yield 1
+    raise ValueError(x)
+
+for i in range(3):
+    g = gen_exc(i)
+    print(next(g))
+    try:
+        next(g)
+    except ValueError as er:
+        print('ValueError', er.args)
+
+def gen_ret():
+    yield 1
+    return 2
+
+for i in range(3):
+    g = gen_ret()
+    next(g)
+    try:
+        g.send(None)
+    except StopIteration as er:
+        print('StopIteration', er.args)
+
+for i in range(3):
+    g = gen(5)
+    print(next(g))
+    g.close()
+    print(list(g))
+    g.close()
+
+# a generator that wasn't started, then a new one
+g = gen(2)
+g.close()
+print(list(gen(2)))
+print(repr(g)[:16])
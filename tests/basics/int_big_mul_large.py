@@ -0,0 +1,27 @@
+# test multiplication and 3-arg pow of large ints, covering the sizes where
+# faster algorithms take over
+
+seed = 1
+def rand_int(bits):
+    # simple LCG so the test doesn't depend on a random module
+    global seed
+    x = 0
+    for i in range(0, bits, 30):
+        seed = (seed * 1103515245 + 12345) & 0x7fffffff
+        x = (x << 30) | (seed & 0x3fffffff)
+    return x | (1 << bits)
+
+for bits in (200, 1000, 2000, 5000):
+    a = rand_int(bits)
+    b = rand_int(bits + 31)
+    c = rand_int(bits // 7)
+    print(bits, hex(a * b)[-24:], (a * b) % 1000000007, (a * a) % 1000000007)
+    print(a * b // b == a, (a * c) % 998244353, (c * a) // c == a, -a * b == a * -b)
+    print(hex((a - 1) * (b + 1))[:24], (a << 1000) * b == (a * b) << 1000)
+
+for bits in (64, 100, 500, 1024, 2048):
+    m = rand_int(bits) | 1
+    x = rand_int(bits + 10)
+    e = rand_int(bits)
+    print(bits, pow(x, e, m) % 1000000007, pow(x, 65537, m) == pow(x, 65537, m * 2) % m)
+    print(pow(-x, 3, m) == (-x * x * x) % m, pow(x, 1, m) == x % m, pow(m, e, m), pow(x, e, 1 << bits) % 1000)
@@ -0,0 +1,16 @@
+# test conversion of large ints to and from strings in various bases
+
+for n in (10**9 - 1, 10**9, 10**18 + 1, 2**64, 2**100 - 1, 10**40, 3**500, -7**77):
+    s = str(n)
+    print(s, int(s) == n, hex(n), oct(n)[-30:], int(bin(n), 2) == n)
+    print('{:,}'.format(n), '{:,}'.format(-n))
+
+# leading zeros, spaces and more digits than fit in a machine word
+print(int('0' * 40 + '123'), int('  1000000000000000000000000000 '), int('z' * 30, 36))
+print(int('1' + '0' * 45) == 10**45, int('-' + '9' * 50) == 1 - 10**50)
+
+f = 1
+for i in range(1, 300):
+    f *= i
+s = str(f)
+print(len(s), s[:20], s[-20:], int(s) == f, int(s, 16) % 1000003)
@@ -0,0 +1,51 @@
+# getvalue() shares its buffer with the returned object until the next write
+try:
+    import uio as io
+except ImportError:
+    import io
+
+s = io.StringIO()
+s.write("abc")
+v1 = s.getvalue()
+print(v1, s.getvalue() == v1)
+s.write("def")
+v2 = s.getvalue()
+print(v1, v2)
+s.seek(1)
+s.write("X")
+print(v1, v2, s.getvalue())
+print(s.read())
+s.seek(0)
+print(s.read())
+
+b = io.BytesIO(b"123")
+v1 = b.getvalue()
+b.seek(0, 2)
+b.write(b"45")
+print(v1, b.getvalue())
+
+# StringIO made from a str, and BytesIO from a bytearray
+s = io.StringIO("xyz")
+print(s.getvalue(), s.read())
+b = io.BytesIO(bytearray(b"12"))
+v1 = b.getvalue()
+b.write(b"3")
+print(v1, b.getvalue())
+
+# a long value built a piece at a time
+s = io.StringIO()
+for i in range(500):
+    s.write("%d," % i)
+v = s.getvalue()
+print(len(v), v[:10], v[-10:])
+s.write("end")
+print(len(v), len(s.getvalue()))
+
+b = io.BytesIO()
+b.write(b"")
+print(b.getvalue())
+b.close()
+try:
+    b.getvalue()
+except ValueError:
+    print("ValueError")
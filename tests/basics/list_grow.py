@@ -0,0 +1,24 @@
+# list growth and shrinking through append, extend, insert and pop
+l = []
+for i in range(20):
+    l.extend([i, i])
+    l.insert(i, -i)
+print(len(l), l[:5], l[-5:])
+
+for i in range(50):
+    l.pop(0)
+print(l)
+
+# alternate around a power of 2
+l = list(range(15))
+for i in range(10):
+    l.append(i)
+    l.append(i)
+    l.pop()
+    l.pop(0)
+print(l)
+
+l[2:4] = list(range(30))
+print(len(l), l[:6])
+l[1:] = []
+print(l)
@@ -0,0 +1,36 @@
+# test that list.sort is stable and keeps all items when a comparison fails
+
+# equal keys keep their original order, also when reversed
+l = [(i % 3, i) for i in range(20)]
+print(sorted(l, key=lambda x: x[0]))
+print(sorted(l, key=lambda x: x[0], reverse=True))
+
+# the key function is called once per item
+n = 0
+def key(x):
+    global n
+    n += 1
+    return -x
+l = list(range(50))
+l.sort(key=key)
+print(n, l[:3], l[-3:])
+
+# already sorted, reversed and mixed number types
+for l in (list(range(100)), list(range(100, 0, -1)), [3, 1.5, -2, 0.25, 7, -1.75] * 5):
+    s = sorted(l)
+    print(all(s[i] <= s[i + 1] for i in range(len(s) - 1)), len(s))
+
+# an exception while comparing leaves the list with the same items
+class A:
+    def __init__(self, x):
+        self.x = x
+    def __lt__(self, other):
+        if self.x == 13 or other.x == 13:
+            raise ValueError
+        return self.x < other.x
+l = [A((i * 7) % 40) for i in range(40)]
+try:
+    l.sort()
+except ValueError:
+    print('ValueError')
+print(sorted(a.x for a in l) == list(range(40)))
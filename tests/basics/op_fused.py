@@ -0,0 +1,56 @@
+# test sequences of opcodes that the compiler may fuse into one
+
+def f(a, b, o):
+    # local op small int
+    print(a + 1, a - 1, a * 2, a < 3, a >= 3, a == 2)
+    # local attribute
+    print(o.x, o.f())
+    # comparison and jump
+    if a < b:
+        print('lt')
+    if a == b:
+        print('eq')
+    else:
+        print('ne')
+    n = 0
+    while n < b:
+        n += 1
+    print(n)
+    while a:
+        a -= 1
+    print(a)
+
+class O:
+    x = 1
+    def f(self):
+        return 2
+
+f(2, 5, O())
+f(3, 3, O())
+
+# results that don't fit in a small int
+for x in (0x3fffffff, 0x3fffffffffffffff):
+    print(x + 1, x - -1)
+for x in (-0x40000000, -0x4000000000000000):
+    print(x - 1, x + -1)
+
+# operands of other types
+def g(a, b):
+    print(a + 1 if isinstance(a, int) else a * 2)
+    if a < b:
+        print('lt')
+g('ab', 'cd')
+g([1], [2])
+
+# unbound locals
+def h():
+    try:
+        print(x + 1)
+    except NameError:
+        print('NameError')
+    try:
+        print(x.y)
+    except NameError:
+        print('NameError')
+    x = 1
+h()
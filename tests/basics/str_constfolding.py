@@ -0,0 +1,29 @@
+# tests str, bytes and power constant folding in compiler
+
+# concatenation
+print("ab" + "cd")
+print("a" + "b" + "c" + "d")
+print(b"ab" + b"cd")
+print("" + "")
+
+# long result
+print("0123456789" * 1 + "0123456789" + "0123456789" + "0123456789")
+
+# mixed types must still raise at runtime
+try:
+    "a" + 1
+except TypeError:
+    print("TypeError")
+try:
+    "a" + b"b"
+except TypeError:
+    print("TypeError")
+try:
+    -"a"
+except TypeError:
+    print("TypeError")
+
+# power with small int operands
+print(2 ** 0, 2 ** 8, 2 ** 30)
+print(-2 ** 2, (-2) ** 3)
+print(3 ** 2 ** 2)
@@ -0,0 +1,68 @@
+# test building up str and bytes with repeated +=
+
+import gc
+
+s = ''
+parts = []
+for i in range(100):
+    s += 'abc%d' % i
+    parts.append(s)
+print(len(s), s[-12:])
+
+# earlier results are unchanged by later appends
+print(parts[20] == s[:len(parts[20])], len(parts[20]))
+
+# appending to an earlier result makes a separate string
+t = parts[50] + 'xyz'
+print(t[-8:], s[len(parts[50]):len(parts[50]) + 3])
+t += 'more'
+s += 'end'
+print(t[-10:], s[-6:])
+
+# the data survives a collection, and appending continues afterwards
+gc.collect()
+x = [bytes(100) for i in range(50)]
+s += 'after'
+print(parts[20][-6:], s[-20:])
+
+# collections while the growing string is the only reference to its data
+s = ''
+for i in range(200):
+    s += 'x%d,' % i
+    if i % 25 == 0:
+        gc.collect()
+        x = [bytearray(64) for j in range(20)]
+print(len(s), s == ''.join('x%d,' % i for i in range(200)))
+
+# a buffer that's been freed and reused isn't appended to
+s = None
+parts = None
+gc.collect()
+x = [bytes(100) for i in range(50)]
+t = ''
+for i in range(30):
+    t += 'y%d' % i
+print(len(t), t == ''.join('y%d' % i for i in range(30)))
+
+# hashes and equality match strings made other ways
+d = {}
+k = ''
+for i in range(20):
+    k += 'key'
+d[k] = 1
+print(d['key' * 20], hash(k) == hash('key' * 20), k == 'key' * 20)
+
+# adding a string to itself
+k += k
+print(len(k), k == 'key' * 40)
+
+b = b''
+for i in range(100):
+    b += bytes([i])
+print(len(b), b[-4:], b == bytes(range(100)))
+
+# the result is a C string where one is needed
+n = ''
+for i in range(40):
+    n += '1'
+print(int(n) == int('1' * 40), n.encode() == b'1' * 40)
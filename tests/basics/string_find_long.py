@@ -0,0 +1,22 @@
+# test searching in longer strings, bytes and bytearrays
+
+h = 'abcdefghij' * 20 + 'needle in a haystack' + 'xyz' * 30
+for n in ('needle', 'haystack', 'ij' * 3, 'jabc', 'xyzx', 'notfound', 'a', 'z', h[-100:], h):
+    print(h.find(n), h.rfind(n), h.count(n), n in h)
+
+# needles longer than the skip table limit
+n = 'q' * 300 + 'r'
+print((('q' * 600) + 'r').find(n), ('q' * 600).find(n))
+
+b = bytes(h, 'utf-8')
+print(b.find(b'needle'), b.rfind(b'ab'), b.count(b'xyz'), b'stack' in b, b'stacks' in b)
+b = bytearray(b)
+print(b'stack' in b, b'stacks' in b)
+
+# split, replace and partition
+r = 'k1=v1\r\nkey2=value2\r\n\r\nbody' * 10
+print(len(r.split('\r\n')), r.split('\r\n\r\n')[1][:8], r.split('\r\n', 3))
+print(r.replace('\r\n', '|')[:40], r.partition('\r\n\r\n')[2][:10], r.rpartition('=')[2][:6])
+
+# multi-byte chars
+print(('étéé' * 20).count('é'), ('étéé' * 20).find('éé'))
@@ -0,0 +1,42 @@
+# test repeated formatting with the same literal format, which may be cached
+
+for i in range(3):
+    print("a{}b{:>5}c{{}}{x!r}".format(i, "zz", x="q"))
+    print("{0}{1}{0}".format("x", i))
+    print("{:{}}|{:}|".format("a", 4, True))
+    print("{:08.3f}|{:^7}|{:+d}|{:#x}|{:o}".format(3.25, "m", i, 255, 8))
+    print("%s=%5d %%%x" % ("a", i, 255))
+    print("%(k)s-%(j)r" % {"k": i, "j": "s"})
+    print("%-*d|%.*s|" % (5, i, 2, "hello"))
+    print("%#o %#x %c %c %05d %.2s" % (8, 255, 65, "z", -42, "hello"))
+    print("no fields".format(), "no conversions" % ())
+
+    # errors come from the same field as without a cache
+    try:
+        "{}{}".format(i)
+    except IndexError:
+        print("IndexError")
+    try:
+        "{a}{b}".format(a=i)
+    except KeyError as er:
+        print("KeyError", er.args)
+    try:
+        "%d %d" % (i,)
+    except TypeError:
+        print("TypeError")
+    try:
+        "%d" % (i, i)
+    except TypeError:
+        print("TypeError")
+    try:
+        "%(k)s" % (i,)
+    except TypeError:
+        print("TypeError")
+    try:
+        "{:s}".format(i)
+    except ValueError:
+        print("ValueError")
+    try:
+        "{}{0}".format(i, i)
+    except ValueError:
+        print("ValueError")
@@ -0,0 +1,46 @@
+# test struct.Struct, which parses its format once
+
+try:
+    import ustruct as struct
+except:
+    try:
+        import struct
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+try:
+    struct.Struct
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+s = struct.Struct('<hH3sBi')
+print(s.format, s.size, struct.calcsize(s.format))
+
+# pack gives the same as the module function
+b = s.pack(-1, 2, b'ab', 3, 4)
+print(b, b == struct.pack(s.format, -1, 2, b'ab', 3, 4))
+
+# unpack and unpack_from, with an offset
+print(s.unpack(b))
+print(s.unpack_from(b'\x00' + b, 1))
+print(s.unpack_from(b'\x00' + b, -len(b)))
+
+# pack_into
+buf = bytearray(16)
+s.pack_into(buf, 2, 5, 6, b'xyz', 7, 8)
+print(buf)
+
+# repeat counts
+s = struct.Struct('>2H2b')
+print(s.size, s.unpack(s.pack(1, 2, -3, 4)))
+
+# buffer too small
+try:
+    s.unpack_from(b'12')
+except:
+    print('Exception')
+try:
+    s.pack_into(bytearray(4), 0, 1, 2, 3, 4)
+except:
+    print('Exception')
@@ -0,0 +1,23 @@
+# tuples made only of literals, which the compiler may build just once
+
+def f():
+    return (1, -2, 'abc', b'de', 12345678901234567890)
+
+print(f())
+print(f() == f(), f()[2], f()[4] + 1)
+
+# one item, and items that are not all literals
+x = 3
+print((1,), ('a', x), (1, (2, 3)))
+
+# used as operands and iterables
+print((1, 2) + (3,), (1, 2) * 2, 2 in (1, 2), ('p', 'q')[1])
+for i in (4, 5):
+    print(i)
+
+# as default arguments and for unpacking
+def g(a=(1, 2)):
+    return a
+print(g(), g((3,)))
+a, b = (6, 7)
+print(a, b)
@@ -1,10 +1,30 @@
-import time
+try:
+    import utime as time
+except ImportError:
+    import time
 
 
 ITERS = 20000000
 
+# run-bench-tests sets this to scale the benchmarks, eg for a slow board
+try:
+    try:
+        import uos as os
+    except ImportError:
+        import os
+    if os.getenv('BENCH_ITERS'):
+        ITERS = int(os.getenv('BENCH_ITERS'))
+except AttributeError:
+    pass
+
 def run(f):
-    t = time.time()
-    f(ITERS)
-    t = time.time() - t
+    if hasattr(time, 'ticks_us'):
+        # time.time() has only whole seconds on some ports
+        t = time.ticks_us()
+        f(ITERS)
+        t = time.ticks_diff(time.ticks_us(), t) / 1000000
+    else:
+        t = time.time()
+        f(ITERS)
+        t = time.time() - t
     print(t)
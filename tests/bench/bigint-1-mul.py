@@ -0,0 +1,10 @@
+# Multiplication of 2048-bit ints, as in RSA exercises
+import bench
+
+def test(num):
+    a = (1 << 2048) // 3 + 12345
+    b = (1 << 2048) // 7 + 999
+    for i in iter(range(num // 5000)):
+        a * b
+
+bench.run(test)
@@ -0,0 +1,10 @@
+# Modular exponentiation of 512-bit ints with pow(a, b, m)
+import bench
+
+def test(num):
+    m = (1 << 512) // 3 | 1
+    a = m // 5
+    for i in iter(range(num // 2000000)):
+        pow(a, m - 1, m)
+
+bench.run(test)
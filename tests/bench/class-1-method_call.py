@@ -0,0 +1,34 @@
+# Method calls on an instance of a subclass, as made by the wrapper classes
+# in pystubit, to measure the class attribute lookup
+import bench
+
+
+class Base:
+    def __init__(self):
+        self.n = 0
+
+    def get(self):
+        return self.n
+
+    def put(self, n):
+        self.n = n
+
+
+class Wrapper(Base):
+    def show(self, n):
+        self.put(self.get() + n)
+
+
+class Outer(Wrapper):
+    pass
+
+
+def test(num):
+    o = Outer()
+    for i in iter(range(num // 5)):
+        o.show(1)
+        o.show(2)
+        o.get()
+
+
+bench.run(test)
@@ -0,0 +1,11 @@
+# GC: collect with a wide object graph.  One list holds many small lists,
+# so marking has every one of them on the GC stack at the same time.
+import bench
+import gc
+
+def test(num):
+    l = [[i] for i in range(5000)]
+    for i in range(num // 400000):
+        gc.collect()
+
+bench.run(test)
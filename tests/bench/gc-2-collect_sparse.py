@@ -0,0 +1,10 @@
+# GC: collect with hardly anything live, so the time goes on sweeping
+# a mostly free heap.
+import bench
+import gc
+
+def test(num):
+    for i in range(num // 40000):
+        gc.collect()
+
+bench.run(test)
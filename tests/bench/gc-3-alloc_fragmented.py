@@ -0,0 +1,16 @@
+# GC: multi-block allocations on a fragmented heap.  Every other 1-block
+# object is kept, which leaves thousands of 1-block holes that each search
+# for a longer run of free blocks has to pass.
+import bench
+import gc
+
+def test(num):
+    keep = [None] * 20000
+    for i in range(20000):
+        keep[i] = [i]
+        b = [i]
+    gc.collect()
+    for i in range(num // 200):
+        t = (i, i, i, i, i)
+
+bench.run(test)
@@ -0,0 +1,12 @@
+# Integer filter over local values, as in sensor processing code
+import bench
+
+def test(num):
+    acc = 0
+    mask = 0x3ff
+    k = 3
+    for v in iter(range(num // 4)):
+        acc = acc * k + v
+        acc = (acc & mask) ^ (v | k)
+
+bench.run(test)
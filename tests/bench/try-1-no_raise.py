@@ -0,0 +1,12 @@
+# Exception handling overhead test
+# Enter and leave a try block without raising
+import bench
+
+def test(num):
+    for i in iter(range(num)):
+        try:
+            a = i + 1
+        except ValueError:
+            pass
+
+bench.run(test)
@@ -0,0 +1,12 @@
+# Exception handling overhead test
+# Raise and catch an exception in the same function
+import bench
+
+def test(num):
+    for i in iter(range(num)):
+        try:
+            raise OSError
+        except OSError:
+            pass
+
+bench.run(test)
@@ -0,0 +1,15 @@
+# Exception handling overhead test
+# Catch an exception raised from a called function, like a stream timeout
+import bench
+
+def f(x):
+    raise OSError(x)
+
+def test(num):
+    for i in iter(range(num)):
+        try:
+            f(i)
+        except OSError:
+            pass
+
+bench.run(test)
@@ -0,0 +1,31 @@
+# Prepended to every benchmark by run-device-bench.
+#
+# A benchmark calls report(name, samples) with a list of times in
+# microseconds, or other units given by unit.  The runner collects the
+# samples of each name over every run and reports their median.
+import gc
+import utime
+
+try:
+    import ujson as json
+except ImportError:
+    import json
+
+
+def measure(f, n, warmup=2):
+    for _ in range(warmup):
+        f()
+    samples = []
+    for _ in range(n):
+        t0 = utime.ticks_us()
+        f()
+        samples.append(utime.ticks_diff(utime.ticks_us(), t0))
+    return samples
+
+
+def report(name, samples, unit='us'):
+    print('BENCH ' + json.dumps({'name': name, 'unit': unit, 'samples': samples}))
+
+
+def skip(name, reason):
+    print('BENCH ' + json.dumps({'name': name, 'skip': reason}))
@@ -0,0 +1,15 @@
+# Achieved ADC read_timed() sample rate, in samples per second
+from machine import ADC, Pin
+
+adc = ADC(Pin(32))
+buf = bytearray(2000)
+for freq in (1000, 10000, 20000):
+    rates = []
+    for _ in range(3):
+        t0 = utime.ticks_us()
+        adc.read_timed(buf, freq, wait=True)
+        dt = utime.ticks_diff(utime.ticks_us(), t0)
+        rates.append(len(buf) * 1000000 // dt)
+    report('adc.read_timed_%d' % freq, rates, unit='Hz')
+report('adc.read', measure(adc.read, 500))
+adc.deinit()
@@ -0,0 +1,22 @@
+# Frame time of the 5x5 display through pystubit.board.display
+from pystubit.board import display, Image
+
+frames = [Image.HEART, Image.HEART_SMALL]
+i = 0
+
+
+def show():
+    global i
+    display.show(frames[i], delay=0)
+    i ^= 1
+
+
+def set_pixels():
+    for y in range(5):
+        for x in range(5):
+            display.set_pixel(x, y, (x * 50, y * 50, 0))
+
+
+report('display.show', measure(show, 200))
+report('display.set_pixel_x25', measure(set_pixels, 50))
+display.clear()
@@ -0,0 +1,34 @@
+# ESP-NOW round trip and throughput against a peer running espnow_echo.py;
+# the runner defines PEER (a MAC as bytes, or None) before this runs
+import network
+from esp import espnow
+
+if PEER is None:
+    skip('espnow.rtt', 'no peer given, see --espnow-peer')
+else:
+    network.WLAN(network.STA_IF).active(True)
+    espnow.init()
+    espnow.add_peer(PEER)
+    msg = bytearray(200)
+    rx = bytearray(250)
+
+    def rtt():
+        espnow.send(PEER, msg[:32])
+        t0 = utime.ticks_ms()
+        while espnow.recv_into(rx) is None:
+            if utime.ticks_diff(utime.ticks_ms(), t0) > 1000:
+                raise OSError('no reply from peer')
+
+    report('espnow.rtt_32', measure(rtt, 100))
+
+    # bytes per second for a burst of 200 byte frames
+    n = 200
+    rates = []
+    for _ in range(5):
+        t0 = utime.ticks_us()
+        espnow.send_many((PEER, msg) for _ in range(n))
+        espnow.flush(5000)
+        dt = utime.ticks_diff(utime.ticks_us(), t0)
+        rates.append(n * len(msg) * 1000000 // dt)
+    report('espnow.throughput_200', rates, unit='B/s')
+    espnow.deinit()
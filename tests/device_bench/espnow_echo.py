@@ -0,0 +1,23 @@
+# Run on the second board (run-device-bench --espnow-peer does this) to send
+# every ESP-NOW frame back, until the board is reset
+import network
+from esp import espnow
+
+network.WLAN(network.STA_IF).active(True)
+espnow.init()
+peers = set()
+buf = bytearray(250)
+mac = bytearray(6)
+print(network.WLAN(network.STA_IF).config('mac'))
+while True:
+    n = espnow.recv_into(buf, mac)
+    if n is None:
+        continue
+    if n > 32:
+        # throughput frames are only counted by the sender
+        continue
+    peer = bytes(mac)
+    if peer not in peers:
+        espnow.add_peer(peer)
+        peers.add(peer)
+    espnow.send(peer, buf[:n])
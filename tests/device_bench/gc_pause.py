@@ -0,0 +1,15 @@
+# gc.collect() pause with a small and a large live heap
+live = []
+
+
+def collect():
+    gc.collect()
+
+
+report('gc.collect_empty', measure(collect, 20))
+for i in range(2000):
+    live.append([i, str(i)])
+report('gc.collect_2000_lists', measure(collect, 20))
+live = None
+gc.collect()
+report('gc.alloc_1k', measure(lambda: bytearray(1024), 200))
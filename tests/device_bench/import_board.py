@@ -0,0 +1,5 @@
+# Time to import pystubit.board from a fresh soft reset
+# repeat: 10
+t0 = utime.ticks_us()
+import pystubit.board
+report('import.pystubit.board', [utime.ticks_diff(utime.ticks_us(), t0)])
@@ -0,0 +1,13 @@
+# Sample rate of the ICM20948 through pystubit.sensor
+from pystubit.board import accelerometer, gyro
+from pystubit.sensor import get_icm20948_object
+
+icm = get_icm20948_object()
+raw = [0, 0, 0]
+buf = [0, 0, 0]
+
+report('imu.acceleration_raw_into', measure(lambda: icm.acceleration_raw_into(raw), 500))
+report('imu.gyro_raw_into', measure(lambda: icm.gyro_raw_into(raw), 500))
+report('imu.accelerometer.get_values', measure(accelerometer.get_values, 200))
+report('imu.accelerometer.get_values_into', measure(lambda: accelerometer.get_values_into(buf), 200))
+report('imu.gyro.get_values', measure(gyro.get_values, 200))
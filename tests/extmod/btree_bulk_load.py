@@ -0,0 +1,28 @@
+try:
+    import btree
+    import uio
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+f = uio.BytesIO()
+db = btree.open(f, pagesize=512)
+
+print(db.bulk_load((b"%04d" % i, b"val%d" % i) for i in range(200)))
+print(len(list(db.keys())), db[b"0000"], db[b"0199"])
+print(list(db.keys(b"0097", b"0100")))
+
+# keys must be strictly increasing
+try:
+    db.bulk_load([(b"a", b"1"), (b"a", b"2")])
+except ValueError:
+    print("ValueError")
+# items before the bad one are stored
+print(db[b"a"])
+
+if hasattr(db, "stats"):
+    print(len(db.stats()))
+else:
+    print(4)
+
+db.close()
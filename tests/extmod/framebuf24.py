@@ -0,0 +1,54 @@
+try:
+    import framebuf
+    framebuf.RGB888
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+def printbuf():
+    print("--8<--")
+    for y in range(h):
+        print(buf[y * w * 3:(y + 1) * w * 3])
+    print("-->8--")
+
+w = 4
+h = 3
+buf = bytearray(w * h * 3)
+
+for fmt in (framebuf.RGB888, framebuf.GRB888):
+    fbuf = framebuf.FrameBuffer(buf, w, h, fmt)
+
+    # fill
+    fbuf.fill(0x112233)
+    printbuf()
+    fbuf.fill_rect(1, 1, 2, 5, 0x000000)
+    printbuf()
+
+    # put/get pixel
+    fbuf.pixel(0, 0, 0xff0000)
+    fbuf.pixel(3, 2, 0x0000ff)
+    print(hex(fbuf.pixel(0, 0)), hex(fbuf.pixel(3, 2)), hex(fbuf.pixel(1, 2)))
+    printbuf()
+
+    # scroll
+    fbuf.scroll(1, 1)
+    printbuf()
+    fbuf.scroll(-2, -1)
+    printbuf()
+
+    # blit from the same format, with and without a transparent colour
+    buf2 = bytearray(2 * 2 * 3)
+    fbuf2 = framebuf.FrameBuffer(buf2, 2, 2, fmt)
+    fbuf2.fill(0x445566)
+    fbuf2.pixel(0, 0, 0x000000)
+    fbuf.blit(fbuf2, 2, 1)
+    printbuf()
+    fbuf.fill(0xffffff)
+    fbuf.blit(fbuf2, -1, -1, 0x000000)
+    fbuf.blit(fbuf2, 3, 2, 0x000000)
+    printbuf()
+
+    # text
+    fbuf.fill(0)
+    fbuf.text("|", 0, 0, 0x010203)
+    print(hex(fbuf.pixel(3, 0)), hex(fbuf.pixel(3, 2)), hex(fbuf.pixel(2, 0)))
@@ -0,0 +1,65 @@
+# test uasyncio event loop, coroutines and callbacks
+
+try:
+    import uasyncio as asyncio
+    import utime
+except ImportError:
+    print('SKIP')
+    raise SystemExit
+
+async def worker(name, n, ms):
+    for i in range(n):
+        print(name, i)
+        await asyncio.sleep_ms(ms)
+
+async def sub():
+    await asyncio.sleep_ms(5)
+    return 42
+
+async def main():
+    asyncio.create_task(worker('a', 3, 20))
+    asyncio.create_task(worker('b', 2, 30))
+    print('sub', await sub())
+    await asyncio.sleep(0.1)
+    return 'done'
+
+t = utime.ticks_ms()
+print(asyncio.run(main()))
+print(utime.ticks_diff(utime.ticks_ms(), t) >= 100)
+
+# plain generators, a bare yield, and callbacks
+def gen():
+    for i in range(3):
+        print('gen', i)
+        yield
+
+loop = asyncio.get_event_loop()
+loop.create_task(gen())
+loop.call_soon(print, 'soon', 1)
+loop.call_later_ms(10, print, 'later')
+loop.run_forever()
+
+# stop() ends run_forever
+def gen_forever():
+    while True:
+        yield asyncio.sleep_ms(1)
+
+loop.create_task(gen_forever())
+loop.call_later(0.01, loop.stop)
+loop.run_forever()
+print('stopped')
+
+# an exception in a coroutine comes out of the loop
+async def bad():
+    await asyncio.sleep_ms(1)
+    raise ValueError('x')
+
+try:
+    asyncio.run(bad())
+except ValueError as er:
+    print('ValueError', er)
+
+try:
+    asyncio.create_task(1)
+except TypeError:
+    print('TypeError')
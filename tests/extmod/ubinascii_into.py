@@ -0,0 +1,37 @@
+try:
+    try:
+        import ubinascii as binascii
+    except ImportError:
+        import binascii
+    binascii.b2a_base64_into
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+buf = bytearray(32)
+
+n = binascii.hexlify_into(b'\x01\xab\xff', buf)
+print(n, buf[:n])
+n = binascii.hexlify_into(b'\x01\xab\xff', buf, ':')
+print(n, buf[:n])
+print(binascii.hexlify_into(b'', buf))
+
+for data in (b'', b'f', b'fo', b'foo', b'foob', b'fooba', b'foobar'):
+    n = binascii.b2a_base64_into(data, buf)
+    enc = bytes(buf[:n])
+    print(n, enc, enc == binascii.b2a_base64(data))
+    n = binascii.a2b_base64_into(enc, buf)
+    print(n, buf[:n] == data)
+
+# line breaks and padding take the slow path
+n = binascii.a2b_base64_into(b'Zm9v\nYmFy\nYQ==', buf)
+print(buf[:n])
+
+try:
+    binascii.b2a_base64_into(b'foobar', bytearray(8))
+except ValueError:
+    print('ValueError')
+try:
+    binascii.a2b_base64_into(b'Zm9', buf)
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,47 @@
+try:
+    from ucryptolib import aes
+    from ubinascii import unhexlify, hexlify
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+MODE_CTR = 6
+
+key = unhexlify("2b7e151628aed2a6abf7158809cf4f3c")
+ctr = unhexlify("f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff")
+try:
+    aes(key, MODE_CTR, ctr)
+except ValueError:
+    print("SKIP")
+    raise SystemExit
+
+# NIST SP800-38A, F.5.1
+pt = unhexlify(
+    "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+    "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710")
+ct = aes(key, MODE_CTR, ctr).encrypt(pt)
+print(hexlify(ct))
+
+# any length, and the keystream carries on across calls
+crypto = aes(key, MODE_CTR, ctr)
+print(b"".join(crypto.encrypt(pt[i:i + 7]) for i in range(0, len(pt), 7)) == ct)
+
+# decrypting runs the same keystream
+print(aes(key, MODE_CTR, ctr).decrypt(ct) == pt)
+
+# the counter carries across all 16 bytes
+crypto = aes(key, MODE_CTR, b"\x00" * 15 + b"\xff")
+out = crypto.encrypt(bytes(32))
+print(out[16:] == aes(key, 1).encrypt(b"\x00" * 14 + b"\x01\x00"))
+
+# encrypt_into/decrypt_into, in place
+buf = bytearray(pt)
+aes(key, MODE_CTR, ctr).encrypt_into(buf, buf)
+print(buf == ct)
+aes(key, MODE_CTR, ctr).decrypt_into(ct, buf)
+print(buf == pt)
+
+try:
+    aes(key, MODE_CTR)
+except ValueError as e:
+    print(e)
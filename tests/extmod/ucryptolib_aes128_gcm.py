@@ -0,0 +1,66 @@
+try:
+    from ucryptolib import aes
+    from ubinascii import unhexlify, hexlify
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+MODE_GCM = 11
+
+try:
+    aes(bytes(16), MODE_GCM, bytes(12))
+except ValueError:
+    print("SKIP")
+    raise SystemExit
+
+# vectors from the GCM specification, test cases 1 to 5
+crypto = aes(bytes(16), MODE_GCM, bytes(12))
+print(hexlify(crypto.digest()))
+crypto = aes(bytes(16), MODE_GCM, bytes(12))
+print(hexlify(crypto.encrypt(bytes(16))), hexlify(crypto.digest()))
+
+key = unhexlify("feffe9928665731c6d6a8f9467308308")
+iv = unhexlify("cafebabefacedbaddecaf888")
+pt = unhexlify(
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+    "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255")
+aad = unhexlify("feedfacedeadbeeffeedfacedeadbeefabaddad2")
+crypto = aes(key, MODE_GCM, iv)
+print(hexlify(crypto.encrypt(pt)), hexlify(crypto.digest()))
+crypto = aes(key, MODE_GCM, iv)
+crypto.update(aad)
+ct = crypto.encrypt(pt[:60])
+tag = crypto.digest()
+print(hexlify(ct), hexlify(tag))
+crypto = aes(key, MODE_GCM, iv[:8])
+crypto.update(aad)
+print(hexlify(crypto.encrypt(pt[:60])), hexlify(crypto.digest()))
+
+# streaming, in pieces that don't line up with the blocks
+crypto = aes(key, MODE_GCM, iv)
+crypto.update(aad[:5])
+crypto.update(aad[5:])
+out = bytearray(60)
+for i in range(0, 60, 13):
+    n = min(13, 60 - i)
+    crypto.encrypt_into(pt[i:i + n], memoryview(out)[i:i + n])
+print(out == ct, crypto.digest() == tag)
+
+# decrypt and verify
+crypto = aes(key, MODE_GCM, iv)
+crypto.update(aad)
+print(crypto.decrypt(ct) == pt[:60])
+crypto.verify(tag)
+try:
+    crypto.verify(tag[:15] + b"\x00")
+except ValueError as e:
+    print(e)
+
+try:
+    crypto.update(aad)
+except ValueError as e:
+    print(e)
+try:
+    aes(key, 1).digest()
+except ValueError as e:
+    print(e)
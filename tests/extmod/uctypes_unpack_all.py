@@ -0,0 +1,53 @@
+# test uctypes.unpack_all, and fields being read through the compiled layout
+
+try:
+    import uctypes
+    uctypes.unpack_all
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+desc = {
+    "a": uctypes.UINT8 | 0,
+    "b": uctypes.UINT16 | 2,
+    "c": uctypes.BFUINT8 | 1 | 0 << uctypes.BF_POS | 4 << uctypes.BF_LEN,
+    "d": uctypes.BFUINT8 | 1 | 4 << uctypes.BF_POS | 4 << uctypes.BF_LEN,
+    "arr": (uctypes.ARRAY | 4, uctypes.UINT8 | 2),
+    "sub": (6, {"x": uctypes.UINT8 | 0, "y": uctypes.UINT8 | 1}),
+}
+
+data = bytearray(b"\x01\xa5\x02\x03\x04\x05\x06\x07")
+s = uctypes.struct(uctypes.addressof(data), desc, uctypes.LITTLE_ENDIAN)
+
+# the values come in the order of iterating the descriptor
+values = uctypes.unpack_all(s)
+for k, v in zip(desc, values):
+    if k == "arr":
+        v = bytes(v)
+    elif k == "sub":
+        v = (v.x, v.y)
+    print(k, v, v == (bytes(s.arr) if k == "arr" else (s.sub.x, s.sub.y) if k == "sub" else getattr(s, k)))
+
+# writes go through the same layout
+s.d = 3
+s.b = 0x1234
+print(data)
+
+# nested structs created many times share a layout
+for i in range(10):
+    s.sub.x += 1
+print(s.sub.x)
+
+# a field added to the descriptor is seen by new struct objects
+desc["e"] = uctypes.UINT8 | 7
+s = uctypes.struct(uctypes.addressof(data), desc, uctypes.LITTLE_ENDIAN)
+print(s.e, len(uctypes.unpack_all(s)))
+
+try:
+    s.nofield
+except KeyError:
+    print("KeyError")
+try:
+    uctypes.unpack_all(1)
+except TypeError:
+    print("TypeError")
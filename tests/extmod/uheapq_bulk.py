@@ -0,0 +1,40 @@
+try:
+    import uheapq as heapq
+except:
+    try:
+        import heapq
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+try:
+    heapq.merge
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+data = [5, 1, 8, 3, 9, 2, 7, 4, 6, 0, 3]
+for n in (-1, 0, 1, 3, 11, 20):
+    print(n, heapq.nsmallest(n, data), heapq.nlargest(n, data))
+print(heapq.nsmallest(2, iter(['b', 'c', 'a'])), heapq.nlargest(2, (1.5, -1, 2)))
+
+# (time, action) entries, including ties on the time and non-int times
+h = [(3, 'c'), (1, 'b'), (1, 'a'), (2.5, 'x'), (-4, 'z')]
+heapq.heapify(h)
+print([heapq.heappop(h) for _ in range(len(h))])
+print(heapq.nsmallest(2, [(5, 'e'), (2, 'b'), (2, 'a')]))
+
+print(list(heapq.merge()))
+print(list(heapq.merge([], [1, 4, 7], [2, 5], [], [0, 3, 6, 9])))
+print(list(heapq.merge([(1, 'x'), (2, 'x')], [(1, 'y'), (3, 'y')], [(1, 'z')])))
+print(list(heapq.merge('ace', 'bd')))
+
+# merge is stable for equal values
+a = [1.0, 2.0]
+b = [1, 2]
+print([type(x).__name__ for x in heapq.merge(a, b)])
+
+try:
+    list(heapq.merge([1], 1))
+except TypeError:
+    print('TypeError')
@@ -0,0 +1,126 @@
+# test the native HTTP client against fake server connections
+
+try:
+    import uio
+    import uhttpc
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uio.IOBase
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# a connection that answers each request with the next of its responses,
+# where b"" is a connection closed by the server
+class Conn(uio.IOBase):
+    def __init__(self, responses):
+        self.responses = responses
+        self.rx = b""
+        self.pos = 0
+        self.tx = bytearray()
+        self.closed = False
+    def readinto(self, buf):
+        if self.pos == len(self.rx):
+            if not self.responses:
+                return 0
+            self.rx = self.responses.pop(0)
+            self.pos = 0
+        n = min(len(buf), len(self.rx) - self.pos)
+        buf[:n] = self.rx[self.pos:self.pos + n]
+        self.pos += n
+        return n
+    def write(self, buf):
+        self.tx.extend(buf)
+        return len(buf)
+    def ioctl(self, req, arg):
+        if req == 4: # MP_STREAM_CLOSE
+            self.closed = True
+            return 0
+        return -22
+
+servers = []
+def connect(host, port, ssl):
+    print("connect", host, port, ssl)
+    return servers.pop(0)
+
+s = uhttpc.Session(connect=connect, buf_size=32)
+
+# keep-alive response with a length, then chunked on the same connection
+c1 = Conn([
+    b"HTTP/1.1 200 OK\r\nContent-Length: 5\r\nX-Test: a b\r\n\r\nhello",
+    b"HTTP/1.1 201 Created\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n10;ext=1\r\n0123456789abcdef\r\n0\r\nTrailer: x\r\n\r\n",
+])
+servers.append(c1)
+r = s.get("http://example.com/a?b=1")
+print(r, r.status_code, r.reason, sorted(r.headers.items()))
+print(r.content, r.text)
+print(bytes(c1.tx))
+c1.tx = bytearray()
+r = s.post("http://example.com/p", json={"k": 1})
+print(r.status_code, r.read())
+print(bytes(c1.tx))
+print(c1.closed)
+
+# streaming the body in pieces
+c1.responses.append(b"HTTP/1.1 200 OK\r\nContent-Length: 40\r\n\r\n" + bytes(range(48, 88)))
+r = s.get("http://example.com/")
+buf = bytearray(16)
+n = r.readinto(buf)
+total = n
+while n:
+    n = r.readinto(buf)
+    total += n
+print(total)
+
+# the server closed the idle connection, so a new one is opened
+c2 = Conn([b"HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n"])
+servers.append(c2)
+c1.responses.append(b"")
+r = s.request("DELETE", "http://example.com/x")
+print(r.status_code, r.content, c1.closed, c2.closed)
+
+# no length: the body ends when the server closes, on another port and https
+c3 = Conn([b"HTTP/1.0 200 OK\r\n\r\nuntil close"])
+servers.append(c3)
+r = s.head("https://example.com:8443/h", headers={"Accept": "*/*"})
+print(r.status_code, r.content, c3.closed)
+print(bytes(c3.tx))
+c4 = Conn([b"HTTP/1.0 200 OK\r\n\r\nuntil close"])
+servers.append(c4)
+r = s.get("https://example.com:8443/")
+print(r.content, c4.closed)
+
+# closing an unfinished response closes its connection
+c5 = Conn([b"HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n01234"])
+servers.append(c5)
+with s.get("http://other/") as r:
+    print(r.read(2))
+print(c5.closed)
+
+# Session.close() closes the pooled connections
+c6 = Conn([b"HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n"])
+servers.append(c6)
+print(s.get("http://other/").content, c6.closed)
+s.close()
+print(c6.closed)
+
+# errors
+for url in ("ftp://x/", "http://", "http://x:0/"):
+    try:
+        s.get(url)
+    except ValueError:
+        print("ValueError")
+servers.append(Conn([b"HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n01234"]))
+r = s.get("http://x/")
+try:
+    r.content
+except OSError:
+    print("OSError")
+servers.append(Conn([b"garbage\r\n\r\n"]))
+try:
+    s.get("http://x/")
+except OSError:
+    print("OSError")
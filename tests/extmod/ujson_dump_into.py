@@ -0,0 +1,28 @@
+try:
+    import ujson as json
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(json, "dump_into"):
+    print("SKIP")
+    raise SystemExit
+
+buf = bytearray(32)
+n = json.dump_into({"a": [1, 2.5, None]}, buf)
+print(n, buf[:n])
+n = json.dump_into("x", memoryview(buf)[4:])
+print(n, buf[:8])
+
+# output must fit
+try:
+    json.dump_into([1, 2, 3], bytearray(6))
+except ValueError:
+    print("ValueError")
+print(json.dump_into([1, 2, 3], bytearray(9)))
+
+# read-only buffers not allowed
+try:
+    json.dump_into(1, b"1234")
+except TypeError:
+    print("TypeError")
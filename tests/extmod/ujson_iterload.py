@@ -0,0 +1,46 @@
+try:
+    from uio import StringIO
+    import ujson as json
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(json, "iterload"):
+    print("SKIP")
+    raise SystemExit
+
+def test(s):
+    try:
+        print(list(json.iterload(StringIO(s))))
+    except ValueError:
+        print("ValueError")
+
+test('1')
+test(' "abc" ')
+test('null')
+test('[]')
+test('{}')
+test('[1, 2, "c"]')
+test('{"a": 1, "b": [true, false, null]}')
+test('{"a": {"b": {"c": [[], {}, [1.5]]}}}')
+test('[[1, 2], [[3]], 4]')
+test('[{"x": 1}, {"x": 2, "y": {}}]')
+
+# larger than the read buffer
+print(sum(v for p, v in json.iterload(StringIO('[' + ', '.join(str(i) for i in range(1000)) + ']'))))
+print(list(json.iterload(StringIO('{"k": "' + 'x' * 1000 + '"}')))[0][1] == 'x' * 1000)
+
+# the iterator can be consumed incrementally
+it = json.iterload(StringIO('{"a": [10, 20]}'))
+print(next(it))
+print(next(it))
+print(list(it))
+
+# errors
+test('')
+test('[1, 2')
+test('{"a": }')
+test('{1: 2}')
+test('{[]: 2}')
+test('1 2')
+test(']')
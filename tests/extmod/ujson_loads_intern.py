@@ -0,0 +1,22 @@
+# test ujson.loads with intern_keys, a MicroPython extension
+
+try:
+    import ujson as json
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+s = '{"temperature": 21, "humidity": [1, "a"], "nested": {"temperature": "x"}}'
+a = json.loads(s)
+b = json.loads(s, intern_keys=True)
+print(a == b, sorted(b.keys()), b['nested'])
+
+# values aren't interned, only keys
+print(json.loads('["no_such_qstr_key"]', intern_keys=True))
+print(json.loads('"top"', intern_keys=True), json.loads('{}', intern_keys=True))
+
+# the option is keyword only
+try:
+    json.loads(s, True)
+except TypeError:
+    print('TypeError')
@@ -0,0 +1,74 @@
+# test the ring-file data logger on an in-memory stream
+
+try:
+    import uio
+    import ulog
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+f = uio.BytesIO()
+
+# 64 byte blocks hold 8 records of 6 bytes
+log = ulog.Log(f, "<HI", 4, block_size=64, buffer=2)
+print(log.record_size, log.seq, log.pending)
+
+# the superblock and an empty ring are written up front
+print(len(f.getvalue()))
+
+# staged records can be read before they are written
+for i in range(10):
+    log.append(i, i * 1000)
+print(log.seq, log.pending)
+print(list(log.records()))
+
+# a partial block is carried on with after reopening
+log.flush()
+print(log.pending)
+log = ulog.Log(f, "<HI", 4, block_size=64, buffer=2)
+print(log.seq, log.pending)
+print(list(log.records()) == [(i, i * 1000) for i in range(10)])
+
+# the oldest blocks are overwritten once the ring is full
+for i in range(10, 40):
+    log.append(i, i)
+log.flush()
+print([r[0] for r in log.records()])
+log = ulog.Log(f, "<HI", 4, block_size=64, buffer=2)
+print(log.seq, [r[0] for r in log.records()])
+
+# a block with a bad CRC is skipped
+buf = bytearray(f.getvalue())
+buf[4 * 64 + 20] ^= 1
+f = uio.BytesIO(buf)
+log = ulog.Log(f, "<HI", 4, block_size=64)
+print([r[0] for r in log.records()])
+
+# the layout has to match the file
+try:
+    ulog.Log(f, "<HH", 4, block_size=64)
+except ValueError:
+    print("ValueError")
+try:
+    ulog.Log(f, "<HI", 5, block_size=64)
+except ValueError:
+    print("ValueError")
+
+# bad arguments
+try:
+    log.append(1)
+except TypeError:
+    print("TypeError")
+try:
+    ulog.Log(uio.BytesIO(), "<60s", 4, block_size=64)
+except ValueError:
+    print("ValueError")
+
+# closing flushes the log and closes the stream
+f = uio.BytesIO()
+with ulog.Log(f, "<b", 2, block_size=64) as log:
+    log.append(-1)
+try:
+    log.append(1)
+except OSError:
+    print("OSError")
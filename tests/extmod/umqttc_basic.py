@@ -0,0 +1,128 @@
+# test the native MQTT client against a fake broker stream
+
+try:
+    import uio
+    import umqttc
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uio.IOBase
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# replays bytes from the broker and collects what the client sends
+class Broker(uio.IOBase):
+    def __init__(self, data):
+        self.feed(data)
+        self.tx = bytearray()
+    def feed(self, data):
+        self.rx = data
+        self.pos = 0
+    def readinto(self, buf):
+        n = min(len(buf), len(self.rx) - self.pos)
+        buf[:n] = self.rx[self.pos:self.pos + n]
+        self.pos += n
+        return n
+    def write(self, buf):
+        self.tx.extend(buf)
+        return len(buf)
+    def ioctl(self, req, arg):
+        if req == 3: # MP_STREAM_POLL
+            return arg if self.pos < len(self.rx) else 0
+        return 0 if req == 4 else -22 # MP_STREAM_CLOSE
+    def sent(self):
+        tx = bytes(self.tx)
+        self.tx = bytearray()
+        return tx
+
+CONNACK = b"\x20\x02\x00\x00"
+
+# connect, with last will and login
+b = Broker(CONNACK)
+c = umqttc.MQTTClient("cid", "localhost", user="u", password="p", keepalive=60)
+c.set_last_will("lw", b"gone", retain=True)
+print(c.connect(sock=b))
+print(b.sent())
+
+# refused connection
+c2 = umqttc.MQTTClient("cid", "localhost")
+try:
+    c2.connect(sock=Broker(b"\x20\x02\x00\x05"))
+except umqttc.MQTTException as e:
+    print("MQTTException", e.args[0])
+
+# QoS 0 publishes, small and big
+c.publish("t", b"hi")
+print(b.sent())
+c.publish(b"t", b"x" * 200)
+tx = b.sent()
+print(tx[:6], len(tx))
+
+# QoS 1 publish stays in flight until its PUBACK
+b.feed(b"\x40\x02\x00\x01")
+print(c.publish("t", b"q", qos=1))
+print(b.sent())
+print(c.inflight())
+print(c.check_msg())
+print(c.inflight())
+print(c.check_msg())
+
+# subscribe, and messages to the general and the per-filter callbacks
+def cb(topic, msg):
+    print("cb", topic, bytes(msg))
+def cb_sensor(topic, msg):
+    print("sensor", topic, bytes(msg))
+c.set_callback(cb)
+b.feed(b"\x90\x03\x00\x02\x01")
+c.subscribe("sensor/+/temp", qos=1, cb=cb_sensor)
+print(b.sent())
+b.feed(
+    b"\x30\x07\x00\x03abcxy"
+    + b"\x32\x13\x00\x0dsensor/a/temp\x00\x07" + b"21"
+)
+c.wait_msg()
+c.wait_msg()
+print(b.sent())
+
+# refused subscription
+b.feed(b"\x90\x03\x00\x03\x80")
+try:
+    c.subscribe("x")
+except umqttc.MQTTException as e:
+    print("MQTTException", e.args[0])
+b.sent()
+
+# a message too big for the buffer is dropped but still acknowledged
+c3 = umqttc.MQTTClient("cid", "localhost", buf_size=20)
+b3 = Broker(CONNACK + b"\x32\x1a\x00\x01t\x00\x09" + b"z" * 21)
+c3.connect(sock=b3)
+b3.sent()
+c3.set_callback(cb)
+c3.wait_msg()
+print(b3.sent(), c3.inflight())
+
+# unsupported QoS, and a session resent after reconnecting
+try:
+    c.publish("t", b"", qos=2)
+except ValueError:
+    print("ValueError")
+b.feed(b"")
+c.publish("t", b"r", qos=1)
+b.sent()
+b.feed(b"\x20\x02\x01\x00")
+print(c.connect(clean_session=False, sock=b))
+print(b.sent()[-8:])
+c.disconnect()
+print(b.sent())
+
+# topic filters
+for f, t in (
+    ("a/b", "a/b"), ("a/b", "a/c"), ("a/+", "a/b"), ("a/+", "a/b/c"),
+    ("a/#", "a"), ("a/#", "a/b/c"), ("#", "a/b"), ("+/+", "a/b"),
+    ("+", "$SYS"), ("#", "$SYS/x"), ("$SYS/#", "$SYS/x"), ("a/+/c", "a//c"),
+    ("a", "a/b"), ("a/b", "a"),
+):
+    print(f, t, umqttc.topic_matches(f, t))
@@ -0,0 +1,39 @@
+try:
+    import urandom as random
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    random.fill
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# fill every length, including partial trailing words
+for n in range(10):
+    b = bytearray(n)
+    random.fill(b)
+    print(len(b))
+
+# the same seed gives the same bytes
+b1 = bytearray(17)
+b2 = bytearray(17)
+random.seed(5)
+random.fill(b1)
+random.seed(5)
+random.fill(b2)
+print(b1 == b2)
+print(b1 != bytearray(17))
+
+# a memoryview fills only its own slice
+b = bytearray(8)
+random.seed(3)
+random.fill(memoryview(b)[2:6])
+print(b[:2], b[6:])
+
+# the buffer must be writable
+try:
+    random.fill(b"1234")
+except TypeError:
+    print("TypeError")
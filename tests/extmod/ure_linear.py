@@ -0,0 +1,21 @@
+# test patterns that take exponential time with a backtracking matcher
+
+try:
+    import ure as re
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+# only a non-backtracking matcher can run these
+try:
+    re.match("(a*)*", "aaa")
+except RuntimeError:
+    print("SKIP")
+    raise SystemExit
+
+print(re.match("(a*)*", "aaa").group(0))
+print(re.match("(a|a)*c", "a" * 30 + "c").group(0))
+print(re.match("(a|a)*c", "a" * 30))
+print(re.search("(x+x+)+y", "x" * 30 + "y").group(0))
+print(re.search("(x+x+)+y", "x" * 30))
+print(len(re.search("b(a*)*$", "ab" + "a" * 1000).group(0)))
@@ -0,0 +1,44 @@
+# test that search finds the same match as a backtracking matcher
+
+try:
+    import ure as re
+except ImportError:
+    try:
+        import re
+    except ImportError:
+        print("SKIP")
+        raise SystemExit
+
+def test(r, s):
+    m = re.search(r, s)
+    if m is None:
+        print(None)
+    else:
+        print([m.group(i) for i in range(r.count("(") + 1)])
+
+# literal prefix
+test("abc", "xxabxabcxabc")
+test("ab+c", "abbxabbbc")
+test("abd", "abcabcab")
+test("aa", "a")
+test("abc", "")
+test("(ab)(c|d)", "xabxabdabc")
+
+# priority between alternatives and repeats
+test("a|ab", "xab")
+test("ab|a", "xab")
+test("a(b*)", "abbb")
+test("a(b*?)", "abbb")
+test("a(b*?)c", "abbbc")
+test("(a+)(a*)", "aaaa")
+test("(a+?)(a*)", "aaaa")
+test("(a*)b", "aaacaab")
+test("x(a|b)*y", "xabxababy")
+test("(a?)(a?)a", "aa")
+
+# anchors
+test("^ab", "abab")
+test("^ab", "xab")
+test("ab$", "ababab")
+test("(^a|b)c", "xbcac")
+test("a.*$", "xabcab")
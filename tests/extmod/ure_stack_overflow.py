@@ -11,3 +11,6 @@ try:
     re.match("(a*)*", "aaa")
 except RuntimeError:
     print("RuntimeError")
+else:
+    # the matcher doesn't backtrack, so doesn't recurse on the subject
+    print("SKIP")
@@ -0,0 +1,50 @@
+try:
+    import uzlib as zlib
+    import uio as io
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(zlib, "compress"):
+    print("SKIP")
+    raise SystemExit
+
+PATTERNS = [
+    b'',
+    b'0',
+    b'a' * 1000,
+    b'hello world ' * 50,
+    bytes(range(256)) * 4,
+    b''.join(b'{"seq": %d, "temp": 23.%d}\n' % (i, i % 10) for i in range(200)),
+]
+
+for data in PATTERNS:
+    c = zlib.compress(data)
+    print(len(data), len(c), zlib.decompress(c) == data)
+
+# raw deflate and gzip, with other window sizes (the 15 bit window, which
+# needs much more memory, is tested in uzlib_compress_wbits15.py)
+data = PATTERNS[-1]
+for wbits in (9, 12, -9, -12, 25, 28):
+    c = zlib.compress(data, wbits)
+    print(wbits, len(c), zlib.DecompIO(io.BytesIO(c), wbits).read() == data)
+
+# streaming gives the same output however the input is split
+f = io.BytesIO()
+with zlib.CompressIO(f, 12) as z:
+    for i in range(0, len(data), 100):
+        z.write(data[i:i + 100])
+print(f.getvalue() == zlib.compress(data, 12))
+
+# writing after close
+try:
+    z.write(b'x')
+except OSError:
+    print('OSError')
+
+# invalid window size
+for wbits in (8, 16, -8, 24, 32):
+    try:
+        zlib.compress(b'', wbits)
+    except ValueError:
+        print('ValueError')
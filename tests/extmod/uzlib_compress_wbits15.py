@@ -0,0 +1,23 @@
+# test uzlib compression with the largest window, which needs about 160k
+
+try:
+    import uzlib as zlib
+    import uio as io
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+if not hasattr(zlib, "compress"):
+    print("SKIP")
+    raise SystemExit
+
+try:
+    zlib.CompressIO(io.BytesIO(), 15).close()
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+data = b''.join(b'{"seq": %d, "temp": 23.%d}\n' % (i, i % 10) for i in range(200))
+for wbits in (15, -15, 31):
+    c = zlib.compress(data, wbits)
+    print(wbits, len(c), zlib.DecompIO(io.BytesIO(c), wbits).read() == data)
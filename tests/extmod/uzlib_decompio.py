@@ -31,3 +31,9 @@ try:
     print(inp.read())
 except OSError as e:
     print(repr(e))
+
+# reading the source in chunks
+for bufsize in (1, 2, 3, 100):
+    buf = io.BytesIO(b'x\x9c30\xa0=\x00\x00\xb3q\x12\xc1')
+    inp = zlib.DecompIO(buf, 0, bufsize)
+    print(inp.read(3), inp.read(), buf.seek(0, 1))
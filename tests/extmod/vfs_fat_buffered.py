@@ -0,0 +1,101 @@
+# test open(..., buffering=n) on a FAT filesystem
+
+try:
+    import uerrno
+    import uos
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uos.VfsFat
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMFS:
+
+    SEC_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.SEC_SIZE)
+        self.writes = 0
+
+    def readblocks(self, n, buf):
+        buf[:] = self.data[n * self.SEC_SIZE:n * self.SEC_SIZE + len(buf)]
+
+    def writeblocks(self, n, buf):
+        self.writes += 1
+        self.data[n * self.SEC_SIZE:n * self.SEC_SIZE + len(buf)] = buf
+
+    def ioctl(self, op, arg):
+        if op == 4:  # BP_IOCTL_SEC_COUNT
+            return len(self.data) // self.SEC_SIZE
+        if op == 5:  # BP_IOCTL_SEC_SIZE
+            return self.SEC_SIZE
+
+
+try:
+    bdev = RAMFS(80)
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+uos.VfsFat.mkfs(bdev)
+vfs = uos.VfsFat(bdev)
+uos.mount(vfs, "/ramdisk")
+uos.chdir("/ramdisk")
+
+rows = "".join("%d,%d,%d\n" % (i, i * 3, i * i) for i in range(300))
+
+
+def log(name, **kw):
+    bdev.writes = 0
+    with open(name, "w", **kw) as f:
+        for line in rows.splitlines(True):
+            f.write(line)
+    return bdev.writes
+
+
+unbuffered = log("a.csv")
+buffered = log("b.csv", buffering=4096)
+print(buffered < unbuffered)
+with open("a.csv") as f:
+    a = f.read()
+with open("b.csv") as f:
+    b = f.read()
+print(a == rows, b == rows)
+
+# reads, seeks and tells see the buffered data
+with open("c.bin", "w+b", buffering=1000) as f:
+    f.write(b"0123456789")
+    print(f.tell())
+    f.seek(0)
+    print(f.read(4))
+    f.write(b"ab")
+    f.seek(0, 2)
+    f.write(b"XYZ" * 400)
+    print(f.tell())
+    f.seek(8)
+    print(f.read(6))
+print(uos.stat("c.bin")[6])
+
+# flush makes the data visible to another file
+f = open("d.txt", "w", buffering=512)
+f.write("hello")
+with open("d.txt") as g:
+    print(repr(g.read()))
+f.flush()
+with open("d.txt") as g:
+    print(repr(g.read()))
+f.close()
+
+# the VFS method takes the buffer size as well
+with vfs.open("e.txt", "w", 2048) as f:
+    f.write("direct")
+with vfs.open("e.txt", "r") as f:
+    print(f.read())
+
+uos.chdir("/")
+uos.umount("/ramdisk")
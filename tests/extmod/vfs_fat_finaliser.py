@@ -0,0 +1,83 @@
+# Test that files left open are flushed by their finaliser when collected
+
+try:
+    import uos, gc
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uos.VfsFat
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMFS:
+
+    SEC_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(blocks * self.SEC_SIZE)
+
+    def readblocks(self, n, buf):
+        for i in range(len(buf)):
+            buf[i] = self.data[n * self.SEC_SIZE + i]
+
+    def writeblocks(self, n, buf):
+        for i in range(len(buf)):
+            self.data[n * self.SEC_SIZE + i] = buf[i]
+
+    def ioctl(self, op, arg):
+        if op == 4:  # MP_BLOCKDEV_IOCTL_BLOCK_COUNT
+            return len(self.data) // self.SEC_SIZE
+        if op == 5:  # MP_BLOCKDEV_IOCTL_BLOCK_SIZE
+            return self.SEC_SIZE
+
+
+try:
+    bdev = RAMFS(50)
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+uos.VfsFat.mkfs(bdev)
+vfs = uos.VfsFat(bdev)
+uos.mount(vfs, "/ramdisk")
+uos.chdir("/ramdisk")
+
+# every third file is kept open, the others are only reachable by the GC;
+# they're opened in a function, and its stack is then overwritten, so that
+# no stale references to them are left on the C stack when collecting
+def open_files(keep):
+    for i in range(10):
+        f = open("f%d" % i, "w")
+        f.write("x" * (i + 1))
+        if i % 3 == 0:
+            keep.append(f)
+
+
+def clear_stack(n):
+    a = b = c = d = None
+    if n:
+        clear_stack(n - 1)
+
+
+keep = []
+open_files(keep)
+clear_stack(10)
+gc.collect()
+gc.collect()
+
+for i in range(10):
+    with open("f%d" % i) as f:
+        print(i, len(f.read()))
+
+for f in keep:
+    f.close()
+for i in range(0, 10, 3):
+    with open("f%d" % i) as f:
+        print(i, len(f.read()))
+
+uos.chdir("/")
+uos.umount("/ramdisk")
@@ -0,0 +1,150 @@
+try:
+    import uerrno
+    import uos
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uos.VfsLog
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMFS:
+
+    SEC_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(b"\xff" * (blocks * self.SEC_SIZE))
+
+    def readblocks(self, n, buf):
+        for i in range(len(buf)):
+            buf[i] = self.data[n * self.SEC_SIZE + i]
+
+    def writeblocks(self, n, buf):
+        for i in range(len(buf)):
+            self.data[n * self.SEC_SIZE + i] = buf[i]
+
+    def ioctl(self, op, arg):
+        if op == 4:  # BP_IOCTL_SEC_COUNT
+            return len(self.data) // self.SEC_SIZE
+        if op == 5:  # BP_IOCTL_SEC_SIZE
+            return self.SEC_SIZE
+
+
+try:
+    bdev = RAMFS(16)
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+# not formatted yet
+vfs = uos.VfsLog(bdev)
+try:
+    vfs.mount(False, False)
+except OSError as e:
+    print(e.args[0] == uerrno.ENODEV)
+
+uos.VfsLog.mkfs(bdev)
+vfs = uos.VfsLog(bdev)
+uos.mount(vfs, "/ramdisk")
+print("getcwd:", vfs.getcwd())
+print(list(vfs.ilistdir()))
+
+with open("/ramdisk/foo.txt", "w") as f:
+    print(f.write("hello!"))
+with open("/ramdisk/foo.txt") as f:
+    print(f.read())
+with open("/ramdisk/foo.txt", "a") as f:
+    f.write(" world")
+with open("/ramdisk/foo.txt", "rb") as f:
+    print(f.read())
+print(vfs.stat("foo.txt")[:7])
+
+# seek and overwrite in the middle, and write past the end to leave a hole
+with open("/ramdisk/foo.txt", "r+b") as f:
+    f.seek(6)
+    f.write(b"W")
+    f.seek(14)
+    f.write(b"!")
+    print(f.tell())
+    f.seek(0)
+    print(f.read())
+
+try:
+    open("/ramdisk/foo.txt", "x")
+except OSError as e:
+    print(e.args[0] == uerrno.EEXIST)
+try:
+    open("/ramdisk/nofile.txt")
+except OSError as e:
+    print(e.args[0] == uerrno.ENOENT)
+
+vfs.mkdir("dir")
+try:
+    vfs.mkdir("dir")
+except OSError as e:
+    print(e.args[0] == uerrno.EEXIST)
+try:
+    open("/ramdisk/dir")
+except OSError as e:
+    print(e.args[0] == uerrno.EISDIR)
+
+vfs.chdir("dir")
+print("getcwd:", vfs.getcwd())
+with open("/ramdisk/dir/bar.txt", "w") as f:
+    f.write("in dir")
+print(list(vfs.ilistdir(".")))
+print(list(vfs.ilistdir(b"..")))
+vfs.chdir("/")
+
+try:
+    vfs.rmdir("dir")
+except OSError as e:
+    print(e.args[0] == uerrno.EACCES)
+try:
+    vfs.remove("dir")
+except OSError as e:
+    print(e.args[0] == uerrno.EISDIR)
+
+vfs.rename("dir/bar.txt", "baz.txt")
+vfs.rename("baz.txt", "foo.txt")
+with open("/ramdisk/foo.txt") as f:
+    print(f.read())
+vfs.rmdir("dir")
+try:
+    vfs.rename("foo.txt", "nodir/foo.txt")
+except OSError as e:
+    print(e.args[0] == uerrno.ENOENT)
+
+# a removed file can still be read from but gives nothing
+f = open("/ramdisk/foo.txt")
+vfs.remove("foo.txt")
+print(f.read())
+f.close()
+print(sorted(uos.listdir("/ramdisk")))
+
+# everything survives a remount
+with open("/ramdisk/keep.txt", "w") as f:
+    f.write("kept" * 100)
+vfs.mkdir("d2")
+with open("/ramdisk/d2/x", "w") as f:
+    f.write("x")
+uos.umount("/ramdisk")
+vfs = uos.VfsLog(bdev)
+uos.mount(vfs, "/ramdisk")
+print(sorted(uos.listdir("/ramdisk")), uos.listdir("/ramdisk/d2"))
+with open("/ramdisk/keep.txt") as f:
+    print(f.read() == "kept" * 100)
+
+# mounting autodetects the filesystem
+uos.umount("/ramdisk")
+uos.mount(bdev, "/ramdisk", readonly=True)
+print(uos.stat("/ramdisk/d2/x")[6])
+try:
+    open("/ramdisk/new", "w")
+except OSError as e:
+    print(e.args[0] == 30)  # EROFS
+uos.umount("/ramdisk")
@@ -0,0 +1,120 @@
+# test that VfsLog spreads writes over the device and survives torn writes
+
+try:
+    import uerrno
+    import uos
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+try:
+    uos.VfsLog
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+
+class RAMFS:
+
+    SEC_SIZE = 512
+
+    def __init__(self, blocks):
+        self.data = bytearray(b"\xff" * (blocks * self.SEC_SIZE))
+        self.writes = [0] * blocks
+        self.fail_after = -1
+
+    def readblocks(self, n, buf):
+        buf[:] = self.data[n * self.SEC_SIZE:n * self.SEC_SIZE + len(buf)]
+
+    def writeblocks(self, n, buf):
+        if self.fail_after == 0:
+            # lose power half way through the write
+            half = len(buf) // 2
+            self.data[n * self.SEC_SIZE:n * self.SEC_SIZE + half] = buf[:half]
+            raise OSError(uerrno.EIO)
+        self.fail_after -= 1
+        self.writes[n] += 1
+        self.data[n * self.SEC_SIZE:n * self.SEC_SIZE + len(buf)] = buf
+
+    def ioctl(self, op, arg):
+        if op == 4:  # BP_IOCTL_SEC_COUNT
+            return len(self.data) // self.SEC_SIZE
+        if op == 5:  # BP_IOCTL_SEC_SIZE
+            return self.SEC_SIZE
+
+
+try:
+    bdev = RAMFS(12)
+except MemoryError:
+    print("SKIP")
+    raise SystemExit
+
+uos.VfsLog.mkfs(bdev)
+vfs = uos.VfsLog(bdev)
+uos.mount(vfs, "/ramdisk")
+
+# keep appending rows to a log file and rewriting a small config file, much
+# more in total than the device holds
+for i in range(200):
+    with open("/ramdisk/data.csv", "a") as f:
+        f.write("%d,%d\n" % (i, i * i))
+    with open("/ramdisk/cfg", "w") as f:
+        f.write("n=%d" % i)
+    if i % 50 == 49:
+        # keep the data file from filling the device
+        vfs.remove("data.csv")
+
+print(vfs.info()[1] > 0)
+print(max(bdev.writes) - min(bdev.writes) <= 2 * min(bdev.writes))
+
+with open("/ramdisk/data.csv", "w") as f:
+    f.write("0123456789" * 50)
+uos.umount("/ramdisk")
+
+vfs = uos.VfsLog(bdev)
+uos.mount(vfs, "/ramdisk")
+print(sorted(uos.listdir("/ramdisk")))
+with open("/ramdisk/cfg") as f:
+    print(f.read())
+with open("/ramdisk/data.csv") as f:
+    print(f.read() == "0123456789" * 50)
+before = "0123456789" * 50 + "more"
+
+# a write torn by power loss loses only what was not yet synced
+f = open("/ramdisk/data.csv", "a")
+f.write("more")
+f.flush()
+f.write("X" * 600)
+bdev.fail_after = 0
+try:
+    f.close()
+except OSError as e:
+    print(e.args[0] == uerrno.EIO)
+bdev.fail_after = -1
+
+vfs = uos.VfsLog(bdev)
+uos.mount(vfs, "/ramdisk2")
+with open("/ramdisk2/data.csv") as f:
+    s = f.read()
+print(s[:len(before)] == before, s[len(before):] == "X" * (len(s) - len(before)))
+with open("/ramdisk2/cfg") as f:
+    print(f.read())
+
+# the filesystem can still be written after the torn block
+with open("/ramdisk2/cfg", "w") as f:
+    f.write("after")
+vfs = uos.VfsLog(bdev)
+with vfs.open("cfg", "r") as f:
+    print(f.read())
+
+# filling the device gives ENOSPC
+try:
+    with vfs.open("big", "w") as f:
+        for i in range(100):
+            f.write("z" * 100)
+except OSError as e:
+    print(e.args[0] == 28)  # ENOSPC
+vfs.remove("big")
+with vfs.open("small", "w") as f:
+    f.write("ok")
+print(sorted(vfs.ilistdir()))
@@ -34,6 +34,10 @@ print(ws_write(b"pong" * 32, 132))
 # mask (returned data will be 'mask' ^ 'mask')
 print(ws_read(b"\x81\x84maskmask", 4))
 
+# masked extended payload, read in pieces that don't line up with the mask
+ws = uwebsocket.websocket(uio.BytesIO(b'\x82\xfe\x00\x83mask' + bytes(b ^ b'mask'[i & 3] for i, b in enumerate(bytes(range(131))))))
+print(ws.read(3) + ws.read(65) + ws.read(63))
+
 # close control frame
 s = uio.BytesIO(b'\x88\x00') # FRAME_CLOSE
 ws = uwebsocket.websocket(s)
@@ -0,0 +1,36 @@
+# tests float constant folding in compiler
+
+# negation
+print(-1.5)
+print(-(-1.5))
+print(+2.5)
+
+# arithmetic with float and int operands
+print(1.5 + 2)
+print(2 - 0.5)
+print(3 * 0.25)
+print(1 / 4)
+print(7.5 // 2, 7.5 % 2)
+print(-7.5 // 2, -7.5 % 2)
+print(10 % 3.0)
+print(1 + 2 * 0.5 - 3 / 2)
+
+# division by zero must still raise at runtime
+try:
+    1.0 / 0
+except ZeroDivisionError:
+    print("ZeroDivisionError")
+try:
+    1 / 0
+except ZeroDivisionError:
+    print("ZeroDivisionError")
+try:
+    1.5 // 0.0
+except ZeroDivisionError:
+    print("ZeroDivisionError")
+
+# 1's complement of a float must still raise at runtime
+try:
+    ~1.5
+except TypeError:
+    print("TypeError")
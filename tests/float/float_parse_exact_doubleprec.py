@@ -0,0 +1,19 @@
+# test that parsing gives the correctly rounded double, requiring double-precision
+
+try:
+    try:
+        import ustruct as struct
+    except:
+        import struct
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+# values where scaling by inexact powers of 10 used to lose the last bit
+for s in ('1e23', '3.14159265358979323846', '2.2250738585072014e-308',
+        '0.1', '23.45', '123.456', '1.7976931348623157e308', '9007199254740993',
+        '1e22', '1.5e-10', '4.35', '-273.15', '1_000.125'):
+    print(s, struct.pack('<d', float(s)))
+
+# a zero mantissa stays zero whatever the exponent
+print(float('0e400'), float('-0e400'), float('0.000e-400'))
@@ -0,0 +1,56 @@
+# math functions batched over float arrays, and the 3-vector helpers
+try:
+    import math
+    from array import array
+    math.atan2_array
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+def show(a):
+    print(['%.4f' % v for v in a])
+
+y = array('f', [0.0, 1.0, -1.0, 1.0])
+x = array('f', [1.0, 0.0, 0.0, -1.0])
+out = array('f', [0] * 4)
+print(math.atan2_array(y, x, out) is out)
+show(out)
+math.hypot_array(x, y, out)
+show(out)
+d = array('d', [4.0, 2.0, 0.25, 0.0])
+math.sqrt_array(d, out)
+show(out)
+
+# in place, and mixing 'f' and 'd'
+math.sqrt_array(d, d)
+show(d)
+math.atan2_array(d, x, d)
+show(d)
+
+print(math.isnan(math.sqrt_array(array('f', [-1.0]), array('f', [0]))[0]))
+
+for args in ((y, x, array('f', [0] * 3)), (array('f', [0] * 3), x, out)):
+    try:
+        math.atan2_array(*args)
+    except ValueError:
+        print('ValueError')
+for args in ((array('i', [0] * 4), x, out), (y, x, bytearray(16)), (y, x, b'1234')):
+    try:
+        math.atan2_array(*args)
+    except TypeError:
+        print('TypeError')
+
+print('%.4f' % math.norm3((3, 4, 12)), '%.4f' % math.norm3([1, 2, 2.0]), '%.4f' % math.norm3(array('h', [2, -3, 6])))
+try:
+    math.norm3((1, 2))
+except ValueError:
+    print('ValueError')
+try:
+    math.norm3(array('f', [1, 2, 3, 4]))
+except ValueError:
+    print('ValueError')
+
+# tilt-compensated heading, as used by the compass
+for accel, mag in (((0, 0, 1), (1, 0, 0)), ((0, 0, 1), (-1, 0.5, 0)),
+                   ((0.1, -0.2, 0.97), (20, -13, 40)), ((0, 0, 1), (1, -1, 0))):
+    print('%.3f' % math.tilt_heading(accel, mag))
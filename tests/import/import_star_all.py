@@ -0,0 +1,7 @@
+# test "from module import *" importing only the names in __all__
+from pkg9.mod import *
+print(a, _c, d)
+try:
+    b
+except NameError:
+    print('NameError')
@@ -73,6 +73,24 @@ user_files = {
             b'\x00\x00\x00\x00\x00\x00\x00\x00' # dummy machine code
             b'\x00\x00\x00' # scope_flags, n_pos_args, type_sig
     ),
+
+    # test relocation of viper code, f() loads a word from its own data
+    '/mod2.mpy': (
+        b'M\x04\x0b\x1f\x20' # header
+
+        b'\x54' # n bytes, bytecode
+            b'\x01\x000\x00\x00\x00\x07\x07\x00S\x01\x00\x00\xff' # prelude
+            b'`\x00\x24\x02f\x11[' # MAKE_FUNCTION, STORE_NAME f, LOAD_CONST_NONE, RETURN_VALUE
+            b'\x00\x07\x0avf.py\x00\x01' # simple_name, source_file, n_obj, n_raw_code
+
+        b'\x62' # n bytes, viper code
+            b'\x48\xb8\x10\x00\x00\x00\x00\x00\x00\x00' # movabs rax, 16
+            b'\x48\x8b\x00' # mov rax, [rax]
+            b'\xc3\x00\x00' # ret, padding
+            b'\xab\x00\x00\x00\x00\x00\x00\x00' # small int 85
+            b'\x01\x0b' # n_qstr, relocation of the word at offset 2
+            b'\x00\x00\x00' # scope_flags, n_obj, n_raw_code
+    ),
 }
 
 # create and mount a user filesystem
@@ -88,6 +106,9 @@ for i in range(len(user_files)):
     except ValueError as er:
         print(mod, 'ValueError', er)
 
+import mod2
+print(mod2.f())
+
 # unmount and undo path addition
 uos.umount('/userfs')
 sys.path.pop()
@@ -0,0 +1,5 @@
+a = 1
+b = 2
+_c = 3
+d = 4
+__all__ = ['a', '_c', 'd']
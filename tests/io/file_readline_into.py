@@ -0,0 +1,38 @@
+# readline_into() is a MicroPython extension that reads a line into a buffer
+f = open("io/data/file1", "rb")
+if not hasattr(f, "readline_into"):
+    print("SKIP")
+    raise SystemExit
+
+b = bytearray(8)
+n = f.readline_into(b)
+print(n, b[:n])
+# a line longer than the buffer comes back in pieces
+n = f.readline_into(b, 3)
+print(n, b[:n])
+n = f.readline_into(b)
+print(n, b[:n])
+print(f.readline())
+n = f.readline_into(b)
+print(n, b[:n])
+# at EOF
+print(f.readline_into(b), f.readline())
+f.close()
+
+# lines read by readline() and readline_into() leave the file positioned
+# just after the newline
+f = open("io/data/file1", "rb")
+print(f.readline_into(bytearray(100)), f.tell(), f.read(4))
+
+try:
+    f.readline_into(b"")
+except TypeError:
+    print("TypeError")
+f.close()
+
+# readline() over many chunks
+f = open("io/data/bigfile1", "rb")
+lines = f.readlines()
+f.seek(0)
+print(b"".join(lines) == f.read(), len(lines), lines[-1])
+f.close()
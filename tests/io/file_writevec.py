@@ -0,0 +1,39 @@
+# writevec() is a MicroPython extension that writes a sequence of buffers
+try:
+    import uos as os
+except ImportError:
+    import os
+
+if not hasattr(os, "remove"):
+    print("SKIP")
+    raise SystemExit
+
+f = open("testfile", "wb")
+if not hasattr(f, "writevec"):
+    print("SKIP")
+    raise SystemExit
+
+print(f.writevec([b"head:", bytearray(b"body"), memoryview(b"--tail--")[2:6]]))
+print(f.writevec(()))
+print(f.writevec([b""] * 3 + [b"x"]))
+# more buffers than fit in one batch
+print(f.writevec([b"%d" % i for i in range(20)]))
+try:
+    f.writevec([b"ok", 1])
+except TypeError:
+    print("TypeError")
+f.close()
+
+f = open("testfile", "rb")
+print(f.read())
+f.close()
+
+# not open for writing
+f = open("testfile")
+try:
+    f.writevec([b"a"])
+except OSError:
+    print("OSError")
+f.close()
+
+os.remove("testfile")
@@ -0,0 +1,62 @@
+# test micropython.arena
+
+import micropython
+import gc
+
+try:
+    micropython.arena
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# temporaries made inside the arena
+def frame(n):
+    return sum([i * i for i in range(n)])
+
+a = micropython.arena(2048)
+for _ in range(10):
+    with a:
+        total = frame(20)
+print(total)
+
+# an object that escapes keeps the arena alive
+with micropython.arena(1024):
+    keep = [1, 2, 3]
+    keep.append("abc" * 2)
+    d = {"x": (4, 5)}
+gc.collect()
+for _ in range(20):
+    with micropython.arena(1024):
+        [0] * 50
+    gc.collect()
+print(keep, d)
+
+# allocations that don't fit come from the heap
+with micropython.arena(64):
+    big = bytearray(1000)
+    l = list(range(100))
+gc.collect()
+print(len(big), sum(l))
+
+# nested arenas
+with micropython.arena(512):
+    x = [1]
+    with micropython.arena(512):
+        y = [2]
+    x.append(3)
+gc.collect()
+print(x, y)
+
+# an arena can't be entered twice at once
+a = micropython.arena(256)
+with a:
+    try:
+        with a:
+            pass
+    except ValueError:
+        print("ValueError")
+
+try:
+    micropython.arena(0)
+except ValueError:
+    print("ValueError")
@@ -0,0 +1,31 @@
+# test gc.collect() with a time budget, which sweeps the heap in steps
+
+import gc
+
+try:
+    gc.collect(0)
+except TypeError:
+    print('SKIP')
+    raise SystemExit
+
+# a complete sweep in steps
+while not gc.collect(10):
+    pass
+
+# objects allocated while a sweep is pending must stay alive
+x = [bytearray(64) for i in range(100)]
+del x
+gc.collect(0)
+keep = [bytes([i]) * 20 for i in range(100)]
+while not gc.collect(10):
+    pass
+gc.collect()
+print(all(b == bytes([i]) * 20 for i, b in enumerate(keep)))
+
+# a sweep started by the allocation threshold
+gc.threshold(1000)
+for i in range(2000):
+    keep.append([i])
+gc.threshold(-1)
+gc.collect()
+print(all(keep[100 + i] == [i] for i in range(2000)))
@@ -0,0 +1,65 @@
+# test gc.mem_peak(), gc.mem_total() and gc.reset_peak()
+
+import gc
+
+try:
+    gc.mem_peak
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+# each part runs in a function, so that storing globals doesn't allocate
+# between the measurements; a few blocks of slack are allowed for the rest
+
+
+def test_reset():
+    gc.collect()
+    gc.reset_peak()
+    base = gc.mem_alloc()
+    peak = gc.mem_peak()
+    total = gc.mem_total()
+    print(total < 128)
+    print(base <= peak < base + 128)
+
+
+# a temporary allocation raises the peak and the total, and the peak stays
+# after a collection
+def test_temporary():
+    gc.collect()
+    gc.reset_peak()
+    base = gc.mem_alloc()
+    b = bytearray(4000)
+    print(gc.mem_peak() >= base + 4000)
+    print(gc.mem_total() >= 4000)
+    b = None
+    gc.collect()
+    print(gc.mem_peak() >= base + 4000)
+
+
+# the total counts every allocation, the peak only what was live at once (a
+# stale reference on the C stack may keep one of the buffers alive)
+def test_total():
+    gc.collect()
+    gc.reset_peak()
+    base = gc.mem_alloc()
+    for i in range(10):
+        b = bytearray(1000)
+        b = None
+        gc.collect()
+    print(gc.mem_total() >= 10000)
+    print(gc.mem_peak() < base + 2 * 1000 + 512)
+
+
+# the count of blocks in use agrees with a scan of the heap
+def test_scan():
+    gc.collect()
+    gc.reset_peak()
+    peak = gc.mem_peak()
+    alloc = gc.mem_alloc()
+    print(alloc <= peak < alloc + 128)
+
+
+test_reset()
+test_temporary()
+test_total()
+test_scan()
@@ -0,0 +1,23 @@
+# test the allocation profiler and heap snapshot
+
+import gc
+
+try:
+    gc.profile
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+def f():
+    return [bytearray(10) for i in range(20)]
+
+gc.profile(True)
+x = f()
+sites = [p for p in gc.profile() if p[2] == '<listcomp>']
+print(sum(p[3] for p in sites) >= 20)
+print(sum(p[4] for p in sites) >= 200)
+print(gc.profile(True)[-1][0])
+print(len(gc.profile()))
+
+s = gc.snapshot()
+print(s[:5])
@@ -0,0 +1,53 @@
+# Test that StopIteration and EAGAIN raised from C use preallocated
+# instances, so they can be raised and caught without memory allocation.
+import micropython, sys
+
+try:
+    import usocket as socket, uerrno as errno
+except ImportError:
+    print("SKIP")
+    raise SystemExit
+
+def gen():
+    yield 1
+
+def stop_iteration():
+    it = iter(())
+    g = gen()
+    next(g)
+    funcs = (lambda: next(it), lambda: g.send(None))
+    micropython.heap_lock()
+    for f in funcs:
+        try:
+            f()
+        except StopIteration as e:
+            print('StopIteration', e.args)
+    micropython.heap_unlock()
+
+def eagain():
+    s = socket.socket()
+    s.bind(socket.getaddrinfo('127.0.0.1', 0)[0][-1])
+    s.listen(1)
+    s.setblocking(False)
+    micropython.heap_lock()
+    for i in range(3):
+        try:
+            s.accept()
+        except OSError as e:
+            print('OSError', e.args[0] == errno.EAGAIN)
+    micropython.heap_unlock()
+    s.close()
+
+stop_iteration()
+eagain()
+
+# the same instance is raised each time and it has no traceback
+exc = []
+for i in range(2):
+    try:
+        next(iter(()))
+    except StopIteration as e:
+        exc.append(e)
+print(exc[0] is exc[1])
+exc[0].__traceback__ = None
+sys.print_exception(exc[0])
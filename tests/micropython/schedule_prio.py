@@ -0,0 +1,62 @@
+# test micropython.schedule() priorities and micropython.sched_stats()
+
+import micropython
+
+try:
+    micropython.sched_stats
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+# Callbacks run in the order they were scheduled, high priority ones first.
+# They are scheduled from within a callback so the scheduler is locked.
+
+def cb(arg):
+    order.append(arg)
+
+def outer(arg):
+    global done
+    micropython.schedule(cb, 1)
+    micropython.schedule(cb, 2)
+    micropython.schedule(cb, 'high', True)
+    micropython.schedule(cb, 3)
+    done = True
+
+micropython.sched_stats(True)
+order = []
+done = False
+micropython.schedule(outer, None)
+while len(order) < 4:
+    pass
+print(order)
+
+max_len, stats = micropython.sched_stats()
+print(max_len >= 4)
+for func, scheduled, dropped in stats:
+    if func is cb:
+        print('cb', scheduled, dropped)
+    elif func is outer:
+        print('outer', scheduled, dropped)
+
+# A full queue counts the callback as dropped
+def fill(arg):
+    global done
+    try:
+        for i in range(100):
+            micropython.schedule(cb, None)
+    except RuntimeError:
+        print('RuntimeError')
+    done = True
+
+micropython.sched_stats(True)
+order = []
+done = False
+micropython.schedule(fill, None)
+while not done:
+    pass
+for i in range(100):
+    pass
+for func, scheduled, dropped in micropython.sched_stats(True)[1]:
+    if func is cb:
+        print('cb', dropped)
+print(micropython.sched_stats())
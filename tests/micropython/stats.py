@@ -0,0 +1,46 @@
+# test micropython.stats()
+
+import micropython
+
+try:
+    micropython.stats
+except AttributeError:
+    print('SKIP')
+    raise SystemExit
+
+import gc
+
+micropython.stats(True)
+s = micropython.stats()
+print(s['gc_collections'], s['gc_pause_us'])
+
+# allocations are counted
+l = [bytearray(100) for i in range(10)]
+s = micropython.stats()
+print(s['alloc_count'] >= 10, s['alloc_bytes'] >= 1000)
+
+# collections and their pause time are counted
+gc.collect()
+gc.collect()
+s = micropython.stats(True)
+print(s['gc_collections'], s['gc_pause_us'] >= s['gc_pause_max_us'] >= 0)
+
+# the counters start again after a reset
+s = micropython.stats()
+print(s['gc_collections'], s['gc_pause_max_us'])
+
+# bytecodes are counted if the VM was built to
+if 'bytecodes' in s:
+    for i in range(100):
+        pass
+    print(micropython.stats()['bytecodes'] > 100)
+else:
+    print(True)
+
+# the scheduler counters, where there is one
+if hasattr(micropython, 'schedule'):
+    micropython.schedule(lambda x: None, None)
+    s = micropython.stats()
+    print(s['sched_max_depth'] >= 1, s['sched_dropped'], s['sched_latency_max_us'] >= 0)
+else:
+    print(True, 0, True)
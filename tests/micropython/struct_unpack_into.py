@@ -0,0 +1,19 @@
+# test unpacking a struct.Struct into an existing list
+
+try:
+    import ustruct as struct
+    struct.Struct
+except (ImportError, AttributeError):
+    print("SKIP")
+    raise SystemExit
+
+s = struct.Struct('<hB2s')
+l = [None] * 3
+print(s.unpack_from(b'\x01\x00\x02ab', 0, l) is l, l)
+print(s.unpack_from(b'\x00\x03\x00\x04cd', 1, l) is l, l)
+
+# the list must be the right length
+try:
+    s.unpack_from(b'\x01\x00\x02ab', 0, [])
+except ValueError:
+    print('ValueError')
@@ -0,0 +1,49 @@
+# test functions being made native after a number of calls
+
+import micropython
+
+try:
+    micropython.tier_native
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+def fib(n):
+    a, b = 0, 1
+    for i in range(n):
+        a, b = b, a + b
+    return a
+
+def args(a, b=2, *c, **d):
+    return a, b, c, sorted(d)
+
+class A:
+    def m(self, x):
+        return [x * i for i in range(3)]
+
+def outer(y):
+    def inner(x):
+        return x + y
+    return inner
+
+def raises(x):
+    try:
+        return 1 // x
+    except ZeroDivisionError:
+        return 'div'
+
+micropython.tier_native(5)
+print(micropython.tier_native()[0])
+
+a = A()
+inner = outer(10)
+for i in range(10):
+    r = (fib(20), args(i), args(1, 2, 3, x=4), a.m(i), inner(i), raises(i % 2))
+    print(r)
+
+# the hot functions used some of the native code budget
+print(micropython.tier_native()[1] < 16384)
+
+# turn it off again
+micropython.tier_native(0)
+print(micropython.tier_native()[0])
@@ -0,0 +1,48 @@
+# test loading from and storing to ptrf32 type
+
+try:
+    import array
+    array.array('f')
+except (ImportError, ValueError):
+    print("SKIP")
+    raise SystemExit
+
+@micropython.viper
+def get(src:ptrf32):
+    return src[0], src[1]
+
+@micropython.viper
+def sum(src:ptrf32, n:int):
+    s = 0.0
+    for i in range(n):
+        s += src[i]
+    return s
+
+@micropython.viper
+def set1(dest:ptrf32, val):
+    dest[1] = val
+
+@micropython.viper
+def ramp(dest_in):
+    dest = ptrf32(dest_in)
+    n = int(len(dest_in))
+    for i in range(n):
+        dest[i] = i
+
+@micropython.viper
+def scale(buf:ptrf32, n:int, k):
+    for i in range(n):
+        buf[i] = buf[i] * k
+
+a = array.array('f', [1.5, -2, 3, 0.25])
+print(get(a))
+print(sum(a, 4))
+
+set1(a, 10)
+print(a)
+
+ramp(a)
+print(a)
+
+scale(a, 4, 0.5)
+print(a)
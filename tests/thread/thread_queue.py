@@ -0,0 +1,72 @@
+# test _thread.Queue, a fixed size queue of byte strings
+
+import _thread
+
+try:
+    _thread.Queue
+except AttributeError:
+    print("SKIP")
+    raise SystemExit
+
+# basic use, items are copied in and out
+q = _thread.Queue(3, 4)
+print(len(q), bool(q))
+buf = bytearray(b'ab')
+print(q.put(buf), q.put(b'1234'), q.put(b''))
+buf[0] = ord('x')
+print(q.put(b'more'))
+print(len(q), bool(q))
+print(q.get(), q.get(), q.get())
+
+# empty queue with a zero and a short timeout
+print(q.get(0), q.get(10))
+
+# get_into returns the length
+q.put(b'xyz')
+b = bytearray(4)
+print(q.get_into(b), b)
+print(q.get_into(b, 0))
+
+# errors
+for args in ((0, 4), (2, -1)):
+    try:
+        _thread.Queue(*args)
+    except ValueError:
+        print('ValueError')
+try:
+    q.put(b'12345')
+except ValueError as er:
+    print('ValueError', er)
+try:
+    q.get_into(bytearray(3))
+except ValueError as er:
+    print('ValueError', er)
+
+# several producer threads handing items to this one
+n_thread = 4
+n_item = 50
+q = _thread.Queue(8, 2)
+lock = _thread.allocate_lock()
+n_done = 0
+
+def producer(tid):
+    global n_done
+    for i in range(n_item):
+        while not q.put(bytes((tid, i))):
+            pass
+    with lock:
+        n_done += 1
+
+for tid in range(n_thread):
+    _thread.start_new_thread(producer, (tid,))
+
+last = [-1] * n_thread
+total = 0
+while total < n_thread * n_item:
+    tid, i = q.get(1000)
+    # each producer's items arrive in order
+    if i != last[tid] + 1:
+        print('out of order', tid, i)
+    last[tid] = i
+    total += 1
+print(total, last)
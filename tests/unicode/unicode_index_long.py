@@ -0,0 +1,26 @@
+# test indexing and slicing of long unicode strings
+
+s = 'aβc日本語' * 20 + 'end'
+n = len(s)
+print(n, len(s))
+print(''.join(s[i] for i in range(n)) == s, ''.join(s[-i] for i in range(n, 0, -1)) == s)
+print(s[0], s[5], s[31], s[32], s[33], s[63], s[64], s[-1], s[-3], s[-n])
+print(s[30:40], s[-5:], s[:3], s[100:200] == s[100:], s[n:], s[-1000:2])
+for i in (n, -n - 1):
+    try:
+        s[i]
+    except IndexError:
+        print('IndexError')
+
+# all ASCII
+a = 'x' * 40 + 'yz'
+print(len(a), a[40], a[-1], a[38:], a[50:])
+
+# a slice of a long string
+t = s[7:90]
+print(len(t), t[0], t[40], t[-1])
+
+# several strings indexed in turn
+l = [c * 40 + str(i) for i, c in enumerate('日本語αβγδε')]
+for _ in range(2):
+    print(' '.join(x[40] + x[3] for x in l))
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""
+Print a histogram of the objects in a heap snapshot made by gc.snapshot()
+(in a build with MICROPY_GC_PROFILE), for example after
+
+    open('heap.bin', 'wb').write(gc.snapshot())
+
+on the board and copying heap.bin to the host.  Chunks that don't start
+with a type the board recognised (buffers, arrays of items, bytecode, ...)
+are listed as <data>.
+"""
+
+from __future__ import print_function
+
+import argparse
+import struct
+import sys
+
+
+def parse(data):
+    if data[:4] != b'MPHS':
+        raise ValueError('not a heap snapshot')
+    version, _, bytes_per_block, n_types = struct.unpack_from('<BBHB', data, 4)
+    if version != 1:
+        raise ValueError('unsupported snapshot version %d' % version)
+    pos = 9
+    names = ['<data>']
+    for _ in range(n_types):
+        n = data[pos]
+        names.append(data[pos + 1:pos + 1 + n].decode('utf-8', 'replace'))
+        pos += 1 + n
+    chunks = []
+    while pos < len(data):
+        t = data[pos]
+        pos += 1
+        n_blocks = shift = 0
+        while True:
+            b = data[pos]
+            pos += 1
+            n_blocks |= (b & 0x7f) << shift
+            shift += 7
+            if not b & 0x80:
+                break
+        name = names[t] if t < len(names) else '<other type>'
+        chunks.append((name, n_blocks))
+    return bytes_per_block, chunks
+
+
+def main():
+    cmd = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    cmd.add_argument('-n', '--top', type=int, default=0, help='only show the N largest types')
+    cmd.add_argument('file')
+    args = cmd.parse_args()
+
+    with open(args.file, 'rb') as f:
+        bytes_per_block, chunks = parse(f.read())
+
+    hist = {}
+    for name, n_blocks in chunks:
+        count, blocks = hist.get(name, (0, 0))
+        hist[name] = (count + 1, blocks + n_blocks)
+    rows = sorted(hist.items(), key=lambda x: -x[1][1])
+    if args.top:
+        rows = rows[:args.top]
+
+    total = sum(n for _, n in chunks) * bytes_per_block
+    print('%-24s %8s %10s %6s' % ('type', 'count', 'bytes', '%'))
+    for name, (count, blocks) in rows:
+        size = blocks * bytes_per_block
+        print('%-24s %8d %10d %5.1f%%' % (name, count, size, 100.0 * size / max(total, 1)))
+    print('%-24s %8d %10d' % ('total', len(chunks), total))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,107 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""
+Print where a board (in a build with MICROPY_PROF_SAMPLES) spends its time,
+per function and per line, from the samples of its sampling profiler.
+
+    mpprof.py -d /dev/ttyUSB0 script.py   run script.py with the profiler on
+    mpprof.py -d /dev/ttyUSB0             read the samples an application
+                                           took after esp32.prof_start()
+    mpprof.py prof.txt                    read samples saved on the board with
+                                           open('prof.txt', 'w').write(repr(micropython.profile()))
+
+The board only keeps the last MICROPY_PROF_SAMPLES samples.
+"""
+
+from __future__ import print_function
+
+import argparse
+import ast
+import sys
+
+import pyboard
+
+
+def collect(args):
+    pyb = pyboard.Pyboard(args.device, args.baudrate)
+    pyb.enter_raw_repl()
+    try:
+        if args.script is not None:
+            with open(args.script, 'rb') as f:
+                script = f.read()
+            pyb.exec_('import esp32\nesp32.prof_start(%d)' % args.period)
+            try:
+                ret, ret_err = pyb.exec_raw(script, timeout=None, data_consumer=pyboard.stdout_write_bytes)
+            finally:
+                pyb.exec_('esp32.prof_stop()')
+            if ret_err:
+                pyboard.stdout_write_bytes(ret_err)
+        samples = pyb.exec_('import micropython\nprint(repr(micropython.profile()))')
+    finally:
+        pyb.exit_raw_repl()
+        pyb.close()
+    return ast.literal_eval(samples.decode())
+
+
+def main():
+    cmd = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    cmd.add_argument('-d', '--device', help='serial port of the board')
+    cmd.add_argument('-b', '--baudrate', type=int, default=115200)
+    cmd.add_argument('-p', '--period', type=int, default=1000, help='sample period in us')
+    cmd.add_argument('-n', '--top', type=int, default=20, help='only show the N busiest lines')
+    cmd.add_argument('script', nargs='?', help='script to run, or samples saved on the board')
+    args = cmd.parse_args()
+
+    if args.device is not None:
+        samples = collect(args)
+    elif args.script is not None:
+        with open(args.script) as f:
+            samples = ast.literal_eval(f.read())
+    else:
+        cmd.error('need a device or a file of samples')
+
+    total = sum(s[3] for s in samples)
+    if total == 0:
+        print('no samples')
+        return
+
+    funcs = {}
+    for file, line, func, count in samples:
+        funcs[(file, func)] = funcs.get((file, func), 0) + count
+    print('%8s %6s  %s' % ('samples', '%', 'function'))
+    for (file, func), count in sorted(funcs.items(), key=lambda x: -x[1]):
+        name = '%s:%s' % (file, func) if file is not None else '<outside bytecode>'
+        print('%8d %5.1f%%  %s' % (count, 100.0 * count / total, name))
+
+    print()
+    print('%8s %6s  %s' % ('samples', '%', 'line'))
+    lines = sorted((s for s in samples if s[0] is not None), key=lambda s: -s[3])
+    for file, line, func, count in lines[:args.top]:
+        print('%8d %5.1f%%  %s:%d (%s)' % (count, 100.0 * count / total, file, line, func))
+    print('%8d samples' % total)
+
+
+if __name__ == '__main__':
+    main()
@@ -41,8 +41,12 @@ else:
     is_int_type = lambda o: type(o) is int
 # end compatibility code
 
+# Whether an int fits a small int on every object representation
+is_small_int = lambda o: -(1 << 30) <= o < (1 << 30)
+
 import sys
 import struct
+import zlib
 from collections import namedtuple
 
 sys.path.append(sys.path[0] + '/../py')
@@ -117,6 +121,18 @@ MP_BC_LOAD_NAME = 0x1b
 MP_BC_LOAD_GLOBAL = 0x1c
 MP_BC_LOAD_ATTR = 0x1d
 MP_BC_STORE_ATTR = 0x26
+# used by the bytecode optimiser:
+MP_BC_JUMP = 0x35
+MP_BC_POP_JUMP_IF_TRUE = 0x36
+MP_BC_POP_JUMP_IF_FALSE = 0x37
+MP_BC_JUMP_IF_TRUE_OR_POP = 0x38
+MP_BC_JUMP_IF_FALSE_OR_POP = 0x39
+MP_BC_COMPARE_POP_JUMP_IF_TRUE = 0x3a
+MP_BC_COMPARE_POP_JUMP_IF_FALSE = 0x3b
+MP_BC_UNWIND_JUMP = 0x46
+MP_BC_RETURN_VALUE = 0x5b
+MP_BC_BINARY_OP_MULTI = 0xd7
+MP_BINARY_OP_IS = 7
 
 def make_opcode_format():
     def OC4(a, b, c, d):
@@ -142,7 +158,7 @@ def make_opcode_format():
     OC4(U, U, U, U), # 0x2c-0x2f
     OC4(B, B, B, B), # 0x30-0x33
     OC4(B, O, O, O), # 0x34-0x37
-    OC4(O, O, U, U), # 0x38-0x3b
+    OC4(O, O, O, O), # 0x38-0x3b
     OC4(U, O, B, O), # 0x3c-0x3f
     OC4(O, B, B, O), # 0x40-0x43
     OC4(O, U, O, B), # 0x44-0x47
@@ -218,6 +234,8 @@ def mp_opcode_format(bytecode, ip, count_var_uint, opcode_format=make_opcode_for
             opcode == MP_BC_RAISE_VARARGS
             or opcode == MP_BC_MAKE_CLOSURE
             or opcode == MP_BC_MAKE_CLOSURE_DEFARGS
+            or opcode == MP_BC_COMPARE_POP_JUMP_IF_TRUE
+            or opcode == MP_BC_COMPARE_POP_JUMP_IF_FALSE
         )
         ip += 1
         if f == MP_OPCODE_VAR_UINT:
@@ -240,6 +258,21 @@ def decode_uint(bytecode, ip):
             break
     return ip, unum
 
+def encode_uint(val):
+    # same encoding as mp_encode_uint: 7 bits per byte, most significant first
+    buf = bytearray([val & 0x7f])
+    val >>= 7
+    while val:
+        buf.insert(0, 0x80 | (val & 0x7f))
+        val >>= 7
+    return buf
+
+def const_obj_key(obj):
+    # identifies a constant by type and value, so 1 and 1.0, or 0.0 and -0.0, stay apart
+    if type(obj) is tuple:
+        return (tuple, tuple(const_obj_key(o) for o in obj))
+    return (type(obj), repr(obj))
+
 def extract_prelude(bytecode, ip):
     ip, n_state = decode_uint(bytecode, ip)
     ip, n_exc_stack = decode_uint(bytecode, ip)
@@ -263,6 +296,11 @@ class RawCode:
     # a set of all escaped names, to make sure they are unique
     escaped_names = set()
 
+    # constant objects and tables already emitted, by value, so that
+    # identical ones can be shared between all raw codes when optimising
+    shared_objs = {}
+    shared_const_tables = {}
+
     # convert code kind number to string
     code_kind_str = {
        MP_CODE_BYTECODE: 'MP_CODE_BYTECODE',
@@ -314,83 +352,127 @@ class RawCode:
         for rc in self.raw_codes:
             rc.freeze(self.escaped_name + '_')
 
+    def freeze_constant_obj(self, obj_name, obj):
+        if (config.optimise and obj is not MPFunTable and obj is not Ellipsis
+            and not (is_int_type(obj) and is_small_int(obj))):
+            key = const_obj_key(obj)
+            if key in RawCode.shared_objs:
+                print('#define %s %s' % (obj_name, RawCode.shared_objs[key]))
+                return
+            RawCode.shared_objs[key] = obj_name
+
+        if obj is MPFunTable:
+            pass
+        elif obj is Ellipsis:
+            print('#define %s mp_const_ellipsis_obj' % obj_name)
+        elif is_str_type(obj) or is_bytes_type(obj):
+            if is_str_type(obj):
+                obj = bytes_cons(obj, 'utf8')
+                obj_type = 'mp_type_str'
+            else:
+                obj_type = 'mp_type_bytes'
+            print('STATIC const mp_obj_str_t %s = {{&%s}, %u, %u, (const byte*)"%s"};'
+                % (obj_name, obj_type, qstrutil.compute_hash(obj, config.MICROPY_QSTR_BYTES_IN_HASH),
+                    len(obj), ''.join(('\\x%02x' % b) for b in obj)))
+        elif is_int_type(obj):
+            if is_small_int(obj):
+                # only tuple items can be small, and they go in as MP_ROM_INT
+                pass
+            elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_NONE:
+                # TODO check if we can actually fit this long-int into a small-int
+                raise FreezeError(self, 'target does not support long int')
+            elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_LONGLONG:
+                # TODO
+                raise FreezeError(self, 'freezing int to long-long is not implemented')
+            elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_MPZ:
+                neg = 0
+                if obj < 0:
+                    obj = -obj
+                    neg = 1
+                bits_per_dig = config.MPZ_DIG_SIZE
+                digs = []
+                z = obj
+                while z:
+                    digs.append(z & ((1 << bits_per_dig) - 1))
+                    z >>= bits_per_dig
+                ndigs = len(digs)
+                digs = ','.join(('%#x' % d) for d in digs)
+                print('STATIC const mp_obj_int_t %s = {{&mp_type_int}, '
+                    '{.neg=%u, .fixed_dig=1, .alloc=%u, .len=%u, .dig=(uint%u_t*)(const uint%u_t[]){%s}}};'
+                    % (obj_name, neg, ndigs, ndigs, bits_per_dig, bits_per_dig, digs))
+        elif type(obj) is float:
+            print('#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B')
+            print('STATIC const mp_obj_float_t %s = {{&mp_type_float}, %.16g};'
+                % (obj_name, obj))
+            print('#endif')
+        elif type(obj) is complex:
+            print('STATIC const mp_obj_complex_t %s = {{&mp_type_complex}, %.16g, %.16g};'
+                % (obj_name, obj.real, obj.imag))
+        elif type(obj) is tuple:
+            # the items are frozen first, then the tuple refers to them
+            for i, item in enumerate(obj):
+                self.freeze_constant_obj('%s_%u' % (obj_name, i), item)
+            print('STATIC const mp_rom_obj_tuple_t %s = {{&mp_type_tuple}, %u, {'
+                % (obj_name, len(obj)))
+            for i, item in enumerate(obj):
+                self.print_rom_obj('%s_%u' % (obj_name, i), item)
+            print('}};')
+        else:
+            raise FreezeError(self, 'freezing of object %r is not implemented' % (obj,))
+
+    def print_rom_obj(self, obj_name, obj):
+        for line in self.rom_obj_entry(obj_name, obj):
+            print(line)
+
+    def rom_obj_entry(self, obj_name, obj):
+        if obj is MPFunTable:
+            return ['    mp_fun_table,']
+        elif type(obj) is float:
+            n_c = struct.unpack('<I', struct.pack('<f', obj))[0]
+            n_c = ((n_c & ~0x3) | 2) + 0x80800000
+            n_d = struct.unpack('<Q', struct.pack('<d', obj))[0]
+            n_d += 0x8004000000000000
+            return [
+                '#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B',
+                '    MP_ROM_PTR(&%s),' % obj_name,
+                '#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C',
+                '    (mp_rom_obj_t)(0x%08x),' % (n_c,),
+                '#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D',
+                '    (mp_rom_obj_t)(0x%016x),' % (n_d,),
+                '#endif',
+            ]
+        elif is_int_type(obj) and is_small_int(obj):
+            return ['    MP_ROM_INT(%d),' % obj]
+        else:
+            return ['    MP_ROM_PTR(&%s),' % obj_name]
+
     def freeze_constants(self):
         # generate constant objects
         for i, obj in enumerate(self.objs):
-            obj_name = 'const_obj_%s_%u' % (self.escaped_name, i)
-            if obj is MPFunTable:
-                pass
-            elif obj is Ellipsis:
-                print('#define %s mp_const_ellipsis_obj' % obj_name)
-            elif is_str_type(obj) or is_bytes_type(obj):
-                if is_str_type(obj):
-                    obj = bytes_cons(obj, 'utf8')
-                    obj_type = 'mp_type_str'
-                else:
-                    obj_type = 'mp_type_bytes'
-                print('STATIC const mp_obj_str_t %s = {{&%s}, %u, %u, (const byte*)"%s"};'
-                    % (obj_name, obj_type, qstrutil.compute_hash(obj, config.MICROPY_QSTR_BYTES_IN_HASH),
-                        len(obj), ''.join(('\\x%02x' % b) for b in obj)))
-            elif is_int_type(obj):
-                if config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_NONE:
-                    # TODO check if we can actually fit this long-int into a small-int
-                    raise FreezeError(self, 'target does not support long int')
-                elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_LONGLONG:
-                    # TODO
-                    raise FreezeError(self, 'freezing int to long-long is not implemented')
-                elif config.MICROPY_LONGINT_IMPL == config.MICROPY_LONGINT_IMPL_MPZ:
-                    neg = 0
-                    if obj < 0:
-                        obj = -obj
-                        neg = 1
-                    bits_per_dig = config.MPZ_DIG_SIZE
-                    digs = []
-                    z = obj
-                    while z:
-                        digs.append(z & ((1 << bits_per_dig) - 1))
-                        z >>= bits_per_dig
-                    ndigs = len(digs)
-                    digs = ','.join(('%#x' % d) for d in digs)
-                    print('STATIC const mp_obj_int_t %s = {{&mp_type_int}, '
-                        '{.neg=%u, .fixed_dig=1, .alloc=%u, .len=%u, .dig=(uint%u_t*)(const uint%u_t[]){%s}}};'
-                        % (obj_name, neg, ndigs, ndigs, bits_per_dig, bits_per_dig, digs))
-            elif type(obj) is float:
-                print('#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B')
-                print('STATIC const mp_obj_float_t %s = {{&mp_type_float}, %.16g};'
-                    % (obj_name, obj))
-                print('#endif')
-            elif type(obj) is complex:
-                print('STATIC const mp_obj_complex_t %s = {{&mp_type_complex}, %.16g, %.16g};'
-                    % (obj_name, obj.real, obj.imag))
-            else:
-                raise FreezeError(self, 'freezing of object %r is not implemented' % (obj,))
+            self.freeze_constant_obj('const_obj_%s_%u' % (self.escaped_name, i), obj)
 
         # generate constant table, if it has any entries
         const_table_len = len(self.qstrs) + len(self.objs) + len(self.raw_codes)
         if const_table_len:
-            print('STATIC const mp_rom_obj_t const_table_data_%s[%u] = {'
-                % (self.escaped_name, const_table_len))
-            for qst in self.qstrs:
-                print('    MP_ROM_QSTR(%s),' % global_qstrs[qst].qstr_id)
-            for i in range(len(self.objs)):
-                if self.objs[i] is MPFunTable:
-                    print('    mp_fun_table,')
-                elif type(self.objs[i]) is float:
-                    print('#if MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_A || MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_B')
-                    print('    MP_ROM_PTR(&const_obj_%s_%u),' % (self.escaped_name, i))
-                    print('#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_C')
-                    n = struct.unpack('<I', struct.pack('<f', self.objs[i]))[0]
-                    n = ((n & ~0x3) | 2) + 0x80800000
-                    print('    (mp_rom_obj_t)(0x%08x),' % (n,))
-                    print('#elif MICROPY_OBJ_REPR == MICROPY_OBJ_REPR_D')
-                    n = struct.unpack('<Q', struct.pack('<d', self.objs[i]))[0]
-                    n += 0x8004000000000000
-                    print('    (mp_rom_obj_t)(0x%016x),' % (n,))
-                    print('#endif')
-                else:
-                    print('    MP_ROM_PTR(&const_obj_%s_%u),' % (self.escaped_name, i))
+            table = ['    MP_ROM_QSTR(%s),' % global_qstrs[qst].qstr_id for qst in self.qstrs]
+            for i, obj in enumerate(self.objs):
+                obj_name = 'const_obj_%s_%u' % (self.escaped_name, i)
+                if config.optimise and obj is not MPFunTable and obj is not Ellipsis:
+                    # refer to a shared object by its own name so equal tables compare equal
+                    obj_name = RawCode.shared_objs.get(const_obj_key(obj), obj_name)
+                table.extend(self.rom_obj_entry(obj_name, obj))
             for rc in self.raw_codes:
-                print('    MP_ROM_PTR(&raw_code_%s),' % rc.escaped_name)
+                table.append('    MP_ROM_PTR(&raw_code_%s),' % rc.escaped_name)
+            table_name = 'const_table_data_%s' % self.escaped_name
+            if config.optimise:
+                key = tuple(table)
+                if key in RawCode.shared_const_tables:
+                    print('#define %s %s' % (table_name, RawCode.shared_const_tables[key]))
+                    return
+                RawCode.shared_const_tables[key] = table_name
+            print('STATIC const mp_rom_obj_t %s[%u] = {' % (table_name, const_table_len))
+            for line in table:
+                print(line)
             print('};')
 
     def freeze_module(self, qstr_links=(), type_sig=0):
@@ -425,12 +507,127 @@ class RawCodeBytecode(RawCode):
     def __init__(self, bytecode, qstrs, objs, raw_codes):
         super().__init__(MP_CODE_BYTECODE, bytecode, 0, qstrs, objs, raw_codes)
 
+    def _jump_label(self, ip):
+        # offset of the 2-byte label of the jump opcode at ip
+        op = self.bytecode[ip]
+        if op == MP_BC_COMPARE_POP_JUMP_IF_TRUE or op == MP_BC_COMPARE_POP_JUMP_IF_FALSE:
+            return ip + 2
+        return ip + 1
+
+    def _jump_is_signed(self, ip):
+        op = self.bytecode[ip]
+        return MP_BC_JUMP <= op <= MP_BC_COMPARE_POP_JUMP_IF_FALSE or op == MP_BC_UNWIND_JUMP
+
+    def _get_jump_target(self, ip):
+        label = self._jump_label(ip)
+        offset = self.bytecode[label] | self.bytecode[label + 1] << 8
+        if self._jump_is_signed(ip):
+            offset -= 0x8000
+        return label + 2 + offset
+
+    def _set_jump_target(self, ip, target):
+        label = self._jump_label(ip)
+        offset = target - (label + 2)
+        if self._jump_is_signed(ip):
+            offset += 0x8000
+        if 0 <= offset <= 0xffff:
+            self.bytecode[label] = offset & 0xff
+            self.bytecode[label + 1] = offset >> 8
+
+    def _opcodes(self):
+        ip = self.ip
+        while ip < len(self.bytecode):
+            f, sz = mp_opcode_format(self.bytecode, ip, True)
+            yield ip, f, sz
+            ip += sz
+
+    def optimise(self):
+        # Each rewrite here keeps every opcode that remains at the same offset,
+        # so the line-number info in the prelude and all other jumps stay valid.
+        bc = self.bytecode
+
+        # fuse a comparison with the conditional jump after it, as the compiler
+        # does for code compiled on the target
+        if config.MICROPY_OPT_SUPERINSTRUCTIONS:
+            targets = set(self._get_jump_target(ip) for ip, f, _ in self._opcodes() if f == MP_OPCODE_OFFSET)
+            prev = None
+            for ip, f, sz in list(self._opcodes()):
+                if (prev is not None and ip not in targets
+                    and MP_BC_BINARY_OP_MULTI <= bc[prev] <= MP_BC_BINARY_OP_MULTI + MP_BINARY_OP_IS
+                    and (bc[ip] == MP_BC_POP_JUMP_IF_TRUE or bc[ip] == MP_BC_POP_JUMP_IF_FALSE)):
+                    binary_op = bc[prev] - MP_BC_BINARY_OP_MULTI
+                    if bc[ip] == MP_BC_POP_JUMP_IF_TRUE:
+                        bc[prev] = MP_BC_COMPARE_POP_JUMP_IF_TRUE
+                    else:
+                        bc[prev] = MP_BC_COMPARE_POP_JUMP_IF_FALSE
+                    bc[ip] = binary_op
+                prev = ip
+
+        # thread jumps that land on an unconditional jump through to its target,
+        # and turn an unconditional jump to a return into the return itself
+        for ip, f, sz in self._opcodes():
+            if f != MP_OPCODE_OFFSET or not self._jump_is_signed(ip):
+                continue
+            target = self._get_jump_target(ip)
+            seen = set()
+            while bc[target] == MP_BC_JUMP and target not in seen:
+                seen.add(target)
+                target = self._get_jump_target(target)
+            if bc[ip] == MP_BC_JUMP and bc[target] == MP_BC_RETURN_VALUE:
+                # the 2 bytes after the new return are never reached
+                bc[ip:ip + 3] = bytes_cons((MP_BC_RETURN_VALUE,)) * 3
+            else:
+                self._set_jump_target(ip, target)
+
+    def freeze_compressed(self):
+        # the qstrs are written as placeholders and patched in after inflating,
+        # see py/frozenmod.c for the layout
+        bc = bytearray(self.bytecode)
+        qstrs = [(self.ip2, self.simple_name.qstr_id), (self.ip2 + 2, self.source_file.qstr_id)]
+        ip = self.ip
+        while ip < len(bc):
+            f, sz = mp_opcode_format(bc, ip, True)
+            if f == 1:
+                qstrs.append((ip + 1, self._unpack_qstr(ip + 1).qstr_id))
+            ip += sz
+        for offset, _ in qstrs:
+            bc[offset] = bc[offset + 1] = 0
+        comp = zlib.compressobj(9, zlib.DEFLATED, -15)
+        deflate = comp.compress(bytes(bc)) + comp.flush()
+        header = bytearray([0x80])
+        header += encode_uint(len(bc))
+        header += encode_uint(len(deflate))
+        header += encode_uint(len(qstrs))
+        links = []
+        prev = 0
+        for offset, qst in qstrs:
+            links.append((encode_uint(offset - prev), qst))
+            prev = offset + 2
+        size = len(header) + sum(len(l) + 2 for l, _ in links) + len(deflate)
+        if size >= len(bc):
+            return False
+
+        print('STATIC const byte fun_data_%s[%u] = {' % (self.escaped_name, size))
+        print('   ', ''.join(' 0x%02x,' % b for b in header))
+        for l, qst in links:
+            print('   ', ''.join(' 0x%02x,' % b for b in l), qst, '& 0xff,', qst, '>> 8,')
+        for i in range(0, len(deflate), 16):
+            print('   ', ''.join(' 0x%02x,' % b for b in deflate[i:i + 16]))
+        print('};')
+        return True
+
     def freeze(self, parent_name):
         self.freeze_children(parent_name)
 
         # generate bytecode data
         print()
         print('// frozen bytecode for file %s, scope %s%s' % (self.source_file.str, parent_name, self.simple_name.str))
+        if config.optimise:
+            self.optimise()
+        if config.compress_bytecode and self.freeze_compressed():
+            self.freeze_constants()
+            self.freeze_module()
+            return
         print('STATIC ', end='')
         if not config.MICROPY_OPT_CACHE_MAP_LOOKUP_IN_BYTECODE:
             print('const ', end='')
@@ -466,7 +663,7 @@ class RawCodeNative(RawCode):
         self.prelude = prelude
         self.qstr_links = qstr_links
         self.type_sig = type_sig
-        if config.native_arch in (MP_NATIVE_ARCH_X86, MP_NATIVE_ARCH_X64):
+        if config.native_arch in (MP_NATIVE_ARCH_X86, MP_NATIVE_ARCH_X64, MP_NATIVE_ARCH_XTENSA):
             self.fun_data_attributes = '__attribute__((section(".text,\\"ax\\",@progbits # ")))'
         else:
             self.fun_data_attributes = '__attribute__((section(".text,\\"ax\\",%progbits @ ")))'
@@ -475,22 +672,35 @@ class RawCodeNative(RawCode):
         print('    (%u & 0xf0) | (%s >> 12),' % (self.bytecode[pc], val), end='')
         print(' (%u & 0xfb) | (%s >> 9 & 0x04),' % (self.bytecode[pc + 1], val), end='')
         print(' (%s & 0xff),' % (val,), end='')
-        print(' (%u & 0x07) | (%s >> 4 & 0x70),' % (self.bytecode[pc + 3], val))
+        print(' (%u & 0x0f) | (%s >> 4 & 0x70),' % (self.bytecode[pc + 3], val))
 
     def _link_qstr(self, pc, kind, qst):
+        # must match arch_link_qstr in py/persistentcode.c; returns the
+        # number of bytes of machine code that were written
         if kind == 0:
+            # generic 16-bit link
             print('    %s & 0xff, %s >> 8,' % (qst, qst))
+            return 2
         else:
-            if kind == 2:
+            # architecture-specific link
+            is_obj = kind == 2
+            if is_obj:
                 qst = '((uintptr_t)MP_OBJ_NEW_QSTR(%s))' % qst
-            if config.native_arch in (MP_NATIVE_ARCH_X86, MP_NATIVE_ARCH_X64):
-                print('    %s & 0xff, %s >> 8, 0, 0,' % (qst, qst))
+            if config.native_arch in (MP_NATIVE_ARCH_X86, MP_NATIVE_ARCH_X64,
+                MP_NATIVE_ARCH_ARMV6, MP_NATIVE_ARCH_XTENSA):
+                # full 32-bit word
+                print('    %s & 0xff, %s >> 8 & 0xff, %s >> 16 & 0xff, %s >> 24,' % (qst, qst, qst, qst))
+                return 4
             elif MP_NATIVE_ARCH_ARMV6M <= config.native_arch <= MP_NATIVE_ARCH_ARMV7EMDP:
                 if is_obj:
-                    self._asm_thumb_rewrite_mov(i, qst)
-                    self._asm_thumb_rewrite_mov(i + 4, '(%s >> 16)' % qst)
+                    # qstr object, movw and movt
+                    self._asm_thumb_rewrite_mov(pc, qst)
+                    self._asm_thumb_rewrite_mov(pc + 4, '(%s >> 16)' % qst)
+                    return 8
                 else:
-                    self._asm_thumb_rewrite_mov(i, qst)
+                    # qstr number, movw instruction
+                    self._asm_thumb_rewrite_mov(pc, qst)
+                    return 4
             else:
                 assert 0
 
@@ -518,8 +728,7 @@ class RawCodeNative(RawCode):
                 # link qstr
                 qi_off, qi_kind, qi_val = self.qstr_links[qi]
                 qst = global_qstrs[qi_val].qstr_id
-                self._link_qstr(i, qi_kind, qst)
-                i += 4
+                i += self._link_qstr(i, qi_kind, qst)
                 qi += 1
             else:
                 # copy machine code (max 16 bytes)
@@ -596,6 +805,8 @@ def read_obj(f):
     obj_type = f.read(1)
     if obj_type == b'e':
         return Ellipsis
+    elif obj_type == b't':
+        return tuple(read_obj(f) for _ in range(read_uint(f)))
     else:
         buf = f.read(read_uint(f))
         if obj_type == b's':
@@ -664,7 +875,7 @@ def read_raw_code(f, qstr_win):
             # load qstr link table
             n_qstr_link = read_uint(f)
             for _ in range(n_qstr_link):
-                off = read_uint(f, qstr_win)
+                off = read_uint(f)
                 qst = read_qstr(f, qstr_win)
                 qstr_links.append((off >> 2, off & 3, qst))
 
@@ -737,6 +948,7 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('#include "py/mpconfig.h"')
     print('#include "py/objint.h"')
     print('#include "py/objstr.h"')
+    print('#include "py/objtuple.h"')
     print('#include "py/emitglue.h"')
     print()
 
@@ -745,6 +957,18 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('#endif')
     print()
 
+    if config.optimise and config.MICROPY_OPT_SUPERINSTRUCTIONS:
+        print('#if !MICROPY_OPT_SUPERINSTRUCTIONS')
+        print('#error "incompatible MICROPY_OPT_SUPERINSTRUCTIONS"')
+        print('#endif')
+        print()
+
+    if config.compress_bytecode:
+        print('#if !MICROPY_MODULE_FROZEN_MPY_COMPRESSED')
+        print('#error "compressed bytecode needs MICROPY_MODULE_FROZEN_MPY_COMPRESSED"')
+        print('#endif')
+        print()
+
     print('#if MICROPY_LONGINT_IMPL != %u' % config.MICROPY_LONGINT_IMPL)
     print('#error "incompatible MICROPY_LONGINT_IMPL"')
     print('#endif')
@@ -786,6 +1010,16 @@ def freeze_mpy(base_qstrs, raw_codes):
     # As in qstr.c, set so that the first dynamically allocated pool is twice this size; must be <= the len
     qstr_pool_alloc = min(len(new), 10)
 
+    qstr_index = qstrutil.make_hash_index([qstrutil.compute_hash(bytes_cons(qstr, 'utf8'), config.MICROPY_QSTR_BYTES_IN_HASH)
+        for _, _, qstr in new])
+
+    print()
+    print('#if MICROPY_QSTR_HASH_INDEX')
+    print('STATIC const uint16_t mp_qstr_frozen_const_index[] = {')
+    for i in range(0, len(qstr_index), 16):
+        print('    %s,' % ', '.join(str(n) for n in qstr_index[i:i + 16]))
+    print('};')
+    print('#endif')
     print()
     print('extern const qstr_pool_t mp_qstr_const_pool;');
     print('const qstr_pool_t mp_qstr_frozen_const_pool = {')
@@ -793,6 +1027,10 @@ def freeze_mpy(base_qstrs, raw_codes):
     print('    MP_QSTRnumber_of, // previous pool size')
     print('    %u, // allocated entries' % qstr_pool_alloc)
     print('    %u, // used entries' % len(new))
+    print('    #if MICROPY_QSTR_HASH_INDEX')
+    print('    mp_qstr_frozen_const_index,')
+    print('    %u, // index mask' % (len(qstr_index) - 1))
+    print('    #endif')
     print('    {')
     for _, _, qstr in new:
         print('        %s,'
@@ -828,6 +1066,12 @@ def main():
         help='long-int implementation used by target (default mpz)')
     cmd_parser.add_argument('-mmpz-dig-size', metavar='N', type=int, default=16,
         help='mpz digit size used by target (default 16)')
+    cmd_parser.add_argument('-mcompress-bytecode', action='store_true',
+        help='deflate each bytecode function, for MICROPY_MODULE_FROZEN_MPY_COMPRESSED')
+    cmd_parser.add_argument('-moptimise', action='store_true',
+        help='optimise bytecode and share identical constants between frozen modules')
+    cmd_parser.add_argument('-msuperinstructions', action='store_true',
+        help='target has MICROPY_OPT_SUPERINSTRUCTIONS enabled, used with -moptimise')
     cmd_parser.add_argument('files', nargs='+',
         help='input .mpy files')
     args = cmd_parser.parse_args()
@@ -839,6 +1083,9 @@ def main():
         'mpz':config.MICROPY_LONGINT_IMPL_MPZ,
     }[args.mlongint_impl]
     config.MPZ_DIG_SIZE = args.mmpz_dig_size
+    config.compress_bytecode = args.mcompress_bytecode
+    config.optimise = args.moptimise
+    config.MICROPY_OPT_SUPERINSTRUCTIONS = args.msuperinstructions
 
     # set config values for qstrs, and get the existing base set of qstrs
     if args.qstr_header:
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+#
+# This file is part of the MicroPython project, http://micropython.org/
+#
+# The MIT License (MIT)
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+# THE SOFTWARE.
+
+"""
+Read a log file written by the ulog module, oldest record first.
+
+    ulog.py data.log              print the records, one per line
+    ulog.py --csv data.log        print them as CSV
+    ulog.py --info data.log       print the layout and the blocks found
+
+The layout, including the record format, is read from the file itself.
+Blocks with a bad CRC are skipped.
+"""
+
+from __future__ import print_function
+
+import argparse
+import struct
+import sys
+import zlib
+
+SUPER_HDR = struct.Struct('<4sBxHIHHI')
+BLOCK_HDR = struct.Struct('<2sHIHxxI')
+VERSION = 1
+
+
+class LogError(Exception):
+    pass
+
+
+class Log:
+    def __init__(self, data):
+        if len(data) < SUPER_HDR.size:
+            raise LogError('file too short')
+        magic, version, self.block_size, self.n_blocks, self.rec_size, fmt_len, crc = \
+            SUPER_HDR.unpack_from(data)
+        if magic != b'ULOG' or version != VERSION:
+            raise LogError('not a ulog file')
+        fmt = data[SUPER_HDR.size:SUPER_HDR.size + fmt_len]
+        if zlib.crc32(data[:16] + fmt) & 0xffffffff != crc:
+            raise LogError('bad superblock CRC')
+        self.format = fmt.decode()
+        self.rec = struct.Struct(self.format)
+        if self.rec.size != self.rec_size:
+            raise LogError('record size mismatch')
+        self.blocks = {}
+        for slot in range(self.n_blocks):
+            block = data[(1 + slot) * self.block_size:(2 + slot) * self.block_size]
+            if len(block) < BLOCK_HDR.size:
+                break
+            magic, rec_size, seq, count, crc = BLOCK_HDR.unpack_from(block)
+            if magic != b'UL' or rec_size != self.rec_size or seq % self.n_blocks != slot:
+                continue
+            recs = block[BLOCK_HDR.size:BLOCK_HDR.size + count * rec_size]
+            if len(recs) != count * rec_size or zlib.crc32(block[:12] + recs) & 0xffffffff != crc:
+                continue
+            self.blocks[seq] = recs
+
+    def records(self):
+        for seq in sorted(self.blocks):
+            recs = self.blocks[seq]
+            for i in range(0, len(recs), self.rec_size):
+                yield self.rec.unpack_from(recs, i)
+
+
+def main():
+    cmd_parser = argparse.ArgumentParser(description='Read a ulog log file.')
+    cmd_parser.add_argument('--csv', action='store_true', help='print the records as CSV')
+    cmd_parser.add_argument('--info', action='store_true', help='print the layout and blocks')
+    cmd_parser.add_argument('file', help='log file')
+    args = cmd_parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        data = f.read()
+    try:
+        log = Log(data)
+    except LogError as er:
+        print('{}: {}'.format(args.file, er), file=sys.stderr)
+        sys.exit(1)
+
+    if args.info:
+        print('format {!r}, {} byte records, {} blocks of {} bytes'.format(
+            log.format, log.rec_size, log.n_blocks, log.block_size))
+        for seq in sorted(log.blocks):
+            print('block {}: {} records'.format(seq, len(log.blocks[seq]) // log.rec_size))
+        return
+
+    for rec in log.records():
+        if args.csv:
+            print(','.join(str(v) for v in rec))
+        else:
+            print(rec)
+
+
+if __name__ == '__main__':
+    main()
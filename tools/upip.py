@@ -182,7 +182,8 @@ def install_pkg(pkg_spec, install_path):
     package_fname = op_basename(package_url)
     f1 = url_open(package_url)
     try:
-        f2 = uzlib.DecompIO(f1, gzdict_sz)
+        # nothing follows the package in f1, so it can be read in chunks
+        f2 = uzlib.DecompIO(f1, gzdict_sz, 128)
         f3 = tarfile.TarFile(fileobj=f2)
         meta = install_tar(f3, install_path)
     finally: